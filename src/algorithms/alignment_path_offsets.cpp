@@ -18,13 +18,22 @@ alignment_path_offsets(const PathPositionHandleGraph& graph,
     }
     unordered_map<path_handle_t, vector<pair<size_t, bool> > > offsets;
     if (graph.get_path_count() == 0) return offsets;
+    // Find the positions of the Mappings we need to look at all at once, so
+    // that nearby Mappings can share their searches
+    vector<const Mapping*> mappings;
+    vector<pos_t> mapping_positions;
     for (auto& mapping : aln.path().mapping()) {
-        // How many bases does this Mapping cover over?
-        size_t mapping_width = mapping_from_length(mapping);
-        if (mapping_width == 0 && !nearby) {
+        if (mapping_from_length(mapping) == 0 && !nearby) {
             // Just skip over this mapping; it touches no bases.
             continue;
         }
+        mappings.push_back(&mapping);
+        mapping_positions.push_back(make_pos_t(mapping.position()));
+    }
+    auto mapping_offsets = algorithms::nearest_offsets_in_paths(&graph, mapping_positions, nearby ? search_limit : -1, path_filter);
+    for (size_t i = 0; i < mappings.size(); ++i) {
+        // How many bases does this Mapping cover over?
+        size_t mapping_width = mapping_from_length(*mappings[i]);
         // We may have to consider both the starts and ends of mappings
         vector<bool> end = {false};
         if (just_min && !nearby) {
@@ -32,10 +41,8 @@ alignment_path_offsets(const PathPositionHandleGraph& graph,
             // could come from the Mapping start or the Mapping end.
             end.push_back(true);
         }
-        // Find the position of this end of this mapping
-        pos_t mapping_pos = make_pos_t(mapping.position());
         // Find the positions for this end of this Mapping
-        auto pos_offs = algorithms::nearest_offsets_in_paths(&graph, mapping_pos, nearby ? search_limit : -1, path_filter);
+        auto& pos_offs = mapping_offsets[i];
         for (auto look_at_end : end) {
             // For the start and the end of the Mapping, as needed
             for (auto& p : pos_offs) {
@@ -22,6 +22,9 @@ using namespace std;
 ///
 /// If path_filter is set, and it returns false for a path, that path is not
 /// used to annotate the read.
+///
+/// Passing a StepPositionOverlay makes the lookups lock-free and cheap to
+/// share between threads.
 unordered_map<path_handle_t, vector<pair<size_t, bool> > >
 alignment_path_offsets(const PathPositionHandleGraph& graph,
                        const Alignment& aln,
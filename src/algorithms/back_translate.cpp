@@ -5,6 +5,7 @@
 #include "back_translate.hpp"
 #include "../path.hpp"
 #include "../snarls.hpp"
+#include "../flat_file_back_translation.hpp"
 
 namespace vg {
 namespace algorithms {
@@ -50,42 +51,58 @@ void back_translate_in_place(const NamedNodeBackTranslation* translation, Path&
     // their indices in this list.
     vector<size_t> mapping_indices_to_remove;
     
+    // Determine the range of each Mapping
+    vector<oriented_node_range_t> source_ranges;
+    source_ranges.reserve(path.mapping_size());
+    for (size_t i = 0; i < path.mapping_size(); i++) {
+        const Mapping& mapping = path.mapping(i);
+        source_ranges.emplace_back(mapping.position().node_id(), mapping.position().is_reverse(),
+                                   mapping.position().offset(), from_length(mapping));
+    }
+    
+    // Translate them all, in one batch if the translation can do that
+    vector<oriented_node_range_t> translated_ranges;
+    if (auto flat_translation = dynamic_cast<const FlatFileBackTranslation*>(translation)) {
+        flat_translation->translate_back(source_ranges, translated_ranges);
+    } else {
+        translated_ranges.reserve(source_ranges.size());
+        for (auto& source_range : source_ranges) {
+            vector<oriented_node_range_t> translated = translation->translate_back(source_range);
+            
+            if (translated.size() != 1) {
+                // TODO: Implement translations that split graph nodes into multiple segments.
+                throw std::runtime_error("Translated range on node " + to_string(get<0>(source_range)) +
+                                         " to " + to_string(translated.size()) + 
+                                         " named segment ranges, but complex translations like this are not yet implemented");
+            }
+            translated_ranges.push_back(translated[0]);
+        }
+    }
+    
     for (size_t i = 0; i < path.mapping_size(); i++) {
         // For each Mapping
         Mapping* mapping = path.mutable_mapping(i);
+        auto& source_range = source_ranges[i];
+        auto& translated_range = translated_ranges[i];
         
-        // Determine its range
-        oriented_node_range_t source_range(mapping->position().node_id(), mapping->position().is_reverse(),
-                                           mapping->position().offset(), from_length(*mapping)); 
-        
-        // Translate it
-        vector<oriented_node_range_t> translated = translation->translate_back(source_range);
-        
-        if (translated.size() != 1) {
-            // TODO: Implement translations that split graph nodes into multiple segments.
-            throw std::runtime_error("Translated range on node " + to_string(get<0>(source_range)) +
-                                     " to " + to_string(translated.size()) + 
-                                     " named segment ranges, but complex translations like this are not yet implemented");
-        }
-        
-        auto& translated_range = translated[0];
         if (get<1>(translated_range) != get<1>(source_range)) {
             // TODO: Implement translations that flip orientations.
             throw std::runtime_error("Translated range on node " + to_string(get<0>(source_range)) +
                                      " ended up on the opposite strand; complex translations like this are not yet implemented");
         }
         
-        // Change over to the named sequence and the offset there.
-        mapping->mutable_position()->clear_node_id();
-        mapping->mutable_position()->set_name(translation->get_back_graph_node_name(get<0>(translated_range)));
-        mapping->mutable_position()->set_offset(get<2>(translated_range));
-        
         if (i == 0 || get<0>(translated_range) != prev_segment_number || get<1>(translated_range) != prev_segment_is_reverse || get<2>(translated_range) != prev_segment_offset) {
             // We have done a transition that isn't just abutting in a
             // segment. We assume anything we want to represent as a
             // deletion is already represented as a deletion, so we
             // preserve all jumps as jumps.
             
+            // Change over to the named sequence and the offset there. We
+            // only need to look up the name for Mappings that we keep.
+            mapping->mutable_position()->clear_node_id();
+            mapping->mutable_position()->set_name(translation->get_back_graph_node_name(get<0>(translated_range)));
+            mapping->mutable_position()->set_offset(get<2>(translated_range));
+            
             // Just move to this part of this segment, and then advance by
             // the length of the piece we translated.
             prev_segment_number = get<0>(translated_range);
@@ -8,6 +8,8 @@
 
 #include <handlegraph/algorithms/dijkstra.hpp>
 
+#include <iterator>
+
 //#define debug_chaining
 
 namespace vg {
@@ -64,7 +66,7 @@ void sort_and_shadow(const std::vector<Anchor>& items, std::vector<size_t>& inde
     // and the difference between the graph offset and the read position. So we
     // can represent them with pos_t, and subtract the read position out of the
     // stored offset to make them.
-    std::unordered_map<pos_t, size_t> diagonal_progress;
+    flat_hash_map<pos_t, size_t> diagonal_progress;
     
     // Scan through and make a new collection of indexes, keeping the first on
     // any pair of diagonals, which will thus be the one with the earliest
@@ -118,6 +120,35 @@ void sort_and_shadow(std::vector<Anchor>& items) {
     items = std::move(kept_items);
 }
 
+/// How many predecessors should we score together when batching transitions?
+static constexpr size_t TRANSITION_BATCH_SIZE = 8;
+
+/// Work out how many points it is worth to make a transition across the given
+/// read and graph distances, or std::numeric_limits<int>::min() if the
+/// transition is not allowed.
+static inline int score_transition(size_t read_distance, size_t graph_distance, int gap_open, int gap_extension, size_t max_indel_bases) {
+    // Don't allow the transition if it seems like we're going the long
+    // way around an inversion and needing a huge indel.
+    if (read_distance == numeric_limits<size_t>::max()) {
+        // Overlap in read, so not allowed.
+        return std::numeric_limits<int>::min();
+    } else if (graph_distance == numeric_limits<size_t>::max()) {
+        // No graph connection
+        return std::numeric_limits<int>::min();
+    } else {
+        // Decide how much length changed
+        size_t indel_length = (read_distance > graph_distance) ? read_distance - graph_distance : graph_distance - read_distance;
+        
+        if (indel_length > max_indel_bases) {
+            // Don't allow an indel this long
+            return std::numeric_limits<int>::min();
+        } else {
+            // Then charge for that indel
+            return score_gap(indel_length, gap_open, gap_extension);
+        }
+    }
+}
+
 TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
                            const VectorView<Anchor>& to_chain,
                            const SnarlDistanceIndex& distance_index,
@@ -131,7 +162,9 @@ TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
                            double lookback_scale_factor,
                            double min_good_transition_score_per_base,
                            int item_bonus,
-                           size_t max_indel_bases) {
+                           size_t max_indel_bases,
+                           bool batch_transitions,
+                           DistanceCache* distance_cache) {
     
     DiagramExplainer diagram;
     diagram.add_globals({{"rankdir", "LR"}});
@@ -162,6 +195,12 @@ TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
     // What's the winner so far?
     TracedScore best_score = TracedScore::unset();
     
+    // When batching transitions, we keep the batch in these arrays.
+    size_t batch_predecessors[TRANSITION_BATCH_SIZE];
+    size_t batch_read_distances[TRANSITION_BATCH_SIZE];
+    size_t batch_graph_distances[TRANSITION_BATCH_SIZE];
+    int batch_jump_points[TRANSITION_BATCH_SIZE];
+    
     for (size_t i = 0; i < to_chain.size(); i++) {
         // For each item
         auto& here = to_chain[i];
@@ -206,89 +245,43 @@ TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
         // the best one we have seen so far in case the standard goes below it. 
         int best_transition_found = std::numeric_limits<int>::min();
         
-        // Start considering predecessors for this item.
-        auto predecessor_index_it = first_overlapping_it;
-        while (predecessor_index_it != read_end_order.begin()) {
-            --predecessor_index_it;
-            
-            // How many items have we considered before this one?
-            size_t item_number = items_considered++;
-            
-            // For each source that ended before here started, in reverse order by end position...
-            auto& source = to_chain[*predecessor_index_it];
-            
-#ifdef debug_chaining
-            cerr << "\tConsider transition from #" << *predecessor_index_it << ": " << source << endl;
-#endif
-
-            // How far do we go in the read?
-            size_t read_distance = get_read_distance(source, here);
-            
+        // Decide if we should stop looking back before the given predecessor,
+        // and raise the lookback threshold if we haven't found anything good.
+        auto should_stop = [&](size_t item_number, size_t read_distance) {
             if (item_number > lookback_item_hard_cap) {
                 // This would be too many
 #ifdef debug_chaining
                 cerr << "\t\tDisregard due to hitting lookback item hard cap" << endl;
 #endif
-                break;
+                return true;
             }
             if (item_number >= min_lookback_items) {
                 // We have looked at enough predecessors that we might consider stopping.
                 // See if we should look back this far.
                 if (read_distance > max_lookback_bases) {
                     // This is further in the read than the real hard limit.
-                    break;
+                    return true;
                 } else if (read_distance > lookback_threshold && good_score_found) {
                     // We already found something good enough.
-                    break;
+                    return true;
                 }
             }
             if (read_distance > lookback_threshold && !good_score_found) {
                 // We still haven't found anything good, so raise the threshold.
                 lookback_threshold *= lookback_scale_factor;
             }
-            
-            // Now it's safe to make a distance query
-#ifdef debug_chaining
-            cerr << "\t\tCome from score " << best_chain_score[*predecessor_index_it]
-                << " across " << source << " to " << here << endl;
-#endif
-            
-            // We will actually evaluate the source.
-            
-            // How far do we go in the graph?
-            size_t graph_distance = get_graph_distance(source, here, distance_index, graph);
-            
-            // How much does it pay (+) or cost (-) to make the jump from there
-            // to here?
-            // Don't allow the transition if it seems like we're going the long
-            // way around an inversion and needing a huge indel.
-            int jump_points;
-            
-            if (read_distance == numeric_limits<size_t>::max()) {
-                // Overlap in read, so not allowed.
-                jump_points = std::numeric_limits<int>::min();
-            } else if (graph_distance == numeric_limits<size_t>::max()) {
-                // No graph connection
-                jump_points = std::numeric_limits<int>::min();
-            } else {
-                // Decide how much length changed
-                size_t indel_length = (read_distance > graph_distance) ? read_distance - graph_distance : graph_distance - read_distance;
-                
-                if (indel_length > max_indel_bases) {
-                    // Don't allow an indel this long
-                    jump_points = std::numeric_limits<int>::min();
-                } else {
-                    // Then charge for that indel
-                    jump_points = score_gap(indel_length, gap_open, gap_extension);
-                }
-            }
-            
+            return false;
+        };
+        
+        // Take a transition from the given predecessor, worth the given jump
+        // points, into account.
+        auto record_transition = [&](size_t predecessor, size_t read_distance, size_t graph_distance, int jump_points) {
             // And how much do we end up with overall coming from there.
             int achieved_score;
             
             if (jump_points != numeric_limits<int>::min()) {
                 // Get the score we are coming from
-                TracedScore source_score = TracedScore::score_from(best_chain_score, *predecessor_index_it);
+                TracedScore source_score = TracedScore::score_from(best_chain_score, predecessor);
                 
                 // And the score with the transition and the points from the item
                 TracedScore from_source_score = source_score.add_points(jump_points + item_points);
@@ -304,7 +297,7 @@ TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
                     // Only explain edges that were actual candidates since we
                     // won't let local score go negative
                     
-                    std::string source_gvnode = "i" + std::to_string(*predecessor_index_it);
+                    std::string source_gvnode = "i" + std::to_string(predecessor);
                     // Suggest that we have an edge, where the edges that are the best routes here are the most likely to actually show up.
                     diagram.suggest_edge(source_gvnode, here_gvnode, here_gvnode, from_source_score.score, {
                         {"label", std::to_string(jump_points)},
@@ -326,6 +319,107 @@ TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
                 // We found a jump that looks plausible given how far we have searched, so we can stop searching way past here.
                 good_score_found = true;
             }
+        };
+        
+        // Start considering predecessors for this item.
+        auto predecessor_index_it = first_overlapping_it;
+        if (!batch_transitions) {
+            while (predecessor_index_it != read_end_order.begin()) {
+                --predecessor_index_it;
+                
+                // How many items have we considered before this one?
+                size_t item_number = items_considered++;
+                
+                // For each source that ended before here started, in reverse order by end position...
+                auto& source = to_chain[*predecessor_index_it];
+                
+#ifdef debug_chaining
+                cerr << "\tConsider transition from #" << *predecessor_index_it << ": " << source << endl;
+#endif
+
+                // How far do we go in the read?
+                size_t read_distance = get_read_distance(source, here);
+                
+                if (should_stop(item_number, read_distance)) {
+                    break;
+                }
+                
+                // Now it's safe to make a distance query
+#ifdef debug_chaining
+                cerr << "\t\tCome from score " << best_chain_score[*predecessor_index_it]
+                    << " across " << source << " to " << here << endl;
+#endif
+                
+                // We will actually evaluate the source.
+                
+                // How far do we go in the graph?
+                size_t graph_distance = get_graph_distance(source, here, distance_index, graph, distance_cache);
+                
+                // How much does it pay (+) or cost (-) to make the jump from there
+                // to here?
+                int jump_points = score_transition(read_distance, graph_distance, gap_open, gap_extension, max_indel_bases);
+                
+                record_transition(*predecessor_index_it, read_distance, graph_distance, jump_points);
+            }
+        } else {
+            // Work through the predecessors a batch at a time: first find the
+            // distances for the whole batch, then score all the transitions
+            // together, and then apply them in order, so we stop in the same
+            // place as the one-at-a-time loop.
+            bool stopped = false;
+            while (!stopped && predecessor_index_it != read_end_order.begin()) {
+                // Collect the batch, applying only the limits that don't
+                // depend on the scores we find.
+                size_t batch_count = 0;
+                while (batch_count < TRANSITION_BATCH_SIZE && predecessor_index_it != read_end_order.begin()) {
+                    size_t item_number = items_considered + batch_count;
+                    size_t read_distance = get_read_distance(to_chain[*std::prev(predecessor_index_it)], here);
+                    if (item_number > lookback_item_hard_cap ||
+                        (item_number >= min_lookback_items && read_distance > max_lookback_bases)) {
+                        // Nothing past here can be looked at.
+                        break;
+                    }
+                    --predecessor_index_it;
+                    batch_predecessors[batch_count] = *predecessor_index_it;
+                    batch_read_distances[batch_count] = read_distance;
+                    batch_count++;
+                }
+                if (batch_count == 0) {
+                    break;
+                }
+                
+                // Get all the graph distances we might need. Transitions that
+                // overlap in the read are never allowed, so don't bother
+                // querying those.
+                for (size_t k = 0; k < batch_count; k++) {
+                    batch_graph_distances[k] = (batch_read_distances[k] == numeric_limits<size_t>::max()) ?
+                        numeric_limits<size_t>::max() :
+                        get_graph_distance(to_chain[batch_predecessors[k]], here, distance_index, graph, distance_cache);
+                }
+                
+                // Score all the transitions. This is written without branches
+                // so the compiler can vectorize it.
+                for (size_t k = 0; k < batch_count; k++) {
+                    size_t read_distance = batch_read_distances[k];
+                    size_t graph_distance = batch_graph_distances[k];
+                    size_t indel_length = (read_distance > graph_distance) ? read_distance - graph_distance : graph_distance - read_distance;
+                    bool allowed = (read_distance != numeric_limits<size_t>::max()) &
+                                   (graph_distance != numeric_limits<size_t>::max()) &
+                                   (indel_length <= max_indel_bases);
+                    int gap_points = indel_length ? -gap_open - (int) ((indel_length - 1) * gap_extension) : 0;
+                    batch_jump_points[k] = allowed ? gap_points : numeric_limits<int>::min();
+                }
+                
+                // Apply them in order, stopping where the scalar loop would.
+                for (size_t k = 0; k < batch_count; k++) {
+                    size_t item_number = items_considered++;
+                    if (should_stop(item_number, batch_read_distances[k])) {
+                        stopped = true;
+                        break;
+                    }
+                    record_transition(batch_predecessors[k], batch_read_distances[k], batch_graph_distances[k], batch_jump_points[k]);
+                }
+            }
         }
         
 #ifdef debug_chaining
@@ -416,7 +510,9 @@ pair<int, vector<size_t>> find_best_chain(const VectorView<Anchor>& to_chain,
                                           double lookback_scale_factor,
                                           double min_good_transition_score_per_base,
                                           int item_bonus,
-                                          size_t max_indel_bases) {
+                                          size_t max_indel_bases,
+                                          bool batch_transitions,
+                                          DistanceCache* distance_cache) {
                                                                  
     if (to_chain.empty()) {
         return std::make_pair(0, vector<size_t>());
@@ -437,7 +533,9 @@ pair<int, vector<size_t>> find_best_chain(const VectorView<Anchor>& to_chain,
                                                                  lookback_scale_factor,
                                                                  min_good_transition_score_per_base,
                                                                  item_bonus,
-                                                                 max_indel_bases);
+                                                                 max_indel_bases,
+                                                                 batch_transitions,
+                                                                 distance_cache);
         // Then do the traceback and pair it up with the score.
         return std::make_pair(
             best_past_ending_score_ever.score,
@@ -457,13 +555,19 @@ int score_best_chain(const VectorView<Anchor>& to_chain, const SnarlDistanceInde
     }
 }
 
-size_t get_graph_distance(const Anchor& from, const Anchor& to, const SnarlDistanceIndex& distance_index, const HandleGraph& graph) {
+size_t get_graph_distance(const Anchor& from, const Anchor& to, const SnarlDistanceIndex& distance_index, const HandleGraph& graph,
+                          DistanceCache* distance_cache) {
     // TODO: hide something in the Anchors so we can use the minimizer cache information
     // For now just measure between the graph positions.
     
     auto from_pos = from.graph_end();
     auto& to_pos = to.graph_start();
     
+    if (distance_cache) {
+        // Anchors on the same nodes come up over and over, so remember the answers.
+        return distance_cache->minimum_distance(distance_index, from_pos, to_pos, &graph);
+    }
+    
     return distance_index.minimum_distance(
         id(from_pos), is_rev(from_pos), offset(from_pos),
         id(to_pos), is_rev(to_pos), offset(to_pos),
@@ -27,6 +27,7 @@
 
 #include "../gbwt_extender.hpp"
 #include "../snarl_seed_clusterer.hpp"
+#include "../distance_cache.hpp"
 #include "../handle.hpp"
 #include "../explainer.hpp"
 #include "../utility.hpp"
@@ -214,6 +215,13 @@ void sort_and_shadow(std::vector<Anchor>& items);
  *
  * Limits transitions to those involving indels of the given size or less, to
  * avoid very bad transitions.
+ *
+ * If batch_transitions is set, finds graph distances for several predecessors
+ * at a time and scores their transitions together in a vectorizable loop.
+ * This produces the same result as considering them one at a time, but may
+ * make a few distance queries past where the lookback would have stopped.
+ *
+ * If distance_cache is set, graph distances are looked up through it.
  */
 TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
                            const VectorView<Anchor>& to_chain,
@@ -228,7 +236,9 @@ TracedScore chain_items_dp(vector<TracedScore>& best_chain_score,
                            double lookback_scale_factor = 2.0,
                            double min_good_transition_score_per_base = -0.1,
                            int item_bonus = 0,
-                           size_t max_indel_bases = 100);
+                           size_t max_indel_bases = 100,
+                           bool batch_transitions = false,
+                           DistanceCache* distance_cache = nullptr);
 
 /**
  * Trace back through in the given DP table from the best chain score.
@@ -245,6 +255,10 @@ vector<size_t> chain_items_traceback(const vector<TracedScore>& best_chain_score
  *
  * Returns the score and the list of indexes of items visited to achieve
  * that score, in order.
+ *
+ * If batch_transitions is set, uses batched transition scoring as described
+ * for chain_items_dp(). If distance_cache is set, graph distances are looked
+ * up through it.
  */
 pair<int, vector<size_t>> find_best_chain(const VectorView<Anchor>& to_chain,
                                           const SnarlDistanceIndex& distance_index,
@@ -258,7 +272,9 @@ pair<int, vector<size_t>> find_best_chain(const VectorView<Anchor>& to_chain,
                                           double lookback_scale_factor = 2.0,
                                           double min_good_transition_score_per_base = -0.1,
                                           int item_bonus = 0,
-                                          size_t max_indel_bases = 100);
+                                          size_t max_indel_bases = 100,
+                                          bool batch_transitions = false,
+                                          DistanceCache* distance_cache = nullptr);
 
 /**
  * Score the given group of items. Determines the best score that can be
@@ -269,7 +285,9 @@ pair<int, vector<size_t>> find_best_chain(const VectorView<Anchor>& to_chain,
 int score_best_chain(const VectorView<Anchor>& to_chain, const SnarlDistanceIndex& distance_index, const HandleGraph& graph, int gap_open, int gap_extension);
 
 /// Get distance in the graph, or std::numeric_limits<size_t>::max() if unreachable.
-size_t get_graph_distance(const Anchor& from, const Anchor& to, const SnarlDistanceIndex& distance_index, const HandleGraph& graph);
+/// If a DistanceCache is given, use it to avoid repeating queries.
+size_t get_graph_distance(const Anchor& from, const Anchor& to, const SnarlDistanceIndex& distance_index, const HandleGraph& graph,
+                          DistanceCache* distance_cache = nullptr);
 
 /// Get distance in the read, or std::numeric_limits<size_t>::max() if unreachable.
 size_t get_read_distance(const Anchor& from, const Anchor& to);
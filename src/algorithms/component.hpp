@@ -14,18 +14,30 @@ namespace algorithms {
 
 using namespace std;
 
-// returns the number of weakly connected components
+// returns the number of weakly connected components, found on all threads
 size_t num_components(const HandleGraph& graph);
 
-// returns the size in number of nodes of each component
+// returns the size in number of nodes of each component, found on all threads
 vector<size_t> component_sizes(const HandleGraph& graph);
 
+// returns the node IDs of each weakly connected component, in the same order
+// as handlealgs::weakly_connected_components(), but found on all threads with
+// a concurrent union-find over node ranks
+vector<unordered_set<nid_t>> weakly_connected_components_parallel(const HandleGraph& graph);
+
+// calls the iteratee with each node ID and the number of its weakly connected
+// component, numbering the components in the order that their first nodes
+// come up in for_each_handle(), which is the order used by the functions above.
+// the components are found on all threads, but the iteratee is called on this
+// one, in for_each_handle() order. returns the number of components.
+size_t for_each_component_label(const HandleGraph& graph, const function<void(nid_t, size_t)>& iteratee);
+
 // returns sets of path handles, one set for each component (unless the
 // component doesn't have any paths)
 vector<unordered_set<path_handle_t>> component_paths(const PathHandleGraph& graph);
 
-// the same semantics as the previous, but multithreaded and more
-// memory intensive
+// the same semantics as the previous, but finds the components with a
+// concurrent union-find over node ranks and then scans the paths in parallel
 vector<unordered_set<path_handle_t>> component_paths_parallel(const PathHandleGraph& graph);
 }
 
@@ -0,0 +1,154 @@
+#include "copy_in_order.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+#include <ips4o.hpp>
+
+namespace vg {
+namespace algorithms {
+
+using namespace std;
+
+void copy_in_order(const PathHandleGraph& source, MutablePathMutableHandleGraph& into,
+                   const vector<handle_t>& order, size_t max_node_length) {
+
+    // work out how many pieces each node becomes, and from that the first
+    // new ID of each node, with one past the end at the end
+    vector<nid_t> first_ids(order.size() + 1);
+    first_ids[0] = 1;
+#pragma omp parallel for
+    for (size_t i = 0; i < order.size(); ++i) {
+        size_t length = source.get_length(order[i]);
+        bool whole = (max_node_length == 0 || length <= max_node_length);
+        first_ids[i + 1] = whole ? 1 : (length + max_node_length - 1) / max_node_length;
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        first_ids[i + 1] += first_ids[i];
+    }
+
+    // pair each old ID with its place in the order, and sort by old ID for lookup
+    vector<pair<nid_t, size_t>> ranks(order.size());
+#pragma omp parallel for
+    for (size_t i = 0; i < order.size(); ++i) {
+        ranks[i] = make_pair(source.get_id(order[i]), i);
+    }
+    ips4o::parallel::sort(ranks.begin(), ranks.end());
+    auto rank_of = [&](const handle_t& handle) {
+        nid_t old_id = source.get_id(handle);
+        auto it = std::lower_bound(ranks.begin(), ranks.end(), make_pair(old_id, (size_t) 0));
+        if (it == ranks.end() || it->first != old_id) {
+            throw std::out_of_range("Node " + std::to_string(old_id) + " is not in the ordering");
+        }
+        return it->second;
+    };
+
+    // the new pieces a traversal of an old handle starts and ends on, as
+    // IDs and orientations
+    auto entering = [&](const handle_t& handle) {
+        size_t rank = rank_of(handle);
+        bool is_reverse = source.get_is_reverse(handle);
+        return make_pair(is_reverse ? first_ids[rank + 1] - 1 : first_ids[rank], is_reverse);
+    };
+    auto leaving = [&](const handle_t& handle) {
+        size_t rank = rank_of(handle);
+        bool is_reverse = source.get_is_reverse(handle);
+        return make_pair(is_reverse ? first_ids[rank] : first_ids[rank + 1] - 1, is_reverse);
+    };
+
+    // make the nodes in order, a block at a time so the sequences can be
+    // fetched in parallel
+    const size_t block_size = 1 << 16;
+    vector<string> sequences;
+    for (size_t block_start = 0; block_start < order.size(); block_start += block_size) {
+        size_t block_end = std::min(order.size(), block_start + block_size);
+        sequences.resize(block_end - block_start);
+#pragma omp parallel for
+        for (size_t i = block_start; i < block_end; ++i) {
+            sequences[i - block_start] = source.get_sequence(source.forward(order[i]));
+        }
+        for (size_t i = block_start; i < block_end; ++i) {
+            const string& sequence = sequences[i - block_start];
+            size_t piece_count = first_ids[i + 1] - first_ids[i];
+            handle_t previous;
+            for (size_t piece = 0; piece < piece_count; ++piece) {
+                size_t start = piece * max_node_length;
+                size_t length = (piece_count == 1) ? sequence.size() : std::min(max_node_length, sequence.size() - start);
+                handle_t created = into.create_handle(sequence.substr(start, length), first_ids[i] + piece);
+                if (piece != 0) {
+                    into.create_edge(previous, created);
+                }
+                previous = created;
+            }
+        }
+    }
+    sequences.clear();
+    sequences.shrink_to_fit();
+
+    // translate the edges in parallel, and then make them
+    {
+        vector<vector<pair<pair<nid_t, bool>, pair<nid_t, bool>>>> thread_edges(omp_get_max_threads());
+        source.for_each_edge([&](const edge_t& edge) {
+            thread_edges[omp_get_thread_num()].emplace_back(leaving(edge.first), entering(edge.second));
+            return true;
+        }, true);
+        for (auto& edges : thread_edges) {
+            for (auto& edge : edges) {
+                into.create_edge(into.get_handle(edge.first.first, edge.first.second),
+                                 into.get_handle(edge.second.first, edge.second.second));
+            }
+            edges.clear();
+            edges.shrink_to_fit();
+        }
+    }
+
+    // translate the paths a few at a time, in parallel, and then make them
+    vector<path_handle_t> paths;
+    source.for_each_path_matching(nullptr, nullptr, nullptr, [&](const path_handle_t& path) {
+        paths.push_back(path);
+        return true;
+    });
+    size_t path_batch_size = omp_get_max_threads();
+    vector<vector<pair<nid_t, bool>>> path_steps;
+    for (size_t batch_start = 0; batch_start < paths.size(); batch_start += path_batch_size) {
+        size_t batch_end = std::min(paths.size(), batch_start + path_batch_size);
+        path_steps.clear();
+        path_steps.resize(batch_end - batch_start);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = batch_start; i < batch_end; ++i) {
+            auto& steps = path_steps[i - batch_start];
+            source.for_each_step_in_path(paths[i], [&](const step_handle_t& step) {
+                handle_t handle = source.get_handle_of_step(step);
+                size_t rank = rank_of(handle);
+                if (source.get_is_reverse(handle)) {
+                    for (nid_t id = first_ids[rank + 1]; id > first_ids[rank]; --id) {
+                        steps.emplace_back(id - 1, true);
+                    }
+                } else {
+                    for (nid_t id = first_ids[rank]; id < first_ids[rank + 1]; ++id) {
+                        steps.emplace_back(id, false);
+                    }
+                }
+            });
+        }
+        for (size_t i = batch_start; i < batch_end; ++i) {
+            const path_handle_t& path = paths[i];
+            path_handle_t into_path = into.create_path(source.get_sense(path),
+                                                       source.get_sample_name(path),
+                                                       source.get_locus_name(path),
+                                                       source.get_haplotype(path),
+                                                       source.get_phase_block(path),
+                                                       source.get_subrange(path),
+                                                       source.get_is_circular(path));
+            for (auto& step : path_steps[i - batch_start]) {
+                into.append_step(into_path, into.get_handle(step.first, step.second));
+            }
+        }
+    }
+}
+
+}
+}
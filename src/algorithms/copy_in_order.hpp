@@ -0,0 +1,36 @@
+#ifndef VG_ALGORITHMS_COPY_IN_ORDER_HPP_INCLUDED
+#define VG_ALGORITHMS_COPY_IN_ORDER_HPP_INCLUDED
+
+/**
+ * \file copy_in_order.hpp
+ *
+ * Defines a bulk copy of a graph that renumbers and optionally chops its nodes.
+ */
+
+#include "../handle.hpp"
+
+
+namespace vg {
+namespace algorithms {
+
+using namespace std;
+
+/**
+ * Copy the source graph, with its paths, into the empty graph into. The nodes
+ * are laid out in the given order, which must contain every node exactly once,
+ * and get the IDs 1, 2, 3, ... in that order. If max_node_length is not 0,
+ * each node is also cut into pieces of at most that many bases, which get
+ * consecutive IDs along its forward strand, and path steps through the node
+ * become steps through its pieces.
+ *
+ * The new layout, edges, and path steps are all worked out in parallel, and
+ * the graph is then built in one pass, instead of changing nodes and path
+ * steps one at a time in place. Needs memory for both graphs at once.
+ */
+void copy_in_order(const PathHandleGraph& source, MutablePathMutableHandleGraph& into,
+                   const vector<handle_t>& order, size_t max_node_length = 0);
+
+}
+}
+
+#endif
@@ -3,6 +3,9 @@
 #include "algorithms/subgraph.hpp"
 #include <vg/io/stream.hpp>
 #include "../path.hpp"
+#include "../stream_index.hpp"
+
+#include <list>
 
 namespace vg {
 namespace algorithms {
@@ -34,45 +37,49 @@ void packed_depths(const Packer& packer, const string& path_name, size_t min_cov
     }
 }
 
-pair<double, double> packed_depth_of_bin(const Packer& packer,
-                                         step_handle_t start_step, step_handle_t end_plus_one_step,
-                                         size_t min_coverage, bool include_deletions) {
-
+// coverage of each node via deletion (that's contained in the bin)
+static unordered_map<nid_t, size_t> deletion_coverages_of_bin(const Packer& packer,
+                                                              step_handle_t start_step, step_handle_t end_plus_one_step) {
     const PathHandleGraph& graph = dynamic_cast<const PathHandleGraph&>(*packer.get_graph());
+    const VectorizableHandleGraph* vec_graph = dynamic_cast<const VectorizableHandleGraph*>(packer.get_graph());
 
-    // coverage of each node via deletion (that's contained in the bin)
     unordered_map<nid_t, size_t> deletion_coverages;
-    if (include_deletions) {
-        const VectorizableHandleGraph* vec_graph = dynamic_cast<const VectorizableHandleGraph*>(packer.get_graph());
-        unordered_map<handle_t, step_handle_t> deletion_candidates;
-        handle_t prev_handle;
-        for (step_handle_t cur_step = start_step; cur_step != end_plus_one_step; cur_step = graph.get_next_step(cur_step)) {
-            handle_t cur_handle = graph.get_handle_of_step(cur_step);
-            graph.follow_edges(cur_handle, true, [&] (handle_t other) {
-                    if (!deletion_candidates.empty() && other!= prev_handle && deletion_candidates.count(other)) {
-                        edge_t edge = graph.edge_handle(other, cur_handle);
-                        size_t edge_pos = vec_graph->edge_index(edge);
-                        size_t deletion_coverage = packer.edge_coverage(edge_pos);
-                        // quadratic alert.  if this is too slow, can use interval tree or something
-                        for (step_handle_t del_step = graph.get_next_step(deletion_candidates[other]);
-                             del_step != cur_step;
-                             del_step = graph.get_next_step(del_step)) {
-                            handle_t del_handle = graph.get_handle_of_step(del_step);
-                            nid_t del_id = graph.get_id(del_handle);
-                            if (!deletion_coverages.count(del_id)) {
-                                deletion_coverages[del_id] = deletion_coverage;
-                            } else {
-                                deletion_coverages[del_id] += deletion_coverage;
-                            }
+    unordered_map<handle_t, step_handle_t> deletion_candidates;
+    handle_t prev_handle;
+    for (step_handle_t cur_step = start_step; cur_step != end_plus_one_step; cur_step = graph.get_next_step(cur_step)) {
+        handle_t cur_handle = graph.get_handle_of_step(cur_step);
+        graph.follow_edges(cur_handle, true, [&] (handle_t other) {
+                if (!deletion_candidates.empty() && other!= prev_handle && deletion_candidates.count(other)) {
+                    edge_t edge = graph.edge_handle(other, cur_handle);
+                    size_t edge_pos = vec_graph->edge_index(edge);
+                    size_t deletion_coverage = packer.edge_coverage(edge_pos);
+                    // quadratic alert.  if this is too slow, can use interval tree or something
+                    for (step_handle_t del_step = graph.get_next_step(deletion_candidates[other]);
+                         del_step != cur_step;
+                         del_step = graph.get_next_step(del_step)) {
+                        handle_t del_handle = graph.get_handle_of_step(del_step);
+                        nid_t del_id = graph.get_id(del_handle);
+                        if (!deletion_coverages.count(del_id)) {
+                            deletion_coverages[del_id] = deletion_coverage;
+                        } else {
+                            deletion_coverages[del_id] += deletion_coverage;
                         }
                     }
-                });
-            prev_handle = cur_handle;
-            deletion_candidates[cur_handle] = cur_step;
-        }
+                }
+            });
+        prev_handle = cur_handle;
+        deletion_candidates[cur_handle] = cur_step;
     }
+    return deletion_coverages;
+}
+
+// compute the mean and variance of our base coverage across the bin, given the deletion coverages
+static pair<double, double> packed_depth_of_bin(const Packer& packer,
+                                                step_handle_t start_step, step_handle_t end_plus_one_step,
+                                                size_t min_coverage, unordered_map<nid_t, size_t>& deletion_coverages) {
+
+    const PathHandleGraph& graph = dynamic_cast<const PathHandleGraph&>(*packer.get_graph());
 
-    // compute the mean and variance of our base coverage across the bin
     size_t bin_length = 0;
     double mean = 0.0;
     double M2 = 0.0;
@@ -81,7 +88,7 @@ pair<double, double> packed_depth_of_bin(const Packer& packer,
         handle_t cur_handle = graph.get_handle_of_step(cur_step);
         nid_t cur_id = graph.get_id(cur_handle);
         size_t cur_len = graph.get_length(cur_handle);
-        size_t del_coverage = !include_deletions or !deletion_coverages.count(cur_id) ? 0 : deletion_coverages[cur_id];
+        size_t del_coverage = !deletion_coverages.count(cur_id) ? 0 : deletion_coverages[cur_id];
         Position cur_pos;
         cur_pos.set_node_id(cur_id);
         cur_pos.set_is_reverse(graph.get_is_reverse(cur_handle));
@@ -96,38 +103,177 @@ pair<double, double> packed_depth_of_bin(const Packer& packer,
     return wellford_mean_var(bin_length, mean, M2);
 }
 
+pair<double, double> packed_depth_of_bin(const Packer& packer,
+                                         step_handle_t start_step, step_handle_t end_plus_one_step,
+                                         size_t min_coverage, bool include_deletions) {
+
+    unordered_map<nid_t, size_t> deletion_coverages;
+    if (include_deletions) {
+        deletion_coverages = deletion_coverages_of_bin(packer, start_step, end_plus_one_step);
+    }
+    return packed_depth_of_bin(packer, start_step, end_plus_one_step, min_coverage, deletion_coverages);
+}
+
+PackedPathCoverage::PackedPathCoverage(const Packer& packer, const string& path_name, size_t min_coverage) :
+    packer(packer), min_coverage(min_coverage) {
+
+    const PathHandleGraph& graph = dynamic_cast<const PathHandleGraph&>(*packer.get_graph());
+    path = graph.get_path_handle(path_name);
+
+    // one scan of our path to collect the steps
+    steps.reserve(graph.get_step_count(path));
+    offsets.reserve(graph.get_step_count(path) + 1);
+    size_t offset = 0;
+    step_handle_t end_step = graph.path_end(path);
+    for (step_handle_t cur_step = graph.path_begin(path); cur_step != end_step; cur_step = graph.get_next_step(cur_step)) {
+        steps.push_back(cur_step);
+        offsets.push_back(offset);
+        offset += graph.get_length(graph.get_handle_of_step(cur_step));
+    }
+    offsets.push_back(offset);
+
+    // parallel scan to sum up the coverage of each step
+    prefix_sums.resize(steps.size() + 1);
+#pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t i = 0; i < steps.size(); ++i) {
+        add_bases(i, 0, offsets[i + 1] - offsets[i], prefix_sums[i + 1]);
+    }
+
+    // and make them prefix sums
+    for (size_t i = 1; i < prefix_sums.size(); ++i) {
+        prefix_sums[i].count += prefix_sums[i - 1].count;
+        prefix_sums[i].sum += prefix_sums[i - 1].sum;
+        prefix_sums[i].sum_of_squares += prefix_sums[i - 1].sum_of_squares;
+    }
+}
+
+size_t PackedPathCoverage::step_count() const {
+    return steps.size();
+}
+
+size_t PackedPathCoverage::step_offset(size_t i) const {
+    return offsets[i];
+}
+
+step_handle_t PackedPathCoverage::get_step(size_t i) const {
+    return steps[i];
+}
+
+const Packer& PackedPathCoverage::get_packer() const {
+    return packer;
+}
+
+path_handle_t PackedPathCoverage::get_path() const {
+    return path;
+}
+
+size_t PackedPathCoverage::get_min_coverage() const {
+    return min_coverage;
+}
+
+void PackedPathCoverage::add_bases(size_t i, size_t from, size_t to, CoverageSums& sums) const {
+    const PathHandleGraph& graph = dynamic_cast<const PathHandleGraph&>(*packer.get_graph());
+    handle_t handle = graph.get_handle_of_step(steps[i]);
+    Position pos;
+    pos.set_node_id(graph.get_id(handle));
+    pos.set_is_reverse(graph.get_is_reverse(handle));
+    for (size_t j = from; j < to; ++j) {
+        pos.set_offset(j);
+        uint64_t pos_coverage = packer.coverage_at_position(packer.position_in_basis(pos));
+        if (pos_coverage >= min_coverage) {
+            ++sums.count;
+            sums.sum += pos_coverage;
+            sums.sum_of_squares += pos_coverage * pos_coverage;
+        }
+    }
+}
+
+pair<double, double> PackedPathCoverage::mean_var(const CoverageSums& sums) {
+    if (sums.count == 0) {
+        return make_pair(nan(""), nan(""));
+    }
+    double mean = (double)sums.sum / (double)sums.count;
+    double var = std::max(0.0, (double)sums.sum_of_squares / (double)sums.count - mean * mean);
+    return make_pair(mean, var);
+}
+
+pair<double, double> PackedPathCoverage::depth_of_steps(size_t first, size_t past_last) const {
+    CoverageSums sums;
+    sums.count = prefix_sums[past_last].count - prefix_sums[first].count;
+    sums.sum = prefix_sums[past_last].sum - prefix_sums[first].sum;
+    sums.sum_of_squares = prefix_sums[past_last].sum_of_squares - prefix_sums[first].sum_of_squares;
+    return mean_var(sums);
+}
+
+pair<double, double> PackedPathCoverage::depth_of_interval(size_t start, size_t end) const {
+    end = std::min(end, offsets.back());
+    if (start >= end) {
+        return mean_var(CoverageSums());
+    }
+    // the steps containing the first and last bases
+    size_t first = std::upper_bound(offsets.begin(), offsets.end(), start) - offsets.begin() - 1;
+    size_t last = std::upper_bound(offsets.begin(), offsets.end(), end - 1) - offsets.begin() - 1;
+    if (first == last) {
+        CoverageSums sums;
+        add_bases(first, start - offsets[first], end - offsets[first], sums);
+        return mean_var(sums);
+    }
+    // whole steps in between from the prefix sums, and the ends base by base
+    CoverageSums sums;
+    sums.count = prefix_sums[last].count - prefix_sums[first + 1].count;
+    sums.sum = prefix_sums[last].sum - prefix_sums[first + 1].sum;
+    sums.sum_of_squares = prefix_sums[last].sum_of_squares - prefix_sums[first + 1].sum_of_squares;
+    add_bases(first, start - offsets[first], offsets[first + 1] - offsets[first], sums);
+    add_bases(last, 0, end - offsets[last], sums);
+    return mean_var(sums);
+}
+
 vector<tuple<size_t, size_t, double, double>> binned_packed_depth(const Packer& packer, const string& path_name, size_t bin_size,
                                                                   size_t min_coverage, bool include_deletions) {
+    PackedPathCoverage coverage(packer, path_name, min_coverage);
+    return binned_packed_depth(coverage, bin_size, include_deletions);
+}
 
+vector<tuple<size_t, size_t, double, double>> binned_packed_depth(const PackedPathCoverage& coverage, size_t bin_size,
+                                                                  bool include_deletions) {
+
+    const Packer& packer = coverage.get_packer();
     const PathHandleGraph& graph = dynamic_cast<const PathHandleGraph&>(*packer.get_graph());
-    path_handle_t path_handle = graph.get_path_handle(path_name);
     
-    // one scan of our path to collect the bins
-    step_handle_t start_step = graph.path_begin(path_handle);
-    step_handle_t end_step = graph.path_end(path_handle);
-    vector<pair<size_t, step_handle_t>> bins; // start offset / start step of each bin
-    size_t offset = 0;
+    // collect the bins, as the index of the first step of each bin
+    vector<size_t> bins;
     size_t cur_bin_size = bin_size;
-    for (step_handle_t cur_step = start_step; cur_step != end_step; cur_step = graph.get_next_step(cur_step)) {
+    for (size_t i = 0; i < coverage.step_count(); ++i) {
         if (cur_bin_size >= bin_size) {
-            bins.push_back(make_pair(offset, cur_step));
+            bins.push_back(i);
             cur_bin_size = 0;
         }
-        size_t node_len = graph.get_length(graph.get_handle_of_step(cur_step));
-        offset += node_len;
-        cur_bin_size += node_len;
+        cur_bin_size += coverage.step_offset(i + 1) - coverage.step_offset(i);
     }
+    step_handle_t end_step = graph.path_end(coverage.get_path());
 
     // parallel scan to compute the coverages
     vector<tuple<size_t, size_t, double, double>> binned_depths(bins.size());
-#pragma omp parallel for
+#pragma omp parallel for schedule(dynamic, 64)
     for (size_t i = 0; i < bins.size(); ++i) {
-        step_handle_t bin_start_step = bins[i].second;
-        step_handle_t bin_end_step = i < bins.size() - 1 ? bins[i+1].second : end_step;
-        size_t bin_start = bins[i].first;
-        size_t bin_end = i < bins.size() - 1 ? bins[i+1].first : offset;
-        pair<double, double> coverage = packed_depth_of_bin(packer, bin_start_step, bin_end_step, min_coverage, include_deletions);
-        binned_depths[i] = make_tuple(bin_start, bin_end, coverage.first, coverage.second);
+        size_t bin_past_last = i < bins.size() - 1 ? bins[i+1] : coverage.step_count();
+        size_t bin_start = coverage.step_offset(bins[i]);
+        size_t bin_end = coverage.step_offset(bin_past_last);
+        pair<double, double> depth;
+        unordered_map<nid_t, size_t> deletion_coverages;
+        step_handle_t bin_start_step = coverage.get_step(bins[i]);
+        step_handle_t bin_end_step = i < bins.size() - 1 ? coverage.get_step(bin_past_last) : end_step;
+        if (include_deletions) {
+            deletion_coverages = deletion_coverages_of_bin(packer, bin_start_step, bin_end_step);
+        }
+        if (deletion_coverages.empty()) {
+            // the summed coverage is all we need
+            depth = coverage.depth_of_steps(bins[i], bin_past_last);
+        } else {
+            // the deletions change which bases are counted, so we have to look at each one
+            depth = packed_depth_of_bin(packer, bin_start_step, bin_end_step, coverage.get_min_coverage(), deletion_coverages);
+        }
+        binned_depths[i] = make_tuple(bin_start, bin_end, depth.first, depth.second);
     }
 
     return binned_depths;
@@ -141,24 +287,23 @@ BinnedDepthIndex binned_packed_depth_index(const Packer& packer,
                                            size_t min_coverage,
                                            bool include_deletions,
                                            bool std_err) {
-    const PathHandleGraph& graph = dynamic_cast<const PathHandleGraph&>(*packer.get_graph());
     
-    BinnedDepthIndex depth_index;
-    for (const string& path_name : path_names) {
-        size_t path_max_bin = 0;
-        graph.for_each_step_in_path(graph.get_path_handle(path_name), [&] (step_handle_t step_handle) {
-                path_max_bin += graph.get_length(graph.get_handle_of_step(step_handle));
-                return path_max_bin < max_bin_size;
-            });
-        path_max_bin = std::min(max_bin_size, path_max_bin);
-
-        map<size_t, map<size_t, pair<float, float>>>& scaled_depth_map = depth_index[path_name];
+    // with enough paths to go around, give each thread its own paths.
+    // otherwise, use all the threads on each path in turn.
+    vector<map<size_t, map<size_t, pair<float, float>>>> scaled_depth_maps(path_names.size());
+#pragma omp parallel for schedule(dynamic, 1) if (path_names.size() >= (size_t)get_thread_count())
+    for (size_t i = 0; i < path_names.size(); ++i) {
+        // sum up the coverage once, and reuse it for every bin size
+        PackedPathCoverage coverage(packer, path_names[i], min_coverage);
+        size_t path_max_bin = std::min(max_bin_size, coverage.step_offset(coverage.step_count()));
+
+        map<size_t, map<size_t, pair<float, float>>>& scaled_depth_map = scaled_depth_maps[i];
         size_t prev_bin_size = 0;
         for (size_t bin_size = min_bin_size; bin_size != prev_bin_size;) {
 
             map<size_t, pair<float, float>>& depth_map = scaled_depth_map[bin_size];
-            vector<tuple<size_t, size_t, double, double>> binned_depths = binned_packed_depth(packer, path_name, bin_size,
-                                                                                              min_coverage, include_deletions);
+            vector<tuple<size_t, size_t, double, double>> binned_depths = binned_packed_depth(coverage, bin_size,
+                                                                                              include_deletions);
             // todo: probably more efficent to just leave in sorted vector
             for (auto& binned_depth : binned_depths) {
                 double var = get<3>(binned_depth);
@@ -174,6 +319,11 @@ BinnedDepthIndex binned_packed_depth_index(const Packer& packer,
             bin_size = std::min(path_max_bin, (size_t)pow(bin_size, exp_growth_factor));
         }
     }
+
+    BinnedDepthIndex depth_index;
+    for (size_t i = 0; i < path_names.size(); ++i) {
+        depth_index[path_names[i]] = std::move(scaled_depth_maps[i]);
+    }
     return depth_index;
 }
 
@@ -207,6 +357,79 @@ pair<float, float> get_depth_from_index(const BinnedDepthIndex& depth_index, con
     return total;
 }
 
+// header of a saved BinnedDepthIndex
+static const string BINNED_DEPTH_INDEX_MAGIC = "VGBDI1";
+
+template<typename T>
+static void write_binary(ostream& out, const T& value) {
+    out.write((const char*)&value, sizeof(T));
+}
+
+template<typename T>
+static void read_binary(istream& in, T& value) {
+    if (!in.read((char*)&value, sizeof(T))) {
+        throw runtime_error("truncated binned depth index");
+    }
+}
+
+void save_binned_depth_index(const BinnedDepthIndex& depth_index, ostream& out) {
+    out.write(BINNED_DEPTH_INDEX_MAGIC.c_str(), BINNED_DEPTH_INDEX_MAGIC.size());
+    write_binary<uint64_t>(out, depth_index.size());
+    for (const auto& path_maps : depth_index) {
+        write_binary<uint64_t>(out, path_maps.first.size());
+        out.write(path_maps.first.c_str(), path_maps.first.size());
+        write_binary<uint64_t>(out, path_maps.second.size());
+        for (const auto& scaled_map : path_maps.second) {
+            write_binary<uint64_t>(out, scaled_map.first);
+            write_binary<uint64_t>(out, scaled_map.second.size());
+            for (const auto& bin_depth : scaled_map.second) {
+                write_binary<uint64_t>(out, bin_depth.first);
+                write_binary<float>(out, bin_depth.second.first);
+                write_binary<float>(out, bin_depth.second.second);
+            }
+        }
+    }
+    if (!out) {
+        throw runtime_error("could not write binned depth index");
+    }
+}
+
+BinnedDepthIndex load_binned_depth_index(istream& in) {
+    string magic(BINNED_DEPTH_INDEX_MAGIC.size(), '\0');
+    if (!in.read(&magic[0], magic.size()) || magic != BINNED_DEPTH_INDEX_MAGIC) {
+        throw runtime_error("not a binned depth index");
+    }
+    BinnedDepthIndex depth_index;
+    uint64_t path_count;
+    read_binary(in, path_count);
+    for (uint64_t i = 0; i < path_count; ++i) {
+        uint64_t name_length;
+        read_binary(in, name_length);
+        string path_name(name_length, '\0');
+        if (name_length > 0 && !in.read(&path_name[0], name_length)) {
+            throw runtime_error("truncated binned depth index");
+        }
+        auto& scaled_depth_map = depth_index[path_name];
+        uint64_t scale_count;
+        read_binary(in, scale_count);
+        for (uint64_t j = 0; j < scale_count; ++j) {
+            uint64_t bin_size, bin_count;
+            read_binary(in, bin_size);
+            read_binary(in, bin_count);
+            auto& depth_map = scaled_depth_map[bin_size];
+            for (uint64_t k = 0; k < bin_count; ++k) {
+                uint64_t bin_start;
+                pair<float, float> depth;
+                read_binary(in, bin_start);
+                read_binary(in, depth.first);
+                read_binary(in, depth.second);
+                depth_map.emplace_hint(depth_map.end(), bin_start, depth);
+            }
+        }
+    }
+    return depth_index;
+}
+
 // draw (roughly) max_nodes nodes from the graph using the random seed
 static unordered_map<nid_t, size_t> sample_nodes(const HandleGraph& graph, size_t max_nodes, size_t random_seed) {
     default_random_engine generator(random_seed);
@@ -282,6 +505,79 @@ pair<double, double> sample_mapping_depth(const HandleGraph& graph, const string
 
 
 
+pair<double, double> sample_indexed_mapping_depth(const HandleGraph& graph, const string& gam_filename, size_t max_nodes, size_t random_seed,
+                                                  size_t min_coverage, size_t min_mapq, double target_precision) {
+    GAMIndex gam_index;
+    ifstream index_stream(gam_filename + ".gai");
+    if (!index_stream) {
+        throw runtime_error("vg::algorithms::coverage_depth: Unable to open GAM index " + gam_filename + ".gai");
+    }
+    gam_index.load(index_stream);
+
+    // give every thread its own cursor to look things up with
+    list<ifstream> gam_streams;
+    vector<GAMIndex::cursor_t> cursors;
+    for (int i = 0; i < get_thread_count(); ++i) {
+        gam_streams.emplace_back(gam_filename);
+        if (!gam_streams.back()) {
+            throw runtime_error("vg::algorithms::coverage_depth: Unable to open GAM " + gam_filename);
+        }
+        cursors.emplace_back(gam_streams.back());
+    }
+
+    // visit the same nodes as sample_mapping_depth(), but in random order
+    vector<nid_t> nodes;
+    for (const auto& node_cov : sample_nodes(graph, max_nodes, random_seed)) {
+        nodes.push_back(node_cov.first);
+    }
+    sort(nodes.begin(), nodes.end());
+    shuffle(nodes.begin(), nodes.end(), default_random_engine(random_seed));
+
+    // don't trust the confidence interval until we've seen this many nodes
+    const size_t min_sampled_nodes = 30;
+    // look up this many nodes at a time, so that nearby nodes share reads from the file
+    const size_t batch_size = 256 * cursors.size();
+
+    size_t count = 0;
+    double mean = 0.;
+    double M2 = 0.;
+    for (size_t batch_start = 0; batch_start < nodes.size(); batch_start += batch_size) {
+        size_t batch_end = std::min(nodes.size(), batch_start + batch_size);
+        vector<vector<pair<id_t, id_t>>> queries;
+        queries.reserve(batch_end - batch_start);
+        for (size_t i = batch_start; i < batch_end; ++i) {
+            queries.push_back({{nodes[i], nodes[i]}});
+        }
+        // bases covered on each node in the batch
+        vector<size_t> node_coverage(queries.size(), 0);
+        gam_index.find_batch(cursors, queries, [&](size_t query, const Alignment& aln) {
+                if (aln.mapping_quality() >= min_mapq) {
+                    const Path& path = aln.path();
+                    for (int i = 0; i < path.mapping_size(); ++i) {
+                        if (path.mapping(i).position().node_id() == nodes[batch_start + query]) {
+                            node_coverage[query] += mapping_from_length(path.mapping(i));
+                        }
+                    }
+                }
+            });
+        // add them up in our random order, so we stop in the same place no matter the thread count
+        for (size_t i = 0; i < node_coverage.size(); ++i) {
+            if (node_coverage[i] >= min_coverage) {
+                double node_len = graph.get_length(graph.get_handle(nodes[batch_start + i]));
+                wellford_update(count, mean, M2, (double)node_coverage[i] / node_len);
+            }
+        }
+        if (count >= min_sampled_nodes) {
+            double std_err = sqrt(wellford_mean_var(count, mean, M2, true).second / (double)count);
+            if (1.96 * std_err <= target_precision * mean) {
+                break;
+            }
+        }
+    }
+
+    return wellford_mean_var(count, mean, M2);
+}
+
 pair<double, double> sample_gam_depth(const HandleGraph& graph, const vector<Alignment>& alignments, size_t max_nodes, size_t random_seed, size_t min_coverage, size_t min_mapq) {
     // one node counter per thread
     vector<unordered_map<nid_t, size_t>> node_coverages(get_thread_count(), sample_nodes(graph, max_nodes, random_seed));
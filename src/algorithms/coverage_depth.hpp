@@ -32,11 +32,69 @@ void packed_depths(const Packer& packer, const string& path_name, size_t min_cov
 pair<double, double> packed_depth_of_bin(const Packer& packer, step_handle_t start_step, step_handle_t end_plus_one_step,
                                          size_t min_coverage, bool include_deletions);
 
+/// The packed coverage of a path, summed up by step, so that the depth of any
+/// run of steps can be read off in constant time, and that of any interval of
+/// bases in time proportional to the lengths of the nodes at its ends.
+/// Only bases with at least min_coverage coverage are counted, as in
+/// packed_depth_of_bin.  Building it scans the path once, in parallel.
+class PackedPathCoverage {
+public:
+    PackedPathCoverage(const Packer& packer, const string& path_name, size_t min_coverage);
+
+    /// The number of steps in the path
+    size_t step_count() const;
+
+    /// The path offset of the start of step i.  step_count() gives the path length.
+    size_t step_offset(size_t i) const;
+
+    /// Step i of the path
+    step_handle_t get_step(size_t i) const;
+
+    /// The mean and variance of the counted coverage over steps [first, past_last)
+    pair<double, double> depth_of_steps(size_t first, size_t past_last) const;
+
+    /// The mean and variance of the counted coverage over the 0-based path interval [start, end)
+    pair<double, double> depth_of_interval(size_t start, size_t end) const;
+
+    const Packer& get_packer() const;
+    path_handle_t get_path() const;
+    size_t get_min_coverage() const;
+
+private:
+    /// Totals over the counted bases of some steps.  Prefix totals are kept
+    /// modulo 2^64, so differences are exact as long as the totals for the
+    /// run of steps itself fit.
+    struct CoverageSums {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t sum_of_squares = 0;
+    };
+
+    /// Add the counted bases of the given range of offsets within step i to sums
+    void add_bases(size_t i, size_t from, size_t to, CoverageSums& sums) const;
+
+    /// Convert totals to a mean and variance, like wellford_mean_var
+    static pair<double, double> mean_var(const CoverageSums& sums);
+
+    const Packer& packer;
+    path_handle_t path;
+    size_t min_coverage;
+    vector<step_handle_t> steps;
+    /// Offset of each step, and the path length at the end
+    vector<size_t> offsets;
+    /// Totals over the steps before each step, and all steps at the end
+    vector<CoverageSums> prefix_sums;
+};
+
 /// Use all available threads to estimate the binned packed coverage of a path using above fucntion
 /// Each element is a bin's 0-based open-ended interval in the path, and its coverage mean,variance. 
 vector<tuple<size_t, size_t, double, double>> binned_packed_depth(const Packer& packer, const string& path_name, size_t bin_size,
                                                                   size_t min_coverage, bool include_deletions);
 
+/// As above, but reusing the summed coverage of the path, so only bins with deletions in them need to be scanned
+vector<tuple<size_t, size_t, double, double>> binned_packed_depth(const PackedPathCoverage& coverage, size_t bin_size,
+                                                                  bool include_deletions);
+
 /// Use the above function to retrieve the binned depths of a list of paths, and store them indexed by start
 /// coordinate.  If std_err is true, store <mean, stderr> instead of <mean, variance>
 /// For each path, a series of indexes is computed, for bin sizes from min_bin_size, min_bin_size^(exp_growth_factor), etc.
@@ -53,6 +111,12 @@ BinnedDepthIndex binned_packed_depth_index(const Packer& packer,
 /// Query index created above
 pair<float, float> get_depth_from_index(const BinnedDepthIndex& depth_index, const string& path_name, size_t start_offset, size_t end_offset);
 
+/// Write an index created above to a stream, so it doesn't need to be recomputed
+void save_binned_depth_index(const BinnedDepthIndex& depth_index, ostream& out);
+
+/// Read an index written by save_binned_depth_index.  Throws runtime_error if the stream doesn't contain one.
+BinnedDepthIndex load_binned_depth_index(istream& in);
+
 /// Return the mean and variance of coverage of randomly sampled nodes from a mappings file
 /// Nodes with less than min_coverage are ignored
 /// The input_filename can be - for stdin
@@ -64,6 +128,14 @@ pair<double, double> sample_mapping_depth(const HandleGraph& graph, const string
 /// As above, but read a vector instead of a stream
 pair<double, double> sample_mapping_depth(const HandleGraph& graph, const vector<Alignment>& alignments, size_t max_nodes, size_t random_seed, size_t min_coverage, size_t min_mapq);
 
+/// As above, but for a sorted GAM file indexed with vg gamsort -i, without reading the whole file.
+/// The sampled nodes are visited in random order, and their coverage is looked up in the index in
+/// batches, until the 95% confidence interval of the mean depth is within target_precision of it
+/// (as a fraction of the mean), or all the nodes have been used.
+/// The index is read from gam_filename + ".gai".  Throws runtime_error if either file can't be read.
+pair<double, double> sample_indexed_mapping_depth(const HandleGraph& graph, const string& gam_filename, size_t max_nodes, size_t random_seed,
+                                                  size_t min_coverage, size_t min_mapq, double target_precision);
+
 /// print path-name offset base-coverage for every base on a path (just like samtools depth)
 /// ignoring things below min_coverage.  offsets are 1-based in output stream
 /// coverage here is the number of steps from (unique) other paths
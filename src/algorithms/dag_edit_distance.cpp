@@ -0,0 +1,172 @@
+#include "dag_edit_distance.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace vg {
+namespace algorithms {
+
+using namespace std;
+
+/// Code for a base, or 4 for anything else
+static inline size_t base_code(char c) {
+    switch (c) {
+    case 'A': case 'a':
+        return 0;
+    case 'C': case 'c':
+        return 1;
+    case 'G': case 'g':
+        return 2;
+    case 'T': case 't':
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+/// A DP column in bit-parallel form: the vertical deltas of each query
+/// position, and the distance for the whole query
+struct Column {
+    vector<uint64_t> pv;
+    vector<uint64_t> mv;
+    int64_t score;
+};
+
+/// Advance one 64-row block of the column by a text character with match
+/// mask eq, given the horizontal delta coming in at the top of the block.
+/// Returns the horizontal delta leaving the row at the given high bit.
+static inline int advance_block(uint64_t& pv, uint64_t& mv, uint64_t eq, int h_in, uint64_t high_bit) {
+    uint64_t xv = eq | mv;
+    if (h_in < 0) {
+        eq |= 1;
+    }
+    uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+    uint64_t ph = mv | ~(xh | pv);
+    uint64_t mh = pv & xh;
+    int h_out = 0;
+    if (ph & high_bit) {
+        h_out = 1;
+    } else if (mh & high_bit) {
+        h_out = -1;
+    }
+    ph <<= 1;
+    mh <<= 1;
+    if (h_in < 0) {
+        mh |= 1;
+    } else if (h_in > 0) {
+        ph |= 1;
+    }
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+    return h_out;
+}
+
+vector<size_t> dag_edit_distance(const HandleGraph& graph, const vector<handle_t>& topological_order,
+                                 const string& query) {
+
+    size_t m = query.size();
+    vector<size_t> best(topological_order.size(), m);
+    if (m == 0 || topological_order.empty()) {
+        return best;
+    }
+    size_t words = (m + 63) / 64;
+    uint64_t last_high_bit = uint64_t(1) << ((m - 1) % 64);
+
+    // Match masks for each base, and an empty one for everything else
+    vector<vector<uint64_t>> peq(5, vector<uint64_t>(words, 0));
+    for (size_t i = 0; i < m; i++) {
+        size_t code = base_code(query[i]);
+        if (code < 4) {
+            peq[code][i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+
+    // The column before any text: the query can start anywhere in the text,
+    // but all of it has to be used.
+    Column initial;
+    initial.pv.assign(words, ~uint64_t(0));
+    initial.mv.assign(words, 0);
+    initial.score = m;
+
+    unordered_map<handle_t, size_t> rank;
+    rank.reserve(topological_order.size());
+    for (size_t i = 0; i < topological_order.size(); i++) {
+        rank[topological_order[i]] = i;
+    }
+
+    // The column at the end of each handle. We could drop these once all
+    // successors are done, but rescue subgraphs are small.
+    vector<Column> end_columns(topological_order.size());
+    // Scratch for merging columns as explicit distances
+    vector<int64_t> merged(m + 1), other(m + 1);
+
+    auto to_distances = [&](const Column& column, vector<int64_t>& distances) {
+        distances[0] = 0;
+        for (size_t i = 0; i < m; i++) {
+            uint64_t bit = uint64_t(1) << (i % 64);
+            distances[i + 1] = distances[i] + ((column.pv[i / 64] & bit) ? 1 : 0) - ((column.mv[i / 64] & bit) ? 1 : 0);
+        }
+    };
+
+    for (size_t i = 0; i < topological_order.size(); i++) {
+        const handle_t& handle = topological_order[i];
+
+        // Combine the columns from the predecessors in the subgraph
+        vector<const Column*> predecessors;
+        graph.follow_edges(handle, true, [&](const handle_t& prev) {
+            auto found = rank.find(prev);
+            if (found != rank.end() && found->second < i) {
+                predecessors.push_back(&end_columns[found->second]);
+            }
+        });
+
+        Column column;
+        if (predecessors.empty()) {
+            column = initial;
+        } else if (predecessors.size() == 1) {
+            column = *predecessors.front();
+        } else {
+            // The minimum of columns whose neighboring entries differ by at
+            // most 1 also has that property, so it can go back to deltas.
+            to_distances(*predecessors.front(), merged);
+            for (size_t j = 1; j < predecessors.size(); j++) {
+                to_distances(*predecessors[j], other);
+                for (size_t k = 0; k <= m; k++) {
+                    merged[k] = std::min(merged[k], other[k]);
+                }
+            }
+            column.pv.assign(words, 0);
+            column.mv.assign(words, 0);
+            for (size_t k = 0; k < m; k++) {
+                int64_t delta = merged[k + 1] - merged[k];
+                if (delta > 0) {
+                    column.pv[k / 64] |= uint64_t(1) << (k % 64);
+                } else if (delta < 0) {
+                    column.mv[k / 64] |= uint64_t(1) << (k % 64);
+                }
+            }
+            column.score = merged[m];
+        }
+
+        int64_t node_best = m;
+        string sequence = graph.get_sequence(handle);
+        for (char c : sequence) {
+            const vector<uint64_t>& eq = peq[base_code(c)];
+            // The top row is always 0, since the match can start anywhere.
+            int h = 0;
+            for (size_t w = 0; w < words; w++) {
+                h = advance_block(column.pv[w], column.mv[w], eq[w], h,
+                                  w + 1 == words ? last_high_bit : uint64_t(1) << 63);
+            }
+            column.score += h;
+            node_best = std::min(node_best, column.score);
+        }
+        best[i] = node_best;
+        end_columns[i] = std::move(column);
+    }
+
+    return best;
+}
+
+}
+}
@@ -0,0 +1,39 @@
+#ifndef VG_ALGORITHMS_DAG_EDIT_DISTANCE_HPP_INCLUDED
+#define VG_ALGORITHMS_DAG_EDIT_DISTANCE_HPP_INCLUDED
+
+/**
+ * \file dag_edit_distance.hpp
+ *
+ * Bit-parallel approximate matching of a query against all paths through a
+ * DAG, for cheaply finding where a read could align before doing a full
+ * alignment.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../handle.hpp"
+
+namespace vg {
+namespace algorithms {
+
+using namespace std;
+
+/// For each handle in a topological order of an acyclic subgraph (oriented
+/// handles whose edges between each other are all forward in the order),
+/// compute the smallest edit distance between the whole query and a
+/// substring of any path through the subgraph that ends in that handle.
+///
+/// Uses Myers' bit-parallel algorithm, in Hyyrö's multi-word form, along
+/// each handle's sequence. Where paths merge, the DP columns of the
+/// predecessors are combined by taking their minimum, so the result is exact
+/// over all paths. Edges to handles not in the order are ignored. Non-ACGT
+/// characters in either sequence match nothing.
+vector<size_t> dag_edit_distance(const HandleGraph& graph, const vector<handle_t>& topological_order,
+                                 const string& query);
+
+}
+}
+
+#endif
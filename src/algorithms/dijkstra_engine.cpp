@@ -0,0 +1,128 @@
+/**
+ * \file dijkstra_engine.cpp
+ *
+ * Implementation of the reusable Dijkstra search machinery.
+ */
+
+#include "dijkstra_engine.hpp"
+#include "../wang_hash.hpp"
+
+namespace vg {
+namespace algorithms {
+
+using namespace std;
+
+DijkstraEngine& DijkstraEngine::for_this_thread() {
+    thread_local DijkstraEngine engine;
+    engine.reset();
+    return engine;
+}
+
+void DijkstraEngine::reset() {
+    queue.clear();
+    record_count = 0;
+    ++generation;
+    if (generation == 0) {
+        // the stamps wrapped around, so old records could look current
+        for (auto& record : records) {
+            record.generation = 0;
+        }
+        generation = 1;
+    }
+}
+
+const DijkstraEngine::Record* DijkstraEngine::find(const handle_t& handle) const {
+    uint64_t key = as_integer(handle);
+    size_t mask = records.size() - 1;
+    for (size_t i = wang_hash_64(key) & mask; records[i].generation == generation; i = (i + 1) & mask) {
+        if (records[i].key == key) {
+            return &records[i];
+        }
+    }
+    return nullptr;
+}
+
+pair<DijkstraEngine::Record*, bool> DijkstraEngine::find_or_insert(const handle_t& handle) {
+    if (2 * (record_count + 1) > records.size()) {
+        grow();
+    }
+    uint64_t key = as_integer(handle);
+    size_t mask = records.size() - 1;
+    size_t i = wang_hash_64(key) & mask;
+    for (; records[i].generation == generation; i = (i + 1) & mask) {
+        if (records[i].key == key) {
+            return make_pair(&records[i], false);
+        }
+    }
+    Record& record = records[i];
+    record.key = key;
+    record.generation = generation;
+    record.finished = false;
+    ++record_count;
+    return make_pair(&record, true);
+}
+
+void DijkstraEngine::grow() {
+    vector<Record> old_records(records.size() * 2);
+    // swap in the bigger table and reinsert into it
+    swap(old_records, records);
+    size_t mask = records.size() - 1;
+    for (const Record& record : old_records) {
+        if (record.generation == generation) {
+            size_t i = wang_hash_64(record.key) & mask;
+            while (records[i].generation == generation) {
+                i = (i + 1) & mask;
+            }
+            records[i] = record;
+        }
+    }
+}
+
+void DijkstraEngine::push_or_reprioritize(const handle_t& handle, int64_t dist) {
+    auto found = find_or_insert(handle);
+    Record& record = *found.first;
+    if (!found.second && (record.finished || record.dist <= dist)) {
+        // it's done or already queued at least this close
+        return;
+    }
+    record.dist = dist;
+    queue.push(dist, handle);
+}
+
+bool DijkstraEngine::settle() {
+    while (!queue.empty()) {
+        const pair<int64_t, handle_t>& entry = queue.top();
+        const Record* record = find(entry.second);
+        if (!record->finished && record->dist == entry.first) {
+            return true;
+        }
+        // this entry was superseded
+        queue.pop();
+    }
+    return false;
+}
+
+bool DijkstraEngine::empty() {
+    return !settle();
+}
+
+pair<handle_t, int64_t> DijkstraEngine::top() {
+    settle();
+    const pair<int64_t, handle_t>& entry = queue.top();
+    return make_pair(entry.second, entry.first);
+}
+
+void DijkstraEngine::pop() {
+    settle();
+    const pair<int64_t, handle_t>& entry = queue.top();
+    const_cast<Record*>(find(entry.second))->finished = true;
+    queue.pop();
+}
+
+bool DijkstraEngine::is_finished(const handle_t& handle) const {
+    const Record* record = find(handle);
+    return record != nullptr && record->finished;
+}
+
+}
+}
@@ -0,0 +1,241 @@
+#ifndef VG_ALGORITHMS_DIJKSTRA_ENGINE_HPP_INCLUDED
+#define VG_ALGORITHMS_DIJKSTRA_ENGINE_HPP_INCLUDED
+
+/**
+ * \file dijkstra_engine.hpp
+ *
+ * Defines a reusable per-thread priority queue and visited set for
+ * Dijkstra-style searches over handles.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "../handle.hpp"
+
+namespace vg {
+namespace algorithms {
+
+using namespace std;
+
+/**
+ * A radix heap of items with int64_t keys. It is fastest when keys are
+ * monotone, i.e. never pushed below the last key popped, as they are in a
+ * Dijkstra search with nonnegative lengths: each item is then moved between
+ * buckets at most 64 times in total, and there is no comparison-based
+ * reordering. Keys below the last key popped are allowed, and go in a small
+ * binary heap that is checked first.
+ */
+template<typename T>
+class RadixHeap {
+public:
+    
+    /// Add an item
+    void push(int64_t key, const T& item);
+    
+    /// Returns true if there are no items
+    bool empty() const;
+    
+    /// Get an item with the smallest key. The heap must not be empty.
+    const pair<int64_t, T>& top();
+    
+    /// Remove the item returned by top(). The heap must not be empty.
+    void pop();
+    
+    /// Remove all items, keeping the allocated memory
+    void clear();
+    
+private:
+    
+    /// Map a key to an unsigned integer in the same order
+    static inline uint64_t order_key(int64_t key) {
+        return uint64_t(key) ^ (uint64_t(1) << 63);
+    }
+    
+    /// Get the bucket a key belongs in, relative to last
+    inline size_t bucket_of(int64_t key) const {
+        uint64_t diff = order_key(key) ^ order_key(last);
+        return diff == 0 ? 0 : 64 - __builtin_clzll(diff);
+    }
+    
+    /// Make sure bucket 0 has the smallest monotone keys, if there are any
+    void refill();
+    
+    /// Bucket i holds keys that first differ from last at bit i - 1
+    vector<pair<int64_t, T>> buckets[65];
+    
+    /// Items with keys below last, as a binary heap on the key
+    vector<pair<int64_t, T>> early;
+    
+    /// Lower bound on all the keys in the buckets
+    int64_t last = numeric_limits<int64_t>::min();
+    
+    /// Number of items in the buckets
+    size_t bucketed = 0;
+};
+
+/**
+ * Shared machinery for Dijkstra-style searches over the handles of a graph:
+ * a radix heap, and a record of the best distance to each handle seen in the
+ * current search. The record is an open-addressing table stamped with the
+ * search it belongs to, so starting a new search does not clear or free
+ * anything, and keeping one engine per thread leaves no allocation in the
+ * steady state.
+ *
+ * Each handle is popped at most once per search, at its smallest distance;
+ * pushing a handle that has already been popped does nothing, just like
+ * structures::RankPairingHeap::push_or_reprioritize().
+ */
+class DijkstraEngine {
+public:
+    
+    /// Get the engine for the calling thread, reset for a new search. The
+    /// engine must not be used for another search until this one is done.
+    static DijkstraEngine& for_this_thread();
+    
+    /// Forget everything about the current search
+    void reset();
+    
+    /// Queue a handle at the given distance, unless it has already been
+    /// popped or is queued at a distance no greater than this one
+    void push_or_reprioritize(const handle_t& handle, int64_t dist);
+    
+    /// Returns true if there are no more handles to pop
+    bool empty();
+    
+    /// Get the closest queued handle and its distance. Must not be empty.
+    pair<handle_t, int64_t> top();
+    
+    /// Remove the closest queued handle, marking it as finished. Must not be
+    /// empty.
+    void pop();
+    
+    /// Returns true if the handle has been popped in the current search
+    bool is_finished(const handle_t& handle) const;
+    
+private:
+    
+    /// One handle's state in the current search
+    struct Record {
+        /// The handle, as an integer
+        uint64_t key;
+        /// The search this record is for
+        uint32_t generation = 0;
+        /// Whether the handle has been popped
+        bool finished;
+        /// The best distance queued
+        int64_t dist;
+    };
+    
+    /// Find the record for the handle in the current search, or null
+    const Record* find(const handle_t& handle) const;
+    
+    /// Find or make the record for the handle in the current search. The
+    /// bool is true if it was made.
+    pair<Record*, bool> find_or_insert(const handle_t& handle);
+    
+    /// Drop queue entries that have been superseded or whose handles are
+    /// finished, so the top is live. Returns false if nothing is left.
+    bool settle();
+    
+    /// Double the record table
+    void grow();
+    
+    /// The queue, which can hold stale entries for reprioritized handles
+    RadixHeap<handle_t> queue;
+    
+    /// Open-addressing table of records; the size is a power of 2
+    vector<Record> records = vector<Record>(1024);
+    
+    /// Number of records in the current search
+    size_t record_count = 0;
+    
+    /// The current search
+    uint32_t generation = 1;
+};
+
+/*
+ * Template implementations
+ */
+
+template<typename T>
+void RadixHeap<T>::push(int64_t key, const T& item) {
+    if (key < last) {
+        early.emplace_back(key, item);
+        push_heap(early.begin(), early.end(), [](const pair<int64_t, T>& a, const pair<int64_t, T>& b) {
+            return a.first > b.first;
+        });
+    }
+    else {
+        buckets[bucket_of(key)].emplace_back(key, item);
+        ++bucketed;
+    }
+}
+
+template<typename T>
+bool RadixHeap<T>::empty() const {
+    return bucketed == 0 && early.empty();
+}
+
+template<typename T>
+void RadixHeap<T>::refill() {
+    if (!buckets[0].empty() || bucketed == 0) {
+        return;
+    }
+    // find the first nonempty bucket, and redistribute it around its minimum
+    size_t i = 1;
+    while (buckets[i].empty()) {
+        ++i;
+    }
+    auto& bucket = buckets[i];
+    last = min_element(bucket.begin(), bucket.end(), [](const pair<int64_t, T>& a, const pair<int64_t, T>& b) {
+        return a.first < b.first;
+    })->first;
+    for (auto& entry : bucket) {
+        buckets[bucket_of(entry.first)].push_back(entry);
+    }
+    bucket.clear();
+}
+
+template<typename T>
+const pair<int64_t, T>& RadixHeap<T>::top() {
+    refill();
+    if (!early.empty() && (bucketed == 0 || early.front().first < last)) {
+        return early.front();
+    }
+    return buckets[0].back();
+}
+
+template<typename T>
+void RadixHeap<T>::pop() {
+    refill();
+    if (!early.empty() && (bucketed == 0 || early.front().first < last)) {
+        pop_heap(early.begin(), early.end(), [](const pair<int64_t, T>& a, const pair<int64_t, T>& b) {
+            return a.first > b.first;
+        });
+        early.pop_back();
+    }
+    else {
+        buckets[0].pop_back();
+        --bucketed;
+    }
+}
+
+template<typename T>
+void RadixHeap<T>::clear() {
+    for (auto& bucket : buckets) {
+        bucket.clear();
+    }
+    early.clear();
+    last = numeric_limits<int64_t>::min();
+    bucketed = 0;
+}
+
+}
+}
+
+#endif
@@ -5,7 +5,7 @@
  */
  
 #include "extract_connecting_graph.hpp"
-#include <structures/updateable_priority_queue.hpp>
+#include "dijkstra_engine.hpp"
 
 //#define debug_vg_algorithms
 
@@ -28,16 +28,6 @@ unordered_map<id_t, id_t> extract_connecting_graph(const HandleGraph* source,
         exit(1);
     }
     
-    // a local struct that packages a handle with its distance from the first position
-    struct Traversal {
-        Traversal(handle_t handle, int64_t dist) : handle(handle), dist(dist) {}
-        int64_t dist; // distance from pos to the right side of this node
-        handle_t handle; // Oriented node traversal
-        inline bool operator<(const Traversal& other) const {
-            return dist > other.dist; // opposite order so priority queue selects minimum
-        }
-    };
-    
     // local enum to keep track of the cases where the positions are on the same node
     enum colocation_t {SeparateNodes, SharedNodeReachable, SharedNodeUnreachable, SharedNodeReverse};
     
@@ -98,10 +88,9 @@ unordered_map<id_t, id_t> extract_connecting_graph(const HandleGraph* source,
     // mark final position for skipping so that we won't look for additional traversals
     unordered_set<handle_t> skip_handles{source_handle_1, source_handle_2};
     
-    // initialize the queue
-    UpdateablePriorityQueue<Traversal, handle_t> queue([](const Traversal& item) {
-        return item.handle;
-    });
+    // initialize the queue, which holds oriented node traversals with the distance from
+    // pos to the right side of the node
+    DijkstraEngine& queue = DijkstraEngine::for_this_thread();
     
     // the distance to the ends of the starting nodes
     int64_t first_traversal_length = source->get_length(source_handle_1) - offset(pos_1);
@@ -132,22 +121,22 @@ unordered_map<id_t, id_t> extract_connecting_graph(const HandleGraph* source,
         
         // if we can reach the end of this node, init the queue with it
         if (first_traversal_length <= forward_max_len) {
-            queue.emplace(source_handle_1, first_traversal_length);
+            queue.push_or_reprioritize(source_handle_1, first_traversal_length);
         }
         
         // search along a Dijkstra tree
         while (!queue.empty()) {
             // get the next closest node to the starting position
-            Traversal trav = queue.top();
+            pair<handle_t, int64_t> trav = queue.top();
             queue.pop();
             
 #ifdef debug_vg_algorithms
-            cerr << "FORWARD SEARCH: traversing node " << source->get_id(trav.handle) << " in "
-                << (source->get_is_reverse(trav.handle) ? "reverse" : "forward")
-                << " orientation at distance " << trav.dist << endl;
+            cerr << "FORWARD SEARCH: traversing node " << source->get_id(trav.first) << " in "
+                << (source->get_is_reverse(trav.first) ? "reverse" : "forward")
+                << " orientation at distance " << trav.second << endl;
 #endif
             
-            source->follow_edges(trav.handle, false, [&](const handle_t& next) {
+            source->follow_edges(trav.first, false, [&](const handle_t& next) {
                 // get the orientation and id of the other side of the edge
                 
                 id_t next_id = source->get_id(next);
@@ -155,7 +144,7 @@ unordered_map<id_t, id_t> extract_connecting_graph(const HandleGraph* source,
                 
 #ifdef debug_vg_algorithms
                 cerr << "FORWARD SEARCH: got edge "
-                    << source->get_id(trav.handle) << " " << source->get_is_reverse(trav.handle)
+                    << source->get_id(trav.first) << " " << source->get_is_reverse(trav.first)
                     << " -> " << next_id << " " << next_rev << endl;
 #endif
                 found_target = found_target || (next_id == id(pos_2) && next_rev == is_rev(pos_2));
@@ -169,17 +158,17 @@ unordered_map<id_t, id_t> extract_connecting_graph(const HandleGraph* source,
                 }
                 
                 // distance to the end of this node
-                int64_t dist_thru = trav.dist + source->get_length(next);
+                int64_t dist_thru = trav.second + source->get_length(next);
                 if (!skip_handles.count(next) && dist_thru <= forward_max_len) {
                     // we can add more nodes along same path without going over the max length
                     // and we do not want to skip the target node
-                    queue.emplace(next, dist_thru);
+                    queue.push_or_reprioritize(next, dist_thru);
 #ifdef debug_vg_algorithms
                     cerr << "FORWARD SEARCH: distance " << dist_thru << " is under maximum, adding to queue" << endl;
 #endif
                 }
                 
-                observed_edges.insert(source->edge_handle(trav.handle, next));
+                observed_edges.insert(source->edge_handle(trav.first, next));
             });
         }
     }
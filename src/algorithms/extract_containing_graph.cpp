@@ -5,6 +5,7 @@
  */
  
 #include "extract_containing_graph.hpp"
+#include "dijkstra_engine.hpp"
 
 //#define debug_vg_algorithms
 
@@ -56,9 +57,9 @@ void extract_containing_graph(const HandleGraph* source,
     // system stdlib)
     spp::sparse_hash_set<edge_t> observed_edges;
     
-    // initialize the queue, opposite order so priority queue selects minimum
+    // initialize the queue, which selects the minimum distance
     // priority represent distance from starting pos to the left side of this node
-    RankPairingHeap<handle_t, int64_t, greater<int64_t>> queue;
+    DijkstraEngine& queue = DijkstraEngine::for_this_thread();
     
     for (size_t i = 0; i < positions.size(); i++) {
         
@@ -1,8 +1,18 @@
 #include "gfa_to_handle.hpp"
 #include "../path.hpp"
+#include "xg.hpp"
 
 #include <gbwtgraph/utils.h>
 
+#include <cstring>
+#include <exception>
+
+#include <omp.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace vg {
 namespace algorithms {
 
@@ -46,23 +56,35 @@ static void write_gfa_translation(const GFAIDMapInfo& id_map_info, const string&
     }
 }
 
+/// Throw if an edge's overlap isn't one we can load.
+static void check_blunt(const GFAParser::chars_t& overlap) {
+    static const string not_blunt = ("error:[gfa_to_handle_graph] Can only load blunt-ended GFAs. "
+        "Try \"bluntifying\" your graph with a tool like <https://github.com/vgteam/GetBlunted>, or "
+        "transitively merge overlaps with a pipeline of <https://github.com/ekg/gimbricate> and "
+        "<https://github.com/ekg/seqwish>.");
+    if (GFAParser::length(overlap) > 0) {
+        string overlap_text = GFAParser::extract(overlap);
+        if (overlap_text != "0M" && overlap_text != "*") {
+            // This isn't an allowed overlap value.
+            throw GFAFormatError(not_blunt + " Found edge with a non-null alignment '" + overlap_text + "'.");
+        }
+    }
+}
+
 /// Add listeners which let a GFA parser fill in a handle graph with nodes and edges.
 static void add_graph_listeners(GFAParser& parser, MutableHandleGraph* graph) {
+    parser.size_listeners.push_back([graph](size_t node_count, size_t edge_count, size_t step_count, nid_t min_id, nid_t max_id) {
+        if (min_id > 1 && graph->get_node_count() == 0) {
+            // Graphs that keep an ID-indexed table (like PackedGraph) can
+            // skip allocating the IDs below where the GFA starts.
+            graph->set_id_increment(min_id);
+        }
+    });
     parser.node_listeners.push_back([&parser, graph](nid_t id, const GFAParser::chars_t& sequence, const GFAParser::tag_list_t& tags) {
         graph->create_handle(GFAParser::extract(sequence), id);
     });
     parser.edge_listeners.push_back([&parser, graph](nid_t from, bool from_is_reverse, nid_t to, bool to_is_reverse, const GFAParser::chars_t& overlap, const GFAParser::tag_list_t& tags) {
-        static const string not_blunt = ("error:[gfa_to_handle_graph] Can only load blunt-ended GFAs. "
-            "Try \"bluntifying\" your graph with a tool like <https://github.com/vgteam/GetBlunted>, or "
-            "transitively merge overlaps with a pipeline of <https://github.com/ekg/gimbricate> and "
-            "<https://github.com/ekg/seqwish>.");
-        if (GFAParser::length(overlap) > 0) {
-            string overlap_text = GFAParser::extract(overlap);
-            if (overlap_text != "0M" && overlap_text != "*") {
-                // This isn't an allowed overlap value.
-                throw GFAFormatError(not_blunt + " Found edge with a non-null alignment '" + overlap_text + "'.");
-            }
-        }
+        check_blunt(overlap);
         
         graph->create_edge(graph->get_handle(from, from_is_reverse),
                            graph->get_handle(to, to_is_reverse));
@@ -70,6 +92,116 @@ static void add_graph_listeners(GFAParser& parser, MutableHandleGraph* graph) {
     });
 }
 
+/// Add a listener that collects the reference samples (RS) tag from the
+/// header, which makes P and W lines for those samples reference paths.
+static void add_reference_samples_listener(GFAParser& parser, std::shared_ptr<unordered_set<string>> reference_samples) {
+    parser.header_listeners.push_back([reference_samples](const GFAParser::tag_list_t& tags) {
+        for (const std::string& tag : tags) {
+            if (tag.size() >= 5 &&
+                std::equal(gbwtgraph::REFERENCE_SAMPLE_LIST_GFA_TAG.begin(), gbwtgraph::REFERENCE_SAMPLE_LIST_GFA_TAG.end(), tag.begin()) &&
+                tag[2] == ':' &&
+                tag[3] == 'Z' &&
+                tag[4] == ':') {
+             
+                // This is a reference samples tag like GBWTGraph's GFA parser knows how to parse.
+                // Parse the tag's value
+                *reference_samples = gbwtgraph::parse_reference_samples_tag(tag.substr(5));
+            }
+        }
+    });
+}
+
+/// Work out the path metadata for a P line with the given name.
+static void p_line_metadata(const string& name,
+                            const unordered_set<string>& reference_samples,
+                            PathSense& sense,
+                            string& sample,
+                            string& locus,
+                            size_t& haplotype,
+                            size_t& phase_block,
+                            subrange_t& subrange) {
+    
+    // Parse out the path name's metadata
+    PathMetadata::parse_path_name(name,
+                                  sense,
+                                  sample,
+                                  locus,
+                                  haplotype,
+                                  phase_block,
+                                  subrange);
+                                  
+    if (sense == PathSense::HAPLOTYPE && reference_samples.count(sample)) {
+        // This P line is about a sample that looks like a haplotype but
+        // actually wants to be a reference.
+        sense = PathSense::REFERENCE;
+    } else if (sense == PathSense::REFERENCE && haplotype != PathMetadata::NO_HAPLOTYPE && !reference_samples.count(sample)) {
+        // Mimic the GBWTGraph behavior of parsing full PanSN names
+        // (sample, haplotype number, contig) as haplotypes by default,
+        // even though we use PanSN names in vg to indicate reference
+        // sense.
+        // TODO: This is super ugly, can we just change the way the
+        // metadata name format works, or use a dedicated PanSN parser here
+        // instead?
+        // TODO: Can we use GBWTGraph's regex priority system?
+        sense = PathSense::HAPLOTYPE;
+        if (phase_block == PathMetadata::NO_PHASE_BLOCK) {
+            // Assign a phase block if none is specified, since haplotypes need one.
+            phase_block = 0;
+        }
+    }
+}
+
+/// Work out the path metadata for a W line.
+static void w_line_metadata(const string& sample_name,
+                            int64_t haplotype,
+                            const subrange_t& subrange,
+                            const unordered_set<string>& reference_samples,
+                            PathSense& sense,
+                            string& assigned_sample_name,
+                            size_t& assigned_haplotype,
+                            size_t& phase_block,
+                            subrange_t& assigned_subrange) {
+    
+    // By default this is interpreted as a haplotype
+    assigned_haplotype = (size_t) haplotype;
+    
+    if (sample_name == "*") {
+        // The sample name is elided from the walk.
+        // This walk must be a generic path.
+        sense = PathSense::GENERIC;
+        // We don't send a sample name.
+        assigned_sample_name = PathMetadata::NO_SAMPLE_NAME;
+        if (assigned_haplotype != 0) {
+            // We can't have multiple haplotypes for a generic path
+            throw GFAFormatError("Generic path on omitted (*) sample has nonzero haplotype");
+        }
+        assigned_haplotype = PathMetadata::NO_HAPLOTYPE;
+        phase_block = PathMetadata::NO_PHASE_BLOCK;
+    } else {
+        // This is probably a sample name we can use
+        
+        if (reference_samples.count(sample_name)) {
+            // This sample is supposed to be reference.
+            sense = PathSense::REFERENCE;
+            phase_block = PathMetadata::NO_PHASE_BLOCK;
+        } else {
+            // We're a haplotype
+            sense = PathSense::HAPLOTYPE;
+            // GFA doesn't really encode phase blocks. Always use the 0th one.
+            phase_block = 0;
+        }
+        
+        // Keep the sample name
+        assigned_sample_name = sample_name;
+    }
+    
+    // Drop the subrange completely if it starts at 0.
+    // TODO: Detect if there are going to be multiple walks describing
+    // different subranges, and keep the subrange on the first one even if
+    // it starts at 0, because then we know it's really a partial walk.
+    assigned_subrange = (subrange.first == 0) ? PathMetadata::NO_SUBRANGE : subrange;
+}
+
 /// Add listeners which let a GFA parser fill in a path handle graph with paths.
 static void add_path_listeners(GFAParser& parser, MutablePathMutableHandleGraph* graph,
                                unordered_set<PathSense>* ignore_sense) {
@@ -86,62 +218,20 @@ static void add_path_listeners(GFAParser& parser, MutablePathMutableHandleGraph*
     
     // We also need some shared state for making reference sample (RS) tags on the header apply to P and W lines later
     std::shared_ptr<unordered_set<string>> reference_samples = std::make_shared<unordered_set<string>>();
-    
-    parser.header_listeners.push_back([&parser, reference_samples](const GFAParser::tag_list_t& tags) {
-        for (const std::string& tag : tags) {
-            if (tag.size() >= 5 &&
-                std::equal(gbwtgraph::REFERENCE_SAMPLE_LIST_GFA_TAG.begin(), gbwtgraph::REFERENCE_SAMPLE_LIST_GFA_TAG.end(), tag.begin()) &&
-                tag[2] == ':' &&
-                tag[3] == 'Z' &&
-                tag[4] == ':') {
-             
-                // This is a reference samples tag like GBWTGraph's GFA parser knows how to parse.
-                // Parse the tag's value
-                *reference_samples = gbwtgraph::parse_reference_samples_tag(tag.substr(5));
-            }
-        }
-    });
+    add_reference_samples_listener(parser, reference_samples);
 
     parser.path_listeners.push_back([&parser, graph, reference_samples, ignore_sense](const string& name,
                                                                                       const GFAParser::chars_t& visits,
                                                                                       const GFAParser::chars_t& overlaps,
                                                                                       const GFAParser::tag_list_t& tags) {
         // For P lines, we add the path.
-        
-        // Parse out the path name's metadata
         PathSense sense;
         string sample;
         string locus;
         size_t haplotype;
         size_t phase_block;
         subrange_t subrange;
-        PathMetadata::parse_path_name(name,
-                                      sense,
-                                      sample,
-                                      locus,
-                                      haplotype,
-                                      phase_block,
-                                      subrange);
-                                      
-        if (sense == PathSense::HAPLOTYPE && reference_samples->count(sample)) {
-            // This P line is about a sample that looks like a haplotype but
-            // actually wants to be a reference.
-            sense = PathSense::REFERENCE;
-        } else if (sense == PathSense::REFERENCE && haplotype != PathMetadata::NO_HAPLOTYPE && !reference_samples->count(sample)) {
-            // Mimic the GBWTGraph behavior of parsing full PanSN names
-            // (sample, haplotype number, contig) as haplotypes by default,
-            // even though we use PanSN names in vg to indicate reference
-            // sense.
-            // TODO: This is super ugly, can we just change the way the
-            // metadata name format works, or use a dedicated PanSN parser here
-            // instead?
-            // TODO: Can we use GBWTGraph's regex priority system?
-            sense = PathSense::HAPLOTYPE;
-            if (phase_block == PathMetadata::NO_PHASE_BLOCK) {
-                // Assign a phase block if none is specified, since haplotypes need one.
-                phase_block = 0;
-            }
-        }
+        p_line_metadata(name, *reference_samples, sense, sample, locus, haplotype, phase_block, subrange);
         
         if (ignore_sense && ignore_sense->count(sense)) {
             return;
@@ -193,51 +283,13 @@ static void add_path_listeners(GFAParser& parser, MutablePathMutableHandleGraph*
                                                                         const GFAParser::chars_t& visits,
                                                                         const GFAParser::tag_list_t& tags) {
         // For W lines, we add the path with a bit more metadata.
-        
-        // By default this is interpreted as a haplotype
         PathSense sense;
-        
-        // We need to determine a phase block
-        size_t phase_block;
-        // And a haplotype.
-        size_t assigned_haplotype = (size_t) haplotype;
-        
         string assigned_sample_name;
-        if (sample_name == "*") {
-            // The sample name is elided from the walk.
-            // This walk must be a generic path.
-            sense = PathSense::GENERIC;
-            // We don't send a sample name.
-            assigned_sample_name = PathMetadata::NO_SAMPLE_NAME;
-            if (assigned_haplotype != 0) {
-                // We can't have multiple haplotypes for a generic path
-                throw GFAFormatError("Generic path on omitted (*) sample has nonzero haplotype");
-            }
-            assigned_haplotype = PathMetadata::NO_HAPLOTYPE;
-            phase_block = PathMetadata::NO_PHASE_BLOCK;
-        } else {
-            // This is probably a sample name we can use
-            
-            if (reference_samples->count(sample_name)) {
-                // This sample is supposed to be reference.
-                sense = PathSense::REFERENCE;
-                phase_block = PathMetadata::NO_PHASE_BLOCK;
-            } else {
-                // We're a haplotype
-                sense = PathSense::HAPLOTYPE;
-                // GFA doesn't really encode phase blocks. Always use the 0th one.
-                phase_block = 0;
-            }
-            
-            // Keep the sample name
-            assigned_sample_name = sample_name;
-        }
-        
-        // Drop the subrange completely if it starts at 0.
-        // TODO: Detect if there are going to be multiple walks describing
-        // different subranges, and keep the subrange on the first one even if
-        // it starts at 0, because then we know it's really a partial walk.
-        subrange_t assigned_subrange = (subrange.first == 0) ? PathMetadata::NO_SUBRANGE : subrange;
+        size_t assigned_haplotype;
+        size_t phase_block;
+        subrange_t assigned_subrange;
+        w_line_metadata(sample_name, haplotype, subrange, *reference_samples,
+                        sense, assigned_sample_name, assigned_haplotype, phase_block, assigned_subrange);
         
         // Compose what we think the path ought to be named.
         // TODO: When we get a has_path that takes fully specified metadata, use that instead.
@@ -324,12 +376,32 @@ static void add_path_listeners(GFAParser& parser, MutablePathMutableHandleGraph*
     });
 }
 
+/// Run a parser over the named file. Regular files are parsed in parallel if
+/// we have threads to spare; anything else, including "-" for stdin, is
+/// streamed.
+static void parse_gfa_file(GFAParser& parser, const string& filename) {
+    struct stat file_stats;
+    if (filename != "-" && omp_get_max_threads() > 1 &&
+        stat(filename.c_str(), &file_stats) == 0 && S_ISREG(file_stats.st_mode) && file_stats.st_size > 0) {
+        parser.parse_parallel(filename);
+    } else {
+        get_input_file(filename, [&](istream& in) {
+            parser.parse(in);
+        });
+    }
+}
+
 void gfa_to_handle_graph(const string& filename, MutableHandleGraph* graph,
                          GFAIDMapInfo* translation) {
                          
-    get_input_file(filename, [&](istream& in) {
-       gfa_to_handle_graph(in, graph, translation);
-    });
+    GFAParser parser;
+    if (translation) {
+        // Use the given external translation so the caller can keep it around.
+        parser.external_id_map = translation;
+    }
+    add_graph_listeners(parser, graph);
+    
+    parse_gfa_file(parser, filename);
 }
 
 void gfa_to_handle_graph(const string& filename, MutableHandleGraph* graph,
@@ -359,9 +431,18 @@ void gfa_to_path_handle_graph(const string& filename, MutablePathMutableHandleGr
                               GFAIDMapInfo* translation, int64_t max_rgfa_rank,
                               unordered_set<PathSense>* ignore_sense) {
     
-    get_input_file(filename, [&](istream& in) {
-        gfa_to_path_handle_graph(in, graph, translation, max_rgfa_rank);
-    });
+    GFAParser parser;
+    if (translation) {
+        // Use the given external translation so the caller can keep it around.
+        parser.external_id_map = translation;
+    }
+    add_graph_listeners(parser, graph);
+    
+    // Set up for path input
+    parser.max_rgfa_rank = max_rgfa_rank;
+    add_path_listeners(parser, graph, ignore_sense);
+    
+    parse_gfa_file(parser, filename);
 }
 
 void gfa_to_path_handle_graph(const string& filename, MutablePathMutableHandleGraph* graph,
@@ -369,7 +450,7 @@ void gfa_to_path_handle_graph(const string& filename, MutablePathMutableHandleGr
                               unordered_set<PathSense>* ignore_sense) {
 
     GFAIDMapInfo id_map_info;
-    gfa_to_path_handle_graph(filename, graph, &id_map_info, max_rgfa_rank);
+    gfa_to_path_handle_graph(filename, graph, &id_map_info, max_rgfa_rank, ignore_sense);
     write_gfa_translation(id_map_info, translation_filename);
 
 }
@@ -395,6 +476,205 @@ void gfa_to_path_handle_graph(istream& in,
     parser.parse(in);
 }
 
+/**
+ * The nodes, edges, and paths of a GFA, in flat arrays that can be enumerated
+ * as many times as XG construction needs, without building a mutable graph.
+ */
+struct FlatGFA {
+    /// Node IDs, in file order
+    vector<nid_t> node_ids;
+    /// All node sequences, concatenated
+    string sequences;
+    /// Where each node's sequence starts, with the total length at the end
+    vector<size_t> sequence_starts;
+    /// Edges as from ID, from orientation, to ID, to orientation
+    vector<tuple<nid_t, bool, nid_t, bool>> edges;
+    /// Names of the paths, with their metadata encoded
+    vector<string> path_names;
+    /// Steps of each path, as the node ID times 2 plus the orientation
+    vector<vector<uint64_t>> path_steps;
+    /// Index of each path name in path_names
+    unordered_map<string, size_t> path_index;
+    
+    /// Start a new path, or throw if it is a duplicate. Returns its steps.
+    vector<uint64_t>& add_path(const string& name) {
+        if (path_index.count(name)) {
+            throw GFADuplicatePathError(name);
+        }
+        path_index[name] = path_names.size();
+        path_names.push_back(name);
+        path_steps.emplace_back();
+        return path_steps.back();
+    }
+};
+
+/// Add listeners which let a GFA parser fill in a FlatGFA.
+static void add_flat_listeners(GFAParser& parser, FlatGFA& flat, unordered_set<PathSense>* ignore_sense) {
+    
+    parser.size_listeners.push_back([&flat](size_t node_count, size_t edge_count, size_t step_count, nid_t min_id, nid_t max_id) {
+        flat.node_ids.reserve(node_count);
+        flat.sequence_starts.reserve(node_count + 1);
+        flat.edges.reserve(edge_count);
+    });
+    parser.node_listeners.push_back([&flat](nid_t id, const GFAParser::chars_t& sequence, const GFAParser::tag_list_t& tags) {
+        flat.node_ids.push_back(id);
+        flat.sequence_starts.push_back(flat.sequences.size());
+        flat.sequences.append(sequence.first, sequence.second);
+    });
+    parser.edge_listeners.push_back([&flat](nid_t from, bool from_is_reverse, nid_t to, bool to_is_reverse, const GFAParser::chars_t& overlap, const GFAParser::tag_list_t& tags) {
+        check_blunt(overlap);
+        flat.edges.emplace_back(from, from_is_reverse, to, to_is_reverse);
+    });
+    
+    std::shared_ptr<unordered_set<string>> reference_samples = std::make_shared<unordered_set<string>>();
+    add_reference_samples_listener(parser, reference_samples);
+    
+    // Record the steps of a P or W line on a path
+    auto add_steps = [&parser](vector<uint64_t>& steps, const GFAParser::chars_t& visits, char line_type) {
+        GFAParser::scan_visits(visits, line_type, [&](int64_t step_rank,
+                                                      const GFAParser::chars_t& step_name,
+                                                      bool step_is_reverse) {
+            if (step_rank >= 0) {
+                // Not an empty path sentinel.
+                nid_t n = GFAParser::find_existing_sequence_id(GFAParser::extract(step_name), parser.id_map());
+                steps.push_back(2 * (uint64_t) n + step_is_reverse);
+            }
+            return true;
+        });
+    };
+    
+    parser.path_listeners.push_back([&flat, reference_samples, ignore_sense, add_steps](const string& name,
+                                                                                         const GFAParser::chars_t& visits,
+                                                                                         const GFAParser::chars_t& overlaps,
+                                                                                         const GFAParser::tag_list_t& tags) {
+        PathSense sense;
+        string sample;
+        string locus;
+        size_t haplotype;
+        size_t phase_block;
+        subrange_t subrange;
+        p_line_metadata(name, *reference_samples, sense, sample, locus, haplotype, phase_block, subrange);
+        if (ignore_sense && ignore_sense->count(sense)) {
+            return;
+        }
+        // XG construction relies on name-encoded path metadata
+        add_steps(flat.add_path(PathMetadata::create_path_name(sense, sample, locus, haplotype, phase_block, subrange)),
+                  visits, 'P');
+    });
+    
+    parser.walk_listeners.push_back([&flat, reference_samples, ignore_sense, add_steps](const string& sample_name,
+                                                                                         int64_t haplotype,
+                                                                                         const string& contig_name,
+                                                                                         const subrange_t& subrange,
+                                                                                         const GFAParser::chars_t& visits,
+                                                                                         const GFAParser::tag_list_t& tags) {
+        PathSense sense;
+        string assigned_sample_name;
+        size_t assigned_haplotype;
+        size_t phase_block;
+        subrange_t assigned_subrange;
+        w_line_metadata(sample_name, haplotype, subrange, *reference_samples,
+                        sense, assigned_sample_name, assigned_haplotype, phase_block, assigned_subrange);
+        if (ignore_sense && ignore_sense->count(sense)) {
+            return;
+        }
+        add_steps(flat.add_path(PathMetadata::create_path_name(sense, assigned_sample_name, contig_name,
+                                                               assigned_haplotype, phase_block, assigned_subrange)),
+                  visits, 'W');
+    });
+    
+    // For rGFA, remember the path we are extending under each name and the
+    // offset we expect it to continue at, like add_path_listeners() does.
+    using rgfa_cache_t = unordered_map<string, pair<size_t, int64_t>>;
+    std::shared_ptr<rgfa_cache_t> rgfa_cache = std::make_shared<rgfa_cache_t>();
+    
+    parser.rgfa_listeners.push_back([&flat, rgfa_cache](nid_t id,
+                                                        int64_t offset,
+                                                        size_t length,
+                                                        const string& path_name,
+                                                        int64_t path_rank) {
+        auto found = rgfa_cache->find(path_name);
+        if (found != rgfa_cache->end() && found->second.second != offset) {
+            // There's a gap, so we need a new subpath
+            rgfa_cache->erase(found);
+            found = rgfa_cache->end();
+        }
+        if (found == rgfa_cache->end()) {
+            subrange_t subrange = (offset == 0) ? PathMetadata::NO_SUBRANGE
+                                                : subrange_t(offset, PathMetadata::NO_END_POSITION);
+            flat.add_path(PathMetadata::create_path_name(PathSense::GENERIC,
+                                                         PathMetadata::NO_SAMPLE_NAME,
+                                                         path_name,
+                                                         PathMetadata::NO_HAPLOTYPE,
+                                                         PathMetadata::NO_PHASE_BLOCK,
+                                                         subrange));
+            found = rgfa_cache->emplace_hint(found, path_name, std::make_pair(flat.path_names.size() - 1, offset));
+        }
+        // rGFA paths always visit sequences forward.
+        flat.path_steps[found->second.first].push_back(2 * (uint64_t) id);
+        found->second.second += length;
+    });
+}
+
+void gfa_to_xg(const string& filename, xg::XG* graph,
+               GFAIDMapInfo* translation, int64_t max_rgfa_rank,
+               unordered_set<PathSense>* ignore_sense) {
+    
+    FlatGFA flat;
+    {
+        GFAParser parser;
+        if (translation) {
+            // Use the given external translation so the caller can keep it around.
+            parser.external_id_map = translation;
+        }
+        parser.max_rgfa_rank = max_rgfa_rank;
+        add_flat_listeners(parser, flat, ignore_sense);
+        
+        parse_gfa_file(parser, filename);
+    }
+    flat.sequence_starts.push_back(flat.sequences.size());
+    // We don't need to look up paths by name anymore
+    unordered_map<string, size_t>().swap(flat.path_index);
+    
+    auto for_each_sequence = [&](const std::function<void(const std::string& seq, const nid_t& node_id)>& lambda) {
+        for (size_t i = 0; i < flat.node_ids.size(); ++i) {
+            lambda(flat.sequences.substr(flat.sequence_starts[i], flat.sequence_starts[i + 1] - flat.sequence_starts[i]),
+                   flat.node_ids[i]);
+        }
+    };
+    
+    auto for_each_edge = [&](const std::function<void(const nid_t& from_id, const bool& from_rev,
+                                                      const nid_t& to_id, const bool& to_rev)>& lambda) {
+        for (const auto& edge : flat.edges) {
+            lambda(get<0>(edge), get<1>(edge), get<2>(edge), get<3>(edge));
+        }
+    };
+    
+    auto for_each_path_element = [&](const std::function<void(const std::string& path_name,
+                                                              const nid_t& node_id, const bool& is_rev,
+                                                              const std::string& cigar, const bool& is_empty, const bool& is_circular)>& lambda) {
+        for (size_t i = 0; i < flat.path_names.size(); ++i) {
+            for (const uint64_t& step : flat.path_steps[i]) {
+                lambda(flat.path_names[i], step / 2, step % 2, "", false, false);
+            }
+            if (flat.path_steps[i].empty()) {
+                lambda(flat.path_names[i], 0, false, "", true, false);
+            }
+        }
+    };
+    
+    graph->from_enumerators(for_each_sequence, for_each_edge, for_each_path_element, false);
+}
+
+void gfa_to_xg(const string& filename, xg::XG* graph,
+               int64_t max_rgfa_rank, const string& translation_filename,
+               unordered_set<PathSense>* ignore_sense) {
+    
+    GFAIDMapInfo id_map_info;
+    gfa_to_xg(filename, graph, &id_map_info, max_rgfa_rank, ignore_sense);
+    write_gfa_translation(id_map_info, translation_filename);
+}
+
 /// Read a range, stopping before any end character in the given null-terminated string,
 /// or at the end of the input.
 /// Throws if the range would be empty.
@@ -1343,6 +1623,491 @@ void GFAParser::parse(istream& in) {
     }
 }
 
+void GFAParser::parse_parallel(const string& filename) {
+    
+    // Map the whole file into memory
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::ios_base::failure("error:[GFAParser] Couldn't open GFA file " + filename);
+    }
+    struct stat file_stats;
+    if (fstat(fd, &file_stats) != 0) {
+        close(fd);
+        throw std::ios_base::failure("error:[GFAParser] Couldn't get the size of GFA file " + filename);
+    }
+    size_t file_size = file_stats.st_size;
+    const char* data = nullptr;
+    if (file_size > 0) {
+        void* mapped = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::ios_base::failure("error:[GFAParser] Couldn't memory-map GFA file " + filename);
+        }
+        // We read it front to back, once.
+        madvise(mapped, file_size, MADV_SEQUENTIAL);
+        data = (const char*) mapped;
+    }
+    close(fd);
+    
+    // Cut the file into chunks that start just after a newline. We want a few
+    // chunks per thread so that chunks full of long P or W lines don't hold
+    // everyone up, but we don't want tiny chunks.
+    const size_t MIN_CHUNK_SIZE = 1 << 18;
+    size_t target_chunks = std::max<size_t>(1, std::min<size_t>(omp_get_max_threads() * 4, file_size / MIN_CHUNK_SIZE));
+    vector<size_t> chunk_bounds {0};
+    for (size_t i = 1; i < target_chunks; i++) {
+        size_t start = file_size * i / target_chunks;
+        if (start <= chunk_bounds.back()) {
+            continue;
+        }
+        const char* newline = (const char*) memchr(data + start - 1, '\n', file_size - (start - 1));
+        if (!newline || newline + 1 == data + file_size) {
+            // No more line boundaries to split at
+            break;
+        }
+        start = newline + 1 - data;
+        if (start > chunk_bounds.back()) {
+            chunk_bounds.push_back(start);
+        }
+    }
+    chunk_bounds.push_back(file_size);
+    
+    // A line copied out of the file, so that our string cursors can point into it.
+    struct line_t {
+        // 1-based, and relative to the chunk until the chunks are all split.
+        size_t line_number;
+        string text;
+    };
+    // The rGFA tags found on an S line, if any
+    struct rgfa_tags_t {
+        bool present = false;
+        string path_name;
+        int64_t offset;
+        int64_t rank;
+    };
+    // Everything we know about one chunk of the file. The parse results point
+    // into the lines, so the line vectors can't change once they are parsed.
+    struct chunk_t {
+        size_t line_count = 0;
+        set<char> unknown_line_types;
+        
+        vector<line_t> h_lines;
+        vector<tuple<tag_list_t>> h_parses;
+        
+        vector<line_t> s_lines;
+        vector<tuple<string, chars_t, tag_list_t>> s_parses;
+        vector<rgfa_tags_t> s_rgfa_tags;
+        
+        vector<line_t> l_lines;
+        vector<tuple<string, bool, string, bool, chars_t, tag_list_t>> l_parses;
+        vector<pair<nid_t, nid_t>> l_ids;
+        
+        // P and W lines share a vector so we can keep them in file order.
+        vector<line_t> path_lines;
+        // For each, the index of its parse in the vector for its type.
+        vector<size_t> path_parse_indexes;
+        // And the total number of steps they take.
+        size_t step_count = 0;
+        
+        // Whether all the node names are numeric IDs, and their range
+        bool all_numeric = true;
+        bool any_numeric = false;
+        nid_t min_numeric_id = numeric_limits<nid_t>::max();
+        nid_t max_numeric_id = 0;
+        vector<tuple<string, chars_t, chars_t, tag_list_t>> p_parses;
+        vector<tuple<string, size_t, string, pair<int64_t, int64_t>, chars_t, tag_list_t>> w_parses;
+    };
+    vector<chunk_t> chunks(chunk_bounds.size() - 1);
+    
+    // Errors need to know where they are.
+    auto annotate_error = [&](GFAFormatError& e, const line_t* line) {
+        e.pass_number = 1;
+        if (line) {
+            e.line_number = line->line_number;
+            if (e.has_position) {
+                e.column_number = 1 + (e.position - line->text.begin());
+            }
+        }
+    };
+    
+    // Exceptions can't leave an OMP parallel region, so we run work over the
+    // chunks in parallel with this and rethrow the error from the earliest
+    // chunk, if there were any.
+    auto for_each_chunk_parallel = [&](const function<void(chunk_t&)>& work) {
+        vector<exception_ptr> errors(chunks.size());
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < chunks.size(); i++) {
+            try {
+                work(chunks[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+        for (auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+    
+    // Run a line through a function that does work for it.
+    auto do_for_line = [&](const line_t& line, const function<void()>& work) {
+        try {
+            work();
+        } catch (GFAFormatError& e) {
+            annotate_error(e, &line);
+            throw;
+        }
+    };
+    
+    // Call some listeners from the main thread, tolerating duplicate paths
+    // the same way the streaming parser does.
+    auto dispatch = [&](const line_t* line, const function<void()>& call_listeners) {
+        try {
+            call_listeners();
+        } catch (GFADuplicatePathError& e) {
+            annotate_error(e, line);
+            if (stop_on_duplicate_paths) {
+                throw;
+            }
+            #pragma omp critical (cerr)
+            std::cerr << "warning:[GFAParser] Skipping GFA " << (line ? line->text[0] : 'S')
+                << " line: " << e.what() << std::endl;
+        } catch (GFAFormatError& e) {
+            annotate_error(e, line);
+            throw;
+        }
+    };
+    
+    // Copy out the lines in each chunk, sorted by type.
+    for_each_chunk_parallel([&](chunk_t& chunk) {
+        size_t i = &chunk - chunks.data();
+        const char* cursor = data + chunk_bounds[i];
+        const char* end = data + chunk_bounds[i + 1];
+        while (cursor < end) {
+            const char* line_end = (const char*) memchr(cursor, '\n', end - cursor);
+            if (!line_end) {
+                // Last line of the file has no newline
+                line_end = end;
+            }
+            chunk.line_count++;
+            if (line_end != cursor) {
+                vector<line_t>* destination = nullptr;
+                switch (*cursor) {
+                case 'H':
+                    destination = &chunk.h_lines;
+                    break;
+                case 'S':
+                    destination = &chunk.s_lines;
+                    break;
+                case 'L':
+                    destination = &chunk.l_lines;
+                    break;
+                case 'P':
+                case 'W':
+                    destination = &chunk.path_lines;
+                    break;
+                default:
+                    chunk.unknown_line_types.insert(*cursor);
+                }
+                if (destination) {
+                    destination->push_back({chunk.line_count, string(cursor, line_end)});
+                }
+            }
+            cursor = line_end + 1;
+        }
+    });
+    
+    // We have our own copies of everything now.
+    if (data) {
+        munmap((void*) data, file_size);
+        data = nullptr;
+    }
+    
+    // Work out where each chunk's lines start
+    vector<size_t> chunk_line_offsets(chunks.size(), 0);
+    for (size_t i = 1; i < chunks.size(); i++) {
+        chunk_line_offsets[i] = chunk_line_offsets[i - 1] + chunks[i - 1].line_count;
+    }
+    
+    set<char> unknown_line_types;
+    for (auto& chunk : chunks) {
+        unknown_line_types.insert(chunk.unknown_line_types.begin(), chunk.unknown_line_types.end());
+    }
+    for (char line_type : unknown_line_types) {
+        cerr << "warning:[GFAParser] Ignoring unrecognized " << line_type << " line type" << endl;
+    }
+    
+    // Parse everything that doesn't depend on other lines.
+    for_each_chunk_parallel([&](chunk_t& chunk) {
+        size_t line_offset = chunk_line_offsets[&chunk - chunks.data()];
+        for (auto* lines : {&chunk.h_lines, &chunk.s_lines, &chunk.l_lines, &chunk.path_lines}) {
+            for (auto& line : *lines) {
+                line.line_number += line_offset;
+            }
+        }
+        
+        chunk.h_parses.reserve(chunk.h_lines.size());
+        for (auto& line : chunk.h_lines) {
+            do_for_line(line, [&]() {
+                chunk.h_parses.emplace_back(GFAParser::parse_h(line.text));
+            });
+        }
+        
+        chunk.s_parses.reserve(chunk.s_lines.size());
+        chunk.s_rgfa_tags.resize(chunk.s_lines.size());
+        for (size_t j = 0; j < chunk.s_lines.size(); j++) {
+            do_for_line(chunk.s_lines[j], [&]() {
+                chunk.s_parses.emplace_back(GFAParser::parse_s(chunk.s_lines[j].text));
+                auto& node_name = get<0>(chunk.s_parses.back());
+                auto& tags = get<2>(chunk.s_parses.back());
+                // See if this name is going to be the node ID, the same way assign_new_sequence_id() would
+                nid_t numeric_id = 0;
+                if (!node_name.empty() && node_name.size() < 19 &&
+                    all_of(node_name.begin(), node_name.end(), [](char c) { return isdigit(c); })) {
+                    numeric_id = stoll(node_name);
+                }
+                if (numeric_id > 0) {
+                    chunk.any_numeric = true;
+                    chunk.min_numeric_id = std::min(chunk.min_numeric_id, numeric_id);
+                    chunk.max_numeric_id = std::max(chunk.max_numeric_id, numeric_id);
+                } else {
+                    chunk.all_numeric = false;
+                }
+                if (this->max_rgfa_rank >= 0 && tags.size() >= 3) {
+                    // We'll check for the 3 rGFA optional tags.
+                    auto& rgfa_tags = chunk.s_rgfa_tags[j];
+                    rgfa_tags.present = (decode_rgfa_tags(tags, &rgfa_tags.path_name, &rgfa_tags.offset, &rgfa_tags.rank) &&
+                                         rgfa_tags.rank <= this->max_rgfa_rank);
+                }
+            });
+        }
+        
+        chunk.l_parses.reserve(chunk.l_lines.size());
+        for (auto& line : chunk.l_lines) {
+            do_for_line(line, [&]() {
+                chunk.l_parses.emplace_back(GFAParser::parse_l(line.text));
+            });
+        }
+        
+        chunk.path_parse_indexes.reserve(chunk.path_lines.size());
+        for (auto& line : chunk.path_lines) {
+            do_for_line(line, [&]() {
+                if (line.text[0] == 'P') {
+                    chunk.path_parse_indexes.push_back(chunk.p_parses.size());
+                    chunk.p_parses.emplace_back(GFAParser::parse_p(line.text));
+                    auto& path_name = get<0>(chunk.p_parses.back());
+                    auto& visits = get<1>(chunk.p_parses.back());
+                    auto& overlaps = get<2>(chunk.p_parses.back());
+                    for (auto it = overlaps.first; it != overlaps.second; ++it) {
+                        if (*it != '*' && *it != ',' && *it != 'M' && (*it < '0' || *it > '9')) {
+                            // This overlap isn't just * or a list of * or a list of matches with numbers.
+                            // We can't handle it
+                            throw GFAFormatError("Path " + path_name + " has nontrivial overlaps and can't be handled", it);
+                        }
+                    }
+                    if (!GFAParser::empty(visits) && *visits.first != '*') {
+                        chunk.step_count += 1 + std::count(visits.first, visits.second, ',');
+                    }
+                } else {
+                    chunk.path_parse_indexes.push_back(chunk.w_parses.size());
+                    chunk.w_parses.emplace_back(GFAParser::parse_w(line.text));
+                    auto& visits = get<4>(chunk.w_parses.back());
+                    chunk.step_count += std::count(visits.first, visits.second, '>') + std::count(visits.first, visits.second, '<');
+                }
+            });
+        }
+    });
+    
+    // Make sure the ID map exists before threads look at it.
+    GFAIDMapInfo& ids = this->id_map();
+    
+    if (!this->size_listeners.empty()) {
+        // We know how big the graph is going to be, so we can tell anyone who
+        // wants to allocate space up front.
+        size_t node_count = 0;
+        size_t edge_count = 0;
+        size_t step_count = 0;
+        bool all_numeric = true;
+        bool any_numeric = false;
+        nid_t min_numeric_id = numeric_limits<nid_t>::max();
+        nid_t max_numeric_id = 0;
+        for (auto& chunk : chunks) {
+            node_count += chunk.s_lines.size();
+            edge_count += chunk.l_lines.size();
+            step_count += chunk.step_count;
+            all_numeric = all_numeric && chunk.all_numeric;
+            any_numeric = any_numeric || chunk.any_numeric;
+            min_numeric_id = std::min(min_numeric_id, chunk.min_numeric_id);
+            max_numeric_id = std::max(max_numeric_id, chunk.max_numeric_id);
+        }
+        
+        // We can only predict the IDs if the names are all numeric or all
+        // not, and we aren't adding to an ID space that is already in use.
+        nid_t min_id = 0;
+        nid_t max_id = 0;
+        if (node_count > 0 && ids.numeric_mode && ids.name_to_id->empty()) {
+            if (all_numeric) {
+                min_id = min_numeric_id;
+                max_id = max_numeric_id;
+            } else if (!any_numeric) {
+                min_id = ids.max_id + 1;
+                max_id = ids.max_id + node_count;
+            }
+        }
+        
+        for (auto& listener : this->size_listeners) {
+            // Tell all the listener functions
+            listener(node_count, edge_count, step_count, min_id, max_id);
+        }
+    }
+    
+    for (auto& chunk : chunks) {
+        for (size_t j = 0; j < chunk.h_lines.size(); j++) {
+            dispatch(&chunk.h_lines[j], [&]() {
+                for (auto& listener : this->header_listeners) {
+                    // Tell all the listener functions
+                    listener(get<0>(chunk.h_parses[j]));
+                }
+            });
+        }
+    }
+    
+    // Nodes have to get their IDs in file order, and rGFA visits have to wait
+    // for all the nodes, so we hold those in order of first appearance.
+    using rgfa_visit_t = tuple<int64_t, nid_t, size_t>;
+    vector<tuple<string, int64_t, vector<rgfa_visit_t>>> rgfa_paths;
+    unordered_map<string, size_t> rgfa_path_indexes;
+    for (auto& chunk : chunks) {
+        for (size_t j = 0; j < chunk.s_lines.size(); j++) {
+            dispatch(&chunk.s_lines[j], [&]() {
+                auto& node_name = get<0>(chunk.s_parses[j]);
+                auto& sequence_range = get<1>(chunk.s_parses[j]);
+                auto& tags = get<2>(chunk.s_parses[j]);
+                nid_t assigned_id = GFAParser::assign_new_sequence_id(node_name, ids);
+                if (assigned_id == 0) {
+                    // This name has been used already!
+                    throw GFAFormatError("Duplicate sequence name: " + node_name);
+                }
+                for (auto& listener : this->node_listeners) {
+                    // Tell all the listener functions
+                    listener(assigned_id, sequence_range, tags);
+                }
+                
+                auto& rgfa_tags = chunk.s_rgfa_tags[j];
+                if (rgfa_tags.present) {
+                    auto found = rgfa_path_indexes.find(rgfa_tags.path_name);
+                    if (found == rgfa_path_indexes.end()) {
+                        // This is a completely new path, so record its rank
+                        found = rgfa_path_indexes.emplace_hint(found, rgfa_tags.path_name, rgfa_paths.size());
+                        rgfa_paths.emplace_back(rgfa_tags.path_name, rgfa_tags.rank, vector<rgfa_visit_t>());
+                    } else if (rgfa_tags.rank != get<1>(rgfa_paths[found->second])) {
+                        throw GFAFormatError("rGFA path " + rgfa_tags.path_name + " has conflicting ranks " + std::to_string(rgfa_tags.rank) + " and " + std::to_string(get<1>(rgfa_paths[found->second])));
+                    }
+                    get<2>(rgfa_paths[found->second]).emplace_back(rgfa_tags.offset, assigned_id, GFAParser::length(sequence_range));
+                }
+            });
+        }
+        
+        // The sequences are in the graph now, so we can drop our copies.
+        vector<line_t>().swap(chunk.s_lines);
+        vector<tuple<string, chars_t, tag_list_t>>().swap(chunk.s_parses);
+        vector<rgfa_tags_t>().swap(chunk.s_rgfa_tags);
+    }
+    
+    for (auto& rgfa_path : rgfa_paths) {
+        auto& rgfa_path_name = get<0>(rgfa_path);
+        auto& rgfa_path_rank = get<1>(rgfa_path);
+        auto& visits = get<2>(rgfa_path);
+        // Announce the visits along each path in offset order
+        std::sort(visits.begin(), visits.end());
+        for (auto& visit : visits) {
+            dispatch(nullptr, [&]() {
+                for (auto& listener : this->rgfa_listeners) {
+                    // Tell all the listener functions about this visit
+                    listener(get<1>(visit), get<0>(visit), get<2>(visit), rgfa_path_name, rgfa_path_rank);
+                }
+            });
+        }
+    }
+    rgfa_paths.clear();
+    
+    // Now all the nodes are known, we can check edges and paths against them
+    // in parallel, just reading the ID map.
+    for_each_chunk_parallel([&](chunk_t& chunk) {
+        chunk.l_ids.reserve(chunk.l_lines.size());
+        for (size_t j = 0; j < chunk.l_lines.size(); j++) {
+            do_for_line(chunk.l_lines[j], [&]() {
+                auto& l_parse = chunk.l_parses[j];
+                nid_t n1 = GFAParser::find_existing_sequence_id(get<0>(l_parse), ids);
+                if (!n1) {
+                    throw GFAFormatError("GFA file references missing node " + get<0>(l_parse));
+                }
+                nid_t n2 = GFAParser::find_existing_sequence_id(get<2>(l_parse), ids);
+                if (!n2) {
+                    throw GFAFormatError("GFA file references missing node " + get<2>(l_parse));
+                }
+                chunk.l_ids.emplace_back(n1, n2);
+            });
+        }
+        
+        for (size_t j = 0; j < chunk.path_lines.size(); j++) {
+            do_for_line(chunk.path_lines[j], [&]() {
+                // Make sure a P or W line only visits nodes we have
+                auto check_visit = [&](int64_t step_rank, const GFAParser::chars_t& step_id, bool step_is_reverse) {
+                    if (step_rank >= 0) {
+                        string step_string = GFAParser::extract(step_id);
+                        if (!GFAParser::find_existing_sequence_id(step_string, ids)) {
+                            throw GFAFormatError("GFA file references missing node " + step_string);
+                        }
+                    }
+                    return true;
+                };
+                if (chunk.path_lines[j].text[0] == 'P') {
+                    GFAParser::scan_p_visits(get<1>(chunk.p_parses[chunk.path_parse_indexes[j]]), check_visit);
+                } else {
+                    GFAParser::scan_w_visits(get<4>(chunk.w_parses[chunk.path_parse_indexes[j]]), check_visit);
+                }
+            });
+        }
+    });
+    
+    for (auto& chunk : chunks) {
+        for (size_t j = 0; j < chunk.l_lines.size(); j++) {
+            dispatch(&chunk.l_lines[j], [&]() {
+                auto& l_parse = chunk.l_parses[j];
+                for (auto& listener : this->edge_listeners) {
+                    // Tell all the listener functions
+                    listener(chunk.l_ids[j].first, get<1>(l_parse), chunk.l_ids[j].second, get<3>(l_parse), get<4>(l_parse), get<5>(l_parse));
+                }
+            });
+        }
+        vector<line_t>().swap(chunk.l_lines);
+        vector<tuple<string, bool, string, bool, chars_t, tag_list_t>>().swap(chunk.l_parses);
+        vector<pair<nid_t, nid_t>>().swap(chunk.l_ids);
+    }
+    
+    for (auto& chunk : chunks) {
+        for (size_t j = 0; j < chunk.path_lines.size(); j++) {
+            dispatch(&chunk.path_lines[j], [&]() {
+                if (chunk.path_lines[j].text[0] == 'P') {
+                    auto& p_parse = chunk.p_parses[chunk.path_parse_indexes[j]];
+                    for (auto& listener : this->path_listeners) {
+                        // Tell all the listener functions
+                        listener(get<0>(p_parse), get<1>(p_parse), get<2>(p_parse), get<3>(p_parse));
+                    }
+                } else {
+                    auto& w_parse = chunk.w_parses[chunk.path_parse_indexes[j]];
+                    for (auto& listener : this->walk_listeners) {
+                        // Tell all the listener functions
+                        listener(get<0>(w_parse), get<1>(w_parse), get<2>(w_parse), get<3>(w_parse), get<4>(w_parse), get<5>(w_parse));
+                    }
+                }
+            });
+        }
+    }
+}
+
 GFAIDMapInfo& GFAParser::id_map() {
     if (external_id_map) {
         return *external_id_map;
@@ -13,6 +13,10 @@
 
 #include "../handle.hpp"
 
+namespace xg {
+    class XG;
+}
+
 namespace vg {
 namespace algorithms {
 using namespace std;
@@ -59,7 +63,8 @@ struct GFAIDMapInfo : public NamedNodeBackTranslation {
 /// Throws GFAFormatError if the GFA file is not acceptable, and
 /// std::ios_base::failure if an IO operation fails. Throws invalid_argument if
 /// otherwise misused.
-/// Does not give max ID hints, and so might be very slow when loading into an ODGI graph.
+/// Only gives ID hints when the file is parsed in parallel, and so might be
+/// very slow when streaming into an ODGI graph.
 void gfa_to_handle_graph(const string& filename,
                          MutableHandleGraph* graph,
                          GFAIDMapInfo* translation = nullptr);
@@ -95,6 +100,24 @@ void gfa_to_path_handle_graph(istream& in,
                               int64_t max_rgfa_rank = numeric_limits<int64_t>::max(),
                               unordered_set<PathSense>* ignore_sense = nullptr);
 
+/// Read a GFA file for a blunt-ended graph straight into an XG, without an
+/// intermediate mutable graph. The file is parsed into flat arrays (in
+/// parallel, if it is a regular file), which XG construction then enumerates.
+/// Give "-" as a filename for stdin. Paths with senses in ignore_sense are
+/// skipped. Throws like gfa_to_path_handle_graph().
+void gfa_to_xg(const string& filename,
+               xg::XG* graph,
+               GFAIDMapInfo* translation = nullptr,
+               int64_t max_rgfa_rank = numeric_limits<int64_t>::max(),
+               unordered_set<PathSense>* ignore_sense = nullptr);
+
+/// Overload which serializes its translation to a file internally.
+void gfa_to_xg(const string& filename,
+               xg::XG* graph,
+               int64_t max_rgfa_rank,
+               const string& translation_filename,
+               unordered_set<PathSense>* ignore_sense = nullptr);
+
 /**
  * Lower-level tools for parsing GFA elements.
  *
@@ -245,6 +268,12 @@ public:
     
     /// These listeners are called for the header line(s), if any.
     vector<std::function<void(const tag_list_t& tags)>> header_listeners;
+    /// These listeners are called once, before any node listeners, if the
+    /// parser knows in advance how big the graph is going to be. They get the
+    /// number of S lines, L lines, and path and walk steps, and the smallest
+    /// and largest node IDs that will be assigned, or 0 if those can't be
+    /// predicted. Only parse_parallel() can know this.
+    vector<std::function<void(size_t node_count, size_t edge_count, size_t step_count, nid_t min_id, nid_t max_id)>> size_listeners;
     /// These listeners will be called with information for all nodes.
     /// Listeners are protected from duplicate node IDs. 
     vector<std::function<void(nid_t id, const chars_t& sequence, const tag_list_t& tags)>> node_listeners;
@@ -282,7 +311,19 @@ public:
      * Parse GFA from the given stream.
      */
     void parse(istream& in);
-    
+
+    /**
+     * Parse GFA from the named file, which must be a regular file that can be
+     * memory-mapped. The file is split into chunks at line boundaries, and
+     * the lines in the chunks are parsed, and checked against the nodes, in
+     * parallel. Listeners are still called from a single thread: headers
+     * first, then nodes, then rGFA visits, then edges, and then paths and
+     * walks, each in file order.
+     *
+     * Throws std::ios_base::failure if the file can't be opened or mapped.
+     */
+    void parse_parallel(const string& filename);
+
 };
 
 /// This exception will be thrown if the GFA data is not acceptable.
@@ -1,8 +1,12 @@
 #include "id_sort.hpp"
+#include "../concurrent_union_find.hpp"
 
 #include <algorithm>
 #include <vector>
 
+#include <omp.h>
+#include <ips4o.hpp>
+
 namespace vg {
 namespace algorithms {
 
@@ -11,18 +15,194 @@ using namespace std;
 vector<handle_t> id_order(const HandleGraph* g) {
     // We will fill and sort this
     vector<handle_t> to_return;
+    to_return.reserve(g->get_node_count());
     g->for_each_handle([&](const handle_t& handle) {
         // Collect all the handles
         to_return.push_back(handle);
     });
     
-    std::sort(to_return.begin(), to_return.end(), [&](const handle_t& a, const handle_t& b) {
-        // Sort in ID order with the standard algorithm
+    ips4o::parallel::sort(to_return.begin(), to_return.end(), [&](const handle_t& a, const handle_t& b) {
+        // Sort in ID order
         return g->get_id(a) < g->get_id(b);
     });
     
     return to_return;
 }
+
+namespace {
+
+/**
+ * A view of one weakly connected component of a graph, given by its sorted
+ * node IDs, so it can be sorted on its own.
+ */
+class ComponentOverlay : public HandleGraph {
+public:
+    ComponentOverlay(const HandleGraph* graph, const nid_t* ids_begin, const nid_t* ids_end) :
+        graph(graph), ids_begin(ids_begin), ids_end(ids_end) {
+        // Nothing to do
+    }
+    
+    bool has_node(nid_t node_id) const {
+        return std::binary_search(ids_begin, ids_end, node_id);
+    }
+    
+    handle_t get_handle(const nid_t& node_id, bool is_reverse = false) const {
+        return graph->get_handle(node_id, is_reverse);
+    }
+    
+    nid_t get_id(const handle_t& handle) const {
+        return graph->get_id(handle);
+    }
+    
+    bool get_is_reverse(const handle_t& handle) const {
+        return graph->get_is_reverse(handle);
+    }
+    
+    handle_t flip(const handle_t& handle) const {
+        return graph->flip(handle);
+    }
+    
+    size_t get_length(const handle_t& handle) const {
+        return graph->get_length(handle);
+    }
+    
+    string get_sequence(const handle_t& handle) const {
+        return graph->get_sequence(handle);
+    }
+    
+    size_t get_node_count() const {
+        return ids_end - ids_begin;
+    }
+    
+    nid_t min_node_id() const {
+        return *ids_begin;
+    }
+    
+    nid_t max_node_id() const {
+        return *(ids_end - 1);
+    }
+    
+protected:
+    
+    // the component is closed under edges, so we can follow them all
+    bool follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const {
+        return graph->follow_edges(handle, go_left, iteratee);
+    }
+    
+    bool for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel = false) const {
+        for (const nid_t* it = ids_begin; it != ids_end; ++it) {
+            if (!iteratee(graph->get_handle(*it))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    const HandleGraph* graph;
+    const nid_t* ids_begin;
+    const nid_t* ids_end;
+};
+
+}
+
+vector<handle_t> component_topological_order(const HandleGraph* g) {
+    
+    // get all the IDs in sorted order, so a node's index is its rank
+    vector<nid_t> ids;
+    ids.reserve(g->get_node_count());
+    g->for_each_handle([&](const handle_t& handle) {
+        ids.push_back(g->get_id(handle));
+    });
+    ips4o::parallel::sort(ids.begin(), ids.end());
+    auto rank = [&](nid_t id) {
+        return std::lower_bound(ids.begin(), ids.end(), id) - ids.begin();
+    };
+    
+    // find the components, whose group IDs are their smallest nodes' ranks
+    ConcurrentUnionFind union_find(ids.size());
+    g->for_each_edge([&](const edge_t& edge) {
+        union_find.union_groups(rank(g->get_id(edge.first)), rank(g->get_id(edge.second)));
+        return true;
+    }, true);
+    
+    // count the nodes in each component, lay the components out by their roots,
+    // and bucket the IDs, which stay sorted within each component
+    vector<size_t> component_starts(ids.size() + 1, 0);
+    vector<size_t> roots(ids.size());
+#pragma omp parallel for
+    for (size_t i = 0; i < ids.size(); ++i) {
+        roots[i] = union_find.find_group(i);
+    }
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ++component_starts[roots[i] + 1];
+    }
+    vector<size_t> components;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (component_starts[i + 1] != 0) {
+            components.push_back(i);
+        }
+        component_starts[i + 1] += component_starts[i];
+    }
+    
+    if (components.size() <= 1) {
+        // nothing to do in parallel
+        return handlealgs::topological_order(g);
+    }
+    
+    {
+        vector<nid_t> bucketed(ids.size());
+        vector<size_t> next(component_starts.begin(), component_starts.end() - 1);
+        for (size_t i = 0; i < ids.size(); ++i) {
+            bucketed[next[roots[i]]++] = ids[i];
+        }
+        ids = std::move(bucketed);
+    }
+    roots.clear();
+    roots.shrink_to_fit();
+    
+    // sort the biggest components first so the threads finish together
+    vector<size_t> work_order(components.begin(), components.end());
+    std::sort(work_order.begin(), work_order.end(), [&](size_t a, size_t b) {
+        size_t a_size = component_starts[a + 1] - component_starts[a];
+        size_t b_size = component_starts[b + 1] - component_starts[b];
+        return a_size > b_size || (a_size == b_size && a < b);
+    });
+    
+    vector<handle_t> to_return(ids.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < work_order.size(); ++i) {
+        size_t start = component_starts[work_order[i]];
+        size_t end = component_starts[work_order[i] + 1];
+        if (end - start == 1) {
+            to_return[start] = g->get_handle(ids[start]);
+            continue;
+        }
+        ComponentOverlay component(g, ids.data() + start, ids.data() + end);
+        vector<handle_t> order = handlealgs::topological_order(&component);
+        std::copy(order.begin(), order.end(), to_return.begin() + start);
+    }
+    
+    return to_return;
+}
+
+void assign_ids_in_order(MutableHandleGraph* g, const vector<handle_t>& order) {
+    // pair each old ID with its new ID, and sort by old ID for lookup
+    vector<pair<nid_t, nid_t>> new_ids(order.size());
+#pragma omp parallel for
+    for (size_t i = 0; i < order.size(); ++i) {
+        new_ids[i] = make_pair(g->get_id(order[i]), (nid_t) i + 1);
+    }
+    ips4o::parallel::sort(new_ids.begin(), new_ids.end());
+    
+    // If we find any e.g. dangling paths or edges with no nodes we will crash.
+    g->reassign_node_ids([&](const nid_t& old_id) {
+        auto it = std::lower_bound(new_ids.begin(), new_ids.end(), make_pair(old_id, (nid_t) 0));
+        if (it == new_ids.end() || it->first != old_id) {
+            throw std::out_of_range("Node " + std::to_string(old_id) + " is not in the ordering");
+        }
+        return it->second;
+    });
+}
     
 }
 }
@@ -20,8 +20,26 @@ using namespace std;
 
 /**
  * Order all the handles in the graph in ID order. All orientations are forward.
+ * The sort runs on all OMP threads.
  */
 vector<handle_t> id_order(const HandleGraph* g);
+
+/**
+ * Order all the handles in the graph in the generalized topological order of
+ * handlealgs::topological_order(), working on each weakly connected component
+ * concurrently. Components are laid out one after the other, in order of their
+ * smallest node IDs. A graph with a single component gets exactly the order
+ * handlealgs::topological_order() would give it. Apart from what the
+ * per-component sorts use, memory is a few integers per node.
+ */
+vector<handle_t> component_topological_order(const HandleGraph* g);
+
+/**
+ * Give the nodes of the graph the IDs 1, 2, 3, ... in the given order, which
+ * must contain every node exactly once. The new ID of each node is worked out
+ * in parallel and kept in a sorted table rather than a hash map.
+ */
+void assign_ids_in_order(MutableHandleGraph* g, const vector<handle_t>& order);
                                                       
 }
 }
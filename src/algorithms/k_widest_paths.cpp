@@ -8,6 +8,9 @@
 
 #include <structures/updateable_priority_queue.hpp>
 
+#include <algorithm>
+#include <unordered_map>
+
 namespace vg {
 namespace algorithms {
 
@@ -152,6 +155,123 @@ pair<double, vector<handle_t>> widest_dijkstra(const HandleGraph* g, handle_t so
     return make_pair(width, widest_path);
 }
 
+bool widest_path_order(const HandleGraph* g, handle_t source, handle_t sink, vector<handle_t>& order) {
+
+    // Kahn's algorithm over the handles we can reach, so first we need to
+    // find them all and count the edges into each.
+    // These are reused between calls on the same thread.
+    thread_local unordered_map<handle_t, size_t> in_degree;
+    thread_local vector<handle_t> stack;
+    in_degree.clear();
+    stack.clear();
+    order.clear();
+
+    handle_t flipped_source = g->flip(source);
+    in_degree[source] = 0;
+    stack.push_back(source);
+    while (!stack.empty()) {
+        handle_t here = stack.back();
+        stack.pop_back();
+        if (here == sink || here == flipped_source) {
+            // widest_dijkstra() doesn't go on from here
+            continue;
+        }
+        g->follow_edges(here, false, [&](const handle_t& next) {
+                auto found = in_degree.find(next);
+                if (found == in_degree.end()) {
+                    in_degree.emplace(next, 1);
+                    stack.push_back(next);
+                } else {
+                    found->second++;
+                }
+            });
+    }
+
+    if (in_degree[source] == 0) {
+        stack.push_back(source);
+    }
+    while (!stack.empty()) {
+        handle_t here = stack.back();
+        stack.pop_back();
+        order.push_back(here);
+        if (here == sink || here == flipped_source) {
+            continue;
+        }
+        g->follow_edges(here, false, [&](const handle_t& next) {
+                if (--in_degree[next] == 0) {
+                    stack.push_back(next);
+                }
+            });
+    }
+
+    // If there was a cycle, we never got to the handles on it
+    return order.size() == in_degree.size();
+}
+
+pair<double, vector<handle_t>> widest_dag_path(const HandleGraph* g, handle_t source, handle_t sink,
+                                               const vector<handle_t>& order,
+                                               function<double(const handle_t&)> node_weight_callback,
+                                               function<double(const edge_t&)> edge_weight_callback,
+                                               function<bool(const handle_t&)> is_node_ignored_callback,
+                                               function<bool(const edge_t&)> is_edge_ignored_callback) {
+
+    // The widest path to each handle reached so far, as (previous, width).
+    // Every path to a handle comes from handles before it in the order, so
+    // its width is final when we get to it.
+    thread_local unordered_map<handle_t, pair<handle_t, double>> best;
+    best.clear();
+
+    handle_t flipped_source = g->flip(source);
+    best[source] = make_pair(source, numeric_limits<double>::max());
+    for (auto it = std::find(order.begin(), order.end(), source); it != order.end(); ++it) {
+        handle_t current = *it;
+        auto found = best.find(current);
+        if (found == best.end() || current == sink || current == flipped_source) {
+            // Either we can't get here or we don't go on from here
+            continue;
+        }
+        double score = found->second.second;
+
+#ifdef debug_vg_algorithms
+        cerr << "Visit " << g->get_id(current) << " " << g->get_is_reverse(current) << " at width " << score << endl;
+#endif
+
+        g->follow_edges(current, false, [&](const handle_t& next) {
+                edge_t edge = g->edge_handle(current, next);
+                if (is_node_ignored_callback(next) || is_edge_ignored_callback(edge)) {
+                    return;
+                }
+                double next_score = score;
+                if (next != source && next != sink) {
+                    // we don't include the source / sink, as in widest_dijkstra()
+                    next_score = min(next_score, node_weight_callback(next));
+                }
+                next_score = min(next_score, edge_weight_callback(edge));
+
+                auto next_found = best.find(next);
+                if (next_found == best.end()) {
+                    best.emplace(next, make_pair(current, next_score));
+                } else if (next_score > next_found->second.second) {
+                    next_found->second = make_pair(current, next_score);
+                }
+            });
+    }
+
+    // trace our results back out of the table
+    vector<handle_t> widest_path;
+    double width = 0;
+    auto found = best.find(sink);
+    if (found != best.end()) {
+        width = found->second.second;
+        for (handle_t tb = sink; widest_path.empty() || widest_path.back() != source; tb = best[tb].first) {
+            widest_path.push_back(tb);
+        }
+        std::reverse(widest_path.begin(), widest_path.end());
+    }
+
+    return make_pair(width, widest_path);
+}
+
 // https://en.wikipedia.org/wiki/Yen%27s_algorithm
 vector<pair<double, vector<handle_t>>> yens_k_widest_paths(const HandleGraph* g, handle_t source, handle_t sink,
                                                            size_t K,
@@ -166,10 +286,25 @@ vector<pair<double, vector<handle_t>>> yens_k_widest_paths(const HandleGraph* g,
     // to not bother looking at the same prefix again
     vector<size_t> best_spurs;
 
-    // get the widest path from dijkstra
-    best_paths.push_back(widest_dijkstra(g, source, sink, node_weight_callback,
-                                         edge_weight_callback, [](handle_t) {return false;},
-                                         [](edge_t) {return false;}, greedy_avg));
+    // If the region we search is acyclic, every search can follow the same
+    // topological order instead of using Dijkstra. Greedy average width
+    // depends on the whole path, so that still needs Dijkstra.
+    vector<handle_t> order;
+    bool is_dag = !greedy_avg && widest_path_order(g, source, sink, order);
+    auto widest_path = [&](handle_t from,
+                           const function<bool(const handle_t&)>& is_node_ignored_callback,
+                           const function<bool(const edge_t&)>& is_edge_ignored_callback) {
+        if (is_dag) {
+            return widest_dag_path(g, from, sink, order, node_weight_callback, edge_weight_callback,
+                                   is_node_ignored_callback, is_edge_ignored_callback);
+        } else {
+            return widest_dijkstra(g, from, sink, node_weight_callback, edge_weight_callback,
+                                   is_node_ignored_callback, is_edge_ignored_callback, greedy_avg);
+        }
+    };
+
+    // get the widest path
+    best_paths.push_back(widest_path(source, [](handle_t) {return false;}, [](edge_t) {return false;}));
 
     // unable to get any kind of path.  this is either a bug in the search or the graph
     if (best_paths.back().second.empty()) {
@@ -184,6 +319,13 @@ vector<pair<double, vector<handle_t>>> yens_k_widest_paths(const HandleGraph* g,
     map<vector<handle_t>, size_t> B;
     // used to pull out the biggest element in B
     multimap<double, map<vector<handle_t>, size_t>::iterator> score_to_B;
+
+    // The search state for the spurs along a path only grows as we move the
+    // spur node along, so we keep it from one spur node to the next.
+    // Indexes in best_paths of the paths that share the root path and the spur node
+    vector<size_t> common_root_paths;
+    unordered_set<handle_t> forgotten_nodes;
+    unordered_set<edge_t> forgotten_edges;
     
     // start scanning for our k-1 next-widest paths
     for (size_t k = 1; k < K; ++k) {
@@ -192,7 +334,39 @@ vector<pair<double, vector<handle_t>>> yens_k_widest_paths(const HandleGraph* g,
         // up to that spur node, then a new path to the sink. (i is the index of the spur node in
         // the previous (k - 1) path
         vector<handle_t>& prev_path = best_paths[k - 1].second;
-        for (size_t i = best_spurs[k - 1]; i < prev_path.size() - 1; ++i) {
+        size_t first_spur = best_spurs[k - 1];
+
+        // All the paths that share prev_path[0 : first_spur]
+        common_root_paths.clear();
+        for (size_t p_i = 0; p_i < best_paths.size(); ++p_i) {
+            const vector<handle_t>& p = best_paths[p_i].second;
+            bool is_common_root = p.size() > first_spur;
+            for (size_t j = 0; j < first_spur && is_common_root; ++j) {
+                is_common_root = (p[j] == prev_path[j]);
+            }
+            if (is_common_root) {
+                common_root_paths.push_back(p_i);
+            }
+        }
+
+        // forget the root path (except spur node and the node before it)
+        forgotten_nodes.clear();
+        for (int j = 0; j < (int)first_spur - 1; ++j) {
+            forgotten_nodes.insert(prev_path[j]);
+            // don't allow loop-backs in paths
+            forgotten_nodes.insert(g->flip(prev_path[j]));
+        }
+
+        // The width of the root path prev_path[0 : first_spur]
+        double root_width = numeric_limits<double>::max();
+        for (size_t j = 0; j < first_spur; ++j) {
+            root_width = min(root_width, node_weight_callback(prev_path[j]));
+            if (j > 0) {
+                root_width = min(root_width, edge_weight_callback(g->edge_handle(prev_path[j-1], prev_path[j])));
+            }
+        }
+        
+        for (size_t i = first_spur; i < prev_path.size() - 1; ++i) {
             
             handle_t spur_node = prev_path[i];
             // root path = prev_path[0 : i]
@@ -200,57 +374,49 @@ vector<pair<double, vector<handle_t>>> yens_k_widest_paths(const HandleGraph* g,
 #ifdef debug_vg_algorithms
             cerr << "k=" << k << ": spur node=" << g->get_id(spur_node) << ":" << g->get_is_reverse(spur_node) << endl;
 #endif
-            unordered_set<edge_t> forgotten_edges;
-            for (const auto& p_v : best_paths) {
-                const vector<handle_t>& p = p_v.second;
-
-                // check if the root path is a prefix of p
-                bool is_common_root = true;
-                for (size_t j = 0; j <= i && is_common_root; ++j) {
-                    if (j >= prev_path.size() || p[j] != prev_path[j]) {
-                        is_common_root = false;
-                    }
-                }
-
-                // remove the links that are part of the previous shortest paths which share the same root path
-                if (is_common_root) {
+            if (i > first_spur) {
+                // Extend the root path by the last spur node.
+                root_width = min(root_width, node_weight_callback(prev_path[i - 1]));
+                if (i > 1) {
+                    root_width = min(root_width, edge_weight_callback(g->edge_handle(prev_path[i - 2], prev_path[i - 1])));
+                    forgotten_nodes.insert(prev_path[i - 2]);
+                    forgotten_nodes.insert(g->flip(prev_path[i - 2]));
 #ifdef debug_vg_algorithms
-                  cerr << "forgetting edge " << g->get_id(p[i]) << ":" << g->get_is_reverse(p[i]) << " -- "
-                       << g->get_id(p[i+1]) << ":" << g->get_is_reverse(p[i+1]) << endl;
+                    cerr << "forgetting node " << g->get_id(prev_path[i - 2]) << ":" << g->get_is_reverse(prev_path[i - 2]) << endl;
 #endif
-                    forgotten_edges.insert(g->edge_handle(p[i], p[i+1]));
                 }
             }
-            
-            // forget the root path too (except spur node)
-            unordered_set<handle_t> forgotten_nodes;
-            for (int j = 0; j < (int)i - 1; ++j) {
+
+            // Only the paths that also share the spur node share the root
+            // path through it.
+            forgotten_edges.clear();
+            size_t kept = 0;
+            for (size_t p_i : common_root_paths) {
+                const vector<handle_t>& p = best_paths[p_i].second;
+                if (p.size() > i + 1 && p[i] == prev_path[i]) {
+                    common_root_paths[kept++] = p_i;
+                    // remove the links that are part of the previous shortest paths which share the same root path
 #ifdef debug_vg_algorithms
-              cerr << "forgetting node " << g->get_id(prev_path[j]) << ":" << g->get_is_reverse(prev_path[j]) << endl;
+                    cerr << "forgetting edge " << g->get_id(p[i]) << ":" << g->get_is_reverse(p[i]) << " -- "
+                         << g->get_id(p[i+1]) << ":" << g->get_is_reverse(p[i+1]) << endl;
 #endif
-                forgotten_nodes.insert(prev_path[j]);
-                // don't allow loop-backs in paths
-                forgotten_nodes.insert(g->flip(prev_path[j]));
+                    forgotten_edges.insert(g->edge_handle(p[i], p[i+1]));
+                }
             }
+            common_root_paths.resize(kept);
 
             // find our path from the spur_node to the sink
-            pair<double, vector<handle_t>> spur_path_v = widest_dijkstra(g, spur_node, sink, node_weight_callback, edge_weight_callback,
-                                                                         [&](handle_t h) {return forgotten_nodes.count(h);},
-                                                                         [&](edge_t e) {return forgotten_edges.count(e);},
-                                                                         greedy_avg);
+            pair<double, vector<handle_t>> spur_path_v = widest_path(spur_node,
+                                                                     [&](handle_t h) {return forgotten_nodes.count(h);},
+                                                                     [&](edge_t e) {return forgotten_edges.count(e);});
 
             if (!spur_path_v.second.empty()) {
             
                 // make the path by combining the root path and the spur path
                 pair<double, vector<handle_t>> total_path;
-                double total_width = numeric_limits<double>::max();
-                for (size_t j = 0; j < i; ++j) {
-                    total_path.second.push_back(prev_path[j]);
-                    total_width = min(total_width, node_weight_callback(prev_path[j]));
-                    if (j > 0) {
-                        total_width = min(total_width, edge_weight_callback(g->edge_handle(prev_path[j-1], prev_path[j])));
-                    }
-                }
+                total_path.second.reserve(i + spur_path_v.second.size());
+                total_path.second.insert(total_path.second.end(), prev_path.begin(), prev_path.begin() + i);
+                double total_width = root_width;
                 if (!total_path.second.empty()) {
                     total_width = min(total_width, edge_weight_callback(g->edge_handle(total_path.second.back(), spur_path_v.second.front())));
                 }
@@ -274,7 +440,7 @@ vector<pair<double, vector<handle_t>>> yens_k_widest_paths(const HandleGraph* g,
                     }
                     total_path.first = total_length > 0 ? total_support / total_length : 0;
                 }                    
-                pair<map<vector<handle_t>, size_t>::iterator, bool> ins = B.insert(make_pair(total_path.second, i));
+                pair<map<vector<handle_t>, size_t>::iterator, bool> ins = B.insert(make_pair(std::move(total_path.second), i));
                 if (ins.second == true) {
                     score_to_B.insert(make_pair(total_path.first, ins.first));
                 } // todo: is there any reason we'd need to update the score of an existing entry in B?
@@ -313,6 +479,5 @@ vector<pair<double, vector<handle_t>>> yens_k_widest_paths(const HandleGraph* g,
     return best_paths;
 }
 
-
 }
 }
@@ -32,7 +32,27 @@ pair<double, vector<handle_t>> widest_dijkstra(const HandleGraph* g, handle_t so
                                                function<bool(const edge_t&)> is_edge_ignored_callbback,
                                                bool greedy_avg = false);
 
+/// Get a topological order of the handles that widest_dijkstra() could reach
+/// from source, which doesn't search past sink or flip(source). Returns false
+/// (and leaves order in an unspecified state) if they contain a cycle.
+bool widest_path_order(const HandleGraph* g, handle_t source, handle_t sink, vector<handle_t>& order);
+
+/// Linear-time replacement for widest_dijkstra() in min-flow mode, for when
+/// the handles reachable from source are acyclic. order must be a topological
+/// order (from widest_path_order()) that includes every handle reachable from
+/// source. When several paths are equally wide, may pick a different one than
+/// widest_dijkstra().
+pair<double, vector<handle_t>> widest_dag_path(const HandleGraph* g, handle_t source, handle_t sink,
+                                               const vector<handle_t>& order,
+                                               function<double(const handle_t&)> node_weight_callback,
+                                               function<double(const edge_t&)> edge_weight_callback,
+                                               function<bool(const handle_t&)> is_node_ignored_callback,
+                                               function<bool(const edge_t&)> is_edge_ignored_callback);
+
 /// Find the k widest paths
+/// If the part of the graph between source and sink is acyclic, and we aren't
+/// using greedy_avg, the searches follow its topological order instead of
+/// using Dijkstra.
 vector<pair<double, vector<handle_t>>> yens_k_widest_paths(const HandleGraph* g, handle_t source, handle_t sink,
                                                            size_t K,
                                                            function<double(const handle_t&)> node_weight_callback,
@@ -5,6 +5,12 @@
  */
 
 #include "nearest_offsets_in_paths.hpp"
+#include "../step_position_overlay.hpp"
+#include "../hash_map.hpp"
+#include "dijkstra_engine.hpp"
+
+#include <algorithm>
+#include <omp.h>
 
 //#define debug
 
@@ -13,39 +19,50 @@ namespace algorithms {
 
 using namespace std;
 
-path_offset_collection_t nearest_offsets_in_paths(const PathPositionHandleGraph* graph,
-                                                  const pos_t& pos,
-                                                  int64_t max_search,
-                                                  const std::function<bool(const path_handle_t&)>* path_filter) {
-    
-    // init the return value
-    // This is a map from path handle, to vector of offset and orientation pairs
-    path_offset_collection_t return_val;
-    
-    // use greater so that we traverse in ascending order of distance
-    structures::RankPairingHeap<pair<handle_t, bool>, int64_t, greater<int64_t>> queue;
-    
-    // add in the initial traversals in both directions from the start position
-    // distances are measured to the left side of the node
-    handle_t start = graph->get_handle(id(pos), is_rev(pos));
-    queue.push_or_reprioritize(make_pair(start, false), -offset(pos));
-    queue.push_or_reprioritize(make_pair(graph->flip(start), true), offset(pos) - graph->get_length(start));
+/// Add the offsets along all the paths that visit the node at the given
+/// search state to the return value. Returns true if any were added.
+static bool add_node_offsets(const PathPositionHandleGraph* graph,
+                             const StepPositionOverlay* overlay,
+                             const handle_t& here, bool search_left, int64_t dist,
+                             const std::function<bool(const path_handle_t&)>* path_filter,
+                             path_offset_collection_t& return_val) {
     
-    while (!queue.empty()) {
-        // get the queue that has the next shortest path
-        auto trav = queue.top();
-        queue.pop();
-        
-        // unpack this record
-        handle_t here = trav.first.first;
-        bool search_left = trav.first.second;
-        int64_t dist = trav.second;
-        
-#ifdef debug_algorithms
-        cerr << "traversing " << graph->get_id(here) << (graph->get_is_reverse(here) ? "-" : "+")
-        << " in " << (search_left ? "leftward" : "rightward") << " direction at distance " << dist << endl;
-#endif
+    bool added = false;
+    if (overlay) {
+        // flip the handle back to the orientation it started in
+        handle_t oriented = search_left ? graph->flip(here) : here;
+        bool oriented_rev = graph->get_is_reverse(oriented);
+        size_t oriented_length = graph->get_length(oriented);
         
+        auto range = overlay->visit_range(graph->get_id(here));
+        for (size_t i = range.first; i < range.second; ++i) {
+            path_handle_t path_handle = overlay->visit_path(i);
+            if (path_filter && !(*path_filter)(path_handle)) {
+                // We are to ignore this path
+                continue;
+            }
+            
+            // the orientation of the position relative to the forward strand of the path
+            bool rev_on_path = (oriented_rev != overlay->visit_is_reverse(i));
+            
+            // the offset of this step on the forward strand
+            int64_t path_offset = overlay->visit_offset(i);
+            
+            if (rev_on_path != search_left) {
+                path_offset += oriented_length + dist;
+            }
+            else {
+                path_offset -= dist;
+            }
+            
+            // handle possible under/overflow from the search distance
+            path_offset = max<int64_t>(min<int64_t>(path_offset, overlay->get_path_length(path_handle)), 0);
+            
+            return_val[path_handle].emplace_back(path_offset, rev_on_path);
+            added = true;
+        }
+    }
+    else {
         for (const step_handle_t& step : graph->steps_of_handle(here)) {
             // For each path visit that occurs on this node
 #ifdef debug
@@ -61,33 +78,95 @@ path_offset_collection_t nearest_offsets_in_paths(const PathPositionHandleGraph*
 #endif
                 continue;
             }
-            
+        
             // flip the handle back to the orientation it started in
             handle_t oriented = search_left ? graph->flip(here) : here;
-            
+        
             // the orientation of the position relative to the forward strand of the path
             bool rev_on_path = (oriented != graph->get_handle_of_step(step));
-            
+        
             // the offset of this step on the forward strand
             int64_t path_offset = graph->get_position_of_step(step);
-            
+        
             if (rev_on_path != search_left) {
                 path_offset += graph->get_length(oriented) + dist;
             }
             else {
                 path_offset -= dist;
             }
-            
+        
 #ifdef debug
             cerr << "after adding search distance and node offset, " << path_offset << " on strand " << rev_on_path << endl;
 #endif
-            
+        
             // handle possible under/overflow from the search distance
             path_offset = max<int64_t>(min<int64_t>(path_offset, graph->get_path_length(path_handle)), 0);
-            
+        
             // add in the search distance and add the result to the output
             return_val[path_handle].emplace_back(path_offset, rev_on_path);
+            added = true;
+        }
+    }
+    return added;
+}
+
+/// Returns true if any path visits the node, ignoring paths rejected by the filter.
+static bool has_path_visits(const PathPositionHandleGraph* graph,
+                            const StepPositionOverlay* overlay,
+                            const handle_t& here,
+                            const std::function<bool(const path_handle_t&)>* path_filter) {
+    if (overlay) {
+        auto range = overlay->visit_range(graph->get_id(here));
+        for (size_t i = range.first; i < range.second; ++i) {
+            if (!path_filter || (*path_filter)(overlay->visit_path(i))) {
+                return true;
+            }
         }
+        return false;
+    }
+    return !graph->for_each_step_on_handle(here, [&](const step_handle_t& step) {
+        return path_filter && !(*path_filter)(graph->get_path_handle_of_step(step));
+    });
+}
+
+path_offset_collection_t nearest_offsets_in_paths(const PathPositionHandleGraph* graph,
+                                                  const pos_t& pos,
+                                                  int64_t max_search,
+                                                  const std::function<bool(const path_handle_t&)>* path_filter) {
+    
+    // if the graph has its visits precomputed, we can read them without going
+    // through the step handles
+    const StepPositionOverlay* overlay = dynamic_cast<const StepPositionOverlay*>(graph);
+    
+    // init the return value
+    // This is a map from path handle, to vector of offset and orientation pairs
+    path_offset_collection_t return_val;
+    
+    // use greater so that we traverse in ascending order of distance
+    structures::RankPairingHeap<pair<handle_t, bool>, int64_t, greater<int64_t>> queue;
+    
+    // add in the initial traversals in both directions from the start position
+    // distances are measured to the left side of the node
+    handle_t start = graph->get_handle(id(pos), is_rev(pos));
+    queue.push_or_reprioritize(make_pair(start, false), -offset(pos));
+    queue.push_or_reprioritize(make_pair(graph->flip(start), true), offset(pos) - graph->get_length(start));
+    
+    while (!queue.empty()) {
+        // get the queue that has the next shortest path
+        auto trav = queue.top();
+        queue.pop();
+        
+        // unpack this record
+        handle_t here = trav.first.first;
+        bool search_left = trav.first.second;
+        int64_t dist = trav.second;
+        
+#ifdef debug_algorithms
+        cerr << "traversing " << graph->get_id(here) << (graph->get_is_reverse(here) ? "-" : "+")
+        << " in " << (search_left ? "leftward" : "rightward") << " direction at distance " << dist << endl;
+#endif
+        
+        add_node_offsets(graph, overlay, here, search_left, dist, path_filter, return_val);
         
         if (!return_val.empty()) {
             // we found the closest, we're done
@@ -115,6 +194,118 @@ path_offset_collection_t nearest_offsets_in_paths(const PathPositionHandleGraph*
     return return_val;
 }
 
+/// The nearest node with path visits found by a one-directional search from
+/// the left side of a node.
+struct directed_path_hit_t {
+    /// Whether any was found within the search bound
+    bool found = false;
+    /// The node, oriented in the search direction
+    handle_t here;
+    /// The distance from the left side of the start node to the left side of here
+    int64_t dist = 0;
+};
+
+/// Search in one direction from the left side of start, which has no path
+/// visits, for the nearest node that does, not crossing nodes past max_search.
+static directed_path_hit_t nearest_directed_path_hit(const PathPositionHandleGraph* graph,
+                                                     const StepPositionOverlay* overlay,
+                                                     const handle_t& start, int64_t max_search,
+                                                     const std::function<bool(const path_handle_t&)>* path_filter) {
+    directed_path_hit_t hit;
+    DijkstraEngine& queue = DijkstraEngine::for_this_thread();
+    queue.push_or_reprioritize(start, 0);
+    while (!queue.empty()) {
+        auto trav = queue.top();
+        queue.pop();
+        if (trav.first != start && has_path_visits(graph, overlay, trav.first, path_filter)) {
+            hit.found = true;
+            hit.here = trav.first;
+            hit.dist = trav.second;
+            break;
+        }
+        int64_t dist_thru = trav.second + graph->get_length(trav.first);
+        if (dist_thru <= max_search) {
+            graph->follow_edges(trav.first, false, [&](const handle_t& next) {
+                queue.push_or_reprioritize(next, dist_thru);
+            });
+        }
+    }
+    return hit;
+}
+
+vector<path_offset_collection_t> nearest_offsets_in_paths(const PathPositionHandleGraph* graph,
+                                                          const vector<pos_t>& positions,
+                                                          int64_t max_search,
+                                                          const std::function<bool(const path_handle_t&)>* path_filter) {
+    
+    vector<path_offset_collection_t> return_val(positions.size());
+    
+    const StepPositionOverlay* overlay = dynamic_cast<const StepPositionOverlay*>(graph);
+    
+    // visit the positions in node order so that nearby positions share cache entries
+    vector<size_t> order(positions.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return positions[a] < positions[b];
+    });
+    
+#pragma omp parallel if (positions.size() >= NEAREST_OFFSETS_PARALLEL_BATCH_SIZE)
+    {
+        // the nearest path nodes from the left side of each handle, which doesn't depend
+        // on the offset on the node, so positions on the same off-path nodes share it
+        unordered_map<handle_t, directed_path_hit_t> hit_cache;
+        
+#pragma omp for schedule(dynamic, 64)
+        for (size_t i = 0; i < order.size(); ++i) {
+            const pos_t& pos = positions[order[i]];
+            path_offset_collection_t& offsets = return_val[order[i]];
+            
+            handle_t start = graph->get_handle(id(pos), is_rev(pos));
+            // both directions give the same offsets on the start node itself
+            if (add_node_offsets(graph, overlay, start, false, -offset(pos), path_filter, offsets)) {
+                continue;
+            }
+            
+            // the search from a position can cross at most this far past the left side of
+            // either orientation of its node, so one bounded search per orientation answers
+            // every position on the node
+            int64_t length = graph->get_length(start);
+            int64_t bound = max_search + length;
+            
+            directed_path_hit_t hits[2];
+            handle_t starts[2] = {start, graph->flip(start)};
+            int64_t shifts[2] = {-offset(pos), offset(pos) - length};
+            for (size_t j = 0; j < 2; ++j) {
+                auto it = hit_cache.find(starts[j]);
+                if (it == hit_cache.end()) {
+                    it = hit_cache.emplace(starts[j], nearest_directed_path_hit(graph, overlay, starts[j], bound, path_filter)).first;
+                }
+                hits[j] = it->second;
+                hits[j].dist += shifts[j];
+                if (hits[j].dist > max_search) {
+                    // the search from this position runs out of budget first
+                    hits[j].found = false;
+                }
+            }
+            
+            // take the nearer of the two directions
+            int best = -1;
+            for (int j = 0; j < 2; ++j) {
+                if (hits[j].found && (best == -1 || hits[j].dist < hits[best].dist)) {
+                    best = j;
+                }
+            }
+            if (best != -1) {
+                add_node_offsets(graph, overlay, hits[best].here, best == 1, hits[best].dist, path_filter, offsets);
+            }
+        }
+    }
+    
+    return return_val;
+}
+
 map<string, vector<pair<size_t, bool>>> offsets_in_paths(const PathPositionHandleGraph* graph, const pos_t& pos) {
     auto offsets = nearest_offsets_in_paths(graph, pos, -1);
     map<string, vector<pair<size_t, bool>>> named_offsets;
@@ -32,11 +32,28 @@ using path_offset_collection_t = unordered_map<path_handle_t, vector<pair<size_t
 /// Stops search when path(s) are ancountered.
 ///
 /// If path_filter is set, ignores paths for which it returns false.
+///
+/// If the graph is a StepPositionOverlay, its precomputed visits are used.
 path_offset_collection_t nearest_offsets_in_paths(const PathPositionHandleGraph* graph,
                                                   const pos_t& pos, int64_t max_search,
                                                   const std::function<bool(const path_handle_t&)>* path_filter = nullptr);
     
-/// Wrapper for the above to support some earlier code. Only looks for paths
+/// Batches at least this big are searched with multiple threads.
+constexpr size_t NEAREST_OFFSETS_PARALLEL_BATCH_SIZE = 1024;
+
+/// Batched version of the above, giving the nearest path offsets of each of
+/// the positions, in order. The positions are visited in node order, and the
+/// nearest path nodes found from each node without path visits are reused for
+/// all the other positions on it, so this is much faster than one call per
+/// position when positions are clustered, as they are within a read. Results
+/// are the same as for the single-position version, except that ties between
+/// equally distant nodes may be broken differently. Large batches are
+/// searched in parallel, with a cache per thread.
+vector<path_offset_collection_t> nearest_offsets_in_paths(const PathPositionHandleGraph* graph,
+                                                          const vector<pos_t>& positions, int64_t max_search,
+                                                          const std::function<bool(const path_handle_t&)>* path_filter = nullptr);
+
+/// Wrapper for the single-position version to support some earlier code. Only looks for paths
 /// that directly touch the position, and returns the paths by name.
 map<string, vector<pair<size_t, bool>>> offsets_in_paths(const PathPositionHandleGraph* graph, const pos_t& pos);
 
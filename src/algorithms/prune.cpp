@@ -122,18 +122,11 @@ pair_hash_set<edge_t> find_edges_to_prune(const HandleGraph& graph, size_t k, si
     return result;
 }
 
-size_t prune_complex(DeletableHandleGraph& graph,
-                     int path_length, int edge_max) {
-    
-    auto edges_to_destroy = find_edges_to_prune(graph, path_length, edge_max);
-    for (auto& edge : edges_to_destroy) {
-        graph.destroy_edge(edge);
-    }
-    return edges_to_destroy.size();
-}
-
-size_t prune_complex_with_head_tail(DeletableHandleGraph& graph,
-                                    int path_length, int edge_max) {
+/// Find the edges that prune_complex_with_head_tail() should remove from the
+/// graph, and the total number of edges pruned, including edges involving the
+/// artificial source and sink.
+static pair<vector<edge_t>, size_t> find_edges_to_prune_with_head_tail(const HandleGraph& graph,
+                                                                       int path_length, int edge_max) {
     
     SourceSinkOverlay source_sink_graph(&graph, path_length);
     
@@ -141,6 +134,8 @@ size_t prune_complex_with_head_tail(DeletableHandleGraph& graph,
                                                 path_length,
                                                 edge_max);
     
+    pair<vector<edge_t>, size_t> to_return;
+    to_return.second = edges_to_destroy.size();
     for (auto& edge : edges_to_destroy) {
         auto ss_handle_1 = source_sink_graph.forward(edge.first);
         auto ss_handle_2 = source_sink_graph.forward(edge.second);
@@ -149,15 +144,16 @@ size_t prune_complex_with_head_tail(DeletableHandleGraph& graph,
             && ss_handle_2 != source_sink_graph.get_source_handle()
             && ss_handle_2 != source_sink_graph.get_sink_handle()) {
             // this is not an edge involving the artificial source/sink nodes
-            graph.destroy_edge(source_sink_graph.get_underlying_handle(edge.first),
-                               source_sink_graph.get_underlying_handle(edge.second));
-            
+            to_return.first.emplace_back(source_sink_graph.get_underlying_handle(edge.first),
+                                         source_sink_graph.get_underlying_handle(edge.second));
         }
     }
-    return edges_to_destroy.size();
+    return to_return;
 }
 
-size_t prune_short_subgraphs(DeletableHandleGraph& graph, int min_size) {
+/// Find the forward handles of the nodes in weakly connected components with
+/// total sequence length under the minimum size.
+static unordered_set<handle_t> find_short_subgraph_nodes(const HandleGraph& graph, int min_size) {
     
     unordered_set<handle_t> to_destroy;
     
@@ -199,16 +195,11 @@ size_t prune_short_subgraphs(DeletableHandleGraph& graph, int min_size) {
         }
     }
     
-    // destroy all handles that we marked
-    for (auto handle : to_destroy) {
-        graph.destroy_handle(handle);
-    }
-    
-    return to_destroy.size();
+    return to_destroy;
 }
 
-
-size_t remove_high_degree_nodes(DeletableHandleGraph& g, int max_degree) {
+/// Find the nodes with more than max_degree total edges.
+static vector<handle_t> find_high_degree_nodes(const HandleGraph& g, int max_degree) {
     vector<handle_t> to_remove;
     g.for_each_handle([&](const handle_t& h) {
         int edge_count = 0;
@@ -222,6 +213,43 @@ size_t remove_high_degree_nodes(DeletableHandleGraph& g, int max_degree) {
             to_remove.push_back(h);
         }
     });
+    return to_remove;
+}
+
+size_t prune_complex(DeletableHandleGraph& graph,
+                     int path_length, int edge_max) {
+    
+    auto edges_to_destroy = find_edges_to_prune(graph, path_length, edge_max);
+    for (auto& edge : edges_to_destroy) {
+        graph.destroy_edge(edge);
+    }
+    return edges_to_destroy.size();
+}
+
+size_t prune_complex_with_head_tail(DeletableHandleGraph& graph,
+                                    int path_length, int edge_max) {
+    
+    auto edges_to_destroy = find_edges_to_prune_with_head_tail(graph, path_length, edge_max);
+    for (auto& edge : edges_to_destroy.first) {
+        graph.destroy_edge(edge);
+    }
+    return edges_to_destroy.second;
+}
+
+size_t prune_short_subgraphs(DeletableHandleGraph& graph, int min_size) {
+    
+    auto to_destroy = find_short_subgraph_nodes(graph, min_size);
+    
+    // destroy all handles that we marked
+    for (auto handle : to_destroy) {
+        graph.destroy_handle(handle);
+    }
+    
+    return to_destroy.size();
+}
+
+size_t remove_high_degree_nodes(DeletableHandleGraph& g, int max_degree) {
+    auto to_remove = find_high_degree_nodes(g, max_degree);
     // now destroy the high degree nodes
     for (auto& h : to_remove) {
         g.destroy_handle(h);
@@ -229,5 +257,62 @@ size_t remove_high_degree_nodes(DeletableHandleGraph& g, int max_degree) {
     return to_remove.size();
 }
 
+size_t prune_complex(PruningOverlay& graph,
+                     int path_length, int edge_max) {
+    
+    auto edges_to_destroy = find_edges_to_prune(graph, path_length, edge_max);
+    for (auto& edge : edges_to_destroy) {
+        graph.mask_edge(edge);
+    }
+    return edges_to_destroy.size();
+}
+
+size_t prune_complex_with_head_tail(PruningOverlay& graph,
+                                    int path_length, int edge_max) {
+    
+    auto edges_to_destroy = find_edges_to_prune_with_head_tail(graph, path_length, edge_max);
+    for (auto& edge : edges_to_destroy.first) {
+        graph.mask_edge(edge);
+    }
+    return edges_to_destroy.second;
+}
+
+size_t prune_short_subgraphs(PruningOverlay& graph, int min_size) {
+    
+    auto to_destroy = find_short_subgraph_nodes(graph, min_size);
+    for (auto handle : to_destroy) {
+        graph.mask_node(handle);
+    }
+    return to_destroy.size();
+}
+
+size_t remove_high_degree_nodes(PruningOverlay& g, int max_degree) {
+    auto to_remove = find_high_degree_nodes(g, max_degree);
+    for (auto& h : to_remove) {
+        g.mask_node(h);
+    }
+    return to_remove.size();
+}
+
+void restore_paths(PruningOverlay& graph, const PathHandleGraph& path_graph) {
+    // we include generic to also pick up transcript paths
+    path_graph.for_each_path_matching({PathSense::GENERIC, PathSense::REFERENCE}, {}, {},
+                                      [&](const path_handle_t& path) {
+        handle_t prev;
+        bool first = true;
+        path_graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+            handle_t curr = path_graph.get_handle_of_step(step);
+            if (first) {
+                graph.unmask_node(curr);
+                first = false;
+            } else {
+                // this also brings back the nodes
+                graph.unmask_edge(make_pair(prev, curr));
+            }
+            prev = curr;
+        });
+    });
+}
+
 }
 }
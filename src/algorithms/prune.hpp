@@ -2,6 +2,7 @@
 #define VG_ALGORITHMS_PRUNE_HPP_INCLUDED
 
 #include "../handle.hpp"
+#include "../pruning_overlay.hpp"
 
 namespace vg {
 namespace algorithms {
@@ -25,6 +26,21 @@ size_t prune_short_subgraphs(DeletableHandleGraph& graph, int min_size);
 /// end-to-start self loops count twice. Returns the number of nodes removed.
 size_t remove_high_degree_nodes(DeletableHandleGraph& graph, int max_degree);
 
+/// Versions of the above that leave the backing graph of a PruningOverlay
+/// alone, and hide what they would remove in the overlay instead. These let
+/// a read-only graph be pruned without making a mutable copy of it.
+size_t prune_complex(PruningOverlay& graph,
+                     int path_length, int edge_max);
+size_t prune_complex_with_head_tail(PruningOverlay& graph,
+                                    int path_length, int edge_max);
+size_t prune_short_subgraphs(PruningOverlay& graph, int min_size);
+size_t remove_high_degree_nodes(PruningOverlay& graph, int max_degree);
+
+/// Bring back the nodes and edges along the reference and generic paths of
+/// the given graph, which must be the backing graph of the overlay. This is
+/// the overlay version of PhaseUnfolder::restore_paths().
+void restore_paths(PruningOverlay& graph, const PathHandleGraph& path_graph);
+
 }
 }
 
@@ -31,70 +31,40 @@ bool simplify_siblings(handlegraph::MutablePathDeletableHandleGraph* graph,
     // left side in another.
     unordered_set<id_t> in_family;
     
+    // Finding which candidate siblings have exactly the right parents is the
+    // expensive part, and only reads the graph, so we do it for all the
+    // handles in parallel first. Then we assemble the families serially, in
+    // graph order, so the merges are the same no matter the thread count.
+    vector<handle_t> handles;
+    handles.reserve(graph->get_node_count());
     graph->for_each_handle([&](const handle_t& local_forward_node) {
-        // For each node local forward
-        
+        handles.push_back(local_forward_node);
+    });
+    
+    // For each handle and then its flip, the candidate siblings that have
+    // exactly its parents, in the order we found them. Left empty when there
+    // is no one to merge with.
+    vector<vector<handle_t>> sibling_candidates(handles.size() * 2);
+    
+#pragma omp parallel for schedule(dynamic, 512)
+    for (size_t i = 0; i < handles.size(); i++) {
         for (bool local_orientation : {false, true}) {
             // For it local forward and local reverse
-            handle_t node = local_orientation ? graph->flip(local_forward_node) : local_forward_node;
-            
-#ifdef debug
-            cerr << "Consider " << graph->get_id(node) << (graph->get_is_reverse(node) ? '-' : '+') << endl;
-#endif
-            
-            if (in_family.count(graph->get_id(node))) {
-                // If it is in a family in one orientation, don't find a family for it in the other orientation.
-                // We can only merge from one end of a node at a time.
-#ifdef debug
-                cerr << "Node " << graph->get_id(node) << " is already in a family to merge" << endl;
-#endif
-                
-                return;
-            }
-            // For each handle where it or its RC isn't already in a superfamily, identify its superfamily.
-            unordered_set<handle_t> superfamily;
+            handle_t node = local_orientation ? graph->flip(handles[i]) : handles[i];
+            auto& candidates = sibling_candidates[2 * i + local_orientation];
             
             // Look left from the node and make a set of the things you see.
             unordered_set<handle_t> correct_parents;
             graph->follow_edges(node, true, [&](const handle_t& parent) {
                 correct_parents.insert(parent);
-#ifdef debug
-                cerr << "Parent set includes: " << graph->get_id(parent) << (graph->get_is_reverse(parent) ? '-' : '+') << endl;
-#endif
             });
             
-            // Keep a set of things that are partial siblings so we don't have to constantly check them
-            unordered_set<handle_t> partial_siblings;
+            // Keep a set of things we already checked so we don't have to constantly check them
+            unordered_set<handle_t> checked;
             for (auto& parent : correct_parents) {
                 graph->follow_edges(parent, false, [&](const handle_t& candidate) {
                     // Look right from parents and for each candidate family member
-                    
-#ifdef debug
-                    cerr << "Parent " << graph->get_id(parent) << (graph->get_is_reverse(parent) ? '-' : '+')
-                        << " suggests sibling " << graph->get_id(candidate) << (graph->get_is_reverse(candidate) ? '-' : '+') << endl;
-#endif
-                    
-                    if (partial_siblings.count(candidate)) {
-                        // Known non-member
-#ifdef debug
-                        cerr << "\tAlready checked." << endl;
-#endif
-                        return;
-                    }
-                    if (superfamily.count(candidate)) {
-                        // Known member
-#ifdef debug
-                        cerr << "\tAlready taken." << endl;
-#endif
-                        return;
-                    }
-                    
-                    if (in_family.count(graph->get_id(candidate))) {
-                        // If it is in a family in one orientation, don't find a family for it in the other orientation.
-                        // We can only merge from one end of a node at a time.
-#ifdef debug
-                        cerr << "\tAlready in a family to merge." << endl;
-#endif
+                    if (!checked.insert(candidate).second) {
                         return;
                     }
                     
@@ -105,56 +75,80 @@ bool simplify_siblings(handlegraph::MutablePathDeletableHandleGraph* graph,
                         if (!correct_parents.count(candidate_parent)) {
                             // We have a parent we shouldn't
                             bad_parent = true;
-                            
-#ifdef debug
-                            cerr << "\tHas unacceptable parent "
-                                << graph->get_id(candidate_parent) << (graph->get_is_reverse(candidate_parent) ? '-' : '+') << endl;
-#endif
-                            
                             return false;
                         } else {
                             // Otherwise we found one of the right ones.
                             seen_parents++;
-                            
-#ifdef debug
-                            cerr << "\tHas OK parent "
-                                << graph->get_id(candidate_parent) << (graph->get_is_reverse(candidate_parent) ? '-' : '+') << endl;
-#endif
-                            
                             return true;
                         }
                     });
                     
+                    if (!bad_parent && seen_parents == correct_parents.size()) {
+                        candidates.push_back(candidate);
+                    }
+                });
+            }
+            
+            if (candidates.size() < 2) {
+                // This can only make a trivial family
+                vector<handle_t>().swap(candidates);
+            }
+        }
+    }
+    
+    for (size_t i = 0; i < handles.size(); i++) {
+        // For each node local forward
+        
+        for (bool local_orientation : {false, true}) {
+            // For it local forward and local reverse
+            handle_t node = local_orientation ? graph->flip(handles[i]) : handles[i];
+            
 #ifdef debug
-                    cerr << "\tHas " << seen_parents << "/" << correct_parents.size() << " required parents" << endl;
+            cerr << "Consider " << graph->get_id(node) << (graph->get_is_reverse(node) ? '-' : '+') << endl;
 #endif
-                    // If it has the correct parents, it is a member of the superfamily
-                    bool superfamily_check = !bad_parent && seen_parents == correct_parents.size();
-                    if (can_merge != nullptr) {
-                        // optional callback filter checks candidate against the super family
-                        for (auto super_it = superfamily.begin(); superfamily_check && super_it != superfamily.end(); ++super_it) {
-                            superfamily_check = can_merge(candidate, *super_it);
-                        }
-                    }
-                    if (superfamily_check) {
-                        // If it has the correct parents and passes the check callback, it is a member of the superfamily
-                        superfamily.insert(candidate);
-                        
+            
+            if (in_family.count(graph->get_id(node))) {
+                // If it is in a family in one orientation, don't find a family for it in the other orientation.
+                // We can only merge from one end of a node at a time.
 #ifdef debug
-                        cerr << "\tBelongs in superfamily" << endl;
+                cerr << "Node " << graph->get_id(node) << " is already in a family to merge" << endl;
 #endif
-                        
-                    } else {
-                        // Otherwise, it is out, so don't check it again if we find it from another parent.
-                        partial_siblings.insert(candidate);
-                        
+                
+                break;
+            }
+            // For each handle where it or its RC isn't already in a superfamily, identify its superfamily.
+            unordered_set<handle_t> superfamily;
+            
+            for (auto& candidate : sibling_candidates[2 * i + local_orientation]) {
+                // For each candidate with the right parents
+                
+                if (in_family.count(graph->get_id(candidate))) {
+                    // If it is in a family in one orientation, don't find a family for it in the other orientation.
+                    // We can only merge from one end of a node at a time.
 #ifdef debug
-                        cerr << "\tOnly a partial sibling" << endl;
+                    cerr << "\tAlready in a family to merge." << endl;
 #endif
-                        
+                    continue;
+                }
+                
+                bool superfamily_check = true;
+                if (can_merge != nullptr) {
+                    // optional callback filter checks candidate against the super family
+                    for (auto super_it = superfamily.begin(); superfamily_check && super_it != superfamily.end(); ++super_it) {
+                        superfamily_check = can_merge(candidate, *super_it);
                     }
-                });
+                }
+                if (superfamily_check) {
+                    // If it has the correct parents and passes the check callback, it is a member of the superfamily
+                    superfamily.insert(candidate);
+                    
+#ifdef debug
+                    cerr << "\tBelongs in superfamily" << endl;
+#endif
+                    
+                }
             }
+            vector<handle_t>().swap(sibling_candidates[2 * i + local_orientation]);
             
             // Now we have a family. It can't overap with any existing ones.
             
@@ -237,7 +231,7 @@ bool simplify_siblings(handlegraph::MutablePathDeletableHandleGraph* graph,
                 }
             }
         }
-    });
+    }
     
     in_family.clear();
     
@@ -23,6 +23,9 @@ using namespace std;
  *
  * Preserves paths.
  *
+ * Candidate families are found in parallel with OMP, but the merges are done
+ * serially in graph order, so the result does not depend on the thread count.
+ *
  * Optional can_merge callback will only let nodes get merged together if 
  * this pairwise check returns true. 
  */
@@ -11,6 +11,8 @@
 #include "dozeu_pinning_overlay.hpp"
 #include "algorithms/distance_to_tail.hpp"
 
+#include <deque>
+
 //#define debug_print_score_matrices
 
 namespace vg {
@@ -25,6 +27,92 @@ int32_t score_gap(size_t gap_length, int32_t gap_open, int32_t gap_extension) {
 static const double quality_scale_factor = 10.0 / log(10.0);
 static const double exp_overflow_limit = log(std::numeric_limits<double>::max());
 
+/**
+ * Per-thread scratch space for turning HandleGraphs into gssw graphs. Keeps
+ * the containers used while building each gssw graph, so they don't need to
+ * be reallocated for every alignment, and remembers the topological orders
+ * of the last few graphs, so that aligning against the same graph again
+ * (like for both mates, or for alternate alignments of a tail) doesn't need
+ * another sort.
+ *
+ * The gssw nodes themselves, and the DP matrices, are allocated by gssw, and
+ * are not kept.
+ */
+struct GSSWWorkspace {
+    /// How many topological orders do we remember?
+    static const size_t MAX_CACHED_ORDERS = 4;
+    
+    /// gssw nodes by node ID, for the graph being built.
+    unordered_map<int64_t, gssw_node*> nodes;
+    /// Buffer for the cleaned-up sequence of the node being added.
+    string sequence;
+    /// Buffer for the topological order of the graph being built.
+    vector<handle_t> topological_order;
+    
+    /// A remembered topological order, as node IDs and orientations, so it
+    /// can be applied to a different graph object with identical topology.
+    struct CachedOrder {
+        /// The signature of the graph the order is for.
+        vector<int64_t> signature;
+        vector<pair<nid_t, bool>> order;
+    };
+    /// Remembered orders, most recently used first.
+    deque<CachedOrder> cached_orders;
+    /// Buffer for the signature of the graph being built.
+    vector<int64_t> signature;
+    
+    /// Get the calling thread's workspace.
+    static GSSWWorkspace& get() {
+        thread_local GSSWWorkspace workspace;
+        return workspace;
+    }
+    
+    /// Fill in topological_order for the given graph, using a remembered
+    /// order if we have one for a graph with the same nodes and edges.
+    void find_topological_order(const HandleGraph& g) {
+        // Describe the graph exactly: all its node IDs, and then all its
+        // edges. For the same graph, both come out in the same order.
+        signature.clear();
+        g.for_each_handle([&](const handle_t& handle) {
+            signature.push_back(g.get_id(handle));
+        });
+        signature.push_back(0);
+        g.for_each_edge([&](const edge_t& edge) {
+            signature.push_back(g.get_id(edge.first) * 2 + g.get_is_reverse(edge.first));
+            signature.push_back(g.get_id(edge.second) * 2 + g.get_is_reverse(edge.second));
+        });
+        
+        topological_order.clear();
+        for (auto it = cached_orders.begin(); it != cached_orders.end(); ++it) {
+            if (it->signature == signature) {
+                // We've sorted this graph before.
+                for (auto& visit : it->order) {
+                    topological_order.push_back(g.get_handle(visit.first, visit.second));
+                }
+                if (it != cached_orders.begin()) {
+                    // Move it to the front so it stays around.
+                    CachedOrder found = std::move(*it);
+                    cached_orders.erase(it);
+                    cached_orders.emplace_front(std::move(found));
+                }
+                return;
+            }
+        }
+        
+        // Otherwise we need to sort it, and remember the result.
+        topological_order = handlealgs::lazier_topological_order(&g);
+        if (cached_orders.size() >= MAX_CACHED_ORDERS) {
+            cached_orders.pop_back();
+        }
+        cached_orders.emplace_front();
+        cached_orders.front().signature = signature;
+        cached_orders.front().order.reserve(topological_order.size());
+        for (auto& handle : topological_order) {
+            cached_orders.front().order.emplace_back(g.get_id(handle), g.get_is_reverse(handle));
+        }
+    }
+};
+
 GSSWAligner::~GSSWAligner(void) {
     free(nt_table);
     free(score_matrix);
@@ -52,14 +140,25 @@ GSSWAligner::GSSWAligner(const int8_t* _score_matrix,
 
 gssw_graph* GSSWAligner::create_gssw_graph(const HandleGraph& g) const {
     
-    vector<handle_t> topological_order = handlealgs::lazier_topological_order(&g);
+    // Reuse this thread's buffers
+    GSSWWorkspace& workspace = GSSWWorkspace::get();
+    
+    // compute the topological order
+    workspace.find_topological_order(g);
+    const vector<handle_t>& topological_order = workspace.topological_order;
     
     gssw_graph* graph = gssw_graph_create(g.get_node_count());
-    unordered_map<int64_t, gssw_node*> nodes;
+    unordered_map<int64_t, gssw_node*>& nodes = workspace.nodes;
+    nodes.clear();
     
-    // compute the topological order
     for (const handle_t& handle : topological_order) {
-        auto cleaned_seq = nonATGCNtoN(g.get_sequence(handle));
+        string& cleaned_seq = workspace.sequence;
+        cleaned_seq = g.get_sequence(handle);
+        for (char& b : cleaned_seq) {
+            if (b != 'A' && b != 'T' && b != 'G' && b != 'C' && b != 'N') {
+                b = 'N';
+            }
+        }
         gssw_node* node = gssw_node_create(nullptr,       // TODO: the ID should be enough, don't need Node* too
                                            g.get_id(handle),
                                            cleaned_seq.c_str(),
@@ -1420,16 +1519,66 @@ void Aligner::align_pinned_multi(Alignment& alignment, vector<Alignment>& alt_al
     align_internal(alignment, &alt_alignments, g, true, pin_left, max_alt_alns, true);
 }
 
-void Aligner::align_global_banded(Alignment& alignment, const HandleGraph& g,
-                                  int32_t band_padding, bool permissive_banding,
-                                  const unordered_map<handle_t, bool>* left_align_strand) const {
+void Aligner::align_pinned_batch(const vector<PinnedAlignmentProblem>& problems) const {
     
-    if (alignment.sequence().empty()) {
-        // we can save time by using a specialized deletion aligner for empty strings
-        deletion_aligner.align(alignment, g);
-        return;
+    BatchedPinnedAligner batched_aligner(score_matrix, nt_table, gap_open, gap_extension, full_length_bonus);
+    vector<bool> aligned = batched_aligner.align(problems);
+    
+    // fall back on GSSW for anything the batched aligner couldn't do
+    for (size_t i = 0; i < problems.size(); ++i) {
+        if (!aligned[i]) {
+            align_pinned(*problems[i].alignment, *problems[i].graph, problems[i].pin_left, false);
+        }
+    }
+}
+
+/// Do banded global alignment with IntType scores. If the scores are known to fit, always
+/// succeeds. Otherwise, checks for overflow, and returns false without aligning if the scores
+/// might not have fit. If score_out is given, only computes the optimal score and stores it
+/// there, without doing the traceback.
+template<class IntType>
+static bool align_global_banded_with(Alignment& alignment, vector<Alignment>* alt_alignments, int32_t max_alt_alns,
+                                     const HandleGraph& g, int32_t band_padding, bool permissive_banding,
+                                     bool adjust_for_base_quality, const unordered_map<handle_t, bool>* left_align_strand,
+                                     int8_t* score_matrix, int8_t* nt_table, int8_t gap_open, int8_t gap_extension,
+                                     bool known_to_fit, int32_t* score_out = nullptr) {
+    unique_ptr<BandedGlobalAligner<IntType>> band_graph;
+    if (alt_alignments) {
+        band_graph.reset(new BandedGlobalAligner<IntType>(alignment, g, *alt_alignments, max_alt_alns, band_padding,
+                                                          permissive_banding, adjust_for_base_quality,
+                                                          left_align_strand));
+    }
+    else {
+        band_graph.reset(new BandedGlobalAligner<IntType>(alignment, g, band_padding, permissive_banding,
+                                                          adjust_for_base_quality, left_align_strand));
+    }
+    
+    if (score_out) {
+        if (known_to_fit) {
+            *score_out = band_graph->score(score_matrix, nt_table, gap_open, gap_extension);
+            return true;
+        }
+        return band_graph->score_checking_overflow(score_matrix, nt_table, gap_open, gap_extension, *score_out);
     }
     
+    if (known_to_fit) {
+        band_graph->align(score_matrix, nt_table, gap_open, gap_extension);
+        return true;
+    }
+    return band_graph->align_checking_overflow(score_matrix, nt_table, gap_open, gap_extension);
+}
+
+/// Do banded global alignment as align_global_banded() and align_global_banded_multi() do, with
+/// the narrowest integer type that works. The worst case bounds on the scores hold for any band,
+/// so they choose a wide type for most problems. Instead, we start with the narrowest type that the
+/// best score fits in, and move on to a wider one only if the DP comes too close to overflowing.
+/// If score_out is given, only computes the optimal score, as align_global_banded_with() does.
+static void align_global_banded_adaptive(Alignment& alignment, vector<Alignment>* alt_alignments, int32_t max_alt_alns,
+                                         const HandleGraph& g, int32_t band_padding, bool permissive_banding,
+                                         bool adjust_for_base_quality, const unordered_map<handle_t, bool>* left_align_strand,
+                                         int8_t* score_matrix, int8_t* nt_table, int8_t gap_open, int8_t gap_extension,
+                                         int32_t match, int32_t mismatch, int32_t* score_out = nullptr) {
+    
     // We need to figure out what size ints we need to use.
     // Get upper and lower bounds on the scores. TODO: if these overflow int64 we're out of luck
     int64_t best_score = alignment.sequence().size() * match;
@@ -1437,51 +1586,47 @@ void Aligner::align_global_banded(Alignment& alignment, const HandleGraph& g,
     g.for_each_handle([&](const handle_t& handle) {
         total_bases += g.get_length(handle);
     });
-    int64_t worst_score = (alignment.sequence().size() + total_bases) * -max(max(mismatch, gap_open), gap_extension);
-    
-    // TODO: put this all into another template somehow?
-    
-    if (best_score <= numeric_limits<int8_t>::max() && worst_score >= numeric_limits<int8_t>::min()) {
-        // We'll fit in int8
-        BandedGlobalAligner<int8_t> band_graph(alignment,
-                                               g,
-                                               band_padding,
-                                               permissive_banding,
-                                               false,
-                                               left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else if (best_score <= numeric_limits<int16_t>::max() && worst_score >= numeric_limits<int16_t>::min()) {
-        // We'll fit in int16
-        BandedGlobalAligner<int16_t> band_graph(alignment,
-                                                g,
-                                                band_padding,
-                                                permissive_banding,
-                                                false,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else if (best_score <= numeric_limits<int32_t>::max() && worst_score >= numeric_limits<int32_t>::min()) {
-        // We'll fit in int32
-        BandedGlobalAligner<int32_t> band_graph(alignment,
-                                                g,
-                                                band_padding,
-                                                permissive_banding,
-                                                false,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else {
-        // Fall back to int64
-        BandedGlobalAligner<int64_t> band_graph(alignment,
-                                                g,
-                                                band_padding,
-                                                permissive_banding,
-                                                false,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
+    int64_t worst_score = (alignment.sequence().size() + total_bases) * -max<int64_t>(max<int64_t>(mismatch, gap_open), gap_extension);
+    
+    if (best_score <= numeric_limits<int8_t>::max() &&
+        align_global_banded_with<int8_t>(alignment, alt_alignments, max_alt_alns, g, band_padding, permissive_banding,
+                                         adjust_for_base_quality, left_align_strand, score_matrix, nt_table,
+                                         gap_open, gap_extension, worst_score >= numeric_limits<int8_t>::min(),
+                                         score_out)) {
+        return;
+    }
+    if (best_score <= numeric_limits<int16_t>::max() &&
+        align_global_banded_with<int16_t>(alignment, alt_alignments, max_alt_alns, g, band_padding, permissive_banding,
+                                          adjust_for_base_quality, left_align_strand, score_matrix, nt_table,
+                                          gap_open, gap_extension, worst_score >= numeric_limits<int16_t>::min(),
+                                          score_out)) {
+        return;
     }
+    if (best_score <= numeric_limits<int32_t>::max() &&
+        align_global_banded_with<int32_t>(alignment, alt_alignments, max_alt_alns, g, band_padding, permissive_banding,
+                                          adjust_for_base_quality, left_align_strand, score_matrix, nt_table,
+                                          gap_open, gap_extension, worst_score >= numeric_limits<int32_t>::min(),
+                                          score_out)) {
+        return;
+    }
+    // Fall back to int64
+    align_global_banded_with<int64_t>(alignment, alt_alignments, max_alt_alns, g, band_padding, permissive_banding,
+                                      adjust_for_base_quality, left_align_strand, score_matrix, nt_table,
+                                      gap_open, gap_extension, true, score_out);
+}
+
+void Aligner::align_global_banded(Alignment& alignment, const HandleGraph& g,
+                                  int32_t band_padding, bool permissive_banding,
+                                  const unordered_map<handle_t, bool>* left_align_strand) const {
+    
+    if (alignment.sequence().empty()) {
+        // we can save time by using a specialized deletion aligner for empty strings
+        deletion_aligner.align(alignment, g);
+        return;
+    }
+    
+    align_global_banded_adaptive(alignment, nullptr, 0, g, band_padding, permissive_banding, false, left_align_strand,
+                                 score_matrix, nt_table, gap_open, gap_extension, match, mismatch);
 }
 
 void Aligner::align_global_banded_multi(Alignment& alignment, vector<Alignment>& alt_alignments, const HandleGraph& g,
@@ -1494,64 +1639,28 @@ void Aligner::align_global_banded_multi(Alignment& alignment, vector<Alignment>&
         return;
     }
     
-    // We need to figure out what size ints we need to use.
-    // Get upper and lower bounds on the scores. TODO: if these overflow int64 we're out of luck
-    int64_t best_score = alignment.sequence().size() * match;
-    size_t total_bases = 0;
-    g.for_each_handle([&](const handle_t& handle) {
-        total_bases += g.get_length(handle);
-    });
-    int64_t worst_score = (alignment.sequence().size() + total_bases) * -max(max(mismatch, gap_open), gap_extension);
-    
-    if (best_score <= numeric_limits<int8_t>::max() && worst_score >= numeric_limits<int8_t>::min()) {
-        // We'll fit in int8
-        BandedGlobalAligner<int8_t> band_graph(alignment,
-                                               g,
-                                               alt_alignments,
-                                               max_alt_alns,
-                                               band_padding,
-                                               permissive_banding,
-                                               false,
-                                               left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else if (best_score <= numeric_limits<int16_t>::max() && worst_score >= numeric_limits<int16_t>::min()) {
-        // We'll fit in int16
-        BandedGlobalAligner<int16_t> band_graph(alignment,
-                                                g,
-                                                alt_alignments,
-                                                max_alt_alns,
-                                                band_padding,
-                                                permissive_banding,
-                                                false,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else if (best_score <= numeric_limits<int32_t>::max() && worst_score >= numeric_limits<int32_t>::min()) {
-        // We'll fit in int32
-        BandedGlobalAligner<int32_t> band_graph(alignment,
-                                                g,
-                                                alt_alignments,
-                                                max_alt_alns,
-                                                band_padding,
-                                                permissive_banding,
-                                                false,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else {
-        // Fall back to int64
-        BandedGlobalAligner<int64_t> band_graph(alignment,
-                                                g,
-                                                alt_alignments,
-                                                max_alt_alns,
-                                                band_padding,
-                                                permissive_banding,
-                                                false,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
+    align_global_banded_adaptive(alignment, &alt_alignments, max_alt_alns, g, band_padding, permissive_banding, false,
+                                 left_align_strand, score_matrix, nt_table, gap_open, gap_extension, match, mismatch);
+}
+
+int32_t Aligner::score_global_banded(const Alignment& alignment, const HandleGraph& g,
+                                    int32_t band_padding, bool permissive_banding,
+                                    const unordered_map<handle_t, bool>* left_align_strand) const {
+    
+    // the banded aligner writes into the alignment it's given, so work on a scratch copy
+    Alignment scratch;
+    scratch.set_sequence(alignment.sequence());
+    scratch.set_quality(alignment.quality());
+    
+    if (scratch.sequence().empty()) {
+        deletion_aligner.align(scratch, g);
+        return scratch.score();
     }
+    
+    int32_t score;
+    align_global_banded_adaptive(scratch, nullptr, 0, g, band_padding, permissive_banding, false, left_align_strand,
+                                 score_matrix, nt_table, gap_open, gap_extension, match, mismatch, &score);
+    return score;
 }
 
 void Aligner::align_xdrop(Alignment& alignment, const HandleGraph& g, const vector<MaximalExactMatch>& mems,
@@ -2104,6 +2213,20 @@ void QualAdjAligner::align_pinned_multi(Alignment& alignment, vector<Alignment>&
     align_internal(alignment, &alt_alignments, g, true, pin_left, max_alt_alns, true);
 }
 
+void QualAdjAligner::align_pinned_batch(const vector<PinnedAlignmentProblem>& problems) const {
+    
+    BatchedPinnedAligner batched_aligner(score_matrix, nt_table, gap_open, gap_extension, full_length_bonus,
+                                         qual_adj_full_length_bonuses);
+    vector<bool> aligned = batched_aligner.align(problems);
+    
+    // fall back on GSSW for anything the batched aligner couldn't do
+    for (size_t i = 0; i < problems.size(); ++i) {
+        if (!aligned[i]) {
+            align_pinned(*problems[i].alignment, *problems[i].graph, problems[i].pin_left, false);
+        }
+    }
+}
+
 void QualAdjAligner::align_global_banded(Alignment& alignment, const HandleGraph& g,
                                          int32_t band_padding, bool permissive_banding,
                                          const unordered_map<handle_t, bool>* left_align_strand) const {
@@ -2114,56 +2237,8 @@ void QualAdjAligner::align_global_banded(Alignment& alignment, const HandleGraph
         return;
     }
     
-    int64_t best_score = alignment.sequence().size() * match;
-    size_t total_bases = 0;
-    g.for_each_handle([&](const handle_t& handle) {
-        total_bases += g.get_length(handle);
-    });
-    int64_t worst_score = (alignment.sequence().size() + total_bases) * -max(max(mismatch, gap_open), gap_extension);
-    
-    // TODO: put this all into another template somehow?
-    
-    if (best_score <= numeric_limits<int8_t>::max() && worst_score >= numeric_limits<int8_t>::min()) {
-        // We'll fit in int8
-        BandedGlobalAligner<int8_t> band_graph(alignment,
-                                               g,
-                                               band_padding,
-                                               permissive_banding,
-                                               true,
-                                               left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else if (best_score <= numeric_limits<int16_t>::max() && worst_score >= numeric_limits<int16_t>::min()) {
-        // We'll fit in int16
-        BandedGlobalAligner<int16_t> band_graph(alignment,
-                                                g,
-                                                band_padding,
-                                                permissive_banding,
-                                                true,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else if (best_score <= numeric_limits<int32_t>::max() && worst_score >= numeric_limits<int32_t>::min()) {
-        // We'll fit in int32
-        BandedGlobalAligner<int32_t> band_graph(alignment,
-                                                g,
-                                                band_padding,
-                                                permissive_banding,
-                                                true,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else {
-        // Fall back to int64
-        BandedGlobalAligner<int64_t> band_graph(alignment,
-                                                g,
-                                                band_padding,
-                                                permissive_banding,
-                                                true,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    }
+    align_global_banded_adaptive(alignment, nullptr, 0, g, band_padding, permissive_banding, true, left_align_strand,
+                                 score_matrix, nt_table, gap_open, gap_extension, match, mismatch);
 }
 
 void QualAdjAligner::align_global_banded_multi(Alignment& alignment, vector<Alignment>& alt_alignments, const HandleGraph& g,
@@ -2176,64 +2251,28 @@ void QualAdjAligner::align_global_banded_multi(Alignment& alignment, vector<Alig
         return;
     }
     
-    // We need to figure out what size ints we need to use.
-    // Get upper and lower bounds on the scores. TODO: if these overflow int64 we're out of luck
-    int64_t best_score = alignment.sequence().size() * match;
-    size_t total_bases = 0;
-    g.for_each_handle([&](const handle_t& handle) {
-        total_bases += g.get_length(handle);
-    });
-    int64_t worst_score = (alignment.sequence().size() + total_bases) * -max(max(mismatch, gap_open), gap_extension);
-    
-    if (best_score <= numeric_limits<int8_t>::max() && worst_score >= numeric_limits<int8_t>::min()) {
-        // We'll fit in int8
-        BandedGlobalAligner<int8_t> band_graph(alignment,
-                                               g,
-                                               alt_alignments,
-                                               max_alt_alns,
-                                               band_padding,
-                                               permissive_banding,
-                                               true,
-                                               left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else if (best_score <= numeric_limits<int16_t>::max() && worst_score >= numeric_limits<int16_t>::min()) {
-        // We'll fit in int16
-        BandedGlobalAligner<int16_t> band_graph(alignment,
-                                                g,
-                                                alt_alignments,
-                                                max_alt_alns,
-                                                band_padding,
-                                                permissive_banding,
-                                                true,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else if (best_score <= numeric_limits<int32_t>::max() && worst_score >= numeric_limits<int32_t>::min()) {
-        // We'll fit in int32
-        BandedGlobalAligner<int32_t> band_graph(alignment,
-                                                g,
-                                                alt_alignments,
-                                                max_alt_alns,
-                                                band_padding,
-                                                permissive_banding,
-                                                true,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
-    } else {
-        // Fall back to int64
-        BandedGlobalAligner<int64_t> band_graph(alignment,
-                                                g,
-                                                alt_alignments,
-                                                max_alt_alns,
-                                                band_padding,
-                                                permissive_banding,
-                                                true,
-                                                left_align_strand);
-        
-        band_graph.align(score_matrix, nt_table, gap_open, gap_extension);
+    align_global_banded_adaptive(alignment, &alt_alignments, max_alt_alns, g, band_padding, permissive_banding, true,
+                                 left_align_strand, score_matrix, nt_table, gap_open, gap_extension, match, mismatch);
+}
+
+int32_t QualAdjAligner::score_global_banded(const Alignment& alignment, const HandleGraph& g,
+                                           int32_t band_padding, bool permissive_banding,
+                                           const unordered_map<handle_t, bool>* left_align_strand) const {
+    
+    // the banded aligner writes into the alignment it's given, so work on a scratch copy
+    Alignment scratch;
+    scratch.set_sequence(alignment.sequence());
+    scratch.set_quality(alignment.quality());
+    
+    if (scratch.sequence().empty()) {
+        deletion_aligner.align(scratch, g);
+        return scratch.score();
     }
+    
+    int32_t score;
+    align_global_banded_adaptive(scratch, nullptr, 0, g, band_padding, permissive_banding, true, left_align_strand,
+                                 score_matrix, nt_table, gap_open, gap_extension, match, mismatch, &score);
+    return score;
 }
 
 void QualAdjAligner::align_xdrop(Alignment& alignment, const HandleGraph& g, const vector<MaximalExactMatch>& mems,
@@ -17,6 +17,7 @@
 #include "path.hpp"
 #include "dozeu_interface.hpp"
 #include "deletion_aligner.hpp"
+#include "batched_pinned_aligner.hpp"
 
 // #define BENCH
 // #include "bench.h"
@@ -149,6 +150,11 @@ namespace vg {
         virtual void align_pinned_multi(Alignment& alignment, vector<Alignment>& alt_alignments, const HandleGraph& g,
                                         bool pin_left, int32_t max_alt_alns) const = 0;
         
+        /// store optimal pinned alignments for a batch of alignments, each against its own graph. gives
+        /// the same scores as align_pinned without xdrop, but does short alignments against small graphs,
+        /// like read tails, several at a time.
+        virtual void align_pinned_batch(const vector<PinnedAlignmentProblem>& problems) const = 0;
+        
         /// store optimal global alignment against a graph within a specified band in the Alignment object
         /// permissive banding auto detects the width of band needed so that paths can travel
         /// through every node in the graph
@@ -164,6 +170,12 @@ namespace vg {
                                                const HandleGraph& g, int32_t max_alt_alns, int32_t band_padding = 0,
                                                bool permissive_banding = true,
                                                const unordered_map<handle_t, bool>* left_align_strand = nullptr) const = 0;
+        
+        /// compute the score of the optimal banded global alignment, as align_global_banded() would
+        /// find it, without doing the traceback. the alignment itself is not modified
+        virtual int32_t score_global_banded(const Alignment& alignment, const HandleGraph& g,
+                                            int32_t band_padding = 0, bool permissive_banding = true,
+                                            const unordered_map<handle_t, bool>* left_align_strand = nullptr) const = 0;
         /// xdrop aligner
         virtual void align_xdrop(Alignment& alignment, const HandleGraph& g, const vector<MaximalExactMatch>& mems,
                                  bool reverse_complemented, uint16_t max_gap_length = default_xdrop_max_gap_length) const = 0;
@@ -356,6 +368,11 @@ namespace vg {
         void align_pinned_multi(Alignment& alignment, vector<Alignment>& alt_alignments, const HandleGraph& g,
                                 bool pin_left, int32_t max_alt_alns) const;
         
+        /// store optimal pinned alignments for a batch of alignments, each against its own graph. gives
+        /// the same scores as align_pinned without xdrop, but does short alignments against small graphs,
+        /// like read tails, several at a time.
+        void align_pinned_batch(const vector<PinnedAlignmentProblem>& problems) const;
+        
         /// store optimal global alignment against a graph within a specified band in the Alignment object
         /// permissive banding auto detects the width of band needed so that paths can travel
         /// through every node in the graph
@@ -370,6 +387,11 @@ namespace vg {
         void align_global_banded_multi(Alignment& alignment, vector<Alignment>& alt_alignments, const HandleGraph& g,
                                        int32_t max_alt_alns, int32_t band_padding = 0, bool permissive_banding = true,
                                        const unordered_map<handle_t, bool>* left_align_strand = nullptr) const;
+        
+        /// compute the score of the optimal banded global alignment without doing the traceback
+        int32_t score_global_banded(const Alignment& alignment, const HandleGraph& g,
+                                    int32_t band_padding = 0, bool permissive_banding = true,
+                                    const unordered_map<handle_t, bool>* left_align_strand = nullptr) const;
 
         /// xdrop aligner
         void align_xdrop(Alignment& alignment, const HandleGraph& g, const vector<MaximalExactMatch>& mems,
@@ -439,8 +461,12 @@ namespace vg {
         void align_global_banded_multi(Alignment& alignment, vector<Alignment>& alt_alignments, const HandleGraph& g,
                                        int32_t max_alt_alns, int32_t band_padding = 0, bool permissive_banding = true,
                                        const unordered_map<handle_t, bool>* left_align_strand = nullptr) const;
+        int32_t score_global_banded(const Alignment& alignment, const HandleGraph& g,
+                                    int32_t band_padding = 0, bool permissive_banding = true,
+                                    const unordered_map<handle_t, bool>* left_align_strand = nullptr) const;
         void align_pinned_multi(Alignment& alignment, vector<Alignment>& alt_alignments, const HandleGraph& g,
                                 bool pin_left, int32_t max_alt_alns) const;
+        void align_pinned_batch(const vector<PinnedAlignmentProblem>& problems) const;
                                 
         void align_xdrop(Alignment& alignment, const HandleGraph& g, const vector<MaximalExactMatch>& mems,
                          bool reverse_complemented, uint16_t max_gap_length = default_xdrop_max_gap_length) const;
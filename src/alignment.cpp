@@ -1,6 +1,8 @@
 #include "alignment.hpp"
 #include "vg/io/gafkluge.hpp"
 #include "annotation.hpp"
+#include "fastq_reader.hpp"
+#include "work_stealing_scheduler.hpp"
 
 #include <sstream>
 
@@ -45,9 +47,20 @@ int hts_for_each_parallel(string& filename, function<void(Alignment&)> lambda,
     parse_tid_path_handle_map(hdr, graph, tid_path_handle);
 
     int thread_count = get_thread_count();
-    vector<bam1_t*> bs; bs.resize(thread_count);
-    for (auto& b : bs) {
-        b = bam_init1();
+    
+    // Let htslib decompress BGZF blocks on its own threads, so that one
+    // thread doing the reading can keep up with the conversion.
+    if (thread_count > 1 && hts_set_threads(in, thread_count) != 0) {
+        cerr << "[vg::alignment] warning: could not use multiple threads to decompress " << filename << endl;
+    }
+    
+    // Each thread takes a batch of records at a time, so it doesn't wait for
+    // the input for every record.
+    vector<vector<bam1_t*>> bs(thread_count, vector<bam1_t*>(HTS_READ_BATCH_SIZE));
+    for (auto& batch : bs) {
+        for (auto& b : batch) {
+            b = bam_init1();
+        }
     }
 
     bool more_data = true;
@@ -55,25 +68,34 @@ int hts_for_each_parallel(string& filename, function<void(Alignment&)> lambda,
     {
         int tid = omp_get_thread_num();
         while (more_data) {
-            bam1_t* b = bs[tid];
-            // We need to track our own read operation's success separate from
+            vector<bam1_t*>& batch = bs[tid];
+            // We need to track our own read operations' success separate from
             // the global flag, or someone else encountering EOF will cause us
-            // to drop our read on the floor.
-            bool got_read = false;
+            // to drop our reads on the floor.
+            size_t got_reads = 0;
 #pragma omp critical (hts_input)
-            if (more_data) {
-                got_read = sam_read1(in, hdr, b) >= 0;
-                more_data &= got_read;
+            {
+                while (more_data && got_reads < batch.size()) {
+                    if (sam_read1(in, hdr, batch[got_reads]) >= 0) {
+                        ++got_reads;
+                    } else {
+                        more_data = false;
+                    }
+                }
             }
             // Now we're outside the critical section so we can only rely on our own variables.
-            if (got_read) {
-                Alignment a = bam_to_alignment(b, rg_sample, tid_path_handle, hdr, graph);
+            for (size_t i = 0; i < got_reads; ++i) {
+                Alignment a = bam_to_alignment(batch[i], rg_sample, tid_path_handle, hdr, graph);
                 lambda(a);
             }
         }
     }
 
-    for (auto& b : bs) bam_destroy1(b);
+    for (auto& batch : bs) {
+        for (auto& b : batch) {
+            bam_destroy1(b);
+        }
+    }
     bam_hdr_destroy(hdr);
     hts_close(in);
     return 1;
@@ -128,32 +150,41 @@ bam_hdr_t* hts_string_header(string& header,
     return h;
 }
 
+void fastq_quality_char_to_short_in_place(string& quality) {
+    for (char& c : quality) {
+        c = c - 33;
+    }
+}
+
 bool get_next_alignment_from_fastq(gzFile fp, char* buffer, size_t len, Alignment& alignment) {
 
+    // Clearing keeps the memory already allocated for the strings, so we fill
+    // them in place and reuse it from record to record.
     alignment.Clear();
     bool is_fasta = false;
     // handle name
-    string name;
+    string& name = *alignment.mutable_name();
     if (gzgets(fp,buffer,len) != 0) {
-        buffer[strlen(buffer)-1] = '\0';
-        name = buffer;
-        if (name[0] == '@') {
+        size_t size_read = strlen(buffer) - 1;
+        if (buffer[0] == '@') {
             is_fasta = false;
-        } else if (name[0] == '>') {
+        } else if (buffer[0] == '>') {
             is_fasta = true;
         } else {
-            throw runtime_error("Found unexpected delimiter " + name.substr(0,1) + " in fastq/fasta input");
+            throw runtime_error("Found unexpected delimiter " + string(buffer, std::min<size_t>(size_read, 1)) + " in fastq/fasta input");
         }
-        name = name.substr(1, name.find(' ') - 1); // trim off leading @ and things after the first whitespace
+        // trim off leading @ and things after the first whitespace
         // keep trailing /1 /2
-        alignment.set_name(name);
+        const char* name_start = buffer + 1;
+        const char* name_end = (const char*) memchr(name_start, ' ', size_read - 1);
+        name.assign(name_start, name_end ? name_end : buffer + size_read);
     }
     else {
         // no more to get
         return false;
     }
     // handle sequence
-    string sequence;
+    string& sequence = *alignment.mutable_sequence();
     bool reading_sequence = true;
     while (reading_sequence) {
         if (gzgets(fp,buffer,len) == 0) {
@@ -195,7 +226,6 @@ bool get_next_alignment_from_fastq(gzFile fp, char* buffer, size_t len, Alignmen
         }
         sequence.append(buffer, size_read);
     }
-    alignment.set_sequence(sequence);
     // handle "+" sep
     if (!is_fasta) {
         if (0!=gzgets(fp,buffer,len)) {
@@ -204,10 +234,9 @@ bool get_next_alignment_from_fastq(gzFile fp, char* buffer, size_t len, Alignmen
         }
         // handle quality
         if (0!=gzgets(fp,buffer,len)) {
-            buffer[strlen(buffer)-1] = '\0';
-            string quality = string_quality_char_to_short(buffer);
-            //cerr << string_quality_short_to_char(quality) << endl;
-            alignment.set_quality(quality);
+            string& quality = *alignment.mutable_quality();
+            quality.assign(buffer, strlen(buffer) - 1);
+            fastq_quality_char_to_short_in_place(quality);
         } else {
             cerr << "[vg::alignment.cpp] error: fastq record missing base quality " << name << endl; exit(1);
         }
@@ -225,29 +254,109 @@ bool get_next_alignment_pair_from_fastqs(gzFile fp1, gzFile fp2, char* buffer, s
     return get_next_alignment_from_fastq(fp1, buffer, len, mate1) && get_next_alignment_from_fastq(fp2, buffer, len, mate2);
 }
 
+/// A read pair whose reads are both allocated in a batch's Arena, and its
+/// number in the input
+struct ArenaMates {
+    Alignment* first;
+    Alignment* second;
+    size_t number;
+};
+
+template<>
+struct ArenaItem<ArenaMates> {
+    static ArenaMates* create(google::protobuf::Arena* arena) {
+        ArenaMates* mates = google::protobuf::Arena::Create<ArenaMates>(arena);
+        mates->first = google::protobuf::Arena::CreateMessage<Alignment>(arena);
+        mates->second = google::protobuf::Arena::CreateMessage<Alignment>(arena);
+        return mates;
+    }
+};
+
+/// A read allocated in a batch's Arena, and its number in the input
+struct ArenaNumberedRead {
+    Alignment* read;
+    size_t number;
+};
+
+template<>
+struct ArenaItem<ArenaNumberedRead> {
+    static ArenaNumberedRead* create(google::protobuf::Arena* arena) {
+        ArenaNumberedRead* numbered = google::protobuf::Arena::Create<ArenaNumberedRead>(arena);
+        numbered->read = google::protobuf::Arena::CreateMessage<Alignment>(arena);
+        return numbered;
+    }
+};
+
+/// Run lambda on all the read pairs from get_pair, letting idle threads take
+/// pairs from batches other threads are stuck on. Returns the number of pairs.
+static size_t paired_for_each_parallel_stealing(const function<bool(Alignment&, Alignment&)>& get_pair,
+                                                const function<void(Alignment&, Alignment&, size_t)>& lambda,
+                                                const function<bool(void)>& single_threaded_until_true,
+                                                const function<void(size_t)>& before_read,
+                                                uint64_t batch_size) {
+    WorkStealingScheduler<ArenaMates> scheduler(batch_size);
+    size_t next_number = 0;
+    return scheduler.run([&](ArenaMates& mates) {
+        if (before_read) {
+            before_read(next_number);
+        }
+        mates.number = next_number++;
+        return get_pair(*mates.first, *mates.second);
+    }, [&](ArenaMates& mates) {
+        lambda(*mates.first, *mates.second, mates.number);
+    }, single_threaded_until_true);
+}
+
+static size_t paired_for_each_parallel_stealing(const function<bool(Alignment&, Alignment&)>& get_pair,
+                                                const function<void(Alignment&, Alignment&)>& lambda,
+                                                const function<bool(void)>& single_threaded_until_true,
+                                                uint64_t batch_size) {
+    WorkStealingScheduler<ArenaMates> scheduler(batch_size);
+    return scheduler.run([&](ArenaMates& mates) {
+        return get_pair(*mates.first, *mates.second);
+    }, [&](ArenaMates& mates) {
+        lambda(*mates.first, *mates.second);
+    }, single_threaded_until_true);
+}
+
 size_t fastq_unpaired_for_each_parallel(const string& filename, function<void(Alignment&)> lambda, uint64_t batch_size) {
     
-    gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp) {
-        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
-    }
-    
-    size_t len = 2 << 22; // 4M
-    char* buf = new char[len];
+    // Decompress and parse on background threads, so the threads mapping
+    // reads never wait on input.
+    FastqReader reader(filename, FastqReader::default_decompression_threads(omp_get_max_threads()));
     
     function<bool(Alignment&)> get_read = [&](Alignment& aln) {
-        return get_next_alignment_from_fastq(fp, buf, len, aln);;
+        return reader.next(aln);
     };
     
+    // Let idle threads take reads from batches other threads are stuck on.
+    WorkStealingScheduler<Alignment> scheduler(batch_size);
+    size_t nLines = scheduler.run(get_read, lambda);
     
-    size_t nLines = unpaired_for_each_parallel(get_read, lambda, batch_size);
-    
-    delete[] buf;
-    gzclose(fp);
     return nLines;
     
 }
 
+size_t fastq_unpaired_for_each_parallel_numbered(const string& filename, function<void(Alignment&, size_t)> lambda,
+                                                 function<void(size_t)> before_read, uint64_t batch_size) {
+    
+    FastqReader reader(filename, FastqReader::default_decompression_threads(omp_get_max_threads()));
+    
+    size_t next_number = 0;
+    function<bool(ArenaNumberedRead&)> get_read = [&](ArenaNumberedRead& numbered) {
+        if (before_read) {
+            before_read(next_number);
+        }
+        numbered.number = next_number++;
+        return reader.next(*numbered.read);
+    };
+    
+    WorkStealingScheduler<ArenaNumberedRead> scheduler(batch_size);
+    return scheduler.run(get_read, [&](ArenaNumberedRead& numbered) {
+        lambda(*numbered.read, numbered.number);
+    });
+}
+
 size_t fastq_paired_interleaved_for_each_parallel(const string& filename, function<void(Alignment&, Alignment&)> lambda, uint64_t batch_size) {
     return fastq_paired_interleaved_for_each_parallel_after_wait(filename, lambda, [](void) {return true;}, batch_size);
 }
@@ -261,22 +370,16 @@ size_t fastq_paired_interleaved_for_each_parallel_after_wait(const string& filen
                                                              function<bool(void)> single_threaded_until_true,
                                                              uint64_t batch_size) {
     
-    gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp) {
-        cerr << "[vg::alignment.cpp] couldn't open " << filename << endl; exit(1);
-    }
-    
-    size_t len = 1 << 18; // 256k
-    char* buf = new char[len];
+    // Decompress and parse on background threads, so the threads mapping
+    // reads never wait on input.
+    FastqReader reader(filename, FastqReader::default_decompression_threads(omp_get_max_threads()));
     
     function<bool(Alignment&, Alignment&)> get_pair = [&](Alignment& mate1, Alignment& mate2) {
-        return get_next_interleaved_alignment_pair_from_fastq(fp, buf, len, mate1, mate2);
+        return reader.next(mate1) && reader.next(mate2);
     };
     
-    size_t nLines = paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true, batch_size);
+    size_t nLines = paired_for_each_parallel_stealing(get_pair, lambda, single_threaded_until_true, batch_size);
     
-    delete[] buf;
-    gzclose(fp);
     return nLines;
 }
     
@@ -285,30 +388,52 @@ size_t fastq_paired_two_files_for_each_parallel_after_wait(const string& file1,
                                                            function<bool(void)> single_threaded_until_true,
                                                            uint64_t batch_size) {
     
-    gzFile fp1 = (file1 != "-") ? gzopen(file1.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp1) {
-        cerr << "[vg::alignment.cpp] couldn't open " << file1 << endl; exit(1);
-    }
-    gzFile fp2 = (file2 != "-") ? gzopen(file2.c_str(), "r") : gzdopen(fileno(stdin), "r");
-    if (!fp2) {
-        cerr << "[vg::alignment.cpp] couldn't open " << file2 << endl; exit(1);
-    }
-    
-    size_t len = 1 << 18; // 256k
-    char* buf = new char[len];
+    // Each file gets its own parser thread.
+    size_t decompression_threads = FastqReader::default_decompression_threads(omp_get_max_threads());
+    FastqReader reader1(file1, decompression_threads);
+    FastqReader reader2(file2, decompression_threads);
     
     function<bool(Alignment&, Alignment&)> get_pair = [&](Alignment& mate1, Alignment& mate2) {
-        return get_next_alignment_pair_from_fastqs(fp1, fp2, buf, len, mate1, mate2);
+        return reader1.next(mate1) && reader2.next(mate2);
     };
     
-    size_t nLines = paired_for_each_parallel_after_wait(get_pair, lambda, single_threaded_until_true, batch_size);
+    size_t nLines = paired_for_each_parallel_stealing(get_pair, lambda, single_threaded_until_true, batch_size);
     
-    delete[] buf;
-    gzclose(fp1);
-    gzclose(fp2);
     return nLines;
 }
 
+size_t fastq_paired_interleaved_for_each_parallel_after_wait_numbered(const string& filename,
+                                                                      function<void(Alignment&, Alignment&, size_t)> lambda,
+                                                                      function<bool(void)> single_threaded_until_true,
+                                                                      function<void(size_t)> before_read,
+                                                                      uint64_t batch_size) {
+    
+    FastqReader reader(filename, FastqReader::default_decompression_threads(omp_get_max_threads()));
+    
+    function<bool(Alignment&, Alignment&)> get_pair = [&](Alignment& mate1, Alignment& mate2) {
+        return reader.next(mate1) && reader.next(mate2);
+    };
+    
+    return paired_for_each_parallel_stealing(get_pair, lambda, single_threaded_until_true, before_read, batch_size);
+}
+
+size_t fastq_paired_two_files_for_each_parallel_after_wait_numbered(const string& file1, const string& file2,
+                                                                    function<void(Alignment&, Alignment&, size_t)> lambda,
+                                                                    function<bool(void)> single_threaded_until_true,
+                                                                    function<void(size_t)> before_read,
+                                                                    uint64_t batch_size) {
+    
+    size_t decompression_threads = FastqReader::default_decompression_threads(omp_get_max_threads());
+    FastqReader reader1(file1, decompression_threads);
+    FastqReader reader2(file2, decompression_threads);
+    
+    function<bool(Alignment&, Alignment&)> get_pair = [&](Alignment& mate1, Alignment& mate2) {
+        return reader1.next(mate1) && reader2.next(mate2);
+    };
+    
+    return paired_for_each_parallel_stealing(get_pair, lambda, single_threaded_until_true, before_read, batch_size);
+}
+
 size_t fastq_unpaired_for_each(const string& filename, function<void(Alignment&)> lambda) {
     gzFile fp = (filename != "-") ? gzopen(filename.c_str(), "r") : gzdopen(fileno(stdin), "r");
     if (!fp) {
@@ -1896,6 +2021,82 @@ pair<string, string> signature(const Alignment& aln1, const Alignment& aln2) {
     return make_pair(signature(aln1), signature(aln2));
 }
 
+/// A region of a path to make into an Alignment, as parsed from a BED or GFF line.
+struct TargetRegion {
+    path_handle_t path;
+    size_t start;
+    size_t end;
+    string name;
+    bool is_reverse;
+    size_t score;
+};
+
+/// Make the Alignment for the non-circular part of a path starting in the given step.
+static Alignment target_alignment_from_step(const PathPositionHandleGraph* graph, step_handle_t step, size_t step_start,
+                                            size_t pos1, size_t pos2, const string& feature, bool is_reverse);
+
+/// How far ahead along a path we walk to the next region. Farther regions
+/// are found with a position lookup.
+static const size_t TARGET_REGION_MAX_WALK = 1 << 16;
+
+/// Make the Alignments for a batch of regions, in order. The regions on each
+/// path are sorted and found in one sweep along it, and the paths are done
+/// in parallel.
+static void target_alignments(const PathPositionHandleGraph* graph, const vector<TargetRegion>& regions,
+                              vector<Alignment>* out_alignments) {
+    
+    unordered_map<int64_t, vector<size_t>> regions_by_path;
+    for (size_t i = 0; i < regions.size(); i++) {
+        regions_by_path[as_integer(regions[i].path)].push_back(i);
+    }
+    vector<vector<size_t>*> path_regions;
+    path_regions.reserve(regions_by_path.size());
+    for (auto& entry : regions_by_path) {
+        path_regions.push_back(&entry.second);
+    }
+    
+    out_alignments->resize(regions.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < path_regions.size(); i++) {
+        vector<size_t>& indexes = *path_regions[i];
+        std::stable_sort(indexes.begin(), indexes.end(), [&](size_t a, size_t b) {
+            return regions[a].start < regions[b].start;
+        });
+        
+        path_handle_t path = regions[indexes.front()].path;
+        step_handle_t step = graph->path_begin(path);
+        step_handle_t end_step = graph->path_end(path);
+        size_t step_start = 0;
+        for (size_t index : indexes) {
+            const TargetRegion& region = regions[index];
+            Alignment& alignment = (*out_alignments)[index];
+            if (region.start >= region.end) {
+                // Regions that wrap around a circular path, or are empty
+                alignment = target_alignment(graph, path, region.start, region.end, region.name, region.is_reverse);
+            } else {
+                if (step != end_step && region.start - step_start > TARGET_REGION_MAX_WALK) {
+                    // Jump ahead
+                    step = graph->get_step_at_position(path, region.start);
+                    step_start = step == end_step ? 0 : graph->get_position_of_step(step);
+                }
+                while (step != end_step && step_start + graph->get_length(graph->get_handle_of_step(step)) <= region.start) {
+                    step_start += graph->get_length(graph->get_handle_of_step(step));
+                    step = graph->get_next_step(step);
+                }
+                if (step == end_step) {
+                    // The region is past the end of the path; let the
+                    // position lookup deal with it as it would alone.
+                    alignment = target_alignment(graph, path, region.start, region.end, region.name, region.is_reverse);
+                } else {
+                    alignment = target_alignment_from_step(graph, step, step_start, region.start, region.end,
+                                                           region.name, region.is_reverse);
+                }
+            }
+            alignment.set_score(region.score);
+        }
+    }
+}
+
 void parse_bed_regions(istream& bedstream,
                        const PathPositionHandleGraph* graph,
                        vector<Alignment>* out_alignments) {
@@ -1913,6 +2114,7 @@ void parse_bed_regions(istream& bedstream,
     string name;
     size_t score = 0;
     string strand;
+    vector<TargetRegion> regions;
 
     for (int line = 1; getline(bedstream, row); ++line) {
         if (row.size() < 2 || row[0] == '#') {
@@ -1971,12 +2173,11 @@ void parse_bed_regions(istream& bedstream,
             is_reverse = true;
         }
 
-        // Make the Alignment
-        Alignment alignment = target_alignment(graph, path_handle, sbuf, ebuf, name, is_reverse);
-        alignment.set_score(score);
-
-        out_alignments->push_back(alignment);
+        // Remember to make the Alignment
+        regions.push_back({path_handle, sbuf, ebuf, name, is_reverse, score});
     }
+    
+    target_alignments(graph, regions, out_alignments);
 }
 
 void parse_gff_regions(istream& gffstream,
@@ -1999,6 +2200,7 @@ void parse_gff_regions(istream& gffstream,
     string strand;
     string num;
     string annotations;
+    vector<TargetRegion> regions;
 
     for (int line = 1; getline(gffstream, row); ++line) {
         if (row.size() < 2 || row[0] == '#') {
@@ -2049,12 +2251,12 @@ void parse_gff_regions(istream& gffstream,
                 // we go look for positions in it.
                 cerr << "warning: path \"" << seq << "\" not found in index, skipping" << endl;
             } else {
-                Alignment alignment = target_alignment(graph, graph->get_path_handle(seq), sbuf, ebuf, name, is_reverse);
-
-                out_alignments->push_back(alignment);
+                regions.push_back({graph->get_path_handle(seq), sbuf, ebuf, name, is_reverse, 0});
             }
         }
     }
+    
+    target_alignments(graph, regions, out_alignments);
 }
 
 Position alignment_start(const Alignment& aln) {
@@ -2341,8 +2543,6 @@ Alignment target_alignment(const PathPositionHandleGraph* graph, const path_hand
 
 Alignment target_alignment(const PathPositionHandleGraph* graph, const path_handle_t& path, size_t pos1, size_t pos2,
                            const string& feature, bool is_reverse) {
-    Alignment aln;
-
     
     if (pos2 < pos1) {
         // Looks like we want to span the origin of a circular path
@@ -2388,7 +2588,12 @@ Alignment target_alignment(const PathPositionHandleGraph* graph, const path_hand
     // If we get here, we do the normal non-circular path case.
     
     step_handle_t step = graph->get_step_at_position(path, pos1);
-    size_t step_start = graph->get_position_of_step(step);
+    return target_alignment_from_step(graph, step, graph->get_position_of_step(step), pos1, pos2, feature, is_reverse);
+}
+
+Alignment target_alignment_from_step(const PathPositionHandleGraph* graph, step_handle_t step, size_t step_start,
+                                     size_t pos1, size_t pos2, const string& feature, bool is_reverse) {
+    Alignment aln;
     handle_t handle = graph->get_handle_of_step(step);
     
     int64_t trim_start = pos1 - step_start;
@@ -20,6 +20,9 @@ namespace vg {
 
 const char* const BAM_DNA_LOOKUP = "=ACMGRSVTWYHKDBN";
 
+/// How many records each thread takes from the input at once in hts_for_each_parallel().
+const size_t HTS_READ_BATCH_SIZE = 256;
+
 int hts_for_each(string& filename, function<void(Alignment&)> lambda);
 int hts_for_each_parallel(string& filename, function<void(Alignment&)> lambda);
 int hts_for_each(string& filename, function<void(Alignment&)> lambda,
@@ -29,6 +32,11 @@ int hts_for_each_parallel(string& filename, function<void(Alignment&)> lambda,
 int fastq_for_each(string& filename, function<void(Alignment&)> lambda);
 
 // fastq
+/// Convert a FASTQ quality string from Phred+33 characters to raw Phred
+/// scores, as stored in an Alignment, without copying it.
+void fastq_quality_char_to_short_in_place(string& quality);
+/// Parse the next FASTQ or FASTA record into the given Alignment. The
+/// Alignment's existing string storage is reused.
 bool get_next_alignment_from_fastq(gzFile fp, char* buffer, size_t len, Alignment& alignment);
 bool get_next_interleaved_alignment_pair_from_fastq(gzFile fp, char* buffer, size_t len, Alignment& mate1, Alignment& mate2);
 bool get_next_alignment_pair_from_fastqs(gzFile fp1, gzFile fp2, char* buffer, size_t len, Alignment& mate1, Alignment& mate2);
@@ -59,6 +67,28 @@ size_t fastq_paired_two_files_for_each_parallel_after_wait(const string& file1,
                                                            function<bool(void)> single_threaded_until_true,
                                                            uint64_t batch_size = vg::io::DEFAULT_PARALLEL_BATCHSIZE);
 
+// numbered versions of the parallel functions above, which also give the lambda
+// the number of each read (or pair) in the input, counting from 0. before_read
+// is called with the number the next read will get, from the thread doing the
+// reading, before it is read, so reading can be held up until there is room
+// for it. At most batch_size reads are read before they can be processed.
+size_t fastq_unpaired_for_each_parallel_numbered(const string& filename,
+                                                 function<void(Alignment&, size_t)> lambda,
+                                                 function<void(size_t)> before_read,
+                                                 uint64_t batch_size = vg::io::DEFAULT_PARALLEL_BATCHSIZE);
+
+size_t fastq_paired_interleaved_for_each_parallel_after_wait_numbered(const string& filename,
+                                                                      function<void(Alignment&, Alignment&, size_t)> lambda,
+                                                                      function<bool(void)> single_threaded_until_true,
+                                                                      function<void(size_t)> before_read,
+                                                                      uint64_t batch_size = vg::io::DEFAULT_PARALLEL_BATCHSIZE);
+
+size_t fastq_paired_two_files_for_each_parallel_after_wait_numbered(const string& file1, const string& file2,
+                                                                    function<void(Alignment&, Alignment&, size_t)> lambda,
+                                                                    function<bool(void)> single_threaded_until_true,
+                                                                    function<void(size_t)> before_read,
+                                                                    uint64_t batch_size = vg::io::DEFAULT_PARALLEL_BATCHSIZE);
+
 bam_hdr_t* hts_file_header(string& filename, string& header);
 bam_hdr_t* hts_string_header(string& header,
                              const map<string, int64_t>& path_length,
@@ -296,6 +326,7 @@ map<id_t, int> alignment_quality_per_node(const Alignment& aln);
 /// Parse regions from the given BED file into Alignments in a vector.
 /// Reads the optional name, is_reverse, and score fields if present, and populates the relevant Alignment fields.
 /// Skips and warns about malformed or illegal BED records.
+/// The regions on each path are found in one sweep along it, and the paths are done in parallel.
 void parse_bed_regions(istream& bedstream, const PathPositionHandleGraph* graph, vector<Alignment>* out_alignments);
 void parse_gff_regions(istream& gtfstream, const PathPositionHandleGraph* graph, vector<Alignment>* out_alignments);
 
@@ -0,0 +1,148 @@
+/// \file annotation.cpp
+/// Implementation of the compact AnnotationBuffer
+
+#include "annotation.hpp"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace vg {
+
+using namespace std;
+
+/// All the names that have been interned, shared by all the threads. The
+/// deque keeps references to the names valid as it grows.
+static mutex interned_mutex;
+static unordered_map<string, uint32_t> interned_keys;
+static deque<string> interned_names;
+
+uint32_t AnnotationBuffer::intern(const string& name) {
+    // Most lookups are for names this thread has already seen, so check a
+    // thread-local copy before taking the lock.
+    thread_local unordered_map<string, uint32_t> known_keys;
+    auto found = known_keys.find(name);
+    if (found != known_keys.end()) {
+        return found->second;
+    }
+    
+    uint32_t key;
+    {
+        lock_guard<mutex> lock(interned_mutex);
+        auto interned = interned_keys.find(name);
+        if (interned == interned_keys.end()) {
+            key = interned_names.size();
+            interned_names.push_back(name);
+            interned_keys.emplace(name, key);
+        } else {
+            key = interned->second;
+        }
+    }
+    known_keys.emplace(name, key);
+    return key;
+}
+
+const string& AnnotationBuffer::name_of(uint32_t key) {
+    lock_guard<mutex> lock(interned_mutex);
+    return interned_names.at(key);
+}
+
+AnnotationBuffer::Entry& AnnotationBuffer::entry_for(const string& name, Kind kind) {
+    uint32_t key = intern(name);
+    for (Entry& entry : entries) {
+        if (entry.key == key) {
+            entry.kind = kind;
+            entry.text.clear();
+            entry.numbers.clear();
+            entry.texts.clear();
+            return entry;
+        }
+    }
+    entries.emplace_back();
+    entries.back().key = key;
+    entries.back().kind = kind;
+    return entries.back();
+}
+
+const AnnotationBuffer::Entry* AnnotationBuffer::find(const string& name) const {
+    uint32_t key = intern(name);
+    for (const Entry& entry : entries) {
+        if (entry.key == key) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void AnnotationBuffer::set(const string& name, bool value) {
+    entry_for(name, Kind::Boolean).number = value ? 1.0 : 0.0;
+}
+
+void AnnotationBuffer::set(const string& name, double value) {
+    entry_for(name, Kind::Number).number = value;
+}
+
+void AnnotationBuffer::set(const string& name, const string& value) {
+    entry_for(name, Kind::Text).text = value;
+}
+
+void AnnotationBuffer::set(const string& name, const char* value) {
+    entry_for(name, Kind::Text).text = value;
+}
+
+void AnnotationBuffer::set(const string& name, const vector<double>& value) {
+    entry_for(name, Kind::NumberList).numbers = value;
+}
+
+void AnnotationBuffer::set(const string& name, const vector<string>& value) {
+    entry_for(name, Kind::TextList).texts = value;
+}
+
+bool AnnotationBuffer::has(const string& name) const {
+    return find(name) != nullptr;
+}
+
+void AnnotationBuffer::clear(const string& name) {
+    uint32_t key = intern(name);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].key == key) {
+            entries.erase(entries.begin() + i);
+            return;
+        }
+    }
+}
+
+void AnnotationBuffer::clear() {
+    entries.clear();
+}
+
+size_t AnnotationBuffer::size() const {
+    return entries.size();
+}
+
+void AnnotationBuffer::read(const Entry& entry, bool& value) {
+    assert(entry.kind == Kind::Boolean);
+    value = (entry.number != 0.0);
+}
+
+void AnnotationBuffer::read(const Entry& entry, double& value) {
+    assert(entry.kind == Kind::Number);
+    value = entry.number;
+}
+
+void AnnotationBuffer::read(const Entry& entry, string& value) {
+    assert(entry.kind == Kind::Text);
+    value = entry.text;
+}
+
+void AnnotationBuffer::read(const Entry& entry, vector<double>& value) {
+    assert(entry.kind == Kind::NumberList);
+    value = entry.numbers;
+}
+
+void AnnotationBuffer::read(const Entry& entry, vector<string>& value) {
+    assert(entry.kind == Kind::TextList);
+    value = entry.texts;
+}
+
+}
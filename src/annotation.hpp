@@ -11,6 +11,8 @@
 #include <functional>
 #include <limits>
 #include <cmath>
+#include <cstdint>
+#include <cassert>
 
 #include <google/protobuf/struct.pb.h>
 
@@ -71,6 +73,103 @@ void for_each_basic_annotation(const Annotated& annotated,
                                const function<void(const string&,bool)> bool_lambda,
                                const function<void(const string&,const string&)> string_lambda);
 
+/**
+ * A compact, typed side-store for annotations that are being built up for an
+ * object, to be attached to it later with apply_to(). Names are interned as
+ * small integer keys and the values are kept in a flat vector, so setting an
+ * annotation does not allocate map nodes or Protobuf Values. Supports the
+ * same value types as set_annotation(): bool, numbers (stored as double),
+ * strings, and vectors of doubles or strings.
+ */
+class AnnotationBuffer {
+public:
+    
+    /// Get the key used for the given annotation name.
+    static uint32_t intern(const string& name);
+    
+    /// Get the name that was interned as the given key.
+    static const string& name_of(uint32_t key);
+    
+    /// Set an annotation, replacing any existing value.
+    void set(const string& name, bool value);
+    void set(const string& name, double value);
+    void set(const string& name, const string& value);
+    void set(const string& name, const char* value);
+    void set(const string& name, const vector<double>& value);
+    void set(const string& name, const vector<string>& value);
+    /// Other numbers are stored as doubles, like value_cast() does.
+    template<typename Number, typename Enabled = typename enable_if<is_arithmetic<Number>::value>::type>
+    void set(const string& name, const Number& value);
+    
+    /// Returns true if there is an annotation with this name.
+    bool has(const string& name) const;
+    
+    /// Get the annotation with the given name, or a value-initialized default
+    /// if it is not present. It is undefined behavior to read a value out into
+    /// a different type than it was stored with.
+    template<typename AnnotationType>
+    AnnotationType get(const string& name) const;
+    
+    /// Remove the annotation with the given name, if present.
+    void clear(const string& name);
+    
+    /// Remove all annotations.
+    void clear();
+    
+    /// Get the number of annotations stored.
+    size_t size() const;
+    
+    /// Set all of the stored annotations on the annotated object. If keep is
+    /// not null, only the annotations for which it returns true are set.
+    template<typename Annotated>
+    void apply_to(Annotated& annotated, const function<bool(const string&)>* keep = nullptr) const;
+    
+private:
+    
+    enum class Kind : uint8_t { Boolean, Number, Text, NumberList, TextList };
+    
+    struct Entry {
+        uint32_t key;
+        Kind kind;
+        // Holds Number values, and Boolean values as 0 or 1
+        double number = 0.0;
+        string text;
+        vector<double> numbers;
+        vector<string> texts;
+    };
+    
+    /// Find or make the entry for a name, and reset it to the given kind.
+    Entry& entry_for(const string& name, Kind kind);
+    
+    /// Find the entry for a name, or null if there is none.
+    const Entry* find(const string& name) const;
+    
+    vector<Entry> entries;
+    
+    // The readers for each type that get() can produce
+    static void read(const Entry& entry, bool& value);
+    static void read(const Entry& entry, double& value);
+    static void read(const Entry& entry, string& value);
+    static void read(const Entry& entry, vector<double>& value);
+    static void read(const Entry& entry, vector<string>& value);
+    template<typename Number, typename Enabled = typename enable_if<is_arithmetic<Number>::value>::type>
+    static void read(const Entry& entry, Number& value);
+};
+
+/// Returns true if the buffer has an annotation with this name
+bool has_annotation(const AnnotationBuffer& annotated, const string& name);
+
+/// Get the annotation with the given name from the buffer and return it.
+template<typename AnnotationType>
+AnnotationType get_annotation(const AnnotationBuffer& annotated, const string& name);
+
+/// Set the annotation with the given name to the given value in the buffer.
+template<typename AnnotationType>
+void set_annotation(AnnotationBuffer& annotated, const string& name, const AnnotationType& annotation);
+
+/// Clear the annotation with the given name from the buffer.
+void clear_annotation(AnnotationBuffer& annotated, const string& name);
+
 ////////////////////////////////////////////////////////////////////////
 // Internal Definitions
 ////////////////////////////////////////////////////////////////////////
@@ -222,8 +321,8 @@ inline google::protobuf::Value value_cast(const Container& wrap) {
 
 template<typename Annotated>
 inline bool has_annotation(const Annotated& annotated, const string& name) {
-    // Grab the whole annotation struct
-    auto annotation_struct = Annotation<Annotated>::get(annotated);
+    // Grab the whole annotation struct, without copying it
+    const auto& annotation_struct = Annotation<Annotated>::get(annotated);
     // Check for the annotation
     return annotation_struct.fields().count(name);
 }
@@ -232,20 +331,18 @@ inline bool has_annotation(const Annotated& annotated, const string& name) {
 
 template<typename AnnotationType, typename Annotated>
 inline AnnotationType get_annotation(const Annotated& annotated, const string& name) {
-    // Grab the whole annotation struct
-    auto annotation_struct = Annotation<Annotated>::get(annotated);
+    // Grab the whole annotation struct, without copying it
+    const auto& annotation_struct = Annotation<Annotated>::get(annotated);
     
-    if (!annotation_struct.fields().count(name)) {
+    auto found = annotation_struct.fields().find(name);
+    if (found == annotation_struct.fields().end()) {
         // Nothing is there.
         // Return the Proto default value, by value-initializing.
         return AnnotationType();
     }
     
-    // Get the Protobuf Value for this annotation name
-    auto value = annotation_struct.fields().at(name);
-    
-    // Pull out the right type.
-    return value_cast<AnnotationType>(value);
+    // Pull out the right type from the Protobuf Value for this annotation name.
+    return value_cast<AnnotationType>(found->second);
 }
 
 template<typename AnnotationType, typename Annotated>
@@ -280,6 +377,72 @@ inline void clear_annotation(Annotated& annotated, const string& name) {
     clear_annotation(&annotated, name);
 }
 
+template<typename Number, typename Enabled>
+inline void AnnotationBuffer::set(const string& name, const Number& value) {
+    set(name, (double) value);
+}
+
+template<typename AnnotationType>
+inline AnnotationType AnnotationBuffer::get(const string& name) const {
+    AnnotationType value = AnnotationType();
+    const Entry* entry = find(name);
+    if (entry != nullptr) {
+        read(*entry, value);
+    }
+    return value;
+}
+
+template<typename Number, typename Enabled>
+inline void AnnotationBuffer::read(const Entry& entry, Number& value) {
+    assert(entry.kind == Kind::Number);
+    value = (Number) entry.number;
+}
+
+template<typename Annotated>
+void AnnotationBuffer::apply_to(Annotated& annotated, const function<bool(const string&)>* keep) const {
+    for (const Entry& entry : entries) {
+        const string& name = name_of(entry.key);
+        if (keep != nullptr && !(*keep)(name)) {
+            continue;
+        }
+        switch (entry.kind) {
+            case Kind::Boolean:
+                set_annotation(annotated, name, entry.number != 0.0);
+                break;
+            case Kind::Number:
+                set_annotation(annotated, name, entry.number);
+                break;
+            case Kind::Text:
+                set_annotation(annotated, name, entry.text);
+                break;
+            case Kind::NumberList:
+                set_annotation(annotated, name, entry.numbers);
+                break;
+            case Kind::TextList:
+                set_annotation(annotated, name, entry.texts);
+                break;
+        }
+    }
+}
+
+inline bool has_annotation(const AnnotationBuffer& annotated, const string& name) {
+    return annotated.has(name);
+}
+
+template<typename AnnotationType>
+inline AnnotationType get_annotation(const AnnotationBuffer& annotated, const string& name) {
+    return annotated.get<AnnotationType>(name);
+}
+
+template<typename AnnotationType>
+inline void set_annotation(AnnotationBuffer& annotated, const string& name, const AnnotationType& annotation) {
+    annotated.set(name, annotation);
+}
+
+inline void clear_annotation(AnnotationBuffer& annotated, const string& name) {
+    annotated.clear(name);
+}
+
 template<typename Annotated>
 void for_each_basic_annotation(const Annotated& annotated,
                                const function<void(const string&)> null_lambda,
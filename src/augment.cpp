@@ -6,6 +6,11 @@
 #include "alignment.hpp"
 #include "packer.hpp"
 #include "annotation.hpp"
+#include "stream_index.hpp"
+
+#include <ips4o.hpp>
+
+#include <queue>
 //#define debug
 
 using namespace vg::io;
@@ -14,6 +19,13 @@ namespace vg {
 
 using namespace std;
 
+// How many breakpoints can a thread collect in the first pass before we
+// deduplicate them?
+static const size_t BREAKPOINT_COMPACT_SIZE = 1024 * 1024;
+
+// How many reads per thread do we prepare at once in the second pass?
+static const size_t EMBED_BATCH_SIZE = 1024;
+
 // The correct way to edit the graph
 void augment(MutablePathMutableHandleGraph* graph,
              const string& gam_path,
@@ -171,6 +183,19 @@ static inline bool check_in_graph(const Path& path, const unordered_map<id_t, si
     return true;
 }
 
+static Path embed_read_path(MutablePathMutableHandleGraph* graph, const Path& simplified_path, const string& name,
+                            const map<pos_t, id_t>& node_translation,
+                            unordered_map<pair<pos_t, string>, vector<id_t>>& added_seqs,
+                            unordered_map<id_t, Path>& added_nodes,
+                            const unordered_map<id_t, size_t>& orig_node_sizes,
+                            bool embed_paths);
+
+static void finish_augment(MutablePathMutableHandleGraph* graph,
+                           vector<Translation>* out_translations,
+                           const map<pos_t, id_t>& node_translation,
+                           const unordered_map<id_t, Path>& added_nodes,
+                           const unordered_map<id_t, size_t>& orig_node_sizes);
+
 void augment_impl(MutablePathMutableHandleGraph* graph,
                   function<void(function<void(Alignment&)>,bool, bool)> iterate_gam,
                   const string& aln_format,                  
@@ -202,6 +227,11 @@ void augment_impl(MutablePathMutableHandleGraph* graph,
     assert(!packed_mode || packer != nullptr);
     
     unordered_map<id_t, set<pos_t>> breakpoints;
+
+    // Without the Packer, each thread collects the breakpoints it finds in its
+    // own vector, which gets deduplicated whenever it doubles in size.
+    vector<vector<pos_t>> thread_breakpoints(packed_mode ? 0 : get_thread_count());
+    vector<size_t> compact_at(thread_breakpoints.size(), BREAKPOINT_COMPACT_SIZE);
         
     // First pass: find the breakpoints
     iterate_gam((function<void(Alignment&)>)[&](Alignment& aln) {
@@ -234,14 +264,28 @@ void augment_impl(MutablePathMutableHandleGraph* graph,
             } else {
                 // note: we cannot pass non-zero min_baseq here.  it relies on filter_breakpoints_by_coverage
                 // to work correctly, and must be passed in only via find_packed_breakpoints.
-                find_breakpoints(simplified_path, breakpoints, break_at_ends, "", 0, 1.);
+                thread_local unordered_map<id_t, set<pos_t>> read_breakpoints;
+                read_breakpoints.clear();
+                find_breakpoints(simplified_path, read_breakpoints, break_at_ends, "", 0, 1.);
+                size_t thread_num = omp_get_thread_num();
+                vector<pos_t>& found = thread_breakpoints[thread_num];
+                for (auto& node_breakpoints : read_breakpoints) {
+                    found.insert(found.end(), node_breakpoints.second.begin(), node_breakpoints.second.end());
+                }
+                if (found.size() >= compact_at[thread_num]) {
+                    ips4o::sort(found.begin(), found.end());
+                    found.erase(std::unique(found.begin(), found.end()), found.end());
+                    compact_at[thread_num] = std::max(BREAKPOINT_COMPACT_SIZE, 2 * found.size());
+                }
             }
-        }, false, packed_mode);
+        }, false, true);
 
     if (packed_mode) {
         // Filter the breakpoints by coverage
         breakpoints = filter_breakpoints_by_coverage(*packer, min_bp_coverage);
     } else {
+        breakpoints = merge_breakpoints(thread_breakpoints);
+        thread_breakpoints.clear();
         // Invert the breakpoints that are on the reverse strand
         breakpoints = forwardize_breakpoints(graph, breakpoints);
     }
@@ -268,17 +312,27 @@ void augment_impl(MutablePathMutableHandleGraph* graph,
     unordered_map<pair<pos_t, string>, vector<id_t>> added_seqs;
     // we will record the nodes that we add, so we can correctly make the returned translation
     unordered_map<id_t, Path> added_nodes;
-    // output alignment emitter and buffer
+    // output alignment emitter
     unique_ptr<vg::io::AlignmentEmitter> aln_emitter;
     if (!gam_out_path.empty()) {
         aln_emitter = vg::io::get_non_hts_alignment_emitter(gam_out_path, aln_format, {}, get_thread_count(), graph);
     }
-    vector<Alignment> aln_buffer;
 
-    // Second pass: add the nodes and edges
-    iterate_gam((function<void(Alignment&)>)[&](Alignment& aln) {
+    // Second pass: add the nodes and edges. We collect the reads into batches
+    // and prepare their paths in parallel, and then modify the graph for each
+    // read in input order, so the new node IDs don't depend on the threads.
+    size_t embed_batch_size = EMBED_BATCH_SIZE * get_thread_count();
+    vector<Alignment> batch;
+    vector<Path> batch_paths;
+    vector<char> batch_used;
+    auto embed_batch = [&]() {
+        batch_paths.resize(batch.size());
+        batch_used.assign(batch.size(), false);
+#pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = 0; i < batch.size(); ++i) {
+            Alignment& aln = batch[i];
             if (aln.mapping_quality() < min_mapq || (filter_out_of_graph_alignments && !check_in_graph(aln.path(), orig_node_sizes))) {
-                return;
+                continue;
             }
             
             if (remove_softclips) {
@@ -289,56 +343,94 @@ void augment_impl(MutablePathMutableHandleGraph* graph,
             // Mapping (because we don't have or want a breakpoint there)
             // Note: We're electing to re-simplify in a second pass to avoid storing all
             // the input paths in memory
-            Path simplified_path = simplify(aln.path());
+            batch_paths[i] = simplify(aln.path());
 
             // Filter out edits corresponding to breakpoints that didn't meet our coverage
             // criteria
             if (min_bp_coverage > 0) {
-                simplify_filtered_edits(graph, aln, simplified_path, node_translation, orig_node_sizes,
+                simplify_filtered_edits(graph, aln, batch_paths[i], node_translation, orig_node_sizes,
                                         min_baseq, max_frac_n);
             }
+            batch_used[i] = true;
+        }
 
-            // Create new nodes/wire things up. Get the added version of the path.
-            Path added = add_nodes_and_edges(graph, simplified_path, node_translation, added_seqs,
-                                             added_nodes, orig_node_sizes);
-
-            // Copy over the name
-            *added.mutable_name() = aln.name();
-
-            if (embed_paths) {
-                add_path_to_graph(graph, added);
-            }
-
-            // something is off about this check.
-            // assuming the GAM path is sorted, let's double-check that its edges are here
-            for (size_t i = 1; i < added.mapping_size(); ++i) {
-                auto& m1 = added.mapping(i-1);
-                auto& m2 = added.mapping(i);
-                // we're no longer sorting our input paths, so we assume they are sorted
-                assert((m1.rank() == 0 && m2.rank() == 0) || (m1.rank() + 1 == m2.rank()));
-                //if (!adjacent_mappings(m1, m2)) continue; // the path is completely represented here
-                auto s1 = graph->get_handle(m1.position().node_id(), m1.position().is_reverse());
-                auto s2 = graph->get_handle(m2.position().node_id(), m2.position().is_reverse());
-                // Ensure that we always have an edge between the two nodes in the correct direction
-                graph->create_edge(s1, s2);
+        vector<Alignment> aln_buffer;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (!batch_used[i]) {
+                continue;
             }
+            Alignment& aln = batch[i];
+            
+            Path added = embed_read_path(graph, batch_paths[i], aln.name(), node_translation, added_seqs,
+                                         added_nodes, orig_node_sizes, embed_paths);
 
             // optionally write out the modified path to GAM
-            if (!gam_out_path.empty()) {
-                *aln.mutable_path() = added;
-                aln_buffer.push_back(aln);
-                if (aln_buffer.size() >= 100) {
-                    aln_emitter->emit_singles(vector<Alignment>(aln_buffer));
-                    aln_buffer.clear();
-                }
+            if (aln_emitter) {
+                *aln.mutable_path() = std::move(added);
+                aln_buffer.emplace_back(std::move(aln));
+            }
+        }
+        if (!aln_buffer.empty()) {
+            aln_emitter->emit_singles(std::move(aln_buffer));
+        }
+        batch.clear();
+    };
+    iterate_gam((function<void(Alignment&)>)[&](Alignment& aln) {
+            batch.emplace_back(std::move(aln));
+            if (batch.size() >= embed_batch_size) {
+                embed_batch();
             }
         }, true, false);
-    if (!aln_buffer.empty()) {
-        // Flush the buffer
-        aln_emitter->emit_singles(vector<Alignment>(aln_buffer));
+    embed_batch();
+
+    finish_augment(graph, out_translations, node_translation, added_nodes, orig_node_sizes);
+}
+
+// Create the new nodes and edges for a read's prepared path, and return the
+// path's embedding in the modified graph, with the given name. Also adds the
+// embedding to the graph as a path if requested.
+static Path embed_read_path(MutablePathMutableHandleGraph* graph, const Path& simplified_path, const string& name,
+                            const map<pos_t, id_t>& node_translation,
+                            unordered_map<pair<pos_t, string>, vector<id_t>>& added_seqs,
+                            unordered_map<id_t, Path>& added_nodes,
+                            const unordered_map<id_t, size_t>& orig_node_sizes,
+                            bool embed_paths) {
+    // Create new nodes/wire things up. Get the added version of the path.
+    Path added = add_nodes_and_edges(graph, simplified_path, node_translation, added_seqs,
+                                     added_nodes, orig_node_sizes);
+
+    // Copy over the name
+    *added.mutable_name() = name;
+
+    if (embed_paths) {
+        add_path_to_graph(graph, added);
+    }
+
+    // something is off about this check.
+    // assuming the GAM path is sorted, let's double-check that its edges are here
+    for (size_t i = 1; i < added.mapping_size(); ++i) {
+        auto& m1 = added.mapping(i-1);
+        auto& m2 = added.mapping(i);
+        // we're no longer sorting our input paths, so we assume they are sorted
+        assert((m1.rank() == 0 && m2.rank() == 0) || (m1.rank() + 1 == m2.rank()));
+        //if (!adjacent_mappings(m1, m2)) continue; // the path is completely represented here
+        auto s1 = graph->get_handle(m1.position().node_id(), m1.position().is_reverse());
+        auto s2 = graph->get_handle(m2.position().node_id(), m2.position().is_reverse());
+        // Ensure that we always have an edge between the two nodes in the correct direction
+        graph->create_edge(s1, s2);
     }
 
-    // perform the same check as above, but on the paths that were already in the graph
+    return added;
+}
+
+// Do the work that has to happen after all the reads have been embedded.
+static void finish_augment(MutablePathMutableHandleGraph* graph,
+                           vector<Translation>* out_translations,
+                           const map<pos_t, id_t>& node_translation,
+                           const unordered_map<id_t, Path>& added_nodes,
+                           const unordered_map<id_t, size_t>& orig_node_sizes) {
+
+    // perform the same check as in embed_read_path(), but on the paths that were already in the graph
     // assuming the graph's paths are sorted, let's double-check that the edges are here
     graph->for_each_path_handle([&](path_handle_t path_handle) {
             step_handle_t prev_handle;
@@ -373,6 +465,181 @@ void augment_impl(MutablePathMutableHandleGraph* graph,
 
 }
 
+void augment_chunked(MutablePathMutableHandleGraph* graph,
+                     const string& gam_path,
+                     size_t chunk_size,
+                     vector<Translation>* out_translations,
+                     const string& gam_out_path,
+                     bool embed_paths,
+                     bool break_at_ends,
+                     bool remove_softclips,
+                     bool filter_out_of_graph_alignments,
+                     double min_baseq,
+                     double min_mapq,
+                     size_t min_bp_coverage,
+                     double max_frac_n) {
+
+    assert(chunk_size > 0);
+
+    GAMIndex gam_index;
+    try {
+        get_input_file(gam_path + ".gai", [&](istream& index_stream) {
+                gam_index.load(index_stream);
+            });
+    } catch (...) {
+        cerr << "error:[vg augment] unable to load GAM index file: " << gam_path << ".gai" << endl
+             << "                   note: augmenting by chunks requires a sorted and indexed GAM" << endl;
+        exit(1);
+    }
+    ifstream gam_stream(gam_path);
+    if (!gam_stream) {
+        cerr << "error:[vg augment] unable to open GAM file: " << gam_path << endl;
+        exit(1);
+    }
+    GAMIndex::cursor_t cursor(gam_stream);
+
+    // The same filters that augment() applies with a Packer, but with the
+    // breakpoint coverage counted one chunk at a time.
+    bool filter_mode = min_bp_coverage > 0 || min_baseq > 0 || max_frac_n < 1.;
+    size_t min_count = std::max(min_bp_coverage, (size_t)1);
+
+    // get the node sizes, for use when making the translation
+    unordered_map<id_t, size_t> orig_node_sizes;
+    orig_node_sizes.reserve(graph->get_node_count());
+    graph->for_each_handle([&](handle_t node) {
+            orig_node_sizes[graph->get_id(node)] = graph->get_length(node);
+        });
+
+    // First pass: for each chunk of node IDs, find the breakpoints on its
+    // nodes in the reads that visit it, and break the nodes right away.
+    map<pos_t, id_t> node_translation;
+    id_t min_id = graph->min_node_id();
+    id_t max_id = graph->max_node_id();
+    for (id_t chunk_start = min_id; chunk_start <= max_id; chunk_start += chunk_size) {
+        id_t chunk_end = std::min<id_t>(max_id, chunk_start + chunk_size - 1);
+        
+        // Number of reads breaking each position in the chunk
+        map<pos_t, size_t> breakpoint_counts;
+        gam_index.find(cursor, chunk_start, chunk_end, [&](const Alignment& found) {
+                if (found.mapping_quality() < min_mapq || (filter_out_of_graph_alignments && !check_in_graph(found.path(), orig_node_sizes))) {
+                    return;
+                }
+                Alignment aln = found;
+                if (remove_softclips) {
+                    softclip_trim(aln);
+                }
+                Path simplified_path = simplify(aln.path());
+                
+                unordered_map<id_t, set<pos_t>> read_breakpoints;
+                if (filter_mode) {
+                    find_breakpoints(simplified_path, read_breakpoints, break_at_ends, aln.quality(), min_baseq, max_frac_n);
+                } else {
+                    find_breakpoints(simplified_path, read_breakpoints, break_at_ends, "", 0, 1.);
+                }
+                // Other chunks' nodes are handled when we get to them, or
+                // have been broken already.
+                for (auto it = read_breakpoints.begin(); it != read_breakpoints.end();) {
+                    if (it->first < chunk_start || it->first > chunk_end) {
+                        it = read_breakpoints.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                for (auto& node_breakpoints : forwardize_breakpoints(graph, read_breakpoints)) {
+                    for (auto& pos : node_breakpoints.second) {
+                        breakpoint_counts[pos]++;
+                    }
+                }
+            });
+
+        unordered_map<id_t, set<pos_t>> breakpoints;
+        for (auto& pos_count : breakpoint_counts) {
+            if (pos_count.second >= min_count) {
+                breakpoints[id(pos_count.first)].insert(pos_count.first);
+            }
+        }
+        auto chunk_translation = ensure_breakpoints(graph, breakpoints);
+        node_translation.insert(chunk_translation.begin(), chunk_translation.end());
+    }
+
+    // we remember the sequences of nodes we've added at particular positions on the forward strand
+    unordered_map<pair<pos_t, string>, vector<id_t>> added_seqs;
+    // we will record the nodes that we add, so we can correctly make the returned translation
+    unordered_map<id_t, Path> added_nodes;
+    // output alignment emitter and buffer
+    unique_ptr<vg::io::AlignmentEmitter> aln_emitter;
+    if (!gam_out_path.empty()) {
+        aln_emitter = vg::io::get_non_hts_alignment_emitter(gam_out_path, "GAM", {}, get_thread_count(), graph);
+    }
+    vector<Alignment> aln_buffer;
+
+    // Second pass: add the nodes and edges. The reads are sorted by their
+    // minimum node ID, so once we pass a chunk boundary, no later read can
+    // touch the nodes before it, and unless we need the translation, we can
+    // forget what we did there.
+    bool forget_chunks = (out_translations == nullptr);
+    id_t next_boundary = min_id + chunk_size;
+    ifstream second_pass_stream(gam_path);
+    vg::io::for_each<Alignment>(second_pass_stream, [&](Alignment& aln) {
+            if (aln.mapping_quality() < min_mapq || (filter_out_of_graph_alignments && !check_in_graph(aln.path(), orig_node_sizes))) {
+                return;
+            }
+
+            if (forget_chunks && aln.path().mapping_size() > 0) {
+                id_t read_min_id = numeric_limits<id_t>::max();
+                for (auto& mapping : aln.path().mapping()) {
+                    if (mapping.position().node_id() != 0) {
+                        read_min_id = std::min<id_t>(read_min_id, mapping.position().node_id());
+                    }
+                }
+                if (read_min_id != numeric_limits<id_t>::max() && read_min_id >= next_boundary) {
+                    for (auto it = added_seqs.begin(); it != added_seqs.end();) {
+                        if (id(it->first.first) < read_min_id) {
+                            it = added_seqs.erase(it);
+                        } else {
+                            ++it;
+                        }
+                    }
+                    node_translation.erase(node_translation.begin(),
+                                           node_translation.lower_bound(make_pos_t(read_min_id, false, 0)));
+                    added_nodes.clear();
+                    next_boundary = read_min_id + chunk_size;
+                }
+            }
+            
+            if (remove_softclips) {
+                softclip_trim(aln);
+            }
+
+            Path simplified_path = simplify(aln.path());
+
+            // Filter out edits corresponding to breakpoints that didn't meet our coverage
+            // criteria
+            if (filter_mode) {
+                simplify_filtered_edits(graph, aln, simplified_path, node_translation, orig_node_sizes,
+                                        min_baseq, max_frac_n);
+            }
+
+            Path added = embed_read_path(graph, simplified_path, aln.name(), node_translation, added_seqs,
+                                         added_nodes, orig_node_sizes, embed_paths);
+
+            // optionally write out the modified path to GAM
+            if (aln_emitter) {
+                *aln.mutable_path() = std::move(added);
+                aln_buffer.emplace_back(std::move(aln));
+                if (aln_buffer.size() >= 100) {
+                    aln_emitter->emit_singles(std::move(aln_buffer));
+                    aln_buffer.clear();
+                }
+            }
+        });
+    if (!aln_buffer.empty()) {
+        aln_emitter->emit_singles(std::move(aln_buffer));
+    }
+
+    finish_augment(graph, out_translations, node_translation, added_nodes, orig_node_sizes);
+}
+
 double get_avg_baseq(const Edit& edit, const string& base_quals, size_t position_in_read) {
     double avg_qual = numeric_limits<int>::max();
     if (!base_quals.empty() && !edit.sequence().empty() && (edit_is_sub(edit) || edit_is_insertion(edit))) {
@@ -492,6 +759,45 @@ void find_breakpoints(const Path& path, unordered_map<id_t, set<pos_t>>& breakpo
 
 }
 
+unordered_map<id_t, set<pos_t>> merge_breakpoints(vector<vector<pos_t>>& thread_breakpoints) {
+    // Sort the runs in parallel
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < thread_breakpoints.size(); ++i) {
+        auto& run = thread_breakpoints[i];
+        ips4o::sort(run.begin(), run.end());
+        run.erase(std::unique(run.begin(), run.end()), run.end());
+    }
+
+    // Then merge them, so that each node's set is built in order
+    unordered_map<id_t, set<pos_t>> breakpoints;
+    typedef pair<pos_t, size_t> head_t;
+    priority_queue<head_t, vector<head_t>, greater<head_t>> heads;
+    vector<size_t> next(thread_breakpoints.size(), 0);
+    for (size_t i = 0; i < thread_breakpoints.size(); ++i) {
+        if (!thread_breakpoints[i].empty()) {
+            heads.emplace(thread_breakpoints[i][0], i);
+            next[i] = 1;
+        }
+    }
+    set<pos_t>* node_set = nullptr;
+    while (!heads.empty()) {
+        head_t head = heads.top();
+        heads.pop();
+        if (node_set == nullptr || node_set->empty() || id(*node_set->rbegin()) != id(head.first)) {
+            node_set = &breakpoints[id(head.first)];
+        }
+        node_set->emplace_hint(node_set->end(), head.first);
+        auto& run = thread_breakpoints[head.second];
+        if (next[head.second] < run.size()) {
+            heads.emplace(run[next[head.second]++], head.second);
+        } else {
+            // Free memory as we go
+            vector<pos_t>().swap(run);
+        }
+    }
+    return breakpoints;
+}
+
 unordered_map<id_t, set<pos_t>> forwardize_breakpoints(const HandleGraph* graph,
                                                        const unordered_map<id_t, set<pos_t>>& breakpoints) {
     unordered_map<id_t, set<pos_t>> fwd;
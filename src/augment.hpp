@@ -77,6 +77,26 @@ void augment(MutablePathMutableHandleGraph* graph,
              double max_frac_n = 1.,
              bool edges_only = false);
 
+/// Like the file version above, but for a sorted and indexed GAM (with a .gai
+/// index next to it), working on chunk_size node IDs at a time so that the
+/// breakpoints and their coverage never have to be held for the whole graph.
+/// Breakpoint coverage is counted per chunk instead of with a Packer. Unless
+/// a translation is requested, the bookkeeping for the added nodes is also
+/// dropped once the sorted reads have moved past a chunk.
+void augment_chunked(MutablePathMutableHandleGraph* graph,
+                     const string& gam_path,
+                     size_t chunk_size,
+                     vector<Translation>* out_translation = nullptr,
+                     const string& gam_out_path = "",
+                     bool embed_paths = false,
+                     bool break_at_ends = false,
+                     bool remove_soft_clips = false,
+                     bool filter_out_of_graph_alignments = false,
+                     double min_baseq = 0,
+                     double min_mapq = 0,
+                     size_t min_bp_coverage = 0,
+                     double max_frac_n = 1.);
+
 /// Generic version used to implement the above three methods.  
 void augment_impl(MutablePathMutableHandleGraph* graph,
                   function<void(function<void(Alignment&)>, bool, bool)> iterate_gam,
@@ -120,6 +140,11 @@ double get_avg_baseq(const Edit& edit, const string& base_quals, size_t position
 void find_breakpoints(const Path& path, unordered_map<id_t, set<pos_t>>& breakpoints, bool break_ends = true,
                       const string& base_quals = "", double min_baseq = 0, double max_frac_n = 1.);
 
+/// Merge the breakpoints collected by different threads into the map
+/// expected by the following methods. Each vector may be unsorted and contain
+/// duplicates, and is cleared along the way.
+unordered_map<id_t, set<pos_t>> merge_breakpoints(vector<vector<pos_t>>& thread_breakpoints);
+
 /// Flips the breakpoints onto the forward strand.
 unordered_map<id_t, set<pos_t>> forwardize_breakpoints(const HandleGraph* graph,
                                                        const unordered_map<id_t, set<pos_t>>& breakpoints);
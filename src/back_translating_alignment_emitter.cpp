@@ -24,7 +24,7 @@ void BackTranslatingAlignmentEmitter::back_translate_alignments_in_place(vector<
 
 void BackTranslatingAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
     // Intercept the batch on its way
-    vector<Alignment> aln_batch_caught(aln_batch);
+    vector<Alignment> aln_batch_caught(std::move(aln_batch));
     // Process it in place
     back_translate_alignments_in_place(aln_batch_caught);
     // Forward it along
@@ -33,7 +33,7 @@ void BackTranslatingAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch
 
 void BackTranslatingAlignmentEmitter::emit_mapped_singles(vector<vector<Alignment>>&& alns_batch) {
     // Intercept the batch on its way
-    vector<vector<Alignment>> alns_batch_caught(alns_batch);
+    vector<vector<Alignment>> alns_batch_caught(std::move(alns_batch));
     for (auto& mappings : alns_batch_caught) {
         // Surject all mappings in place
         back_translate_alignments_in_place(mappings);
@@ -44,8 +44,8 @@ void BackTranslatingAlignmentEmitter::emit_mapped_singles(vector<vector<Alignmen
 
 void BackTranslatingAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch, vector<int64_t>&& tlen_limit_batch) {
     // Intercept the batch on its way
-    vector<Alignment> aln1_batch_caught(aln1_batch);
-    vector<Alignment> aln2_batch_caught(aln2_batch);
+    vector<Alignment> aln1_batch_caught(std::move(aln1_batch));
+    vector<Alignment> aln2_batch_caught(std::move(aln2_batch));
     // Process it in place
     back_translate_alignments_in_place(aln1_batch_caught);
     back_translate_alignments_in_place(aln2_batch_caught);
@@ -55,8 +55,8 @@ void BackTranslatingAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch,
 
 void BackTranslatingAlignmentEmitter::emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch, vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch) {
     // Intercept the batch on its way
-    vector<vector<Alignment>> alns1_batch_caught(alns1_batch);
-    vector<vector<Alignment>> alns2_batch_caught(alns2_batch);
+    vector<vector<Alignment>> alns1_batch_caught(std::move(alns1_batch));
+    vector<vector<Alignment>> alns2_batch_caught(std::move(alns2_batch));
     for (auto& mappings : alns1_batch_caught) {
         // Process all mappings in place
         back_translate_alignments_in_place(mappings);
@@ -238,8 +238,8 @@ BandedGlobalAligner<IntType>::BAMatrix::~BAMatrix() {
 }
 
 template <class IntType>
-void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& graph, int8_t* score_mat, int8_t* nt_table,
-                                                         int8_t gap_open, int8_t gap_extend, bool qual_adjusted, IntType min_inf) {
+void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& graph, const int8_t* score_profile, int8_t* nt_table,
+                                                         int8_t gap_open, int8_t gap_extend, IntType min_inf) {
     
 #ifdef debug_banded_aligner_fill_matrix
     cerr << "[BAMatrix::fill_matrix] beginning DP on matrix for node " << as_integer(node) << endl;;
@@ -256,7 +256,6 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
     
     string node_seq = graph.get_sequence(node);
     const string& read = alignment.sequence();
-    const string& base_quality = alignment.quality();
     
     match = (IntType*) malloc(sizeof(IntType) * band_size);
     insert_col = (IntType*) malloc(sizeof(IntType) * band_size);
@@ -408,12 +407,7 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
         idx = (seed_next_top_diag_iter - top_diag) * ncols;
         
         IntType match_score;
-        if (qual_adjusted) {
-            match_score = score_mat[25 * base_quality[seed_next_top_diag_iter] + 5 * nt_table[node_seq[0]] + nt_table[read[seed_next_top_diag_iter]]];
-        }
-        else {
-            match_score = score_mat[5 * nt_table[node_seq[0]] + nt_table[read[seed_next_top_diag_iter]]];
-        }
+        match_score = score_profile[5 * seed_next_top_diag_iter + nt_table[node_seq[0]]];
         
         if (beyond_top_of_matrix) {
             // the implied cell above this cell is within the extended band form this seed, so we can extend from
@@ -463,12 +457,7 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
             
             // extend a match
             diag_idx = (diag - seed_next_top_diag) * seed_node_seq_len + seed_node_seq_len - 1;
-            if (qual_adjusted) {
-                match_score = score_mat[25 * base_quality[diag] + 5 * nt_table[node_seq[0]] + nt_table[read[diag]]];
-            }
-            else {
-                match_score = score_mat[5 * nt_table[node_seq[0]] + nt_table[read[diag]]];
-            }
+            match_score = score_profile[5 * diag + nt_table[node_seq[0]]];
             
 #ifdef debug_banded_aligner_fill_matrix
             cerr << "[BAMatrix::fill_matrix]: extending match from rectangular coord (" << diag - seed_next_top_diag << ", " << seed_node_seq_len - 1 << ")" << " with match score " << (int) match_score << ", scores are " << (int) seed->match[diag_idx] << " (M), " << (int) seed->insert_row[diag_idx] << " (Ir), and " << (int) seed->insert_col[diag_idx] << " (Ic), current score is " << (int) match[idx] << endl;
@@ -503,12 +492,7 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
             // may only be able to extend a match on last iteration
             idx = (seed_next_bottom_diag_iter - top_diag) * ncols;
             diag_idx = (seed_next_bottom_diag_iter - seed_next_top_diag) * seed_node_seq_len + seed_node_seq_len - 1;
-            if (qual_adjusted) {
-                match_score = score_mat[25 * base_quality[seed_next_bottom_diag_iter] + 5 * nt_table[node_seq[0]] + nt_table[read[seed_next_bottom_diag_iter]]];
-            }
-            else {
-                match_score = score_mat[5 * nt_table[node_seq[0]] + nt_table[read[seed_next_bottom_diag_iter]]];
-            }
+            match_score = score_profile[5 * seed_next_bottom_diag_iter + nt_table[node_seq[0]]];
             
 #ifdef debug_banded_aligner_fill_matrix
             cerr << "[BAMatrix::fill_matrix]: extending match from rectangular coord (" << seed_next_bottom_diag_iter - seed_next_top_diag << ", " << seed_node_seq_len - 1 << ")" << " with match score " << (int) match_score << ", scores are " << (int) seed->match[diag_idx] << " (M), " << (int) seed->insert_row[diag_idx] << " (Ir), and " << (int) seed->insert_col[diag_idx] << " (Ic), current score is " << (int) match[idx] << endl;
@@ -550,16 +534,11 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
         // cap stop index if last diagonal is below bottom of matrix
         int64_t iter_stop = bottom_diag >= (int64_t) read.length() ? band_height + (int64_t) read.length() - bottom_diag - 1 : band_height;
         // match of first nucleotides
-        if (qual_adjusted) {
-            match[idx] = max<IntType>(score_mat[25 * base_quality[0] + 5 * nt_table[node_seq[0]] + nt_table[read[0]]], match[idx]);
-            
+        match[idx] = max<IntType>(score_profile[nt_table[node_seq[0]]], match[idx]);
+        
 #ifdef debug_banded_aligner_fill_matrix
-            cerr << "[BAMatrix::fill_matrix]: set quality adjusted initial match cell to " << (int) match[idx] << " from node char " << node_seq[0] << ", read char " << read[0] << ", base qual " << (int) base_quality[0] << " for adjusted matrix index " << 25 * base_quality[0] + 5 * nt_table[node_seq[0]] + nt_table[read[0]] << " and score " << (int) score_mat[25 * base_quality[0] + 5 * nt_table[node_seq[0]] + nt_table[read[0]]] << endl;
+        cerr << "[BAMatrix::fill_matrix]: set initial match cell to " << (int) match[idx] << " from node char " << node_seq[0] << ", read char " << read[0] << " and score " << (int) score_profile[nt_table[node_seq[0]]] << endl;
 #endif
-        }
-        else {
-             match[idx] = max<IntType>(match[idx] = score_mat[5 * nt_table[node_seq[0]] + nt_table[read[0]]], match[idx]);
-        }
         
         // only way to end an alignment in a gap here is to row and column gap
         insert_row[idx] = max<IntType>(-2 * gap_open, insert_row[idx]);
@@ -570,12 +549,7 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
             up_idx = idx - ncols;
             // score of a match in this cell
             IntType match_score;
-            if (qual_adjusted) {
-                match_score = score_mat[25 * base_quality[top_diag + i] + 5 * nt_table[node_seq[0]] + nt_table[read[top_diag + i]]];
-            }
-            else {
-                match_score = score_mat[5 * nt_table[node_seq[0]] + nt_table[read[top_diag + i]]];
-            }
+            match_score = score_profile[5 * (top_diag + i) + nt_table[node_seq[0]]];
             // must take one lead gap to get into first column
             match[idx] = max<IntType>(match_score - gap_open - (top_diag + i - 1) * gap_extend, match[idx]);
             // normal iteration along column
@@ -621,12 +595,7 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
         idx = iter_start * ncols + j;
         
         IntType match_score;
-        if (qual_adjusted) {
-            match_score = score_mat[25 * base_quality[iter_start + top_diag + j] + 5 * nt_table[node_seq[j]] + nt_table[read[iter_start + top_diag + j]]];
-        }
-        else {
-            match_score = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[iter_start + top_diag + j]]];
-        }
+        match_score = score_profile[5 * (iter_start + top_diag + j) + nt_table[node_seq[j]]];
         if (top_diag_outside || top_diag_abutting) {
             // match after implied gap along top edge
             match[idx] = match_score - gap_open - (cumulative_seq_len + j - 1) * gap_extend;
@@ -668,12 +637,7 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
             diag_idx = i * ncols + (j - 1);
             left_idx = (i + 1) * ncols + (j - 1);
             
-            if (qual_adjusted) {
-                match_score = score_mat[25 * base_quality[i + top_diag + j] + 5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
-            }
-            else {
-                match_score = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
-            }
+            match_score = score_profile[5 * (i + top_diag + j) + nt_table[node_seq[j]]];
             
             match[idx] = match_score + max(max(match[diag_idx], insert_row[diag_idx]), insert_col[diag_idx]);
             
@@ -696,12 +660,7 @@ void BandedGlobalAligner<IntType>::BAMatrix::fill_matrix(const HandleGraph& grap
             up_idx = (iter_stop - 2) * ncols + j;
             diag_idx = (iter_stop - 1) * ncols + (j - 1);
             
-            if (qual_adjusted) {
-                match_score = score_mat[25 * base_quality[iter_stop + top_diag + j - 1] + 5 * nt_table[node_seq[j]] + nt_table[read[iter_stop + top_diag + j - 1]]];
-            }
-            else {
-                match_score = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[iter_stop + top_diag + j - 1]]];
-            }
+            match_score = score_profile[5 * (iter_stop + top_diag + j - 1) + nt_table[node_seq[j]]];
             
             match[idx] = match_score + max(max(match[diag_idx], insert_row[diag_idx]), insert_col[diag_idx]);
             
@@ -739,20 +698,43 @@ void BandedGlobalAligner<IntType>::BAMatrix::init_traceback_indexes(const Handle
     j = ncols - 1;
 }
 
+template <class IntType>
+void BandedGlobalAligner<IntType>::BAMatrix::score_range(const HandleGraph& graph, IntType min_inf,
+                                                         int64_t& low, int64_t& high) const {
+    
+    const string& read = alignment.sequence();
+    int64_t band_height = bottom_diag - top_diag + 1;
+    int64_t ncols = graph.get_length(node);
+    
+    for (int64_t j = 0; j < ncols; j++) {
+        // only the diagonals that are inside the matrix in this column get filled
+        int64_t iter_start = top_diag + j < 0 ? -(top_diag + j) : 0;
+        int64_t iter_stop = bottom_diag + j >= (int64_t) read.size() ? band_height + (int64_t) read.size() - bottom_diag - j - 1 : band_height;
+        for (int64_t i = iter_start; i < iter_stop; i++) {
+            int64_t idx = i * ncols + j;
+            for (IntType score : {match[idx], insert_row[idx], insert_col[idx]}) {
+                if (score != min_inf) {
+                    low = min<int64_t>(low, score);
+                    high = max<int64_t>(high, score);
+                }
+            }
+        }
+    }
+}
+
 template <class IntType>
 void BandedGlobalAligner<IntType>::BAMatrix::traceback(const HandleGraph& graph, BABuilder& builder,
                                                        AltTracebackStack& traceback_stack,
                                                        int64_t& i, int64_t& j, matrix_t& mat, bool& in_lead_gap,
-                                                       const int8_t* score_mat, const int8_t* nt_table,
+                                                       const int8_t* score_profile, const int8_t* nt_table,
                                                        const int8_t gap_open,  const int8_t gap_extend,
-                                                       const bool qual_adjusted, const IntType min_inf) {
+                                                       const IntType min_inf) {
     
 #ifdef debug_banded_aligner_traceback
     cerr << "[BAMatrix::traceback] starting traceback back through node " << graph.get_id(node) << " from rectangular coordinates (" << i << ", " << j << "), currently " << (in_lead_gap ? "" : "not ") << "in a lead gap" << endl;
 #endif
     
     const string& read = alignment.sequence();
-    const string& base_quality = alignment.quality();
     
     int64_t band_height = bottom_diag - top_diag + 1;
     string node_seq = graph.get_sequence(node);
@@ -838,12 +820,7 @@ void BandedGlobalAligner<IntType>::BAMatrix::traceback(const HandleGraph& graph,
                 next_idx = i * ncols + j - 1;
                 
                 IntType match_score;
-                if (qual_adjusted) {
-                    match_score = score_mat[25 * base_quality[i + top_diag + j] + 5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
-                }
-                else {
-                    match_score = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
-                }
+                match_score = score_profile[5 * (i + top_diag + j) + nt_table[node_seq[j]]];
                 
 #ifdef debug_banded_aligner_traceback
                 cerr << "[BAMatrix::traceback] transitioning from match, current score " << (int) match[idx] << " match/mismatch score " << (int) match_score << " from node char " << j << " (" << node_seq[j] << ") and read char " << i + top_diag + j << " (" << read[i + top_diag + j] << ")" << endl;
@@ -1120,9 +1097,9 @@ void BandedGlobalAligner<IntType>::BAMatrix::traceback_over_edge(const HandleGra
                                                                  AltTracebackStack& traceback_stack,
                                                                  int64_t& i, int64_t& j, matrix_t& mat,
                                                                  bool& in_lead_gap, int64_t& node_id,
-                                                                 const int8_t* score_mat, const int8_t* nt_table,
+                                                                 const int8_t* score_profile, const int8_t* nt_table,
                                                                  const int8_t gap_open, const int8_t gap_extend,
-                                                                 const bool qual_adjusted, IntType const min_inf) {
+                                                                 IntType const min_inf) {
     
     // begin POA across the boundary
     
@@ -1139,7 +1116,6 @@ void BandedGlobalAligner<IntType>::BAMatrix::traceback_over_edge(const HandleGra
     matrix_t traceback_mat = Match;
     
     const string& read = alignment.sequence();
-    const string& base_quality = alignment.quality();
     
     int64_t idx, next_idx;
     IntType score_diff;
@@ -1322,12 +1298,7 @@ void BandedGlobalAligner<IntType>::BAMatrix::traceback_over_edge(const HandleGra
             case Match:
             {
                 curr_score = match[i * ncols];
-                if (qual_adjusted) {
-                    match_score = score_mat[25 * base_quality[i + top_diag] + 5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag]]];
-                }
-                else {
-                    match_score = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag]]];
-                }
+                match_score = score_profile[5 * (i + top_diag) + nt_table[node_seq[j]]];
                 break;
             }
                 
@@ -1670,12 +1641,7 @@ void BandedGlobalAligner<IntType>::BAMatrix::traceback_over_edge(const HandleGra
                 case Match:
                 {
                     IntType match_score;
-                    if (qual_adjusted) {
-                        match_score = score_mat[25 * base_quality[i + top_diag + j] + 5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
-                    }
-                    else {
-                        match_score = score_mat[5 * nt_table[node_seq[j]] + nt_table[read[i + top_diag + j]]];
-                    }
+                    match_score = score_profile[5 * (i + top_diag + j) + nt_table[node_seq[j]]];
                     
                     source_score = curr_diag > 0 ? -gap_open - (curr_diag - 1) * gap_extend : 0;
                     score_diff = curr_score - (source_score + match_score);
@@ -2263,7 +2229,30 @@ void BandedGlobalAligner<IntType>::shortest_seq_paths(vector<int64_t>& seq_lens_
 }
 
 template <class IntType>
-void BandedGlobalAligner<IntType>::align(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend) {
+void BandedGlobalAligner<IntType>::build_score_profile(const int8_t* score_mat, const int8_t* nt_table) {
+    
+    const string& read = alignment.sequence();
+    const string& base_quality = alignment.quality();
+    
+    // include the position past the end, so that the fill has the same look ahead into the
+    // string's null terminator that it would have reading the read directly
+    score_profile.resize(5 * (read.size() + 1));
+    for (size_t i = 0; i <= read.size(); i++) {
+        const int8_t* row = score_mat + nt_table[read[i]];
+        if (adjust_for_base_quality) {
+            row += 25 * (i < base_quality.size() ? base_quality[i] : 0);
+        }
+        for (size_t j = 0; j < 5; j++) {
+            score_profile[5 * i + j] = row[5 * j];
+        }
+    }
+}
+
+template <class IntType>
+IntType BandedGlobalAligner<IntType>::fill_matrices(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend) {
+    
+    // look up the scores for each read base once, rather than in every cell
+    build_score_profile(score_mat, nt_table);
     
     // small enough number to never be accepted in alignment but also not trigger underflow
     IntType max_mismatch = numeric_limits<IntType>::max();
@@ -2289,24 +2278,163 @@ void BandedGlobalAligner<IntType>::align(int8_t* score_mat, int8_t* nt_table, in
         cerr << "[BandedGlobalAligner::align] at node " << graph.get_id(band_matrix->node) << " at index " << i << " with sequence " << graph.get_id(band_matrix->node) << endl;
         cerr << "[BandedGlobalAligner::align] node is not masked, filling matrix" << endl;
 #endif
-        band_matrix->fill_matrix(graph, score_mat, nt_table, gap_open, gap_extend, adjust_for_base_quality, min_inf);
+        band_matrix->fill_matrix(graph, score_profile.data(), nt_table, gap_open, gap_extend, min_inf);
     }
     
+    return min_inf;
+}
+
+template <class IntType>
+void BandedGlobalAligner<IntType>::align(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend) {
+    
+    IntType min_inf = fill_matrices(score_mat, nt_table, gap_open, gap_extend);
+    
     traceback(score_mat, nt_table, gap_open, gap_extend, min_inf);
 }
 
 template <class IntType>
-void BandedGlobalAligner<IntType>::traceback(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend, IntType min_inf) {
+bool BandedGlobalAligner<IntType>::align_checking_overflow(int8_t* score_mat, int8_t* nt_table,
+                                                           int8_t gap_open, int8_t gap_extend) {
     
-    // get the sink and source node matrices for alignment stack
-    unordered_set<BAMatrix*> sink_node_matrices;
-    unordered_set<BAMatrix*> source_node_matrices;
+    IntType min_inf;
+    if (!fill_matrices_checking_overflow(score_mat, nt_table, gap_open, gap_extend, min_inf)) {
+        return false;
+    }
+    
+    traceback(score_mat, nt_table, gap_open, gap_extend, min_inf);
+    return true;
+}
+
+template <class IntType>
+int32_t BandedGlobalAligner<IntType>::score(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend) {
+    
+    IntType min_inf = fill_matrices(score_mat, nt_table, gap_open, gap_extend);
+    
+    return optimal_score(gap_open, gap_extend, min_inf);
+}
+
+template <class IntType>
+bool BandedGlobalAligner<IntType>::score_checking_overflow(int8_t* score_mat, int8_t* nt_table,
+                                                           int8_t gap_open, int8_t gap_extend, int32_t& score_out) {
+    
+    IntType min_inf;
+    if (!fill_matrices_checking_overflow(score_mat, nt_table, gap_open, gap_extend, min_inf)) {
+        return false;
+    }
+    
+    score_out = optimal_score(gap_open, gap_extend, min_inf);
+    return true;
+}
+
+template <class IntType>
+bool BandedGlobalAligner<IntType>::fill_matrices_checking_overflow(int8_t* score_mat, int8_t* nt_table,
+                                                                   int8_t gap_open, int8_t gap_extend,
+                                                                   IntType& min_inf) {
+    
+    const string& read = alignment.sequence();
+    const string& base_quality = alignment.quality();
+    
+    // find the most that one step through the DP can change a score by
+    int64_t max_step = max<int64_t>(gap_open, gap_extend);
+    if (adjust_for_base_quality) {
+        vector<bool> seen_quality(256, false);
+        for (char q : base_quality) {
+            if (!seen_quality[(uint8_t) q]) {
+                seen_quality[(uint8_t) q] = true;
+                for (int i = 0; i < 25; i++) {
+                    max_step = max<int64_t>(max_step, abs((int64_t) score_mat[25 * (uint8_t) q + i]));
+                }
+            }
+        }
+    }
+    else {
+        for (int i = 0; i < 25; i++) {
+            max_step = max<int64_t>(max_step, abs((int64_t) score_mat[i]));
+        }
+    }
+    
+    // lead gap scores are computed straight from the sequence lengths, so they have to be
+    // known to fit before we start
+    int64_t total_seq_len = 0;
+    for (const handle_t& handle : topological_order) {
+        total_seq_len += graph.get_length(handle);
+    }
+    int64_t worst_lead_gap = -2 * gap_open - (int64_t(read.size()) + total_seq_len) * gap_extend - max_step;
+    if (worst_lead_gap <= numeric_limits<IntType>::min() + max_step ||
+        int64_t(read.size()) * max_step >= numeric_limits<IntType>::max() - max_step) {
+        return false;
+    }
+    
+    min_inf = fill_matrices(score_mat, nt_table, gap_open, gap_extend);
+    
+    int64_t low = numeric_limits<int64_t>::max();
+    int64_t high = numeric_limits<int64_t>::min();
+    for (BAMatrix* band_matrix : banded_matrices) {
+        if (band_matrix != nullptr) {
+            band_matrix->score_range(graph, min_inf, low, high);
+        }
+    }
+    
+    if (low <= high) {
+        // every stored score must be one step away from the limits, so that computing the
+        // next one can't wrap around, and a score below min inf means we were already computing
+        // from min inf and may have wrapped
+        if (low < min_inf || high > numeric_limits<IntType>::max() - max_step) {
+            return false;
+        }
+        // the traceback takes differences between scores
+        if (high - low + max_step > numeric_limits<IntType>::max()) {
+            return false;
+        }
+        // and alternate tracebacks are scored by adding those differences to other scores
+        if (alt_alignments && (2 * high - low + max_step > numeric_limits<IntType>::max() ||
+                               2 * low - high - max_step < numeric_limits<IntType>::min())) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+template <class IntType>
+void BandedGlobalAligner<IntType>::end_matrices(unordered_set<BAMatrix*>& source_node_matrices,
+                                                unordered_set<BAMatrix*>& sink_node_matrices) {
     for (const handle_t& node : sink_nodes) {
         sink_node_matrices.insert(banded_matrices[node_id_to_idx[graph.get_id(node)]]);
     }
     for (const handle_t& node : source_nodes) {
         source_node_matrices.insert(banded_matrices[node_id_to_idx[graph.get_id(node)]]);
     }
+}
+
+template <class IntType>
+int32_t BandedGlobalAligner<IntType>::optimal_score(int8_t gap_open, int8_t gap_extend, IntType min_inf) {
+    
+    unordered_set<BAMatrix*> sink_node_matrices;
+    unordered_set<BAMatrix*> source_node_matrices;
+    end_matrices(source_node_matrices, sink_node_matrices);
+    
+    int64_t read_length = alignment.sequence().length();
+    int32_t empty_score = read_length > 0 ? -gap_open - (read_length - 1) * gap_extend : 0;
+    
+    // the stack finds the optimal alignment when it is initialized
+    AltTracebackStack traceback_stack(graph, 1, empty_score, source_node_matrices, sink_node_matrices,
+                                      gap_open, gap_extend, min_inf);
+    
+    if (!traceback_stack.has_next()) {
+        // there is no alignment at all
+        return numeric_limits<int32_t>::min();
+    }
+    return traceback_stack.next_is_empty() ? empty_score : traceback_stack.current_traceback_score();
+}
+
+template <class IntType>
+void BandedGlobalAligner<IntType>::traceback(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend, IntType min_inf) {
+    
+    // get the sink and source node matrices for alignment stack
+    unordered_set<BAMatrix*> sink_node_matrices;
+    unordered_set<BAMatrix*> source_node_matrices;
+    end_matrices(source_node_matrices, sink_node_matrices);
     
     int64_t read_length = alignment.sequence().length();
     int32_t empty_score = read_length > 0 ? -gap_open - (read_length - 1) * gap_extend : 0;
@@ -2365,12 +2493,12 @@ void BandedGlobalAligner<IntType>::traceback(int8_t* score_mat, int8_t* nt_table
             while (node_id != 0) {
                 int64_t node_idx = node_id_to_idx[node_id];
                 // trace through the matrix
-                banded_matrices[node_idx]->traceback(graph, builder, traceback_stack, i, j, mat, in_lead_gap, score_mat,
-                                                     nt_table, gap_open, gap_extend, adjust_for_base_quality, min_inf);
+                banded_matrices[node_idx]->traceback(graph, builder, traceback_stack, i, j, mat, in_lead_gap,
+                                                     score_profile.data(), nt_table, gap_open, gap_extend, min_inf);
                 // trace over edges
                 banded_matrices[node_idx]->traceback_over_edge(graph, builder, traceback_stack, i, j, mat, in_lead_gap,
-                                                               node_id, score_mat, nt_table, gap_open, gap_extend,
-                                                               adjust_for_base_quality, min_inf);
+                                                               node_id, score_profile.data(), nt_table, gap_open,
+                                                               gap_extend, min_inf);
             }
             
             // construct the alignment path
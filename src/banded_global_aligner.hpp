@@ -99,6 +99,21 @@ namespace vg {
         ///              use QualAdjAligner's scaled penalty)
         void align(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend);
         
+        /// Same as align(), but for when IntType might be too narrow for the problem. After
+        /// filling the matrices, checks whether any score came close enough to the limits of
+        /// IntType that it or the traceback could have overflowed. If so, returns false without
+        /// touching the alignment, and the problem should be aligned again with a wider IntType.
+        /// Otherwise does the traceback and returns true.
+        bool align_checking_overflow(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend);
+        
+        /// Fill the dynamic programming matrices and return the score of the optimal alignment,
+        /// without doing the traceback or touching the alignment. Takes the same arguments as align().
+        int32_t score(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend);
+        
+        /// Same as score(), but returns false instead of setting score_out if the scores might
+        /// have overflowed IntType, like align_checking_overflow().
+        bool score_checking_overflow(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend,
+                                     int32_t& score_out);
         
     private:
         
@@ -119,6 +134,11 @@ namespace vg {
         /// Use base quality adjusted scoring for alignments?
         bool adjust_for_base_quality;
         
+        /// Score of each read base against each reference base, with the scores for read
+        /// base i at 5 * i through 5 * i + 4, indexed by the reference base's nt_table value.
+        /// Any quality adjustment is already applied, so the DP never needs the quality.
+        vector<int8_t> score_profile;
+        
         /// Dynamic programming matrices for each node
         vector<BAMatrix*> banded_matrices;
         
@@ -138,6 +158,23 @@ namespace vg {
                             bool adjust_for_base_quality = false,
                             const unordered_map<handle_t, bool>* left_align_strand = nullptr);
         
+        /// Build the score profile for the read from the score matrix
+        void build_score_profile(const int8_t* score_mat, const int8_t* nt_table);
+        
+        /// Fill the dynamic programming matrices of all nodes, and return the min inf value used
+        IntType fill_matrices(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend);
+        
+        /// Fill the dynamic programming matrices, unless the scores might overflow IntType. Returns
+        /// false if they might have, and otherwise sets min_inf to the min inf value used.
+        bool fill_matrices_checking_overflow(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend,
+                                             IntType& min_inf);
+        
+        /// After filling the matrices, get the score of the optimal alignment
+        int32_t optimal_score(int8_t gap_open, int8_t gap_extend, IntType min_inf);
+        
+        /// Get the matrices for the source and sink nodes
+        void end_matrices(unordered_set<BAMatrix*>& source_node_matrices, unordered_set<BAMatrix*>& sink_node_matrices);
+        
         /// Traceback through dynamic programming matrices to compute alignment
         void traceback(int8_t* score_mat, int8_t* nt_table, int8_t gap_open, int8_t gap_extend, IntType min_inf);
         
@@ -163,20 +200,24 @@ namespace vg {
         ~BAMatrix();
         
         /// Use DP to fill the band with alignment scores
-        void fill_matrix(const HandleGraph& graph, int8_t* score_mat, int8_t* nt_table, int8_t gap_open,
-                         int8_t gap_extend, bool qual_adjusted, IntType min_inf);
+        void fill_matrix(const HandleGraph& graph, const int8_t* score_profile, int8_t* nt_table, int8_t gap_open,
+                         int8_t gap_extend, IntType min_inf);
         
         void init_traceback_indexes(const HandleGraph& graph, int64_t& i, int64_t& j);
         
+        /// Widen low and high to include all the scores in the filled part of the band,
+        /// other than min inf
+        void score_range(const HandleGraph& graph, IntType min_inf, int64_t& low, int64_t& high) const;
+        
         void traceback(const HandleGraph& graph, BABuilder& builder, AltTracebackStack& traceback_stack,
                        int64_t& i, int64_t& j, matrix_t& mat, bool& in_lead_gap,
-                       const int8_t* score_mat, const int8_t* nt_table, const int8_t gap_open, const int8_t gap_extend,
-                       const bool qual_adjusted, IntType const min_inf);
+                       const int8_t* score_profile, const int8_t* nt_table, const int8_t gap_open, const int8_t gap_extend,
+                       IntType const min_inf);
         
         void traceback_over_edge(const HandleGraph& graph, BABuilder& builder, AltTracebackStack& traceback_stack,
                                  int64_t& i, int64_t& j, matrix_t& mat, bool& in_lead_gap, int64_t& node_id,
-                                 const int8_t* score_mat, const int8_t* nt_table, const int8_t gap_open,
-                                 const int8_t gap_extend, const bool qual_adjusted, IntType const min_inf);
+                                 const int8_t* score_profile, const int8_t* nt_table, const int8_t gap_open,
+                                 const int8_t gap_extend, IntType const min_inf);
         
         /// Debugging function
         void print_full_matrices(const HandleGraph& graph);
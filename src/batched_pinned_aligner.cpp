@@ -0,0 +1,536 @@
+/**
+ * \file batched_pinned_aligner.cpp
+ *
+ * Implements an aligner that does many small pinned alignments at once
+ *
+ */
+
+#include "batched_pinned_aligner.hpp"
+#include "reverse_graph.hpp"
+#include "null_masking_graph.hpp"
+#include "hash_map.hpp"
+#include "path.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <simde/x86/sse2.h>
+
+//#define debug_batched_pinned_aligner
+
+namespace vg {
+
+constexpr size_t BatchedPinnedAligner::LANES;
+const size_t BatchedPinnedAligner::MAX_CELLS = 1 << 17;
+
+/// Score for cells that can't be reached. Low enough that nothing reachable
+/// gets near it, and high enough that subtracting gap scores can't saturate.
+static const int16_t UNREACHABLE = -16384;
+/// Highest score we allow a problem to be able to reach.
+static const int32_t MAX_SCORE = 16384;
+
+struct BatchedPinnedAligner::Layout {
+    /// The read as base codes, oriented so the alignment is pinned at its end
+    vector<int16_t> read;
+    /// The base qualities, in the same orientation, if using them
+    vector<uint8_t> quality;
+    /// The full length bonus for the free end of the read
+    int16_t bonus;
+    /// The graph's bases as base codes, in topological order
+    vector<int16_t> ref;
+    /// The graph's bases as (cleaned) characters
+    string ref_chars;
+    /// The node each column belongs to
+    vector<id_t> column_node;
+    /// The offset of each column in its node, in the unreversed graph
+    vector<uint32_t> column_offset;
+    /// Where each column's predecessors start in preds
+    vector<uint32_t> pred_start;
+    /// The columns that come before each column
+    vector<uint32_t> preds;
+    /// Whether each column's only predecessor is the column before it
+    vector<bool> linear;
+    /// The columns an alignment may end at
+    vector<uint32_t> pinning_columns;
+};
+
+BatchedPinnedAligner::BatchedPinnedAligner(const int8_t* score_matrix, const int8_t* nt_table,
+                                           int8_t gap_open, int8_t gap_extension, int8_t full_length_bonus,
+                                           const int8_t* qual_adj_full_length_bonuses)
+    : score_matrix(score_matrix), nt_table(nt_table), gap_open(gap_open), gap_extension(gap_extension),
+      full_length_bonus(full_length_bonus), qual_adj_full_length_bonuses(qual_adj_full_length_bonuses)
+{
+
+}
+
+bool BatchedPinnedAligner::make_layout(const PinnedAlignmentProblem& problem, Layout& layout) const {
+
+    const Alignment& alignment = *problem.alignment;
+    const string& sequence = alignment.sequence();
+    bool qual_adjusted = qual_adj_full_length_bonuses != nullptr;
+    if (sequence.empty() || (qual_adjusted && alignment.quality().size() != sequence.size())) {
+        return false;
+    }
+
+    // like GSSW, we always pin on the right, so pinning left means reversing everything
+    ReverseGraph reversed_graph(problem.graph, false);
+    const HandleGraph* oriented_graph = problem.pin_left ? (const HandleGraph*) &reversed_graph : problem.graph;
+    NullMaskingGraph masked_graph(oriented_graph);
+    if (masked_graph.get_node_count() == 0) {
+        return false;
+    }
+
+    // find the non-empty nodes closest to the sinks, which we pin to
+    unordered_set<id_t> pinning_ids;
+    for (const handle_t& sink : handlealgs::tail_nodes(oriented_graph)) {
+        vector<handle_t> stack(1, sink);
+        while (!stack.empty()) {
+            handle_t here = stack.back();
+            stack.pop_back();
+            if (oriented_graph->get_length(here) > 0) {
+                pinning_ids.insert(oriented_graph->get_id(here));
+            }
+            else {
+                oriented_graph->follow_edges(here, true, [&](const handle_t& prev) {
+                    if (!pinning_ids.count(oriented_graph->get_id(prev))) {
+                        stack.push_back(prev);
+                    }
+                });
+            }
+        }
+    }
+
+    size_t total_length = 0;
+    masked_graph.for_each_handle([&](const handle_t& handle) {
+        total_length += masked_graph.get_length(handle);
+    });
+    if (total_length * sequence.size() > MAX_CELLS) {
+        return false;
+    }
+
+    // lay out the read
+    layout.read.resize(sequence.size());
+    layout.quality.clear();
+    for (size_t i = 0; i < sequence.size(); ++i) {
+        size_t k = problem.pin_left ? sequence.size() - i - 1 : i;
+        layout.read[i] = nt_table[(uint8_t) sequence[k]];
+        if (qual_adjusted) {
+            layout.quality.push_back(alignment.quality()[k]);
+        }
+    }
+    layout.bonus = qual_adjusted ? qual_adj_full_length_bonuses[layout.quality.front()] : full_length_bonus;
+
+    // make sure the best possible score fits comfortably in 16 bits
+    int32_t max_score = layout.bonus;
+    for (size_t i = 0; i < layout.read.size(); ++i) {
+        const int8_t* matrix = score_matrix + (qual_adjusted ? 25 * layout.quality[i] : 0);
+        int32_t best = 0;
+        for (size_t c = 0; c < 5; ++c) {
+            best = max<int32_t>(best, matrix[c * 5 + layout.read[i]]);
+        }
+        max_score += best;
+    }
+    if (max_score >= MAX_SCORE) {
+        return false;
+    }
+
+    // lay out the graph in topological order
+    layout.ref.clear();
+    layout.ref_chars.clear();
+    layout.column_node.clear();
+    layout.column_offset.clear();
+    layout.pred_start.clear();
+    layout.preds.clear();
+    layout.linear.clear();
+    layout.pinning_columns.clear();
+    hash_map<handle_t, uint32_t> last_column;
+    for (const handle_t& handle : handlealgs::lazier_topological_order(&masked_graph)) {
+        if (masked_graph.get_is_reverse(handle)) {
+            // GSSW takes these on forward strand IDs, so leave it to GSSW
+            return false;
+        }
+        string node_sequence = masked_graph.get_sequence(handle);
+        id_t node_id = masked_graph.get_id(handle);
+        for (size_t k = 0; k < node_sequence.size(); ++k) {
+            char base = node_sequence[k];
+            if (base != 'A' && base != 'T' && base != 'G' && base != 'C' && base != 'N') {
+                base = 'N';
+            }
+            uint32_t column = layout.ref.size();
+            layout.ref.push_back(nt_table[(uint8_t) base]);
+            layout.ref_chars.push_back(base);
+            layout.column_node.push_back(node_id);
+            layout.column_offset.push_back(problem.pin_left ? node_sequence.size() - k - 1 : k);
+            layout.pred_start.push_back(layout.preds.size());
+            if (k > 0) {
+                layout.preds.push_back(column - 1);
+                layout.linear.push_back(true);
+            }
+            else {
+                masked_graph.follow_edges(handle, true, [&](const handle_t& prev) {
+                    auto it = last_column.find(prev);
+                    if (it != last_column.end()) {
+                        layout.preds.push_back(it->second);
+                    }
+                });
+                layout.linear.push_back(layout.preds.size() == layout.pred_start.back() + 1 &&
+                                        layout.preds.back() + 1 == column);
+            }
+        }
+        uint32_t last = layout.ref.size() - 1;
+        last_column[handle] = last;
+        if (pinning_ids.count(node_id)) {
+            layout.pinning_columns.push_back(last);
+        }
+    }
+    layout.pred_start.push_back(layout.preds.size());
+
+    return !layout.pinning_columns.empty();
+}
+
+vector<bool> BatchedPinnedAligner::align(const vector<PinnedAlignmentProblem>& problems) const {
+
+    vector<bool> aligned(problems.size(), false);
+
+    // lay out everything we can take
+    vector<Layout> layouts(problems.size());
+    vector<size_t> order;
+    order.reserve(problems.size());
+    for (size_t i = 0; i < problems.size(); ++i) {
+        if (make_layout(problems[i], layouts[i])) {
+            order.push_back(i);
+        }
+    }
+
+    // group similarly sized problems, so lanes don't spend much time on padding
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return layouts[a].ref.size() * layouts[a].read.size() < layouts[b].ref.size() * layouts[b].read.size();
+    });
+
+    vector<size_t> group;
+    for (size_t i = 0; i < order.size(); i += LANES) {
+        group.assign(order.begin() + i, order.begin() + min(order.size(), i + LANES));
+        align_group(problems, layouts, group, aligned);
+    }
+
+    return aligned;
+}
+
+void BatchedPinnedAligner::align_group(const vector<PinnedAlignmentProblem>& problems, vector<Layout>& layouts,
+                                       const vector<size_t>& group, vector<bool>& aligned) const {
+
+    size_t rows = 0;
+    size_t cols = 0;
+    for (size_t p : group) {
+        rows = max(rows, layouts[p].read.size());
+        cols = max(cols, layouts[p].ref.size());
+    }
+    bool qual_adjusted = qual_adj_full_length_bonuses != nullptr;
+
+    // reuse this thread's DP matrices, interleaved so that each cell holds one score per lane
+    thread_local vector<int16_t> H, E, F, ref_codes;
+    thread_local vector<bool> linear;
+    H.resize(rows * cols * LANES);
+    E.resize(rows * cols * LANES);
+    F.resize(rows * cols * LANES);
+    ref_codes.assign(cols * LANES, -1);
+    linear.assign(cols, true);
+    for (size_t l = 0; l < group.size(); ++l) {
+        const Layout& layout = layouts[group[l]];
+        for (size_t j = 0; j < layout.ref.size(); ++j) {
+            ref_codes[j * LANES + l] = layout.ref[j];
+            if (!layout.linear[j]) {
+                linear[j] = false;
+            }
+        }
+    }
+
+    auto load = [](const vector<int16_t>& matrix, size_t cell) {
+        return simde_mm_loadu_si128((const simde__m128i*) (matrix.data() + cell * LANES));
+    };
+    auto store = [](vector<int16_t>& matrix, size_t cell, simde__m128i value) {
+        simde_mm_storeu_si128((simde__m128i*) (matrix.data() + cell * LANES), value);
+    };
+
+    const simde__m128i zero = simde_mm_setzero_si128();
+    const simde__m128i unreachable = simde_mm_set1_epi16(UNREACHABLE);
+    const simde__m128i open = simde_mm_set1_epi16(gap_open);
+    const simde__m128i extend = simde_mm_set1_epi16(gap_extension);
+    simde__m128i codes[5];
+    for (int16_t c = 0; c < 5; ++c) {
+        codes[c] = simde_mm_set1_epi16(c);
+    }
+
+    alignas(16) int16_t profile_lanes[5][LANES];
+    alignas(16) int16_t diag_lanes[LANES];
+    alignas(16) int16_t del_lanes[LANES];
+    simde__m128i profile[5];
+
+    for (size_t i = 0; i < rows; ++i) {
+
+        // score each read base against each possible reference base
+        for (size_t l = 0; l < LANES; ++l) {
+            for (size_t c = 0; c < 5; ++c) {
+                profile_lanes[c][l] = 0;
+            }
+            if (l < group.size() && i < layouts[group[l]].read.size()) {
+                const Layout& layout = layouts[group[l]];
+                const int8_t* matrix = score_matrix + (qual_adjusted ? 25 * layout.quality[i] : 0);
+                for (size_t c = 0; c < 5; ++c) {
+                    profile_lanes[c][l] = matrix[c * 5 + layout.read[i]] + (i == 0 ? layout.bonus : 0);
+                }
+            }
+        }
+        for (size_t c = 0; c < 5; ++c) {
+            profile[c] = simde_mm_load_si128((const simde__m128i*) profile_lanes[c]);
+        }
+
+        for (size_t j = 0; j < cols; ++j) {
+            size_t cell = i * cols + j;
+
+            simde__m128i ref = simde_mm_loadu_si128((const simde__m128i*) (ref_codes.data() + j * LANES));
+            simde__m128i match = zero;
+            for (size_t c = 0; c < 5; ++c) {
+                match = simde_mm_or_si128(match, simde_mm_and_si128(simde_mm_cmpeq_epi16(ref, codes[c]), profile[c]));
+            }
+
+            simde__m128i diag, del;
+            if (linear[j]) {
+                // every lane continues along a node, so we can do them all at once
+                diag = i > 0 ? load(H, cell - cols - 1) : zero;
+                del = simde_mm_max_epi16(simde_mm_subs_epi16(load(H, cell - 1), open),
+                                         simde_mm_subs_epi16(load(F, cell - 1), extend));
+            }
+            else {
+                // some lane is at the start of a node, so we look up predecessors lane by lane
+                for (size_t l = 0; l < LANES; ++l) {
+                    diag_lanes[l] = 0;
+                    del_lanes[l] = UNREACHABLE;
+                    if (l < group.size() && j < layouts[group[l]].ref.size()) {
+                        const Layout& layout = layouts[group[l]];
+                        for (size_t k = layout.pred_start[j]; k < layout.pred_start[j + 1]; ++k) {
+                            size_t pred = layout.preds[k];
+                            if (i > 0) {
+                                diag_lanes[l] = max(diag_lanes[l], H[((i - 1) * cols + pred) * LANES + l]);
+                            }
+                            del_lanes[l] = max<int16_t>(del_lanes[l],
+                                                        max(H[(i * cols + pred) * LANES + l] - gap_open,
+                                                            F[(i * cols + pred) * LANES + l] - gap_extension));
+                        }
+                    }
+                }
+                diag = simde_mm_load_si128((const simde__m128i*) diag_lanes);
+                del = simde_mm_load_si128((const simde__m128i*) del_lanes);
+            }
+
+            simde__m128i ins = i > 0 ? simde_mm_max_epi16(simde_mm_subs_epi16(load(H, cell - cols), open),
+                                                          simde_mm_subs_epi16(load(E, cell - cols), extend))
+                                     : unreachable;
+            del = simde_mm_max_epi16(del, unreachable);
+            ins = simde_mm_max_epi16(ins, unreachable);
+
+            simde__m128i score = simde_mm_max_epi16(simde_mm_max_epi16(simde_mm_adds_epi16(diag, match), zero),
+                                                    simde_mm_max_epi16(ins, del));
+            store(H, cell, score);
+            store(E, cell, ins);
+            store(F, cell, del);
+        }
+    }
+
+    // trace back each lane from its best pinning point
+    vector<pair<char, size_t>> ops;
+    for (size_t l = 0; l < group.size(); ++l) {
+        const PinnedAlignmentProblem& problem = problems[group[l]];
+        const Layout& layout = layouts[group[l]];
+        auto at = [&](const vector<int16_t>& matrix, size_t i, size_t j) {
+            return (int32_t) matrix[(i * cols + j) * LANES + l];
+        };
+        auto base_score = [&](size_t i, size_t j) {
+            const int8_t* matrix = score_matrix + (qual_adjusted ? 25 * layout.quality[i] : 0);
+            return (int32_t) matrix[layout.ref[j] * 5 + layout.read[i]] + (i == 0 ? layout.bonus : 0);
+        };
+
+        size_t i = layout.read.size() - 1;
+        size_t j = layout.pinning_columns.front();
+        for (uint32_t column : layout.pinning_columns) {
+            if (at(H, i, column) > at(H, i, j)) {
+                j = column;
+            }
+        }
+        int32_t score = at(H, i, j);
+        if (score <= 0) {
+            // GSSW makes a soft clip for these, so let it
+            continue;
+        }
+
+        ops.clear();
+        char state = 'H';
+        size_t clip_length = 0;
+        while (true) {
+            if (state == 'H') {
+                int32_t value = at(H, i, j);
+                int32_t match = base_score(i, j);
+                bool found = false;
+                if (i > 0) {
+                    for (size_t k = layout.pred_start[j]; k < layout.pred_start[j + 1]; ++k) {
+                        size_t pred = layout.preds[k];
+                        if (at(H, i - 1, pred) > 0 && at(H, i - 1, pred) + match == value) {
+                            ops.emplace_back('M', j);
+                            --i;
+                            j = pred;
+                            found = true;
+                            break;
+                        }
+                    }
+                }
+                if (found) {
+                    continue;
+                }
+                if (value == match) {
+                    // the alignment starts here
+                    ops.emplace_back('M', j);
+                    clip_length = i;
+                    break;
+                }
+                else if (i > 0 && value == at(E, i, j)) {
+                    state = 'E';
+                }
+                else if (value == at(F, i, j)) {
+                    state = 'F';
+                }
+                else {
+                    throw runtime_error("error:[BatchedPinnedAligner] traceback failed");
+                }
+            }
+            else if (state == 'E') {
+                ops.emplace_back('I', i);
+                if (at(E, i, j) == at(H, i - 1, j) - gap_open) {
+                    state = 'H';
+                }
+                --i;
+            }
+            else {
+                ops.emplace_back('D', j);
+                bool found = false;
+                for (size_t k = layout.pred_start[j]; k < layout.pred_start[j + 1] && !found; ++k) {
+                    if (at(F, i, j) == at(H, i, layout.preds[k]) - gap_open) {
+                        state = 'H';
+                        j = layout.preds[k];
+                        found = true;
+                    }
+                }
+                for (size_t k = layout.pred_start[j]; k < layout.pred_start[j + 1] && !found; ++k) {
+                    if (at(F, i, j) == at(F, i, layout.preds[k]) - gap_extension) {
+                        j = layout.preds[k];
+                        found = true;
+                    }
+                }
+                if (!found) {
+                    throw runtime_error("error:[BatchedPinnedAligner] traceback failed");
+                }
+            }
+        }
+
+        // put the operations in read order, in the unreversed orientation
+        if (!problem.pin_left) {
+            reverse(ops.begin(), ops.end());
+        }
+
+#ifdef debug_batched_pinned_aligner
+        cerr << "lane " << l << " of " << group.size() << " aligned with score " << score << " and clip " << clip_length << endl;
+#endif
+
+        write_alignment(problem, layout, ops, clip_length, score);
+        aligned[group[l]] = true;
+    }
+}
+
+void BatchedPinnedAligner::write_alignment(const PinnedAlignmentProblem& problem, const Layout& layout,
+                                           const vector<pair<char, size_t>>& ops, size_t clip_length,
+                                           int32_t score) const {
+
+    Alignment& alignment = *problem.alignment;
+    const string& sequence = alignment.sequence();
+    alignment.clear_path();
+    alignment.set_score(score);
+    alignment.set_query_position(0);
+    Path* path = alignment.mutable_path();
+
+    // the unaligned part of the read comes first unless we reversed
+    size_t read_pos = 0;
+    size_t leading_clip = problem.pin_left ? 0 : clip_length;
+
+    Mapping* mapping = nullptr;
+    size_t next_offset = 0;
+    for (const pair<char, size_t>& op : ops) {
+        if (op.first == 'I' && !mapping) {
+            // an insertion against the pinned end, which goes before the first mapping's bases
+            ++leading_clip;
+            continue;
+        }
+        else if (op.first == 'I') {
+            Edit* edit = mapping->mutable_edit(mapping->edit_size() - 1);
+            if (edit->from_length() != 0 || edit->to_length() == 0) {
+                edit = mapping->add_edit();
+            }
+            edit->set_to_length(edit->to_length() + 1);
+            edit->mutable_sequence()->push_back(sequence[read_pos]);
+            ++read_pos;
+            continue;
+        }
+
+        size_t column = op.second;
+        if (!mapping || mapping->position().node_id() != layout.column_node[column]
+            || next_offset != layout.column_offset[column]) {
+            // start a new mapping
+            mapping = path->add_mapping();
+            mapping->mutable_position()->set_node_id(layout.column_node[column]);
+            mapping->mutable_position()->set_offset(layout.column_offset[column]);
+            mapping->set_rank(path->mapping_size());
+            if (leading_clip) {
+                Edit* edit = mapping->add_edit();
+                edit->set_to_length(leading_clip);
+                edit->set_sequence(sequence.substr(0, leading_clip));
+                read_pos = leading_clip;
+                leading_clip = 0;
+            }
+        }
+        next_offset = layout.column_offset[column] + 1;
+
+        Edit* edit = mapping->edit_size() ? mapping->mutable_edit(mapping->edit_size() - 1) : nullptr;
+        if (op.first == 'D') {
+            if (!edit || edit->to_length() != 0) {
+                edit = mapping->add_edit();
+            }
+            edit->set_from_length(edit->from_length() + 1);
+        }
+        else if (sequence[read_pos] == layout.ref_chars[column]) {
+            if (!edit || edit->from_length() != edit->to_length() || edit->from_length() == 0 || !edit->sequence().empty()) {
+                edit = mapping->add_edit();
+            }
+            edit->set_from_length(edit->from_length() + 1);
+            edit->set_to_length(edit->to_length() + 1);
+            ++read_pos;
+        }
+        else {
+            // mismatches each get their own edit
+            edit = mapping->add_edit();
+            edit->set_from_length(1);
+            edit->set_to_length(1);
+            edit->set_sequence(sequence.substr(read_pos, 1));
+            ++read_pos;
+        }
+    }
+
+    if (read_pos < sequence.size()) {
+        // soft clip the rest
+        Edit* edit = mapping->add_edit();
+        edit->set_to_length(sequence.size() - read_pos);
+        edit->set_sequence(sequence.substr(read_pos));
+    }
+
+    alignment.set_identity(identity(alignment.path()));
+}
+
+}
@@ -0,0 +1,97 @@
+/**
+ * \file batched_pinned_aligner.hpp
+ *
+ * Defines an aligner that does many small pinned alignments at once, with
+ * one alignment problem in each SIMD lane
+ *
+ */
+#ifndef VG_BATCHED_PINNED_ALIGNER_HPP_INCLUDED
+#define VG_BATCHED_PINNED_ALIGNER_HPP_INCLUDED
+
+#include <cstdint>
+#include <vector>
+#include <vg/vg.pb.h>
+
+#include "handle.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/*
+ * One read (or read tail) to be aligned pinned against its own graph as part
+ * of a batch. Pinning follows the same conventions as
+ * GSSWAligner::align_pinned().
+ */
+struct PinnedAlignmentProblem {
+    Alignment* alignment;
+    const HandleGraph* graph;
+    bool pin_left;
+};
+
+/*
+ * An aligner for batches of short pinned alignments against small DAGs, like
+ * read tails. Rather than vectorizing within one alignment, it runs up to
+ * LANES independent alignments side by side, one per 16-bit SIMD lane, so a
+ * batch of 150 bp tails fills the vector units even though no one of them
+ * is big enough to. Each graph is laid out as a topologically sorted array of
+ * bases, so lanes only need to be handled separately at columns where some
+ * lane's graph branches or merges.
+ *
+ * Produces optimal alignments with the same scores as GSSW's pinned alignment,
+ * though ties may be broken differently. Does not do multiple tracebacks.
+ */
+class BatchedPinnedAligner {
+public:
+
+    /// Make an aligner using a 5x5 score matrix, indexed by reference base
+    /// and then read base, with N as the 5th base. If qual_adj_full_length_bonuses
+    /// is set, the score matrix is instead a stack of such matrices, one for
+    /// each base quality, and the full length bonus also depends on quality.
+    /// Nothing is copied, so the arrays must outlive the aligner.
+    BatchedPinnedAligner(const int8_t* score_matrix, const int8_t* nt_table,
+                         int8_t gap_open, int8_t gap_extension, int8_t full_length_bonus,
+                         const int8_t* qual_adj_full_length_bonuses = nullptr);
+    ~BatchedPinnedAligner() = default;
+
+    /// Align as many of the problems as we can, and return whether each
+    /// one was aligned. Problems that are empty, too big, would overflow
+    /// 16-bit scores, or have no positive-scoring alignment are skipped, and
+    /// should be aligned with the GSSW-based aligner instead.
+    vector<bool> align(const vector<PinnedAlignmentProblem>& problems) const;
+
+    /// Number of alignments we can run at once
+    static constexpr size_t LANES = 8;
+    /// Most DP cells we will allow for any one problem
+    static const size_t MAX_CELLS;
+
+private:
+
+    /// A problem laid out as arrays, in the orientation where the alignment
+    /// is pinned to the right.
+    struct Layout;
+
+    /// Lay out the problem, or return false if we can't take it.
+    bool make_layout(const PinnedAlignmentProblem& problem, Layout& layout) const;
+
+    /// Align a group of at most LANES laid out problems together, and
+    /// write the alignments for those that scored above 0.
+    void align_group(const vector<PinnedAlignmentProblem>& problems, vector<Layout>& layouts,
+                     const vector<size_t>& group, vector<bool>& aligned) const;
+
+    /// Write the alignment for a traced back problem into its Alignment
+    void write_alignment(const PinnedAlignmentProblem& problem, const Layout& layout,
+                         const vector<pair<char, size_t>>& ops, size_t clip_length,
+                         int32_t score) const;
+
+    const int8_t* score_matrix;
+    const int8_t* nt_table;
+    int16_t gap_open;
+    int16_t gap_extension;
+    int8_t full_length_bonus;
+    const int8_t* qual_adj_full_length_bonuses;
+};
+
+}
+
+#endif
@@ -4,7 +4,17 @@
 #include <cassert>
 #include <numeric>
 #include <cmath>
+#include <cstring>
 #include <iomanip>
+#include <limits>
+#include <memory>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <asm/unistd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
 
 /**
  * \file benchmark.hpp: implementations of benchmarking functions
@@ -13,6 +23,129 @@
 namespace vg {
 using namespace std;
 
+/// Should benchmarks collect hardware performance counters?
+static bool use_benchmark_counters = false;
+
+void set_benchmark_counters(bool enabled) {
+    use_benchmark_counters = enabled;
+}
+
+/**
+ * Set of hardware performance counters for the calling thread, which can be
+ * started and stopped around a function under test.
+ */
+class BenchmarkCounters {
+public:
+    /// How many counters do we track?
+    static const size_t COUNTER_COUNT = 4;
+    
+    /// Open the counters. Any that can't be opened will read as NaN.
+    BenchmarkCounters();
+    /// Close the counters.
+    ~BenchmarkCounters();
+    
+    /// Are any counters working?
+    bool any_open() const;
+    
+    /// Zero and start all the counters.
+    void start();
+    /// Stop all the counters.
+    void stop();
+    /// Get the value of each counter since the last start(), or NaN if it is
+    /// not available.
+    void read(double values[COUNTER_COUNT]) const;
+    
+private:
+    /// File descriptor for each counter, or -1 if not open.
+    int fds[COUNTER_COUNT];
+};
+
+#ifdef __linux__
+/// Bind perf_event_open, which has no glibc wrapper.
+static long perf_event_open(struct perf_event_attr* hw_event, pid_t pid, int cpu, int group_fd, unsigned long flags) {
+    return syscall(__NR_perf_event_open, hw_event, pid, cpu, group_fd, flags);
+}
+#endif
+
+BenchmarkCounters::BenchmarkCounters() {
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        fds[i] = -1;
+    }
+#ifdef __linux__
+    // These go in the same order as the BenchmarkResult fields.
+    const uint64_t configs[COUNTER_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        struct perf_event_attr config;
+        memset(&config, 0, sizeof(struct perf_event_attr));
+        config.type = PERF_TYPE_HARDWARE;
+        config.size = sizeof(struct perf_event_attr);
+        config.config = configs[i];
+        config.disabled = 1;
+        // Only count our own code, so unprivileged users can count too.
+        config.exclude_kernel = 1;
+        config.exclude_hv = 1;
+        fds[i] = perf_event_open(&config, 0, -1, -1, 0);
+    }
+#endif
+}
+
+BenchmarkCounters::~BenchmarkCounters() {
+#ifdef __linux__
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+#endif
+}
+
+bool BenchmarkCounters::any_open() const {
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        if (fds[i] >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BenchmarkCounters::start() {
+#ifdef __linux__
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        if (fds[i] >= 0) {
+            ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+void BenchmarkCounters::stop() {
+#ifdef __linux__
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        if (fds[i] >= 0) {
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+#endif
+}
+
+void BenchmarkCounters::read(double values[COUNTER_COUNT]) const {
+    for (size_t i = 0; i < COUNTER_COUNT; i++) {
+        values[i] = numeric_limits<double>::quiet_NaN();
+#ifdef __linux__
+        long long count;
+        if (fds[i] >= 0 && ::read(fds[i], &count, sizeof(long long)) == sizeof(long long)) {
+            values[i] = count;
+        }
+#endif
+    }
+}
+
 double BenchmarkResult::score() const {
     // We comnpute a score in points by comparing the experimental and control runtimes.
     // Higher is better.
@@ -73,6 +206,18 @@ ostream& operator<<(ostream& out, const BenchmarkResult& result) {
     out << "\t";
     out << result.score_error();
     out << "\t";
+    if (result.has_counters) {
+        // Counts are big, so show them in scientific notation.
+        out << scientific;
+        out << result.test_cycles;
+        out << "\t";
+        out << result.test_instructions;
+        out << "\t";
+        out << result.test_cache_misses;
+        out << "\t";
+        out << result.test_branch_misses;
+        out << "\t";
+    }
     out << result.name;
     
     out.precision(initial_precision);
@@ -132,6 +277,19 @@ BenchmarkResult run_benchmark(const string& name, size_t iterations, const funct
     test_samples.reserve(iterations);
     control_samples.reserve(iterations);
     
+    // If we want hardware counters, set them up, and keep totals for each.
+    unique_ptr<BenchmarkCounters> counters;
+    if (use_benchmark_counters) {
+        counters.reset(new BenchmarkCounters());
+        static bool warned = false;
+        if (!counters->any_open() && !warned) {
+            // Keep going, so the report still has the columns, but with NaNs.
+            cerr << "warning[vg::run_benchmark]: could not open any hardware performance counters" << endl;
+            warned = true;
+        }
+    }
+    double counter_totals[BenchmarkCounters::COUNTER_COUNT] = {0, 0, 0, 0};
+    
     for (size_t i = 0; i < iterations; i++) {
         // For each iteration
         
@@ -139,9 +297,21 @@ BenchmarkResult run_benchmark(const string& name, size_t iterations, const funct
         setup();
         
         // Run the function under test
+        if (counters) {
+            counters->start();
+        }
         auto test_start = chrono::high_resolution_clock::now();
         under_test();
         auto test_stop = chrono::high_resolution_clock::now();
+        if (counters) {
+            counters->stop();
+            double values[BenchmarkCounters::COUNTER_COUNT];
+            counters->read(values);
+            for (size_t j = 0; j < BenchmarkCounters::COUNTER_COUNT; j++) {
+                // Unavailable counters stay NaN
+                counter_totals[j] += values[j];
+            }
+        }
         
         // And run the control
         auto control_start = chrono::high_resolution_clock::now();
@@ -183,6 +353,14 @@ BenchmarkResult run_benchmark(const string& name, size_t iterations, const funct
     to_return.control_stddev = benchtime((benchtime::rep) sqrt(control_square_total / iterations -
         to_return.control_mean.count() * to_return.control_mean.count()));
     
+    if (counters) {
+        to_return.has_counters = true;
+        to_return.test_cycles = counter_totals[0] / iterations;
+        to_return.test_instructions = counter_totals[1] / iterations;
+        to_return.test_cache_misses = counter_totals[2] / iterations;
+        to_return.test_branch_misses = counter_totals[3] / iterations;
+    }
+    
     return to_return;
     
 }
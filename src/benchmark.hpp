@@ -36,6 +36,16 @@ struct BenchmarkResult {
     benchtime control_stddev;
     /// What was the name of the test being run
     string name;
+    /// Were hardware performance counters collected for the test runs?
+    bool has_counters = false;
+    /// Mean CPU cycles per test run, or NaN if not available
+    double test_cycles = 0;
+    /// Mean instructions retired per test run, or NaN if not available
+    double test_instructions = 0;
+    /// Mean cache misses per test run, or NaN if not available
+    double test_cache_misses = 0;
+    /// Mean branch mispredictions per test run, or NaN if not available
+    double test_branch_misses = 0;
     /// How many control-standardized "points" do we score?
     double score() const;
     /// What is the uncertainty on the score?
@@ -43,10 +53,19 @@ struct BenchmarkResult {
 };
 
 /**
- * Benchmark results can be output to streams
+ * Benchmark results can be output to streams. If hardware counters were
+ * collected, their per-run means are output after the score error.
  */
 ostream& operator<<(ostream& out, const BenchmarkResult& result);
 
+/**
+ * Turn on or off collection of hardware performance counters (cycles,
+ * instructions, cache misses, and branch misses) for the test function in
+ * benchmarks run after this. Only works on Linux, and only if the kernel lets
+ * us use perf events; otherwise results will not have counters.
+ */
+void set_benchmark_counters(bool enabled);
+
 /**
  * The benchmark control function, designed to take some amount of time that might vary with CPU load.
  */
@@ -7,6 +7,7 @@
 
 #include "subgraph_overlay.hpp"
 #include "handle.hpp"
+#include "algorithms/component.hpp"
 
 #include "cactus_snarl_finder.hpp"
 
@@ -74,7 +75,7 @@ SnarlManager CactusSnarlFinder::find_snarls() {
 
 SnarlManager CactusSnarlFinder::find_snarls_parallel() {
 
-    vector<unordered_set<id_t>> weak_components = handlealgs::weakly_connected_components(graph);
+    vector<unordered_set<id_t>> weak_components = algorithms::weakly_connected_components_parallel(*graph);
     vector<SnarlManager> snarl_managers(weak_components.size());
 
 #pragma omp parallel for schedule(dynamic, 1)
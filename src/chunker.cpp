@@ -21,7 +21,8 @@ PathChunker::~PathChunker() {
 }
 
 void PathChunker::extract_subgraph(const Region& region, int64_t context, int64_t length, bool forward_only,
-                                   MutablePathMutableHandleGraph& subgraph, Region& out_region) {
+                                   MutablePathMutableHandleGraph& subgraph, Region& out_region,
+                                   const set<pair<pair<id_t, bool>, pair<id_t, bool>>>* path_edge_set) {
     // This method still depends on VG
     // (not a super high priority to port, as calling can now be done at genome scale and we no longer
     // have to chunk up paths)
@@ -129,11 +130,14 @@ void PathChunker::extract_subgraph(const Region& region, int64_t context, int64_
     bool end_points_on_cycle = start_node_path_steps.size() > 1 || end_node_path_steps.size() > 1;
     
     // keep track of the edges in our original path
-    set<pair<pair<id_t, bool>, pair<id_t, bool>>> path_edge_set =
+    set<pair<pair<id_t, bool>, pair<id_t, bool>>> own_path_edge_set;
+    if (path_edge_set == nullptr) {
         // walking out with the context length (as supported below) won't always work as expansion
         // can grab an arbitrary amount of path regardless of context.  so we load up the entire path:
         // (todo: could sniff out limits from subgraph...)
-        get_path_edge_index(graph->path_begin(path_handle), graph->path_back(path_handle), std::max(context, length));
+        own_path_edge_set = get_path_edge_index(graph->path_begin(path_handle), graph->path_back(path_handle), std::max(context, length));
+        path_edge_set = &own_path_edge_set;
+    }
     
     // the distance between them and the nodes in our input range
     size_t left_padding = 0;
@@ -163,7 +167,7 @@ void PathChunker::extract_subgraph(const Region& region, int64_t context, int64_
                 handle_t cur_handle = vg_subgraph->get_handle(cur_it->node_id(),
                                                           cur_it->is_reverse());
                 edge_t edge = vg_subgraph->edge_handle(cur_handle, prev_handle);
-                if (!path_edge_set.count(make_pair(make_pair(vg_subgraph->get_id(edge.first), vg_subgraph->get_is_reverse(edge.first)),
+                if (!path_edge_set->count(make_pair(make_pair(vg_subgraph->get_id(edge.first), vg_subgraph->get_is_reverse(edge.first)),
                                                    make_pair(vg_subgraph->get_id(edge.second), vg_subgraph->get_is_reverse(edge.second))))) {
 #ifdef debug
 #pragma omp critical(cerr)
@@ -187,7 +191,7 @@ void PathChunker::extract_subgraph(const Region& region, int64_t context, int64_
             handle_t cur_handle = vg_subgraph->get_handle(cur_it->node_id(),
                                                       cur_it->is_reverse());
             edge_t edge = vg_subgraph->edge_handle(prev_handle, cur_handle);
-            if (!path_edge_set.count(make_pair(make_pair(vg_subgraph->get_id(edge.first), vg_subgraph->get_is_reverse(edge.first)),
+            if (!path_edge_set->count(make_pair(make_pair(vg_subgraph->get_id(edge.first), vg_subgraph->get_is_reverse(edge.first)),
                                                make_pair(vg_subgraph->get_id(edge.second), vg_subgraph->get_is_reverse(edge.second))))) {
 #ifdef debug
 #pragma omp critical(cerr)
@@ -37,9 +37,14 @@ public:
      *
      * NOTE: we follow convention of Region coordinates being 0-based 
      * inclusive. 
+     *
+     * If path_edge_set is given, it must be the result of get_path_edge_index()
+     * over the whole path, as it would be computed here. This lets many
+     * regions on the same path share one index.
      * */
     void extract_subgraph(const Region& region, int64_t context, int64_t length, bool forward_only,
-                          MutablePathMutableHandleGraph& subgraph, Region& out_region);
+                          MutablePathMutableHandleGraph& subgraph, Region& out_region,
+                          const set<pair<pair<id_t, bool>, pair<id_t, bool>>>* path_edge_set = nullptr);
 
 
     /** Extract the region along the given path, and any snarls fully contained in it. This will often 
@@ -1,6 +1,9 @@
 #include "clip.hpp"
 #include "traversal_finder.hpp"
 #include <unordered_map>
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <IntervalTree.h>
 #include <structures/rank_pairing_heap.hpp>
 #include <BooPHF.h>
@@ -477,6 +480,59 @@ struct BBEdgeHash {
     }
 };
 
+/**
+ * Saturating counters packed into words, which can be bumped from many threads
+ * at once. Each counter only uses enough bits to count up to the limit.
+ */
+class PackedSaturatingCounters {
+public:
+    PackedSaturatingCounters(size_t size, uint64_t limit) : limit(limit) {
+        while (width < 64 && (limit >> width) != 0) {
+            ++width;
+        }
+        per_word = 64 / width;
+        mask = width == 64 ? numeric_limits<uint64_t>::max() : (uint64_t(1) << width) - 1;
+        word_count = size / per_word + 1;
+        words.reset(new atomic<uint64_t>[word_count]);
+        for (size_t i = 0; i < word_count; ++i) {
+            words[i].store(0, memory_order_relaxed);
+        }
+    }
+
+    /// Add one to the counter, unless it is at the limit
+    inline void increment(size_t i) {
+        atomic<uint64_t>& word = words[i / per_word];
+        size_t shift = (i % per_word) * width;
+        uint64_t old_word = word.load(memory_order_relaxed);
+        while (((old_word >> shift) & mask) < limit &&
+               !word.compare_exchange_weak(old_word, old_word + (uint64_t(1) << shift), memory_order_relaxed)) {
+            // try again with the new value
+        }
+    }
+
+    /// Set the counter to the limit
+    inline void saturate(size_t i) {
+        atomic<uint64_t>& word = words[i / per_word];
+        size_t shift = (i % per_word) * width;
+        uint64_t old_word = word.load(memory_order_relaxed);
+        while (!word.compare_exchange_weak(old_word, (old_word & ~(mask << shift)) | (limit << shift), memory_order_relaxed)) {
+            // try again with the new value
+        }
+    }
+
+    inline uint64_t get(size_t i) const {
+        return (words[i / per_word].load(memory_order_relaxed) >> ((i % per_word) * width)) & mask;
+    }
+
+private:
+    uint64_t limit;
+    size_t width = 1;
+    size_t per_word;
+    uint64_t mask;
+    size_t word_count;
+    unique_ptr<atomic<uint64_t>[]> words;
+};
+
 void clip_low_depth_nodes_and_edges_generic(MutablePathMutableHandleGraph* graph,
                                             function<void(function<void(handle_t, const Region*)>)> iterate_handles,
                                             function<void(function<void(edge_t, const Region*)>)> iterate_edges,                                            
@@ -498,7 +554,64 @@ void clip_low_depth_nodes_and_edges_generic(MutablePathMutableHandleGraph* graph
         return false;
     };
 
+    // count the path depth of every node and edge in one parallel pass over the paths,
+    // saturating at the minimum depth, which we also give anything on a reference path
+    vector<edge_t> edges;
+    graph->for_each_edge([&](edge_t edge) {
+            edges.push_back(edge);
+        });
+    size_t edge_count = edges.size();
+    boomphf::mphf<edge_t, BBEdgeHash> edge_hash(edge_count, edges, get_thread_count(), 2.0, false, false);
+    edges.clear();
+    uint64_t depth_limit = max<int64_t>(min_depth, 0);
+    PackedSaturatingCounters edge_depths(edge_count + 1, depth_limit);
+    nid_t min_id = graph->get_node_count() > 0 ? graph->min_node_id() : 0;
+    nid_t max_id = graph->get_node_count() > 0 ? graph->max_node_id() : 0;
+    PackedSaturatingCounters node_depths(max_id - min_id + 1, depth_limit);
+
+    vector<path_handle_t> path_handles;
+    graph->for_each_path_handle([&](path_handle_t path_handle) {
+            path_handles.push_back(path_handle);
+        });
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < path_handles.size(); ++i) {
+        path_handle_t path_handle = path_handles[i];
+        bool is_ref_path = check_prefixes(graph->get_path_name(path_handle));
+        handle_t prev_handle;
+        bool first = true;
+        graph->for_each_step_in_path(path_handle, [&](step_handle_t step_handle) {
+                handle_t handle = graph->get_handle_of_step(step_handle);
+                size_t node_rank = graph->get_id(handle) - min_id;
+                if (is_ref_path) {
+                    node_depths.saturate(node_rank);
+                } else {
+                    node_depths.increment(node_rank);
+                }
+                if (!first) {
+                    edge_t edge = graph->edge_handle(prev_handle, handle);
+                    size_t edge_rank = edge_hash.lookup(edge);
+                    if (is_ref_path) {
+                        // we never want to remove and edge on a reference path,
+                        // so automatically bump such edges past the threshold
+                        edge_depths.saturate(edge_rank);
+                    } else {
+                        edge_depths.increment(edge_rank);
+                    }
+                } else {
+                    first = false;
+                }
+                prev_handle = handle;
+            });
+    }
+
     function<void(handle_t, const Region*)> visit_handle = [&](handle_t handle, const Region* region) {
+        if (!region) {
+            // on the whole graph, reference paths are the same ones the depths know about
+            if ((int64_t)node_depths.get(graph->get_id(handle) - min_id) < min_depth) {
+                to_delete.insert(graph->get_id(handle));
+            }
+            return;
+        }
         bool on_ref = false;
         size_t depth = 0;
         graph->for_each_step_on_handle(handle, [&](step_handle_t step_handle) {
@@ -529,46 +642,10 @@ void clip_low_depth_nodes_and_edges_generic(MutablePathMutableHandleGraph* graph
     }
 
     // now do the edges
-    vector<edge_t> edges;
-    graph->for_each_edge([&](edge_t edge) {
-            edges.push_back(edge);
-        });
-    size_t edge_count = edges.size();
-    boomphf::mphf<edge_t, BBEdgeHash> edge_hash(edge_count, edges, get_thread_count(), 2.0, false, false);
-    edges.clear();
-    bdsg::PackedVector<> edge_depths;
-    edge_depths.resize(edge_count + 1);
-    
-    graph->for_each_path_handle([&](path_handle_t path_handle) {
-            bool is_ref_path = check_prefixes(graph->get_path_name(path_handle));
-            handle_t prev_handle;
-            bool first = true;
-            graph->for_each_step_in_path(path_handle, [&](step_handle_t step_handle) {
-                    handle_t handle = graph->get_handle_of_step(step_handle);
-                    if (!first) {
-                        edge_t edge = graph->edge_handle(prev_handle, handle);
-                        size_t edge_rank = edge_hash.lookup(edge);
-                        int64_t edge_depth = edge_depths.get(edge_rank);
-                        if (edge_depth < min_depth) {
-                            if (is_ref_path) {
-                                // we never want to remove and edge on a reference path,
-                                // so automatically bump such edges past the threshold
-                                edge_depths.set(edge_rank, min_depth);
-                            } else {
-                                edge_depths.set(edge_rank, edge_depth + 1);
-                            }
-                        }
-                    } else {
-                        first = false;
-                    }
-                    prev_handle = handle;
-                });
-        });
-
     unordered_set<edge_t> edges_to_delete;
     function<void(edge_t, const Region*)> visit_edge = [&](edge_t edge, const Region* region) {
         size_t edge_rank = edge_hash.lookup(edge);
-        if (edge_depths.get(edge_rank) < min_depth) {
+        if ((int64_t)edge_depths.get(edge_rank) < min_depth) {
             edges_to_delete.insert(edge);
         }
     };
@@ -1296,6 +1296,12 @@ vector<pair<pair<size_t, size_t>, int64_t>>  NullClusterer::pair_clusters(const
     return vector<pair<pair<size_t, size_t>, int64_t>>();
 }
     
+vector<vector<pair<int64_t, size_t>>> OrientedDistanceMeasurer::get_coordinate_buckets(const function<pos_t(size_t)>& get_position,
+                                                                                       size_t num_items) {
+    // no linear coordinates to offer by default
+    return vector<vector<pair<int64_t, size_t>>>();
+}
+    
 PathOrientedDistanceMeasurer::PathOrientedDistanceMeasurer(const PathPositionHandleGraph* graph,
                                                            const PathComponentIndex* path_component_index) :
     graph(graph), path_component_index(path_component_index) {
@@ -1575,6 +1581,54 @@ vector<vector<size_t>> PathOrientedDistanceMeasurer::get_buckets(const function<
     return buckets;
 }
 
+vector<vector<pair<int64_t, size_t>>> PathOrientedDistanceMeasurer::get_coordinate_buckets(const function<pos_t(size_t)>& get_position,
+                                                                                           size_t num_items) {
+#ifdef debug_mem_clusterer
+    cerr << "using path offsets to place items on path strands" << endl;
+#endif
+    
+    // the return value
+    vector<vector<pair<int64_t, size_t>>> buckets;
+    
+    // we will associate each path strand with the index of a bucket
+    unordered_map<pair<path_handle_t, bool>, size_t> bucket_of_path_strand;
+    
+    for (size_t i = 0; i < num_items; i++) {
+        pos_t pos = get_position(i);
+        handle_t handle = graph->get_handle(id(pos), is_rev(pos));
+        
+        for (const step_handle_t& step : graph->steps_of_handle(handle)) {
+            handle_t step_handle = graph->get_handle_of_step(step);
+            
+            // key indicating a path and a strand, oriented the same way as in oriented_distance
+            pair<path_handle_t, bool> key(graph->get_path_handle_of_step(step), step_handle != handle);
+            
+            auto bucket = bucket_of_path_strand.find(key);
+            if (bucket == bucket_of_path_strand.end()) {
+                bucket = bucket_of_path_strand.emplace(key, buckets.size()).first;
+                buckets.emplace_back();
+            }
+            
+            // the offset along the path strand, which on the reverse strand counts leftward from
+            // the end of the node
+            int64_t coordinate;
+            if (key.second) {
+                coordinate = (int64_t) offset(pos) - (int64_t) (graph->get_position_of_step(step) + graph->get_length(step_handle));
+            }
+            else {
+                coordinate = graph->get_position_of_step(step) + offset(pos);
+            }
+            buckets[bucket->second].emplace_back(coordinate, i);
+        }
+    }
+    
+    for (vector<pair<int64_t, size_t>>& bucket : buckets) {
+        sort(bucket.begin(), bucket.end());
+    }
+    
+    return buckets;
+}
+
 vector<pair<size_t, size_t>> PathOrientedDistanceMeasurer::exclude_merges(vector<vector<size_t>>& current_groups,
                                                                           const function<pos_t(size_t)>& get_position){
     
@@ -1928,6 +1982,36 @@ void OrientedDistanceClusterer::extend_dist_tree_by_buckets(const function<pos_t
                                                             UnionFind& component_union_find,
                                                             size_t& num_possible_merges_remaining) {
     
+    // if the items can be placed on linear coordinates, sweep over them in sorted order and take the
+    // distances between neighbors directly, without measuring any distances in the graph
+    for (const vector<pair<int64_t, size_t>>& bucket : distance_measurer.get_coordinate_buckets(get_position, num_items)) {
+        for (size_t i = 1; i < bucket.size(); i++) {
+            size_t prev = bucket[i - 1].second;
+            size_t here = bucket[i].second;
+            
+            if (component_union_find.find_group(prev) == component_union_find.find_group(here)) {
+                continue;
+            }
+            
+            int64_t dist = bucket[i].first - bucket[i - 1].first + get_offset(here) - get_offset(prev);
+            
+#ifdef debug_mem_clusterer
+            cerr << "recording swept distance between " << prev << " and " << here << " at " << dist << endl;
+#endif
+            
+            // record with the lower item first
+            if (prev < here) {
+                recorded_finite_dists[make_pair(prev, here)] = dist;
+            }
+            else {
+                recorded_finite_dists[make_pair(here, prev)] = -dist;
+            }
+            num_possible_merges_remaining -= component_union_find.group_size(prev) * component_union_find.group_size(here);
+            component_union_find.union_groups(prev, here);
+        }
+    }
+    
+    // measure distances for whatever is left in the buckets, like items that are only near a path
     vector<vector<size_t>> buckets = distance_measurer.get_buckets(get_position, num_items);
     
     // Ensure a deterministic, system independent ordering
@@ -2001,6 +2085,12 @@ void OrientedDistanceClusterer::extend_dist_tree_by_permutations(const function<
     // to be connected with probability approaching 1
     size_t current_max_num_probes = max_failed_distance_probes;
     
+    // for reads with many hits, we measure the upcoming distances in parallel batches and save
+    // them until the loop comes to them
+    bool measure_in_parallel = num_items >= min_hits_for_parallel_distances;
+    size_t batch_size = 8 * omp_get_max_threads();
+    unordered_map<pair<size_t, size_t>, int64_t> measured_dists;
+    
     while (num_possible_merges_remaining > 0 && current_pair != shuffled_pairs.end() && current_max_num_probes > 0) {
         // slowly lower the number of distances we need to check before we believe that two clusters are on
         // separate strands
@@ -2059,13 +2149,51 @@ void OrientedDistanceClusterer::extend_dist_tree_by_permutations(const function<
             continue;
         }
         
-        const pos_t& pos_1 = get_position(node_pair.first);
-        const pos_t& pos_2 = get_position(node_pair.second);
-        
-        int64_t oriented_dist = distance_measurer.oriented_distance(pos_1, pos_2);
+        int64_t oriented_dist;
+        auto measured = measured_dists.find(node_pair);
+        if (measured != measured_dists.end()) {
+            // we measured this one in an earlier batch
+            oriented_dist = measured->second;
+            measured_dists.erase(measured);
+        }
+        else if (measure_in_parallel) {
+            // batch this pair with the next pairs that we will probably need to measure
+            vector<pair<size_t, size_t>> batch(1, node_pair);
+            auto look_ahead = current_pair;
+            for (size_t looked = 0; batch.size() < batch_size && look_ahead != shuffled_pairs.end() && looked < 16 * batch_size; ++looked) {
+                pair<size_t, size_t> next_pair = *look_ahead;
+                ++look_ahead;
+                size_t next_strand_1 = component_union_find.find_group(next_pair.first);
+                size_t next_strand_2 = component_union_find.find_group(next_pair.second);
+                if (next_strand_1 == next_strand_2) {
+                    continue;
+                }
+                auto next_failed_probes = num_infinite_dists.find(make_pair(next_strand_1, next_strand_2));
+                if (next_failed_probes != num_infinite_dists.end() && next_failed_probes->second >= current_max_num_probes) {
+                    continue;
+                }
+                batch.push_back(next_pair);
+            }
+            
+            vector<int64_t> batch_dists(batch.size());
+#pragma omp parallel for schedule(dynamic, 1)
+            for (size_t i = 0; i < batch.size(); i++) {
+                batch_dists[i] = distance_measurer.oriented_distance(get_position(batch[i].first),
+                                                                     get_position(batch[i].second));
+            }
+            
+            oriented_dist = batch_dists[0];
+            for (size_t i = 1; i < batch.size(); i++) {
+                measured_dists[batch[i]] = batch_dists[i];
+            }
+        }
+        else {
+            oriented_dist = distance_measurer.oriented_distance(get_position(node_pair.first),
+                                                                get_position(node_pair.second));
+        }
         
 #ifdef debug_mem_clusterer
-        cerr << "distance between " << pos_1 << " and " << pos_2 << " estimated at " << oriented_dist << endl;
+        cerr << "distance between " << get_position(node_pair.first) << " and " << get_position(node_pair.second) << " estimated at " << oriented_dist << endl;
 #endif
         
         if (oriented_dist == std::numeric_limits<int64_t>::max()) {
@@ -3177,19 +3305,25 @@ MEMClusterer::HitGraph TVSClusterer::make_hit_graph(const Alignment& alignment,
     // intialize with nodes
     HitGraph hit_graph(mems, alignment, aligner, min_mem_length, false, fanouts);
     
+    // the edges out of each node as (target, weight, distance), which we find for each node in parallel
+    // if there are enough hits and then add in order
+    vector<vector<tuple<size_t, int32_t, int64_t>>> edges_from(hit_graph.nodes.size());
+    
     // assumes that MEMs are given in lexicographic order by read interval
+#pragma omp parallel for schedule(dynamic, 1) if (hit_graph.nodes.size() >= min_hits_for_parallel_distances)
     for (size_t i = 0; i < hit_graph.nodes.size(); i++) {
-        HitNode& hit_node_1 = hit_graph.nodes[i];
+        const HitNode& hit_node_1 = hit_graph.nodes[i];
         
         for (size_t j = i + 1; j < hit_graph.nodes.size(); j++){
             
-            HitNode& hit_node_2 = hit_graph.nodes[j];
+            const HitNode& hit_node_2 = hit_graph.nodes[j];
             
             if (hit_node_2.mem->begin <= hit_node_1.mem->begin
                 && hit_node_2.mem->end <= hit_node_1.mem->end) {
                 // this node is at the same place or earlier in the read, so they can't be colinear
                 
 #ifdef debug_mem_clusterer
+#pragma omp critical (cerr)
                 cerr << "nodes " << i << " (" << hit_node_1.start_pos << ") and " << j << " (" << hit_node_2.start_pos << ") are not read colinear" << endl;
 #endif
                 continue;
@@ -3203,15 +3337,12 @@ MEMClusterer::HitGraph TVSClusterer::make_hit_graph(const Alignment& alignment,
                                                   aligner->longest_detectable_gap(alignment, hit_node_2.mem->begin)),
                                               max_gap);
             
-#ifdef debug_mem_clusterer
-            cerr << "estimating distance between " << i << " (pos " << hit_node_1.start_pos << ") and " << j << " (pos " << hit_node_2.start_pos << ") with target " << read_separation << " and tolerance " << longest_gap << endl;
-#endif
-            
             // how close can we get to the expected distance, restricting to detectable edits
             int64_t tv_len = tvs.tv_path_length(hit_node_1.start_pos, hit_node_2.start_pos, read_separation, longest_gap);
             
 #ifdef debug_mem_clusterer
-            cerr << "estimate distance at " << tv_len << endl;
+#pragma omp critical (cerr)
+            cerr << "estimated distance between " << i << " (pos " << hit_node_1.start_pos << ") and " << j << " (pos " << hit_node_2.start_pos << ") with target " << read_separation << " and tolerance " << longest_gap << " at " << tv_len << endl;
 #endif
             
             if (tv_len == read_separation
@@ -3223,7 +3354,7 @@ MEMClusterer::HitGraph TVSClusterer::make_hit_graph(const Alignment& alignment,
                 // we add a dummy edge, but only to connect the nodes' components and join the clusters,
                 // not to actually use in dynamic programming (given arbitrary low weight that should not
                 // cause overflow)
-                hit_graph.add_edge(i, j, numeric_limits<int32_t>::lowest() / 2, tv_len);
+                edges_from[i].emplace_back(j, numeric_limits<int32_t>::lowest() / 2, tv_len);
             }
             else if (tv_len != numeric_limits<int64_t>::max()
                      && hit_node_2.mem->begin >= hit_node_1.mem->begin
@@ -3234,12 +3365,18 @@ MEMClusterer::HitGraph TVSClusterer::make_hit_graph(const Alignment& alignment,
                 int64_t graph_dist = tv_len - (hit_node_1.mem->end - hit_node_1.mem->begin);
                 
                 // add the corresponding edge
-                hit_graph.add_edge(i, j, estimate_edge_score(hit_node_1.mem, hit_node_2.mem, graph_dist, aligner), graph_dist);
+                edges_from[i].emplace_back(j, estimate_edge_score(hit_node_1.mem, hit_node_2.mem, graph_dist, aligner), graph_dist);
                 
             }
         }
     }
     
+    for (size_t i = 0; i < edges_from.size(); i++) {
+        for (const auto& edge : edges_from[i]) {
+            hit_graph.add_edge(i, get<0>(edge), get<1>(edge), get<2>(edge));
+        }
+    }
+    
     return hit_graph;
 }
     
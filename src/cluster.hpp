@@ -210,6 +210,9 @@ public:
     /// The largest discrepency we will allow between the read-implied distances and the estimated  gap distance
     int64_t max_gap = numeric_limits<int64_t>::max();
     
+    /// Reads with at least this many hits have their pairwise distances measured in parallel
+    size_t min_hits_for_parallel_distances = 128;
+    
 protected:
     
     class HitNode;
@@ -385,6 +388,12 @@ public:
     /// that cannot have finite distances between them (typically because they are on separate components).
     virtual vector<pair<size_t, size_t>> exclude_merges(vector<vector<size_t>>& current_groups,
                                                         const function<pos_t(size_t)>& get_position) = 0;
+    
+    /// Return a vector of groups of (coordinate, item) pairs, each sorted by coordinate, such that the
+    /// oriented distance between two items in the same group is the difference of their coordinates.
+    /// Items can be in more than one group. By default returns no groups.
+    virtual vector<vector<pair<int64_t, size_t>>> get_coordinate_buckets(const function<pos_t(size_t)>& get_position,
+                                                                         size_t num_items);
 };
 
 /*
@@ -417,6 +426,11 @@ public:
     vector<pair<size_t, size_t>> exclude_merges(vector<vector<size_t>>& current_groups,
                                                 const function<pos_t(size_t)>& get_position);
     
+    /// Return a group for each path strand that the items are on, with each item's offset along
+    /// that strand, sorted by offset. Items that are not on a path are not included.
+    vector<vector<pair<int64_t, size_t>>> get_coordinate_buckets(const function<pos_t(size_t)>& get_position,
+                                                                 size_t num_items);
+    
     /// The maximum distance we will walk trying to find a shared path
     size_t max_walk = 50;
     
@@ -0,0 +1,554 @@
+/**
+ * \file columnar_alignments.cpp
+ * Implementation for the GAMC columnar alignment container.
+ */
+
+
+#include "columnar_alignments.hpp"
+#include "zstdutil.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace vg {
+
+using namespace std;
+
+const string GAMC_MAGIC("\0GMC", 4);
+
+const size_t GAMCAlignmentEmitter::BLOCK_SIZE = 4096;
+
+//------------------------------------------------------------------------------
+
+// Integer encodings shared by the columns.
+
+static inline void put_varint(string& buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back((char) ((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((char) value);
+}
+
+static inline uint64_t get_varint(const string& buffer, size_t& pos) {
+    uint64_t value = 0;
+    for (size_t shift = 0; shift < 64; shift += 7) {
+        if (pos >= buffer.size()) {
+            throw runtime_error("truncated GAMC column");
+        }
+        uint8_t byte = buffer[pos++];
+        value |= (uint64_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw runtime_error("invalid varint in GAMC column");
+}
+
+static inline uint64_t zigzag(int64_t value) {
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static inline void put_u64(string& buffer, uint64_t value) {
+    for (size_t i = 0; i < 8; i++) {
+        buffer.push_back((char) ((value >> (8 * i)) & 0xFF));
+    }
+}
+
+static inline uint64_t get_u64(const char* data) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < 8; i++) {
+        value |= (uint64_t) (uint8_t) data[i] << (8 * i);
+    }
+    return value;
+}
+
+/// Append a length-prefixed string to the column.
+static inline void put_string(string& buffer, const string& value) {
+    put_varint(buffer, value.size());
+    buffer.append(value);
+}
+
+/// Read a length-prefixed string from the column.
+static inline void get_string(const string& buffer, size_t& pos, string* value) {
+    size_t length = get_varint(buffer, pos);
+    if (length > buffer.size() - pos) {
+        throw runtime_error("truncated GAMC column");
+    }
+    value->assign(buffer, pos, length);
+    pos += length;
+}
+
+/// 2-bit code for a base, or 4 if it has to be stored as an exception.
+static inline uint8_t base_code(char base) {
+    switch (base) {
+    case 'A':
+        return 0;
+    case 'C':
+        return 1;
+    case 'G':
+        return 2;
+    case 'T':
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+static const char CODE_BASES[] = "ACGT";
+
+//------------------------------------------------------------------------------
+
+void encode_gamc_block(const vector<Alignment>& reads, string& buffer) {
+    vector<string> columns(GAMC_COLUMN_COUNT);
+
+    // Bases are packed 4 to a byte across the whole block.
+    uint64_t base_index = 0;
+    uint8_t packed = 0;
+    // Exceptions are stored as gaps from the base after the last exception.
+    uint64_t next_exception = 0;
+    // Node IDs are deltas from the previous node in the block, which makes
+    // them small for sorted reads.
+    int64_t prev_node = 0;
+
+    Alignment remainder;
+    for (auto& aln : reads) {
+        put_string(columns[GAMC_NAMES], aln.name());
+
+        const string& sequence = aln.sequence();
+        put_varint(columns[GAMC_SEQUENCE_LENGTHS], sequence.size());
+        for (char base : sequence) {
+            uint8_t code = base_code(base);
+            if (code > 3) {
+                put_varint(columns[GAMC_BASE_EXCEPTIONS], base_index - next_exception);
+                columns[GAMC_BASE_EXCEPTIONS].push_back(base);
+                next_exception = base_index + 1;
+                code = 0;
+            }
+            packed |= code << (2 * (base_index % 4));
+            base_index++;
+            if (base_index % 4 == 0) {
+                columns[GAMC_BASES].push_back((char) packed);
+                packed = 0;
+            }
+        }
+
+        put_string(columns[GAMC_QUALITIES], aln.quality());
+
+        // We can only store paths with the usual ranks and without position
+        // names in columns. Anything else stays in the remainder.
+        const Path& path = aln.path();
+        bool columnar_path = true;
+        for (size_t i = 0; i < path.mapping_size(); i++) {
+            if (path.mapping(i).rank() != (int64_t) i + 1 || !path.mapping(i).position().name().empty()) {
+                columnar_path = false;
+                break;
+            }
+        }
+        if (columnar_path) {
+            string& paths = columns[GAMC_PATHS];
+            put_varint(paths, (uint64_t) path.mapping_size() << 1);
+            for (auto& mapping : path.mapping()) {
+                const Position& position = mapping.position();
+                put_varint(paths, (zigzag(position.node_id() - prev_node) << 1) | position.is_reverse());
+                prev_node = position.node_id();
+                put_varint(paths, position.offset());
+                put_varint(paths, mapping.edit_size());
+                for (auto& edit : mapping.edit()) {
+                    put_varint(paths, (uint32_t) edit.from_length());
+                    put_varint(paths, (uint32_t) edit.to_length());
+                    put_varint(paths, edit.sequence().size());
+                    columns[GAMC_EDIT_SEQUENCES].append(edit.sequence());
+                }
+            }
+        } else {
+            put_varint(columns[GAMC_PATHS], 1);
+        }
+
+        put_varint(columns[GAMC_SCORES], zigzag(aln.score()));
+        put_varint(columns[GAMC_SCORES], zigzag(aln.mapping_quality()));
+
+        remainder = aln;
+        remainder.clear_name();
+        remainder.clear_sequence();
+        remainder.clear_quality();
+        remainder.clear_score();
+        remainder.clear_mapping_quality();
+        if (columnar_path && remainder.has_path()) {
+            // Keep the path itself, in case it has a name or length.
+            remainder.mutable_path()->clear_mapping();
+        }
+        put_string(columns[GAMC_REMAINDER], remainder.SerializeAsString());
+    }
+    if (base_index % 4 != 0) {
+        columns[GAMC_BASES].push_back((char) packed);
+    }
+
+    // Write the read count and the sizes of all columns, so that readers can
+    // skip the columns they don't need, and then the compressed columns.
+    put_u64(buffer, reads.size());
+    vector<string> compressed(GAMC_COLUMN_COUNT);
+    for (size_t i = 0; i < GAMC_COLUMN_COUNT; i++) {
+        if (!columns[i].empty() && zstdutil::CompressString(columns[i], compressed[i]) != 0) {
+            throw runtime_error("could not compress GAMC column");
+        }
+        put_u64(buffer, columns[i].size());
+        put_u64(buffer, compressed[i].size());
+    }
+    for (auto& column : compressed) {
+        buffer.append(column);
+    }
+}
+
+void decode_gamc_block(const string& buffer, vector<Alignment>& reads, uint32_t columns) {
+    // Pull in the columns that the requested ones depend on.
+    if (columns & ((1u << GAMC_SEQUENCE_LENGTHS) | (1u << GAMC_BASES) | (1u << GAMC_BASE_EXCEPTIONS))) {
+        columns |= (1u << GAMC_SEQUENCE_LENGTHS) | (1u << GAMC_BASES) | (1u << GAMC_BASE_EXCEPTIONS);
+    }
+    if (columns & ((1u << GAMC_PATHS) | (1u << GAMC_EDIT_SEQUENCES))) {
+        columns |= (1u << GAMC_PATHS) | (1u << GAMC_EDIT_SEQUENCES);
+    }
+
+    size_t header_size = 8 * (1 + 2 * GAMC_COLUMN_COUNT);
+    if (buffer.size() < header_size) {
+        throw runtime_error("truncated GAMC block header");
+    }
+    size_t read_count = get_u64(buffer.data());
+
+    vector<string> data(GAMC_COLUMN_COUNT);
+    size_t offset = header_size;
+    for (size_t i = 0; i < GAMC_COLUMN_COUNT; i++) {
+        size_t raw_size = get_u64(buffer.data() + 8 * (1 + 2 * i));
+        size_t compressed_size = get_u64(buffer.data() + 8 * (2 + 2 * i));
+        if (compressed_size > buffer.size() - offset) {
+            throw runtime_error("truncated GAMC block");
+        }
+        if ((columns & (1u << i)) && raw_size > 0) {
+            if (zstdutil::DecompressString(buffer.substr(offset, compressed_size), data[i]) != 0 || data[i].size() != raw_size) {
+                throw runtime_error("could not decompress GAMC column");
+            }
+        }
+        if (i == GAMC_SCORES && raw_size < 2 * read_count) {
+            // Every read has at least a byte for each of its scores.
+            throw runtime_error("GAMC block has too few scores for its reads");
+        }
+        offset += compressed_size;
+    }
+
+    vector<size_t> pos(GAMC_COLUMN_COUNT, 0);
+    uint64_t base_index = 0;
+    // Index of the next exception, if there is one.
+    uint64_t next_exception = numeric_limits<uint64_t>::max();
+    if (!data[GAMC_BASE_EXCEPTIONS].empty()) {
+        next_exception = get_varint(data[GAMC_BASE_EXCEPTIONS], pos[GAMC_BASE_EXCEPTIONS]);
+    }
+    int64_t prev_node = 0;
+    size_t edit_sequence_pos = 0;
+
+    reads.resize(read_count);
+    for (auto& aln : reads) {
+        aln.Clear();
+        if (columns & (1u << GAMC_REMAINDER)) {
+            // This has to come first, since parsing replaces the message.
+            size_t length = get_varint(data[GAMC_REMAINDER], pos[GAMC_REMAINDER]);
+            if (length > data[GAMC_REMAINDER].size() - pos[GAMC_REMAINDER] ||
+                !aln.ParseFromArray(data[GAMC_REMAINDER].data() + pos[GAMC_REMAINDER], length)) {
+                throw runtime_error("could not parse GAMC remainder");
+            }
+            pos[GAMC_REMAINDER] += length;
+        }
+
+        if (columns & (1u << GAMC_NAMES)) {
+            get_string(data[GAMC_NAMES], pos[GAMC_NAMES], aln.mutable_name());
+        }
+
+        if (columns & (1u << GAMC_BASES)) {
+            size_t length = get_varint(data[GAMC_SEQUENCE_LENGTHS], pos[GAMC_SEQUENCE_LENGTHS]);
+            if ((base_index + length + 3) / 4 > data[GAMC_BASES].size()) {
+                throw runtime_error("truncated GAMC base column");
+            }
+            string& sequence = *aln.mutable_sequence();
+            sequence.resize(length);
+            for (size_t i = 0; i < length; i++, base_index++) {
+                if (base_index == next_exception) {
+                    string& exceptions = data[GAMC_BASE_EXCEPTIONS];
+                    if (pos[GAMC_BASE_EXCEPTIONS] >= exceptions.size()) {
+                        throw runtime_error("truncated GAMC exception column");
+                    }
+                    sequence[i] = exceptions[pos[GAMC_BASE_EXCEPTIONS]++];
+                    if (pos[GAMC_BASE_EXCEPTIONS] < exceptions.size()) {
+                        next_exception = base_index + 1 + get_varint(exceptions, pos[GAMC_BASE_EXCEPTIONS]);
+                    }
+                } else {
+                    sequence[i] = CODE_BASES[(data[GAMC_BASES][base_index / 4] >> (2 * (base_index % 4))) & 3];
+                }
+            }
+        }
+
+        if (columns & (1u << GAMC_QUALITIES)) {
+            get_string(data[GAMC_QUALITIES], pos[GAMC_QUALITIES], aln.mutable_quality());
+        }
+
+        if (columns & (1u << GAMC_PATHS)) {
+            string& paths = data[GAMC_PATHS];
+            size_t& path_pos = pos[GAMC_PATHS];
+            uint64_t header = get_varint(paths, path_pos);
+            if (!(header & 1)) {
+                size_t mapping_count = header >> 1;
+                Path* path = aln.mutable_path();
+                for (size_t i = 0; i < mapping_count; i++) {
+                    Mapping* mapping = path->add_mapping();
+                    mapping->set_rank(i + 1);
+                    Position* position = mapping->mutable_position();
+                    uint64_t node = get_varint(paths, path_pos);
+                    prev_node += unzigzag(node >> 1);
+                    position->set_node_id(prev_node);
+                    position->set_is_reverse(node & 1);
+                    position->set_offset(get_varint(paths, path_pos));
+                    size_t edit_count = get_varint(paths, path_pos);
+                    for (size_t j = 0; j < edit_count; j++) {
+                        Edit* edit = mapping->add_edit();
+                        edit->set_from_length((int32_t) get_varint(paths, path_pos));
+                        edit->set_to_length((int32_t) get_varint(paths, path_pos));
+                        size_t length = get_varint(paths, path_pos);
+                        if (length > data[GAMC_EDIT_SEQUENCES].size() - edit_sequence_pos) {
+                            throw runtime_error("truncated GAMC edit sequence column");
+                        }
+                        if (length > 0) {
+                            edit->set_sequence(data[GAMC_EDIT_SEQUENCES].substr(edit_sequence_pos, length));
+                            edit_sequence_pos += length;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (columns & (1u << GAMC_SCORES)) {
+            aln.set_score(unzigzag(get_varint(data[GAMC_SCORES], pos[GAMC_SCORES])));
+            aln.set_mapping_quality(unzigzag(get_varint(data[GAMC_SCORES], pos[GAMC_SCORES])));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+bool is_gamc_stream(istream& in) {
+    return in.peek() == GAMC_MAGIC[0];
+}
+
+/// Read and check the GAMC file header, or exit with an error.
+static void read_gamc_header(istream& in, const char* caller) {
+    string header(GAMC_MAGIC.size() + 4, '\0');
+    in.read(&header[0], header.size());
+    if (!in || header.compare(0, GAMC_MAGIC.size(), GAMC_MAGIC) != 0) {
+        cerr << "error[vg::" << caller << "]: input is not a GAMC file" << endl;
+        exit(1);
+    }
+    uint32_t version = 0;
+    for (size_t i = 0; i < 4; i++) {
+        version |= (uint32_t) (uint8_t) header[GAMC_MAGIC.size() + i] << (8 * i);
+    }
+    if (version > GAMC_VERSION) {
+        cerr << "error[vg::" << caller << "]: GAMC version " << version << " is newer than the supported version "
+             << GAMC_VERSION << endl;
+        exit(1);
+    }
+}
+
+/// Read the next block from the stream into the buffer. Returns false at the
+/// end of the stream, and exits with an error on a truncated block.
+static bool read_gamc_block(istream& in, string& buffer, const char* caller) {
+    char length_bytes[8];
+    in.read(length_bytes, 8);
+    if (in.gcount() == 0 && in.eof()) {
+        return false;
+    }
+    if (in.gcount() != 8) {
+        cerr << "error[vg::" << caller << "]: truncated GAMC block" << endl;
+        exit(1);
+    }
+    buffer.resize(get_u64(length_bytes));
+    in.read(&buffer[0], buffer.size());
+    if ((size_t) in.gcount() != buffer.size()) {
+        cerr << "error[vg::" << caller << "]: truncated GAMC block" << endl;
+        exit(1);
+    }
+    return true;
+}
+
+/// Decode a block or exit with an error.
+static void decode_or_die(const string& buffer, vector<Alignment>& reads, uint32_t columns, const char* caller) {
+    try {
+        decode_gamc_block(buffer, reads, columns);
+    } catch (const runtime_error& e) {
+        #pragma omp critical (cerr)
+        {
+            cerr << "error[vg::" << caller << "]: " << e.what() << endl;
+            exit(1);
+        }
+    }
+}
+
+void for_each_gamc(istream& in, const function<void(Alignment&)>& lambda, uint32_t columns) {
+    read_gamc_header(in, "for_each_gamc");
+    string buffer;
+    vector<Alignment> reads;
+    while (read_gamc_block(in, buffer, "for_each_gamc")) {
+        decode_or_die(buffer, reads, columns, "for_each_gamc");
+        for (auto& aln : reads) {
+            lambda(aln);
+        }
+    }
+}
+
+void for_each_gamc_parallel(istream& in, const function<void(Alignment&)>& lambda, uint32_t columns) {
+    read_gamc_header(in, "for_each_gamc_parallel");
+
+    // Don't let the reader get too far ahead of the workers.
+    size_t max_outstanding = 2 * omp_get_max_threads();
+    size_t outstanding = 0;
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            while (true) {
+                auto buffer = make_shared<string>();
+                if (!read_gamc_block(in, *buffer, "for_each_gamc_parallel")) {
+                    break;
+                }
+
+                size_t currently_outstanding;
+                #pragma omp atomic capture
+                currently_outstanding = ++outstanding;
+
+                // If the workers are behind, the reader does this block itself.
+                #pragma omp task firstprivate(buffer) shared(outstanding) if(currently_outstanding <= max_outstanding)
+                {
+                    vector<Alignment> reads;
+                    decode_or_die(*buffer, reads, columns, "for_each_gamc_parallel");
+                    buffer.reset();
+                    for (auto& aln : reads) {
+                        lambda(aln);
+                    }
+                    #pragma omp atomic update
+                    --outstanding;
+                }
+            }
+            #pragma omp taskwait
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+GAMCAlignmentEmitter::GAMCAlignmentEmitter(const string& filename, size_t max_threads) :
+    out_file(filename == "-" ? nullptr : new ofstream(filename, ios_base::binary)),
+    out(out_file.get() != nullptr ? *out_file : cout),
+    thread_blocks(std::max<size_t>(max_threads, 1)) {
+
+    if (out_file.get() != nullptr && !*out_file) {
+        // Make sure we opened a file if we aren't writing to standard output
+        cerr << "[vg::GAMCAlignmentEmitter] failed to open " << filename << " for writing" << endl;
+        exit(1);
+    }
+
+    string header = GAMC_MAGIC;
+    for (size_t i = 0; i < 4; i++) {
+        header.push_back((char) ((GAMC_VERSION >> (8 * i)) & 0xFF));
+    }
+    out.write(header.data(), header.size());
+}
+
+GAMCAlignmentEmitter::~GAMCAlignmentEmitter() {
+    // Everyone is done emitting now, so write out whatever is left.
+    for (auto& block : thread_blocks) {
+        flush_block(block, true);
+    }
+    out.flush();
+}
+
+vector<Alignment>& GAMCAlignmentEmitter::get_block() {
+    size_t thread_number = omp_get_thread_num();
+    if (thread_number >= thread_blocks.size()) {
+        cerr << "error[vg::GAMCAlignmentEmitter]: thread " << thread_number << " is beyond the "
+             << thread_blocks.size() << " threads the emitter was made for" << endl;
+        exit(1);
+    }
+    return thread_blocks[thread_number];
+}
+
+void GAMCAlignmentEmitter::flush_block(vector<Alignment>& block, bool force) {
+    if (block.size() < BLOCK_SIZE && !(force && !block.empty())) {
+        return;
+    }
+
+    // Encode and compress outside the lock.
+    string buffer;
+    put_u64(buffer, 0);
+    encode_gamc_block(block, buffer);
+    uint64_t length = buffer.size() - 8;
+    for (size_t i = 0; i < 8; i++) {
+        buffer[i] = (char) ((length >> (8 * i)) & 0xFF);
+    }
+    block.clear();
+
+    lock_guard<mutex> lock(out_mutex);
+    out.write(buffer.data(), buffer.size());
+    if (!out) {
+        cerr << "error[vg::GAMCAlignmentEmitter]: could not write GAMC block" << endl;
+        exit(1);
+    }
+}
+
+void GAMCAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
+    vector<Alignment>& block = get_block();
+    for (auto& aln : aln_batch) {
+        block.emplace_back(std::move(aln));
+    }
+    flush_block(block);
+}
+
+void GAMCAlignmentEmitter::emit_mapped_singles(vector<vector<Alignment>>&& alns_batch) {
+    vector<Alignment>& block = get_block();
+    for (auto& alns : alns_batch) {
+        for (auto& aln : alns) {
+            block.emplace_back(std::move(aln));
+        }
+    }
+    flush_block(block);
+}
+
+void GAMCAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch, vector<int64_t>&& tlen_limit_batch) {
+    assert(aln1_batch.size() == aln2_batch.size());
+    vector<Alignment>& block = get_block();
+    for (size_t i = 0; i < aln1_batch.size(); i++) {
+        block.emplace_back(std::move(aln1_batch[i]));
+        block.emplace_back(std::move(aln2_batch[i]));
+    }
+    flush_block(block);
+}
+
+void GAMCAlignmentEmitter::emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch, vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch) {
+    assert(alns1_batch.size() == alns2_batch.size());
+    vector<Alignment>& block = get_block();
+    for (size_t i = 0; i < alns1_batch.size(); i++) {
+        assert(alns1_batch[i].size() == alns2_batch[i].size());
+        for (size_t j = 0; j < alns1_batch[i].size(); j++) {
+            block.emplace_back(std::move(alns1_batch[i][j]));
+            block.emplace_back(std::move(alns2_batch[i][j]));
+        }
+    }
+    flush_block(block);
+}
+
+}
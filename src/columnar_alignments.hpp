@@ -0,0 +1,148 @@
+#ifndef VG_COLUMNAR_ALIGNMENTS_HPP_INCLUDED
+#define VG_COLUMNAR_ALIGNMENTS_HPP_INCLUDED
+
+/** \file
+ *
+ * A columnar container for Alignments (GAMC), for archival and for scans
+ * that only need a few fields.
+ *
+ * A GAMC file is a header followed by blocks of reads. Each block stores the
+ * fields of its reads in separately zstd-compressed columns: names, sequence
+ * lengths, 2-bit packed bases with a list of non-ACGT exceptions, qualities,
+ * delta-coded path node arrays with their edits, scores, and everything else
+ * as a protobuf remainder. Reading a file restores the original Alignments.
+ */
+
+#include "vg/io/alignment_emitter.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * The columns of a GAMC block, in the order they are stored.
+ */
+enum GAMCColumn {
+    GAMC_NAMES = 0,
+    GAMC_SEQUENCE_LENGTHS,
+    GAMC_BASES,
+    GAMC_BASE_EXCEPTIONS,
+    GAMC_QUALITIES,
+    GAMC_PATHS,
+    GAMC_EDIT_SEQUENCES,
+    GAMC_SCORES,
+    GAMC_REMAINDER,
+    GAMC_COLUMN_COUNT
+};
+
+/// Column mask for decoding every column.
+constexpr uint32_t GAMC_ALL_COLUMNS = (1u << GAMC_COLUMN_COUNT) - 1;
+
+/// Bytes at the start of every GAMC file. GAM files never start with a 0
+/// byte, since they are either BGZF or start with a nonzero group size.
+extern const string GAMC_MAGIC;
+
+/// Version of the GAMC format written by this code.
+constexpr uint32_t GAMC_VERSION = 1;
+
+/**
+ * Encode the given reads as a GAMC block, appending it to the given buffer.
+ */
+void encode_gamc_block(const vector<Alignment>& reads, string& buffer);
+
+/**
+ * Decode the GAMC block in the given buffer, replacing the contents of the
+ * given vector. Only the columns in the mask, and the columns they depend
+ * on, are decompressed. Fields stored in other columns are left at their
+ * default values, so decoding a subset of columns is only useful for scans
+ * that do not look at the rest. Throws runtime_error if the block is not
+ * valid.
+ */
+void decode_gamc_block(const string& buffer, vector<Alignment>& reads, uint32_t columns = GAMC_ALL_COLUMNS);
+
+/**
+ * Returns true if the stream looks like a GAMC file, without consuming any
+ * input.
+ */
+bool is_gamc_stream(istream& in);
+
+/**
+ * Call the lambda on every read in the GAMC stream, in file order, decoding
+ * only the given columns. Exits with an error if the stream is not valid.
+ */
+void for_each_gamc(istream& in, const function<void(Alignment&)>& lambda, uint32_t columns = GAMC_ALL_COLUMNS);
+
+/**
+ * Call the lambda on every read in the GAMC stream, decoding blocks in
+ * parallel with OMP tasks while the calling thread reads the next blocks.
+ * Reads within a block are passed to the lambda in order, but blocks are not.
+ * Exits with an error if the stream is not valid.
+ */
+void for_each_gamc_parallel(istream& in, const function<void(Alignment&)>& lambda, uint32_t columns = GAMC_ALL_COLUMNS);
+
+/**
+ * An AlignmentEmitter implementation that writes a GAMC file. Each thread
+ * collects reads into its own block, and encodes and compresses a full block
+ * itself before writing it out, so compression scales with the number of
+ * emitting threads. Pairs are written as consecutive reads, and the order of
+ * blocks from different threads is not defined.
+ */
+class GAMCAlignmentEmitter : public vg::io::AlignmentEmitter {
+public:
+
+    /**
+     * Make an emitter that writes GAMC to the given file (or "-" for standard
+     * output), expecting to be called from up to max_threads OMP threads.
+     */
+    GAMCAlignmentEmitter(const string& filename, size_t max_threads);
+
+    /// Write out all buffered reads and close the file.
+    virtual ~GAMCAlignmentEmitter();
+
+    /// Emit a batch of Alignments
+    virtual void emit_singles(vector<Alignment>&& aln_batch);
+    /// Emit batch of Alignments with secondaries. All secondaries must have is_secondary set already.
+    virtual void emit_mapped_singles(vector<vector<Alignment>>&& alns_batch);
+    /// Emit a batch of pairs of Alignments. The tlen_limit_batch is ignored.
+    virtual void emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch,
+        vector<int64_t>&& tlen_limit_batch);
+    /// Emit the mappings of a batch of pairs of Alignments. All secondaries
+    /// must have is_secondary set already.
+    ///
+    /// Both ends of each pair must have the same number of mappings.
+    virtual void emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch,
+        vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch);
+
+    /// How many reads go in each block?
+    static const size_t BLOCK_SIZE;
+
+protected:
+    /// File we own, if not writing to standard output.
+    unique_ptr<ofstream> out_file;
+    /// Stream we write to.
+    ostream& out;
+    /// Mutex serializing writes to out.
+    mutex out_mutex;
+
+    /// Reads waiting to be encoded for each thread.
+    vector<vector<Alignment>> thread_blocks;
+
+    /// Get the block for the calling thread.
+    vector<Alignment>& get_block();
+
+    /// Encode and write out the given block if it is full, or if force is
+    /// set and it is not empty.
+    void flush_block(vector<Alignment>& block, bool force = false);
+};
+
+}
+
+#endif
@@ -0,0 +1,25 @@
+/**
+ * \file compare_kernels.cpp: picks which build of the comparison kernels to use
+ */
+
+#include "compare_kernels.hpp"
+
+namespace vg {
+
+/// Find the fastest build of the kernels this CPU supports
+static const CompareKernels* choose_compare_kernels() {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return &compare_kernels_avx2;
+    }
+#endif
+    return &compare_kernels_base;
+}
+
+const CompareKernels& get_compare_kernels() {
+    static const CompareKernels* chosen = choose_compare_kernels();
+    return *chosen;
+}
+
+}
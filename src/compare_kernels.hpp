@@ -0,0 +1,45 @@
+#ifndef VG_COMPARE_KERNELS_HPP_INCLUDED
+#define VG_COMPARE_KERNELS_HPP_INCLUDED
+
+/** \file
+ * compare_kernels.hpp: defines CompareKernels, a table of entry points into
+ * one build of the sequence comparison loops used by gapless extension, so
+ * that the extender can use the best build for the CPU it is running on.
+ *
+ * This header is included from translation units compiled for instruction
+ * sets the CPU might not have, so it must not pull in any C++ library code
+ * that could end up shared between those and the rest of vg.
+ */
+
+#include <cstddef>
+
+namespace vg {
+
+/**
+ * The functions that compare a read against a node sequence, as compiled for
+ * one instruction set.
+ */
+struct CompareKernels {
+    /// Name of the instruction set this build uses
+    const char* isa;
+    /// Get the length of the longest common prefix of a and b, up to len
+    /// characters.
+    size_t (*common_prefix_length)(const char* a, const char* b, size_t len);
+    /// Get the length of the longest common suffix of the len characters
+    /// ending before a_end and b_end.
+    size_t (*common_suffix_length)(const char* a_end, const char* b_end, size_t len);
+};
+
+/// Get the fastest build of the comparison kernels that this CPU can run.
+/// The choice is made once, on first use.
+const CompareKernels& get_compare_kernels();
+
+// The individual builds. Use get_compare_kernels() instead of these.
+extern const CompareKernels compare_kernels_base;
+#if defined(__x86_64__)
+extern const CompareKernels compare_kernels_avx2;
+#endif
+
+}
+
+#endif
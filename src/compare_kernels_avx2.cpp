@@ -0,0 +1,12 @@
+/** \file
+ * compare_kernels_avx2.cpp: Sequence comparison kernels built for AVX2. The
+ * Makefile adds -mavx2 when compiling this file.
+ */
+
+#if defined(__x86_64__)
+
+#define COMPARE_KERNELS_TABLE compare_kernels_avx2
+#define COMPARE_KERNELS_ISA "avx2"
+#include "compare_kernels_body.hpp"
+
+#endif
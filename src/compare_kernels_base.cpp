@@ -0,0 +1,8 @@
+/** \file
+ * compare_kernels_base.cpp: Sequence comparison kernels built for the
+ * baseline instruction set: SSE4.2 on x86-64, or NEON (through SIMDe) on ARM.
+ */
+
+#define COMPARE_KERNELS_TABLE compare_kernels_base
+#define COMPARE_KERNELS_ISA "base"
+#include "compare_kernels_body.hpp"
@@ -0,0 +1,112 @@
+/** \file
+ * compare_kernels_body.hpp: defines a CompareKernels table for whatever
+ * instruction set the including file is being compiled for.
+ *
+ * This is not a normal header. Include it exactly once, from a kernel
+ * translation unit, after defining COMPARE_KERNELS_TABLE to the name of the
+ * table to define and COMPARE_KERNELS_ISA to the name of the instruction set.
+ *
+ * Everything here has internal linkage except the table, so no code built
+ * for a wider instruction set can be picked up by the linker for use
+ * elsewhere.
+ */
+
+#include "compare_kernels.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#include <simde/x86/sse2.h>
+#ifdef __AVX2__
+#include <simde/x86/avx2.h>
+#endif
+
+namespace vg {
+
+namespace {
+
+size_t kernel_common_prefix_length(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+#ifdef __AVX2__
+    for (; i + 32 <= len; i += 32) {
+        simde__m256i x = simde_mm256_loadu_si256(reinterpret_cast<const simde__m256i*>(a + i));
+        simde__m256i y = simde_mm256_loadu_si256(reinterpret_cast<const simde__m256i*>(b + i));
+        std::uint32_t mismatches = ~static_cast<std::uint32_t>(simde_mm256_movemask_epi8(simde_mm256_cmpeq_epi8(x, y)));
+        if (mismatches != 0) {
+            return i + __builtin_ctz(mismatches);
+        }
+    }
+#endif
+    for (; i + 16 <= len; i += 16) {
+        simde__m128i x = simde_mm_loadu_si128(reinterpret_cast<const simde__m128i*>(a + i));
+        simde__m128i y = simde_mm_loadu_si128(reinterpret_cast<const simde__m128i*>(b + i));
+        std::uint32_t mismatches = ~static_cast<std::uint32_t>(simde_mm_movemask_epi8(simde_mm_cmpeq_epi8(x, y))) & 0xFFFF;
+        if (mismatches != 0) {
+            return i + __builtin_ctz(mismatches);
+        }
+    }
+    // Finish one word at a time.
+    while (i < len) {
+        size_t word = (len - i < sizeof(std::uint64_t) ? len - i : sizeof(std::uint64_t));
+        std::uint64_t x = 0, y = 0;
+        std::memcpy(&x, a + i, word);
+        std::memcpy(&y, b + i, word);
+        if (x != y) {
+            while (a[i] == b[i]) {
+                i++;
+            }
+            return i;
+        }
+        i += word;
+    }
+    return len;
+}
+
+size_t kernel_common_suffix_length(const char* a_end, const char* b_end, size_t len) {
+    size_t i = 0;
+#ifdef __AVX2__
+    for (; i + 32 <= len; i += 32) {
+        simde__m256i x = simde_mm256_loadu_si256(reinterpret_cast<const simde__m256i*>(a_end - i - 32));
+        simde__m256i y = simde_mm256_loadu_si256(reinterpret_cast<const simde__m256i*>(b_end - i - 32));
+        std::uint32_t mismatches = ~static_cast<std::uint32_t>(simde_mm256_movemask_epi8(simde_mm256_cmpeq_epi8(x, y)));
+        if (mismatches != 0) {
+            // The last mismatch in the block is the first one we reach.
+            return i + __builtin_clz(mismatches);
+        }
+    }
+#endif
+    for (; i + 16 <= len; i += 16) {
+        simde__m128i x = simde_mm_loadu_si128(reinterpret_cast<const simde__m128i*>(a_end - i - 16));
+        simde__m128i y = simde_mm_loadu_si128(reinterpret_cast<const simde__m128i*>(b_end - i - 16));
+        std::uint32_t mismatches = ~static_cast<std::uint32_t>(simde_mm_movemask_epi8(simde_mm_cmpeq_epi8(x, y))) & 0xFFFF;
+        if (mismatches != 0) {
+            // The last mismatch in the block is the first one we reach.
+            return i + (__builtin_clz(mismatches) - 16);
+        }
+    }
+    // Finish one word at a time.
+    while (i < len) {
+        size_t word = (len - i < sizeof(std::uint64_t) ? len - i : sizeof(std::uint64_t));
+        std::uint64_t x = 0, y = 0;
+        std::memcpy(&x, a_end - i - word, word);
+        std::memcpy(&y, b_end - i - word, word);
+        if (x != y) {
+            while (*(a_end - i - 1) == *(b_end - i - 1)) {
+                i++;
+            }
+            return i;
+        }
+        i += word;
+    }
+    return len;
+}
+
+}
+
+extern const CompareKernels COMPARE_KERNELS_TABLE = {
+    COMPARE_KERNELS_ISA,
+    kernel_common_prefix_length,
+    kernel_common_suffix_length
+};
+
+}
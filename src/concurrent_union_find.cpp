@@ -0,0 +1,58 @@
+/**
+ * \file concurrent_union_find.cpp: contains the implementation of ConcurrentUnionFind
+ */
+
+#include "concurrent_union_find.hpp"
+
+#include <utility>
+
+namespace vg {
+
+    using namespace std;
+
+    ConcurrentUnionFind::ConcurrentUnionFind(size_t size) : parent(size) {
+#pragma omp parallel for
+        for (size_t i = 0; i < size; ++i) {
+            parent[i].store(i, memory_order_relaxed);
+        }
+    }
+    
+    size_t ConcurrentUnionFind::size() const {
+        return parent.size();
+    }
+    
+    size_t ConcurrentUnionFind::find_group(size_t i) {
+        size_t p = parent[i].load(memory_order_acquire);
+        while (p != i) {
+            // point i at its grandparent, which only ever moves it closer to
+            // the root, so a failed exchange is harmless
+            size_t grandparent = parent[p].load(memory_order_acquire);
+            if (grandparent != p) {
+                parent[i].compare_exchange_weak(p, grandparent, memory_order_acq_rel);
+            }
+            i = p;
+            p = parent[i].load(memory_order_acquire);
+        }
+        return i;
+    }
+    
+    void ConcurrentUnionFind::union_groups(size_t i, size_t j) {
+        while (true) {
+            i = find_group(i);
+            j = find_group(j);
+            if (i == j) {
+                return;
+            }
+            if (i < j) {
+                std::swap(i, j);
+            }
+            // link the larger root under the smaller, unless someone else
+            // has given it a parent in the meantime
+            size_t expected = i;
+            if (parent[i].compare_exchange_strong(expected, j, memory_order_acq_rel)) {
+                return;
+            }
+        }
+    }
+
+}
@@ -0,0 +1,53 @@
+#ifndef VG_CONCURRENT_UNION_FIND_HPP_INCLUDED
+#define VG_CONCURRENT_UNION_FIND_HPP_INCLUDED
+
+/** \file
+ * concurrent_union_find.hpp: defines a union-find that many threads can
+ * update at once
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace vg {
+
+    using namespace std;
+
+    /**
+     * A lock-free union-find over the indices 0 to size - 1, for finding
+     * connected components with all threads at once. Groups are merged by
+     * compare-and-swap, always linking the larger root under the smaller, so
+     * the ID of a group is always its smallest index. Paths are compressed by
+     * halving as they are followed. Unions and finds may be called from any
+     * number of threads concurrently; a find that races with unions gives
+     * the group as it was at some point during the call.
+     *
+     * Unlike structures::UnionFind, there is no size or member tracking, so
+     * the memory use is one word per index.
+     */
+    class ConcurrentUnionFind {
+    public:
+        
+        /// Make a union-find where every index is in its own group
+        ConcurrentUnionFind(size_t size);
+        
+        /// Returns the number of indices in the union-find
+        size_t size() const;
+        
+        /// Returns the group ID that index i belongs to, which is the smallest
+        /// index in its group (can change after calling union_groups)
+        size_t find_group(size_t i);
+        
+        /// Merges the group containing index i with the group containing index j
+        void union_groups(size_t i, size_t j);
+        
+    private:
+        
+        /// The parent of each index, which points to itself for roots
+        vector<atomic<size_t>> parent;
+    };
+
+}
+
+#endif
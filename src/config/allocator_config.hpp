@@ -7,7 +7,11 @@
  * allocator_config_jemalloc.cpp or allocator_config_system.cpp as appropriate
  * for the build.
  */
- 
+
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace vg {
 
 /**
@@ -15,6 +19,21 @@ namespace vg {
  */
 void configure_memory_allocator();
 
+/**
+ * Account the memory that the calling thread allocates from now on to the
+ * named subsystem, or to no subsystem if the name is empty. Returns false if
+ * the allocator can't account memory by subsystem.
+ */
+bool set_thread_allocator_subsystem(const std::string& name);
+
+/**
+ * Get the bytes currently allocated to each subsystem that has been used, by
+ * name, followed by "other" for all the rest. Memory stays with the subsystem
+ * that allocated it, whichever thread frees it. Empty if the allocator can't
+ * account memory by subsystem.
+ */
+std::vector<std::pair<std::string, size_t>> get_allocator_subsystem_usage();
+
 }
  
 #endif
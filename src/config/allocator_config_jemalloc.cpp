@@ -8,6 +8,9 @@
 #include <iostream>
 #include <fstream>
 #include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 #include <jemalloc/jemalloc.h>
 
@@ -108,5 +111,84 @@ void configure_memory_allocator() {
     }
 }
 
+/// Subsystem arenas by name, in order of creation.
+static std::mutex subsystem_mutex;
+static std::vector<std::pair<std::string, unsigned>> subsystem_arenas;
+
+bool set_thread_allocator_subsystem(const std::string& name) {
+    // Remember the automatic arena jemalloc gave the thread, to go back to.
+    thread_local unsigned automatic_arena = 0;
+    thread_local bool in_subsystem = false;
+    
+    unsigned arena;
+    if (name.empty()) {
+        if (!in_subsystem) {
+            return true;
+        }
+        arena = automatic_arena;
+    } else {
+        std::lock_guard<std::mutex> lock(subsystem_mutex);
+        auto found = std::find_if(subsystem_arenas.begin(), subsystem_arenas.end(), [&](const std::pair<std::string, unsigned>& entry) {
+            return entry.first == name;
+        });
+        if (found != subsystem_arenas.end()) {
+            arena = found->second;
+        } else {
+            // Each subsystem gets an arena of its own, so its statistics are its own.
+            size_t arena_size = sizeof(arena);
+            if (mallctl("arenas.create", (void*) &arena, &arena_size, nullptr, 0)) {
+                return false;
+            }
+            subsystem_arenas.emplace_back(name, arena);
+        }
+    }
+    
+    unsigned old_arena;
+    size_t old_arena_size = sizeof(old_arena);
+    if (mallctl("thread.arena", (void*) &old_arena, &old_arena_size, (void*) &arena, sizeof(arena))) {
+        return false;
+    }
+    if (!in_subsystem) {
+        automatic_arena = old_arena;
+    }
+    in_subsystem = !name.empty();
+    return true;
+}
+
+std::vector<std::pair<std::string, size_t>> get_allocator_subsystem_usage() {
+    std::vector<std::pair<std::string, size_t>> usage;
+    
+    // Statistics are only brought up to date when the epoch advances.
+    uint64_t epoch = 1;
+    size_t epoch_size = sizeof(epoch);
+    if (mallctl("epoch", (void*) &epoch, &epoch_size, (void*) &epoch, epoch_size)) {
+        return usage;
+    }
+    size_t total = 0;
+    size_t total_size = sizeof(total);
+    if (mallctl("stats.allocated", (void*) &total, &total_size, nullptr, 0)) {
+        // jemalloc was built without statistics.
+        return usage;
+    }
+    
+    std::lock_guard<std::mutex> lock(subsystem_mutex);
+    size_t accounted = 0;
+    for (auto& entry : subsystem_arenas) {
+        size_t allocated = 0;
+        for (const char* kind : {"small", "large"}) {
+            std::string key = "stats.arenas." + std::to_string(entry.second) + "." + kind + ".allocated";
+            size_t kind_allocated = 0;
+            size_t kind_size = sizeof(kind_allocated);
+            if (mallctl(key.c_str(), (void*) &kind_allocated, &kind_size, nullptr, 0) == 0) {
+                allocated += kind_allocated;
+            }
+        }
+        usage.emplace_back(entry.first, allocated);
+        accounted += allocated;
+    }
+    usage.emplace_back("other", total > accounted ? total - accounted : 0);
+    return usage;
+}
+
 }
  
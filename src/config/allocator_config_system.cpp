@@ -14,6 +14,14 @@ void configure_memory_allocator() {
     // system, but it isn't really configurable in any meaningful way.
 }
 
+bool set_thread_allocator_subsystem(const std::string& name) {
+    // The system allocator has no way to keep track of this.
+    return false;
+}
+
+std::vector<std::pair<std::string, size_t>> get_allocator_subsystem_usage() {
+    return {};
 }
- 
 
+}
+ 
@@ -2165,6 +2165,53 @@ namespace vg {
             callback(chunk.graph);
         };
 
+        // Chunks don't depend on each other until they are wired together, so
+        // we collect a batch of them, build them in parallel, and then wire
+        // and emit them in order. Node IDs are only assigned during wiring,
+        // so they come out the same no matter how many threads we use.
+        // Each pending chunk is the reference sequence, the variants, and the
+        // start and past-the-end positions on the contig.
+        vector<tuple<string, vector<vcflib::Variant>, size_t, size_t>> pending_chunks;
+        // We want a few chunks per thread so slow chunks full of variants
+        // don't hold everyone up, but not so many that we hold lots of
+        // unwired graphs in memory.
+        size_t max_pending_chunks = get_thread_count() * 2;
+
+        // Build and emit all the pending chunks.
+        auto flush_chunks = [&]() {
+            vector<ConstructedChunk> results(pending_chunks.size());
+            #pragma omp parallel for schedule(dynamic, 1) if (pending_chunks.size() > 1)
+            for (size_t i = 0; i < pending_chunks.size(); i++) {
+                auto& pending = pending_chunks[i];
+                results[i] = construct_chunk(std::move(get<0>(pending)), reference_contig,
+                                             std::move(get<1>(pending)), get<2>(pending));
+            }
+            for (size_t i = 0; i < results.size(); i++) {
+                // Wire up and emit the chunk graph
+                wire_and_emit(results[i]);
+                // Release its memory before we do the next one
+                results[i] = ConstructedChunk();
+
+                // Say we've completed the chunk
+                update_progress(get<3>(pending_chunks[i]) - leading_offset);
+            }
+            pending_chunks.clear();
+        };
+
+        // Set aside the chunk from chunk_start to chunk_end with chunk_variants
+        // to be built, and build the batch if it is full. Leaves
+        // chunk_variants empty.
+        auto queue_chunk = [&]() {
+            // Get the ref sequence we need. The FASTA reader isn't thread
+            // safe so we do this here.
+            pending_chunks.emplace_back(reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start),
+                                        std::move(chunk_variants), chunk_start, chunk_end);
+            chunk_variants.clear();
+            if (pending_chunks.size() >= max_pending_chunks) {
+                flush_chunks();
+            }
+        };
+
         bool do_external_insertions = false;
         FastaReference* insertion_fasta;
 
@@ -2362,17 +2409,8 @@ namespace vg {
                             min((size_t) reference_end,
                                 (size_t) (chunk_start + bases_per_chunk))));
 
-                // Get the ref sequence we need
-                auto chunk_ref = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
-
-                // Call the construction
-                auto result = construct_chunk(chunk_ref, reference_contig, chunk_variants, chunk_start);
-
-                // Wire up and emit the chunk graph
-                wire_and_emit(result);
-
-                // Say we've completed the chunk
-                update_progress(chunk_end - leading_offset);
+                // Queue up the chunk to be built
+                queue_chunk();
 
                 // Set up a new chunk
                 chunk_start = chunk_end;
@@ -2398,17 +2436,8 @@ namespace vg {
                     min((size_t) reference_end,
                         (size_t) (chunk_start + bases_per_chunk)));
 
-            // Get the ref sequence we need
-            auto chunk_ref = reference.getSubSequence(reference_contig, chunk_start, chunk_end - chunk_start);
-
-            // Call the construction
-            auto result = construct_chunk(chunk_ref, reference_contig, chunk_variants, chunk_start);
-
-            // Wire up and emit the chunk graph
-            wire_and_emit(result);
-
-            // Say we've completed the chunk
-            update_progress(chunk_end - leading_offset);
+            // Queue up the chunk to be built
+            queue_chunk();
 
             // Set up a new chunk
             chunk_start = chunk_end;
@@ -2416,6 +2445,9 @@ namespace vg {
             chunk_variants.clear();
         }
 
+        // Build whatever chunks are still waiting
+        flush_chunks();
+
         // All the chunks have been wired and emitted.
         
         if (last_node_buffer.id() != 0) {
@@ -2462,8 +2494,10 @@ namespace vg {
                 continue;
             }
 
-            // These will all get destructed when the vector goes away.
-            buffers.emplace_back(new VcfBuffer(vcf));
+            // These will all get destructed when the vector goes away. Read
+            // ahead in the background so VCF decompression and parsing
+            // overlap with construction.
+            buffers.emplace_back(new VcfBuffer(vcf, 1024));
         }
 
         if (!allowed_vcf_names.empty()) {
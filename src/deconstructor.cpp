@@ -1,6 +1,8 @@
 #include "deconstructor.hpp"
 #include "traversal_finder.hpp"
+#include "wang_hash.hpp"
 #include <gbwtgraph/gbwtgraph.h>
+#include <htslib/hts.h>
 
 //#define debug
 
@@ -1118,6 +1120,10 @@ void Deconstructor::deconstruct(vector<string> ref_paths, const PathPositionHand
         gbwt_trav_finder = unique_ptr<GBWTTraversalFinder>(new GBWTTraversalFinder(*graph, *gbwt));
     }
 
+    if (!prior_vcf_name.empty()) {
+        load_prior_run();
+    }
+
     vector<const Snarl*> snarls_todo;
     // Do the top-level snarls in parallel
     snarl_manager->for_each_top_level_snarl([&](const Snarl* snarl) {
@@ -1141,6 +1147,17 @@ void Deconstructor::deconstruct(vector<string> ref_paths, const PathPositionHand
             }
         });
 
+    // walk the paths once to find where they visit all the snarls, so each
+    // site doesn't have to search for its own path traversals
+    path_trav_finder->index_snarl_boundaries(snarls_todo);
+    if (gbwt_trav_finder.get() != nullptr) {
+        gbwt_trav_finder->index_snarl_boundaries(snarls_todo);
+    }
+
+    // fingerprints tell us which snarls can keep their prior records
+    bool use_fingerprints = !prior_fingerprints_name.empty() || !fingerprints_out_name.empty();
+    vector<uint64_t> fingerprints(use_fingerprints ? snarls_todo.size() : 0);
+
 //#pragma omp parallel
 //#pragma omp single
     {
@@ -1149,16 +1166,161 @@ void Deconstructor::deconstruct(vector<string> ref_paths, const PathPositionHand
 //#pragma omp task firstprivate(i)
             {
                 auto& snarl = snarls_todo[i];
+                if (use_fingerprints) {
+                    fingerprints[i] = snarl_fingerprint(snarl);
+                    if (reuse_prior_records(snarl, fingerprints[i])) {
+                        continue;
+                    }
+                }
                 deconstruct_site(snarl);
             }
         }
     }
 //#pragma omp taskwait
 
+    if (!fingerprints_out_name.empty()) {
+        ofstream fingerprints_out(fingerprints_out_name);
+        if (!fingerprints_out) {
+            cerr << "Error [vg deconstruct]: Unable to write fingerprints file: " << fingerprints_out_name << endl;
+            exit(1);
+        }
+        for (size_t i = 0; i < snarls_todo.size(); ++i) {
+            fingerprints_out << print_snarl(*snarls_todo[i]) << "\t" << fingerprints[i] << "\n";
+        }
+    }
+
     // write variants in sorted order
     write_variants(cout, snarl_manager);
 }
 
+void Deconstructor::set_prior_run(const string& prior_vcf_name, const string& prior_fingerprints_name) {
+    this->prior_vcf_name = prior_vcf_name;
+    this->prior_fingerprints_name = prior_fingerprints_name;
+}
+
+void Deconstructor::set_fingerprint_output(const string& fingerprints_out_name) {
+    this->fingerprints_out_name = fingerprints_out_name;
+}
+
+uint64_t Deconstructor::snarl_fingerprint(const Snarl* snarl) const {
+    // we add up the hashes of the parts so that the order we find them in doesn't matter
+    uint64_t fingerprint = 0;
+    unordered_set<id_t> nodes = snarl_manager->deep_contents(snarl, *graph, true).first;
+    for (id_t node_id : nodes) {
+        handle_t handle = graph->get_handle(node_id);
+        fingerprint += wang_hash_64(node_id) ^ std::hash<string>()(graph->get_sequence(handle));
+        // edges within the snarl, from each side
+        for (bool go_left : {false, true}) {
+            graph->follow_edges(handle, go_left, [&](const handle_t& other) {
+                if (nodes.count(graph->get_id(other))) {
+                    fingerprint += wang_hash_64((as_integer(handle) << 1 | go_left) ^ wang_hash_64(as_integer(other)));
+                }
+            });
+        }
+        // path steps, tied to the next step so that we see the order the paths walk in
+        graph->for_each_step_on_handle(handle, [&](const step_handle_t& step) {
+            string path_name = graph->get_path_name(graph->get_path_handle_of_step(step));
+            uint64_t step_hash = std::hash<string>()(path_name) ^ wang_hash_64(as_integer(graph->get_handle_of_step(step)));
+            if (graph->has_next_step(step)) {
+                step_hash ^= wang_hash_64(~as_integer(graph->get_handle_of_step(graph->get_next_step(step))));
+            }
+            if (ref_paths.count(path_name)) {
+                // the record positions come from the reference paths
+                step_hash ^= wang_hash_64(graph->get_position_of_step(step) ^ 0x9e3779b97f4a7c15ull);
+            }
+            fingerprint += wang_hash_64(step_hash);
+        });
+    }
+    return fingerprint;
+}
+
+void Deconstructor::load_prior_run() {
+    ifstream fingerprints_in(prior_fingerprints_name);
+    if (!fingerprints_in) {
+        cerr << "Error [vg deconstruct]: Unable to read fingerprints file: " << prior_fingerprints_name << endl;
+        exit(1);
+    }
+    string name;
+    uint64_t fingerprint;
+    while (fingerprints_in >> name >> fingerprint) {
+        prior_fingerprints[name] = fingerprint;
+    }
+
+    htsFile* vcf_file = hts_open(prior_vcf_name.c_str(), "r");
+    if (vcf_file == nullptr) {
+        cerr << "Error [vg deconstruct]: Unable to read prior VCF: " << prior_vcf_name << endl;
+        exit(1);
+    }
+    // for each of our sample columns, where it is in the prior VCF (or 0 if it isn't)
+    vector<size_t> prior_columns;
+    kstring_t line = {0, 0, nullptr};
+    while (hts_getline(vcf_file, KS_SEP_LINE, &line) >= 0) {
+        if (line.l == 0 || (line.s[0] == '#' && line.l > 1 && line.s[1] == '#')) {
+            continue;
+        }
+        vector<string> toks = split_delims(string(line.s, line.l), "\t");
+        if (toks[0] == "#CHROM") {
+            unordered_map<string, size_t> prior_sample_columns;
+            for (size_t i = 9; i < toks.size(); ++i) {
+                prior_sample_columns[toks[i]] = i;
+            }
+            for (const string& sample_name : sample_names) {
+                prior_columns.push_back(prior_sample_columns.count(sample_name) ? prior_sample_columns[sample_name] : 0);
+            }
+            continue;
+        }
+        if (toks.size() < 8) {
+            cerr << "Error [vg deconstruct]: Malformed record in prior VCF: " << prior_vcf_name << endl;
+            exit(1);
+        }
+        if (include_nested) {
+            // these get recomputed over the whole output
+            vector<string> info_toks = split_delims(toks[7], ";");
+            toks[7].clear();
+            for (const string& info_tok : info_toks) {
+                if (info_tok.compare(0, 3, "LV=") != 0 && info_tok.compare(0, 3, "PS=") != 0) {
+                    toks[7] += (toks[7].empty() ? "" : ";") + info_tok;
+                }
+            }
+            if (toks[7].empty()) {
+                toks[7] = ".";
+            }
+        }
+        string record;
+        for (size_t i = 0; i < toks.size() && i < 9; ++i) {
+            record += (i > 0 ? "\t" : "") + toks[i];
+        }
+        if (toks.size() > 8) {
+            // move the genotypes to our sample columns, leaving any new samples blank
+            for (size_t column : prior_columns) {
+                record += "\t" + (column > 0 && column < toks.size() ? toks[column] : string("."));
+            }
+        }
+        prior_records[toks[2]].emplace_back(toks[0], parse<size_t>(toks[1]), std::move(record));
+    }
+    free(line.s);
+    hts_close(vcf_file);
+}
+
+bool Deconstructor::reuse_prior_records(const Snarl* snarl, uint64_t fingerprint) const {
+    if (prior_fingerprints.empty()) {
+        return false;
+    }
+    string name = print_snarl(*snarl);
+    auto it = prior_fingerprints.find(name);
+    if (it == prior_fingerprints.end() || it->second != fingerprint) {
+        return false;
+    }
+    // unchanged: the prior records (if any) are still right
+    auto records = prior_records.find(name);
+    if (records != prior_records.end()) {
+        for (auto& record : records->second) {
+            add_variant_record(get<2>(record), get<0>(record), get<1>(record));
+        }
+    }
+    return true;
+}
+
 bool Deconstructor::check_max_nodes(const Snarl* snarl) const  {
     unordered_set<id_t> nodeset = snarl_manager->deep_contents(snarl, *graph, false).first;
     int node_count = 0;
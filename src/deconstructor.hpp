@@ -48,6 +48,14 @@ public:
                      bool strict_conflicts,
                      bool long_ref_contig,
                      gbwt::GBWT* gbwt = nullptr);
+
+    // reuse the records of a prior run (its VCF and the fingerprints it wrote) for every
+    // snarl whose fingerprint hasn't changed, and only deconstruct the others.
+    // the prior run must have used the same options and reference paths.
+    void set_prior_run(const string& prior_vcf_name, const string& prior_fingerprints_name);
+
+    // write the fingerprint of every snarl deconstructed to this file, for use in a later run
+    void set_fingerprint_output(const string& fingerprints_out_name);
     
 private:
 
@@ -74,6 +82,16 @@ private:
                                               const vector<string>& trav_to_name,
                                               const vector<int>& gbwt_phases) const;
 
+    // hash the sequence, edges and path steps inside a snarl, along with where the reference
+    // paths are, so that we can tell if its records could have changed
+    uint64_t snarl_fingerprint(const Snarl* snarl) const;
+
+    // read in the prior run's records, converting them to our sample columns
+    void load_prior_run();
+
+    // if the snarl is unchanged since the prior run, add its prior records and return true
+    bool reuse_prior_records(const Snarl* snarl, uint64_t fingerprint) const;
+    
     // check to see if a snarl is too big to exhaustively traverse
     bool check_max_nodes(const Snarl* snarl) const;
 
@@ -163,6 +181,15 @@ private:
 
     // warn about context jaccard not working with exhaustive traversals
     mutable atomic<bool> exhaustive_jaccard_warning;
+
+    // incremental mode: the prior run's files
+    string prior_vcf_name;
+    string prior_fingerprints_name;
+    string fingerprints_out_name;
+
+    // the prior run's fingerprints and records, by snarl name
+    unordered_map<string, uint64_t> prior_fingerprints;
+    unordered_map<string, vector<tuple<string, size_t, string>>> prior_records;
 };
 
 // helpel for measuring set intersectiond and union size
@@ -0,0 +1,265 @@
+/**
+ * \file direct_gaf_alignment_emitter.cpp
+ * Implementation for DirectGAFAlignmentEmitter
+ */
+
+
+#include "direct_gaf_alignment_emitter.hpp"
+#include "annotation.hpp"
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+namespace vg {
+
+using namespace std;
+
+const size_t DirectGAFAlignmentEmitter::FLUSH_THRESHOLD = 1024 * 1024;
+
+DirectGAFAlignmentEmitter::DirectGAFAlignmentEmitter(const string& filename, const HandleGraph& graph, size_t max_threads) :
+    graph(graph),
+    out_file(filename == "-" ? nullptr : new ofstream(filename)),
+    out(out_file.get() != nullptr ? *out_file : cout),
+    thread_buffers(std::max<size_t>(max_threads, 1)) {
+
+    if (out_file.get() != nullptr && !*out_file) {
+        // Make sure we opened a file if we aren't writing to standard output
+        cerr << "[vg::DirectGAFAlignmentEmitter] failed to open " << filename << " for writing" << endl;
+        exit(1);
+    }
+}
+
+DirectGAFAlignmentEmitter::~DirectGAFAlignmentEmitter() {
+    // Everyone is done emitting now, so write out whatever is left.
+    for (auto& buffer : thread_buffers) {
+        out.write(buffer.data(), buffer.size());
+    }
+    out.flush();
+}
+
+string& DirectGAFAlignmentEmitter::get_buffer() {
+    size_t thread_number = omp_get_thread_num();
+    if (thread_number >= thread_buffers.size()) {
+        cerr << "error[vg::DirectGAFAlignmentEmitter]: thread " << thread_number << " is beyond the "
+             << thread_buffers.size() << " threads the emitter was made for" << endl;
+        exit(1);
+    }
+    return thread_buffers[thread_number];
+}
+
+void DirectGAFAlignmentEmitter::flush_if_full(string& buffer) {
+    if (buffer.size() >= FLUSH_THRESHOLD) {
+        lock_guard<mutex> lock(out_mutex);
+        out.write(buffer.data(), buffer.size());
+        // Keep the capacity for the next lines.
+        buffer.clear();
+    }
+}
+
+void DirectGAFAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
+    string& buffer = get_buffer();
+    for (auto& aln : aln_batch) {
+        append_gaf_line(graph, aln, buffer);
+    }
+    flush_if_full(buffer);
+}
+
+void DirectGAFAlignmentEmitter::emit_mapped_singles(vector<vector<Alignment>>&& alns_batch) {
+    string& buffer = get_buffer();
+    for (auto& alns : alns_batch) {
+        for (auto& aln : alns) {
+            append_gaf_line(graph, aln, buffer);
+        }
+    }
+    flush_if_full(buffer);
+}
+
+void DirectGAFAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch, vector<int64_t>&& tlen_limit_batch) {
+    assert(aln1_batch.size() == aln2_batch.size());
+    string& buffer = get_buffer();
+    for (size_t i = 0; i < aln1_batch.size(); i++) {
+        append_gaf_line(graph, aln1_batch[i], buffer);
+        append_gaf_line(graph, aln2_batch[i], buffer);
+    }
+    flush_if_full(buffer);
+}
+
+void DirectGAFAlignmentEmitter::emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch, vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch) {
+    assert(alns1_batch.size() == alns2_batch.size());
+    string& buffer = get_buffer();
+    for (size_t i = 0; i < alns1_batch.size(); i++) {
+        assert(alns1_batch[i].size() == alns2_batch[i].size());
+        for (size_t j = 0; j < alns1_batch[i].size(); j++) {
+            append_gaf_line(graph, alns1_batch[i][j], buffer);
+            append_gaf_line(graph, alns2_batch[i][j], buffer);
+        }
+    }
+    flush_if_full(buffer);
+}
+
+/// Append a number in decimal to a buffer.
+static inline void append_number(string& buffer, int64_t number) {
+    buffer.append(std::to_string(number));
+}
+
+void DirectGAFAlignmentEmitter::append_gaf_line(const HandleGraph& graph, const Alignment& aln, string& buffer) {
+    const Path& path = aln.path();
+
+    buffer.append(aln.name().empty() ? "*" : aln.name());
+    buffer.push_back('\t');
+    append_number(buffer, aln.sequence().size());
+
+    if (path.mapping_size() == 0) {
+        // Unmapped reads get placeholders for everything positional.
+        buffer.append("\t*\t*\t*\t*\t*\t*\t*\t0\t0\t");
+        append_number(buffer, aln.mapping_quality());
+    } else {
+        // Leading and trailing insertions are soft clips, and don't count as
+        // part of the aligned block.
+        const Mapping& first_mapping = path.mapping(0);
+        const Mapping& last_mapping = path.mapping(path.mapping_size() - 1);
+        const Edit* leading_clip = nullptr;
+        const Edit* trailing_clip = nullptr;
+        if (first_mapping.edit_size() > 0 && first_mapping.edit(0).from_length() == 0) {
+            leading_clip = &first_mapping.edit(0);
+        }
+        if (last_mapping.edit_size() > 0 && last_mapping.edit(last_mapping.edit_size() - 1).from_length() == 0) {
+            trailing_clip = &last_mapping.edit(last_mapping.edit_size() - 1);
+            if (trailing_clip == leading_clip) {
+                // Only count an all-insertion path once.
+                trailing_clip = nullptr;
+            }
+        }
+        size_t query_start = leading_clip ? leading_clip->to_length() : 0;
+        size_t query_end = aln.sequence().size() - (trailing_clip ? trailing_clip->to_length() : 0);
+
+        buffer.push_back('\t');
+        append_number(buffer, query_start);
+        buffer.push_back('\t');
+        append_number(buffer, query_end);
+        buffer.append("\t+\t");
+
+        // Walk the path once, writing the node list and collecting the
+        // difference string and statistics as we go.
+        thread_local string difference;
+        difference.clear();
+        thread_local string node_sequence;
+        size_t match_run = 0;
+        size_t residue_matches = 0;
+        // The block covers the longer of the read and graph sides.
+        size_t aligned_from_length = 0;
+        size_t aligned_to_length = 0;
+
+        int64_t path_length = 0;
+        int64_t path_start = first_mapping.position().offset();
+        int64_t last_node_length = 0;
+        size_t last_end = 0;
+
+        for (size_t i = 0; i < path.mapping_size(); i++) {
+            const Mapping& mapping = path.mapping(i);
+            const Position& position = mapping.position();
+            handle_t handle = graph.get_handle(position.node_id(), position.is_reverse());
+
+            if (i == 0 || position.node_id() != path.mapping(i - 1).position().node_id() ||
+                position.is_reverse() != path.mapping(i - 1).position().is_reverse() ||
+                (size_t) position.offset() != last_end) {
+                // This is a new visit, not a continuation of the last one.
+                buffer.push_back(position.is_reverse() ? '<' : '>');
+                append_number(buffer, position.node_id());
+                last_node_length = graph.get_length(handle);
+                path_length += last_node_length;
+            }
+
+            // Only fetch the node sequence if some edit needs reference bases.
+            bool have_sequence = false;
+            size_t node_offset = position.offset();
+            for (size_t j = 0; j < mapping.edit_size(); j++) {
+                const Edit& edit = mapping.edit(j);
+                if (&edit == leading_clip || &edit == trailing_clip) {
+                    continue;
+                }
+                if (edit.from_length() == edit.to_length() && edit.sequence().empty()) {
+                    // A match
+                    match_run += edit.from_length();
+                    residue_matches += edit.from_length();
+                } else {
+                    if (match_run > 0) {
+                        difference.push_back(':');
+                        append_number(difference, match_run);
+                        match_run = 0;
+                    }
+                    if (edit.from_length() > 0 && !have_sequence) {
+                        node_sequence = graph.get_sequence(handle);
+                        have_sequence = true;
+                    }
+                    if (edit.from_length() == edit.to_length()) {
+                        // A substitution, which cs writes base by base
+                        for (size_t k = 0; k < edit.from_length(); k++) {
+                            difference.push_back('*');
+                            difference.push_back(node_sequence[node_offset + k]);
+                            difference.push_back(edit.sequence()[k]);
+                        }
+                    } else {
+                        // Insertions, deletions, and anything more complex are
+                        // written as a deletion followed by an insertion.
+                        if (edit.from_length() > 0) {
+                            difference.push_back('-');
+                            difference.append(node_sequence, node_offset, edit.from_length());
+                        }
+                        if (edit.to_length() > 0) {
+                            difference.push_back('+');
+                            difference.append(edit.sequence());
+                        }
+                    }
+                }
+                aligned_from_length += edit.from_length();
+                aligned_to_length += edit.to_length();
+                node_offset += edit.from_length();
+            }
+            last_end = node_offset;
+        }
+        if (match_run > 0) {
+            difference.push_back(':');
+            append_number(difference, match_run);
+        }
+
+        buffer.push_back('\t');
+        append_number(buffer, path_length);
+        buffer.push_back('\t');
+        append_number(buffer, path_start);
+        buffer.push_back('\t');
+        append_number(buffer, path_length - last_node_length + last_end);
+        buffer.push_back('\t');
+        append_number(buffer, residue_matches);
+        buffer.push_back('\t');
+        append_number(buffer, std::max(aligned_from_length, aligned_to_length));
+        buffer.push_back('\t');
+        append_number(buffer, aln.mapping_quality());
+
+        buffer.append("\tcs:Z:");
+        buffer.append(difference);
+    }
+
+    if (aln.score() != 0) {
+        buffer.append("\tAS:i:");
+        append_number(buffer, aln.score());
+    }
+    if (aln.has_fragment_prev() && !aln.fragment_prev().name().empty()) {
+        buffer.append("\tfp:Z:");
+        buffer.append(aln.fragment_prev().name());
+    }
+    if (aln.has_fragment_next() && !aln.fragment_next().name().empty()) {
+        buffer.append("\tfn:Z:");
+        buffer.append(aln.fragment_next().name());
+    }
+    if (has_annotation(aln, "proper_pair")) {
+        buffer.append("\tpd:b:");
+        buffer.push_back(get_annotation<bool>(aln, "proper_pair") ? '1' : '0');
+    }
+    buffer.push_back('\n');
+}
+
+}
@@ -0,0 +1,90 @@
+#ifndef VG_DIRECT_GAF_ALIGNMENT_EMITTER_HPP_INCLUDED
+#define VG_DIRECT_GAF_ALIGNMENT_EMITTER_HPP_INCLUDED
+
+/** \file
+ *
+ * Holds an AlignmentEmitter that writes GAF text straight from Alignments.
+ */
+
+
+#include "vg/io/alignment_emitter.hpp"
+#include "handle.hpp"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * An AlignmentEmitter implementation that formats GAF lines directly from the
+ * fields of each Alignment into a per-thread text buffer, without building an
+ * intermediate GAF record for each read. Buffers are written to the output
+ * stream in large chunks, so the lines for each emitted batch stay together.
+ *
+ * Produces the standard 12 GAF columns in node ID space, plus a cs tag, and
+ * where available, AS, fp, fn, and pd tags.
+ */
+class DirectGAFAlignmentEmitter : public vg::io::AlignmentEmitter {
+public:
+
+    /**
+     * Make an emitter that writes GAF to the given file (or "-" for standard
+     * output), using the given graph for node lengths and sequences, and
+     * expecting to be called from up to max_threads OMP threads.
+     */
+    DirectGAFAlignmentEmitter(const string& filename, const HandleGraph& graph, size_t max_threads);
+
+    /// Flush all buffered lines and close the file.
+    virtual ~DirectGAFAlignmentEmitter();
+
+    /// Emit a batch of Alignments
+    virtual void emit_singles(vector<Alignment>&& aln_batch);
+    /// Emit batch of Alignments with secondaries. All secondaries must have is_secondary set already.
+    virtual void emit_mapped_singles(vector<vector<Alignment>>&& alns_batch);
+    /// Emit a batch of pairs of Alignments. The tlen_limit_batch is
+    /// ignored, since GAF carries pairing information in tags.
+    virtual void emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch,
+        vector<int64_t>&& tlen_limit_batch);
+    /// Emit the mappings of a batch of pairs of Alignments. All secondaries
+    /// must have is_secondary set already.
+    ///
+    /// Both ends of each pair must have the same number of mappings.
+    virtual void emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch,
+        vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch);
+
+    /// Append the GAF line for the given Alignment, with its trailing
+    /// newline, to the given buffer.
+    static void append_gaf_line(const HandleGraph& graph, const Alignment& aln, string& buffer);
+
+    /// How big can a thread's buffer get before we write it out?
+    static const size_t FLUSH_THRESHOLD;
+
+protected:
+    /// Graph to get node lengths and sequences from.
+    const HandleGraph& graph;
+
+    /// File we own, if not writing to standard output.
+    unique_ptr<ofstream> out_file;
+    /// Stream we write to.
+    ostream& out;
+    /// Mutex serializing writes to out.
+    mutex out_mutex;
+
+    /// Text buffer for each thread.
+    vector<string> thread_buffers;
+
+    /// Get the buffer for the calling thread.
+    string& get_buffer();
+
+    /// Write out the calling thread's buffer if it has gotten big.
+    void flush_if_full(string& buffer);
+};
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * \file distance_cache.cpp
+ * Implementation of the per-read distance query cache.
+ */
+
+#include "distance_cache.hpp"
+
+namespace vg {
+
+using namespace std;
+
+size_t DistanceCache::minimum_distance(const SnarlDistanceIndex& distance_index, const pos_t& from, const pos_t& to,
+                                       const HandleGraph* graph) {
+    auto key = make_tuple(from, to, graph);
+    auto found = position_distances.find(key);
+    if (found != position_distances.end()) {
+        hit_count++;
+        return found->second;
+    }
+    miss_count++;
+    size_t distance = distance_index.minimum_distance(id(from), is_rev(from), offset(from),
+                                                      id(to), is_rev(to), offset(to),
+                                                      false, graph);
+    position_distances.emplace(key, distance);
+    return distance;
+}
+
+size_t DistanceCache::distance_in_parent(const SnarlDistanceIndex& distance_index, const net_handle_t& parent,
+                                         const net_handle_t& child1, const net_handle_t& child2,
+                                         const HandleGraph* graph, size_t distance_limit) {
+    auto key = make_tuple(as_integer(parent), as_integer(child1), as_integer(child2), graph, distance_limit);
+    auto found = child_distances.find(key);
+    if (found != child_distances.end()) {
+        hit_count++;
+        return found->second;
+    }
+    miss_count++;
+    size_t distance = distance_index.distance_in_parent(parent, child1, child2, graph, distance_limit);
+    child_distances.emplace(key, distance);
+    return distance;
+}
+
+size_t DistanceCache::hits() const {
+    return hit_count;
+}
+
+size_t DistanceCache::misses() const {
+    return miss_count;
+}
+
+void DistanceCache::clear() {
+    position_distances.clear();
+    child_distances.clear();
+    hit_count = 0;
+    miss_count = 0;
+}
+
+}
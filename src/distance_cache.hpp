@@ -0,0 +1,66 @@
+#ifndef VG_DISTANCE_CACHE_HPP_INCLUDED
+#define VG_DISTANCE_CACHE_HPP_INCLUDED
+
+/**
+ * \file distance_cache.hpp
+ * Defines a cache of distance index query results, for reuse within the
+ * mapping of a single read.
+ */
+
+#include "snarl_distance_index.hpp"
+#include "hash_map.hpp"
+
+#include <tuple>
+#include <unordered_map>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Remembers the answers to SnarlDistanceIndex queries, so that when the same
+ * pair of positions or snarl tree children comes up again while mapping a
+ * read, we don't have to walk the snarl tree again.
+ *
+ * Meant to live for the mapping of one read (or pair), so it never gets too
+ * big and never outlives the distance index. Not thread safe.
+ */
+class DistanceCache {
+public:
+
+    /// Get the oriented minimum distance between two positions, as
+    /// minimum_distance() would.
+    size_t minimum_distance(const SnarlDistanceIndex& distance_index, const pos_t& from, const pos_t& to,
+                            const HandleGraph* graph = nullptr);
+
+    /// Get the distance between two children of a parent snarl tree node, as
+    /// SnarlDistanceIndex::distance_in_parent() would.
+    size_t distance_in_parent(const SnarlDistanceIndex& distance_index, const net_handle_t& parent,
+                              const net_handle_t& child1, const net_handle_t& child2,
+                              const HandleGraph* graph = nullptr,
+                              size_t distance_limit = std::numeric_limits<size_t>::max());
+
+    /// Get the number of queries answered from the cache.
+    size_t hits() const;
+
+    /// Get the number of queries that had to go to the distance index.
+    size_t misses() const;
+
+    /// Forget all cached distances, and reset the counters.
+    void clear();
+
+protected:
+    /// Cached position-to-position distances, by from position, to position,
+    /// and graph used.
+    unordered_map<tuple<pos_t, pos_t, const HandleGraph*>, size_t> position_distances;
+    /// Cached child-to-child distances, by parent, children, graph used, and
+    /// distance limit.
+    unordered_map<tuple<uint64_t, uint64_t, uint64_t, const HandleGraph*, size_t>, size_t> child_distances;
+
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * \file dozeu_kernels.cpp: picks which build of the dozeu kernels to use
+ */
+
+#include "dozeu_kernels.hpp"
+
+namespace vg {
+
+/// Find the fastest build of the kernels this CPU supports
+static const DozeuKernels* choose_dozeu_kernels(bool qual_adj) {
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl")) {
+        return qual_adj ? &qual_adj_dozeu_kernels_avx512 : &dozeu_kernels_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return qual_adj ? &qual_adj_dozeu_kernels_avx2 : &dozeu_kernels_avx2;
+    }
+#endif
+    return qual_adj ? &qual_adj_dozeu_kernels_base : &dozeu_kernels_base;
+}
+
+const DozeuKernels& get_dozeu_kernels(bool qual_adj) {
+    static const DozeuKernels* regular = choose_dozeu_kernels(false);
+    static const DozeuKernels* qual = choose_dozeu_kernels(true);
+    return qual_adj ? *qual : *regular;
+}
+
+}
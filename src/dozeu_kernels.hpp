@@ -0,0 +1,69 @@
+#ifndef VG_DOZEU_KERNELS_HPP_INCLUDED
+#define VG_DOZEU_KERNELS_HPP_INCLUDED
+
+/** \file
+ * dozeu_kernels.hpp: defines DozeuKernels, a table of entry points into one
+ * build of the dozeu inner loop, so that the X-drop aligners can use the best
+ * build for the CPU they are running on.
+ *
+ * This header is included from translation units compiled for instruction
+ * sets the CPU might not have, so it must not pull in any C++ library code
+ * that could end up shared between those and the rest of vg.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+// forward declarations of dozeu structs
+struct dz_s;
+struct dz_forefront_s;
+struct dz_query_s;
+struct dz_alignment_s;
+
+namespace vg {
+
+/**
+ * The dozeu functions that do the vectorized work of X-drop alignment, for
+ * either the regular or the quality adjusted scoring, as compiled for one
+ * instruction set. The dz_s objects made by one table's init must only be
+ * used with that same table.
+ */
+struct DozeuKernels {
+    /// Name of the instruction set this build uses
+    const char* isa;
+    /// Make a dz_s. The quality adjusted matrix is ignored for regular scoring.
+    dz_s* (*init)(const int8_t* score_matrix, const int8_t* qual_adj_score_matrix,
+                  uint16_t gap_open, uint16_t gap_extend);
+    void (*destroy)(dz_s* dz);
+    /// Pack a query. The qualities are ignored for regular scoring.
+    dz_query_s* (*pack_query_forward)(dz_s* dz, const char* seq, const uint8_t* qual,
+                                      int8_t full_length_bonus, size_t len);
+    dz_query_s* (*pack_query_reverse)(dz_s* dz, const char* seq, const uint8_t* qual,
+                                      int8_t full_length_bonus, size_t len);
+    const dz_forefront_s* (*scan)(dz_s* dz, const dz_query_s* query, const dz_forefront_s** forefronts,
+                                  size_t n_forefronts, const char* ref, int32_t rlen, uint32_t rid,
+                                  uint16_t xt);
+    const dz_forefront_s* (*extend)(dz_s* dz, const dz_query_s* query, const dz_forefront_s** forefronts,
+                                    size_t n_forefronts, const char* ref, int32_t rlen, uint32_t rid,
+                                    uint16_t xt);
+    dz_alignment_s* (*trace)(dz_s* dz, const dz_forefront_s* forefront);
+    void (*flush)(dz_s* dz);
+};
+
+/// Get the fastest build of the regular or quality adjusted dozeu kernels
+/// that this CPU can run. The choice is made once, on first use.
+const DozeuKernels& get_dozeu_kernels(bool qual_adj);
+
+// The individual builds. Use get_dozeu_kernels() instead of these.
+extern const DozeuKernels dozeu_kernels_base;
+extern const DozeuKernels qual_adj_dozeu_kernels_base;
+#if defined(__x86_64__)
+extern const DozeuKernels dozeu_kernels_avx2;
+extern const DozeuKernels qual_adj_dozeu_kernels_avx2;
+extern const DozeuKernels dozeu_kernels_avx512;
+extern const DozeuKernels qual_adj_dozeu_kernels_avx512;
+#endif
+
+}
+
+#endif
@@ -0,0 +1,12 @@
+/** \file
+ * dozeu_kernels_avx2.cpp: Dozeu kernels built for AVX2. The Makefile adds
+ * -mavx2 when compiling this file.
+ */
+
+#if defined(__x86_64__)
+
+#define DOZEU_KERNELS_TABLE dozeu_kernels_avx2
+#define DOZEU_KERNELS_ISA "avx2"
+#include "dozeu_kernels_body.hpp"
+
+#endif
@@ -0,0 +1,12 @@
+/** \file
+ * dozeu_kernels_avx512.cpp: Dozeu kernels built for AVX-512. The Makefile
+ * adds -mavx512f -mavx512bw -mavx512vl when compiling this file.
+ */
+
+#if defined(__x86_64__)
+
+#define DOZEU_KERNELS_TABLE dozeu_kernels_avx512
+#define DOZEU_KERNELS_ISA "avx512"
+#include "dozeu_kernels_body.hpp"
+
+#endif
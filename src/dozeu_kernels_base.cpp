@@ -0,0 +1,8 @@
+/** \file
+ * dozeu_kernels_base.cpp: Dozeu kernels built for the baseline instruction
+ * set: SSE4.2 on x86-64, or NEON (through SIMDe) on ARM.
+ */
+
+#define DOZEU_KERNELS_TABLE dozeu_kernels_base
+#define DOZEU_KERNELS_ISA "base"
+#include "dozeu_kernels_body.hpp"
@@ -0,0 +1,129 @@
+/** \file
+ * dozeu_kernels_body.hpp: defines a DozeuKernels table for whatever
+ * instruction set the including file is being compiled for.
+ *
+ * This is not a normal header. Include it exactly once, from a kernel
+ * translation unit, after defining DOZEU_KERNELS_TABLE to the name of the
+ * table to define, DOZEU_KERNELS_ISA to the name of the instruction set, and
+ * DZ_QUAL_ADJ if the table is for quality adjusted scoring.
+ *
+ * Everything here has internal linkage except the table, so no code built
+ * for a wider instruction set can be picked up by the linker for use
+ * elsewhere.
+ */
+
+#include "dozeu_kernels.hpp"
+
+// Configure dozeu the same way as the aligners that use it:
+// We want the full length bonus included
+#ifndef DZ_FULL_LENGTH_BONUS
+#define DZ_FULL_LENGTH_BONUS
+#endif
+// We require these particular values for this enum because we index arrays with it.
+enum { MISMATCH = 1, MATCH = 2, INS = 3, DEL = 4 };
+// Set dozeu's CIGAR codes to match our enum
+#ifndef DZ_CIGAR_OP
+#define DZ_CIGAR_OP 0x04030201
+#endif
+
+#include <dozeu/dozeu.h>
+
+namespace vg {
+
+namespace {
+
+#ifdef DZ_QUAL_ADJ
+
+dz_s* kernel_init(const int8_t* score_matrix, const int8_t* qual_adj_score_matrix,
+                  uint16_t gap_open, uint16_t gap_extend) {
+    return dz_qual_adj_init(score_matrix, qual_adj_score_matrix, gap_open, gap_extend);
+}
+
+dz_query_s* kernel_pack_query_forward(dz_s* dz, const char* seq, const uint8_t* qual,
+                                      int8_t full_length_bonus, size_t len) {
+    return dz_qual_adj_pack_query_forward(dz, seq, qual, full_length_bonus, len);
+}
+
+dz_query_s* kernel_pack_query_reverse(dz_s* dz, const char* seq, const uint8_t* qual,
+                                      int8_t full_length_bonus, size_t len) {
+    return dz_qual_adj_pack_query_reverse(dz, seq, qual, full_length_bonus, len);
+}
+
+const dz_forefront_s* kernel_scan(dz_s* dz, const dz_query_s* query, const dz_forefront_s** forefronts,
+                                  size_t n_forefronts, const char* ref, int32_t rlen, uint32_t rid,
+                                  uint16_t xt) {
+    return dz_qual_adj_scan(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
+}
+
+const dz_forefront_s* kernel_extend(dz_s* dz, const dz_query_s* query, const dz_forefront_s** forefronts,
+                                    size_t n_forefronts, const char* ref, int32_t rlen, uint32_t rid,
+                                    uint16_t xt) {
+    return dz_qual_adj_extend(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
+}
+
+dz_alignment_s* kernel_trace(dz_s* dz, const dz_forefront_s* forefront) {
+    return dz_qual_adj_trace(dz, forefront);
+}
+
+void kernel_flush(dz_s* dz) {
+    dz_qual_adj_flush(dz);
+}
+
+#else
+
+dz_s* kernel_init(const int8_t* score_matrix, const int8_t* qual_adj_score_matrix,
+                  uint16_t gap_open, uint16_t gap_extend) {
+    return dz_init(score_matrix, gap_open, gap_extend);
+}
+
+dz_query_s* kernel_pack_query_forward(dz_s* dz, const char* seq, const uint8_t* qual,
+                                      int8_t full_length_bonus, size_t len) {
+    return dz_pack_query_forward(dz, seq, full_length_bonus, len);
+}
+
+dz_query_s* kernel_pack_query_reverse(dz_s* dz, const char* seq, const uint8_t* qual,
+                                      int8_t full_length_bonus, size_t len) {
+    return dz_pack_query_reverse(dz, seq, full_length_bonus, len);
+}
+
+const dz_forefront_s* kernel_scan(dz_s* dz, const dz_query_s* query, const dz_forefront_s** forefronts,
+                                  size_t n_forefronts, const char* ref, int32_t rlen, uint32_t rid,
+                                  uint16_t xt) {
+    return dz_scan(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
+}
+
+const dz_forefront_s* kernel_extend(dz_s* dz, const dz_query_s* query, const dz_forefront_s** forefronts,
+                                    size_t n_forefronts, const char* ref, int32_t rlen, uint32_t rid,
+                                    uint16_t xt) {
+    return dz_extend(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
+}
+
+dz_alignment_s* kernel_trace(dz_s* dz, const dz_forefront_s* forefront) {
+    return dz_trace(dz, forefront);
+}
+
+void kernel_flush(dz_s* dz) {
+    dz_flush(dz);
+}
+
+#endif
+
+void kernel_destroy(dz_s* dz) {
+    dz_destroy(dz);
+}
+
+}
+
+extern const DozeuKernels DOZEU_KERNELS_TABLE = {
+    DOZEU_KERNELS_ISA,
+    kernel_init,
+    kernel_destroy,
+    kernel_pack_query_forward,
+    kernel_pack_query_reverse,
+    kernel_scan,
+    kernel_extend,
+    kernel_trace,
+    kernel_flush
+};
+
+}
@@ -0,0 +1,146 @@
+#ifndef VG_DUPLICATE_READ_CACHE_HPP_INCLUDED
+#define VG_DUPLICATE_READ_CACHE_HPP_INCLUDED
+
+/**
+ * \file duplicate_read_cache.hpp
+ * Defines a bounded, thread-safe cache of mapping results by read content,
+ * for reuse when the same read turns up again.
+ */
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Remembers the results of mapping reads, by a key that captures everything
+ * about a read that the result depends on (for a mapper, its sequence and
+ * qualities), so that duplicate reads can be answered without mapping them
+ * again.
+ *
+ * The cache is split into shards, each behind its own lock, so threads
+ * mapping different reads rarely wait for each other. Each shard forgets its
+ * oldest entries first when it fills up. Safe to use from multiple threads.
+ */
+template<typename Result>
+class DuplicateReadCache {
+public:
+
+    /// Try to find the result for the given key. If it is there, copy it
+    /// into result and return true.
+    bool lookup(const string& key, Result& result) const;
+
+    /// Remember the result for the given key, keeping at most about
+    /// max_entries results in the whole cache.
+    void insert(const string& key, const Result& result, size_t max_entries);
+
+    /// Get the number of lookups that found a result.
+    size_t hits() const;
+
+    /// Get the number of lookups that did not find a result.
+    size_t misses() const;
+
+    /// Forget all the results, and reset the counters.
+    void clear();
+
+protected:
+
+    static constexpr size_t SHARD_COUNT = 64;
+
+    struct Shard {
+        mutable mutex lock;
+        unordered_map<string, Result> results;
+        /// Keys in the order they were inserted, oldest first.
+        deque<string> order;
+        mutable size_t hit_count = 0;
+        mutable size_t miss_count = 0;
+    };
+
+    array<Shard, SHARD_COUNT> shards;
+
+    inline Shard& shard_for(const string& key);
+    inline const Shard& shard_for(const string& key) const;
+};
+
+template<typename Result>
+inline typename DuplicateReadCache<Result>::Shard& DuplicateReadCache<Result>::shard_for(const string& key) {
+    return shards[hash<string>()(key) % SHARD_COUNT];
+}
+
+template<typename Result>
+inline const typename DuplicateReadCache<Result>::Shard& DuplicateReadCache<Result>::shard_for(const string& key) const {
+    return shards[hash<string>()(key) % SHARD_COUNT];
+}
+
+template<typename Result>
+bool DuplicateReadCache<Result>::lookup(const string& key, Result& result) const {
+    const Shard& shard = shard_for(key);
+    lock_guard<mutex> guard(shard.lock);
+    auto found = shard.results.find(key);
+    if (found == shard.results.end()) {
+        shard.miss_count++;
+        return false;
+    }
+    shard.hit_count++;
+    result = found->second;
+    return true;
+}
+
+template<typename Result>
+void DuplicateReadCache<Result>::insert(const string& key, const Result& result, size_t max_entries) {
+    // Every shard gets an equal part of the budget, but always room for one.
+    size_t shard_entries = max(max_entries / SHARD_COUNT, (size_t) 1);
+    Shard& shard = shard_for(key);
+    lock_guard<mutex> guard(shard.lock);
+    if (!shard.results.emplace(key, result).second) {
+        // Another thread mapped the same read at the same time.
+        return;
+    }
+    shard.order.push_back(key);
+    while (shard.order.size() > shard_entries) {
+        shard.results.erase(shard.order.front());
+        shard.order.pop_front();
+    }
+}
+
+template<typename Result>
+size_t DuplicateReadCache<Result>::hits() const {
+    size_t total = 0;
+    for (const Shard& shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        total += shard.hit_count;
+    }
+    return total;
+}
+
+template<typename Result>
+size_t DuplicateReadCache<Result>::misses() const {
+    size_t total = 0;
+    for (const Shard& shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        total += shard.miss_count;
+    }
+    return total;
+}
+
+template<typename Result>
+void DuplicateReadCache<Result>::clear() {
+    for (Shard& shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        shard.results.clear();
+        shard.order.clear();
+        shard.hit_count = 0;
+        shard.miss_count = 0;
+    }
+}
+
+}
+
+#endif
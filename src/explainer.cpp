@@ -4,9 +4,12 @@
  */
 
 #include "explainer.hpp"
+#include "zstdutil.hpp"
 
 #include <structures/union_find.hpp>
 
+#include <algorithm>
+#include <iostream>
 #include <sstream>
 
 namespace vg {
@@ -15,6 +18,10 @@ std::atomic<size_t> Explainer::next_explanation_number {0};
 
 bool Explainer::save_explanations = false;
 
+size_t ProblemDumpExplainer::sample_interval = 1;
+
+bool ExplanationWriter::compress = false;
+
 Explainer::Explainer() : explanation_number(Explainer::next_explanation_number++) {
     // Nothing to do!
 }
@@ -23,19 +30,98 @@ Explainer::~Explainer() {
     // Nothing to do!
 }
 
-ProblemDumpExplainer::ProblemDumpExplainer(const std::string& name) : Explainer() {
-    if (!Explainer::save_explanations) {
+std::mutex ExplanationWriter::instance_mutex;
+std::unique_ptr<ExplanationWriter> ExplanationWriter::instance;
+
+ExplanationWriter& ExplanationWriter::get_instance() {
+    std::lock_guard<std::mutex> lock(instance_mutex);
+    if (!instance) {
+        instance.reset(new ExplanationWriter());
+    }
+    return *instance;
+}
+
+ExplanationWriter::ExplanationWriter() : writer(&ExplanationWriter::writer_loop, this) {
+    // Nothing to do!
+}
+
+ExplanationWriter::~ExplanationWriter() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_changed.notify_all();
+    writer.join();
+    if (dropped != 0) {
+        std::cerr << "warning:[vg::ExplanationWriter] Dropped " << dropped
+                  << " problem dumps because they were made faster than they could be written" << std::endl;
+    }
+}
+
+void ExplanationWriter::write(std::string filename, std::string contents) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (queue.size() >= MAX_QUEUED) {
+            // Rather drop a dump than stall the mapping thread.
+            dropped++;
+            return;
+        }
+        queue.emplace_back(std::move(filename), std::move(contents));
+    }
+    queue_changed.notify_one();
+}
+
+void ExplanationWriter::writer_loop() {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    while (true) {
+        queue_changed.wait(lock, [&]() { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            // We must be stopping and there's nothing left.
+            return;
+        }
+        std::pair<std::string, std::string> dump = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+
+        std::string& contents = dump.second;
+        if (ExplanationWriter::compress) {
+            std::string compressed;
+            if (zstdutil::CompressString(contents, compressed) != 0) {
+                std::cerr << "error:[vg::ExplanationWriter] Could not compress " << dump.first << std::endl;
+                exit(1);
+            }
+            contents = std::move(compressed);
+            dump.first += ".zst";
+        }
+        std::ofstream out(dump.first, std::ios::binary);
+        out.write(contents.data(), contents.size());
+        if (!out) {
+            std::cerr << "error:[vg::ExplanationWriter] Could not write " << dump.first << std::endl;
+            exit(1);
+        }
+
+        lock.lock();
+    }
+}
+
+ProblemDumpExplainer::ProblemDumpExplainer(const std::string& name) : Explainer(),
+    enabled(Explainer::save_explanations && explanation_number % std::max<size_t>(ProblemDumpExplainer::sample_interval, 1) == 0) {
+    if (!enabled) {
         return;
     }
-    out.open(name + std::to_string(explanation_number) + ".json");
+    filename = name + std::to_string(explanation_number) + ".json";
 }
 
 ProblemDumpExplainer::~ProblemDumpExplainer() {
-    // Nothing to do!
+    if (!enabled) {
+        return;
+    }
+    // Hand the finished dump off so the mapping thread doesn't wait on the disk.
+    ExplanationWriter::get_instance().write(std::move(filename), out.str());
 }
 
 void ProblemDumpExplainer::object_start() {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     comma();
@@ -43,7 +129,7 @@ void ProblemDumpExplainer::object_start() {
 }
 
 void ProblemDumpExplainer::object_end() {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     out << "}";
@@ -51,7 +137,7 @@ void ProblemDumpExplainer::object_end() {
 }
 
 void ProblemDumpExplainer::array_start() {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     comma();
@@ -59,7 +145,7 @@ void ProblemDumpExplainer::array_start() {
 }
 
 void ProblemDumpExplainer::array_end() {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     out << "]";
@@ -67,7 +153,7 @@ void ProblemDumpExplainer::array_end() {
 }
 
 void ProblemDumpExplainer::key(const std::string& k) {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     comma();
@@ -75,7 +161,7 @@ void ProblemDumpExplainer::key(const std::string& k) {
 }
 
 void ProblemDumpExplainer::value(const std::string& v) {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     comma();
@@ -84,7 +170,7 @@ void ProblemDumpExplainer::value(const std::string& v) {
 }
 
 void ProblemDumpExplainer::value(double v) {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     comma();
@@ -93,7 +179,7 @@ void ProblemDumpExplainer::value(double v) {
 }
 
 void ProblemDumpExplainer::value(size_t v) {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     comma();
@@ -102,7 +188,7 @@ void ProblemDumpExplainer::value(size_t v) {
 }
 
 void ProblemDumpExplainer::value(int v) {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     comma();
@@ -111,7 +197,7 @@ void ProblemDumpExplainer::value(int v) {
 }
 
 void ProblemDumpExplainer::value(bool v) {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     comma();
@@ -120,7 +206,7 @@ void ProblemDumpExplainer::value(bool v) {
 }
 
 void ProblemDumpExplainer::value(vg::id_t v) {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     comma();
@@ -129,7 +215,7 @@ void ProblemDumpExplainer::value(vg::id_t v) {
 }
 
 void ProblemDumpExplainer::value(const pos_t& v) {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     object_start();
@@ -147,7 +233,7 @@ void ProblemDumpExplainer::value(const pos_t& v) {
 }
 
 void ProblemDumpExplainer::value(const HandleGraph& v) {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     object_start();
@@ -187,7 +273,7 @@ void ProblemDumpExplainer::value(const HandleGraph& v) {
 }
 
 void ProblemDumpExplainer::value(const handle_t& v, const HandleGraph& context) {
-    if (!Explainer::save_explanations) {
+    if (!enabled) {
         return;
     }
     // Implement via pos_t serialization.
@@ -8,8 +8,14 @@
  */
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <unordered_map>
 #include <vector>
@@ -47,15 +53,69 @@ protected:
     static std::atomic<size_t> next_explanation_number;
 };
 
+/**
+ * Background thread that writes finished explanations to their files, so
+ * that the threads making them don't wait on the disk. The queue is bounded,
+ * and explanations that arrive when it is full are dropped and counted.
+ */
+class ExplanationWriter {
+public:
+    /// Whether to zstd-compress the explanations written, adding .zst to
+    /// their file names.
+    static bool compress;
+
+    /// Most explanations to hold waiting to be written.
+    constexpr static size_t MAX_QUEUED = 256;
+
+    /// Get the shared writer, starting it if needed.
+    static ExplanationWriter& get_instance();
+
+    /// Queue the given contents to be written to the given file.
+    void write(std::string filename, std::string contents);
+
+    /// Write out everything queued and stop the writing thread.
+    ~ExplanationWriter();
+
+protected:
+    ExplanationWriter();
+
+    /// Run on the writing thread.
+    void writer_loop();
+
+    static std::mutex instance_mutex;
+    static std::unique_ptr<ExplanationWriter> instance;
+
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    /// Queued (file name, contents) pairs.
+    std::deque<std::pair<std::string, std::string>> queue;
+    size_t dropped = 0;
+    bool stopping = false;
+    std::thread writer;
+};
+
 /**
  * Widget to serialize somewhat structured logs.
+ *
+ * The dump is built in memory and handed to the ExplanationWriter when the
+ * explainer is destroyed.
  */
 class ProblemDumpExplainer : public Explainer {
 public:
+    /// Only save every this many problem dumps, to keep the cost down on
+    /// large runs.
+    static size_t sample_interval;
+
     /// Construct a ProblemDumpExplainer that will save a dump of a problem to a file.
     ProblemDumpExplainer(const std::string& name = "problem");
-    /// Close out the file being explained to
+    /// Send the dump off to be written
     ~ProblemDumpExplainer();
+
+    /// Determine if this dump is going to be saved, so callers can skip
+    /// preparing what goes in it.
+    inline bool is_enabled() const {
+        return enabled;
+    }
     
     // We think in JSON, but with support for vg types.
     
@@ -95,8 +155,12 @@ public:
     void value(const handle_t& v, const HandleGraph& context);
     
 protected:
+    /// Whether this dump is sampled to be saved.
+    bool enabled;
+    /// File the dump will be saved to
+    std::string filename;
     /// Stream being written to
-    ofstream out;
+    std::stringstream out;
     /// Whether we need a comma before the next key or value.
     bool need_comma = false;
     
@@ -0,0 +1,212 @@
+/**
+ * \file fastq_reader.cpp
+ * Implementation of the background-parsing FASTQ reader.
+ */
+
+#include "fastq_reader.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include "alignment.hpp"
+
+namespace vg {
+
+using namespace std;
+using namespace vg::io;
+
+const size_t FastqReader::DEFAULT_BATCH_SIZE = 1024;
+const size_t FastqReader::DEFAULT_MAX_BATCHES_QUEUED = 64;
+
+size_t FastqReader::default_decompression_threads(size_t available_threads) {
+    // A few threads are enough to keep up with a lot of mappers.
+    return std::max<size_t>(1, std::min<size_t>(4, available_threads / 8));
+}
+
+FastqReader::FastqReader(const string& filename, size_t decompression_threads, size_t batch_size, size_t max_batches_queued) :
+    filename(filename), batch_size(std::max<size_t>(batch_size, 1)), max_batches_queued(std::max<size_t>(max_batches_queued, 1)) {
+
+    fp = (filename != "-") ? bgzf_open(filename.c_str(), "r") : bgzf_dopen(fileno(stdin), "r");
+    if (!fp) {
+        cerr << "[vg::fastq_reader.cpp] couldn't open " << filename << endl; exit(1);
+    }
+
+    if (decompression_threads > 1 && bgzf_compression(fp) == 2) {
+        // The file is BGZF, so blocks can be decompressed independently.
+        if (bgzf_mt(fp, decompression_threads, 256) != 0) {
+            cerr << "warning:[vg::fastq_reader.cpp] could not use multiple threads to decompress " << filename << endl;
+        }
+    }
+
+    // Start parsing
+    parser = thread(&FastqReader::parse_loop, this);
+}
+
+FastqReader::~FastqReader() {
+    {
+        // Tell the parser to stop if it hasn't yet.
+        lock_guard<mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    queue_not_full.notify_all();
+    parser.join();
+
+    bgzf_close(fp);
+    free(line_buffer.s);
+}
+
+bool FastqReader::next(Alignment& alignment) {
+    if (current_index >= current.size()) {
+        // We need a new batch.
+        unique_lock<mutex> lock(queue_mutex);
+        queue_not_empty.wait(lock, [&]() { return !queue.empty() || done; });
+        if (queue.empty()) {
+            // The parser is finished.
+            if (error) {
+                rethrow_exception(error);
+            }
+            return false;
+        }
+        // Give back the batch we finished, so its Alignments' memory can be
+        // reused by the parser.
+        if (!current.empty() && free_batches.size() < max_batches_queued) {
+            free_batches.emplace_back(std::move(current));
+        }
+        current = std::move(queue.front());
+        queue.pop_front();
+        current_index = 0;
+        lock.unlock();
+        queue_not_full.notify_one();
+    }
+
+    // Hand over the read, but keep the object so its memory can be reused.
+    alignment.Swap(&current[current_index]);
+    current_index++;
+    return true;
+}
+
+void FastqReader::parse_loop() {
+    try {
+        vector<Alignment> batch;
+        bool more = true;
+        while (more) {
+            batch.resize(batch_size);
+            size_t filled = 0;
+            while (filled < batch_size && (more = parse_record(batch[filled]))) {
+                filled++;
+            }
+            batch.resize(filled);
+
+            if (filled > 0) {
+                unique_lock<mutex> lock(queue_mutex);
+                queue_not_full.wait(lock, [&]() { return queue.size() < max_batches_queued || stopping; });
+                if (stopping) {
+                    break;
+                }
+                queue.emplace_back(std::move(batch));
+                // Reuse a batch the consumer is done with, if we have one.
+                if (!free_batches.empty()) {
+                    batch = std::move(free_batches.back());
+                    free_batches.pop_back();
+                } else {
+                    batch = vector<Alignment>();
+                }
+                lock.unlock();
+                queue_not_empty.notify_one();
+            }
+        }
+    } catch (...) {
+        lock_guard<mutex> lock(queue_mutex);
+        error = current_exception();
+    }
+
+    {
+        lock_guard<mutex> lock(queue_mutex);
+        done = true;
+    }
+    queue_not_empty.notify_all();
+}
+
+bool FastqReader::read_line(string& line) {
+    if (have_pending_line) {
+        line.swap(pending_line);
+        have_pending_line = false;
+        return true;
+    }
+    int length = bgzf_getline(fp, '\n', &line_buffer);
+    if (length < -1) {
+        throw runtime_error("[vg::fastq_reader.cpp] error reading " + filename);
+    } else if (length == -1) {
+        return false;
+    }
+    // Drop any Windows line ending.
+    if (length > 0 && line_buffer.s[length - 1] == '\r') {
+        length--;
+    }
+    line.assign(line_buffer.s, length);
+    return true;
+}
+
+bool FastqReader::parse_record(Alignment& alignment) {
+    alignment.Clear();
+
+    // Find the header, skipping blank lines.
+    string& name = *alignment.mutable_name();
+    do {
+        if (!read_line(name)) {
+            // no more to get
+            return false;
+        }
+    } while (name.empty());
+
+    bool is_fasta = false;
+    if (name[0] == '@') {
+        is_fasta = false;
+    } else if (name[0] == '>') {
+        is_fasta = true;
+    } else {
+        throw runtime_error("Found unexpected delimiter " + name.substr(0,1) + " in fastq/fasta input");
+    }
+    // trim off leading @ and things after the first whitespace
+    // keep trailing /1 /2
+    size_t name_end = name.find(' ');
+    if (name_end != string::npos) {
+        name.resize(name_end);
+    }
+    name.erase(0, 1);
+
+    // handle sequence
+    string& sequence = *alignment.mutable_sequence();
+    if (!read_line(sequence)) {
+        throw runtime_error("[vg::fastq_reader.cpp] incomplete fastq/fasta record " + name);
+    }
+    if (is_fasta) {
+        // FASTA sequences may span multiple lines, up to the next header.
+        while (read_line(separator_line)) {
+            if (!separator_line.empty() && separator_line[0] == '>') {
+                pending_line.swap(separator_line);
+                have_pending_line = true;
+                break;
+            }
+            sequence.append(separator_line);
+        }
+    } else {
+        // handle "+" sep
+        if (!read_line(separator_line)) {
+            throw runtime_error("[vg::fastq_reader.cpp] incomplete fastq record " + name);
+        }
+        // handle quality
+        string& quality = *alignment.mutable_quality();
+        if (!read_line(quality)) {
+            throw runtime_error("[vg::fastq_reader.cpp] fastq record missing base quality " + name);
+        }
+        fastq_quality_char_to_short_in_place(quality);
+    }
+
+    return true;
+}
+
+}
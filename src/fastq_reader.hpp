@@ -0,0 +1,124 @@
+#ifndef VG_FASTQ_READER_HPP_INCLUDED
+#define VG_FASTQ_READER_HPP_INCLUDED
+
+/**
+ * \file fastq_reader.hpp
+ * Defines a FASTQ/FASTA reader that decompresses and parses on its own
+ * threads, ahead of the threads consuming the reads.
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <htslib/bgzf.h>
+
+#include <vg/vg.pb.h>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Reads FASTQ or FASTA records, plain or gzip/BGZF compressed, into
+ * Alignments.
+ *
+ * A background thread reads and parses fixed-size batches of records into a
+ * bounded queue, so the consumer only ever has to pop a finished Alignment.
+ * Records are parsed in place into recycled Alignments, so once the reader
+ * has warmed up, their string storage is reused rather than reallocated.
+ * If the input is BGZF-compressed, decompression is additionally spread
+ * over an htslib thread pool.
+ *
+ * Only one thread may call next() at a time.
+ */
+class FastqReader {
+public:
+    /**
+     * Open the given file ("-" for standard input) for reading. Uses up to
+     * decompression_threads threads to decompress BGZF blocks. Exits with an
+     * error if the file cannot be opened.
+     */
+    FastqReader(const string& filename, size_t decompression_threads = 1,
+                size_t batch_size = DEFAULT_BATCH_SIZE, size_t max_batches_queued = DEFAULT_MAX_BATCHES_QUEUED);
+
+    /// Stop the parser thread and close the file.
+    ~FastqReader();
+
+    FastqReader(const FastqReader& other) = delete;
+    FastqReader& operator=(const FastqReader& other) = delete;
+
+    /**
+     * Fill in the next read. Returns false if there are no more reads.
+     * Rethrows any error encountered while parsing.
+     */
+    bool next(Alignment& alignment);
+
+    /// How many records go in a parsed batch by default?
+    static const size_t DEFAULT_BATCH_SIZE;
+    /// How many parsed batches can be waiting by default?
+    static const size_t DEFAULT_MAX_BATCHES_QUEUED;
+
+    /**
+     * Pick a number of decompression threads to use for each input file,
+     * given the number of threads available.
+     */
+    static size_t default_decompression_threads(size_t available_threads);
+
+protected:
+
+    /// Main loop for the parser thread.
+    void parse_loop();
+
+    /// Read the next line into line, or return false at EOF.
+    bool read_line(string& line);
+
+    /// Parse one record into the given Alignment, or return false at EOF.
+    bool parse_record(Alignment& alignment);
+
+    /// The file we read from
+    BGZF* fp = nullptr;
+    /// A buffer for htslib to read lines into
+    kstring_t line_buffer = {0, 0, nullptr};
+    /// A line we read but have not used yet, when looking ahead in FASTA.
+    string pending_line;
+    /// True if pending_line holds a line.
+    bool have_pending_line = false;
+    /// Reusable storage for lines we don't keep, like FASTQ "+" lines.
+    string separator_line;
+    /// The name of the file, for error messages
+    string filename;
+
+    size_t batch_size;
+    size_t max_batches_queued;
+
+    /// Batches parsed but not yet consumed.
+    deque<vector<Alignment>> queue;
+    /// Batches the consumer is done with, which the parser can refill
+    /// without allocating new Alignments.
+    vector<vector<Alignment>> free_batches;
+    /// Set when the parser thread has produced everything it ever will.
+    bool done = false;
+    /// Set when the consumer wants the parser to give up early.
+    bool stopping = false;
+    /// Any error the parser thread hit.
+    exception_ptr error;
+    mutex queue_mutex;
+    condition_variable queue_not_empty;
+    condition_variable queue_not_full;
+
+    /// The batch the consumer is working through.
+    vector<Alignment> current;
+    /// Where in that batch the consumer is.
+    size_t current_index = 0;
+
+    thread parser;
+};
+
+}
+
+#endif
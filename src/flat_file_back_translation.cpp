@@ -6,6 +6,8 @@
 #include "flat_file_back_translation.hpp"
 #include "utility.hpp"
 
+#include <algorithm>
+
 namespace vg {
 
 FlatFileBackTranslation::FlatFileBackTranslation(std::istream& stream) {
@@ -28,46 +30,105 @@ FlatFileBackTranslation::FlatFileBackTranslation(std::istream& stream) {
             if (parts.size() != 3) {
                 throw std::runtime_error("Encountered unparseable T line: " + line);
             }
-            segment_to_name[parse<nid_t>(parts[2])] = parts[1];
+            segment_to_name.emplace_back(parse<nid_t>(parts[2]), parts[1]);
         } else if (parts[0] == "K") {
             // This is K <tab> old ID <tab> forward offset <tab> reverse offset <tab> new ID
             if (parts.size() != 5) {
                 throw std::runtime_error("Encountered unparseable K line: " + line);
             }
             // Save, under the new node ID, the old node ID and the offsets.
-            node_to_segment_and_offsets[parse<nid_t>(parts[4])] =  {parse<nid_t>(parts[1]), parse<size_t>(parts[2]), parse<size_t>(parts[3])};
+            node_to_segment_and_offsets.emplace_back(parse<nid_t>(parts[4]), parse<nid_t>(parts[1]), parse<size_t>(parts[2]), parse<size_t>(parts[3]));
         } else {
             // This shouldn't be here.
             throw std::runtime_error("Encountered unrecognized line: " + line);
         }
     }
+    
+    // Sort for binary search, keeping the last line for each ID like a map would.
+    auto sort_keeping_last = [](auto& entries) {
+        std::stable_sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+            return std::get<0>(a) < std::get<0>(b);
+        });
+        size_t kept = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (i + 1 < entries.size() && std::get<0>(entries[i + 1]) == std::get<0>(entries[i])) {
+                continue;
+            }
+            if (kept != i) {
+                entries[kept] = std::move(entries[i]);
+            }
+            kept++;
+        }
+        entries.resize(kept);
+        entries.shrink_to_fit();
+    };
+    sort_keeping_last(node_to_segment_and_offsets);
+    sort_keeping_last(segment_to_name);
 }
 
-std::vector<oriented_node_range_t> FlatFileBackTranslation::translate_back(const oriented_node_range_t& range) const {
-    // Look up the node ID
-    auto it = node_to_segment_and_offsets.find(std::get<0>(range));
-    
-    if (it == node_to_segment_and_offsets.end()) {
+const FlatFileBackTranslation::segment_piece_t* FlatFileBackTranslation::find_piece(nid_t node_id, size_t& hint) const {
+    // Nodes along a segment are usually consecutive, so try next to the hint first.
+    for (size_t i = hint; i < node_to_segment_and_offsets.size() && i <= hint + 1; i++) {
+        if (std::get<0>(node_to_segment_and_offsets[i]) == node_id) {
+            hint = i;
+            return &node_to_segment_and_offsets[i];
+        }
+    }
+    if (hint > 0 && hint - 1 < node_to_segment_and_offsets.size() && std::get<0>(node_to_segment_and_offsets[hint - 1]) == node_id) {
+        hint--;
+        return &node_to_segment_and_offsets[hint];
+    }
+    auto it = std::lower_bound(node_to_segment_and_offsets.begin(), node_to_segment_and_offsets.end(), node_id,
+                               [](const segment_piece_t& piece, nid_t id) {
+        return std::get<0>(piece) < id;
+    });
+    if (it == node_to_segment_and_offsets.end() || std::get<0>(*it) != node_id) {
+        return nullptr;
+    }
+    hint = it - node_to_segment_and_offsets.begin();
+    return &*it;
+}
+
+oriented_node_range_t FlatFileBackTranslation::translate_with(const segment_piece_t* piece, const oriented_node_range_t& range) {
+    if (piece == nullptr) {
         // This doesn't have to go anywhere else.
-        return {range};
+        return range;
     }
     
     // Otherwise this goes somewhere else.
-    return {{
-             // The destination segment
-             std::get<0>(it->second),
-             // In the requested orientation
-             std::get<1>(range),
-             // Starting at the correct offset along that orientation of the segment
-             std::get<2>(range) + (std::get<1>(range) ? std::get<2>(it->second) : std::get<1>(it->second)),
-             // And running for the specified length
-             std::get<3>(range)
-           }};
+    return {
+        // The destination segment
+        std::get<1>(*piece),
+        // In the requested orientation
+        std::get<1>(range),
+        // Starting at the correct offset along that orientation of the segment
+        std::get<2>(range) + (std::get<1>(range) ? std::get<3>(*piece) : std::get<2>(*piece)),
+        // And running for the specified length
+        std::get<3>(range)
+    };
+}
+
+std::vector<oriented_node_range_t> FlatFileBackTranslation::translate_back(const oriented_node_range_t& range) const {
+    size_t hint = 0;
+    return {translate_with(find_piece(std::get<0>(range), hint), range)};
+}
+
+void FlatFileBackTranslation::translate_back(const std::vector<oriented_node_range_t>& ranges,
+                                             std::vector<oriented_node_range_t>& translated) const {
+    translated.clear();
+    translated.reserve(ranges.size());
+    size_t hint = 0;
+    for (auto& range : ranges) {
+        translated.push_back(translate_with(find_piece(std::get<0>(range), hint), range));
+    }
 }
 
 std::string FlatFileBackTranslation::get_back_graph_node_name(const nid_t& back_node_id) const {
-    auto it = segment_to_name.find(back_node_id);
-    if (it == segment_to_name.end()) {
+    auto it = std::lower_bound(segment_to_name.begin(), segment_to_name.end(), back_node_id,
+                               [](const std::pair<nid_t, std::string>& entry, nid_t id) {
+        return entry.first < id;
+    });
+    if (it == segment_to_name.end() || it->first != back_node_id) {
         // There's no non-default name for this segment.
         return std::to_string(back_node_id);
     }
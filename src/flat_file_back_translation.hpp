@@ -50,6 +50,14 @@ public:
      */
     virtual std::vector<oriented_node_range_t> translate_back(const oriented_node_range_t& range) const;
     
+    /**
+     * Translate a batch of ranges, each to exactly one range on a segment,
+     * which is all this format can represent. Ranges on consecutive nodes
+     * along a segment, as in an alignment, are found without a search.
+     */
+    void translate_back(const std::vector<oriented_node_range_t>& ranges,
+                        std::vector<oriented_node_range_t>& translated) const;
+    
     /**
      * Get the name of a node in the graph that translate_back() translates
      * into, given its number.
@@ -57,18 +65,32 @@ public:
     virtual std::string get_back_graph_node_name(const nid_t& back_node_id) const;
     
 protected:
+    
+    /// A node ID, its segment number, and the node's starting offset on each
+    /// orientation of the segment.
+    using segment_piece_t = std::tuple<nid_t, nid_t, size_t, size_t>;
+    
+    /**
+     * Find the piece for a node, or nullptr if the node isn't translated.
+     * Starts looking at the hint, and sets it to where the piece was found.
+     */
+    const segment_piece_t* find_piece(nid_t node_id, size_t& hint) const;
+    
+    /// Translate a range using its piece, which may be nullptr.
+    static oriented_node_range_t translate_with(const segment_piece_t* piece, const oriented_node_range_t& range);
+    
     /**
-     * This holds, for each node ID, the segment number and starting offset, if
-     * it is not offset 0, on each orientation of the segment with the same
-     * number as the node ID.
+     * This holds, for each node ID that is not just the segment with the same
+     * number, the segment number and starting offsets on each orientation of
+     * the segment, sorted by node ID.
      */
-    std::unordered_map<nid_t, std::tuple<nid_t, size_t, size_t>> node_to_segment_and_offsets;
+    std::vector<segment_piece_t> node_to_segment_and_offsets;
     
     /**
      * This holds, for each segment ID, the segment name, if it is not the
-     * string version of the segment number.
+     * string version of the segment number, sorted by segment ID.
      */
-    std::unordered_map<nid_t, std::string> segment_to_name;
+    std::vector<std::pair<nid_t, std::string>> segment_to_name;
 
 };
 
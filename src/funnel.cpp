@@ -1,7 +1,9 @@
 #include "funnel.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <stdexcept>
 
 /**
  * \file funnel.hpp: implementation of the Funnel class
@@ -96,6 +98,7 @@ void Funnel::start(const string& name) {
     stage_name.clear();
     substage_name.clear();
     stages.clear();
+    counters.clear();
 }
 
 void Funnel::stop() {
@@ -154,6 +157,9 @@ void Funnel::substage(const string& name) {
     
     // Save the name 
     substage_name = name;
+    
+    // Record the start time
+    substage_start_time = clock::now();
 }
     
 void Funnel::substage_stop() {
@@ -162,6 +168,19 @@ void Funnel::substage_stop() {
         
         // Substages don't bound produce/process.
         
+        // Record the duration in seconds, coalescing with earlier runs of the same substage.
+        auto substage_stop_time = clock::now();
+        float duration = chrono::duration_cast<chrono::duration<double>>(substage_stop_time - substage_start_time).count();
+        auto& durations = stages.back().substage_durations;
+        auto found = std::find_if(durations.begin(), durations.end(), [&](const pair<string, float>& entry) {
+            return entry.first == substage_name;
+        });
+        if (found == durations.end()) {
+            durations.emplace_back(substage_name, duration);
+        } else {
+            found->second += duration;
+        }
+        
         // Say the stage is stopped 
         substage_name.clear();
     }
@@ -219,6 +238,11 @@ void Funnel::introduce(size_t count) {
     }
 }
 
+void Funnel::count_items(size_t count) {
+    assert(!stages.empty());
+    stages.back().counted_items = std::max(stages.back().counted_items, count);
+}
+
 void Funnel::expand(size_t prev_stage_item, size_t count) {
     for (size_t i = 0; i < count; i++) {
         // Create the requested number of items
@@ -367,19 +391,57 @@ size_t Funnel::latest() const {
     return stages.back().items.size() - 1;
 }
 
+double Funnel::total_seconds() const {
+    return chrono::duration_cast<chrono::duration<double>>(stop_time - start_time).count();
+}
+
 void Funnel::for_each_stage(const function<void(const string&, const vector<size_t>&, const double&)>& callback) const {
     for (auto& stage : stages) {
         // Make a vector of item sizes
         vector<size_t> item_sizes;
-        item_sizes.reserve(stage.items.size());
+        item_sizes.reserve(std::max(stage.items.size(), stage.counted_items));
         for (auto& item : stage.items) {
             item_sizes.push_back(item.group_size);
         }
+        if (item_sizes.size() < stage.counted_items) {
+            // Items that were only counted are not groups.
+            item_sizes.resize(stage.counted_items, 0);
+        }
         // Report the name and item count of each stage.
         callback(stage.name, item_sizes, stage.duration);
     }
 }
 
+void Funnel::for_each_stage_total(const function<void(const string&, size_t, double)>& callback) const {
+    for (auto& stage : stages) {
+        callback(stage.name, std::max(stage.items.size(), stage.counted_items), stage.duration);
+    }
+}
+
+void Funnel::for_each_substage(const function<void(const string&, const string&, const double&)>& callback) const {
+    for (auto& stage : stages) {
+        for (auto& substage : stage.substage_durations) {
+            callback(stage.name, substage.first, substage.second);
+        }
+    }
+}
+
+void Funnel::add_to_counter(const string& name, size_t amount) {
+    for (auto& counter : counters) {
+        if (counter.first == name) {
+            counter.second += amount;
+            return;
+        }
+    }
+    counters.emplace_back(name, amount);
+}
+
+void Funnel::for_each_counter(const function<void(const string&, const size_t&)>& callback) const {
+    for (auto& counter : counters) {
+        callback(counter.first, counter.second);
+    }
+}
+
 void Funnel::for_each_filter(const function<void(const string&, const string&,
     const FilterPerformance&, const FilterPerformance&, const vector<double>&, const vector<double>&)>& callback) const {
     
@@ -587,26 +649,42 @@ void Funnel::to_dot(ostream& out) const {
     out << "}" << endl;
 }
 void Funnel::annotate_mapped_alignment(Alignment& aln, bool annotate_correctness) const {
+    AnnotationBuffer annotations;
+    annotate_mapped_alignment(aln, annotations, annotate_correctness);
+    annotations.apply_to(aln);
+}
+
+void Funnel::annotate_mapped_alignment(Alignment& aln, AnnotationBuffer& annotations, bool annotate_correctness) const {
     // Save the total duration in the field set asside for it
-    aln.set_time_used(chrono::duration_cast<chrono::duration<double>>(stop_time - start_time).count());
+    aln.set_time_used(total_seconds());
     
     for_each_stage([&](const string& stage, const vector<size_t>& result_sizes, const double& duration) {
         // Save the number of items
-        set_annotation(aln, "stage_" + stage + "_results", (double)result_sizes.size());
+        set_annotation(annotations, "stage_" + stage + "_results", (double)result_sizes.size());
         // And the per-stage duration
-        set_annotation(aln, "stage_" + stage + "_time", duration);
+        set_annotation(annotations, "stage_" + stage + "_time", duration);
+    });
+    
+    for_each_substage([&](const string& stage, const string& substage, const double& duration) {
+        // Save the per-substage duration
+        set_annotation(annotations, "stage_" + stage + "_substage_" + substage + "_time", duration);
     });
     
-    set_annotation(aln, "last_placed_stage", last_tagged_stage(State::PLACED));
+    for_each_counter([&](const string& name, const size_t& value) {
+        // Save each counter
+        set_annotation(annotations, "counter_" + name, (double) value);
+    });
+    
+    set_annotation(annotations, "last_placed_stage", last_tagged_stage(State::PLACED));
     for (size_t i = 0; i < aln.sequence().size(); i += 500) {
         // For each 500 bp window, annotate with the last stage that had something placed in or spanning the window.
         // TODO: This is terrible, use an array or something.
-        set_annotation(aln, "last_placed_stage_" + std::to_string(i) + "bp", last_tagged_stage(State::PLACED, i, 500));
+        set_annotation(annotations, "last_placed_stage_" + std::to_string(i) + "bp", last_tagged_stage(State::PLACED, i, 500));
     }
     
     if (annotate_correctness) {
         // And with the last stage at which we had any descendants of the correct seed hit locations
-        set_annotation(aln, "last_correct_stage", last_correct_stage());
+        set_annotation(annotations, "last_correct_stage", last_correct_stage());
     }
     
     // Annotate with the performances of all the filters
@@ -619,16 +697,16 @@ void Funnel::annotate_mapped_alignment(Alignment& aln, bool annotate_correctness
             string filter_id = to_string(filter_num) + "_" + filter + "_" + stage;
 
             // Save the stats
-            set_annotation(aln, "filter_" + filter_id + "_passed_count_total", (double) by_count.passing);
-            set_annotation(aln, "filter_" + filter_id + "_failed_count_total", (double) by_count.failing);
-            set_annotation(aln, "filter_" + filter_id + "_passed_size_total", (double) by_size.passing);
-            set_annotation(aln, "filter_" + filter_id + "_failed_size_total", (double) by_size.failing);
+            set_annotation(annotations, "filter_" + filter_id + "_passed_count_total", (double) by_count.passing);
+            set_annotation(annotations, "filter_" + filter_id + "_failed_count_total", (double) by_count.failing);
+            set_annotation(annotations, "filter_" + filter_id + "_passed_size_total", (double) by_size.passing);
+            set_annotation(annotations, "filter_" + filter_id + "_failed_size_total", (double) by_size.failing);
             
             if (annotate_correctness) {
-                set_annotation(aln, "filter_" + filter_id + "_passed_count_correct", (double) by_count.passing_correct);
-                set_annotation(aln, "filter_" + filter_id + "_failed_count_correct", (double) by_count.failing_correct);
-                set_annotation(aln, "filter_" + filter_id + "_passed_size_correct", (double) by_size.passing_correct);
-                set_annotation(aln, "filter_" + filter_id + "_failed_size_correct", (double) by_size.failing_correct);
+                set_annotation(annotations, "filter_" + filter_id + "_passed_count_correct", (double) by_count.passing_correct);
+                set_annotation(annotations, "filter_" + filter_id + "_failed_count_correct", (double) by_count.failing_correct);
+                set_annotation(annotations, "filter_" + filter_id + "_passed_size_correct", (double) by_size.passing_correct);
+                set_annotation(annotations, "filter_" + filter_id + "_failed_size_correct", (double) by_size.failing_correct);
             }
             
             // Save the correct and non-correct filter statistics, even if
@@ -642,9 +720,9 @@ void Funnel::annotate_mapped_alignment(Alignment& aln, bool annotate_correctness
             }
             if (all_nan) {
                 // Elide all-nan vector
-                set_annotation(aln, "filterstats_" + filter_id + "_correct", std::vector<double>());
+                set_annotation(annotations, "filterstats_" + filter_id + "_correct", std::vector<double>());
             } else {
-                set_annotation(aln, "filterstats_" + filter_id + "_correct", filter_statistics_correct);
+                set_annotation(annotations, "filterstats_" + filter_id + "_correct", filter_statistics_correct);
             }
             all_nan = true;
             for (auto& v : filter_statistics_non_correct) {
@@ -655,9 +733,9 @@ void Funnel::annotate_mapped_alignment(Alignment& aln, bool annotate_correctness
             }
             if (all_nan) {
                 // Elide all-nan vector
-                set_annotation(aln, "filterstats_" + filter_id + "_noncorrect", std::vector<double>());
+                set_annotation(annotations, "filterstats_" + filter_id + "_noncorrect", std::vector<double>());
             } else {
-                set_annotation(aln, "filterstats_" + filter_id + "_noncorrect", filter_statistics_non_correct);
+                set_annotation(annotations, "filterstats_" + filter_id + "_noncorrect", filter_statistics_non_correct);
             }
             filter_num++;
         });
@@ -685,21 +763,94 @@ size_t Funnel::create_item() {
     // Return the index used
     return next_index;
 }
-    
-
-
 
+FunnelStats::FunnelStats(size_t thread_count) : thread_totals(std::max<size_t>(thread_count, 1)), thread_locks(thread_totals.size()) {
+    // Nothing to do
 }
 
+void FunnelStats::record(size_t thread, const Funnel& funnel) {
+    if (thread >= thread_totals.size()) {
+        throw runtime_error("vg::FunnelStats: Thread " + to_string(thread) + " is beyond the " +
+            to_string(thread_totals.size()) + " threads we were made for!");
+    }
+    lock_guard<mutex> lock(thread_locks[thread]);
+    ThreadTotals& totals = thread_totals[thread];
+    totals.funnels++;
+    totals.seconds += funnel.total_seconds();
+    funnel.for_each_stage_total([&](const string& name, size_t items, double seconds) {
+        // There are only a handful of stages, so a linear search is fine.
+        auto found = std::find_if(totals.stages.begin(), totals.stages.end(), [&](const pair<string, StageTotals>& entry) {
+            return entry.first == name;
+        });
+        if (found == totals.stages.end()) {
+            totals.stages.emplace_back(name, StageTotals());
+            found = totals.stages.end() - 1;
+        }
+        found->second.runs++;
+        found->second.items += items;
+        found->second.seconds += seconds;
+    });
+}
 
+FunnelStats::ThreadTotals FunnelStats::merged() const {
+    ThreadTotals all;
+    for (auto& totals : thread_totals) {
+        all.funnels += totals.funnels;
+        all.seconds += totals.seconds;
+        for (auto& stage : totals.stages) {
+            auto found = std::find_if(all.stages.begin(), all.stages.end(), [&](const pair<string, StageTotals>& entry) {
+                return entry.first == stage.first;
+            });
+            if (found == all.stages.end()) {
+                all.stages.push_back(stage);
+            } else {
+                found->second.runs += stage.second.runs;
+                found->second.items += stage.second.items;
+                found->second.seconds += stage.second.seconds;
+            }
+        }
+    }
+    return all;
+}
+
+vector<pair<string, double>> FunnelStats::stage_seconds() const {
+    vector<pair<string, double>> seconds;
+    for (size_t i = 0; i < thread_totals.size(); i++) {
+        lock_guard<mutex> lock(thread_locks[i]);
+        for (auto& stage : thread_totals[i].stages) {
+            auto found = std::find_if(seconds.begin(), seconds.end(), [&](const pair<string, double>& entry) {
+                return entry.first == stage.first;
+            });
+            if (found == seconds.end()) {
+                seconds.emplace_back(stage.first, stage.second.seconds);
+            } else {
+                found->second += stage.second.seconds;
+            }
+        }
+    }
+    return seconds;
+}
 
+void FunnelStats::print_summary(ostream& out) const {
+    ThreadTotals all = merged();
+    out << "Stage times over " << all.funnels << " reads taking " << all.seconds << " seconds:" << endl;
+    for (auto& stage : all.stages) {
+        out << "\t" << stage.first << "\t" << stage.second.seconds << " s\t"
+            << (all.seconds > 0 ? 100.0 * stage.second.seconds / all.seconds : 0.0) << "%\t"
+            << (stage.second.runs > 0 ? (double) stage.second.items / stage.second.runs : 0.0) << " items per run" << endl;
+    }
+}
 
+void FunnelStats::to_json(ostream& out) const {
+    ThreadTotals all = merged();
+    out << "{\"reads\": " << all.funnels << ", \"seconds\": " << all.seconds << ", \"stages\": [";
+    for (size_t i = 0; i < all.stages.size(); i++) {
+        auto& stage = all.stages[i];
+        // Stage names are short identifiers, so they don't need escaping.
+        out << (i == 0 ? "" : ", ") << "{\"name\": \"" << stage.first << "\", \"runs\": " << stage.second.runs
+            << ", \"items\": " << stage.second.items << ", \"seconds\": " << stage.second.seconds << "}";
+    }
+    out << "]}" << endl;
+}
 
-
-
-
-
-
-
-
-
+}
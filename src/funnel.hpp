@@ -10,6 +10,7 @@
 #include <functional>
 #include <iostream>
 #include <limits>
+#include <mutex>
 #include <vg/vg.pb.h>
 #include "annotation.hpp"
 
@@ -82,6 +83,11 @@ public:
     /// Introduce the given number of new items, starting their own lines of provenance (default 1).
     void introduce(size_t count = 1);
     
+    /// Record that the current stage has at least the given number of items,
+    /// without tracking their provenance. Items only counted this way are
+    /// reported as non-group items.
+    void count_items(size_t count);
+    
     /// Expand the given item from the previous stage into the given number of new items at this stage.
     void expand(size_t prev_stage_item, size_t count);
     
@@ -205,10 +211,30 @@ public:
     /// Get the index of the most recent item created in the current stage.
     size_t latest() const;
     
+    /// Get the time between start() and stop(), in seconds.
+    double total_seconds() const;
+    
     /// Call the given callback with stage name, and vector of result item
     /// sizes at that stage, and a duration in seconds, for each stage.
     void for_each_stage(const function<void(const string&, const vector<size_t>&, const double&)>& callback) const;
     
+    /// Call the given callback with stage name, number of result items at
+    /// that stage, and a duration in seconds, for each stage. Cheaper than
+    /// for_each_stage() when item sizes are not needed.
+    void for_each_stage_total(const function<void(const string&, size_t, double)>& callback) const;
+    
+    /// Call the given callback with stage name, substage name, and total
+    /// duration in seconds of all runs of that substage in that stage, for
+    /// each substage that was run.
+    void for_each_substage(const function<void(const string&, const string&, const double&)>& callback) const;
+    
+    /// Add the given amount to the named counter, for tracking events, such
+    /// as cache hits, that don't belong to any one item.
+    void add_to_counter(const string& name, size_t amount);
+    
+    /// Call the given callback with the name and value of each counter.
+    void for_each_counter(const function<void(const string&, const size_t&)>& callback) const;
+    
     /// Represents the performance of a filter, for either item counts or total item sizes.
     /// Note that passing_correct and failing_correct will always be 0 if nothing is tagged correct.
     struct FilterPerformance {
@@ -238,6 +264,10 @@ public:
     /// tracking correctness all along
     void annotate_mapped_alignment(Alignment& aln, bool annotate_correctness) const;
     
+    /// Do the same, but put the annotations in a buffer to be attached to
+    /// the alignment later.
+    void annotate_mapped_alignment(Alignment& aln, AnnotationBuffer& annotations, bool annotate_correctness) const;
+    
 protected:
     
     /// Pick a clock to use for measuring stage duration
@@ -263,6 +293,12 @@ protected:
     /// What's the name of the current substage? Will be empty if no substage is running.
     string substage_name;
     
+    /// At what time did the substage start?
+    time_point substage_start_time;
+    
+    /// Named counters, in order of first use.
+    vector<pair<string, size_t>> counters;
+    
     /// What's the current prev-stage input we are processing?
     /// Will be numeric_limits<size_t>::max() if none.
     size_t input_in_progress = numeric_limits<size_t>::max();
@@ -316,9 +352,15 @@ protected:
         vector<Item> items;
         /// How long did the stage last, in seconds?
         float duration;
+        /// How long did each substage last, in seconds, in order of first
+        /// appearance? Repeated substages are coalesced.
+        vector<pair<string, float>> substage_durations;
         /// How many of the items were actually projected?
         /// Needed because items may need to expand to hold information for items that have not been projected yet.
         size_t projected_count = 0;
+        /// How many items were counted with count_items(), if they weren't
+        /// tracked individually?
+        size_t counted_items = 0;
         /// What's the best tag of anything at this stage?
         State tag = State::NONE;
         /// Where are tags applied?
@@ -340,6 +382,64 @@ protected:
     vector<Stage> stages;
 };
 
+/**
+ * Aggregates stage timings and item counts from many Funnels, with separate
+ * totals for each thread so recording doesn't need any locking. Only uses the
+ * stage-level information in each Funnel, so it works with Funnels that only
+ * had their stages marked and their items counted.
+ */
+class FunnelStats {
+public:
+    /// Make a FunnelStats that can be recorded into from the given number of
+    /// threads.
+    FunnelStats(size_t thread_count);
+    
+    /// Add the stages of the given stopped Funnel to the totals for the given
+    /// thread.
+    void record(size_t thread, const Funnel& funnel);
+    
+    /// Write a human-readable table of time and items per stage, over all
+    /// threads. Must not be called while threads are recording.
+    void print_summary(ostream& out) const;
+    
+    /// Write the totals over all threads as a JSON object. Must not be called
+    /// while threads are recording.
+    void to_json(ostream& out) const;
+    
+    /// Get the total seconds spent in each stage so far, over all threads.
+    /// Can be called while threads are recording.
+    vector<pair<string, double>> stage_seconds() const;
+    
+protected:
+    /// Totals for one stage.
+    struct StageTotals {
+        /// How many funnels ran the stage?
+        size_t runs = 0;
+        /// How many items came out of the stage, over all runs?
+        size_t items = 0;
+        /// How long did the stage take, over all runs, in seconds?
+        double seconds = 0;
+    };
+    
+    /// Totals for everything one thread has recorded.
+    struct ThreadTotals {
+        /// How many funnels were recorded?
+        size_t funnels = 0;
+        /// How long did they take in total, in seconds?
+        double seconds = 0;
+        /// Totals for each stage, in order of first appearance.
+        vector<pair<string, StageTotals>> stages;
+    };
+    
+    /// Combine the totals for all threads.
+    ThreadTotals merged() const;
+    
+    vector<ThreadTotals> thread_totals;
+    /// Locks for each thread's totals, which are only ever contended when
+    /// someone is looking at the totals while threads are recording.
+    mutable vector<mutex> thread_locks;
+};
+
 inline std::ostream& operator<<(std::ostream& out, const Funnel::State& state) {
     switch (state) {
         case Funnel::State::NONE:
@@ -0,0 +1,533 @@
+/**
+ * \file gaf_sorter.cpp
+ * GAFSorter: sort GAF lines by node ID into an indexed BGZF file.
+ */
+
+#include "gaf_sorter.hpp"
+#include "utility.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <queue>
+
+#include <omp.h>
+#include <ips4o.hpp>
+
+#include <sys/time.h>
+#include <sys/resource.h>
+
+namespace vg {
+
+//------------------------------------------------------------------------------
+
+bool GAFRecordView::Field::to_int(int64_t& value) const {
+    if (this->empty()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = 0; i < this->size; i++) {
+        if (this->data[i] < '0' || this->data[i] > '9') {
+            return false;
+        }
+        value = 10 * value + (this->data[i] - '0');
+    }
+    return true;
+}
+
+bool GAFRecordView::split(const char* line, size_t length) {
+    for (Field& field : this->fields) {
+        field = Field();
+    }
+    this->tags = Field();
+    if (length == 0 || line[0] == '@') {
+        return false;
+    }
+
+    const char* end = line + length;
+    const char* start = line;
+    for (size_t i = 0; i < MANDATORY_FIELDS; i++) {
+        const char* tab = static_cast<const char*>(memchr(start, '\t', end - start));
+        const char* field_end = (tab == nullptr ? end : tab);
+        this->fields[i].data = start;
+        this->fields[i].size = field_end - start;
+        if (tab == nullptr) {
+            return i + 1 == MANDATORY_FIELDS;
+        }
+        start = tab + 1;
+    }
+    this->tags.data = start;
+    this->tags.size = end - start;
+    return true;
+}
+
+bool GAFRecordView::find_tag(const char* name, Field& value) const {
+    const char* start = this->tags.data;
+    const char* end = this->tags.data + this->tags.size;
+    while (start < end) {
+        const char* tab = static_cast<const char*>(memchr(start, '\t', end - start));
+        const char* tag_end = (tab == nullptr ? end : tab);
+        // tags look like "cs:Z:value"
+        if (tag_end - start >= 5 && start[0] == name[0] && start[1] == name[1] && start[2] == ':' && start[4] == ':') {
+            value.data = start + 5;
+            value.size = tag_end - value.data;
+            return true;
+        }
+        if (tab == nullptr) {
+            break;
+        }
+        start = tab + 1;
+    }
+    return false;
+}
+
+bool GAFRecordView::for_each_node(const function<bool(id_t, bool)>& iteratee) const {
+    const Field& path = this->fields[5];
+    size_t i = 0;
+    while (i < path.size) {
+        if (path.data[i] != '>' && path.data[i] != '<') {
+            // Unmapped reads and stable path intervals have no node IDs.
+            return true;
+        }
+        bool is_reverse = (path.data[i] == '<');
+        i++;
+        id_t id = 0;
+        bool has_digits = false;
+        while (i < path.size && path.data[i] >= '0' && path.data[i] <= '9') {
+            id = 10 * id + (path.data[i] - '0');
+            has_digits = true;
+            i++;
+        }
+        if (!has_digits) {
+            // Segment names that are not node IDs.
+            return true;
+        }
+        if (!iteratee(id, is_reverse)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool for_each_gaf_node_id(const string& line, const function<bool(id_t)>& iteratee) {
+    GAFRecordView record;
+    // Header lines and lines truncated before the path have an empty path.
+    record.split(line);
+    return record.for_each_node([&](id_t id, bool) {
+        return iteratee(id);
+    });
+}
+
+GAFSortKey gaf_sort_key(const string& line) {
+    GAFSortKey key;
+    GAFRecordView record;
+    record.split(line);
+    bool first = true, min_is_first = false;
+    record.for_each_node([&](id_t id, bool) -> bool {
+        if (first) {
+            key.min_id = id;
+            key.max_id = id;
+            min_is_first = true;
+            first = false;
+        } else {
+            if (id < key.min_id) {
+                key.min_id = id;
+                min_is_first = false;
+            }
+            key.max_id = std::max(key.max_id, id);
+        }
+        return true;
+    });
+
+    int64_t offset;
+    if (min_is_first && record.fields[7].to_int(offset)) {
+        key.offset = offset;
+    }
+    return key;
+}
+
+//------------------------------------------------------------------------------
+
+/// Write the line and a newline to the BGZF file, or exit with an error.
+static void write_gaf_line(BGZF* out, const string& line) {
+    if (bgzf_write(out, line.data(), line.length()) < 0 || bgzf_write(out, "\n", 1) < 0) {
+        cerr << "error:[vg::GAFSorter]: could not write GAF output" << endl;
+        exit(1);
+    }
+}
+
+/// Open a BGZF file for reading or writing, with "-" meaning standard input
+/// or output, or exit with an error.
+static BGZF* open_bgzf(const string& filename, const char* mode) {
+    BGZF* result = nullptr;
+    if (filename == "-") {
+        result = bgzf_dopen((mode[0] == 'r' ? fileno(stdin) : fileno(stdout)), mode);
+    } else {
+        result = bgzf_open(filename.c_str(), mode);
+    }
+    if (result == nullptr) {
+        cerr << "error:[vg::GAFSorter]: could not open " << filename << endl;
+        exit(1);
+    }
+    return result;
+}
+
+/// Close a BGZF file, or exit with an error.
+static void close_bgzf(BGZF* file, const string& filename) {
+    if (bgzf_close(file) != 0) {
+        cerr << "error:[vg::GAFSorter]: could not close " << filename << endl;
+        exit(1);
+    }
+}
+
+/**
+ * Reads the lines of a sorted temporary file along with their keys.
+ */
+struct GAFRunReader {
+    GAFRunReader(const string& filename) : filename(filename) {
+        this->file = open_bgzf(filename, "r");
+    }
+
+    ~GAFRunReader() {
+        close_bgzf(this->file, this->filename);
+        free(this->buffer.s);
+    }
+
+    GAFRunReader(const GAFRunReader& other) = delete;
+    GAFRunReader& operator=(const GAFRunReader& other) = delete;
+
+    /// Read the next line. Returns false at the end of the file.
+    bool next() {
+        int length = bgzf_getline(this->file, '\n', &(this->buffer));
+        if (length < -1) {
+            cerr << "error:[vg::GAFSorter]: could not read " << this->filename << endl;
+            exit(1);
+        } else if (length == -1) {
+            return false;
+        }
+        this->line.assign(this->buffer.s, length);
+        this->key = gaf_sort_key(this->line);
+        return true;
+    }
+
+    string filename;
+    BGZF* file = nullptr;
+    kstring_t buffer = { 0, 0, nullptr };
+    string line;
+    GAFSortKey key;
+};
+
+//------------------------------------------------------------------------------
+
+void for_each_gaf_record_parallel(const string& filename, const function<void(const GAFRecordView&)>& iteratee,
+                                  size_t batch_size) {
+    BGZF* in = open_bgzf(filename, "r");
+    size_t threads = get_thread_count();
+    if (threads > 1 && bgzf_mt(in, threads, 256) != 0) {
+        cerr << "warning:[vg::for_each_gaf_record_parallel]: could not decompress on multiple threads" << endl;
+    }
+
+    // Read enough lines for every thread to get a few batches, then process
+    // them while the next lines are read.
+    size_t lines_per_round = std::max<size_t>(batch_size, 1) * threads * 4;
+    vector<string> lines, next_lines;
+    kstring_t buffer = { 0, 0, nullptr };
+    auto read_lines = [&](vector<string>& into) {
+        into.clear();
+        while (into.size() < lines_per_round) {
+            int length = bgzf_getline(in, '\n', &buffer);
+            if (length < -1) {
+                cerr << "error:[vg::for_each_gaf_record_parallel]: could not read " << filename << endl;
+                exit(1);
+            } else if (length == -1) {
+                break;
+            }
+            if (length == 0 || buffer.s[0] == '@') {
+                // Skip empty lines and header lines.
+                continue;
+            }
+            into.emplace_back(buffer.s, length);
+        }
+    };
+
+    read_lines(lines);
+    while (!lines.empty()) {
+        #pragma omp parallel
+        {
+            #pragma omp single
+            {
+                #pragma omp task
+                read_lines(next_lines);
+
+                for (size_t start = 0; start < lines.size(); start += batch_size) {
+                    #pragma omp task firstprivate(start)
+                    {
+                        GAFRecordView record;
+                        size_t end = std::min(start + batch_size, lines.size());
+                        for (size_t i = start; i < end; i++) {
+                            if (record.split(lines[i])) {
+                                iteratee(record);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        lines.swap(next_lines);
+    }
+
+    free(buffer.s);
+    close_bgzf(in, filename);
+}
+
+//------------------------------------------------------------------------------
+
+GAFSorter::GAFSorter(bool show_progress) {
+    this->show_progress = show_progress;
+
+    // Leave some file descriptors for everything else.
+    size_t extra_fds = 10;
+    struct rlimit fd_limit;
+    if (getrlimit(RLIMIT_NOFILE, &fd_limit) == 0 && fd_limit.rlim_cur != RLIM_INFINITY
+        && fd_limit.rlim_cur < this->max_fan_in + extra_fds) {
+        this->max_fan_in = std::max<size_t>(2, fd_limit.rlim_cur - std::min<size_t>(fd_limit.rlim_cur, extra_fds));
+    }
+}
+
+void GAFSorter::sort(const string& input_file, const string& output_file, GAFIndex* index_to) {
+
+    BGZF* in = open_bgzf(input_file, "r");
+
+    // Sorted runs go to temporary files, in the order the runs were read.
+    vector<string> temp_files;
+    size_t total_lines = 0, next_run = 0;
+    kstring_t buffer = { 0, 0, nullptr };
+    bool read_error = false;
+
+    #pragma omp parallel
+    {
+        while (true) {
+            vector<string> lines;
+            size_t run = 0;
+
+            #pragma omp critical (gaf_input)
+            {
+                // Each thread fights for the file and the winner takes some data.
+                size_t buffered_bytes = 0;
+                while (!read_error && buffered_bytes < this->max_buf_size) {
+                    int length = bgzf_getline(in, '\n', &buffer);
+                    if (length < -1) {
+                        read_error = true;
+                        break;
+                    } else if (length == -1) {
+                        break;
+                    }
+                    if (length > 0 && buffer.s[length - 1] == '\r') {
+                        length--;
+                    }
+                    if (length == 0 || buffer.s[0] == '@') {
+                        // Skip empty lines and header lines.
+                        continue;
+                    }
+                    lines.emplace_back(buffer.s, length);
+                    buffered_bytes += length;
+                }
+                if (!lines.empty()) {
+                    run = next_run;
+                    next_run++;
+                }
+            }
+
+            if (lines.empty()) {
+                break;
+            }
+
+            // Sort the run by key. Ties are broken by input order.
+            vector<pair<tuple<id_t, int64_t>, size_t>> keys(lines.size());
+            for (size_t i = 0; i < lines.size(); i++) {
+                keys[i] = make_pair(gaf_sort_key(lines[i]).sort_order(), i);
+            }
+            ips4o::sort(keys.begin(), keys.end());
+
+            // Save it to a temporary file with fast compression.
+            string temp_name = temp_file::create();
+            BGZF* temp = open_bgzf(temp_name, "w1");
+            for (auto& key : keys) {
+                write_gaf_line(temp, lines[key.second]);
+            }
+            close_bgzf(temp, temp_name);
+
+            #pragma omp critical (gaf_temp_files)
+            {
+                if (temp_files.size() <= run) {
+                    temp_files.resize(run + 1);
+                }
+                temp_files[run] = temp_name;
+                total_lines += lines.size();
+            }
+        }
+    }
+
+    free(buffer.s);
+    if (read_error) {
+        cerr << "error:[vg::GAFSorter]: could not read " << input_file << endl;
+        exit(1);
+    }
+    close_bgzf(in, input_file);
+
+    while (temp_files.size() > this->max_fan_in) {
+        // We can't merge them all at once, so merge subsets of them.
+        temp_files = this->merge_batches(temp_files);
+    }
+
+    BGZF* out = open_bgzf(output_file, "w");
+    this->merge(temp_files, out, index_to, total_lines);
+    close_bgzf(out, output_file);
+}
+
+void GAFSorter::merge(const vector<string>& temp_files, BGZF* out, GAFIndex* index_to, size_t expected_lines) {
+
+    create_progress("merge " + to_string(temp_files.size()) + " files", expected_lines == 0 ? 1 : expected_lines);
+    size_t observed_lines = 0;
+
+    vector<unique_ptr<GAFRunReader>> readers;
+    readers.reserve(temp_files.size());
+    for (auto& filename : temp_files) {
+        readers.emplace_back(new GAFRunReader(filename));
+    }
+
+    // The queue is ordered by key and then by run, so ties keep the input
+    // order. We reverse the order, because priority queues put the "greatest"
+    // element first.
+    using entry_type = pair<tuple<id_t, int64_t>, size_t>;
+    priority_queue<entry_type, vector<entry_type>, greater<entry_type>> queue;
+    for (size_t i = 0; i < readers.size(); i++) {
+        if (readers[i]->next()) {
+            queue.emplace(readers[i]->key.sort_order(), i);
+        }
+    }
+
+    // The group of lines we are currently indexing.
+    size_t group_lines = 0;
+    int64_t group_start = 0;
+    id_t group_min = 0, group_max = 0;
+
+    while (!queue.empty()) {
+        size_t winner = queue.top().second;
+        queue.pop();
+        GAFRunReader& reader = *(readers[winner]);
+
+        if (index_to != nullptr) {
+            if (group_lines == 0) {
+                group_start = bgzf_tell(out);
+                group_min = reader.key.min_id;
+                group_max = reader.key.max_id;
+            }
+            group_max = std::max(group_max, reader.key.max_id);
+        }
+        write_gaf_line(out, reader.line);
+        if (index_to != nullptr) {
+            group_lines++;
+            if (group_lines >= this->group_size) {
+                index_to->add_group(group_min, group_max, group_start, bgzf_tell(out));
+                group_lines = 0;
+            }
+        }
+
+        if (reader.next()) {
+            queue.emplace(reader.key.sort_order(), winner);
+        }
+
+        observed_lines++;
+        if (expected_lines != 0) {
+            update_progress(observed_lines);
+        }
+    }
+    if (index_to != nullptr && group_lines > 0) {
+        index_to->add_group(group_min, group_max, group_start, bgzf_tell(out));
+    }
+
+    update_progress(expected_lines == 0 ? 1 : expected_lines);
+    destroy_progress();
+
+    // Clean up the input files.
+    readers.clear();
+    for (auto& filename : temp_files) {
+        temp_file::remove(filename);
+    }
+}
+
+vector<string> GAFSorter::merge_batches(const vector<string>& temp_files) {
+    vector<string> result;
+    // We don't do this loop in parallel because the point of looping is to limit the total currently open files.
+    for (size_t start = 0; start < temp_files.size(); start += this->max_fan_in) {
+        size_t count = std::min(this->max_fan_in, temp_files.size() - start);
+        vector<string> batch(temp_files.begin() + start, temp_files.begin() + start + count);
+        string out_name = temp_file::create();
+        BGZF* out = open_bgzf(out_name, "w1");
+        this->merge(batch, out, nullptr, 0);
+        close_bgzf(out, out_name);
+        result.push_back(out_name);
+    }
+    return result;
+}
+
+//------------------------------------------------------------------------------
+
+void find_gaf(BGZF* gaf_file, const GAFIndex& index, id_t min_node, id_t max_node,
+              const function<void(const string&)>& handle_result) {
+
+    kstring_t buffer = { 0, 0, nullptr };
+
+    // Virtual offset of the next line. If we are at the end of a block, we
+    // move to the next block first, so that the offset matches the offsets
+    // recorded when writing.
+    auto next_line_offset = [&]() -> int64_t {
+        if (gaf_file->block_offset >= gaf_file->block_length) {
+            if (bgzf_read_block(gaf_file) != 0) {
+                cerr << "error:[vg::find_gaf]: could not read a BGZF block" << endl;
+                exit(1);
+            }
+        }
+        return bgzf_tell(gaf_file);
+    };
+
+    index.find(min_node, max_node, [&](int64_t start_vo, int64_t past_end_vo) -> bool {
+        if (bgzf_seek(gaf_file, start_vo, SEEK_SET) != 0) {
+            cerr << "error:[vg::find_gaf]: could not seek to virtual offset " << start_vo << endl;
+            exit(1);
+        }
+        while (next_line_offset() < past_end_vo) {
+            int length = bgzf_getline(gaf_file, '\n', &buffer);
+            if (length < 0) {
+                break;
+            }
+            string line(buffer.s, length);
+            GAFSortKey key = gaf_sort_key(line);
+            if (key.min_id > max_node) {
+                // The lines are sorted, so the rest of the run is out of range.
+                return false;
+            }
+            bool visits = false;
+            for_each_gaf_node_id(line, [&](id_t id) -> bool {
+                if (id >= min_node && id <= max_node) {
+                    visits = true;
+                    return false;
+                }
+                return true;
+            });
+            if (visits) {
+                handle_result(line);
+            }
+        }
+        return true;
+    });
+
+    free(buffer.s);
+}
+
+//------------------------------------------------------------------------------
+
+}
@@ -0,0 +1,162 @@
+#ifndef VG_GAF_SORTER_HPP_INCLUDED
+#define VG_GAF_SORTER_HPP_INCLUDED
+
+/**
+ * \file gaf_sorter.hpp
+ * Sorts GAF files by node ID with temporary files, writes them BGZF
+ * compressed, and indexes them for node range queries.
+ */
+
+#include "progressive.hpp"
+#include "stream_index.hpp"
+#include "types.hpp"
+
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <htslib/bgzf.h>
+
+namespace vg {
+
+using namespace std;
+
+/// A GAF index uses the same bins and windows as a GAM index, with groups of
+/// lines between BGZF virtual offsets instead of groups of Protobuf messages.
+using GAFIndex = StreamIndexBase;
+
+/**
+ * A view of the fields of a GAF line that points into the line without
+ * copying it. Splitting finds the 12 mandatory fields with memchr(), which
+ * scans many bytes at a time, and leaves the optional tags and the path to be
+ * parsed only when they are asked for.
+ */
+struct GAFRecordView {
+    /// A piece of the line.
+    struct Field {
+        const char* data = nullptr;
+        size_t size = 0;
+
+        bool empty() const { return this->size == 0; }
+        bool is_missing() const { return this->size == 1 && this->data[0] == '*'; }
+        string str() const { return string(this->data, this->size); }
+        /// Parse the field as a non-negative integer. Returns false if it is
+        /// not one.
+        bool to_int(int64_t& value) const;
+    };
+
+    /// The number of mandatory fields.
+    constexpr static size_t MANDATORY_FIELDS = 12;
+
+    /// Mandatory fields, starting with the name and the path in field 5.
+    Field fields[MANDATORY_FIELDS];
+    /// The optional tags, still separated by tabs.
+    Field tags;
+
+    /// Split the line. Returns false if it is a header line or does not have
+    /// all mandatory fields, in which case the fields beyond the last one
+    /// found are empty.
+    bool split(const char* line, size_t length);
+    bool split(const string& line) { return this->split(line.data(), line.length()); }
+
+    /// Find the value of the optional tag with the given two-character name
+    /// (e.g. "cs"), without the name and type. Returns false if the line has
+    /// no such tag.
+    bool find_tag(const char* name, Field& value) const;
+
+    /// Call the iteratee with each node ID and orientation on the path, in path
+    /// order. Stops early and returns false if the iteratee returns false.
+    /// Paths that are not made of node IDs have no nodes.
+    bool for_each_node(const function<bool(id_t, bool)>& iteratee) const;
+};
+
+/**
+ * Call the iteratee in parallel with a view of each record of a GAF file,
+ * which may be BGZF-compressed, with "-" meaning standard input. The file is
+ * decompressed on htslib threads, and lines are handed out to the threads in
+ * batches of the given size. Header and empty lines are skipped.
+ */
+void for_each_gaf_record_parallel(const string& filename, const function<void(const GAFRecordView&)>& iteratee,
+                                  size_t batch_size = 512);
+
+/**
+ * The node IDs visited by a GAF line, and the key it is sorted by.
+ */
+struct GAFSortKey {
+    /// Minimum node ID on the path, or 0 if the path has no node IDs.
+    id_t min_id = 0;
+    /// Maximum node ID on the path, or 0 if the path has no node IDs.
+    id_t max_id = 0;
+    /// Path start offset, if the path starts on the minimum node, and 0
+    /// otherwise.
+    int64_t offset = 0;
+
+    /// Sort by minimum node ID and then by offset.
+    tuple<id_t, int64_t> sort_order() const {
+        return make_tuple(this->min_id, this->offset);
+    }
+};
+
+/**
+ * Compute the sort key for a GAF line. Unmapped lines and lines with paths
+ * given as stable path intervals have no node IDs.
+ */
+GAFSortKey gaf_sort_key(const string& line);
+
+/**
+ * Call the iteratee with each node ID on the path of the GAF line, in path
+ * order. Stops early and returns false if the iteratee returns false.
+ */
+bool for_each_gaf_node_id(const string& line, const function<bool(id_t)>& iteratee);
+
+/**
+ * Sorts GAF lines by GAFSortKey, using temporary files for sorted runs that
+ * are then merged, much like StreamSorter does for GAM. Ties keep the input
+ * order. The output is BGZF-compressed and can be indexed while it is
+ * written.
+ */
+class GAFSorter : public Progressive {
+public:
+    /// Create a GAF sorter, showing sort progress on standard error if
+    /// show_progress is true.
+    GAFSorter(bool show_progress = false);
+
+    /**
+     * Sort the GAF lines in the input file ("-" for standard input), which
+     * may be plain, gzip, or BGZF, into a BGZF-compressed output file ("-"
+     * for standard output). Optionally index the sorted file into the given
+     * index. Uses OMP threads for sorting runs. Exits with an error if a file
+     * cannot be opened.
+     */
+    void sort(const string& input_file, const string& output_file, GAFIndex* index_to = nullptr);
+
+    /// Maximum total length of GAF lines in a single sorted run.
+    size_t max_buf_size = 256 * 1024 * 1024;
+
+    /// Maximum number of temporary files merged at once.
+    size_t max_fan_in = 512;
+
+    /// Number of lines in each indexed group in the output.
+    size_t group_size = 1024;
+
+private:
+    /// Merge the given temporary files into the output, indexing it if
+    /// requested. The input files will be deleted.
+    void merge(const vector<string>& temp_files, BGZF* out, GAFIndex* index_to, size_t expected_lines);
+
+    /// Merge the temporary files in batches of at most max_fan_in files and
+    /// return the names of the merged files.
+    vector<string> merge_batches(const vector<string>& temp_files);
+};
+
+/**
+ * Call the callback with every line in the sorted BGZF-compressed GAF file
+ * that visits a node in the given inclusive range, using the index.
+ */
+void find_gaf(BGZF* gaf_file, const GAFIndex& index, id_t min_node, id_t max_node,
+              const function<void(const string&)>& handle_result);
+
+}
+
+#endif
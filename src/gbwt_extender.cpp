@@ -1,9 +1,9 @@
 #include "gbwt_extender.hpp"
+#include "compare_kernels.hpp"
 
 #include <algorithm>
 #include <array>
 #include <cstring>
-#include <queue>
 #include <set>
 
 #include <structures/immutable_list.hpp>
@@ -16,6 +16,7 @@ namespace vg {
 
 constexpr size_t GaplessExtender::MAX_MISMATCHES;
 constexpr double GaplessExtender::OVERLAP_THRESHOLD;
+constexpr size_t GaplessExtensionCache::DEFAULT_MAX_RECORDS;
 
 //------------------------------------------------------------------------------
 
@@ -156,6 +157,77 @@ void ReadMasker::operator()(std::string& sequence) const {
     }
 }
 
+void ReadMasker::operator()(const std::string& sequence, std::string& masked) const {
+    masked.resize(sequence.size());
+    for (size_t i = 0; i < sequence.size(); i++) {
+        masked[i] = this->mask[static_cast<size_t>(sequence[i])];
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void PreparedRead::prepare(const std::string& sequence) {
+    static const ReadMasker mask("ACGT");
+    mask(sequence, this->forward_sequence);
+
+    size_t n = this->forward_sequence.size();
+    this->reverse_sequence.resize(n);
+    this->packed_codes.assign((n + BASES_PER_WORD - 1) / BASES_PER_WORD, 0);
+    this->valid_bases.assign((n + 63) / 64, 0);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t code;
+        char complement;
+        switch (this->forward_sequence[i]) {
+        case 'A':
+            code = 0; complement = 'T';
+            break;
+        case 'C':
+            code = 1; complement = 'G';
+            break;
+        case 'G':
+            code = 2; complement = 'C';
+            break;
+        case 'T':
+            code = 3; complement = 'A';
+            break;
+        default:
+            this->reverse_sequence[n - 1 - i] = 'X';
+            continue;
+        }
+        this->reverse_sequence[n - 1 - i] = complement;
+        this->packed_codes[i / BASES_PER_WORD] |= code << (2 * (i % BASES_PER_WORD));
+        this->valid_bases[i / 64] |= uint64_t(1) << (i % 64);
+    }
+}
+
+PreparedRead& PreparedRead::for_this_thread(size_t mate) {
+    thread_local std::array<PreparedRead, 2> reads;
+    return reads.at(mate);
+}
+
+//------------------------------------------------------------------------------
+
+GaplessExtensionCache::GaplessExtensionCache(const gbwtgraph::GBWTGraph& graph, size_t max_records) :
+    cached_graph(graph), max_records(max_records)
+{
+}
+
+const gbwtgraph::CachedGBWTGraph* GaplessExtensionCache::get() {
+    size_t cached = this->cached_graph.cache.cacheSize();
+    if (cached > this->max_records) {
+        // CachedGBWT has no eviction of its own, so start over.
+        this->flushed_records += cached;
+        this->cached_graph.cache.clearCache();
+        this->flush_count++;
+    }
+    this->use_count++;
+    return &(this->cached_graph);
+}
+
+size_t GaplessExtensionCache::records_decoded() const {
+    return this->flushed_records + this->cached_graph.cache.cacheSize();
+}
+
 //------------------------------------------------------------------------------
 
 GaplessExtender::GaplessExtender() :
@@ -195,29 +267,38 @@ void set_score(GaplessExtension& extension, const Aligner* aligner) {
     extension.score += static_cast<int32_t>(extension.right_full * aligner->full_length_bonus);
 }
 
+// Returns the length of the longest common prefix of a and b, up to len
+// characters, using the fastest comparison kernels for this CPU.
+inline size_t common_prefix_length(const char* a, const char* b, size_t len) {
+    static const CompareKernels& kernels = get_compare_kernels();
+    return kernels.common_prefix_length(a, b, len);
+}
+
+// Returns the length of the longest common suffix of the len characters
+// ending before a_end and b_end, using the fastest comparison kernels for
+// this CPU.
+inline size_t common_suffix_length(const char* a_end, const char* b_end, size_t len) {
+    static const CompareKernels& kernels = get_compare_kernels();
+    return kernels.common_suffix_length(a_end, b_end, len);
+}
+
 // Match the initial node, assuming that read_offset or node_offset is 0.
 // Updates internal_score and old_score; use set_score() to compute score.
 void match_initial(GaplessExtension& match, const std::string& seq, gbwtgraph::view_type target) {
     size_t node_offset = match.offset;
     size_t left = std::min(seq.length() - match.read_interval.second, target.second - node_offset);
     while (left > 0) {
-        size_t len = std::min(left, sizeof(std::uint64_t));
-        std::uint64_t a = 0, b = 0;
-        std::memcpy(&a, seq.data() + match.read_interval.second, len);
-        std::memcpy(&b, target.first + node_offset, len);
-        if (a == b) {
-            match.read_interval.second += len;
-            node_offset += len;
-        } else {
-            for (size_t i = 0; i < len; i++) {
-                if (seq[match.read_interval.second] != target.first[node_offset]) {
-                    match.internal_score++;
-                }
-                match.read_interval.second++;
-                node_offset++;
-            }
-        }
+        size_t len = common_prefix_length(seq.data() + match.read_interval.second, target.first + node_offset, left);
+        match.read_interval.second += len;
+        node_offset += len;
         left -= len;
+        if (left > 0) {
+            // Step over the mismatch.
+            match.internal_score++;
+            match.read_interval.second++;
+            node_offset++;
+            left--;
+        }
     }
     match.old_score = match.internal_score;
 }
@@ -229,26 +310,19 @@ size_t match_forward(GaplessExtension& match, const std::string& seq, gbwtgraph:
     size_t node_offset = 0;
     size_t left = std::min(seq.length() - match.read_interval.second, target.second - node_offset);
     while (left > 0) {
-        size_t len = std::min(left, sizeof(std::uint64_t));
-        std::uint64_t a = 0, b = 0;
-        std::memcpy(&a, seq.data() + match.read_interval.second, len);
-        std::memcpy(&b, target.first + node_offset, len);
-        if (a == b) {
-            match.read_interval.second += len;
-            node_offset += len;
-        } else {
-            for (size_t i = 0; i < len; i++) {
-                if (seq[match.read_interval.second] != target.first[node_offset]) {
-                    if (match.internal_score + 1 >= mismatch_limit) {
-                        return node_offset;
-                    }
-                    match.internal_score++;
-                }
-                match.read_interval.second++;
-                node_offset++;
+        size_t len = common_prefix_length(seq.data() + match.read_interval.second, target.first + node_offset, left);
+        match.read_interval.second += len;
+        node_offset += len;
+        left -= len;
+        if (left > 0) {
+            if (match.internal_score + 1 >= mismatch_limit) {
+                return node_offset;
             }
+            match.internal_score++;
+            match.read_interval.second++;
+            node_offset++;
+            left--;
         }
-        left -= len;
     }
     return node_offset;
 }
@@ -259,26 +333,19 @@ size_t match_forward(GaplessExtension& match, const std::string& seq, gbwtgraph:
 void match_backward(GaplessExtension& match, const std::string& seq, gbwtgraph::view_type target, uint32_t mismatch_limit) {
     size_t left = std::min(match.read_interval.first, match.offset);
     while (left > 0) {
-        size_t len = std::min(left, sizeof(std::uint64_t));
-        std::uint64_t a = 0, b = 0;
-        std::memcpy(&a, seq.data() + match.read_interval.first - len, len);
-        std::memcpy(&b, target.first + match.offset - len, len);
-        if (a == b) {
-            match.read_interval.first -= len;
-            match.offset -= len;
-        } else {
-            for (size_t i = 0; i < len; i++) {
-                if (seq[match.read_interval.first - 1] != target.first[match.offset - 1]) {
-                    if (match.internal_score + 1 >= mismatch_limit) {
-                        return;
-                    }
-                    match.internal_score++;
-                }
-                match.read_interval.first--;
-                match.offset--;
+        size_t len = common_suffix_length(seq.data() + match.read_interval.first, target.first + match.offset, left);
+        match.read_interval.first -= len;
+        match.offset -= len;
+        left -= len;
+        if (left > 0) {
+            if (match.internal_score + 1 >= mismatch_limit) {
+                return;
             }
+            match.internal_score++;
+            match.read_interval.first--;
+            match.offset--;
+            left--;
         }
-        left -= len;
     }
 }
 
@@ -518,13 +585,161 @@ bool trim_mismatches(GaplessExtension& extension, const gbwtgraph::CachedGBWTGra
 //------------------------------------------------------------------------------
 
 std::vector<GaplessExtension> GaplessExtender::extend(cluster_type& cluster, std::string sequence, const gbwtgraph::CachedGBWTGraph* cache, size_t max_mismatches, double overlap_threshold) const {
+    this->mask(sequence);
+    return this->extend_masked(cluster, sequence, cache, max_mismatches, overlap_threshold);
+}
+
+std::vector<GaplessExtension> GaplessExtender::extend(cluster_type& cluster, const PreparedRead& read, const gbwtgraph::CachedGBWTGraph* cache, size_t max_mismatches, double overlap_threshold) const {
+    return this->extend_masked(cluster, read.forward(), cache, max_mismatches, overlap_threshold);
+}
+
+GaplessExtension GaplessExtender::extend_seed(seed_type seed, const std::string& sequence, const gbwtgraph::CachedGBWTGraph& cache, size_t max_mismatches, std::vector<GaplessExtension>& queue) const {
+
+    GaplessExtension best_match {
+        { }, static_cast<size_t>(0), gbwt::BidirectionalState(),
+        { static_cast<size_t>(0), static_cast<size_t>(0) }, { },
+        std::numeric_limits<int32_t>::min(), false, false,
+        false, false, std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint32_t>::max()
+    };
+
+    // Match the initial node and add it to the queue.
+    queue.clear();
+    auto push = [&](GaplessExtension&& extension) {
+        queue.emplace_back(std::move(extension));
+        std::push_heap(queue.begin(), queue.end());
+    };
+    {
+        size_t read_offset = get_read_offset(seed);
+        size_t node_offset = get_node_offset(seed);
+        GaplessExtension match {
+            { seed.first }, node_offset, cache.get_bd_state(seed.first),
+            { read_offset, read_offset }, { },
+            static_cast<int32_t>(0), false, false,
+            false, false, static_cast<uint32_t>(0), static_cast<uint32_t>(0)
+        };
+        match_initial(match, sequence, cache.get_sequence_view(seed.first));
+        if (match.read_interval.first == 0) {
+            match.left_full = true;
+            match.left_maximal = true;
+        }
+        if (match.read_interval.second >= sequence.length()) {
+            match.right_full = true;
+            match.right_maximal = true;
+        }
+        set_score(match, this->aligner);
+        push(std::move(match));
+    }
+
+    // Extend the most promising extensions first, using alignment scores for priority.
+    // First make the extension right-maximal and then left-maximal.
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end());
+        GaplessExtension curr = std::move(queue.back());
+        queue.pop_back();
+
+        // Case 1: Extend to the right.
+        if (!curr.right_maximal) {
+            size_t num_extensions = 0;
+            // Always allow at least max_mismatches / 2 mismatches in the current flank.
+            uint32_t mismatch_limit = std::max(
+                static_cast<uint32_t>(max_mismatches + 1),
+                static_cast<uint32_t>(max_mismatches / 2 + curr.old_score + 1));
+            cache.follow_paths(curr.state, false, [&](const gbwt::BidirectionalState& next_state) -> bool {
+                handle_t handle = gbwtgraph::GBWTGraph::node_to_handle(next_state.forward.node);
+                GaplessExtension next {
+                    { }, curr.offset, next_state,
+                    curr.read_interval, { },
+                    curr.score, curr.left_full, curr.right_full,
+                    curr.left_maximal, curr.right_maximal, curr.internal_score, curr.old_score
+                };
+                size_t node_offset = match_forward(next, sequence, cache.get_sequence_view(handle), mismatch_limit);
+                if (node_offset == 0) { // Did not match anything.
+                    return true;
+                }
+                next.path = get_path(curr.path, handle);
+                // Did the extension become right-maximal?
+                if (next.read_interval.second >= sequence.length()) {
+                    next.right_full = true;
+                    next.right_maximal = true;
+                    next.old_score = next.internal_score;
+                } else if (node_offset < cache.get_length(handle)) {
+                    next.right_maximal = true;
+                    next.old_score = next.internal_score;
+                }
+                set_score(next, this->aligner);
+                num_extensions += next.state.size();
+                push(std::move(next));
+                return true;
+            });
+            // We could not extend all threads in 'curr' to the right. The unextended ones
+            // may have different left extensions, so we must consider 'curr' right-maximal.
+            if (num_extensions < curr.state.size()) {
+                curr.right_maximal = true;
+                curr.old_score = curr.internal_score;
+                push(std::move(curr));
+            }
+            continue;
+        }
+
+        // Case 2: Extend to the left.
+        if (!curr.left_maximal) {
+            bool found_extension = false;
+            // Always allow at least max_mismatches / 2 mismatches in the current flank.
+            uint32_t mismatch_limit = std::max(
+                static_cast<uint32_t>(max_mismatches + 1),
+                static_cast<uint32_t>(max_mismatches / 2 + curr.old_score + 1));
+            cache.follow_paths(curr.state, true, [&](const gbwt::BidirectionalState& next_state) -> bool {
+                handle_t handle = gbwtgraph::GBWTGraph::node_to_handle(gbwt::Node::reverse(next_state.backward.node));
+                size_t node_length = cache.get_length(handle);
+                GaplessExtension next {
+                    { }, node_length, next_state,
+                    curr.read_interval, { },
+                    curr.score, curr.left_full, curr.right_full,
+                    curr.left_maximal, curr.right_maximal, curr.internal_score, curr.old_score
+                };
+                match_backward(next, sequence, cache.get_sequence_view(handle), mismatch_limit);
+                if (next.offset >= node_length) { // Did not match anything.
+                    return true;
+                }
+                next.path = get_path(handle, curr.path);
+                // Did the extension become left-maximal?
+                if (next.read_interval.first == 0) {
+                    next.left_full = true;
+                    next.left_maximal = true;
+                    // No need to set old_score.
+                } else if (next.offset > 0) {
+                    next.left_maximal = true;
+                    // No need to set old_score.
+                }
+                set_score(next, this->aligner);
+                push(std::move(next));
+                found_extension = true;
+                return true;
+            });
+            if (!found_extension) {
+                curr.left_maximal = true;
+                // No need to set old_score.
+            } else {
+                continue;
+            }
+        }
+
+        // Case 3: Maximal extension with a better score than the best extension so far.
+        if (best_match < curr) {
+            best_match = std::move(curr);
+        }
+    }
+
+    return best_match;
+}
+
+std::vector<GaplessExtension> GaplessExtender::extend_masked(cluster_type& cluster, const std::string& sequence, const gbwtgraph::CachedGBWTGraph* cache, size_t max_mismatches, double overlap_threshold) const {
 
     std::vector<GaplessExtension> result;
     if (this->graph == nullptr || this->aligner == nullptr || cluster.empty() || sequence.empty()) {
         return result;
     }
     result.reserve(cluster.size());
-    this->mask(sequence);
 
     // Allocate a cache if we were not provided with one.
     bool free_cache = (cache == nullptr);
@@ -532,7 +747,10 @@ std::vector<GaplessExtension> GaplessExtender::extend(cluster_type& cluster, std
         cache = new gbwtgraph::CachedGBWTGraph(*(this->graph));
     }
 
-    // Find the best extension starting from each seed.
+    // Find the best extension starting from each seed. The seeds are
+    // independent apart from skipping the ones already covered, and they
+    // share the storage for the search queue.
+    std::vector<GaplessExtension> queue;
     size_t best_alignment = std::numeric_limits<size_t>::max();
     for (seed_type seed : cluster) {
 
@@ -543,135 +761,7 @@ std::vector<GaplessExtension> GaplessExtender::extend(cluster_type& cluster, std
             }
         }
 
-        GaplessExtension best_match {
-            { }, static_cast<size_t>(0), gbwt::BidirectionalState(),
-            { static_cast<size_t>(0), static_cast<size_t>(0) }, { },
-            std::numeric_limits<int32_t>::min(), false, false,
-            false, false, std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint32_t>::max()
-        };
-
-        // Match the initial node and add it to the queue.
-        std::priority_queue<GaplessExtension> extensions;
-        {
-            size_t read_offset = get_read_offset(seed);
-            size_t node_offset = get_node_offset(seed);
-            GaplessExtension match {
-                { seed.first }, node_offset, cache->get_bd_state(seed.first),
-                { read_offset, read_offset }, { },
-                static_cast<int32_t>(0), false, false,
-                false, false, static_cast<uint32_t>(0), static_cast<uint32_t>(0)
-            };
-            match_initial(match, sequence, cache->get_sequence_view(seed.first));
-            if (match.read_interval.first == 0) {
-                match.left_full = true;
-                match.left_maximal = true;
-            }
-            if (match.read_interval.second >= sequence.length()) {
-                match.right_full = true;
-                match.right_maximal = true;
-            }
-            set_score(match, this->aligner);
-            extensions.push(std::move(match));
-        }
-
-        // Extend the most promising extensions first, using alignment scores for priority.
-        // First make the extension right-maximal and then left-maximal.
-        while (!extensions.empty()) {
-            GaplessExtension curr = std::move(extensions.top());
-            extensions.pop();
-
-            // Case 1: Extend to the right.
-            if (!curr.right_maximal) {
-                size_t num_extensions = 0;
-                // Always allow at least max_mismatches / 2 mismatches in the current flank.
-                uint32_t mismatch_limit = std::max(
-                    static_cast<uint32_t>(max_mismatches + 1),
-                    static_cast<uint32_t>(max_mismatches / 2 + curr.old_score + 1));
-                cache->follow_paths(curr.state, false, [&](const gbwt::BidirectionalState& next_state) -> bool {
-                    handle_t handle = gbwtgraph::GBWTGraph::node_to_handle(next_state.forward.node);
-                    GaplessExtension next {
-                        { }, curr.offset, next_state,
-                        curr.read_interval, { },
-                        curr.score, curr.left_full, curr.right_full,
-                        curr.left_maximal, curr.right_maximal, curr.internal_score, curr.old_score
-                    };
-                    size_t node_offset = match_forward(next, sequence, cache->get_sequence_view(handle), mismatch_limit);
-                    if (node_offset == 0) { // Did not match anything.
-                        return true;
-                    }
-                    next.path = get_path(curr.path, handle);
-                    // Did the extension become right-maximal?
-                    if (next.read_interval.second >= sequence.length()) {
-                        next.right_full = true;
-                        next.right_maximal = true;
-                        next.old_score = next.internal_score;
-                    } else if (node_offset < cache->get_length(handle)) {
-                        next.right_maximal = true;
-                        next.old_score = next.internal_score;
-                    }
-                    set_score(next, this->aligner);
-                    num_extensions += next.state.size();
-                    extensions.push(std::move(next));
-                    return true;
-                });
-                // We could not extend all threads in 'curr' to the right. The unextended ones
-                // may have different left extensions, so we must consider 'curr' right-maximal.
-                if (num_extensions < curr.state.size()) {
-                    curr.right_maximal = true;
-                    curr.old_score = curr.internal_score;
-                    extensions.push(std::move(curr));
-                }
-                continue;
-            }
-
-            // Case 2: Extend to the left.
-            if (!curr.left_maximal) {
-                bool found_extension = false;
-                // Always allow at least max_mismatches / 2 mismatches in the current flank.
-                uint32_t mismatch_limit = std::max(
-                    static_cast<uint32_t>(max_mismatches + 1),
-                    static_cast<uint32_t>(max_mismatches / 2 + curr.old_score + 1));
-                cache->follow_paths(curr.state, true, [&](const gbwt::BidirectionalState& next_state) -> bool {
-                    handle_t handle = gbwtgraph::GBWTGraph::node_to_handle(gbwt::Node::reverse(next_state.backward.node));
-                    size_t node_length = cache->get_length(handle);
-                    GaplessExtension next {
-                        { }, node_length, next_state,
-                        curr.read_interval, { },
-                        curr.score, curr.left_full, curr.right_full,
-                        curr.left_maximal, curr.right_maximal, curr.internal_score, curr.old_score
-                    };
-                    match_backward(next, sequence, cache->get_sequence_view(handle), mismatch_limit);
-                    if (next.offset >= node_length) { // Did not match anything.
-                        return true;
-                    }
-                    next.path = get_path(handle, curr.path);
-                    // Did the extension become left-maximal?
-                    if (next.read_interval.first == 0) {
-                        next.left_full = true;
-                        next.left_maximal = true;
-                        // No need to set old_score.
-                    } else if (next.offset > 0) {
-                        next.left_maximal = true;
-                        // No need to set old_score.
-                    }
-                    set_score(next, this->aligner);
-                    extensions.push(std::move(next));
-                    found_extension = true;
-                    return true;
-                });
-                if (!found_extension) {
-                    curr.left_maximal = true;
-                    // No need to set old_score.
-                } else {
-                    continue;
-                }
-            }
-
-            // Case 3: Maximal extension with a better score than the best extension so far.
-            if (best_match < curr) {
-                best_match = std::move(curr);
-            }
-        }
+        GaplessExtension best_match = this->extend_seed(seed, sequence, *cache, max_mismatches, queue);
 
         // Add the best match to the result and update the best_alignment offset.
         if (!best_match.empty()) {
@@ -1385,6 +1475,50 @@ struct WFAPoint {
 
 //------------------------------------------------------------------------------
 
+/// The WFA score matrices for one WFANode: points indexed by score and
+/// diagonal, for matches, insertions, and deletions.
+typedef std::array<std::unordered_map<WFAPoint::key_type, WFAPoint::value_type>, 3> WFAWavefronts;
+
+/// A per-thread pool of wavefront storage. When a WFATree is done, the
+/// emptied hash tables of its nodes go back to the pool with their buckets
+/// still allocated, so the next alignment on the thread can reuse them.
+class WFAWavefrontPool {
+public:
+    /// Keep at most this many sets of wavefronts around per thread.
+    constexpr static size_t MAX_POOLED = 256;
+
+    /// Get the pool for the calling thread.
+    static WFAWavefrontPool& for_this_thread() {
+        thread_local WFAWavefrontPool pool;
+        return pool;
+    }
+
+    /// Get an empty set of wavefronts, reused if possible.
+    WFAWavefronts take() {
+        if (this->pooled.empty()) {
+            return WFAWavefronts();
+        }
+        WFAWavefronts result = std::move(this->pooled.back());
+        this->pooled.pop_back();
+        return result;
+    }
+
+    /// Give back a set of wavefronts that is no longer needed.
+    void give(WFAWavefronts&& wavefronts) {
+        if (this->pooled.size() < MAX_POOLED) {
+            for (auto& points : wavefronts) {
+                points.clear();
+            }
+            this->pooled.emplace_back(std::move(wavefronts));
+        }
+    }
+
+private:
+    std::vector<WFAWavefronts> pooled;
+};
+
+//------------------------------------------------------------------------------
+
 /// Represents a node in the tree of haplotypes we are traversing and doing WFA
 /// against.
 ///
@@ -1426,7 +1560,7 @@ struct WFANode {
     constexpr static size_t DELETIONS = 2;  // characters in the graph but not in the sequence
 
     // Points on the wavefronts are indexed by score, diagonal.
-    std::array<std::unordered_map<WFAPoint::key_type, WFAPoint::value_type>, 3> wavefronts;
+    WFAWavefronts wavefronts;
 
     WFANode(const vector<gbwt::SearchState>& states, uint32_t parent, const gbwtgraph::GBWTGraph& graph) :
         states(states),
@@ -1435,7 +1569,7 @@ struct WFANode {
         stored_length(0),
         parent(parent), children(),
         dead_end(false),
-        wavefronts() {
+        wavefronts(WFAWavefrontPool::for_this_thread().take()) {
         if (states.empty()) {
             throw std::runtime_error("Cannot make a WFANode for nothing");
         }
@@ -1524,7 +1658,8 @@ struct WFANode {
     }
 
     // Returns a position at the first non-match after the given position.
-    void match_forward(const std::string& sequence, const gbwtgraph::GBWTGraph& graph, MatchPos& pos) const {
+    // If bit_parallel is set, compares many bases at a time within each graph node.
+    void match_forward(const std::string& sequence, const gbwtgraph::GBWTGraph& graph, MatchPos& pos, bool bit_parallel) const {
 
         // Get first graph node starting after our offset.
         std::map<size_t, size_t>::const_iterator here = this->states_by_start.upper_bound(pos.node_offset);
@@ -1546,6 +1681,14 @@ struct WFANode {
             gbwtgraph::view_type node_seq = graph.get_sequence_view(handle);
             size_t graph_node_offset = pos.node_offset - here->first;
 
+            if (bit_parallel) {
+                // Jump along the diagonal to the end of the run of matches in this graph node.
+                size_t max_len = std::min(sequence.length() - pos.seq_offset, node_seq.second - graph_node_offset);
+                size_t len = common_prefix_length(sequence.data() + pos.seq_offset, node_seq.first + graph_node_offset, max_len);
+                pos.seq_offset += len;
+                pos.node_offset += len;
+                graph_node_offset += len;
+            }
             while (pos.seq_offset < sequence.length() && graph_node_offset < node_seq.second && sequence[pos.seq_offset] == node_seq.first[graph_node_offset]) {
                 // Until we hit the end of the sequence, or the graph node, or a mismatch, advance
                 pos.seq_offset++;
@@ -1565,7 +1708,8 @@ struct WFANode {
     }
 
     // Returns a position at the start of the run of matches before the given position.
-    void match_backward(const std::string& sequence, const gbwtgraph::GBWTGraph& graph, MatchPos& pos) const {
+    // If bit_parallel is set, compares many bases at a time within each graph node.
+    void match_backward(const std::string& sequence, const gbwtgraph::GBWTGraph& graph, MatchPos& pos, bool bit_parallel) const {
 
         // Get first graph node starting after our offset.
         std::map<size_t, size_t>::const_iterator here = this->states_by_start.upper_bound(pos.node_offset);
@@ -1586,6 +1730,14 @@ struct WFANode {
             gbwtgraph::view_type node_seq = graph.get_sequence_view(handle);
             size_t graph_node_offset = pos.node_offset - here->first;
 
+            if (bit_parallel) {
+                // Jump back along the diagonal to the start of the run of matches in this graph node.
+                size_t max_len = std::min<size_t>(pos.seq_offset, graph_node_offset);
+                size_t len = common_suffix_length(sequence.data() + pos.seq_offset, node_seq.first + graph_node_offset, max_len);
+                pos.seq_offset -= len;
+                pos.node_offset -= len;
+                graph_node_offset -= len;
+            }
             while (pos.seq_offset > 0 && graph_node_offset > 0 && sequence[pos.seq_offset - 1] == node_seq.first[graph_node_offset - 1]) {
                 // Until we hit the start of the sequence, or the graph node, or a mismatch, go left
                 pos.seq_offset--;
@@ -1639,6 +1791,9 @@ public:
     // The overall closed range of diagonals reached.
     std::pair<int32_t, int32_t> max_diagonals;
 
+    // Compare bases many at a time when extending along a diagonal.
+    bool bit_parallel;
+
     // TODO: Remove when unnecessary.
     bool debug;
 
@@ -1651,6 +1806,7 @@ public:
         gap_extend(2 * aligner.gap_extension + aligner.match),
         score_bound(0),
         possible_scores(), max_diagonals(0, 0),
+        bit_parallel(true),
         debug(false)
     {
         this->nodes.emplace_back(this->coalesce(root), 0, this->graph);
@@ -1666,6 +1822,14 @@ public:
         possible_scores[0] = { 0, 0, false };
     }
 
+    ~WFATree() {
+        // Let the next alignment on this thread reuse our wavefront storage.
+        WFAWavefrontPool& pool = WFAWavefrontPool::for_this_thread();
+        for (auto& node : this->nodes) {
+            pool.give(std::move(node.wavefronts));
+        }
+    }
+
     /// Get all the GBWT search states for a run of the same set of haplotypes
     /// through nodes in the graph, without any haplotypes in the set branching
     /// off, and without any visits to the same oriented graph node twice.
@@ -1964,7 +2128,7 @@ private:
                     may_reach_to = false;
                 }
 
-                this->nodes[pos.node()].match_forward(this->sequence, this->graph, pos);
+                this->nodes[pos.node()].match_forward(this->sequence, this->graph, pos, this->bit_parallel);
 
                 // We got a match that reached the end or went past it.
                 // Alternatively there is no end position and we have aligned the entire sequence.
@@ -2105,6 +2269,19 @@ private:
 //------------------------------------------------------------------------------
 
 WFAAlignment WFAExtender::connect(std::string sequence, pos_t from, pos_t to) const {
+    this->mask(sequence);
+    return this->connect_masked(sequence, from, to);
+}
+
+WFAAlignment WFAExtender::connect(const PreparedRead& read, size_t start, size_t length, pos_t from, pos_t to) const {
+    // The tree refers to the sequence while it is being aligned, so we copy
+    // the interval into a buffer that outlives the call but not the thread.
+    thread_local std::string interval;
+    interval.assign(read.forward(), start, length);
+    return this->connect_masked(interval, from, to);
+}
+
+WFAAlignment WFAExtender::connect_masked(const std::string& sequence, pos_t from, pos_t to) const {
     if (this->graph == nullptr || this->aligner == nullptr) {
 #ifdef debug_connect
         std::cerr << "No graph or no aligner! Returning empty alignment!" << std::endl;
@@ -2118,9 +2295,9 @@ WFAAlignment WFAExtender::connect(std::string sequence, pos_t from, pos_t to) co
 #endif
         return WFAAlignment();
     }
-    this->mask(sequence);
 
     WFATree tree(*(this->graph), sequence, root_state, offset(from) + 1, *(this->aligner), *(this->error_model));
+    tree.bit_parallel = this->bit_parallel;
     tree.debug = this->debug;
 
     int32_t score = 0;
@@ -2288,14 +2465,33 @@ WFAAlignment WFAExtender::suffix(const std::string& sequence, pos_t from) const
 }
 
 WFAAlignment WFAExtender::prefix(const std::string& sequence, pos_t to) const {
+    std::string reverse_sequence = reverse_complement(sequence);
+    this->mask(reverse_sequence);
+    return this->prefix_masked(reverse_sequence, to);
+}
+
+WFAAlignment WFAExtender::suffix(const PreparedRead& read, size_t start, pos_t from) const {
+    return this->connect(read, start, read.size() - start, from, pos_t(0, false, 0));
+}
+
+WFAAlignment WFAExtender::prefix(const PreparedRead& read, size_t length, pos_t to) const {
+    // The reverse complement of the first length bases is the last length
+    // bases of the reverse complement.
+    thread_local std::string interval;
+    interval.assign(read.reverse(), read.size() - length, length);
+    return this->prefix_masked(interval, to);
+}
+
+WFAAlignment WFAExtender::prefix_masked(const std::string& reverse_sequence, pos_t to) const {
     if (this->graph == nullptr) {
         return WFAAlignment();
     }
 
     // Flip the position, extend forward, and reverse the return value.
     to = reverse_base_pos(to, this->graph->get_length(this->graph->get_handle(id(to), is_rev(to))));
-    WFAAlignment result = this->connect(reverse_complement(sequence), to, pos_t(0, false, 0));
-    result.flip(*(this->graph), sequence);
+    WFAAlignment result = this->connect_masked(reverse_sequence, to, pos_t(0, false, 0));
+    // Flipping only needs the length of the sequence.
+    result.flip(*(this->graph), reverse_sequence);
 
     return result;
 }
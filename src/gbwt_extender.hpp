@@ -117,12 +117,115 @@ public:
     /// Applies the mask to the given sequence.
     void operator()(std::string& sequence) const;
 
+    /// Writes the masked sequence into the given buffer, reusing its memory.
+    void operator()(const std::string& sequence, std::string& masked) const;
+
 private:
     std::vector<char> mask;
 };
 
 //------------------------------------------------------------------------------
 
+/**
+ * A read sequence preprocessed once for all the extensions done for it: the
+ * sequence and its reverse complement with all non-ACGT characters masked
+ * with X, as the extenders use them, and a 2-bit packed encoding of the
+ * sequence. The buffers are reused when the next read is prepared, so once
+ * they have grown to the typical read length, preparing a read does not
+ * allocate.
+ *
+ * Not thread-safe; use one per read being mapped by each thread, for example
+ * from for_this_thread().
+ */
+class PreparedRead {
+public:
+    /// Preprocess the given sequence, replacing the previous one.
+    void prepare(const std::string& sequence);
+
+    /// Length of the sequence.
+    size_t size() const { return this->forward_sequence.size(); }
+
+    /// The masked sequence.
+    const std::string& forward() const { return this->forward_sequence; }
+
+    /// The reverse complement of the masked sequence.
+    const std::string& reverse() const { return this->reverse_sequence; }
+
+    /// The 2-bit code of the base at the given offset, with A, C, G, T =
+    /// 0, 1, 2, 3. Masked bases have code 0.
+    uint8_t code(size_t i) const {
+        return (this->packed_codes[i / BASES_PER_WORD] >> (2 * (i % BASES_PER_WORD))) & 3;
+    }
+
+    /// Whether the base at the given offset is one of ACGT.
+    bool is_valid(size_t i) const {
+        return (this->valid_bases[i / 64] >> (i % 64)) & 1;
+    }
+
+    /// The packed encoding, with base i in bits 2 * (i % 32) and up of word
+    /// i / 32.
+    const std::vector<uint64_t>& packed() const { return this->packed_codes; }
+
+    /// Number of bases in each word of the packed encoding.
+    constexpr static size_t BASES_PER_WORD = 32;
+
+    /**
+     * Get a PreparedRead for the calling thread. There is a separate one for
+     * each read of a pair, selected by mate.
+     */
+    static PreparedRead& for_this_thread(size_t mate = 0);
+
+private:
+    std::string forward_sequence;
+    std::string reverse_sequence;
+    std::vector<uint64_t> packed_codes;
+    /// One bit per base, set if the base is not masked.
+    std::vector<uint64_t> valid_bases;
+};
+
+//------------------------------------------------------------------------------
+
+/**
+ * A CachedGBWTGraph shared by all the gapless extensions done for one read or
+ * read pair, so that GBWT records decoded while extending one cluster can be
+ * reused by the next one. The cache is bounded: when it holds more than
+ * max_records decoded records, it is emptied before the next extension.
+ * Also counts how much decoding the extensions needed.
+ *
+ * Not thread-safe; use one per mapping thread.
+ */
+class GaplessExtensionCache {
+public:
+    /// The default number of decoded records to keep.
+    constexpr static size_t DEFAULT_MAX_RECORDS = 4096;
+
+    /// Create a cache over the given GBWTGraph.
+    explicit GaplessExtensionCache(const gbwtgraph::GBWTGraph& graph, size_t max_records = DEFAULT_MAX_RECORDS);
+
+    /// Get the cached graph to use for the next extension, emptying the cache
+    /// first if it has grown too big.
+    const gbwtgraph::CachedGBWTGraph* get();
+
+    /// Number of times get() has been called.
+    size_t uses() const { return this->use_count; }
+
+    /// Number of GBWT records decoded into the cache so far.
+    size_t records_decoded() const;
+
+    /// Number of times the cache was emptied because it was full.
+    size_t flushes() const { return this->flush_count; }
+
+private:
+    gbwtgraph::CachedGBWTGraph cached_graph;
+    size_t max_records;
+    size_t use_count = 0;
+    size_t flush_count = 0;
+    /// Records that were in the cache when it was emptied.
+    size_t flushed_records = 0;
+};
+
+//------------------------------------------------------------------------------
+
 /**
  * A class that supports haplotype-consistent seed extension using GBWTGraph. Each seed
  * is a pair of matching read/graph positions and each extension is a gapless alignment
@@ -198,6 +301,9 @@ public:
      */
     std::vector<GaplessExtension> extend(cluster_type& cluster, std::string sequence, const gbwtgraph::CachedGBWTGraph* cache = nullptr, size_t max_mismatches = MAX_MISMATCHES, double overlap_threshold = OVERLAP_THRESHOLD) const;
 
+    /// As extend(), but for a read that has already been masked.
+    std::vector<GaplessExtension> extend(cluster_type& cluster, const PreparedRead& read, const gbwtgraph::CachedGBWTGraph* cache = nullptr, size_t max_mismatches = MAX_MISMATCHES, double overlap_threshold = OVERLAP_THRESHOLD) const;
+
     /**
      * Determine whether the extension set contains non-overlapping
      * full-length extensions sorted in descending order by score. Use
@@ -208,6 +314,21 @@ public:
     const gbwtgraph::GBWTGraph* graph;
     const Aligner*              aligner;
     ReadMasker                  mask;
+
+    /**
+     * Find the highest-scoring maximal extension of a single seed in a
+     * masked sequence, before removing duplicates and trimming. The result
+     * is empty if the seed does not match. This depends only on the seed,
+     * the sequence, and the graph, so a batch of seeds from one or many
+     * reads can be extended in any order, or handed to another backend, as
+     * long as the results are given to the same post-processing.
+     * queue is scratch space for the search, reused between calls.
+     */
+    GaplessExtension extend_seed(seed_type seed, const std::string& sequence, const gbwtgraph::CachedGBWTGraph& cache, size_t max_mismatches, std::vector<GaplessExtension>& queue) const;
+
+private:
+    /// Implementation of extend() for a sequence that has already been masked.
+    std::vector<GaplessExtension> extend_masked(cluster_type& cluster, const std::string& sequence, const gbwtgraph::CachedGBWTGraph* cache, size_t max_mismatches, double overlap_threshold) const;
 };
 
 //------------------------------------------------------------------------------
@@ -430,13 +551,36 @@ public:
      */
     WFAAlignment prefix(const std::string& sequence, pos_t to) const;
 
+    /// As connect(), for the given interval of an already masked read.
+    WFAAlignment connect(const PreparedRead& read, size_t start, size_t length, pos_t from, pos_t to) const;
+
+    /// As suffix(), for the part of an already masked read starting at the
+    /// given offset.
+    WFAAlignment suffix(const PreparedRead& read, size_t start, pos_t from) const;
+
+    /// As prefix(), for the first length bases of an already masked read.
+    /// Uses the precomputed reverse complement of the read.
+    WFAAlignment prefix(const PreparedRead& read, size_t length, pos_t to) const;
+
     const gbwtgraph::GBWTGraph* graph;
     ReadMasker                  mask;
     const Aligner*              aligner;
     const ErrorModel*           error_model;
+
+    /// Compare bases many at a time when extending along a diagonal within a
+    /// graph node, instead of one by one.
+    bool bit_parallel = true;
     
     /// TODO: Remove when unnecessary.
     bool debug = false;
+
+private:
+    /// Implementation of connect() for a sequence that has already been masked.
+    WFAAlignment connect_masked(const std::string& sequence, pos_t from, pos_t to) const;
+
+    /// Implementation of prefix() for the reverse complement of a sequence
+    /// that has already been masked.
+    WFAAlignment prefix_masked(const std::string& reverse_sequence, pos_t to) const;
 };
 
 //------------------------------------------------------------------------------
@@ -5,6 +5,9 @@
 #include <handle.hpp>
 #include <gbwtgraph/utils.h>
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <sstream>
 #include <unordered_map>
 
@@ -260,8 +263,48 @@ std::vector<std::vector<gbwt::size_type>> partition_gbwt_sequences(const gbwt::G
     return result;
 }
 
+// Apply the mappings to the path.
+gbwt::vector_type apply_mappings(const gbwt::vector_type& path, const std::unordered_map<gbwt::node_type, std::vector<RebuildJob::mapping_type>>& mappings_by_first_node) {
+    gbwt::vector_type mapped;
+    size_t i = 0;
+    while (i < path.size()) {
+        auto iter = mappings_by_first_node.find(path[i]);
+        bool found = false;
+        if (iter != mappings_by_first_node.end()) {
+            for (auto& mapping : iter->second) {
+                size_t j = 1;
+                while (j < mapping.first.size() && i + j < path.size() && mapping.first[j] == path[i + j]) {
+                    j++;
+                }
+                if (j >= mapping.first.size()) {
+                    // Leave the last node unprocessed if it does not change.
+                    if (mapping.first.size() > 1 && mapping.second.size() > 0 && mapping.first.back() == mapping.second.back()) {
+                        mapped.insert(mapped.end(), mapping.second.begin(), mapping.second.end() - 1);
+                        i += mapping.first.size() - 1;
+                    } else {
+                        mapped.insert(mapped.end(), mapping.second.begin(), mapping.second.end());
+                        i += mapping.first.size();
+                    }
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            mapped.push_back(path[i]);
+            i++;
+        }
+    }
+    return mapped;
+}
+
+// Number of sequences mapped in parallel before inserting them into the GBWT.
+constexpr size_t REBUILD_MAPPING_BATCH = 1024;
+
 // Build a GBWT by inserting the specified sequences and applying the specified mappings.
-gbwt::GBWT rebuild_gbwt_job(const gbwt::GBWT& gbwt_index, const RebuildJob& job, const std::vector<gbwt::size_type>& sequences, const RebuildParameters& parameters) {
+// The mappings are applied using the given number of threads, while GBWT construction
+// itself is sequential.
+gbwt::GBWT rebuild_gbwt_job(const gbwt::GBWT& gbwt_index, const RebuildJob& job, const std::vector<gbwt::size_type>& sequences, const RebuildParameters& parameters, size_t threads) {
 
     // Partition the mappings by the first node and determine node width.
     gbwt::size_type node_width = sdsl::bits::length(gbwt_index.sigma() - 1);
@@ -281,40 +324,19 @@ gbwt::GBWT rebuild_gbwt_job(const gbwt::GBWT& gbwt_index, const RebuildJob& job,
     }
 
     // Insert the sequences from the original GBWT and apply the mappings.
+    // Sequences are mapped in parallel in batches and inserted in the original order.
     gbwt::GBWTBuilder builder(node_width, parameters.batch_size, parameters.sample_interval);
-    for (gbwt::size_type sequence : sequences) {
-        gbwt::vector_type path = gbwt_index.extract(sequence);
-        gbwt::vector_type mapped;
-        size_t i = 0;
-        while (i < path.size()) {
-            auto iter = mappings_by_first_node.find(path[i]);
-            bool found = false;
-            if (iter != mappings_by_first_node.end()) {
-                for (auto& mapping : iter->second) {
-                    size_t j = 1;
-                    while (j < mapping.first.size() && i + j < path.size() && mapping.first[j] == path[i + j]) {
-                        j++;
-                    }
-                    if (j >= mapping.first.size()) {
-                        // Leave the last node unprocessed if it does not change.
-                        if (mapping.first.size() > 1 && mapping.second.size() > 0 && mapping.first.back() == mapping.second.back()) {
-                            mapped.insert(mapped.end(), mapping.second.begin(), mapping.second.end() - 1);
-                            i += mapping.first.size() - 1;
-                        } else {
-                            mapped.insert(mapped.end(), mapping.second.begin(), mapping.second.end());
-                            i += mapping.first.size();
-                        }
-                        found = true;
-                        break;
-                    }
-                }
-            }
-            if (!found) {
-                mapped.push_back(path[i]);
-                i++;
-            }
+    std::vector<gbwt::vector_type> batch;
+    for (size_t batch_start = 0; batch_start < sequences.size(); batch_start += REBUILD_MAPPING_BATCH) {
+        size_t batch_end = std::min(batch_start + REBUILD_MAPPING_BATCH, sequences.size());
+        batch.resize(batch_end - batch_start);
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(threads) if (threads > 1)
+        for (size_t i = batch_start; i < batch_end; i++) {
+            batch[i - batch_start] = apply_mappings(gbwt_index.extract(sequences[i]), mappings_by_first_node);
+        }
+        for (auto& mapped : batch) {
+            builder.insert(mapped, true);
         }
-        builder.insert(mapped, true);
     }
     builder.finish();
 
@@ -363,8 +385,26 @@ gbwt::GBWT rebuild_gbwt(const gbwt::GBWT& gbwt_index,
     }
     std::vector<gbwt::GBWT> indexes(jobs.size());
     std::vector<std::vector<gbwt::size_type>> sequences_by_job = partition_gbwt_sequences(gbwt_index, node_to_job, jobs.size());
+
+    // A few huge jobs would otherwise run on a single thread each after the
+    // tiny ones have finished. We give each job a share of the threads for
+    // applying the mappings that is proportional to its size.
+    size_t total_size = 0;
+    for (auto& job : jobs) {
+        total_size += job.total_size;
+    }
+    std::vector<size_t> job_threads(jobs.size(), std::max(parameters.num_jobs, size_t(1)));
+    if (total_size > 0) {
+        for (size_t job = 0; job < jobs.size(); job++) {
+            double share = static_cast<double>(parameters.num_jobs * jobs[job].total_size) / total_size;
+            job_threads[job] = std::max(static_cast<size_t>(std::round(share)), size_t(1));
+        }
+    }
+
     int old_max_threads = omp_get_max_threads();
+    int old_max_levels = omp_get_max_active_levels();
     omp_set_num_threads(parameters.num_jobs);
+    omp_set_max_active_levels(std::max(old_max_levels, 2));
     #pragma omp parallel for schedule(dynamic, 1)
     for (size_t i = 0; i < jobs.size(); i++) {
         size_t job = jobs_by_size[i];
@@ -374,7 +414,7 @@ gbwt::GBWT rebuild_gbwt(const gbwt::GBWT& gbwt_index,
                 std::cerr << "rebuild_gbwt(): Starting job " << job << std::endl;
             }
         }
-        indexes[job] = rebuild_gbwt_job(gbwt_index, jobs[job], sequences_by_job[job], parameters);
+        indexes[job] = rebuild_gbwt_job(gbwt_index, jobs[job], sequences_by_job[job], parameters, job_threads[job]);
         if (parameters.show_progress) {
             #pragma omp critical
             {
@@ -383,6 +423,7 @@ gbwt::GBWT rebuild_gbwt(const gbwt::GBWT& gbwt_index,
         }
     }
     omp_set_num_threads(old_max_threads);
+    omp_set_max_active_levels(old_max_levels);
 
     // We can avoid merging if we had only one job.
     if (indexes.size() == 1) {
@@ -476,14 +517,6 @@ std::string insert_gbwt_path(MutablePathHandleGraph& graph, const gbwt::GBWT& gb
 }
 
 Path extract_gbwt_path(const HandleGraph& graph, const gbwt::GBWT& gbwt_index, gbwt::size_type id) {
-
-    Path result;
-    gbwt::size_type sequence_id = gbwt_index.bidirectional() ? gbwt::Path::encode(id, false) : id;
-    if (sequence_id >= gbwt_index.sequences()) {
-        std::cerr << "error: [insert_gbwt_path()] invalid path id: " << id << std::endl;
-        return result;
-    }
-    
     // TODO: Pass this down for efficiency
     auto parse = gbwtgraph::parse_reference_samples_tag(gbwt_index);
     auto sense = gbwtgraph::get_path_sense(gbwt_index, id, parse);
@@ -491,6 +524,17 @@ Path extract_gbwt_path(const HandleGraph& graph, const gbwt::GBWT& gbwt_index, g
     if (path_name.empty()) {
         path_name = std::to_string(id);
     }
+    return extract_gbwt_path(graph, gbwt_index, id, path_name);
+}
+
+Path extract_gbwt_path(const HandleGraph& graph, const gbwt::GBWT& gbwt_index, gbwt::size_type id, const std::string& path_name) {
+
+    Path result;
+    gbwt::size_type sequence_id = gbwt_index.bidirectional() ? gbwt::Path::encode(id, false) : id;
+    if (sequence_id >= gbwt_index.sequences()) {
+        std::cerr << "error: [insert_gbwt_path()] invalid path id: " << id << std::endl;
+        return result;
+    }
     result.set_name(path_name);
 
     gbwt::edge_type pos = gbwt_index.start(sequence_id);
@@ -512,6 +556,203 @@ Path extract_gbwt_path(const HandleGraph& graph, const gbwt::GBWT& gbwt_index, g
     return result;
 }
 
+GBWTPathNames::GBWTPathNames(const gbwt::GBWT& gbwt_index) {
+    if (!gbwt_index.hasMetadata() || !gbwt_index.metadata.hasPathNames()) {
+        return;
+    }
+
+    auto parse = gbwtgraph::parse_reference_samples_tag(gbwt_index);
+    this->names.resize(gbwt_index.metadata.paths());
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t id = 0; id < this->names.size(); id++) {
+        auto sense = gbwtgraph::get_path_sense(gbwt_index, id, parse);
+        this->names[id] = gbwtgraph::compose_path_name(gbwt_index, id, sense);
+        if (this->names[id].empty()) {
+            this->names[id] = std::to_string(id);
+        }
+    }
+
+    this->name_to_id.reserve(this->names.size());
+    for (size_t id = 0; id < this->names.size(); id++) {
+        // Keep the first path with each name.
+        this->name_to_id.emplace(this->names[id], id);
+    }
+}
+
+gbwt::size_type GBWTPathNames::find(const std::string& name) const {
+    auto iter = this->name_to_id.find(name);
+    return (iter == this->name_to_id.end() ? this->size() : iter->second);
+}
+
+std::vector<Path> extract_gbwt_paths(const HandleGraph& graph, const gbwt::GBWT& gbwt_index, const std::vector<gbwt::size_type>& ids, const GBWTPathNames& names) {
+    std::vector<Path> result(ids.size());
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < ids.size(); i++) {
+        std::string path_name = (ids[i] < names.size() ? names.name(ids[i]) : std::to_string(ids[i]));
+        result[i] = extract_gbwt_path(graph, gbwt_index, ids[i], path_name);
+    }
+    return result;
+}
+
+constexpr size_t GBWTOffsetIndex::DEFAULT_SAMPLE_INTERVAL;
+constexpr std::uint32_t GBWTOffsetIndex::Header::MAGIC_NUMBER;
+constexpr std::uint32_t GBWTOffsetIndex::Header::VERSION;
+
+GBWTOffsetIndex::GBWTOffsetIndex(const gbwt::GBWT& gbwt_index, const HandleGraph& graph, size_t sample_interval) {
+    this->header.sample_interval = std::max(sample_interval, size_t(1));
+    size_t path_count = (gbwt_index.bidirectional() ? gbwt_index.sequences() / 2 : gbwt_index.sequences());
+    this->path_lengths.resize(path_count, 0);
+
+    // Sample each path separately and concatenate the samples.
+    std::vector<std::vector<std::pair<size_t, gbwt::edge_type>>> path_samples(path_count);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t id = 0; id < path_count; id++) {
+        gbwt::size_type sequence = (gbwt_index.bidirectional() ? gbwt::Path::encode(id, false) : id);
+        size_t offset = 0, next_sample = 0;
+        gbwt::edge_type pos = gbwt_index.start(sequence);
+        while (pos.first != gbwt::ENDMARKER) {
+            if (offset >= next_sample) {
+                path_samples[id].emplace_back(offset, pos);
+                next_sample = offset + this->header.sample_interval;
+            }
+            offset += graph.get_length(gbwt_to_handle(graph, pos.first));
+            pos = gbwt_index.LF(pos);
+        }
+        this->path_lengths[id] = offset;
+    }
+
+    this->sample_starts.reserve(path_count + 1);
+    for (auto& samples : path_samples) {
+        this->samples.insert(this->samples.end(), samples.begin(), samples.end());
+        this->sample_starts.push_back(this->samples.size());
+        samples = std::vector<std::pair<size_t, gbwt::edge_type>>();
+    }
+}
+
+std::pair<gbwt::edge_type, size_t> GBWTOffsetIndex::seek(const gbwt::GBWT& gbwt_index, const HandleGraph& graph, gbwt::size_type id, size_t offset) const {
+    if (id >= this->paths() || offset >= this->path_length(id)) {
+        return std::make_pair(gbwt::invalid_edge(), (id < this->paths() ? this->path_length(id) : 0));
+    }
+
+    // Find the last sample at or before the offset. The first sample is always at offset 0.
+    auto first = this->samples.begin() + this->sample_starts[id];
+    auto last = this->samples.begin() + this->sample_starts[id + 1];
+    auto iter = std::upper_bound(first, last, offset, [](size_t target, const std::pair<size_t, gbwt::edge_type>& sample) {
+        return target < sample.first;
+    });
+    --iter;
+
+    // Walk to the node visit containing the offset.
+    size_t node_start = iter->first;
+    gbwt::edge_type pos = iter->second;
+    while (true) {
+        size_t node_end = node_start + graph.get_length(gbwt_to_handle(graph, pos.first));
+        if (node_end > offset) {
+            break;
+        }
+        node_start = node_end;
+        pos = gbwt_index.LF(pos);
+    }
+
+    return std::make_pair(pos, node_start);
+}
+
+std::string GBWTOffsetIndex::substring(const gbwt::GBWT& gbwt_index, const HandleGraph& graph, gbwt::size_type id, size_t start, size_t end) const {
+    std::string result;
+    if (id >= this->paths()) {
+        return result;
+    }
+    end = std::min(end, this->path_length(id));
+    if (start >= end) {
+        return result;
+    }
+
+    auto found = this->seek(gbwt_index, graph, id, start);
+    gbwt::edge_type pos = found.first;
+    size_t node_start = found.second;
+    while (node_start < end && pos.first != gbwt::ENDMARKER) {
+        std::string sequence = graph.get_sequence(gbwt_to_handle(graph, pos.first));
+        size_t from = (start > node_start ? start - node_start : 0);
+        size_t to = std::min(sequence.length(), end - node_start);
+        result.append(sequence, from, to - from);
+        node_start += sequence.length();
+        pos = gbwt_index.LF(pos);
+    }
+
+    return result;
+}
+
+void GBWTOffsetIndex::Header::check() const {
+    if (this->magic_number != MAGIC_NUMBER) {
+        throw sdsl::simple_sds::InvalidData("GBWTOffsetIndex::simple_sds_load(): Expected magic number " + std::to_string(MAGIC_NUMBER) +
+            ", got " + std::to_string(this->magic_number));
+    }
+    if (this->version != VERSION) {
+        throw sdsl::simple_sds::InvalidData("GBWTOffsetIndex::simple_sds_load(): Expected version " + std::to_string(VERSION) +
+            ", got version " + std::to_string(this->version));
+    }
+    if (this->sample_interval == 0) {
+        throw sdsl::simple_sds::InvalidData("GBWTOffsetIndex::simple_sds_load(): Sample interval must be nonzero");
+    }
+}
+
+void GBWTOffsetIndex::simple_sds_serialize(std::ostream& out) const {
+    sdsl::simple_sds::serialize_value<Header>(this->header, out);
+    sdsl::simple_sds::serialize_vector(this->path_lengths, out);
+    sdsl::simple_sds::serialize_vector(this->sample_starts, out);
+    sdsl::simple_sds::serialize_vector(this->samples, out);
+}
+
+void GBWTOffsetIndex::simple_sds_load(std::istream& in) {
+    this->header = sdsl::simple_sds::load_value<Header>(in);
+    this->header.check();
+    this->path_lengths = sdsl::simple_sds::load_vector<size_t>(in);
+    this->sample_starts = sdsl::simple_sds::load_vector<size_t>(in);
+    this->samples = sdsl::simple_sds::load_vector<std::pair<size_t, gbwt::edge_type>>(in);
+
+    if (this->sample_starts.size() != this->path_lengths.size() + 1 || this->sample_starts.back() != this->samples.size()) {
+        throw sdsl::simple_sds::InvalidData("GBWTOffsetIndex::simple_sds_load(): Sample ranges do not match the paths");
+    }
+    for (size_t id = 0; id < this->paths(); id++) {
+        bool has_samples = (this->sample_starts[id] < this->sample_starts[id + 1]);
+        if (has_samples != (this->path_lengths[id] > 0)) {
+            throw sdsl::simple_sds::InvalidData("GBWTOffsetIndex::simple_sds_load(): Path " + std::to_string(id) + " has invalid samples");
+        }
+    }
+}
+
+size_t GBWTOffsetIndex::simple_sds_size() const {
+    size_t result = sdsl::simple_sds::value_size<Header>();
+    result += sdsl::simple_sds::vector_size(this->path_lengths);
+    result += sdsl::simple_sds::vector_size(this->sample_starts);
+    result += sdsl::simple_sds::vector_size(this->samples);
+    return result;
+}
+
+void load_gbwt_offset_index(GBWTOffsetIndex& index, const std::string& filename, bool show_progress) {
+    if (show_progress) {
+        std::cerr << "Loading GBWT offset index from " << filename << std::endl;
+    }
+    std::ifstream in(filename, std::ios_base::binary);
+    if (!in) {
+        std::cerr << "error: [load_gbwt_offset_index()] cannot open GBWT offset index " << filename << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    try {
+        index.simple_sds_load(in);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "error: [load_gbwt_offset_index()] cannot load GBWT offset index " << filename << ": " << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+void save_gbwt_offset_index(const GBWTOffsetIndex& index, const std::string& filename, bool show_progress) {
+    if (show_progress) {
+        std::cerr << "Saving GBWT offset index to " << filename << std::endl;
+    }
+    sdsl::simple_sds::serialize_to(index, filename);
+}
+
 std::string compose_short_path_name(const gbwt::GBWT& gbwt_index, gbwt::size_type id) {
     if (!gbwt_index.hasMetadata() || !gbwt_index.metadata.hasPathNames() || id >= gbwt_index.metadata.paths()) {
         return "";
@@ -5,6 +5,7 @@
  * Utility classes and functions for working with GBWT.
  */
 
+#include <unordered_map>
 #include <vector>
 
 #include "position.hpp"
@@ -237,6 +238,122 @@ std::string insert_gbwt_path(MutablePathHandleGraph& graph, const gbwt::GBWT& gb
 /// NOTE: id is a gbwt path id, not a gbwt sequence id.
 Path extract_gbwt_path(const HandleGraph& graph, const gbwt::GBWT& gbwt_index, gbwt::size_type id);
 
+/// Extract a GBWT thread as a path with the given name in the given graph.
+/// NOTE: id is a gbwt path id, not a gbwt sequence id.
+Path extract_gbwt_path(const HandleGraph& graph, const gbwt::GBWT& gbwt_index, gbwt::size_type id, const std::string& path_name);
+
+/**
+ * Full path names for all paths in a GBWT index, composed once from the
+ * metadata, with a hash index from names back to path ids. Looking up many
+ * names this way avoids composing every name for every query.
+ */
+class GBWTPathNames {
+public:
+    /// Compose the names for all paths in the index using OpenMP threads.
+    /// The index will be empty if the GBWT has no path names.
+    explicit GBWTPathNames(const gbwt::GBWT& gbwt_index);
+
+    /// Number of paths.
+    size_t size() const { return this->names.size(); }
+
+    /// Returns the name of the path with the given id.
+    const std::string& name(gbwt::size_type id) const { return this->names[id]; }
+
+    /// Returns the id of the path with the given name, or `size()` if there is no such path.
+    gbwt::size_type find(const std::string& name) const;
+
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, gbwt::size_type> name_to_id;
+};
+
+/// Extract the given GBWT threads as paths in the given graph using OpenMP
+/// threads. The paths are named using the given names and returned in the
+/// same order as the ids.
+/// NOTE: ids are gbwt path ids, not gbwt sequence ids.
+std::vector<Path> extract_gbwt_paths(const HandleGraph& graph, const gbwt::GBWT& gbwt_index, const std::vector<gbwt::size_type>& ids, const GBWTPathNames& names);
+
+/**
+ * A sampled offset index for the paths in a GBWT index, which can be stored
+ * as a sidecar file. For each path in the forward orientation, it samples
+ * the GBWT position and the sequence offset of a node visit at least every
+ * `sample_interval` bp. Seeking to an offset is then a binary search and a
+ * walk of about `sample_interval` bp, instead of a walk from the start of the
+ * path. The graph used for node lengths must match the GBWT.
+ */
+class GBWTOffsetIndex {
+public:
+    /// Default distance between samples in bp.
+    constexpr static size_t DEFAULT_SAMPLE_INTERVAL = 1024;
+
+    /// Create an empty index.
+    GBWTOffsetIndex() = default;
+
+    /// Index all paths in the GBWT using OpenMP threads.
+    GBWTOffsetIndex(const gbwt::GBWT& gbwt_index, const HandleGraph& graph, size_t sample_interval = DEFAULT_SAMPLE_INTERVAL);
+
+    /// Number of indexed paths.
+    size_t paths() const { return this->path_lengths.size(); }
+
+    /// Distance between samples in bp.
+    size_t sample_interval() const { return this->header.sample_interval; }
+
+    /// Length of the path with the given id in bp.
+    size_t path_length(gbwt::size_type id) const { return this->path_lengths[id]; }
+
+    /// Returns the GBWT position of the node visit containing the given
+    /// offset on the path, and the offset of the start of that node visit.
+    /// Returns `gbwt::invalid_edge()` and the path length if the offset is
+    /// past the end of the path.
+    std::pair<gbwt::edge_type, size_t> seek(const gbwt::GBWT& gbwt_index, const HandleGraph& graph, gbwt::size_type id, size_t offset) const;
+
+    /// Returns the sequence of the path from `start` (inclusive) to `end`
+    /// (exclusive), truncated to the end of the path.
+    std::string substring(const gbwt::GBWT& gbwt_index, const HandleGraph& graph, gbwt::size_type id, size_t start, size_t end) const;
+
+    /// Serialize the index in simple-sds format.
+    void simple_sds_serialize(std::ostream& out) const;
+
+    /// Load an index serialized in simple-sds format. Throws
+    /// `sdsl::simple_sds::InvalidData` if the data is not valid.
+    void simple_sds_load(std::istream& in);
+
+    /// Size of the serialized index in elements.
+    size_t simple_sds_size() const;
+
+    /// Header of the serialized index.
+    struct Header {
+        constexpr static std::uint32_t MAGIC_NUMBER = 0x46464F47; // "GOFF"
+        constexpr static std::uint32_t VERSION = 1;
+
+        std::uint32_t magic_number = MAGIC_NUMBER;
+        std::uint32_t version = VERSION;
+        std::uint64_t sample_interval = DEFAULT_SAMPLE_INTERVAL;
+        std::uint64_t flags = 0;
+
+        /// Throws `sdsl::simple_sds::InvalidData` if the header is not valid.
+        void check() const;
+    };
+
+private:
+    Header header;
+
+    // Length of each path.
+    std::vector<size_t> path_lengths;
+
+    // Samples for path `i` are in the range from `sample_starts[i]` to `sample_starts[i + 1]`.
+    std::vector<size_t> sample_starts = { 0 };
+
+    // Offset of the sampled node visit and its GBWT position.
+    std::vector<std::pair<size_t, gbwt::edge_type>> samples;
+};
+
+/// Load a GBWT offset index from the file or exit with an error.
+void load_gbwt_offset_index(GBWTOffsetIndex& index, const std::string& filename, bool show_progress = false);
+
+/// Save a GBWT offset index to the file.
+void save_gbwt_offset_index(const GBWTOffsetIndex& index, const std::string& filename, bool show_progress = false);
+
 /// Get a short version of a string representation of a thread name stored in
 /// GBWT metadata, made of just the sample and contig and haplotype.
 /// NOTE: id is a gbwt path id, not a gbwt sequence id.
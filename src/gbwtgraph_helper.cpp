@@ -1,8 +1,22 @@
 #include "gbwtgraph_helper.hpp"
 #include "gbwt_helper.hpp"
+#include "readahead_stream.hpp"
 
 #include <vg/io/vpkg.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>
+
+#include <omp.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace vg {
 
 //------------------------------------------------------------------------------
@@ -60,6 +74,187 @@ gbwtgraph::GFAParsingParameters get_best_gbwtgraph_gfa_parsing_parameters() {
     return parameters;
 }
 
+GFAStatistics scan_gfa(const std::string& filename, size_t max_node_length, size_t threads) {
+    GFAStatistics result;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return result;
+    }
+    struct stat file_stats;
+    void* mapped = MAP_FAILED;
+    size_t file_size = 0;
+    if (fstat(fd, &file_stats) == 0 && S_ISREG(file_stats.st_mode) && file_stats.st_size > 0) {
+        file_size = file_stats.st_size;
+        mapped = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return result;
+    }
+    madvise(mapped, file_size, MADV_SEQUENTIAL);
+    const char* data = (const char*) mapped;
+    const char* file_end = data + file_size;
+
+    // Each chunk counts the lines that start in it.
+    threads = std::max(threads, size_t(1));
+    size_t chunk_count = std::min(threads * 4, std::max(file_size / (1024 * 1024), size_t(1)));
+    std::vector<GFAStatistics> by_chunk(chunk_count);
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(threads)
+    for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+        const char* chunk_end = data + file_size * (chunk + 1) / chunk_count;
+        const char* line = data + file_size * chunk / chunk_count;
+        if (line != data && line[-1] != '\n') {
+            // Skip the rest of a line that started in the previous chunk.
+            const char* newline = (const char*) memchr(line, '\n', file_end - line);
+            line = (newline == nullptr ? file_end : newline + 1);
+        }
+        GFAStatistics& counts = by_chunk[chunk];
+        while (line < chunk_end) {
+            const char* newline = (const char*) memchr(line, '\n', file_end - line);
+            const char* line_end = (newline == nullptr ? file_end : newline);
+            if (line_end - line >= 2 && line[1] == '\t') {
+                if (line[0] == 'S') {
+                    counts.segments++;
+                    // The sequence is the third field.
+                    const char* name_end = (const char*) memchr(line + 2, '\t', line_end - (line + 2));
+                    size_t length = 0;
+                    if (name_end != nullptr) {
+                        const char* sequence_end = (const char*) memchr(name_end + 1, '\t', line_end - (name_end + 1));
+                        length = (sequence_end == nullptr ? line_end : sequence_end) - (name_end + 1);
+                    }
+                    counts.nodes += (max_node_length == 0 || length <= max_node_length ? 1 : (length + max_node_length - 1) / max_node_length);
+                } else if (line[0] == 'P') {
+                    counts.paths++;
+                } else if (line[0] == 'W') {
+                    counts.walks++;
+                }
+            }
+            line = line_end + 1;
+        }
+    }
+    munmap(mapped, file_size);
+
+    for (auto& counts : by_chunk) {
+        result.segments += counts.segments;
+        result.nodes += counts.nodes;
+        result.paths += counts.paths;
+        result.walks += counts.walks;
+    }
+    return result;
+}
+
+size_t guess_parallel_gbwt_jobs(size_t node_count, size_t haplotype_count, size_t available_memory, size_t batch_size) {
+
+    // Memory usage of the GBWT construction itself.
+    size_t bytes_per_node = 135 * std::max(std::log10(haplotype_count + 1), 1.0);
+    // Construction buffers typically use 3-4 bytes per node, and the builder has two buffers.
+    size_t bytes_per_job = batch_size * 8;
+
+    size_t jobs = 1;
+    size_t max_jobs = omp_get_max_threads();
+    // We assume that the largest chromosome is 10% of the genome.
+    size_t job_size = std::max(node_count / 10, size_t(1));
+    size_t memory_usage = bytes_per_node * job_size + bytes_per_job;
+
+    while (jobs < max_jobs) {
+        // We assume that the next chromosome is 5% smaller than the previous one.
+        job_size = std::max(size_t(job_size * 0.95), size_t(1));
+        memory_usage += bytes_per_node * job_size + bytes_per_job;
+        if (memory_usage > available_memory) {
+            break;
+        }
+        jobs++;
+    }
+
+    return jobs;
+}
+
+size_t guess_parallel_gbwt_jobs(std::vector<size_t> component_node_counts, size_t haplotype_count, size_t available_memory, size_t batch_size) {
+
+    // The same estimates as above, but per actual component.
+    size_t bytes_per_node = 135 * std::max(std::log10(haplotype_count + 1), 1.0);
+    size_t bytes_per_job = batch_size * 8;
+
+    std::sort(component_node_counts.begin(), component_node_counts.end(), std::greater<size_t>());
+    size_t max_jobs = std::min(size_t(omp_get_max_threads()), std::max(component_node_counts.size(), size_t(1)));
+    size_t jobs = 1;
+    size_t memory_usage = (component_node_counts.empty() ? 0 : bytes_per_node * component_node_counts.front()) + bytes_per_job;
+    while (jobs < max_jobs) {
+        memory_usage += bytes_per_node * component_node_counts[jobs] + bytes_per_job;
+        if (memory_usage > available_memory) {
+            break;
+        }
+        jobs++;
+    }
+
+    return jobs;
+}
+
+/// A read-only stream buffer over a range of memory.
+class MemoryBuffer : public std::streambuf {
+public:
+    MemoryBuffer(const char* data, size_t length) {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + length);
+    }
+
+protected:
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override {
+        if (!(which & std::ios_base::in)) {
+            return pos_type(off_type(-1));
+        }
+        char* target = (direction == std::ios_base::beg ? eback() : (direction == std::ios_base::cur ? gptr() : egptr())) + offset;
+        if (target < eback() || target > egptr()) {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), target, egptr());
+        return pos_type(target - eback());
+    }
+
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override {
+        return seekoff(off_type(position), std::ios_base::beg, which);
+    }
+};
+
+void with_mapped_file(const std::string& filename, const std::function<void(std::istream&)>& callback) {
+    void* mapped = MAP_FAILED;
+    size_t file_size = 0;
+    if (filename != "-") {
+        int fd = open(filename.c_str(), O_RDONLY);
+        struct stat file_stats;
+        if (fd >= 0 && fstat(fd, &file_stats) == 0 && S_ISREG(file_stats.st_mode) && file_stats.st_size > 0) {
+            file_size = file_stats.st_size;
+            mapped = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    if (mapped == MAP_FAILED) {
+        // Let the normal path deal with standard input and report any problems.
+        if (filename == "-") {
+            callback(std::cin);
+        } else if (ReadaheadInputStream::can_read(filename)) {
+            ReadaheadInputStream in(filename);
+            callback(in);
+        } else {
+            std::ifstream in(filename, std::ios_base::binary);
+            callback(in);
+        }
+        return;
+    }
+
+    // We read it front to back, once, so start reading ahead right away.
+    madvise(mapped, file_size, MADV_SEQUENTIAL);
+    madvise(mapped, file_size, MADV_WILLNEED);
+    {
+        MemoryBuffer buffer((const char*) mapped, file_size);
+        std::istream in(&buffer);
+        callback(in);
+    }
+    munmap(mapped, file_size);
+}
+
 void load_gbwtgraph(gbwtgraph::GBWTGraph& graph, const std::string& filename, bool show_progress) {
     if (show_progress) {
         std::cerr << "Loading GBWTGraph from " << filename << std::endl;
@@ -76,7 +271,7 @@ void load_gbz(gbwtgraph::GBZ& gbz, const std::string& filename, bool show_progre
     if (show_progress) {
         std::cerr << "Loading GBZ from " << filename << std::endl;
     }
-    std::unique_ptr<gbwtgraph::GBZ> loaded = vg::io::VPKG::load_one<gbwtgraph::GBZ>(filename);
+    std::unique_ptr<gbwtgraph::GBZ> loaded = load_one_mapped<gbwtgraph::GBZ>(filename);
     if (loaded.get() == nullptr) {
         std::cerr << "error: [load_gbz()] cannot load GBZ " << filename << std::endl;
         std::exit(EXIT_FAILURE);
@@ -88,7 +283,7 @@ void load_gbz(gbwt::GBWT& index, gbwtgraph::GBWTGraph& graph, const std::string&
     if (show_progress) {
         std::cerr << "Loading GBWT and GBWTGraph from " << filename << std::endl;
     }
-    std::unique_ptr<gbwtgraph::GBZ> loaded = vg::io::VPKG::load_one<gbwtgraph::GBZ>(filename);
+    std::unique_ptr<gbwtgraph::GBZ> loaded = load_one_mapped<gbwtgraph::GBZ>(filename);
     if (loaded.get() == nullptr) {
         std::cerr << "error: [load_gbz()] cannot load GBZ " << filename << std::endl;
         std::exit(EXIT_FAILURE);
@@ -109,7 +304,7 @@ void load_minimizer(gbwtgraph::DefaultMinimizerIndex& index, const std::string&
     if (show_progress) {
         std::cerr << "Loading MinimizerIndex from " << filename << std::endl;
     }
-    std::unique_ptr<gbwtgraph::DefaultMinimizerIndex> loaded = vg::io::VPKG::load_one<gbwtgraph::DefaultMinimizerIndex>(filename);
+    std::unique_ptr<gbwtgraph::DefaultMinimizerIndex> loaded = load_one_mapped<gbwtgraph::DefaultMinimizerIndex>(filename);
     if (loaded.get() == nullptr) {
         std::cerr << "error: [load_minimizer()] cannot load MinimizerIndex " << filename << std::endl;
         std::exit(EXIT_FAILURE);
@@ -164,6 +359,106 @@ void save_minimizer(const gbwtgraph::DefaultMinimizerIndex& index, const std::st
 
 //------------------------------------------------------------------------------
 
+void index_haplotypes_partitioned(const gbwtgraph::GBWTGraph& graph, gbwtgraph::DefaultMinimizerIndex& index,
+                                  const std::function<gbwtgraph::Payload(const pos_t&)>& get_payload,
+                                  size_t partition_bits) {
+    typedef gbwtgraph::DefaultMinimizerIndex::minimizer_type minimizer_type;
+    typedef std::pair<minimizer_type, pos_t> occurrence_type;
+    constexpr size_t BUFFER_SIZE = 1024;
+
+    partition_bits = std::max(partition_bits, size_t(1));
+    partition_bits = std::min(partition_bits, size_t(16));
+    size_t partitions = size_t(1) << partition_bits;
+    int threads = omp_get_max_threads();
+
+    // Occurrences are buffered by thread and partition, and full buffers are
+    // moved into the partition.
+    std::vector<std::vector<occurrence_type>> partition_occs(partitions);
+    std::vector<std::mutex> partition_locks(partitions);
+    std::vector<std::vector<std::vector<occurrence_type>>> buffers(threads, std::vector<std::vector<occurrence_type>>(partitions));
+    auto flush_buffer = [&](int thread_id, size_t partition) {
+        std::vector<occurrence_type>& buffer = buffers[thread_id][partition];
+        std::lock_guard<std::mutex> lock(partition_locks[partition]);
+        partition_occs[partition].insert(partition_occs[partition].end(), buffer.begin(), buffer.end());
+        buffer.clear();
+    };
+
+    // Minimizer finding, as in gbwtgraph::index_haplotypes().
+    auto find_minimizers = [&](const std::vector<handle_t>& traversal, const std::string& seq) {
+        std::vector<minimizer_type> minimizers = index.minimizers(seq);
+        auto iter = traversal.begin();
+        size_t node_start = 0;
+        int thread_id = omp_get_thread_num();
+        for (minimizer_type& minimizer : minimizers) {
+            if (minimizer.empty()) {
+                continue;
+            }
+
+            // Find the node covering minimizer starting position.
+            size_t node_length = graph.get_length(*iter);
+            while (node_start + node_length <= minimizer.offset) {
+                node_start += node_length;
+                ++iter;
+                node_length = graph.get_length(*iter);
+            }
+            pos_t pos = make_pos_t(graph.get_id(*iter), graph.get_is_reverse(*iter), minimizer.offset - node_start);
+            if (minimizer.is_reverse) {
+                pos = reverse_base_pos(pos, node_length);
+            }
+            if (!gbwtgraph::Position::valid_offset(pos)) {
+                #pragma omp critical (cerr)
+                {
+                    std::cerr << "error: [index_haplotypes_partitioned()] Node " << id(pos) << ": Invalid offset " << offset(pos) << std::endl;
+                }
+                std::exit(EXIT_FAILURE);
+            }
+
+            size_t partition = minimizer.hash >> (64 - partition_bits);
+            buffers[thread_id][partition].emplace_back(minimizer, pos);
+            if (buffers[thread_id][partition].size() >= BUFFER_SIZE) {
+                flush_buffer(thread_id, partition);
+            }
+        }
+    };
+    gbwtgraph::for_each_haplotype_window(graph, index.window_bp(), find_minimizers, (threads > 1));
+
+    // Sort, deduplicate, and get the payloads for each partition independently.
+    std::vector<std::vector<gbwtgraph::Payload>> partition_payloads(partitions);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t partition = 0; partition < partitions; partition++) {
+        std::vector<occurrence_type>& occs = partition_occs[partition];
+        for (int thread_id = 0; thread_id < threads; thread_id++) {
+            std::vector<occurrence_type>& buffer = buffers[thread_id][partition];
+            occs.insert(occs.end(), buffer.begin(), buffer.end());
+            std::vector<occurrence_type>().swap(buffer);
+        }
+        std::sort(occs.begin(), occs.end(), [](const occurrence_type& a, const occurrence_type& b) {
+            return (a.first.key < b.first.key || (a.first.key == b.first.key && a.second < b.second));
+        });
+        occs.erase(std::unique(occs.begin(), occs.end(), [](const occurrence_type& a, const occurrence_type& b) {
+            return (a.first.key == b.first.key && a.second == b.second);
+        }), occs.end());
+        occs.shrink_to_fit();
+        partition_payloads[partition].reserve(occs.size());
+        for (const occurrence_type& occ : occs) {
+            partition_payloads[partition].push_back(get_payload(occ.second));
+        }
+    }
+
+    // The hash table itself can't take concurrent insertions, but by now
+    // only the unique occurrences are left.
+    for (size_t partition = 0; partition < partitions; partition++) {
+        std::vector<occurrence_type>& occs = partition_occs[partition];
+        for (size_t i = 0; i < occs.size(); i++) {
+            index.insert(occs[i].first, occs[i].second, partition_payloads[partition][i]);
+        }
+        std::vector<occurrence_type>().swap(occs);
+        std::vector<gbwtgraph::Payload>().swap(partition_payloads[partition]);
+    }
+}
+
+//------------------------------------------------------------------------------
+
 /// Return a mapping of the original segment ids to a list of chopped node ids
 /// (mimicking logic and interface from function of same name in gbwt_helper.cpp)
 unordered_map<string, vector<nid_t>> load_translation_map(const gbwtgraph::GBWTGraph& graph) {
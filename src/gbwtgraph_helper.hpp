@@ -9,8 +9,12 @@
 #include <gbwtgraph/gbz.h>
 #include <gbwtgraph/minimizer.h>
 #include "position.hpp"
+#include <vg/io/vpkg.hpp>
+#include <istream>
+#include <memory>
 #include <unordered_map>
 #include <vector>
+#include <functional>
 
 namespace vg {
 
@@ -22,6 +26,39 @@ namespace vg {
  */
 gbwtgraph::GFAParsingParameters get_best_gbwtgraph_gfa_parsing_parameters();
 
+/// Counts of the GFA lines that GBWT construction from a GFA file depends on.
+struct GFAStatistics {
+    size_t segments = 0;
+    /// Number of nodes after chopping the segments to the maximum node length.
+    size_t nodes = 0;
+    size_t paths = 0;
+    size_t walks = 0;
+};
+
+/**
+ * Scan a GFA file in parallel chunks with the given number of threads, and
+ * count its segments, paths, and walks. Segments are chopped to
+ * max_node_length for the node count, unless it is 0. Returns all 0s if the
+ * file cannot be mapped into memory.
+ */
+GFAStatistics scan_gfa(const std::string& filename, size_t max_node_length, size_t threads);
+
+/**
+ * Guess how many GBWT construction jobs for graph components we can run in
+ * parallel without using more than the available memory, given the total
+ * number of nodes and haplotypes. Never guesses more jobs than there are
+ * threads.
+ */
+size_t guess_parallel_gbwt_jobs(size_t node_count, size_t haplotype_count, size_t available_memory, size_t batch_size);
+
+/**
+ * Guess how many GBWT construction jobs we can run in parallel like above,
+ * but from the actual node counts of the graph components the jobs are made
+ * of. The biggest jobs are started first, so in the worst case those are the
+ * ones running at the same time.
+ */
+size_t guess_parallel_gbwt_jobs(std::vector<size_t> component_node_counts, size_t haplotype_count, size_t available_memory, size_t batch_size);
+
 /*
     These are the proper ways of saving and loading GBWTGraph structures.
     Loading with `vg::io::VPKG::load_one` is also supported.
@@ -43,6 +80,23 @@ void load_gbz(gbwt::GBWT& index, gbwtgraph::GBWTGraph& graph, const std::string&
 /// Load a minimizer index from the file.
 void load_minimizer(gbwtgraph::DefaultMinimizerIndex& index, const std::string& filename, bool show_progress = false);
 
+/// Call the function with a stream reading from a read-only memory mapping of
+/// the file, so that loading reads straight from the page cache with readahead
+/// instead of copying through a file buffer. Falls back to an ordinary file
+/// stream for "-" and for files that cannot be mapped.
+void with_mapped_file(const std::string& filename, const std::function<void(std::istream&)>& callback);
+
+/// Load an object with `vg::io::VPKG::load_one` from a memory mapping of the file.
+/// Returns null if the file does not contain the object.
+template<typename T>
+std::unique_ptr<T> load_one_mapped(const std::string& filename) {
+    std::unique_ptr<T> loaded;
+    with_mapped_file(filename, [&](std::istream& in) {
+        loaded = vg::io::VPKG::load_one<T>(in);
+    });
+    return loaded;
+}
+
 /// Save GBWTGraph to the file.
 void save_gbwtgraph(const gbwtgraph::GBWTGraph& graph, const std::string& filename, bool show_progress = false);
 
@@ -60,6 +114,24 @@ void save_minimizer(const gbwtgraph::DefaultMinimizerIndex& index, const std::st
 
 //------------------------------------------------------------------------------
 
+/**
+ * Index the haplotypes in the graph like gbwtgraph::index_haplotypes(), but
+ * without funneling every occurrence through one critical section. Threads
+ * buffer (minimizer, position) pairs in 2^partition_bits partitions by the
+ * top bits of the minimizer hash. Each partition is then sorted,
+ * deduplicated, and given payloads independently in parallel, and the
+ * unique occurrences are inserted into the index partition by partition.
+ *
+ * This scales with the number of threads much better than the default
+ * construction, at the cost of holding the occurrences in memory until the
+ * end. The payload function must be thread-safe.
+ */
+void index_haplotypes_partitioned(const gbwtgraph::GBWTGraph& graph, gbwtgraph::DefaultMinimizerIndex& index,
+                                  const std::function<gbwtgraph::Payload(const pos_t&)>& get_payload,
+                                  size_t partition_bits = 8);
+
+//------------------------------------------------------------------------------
+
 /// Return a mapping of the original segment ids to a list of chopped node ids
 std::unordered_map<std::string, std::vector<nid_t>> load_translation_map(const gbwtgraph::GBWTGraph& graph);
 
@@ -137,8 +137,15 @@ void Genotyper::run(AugmentedGraph& augmented_graph,
         vcf = start_vcf(cout, *reference_index, sample_name, contig_name, length_override);
     }
 
-    manager.for_each_snarl_parallel([&](const Snarl* snarl) {
-        // For each snarl in parallel
+    // Collect all the sites up front, so that nested ones are shared out
+    // between the threads as well, instead of going serially with their
+    // top-level site.
+    vector<const Snarl*> sites;
+    manager.for_each_snarl_preorder([&](const Snarl* snarl) {
+        sites.push_back(snarl);
+    });
+
+    auto genotype_site = [&](const Snarl* snarl) {
 
         if (snarl->type() != ULTRABUBBLE) {
             // We only work on ultrabubbles right now
@@ -305,7 +312,12 @@ void Genotyper::run(AugmentedGraph& augmented_graph,
                 vg::io::write_buffered(cout, buffer[tid], 100);
             }
         }
-    });
+    };
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < sites.size(); i++) {
+        genotype_site(sites[i]);
+    }
 
     if(!output_json && !output_vcf) {
         // Flush the protobuf output buffers
@@ -696,6 +708,24 @@ void Genotyper::allele_ambiguity_log_probs(const VG& graph,
 
 
 
+vector<const Alignment*> Genotyper::get_relevant_reads(const AugmentedGraph& aug,
+                                                      const pair<unordered_set<id_t>, unordered_set<edge_t> >& contents) {
+    vector<const Alignment*> reads;
+    for (id_t node_id : contents.first) {
+        // For every node in the ultrabubble, what reads visit it?
+        for (const Alignment* aln : aug.get_alignments(node_id)) {
+            reads.push_back(aln);
+        }
+    }
+    // Each read counts once, and we go through them by name so the output
+    // doesn't depend on where they are in memory.
+    sort(reads.begin(), reads.end(), [](const Alignment* a, const Alignment* b) {
+        return a->name() < b->name() || (a->name() == b->name() && a < b);
+    });
+    reads.erase(unique(reads.begin(), reads.end()), reads.end());
+    return reads;
+}
+
 map<const Alignment*, vector<Genotyper::Affinity>>
     Genotyper::get_affinities(AugmentedGraph& aug,
                               const map<string, const Alignment*>& reads_by_name,
@@ -715,7 +745,7 @@ map<const Alignment*, vector<Genotyper::Affinity>>
     map<const Alignment*, vector<Affinity>> to_return;
 
     // What reads are relevant to this ultrabubble?
-    set<string> relevant_read_names;
+    vector<const Alignment*> relevant_reads = get_relevant_reads(aug, contents);
 
     // What IDs are visited by these reads?
     unordered_set<id_t> relevant_ids;
@@ -725,18 +755,10 @@ map<const Alignment*, vector<Genotyper::Affinity>>
     cerr << "Snarl contains " << contents.first.size() << " nodes" << endl;
 #endif
 
-    for(id_t node_id : contents.first) {
-        // For every node in the ultrabubble, what reads visit it?
-        for (const Alignment* aln : aug.get_alignments(node_id)) {
-            // Each read that visits this node is relevant.
-            relevant_read_names.insert(aln->name());
-
-            for (size_t i = 0; i < aln->path().mapping_size(); ++i) {
-                relevant_ids.insert(aln->path().mapping(i).position().node_id());
-            }
+    for (const Alignment* aln : relevant_reads) {
+        for (size_t i = 0; i < aln->path().mapping_size(); ++i) {
+            relevant_ids.insert(aln->path().mapping(i).position().node_id());
         }
-        // TODO: We populate relevant_read_names and then get the alignments by
-        // name. Maybe we can just use alignment pointers?
     }
 
     for(id_t node_id : contents.first) {
@@ -747,9 +769,9 @@ map<const Alignment*, vector<Genotyper::Affinity>>
     // This is a temporary hack to break out of this function if there's too much to do. 
     // To fix properly will require a more general get_affinities_fast-type function, as well as,
     // probably, heuristics to reduce the search space
-    if (relevant_read_names.size() * snarl_paths.size() > 1000) {
+    if (relevant_reads.size() * snarl_paths.size() > 1000) {
 #pragma omp critical (cerr)
-        cerr << "Skipping snarl " << pb2json(*snarl) << " with " << relevant_read_names.size() << " reads, "
+        cerr << "Skipping snarl " << pb2json(*snarl) << " with " << relevant_reads.size() << " reads, "
              << snarl_paths.size() << " paths and " << contents.first.size()
              << " nodes as it is too complex to get affinities for (reads X paths > 1000)." << endl;
         return to_return;
@@ -757,9 +779,57 @@ map<const Alignment*, vector<Genotyper::Affinity>>
 
 #ifdef debug
 #pragma omp critical (cerr)
-    cerr << relevant_read_names.size() << " reads visit an additional " << relevant_ids.size() << " nodes" << endl;
+    cerr << relevant_reads.size() << " reads visit an additional " << relevant_ids.size() << " nodes" << endl;
 #endif
 
+    // We need a way to get graph node sizes to reverse alignments
+    auto get_node_size = [&](id_t id) {
+        return aug.graph.get_node(id)->sequence().size();
+    };
+
+    // Work out once, instead of for every allele, which reads are informative
+    // and what they look like on the other strand.
+    vector<const Alignment*> informative_reads;
+    vector<Alignment> reversed_reads;
+    for (const Alignment* read : relevant_reads) {
+        // Look to make sure it touches more than one node actually in the
+        // ultrabubble, or a non-start, non-end node. If it just touches the
+        // start or just touches the end, it can't be informative.
+        set<id_t> touched_set;
+        // Will this read be informative?
+        bool informative = false;
+        for(size_t i = 0; i < read->path().mapping_size(); i++) {
+            // Look at every node the read touches
+            id_t touched = read->path().mapping(i).position().node_id();
+            if(contents.first.count(touched)) {
+                // If it's in the ultrabubble, keep it
+                touched_set.insert(touched);
+            }
+        }
+
+        if(touched_set.size() >= 2) {
+            // We touch both the start and end, or an internal node.
+            informative = true;
+        } else {
+            // Throw out the start and end nodes, if we touched them.
+            touched_set.erase(snarl->start().node_id());
+            touched_set.erase(snarl->end().node_id());
+            if(!touched_set.empty()) {
+                // We touch an internal node
+                informative = true;
+            }
+        }
+
+        if(!informative) {
+            // We only touch one of the start and end nodes, and can say nothing about the ultrabubble.
+            // TODO: mark these as ambiguous/consistent with everything (but strand?)
+            continue;
+        }
+
+        informative_reads.push_back(read);
+        reversed_reads.push_back(reverse_complement_alignment(*read, get_node_size));
+    }
+
     // Make a vg graph with all the nodes used by the reads relevant to the
     // ultrabubble, but outside the ultrabubble itself.
     VG surrounding;
@@ -820,61 +890,22 @@ map<const Alignment*, vector<Genotyper::Affinity>>
         // read.
         auto path_seq = traversal_to_string(aug.graph, path);
 
-        for(auto& name : relevant_read_names) {
-            // For every read that touched the ultrabubble, grab its original
-            // Alignment pointer.
-            const Alignment* read = reads_by_name.at(name);
-
-            // Look to make sure it touches more than one node actually in the
-            // ultrabubble, or a non-start, non-end node. If it just touches the
-            // start or just touches the end, it can't be informative.
-            set<id_t> touched_set;
-            // Will this read be informative?
-            bool informative = false;            
-            for(size_t i = 0; i < read->path().mapping_size(); i++) {
-                // Look at every node the read touches
-                id_t touched = read->path().mapping(i).position().node_id();
-                if(contents.first.count(touched)) {
-                    // If it's in the ultrabubble, keep it
-                    touched_set.insert(touched);
-                }
-            }
+        for (size_t r = 0; r < informative_reads.size(); r++) {
+            // For every read that is informative as to the internal status of
+            // this ultrabubble, realign it to the allele.
+            const Alignment* read = informative_reads[r];
 
-            if(touched_set.size() >= 2) {
-                // We touch both the start and end, or an internal node.
-                informative = true;
-            } else {
-                // Throw out the start and end nodes, if we touched them.
-                touched_set.erase(snarl->start().node_id());
-                touched_set.erase(snarl->end().node_id());
-                if(!touched_set.empty()) {
-                    // We touch an internal node
-                    informative = true;
-                }
-            }
-
-            if(!informative) {
-                // We only touch one of the start and end nodes, and can say nothing about the ultrabubble. Try the next read.
-                // TODO: mark these as ambiguous/consistent with everything (but strand?)
-                continue;
-            }
-
-            // If we get here, we know this read is informative as to the internal status of this ultrabubble.
             Alignment aligned_fwd;
             Alignment aligned_rev;
-            // We need a way to get graph node sizes to reverse these alignments
-            auto get_node_size = [&](id_t id) {
-                return aug.graph.get_node(id)->sequence().size();
-            };
 
             if(read->sequence().size() == read->quality().size()) {
                 // Re-align a copy to this graph (using quality-adjusted alignment).
                 aligned_fwd = allele_graph.align_qual_adjusted(*read, &qa_aligner, mems);
-                aligned_rev = allele_graph.align_qual_adjusted(reverse_complement_alignment(*read, get_node_size), &qa_aligner, mems);
+                aligned_rev = allele_graph.align_qual_adjusted(reversed_reads[r], &qa_aligner, mems);
             } else {
                 // If we don't have the right number of quality scores, use un-adjusted alignment instead.
                 aligned_fwd = allele_graph.align(*read, &aligner, mems);
-                aligned_rev = allele_graph.align(reverse_complement_alignment(*read, get_node_size), &aligner, mems);
+                aligned_rev = allele_graph.align(reversed_reads[r], &aligner, mems);
             }
             // Pick the best alignment, and emit in original orientation
             Alignment aligned = (aligned_rev.score() > aligned_fwd.score()) ? reverse_complement_alignment(aligned_rev, get_node_size) : aligned_fwd;
@@ -969,16 +1000,13 @@ map<const Alignment*, vector<Genotyper::Affinity>>
         }
     }
 
-    for(auto& name : relevant_read_names) {
+    for (const Alignment* read : relevant_reads) {
         // For every read that touched the ultrabubble, mark it consistent only
         // with its best-score alleles that don't mismatch in the allele.
 
         // So basically make everything that isn't normalized affinity 1.0
         // inconsistent if it wasn't already.
 
-        // Grab its original Alignment pointer.
-        const Alignment* read = reads_by_name.at(name);
-
         // Which is the best affinity we can get while being consistent?
         double best_consistent_affinity = 0;
         // And which is the best affinity we can get overall?
@@ -1030,9 +1058,6 @@ Genotyper::get_affinities_fast(AugmentedGraph& aug,
     // We're going to build this up gradually, appending to all the vectors.
     map<const Alignment*, vector<Affinity>> to_return;
 
-    // What reads are relevant to this ultrabubble?
-    set<string> relevant_read_names;
-
 #ifdef debug
 #pragma omp critical (cerr)
     cerr << "Ultrabubble contains " << contents.first.size() << " nodes" << endl;
@@ -1045,17 +1070,7 @@ Genotyper::get_affinities_fast(AugmentedGraph& aug,
         allele_strings.push_back(traversal_to_string(aug.graph, path));
     }
 
-    for(id_t node_id : contents.first) {
-        // For every node in the ultrabubble, what reads visit it?
-        for (const Alignment* aln : aug.get_alignments(node_id)) {
-            // Each read that visits this node is relevant.
-            relevant_read_names.insert(aln->name());
-        }
-        // TODO: We populate relevant_read_names and then get the alignments by
-        // name. Maybe we can just use alignment pointers?
-    }
-
-    for(auto name : relevant_read_names) {
+    for (const Alignment* read : get_relevant_reads(aug, contents)) {
         // For each relevant read, work out a string for the ultrabubble and whether
         // it's anchored on each end.
 
@@ -1063,7 +1078,7 @@ Genotyper::get_affinities_fast(AugmentedGraph& aug,
         Affinity base_affinity;
 
         // Get the NodeTraversals for this read through this snarl.
-        auto read_traversal = get_traversal_of_snarl(aug.graph, snarl, manager, reads_by_name.at(name)->path());
+        auto read_traversal = get_traversal_of_snarl(aug.graph, snarl, manager, read->path());
 
         if(read_traversal.visit(0) == reverse(snarl->end()) ||
            read_traversal.visit(read_traversal.visit_size() - 1) == reverse(snarl->start())) {
@@ -1102,7 +1117,7 @@ Genotyper::get_affinities_fast(AugmentedGraph& aug,
 
 #ifdef debug
 #pragma omp critical (cerr)
-        cerr << "Consistency of " << reads_by_name.at(name)->sequence() << endl;
+        cerr << "Consistency of " << read->sequence() << endl;
 #endif
 
         // Now decide if the read's seq supports each path.
@@ -1142,7 +1157,7 @@ Genotyper::get_affinities_fast(AugmentedGraph& aug,
 
             // Fake a weight
             affinity.affinity = (double)affinity.consistent;
-            to_return[reads_by_name.at(name)].push_back(affinity);
+            to_return[read].push_back(affinity);
 
             // Add in to the total if it supports this
             total_supported += affinity.consistent;
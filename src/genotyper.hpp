@@ -219,6 +219,13 @@ public:
      */
     string get_qualities_in_snarl(VG& graph, const Snarl* snarl, const Alignment& alignment);
     
+    /**
+     * Get each of the embedded reads that visit a node of the snarl once, in
+     * name order.
+     */
+    static vector<const Alignment*> get_relevant_reads(const AugmentedGraph& aug,
+                                                       const pair<unordered_set<id_t>, unordered_set<edge_t> >& contents);
+
     /**
      * Get the affinity of all the reads relevant to the superbubble to all the
      * paths through the superbubble.
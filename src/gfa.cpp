@@ -9,12 +9,31 @@ namespace vg {
 
 using namespace std;
 
+/// How many records to collect before formatting them in parallel.
+static const size_t GFA_WRITE_BATCH_SIZE = 1 << 20;
+
+/// Format the lines for a batch of items in parallel, in per-thread buffers,
+/// and then write them to the stream in the order of the items.
+template<typename Item, typename Format>
+static void write_in_parallel(ostream& out, const vector<Item>& items, const Format& format);
+
 /// Determine if a path should be written as a GFA W line or a GFA P line.
 static bool should_write_as_w_line(const PathHandleGraph* graph, path_handle_t path_handle);
-/// Write out a W line for a path. Uses a map to keep track of fake offset
-/// ranges used to distinguish multiple phase blocks on a haplotype, since GFA
-/// doesn't support them.
-static void write_w_line(const PathHandleGraph* graph, ostream& out, path_handle_t path_handle, unordered_map<tuple<string, int64_t, string>, size_t>& last_phase_block_end);
+/// Get the sample, haplotype, and contig that a W line for a path will use.
+static tuple<string, int64_t, string> w_line_key(const PathHandleGraph* graph, path_handle_t path_handle);
+/// Work out the start offset of the W line for a path. Uses a map to keep
+/// track of fake offset ranges used to distinguish multiple phase blocks on a
+/// haplotype, since GFA doesn't support them, so the paths must be visited in
+/// the order they will be written.
+static size_t w_line_start_offset(const PathHandleGraph* graph, path_handle_t path_handle, size_t path_length,
+                                  unordered_map<tuple<string, int64_t, string>, size_t>& last_phase_block_end);
+/// Append the S, P, W, and L lines to a buffer.
+static void format_s_line(const PathHandleGraph* graph, string& buffer, const handle_t& handle,
+                          const unordered_map<nid_t, pair<path_handle_t, size_t>>& node_offsets);
+static void format_p_line(const PathHandleGraph* graph, string& buffer, path_handle_t path_handle);
+static void format_w_line(const PathHandleGraph* graph, string& buffer, path_handle_t path_handle,
+                          size_t start_offset, size_t path_length);
+static void format_l_line(const PathHandleGraph* graph, string& buffer, const edge_t& edge);
 
 void graph_to_gfa(const PathHandleGraph* graph, ostream& out, const set<string>& rgfa_paths,
                   bool rgfa_pline, bool use_w_lines) {
@@ -64,22 +83,22 @@ void graph_to_gfa(const PathHandleGraph* graph, ostream& out, const set<string>&
             });
     }
   
-    //Go through each node in the graph
+    //Go through each node in the graph, formatting batches of them in parallel
+    vector<handle_t> handle_batch;
+    auto write_handle_batch = [&]() {
+        write_in_parallel(out, handle_batch, [&](const handle_t& h, string& buffer) {
+            format_s_line(graph, buffer, h, node_offsets);
+        });
+        handle_batch.clear();
+    };
     graph->for_each_handle([&](const handle_t& h) {
-        out << "S\t";
-        nid_t node_id = graph->get_id(h);
-        out << node_id << "\t";
-        out << graph->get_sequence(h);
-        auto it = node_offsets.find(node_id);
-        if (it != node_offsets.end()) {
-            // add rGFA tags
-            out << "\t" << "SN:Z:" << graph->get_path_name(it->second.first)
-                << "\t" << "SO:i:" << it->second.second
-                << "\t" << "SR:i:0"; // todo: support non-zero ranks?
+        handle_batch.push_back(h);
+        if (handle_batch.size() == GFA_WRITE_BATCH_SIZE) {
+            write_handle_batch();
         }
-        out << "\n"; // Writing `std::endl` would flush the buffer.
         return true;
     });
+    write_handle_batch();
     
     // Sort the paths by name, making sure to treat subpath coordinates numerically
     vector<path_handle_t> path_handles;
@@ -101,9 +120,9 @@ void graph_to_gfa(const PathHandleGraph* graph, ostream& out, const set<string>&
             return false;
         });
 
+    vector<path_handle_t> p_line_paths;
     vector<path_handle_t> w_line_paths;
 
-    // Paths as P-lines
     for (const path_handle_t& h : path_handles) {
         auto path_name = graph->get_path_name(h);
         if (rgfa_pline || !rgfa_paths.count(path_name)) {
@@ -116,60 +135,154 @@ void graph_to_gfa(const PathHandleGraph* graph, ostream& out, const set<string>&
             if (use_w_lines && should_write_as_w_line(graph, h)) {
                 w_line_paths.push_back(h);
             } else {
-                out << "P\t";
-                out << path_name << "\t";
-                
-                bool first = true;
-                graph->for_each_step_in_path(h, [&](const step_handle_t& ph) {
-                    handle_t step_handle = graph->get_handle_of_step(ph);
-                    
-                    if (!first) {
-                        out << ',';
-                    }
-                    out << graph->get_id(step_handle);
-                    out << (graph->get_is_reverse(step_handle) ? '-' : '+');
-                    first = false;
-                    return true;
-                });
-                
-                out << "\t*" << "\n";
+                p_line_paths.push_back(h);
             }
         }
     }
     
+    // Paths can be long, so only a few per thread are buffered at a time
+    size_t path_batch_size = get_thread_count() * 4;
+    
+    // Paths as P-lines
+    for (size_t i = 0; i < p_line_paths.size(); i += path_batch_size) {
+        vector<path_handle_t> path_batch(p_line_paths.begin() + i,
+                                         p_line_paths.begin() + std::min(i + path_batch_size, p_line_paths.size()));
+        write_in_parallel(out, path_batch, [&](const path_handle_t& h, string& buffer) {
+            format_p_line(graph, buffer, h);
+        });
+    }
+    
     // Paths as W-lines
     {
+        // The offsets depend on the paths before, so only the lengths can be
+        // found in parallel.
+        vector<pair<size_t, size_t>> w_line_ranges(w_line_paths.size());
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < w_line_paths.size(); ++i) {
+            // TODO: sniff if the graph has this cached somehow?
+            graph->for_each_step_in_path(w_line_paths[i], [&](step_handle_t step_handle) {
+                w_line_ranges[i].second += graph->get_length(graph->get_handle_of_step(step_handle));
+            });
+        }
         unordered_map<tuple<string, int64_t, string>, size_t> last_phase_block_end;
-        for (const path_handle_t& h : w_line_paths) {
-            write_w_line(graph, out, h, last_phase_block_end);
+        for (size_t i = 0; i < w_line_paths.size(); ++i) {
+            w_line_ranges[i].first = w_line_start_offset(graph, w_line_paths[i], w_line_ranges[i].second, last_phase_block_end);
+        }
+        for (size_t i = 0; i < w_line_paths.size(); i += path_batch_size) {
+            vector<size_t> path_batch;
+            for (size_t j = i; j < w_line_paths.size() && j < i + path_batch_size; ++j) {
+                path_batch.push_back(j);
+            }
+            write_in_parallel(out, path_batch, [&](const size_t& j, string& buffer) {
+                format_w_line(graph, buffer, w_line_paths[j], w_line_ranges[j].first, w_line_ranges[j].second);
+            });
         }
     }
 
-    graph->for_each_edge([&](const edge_t& h) {
-        
-        nid_t from_id = graph->get_id(h.first);
-        bool from_is_reverse = graph->get_is_reverse(h.first);
-        nid_t to_id = graph->get_id(h.second);
-        bool to_is_reverse = graph->get_is_reverse(h.second);
-    
-        if (from_is_reverse && (to_is_reverse || to_id < from_id)) {
-            // Canonicalize edges to be + orientation first if possible, and
-            // then low-ID to high-ID if possible, for testability. This edge
-            // needs to flip.
-            
-            // Swap the nodes
-            std::swap(from_id, to_id);
-            // Swap the orientations
-            std::swap(from_is_reverse, to_is_reverse);
-            // Reverse the orientations
-            from_is_reverse = !from_is_reverse;
-            to_is_reverse = !to_is_reverse;
+    vector<edge_t> edge_batch;
+    auto write_edge_batch = [&]() {
+        write_in_parallel(out, edge_batch, [&](const edge_t& e, string& buffer) {
+            format_l_line(graph, buffer, e);
+        });
+        edge_batch.clear();
+    };
+    graph->for_each_edge([&](const edge_t& e) {
+        edge_batch.push_back(e);
+        if (edge_batch.size() == GFA_WRITE_BATCH_SIZE) {
+            write_edge_batch();
         }
-        
-        out << "L\t" << from_id << "\t" << (from_is_reverse ? '-' : '+')
-            << "\t" << to_id << "\t" << (to_is_reverse ? '-' : '+') << "\t0M\n"; // Writing `std::endl` would flush the buffer.
         return true;
     }, false);
+    write_edge_batch();
+}
+
+template<typename Item, typename Format>
+void write_in_parallel(ostream& out, const vector<Item>& items, const Format& format) {
+    if (items.empty()) {
+        return;
+    }
+    // A few chunks per thread, so uneven lines even out
+    size_t chunk_count = std::min(items.size(), (size_t) get_thread_count() * 4);
+    vector<string> buffers(chunk_count);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < chunk_count; ++i) {
+        size_t begin = items.size() * i / chunk_count;
+        size_t end = items.size() * (i + 1) / chunk_count;
+        for (size_t j = begin; j < end; ++j) {
+            format(items[j], buffers[i]);
+        }
+    }
+    for (const string& buffer : buffers) {
+        out.write(buffer.data(), buffer.size());
+    }
+}
+
+void format_s_line(const PathHandleGraph* graph, string& buffer, const handle_t& handle,
+                   const unordered_map<nid_t, pair<path_handle_t, size_t>>& node_offsets) {
+    nid_t node_id = graph->get_id(handle);
+    buffer += "S\t";
+    buffer += std::to_string(node_id);
+    buffer += '\t';
+    buffer += graph->get_sequence(handle);
+    auto it = node_offsets.find(node_id);
+    if (it != node_offsets.end()) {
+        // add rGFA tags
+        buffer += "\tSN:Z:";
+        buffer += graph->get_path_name(it->second.first);
+        buffer += "\tSO:i:";
+        buffer += std::to_string(it->second.second);
+        buffer += "\tSR:i:0"; // todo: support non-zero ranks?
+    }
+    buffer += '\n';
+}
+
+void format_p_line(const PathHandleGraph* graph, string& buffer, path_handle_t path_handle) {
+    buffer += "P\t";
+    buffer += graph->get_path_name(path_handle);
+    buffer += '\t';
+    
+    bool first = true;
+    graph->for_each_step_in_path(path_handle, [&](const step_handle_t& ph) {
+        handle_t step_handle = graph->get_handle_of_step(ph);
+        
+        if (!first) {
+            buffer += ',';
+        }
+        buffer += std::to_string(graph->get_id(step_handle));
+        buffer += (graph->get_is_reverse(step_handle) ? '-' : '+');
+        first = false;
+        return true;
+    });
+    
+    buffer += "\t*\n";
+}
+
+void format_l_line(const PathHandleGraph* graph, string& buffer, const edge_t& edge) {
+        
+    nid_t from_id = graph->get_id(edge.first);
+    bool from_is_reverse = graph->get_is_reverse(edge.first);
+    nid_t to_id = graph->get_id(edge.second);
+    bool to_is_reverse = graph->get_is_reverse(edge.second);
+
+    if (from_is_reverse && (to_is_reverse || to_id < from_id)) {
+        // Canonicalize edges to be + orientation first if possible, and
+        // then low-ID to high-ID if possible, for testability. This edge
+        // needs to flip.
+        
+        // Swap the nodes
+        std::swap(from_id, to_id);
+        // Swap the orientations
+        std::swap(from_is_reverse, to_is_reverse);
+        // Reverse the orientations
+        from_is_reverse = !from_is_reverse;
+        to_is_reverse = !to_is_reverse;
+    }
+    
+    buffer += "L\t";
+    buffer += std::to_string(from_id);
+    buffer += (from_is_reverse ? "\t-\t" : "\t+\t");
+    buffer += std::to_string(to_id);
+    buffer += (to_is_reverse ? "\t-\t0M\n" : "\t+\t0M\n");
 }
 
 bool should_write_as_w_line(const PathHandleGraph* graph, path_handle_t path_handle) {
@@ -178,21 +291,11 @@ bool should_write_as_w_line(const PathHandleGraph* graph, path_handle_t path_han
     return graph->get_sense(path_handle) != PathSense::GENERIC;
 }
 
-void write_w_line(const PathHandleGraph* graph, ostream& out, path_handle_t path_handle, unordered_map<tuple<string, int64_t, string>, size_t>& last_phase_block_end) {
+tuple<string, int64_t, string> w_line_key(const PathHandleGraph* graph, path_handle_t path_handle) {
     // Extract the path metadata
     string sample = graph->get_sample_name(path_handle);
     string contig = graph->get_locus_name(path_handle);
     int64_t hap_index = graph->get_haplotype(path_handle);
-    int64_t phase_block = graph->get_phase_block(path_handle);
-    auto subrange = graph->get_subrange(path_handle);
-    size_t start_offset = 0;
-    size_t end_offset = 0;
-    if (subrange != PathMetadata::NO_SUBRANGE) {
-        start_offset = subrange.first;
-        if (subrange.second != PathMetadata::NO_END_POSITION) {
-            end_offset = subrange.second;
-        }
-    }
     
     if (sample == PathMetadata::NO_SAMPLE_NAME) {
         // Represent an elided sample name with "*";
@@ -207,13 +310,21 @@ void write_w_line(const PathHandleGraph* graph, ostream& out, path_handle_t path
         // TODO: check for collisions somehow?
         hap_index = 0;
     }
-     
-    // Get the path length.
-    // TODO: sniff if the graph has this cached somehow?
-    size_t path_length = 0 ;
-    graph->for_each_step_in_path(path_handle, [&](step_handle_t step_handle) {
-            path_length += graph->get_length(graph->get_handle_of_step(step_handle));
-        });
+    
+    return std::tuple<string, int64_t, string>(sample, hap_index, contig);
+}
+
+size_t w_line_start_offset(const PathHandleGraph* graph, path_handle_t path_handle, size_t path_length,
+                           unordered_map<tuple<string, int64_t, string>, size_t>& last_phase_block_end) {
+    auto subrange = graph->get_subrange(path_handle);
+    size_t start_offset = 0;
+    size_t end_offset = 0;
+    if (subrange != PathMetadata::NO_SUBRANGE) {
+        start_offset = subrange.first;
+        if (subrange.second != PathMetadata::NO_END_POSITION) {
+            end_offset = subrange.second;
+        }
+    }
 
     if (end_offset != 0 && start_offset + path_length != end_offset) {
         cerr << "[gfa] warning: incorrect end offset (" << end_offset << ") extracted from from path name " << graph->get_path_name(path_handle)
@@ -221,8 +332,7 @@ void write_w_line(const PathHandleGraph* graph, ostream& out, path_handle_t path
     }
     
     // See if we need to bump along the start offset to avoid collisions of phase blocks
-    auto key = std::tuple<string, int64_t, string>(sample, hap_index, contig);
-    auto& phase_block_end_cursor = last_phase_block_end[key];
+    auto& phase_block_end_cursor = last_phase_block_end[w_line_key(graph, path_handle)];
     if (phase_block_end_cursor != 0) {
         if (start_offset != 0) {
             // TODO: Work out a way to support phase blocks and subranges at the same time.
@@ -238,13 +348,31 @@ void write_w_line(const PathHandleGraph* graph, ostream& out, path_handle_t path
         phase_block_end_cursor += path_length;
     }
 
-    out << "W\t" << sample << "\t" << hap_index << "\t" << contig << "\t" << start_offset << "\t" << (start_offset + path_length) << "\t";
+    return start_offset;
+}
+
+void format_w_line(const PathHandleGraph* graph, string& buffer, path_handle_t path_handle,
+                   size_t start_offset, size_t path_length) {
+    auto key = w_line_key(graph, path_handle);
+
+    buffer += "W\t";
+    buffer += std::get<0>(key);
+    buffer += '\t';
+    buffer += std::to_string(std::get<1>(key));
+    buffer += '\t';
+    buffer += std::get<2>(key);
+    buffer += '\t';
+    buffer += std::to_string(start_offset);
+    buffer += '\t';
+    buffer += std::to_string(start_offset + path_length);
+    buffer += '\t';
 
     graph->for_each_step_in_path(path_handle, [&](step_handle_t step_handle) {
             handle_t handle = graph->get_handle_of_step(step_handle);
-            out << (graph->get_is_reverse(handle) ? "<" : ">") << graph->get_id(handle);
+            buffer += (graph->get_is_reverse(handle) ? '<' : '>');
+            buffer += std::to_string(graph->get_id(handle));
         });
-    out << "\n";
+    buffer += '\n';
 }
 
 }
@@ -21,6 +21,7 @@ using namespace std;
 /// Express paths mentioned in rgfa_paths as rGFA.
 /// If rgfa_pline is set, also express them as dedicated lines.
 /// If use_w_lines is set, reference and haplotype paths will use W lines instead of P lines.
+/// Lines are formatted in parallel, but written in a deterministic order.
 void graph_to_gfa(const PathHandleGraph* graph, ostream& out,
                   const set<string>& rgfa_paths = {},
                   bool rgfa_pline = false,
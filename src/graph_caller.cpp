@@ -1,4 +1,5 @@
 #include "graph_caller.hpp"
+#include <condition_variable>
 #include "algorithms/expand_context.hpp"
 #include "annotation.hpp"
 
@@ -59,6 +60,50 @@ void GraphCaller::call_top_level_snarls(const HandleGraph& graph, RecurseType re
   
 }
 
+void GraphCaller::call_snarls_in_order(const HandleGraph& graph, const vector<const Snarl*>& snarl_order,
+                                       const function<void(size_t)>& on_prefix_done,
+                                       RecurseType recurse_type, size_t max_in_flight) {
+
+    // Run the snarl caller on a snarl, and recurse into the children right away if it fails
+    function<void(const Snarl*)> process_snarl = [&](const Snarl* snarl) {
+        if (!snarl_manager.is_trivial(snarl, graph)) {
+            bool was_called = call_snarl(*snarl);
+            if (recurse_type == RecurseAlways || (!was_called && recurse_type == RecurseOnFail)) {
+                for (const Snarl* child : snarl_manager.children_of(snarl)) {
+                    process_snarl(child);
+                }
+            }
+        }
+    };
+
+    // which snarls are done, and how far the done prefix goes
+    vector<bool> done(snarl_order.size(), false);
+    size_t prefix = 0;
+    std::mutex progress_lock;
+    std::condition_variable progress_made;
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < snarl_order.size(); ++i) {
+        {
+            // the snarl at the prefix has already been handed out, so this can't deadlock
+            std::unique_lock<std::mutex> guard(progress_lock);
+            progress_made.wait(guard, [&]() { return i < prefix + max_in_flight; });
+        }
+        
+        process_snarl(snarl_order[i]);
+
+        std::lock_guard<std::mutex> guard(progress_lock);
+        done[i] = true;
+        if (i == prefix) {
+            while (prefix < done.size() && done[prefix]) {
+                ++prefix;
+            }
+            on_prefix_done(prefix);
+            progress_made.notify_all();
+        }
+    }
+}
+
 static void flip_snarl(Snarl& snarl) {
     Visit v = snarl.start();
     *snarl.mutable_start() = reverse(snarl.end());
@@ -179,6 +224,7 @@ vector<Chain> GraphCaller::break_chain(const HandleGraph& graph, const Chain& ch
 VCFOutputCaller::VCFOutputCaller(const string& sample_name) : sample_name(sample_name), translation(nullptr), include_nested(false)
 {
     output_variants.resize(get_thread_count());
+    output_variant_locks.reset(new std::mutex[output_variants.size()]);
 }
 
 VCFOutputCaller::~VCFOutputCaller() {
@@ -214,11 +260,17 @@ void VCFOutputCaller::add_variant(vcflib::Variant& var) const {
     var.setVariantCallFile(output_vcf);
     stringstream ss;
     ss << var;
+    add_variant_record(ss.str(), var.sequenceName, var.position);
+}
+
+void VCFOutputCaller::add_variant_record(const string& record, const string& contig, size_t position) const {
     string dest;
-    zstdutil::CompressString(ss.str(), dest);
+    zstdutil::CompressString(record, dest);
     // the Variant object is too big to keep in memory when there are many genotypes, so we
     // store it in a zstd-compressed string
-    output_variants[omp_get_thread_num()].push_back(make_pair(make_pair(var.sequenceName, var.position), dest));
+    size_t thread_num = omp_get_thread_num();
+    std::lock_guard<std::mutex> guard(output_variant_locks[thread_num]);
+    output_variants[thread_num].push_back(make_pair(make_pair(contig, position), dest));
 }
 
 void VCFOutputCaller::write_variants(ostream& out_stream, const SnarlManager* snarl_manager) {
@@ -242,6 +294,30 @@ void VCFOutputCaller::write_variants(ostream& out_stream, const SnarlManager* sn
     }
 }
 
+void VCFOutputCaller::write_variants_before(ostream& out_stream, const pair<string, size_t>& bound) {
+    assert(include_nested == false);
+    vector<pair<pair<string, size_t>, string>> ready_variants;
+    for (size_t i = 0; i < output_variants.size(); ++i) {
+        std::lock_guard<std::mutex> guard(output_variant_locks[i]);
+        auto& buf = output_variants[i];
+        // move the ready variants to the end and take them from there
+        auto ready = std::stable_partition(buf.begin(), buf.end(), [&](const pair<pair<string, size_t>, string>& v) {
+                return !(v.first < bound);
+            });
+        std::move(ready, buf.end(), std::back_inserter(ready_variants));
+        buf.erase(ready, buf.end());
+    }
+    std::sort(ready_variants.begin(), ready_variants.end(), [](const pair<pair<string, size_t>, string>& v1,
+                                                               const pair<pair<string, size_t>, string>& v2) {
+            return v1.first < v2.first;
+        });
+    for (auto& v : ready_variants) {
+        string dest;
+        zstdutil::DecompressString(v.second, dest);
+        out_stream << dest << endl;
+    }
+}
+
 static int countAlts(vcflib::Variant& var, int alleleIndex) {
     int alts = 0;
     for (map<string, map<string, vector<string> > >::iterator s = var.samples.begin(); s != var.samples.end(); ++s) {
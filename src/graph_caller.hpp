@@ -8,6 +8,7 @@
 #include <limits>
 #include <unordered_set>
 #include <tuple>
+#include <mutex>
 #include "handle.hpp"
 #include "snarls.hpp"
 #include "traversal_finder.hpp"
@@ -40,6 +41,17 @@ public:
     /// Snarls are processed in parallel
     virtual void call_top_level_snarls(const HandleGraph& graph, RecurseType recurse_type = RecurseOnFail);
 
+    /// Run call_snarl() on each of the given snarls, and their children as in
+    /// call_top_level_snarls(), in parallel but starting them in the given
+    /// order. A snarl's children are called in the same task, before it counts
+    /// as done. Whenever the first k snarls are all done, on_prefix_done(k) is
+    /// called (by one thread at a time) so that output up to there can be
+    /// released. No snarl more than max_in_flight past the first unfinished one
+    /// is started, which bounds how much output can be held up.
+    virtual void call_snarls_in_order(const HandleGraph& graph, const vector<const Snarl*>& snarl_order,
+                                      const function<void(size_t)>& on_prefix_done,
+                                      RecurseType recurse_type = RecurseOnFail, size_t max_in_flight = 4096);
+
     /// For every chain, cut it up into pieces using max_edges and max_trivial to cap the size of each piece
     /// then make a fake snarl for each chain piece and call it.  If a fake snarl fails to call,
     /// It's child chains will be recursed on (if selected)_
@@ -81,10 +93,19 @@ public:
     /// Add a variant to our buffer
     void add_variant(vcflib::Variant& var) const;
 
+    /// Add an already formatted VCF record (without a newline) to our buffer
+    void add_variant_record(const string& record, const string& contig, size_t position) const;
+
     /// Sort then write variants in the buffer
     /// snarl_manager needed if include_nested is true
     void write_variants(ostream& out_stream, const SnarlManager* snarl_manager = nullptr);
 
+    /// Sort then write the buffered variants that sort before the given
+    /// (contig, position), and remove them from the buffer. Safe to call while
+    /// variants are being added, so output can be streamed. Can't be used
+    /// with nested output, which needs all the variants to fill in its tags.
+    void write_variants_before(ostream& out_stream, const pair<string, size_t>& bound);
+
     /// Run vcffixup from vcflib
     void vcf_fixup(vcflib::Variant& var) const;
 
@@ -145,6 +166,8 @@ protected:
     /// output buffers (1/thread) (for sorting)
     /// variants stored as strings (and position key pairs) because vcflib::Variant in-memory struct so huge
     mutable vector<vector<pair<pair<string, size_t>, string>>> output_variants;
+    /// protects each of the buffers while write_variants_before() drains them
+    unique_ptr<std::mutex[]> output_variant_locks;
 
     /// print up to this many uncalled alleles when doing ref-genotpes in -a mode
     size_t max_uncalled_alleles = 5;
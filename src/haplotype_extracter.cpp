@@ -1,4 +1,5 @@
 #include <iostream>
+#include <limits>
 #include "vg.hpp"
 #include "haplotype_extracter.hpp"
 #include "vg/io/json2pb.h"
@@ -8,59 +9,122 @@ namespace vg {
 
 using namespace std;
 
-static id_t side_id(int64_t side) {
-    return abs(side);
+// Adds to the graph the nodes and edges of a thread that it doesn't already have.
+// Nodes are looked up in a dense bitset over the node IDs from min_id, which must
+// cover the thread, and which marks the nodes known to be in the graph.
+static void add_thread_to_graph(const thread_t& t, const HandleGraph& source, MutableHandleGraph& graph,
+                                vector<bool>& in_graph, nid_t min_id) {
+  // edges can only already exist if both of their nodes were already there
+  bool prev_was_present = false;
+  for (size_t i = 0; i < t.size(); i++) {
+    nid_t id = gbwt::Node::id(t[i]);
+    bool was_present = in_graph[id - min_id];
+    if (!was_present) {
+      was_present = graph.has_node(id);
+      if (!was_present) {
+        graph.create_handle(source.get_sequence(source.get_handle(id)), id);
+      }
+      in_graph[id - min_id] = true;
+    }
+    if (i > 0) {
+      handle_t prev = graph.get_handle(gbwt::Node::id(t[i - 1]), gbwt::Node::is_reverse(t[i - 1]));
+      handle_t here = graph.get_handle(id, gbwt::Node::is_reverse(t[i]));
+      if (!(prev_was_present && was_present) || !graph.has_edge(prev, here)) {
+        graph.create_edge(prev, here);
+      }
+    }
+    prev_was_present = was_present;
+  }
 }
 
-static bool side_is_end(int64_t side) {
-    return side < 0;
+// Adds the threads to the graph as paths, first adding whatever nodes and edges
+// they need, and names them with the given function
+static void embed_threads(const vector<const thread_t*>& threads, const HandleGraph& source,
+                          MutablePathMutableHandleGraph& graph,
+                          const function<string(size_t)>& get_name) {
+  if (threads.empty()) {
+    return;
+  }
+  nid_t min_id = numeric_limits<nid_t>::max();
+  nid_t max_id = numeric_limits<nid_t>::min();
+  for (const thread_t* t : threads) {
+    for (const gbwt::node_type& node : *t) {
+      min_id = min<nid_t>(min_id, gbwt::Node::id(node));
+      max_id = max<nid_t>(max_id, gbwt::Node::id(node));
+    }
+  }
+  if (min_id > max_id) {
+    // only empty threads
+    min_id = max_id = 0;
+  }
+  vector<bool> in_graph(max_id - min_id + 1, false);
+  for (size_t i = 0; i < threads.size(); i++) {
+    add_thread_to_graph(*threads[i], source, graph, in_graph, min_id);
+    path_handle_t path_handle = graph.create_path_handle(get_name(i));
+    for (const gbwt::node_type& node : *threads[i]) {
+      graph.append_step(path_handle, graph.get_handle(gbwt::Node::id(node), gbwt::Node::is_reverse(node)));
+    }
+  }
 }
 
-static int64_t make_side(id_t id, bool is_end) {
-    return !is_end ? id : -1 * id;
+void trace_haplotypes_and_paths(const PathHandleGraph& source, const gbwt::GBWT& haplotype_database,
+                                vg::id_t start_node, int extend_distance,
+                                MutablePathMutableHandleGraph& out_graph,
+                                map<string, int>& out_thread_frequencies,
+                                bool expand_graph) {
+  trace_haplotypes_and_paths(source, haplotype_database, vector<vg::id_t>{start_node}, extend_distance,
+                             out_graph, out_thread_frequencies, expand_graph);
 }
 
-
 void trace_haplotypes_and_paths(const PathHandleGraph& source, const gbwt::GBWT& haplotype_database,
-                                vg::id_t start_node, int extend_distance,
-                                Graph& out_graph,
+                                const vector<vg::id_t>& start_nodes, int extend_distance,
+                                MutablePathMutableHandleGraph& out_graph,
                                 map<string, int>& out_thread_frequencies,
                                 bool expand_graph) {
-  // get our haplotypes
-  handle_t n = source.get_handle(start_node, false);
-  vector<pair<thread_t, gbwt::SearchState> > haplotypes = list_haplotypes(source, haplotype_database, n,
-                                                                          [&extend_distance](const vector<gbwt::node_type>& new_thread) {
-                                                                              return new_thread.size() >= extend_distance;
-                                                                          });
+  // get our haplotypes, with the start positions in parallel
+  vector<vector<pair<thread_t, gbwt::SearchState>>> haplotypes(start_nodes.size());
+#pragma omp parallel for schedule(dynamic, 1)
+  for (size_t i = 0; i < start_nodes.size(); i++) {
+    handle_t n = source.get_handle(start_nodes[i], false);
+    haplotypes[i] = list_haplotypes(source, haplotype_database, n,
+                                    [&extend_distance](const vector<gbwt::node_type>& new_thread) {
+                                      return new_thread.size() >= extend_distance;
+                                    });
+  }
 
 #ifdef debug
-  cerr << "Haplotype database " << &haplotype_database << " produced " << haplotypes.size() << " haplotypes" << endl;
+  for (auto& start_haplotypes : haplotypes) {
+    cerr << "Haplotype database " << &haplotype_database << " produced " << start_haplotypes.size() << " haplotypes" << endl;
+  }
 #endif
 
   if (expand_graph) {
-      // get our subgraph and "regular" paths by expanding forward
-      handle_t handle = source.get_handle(start_node);
-      bdsg::HashGraph extractor;
-      extractor.create_handle(source.get_sequence(handle), source.get_id(handle));
+      // get our subgraph and "regular" paths by expanding forward from all the start nodes at once
+      for (vg::id_t start_node : start_nodes) {
+          if (!out_graph.has_node(start_node)) {
+              out_graph.create_handle(source.get_sequence(source.get_handle(start_node)), start_node);
+          }
+      }
       // TODO: is expanding only forward really the right behavior here?
-      algorithms::expand_context_with_paths(&source, &extractor, extend_distance, true, true, false);
-      
-      // Convert to Protobuf I guess
-      from_path_handle_graph(extractor, out_graph);
+      algorithms::expand_context_with_paths(&source, &out_graph, extend_distance, true, true, false);
   }
 
   // add a frequency of 1 for each normal path
-  for (int i = 0; i < out_graph.path_size(); ++i) {
-    out_thread_frequencies[out_graph.path(i).name()] = 1;
-  }
+  out_graph.for_each_path_handle([&](const path_handle_t& path_handle) {
+      out_thread_frequencies[out_graph.get_path_name(path_handle)] = 1;
+    });
 
   // add our haplotypes to the subgraph, naming ith haplotype "thread_i"
-  for (int i = 0; i < haplotypes.size(); ++i) {
-    Path p = path_from_thread_t(haplotypes[i].first, source);
-    p.set_name("thread_" + to_string(i));
-    out_thread_frequencies[p.name()] = haplotypes[i].second.size();
-    *(out_graph.add_path()) = move(p);
+  vector<const thread_t*> threads;
+  for (auto& start_haplotypes : haplotypes) {
+    for (auto& haplotype : start_haplotypes) {
+      out_thread_frequencies["thread_" + to_string(threads.size())] = haplotype.second.size();
+      threads.push_back(&haplotype.first);
+    }
   }
+  embed_threads(threads, source, out_graph, [](size_t i) {
+      return "thread_" + to_string(i);
+    });
 }
 
 
@@ -71,92 +135,32 @@ void output_haplotype_counts(ostream& annotation_ostream,
   }
 }
 
-Graph output_graph_with_embedded_paths(vector<pair<thread_t,int>>& haplotype_list, const HandleGraph& source) {
-  Graph g;
-  set<int64_t> nodes;
-  set<pair<int,int> > edges;
-  for(int i = 0; i < haplotype_list.size(); i++) {
-    add_thread_nodes_to_set(haplotype_list[i].first, nodes);
-    add_thread_edges_to_set(haplotype_list[i].first, edges);
-  }
-  construct_graph_from_nodes_and_edges(g, source, nodes, edges);
-  for(int i = 0; i < haplotype_list.size(); i++) {
-    Path p = path_from_thread_t(haplotype_list[i].first, source);
-    p.set_name(to_string(i));
-    *(g.add_path()) = move(p);
+void output_graph_with_embedded_paths(vector<pair<thread_t,int>>& haplotype_list, const HandleGraph& source,
+                                      MutablePathMutableHandleGraph& out_graph) {
+  vector<const thread_t*> threads;
+  threads.reserve(haplotype_list.size());
+  for (auto& haplotype : haplotype_list) {
+    threads.push_back(&haplotype.first);
   }
-  return g;
+  embed_threads(threads, source, out_graph, [](size_t i) {
+      return to_string(i);
+    });
 }
  
 void output_graph_with_embedded_paths(ostream& subgraph_ostream,
             vector<pair<thread_t,int>>& haplotype_list, const HandleGraph& source, bool json) {
-  Graph g = output_graph_with_embedded_paths(haplotype_list, source);
+  VG subgraph;
+  output_graph_with_embedded_paths(haplotype_list, source, subgraph);
 
   if (json) {
+    Graph g;
+    from_path_handle_graph(subgraph, g);
     subgraph_ostream << pb2json(g);
   } else {
-    VG subgraph;
-    subgraph.extend(g);
     subgraph.serialize_to_ostream(subgraph_ostream);
   }
 }
 
-void thread_to_graph_spanned(thread_t& t, Graph& g, const HandleGraph& source) {
-  set<int64_t> nodes;
-  set<pair<int,int> > edges;
-  nodes.insert(gbwt::Node::id(t[0]));
-  for(int i = 1; i < t.size(); i++) {
-    nodes.insert(gbwt::Node::id(t[i]));
-    edges.insert(make_pair(make_side(gbwt::Node::id(t[i-1]),gbwt::Node::is_reverse(t[i-1])),
-              make_side(gbwt::Node::id(t[i]),gbwt::Node::is_reverse(t[i]))));
-  }
-  for (auto& n : nodes) {
-    handle_t handle = source.get_handle(n);
-    Node* node = g.add_node();
-    node->set_sequence(source.get_sequence(handle));
-    node->set_id(n);
-  }
-  for (auto& e : edges) {
-    Edge edge;
-    edge.set_from(side_id(e.first));
-    edge.set_from_start(side_is_end(e.first));
-    edge.set_to(side_id(e.second));
-    edge.set_to_end(side_is_end(e.second));
-    *g.add_edge() = edge;
-  }
-}
-
-void add_thread_nodes_to_set(thread_t& t, set<int64_t>& nodes) {
-  for(int i = 0; i < t.size(); i++) {
-    nodes.insert(gbwt::Node::id(t[i]));
-  }
-}
-
-void add_thread_edges_to_set(thread_t& t, set<pair<int,int> >& edges) {
-  for(int i = 1; i < t.size(); i++) {
-    edges.insert(make_pair(make_side(gbwt::Node::id(t[i-1]),gbwt::Node::is_reverse(t[i-1])),
-              make_side(gbwt::Node::id(t[i]),gbwt::Node::is_reverse(t[i]))));
-  }
-}
-
-void construct_graph_from_nodes_and_edges(Graph& g, const HandleGraph& source,
-            set<int64_t>& nodes, set<pair<int,int> >& edges) {
-  for (auto& n : nodes) {
-    handle_t handle = source.get_handle(n);
-    Node* node = g.add_node();
-    node->set_sequence(source.get_sequence(handle));
-    node->set_id(n);
-  }
-  for (auto& e : edges) {
-    Edge edge;
-    edge.set_from(side_id(e.first));
-    edge.set_from_start(side_is_end(e.first));
-    edge.set_to(side_id(e.second));
-    edge.set_to_end(side_is_end(e.second));
-    *g.add_edge() = edge;
-  }
-}
-
 Path path_from_thread_t(thread_t& t, const HandleGraph& source) {
 	Path toReturn;
 	int rank = 1;
@@ -23,11 +23,22 @@ using thread_t = vector<gbwt::node_type>;
 // subgraph search for all the paths too.  Haplotype thread i will be embedded
 // as Paths a path with name thread_i.  Each path name (including threads) is
 // mapped to a frequency in out_thread_frequencies.  Haplotypes will be pulled
-// from the GBWT index.
+// from the GBWT index.  Everything is added directly to out_graph, along with
+// any nodes and edges of the haplotypes that it is missing.
 void trace_haplotypes_and_paths(const PathHandleGraph& source,
                                 const gbwt::GBWT& haplotype_database,
                                 vg::id_t start_node, int extend_distance,
-                                Graph& out_graph,
+                                MutablePathMutableHandleGraph& out_graph,
+                                map<string, int>& out_thread_frequencies,
+                                bool expand_graph = true);
+
+// Same, but walk forward from several nodes, whose haplotypes are collected in
+// parallel.  The threads are numbered consecutively in the order of the start
+// nodes.
+void trace_haplotypes_and_paths(const PathHandleGraph& source,
+                                const gbwt::GBWT& haplotype_database,
+                                const vector<vg::id_t>& start_nodes, int extend_distance,
+                                MutablePathMutableHandleGraph& out_graph,
                                 map<string, int>& out_thread_frequencies,
                                 bool expand_graph = true);
 
@@ -49,24 +60,15 @@ vector<pair<vector<gbwt::node_type>, gbwt::SearchState> > list_haplotypes(const
 // Paths.  Will output in JSON format if json set to true and Protobuf otherwise.
 void output_graph_with_embedded_paths(ostream& subgraph_ostream,
             vector<pair<thread_t,int>>& haplotype_list, const HandleGraph& source, bool json = true);
-// get the graph directly
-Graph output_graph_with_embedded_paths(vector<pair<thread_t,int>>& haplotype_list, const HandleGraph& source);
+// add the subgraph and the embedded paths to a graph directly
+void output_graph_with_embedded_paths(vector<pair<thread_t,int>>& haplotype_list, const HandleGraph& source,
+                                      MutablePathMutableHandleGraph& out_graph);
 
 // writes to annotation_ostream the list of counts of identical subhaplotypes
 // using the same ordering as the Paths from output_graph_with_embedded_paths
 void output_haplotype_counts(ostream& annotation_ostream,
             vector<pair<thread_t,int>>& haplotype_list);
 
-// Adds to a Graph the nodes and edges touched by a thread_t
-void thread_to_graph_spanned(thread_t& t, Graph& graph, const HandleGraph& source);
-// Adds to a set of nodes all those touched by thread_t t
-void add_thread_nodes_to_set(thread_t& t, set<int64_t>& nodes);
-// Adds to a set of edges all those touched by thread_t t
-void add_thread_edges_to_set(thread_t& t, set<pair<int,int> >& edges);
-// Turns a set of nodes and a set of edges into a Graph
-void construct_graph_from_nodes_and_edges(Graph& g, const HandleGraph& source,
-            set<int64_t>& nodes, set<pair<int,int> >& edges);
-
 }
 
 #endif
@@ -4,9 +4,12 @@
 
 #include <iostream>
 #include <map>
+#include <random>
 #include <vector>
 #include <string>
 
+#include <omp.h>
+
 #include <vg/io/stream.hpp>
 #include <gbwtgraph/path_cover.h>
 
@@ -43,17 +46,21 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
 std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename, const PathHandleGraph& graph, const std::vector<path_handle_t>& paths, const std::string& job_name) const {
 
     // Open the VCF file.
-    vcflib::VariantCallFile variant_file;
-    variant_file.parseSamples = false; // vcflib parsing is very slow if there are many samples.
-    std::string temp_filename = filename;
-    variant_file.open(temp_filename);
-    if (!variant_file.is_open()) {
-        std::cerr << "error: [HaplotypeIndexer::parse_vcf] could not open " << filename << std::endl;
-        std::exit(EXIT_FAILURE);
-    }
+    auto open_vcf = [&]() -> std::unique_ptr<vcflib::VariantCallFile> {
+        std::unique_ptr<vcflib::VariantCallFile> variant_file(new vcflib::VariantCallFile());
+        variant_file->parseSamples = false; // vcflib parsing is very slow if there are many samples.
+        std::string temp_filename = filename;
+        variant_file->open(temp_filename);
+        if (!variant_file->is_open()) {
+            std::cerr << "error: [HaplotypeIndexer::parse_vcf] could not open " << filename << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        return variant_file;
+    };
+    std::unique_ptr<vcflib::VariantCallFile> header_file = open_vcf();
 
     // How many samples are there?
-    size_t num_samples = variant_file.sampleNames.size();
+    size_t num_samples = header_file->sampleNames.size();
     if (num_samples == 0) {
         std::cerr << "error: [HaplotypeIndexer::parse_vcf] variant file '" << filename << "' does not contain phasings" << std::endl;
         std::exit(EXIT_FAILURE);
@@ -62,7 +69,7 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
     // Determine the samples we want to index.
     std::pair<size_t, size_t> sample_range = this->sample_range;
     sample_range.second = std::min(sample_range.second, num_samples);
-    std::vector<std::string> sample_names(variant_file.sampleNames.begin() + sample_range.first, variant_file.sampleNames.begin() + sample_range.second);
+    std::vector<std::string> sample_names(header_file->sampleNames.begin() + sample_range.first, header_file->sampleNames.begin() + sample_range.second);
     if (this->show_progress) {
         #pragma omp critical
         {
@@ -84,13 +91,25 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
         }
     }
 
-    // Parse the contigs we are interested in.
-    std::vector<std::string> result;
+    // Parse the contigs we are interested in. The contigs are independent, so
+    // we parse them in parallel, with each thread using its own handle to the
+    // VCF file. Each contig gets its own random number generator, so that
+    // forced phasing does not depend on the number of threads.
+    std::vector<std::string> parse_files(paths.size());
     size_t total_variants_processed = 0;
-    std::mt19937 rng(0xDEADBEEF);
-    std::uniform_int_distribution<std::mt19937::result_type> random_bit(0, 1);
     size_t found_missing_variants = 0;
+    std::vector<std::unique_ptr<vcflib::VariantCallFile>> thread_files(omp_get_max_threads());
+    thread_files[0] = std::move(header_file);
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:total_variants_processed) if (paths.size() > 1 && filename != "-")
     for (size_t path_id = 0; path_id < paths.size(); path_id++) {
+        std::unique_ptr<vcflib::VariantCallFile>& thread_file = thread_files[omp_get_thread_num()];
+        if (!thread_file) {
+            thread_file = open_vcf();
+        }
+        vcflib::VariantCallFile& variant_file = *thread_file;
+        std::mt19937 rng(0xDEADBEEF + path_id);
+        std::uniform_int_distribution<std::mt19937::result_type> random_bit(0, 1);
+
         std::string path_name = graph.get_path_name(paths[path_id]);
         std::string vcf_contig_name = (this->path_to_vcf.count(path_name) > 0 ? this->path_to_vcf.at(path_name) : path_name);
 
@@ -105,7 +124,10 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
         // Check that the VCF file contains this contig.
         vcflib::Variant var(variant_file);
         if (!(variant_file.is_open() && variant_file.getNextVariant(var) && var.sequenceName == vcf_contig_name)) {
-            std::cerr << "warning: [HaplotypeIndexer::parse_vcf] contig " << vcf_contig_name << " not present in file " << filename << std::endl;
+            #pragma omp critical
+            {
+                std::cerr << "warning: [HaplotypeIndexer::parse_vcf] contig " << vcf_contig_name << " not present in file " << filename << std::endl;
+            }
             continue;
         }
         if (this->show_progress) {
@@ -211,15 +233,17 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
                 }
                 if (!found) {
                     // This variant from the VCF is just not in the graph, so skip it.
-                    found_missing_variants++;
-                    if (this->warn_on_missing_variants && found_missing_variants <= this->max_missing_variant_warnings) {
+                    size_t missing_so_far;
+                    #pragma omp atomic capture
+                    missing_so_far = ++found_missing_variants;
+                    if (this->warn_on_missing_variants && missing_so_far <= this->max_missing_variant_warnings) {
                         #pragma omp critical
                         {
                             // The user might not know it. Warn them in case they mixed up their VCFs.
                             std::cerr << "warning: [HaplotypeIndexer::parse_vcf] alt and ref paths for " << var_name
                                     << " at " << var.sequenceName << ":" << var.position
                                     << " missing/empty! Was the variant skipped during construction?" << std::endl;
-                            if (found_missing_variants == this->max_missing_variant_warnings) {
+                            if (missing_so_far == this->max_missing_variant_warnings) {
                                 std::cerr << "warning: [HaplotypeIndexer::parse_vcf] suppressing further missing variant warnings" << std::endl;
                             }
                         }
@@ -270,11 +294,19 @@ std::vector<std::string> HaplotypeIndexer::parse_vcf(const std::string& filename
             std::cerr << "error: [HaplotypeIndexer::parse_vcf] cannot write parse file " << parse_file << std::endl;
             std::exit(EXIT_FAILURE);
         }
-        result.push_back(parse_file);
+        parse_files[path_id] = parse_file;
 
         // End of haplotype generation for the current contig.
         total_variants_processed += variants_processed;
     } // End of contigs.
+
+    // Report the parse files in path order, skipping contigs that were not in the VCF.
+    std::vector<std::string> result;
+    for (auto& parse_file : parse_files) {
+        if (!parse_file.empty()) {
+            result.push_back(parse_file);
+        }
+    }
         
     if (this->warn_on_missing_variants && found_missing_variants > 0) {
         #pragma omp critical
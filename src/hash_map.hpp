@@ -2,8 +2,17 @@
 #define VG_HASH_MAP_HPP_INCLUDED
 
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
 #include <tuple>
 #include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "wang_hash.hpp"
 
@@ -123,6 +132,25 @@ struct wang_hash<std::pair<A, B>> {
     }
 };
 
+// We can hash tuples, which covers pos_t
+template<typename... TT>
+struct wang_hash<std::tuple<TT...>> {
+    size_t operator()(const std::tuple<TT...>& x) const {
+        return combine<0>(x, 0);
+    }
+private:
+    template<size_t Index>
+    static typename std::enable_if<Index == sizeof...(TT), size_t>::type combine(const std::tuple<TT...>& x, size_t hash_val) {
+        return hash_val;
+    }
+    template<size_t Index>
+    static typename std::enable_if<Index < sizeof...(TT), size_t>::type combine(const std::tuple<TT...>& x, size_t hash_val) {
+        using element_t = typename std::decay<typename std::tuple_element<Index, std::tuple<TT...>>::type>::type;
+        hash_val ^= wang_hash<element_t>()(std::get<Index>(x)) + 0x9e3779b9 + (hash_val << 6) + (hash_val >> 2);
+        return combine<Index + 1>(x, hash_val);
+    }
+};
+
 
 // Replacements for std::unordered_map.
 
@@ -250,6 +278,462 @@ public:
 };
 
 
+// Open-addressing flat hash tables.
+
+/**
+ * Open-addressing hash table that keeps its values in one flat array, with a
+ * parallel array of one-byte control codes. Each code says whether its slot
+ * is empty, deleted, or full, and for full slots holds 7 bits of the value's
+ * hash, so a lookup can check 16 slots' codes at once (with SSE2 where
+ * available) and only compare keys on likely matches. This trades some
+ * memory for probe speed, compared to the sparse tables above, so it is
+ * meant for hot lookups on small keys like IDs, handles and positions.
+ *
+ * Like std::unordered_map, inserting can move values and invalidates
+ * iterators and references; unlike it, erasing does not move anything.
+ *
+ * Use flat_hash_map or flat_hash_set instead of this directly.
+ */
+template<typename Key, typename Value, typename KeyOf, typename Hash, bool MutableValues>
+class flat_hash_table {
+public:
+    using key_type = Key;
+    using value_type = Value;
+    using size_type = size_t;
+    using hasher = Hash;
+    
+    template<bool Const>
+    class iterator_base {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using reference = typename std::conditional<Const || !MutableValues, const Value&, Value&>::type;
+        using pointer = typename std::conditional<Const || !MutableValues, const Value*, Value*>::type;
+        
+        iterator_base() = default;
+        /// Non-const iterators can become const ones
+        template<bool OtherConst, typename = typename std::enable_if<Const || !OtherConst>::type>
+        iterator_base(const iterator_base<OtherConst>& other) : table(other.table), index(other.index) {}
+        
+        reference operator*() const { return table->slots[index]; }
+        pointer operator->() const { return &table->slots[index]; }
+        iterator_base& operator++() {
+            index = table->next_full(index + 1);
+            return *this;
+        }
+        iterator_base operator++(int) {
+            iterator_base here = *this;
+            ++*this;
+            return here;
+        }
+        template<bool OtherConst>
+        bool operator==(const iterator_base<OtherConst>& other) const { return index == other.index && table == other.table; }
+        template<bool OtherConst>
+        bool operator!=(const iterator_base<OtherConst>& other) const { return !(*this == other); }
+        
+    private:
+        friend class flat_hash_table;
+        template<bool> friend class iterator_base;
+        using table_t = typename std::conditional<Const, const flat_hash_table, flat_hash_table>::type;
+        iterator_base(table_t* table, size_t index) : table(table), index(index) {}
+        table_t* table = nullptr;
+        size_t index = 0;
+    };
+    
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+    
+    flat_hash_table() = default;
+    
+    flat_hash_table(const flat_hash_table& other) : hash_function(other.hash_function) {
+        if (other.capacity != 0) {
+            allocate(other.capacity);
+            for (size_t i = 0; i < capacity; i++) {
+                if (other.ctrl[i] >= 0) {
+                    new (&slots[i]) Value(other.slots[i]);
+                    set_ctrl(i, other.ctrl[i]);
+                    ++full_count;
+                }
+            }
+            growth_left = max_load(capacity) - full_count;
+        }
+    }
+    
+    flat_hash_table(flat_hash_table&& other) noexcept {
+        swap(other);
+    }
+    
+    flat_hash_table& operator=(flat_hash_table other) {
+        swap(other);
+        return *this;
+    }
+    
+    ~flat_hash_table() {
+        destroy();
+    }
+    
+    void swap(flat_hash_table& other) noexcept {
+        std::swap(ctrl, other.ctrl);
+        std::swap(slots, other.slots);
+        std::swap(capacity, other.capacity);
+        std::swap(full_count, other.full_count);
+        std::swap(growth_left, other.growth_left);
+        std::swap(hash_function, other.hash_function);
+    }
+    
+    iterator begin() { return iterator(this, next_full(0)); }
+    iterator end() { return iterator(this, capacity); }
+    const_iterator begin() const { return const_iterator(this, next_full(0)); }
+    const_iterator end() const { return const_iterator(this, capacity); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    
+    size_t size() const { return full_count; }
+    bool empty() const { return full_count == 0; }
+    
+    /// Make room for at least this many values without rehashing
+    void reserve(size_t wanted) {
+        size_t wanted_capacity = capacity_for(wanted);
+        if (wanted_capacity > capacity) {
+            rehash(wanted_capacity);
+        }
+    }
+    
+    /// Remove all values. Keeps the memory.
+    void clear() {
+        for (size_t i = 0; i < capacity; i++) {
+            if (ctrl[i] >= 0) {
+                slots[i].~Value();
+            }
+        }
+        if (capacity != 0) {
+            std::memset(ctrl, EMPTY, capacity + GROUP_WIDTH - 1);
+        }
+        full_count = 0;
+        growth_left = max_load(capacity);
+    }
+    
+    iterator find(const Key& key) { return iterator(this, find_index(key)); }
+    const_iterator find(const Key& key) const { return const_iterator(this, find_index(key)); }
+    size_t count(const Key& key) const { return find_index(key) == capacity ? 0 : 1; }
+    
+    /// Remove the value at the given position, and return the next one.
+    iterator erase(const_iterator position) {
+        size_t index = position.index;
+        slots[index].~Value();
+        set_ctrl(index, DELETED);
+        --full_count;
+        return iterator(this, next_full(index + 1));
+    }
+    
+    /// Remove the value with the given key, if any, and return how many were removed.
+    size_t erase(const Key& key) {
+        size_t index = find_index(key);
+        if (index == capacity) {
+            return 0;
+        }
+        erase(const_iterator(this, index));
+        return 1;
+    }
+    
+protected:
+    
+    /// Control code for an empty slot, which ends probing
+    static const int8_t EMPTY = -128;
+    /// Control code for a deleted slot, which probing continues past
+    static const int8_t DELETED = -2;
+    /// How many control codes we check at once
+    static const size_t GROUP_WIDTH = 16;
+    
+    /// Get a bitmask of which of the GROUP_WIDTH control codes starting at
+    /// the given one have the given value.
+    static inline uint32_t match(const int8_t* group, int8_t code) {
+#ifdef __SSE2__
+        __m128i codes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(codes, _mm_set1_epi8(code)));
+#else
+        uint32_t found = 0;
+        for (size_t i = 0; i < GROUP_WIDTH; i++) {
+            found |= (uint32_t)(group[i] == code) << i;
+        }
+        return found;
+#endif
+    }
+    
+    /// Get a bitmask of which of the GROUP_WIDTH control codes starting at
+    /// the given one are empty or deleted, which are the negative ones.
+    static inline uint32_t match_free(const int8_t* group) {
+#ifdef __SSE2__
+        return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group)));
+#else
+        uint32_t found = 0;
+        for (size_t i = 0; i < GROUP_WIDTH; i++) {
+            found |= (uint32_t)(group[i] < 0) << i;
+        }
+        return found;
+#endif
+    }
+    
+    /// How many values can be in a table of the given capacity, including
+    /// deleted ones, before it needs rehashing. Keeps at least one slot empty.
+    static size_t max_load(size_t capacity) {
+        return capacity - capacity / 8;
+    }
+    
+    /// Get the smallest capacity that can hold the given number of values.
+    static size_t capacity_for(size_t wanted) {
+        if (wanted == 0) {
+            return 0;
+        }
+        size_t capacity = GROUP_WIDTH;
+        while (max_load(capacity) < wanted) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+    
+    /// Find the index of the first full slot at or after the given one, or
+    /// the capacity if there is none.
+    size_t next_full(size_t index) const {
+        while (index < capacity && ctrl[index] < 0) {
+            ++index;
+        }
+        return index;
+    }
+    
+    /// Set the control code for a slot. The first GROUP_WIDTH - 1 codes are
+    /// repeated after the end, so a group can be read from any slot without
+    /// wrapping around.
+    void set_ctrl(size_t index, int8_t code) {
+        ctrl[index] = code;
+        if (index < GROUP_WIDTH - 1) {
+            ctrl[capacity + index] = code;
+        }
+    }
+    
+    /// Find the slot holding the value with the given key, or the capacity if
+    /// there is none.
+    size_t find_index(const Key& key) const {
+        if (capacity == 0) {
+            return capacity;
+        }
+        size_t hash_val = hash_function(key);
+        int8_t code = hash_val & 0x7F;
+        size_t mask = capacity - 1;
+        size_t group_start = (hash_val >> 7) & mask;
+        // Visit groups in triangular-number steps, which visits every group
+        // of a power-of-two table.
+        for (size_t step = GROUP_WIDTH; ; step += GROUP_WIDTH) {
+            for (uint32_t found = match(ctrl + group_start, code); found != 0; found &= found - 1) {
+                size_t index = (group_start + __builtin_ctz(found)) & mask;
+                if (equal(KeyOf()(slots[index]), key)) {
+                    return index;
+                }
+            }
+            if (match(ctrl + group_start, EMPTY) != 0) {
+                return capacity;
+            }
+            group_start = (group_start + step) & mask;
+        }
+    }
+    
+    /// Find a free slot for a new value with the given hash.
+    size_t find_free_index(size_t hash_val) const {
+        size_t mask = capacity - 1;
+        size_t group_start = (hash_val >> 7) & mask;
+        for (size_t step = GROUP_WIDTH; ; step += GROUP_WIDTH) {
+            uint32_t found = match_free(ctrl + group_start);
+            if (found != 0) {
+                return (group_start + __builtin_ctz(found)) & mask;
+            }
+            group_start = (group_start + step) & mask;
+        }
+    }
+    
+    /// Find the value with the given key, or make one from the given
+    /// arguments if there isn't one. Returns the position of the value, and
+    /// whether it was made.
+    template<typename... Args>
+    std::pair<iterator, bool> emplace_key(const Key& key, Args&&... args) {
+        size_t index = find_index(key);
+        if (index != capacity) {
+            return std::make_pair(iterator(this, index), false);
+        }
+        if (growth_left == 0) {
+            // Either clear out deleted slots, or grow if we are at least half
+            // full of real values.
+            rehash(full_count * 2 < max_load(capacity) ? capacity : (capacity == 0 ? GROUP_WIDTH : capacity * 2));
+        }
+        size_t hash_val = hash_function(key);
+        index = find_free_index(hash_val);
+        new (&slots[index]) Value(std::forward<Args>(args)...);
+        if (ctrl[index] == EMPTY) {
+            --growth_left;
+        }
+        set_ctrl(index, hash_val & 0x7F);
+        ++full_count;
+        return std::make_pair(iterator(this, index), true);
+    }
+    
+    /// Move all the values into new storage of the given capacity.
+    void rehash(size_t new_capacity) {
+        int8_t* old_ctrl = ctrl;
+        Value* old_slots = slots;
+        size_t old_capacity = capacity;
+        allocate(new_capacity);
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old_ctrl[i] >= 0) {
+                size_t hash_val = hash_function(KeyOf()(old_slots[i]));
+                size_t index = find_free_index(hash_val);
+                new (&slots[index]) Value(std::move(old_slots[i]));
+                old_slots[i].~Value();
+                set_ctrl(index, hash_val & 0x7F);
+                ++full_count;
+            }
+        }
+        growth_left -= full_count;
+        if (old_capacity != 0) {
+            delete[] old_ctrl;
+            std::allocator<Value>().deallocate(old_slots, old_capacity);
+        }
+    }
+    
+    /// Set up empty storage of the given capacity, forgetting any old storage.
+    void allocate(size_t new_capacity) {
+        capacity = new_capacity;
+        full_count = 0;
+        growth_left = max_load(capacity);
+        ctrl = nullptr;
+        slots = nullptr;
+        if (capacity != 0) {
+            ctrl = new int8_t[capacity + GROUP_WIDTH - 1];
+            std::memset(ctrl, EMPTY, capacity + GROUP_WIDTH - 1);
+            slots = std::allocator<Value>().allocate(capacity);
+        }
+    }
+    
+    /// Destroy all values and free the storage.
+    void destroy() {
+        if (capacity != 0) {
+            clear();
+            delete[] ctrl;
+            std::allocator<Value>().deallocate(slots, capacity);
+        }
+        ctrl = nullptr;
+        slots = nullptr;
+        capacity = 0;
+        growth_left = 0;
+    }
+    
+    int8_t* ctrl = nullptr;
+    Value* slots = nullptr;
+    /// Number of slots, which is 0 or a power of 2 at least GROUP_WIDTH
+    size_t capacity = 0;
+    /// Number of full slots
+    size_t full_count = 0;
+    /// Number of empty slots we can still fill before rehashing
+    size_t growth_left = 0;
+    Hash hash_function;
+    std::equal_to<Key> equal;
+};
+
+/// Selects the key of a key-value pair
+struct flat_hash_pair_key {
+    template<typename Pair>
+    const typename Pair::first_type& operator()(const Pair& item) const {
+        return item.first;
+    }
+};
+
+/// Selects a set item as its own key
+struct flat_hash_identity_key {
+    template<typename T>
+    const T& operator()(const T& item) const {
+        return item;
+    }
+};
+
+/**
+ * Replacement for std::unordered_map that probes faster than hash_map on
+ * small keys, by using a flat_hash_table. Hashes with wang_hash, which is
+ * defined for integers like IDs, pos_t, handles, and pairs and tuples of
+ * them.
+ */
+template<typename K, typename V, typename Hash = wang_hash<K>>
+class flat_hash_map : public flat_hash_table<K, std::pair<const K, V>, flat_hash_pair_key, Hash, true> {
+    using table_t = flat_hash_table<K, std::pair<const K, V>, flat_hash_pair_key, Hash, true>;
+public:
+    using mapped_type = V;
+    using typename table_t::value_type;
+    using typename table_t::iterator;
+    using typename table_t::const_iterator;
+    
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return this->emplace_key(value.first, value);
+    }
+    
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return this->emplace_key(value.first, std::move(value));
+    }
+    
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        value_type value(std::forward<Args>(args)...);
+        return this->emplace_key(value.first, std::move(value));
+    }
+    
+    /// Make a value for the key from the given arguments, if it has none.
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args) {
+        return this->emplace_key(key, std::piecewise_construct, std::forward_as_tuple(key),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    
+    V& operator[](const K& key) {
+        return try_emplace(key).first->second;
+    }
+    
+    V& at(const K& key) {
+        auto found = this->find(key);
+        if (found == this->end()) {
+            throw std::out_of_range("key not in flat_hash_map");
+        }
+        return found->second;
+    }
+    
+    const V& at(const K& key) const {
+        auto found = this->find(key);
+        if (found == this->end()) {
+            throw std::out_of_range("key not in flat_hash_map");
+        }
+        return found->second;
+    }
+};
+
+/**
+ * Replacement for std::unordered_set that probes faster than hash_set on
+ * small keys, by using a flat_hash_table. Hashes with wang_hash.
+ */
+template<typename K, typename Hash = wang_hash<K>>
+class flat_hash_set : public flat_hash_table<K, K, flat_hash_identity_key, Hash, false> {
+    using table_t = flat_hash_table<K, K, flat_hash_identity_key, Hash, false>;
+public:
+    using typename table_t::iterator;
+    using typename table_t::const_iterator;
+    
+    std::pair<iterator, bool> insert(const K& value) {
+        return this->emplace_key(value, value);
+    }
+    
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        K value(std::forward<Args>(args)...);
+        return this->emplace_key(value, std::move(value));
+    }
+};
+
+
 }   // namespace vg
 
 #endif
@@ -7,6 +7,9 @@
 #include "hts_alignment_emitter.hpp"
 #include "surjecting_alignment_emitter.hpp"
 #include "back_translating_alignment_emitter.hpp"
+#include "direct_gaf_alignment_emitter.hpp"
+#include "ordered_alignment_emitter.hpp"
+#include "columnar_alignments.hpp"
 #include "alignment.hpp"
 #include "vg/io/json2pb.h"
 #include "algorithms/find_translation.hpp"
@@ -14,6 +17,7 @@
 #include <vg/io/stream.hpp>
 
 #include <sstream>
+#include <queue>
 
 //#define debug
 
@@ -22,11 +26,22 @@ using namespace std;
 
 unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const string& format,
                                                    const vector<tuple<path_handle_t, size_t, size_t>>& paths, size_t max_threads,
-                                                   const HandleGraph* graph, int flags) {
+                                                   const HandleGraph* graph, int flags,
+                                                   OrderedAlignmentEmitter** ordered) {
 
     
     unique_ptr<AlignmentEmitter> emitter;
     
+    // Put the emitter actually writing the file behind one that puts things
+    // in order, if wanted.
+    auto order_if_requested = [&]() {
+        if (ordered) {
+            auto ordered_emitter = make_unique<OrderedAlignmentEmitter>(std::move(emitter), max_threads);
+            *ordered = ordered_emitter.get();
+            emitter = std::move(ordered_emitter);
+        }
+    };
+    
     if (format == "SAM" || format == "BAM" || format == "CRAM") {
         // We are doing linear HTSLib output
         
@@ -46,11 +61,20 @@ unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const
     
         if (flags & ALIGNMENT_EMITTER_FLAG_HTS_SPLICED) {
             // Use a splicing emitter as the final emitter
-            emitter = make_unique<SplicedHTSAlignmentEmitter>(filename, format, path_names_and_lengths, subpath_to_length, *path_graph, max_threads);
+            auto hts_emitter = make_unique<SplicedHTSAlignmentEmitter>(filename, format, path_names_and_lengths, subpath_to_length, *path_graph, max_threads);
+            if (flags & ALIGNMENT_EMITTER_FLAG_HTS_SORTED) {
+                hts_emitter->set_sort_by_position();
+            }
+            emitter = std::move(hts_emitter);
         } else {
             // Use a normal emitter
-            emitter = make_unique<HTSAlignmentEmitter>(filename, format, path_names_and_lengths, subpath_to_length, max_threads);
+            auto hts_emitter = make_unique<HTSAlignmentEmitter>(filename, format, path_names_and_lengths, subpath_to_length, max_threads);
+            if (flags & ALIGNMENT_EMITTER_FLAG_HTS_SORTED) {
+                hts_emitter->set_sort_by_position();
+            }
+            emitter = std::move(hts_emitter);
         }
+        order_if_requested();
         
         if (!(flags & ALIGNMENT_EMITTER_FLAG_HTS_RAW)) {
             // Need to surject
@@ -62,9 +86,31 @@ unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const
             }
             // Interpose a surjecting AlignmentEmitter
             emitter = make_unique<SurjectingAlignmentEmitter>(path_graph, target_paths, std::move(emitter),
-                flags & ALIGNMENT_EMITTER_FLAG_HTS_PRUNE_SUSPICIOUS_ANCHORS);
+                flags & ALIGNMENT_EMITTER_FLAG_HTS_PRUNE_SUSPICIOUS_ANCHORS,
+                flags & ALIGNMENT_EMITTER_FLAG_HTS_INDEX_PATHS);
         }
     
+    } else if (format == "GAF" && (flags & ALIGNMENT_EMITTER_FLAG_GAF_DIRECT) &&
+               !(flags & ALIGNMENT_EMITTER_FLAG_VG_USE_SEGMENT_NAMES)) {
+        // We can write GAF lines ourselves, straight from the Alignments.
+        if (graph == nullptr) {
+            cerr << "error[vg::get_alignment_emitter]: No graph available for node lengths needed for " << format << " output." << endl;
+            exit(1);
+        }
+        emitter = make_unique<DirectGAFAlignmentEmitter>(filename, *graph, max_threads);
+        order_if_requested();
+    } else if (format == "GAMC") {
+        // Columnar GAM is our own format, so libvgio can't make it for us.
+        emitter = make_unique<GAMCAlignmentEmitter>(filename, max_threads);
+        order_if_requested();
+        if (flags & ALIGNMENT_EMITTER_FLAG_VG_USE_SEGMENT_NAMES) {
+            const NamedNodeBackTranslation* translation = vg::algorithms::find_translation(graph);
+            if (translation == nullptr) {
+                cerr << "error[vg::get_alignment_emitter]: No graph available supporting translation to named-segment space" << endl;
+                exit(1);
+            }
+            emitter = make_unique<BackTranslatingAlignmentEmitter>(translation, std::move(emitter));
+        }
     } else {
         // The non-HTSlib formats don't actually use the path name and length info.
         // See https://github.com/vgteam/libvgio/issues/34
@@ -84,6 +130,7 @@ unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const
         // TODO: Only GAF actually handles the translation in the emitter right now.
         // TODO: Move BackTranslatingAlignmentEmitter to libvgio so they all can and we don't have to sniff format here.
         emitter = get_non_hts_alignment_emitter(filename, format, {}, max_threads, graph, translation);
+        order_if_requested();
         if (translation && format != "GAF") {
             // Need to translate from node IDs to segment names beforehand.
             // Interpose a translating AlignmentEmitter
@@ -443,6 +490,9 @@ vector<tuple<path_handle_t, size_t, size_t>> get_sequence_dictionary(const strin
 // Give the footer length for rewriting BGZF EOF markers.
 const size_t HTSWriter::BGZF_FOOTER_LENGTH = 28;
 
+const size_t HTSWriter::DEFAULT_SORT_BUFFER_RECORDS = 1000000;
+int HTSWriter::compression_level = 9;
+
 HTSWriter::HTSWriter(const string& filename, const string& format,
     const vector<pair<string, int64_t>>& path_order_and_length,
     const unordered_map<string, int64_t>& subpath_to_length,
@@ -452,7 +502,10 @@ HTSWriter::HTSWriter(const string& filename, const string& format,
     format(format), path_order_and_length(path_order_and_length), subpath_to_length(subpath_to_length),
     backing_files(max_threads, nullptr), sam_files(max_threads, nullptr),
     atomic_header(nullptr), sam_header(), header_mutex(), output_is_bgzf(format != "SAM"),
-    hts_mode() {
+    hts_mode(), pooled(output_is_bgzf && max_threads > 1),
+    compression_threads(std::max<size_t>(1, max_threads / 2)),
+    pooled_stream(out_file.get() != nullptr ? *out_file : cout),
+    max_pooled_batches(max_threads * 4) {
     
     // We can't work with no streams to multiplex, because we need to be able
     // to write BGZF EOF blocks throught he multiplexer at destruction.
@@ -480,7 +533,7 @@ HTSWriter::HTSWriter(const string& filename, const string& format,
         out_format = "";
     }
     strcat(out_mode, out_format.c_str());
-    int compress_level = 9; // TODO: support other compression levels
+    int compress_level = compression_level;
     if (compress_level >= 0) {
         char tmp[2];
         tmp[0] = compress_level + '0'; tmp[1] = '\0';
@@ -502,6 +555,12 @@ HTSWriter::HTSWriter(const string& filename, const string& format,
 HTSWriter::~HTSWriter() {
     // Note that the destructor runs in only one thread, and only when
     // destruction is safe. No need to lock the header.
+    
+    if (pooled_file != nullptr) {
+        // Write out everything still queued while we still have the header.
+        finish_pooled_file();
+    }
+    
     if (atomic_header.load() != nullptr) {
         // Delete the header
         bam_hdr_destroy(atomic_header.load());
@@ -526,14 +585,24 @@ HTSWriter::~HTSWriter() {
         }
     }
     
-    if (output_is_bgzf) {
+    if (output_is_bgzf && !pooled) {
         // Now put one BGZF EOF marker in thread 0's stream.
         // It will be the last thing, after all the barriers, and close the file.
+        // In pooled mode, closing the one samFile* already wrote the EOF marker.
         vg::io::finish(multiplexer.get_thread_stream(0), true);
     }
     
 }
 
+void HTSWriter::set_sort_by_position(size_t max_records_in_memory) {
+    // Nothing can have been written yet.
+    assert(atomic_header.load() == nullptr);
+    sort_by_position = true;
+    max_sort_buffer_records = std::max<size_t>(max_records_in_memory, 1);
+    // Only the writer thread sees all the records, so it has to do the output.
+    pooled = true;
+}
+
 bam_hdr_t* HTSWriter::ensure_header(const string& read_group,
                                     const string& sample_name,
                                     size_t thread_number) {
@@ -560,9 +629,14 @@ bam_hdr_t* HTSWriter::ensure_header(const string& read_group,
             // Make the header
             header = hts_string_header(sam_header, path_order_and_length, rg_sample);
             
-            // Initialize the SAM file for this thread and actually keep the header
-            // we write, since we are the first thread.
-            initialize_sam_file(header, thread_number, true);
+            if (pooled) {
+                // Open the one shared file and start writing to it.
+                initialize_pooled_file(header);
+            } else {
+                // Initialize the SAM file for this thread and actually keep the header
+                // we write, since we are the first thread.
+                initialize_sam_file(header, thread_number, true);
+            }
             
             // Save back to the atomic only after the header has been written and
             // it is safe for other threads to use it.
@@ -576,7 +650,7 @@ bam_hdr_t* HTSWriter::ensure_header(const string& read_group,
     // Otherwise, someone else beat us to creating the header.
     // Header is ready. We just need to create the samFile* for this thread with it if it doesn't exist.
     
-    if (sam_files[thread_number] == nullptr) {
+    if (!pooled && sam_files[thread_number] == nullptr) {
         // The header has been created and written, but hasn't been used to initialize our samFile* yet.
         initialize_sam_file(header, thread_number);
     }
@@ -586,8 +660,23 @@ bam_hdr_t* HTSWriter::ensure_header(const string& read_group,
 
 
 void HTSWriter::save_records(bam_hdr_t* header, vector<bam1_t*>& records, size_t thread_number) {
-    // We need a header and an extant samFile*
+    // We need a header
     assert(header != nullptr);
+    
+    if (pooled) {
+        // Hand the records off to the writer thread, which owns them from now on.
+        assert(pooled_file != nullptr);
+        {
+            unique_lock<mutex> lock(pooled_mutex);
+            pooled_not_full.wait(lock, [&]() { return pooled_queue.size() < max_pooled_batches; });
+            pooled_queue.emplace_back(std::move(records));
+        }
+        records.clear();
+        pooled_not_empty.notify_one();
+        return;
+    }
+    
+    // Otherwise we need an extant samFile* for this thread
     assert(sam_files[thread_number] != nullptr);
     
     for (auto& b : records) {
@@ -667,6 +756,208 @@ void HTSWriter::initialize_sam_file(bam_hdr_t* header, size_t thread_number, boo
     }
 }
 
+void HTSWriter::initialize_pooled_file(bam_hdr_t* header) {
+    assert(pooled_file == nullptr);
+    
+    // Write straight to the output stream; the multiplexer is not used.
+    hFILE* backing_file = vg::io::hfile_wrap(pooled_stream);
+    pooled_file = hts_hopen(backing_file, "-", hts_mode.c_str());
+    if (pooled_file == nullptr) {
+        cerr << "[vg::HTSWriter] failed to open stream for writing " << format << " output" << endl;
+        exit(1);
+    }
+    
+    // Let htslib compress BGZF blocks on its own threads.
+    if (hts_set_threads(pooled_file, compression_threads) != 0) {
+        cerr << "[vg::HTSWriter] warning: could not use multiple threads to compress " << format << " output" << endl;
+    }
+    
+    if (sort_by_position && sam_hdr_update_hd(header, "SO", "coordinate") != 0) {
+        cerr << "[vg::HTSWriter] error: failed to mark the SAM header as sorted" << endl;
+        exit(1);
+    }
+    
+    if (sam_hdr_write(pooled_file, header) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to write the SAM header" << endl;
+        exit(1);
+    }
+    
+    pooled_writer = thread(&HTSWriter::pooled_writer_loop, this, header);
+}
+
+void HTSWriter::pooled_writer_loop(bam_hdr_t* header) {
+    vector<bam1_t*> records;
+    while (true) {
+        {
+            unique_lock<mutex> lock(pooled_mutex);
+            pooled_not_empty.wait(lock, [&]() { return !pooled_queue.empty() || stop_pooled_writer; });
+            if (pooled_queue.empty()) {
+                // We are stopping and there is nothing left.
+                break;
+            }
+            records = std::move(pooled_queue.front());
+            pooled_queue.pop_front();
+        }
+        pooled_not_full.notify_one();
+        
+        if (sort_by_position) {
+            // Hold onto the records until we can put them in order.
+            sort_buffer.insert(sort_buffer.end(), records.begin(), records.end());
+            records.clear();
+            if (sort_buffer.size() >= max_sort_buffer_records) {
+                spill_sort_buffer(header);
+            }
+            continue;
+        }
+        
+        for (auto& b : records) {
+            // Emit each record. The actual compression happens in htslib's thread pool.
+            if (sam_write1(pooled_file, header, b) < 0) {
+                cerr << "[vg::HTSWriter] error: writing to output file failed" << endl;
+                exit(1);
+            }
+            bam_destroy1(b);
+        }
+        records.clear();
+    }
+}
+
+void HTSWriter::finish_pooled_file() {
+    {
+        lock_guard<mutex> lock(pooled_mutex);
+        stop_pooled_writer = true;
+    }
+    pooled_not_empty.notify_all();
+    pooled_writer.join();
+    
+    if (sort_by_position) {
+        // Now that everything has come in, we can write it in order.
+        write_sorted_records(atomic_header.load());
+    }
+    
+    // Closing flushes all the compression threads and writes the BGZF EOF marker.
+    if (sam_close(pooled_file) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to close " << format << " output" << endl;
+        exit(1);
+    }
+    pooled_file = nullptr;
+}
+
+/// Order BAM records by reference position, with unplaced records last.
+static bool bam_position_less(const bam1_t* a, const bam1_t* b) {
+    // A tid of -1 becomes the largest value.
+    uint32_t tid_a = a->core.tid;
+    uint32_t tid_b = b->core.tid;
+    if (tid_a != tid_b) {
+        return tid_a < tid_b;
+    }
+    if (a->core.pos != b->core.pos) {
+        return a->core.pos < b->core.pos;
+    }
+    return bam_is_rev(a) < bam_is_rev(b);
+}
+
+void HTSWriter::spill_sort_buffer(bam_hdr_t* header) {
+    stable_sort(sort_buffer.begin(), sort_buffer.end(), bam_position_less);
+    
+    // Runs are only read back by us, so compress them lightly.
+    string run_name = temp_file::create("vg-hts-sort");
+    samFile* run_file = sam_open(run_name.c_str(), "wb1");
+    if (run_file == nullptr || sam_hdr_write(run_file, header) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to open temporary file " << run_name << " for sorting" << endl;
+        exit(1);
+    }
+    for (auto& b : sort_buffer) {
+        if (sam_write1(run_file, header, b) < 0) {
+            cerr << "[vg::HTSWriter] error: writing to temporary file " << run_name << " failed" << endl;
+            exit(1);
+        }
+        bam_destroy1(b);
+    }
+    sort_buffer.clear();
+    if (sam_close(run_file) != 0) {
+        cerr << "[vg::HTSWriter] error: failed to close temporary file " << run_name << endl;
+        exit(1);
+    }
+    sort_runs.push_back(run_name);
+}
+
+void HTSWriter::write_sorted_records(bam_hdr_t* header) {
+    if (sort_runs.empty()) {
+        // Everything fit in memory.
+        stable_sort(sort_buffer.begin(), sort_buffer.end(), bam_position_less);
+        for (auto& b : sort_buffer) {
+            if (sam_write1(pooled_file, header, b) < 0) {
+                cerr << "[vg::HTSWriter] error: writing to output file failed" << endl;
+                exit(1);
+            }
+            bam_destroy1(b);
+        }
+        sort_buffer.clear();
+        return;
+    }
+    
+    if (!sort_buffer.empty()) {
+        // Make the rest into a run too, so everything merges the same way.
+        spill_sort_buffer(header);
+    }
+    
+    // Open all the runs and read the first record of each.
+    vector<samFile*> run_files(sort_runs.size(), nullptr);
+    vector<bam1_t*> next_records(sort_runs.size(), nullptr);
+    auto read_next = [&](size_t i) {
+        int status = sam_read1(run_files[i], header, next_records[i]);
+        if (status < -1) {
+            cerr << "[vg::HTSWriter] error: reading temporary file " << sort_runs[i] << " failed" << endl;
+            exit(1);
+        }
+        return status >= 0;
+    };
+    // Take the earliest record next, and break ties by run, so equal records stay in the order they came in.
+    auto comes_later = [&](size_t i, size_t j) {
+        if (bam_position_less(next_records[j], next_records[i])) {
+            return true;
+        }
+        if (bam_position_less(next_records[i], next_records[j])) {
+            return false;
+        }
+        return i > j;
+    };
+    priority_queue<size_t, vector<size_t>, decltype(comes_later)> merge_queue(comes_later);
+    for (size_t i = 0; i < sort_runs.size(); ++i) {
+        run_files[i] = sam_open(sort_runs[i].c_str(), "r");
+        bam_hdr_t* run_header = run_files[i] == nullptr ? nullptr : sam_hdr_read(run_files[i]);
+        if (run_header == nullptr) {
+            cerr << "[vg::HTSWriter] error: failed to reopen temporary file " << sort_runs[i] << endl;
+            exit(1);
+        }
+        bam_hdr_destroy(run_header);
+        next_records[i] = bam_init1();
+        if (read_next(i)) {
+            merge_queue.push(i);
+        }
+    }
+    
+    while (!merge_queue.empty()) {
+        size_t i = merge_queue.top();
+        merge_queue.pop();
+        if (sam_write1(pooled_file, header, next_records[i]) < 0) {
+            cerr << "[vg::HTSWriter] error: writing to output file failed" << endl;
+            exit(1);
+        }
+        if (read_next(i)) {
+            merge_queue.push(i);
+        }
+    }
+    
+    for (size_t i = 0; i < sort_runs.size(); ++i) {
+        bam_destroy1(next_records[i]);
+        sam_close(run_files[i]);
+        temp_file::remove(sort_runs[i]);
+    }
+    sort_runs.clear();
+}
+
 HTSAlignmentEmitter::HTSAlignmentEmitter(const string& filename, const string& format,
                                          const vector<pair<string, int64_t>>& path_order_and_length,
                                          const unordered_map<string, int64_t>& subpath_to_length,
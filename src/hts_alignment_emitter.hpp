@@ -11,6 +11,7 @@
 #include <thread>
 #include <vector>
 #include <deque>
+#include <condition_variable>
 
 #include <htslib/hfile.h>
 #include <htslib/hts.h>
@@ -27,6 +28,8 @@ using namespace std;
 
 using namespace vg::io;
 
+class OrderedAlignmentEmitter;
+
 /**
  * Flag enum for controlling the behavior of alignment emitters behind get_alignment_emitter().
  */
@@ -44,7 +47,16 @@ enum alignment_emitter_flags_t {
     ALIGNMENT_EMITTER_FLAG_HTS_PRUNE_SUSPICIOUS_ANCHORS = 4,
     /// Emit graph alignments in named segment (i.e. GFA space) instead of
     /// numerical node ID space.
-    ALIGNMENT_EMITTER_FLAG_VG_USE_SEGMENT_NAMES = 8
+    ALIGNMENT_EMITTER_FLAG_VG_USE_SEGMENT_NAMES = 8,
+    /// When writing GAF in node ID space, format lines directly from the
+    /// Alignments instead of going through the general GAF converter.
+    ALIGNMENT_EMITTER_FLAG_GAF_DIRECT = 16,
+    /// When surjecting, build an index of where the target paths visit each
+    /// node up front, and look up path positions in it.
+    ALIGNMENT_EMITTER_FLAG_HTS_INDEX_PATHS = 32,
+    /// Sort HTSlib output by reference position, instead of writing records
+    /// in the order they are emitted.
+    ALIGNMENT_EMITTER_FLAG_HTS_SORTED = 64
 };
 
 /// Get an AlignmentEmitter that can emit to the given file (or "-") in the
@@ -52,15 +64,22 @@ enum alignment_emitter_flags_t {
 /// contain the paths in the linear reference in sequence dictionary order (see
 /// get_sequence_dictionary), and a PathPositionHandleGraph must be provided.
 /// When writing GAF, a HandleGraph must be provided for obtaining node lengths
-/// and sequences. Other formats do not need a graph.
+/// and sequences. GAMC is the columnar container from columnar_alignments.hpp.
+/// Other formats do not need a graph.
 ///
 /// flags is an ORed together set of flags from alignment_emitter_flags_t.
 ///
 /// Automatically applies per-thread buffering, but needs to know how many OMP
 /// threads will be in use.
+///
+/// If ordered is set, alignments are written in the order of the reads they
+/// belong to, and ordered is pointed at the OrderedAlignmentEmitter that needs
+/// to be told which read each thread is working on. It sits under any
+/// surjection or translation, so those still happen in the mapping threads.
 unique_ptr<AlignmentEmitter> get_alignment_emitter(const string& filename, const string& format, 
                                                    const vector<tuple<path_handle_t, size_t, size_t>>& paths, size_t max_threads,
-                                                   const HandleGraph* graph = nullptr, int flags = ALIGNMENT_EMITTER_FLAG_NONE);
+                                                   const HandleGraph* graph = nullptr, int flags = ALIGNMENT_EMITTER_FLAG_NONE,
+                                                   OrderedAlignmentEmitter** ordered = nullptr);
 
 /**
  * Produce a list of path handles in a fixed order, suitable for use with
@@ -99,7 +118,17 @@ pair<vector<pair<string, int64_t>>, unordered_map<string, int64_t>> extract_path
     bool subpath_support = false);
 
 /*
- * A class that can write SAM/BAM/CRAM files from parallel threads
+ * A class that can write SAM/BAM/CRAM files from parallel threads.
+ *
+ * For compressed formats written from multiple threads, records converted by
+ * the calling threads are handed off in batches to a single writer thread,
+ * which writes them to one samFile* whose BGZF compression is spread over an
+ * htslib thread pool. Otherwise, each thread writes its own samFile* into a
+ * StreamMultiplexer.
+ *
+ * When sorting by position, the writer thread always handles the output. It
+ * collects records in memory, spills sorted runs to temporary BAM files when
+ * too many build up, and merges everything into the output at the end.
  */
 class HTSWriter {
 public:
@@ -121,6 +150,18 @@ public:
     HTSWriter(HTSWriter&& other) = delete;
     HTSWriter& operator=(HTSWriter&& other) = delete;
     
+    /// Write records sorted by reference position rather than in the order
+    /// they are emitted, holding up to max_records_in_memory of them in
+    /// memory at once. Must be called before anything is emitted.
+    void set_sort_by_position(size_t max_records_in_memory = DEFAULT_SORT_BUFFER_RECORDS);
+    
+    /// How many records do we hold in memory while sorting, by default?
+    static const size_t DEFAULT_SORT_BUFFER_RECORDS;
+    
+    /// What zlib compression level (0-9) should HTSWriters created from now
+    /// on use for BAM and CRAM?
+    static int compression_level;
+    
 protected:
     
     /// We hack about with htslib's BGZF EOF footers, so we need to know how long they are.
@@ -172,6 +213,53 @@ protected:
     /// Remember the HTSlib mode string we need to open our files.
     string hts_mode;
     
+    /// True if we hand records to a single writer thread with pooled
+    /// compression, instead of having each thread write its own samFile*.
+    bool pooled;
+    /// How many threads should compress output in pooled mode?
+    size_t compression_threads;
+    /// The output stream to write to directly in pooled mode.
+    ostream& pooled_stream;
+    /// The single samFile* used in pooled mode, once the header is ready.
+    samFile* pooled_file = nullptr;
+    /// Batches of records waiting for the writer thread in pooled mode.
+    deque<vector<bam1_t*>> pooled_queue;
+    /// How many batches can wait before producers block?
+    size_t max_pooled_batches;
+    /// Set when the writer thread should finish up.
+    bool stop_pooled_writer = false;
+    /// Mutex protecting the pooled queue
+    mutex pooled_mutex;
+    condition_variable pooled_not_empty;
+    condition_variable pooled_not_full;
+    /// The thread writing out records in pooled mode.
+    thread pooled_writer;
+    
+    /// True if the writer thread sorts records by position before writing them.
+    bool sort_by_position = false;
+    /// How many records can the writer thread hold before spilling a sorted run?
+    size_t max_sort_buffer_records = DEFAULT_SORT_BUFFER_RECORDS;
+    /// Records the writer thread is holding to sort.
+    vector<bam1_t*> sort_buffer;
+    /// Temporary files holding sorted runs of records.
+    vector<string> sort_runs;
+    
+    /// Open the single samFile* for pooled mode, write the header, and start
+    /// the writer thread.
+    void initialize_pooled_file(bam_hdr_t* header);
+    
+    /// Main loop of the pooled mode writer thread.
+    void pooled_writer_loop(bam_hdr_t* header);
+    
+    /// Stop the pooled writer thread, write out everything, and close the file.
+    void finish_pooled_file();
+    
+    /// Sort the sort buffer and write it to a new temporary run file.
+    void spill_sort_buffer(bam_hdr_t* header);
+    
+    /// Merge the sort buffer and any spilled runs into the output file.
+    void write_sorted_records(bam_hdr_t* header);
+    
     /// Write and deallocate a bunch of BAM records. Takes care of locking the
     /// file. Header must have been written already.
     void save_records(bam_hdr_t* header, vector<bam1_t*>& records, size_t thread_number);
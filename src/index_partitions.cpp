@@ -0,0 +1,148 @@
+/**
+ * \file index_partitions.cpp
+ * Implementation for partition lists and merging mappings against partitions
+ */
+
+#include "index_partitions.hpp"
+#include "annotation.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+namespace vg {
+
+using namespace std;
+
+const string PARTITION_LIST_HEADER = "#vg-partitions";
+
+/// Get the directory part of a file name, with its trailing slash, or "" if
+/// there is none.
+static string directory_of(const string& filename) {
+    size_t slash = filename.rfind('/');
+    return slash == string::npos ? "" : filename.substr(0, slash + 1);
+}
+
+vector<IndexPartition> read_partition_list(const string& filename) {
+    ifstream in(filename);
+    string line;
+    if (!in || !getline(in, line) || line.compare(0, PARTITION_LIST_HEADER.size(), PARTITION_LIST_HEADER) != 0) {
+        cerr << "error:[read_partition_list] " << filename << " is not a partition list" << endl;
+        exit(1);
+    }
+
+    string directory = directory_of(filename);
+    auto resolve = [&](const string& name) {
+        return (name.empty() || name[0] == '/') ? name : directory + name;
+    };
+    vector<IndexPartition> partitions;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        vector<string> fields;
+        stringstream strm(line);
+        string field;
+        while (getline(strm, field, '\t')) {
+            fields.push_back(field);
+        }
+        if (fields.size() != 4) {
+            cerr << "error:[read_partition_list] line in " << filename << " does not have 4 fields: " << line << endl;
+            exit(1);
+        }
+        partitions.push_back({fields[0], resolve(fields[1]), resolve(fields[2]), resolve(fields[3])});
+    }
+    return partitions;
+}
+
+void write_partition_list(const string& filename, const vector<IndexPartition>& partitions) {
+    ofstream out(filename);
+    if (!out) {
+        cerr << "error:[write_partition_list] could not write partition list " << filename << endl;
+        exit(1);
+    }
+    string directory = directory_of(filename);
+    auto relative = [&](const string& name) {
+        if (!directory.empty() && name.compare(0, directory.size(), directory) == 0 &&
+            name.find('/', directory.size()) == string::npos) {
+            return name.substr(directory.size());
+        }
+        return name;
+    };
+    out << PARTITION_LIST_HEADER << "\n";
+    for (auto& partition : partitions) {
+        out << partition.name << "\t" << relative(partition.gbz) << "\t" << relative(partition.minimizers)
+            << "\t" << relative(partition.distance) << "\n";
+    }
+    if (!out) {
+        cerr << "error:[write_partition_list] could not write partition list " << filename << endl;
+        exit(1);
+    }
+}
+
+vector<Alignment> merge_partition_mappings(vector<vector<Alignment>>& mappings, const GSSWAligner& aligner,
+                                           size_t max_multimaps) {
+
+    // Gather all the alignments, and all the candidate scores the partitions
+    // computed their MAPQs from
+    vector<Alignment*> candidates;
+    vector<double> scores;
+    for (auto& partition : mappings) {
+        for (auto& aln : partition) {
+            candidates.push_back(&aln);
+        }
+        if (partition.empty() || partition.front().path().mapping_size() == 0) {
+            // Unmapped partitions don't compete
+            continue;
+        }
+        if (has_annotation(partition.front(), "secondary_scores")) {
+            for (double score : get_annotation<vector<double>>(partition.front(), "secondary_scores")) {
+                scores.push_back(score);
+            }
+        } else {
+            for (auto& aln : partition) {
+                scores.push_back(aln.score());
+            }
+        }
+    }
+
+    vector<Alignment> merged;
+    if (candidates.empty()) {
+        return merged;
+    }
+
+    // Mapped alignments come first, best score first, and ties go to the
+    // earlier partition
+    stable_sort(candidates.begin(), candidates.end(), [](const Alignment* a, const Alignment* b) {
+        bool a_mapped = a->path().mapping_size() != 0;
+        bool b_mapped = b->path().mapping_size() != 0;
+        if (a_mapped != b_mapped) {
+            return a_mapped;
+        }
+        return a->score() > b->score();
+    });
+
+    for (size_t i = 0; i < candidates.size() && merged.size() < max<size_t>(max_multimaps, 1); i++) {
+        if (i != 0 && candidates[i]->path().mapping_size() == 0) {
+            // Don't pass along unmapped secondaries
+            break;
+        }
+        merged.emplace_back(std::move(*candidates[i]));
+        merged.back().set_is_secondary(i != 0);
+    }
+
+    Alignment& primary = merged.front();
+    if (primary.path().mapping_size() != 0) {
+        sort(scores.begin(), scores.end(), greater<double>());
+        double mapq = aligner.compute_max_mapping_quality(scores, false);
+        set_annotation(primary, "secondary_scores", scores);
+        set_annotation(primary, "mapq_merged", mapq);
+        primary.set_mapping_quality(min<int32_t>(primary.mapping_quality(), mapq));
+    }
+
+    return merged;
+}
+
+}
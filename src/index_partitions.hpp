@@ -0,0 +1,64 @@
+#ifndef VG_INDEX_PARTITIONS_HPP_INCLUDED
+#define VG_INDEX_PARTITIONS_HPP_INCLUDED
+
+/**
+ * \file index_partitions.hpp
+ *
+ * Defines lists of index partitions, which split the giraffe indexes for a
+ * genome into one set per reference contig so that mapping only ever needs
+ * one set in memory, and the merging of a read's mappings against all the
+ * sets into one result.
+ *
+ * A partition list is a text file starting with a "#vg-partitions" header
+ * line, and then one tab-separated line per partition with its name and its
+ * GBZ, minimizer index, and distance index files. Relative file names are
+ * relative to the directory the list is in.
+ */
+
+#include <string>
+#include <vector>
+
+#include "vg/vg.pb.h"
+#include "aligner.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/// The first line of every partition list
+extern const string PARTITION_LIST_HEADER;
+
+/// The giraffe indexes for one partition of a genome.
+struct IndexPartition {
+    string name;
+    string gbz;
+    string minimizers;
+    string distance;
+};
+
+/// Read all the partitions in a partition list, with their files resolved
+/// relative to the list's directory. Reports an error and quits if the list
+/// can't be read.
+vector<IndexPartition> read_partition_list(const string& filename);
+
+/// Write a partition list. Files in the same directory as the list are
+/// listed by their base names.
+void write_partition_list(const string& filename, const vector<IndexPartition>& partitions);
+
+/**
+ * Merge the mappings of one read against several partitions. mappings holds
+ * the output of giraffe for the read against each partition: a primary
+ * alignment, possibly unmapped, and then any secondaries.
+ *
+ * The best-scoring alignment over all partitions becomes the primary, and up
+ * to max_multimaps - 1 of the others become secondaries. The primary's MAPQ
+ * is recomputed from the candidate scores of all the partitions (their
+ * secondary_scores annotations), and is never raised above what its own
+ * partition gave it. The alignments are moved out of mappings.
+ */
+vector<Alignment> merge_partition_mappings(vector<vector<Alignment>>& mappings, const GSSWAligner& aligner,
+                                           size_t max_multimaps = 1);
+
+}
+
+#endif
@@ -10,6 +10,9 @@
 #include <random>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <tuple>
 #include <chrono>
 #include <cctype>
 #include <cstdio>
@@ -19,6 +22,7 @@
 #include <omp.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <unistd.h>
 
 #include <bdsg/hash_graph.hpp>
 #include <bdsg/packed_graph.hpp>
@@ -46,6 +50,7 @@
 #include "gbwt_helper.hpp"
 #include "gbwtgraph_helper.hpp"
 #include "gcsa_helper.hpp"
+#include "mem_accelerator.hpp"
 #include "flat_file_back_translation.hpp"
 #include "kmer.hpp"
 #include "transcriptome.hpp"
@@ -59,6 +64,7 @@
 
 #include "algorithms/gfa_to_handle.hpp"
 #include "algorithms/prune.hpp"
+#include "pruning_overlay.hpp"
 #include "algorithms/component.hpp"
 #include "algorithms/find_translation.hpp"
 
@@ -97,6 +103,8 @@ double IndexingParameters::pruning_walk_length_increase_factor = 1.5;
 double IndexingParameters::pruning_max_node_degree_decrease_factor = 0.75;
 int IndexingParameters::gcsa_initial_kmer_length = gcsa::Key::MAX_LENGTH;
 int IndexingParameters::gcsa_doubling_steps = gcsa::ConstructionParameters::DOUBLING_STEPS;
+int IndexingParameters::mem_accelerator_length = 12;
+int IndexingParameters::mem_accelerator_long_length = 18;
 int64_t IndexingParameters::gcsa_size_limit = 2ll * 1024ll * 1024ll * 1024ll * 1024ll;
 int64_t IndexingParameters::gbwt_insert_batch_size = gbwt::DynamicGBWT::INSERT_BATCH_SIZE;
 int IndexingParameters::gbwt_insert_batch_size_increase_factor = 10;
@@ -130,6 +138,55 @@ void copy_file(const string& from_fp, const string& to_fp) {
     to_file << from_file.rdbuf();
 }
 
+// hard link a file if possible, otherwise copy it
+void link_or_copy_file(const string& from_fp, const string& to_fp) {
+    unlink(to_fp.c_str());
+    if (link(from_fp.c_str(), to_fp.c_str()) != 0) {
+        copy_file(from_fp, to_fp);
+    }
+}
+
+// describe the parameters that can change the contents of the given indexes,
+// changes to the parameters of their inputs are picked up through the inputs'
+// fingerprints
+string parameter_fingerprint(const IndexGroup& products) {
+    
+    auto mentions = [&](const string& term) {
+        for (const auto& product : products) {
+            if (product.find(term) != string::npos) {
+                return true;
+            }
+        }
+        return false;
+    };
+    
+    stringstream strm;
+    strm << "graph:" << (int) IndexingParameters::mut_graph_impl << ',' << IndexingParameters::max_node_size << ';';
+    if (mentions("Spliced") || mentions("Transcript") || mentions("GTF")) {
+        strm << "tx:" << IndexingParameters::gff_feature_name << ',' << IndexingParameters::gff_transcript_tag << ';';
+    }
+    if (mentions("Pruned")) {
+        strm << "prune:" << IndexingParameters::pruning_max_node_degree << ',' << IndexingParameters::pruning_walk_length
+             << ',' << IndexingParameters::pruning_max_edge_count << ',' << IndexingParameters::pruning_min_component_size << ';';
+    }
+    if (mentions("GCSA") || mentions("LCP")) {
+        strm << "gcsa:" << IndexingParameters::gcsa_initial_kmer_length << ',' << IndexingParameters::gcsa_doubling_steps << ';';
+    }
+    if (mentions("MEM Accelerator")) {
+        strm << "mema:" << IndexingParameters::mem_accelerator_length << ',' << IndexingParameters::mem_accelerator_long_length << ';';
+    }
+    if (mentions("GBWT") || mentions("GBZ")) {
+        strm << "gbwt:" << IndexingParameters::gbwt_sampling_interval << ',' << IndexingParameters::bidirectional_haplo_tx_gbwt
+             << ',' << IndexingParameters::path_cover_depth << ',' << IndexingParameters::giraffe_gbwt_downsample
+             << ',' << IndexingParameters::downsample_context_length << ',' << IndexingParameters::downsample_threshold << ';';
+    }
+    if (mentions("Minimizers")) {
+        strm << "min:" << IndexingParameters::use_bounded_syncmers << ',' << IndexingParameters::minimizer_k
+             << ',' << IndexingParameters::minimizer_w << ',' << IndexingParameters::minimizer_s << ';';
+    }
+    return strm.str();
+}
+
 // return file size in bytes
 int64_t get_file_size(const string& filename) {
     // get the file size
@@ -335,35 +392,6 @@ vector<string> vcf_contigs(const string& filename) {
     return return_val;
 }
 
-// Returns a guess for an appropriate number of parallel GBWT construction jobs.
-// This is intended for GBWT recipes where the construction uses an external
-// mechanism for parallelism.
-size_t guess_parallel_gbwt_jobs(size_t node_count, size_t haplotype_count, size_t available_memory, size_t batch_size) {
-
-    // Memory usage of the GBWT construction itself.
-    size_t bytes_per_node = 135 * std::max(std::log10(haplotype_count + 1), 1.0);
-    // Construction buffers typically use 3-4 bytes per node, and the builder has two buffers.
-    size_t bytes_per_job = batch_size * 8;
-
-    size_t jobs = 1;
-    size_t max_jobs = get_thread_count();
-    // We assume that the largest chromosome is 10% of the genome.
-    size_t job_size = std::max(node_count / 10, size_t(1));
-    size_t memory_usage = bytes_per_node * job_size + bytes_per_job;
-
-    while (jobs < max_jobs) {
-        // We assume that the next chromosome is 5% smaller than the previous one.
-        job_size = std::max(size_t(job_size * 0.95), size_t(1));
-        memory_usage += bytes_per_node * job_size + bytes_per_job;
-        if (memory_usage > available_memory) {
-            break;
-        }
-        jobs++;
-    }
-
-    return jobs;
-}
-
 // Returns the in-memory size of an XG index in bytes, using the same approach as
 // sdsl::size_in_bytes().
 size_t xg_index_size(const xg::XG& index) {
@@ -527,6 +555,7 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
     registry.register_index("LCP", "gcsa.lcp");
     registry.register_index("Spliced GCSA", "spliced.gcsa");
     registry.register_index("Spliced LCP", "spliced.gcsa.lcp");
+    registry.register_index("Spliced MEM Accelerator", "spliced.gcsa.mema");
     
     registry.register_index("GBWT", "gbwt");
     registry.register_index("Spliced GBWT", "spliced.gbwt");
@@ -1778,6 +1807,7 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         }
         
         JobSchedule schedule(approx_job_requirements, strip_chunk);
+        schedule.set_logging(IndexingParameters::verbosity >= IndexingParameters::Debug);
         schedule.execute(plan->target_memory_usage());
         
         // return the filename(s)
@@ -2105,6 +2135,7 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         // construct the jobs in parallel, trying to use multithreading while also
         // restraining memory usage
         JobSchedule schedule(approx_job_requirements, make_graph);
+        schedule.set_logging(IndexingParameters::verbosity >= IndexingParameters::Debug);
         schedule.execute(plan->target_memory_usage());
         
         // merge the ID spaces if we need to
@@ -2147,6 +2178,7 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
             };
             
             JobSchedule schedule(approx_job_requirements, increment_node_ids);
+            schedule.set_logging(IndexingParameters::verbosity >= IndexingParameters::Debug);
             schedule.execute(plan->target_memory_usage());
         }
         
@@ -2605,6 +2637,7 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         {
             // Do all the GBWT jobs
             JobSchedule schedule(approx_job_requirements, gbwt_job);
+            schedule.set_logging(IndexingParameters::verbosity >= IndexingParameters::Debug);
             schedule.execute(target_memory_usage);
         }
         
@@ -2636,6 +2669,7 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
             };
             
             JobSchedule schedule(approx_job_requirements, one_last_job);
+            schedule.set_logging(IndexingParameters::verbosity >= IndexingParameters::Debug);
             schedule.execute(target_memory_usage);
         }
         
@@ -2736,7 +2770,7 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
             parameters.sample_interval = IndexingParameters::gbwt_sampling_interval;
             std::int64_t available_memory = plan->target_memory_usage() - xg_index_size(*xg_index) - sdsl::size_in_bytes(*gbwt_index);
             parameters.parallel_jobs = guess_parallel_gbwt_jobs(
-                xg_index->get_node_count(),
+                algorithms::component_sizes(*xg_index),
                 parameters.num_paths,
                 std::max(available_memory, std::int64_t(0)),
                 parameters.batch_size
@@ -2821,7 +2855,7 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         parameters.sample_interval = IndexingParameters::gbwt_sampling_interval;
         std::int64_t available_memory = plan->target_memory_usage() - xg_index_size(*xg_index);
         parameters.parallel_jobs = guess_parallel_gbwt_jobs(
-            xg_index->get_node_count(),
+            algorithms::component_sizes(*xg_index),
             parameters.num_paths,
             std::max(available_memory, std::int64_t(0)),
             parameters.batch_size
@@ -3024,6 +3058,7 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         }
         
         JobSchedule schedule(approx_job_requirements, haplo_tx_job);
+        schedule.set_logging(IndexingParameters::verbosity >= IndexingParameters::Debug);
         schedule.execute(target_memory_usage);
         
         if (making_hsts) {
@@ -3417,6 +3452,25 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
             unique_ptr<MutablePathDeletableHandleGraph> graph
                 = vg::io::VPKG::load_one<MutablePathDeletableHandleGraph>(infile_vg);
             
+            // prune the graph based on topology, at first just hiding what we
+            // remove so that we can still bring back the embedded paths without
+            // loading a second copy of the graph
+            PruningOverlay pruned(graph.get());
+            size_t removed_high_degree = 0, removed_complex, removed_subgraph;
+            if (IndexingParameters::pruning_max_node_degree != 0) {
+                removed_high_degree = algorithms::remove_high_degree_nodes(pruned, IndexingParameters::pruning_max_node_degree);
+            }
+            removed_complex = algorithms::prune_complex_with_head_tail(pruned, IndexingParameters::pruning_walk_length,
+                                                                       IndexingParameters::pruning_max_edge_count);
+            removed_subgraph = algorithms::prune_short_subgraphs(pruned, IndexingParameters::pruning_min_component_size);
+            
+            bool removed_any = (removed_high_degree != 0 || removed_complex != 0 || removed_subgraph != 0);
+            
+            if (removed_any && !using_haplotypes && graph->get_path_count() != 0) {
+                // we can bring back edges on embedded paths
+                algorithms::restore_paths(pruned, *graph);
+            }
+            
             // destroy all paths, which might be made inconsistent
             vector<path_handle_t> paths;
             paths.reserve(graph->get_path_count());
@@ -3427,19 +3481,17 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
                 graph->destroy_path(path);
             }
             
-            // prune the graph based on topology
-            size_t removed_high_degree, removed_complex, removed_subgraph;
-            if (IndexingParameters::pruning_max_node_degree != 0) {
-                removed_high_degree = algorithms::remove_high_degree_nodes(*graph, IndexingParameters::pruning_max_node_degree);
+            // and actually do the pruning
+            pruned.apply(*graph);
+            
+            if (removed_any && !using_haplotypes && !paths.empty()
+                && IndexingParameters::verbosity >= IndexingParameters::Debug) {
+                #pragma omp critical (cerr)
+                std::cerr << "Restored graph: " << graph->get_node_count() << " nodes" << std::endl;
             }
-            removed_complex = algorithms::prune_complex_with_head_tail(*graph, IndexingParameters::pruning_walk_length,
-                                                                       IndexingParameters::pruning_max_edge_count);
-            removed_subgraph = algorithms::prune_short_subgraphs(*graph, IndexingParameters::pruning_min_component_size);
-
 
-            if ((removed_high_degree != 0 || removed_complex != 0 || removed_subgraph != 0)
-                && (!paths.empty() || using_haplotypes)) {
-                // we've removed from this graph but there are paths/threads we could use
+            if (removed_any && using_haplotypes) {
+                // we've removed from this graph but there are threads we could use
                 // to restore the graph
                 
                 // TODO: in a single component graph, it would be more efficient to load
@@ -3450,27 +3502,17 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
                 unique_ptr<PathHandleGraph> unpruned_graph
                     = vg::io::VPKG::load_one<PathHandleGraph>(infile_unpruned_vg);
                 
-                if (!using_haplotypes) {
-                    // we can bring back edges on embedded paths
-                    
-                    // Make an empty GBWT index to pass along
-                    gbwt::GBWT empty_gbwt;
-                    PhaseUnfolder unfolder(*unpruned_graph, empty_gbwt, max_node_id + 1);
-                    unfolder.restore_paths(*graph, IndexingParameters::verbosity >= IndexingParameters::Debug);
-                }
-                else {
-                    // we can expand out complex regions using haplotypes as well as paths
-                    
-                    // TODO: can't do this fully in parallel because each chunk needs to modify
-                    // the same mapping
-                    // TODO: it's a bit inelegant that i keep overwriting the mapping...
-                    PhaseUnfolder unfolder(*unpruned_graph, *gbwt_index, max_node_id + 1);
-                    unfold_lock.lock();
-                    unfolder.read_mapping(mapping_name);
-                    unfolder.unfold(*graph, IndexingParameters::verbosity >= IndexingParameters::Debug);
-                    unfolder.write_mapping(mapping_name);
-                    unfold_lock.unlock();
-                }
+                // we can expand out complex regions using haplotypes as well as paths
+                
+                // TODO: can't do this fully in parallel because each chunk needs to modify
+                // the same mapping
+                // TODO: it's a bit inelegant that i keep overwriting the mapping...
+                PhaseUnfolder unfolder(*unpruned_graph, *gbwt_index, max_node_id + 1);
+                unfold_lock.lock();
+                unfolder.read_mapping(mapping_name);
+                unfolder.unfold(*graph, IndexingParameters::verbosity >= IndexingParameters::Debug);
+                unfolder.write_mapping(mapping_name);
+                unfold_lock.unlock();
             }
             
             vg::io::save_handle_graph(graph.get(), outfile_vg);
@@ -3486,12 +3528,13 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         }
         vector<pair<int64_t, int64_t>> approx_job_requirements;
         for (int64_t i = 0; i < graph_names.size(); ++i) {
-            // for paths, double the memory because we'll probably need to re-load the graph to restore paths
+            // paths are restored in place, so we only need one copy of the graph
             approx_job_requirements.emplace_back(get_file_size(graph_names[i]),
-                                                 (using_haplotypes ? 1 : 2) * approx_graph_load_memory(graph_names[i]));
+                                                 approx_graph_load_memory(graph_names[i]));
         }
         
         JobSchedule schedule(approx_job_requirements, prune_job);
+        schedule.set_logging(IndexingParameters::verbosity >= IndexingParameters::Debug);
         schedule.execute(target_memory_usage);
         
         return all_outputs;
@@ -3630,6 +3673,10 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
                          "Rewinding to pruning step with more aggressive pruning to simplify the graph.";
             throw RewindPlanException(msg, pruned_graphs);
         }
+        if (IndexingParameters::verbosity >= IndexingParameters::Basic) {
+            cerr << "[IndexRegistry]: Wrote " << kmer_bytes << " bytes of k-mers for GCSA2 indexing with a disk use limit of "
+                 << params.getLimitBytes() << " bytes." << endl;
+        }
         
         // it seems to only keep the lowest 8 bits of the exit code? this is hack-y, but it gives us the correct
         // code to compare to...
@@ -3719,6 +3766,41 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         return construct_gcsa(inputs, plan, constructing);
     });
     
+    registry.register_recipe({"Spliced MEM Accelerator"}, {"Spliced GCSA"},
+                             [](const vector<const IndexFile*>& inputs,
+                                const IndexingPlan* plan,
+                                AliasGraph& alias_graph,
+                                const IndexGroup& constructing) {
+        if (IndexingParameters::verbosity != IndexingParameters::None) {
+            cerr << "[IndexRegistry]: Memoizing GCSA2 queries." << endl;
+        }
+        
+        assert(inputs.size() == 1);
+        auto gcsa_filenames = inputs[0]->get_filenames();
+        assert(gcsa_filenames.size() == 1);
+        assert(constructing.size() == 1);
+        vector<vector<string>> all_outputs(constructing.size());
+        auto output_accelerator = *constructing.begin();
+        auto& output_names = all_outputs[0];
+        
+        gcsa::GCSA gcsa_index;
+        load_gcsa(gcsa_index, gcsa_filenames.front(), IndexingParameters::verbosity >= IndexingParameters::Debug);
+        
+        // don't make a huge table for a small graph, same as vg mpmap
+        int k = min<int>(IndexingParameters::mem_accelerator_length,
+                         round(log(max<size_t>(gcsa_index.size(), 4)) / log(4.0)));
+        int long_k = min<int>(IndexingParameters::mem_accelerator_long_length, k + 6);
+        MEMAccelerator accelerator(gcsa_index, k, long_k);
+        
+        string output_name = plan->output_filepath(output_accelerator);
+        ofstream outfile;
+        init_out(outfile, output_name);
+        accelerator.serialize(outfile);
+        
+        output_names.push_back(output_name);
+        return all_outputs;
+    });
+    
     ////////////////////////////////////
     // Snarls Recipes
     ////////////////////////////////////
@@ -3914,12 +3996,17 @@ IndexRegistry VGIndexes::get_vg_index_registry() {
         params.batch_size = IndexingParameters::gbwt_insert_batch_size;
         params.sample_interval = IndexingParameters::gbwt_sampling_interval;
         params.max_node_length = IndexingParameters::max_node_size;
-        // TODO: Here we assume that the GFA file contains 100 haplotypes. If there are more,
-        // we could safely launch more jobs. Using 600 as the divisor would be a better
-        // estimate of the number of segments, but we chop long segments to 32 bp nodes.
+        // Count the nodes and haplotypes we will be building for, so we can
+        // run as many component jobs at once as fit in memory.
+        GFAStatistics gfa_stats = scan_gfa(gfa_filename, params.max_node_length, get_thread_count());
+        if (gfa_stats.segments == 0) {
+            // We couldn't scan it, so guess from the file size and assume 100 haplotypes.
+            gfa_stats.nodes = get_file_size(gfa_filename) / 300;
+            gfa_stats.walks = 100;
+        }
         params.parallel_jobs = guess_parallel_gbwt_jobs(
-            std::max(get_file_size(gfa_filename) / 300, std::int64_t(1)),
-            100,
+            std::max(gfa_stats.nodes, size_t(1)),
+            std::max(gfa_stats.paths + gfa_stats.walks, size_t(1)),
             plan->target_memory_usage(),
             params.batch_size
         );
@@ -4134,7 +4221,8 @@ vector<IndexName> VGIndexes::get_default_mpmap_indexes() {
         "Spliced XG",
         "Spliced Distance Index",
         "Spliced GCSA",
-        "Spliced LCP"
+        "Spliced LCP",
+        "Spliced MEM Accelerator"
     };
     return indexes;
 }
@@ -4246,7 +4334,8 @@ IndexRegistry::IndexRegistry(IndexRegistry&& other) :
     registered_suffixes(std::move(other.registered_suffixes)),
     work_dir(std::move(other.work_dir)),
     output_prefix(std::move(other.output_prefix)),
-    keep_intermediates(std::move(other.keep_intermediates)) {
+    keep_intermediates(std::move(other.keep_intermediates)),
+    cache_dir(std::move(other.cache_dir)) {
     
     // Make sure other doesn't delete our work dir when it goes away
     other.work_dir.clear();
@@ -4259,6 +4348,7 @@ IndexRegistry& IndexRegistry::operator=(IndexRegistry&& other) {
     work_dir = std::move(other.work_dir);
     output_prefix = std::move(other.output_prefix);
     keep_intermediates = std::move(other.keep_intermediates);
+    cache_dir = std::move(other.cache_dir);
     
     // Make sure other doesn't delete our work dir when it goes away
     other.work_dir.clear();
@@ -4278,6 +4368,129 @@ void IndexRegistry::set_intermediate_file_keeping(bool keep_intermediates) {
     this->keep_intermediates = keep_intermediates;
 }
 
+void IndexRegistry::set_cache_directory(const string& cache_dir) {
+    if (mkdir(cache_dir.c_str(), 0777) != 0 && errno != EEXIST) {
+        cerr << "error:[IndexRegistry] Couldn't create cache directory " << cache_dir << endl;
+        exit(1);
+    }
+    this->cache_dir = cache_dir;
+}
+
+string IndexRegistry::recipe_fingerprint(const RecipeName& recipe_name,
+                                         const map<IndexName, string>& index_fingerprints) const {
+    
+    stringstream strm;
+    strm << to_string(recipe_name.first) << '\t' << recipe_name.second << '\n';
+    strm << parameter_fingerprint(recipe_name.first) << '\n';
+    for (auto input : get_recipe(recipe_name).inputs) {
+        strm << input->get_identifier() << '\t';
+        auto it = index_fingerprints.find(input->get_identifier());
+        if (it != index_fingerprints.end() && !input->was_provided_directly()) {
+            strm << it->second;
+        }
+        else {
+            // we don't want to read through all of the input files, so we identify them
+            // by their path, size, and modification time
+            for (const auto& filename : input->get_filenames()) {
+                strm << filename;
+                struct stat file_stat;
+                if (stat(filename.c_str(), &file_stat) == 0) {
+                    strm << ',' << file_stat.st_size << ',' << file_stat.st_mtime;
+                }
+                strm << ';';
+            }
+        }
+        strm << '\n';
+    }
+    return sha1sum(strm.str());
+}
+
+vector<vector<string>> IndexRegistry::restore_from_cache(const string& fingerprint, const RecipeName& recipe_name,
+                                                         const IndexingPlan& plan) const {
+    
+    vector<vector<string>> recipe_results;
+    if (cache_dir.empty()) {
+        return recipe_results;
+    }
+    
+    string entry_dir = cache_dir + "/" + fingerprint;
+    ifstream manifest(entry_dir + "/manifest.tsv");
+    if (!manifest) {
+        return recipe_results;
+    }
+    
+    // the manifest lists the number of files for each index in the recipe's group
+    auto it = recipe_name.first.begin();
+    string line;
+    while (getline(manifest, line)) {
+        size_t tab = line.rfind('\t');
+        if (tab == string::npos || it == recipe_name.first.end() || line.substr(0, tab) != *it) {
+            recipe_results.clear();
+            return recipe_results;
+        }
+        size_t num_files = stoull(line.substr(tab + 1));
+        recipe_results.emplace_back();
+        for (size_t j = 0; j < num_files; ++j) {
+            string cached_filename = entry_dir + "/" + std::to_string(recipe_results.size() - 1) + "." + std::to_string(j);
+            if (!ifstream(cached_filename)) {
+                recipe_results.clear();
+                return recipe_results;
+            }
+            string filename = plan.output_filepath(*it, j, num_files);
+            link_or_copy_file(cached_filename, filename);
+            recipe_results.back().emplace_back(move(filename));
+        }
+        ++it;
+    }
+    if (it != recipe_name.first.end()) {
+        recipe_results.clear();
+    }
+    return recipe_results;
+}
+
+void IndexRegistry::save_to_cache(const string& fingerprint, const RecipeName& recipe_name,
+                                  const vector<vector<string>>& recipe_results) const {
+    if (cache_dir.empty()) {
+        return;
+    }
+    
+    // recipes that pass their inputs along are cheap to redo, and we don't want to
+    // duplicate the inputs
+    unordered_set<string> input_filenames;
+    for (auto input : get_recipe(recipe_name).inputs) {
+        input_filenames.insert(input->get_filenames().begin(), input->get_filenames().end());
+    }
+    for (const auto& results : recipe_results) {
+        for (const auto& filename : results) {
+            if (input_filenames.count(filename)) {
+                return;
+            }
+        }
+    }
+    
+    string entry_dir = cache_dir + "/" + fingerprint;
+    if (mkdir(entry_dir.c_str(), 0777) != 0 && errno != EEXIST) {
+        cerr << "warning:[IndexRegistry] Couldn't create cache directory " << entry_dir << ", not caching " << to_string(recipe_name.first) << endl;
+        return;
+    }
+    for (size_t i = 0; i < recipe_results.size(); ++i) {
+        for (size_t j = 0; j < recipe_results[i].size(); ++j) {
+            link_or_copy_file(recipe_results[i][j], entry_dir + "/" + std::to_string(i) + "." + std::to_string(j));
+        }
+    }
+    
+    // write the manifest last so that an interrupted save never looks finished
+    {
+        ofstream manifest(entry_dir + "/manifest.tsv.tmp");
+        auto it = recipe_name.first.begin();
+        for (const auto& results : recipe_results) {
+            manifest << *it << '\t' << results.size() << '\n';
+            ++it;
+        }
+    }
+    rename((entry_dir + "/manifest.tsv.tmp").c_str(), (entry_dir + "/manifest.tsv").c_str());
+}
+
 void IndexRegistry::make_indexes(const vector<IndexName>& identifiers) {
     
     // figure out the best plan to make the objectives from the inputs
@@ -4290,61 +4503,253 @@ void IndexRegistry::make_indexes(const vector<IndexName>& identifiers) {
     list<RecipeName> steps_remaining(plan.get_steps().begin(), plan.get_steps().end());
     list<RecipeName> steps_completed;
     
-    // execute the plan
-    while (!steps_remaining.empty()) {
-        // get the next step
-        auto step = move(steps_remaining.front());
-        steps_remaining.pop_front();
-        steps_completed.push_back(step);
+    // which step of the plan makes each index, so we can tell when a step's inputs are ready
+    map<IndexName, RecipeName> step_producing;
+    for (const auto& step : plan.get_steps()) {
+        for (const auto& index_name : step.first) {
+            step_producing[index_name] = step;
+        }
+    }
+    
+    // steps that have been started and have not been rewound
+    set<RecipeName> steps_finished;
+    auto is_ready = [&](const RecipeName& step) {
+        for (auto input : get_recipe(step).inputs) {
+            auto it = step_producing.find(input->get_identifier());
+            if (it != step_producing.end() && it->second != step && !steps_finished.count(it->second)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    // the inputs are all finished by the time we ask, so we can estimate the memory
+    // needed to load them the same way the recipes estimate their jobs for JobSchedule
+    auto approx_step_memory = [&](const RecipeName& step) {
+        int64_t memory = 0;
+        for (auto input : get_recipe(step).inputs) {
+            if (input->is_finished()) {
+                for (const auto& filename : input->get_filenames()) {
+                    memory += get_file_size(filename);
+                }
+            }
+        }
+        return memory;
+    };
+    
+    int total_threads = get_thread_count();
+    int64_t target_memory_usage = plan.target_memory_usage();
+    
+    // the steps that are executing, with their memory estimates and threads
+    map<RecipeName, pair<int64_t, int>> steps_running;
+    map<RecipeName, thread> workers;
+    int64_t memory_in_use = 0;
+    int threads_in_use = 0;
+    
+    // steps that have returned, along with their results or the exception they threw
+    mutex returned_lock;
+    condition_variable returned_cond;
+    list<tuple<RecipeName, vector<vector<string>>, exception_ptr>> steps_returned;
+    
+    // exceptions that we need to handle once everything in flight has stopped
+    vector<exception_ptr> rewinds;
+    exception_ptr failure;
+    
+    // hashes of the recipes' inputs and parameters, for caching results between runs
+    map<IndexName, string> index_fingerprints;
+    map<RecipeName, string> step_fingerprints;
+    set<RecipeName> cache_misses;
+    
+    auto record_results = [&](const RecipeName& step, const vector<vector<string>>& recipe_results) {
+        assert(recipe_results.size() == step.first.size());
+        auto it = step.first.begin();
+        for (const auto& results : recipe_results) {
+            auto index = get_index(*it);
+            // don't overwrite directly-provided inputs
+            if (!index->was_provided_directly()) {
+                // and assign the new (or first) ones
+                index->assign_constructed(results);
+            }
+            if (!cache_dir.empty()) {
+                index_fingerprints[*it] = step_fingerprints[step];
+            }
+            ++it;
+        }
+        steps_finished.insert(step);
+    };
+    
+    // execute the plan, running independent steps at the same time if they fit
+    // within the memory budget
+    while (!steps_remaining.empty() || !steps_running.empty()) {
+        
+        if (rewinds.empty() && !failure && !cache_dir.empty()) {
+            // finish any ready steps that we already have in the cache, which might
+            // make more steps ready
+            bool restored = true;
+            while (restored) {
+                restored = false;
+                for (auto it = steps_remaining.begin(); it != steps_remaining.end();) {
+                    if (cache_misses.count(*it) || !is_ready(*it)) {
+                        ++it;
+                        continue;
+                    }
+                    step_fingerprints[*it] = recipe_fingerprint(*it, index_fingerprints);
+                    auto recipe_results = restore_from_cache(step_fingerprints[*it], *it, plan);
+                    if (recipe_results.empty()) {
+                        cache_misses.insert(*it);
+                        ++it;
+                        continue;
+                    }
+                    if (IndexingParameters::verbosity != IndexingParameters::None) {
+                        cerr << "[IndexRegistry]: Reusing cached " << to_string(it->first) << "." << endl;
+                    }
+                    steps_completed.push_back(*it);
+                    record_results(*it, recipe_results);
+                    it = steps_remaining.erase(it);
+                    restored = true;
+                }
+            }
+        }
         
-        // do the recipe
-        try {
-            auto recipe_results = execute_recipe(step, &plan, alias_graph);
-            
-            // the recipe executed successfully
-            assert(recipe_results.size() == step.first.size());
+        if (rewinds.empty() && !failure) {
+            // choose steps that can start now, greedily in plan order
+            vector<pair<list<RecipeName>::iterator, int64_t>> to_start;
+            int64_t memory_planned = memory_in_use;
+            for (auto it = steps_remaining.begin(); it != steps_remaining.end()
+                 && threads_in_use + (int) to_start.size() < total_threads; ++it) {
+                if (!is_ready(*it)) {
+                    continue;
+                }
+                int64_t memory = approx_step_memory(*it);
+                if ((steps_running.empty() && to_start.empty()) || memory_planned + memory <= target_memory_usage) {
+                    to_start.emplace_back(it, memory);
+                    memory_planned += memory;
+                }
+            }
+            if (to_start.empty() && steps_running.empty()) {
+                // shouldn't happen with a well-ordered plan, but fall back on plan order
+                to_start.emplace_back(steps_remaining.begin(), approx_step_memory(steps_remaining.front()));
+            }
             
-            // record the results
-            auto it = step.first.begin();
-            for (const auto& results : recipe_results) {
-                auto index = get_index(*it);
-                // don't overwrite directly-provided inputs
-                if (!index->was_provided_directly()) {
-                    // and assign the new (or first) ones
-                    index->assign_constructed(results);
+            // split the idle threads among the steps that are starting
+            int idle_threads = max<int>(total_threads - threads_in_use, to_start.size());
+            for (size_t i = 0; i < to_start.size(); ++i) {
+                auto step = *to_start[i].first;
+                int num_threads = idle_threads / to_start.size() + (i < idle_threads % to_start.size());
+                
+                steps_remaining.erase(to_start[i].first);
+                steps_completed.push_back(step);
+                if (!cache_dir.empty()) {
+                    step_fingerprints[step] = recipe_fingerprint(step, index_fingerprints);
                 }
-                ++it;
+                steps_running[step] = make_pair(to_start[i].second, num_threads);
+                memory_in_use += to_start[i].second;
+                threads_in_use += num_threads;
+                
+#ifdef debug_index_registry
+                cerr << "starting recipe for " << to_string(step.first) << " with " << num_threads << " threads and estimated memory " << to_start[i].second << endl;
+#endif
+                
+                workers[step] = thread([&, step, num_threads]() {
+                    // OpenMP settings don't carry over to new threads
+                    omp_set_num_threads(num_threads);
+                    vector<vector<string>> recipe_results;
+                    exception_ptr ex;
+                    try {
+                        recipe_results = execute_recipe(step, &plan, alias_graph);
+                    }
+                    catch (...) {
+                        ex = current_exception();
+                    }
+                    lock_guard<mutex> lock(returned_lock);
+                    steps_returned.emplace_back(step, move(recipe_results), ex);
+                    returned_cond.notify_one();
+                });
             }
         }
-        catch (RewindPlanException& ex) {
+        
+        if (!steps_running.empty()) {
+            // wait for a step to return
+            RecipeName step;
+            vector<vector<string>> recipe_results;
+            exception_ptr ex;
+            {
+                unique_lock<mutex> lock(returned_lock);
+                returned_cond.wait(lock, [&]() { return !steps_returned.empty(); });
+                tie(step, recipe_results, ex) = move(steps_returned.front());
+                steps_returned.pop_front();
+            }
+            workers[step].join();
+            workers.erase(step);
+            memory_in_use -= steps_running[step].first;
+            threads_in_use -= steps_running[step].second;
+            steps_running.erase(step);
             
-            // the recipe failed, but we can rewind and retry following the recipe with
-            // modified parameters (which should have been set by the exception-throwing code)
-            if (IndexingParameters::verbosity != IndexingParameters::None) {
-                cerr << ex.what() << endl;
-            }
-            // gather the recipes we're going to need to re-attempt
-            const auto& rewinding_indexes = ex.get_indexes();
-            set<RecipeName> dependent_recipes;
-            for (const auto& index_name : rewinding_indexes) {
-                assert(index_registry.count(index_name));
-                for (const auto& recipe : plan.dependents(index_name)) {
-                    dependent_recipes.insert(recipe);
+            if (ex) {
+                try {
+                    rethrow_exception(ex);
+                }
+                catch (RewindPlanException&) {
+                    rewinds.push_back(ex);
                 }
+                catch (...) {
+                    failure = ex;
+                }
+                continue;
             }
             
-            // move rewound steps back onto the queue
-            vector<list<RecipeName>::iterator> to_move;
-            for (auto it = steps_completed.rbegin(); it != steps_completed.rend(); ++it) {
-                if (dependent_recipes.count(*it)) {
-                    to_move.push_back(--it.base());
-                }
+            // the recipe executed successfully
+            record_results(step, recipe_results);
+            save_to_cache(step_fingerprints[step], step, recipe_results);
+        }
+        
+        if (!steps_running.empty()) {
+            continue;
+        }
+        if (failure) {
+            rethrow_exception(failure);
+        }
+        
+        for (auto& rewind : rewinds) {
+            try {
+                rethrow_exception(rewind);
             }
-            for (auto& it : to_move) {
-                steps_remaining.emplace_front(*it);
-                steps_completed.erase(it);
+            catch (RewindPlanException& ex) {
+                
+                // the recipe failed, but we can rewind and retry following the recipe with
+                // modified parameters (which should have been set by the exception-throwing code)
+                if (IndexingParameters::verbosity != IndexingParameters::None) {
+                    cerr << ex.what() << endl;
+                }
+                // gather the recipes we're going to need to re-attempt
+                const auto& rewinding_indexes = ex.get_indexes();
+                set<RecipeName> dependent_recipes;
+                for (const auto& index_name : rewinding_indexes) {
+                    assert(index_registry.count(index_name));
+                    for (const auto& recipe : plan.dependents(index_name)) {
+                        dependent_recipes.insert(recipe);
+                    }
+                }
+                
+                // move rewound steps back onto the queue
+                vector<list<RecipeName>::iterator> to_move;
+                for (auto it = steps_completed.rbegin(); it != steps_completed.rend(); ++it) {
+                    if (dependent_recipes.count(*it)) {
+                        to_move.push_back(--it.base());
+                    }
+                }
+                for (auto& it : to_move) {
+                    steps_finished.erase(*it);
+                    step_fingerprints.erase(*it);
+                    steps_remaining.emplace_front(*it);
+                    steps_completed.erase(it);
+                }
             }
         }
+        if (!rewinds.empty()) {
+            // the parameters have changed, so the cache might have some of these now
+            cache_misses.clear();
+        }
+        rewinds.clear();
     }
 #ifdef debug_index_registry
     cerr << "finished executing recipes, resolving aliases" << endl;
@@ -5493,6 +5898,7 @@ IndexGroup IndexRecipe::input_group() const {
 
 void AliasGraph::register_alias(const IndexName& aliasor, const IndexFile* aliasee) {
     assert(aliasee->get_identifier() != aliasor);
+    lock_guard<mutex> lock(graph_lock);
     graph[aliasee->get_identifier()].emplace_back(aliasor);
 }
 
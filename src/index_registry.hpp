@@ -11,6 +11,7 @@
 #include <memory>
 #include <stdexcept>
 #include <limits>
+#include <mutex>
 
 namespace vg {
 
@@ -80,6 +81,10 @@ struct IndexingParameters {
     static int gcsa_initial_kmer_length;
     // number of k-mer length doubling steps in GCSA2 [4]
     static int gcsa_doubling_steps;
+    // length of the k-mers whose GCSA2 ranges are all memoized for mpmap [12]
+    static int mem_accelerator_length;
+    // length of the frequent k-mers whose GCSA2 ranges are also memoized for mpmap [18]
+    static int mem_accelerator_long_length;
     // disk limit for temporary files in bytes [2TB]
     static int64_t gcsa_size_limit;
     // number of gbwt nodes inserted at a time in dynamic gbwt [100M]
@@ -222,6 +227,11 @@ public:
     /// or the temp directory?
     void set_intermediate_file_keeping(bool keep_intermediates);
     
+    /// Save the results of finished recipes in this directory, keyed by a hash
+    /// of their inputs and parameters, so that later runs can reuse them
+    /// instead of rebuilding. The directory is created if necessary.
+    void set_cache_directory(const string& cache_dir);
+    
     /// Register an index containing the given identifier
     void register_index(const IndexName& identifier, const string& suffix);
     
@@ -299,6 +309,21 @@ protected:
     vector<vector<string>> execute_recipe(const RecipeName& recipe_name, const IndexingPlan* plan,
                                           AliasGraph& alias_graph);
     
+    /// Hash the recipe's inputs and the parameters that affect its results, using
+    /// the given hashes for indexes that were made earlier in the plan
+    string recipe_fingerprint(const RecipeName& recipe_name,
+                              const map<IndexName, string>& index_fingerprints) const;
+    
+    /// If the cache contains the results of the recipe with this fingerprint,
+    /// put them where the plan expects them and return them. Otherwise return
+    /// an empty vector.
+    vector<vector<string>> restore_from_cache(const string& fingerprint, const RecipeName& recipe_name,
+                                              const IndexingPlan& plan) const;
+    
+    /// Save the results of the recipe with this fingerprint in the cache
+    void save_to_cache(const string& fingerprint, const RecipeName& recipe_name,
+                       const vector<vector<string>>& recipe_results) const;
+    
     /// access index file
     IndexFile* get_index(const IndexName& identifier);
     
@@ -333,6 +358,9 @@ protected:
     /// should intermediate files end up in the scratch or the output directory?
     bool keep_intermediates = false;
     
+    /// directory where finished recipe results are cached between runs, if any
+    string cache_dir;
+    
     /// the max memory we will *attempt* to use
     int64_t target_memory_usage = numeric_limits<int64_t>::max();
 };
@@ -421,6 +449,9 @@ private:
     // graph aliasees to their aliasors
     unordered_map<IndexName, vector<IndexName>> graph;
     
+    // recipes can be executed concurrently, so registration is guarded
+    mutex graph_lock;
+    
 };
 
 
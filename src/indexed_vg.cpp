@@ -5,18 +5,23 @@
 
 #include "indexed_vg.hpp"
 #include "utility.hpp"
+#include "wang_hash.hpp"
 #include "vg/io/json2pb.h"
 
 #include <handlegraph/util.hpp>
 
+#include <algorithm>
+
 #include <atomic>
 
 namespace vg {
 
 using namespace std;
 
-IndexedVG::IndexedVG(string graph_filename) : vg_filename(graph_filename), index(),
-    cursor_streams(), cursor_pool(), cursor_pool_mutex(), group_cache(100), cache_mutex() {
+IndexedVG::IndexedVG(string graph_filename, size_t cache_bytes) : vg_filename(graph_filename), index(),
+    cursor_streams(), cursor_pool(), cursor_pool_mutex(), cache_shards(CACHE_SHARDS),
+    shard_capacity(cache_bytes / CACHE_SHARDS), cache_hits(0), cache_misses(0),
+    prefetch_enabled(true), stop_prefetching(false) {
     
     // Decide where the index ought to be stored
     string index_filename = vg_filename + ".vgi";
@@ -50,12 +55,32 @@ IndexedVG::IndexedVG(string graph_filename) : vg_filename(graph_filename), index
     
 }
 
+IndexedVG::~IndexedVG() {
+    {
+        lock_guard<mutex> lock(prefetch_mutex);
+        stop_prefetching = true;
+    }
+    prefetch_wakeup.notify_all();
+    if (prefetcher.joinable()) {
+        prefetcher.join();
+    }
+}
+
 void IndexedVG::print_report() const {
     cerr << cursor_streams.size() << " cursors outstanding, " << cursor_pool.size() << " cursors free" << endl;
-    cerr << group_cache.size() << " cache entries" << endl;
-    // TODO: Cache hit/miss counts from the LRUcache do not appear to be
-    // correct (hits seem to be counted as misses). So we don't report them
-    // here.
+    size_t entries = 0;
+    size_t bytes = 0;
+    for (auto& shard : cache_shards) {
+        lock_guard<mutex> lock(shard.shard_mutex);
+        entries += shard.entries.size();
+        bytes += shard.bytes;
+    }
+    cerr << entries << " cache entries using " << bytes << " bytes, "
+        << cache_hits.load() << " hits, " << cache_misses.load() << " misses" << endl;
+}
+
+void IndexedVG::set_prefetch(bool prefetch) {
+    prefetch_enabled = prefetch;
 }
 
 bool IndexedVG::has_node(id_t node_id) const {
@@ -437,51 +462,24 @@ bool IndexedVG::with_cache_entry(int64_t group_vo, const function<void(const Cac
     }
 
     // This will point to the cache entry for the group when we find or make it.
-    shared_ptr<CacheEntry> cache_entry;
-    
-    {
-        lock_guard<mutex> lock(cache_mutex);
-        // See if it is cached. Gets a pair of the item (if found) and a flag for whether it was found
-        auto cache_pair = group_cache.retrieve(group_vo);
-        if (cache_pair.second) {
-            // We found it
-            cache_entry = move(cache_pair.first);
-        }
-    }
+    shared_ptr<CacheEntry> cache_entry = cache_retrieve(group_vo);
 
-    if (!cache_entry) {
+    if (cache_entry) {
+        cache_hits++;
+    } else {
         // If it wasn't found, load it up. We could synchronize to do
         // this with the cache lock held, to stop all threads banging
         // on the disk until one of them caches it. But we probably
         // want to allow simultaneous reads from disk overall.
-        
-        with_cursor([&](cursor_t& cursor) {
-            // Try to get to the VO we are supposed to go to
-            auto pre_seek_group = cursor.tell_group();
-            if (!cursor.seek_group(group_vo)) {
-                cerr << "error[vg::IndexedVG]: Could not seek from group pos " << pre_seek_group
-                    << " to group pos " << group_vo << endl;
-                cerr << "Current position: group " << cursor.tell_group()
-                    << " has_current: " << cursor.has_current() << endl;
-                assert(false);
-            }
-            
-            if (cursor.has_current()) {
-                // We seeked to a real thing and not EOF
-            
-                // Read the group into a cache entry
-                cache_entry = shared_ptr<CacheEntry>(new CacheEntry(cursor));
-            }
-        });
+        cache_misses++;
+        cache_entry = load_group(group_vo);
         
         if (cache_entry) {
             // We actually found a valid group.
-            
-            lock_guard<mutex> lock(cache_mutex);
-            // Save a copy of the shared pointer into the cache
-            group_cache.put(group_vo, cache_entry);
+            cache_put(group_vo, cache_entry);
+            // We will probably want the next one soon.
+            request_prefetch(cache_entry->next_group);
         }
-        
     }
     
     if (cache_entry) {
@@ -495,6 +493,110 @@ bool IndexedVG::with_cache_entry(int64_t group_vo, const function<void(const Cac
     
 }
 
+shared_ptr<IndexedVG::CacheEntry> IndexedVG::load_group(int64_t group_vo) const {
+    shared_ptr<CacheEntry> cache_entry;
+    with_cursor([&](cursor_t& cursor) {
+        // Try to get to the VO we are supposed to go to
+        auto pre_seek_group = cursor.tell_group();
+        if (!cursor.seek_group(group_vo)) {
+            cerr << "error[vg::IndexedVG]: Could not seek from group pos " << pre_seek_group
+                << " to group pos " << group_vo << endl;
+            cerr << "Current position: group " << cursor.tell_group()
+                << " has_current: " << cursor.has_current() << endl;
+            assert(false);
+        }
+        
+        if (cursor.has_current()) {
+            // We seeked to a real thing and not EOF
+        
+            // Read the group into a cache entry
+            cache_entry = shared_ptr<CacheEntry>(new CacheEntry(cursor));
+        }
+    });
+    return cache_entry;
+}
+
+IndexedVG::CacheShard& IndexedVG::shard_for(int64_t group_vo) const {
+    return cache_shards[wang_hash_64(group_vo) % cache_shards.size()];
+}
+
+shared_ptr<IndexedVG::CacheEntry> IndexedVG::cache_retrieve(int64_t group_vo) const {
+    CacheShard& shard = shard_for(group_vo);
+    lock_guard<mutex> lock(shard.shard_mutex);
+    auto found = shard.entry_index.find(group_vo);
+    if (found == shard.entry_index.end()) {
+        return nullptr;
+    }
+    // Move it to the front, as the most recently used.
+    shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    return found->second->second;
+}
+
+void IndexedVG::cache_put(int64_t group_vo, const shared_ptr<CacheEntry>& entry) const {
+    CacheShard& shard = shard_for(group_vo);
+    lock_guard<mutex> lock(shard.shard_mutex);
+    if (shard.entry_index.count(group_vo)) {
+        // Another thread got it in first.
+        return;
+    }
+    shard.entries.emplace_front(group_vo, entry);
+    shard.entry_index[group_vo] = shard.entries.begin();
+    shard.bytes += entry->bytes;
+    // Evict from the back, but always keep the entry we just added.
+    while (shard.bytes > shard_capacity && shard.entries.size() > 1) {
+        auto& evicted = shard.entries.back();
+        shard.bytes -= evicted.second->bytes;
+        shard.entry_index.erase(evicted.first);
+        shard.entries.pop_back();
+    }
+}
+
+void IndexedVG::request_prefetch(int64_t group_vo) const {
+    if (!prefetch_enabled || group_vo == numeric_limits<int64_t>::max()) {
+        return;
+    }
+    {
+        lock_guard<mutex> lock(prefetch_mutex);
+        if (stop_prefetching) {
+            return;
+        }
+        if (!prefetcher.joinable()) {
+            prefetcher = thread(&IndexedVG::prefetch_loop, const_cast<IndexedVG*>(this));
+        }
+        if (std::find(prefetch_queue.begin(), prefetch_queue.end(), group_vo) != prefetch_queue.end()) {
+            return;
+        }
+        prefetch_queue.push_back(group_vo);
+        if (prefetch_queue.size() > MAX_PREFETCH_QUEUE) {
+            // Old requests are the least likely to still be useful.
+            prefetch_queue.pop_front();
+        }
+    }
+    prefetch_wakeup.notify_one();
+}
+
+void IndexedVG::prefetch_loop() {
+    unique_lock<mutex> lock(prefetch_mutex);
+    while (true) {
+        prefetch_wakeup.wait(lock, [&]() { return stop_prefetching || !prefetch_queue.empty(); });
+        if (stop_prefetching) {
+            return;
+        }
+        int64_t group_vo = prefetch_queue.back();
+        prefetch_queue.pop_back();
+        lock.unlock();
+        
+        if (!cache_retrieve(group_vo)) {
+            shared_ptr<CacheEntry> entry = load_group(group_vo);
+            if (entry) {
+                cache_put(group_vo, entry);
+            }
+        }
+        
+        lock.lock();
+    }
+}
+
 IndexedVG::CacheEntry::CacheEntry(cursor_t& cursor) {
     
     // We want to cache the group we are pointed at
@@ -529,6 +631,12 @@ IndexedVG::CacheEntry::CacheEntry(cursor_t& cursor) {
             id_to_edge_indices[edge.to()].push_back(i);
         }
     }
+    
+    // Estimate our size, counting a few pointers of overhead per hash table entry.
+    bytes = sizeof(CacheEntry) + merged_group.SpaceUsedLong();
+    bytes += id_to_node_index.size() * (sizeof(pair<id_t, size_t>) + 2 * sizeof(void*));
+    bytes += id_to_edge_indices.size() * (sizeof(pair<id_t, vector<size_t>>) + 2 * sizeof(void*));
+    bytes += 2 * merged_group.edge_size() * sizeof(size_t);
 }
 
 Graph IndexedVG::CacheEntry::query(const id_t& id) const {
@@ -6,11 +6,15 @@
  * Contains an implementation of a HandleGraph backed by a sorted, indexed .vg file
  */
 
-#include <lru_cache.h>
-
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <list>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "stream_index.hpp"
 #include "handle.hpp"
@@ -41,17 +45,30 @@ using namespace std;
  * make one if we don't have a free one.
  *
  * Internally we also keep a least-recently-used cache of indexed
- * merged-together graph groups. The cache is keyed by group start VO. The
- * cache holds shared pointers to cache entries, so that one thread can be
+ * merged-together graph groups, limited to a total size in bytes. The cache is
+ * keyed by group start VO, and split into shards with their own locks so that
+ * threads working in different parts of the graph don't wait on each other.
+ * The cache holds shared pointers to cache entries, so that one thread can be
  * evicting something from the cache while another is still working with it.
+ *
+ * Since nodes are in ID order in the file, and edges mostly go between nearby
+ * IDs, traversals tend to move on to the next group. So whenever we have to
+ * load a group, a background thread loads the group after it into the cache.
  */
 class IndexedVG : public HandleGraph {
 
 public:
 
+    /// By default, cache about this many bytes of parsed graph groups.
+    static constexpr size_t DEFAULT_CACHE_BYTES = 256 * 1024 * 1024;
+
     /// Open a .vg file. If the .vg has a .vg.vgi index, it wil be loaded. If
-    /// not, an index will be generated and saved.
-    IndexedVG(string graph_filename);
+    /// not, an index will be generated and saved. Parsed groups of graph
+    /// chunks are cached up to about the given number of bytes.
+    IndexedVG(string graph_filename, size_t cache_bytes = DEFAULT_CACHE_BYTES);
+    
+    /// Stop any background loading.
+    ~IndexedVG();
     
     // TODO: This gets implicitly deleted and generates warning because of the
     // StreamIndex member variable
@@ -63,6 +80,10 @@ public:
     //IndexedVG& operator=(IndexedVG&& other) = default;
     
     void print_report() const;
+    
+    /// Set whether to load the group after each group that has to be loaded
+    /// in the background. On by default.
+    void set_prefetch(bool prefetch);
 
 private:
     // We are not copyable because we keep a pool of open files
@@ -172,6 +193,9 @@ protected:
         /// This is the virtual offset of the next group in the file.
         /// If this was the last group in the file, this is numeric_limits<int64_t>::max().
         int64_t next_group;
+        
+        /// About how much memory the entry takes up, in bytes.
+        size_t bytes;
     };
     
     /// Wrapper around the index's find, with cacheing. Supports stopping
@@ -193,12 +217,64 @@ protected:
     /// callback is running.
     bool with_cache_entry(int64_t group_vo, const function<void(const CacheEntry&)>& callback) const;
     
-    /// This is the cache that holds CacheEntries for groups we have already parsed and indexed.
-    /// We can only access the cache from one thread at a time, but the shared pointers let us
-    /// be working with the actual data in ther threads.
-    mutable LRUCache<int64_t, shared_ptr<CacheEntry>> group_cache;
-    /// The cache is protected with this mutex
-    mutable mutex cache_mutex;
+    /// Read the group at the given VO from the file, or return null at EOF.
+    shared_ptr<CacheEntry> load_group(int64_t group_vo) const;
+    
+    /// One independently locked part of the cache that holds CacheEntries
+    /// for groups we have already parsed and indexed. The shared pointers let
+    /// us be working with the actual data in other threads.
+    struct CacheShard {
+        /// Protects everything in the shard
+        mutex shard_mutex;
+        /// Entries, most recently used first
+        list<pair<int64_t, shared_ptr<CacheEntry>>> entries;
+        /// Where each group's entry is in the list
+        unordered_map<int64_t, list<pair<int64_t, shared_ptr<CacheEntry>>>::iterator> entry_index;
+        /// Total size of the entries
+        size_t bytes = 0;
+    };
+    
+    /// How many shards do we split the cache into?
+    static constexpr size_t CACHE_SHARDS = 16;
+    
+    /// Get the shard responsible for the given group.
+    CacheShard& shard_for(int64_t group_vo) const;
+    
+    /// Get the entry for the group from the cache, or null if it isn't there.
+    shared_ptr<CacheEntry> cache_retrieve(int64_t group_vo) const;
+    
+    /// Add the entry for the group to the cache, evicting the least recently
+    /// used entries of its shard to make room.
+    void cache_put(int64_t group_vo, const shared_ptr<CacheEntry>& entry) const;
+    
+    /// The cache, in shards
+    mutable vector<CacheShard> cache_shards;
+    /// How many bytes of entries can each shard hold?
+    size_t shard_capacity;
+    
+    /// Counts of cache hits and misses, for reporting
+    mutable atomic<size_t> cache_hits;
+    mutable atomic<size_t> cache_misses;
+    
+    /// Ask for the group at the given VO to be loaded in the background.
+    void request_prefetch(int64_t group_vo) const;
+    
+    /// Run on the prefetch thread to load requested groups.
+    void prefetch_loop();
+    
+    /// Should we prefetch?
+    atomic<bool> prefetch_enabled;
+    /// Groups waiting to be prefetched, oldest first
+    mutable deque<int64_t> prefetch_queue;
+    /// How many groups can wait to be prefetched? Older requests are dropped.
+    static constexpr size_t MAX_PREFETCH_QUEUE = 8;
+    /// Protects the queue and the stop flag
+    mutable mutex prefetch_mutex;
+    /// Signals the prefetch thread when there is work or it should stop
+    mutable condition_variable prefetch_wakeup;
+    bool stop_prefetching;
+    /// The prefetch thread, started on the first request
+    mutable thread prefetcher;
 };
 
 }
@@ -6,11 +6,13 @@
 #include "integrated_snarl_finder.hpp"
 
 #include "algorithms/three_edge_connected_components.hpp"
+#include "algorithms/component.hpp"
 #include "subgraph_overlay.hpp"
 
 #include <bdsg/overlays/overlay_helper.hpp>
 #include <structures/union_find.hpp>
 
+#include <algorithm>
 #include <array>
 #include <iostream>
 
@@ -1842,9 +1844,55 @@ void IntegratedSnarlFinder::traverse_computed_decomposition(MergedAdjacencyGraph
     
 }
 
+void IntegratedSnarlFinder::traverse_decomposition_parallel(const function<void(handle_t)>& begin_chain, const function<void(handle_t)>& end_chain,
+    const function<void(handle_t)>& begin_snarl, const function<void(handle_t)>& end_snarl) const {
+
+    vector<unordered_set<id_t>> weak_components = algorithms::weakly_connected_components_parallel(*graph);
+    if (weak_components.size() <= 1 || get_thread_count() == 1) {
+        traverse_decomposition(begin_chain, end_chain, begin_snarl, end_snarl);
+        return;
+    }
+    
+    // Start on the big components first so they don't hold everything up at the end
+    sort(weak_components.begin(), weak_components.end(), [](const unordered_set<id_t>& a, const unordered_set<id_t>& b) {
+        return a.size() > b.size();
+    });
+    
+    enum event_t : uint8_t {BEGIN_CHAIN, END_CHAIN, BEGIN_SNARL, END_SNARL};
+    const array<const function<void(handle_t)>*, 4> callbacks {&begin_chain, &end_chain, &begin_snarl, &end_snarl};
+    
+    #pragma omp parallel for ordered schedule(dynamic, 1)
+    for (size_t i = 0; i < weak_components.size(); ++i) {
+        // Record the component's decomposition. The overlay hands out the
+        // backing graph's handles, so they are good for the callbacks too.
+        vector<event_t> events;
+        vector<handle_t> handles;
+        {
+            SubgraphOverlay subgraph(graph, &weak_components[i]);
+            IntegratedSnarlFinder finder(subgraph);
+            auto record = [&](event_t event) {
+                return [&, event](handle_t handle) {
+                    events.push_back(event);
+                    handles.push_back(handle);
+                };
+            };
+            finder.traverse_decomposition(record(BEGIN_CHAIN), record(END_CHAIN), record(BEGIN_SNARL), record(END_SNARL));
+        }
+        unordered_set<id_t>().swap(weak_components[i]);
+        
+        // Replay it when it's this component's turn
+        #pragma omp ordered
+        {
+            for (size_t j = 0; j < events.size(); ++j) {
+                (*callbacks[events[j]])(handles[j]);
+            }
+        }
+    }
+}
+
 SnarlManager IntegratedSnarlFinder::find_snarls_parallel() {
 
-    vector<unordered_set<id_t>> weak_components = handlealgs::weakly_connected_components(graph);
+    vector<unordered_set<id_t>> weak_components = algorithms::weakly_connected_components_parallel(*graph);
     vector<SnarlManager> snarl_managers(weak_components.size());
 
     #pragma omp parallel for schedule(dynamic, 1)
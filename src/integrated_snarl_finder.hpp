@@ -95,6 +95,16 @@ public:
      */
     void traverse_decomposition(const function<void(handle_t)>& begin_chain, const function<void(handle_t)>& end_chain,
         const function<void(handle_t)>& begin_snarl, const function<void(handle_t)>& end_snarl) const;
+    
+    /**
+     * Visit all snarls and chains like traverse_decomposition(), but
+     * decompose each weakly connected component of the graph (in practice,
+     * each chromosome) in parallel. Each component's events are replayed to
+     * the callbacks one component at a time, largest component first, as
+     * soon as its turn comes.
+     */
+    virtual void traverse_decomposition_parallel(const function<void(handle_t)>& begin_chain, const function<void(handle_t)>& end_chain,
+        const function<void(handle_t)>& begin_snarl, const function<void(handle_t)>& end_snarl) const;
 };
 
 }
@@ -0,0 +1,71 @@
+/**
+ * \file load_joined_graphs.cpp
+ * Implementation for loading graphs into a joint node ID space.
+ */
+
+#include "load_joined_graphs.hpp"
+
+#include <vg/io/vpkg.hpp>
+#include <handlegraph/mutable_path_mutable_handle_graph.hpp>
+
+#include <algorithm>
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+
+void for_each_joined_graph(const vector<string>& filenames, size_t batch_size,
+                           const function<void(unique_ptr<MutablePathMutableHandleGraph>& graph)>& consume) {
+    
+    batch_size = max<size_t>(batch_size, 1);
+    
+    // the largest ID handed out so far
+    nid_t max_node_id = 0;
+    bool first = true;
+    
+    vector<unique_ptr<MutablePathMutableHandleGraph>> batch;
+    vector<nid_t> increments;
+    for (size_t batch_start = 0; batch_start < filenames.size(); batch_start += batch_size) {
+        size_t batch_end = min(batch_start + batch_size, filenames.size());
+        batch.resize(batch_end - batch_start);
+        
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = batch_start; i < batch_end; ++i) {
+            batch[i - batch_start] = vg::io::VPKG::load_one<MutablePathMutableHandleGraph>(filenames[i]);
+        }
+        
+        // the shifts only depend on the ID ranges, so we can find them all up front
+        increments.assign(batch.size(), 0);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (first) {
+                // the first graph keeps its IDs
+                first = false;
+                max_node_id = batch[i]->max_node_id();
+                continue;
+            }
+            nid_t delta = max_node_id - batch[i]->min_node_id();
+            if (delta >= 0) {
+                increments[i] = delta + 1;
+            }
+            max_node_id = batch[i]->max_node_id() + increments[i];
+        }
+        
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (increments[i] != 0) {
+                batch[i]->increment_node_ids(increments[i]);
+            }
+        }
+        
+        for (auto& graph : batch) {
+            consume(graph);
+            graph.reset();
+        }
+    }
+}
+
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef VG_IO_LOAD_JOINED_GRAPHS_HPP_INCLUDED
+#define VG_IO_LOAD_JOINED_GRAPHS_HPP_INCLUDED
+
+/**
+ * \file load_joined_graphs.hpp
+ * Load several graphs in parallel into one joint node ID space.
+ */
+
+#include "../handle.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+
+/**
+ * Load the graphs in the given files, with "-" meaning standard input, and
+ * shift their node IDs where needed so that each graph's IDs come after those
+ * of the graph before it (as in vg ids -j). Up to batch_size graphs are loaded
+ * and shifted in parallel at a time. The graphs are handed to the consumer one
+ * at a time, in file order, from the calling thread.
+ */
+void for_each_joined_graph(const vector<string>& filenames, size_t batch_size,
+                           const function<void(unique_ptr<MutablePathMutableHandleGraph>& graph)>& consume);
+
+}
+
+}
+
+#endif
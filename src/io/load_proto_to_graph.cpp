@@ -21,6 +21,8 @@
 #include <unordered_map>
 #include <mutex>
 
+#include <omp.h>
+
 //#define debug
 
 namespace vg {
@@ -33,19 +35,47 @@ using namespace vg;
 void load_proto_to_graph(vg::MutablePathMutableHandleGraph* destination, const vg::io::message_sender_function_t& for_each_message) {
     
     load_proto_to_graph(destination, [&](const function<void(Graph&)>& process_chunk) {
-        // Now we can give all the deserialized Graph chunks to process_chunk.
+        // Parsing the Graph chunks takes much longer than adding them to the
+        // graph, so we collect batches of serialized chunks, parse each batch
+        // in parallel, and then give the chunks to process_chunk in order.
+        size_t batch_size = omp_get_max_threads() * 4;
+        vector<string> batch;
+        batch.reserve(batch_size);
+        vector<Graph> parsed;
+        
+        auto process_batch = [&]() {
+            parsed.clear();
+            parsed.resize(batch.size());
+            vector<char> failed(batch.size(), false);
+#pragma omp parallel for schedule(dynamic, 1)
+            for (size_t i = 0; i < batch.size(); i++) {
+                // For each Graph, unpack it
+                failed[i] = !ProtobufIterator<Graph>::parse_from_string(parsed[i], batch[i]);
+                batch[i].clear();
+                batch[i].shrink_to_fit();
+            }
+            for (size_t i = 0; i < parsed.size(); i++) {
+                if (failed[i]) {
+                    // TODO: make this an exception if we ever want to be allowed to continue from this.
+                    cerr << "error[load_proto_to_graph]: invalid Graph message" << endl;
+                    exit(1);
+                }
+                // And send it along.
+                process_chunk(parsed[i]);
+                parsed[i].Clear();
+            }
+            batch.clear();
+        };
+        
         for_each_message([&](const string& serialized_graph) {
-            // For each Graph, unpack it
-            Graph g;
-            if (!ProtobufIterator<Graph>::parse_from_string(g, serialized_graph)) {
-                // TODO: make this an exception if we ever want to be allowed to continue from this.
-                cerr << "error[load_proto_to_graph]: invalid Graph message" << endl;
-                exit(1);
+            batch.push_back(serialized_graph);
+            if (batch.size() >= batch_size) {
+                process_batch();
             }
-            
-            // And send it along.
-            process_chunk(g);
         });
+        if (!batch.empty()) {
+            process_batch();
+        }
     });
 }
 
@@ -80,7 +110,8 @@ void load_proto_to_graph(vg::MutablePathMutableHandleGraph* destination, const f
         lock_guard<mutex> chunk_guard(chunk_mutex);
         
         // Within this chunk, we keep a node to handle cache
-        unordered_map<nid_t, handle_t> node_to_handle;
+        flat_hash_map<nid_t, handle_t> node_to_handle;
+        node_to_handle.reserve(g.node_size());
         
         // Define a way to get a handle from a cached handle, or the graph, or to fail.
         auto get_handle = [&](nid_t id, bool is_reverse, handle_t& dest) {
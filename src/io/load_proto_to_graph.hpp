@@ -23,6 +23,9 @@ using namespace vg;
  * Graph objects, and create the specified graph in the destination graph.
  *
  * Paths need to be cached until the end for ranks to be respected.
+ *
+ * Messages are parsed in parallel batches, using OMP threads, and then added
+ * to the graph one at a time in the order they were sent.
  */
 void load_proto_to_graph(vg::MutablePathMutableHandleGraph* destination, const vg::io::message_sender_function_t& for_each_message);
 
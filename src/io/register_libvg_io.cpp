@@ -15,6 +15,7 @@
 #include "register_loader_saver_lcp.hpp"
 #include "register_loader_saver_minimizer.hpp"
 #include "register_loader_saver_snarl_manager.hpp"
+#include "register_loader_saver_splice_site_index.hpp"
 #include "register_loader_saver_vg.hpp"
 #include "register_loader_saver_xg.hpp"
 #include "register_loader_saver_packed_graph.hpp"
@@ -41,6 +42,7 @@ bool register_libvg_io() {
     register_loader_saver_lcp();
     register_loader_saver_minimizer();
     register_loader_saver_snarl_manager();
+    register_loader_saver_splice_site_index();
     register_loader_saver_vg();
     register_loader_saver_gfa();
     register_loader_saver_xg();
@@ -26,6 +26,9 @@ void register_loader_saver_distance_index() {
         // Allocate an index and hand it the stream
         SnarlDistanceIndex* index = new SnarlDistanceIndex();
         if (!filename.empty()) {
+            // Loading from a file memory-maps it, so the index is served from
+            // the page cache and shared between processes, and nothing has
+            // to be read until it is queried.
             index->deserialize(filename);
         } else {
             index->deserialize(input);
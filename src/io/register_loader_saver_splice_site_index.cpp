@@ -0,0 +1,40 @@
+/**
+ * \file register_loader_saver_splice_site_index.cpp
+ * Defines IO for a SpliceSiteIndex from stream files.
+ */
+
+#include <vg/io/registry.hpp>
+
+#include "register_loader_saver_splice_site_index.hpp"
+#include "../splice_site_index.hpp"
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+using namespace vg::io;
+
+void register_loader_saver_splice_site_index() {
+    // the index starts with the bytes "SSIX"
+    std::string magic_string("SSIX");
+
+    Registry::register_bare_loader_saver_with_magic<SpliceSiteIndex>("SPLICESITES", magic_string, [](istream& input) -> void* {
+        // Allocate a SpliceSiteIndex
+        SpliceSiteIndex* index = new SpliceSiteIndex();
+        
+        // Load it
+        index->load(input);
+        
+        // Return it so the caller owns it.
+        return (void*) index;
+    }, [](const void* index_void, ostream& output) {
+        // Cast to SpliceSiteIndex and serialize to the stream.
+        ((const SpliceSiteIndex*) index_void)->serialize(output);
+    });
+
+}
+
+}
+
+}
@@ -0,0 +1,21 @@
+#ifndef VG_IO_REGISTER_LOADER_SAVER_SPLICE_SITE_INDEX_HPP_INCLUDED
+#define VG_IO_REGISTER_LOADER_SAVER_SPLICE_SITE_INDEX_HPP_INCLUDED
+
+/**
+ * \file register_loader_saver_splice_site_index.hpp
+ * Defines IO for a SpliceSiteIndex from stream files.
+ */
+
+namespace vg {
+
+namespace io {
+
+using namespace std;
+
+void register_loader_saver_splice_site_index();
+
+}
+
+}
+
+#endif
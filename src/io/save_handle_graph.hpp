@@ -98,6 +98,21 @@ unique_ptr<T> new_output_graph(const string& fmt_string) {
     }
 }
 
+// Create a new, empty graph (of handle graph type T) with the same implementation
+// as the given graph, or null if it is not one we know how to make
+template<class T>
+unique_ptr<T> new_graph_like(const HandleGraph* graph) {
+    if (dynamic_cast<const GFAHandleGraph*>(graph) != nullptr) {
+        return make_unique<GFAHandleGraph>();
+    } else if (dynamic_cast<const bdsg::PackedGraph*>(graph) != nullptr) {
+        return make_unique<bdsg::PackedGraph>();
+    } else if (dynamic_cast<const bdsg::HashGraph*>(graph) != nullptr) {
+        return make_unique<bdsg::HashGraph>();
+    } else {
+        return unique_ptr<T>();
+    }
+}
+
 }
 
 }
@@ -7,8 +7,12 @@
 #include <chrono>
 #include <mutex>
 #include <atomic>
+#include <algorithm>
+#include <iostream>
+#include <string>
 
 #include "utility.hpp"
+#include "memusage.hpp"
 
 namespace vg {
 
@@ -28,9 +32,47 @@ JobSchedule::JobSchedule(const vector<pair<int64_t, int64_t>>& job_requirements,
     });
 }
 
+void JobSchedule::set_logging(bool log_memory_usage) {
+    this->log_memory_usage = log_memory_usage;
+}
+
+double JobSchedule::get_memory_correction() const {
+    return memory_correction;
+}
+
 void JobSchedule::execute(int64_t target_memory_usage) {
     
+    // the sum of the (uncorrected) estimates of the jobs that are running
     atomic<int64_t> est_memory_usage(0);
+    // the memory that the jobs are actually using, as of the last sample
+    atomic<int64_t> obs_memory_usage(0);
+    // how much more memory the jobs use than we estimate
+    atomic<double> correction(memory_correction);
+    atomic<bool> finished(false);
+    
+    // whatever was allocated before we started isn't the jobs' doing
+    int64_t baseline_rss = get_current_rss_kb() * 1024;
+    
+    thread sampler([&]() {
+        if (baseline_rss == 0) {
+            // we can't measure RSS on this system
+            return;
+        }
+        while (!finished.load()) {
+            this_thread::sleep_for(chrono::milliseconds(sample_interval_ms));
+            int64_t observed = max<int64_t>(int64_t(get_current_rss_kb() * 1024) - baseline_rss, 0);
+            obs_memory_usage.store(observed);
+            int64_t estimated = est_memory_usage.load();
+            if (estimated > 0) {
+                double ratio = min(max(double(observed) / estimated, min_memory_correction), max_memory_correction);
+                double current = correction.load();
+                // learn quickly that we're underestimating so we don't OOM, but only
+                // relax gradually since jobs that just started haven't allocated yet
+                correction.store(ratio > current ? ratio : 0.9 * current + 0.1 * ratio);
+            }
+        }
+    });
+    
     mutex queue_lock;
     int num_threads = get_thread_count();
     vector<thread> workers;
@@ -55,9 +97,12 @@ void JobSchedule::execute(int64_t target_memory_usage) {
                 }
                 else {
                     // find the longest-running job that can be done with the available
-                    // memory budget
+                    // memory budget, according to the corrected estimates or what we
+                    // actually see being used, whichever is more
+                    double factor = correction.load();
+                    int64_t in_use = max<int64_t>(factor * est_memory_usage.load(), obs_memory_usage.load());
                     for (auto it = queue.begin(); it != queue.end(); ++it) {
-                        if (it->first + est_memory_usage.load() <= target_memory_usage) {
+                        if (factor * it->first + in_use <= target_memory_usage) {
                             tie(job_memory, job_idx) = *it;
                             queue.erase(it);
                             est_memory_usage.fetch_add(job_memory);
@@ -75,6 +120,14 @@ void JobSchedule::execute(int64_t target_memory_usage) {
                 else {
                     // we think we have enough memory available to attempt this job
                     job_func(job_idx);
+                    if (log_memory_usage) {
+                        string msg = "[JobSchedule] job " + to_string(job_idx) + " predicted "
+                            + to_string(job_memory) + " bytes, jobs in flight predicted "
+                            + to_string(est_memory_usage.load()) + " bytes and used "
+                            + to_string(obs_memory_usage.load()) + " bytes (correction "
+                            + to_string(correction.load()) + ")\n";
+                        cerr << msg;
+                    }
                     est_memory_usage.fetch_sub(job_memory);
                 }
             }
@@ -84,6 +137,12 @@ void JobSchedule::execute(int64_t target_memory_usage) {
     for (auto& worker : workers) {
         worker.join();
     }
+    finished.store(true);
+    sampler.join();
+    
+    memory_correction = correction.load();
+    if (log_memory_usage) {
+        cerr << "[JobSchedule] memory estimates corrected by a factor of " << memory_correction << endl;
+    }
 }
 }
-
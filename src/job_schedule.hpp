@@ -19,6 +19,10 @@ using namespace std;
  * A parallel job scheduler that tries to (if possible) respect a
  * cap on memory usage. Works best with a moderate number of
  * relatively large jobs.
+ *
+ * While jobs run, the process's actual RSS is sampled and compared to
+ * the estimates of the jobs in flight, and the ratio is used to correct
+ * the estimates of the jobs that are still waiting.
  */
 class JobSchedule {
 public:
@@ -34,11 +38,28 @@ public:
     // execute the job schedule with a target maximum memory usage
     void execute(int64_t target_memory_usage);
     
+    // log the predicted and actual memory usage of jobs to stderr
+    void set_logging(bool log_memory_usage);
+    
+    // get the factor by which the memory estimates were found to be off
+    // in the last execution
+    double get_memory_correction() const;
+    
 private:
     
     function<void(int64_t)> job_func;
     list<pair<int64_t, int64_t>> queue;
     
+    bool log_memory_usage = false;
+    double memory_correction = 1.0;
+    
+    // how often to sample the RSS while jobs are running
+    static const int sample_interval_ms = 250;
+    // keep the correction within these bounds so that a few bad samples
+    // can't stall or flood the schedule
+    static constexpr double min_memory_correction = 0.25;
+    static constexpr double max_memory_correction = 16.0;
+    
 };
 
 }
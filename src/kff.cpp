@@ -1,5 +1,7 @@
 #include "kff.hpp"
 
+#include <algorithm>
+
 namespace vg {
 
 //------------------------------------------------------------------------------
@@ -213,6 +215,39 @@ std::vector<uint8_t> kff_reverse_complement(const uint8_t* kmer, size_t k, const
 
 //------------------------------------------------------------------------------
 
+void kff_write(const std::string& filename, size_t k,
+               const std::function<void(const std::function<void(gbwtgraph::Key64::value_type, size_t)>&)>& for_each_kmer) {
+    Kff_file file(filename, "w");
+    uint8_t encoding[4] = { 0, 1, 2, 3 };
+    file.write_encoding(encoding);
+    std::string metadata = "vg";
+    file.write_metadata(metadata.size(), reinterpret_cast<uint8_t*>(&metadata[0]));
+
+    Section_GV variables(&file);
+    variables.write_var("k", k);
+    variables.write_var("max", 1);
+    variables.write_var("data_size", KFF_COUNT_BYTES);
+    variables.close();
+
+    Section_Raw section(&file);
+    uint8_t data[KFF_COUNT_BYTES];
+    size_t max_count = (size_t(1) << (8 * KFF_COUNT_BYTES)) - 1;
+    for_each_kmer([&](gbwtgraph::Key64::value_type kmer, size_t count) {
+        std::vector<uint8_t> encoded = kff_recode(kmer, k, encoding);
+        count = std::min(count, max_count);
+        // Counts are big-endian, as kff_parse() expects.
+        for (size_t i = KFF_COUNT_BYTES; i > 0; i--) {
+            data[i - 1] = count & 0xFF;
+            count >>= 8;
+        }
+        section.write_compacted_sequence(encoded.data(), k, data);
+    });
+    section.close();
+    file.close();
+}
+
+//------------------------------------------------------------------------------
+
 ParallelKFFReader::ParallelKFFReader(const std::string& filename) :
     reader(filename)
 {
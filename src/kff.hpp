@@ -6,6 +6,7 @@
  */
 
 #include <deque>
+#include <functional>
 #include <mutex>
 
 #include <kff_io.hpp>
@@ -76,6 +77,20 @@ inline gbwtgraph::Key64::value_type minimizer_reverse_complement(gbwtgraph::Key6
 
 //------------------------------------------------------------------------------
 
+/// Number of bytes used for each kmer count by `kff_write()`.
+constexpr size_t KFF_COUNT_BYTES = 4;
+
+/// Writes kmers in the minimizer index format and their counts to a KFF file,
+/// using the same encoding (which is trivial in KFF terms). The function is
+/// called with a callback that it should call for each kmer and count, in the
+/// order they should be written. Counts that do not fit in `KFF_COUNT_BYTES`
+/// bytes are capped. Each kmer is written as its own block, so the file can
+/// be read with `ParallelKFFReader`.
+void kff_write(const std::string& filename, size_t k,
+               const std::function<void(const std::function<void(gbwtgraph::Key64::value_type, size_t)>&)>& for_each_kmer);
+
+//------------------------------------------------------------------------------
+
 /**
  * A wrapper over `Kff_reader` that allows reading kmers safely from multiple threads.
  */
@@ -1,6 +1,9 @@
 #include "kmer.hpp"
 
+#include <algorithm>
 #include <atomic>
+#include <fstream>
+#include <memory>
 
 //#define debug
 
@@ -22,10 +25,92 @@ void for_each_kmer(const HandleGraph& graph, size_t k,
 #ifdef debug
     cerr << "Looping over kmers" << endl;
 #endif
+
+    // Determine the next context of a kmer that has reached length k, handle
+    // the head and tail nodes, and pass the kmer to the callback.
+    auto finish_kmer = [&](kmer_t& kmer) {
+        // TODO here check if we are at the beginning of the reverse head or the beginning of the forward tail and would need special handling
+        // establish the context
+        handle_t end_handle = graph.get_handle(id(kmer.end), is_rev(kmer.end));
+        size_t end_length = graph.get_length(end_handle);
+        if (offset(kmer.end) == end_length) {
+            // have to check which nodes are next
+            graph.follow_edges(kmer.curr, false, [&](const handle_t& next) {
+                kmer.next_pos.emplace_back(graph.get_id(next), graph.get_is_reverse(next), 0);
+                kmer.next_char.emplace_back(graph.get_base(next, 0));
+            });
+            if (kmer.next_pos.empty() && using_head_tail) {
+                if (id(kmer.begin) == head_id) {
+                    kmer.next_pos.emplace_back(tail_id, true, 0);
+                    kmer.next_char.emplace_back(graph.get_base(graph.get_handle(tail_id, true), 0));
+                } else if (id(kmer.begin) == tail_id) {
+                    kmer.next_pos.emplace_back(head_id, false, 0);
+                    kmer.next_char.emplace_back(graph.get_base(graph.get_handle(head_id, false), 0));
+                }
+                //cerr << "done head or tail" << endl;
+            }
+        } else {
+            // on node
+            kmer.next_pos.push_back(kmer.end);
+            kmer.next_char.push_back(graph.get_base(end_handle, offset(kmer.end)));
+        }
+        // if we have head and tail ids set, iterate through our positions and do the flip
+        if (using_head_tail) {
+            // flip the beginning
+            if (id(kmer.begin) == head_id && is_rev(kmer.begin)) {
+                get_id(kmer.begin) = tail_id;
+                get_is_rev(kmer.begin) = false;
+            } else if (id(kmer.begin) == tail_id && is_rev(kmer.begin)) {
+                get_id(kmer.begin) = head_id;
+                get_is_rev(kmer.begin) = false;
+            }
+            // flip the nexts
+            for (auto& pos : kmer.next_pos) {
+                if (id(pos) == head_id && is_rev(pos)) {
+                    get_id(pos) = tail_id;
+                    get_is_rev(pos) = false;
+                } else if (id(pos) == tail_id && is_rev(pos)) {
+                    get_id(pos) = head_id;
+                    get_is_rev(pos) = false;
+                }
+            }
+            // if we aren't both from and to a head/tail node, emit
+            /*
+             if (!((offset(kmer.begin) == 0
+             && id(kmer.begin) == head_id
+             && kmer.next_pos.size() == 1
+             && id(kmer.next_pos.front()) == tail_id)
+             || (offset(kmer.begin) == 0
+             && id(kmer.begin) == tail_id
+             && kmer.next_pos.size() == 1
+             && id(kmer.next_pos.front()) == head_id))) {
+             lambda(kmer);
+             }
+             */
+            if (kmer.prev_pos.size() == 1 && kmer.next_pos.size() == 1
+                && (offset(kmer.begin) == 0)
+                && (id(kmer.begin) == head_id || id(kmer.begin) == tail_id)
+                && (id(kmer.prev_pos.front()) == head_id || id(kmer.prev_pos.front()) == tail_id)
+                && (id(kmer.next_pos.front()) == head_id || id(kmer.next_pos.front()) == tail_id)) {
+                // skip
+            } else {
+                lambda(kmer);
+            }
+        } else {
+            // now pass the kmer and its context to our callback
+            lambda(kmer);
+        }
+    };
+
     graph.for_each_handle([&](const handle_t& h) {
 #ifdef debug
         cerr << "Process handle " << graph.get_id(h) << endl;
 #endif
+        // Kmers that fit in the node are built in this buffer and passed to
+        // the callback directly, so we reuse its allocations.
+        kmer_t kmer("", make_pos_t(0, false, 0), make_pos_t(0, false, 0), h);
+        kmer.seq.reserve(k);
+
         // for the forward and reverse of this handle
         // walk k bases from the end, so that any kmer starting on the node will be represented in the tree we build
         for (auto handle_is_rev : { false, true }) {
@@ -37,9 +122,14 @@ void for_each_kmer(const HandleGraph& graph, size_t k,
             size_t handle_length = graph.get_length(handle);
             string handle_seq = graph.get_sequence(handle);
             for (size_t i = 0; i < handle_length; ++i) {
-                pos_t begin = make_pos_t(handle_id, handle_is_rev, i);
-                pos_t end = make_pos_t(handle_id, handle_is_rev, min(handle_length, i+k));
-                kmer_t kmer = kmer_t(handle_seq.substr(offset(begin), offset(end)-offset(begin)), begin, end, handle);
+                kmer.begin = make_pos_t(handle_id, handle_is_rev, i);
+                kmer.end = make_pos_t(handle_id, handle_is_rev, min(handle_length, i+k));
+                kmer.curr = handle;
+                kmer.seq.assign(handle_seq, offset(kmer.begin), offset(kmer.end)-offset(kmer.begin));
+                kmer.prev_pos.clear();
+                kmer.prev_char.clear();
+                kmer.next_pos.clear();
+                kmer.next_char.clear();
                 // determine previous context
                 // if we are running with head/tail nodes, we'll need to do some trickery to eliminate the reverse complement versions of both
                 if (i == 0) {
@@ -47,7 +137,7 @@ void for_each_kmer(const HandleGraph& graph, size_t k,
                     graph.follow_edges(handle, true, [&](const handle_t& prev) {
                         size_t prev_length = graph.get_length(prev);
                         kmer.prev_pos.emplace_back(graph.get_id(prev), graph.get_is_reverse(prev), prev_length-1);
-                        kmer.prev_char.emplace_back(graph.get_sequence(prev).substr(prev_length-1, 1)[0]);
+                        kmer.prev_char.emplace_back(graph.get_base(prev, prev_length-1));
                         if (stop_flag) {
                             // stop if it evaluates to true
                             return !stop_flag->load();
@@ -59,12 +149,12 @@ void for_each_kmer(const HandleGraph& graph, size_t k,
                     });
                     // if we're on the forward head or reverse tail, we need to point to the end of the opposite node
                     if (kmer.prev_pos.empty() && using_head_tail) {
-                        if (id(begin) == head_id) {
+                        if (id(kmer.begin) == head_id) {
                             kmer.prev_pos.emplace_back(tail_id, false, 0);
-                            kmer.prev_char.emplace_back(graph.get_sequence(graph.get_handle(tail_id, false))[0]);
-                        } else if (id(begin) == tail_id) {
+                            kmer.prev_char.emplace_back(graph.get_base(graph.get_handle(tail_id, false), 0));
+                        } else if (id(kmer.begin) == tail_id) {
                             kmer.prev_pos.emplace_back(head_id, true, 0);
-                            kmer.prev_char.emplace_back(graph.get_sequence(graph.get_handle(head_id, true))[0]);
+                            kmer.prev_char.emplace_back(graph.get_base(graph.get_handle(head_id, true), 0));
                         }
                     }
                 } else {
@@ -73,8 +163,7 @@ void for_each_kmer(const HandleGraph& graph, size_t k,
                     kmer.prev_char.emplace_back(handle_seq[i-1]);
                 }
                 if (kmer.seq.size() < k) {
-                    kmer.seq.reserve(k); // may reduce allocation costs
-                                         // follow edges if we haven't completed the kmer here
+                    // follow edges if we haven't completed the kmer here
                     graph.follow_edges(kmer.curr, false, [&](const handle_t& next) {
                         kmers.push_back(kmer);
                         auto& todo = kmers.back();
@@ -89,7 +178,8 @@ void for_each_kmer(const HandleGraph& graph, size_t k,
                         }
                     });
                 } else {
-                    kmers.push_back(kmer);
+                    // the kmer is complete within the node
+                    finish_kmer(kmer);
                 }
                 
                 if (stop_flag && stop_flag->load()) {
@@ -105,87 +195,16 @@ void for_each_kmer(const HandleGraph& graph, size_t k,
                     auto& kmer = *q;
                     // did we reach our target length?
                     if (kmer.seq.size() == k) {
-                        // TODO here check if we are at the beginning of the reverse head or the beginning of the forward tail and would need special handling
-                        // establish the context
-                        handle_t end_handle = graph.get_handle(id(kmer.end), is_rev(kmer.end));
-                        size_t end_length = graph.get_length(end_handle);
-                        if (offset(kmer.end) == end_length) {
-                            // have to check which nodes are next
-                            graph.follow_edges(kmer.curr, false, [&](const handle_t& next) {
-                                kmer.next_pos.emplace_back(graph.get_id(next), graph.get_is_reverse(next), 0);
-                                kmer.next_char.emplace_back(graph.get_sequence(next)[0]);
-                            });
-                            if (kmer.next_pos.empty() && using_head_tail) {
-                                if (id(kmer.begin) == head_id) {
-                                    kmer.next_pos.emplace_back(tail_id, true, 0);
-                                    kmer.next_char.emplace_back(graph.get_sequence(graph.get_handle(tail_id, true))[0]);
-                                } else if (id(kmer.begin) == tail_id) {
-                                    kmer.next_pos.emplace_back(head_id, false, 0);
-                                    kmer.next_char.emplace_back(graph.get_sequence(graph.get_handle(head_id, false))[0]);
-                                }
-                                //cerr << "done head or tail" << endl;
-                            }
-                        } else {
-                            // on node
-                            kmer.next_pos.push_back(kmer.end);
-                            kmer.next_char.push_back(graph.get_sequence(end_handle)[offset(kmer.end)]);
-                        }
-                        // if we have head and tail ids set, iterate through our positions and do the flip
-                        if (using_head_tail) {
-                            // flip the beginning
-                            if (id(kmer.begin) == head_id && is_rev(kmer.begin)) {
-                                get_id(kmer.begin) = tail_id;
-                                get_is_rev(kmer.begin) = false;
-                            } else if (id(kmer.begin) == tail_id && is_rev(kmer.begin)) {
-                                get_id(kmer.begin) = head_id;
-                                get_is_rev(kmer.begin) = false;
-                            }
-                            // flip the nexts
-                            for (auto& pos : kmer.next_pos) {
-                                if (id(pos) == head_id && is_rev(pos)) {
-                                    get_id(pos) = tail_id;
-                                    get_is_rev(pos) = false;
-                                } else if (id(pos) == tail_id && is_rev(pos)) {
-                                    get_id(pos) = head_id;
-                                    get_is_rev(pos) = false;
-                                }
-                            }
-                            // if we aren't both from and to a head/tail node, emit
-                            /*
-                             if (!((offset(kmer.begin) == 0
-                             && id(kmer.begin) == head_id
-                             && kmer.next_pos.size() == 1
-                             && id(kmer.next_pos.front()) == tail_id)
-                             || (offset(kmer.begin) == 0
-                             && id(kmer.begin) == tail_id
-                             && kmer.next_pos.size() == 1
-                             && id(kmer.next_pos.front()) == head_id))) {
-                             lambda(kmer);
-                             }
-                             */
-                            if (kmer.prev_pos.size() == 1 && kmer.next_pos.size() == 1
-                                && (offset(kmer.begin) == 0)
-                                && (id(kmer.begin) == head_id || id(kmer.begin) == tail_id)
-                                && (id(kmer.prev_pos.front()) == head_id || id(kmer.prev_pos.front()) == tail_id)
-                                && (id(kmer.next_pos.front()) == head_id || id(kmer.next_pos.front()) == tail_id)) {
-                                // skip
-                            } else {
-                                lambda(kmer);
-                            }
-                        } else {
-                            // now pass the kmer and its context to our callback
-                            lambda(kmer);
-                        }
+                        finish_kmer(kmer);
                         q = kmers.erase(q);
                     } else {
                         // do we finish in the current node?
                         id_t curr_id = graph.get_id(kmer.curr);
                         size_t curr_length = graph.get_length(kmer.curr);
                         bool curr_is_rev = graph.get_is_reverse(kmer.curr);
-                        string curr_seq = graph.get_sequence(kmer.curr);
                         size_t take = min(curr_length, k-kmer.seq.size());
                         kmer.end = make_pos_t(curr_id, curr_is_rev, take);
-                        kmer.seq.append(curr_seq.substr(0,take));
+                        kmer.seq.append(graph.get_subsequence(kmer.curr, 0, take));
                         if (kmer.seq.size() < k) {
                             // if not, we need to expand through the node then follow on
                             graph.follow_edges(kmer.curr, false, [&](const handle_t& next) {
@@ -269,6 +288,29 @@ gcsa::byte_type encode_chars(const vector<char>& chars, const gcsa::Alphabet& al
     return val;
 }
 
+size_t merge_gcsa_kmers(vector<gcsa::KMer>& kmers) {
+    if (kmers.size() < 2) {
+        return 0;
+    }
+    std::sort(kmers.begin(), kmers.end(), [](const gcsa::KMer& a, const gcsa::KMer& b) {
+        gcsa::key_type a_label = gcsa::Key::label(a.key), b_label = gcsa::Key::label(b.key);
+        return (a_label < b_label || (a_label == b_label && (a.from < b.from || (a.from == b.from && a.to < b.to))));
+    });
+    size_t tail = 0;
+    for (size_t i = 1; i < kmers.size(); i++) {
+        if (gcsa::Key::label(kmers[i].key) == gcsa::Key::label(kmers[tail].key)
+            && kmers[i].from == kmers[tail].from && kmers[i].to == kmers[tail].to) {
+            kmers[tail].key = gcsa::Key::merge(kmers[tail].key, kmers[i].key);
+        } else {
+            tail++;
+            kmers[tail] = kmers[i];
+        }
+    }
+    size_t removed = kmers.size() - (tail + 1);
+    kmers.resize(tail + 1);
+    return removed;
+}
+
 void write_gcsa_kmers(const HandleGraph& graph, int kmer_size, ostream& out, size_t& size_limit, id_t head_id, id_t tail_id) {
 
     // We need an alphabet to parse the internal string format
@@ -293,6 +335,9 @@ void write_gcsa_kmers(const HandleGraph& graph, int kmer_size, ostream& out, siz
     size_t total_bytes = 0;
     auto handle_kmers = [&](vector<gcsa::KMer>& kmers, bool more) {
         if (!more || kmers.size() > buffer_limit) {
+            // Paths through nodes with identical labels produce duplicate
+            // records, which would only take disk space in the doubling steps.
+            merge_gcsa_kmers(kmers);
             size_t bytes_required = kmers.size() * sizeof(gcsa::KMer) + sizeof(gcsa::GraphFileHeader);
 #pragma omp critical
             {
@@ -352,6 +397,83 @@ string write_gcsa_kmers_to_tmpfile(const HandleGraph& graph, int kmer_size, size
     return tmpfile;
 }
 
+vector<string> write_gcsa_kmers_to_tmpfiles(const HandleGraph& graph, int kmer_size, atomic<size_t>& bytes_used,
+                                            size_t size_limit, id_t head_id, id_t tail_id,
+                                            const string& base_file_name) {
+
+    const gcsa::Alphabet alpha;
+    // Each thread buffers its own KMers and writes them to its own file, which it opens
+    // the first time it has something to write
+    vector<vector<gcsa::KMer> > thread_outputs;
+    vector<string> tmpfiles;
+    vector<unique_ptr<ofstream>> thread_files;
+#pragma omp parallel
+    {
+#pragma omp single
+        {
+            thread_outputs.resize(omp_get_num_threads());
+            tmpfiles.resize(omp_get_num_threads());
+            thread_files.resize(omp_get_num_threads());
+        }
+    }
+    
+    atomic<int> size_limit_exceeded(0);
+    
+    size_t buffer_limit = 1e5; // max 100k kmers per buffer
+    auto handle_kmers = [&](size_t thread_num, bool more) {
+        vector<gcsa::KMer>& kmers = thread_outputs[thread_num];
+        if (kmers.empty() || (more && kmers.size() <= buffer_limit)) {
+            return;
+        }
+        merge_gcsa_kmers(kmers);
+        size_t bytes_required = kmers.size() * sizeof(gcsa::KMer) + sizeof(gcsa::GraphFileHeader);
+        // claim our share of the budget before writing, so that no lock is needed
+        size_t bytes_before = bytes_used.fetch_add(bytes_required);
+        if (bytes_before + bytes_required > size_limit) {
+            if (size_limit_exceeded.exchange(1) == 0) {
+#pragma omp critical (cerr)
+                cerr << "error: [write_gcsa_kmers_to_tmpfiles()] size limit of " << size_limit << " bytes exceeded" << endl;
+            }
+        }
+        else if (!size_limit_exceeded.load()) {
+            if (!thread_files[thread_num]) {
+                tmpfiles[thread_num] = temp_file::create(base_file_name);
+                thread_files[thread_num].reset(new ofstream(tmpfiles[thread_num], ios::binary));
+            }
+            gcsa::writeBinary(*thread_files[thread_num], kmers, kmer_size);
+        }
+        kmers.clear();
+    };
+    auto convert_kmer = [&](const kmer_t& kmer) {
+        size_t thread_num = omp_get_thread_num();
+        vector<gcsa::KMer>& thread_output = thread_outputs[thread_num];
+        kmer_to_gcsa_kmers(kmer, alpha, [&thread_output](const gcsa::KMer& k) { thread_output.push_back(k); });
+        handle_kmers(thread_num, true);
+    };
+    for_each_kmer(graph, kmer_size, convert_kmer, head_id, tail_id, &size_limit_exceeded);
+    
+    // Flush the remaining buffers, each into its own thread's file
+#pragma omp parallel for schedule(static, 1)
+    for (size_t i = 0; i < thread_outputs.size(); ++i) {
+        handle_kmers(i, false);
+    }
+    
+    vector<string> written;
+    for (size_t i = 0; i < thread_files.size(); ++i) {
+        if (thread_files[i]) {
+            thread_files[i]->close();
+            written.push_back(tmpfiles[i]);
+        }
+    }
+    if (size_limit_exceeded.load()) {
+        for (const string& tmpfile : written) {
+            temp_file::remove(tmpfile);
+        }
+        throw SizeLimitExceededException();
+    }
+    return written;
+}
+
 
 
 }
@@ -72,8 +72,14 @@ void kmer_to_gcsa_kmers(const kmer_t& kmer, const gcsa::Alphabet& alpha, const f
 /// Encode the chars into the gcsa2 byte
 gcsa::byte_type encode_chars(const vector<char>& chars, const gcsa::Alphabet& alpha);
 
+/// Sort the gcsa2 binary kmers and merge the ones with the same label, start,
+/// and end by combining their predecessor and successor sets. Returns the
+/// number of kmers removed.
+size_t merge_gcsa_kmers(vector<gcsa::KMer>& kmers);
+
 /**
- * Write GCSA2 formatted binary KMers to the given ostream.
+ * Write GCSA2 formatted binary KMers to the given ostream. Each buffer of
+ * kmers is deduplicated with merge_gcsa_kmers() before it is written.
  * size_limit is the maximum size of the kmer file in bytes. When the function
  * returns, size_limit is the size of the kmer file in bytes.
  */
@@ -85,6 +91,16 @@ void write_gcsa_kmers(const HandleGraph& graph, int kmer_size, ostream& out, siz
 string write_gcsa_kmers_to_tmpfile(const HandleGraph& graph, int kmer_size, size_t& size_limit, id_t head_id, id_t tail_id,
                                    const string& base_file_name = "vg-kmers-tmp-");
 
+/// Write the kmers to one tempfile per thread, so that the threads do not have to
+/// take turns writing. The bytes written are added to bytes_used, which can be shared
+/// between concurrent or successive calls to enforce a combined size_limit. Returns
+/// the names of the nonempty tempfiles, which the calling context should remove
+/// with temp_file::remove(). In the case that the size limit is exceeded, throws a
+/// SizeLimitExceededException and deletes the tempfiles.
+vector<string> write_gcsa_kmers_to_tmpfiles(const HandleGraph& graph, int kmer_size, atomic<size_t>& bytes_used,
+                                            size_t size_limit, id_t head_id, id_t tail_id,
+                                            const string& base_file_name = "vg-kmers-tmp-");
+
 }
 
 #endif
@@ -90,19 +90,23 @@ BaseMapper::find_mems_simple(string::const_iterator seq_begin,
                              int min_mem_length,
                              int reseed_length) {
     
-    if (!gcsa) {
-        cerr << "error:[vg::Mapper] a GCSA2 index is required to query MEMs" << endl;
-        exit(1);
-    }
-    
-    vector<MaximalExactMatch> mems;
-    
-    // an empty sequence matches the entire bwt
-    if (seq_begin == seq_end) {
-        mems.emplace_back(MaximalExactMatch(seq_begin, seq_end,
-                                            gcsa::range_type(0, gcsa->size() - 1)));
-        return mems;
-    }
+    vector<pair<string::const_iterator, string::const_iterator>> seqs(1, make_pair(seq_begin, seq_end));
+    return std::move(find_mems_simple_batch(seqs, vector<int>(1, max_mem_length),
+                                            min_mem_length, reseed_length).front());
+}
+
+vector<vector<MaximalExactMatch>>
+BaseMapper::find_mems_simple_batch(const vector<pair<string::const_iterator, string::const_iterator>>& seqs,
+                                   int max_mem_length,
+                                   int min_mem_length,
+                                   int reseed_length) {
+    return find_mems_simple_batch(seqs, vector<int>(seqs.size(), max_mem_length),
+                                  min_mem_length, reseed_length);
+}
+
+void BaseMapper::interleaved_smem_search(const vector<pair<string::const_iterator, string::const_iterator>>& seqs,
+                                         const vector<int>& max_mem_lengths,
+                                         vector<vector<MaximalExactMatch>>& mems_out) const {
     
     // find SMEMs using GCSA+LCP array
     // algorithm sketch:
@@ -118,148 +122,260 @@ BaseMapper::find_mems_simple(string::const_iterator seq_begin,
     //           (effectively, this steps up the suffix tree)
     //           and calculate the new end point using the LCP of the parent node
     // emit the final MEM, if we finished in a matching state
+    //
+    // each step depends on the range from the last one, and almost every one
+    // misses cache, so we take one step in each sequence in turn to keep several
+    // independent steps in flight at once
+    
+    // the state of the search in one sequence
+    struct SearchState {
+        size_t seq_idx;
+        // the temporary MEM we're building up
+        string::const_iterator curr_end;
+        string::const_iterator cursor;
+        gcsa::range_type range;
+    };
     
-    // the temporary MEM we'll build up in this process
     auto full_range = gcsa::range_type(0, gcsa->size() - 1);
-    string::const_iterator curr_end = seq_end;
-    string::const_iterator cursor = seq_end - 1;
-    // start off looking at the last character in the query
-    gcsa::range_type range = accelerate_mem_query(seq_begin, cursor);
-    while (cursor >= seq_begin) {
-        // hold onto our previous range
-        auto last_range = range;
-        // execute one step of LF mapping
-        range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
-        if (gcsa::Range::empty(range)
-            || (max_mem_length && curr_end - cursor > max_mem_length)
-            || curr_end - cursor > gcsa->order()) {
-            // break on N; which for DNA we assume is non-informative
-            // this *will* match many places in assemblies; this isn't helpful
-            if (*cursor == 'N' || last_range == full_range) {
-                // we mismatched in a single character
-                // there is no MEM here
-                mems.emplace_back(cursor + 1, curr_end, last_range);
-                curr_end = cursor;
-                range = full_range;
-                --cursor;
-            } else {
-                // we've exhausted our BWT range, so the last match range was maximal
-                // or: we have exceeded the order of the graph (FPs if we go further)
-                //     we have run over our parameter-defined MEM limit
-                // record the last MEM
-                mems.emplace_back(cursor + 1, curr_end, last_range);
-                // set up the next MEM using the parent node range
-                // length of last MEM, which we use to update our end pointer for the next MEM
-                int64_t last_mem_length = (curr_end - cursor) - 1;
-                // get the parent suffix tree node corresponding to the parent of the last MEM's STNode
-                gcsa::STNode parent = lcp->parent(last_range);
-                // change the end for the next mem to reflect our step size
-                size_t step_size = last_mem_length - parent.lcp();
-                curr_end = curr_end - step_size;
-                // and set up the next MEM using the parent node range
-                range = parent.range();
-            }
-        } else {
-            // just step to the next position
-            --cursor;
+    
+    vector<SearchState> active;
+    active.reserve(seqs.size());
+    for (size_t i = 0; i < seqs.size(); ++i) {
+        if (seqs[i].first != seqs[i].second) {
+            // start off looking at the last character in the query
+            prefetch_mem_query(seqs[i].first, seqs[i].second - 1);
+            active.push_back(SearchState{i, seqs[i].second, seqs[i].second - 1, full_range});
         }
     }
-    // if we have a non-empty MEM at the end, record it
-    if (curr_end > seq_begin) {
-        mems.emplace_back(seq_begin, curr_end, range);
+    // the memoized ranges will hopefully have arrived by now
+    for (auto& state : active) {
+        state.range = accelerate_mem_query(seqs[state.seq_idx].first, state.cursor);
     }
     
-    // find the SMEMs from the mostly-SMEM and some MEM list we've built
-    // FIXME: un-hack this (it shouldn't be needed!)
-    // the algorithm sometimes generates MEMs contained in SMEMs
-    // with the pattern that they have the same beginning position
-    map<string::const_iterator, string::const_iterator> smems_begin;
-    for (auto& mem : mems) {
-        auto x = smems_begin.find(mem.begin);
-        if (x == smems_begin.end()) {
-            smems_begin[mem.begin] = mem.end;
-        } else {
-            if (x->second < mem.end) {
-                x->second = mem.end;
+    while (!active.empty()) {
+        for (size_t i = 0; i < active.size(); ) {
+            auto& state = active[i];
+            auto seq_begin = seqs[state.seq_idx].first;
+            int max_mem_length = max_mem_lengths[state.seq_idx];
+            auto& mems = mems_out[state.seq_idx];
+            
+            if (state.cursor < seq_begin) {
+                // if we have a non-empty MEM at the end, record it
+                if (state.curr_end > seq_begin) {
+                    mems.emplace_back(seq_begin, state.curr_end, state.range);
+                }
+                // this search is done, so replace it with the last one
+                state = active.back();
+                active.pop_back();
+                continue;
             }
+            
+            // hold onto our previous range
+            auto last_range = state.range;
+            // execute one step of LF mapping
+            state.range = gcsa->LF(state.range, gcsa->alpha.char2comp[*state.cursor]);
+            if (gcsa::Range::empty(state.range)
+                || (max_mem_length && state.curr_end - state.cursor > max_mem_length)
+                || state.curr_end - state.cursor > gcsa->order()) {
+                // break on N; which for DNA we assume is non-informative
+                // this *will* match many places in assemblies; this isn't helpful
+                if (*state.cursor == 'N' || last_range == full_range) {
+                    // we mismatched in a single character
+                    // there is no MEM here
+                    mems.emplace_back(state.cursor + 1, state.curr_end, last_range);
+                    state.curr_end = state.cursor;
+                    state.range = full_range;
+                    --state.cursor;
+                } else {
+                    // we've exhausted our BWT range, so the last match range was maximal
+                    // or: we have exceeded the order of the graph (FPs if we go further)
+                    //     we have run over our parameter-defined MEM limit
+                    // record the last MEM
+                    mems.emplace_back(state.cursor + 1, state.curr_end, last_range);
+                    if (lcp) {
+                        // set up the next MEM using the parent node range
+                        // length of last MEM, which we use to update our end pointer for the next MEM
+                        int64_t last_mem_length = (state.curr_end - state.cursor) - 1;
+                        // get the parent suffix tree node corresponding to the parent of the last MEM's STNode
+                        gcsa::STNode parent = lcp->parent(last_range);
+                        // change the end for the next mem to reflect our step size
+                        size_t step_size = last_mem_length - parent.lcp();
+                        state.curr_end = state.curr_end - step_size;
+                        // and set up the next MEM using the parent node range
+                        state.range = parent.range();
+                    }
+                    else {
+                        // without the LCP array, find where the next MEM ends by search
+                        state.curr_end = lcp_free_mem_restart(state.cursor, state.curr_end, last_range,
+                                                              !gcsa::Range::empty(state.range));
+                        state.range = backward_search(state.cursor + 1, state.curr_end);
+                    }
+                }
+            } else {
+                // just step to the next position
+                --state.cursor;
+            }
+            ++i;
         }
     }
+}
+
+vector<vector<MaximalExactMatch>>
+BaseMapper::find_mems_simple_batch(const vector<pair<string::const_iterator, string::const_iterator>>& seqs,
+                                   const vector<int>& max_mem_lengths,
+                                   int min_mem_length,
+                                   int reseed_length) {
     
-    // remove zero-length entries and MEMs that aren't SMEMs
-    // the zero-length ones are associated with single-base MEMs that tend to
-    // match the entire index (typically Ns)
-    // minor TODO: fix the above algorithm so they aren't introduced at all
-    mems.erase(std::remove_if(mems.begin(), mems.end(),
-                              [&smems_begin,
-                               &min_mem_length](const MaximalExactMatch& m) {
-                                  return ( m.end-m.begin == 0
-                                          || m.length() < min_mem_length
-                                          || smems_begin[m.begin] != m.end
-                                          || m.count_Ns() > 0
-                                          );
-                              }),
-               mems.end());
-    // return the matches in natural order
-    std::reverse(mems.begin(), mems.end());
+    if (!gcsa) {
+        cerr << "error:[vg::Mapper] a GCSA2 index is required to query MEMs" << endl;
+        exit(1);
+    }
     
-    // fill the counts before deciding what to do
-    for (auto& mem : mems) {
-        if (mem.length() >= min_mem_length) {
-            mem.match_count = gcsa->count(mem.range);
-            if (hit_max) {
-                gcsa->locate(mem.range, hit_max, mem.nodes);
+    vector<vector<MaximalExactMatch>> all_mems(seqs.size());
+    
+    interleaved_smem_search(seqs, max_mem_lengths, all_mems);
+    
+    // the MEMs of all the sequences, to locate together at the end
+    vector<MaximalExactMatch*> to_locate;
+    for (size_t i = 0; i < seqs.size(); ++i) {
+        auto& mems = all_mems[i];
+        
+        // an empty sequence matches the entire bwt
+        if (seqs[i].first == seqs[i].second) {
+            mems.emplace_back(MaximalExactMatch(seqs[i].first, seqs[i].second,
+                                                gcsa::range_type(0, gcsa->size() - 1)));
+            continue;
+        }
+        
+        // find the SMEMs from the mostly-SMEM and some MEM list we've built
+        // FIXME: un-hack this (it shouldn't be needed!)
+        // the algorithm sometimes generates MEMs contained in SMEMs
+        // with the pattern that they have the same beginning position
+        map<string::const_iterator, string::const_iterator> smems_begin;
+        for (auto& mem : mems) {
+            auto x = smems_begin.find(mem.begin);
+            if (x == smems_begin.end()) {
+                smems_begin[mem.begin] = mem.end;
             } else {
-                gcsa->locate(mem.range, mem.nodes);
+                if (x->second < mem.end) {
+                    x->second = mem.end;
+                }
+            }
+        }
+        
+        // remove zero-length entries and MEMs that aren't SMEMs
+        // the zero-length ones are associated with single-base MEMs that tend to
+        // match the entire index (typically Ns)
+        // minor TODO: fix the above algorithm so they aren't introduced at all
+        mems.erase(std::remove_if(mems.begin(), mems.end(),
+                                  [&smems_begin,
+                                   &min_mem_length](const MaximalExactMatch& m) {
+                                      return ( m.end-m.begin == 0
+                                              || m.length() < min_mem_length
+                                              || smems_begin[m.begin] != m.end
+                                              || m.count_Ns() > 0
+                                              );
+                                  }),
+                   mems.end());
+        // return the matches in natural order
+        std::reverse(mems.begin(), mems.end());
+        
+        // fill the counts before deciding what to do
+        for (auto& mem : mems) {
+            if (mem.length() >= min_mem_length) {
+                mem.match_count = gcsa->count(mem.range);
+                to_locate.push_back(&mem);
             }
         }
     }
+    locate_mems(to_locate);
     
     // reseed the long smems with shorter mems
     if (reseed_length) {
-        // find if there are any mems that should be reseeded
-        // iterate through MEMs
-        vector<MaximalExactMatch> reseeded;
-        for (auto& mem : mems) {
-            // reseed if we have a long singular match
-            if ((mem.length() >= reseed_length
-                 && mem.match_count == 1)
-                // or if we only have one mem for the entire read (even if it may have many matches)
-                || mems.size() == 1) {
-                // reseed at midway between here and the min mem length and at the min mem length
-                int reseed_to = mem.length() / 2;
-                int reseeds = 0;
-                while (reseeds == 0 && reseed_to >= min_mem_length) {
+        // find if there are any mems that should be reseeded, as (sequence index, MEM index)
+        vector<pair<size_t, size_t>> to_reseed;
+        // and the length we'll reseed each of them to next
+        vector<int> reseed_to;
+        for (size_t i = 0; i < all_mems.size(); ++i) {
+            auto& mems = all_mems[i];
+            for (size_t j = 0; j < mems.size(); ++j) {
+                auto& mem = mems[j];
+                // reseed if we have a long singular match
+                if ((mem.length() >= reseed_length
+                     && mem.match_count == 1)
+                    // or if we only have one mem for the entire read (even if it may have many matches)
+                    || mems.size() == 1) {
+                    // reseed at midway between here and the min mem length and at the min mem length
+                    if (mem.length() / 2 >= min_mem_length) {
+                        to_reseed.emplace_back(i, j);
+                        reseed_to.push_back(mem.length() / 2);
+                    }
+                }
+            }
+        }
+        
+        // the sub-MEMs that replace each MEM, if we find any
+        vector<vector<vector<MaximalExactMatch>>> reseeded(all_mems.size());
+        for (size_t i = 0; i < all_mems.size(); ++i) {
+            reseeded[i].resize(all_mems[i].size());
+        }
+        
+        // reseed all of the MEMs together, halving the length for the ones
+        // that don't find anything
+        while (!to_reseed.empty()) {
+            vector<pair<string::const_iterator, string::const_iterator>> reseed_seqs;
+            reseed_seqs.reserve(to_reseed.size());
+            for (auto& mem_idx : to_reseed) {
+                auto& mem = all_mems[mem_idx.first][mem_idx.second];
 #ifdef debug_mapper
-                    cerr << "reseeding " << mem.sequence() << " with " << reseed_to << endl;
+                cerr << "reseeding " << mem.sequence() << " with " << reseed_to[&mem_idx - &to_reseed.front()] << endl;
 #endif
-                    vector<MaximalExactMatch> remems = find_mems_simple(mem.begin,
-                                                                        mem.end,
-                                                                        reseed_to,
-                                                                        min_mem_length,
-                                                                        0);
-                    reseed_to /= 2;
-                    for (auto& rmem : remems) {
-                        // keep if we have more than the match count of the parent
-                        if (rmem.length() >= min_mem_length
-                            && rmem.match_count > mem.match_count) {
-                            ++reseeds;
-                            reseeded.push_back(rmem);
-                        }
+                reseed_seqs.emplace_back(mem.begin, mem.end);
+            }
+            
+            auto remems = find_mems_simple_batch(reseed_seqs, reseed_to, min_mem_length, 0);
+            
+            vector<pair<size_t, size_t>> next_to_reseed;
+            vector<int> next_reseed_to;
+            for (size_t k = 0; k < to_reseed.size(); ++k) {
+                auto& mem = all_mems[to_reseed[k].first][to_reseed[k].second];
+                auto& replacements = reseeded[to_reseed[k].first][to_reseed[k].second];
+                for (auto& rmem : remems[k]) {
+                    // keep if we have more than the match count of the parent
+                    if (rmem.length() >= min_mem_length
+                        && rmem.match_count > mem.match_count) {
+                        replacements.push_back(std::move(rmem));
                     }
                 }
-                // at least keep the original mem if needed
-                if (reseeds == 0) {
-                    reseeded.push_back(mem);
+                if (replacements.empty() && reseed_to[k] / 2 >= min_mem_length) {
+                    next_to_reseed.push_back(to_reseed[k]);
+                    next_reseed_to.push_back(reseed_to[k] / 2);
                 }
-            } else {
-                reseeded.push_back(mem);
             }
+            to_reseed = std::move(next_to_reseed);
+            reseed_to = std::move(next_reseed_to);
+        }
+        
+        for (size_t i = 0; i < all_mems.size(); ++i) {
+            auto& mems = all_mems[i];
+            vector<MaximalExactMatch> with_reseeds;
+            for (size_t j = 0; j < mems.size(); ++j) {
+                if (reseeded[i][j].empty()) {
+                    // at least keep the original mem if needed
+                    with_reseeds.push_back(std::move(mems[j]));
+                }
+                else {
+                    for (auto& rmem : reseeded[i][j]) {
+                        with_reseeds.push_back(std::move(rmem));
+                    }
+                }
+            }
+            mems = std::move(with_reseeds);
+            // re-sort the MEMs by their start position
+            std::sort(mems.begin(), mems.end(), [](const MaximalExactMatch& m1, const MaximalExactMatch& m2) { return m1.begin < m2.begin; });
         }
-        mems = reseeded;
-        // re-sort the MEMs by their start position
-        std::sort(mems.begin(), mems.end(), [](const MaximalExactMatch& m1, const MaximalExactMatch& m2) { return m1.begin < m2.begin; });
     }
-    return mems;
+    return all_mems;
 }
 
 vector<MaximalExactMatch> BaseMapper::find_fanout_mems(string::const_iterator seq_begin,
@@ -1259,9 +1375,10 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
         min_mem_query_length = max_mem_length * short_mem_filter_factor;
     }
     
-    // query the locations of the hits
+    // query the locations of the hits, all together once we know which we want
     // note: iterate in reverse so we remove the parent count from the children MEMs before decrementing
     // the parent count itself
+    vector<MaximalExactMatch*> to_locate;
     for (int64_t i = mems.size() - 1; i >= 0; i--) {
         
         MaximalExactMatch& mem = mems[i];
@@ -1275,17 +1392,17 @@ vector<MaximalExactMatch> BaseMapper::find_mems_deep(string::const_iterator seq_
         
         if (mem.match_count > 0 && mem.length() >= min_mem_query_length) {
             if (!hard_hit_max || mem.match_count < hard_hit_max) {
-                if (hit_max) {
-                    gcsa->locate(mem.range, hit_max, mem.nodes);
-                    
-                } else {
-                    gcsa->locate(mem.range, mem.nodes);
-                }
-                // keep track of the initial number of hits we query in case the nodes vector is
-                // modified later (e.g. by prefiltering)
-                mem.queried_count = mem.nodes.size();
+                to_locate.push_back(&mem);
             }
         }
+    }
+    locate_mems(to_locate);
+    for (auto mem_ptr : to_locate) {
+        // keep track of the initial number of hits we query in case the nodes vector is
+        // modified later (e.g. by prefiltering)
+        mem_ptr->queried_count = mem_ptr->nodes.size();
+    }
+    for (auto& mem : mems) {
         filtered_mems += mem.match_count - mem.nodes.size();
         total_mems += mem.nodes.size();
 #ifdef debug_mapper
@@ -1874,21 +1991,18 @@ vector<MaximalExactMatch> BaseMapper::find_stripped_matches(string::const_iterat
     // matches are queried in reverse lexicographic order, flip them around
     reverse(matches.begin(), matches.end());
     
+    vector<MaximalExactMatch*> to_locate;
     for (MaximalExactMatch& match : matches) {
         // figure out how many occurrences there are
         match.match_count = gcsa->count(match.range);
         if (!hard_hit_max || match.match_count < hard_hit_max) {
             // the total number of hits is low enough that we think it's at least
-            // potentially worth querying hits
-            if (hit_max) {
-                // we may want to subsample
-                gcsa->locate(match.range, hit_max, match.nodes);
-                
-            } else {
-                // we won't subsample down to a prespecified maximum
-                gcsa->locate(match.range, match.nodes);
-            }
+            // potentially worth querying hits (subsampled to hit_max if set)
+            to_locate.push_back(&match);
         }
+    }
+    locate_mems(to_locate);
+    for (MaximalExactMatch& match : matches) {
         match.queried_count = match.nodes.size();
     }
     
@@ -1896,9 +2010,106 @@ vector<MaximalExactMatch> BaseMapper::find_stripped_matches(string::const_iterat
     return matches;
 }
 
+void BaseMapper::locate_mems(const vector<MaximalExactMatch*>& mems) const {
+    // visit the ranges in SA order, so that nearby samples are looked
+    // up together
+    vector<size_t> order(mems.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return mems[a]->range < mems[b]->range;
+    });
+    
+    for (size_t i = 0; i < order.size(); ) {
+        MaximalExactMatch& mem = *mems[order[i]];
+        if (hit_max) {
+            gcsa->locate(mem.range, hit_max, mem.nodes);
+        } else {
+            gcsa->locate(mem.range, mem.nodes);
+        }
+        // share the hits with any other MEMs that have the same range
+        size_t j = i + 1;
+        for (; j < order.size() && mems[order[j]]->range == mem.range; ++j) {
+            mems[order[j]]->nodes = mem.nodes;
+        }
+        i = j;
+    }
+}
+
+gcsa::range_type BaseMapper::backward_search(string::const_iterator begin,
+                                             string::const_iterator end) const {
+    auto cursor = end - 1;
+    gcsa::range_type range = accelerate_mem_query(begin, cursor);
+    while (cursor >= begin && !gcsa::Range::empty(range)) {
+        range = gcsa->LF(range, gcsa->alpha.char2comp[*cursor]);
+        --cursor;
+    }
+    return range;
+}
+
+string::const_iterator BaseMapper::lcp_free_mem_restart(string::const_iterator cursor,
+                                                        string::const_iterator curr_end,
+                                                        const gcsa::range_type& match_range,
+                                                        bool length_limited) const {
+    
+    // this finds the same restart point as walking up the parent suffix tree nodes of
+    // the match at cursor + 1 until one can be extended to cursor, except for the
+    // contained MEMs that would be filtered out anyway.
+    // the property we binary search for is monotonic in the length of the prefix of
+    // the match we keep, and the longest prefix that has it is the depth of a node
+    size_t lo = 0, hi = (curr_end - cursor) - 2;
+    while (lo < hi) {
+        size_t mid = (lo + hi + 1) / 2;
+        bool keep;
+        if (length_limited) {
+            // the match can be extended, but we went over the length limit, so we
+            // find the parent node of the match, which has a larger range
+            keep = (gcsa::Range::length(backward_search(cursor + 1, cursor + 1 + mid))
+                    > gcsa::Range::length(match_range));
+        }
+        else {
+            // the match can't be extended, so we find the longest prefix of it that can be
+            keep = !gcsa::Range::empty(backward_search(cursor, cursor + 1 + mid));
+        }
+        if (keep) {
+            lo = mid;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+    return cursor + 1 + lo;
+}
+
+void BaseMapper::prefetch_mem_query(string::const_iterator begin,
+                                    string::const_iterator cursor) const {
+    if (!accelerator) {
+        return;
+    }
+    if (accelerator->long_length() != 0 && cursor - begin >= accelerator->long_length() - 1) {
+        accelerator->prefetch_long(cursor);
+    }
+    if (cursor - begin >= accelerator->length() - 1) {
+        accelerator->prefetch(cursor);
+    }
+}
+
 gcsa::range_type BaseMapper::accelerate_mem_query(string::const_iterator begin,
                                                   string::const_iterator& cursor) const {
     
+    if (accelerator
+        && accelerator->long_length() != 0
+        && cursor - begin >= accelerator->long_length() - 1
+        && find(cursor - accelerator->long_length() + 1, cursor + 1, 'N') > cursor) {
+        // try the long k-mers first, since they get us the farthest
+        gcsa::range_type range;
+        if (accelerator->long_memoized_LF(cursor, range)) {
+            cursor -= accelerator->long_length();
+            return range;
+        }
+    }
+    
     if (!accelerator
         || cursor - begin < accelerator->length() - 1
         || find(cursor - accelerator->length() + 1, cursor + 1, 'N') <= cursor) {
@@ -5246,6 +5457,13 @@ void FragmentLengthDistribution::force_parameters(double mean, double stddev) {
     is_fixed = true;
 }
 
+void FragmentLengthDistribution::reset() {
+    lengths.clear();
+    mu = 0.0;
+    sigma = 1.0;
+    is_fixed = false;
+}
+
 void FragmentLengthDistribution::register_fragment_length(int64_t length) {
     // allow this function to operate fully in parallel once the distribution is
     // fixed (and hence threadsafe)
@@ -99,6 +99,10 @@ public:
     /// Instead of estimating anything, just use these parameters.
     void force_parameters(double mean, double stddev);
     
+    /// Forget all observed fragment lengths and any forced parameters, to
+    /// start estimating again.
+    void reset();
+    
     /// Record an observed fragment length
     void register_fragment_length(int64_t length);
 
@@ -220,7 +224,8 @@ public:
                    bool record_max_lcp = false,
                    int reseed_below_count = 0);
     
-    // Use the GCSA2 index to find super-maximal exact matches.
+    // Use the GCSA2 index to find super-maximal exact matches. The LCP array is
+    // optional here, but the MEMs are found faster with it.
     vector<MaximalExactMatch>
     find_mems_simple(string::const_iterator seq_begin,
                      string::const_iterator seq_end,
@@ -228,6 +233,15 @@ public:
                      int min_mem_length = 1,
                      int reseed_length = 0);
     
+    // Find the same MEMs as find_mems_simple for each of a batch of sequences. The
+    // backward searches of the sequences are interleaved so that their GCSA2 accesses
+    // can overlap in memory.
+    vector<vector<MaximalExactMatch>>
+    find_mems_simple_batch(const vector<pair<string::const_iterator, string::const_iterator>>& seqs,
+                           int max_mem_length = 0,
+                           int min_mem_length = 1,
+                           int reseed_length = 0);
+    
     vector<MaximalExactMatch>
     find_stripped_matches(string::const_iterator seq_begin,
                           string::const_iterator seq_end,
@@ -335,6 +349,42 @@ public:
                             int min_sub_mem_length,
                             vector<pair<MaximalExactMatch, vector<size_t>>>& sub_mems_out);
     
+    /// Same as find_mems_simple_batch, but with a separate maximum MEM length for each sequence.
+    vector<vector<MaximalExactMatch>>
+    find_mems_simple_batch(const vector<pair<string::const_iterator, string::const_iterator>>& seqs,
+                           const vector<int>& max_mem_lengths,
+                           int min_mem_length,
+                           int reseed_length);
+    
+    /// Run the backward searches of find_mems_simple in lockstep across the sequences, recording
+    /// the unfiltered MEMs of each sequence in the corresponding vector of the output.
+    void interleaved_smem_search(const vector<pair<string::const_iterator, string::const_iterator>>& seqs,
+                                 const vector<int>& max_mem_lengths,
+                                 vector<vector<MaximalExactMatch>>& mems_out) const;
+    
+    /// Fill in the hits of each of the given MEMs, as gcsa->locate() would, with at
+    /// most hit_max hits each if hit_max is set. The ranges are located in SA order,
+    /// and each distinct range is only located once, with any other MEMs that share
+    /// it (as repetitive reads and reseeding often produce) getting a copy of its hits.
+    void locate_mems(const vector<MaximalExactMatch*>& mems) const;
+    
+    /// Get the GCSA2 range of a sequence, or an empty range as soon as it has no matches.
+    gcsa::range_type backward_search(string::const_iterator begin,
+                                     string::const_iterator end) const;
+    
+    /// Without an LCP array, find the end of the next match that find_mems_simple should
+    /// try to extend to cursor, after the match from cursor + 1 to curr_end with the given
+    /// range either failed to extend or, if length_limited, reached the maximum length.
+    string::const_iterator lcp_free_mem_restart(string::const_iterator cursor,
+                                                string::const_iterator curr_end,
+                                                const gcsa::range_type& match_range,
+                                                bool length_limited) const;
+    
+    /// Start loading the MEMAccelerator entries that accelerate_mem_query will need for the same
+    /// arguments into cache.
+    void prefetch_mem_query(string::const_iterator begin,
+                            string::const_iterator cursor) const;
+    
     /// If possible, use the MEMAcclerator to get the initial range for a MEM and update the cursor
     /// accordingly. If this is not possible, return the full GCSA2 range and leave the cursor unaltered.
     gcsa::range_type accelerate_mem_query(string::const_iterator begin,
@@ -0,0 +1,169 @@
+/**
+ * \file materialized_overlay.cpp: contains the implementation of MaterializedOverlay
+ */
+
+
+#include "materialized_overlay.hpp"
+#include "utility.hpp"
+
+#include <unordered_map>
+
+
+namespace vg {
+
+using namespace std;
+
+    MaterializedOverlay::MaterializedOverlay(const ExpandingOverlayGraph* overlay) {
+
+        // decide on the node order, which is also the ID order
+        vector<handle_t> order;
+        if (handlealgs::is_directed_acyclic(overlay)) {
+            order = handlealgs::topological_order(overlay);
+        }
+        else {
+            order.reserve(overlay->get_node_count());
+            overlay->for_each_handle([&](const handle_t& handle) {
+                order.push_back(handle);
+            });
+        }
+
+        // remember which of our handles each overlay node's forward handle became
+        unordered_map<id_t, handle_t> translation;
+        translation.reserve(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            translation[overlay->get_id(order[i])] = handlegraph::number_bool_packing::pack(i, overlay->get_is_reverse(order[i]));
+        }
+        auto translate = [&](const handle_t& handle) {
+            handle_t translated = translation.at(overlay->get_id(handle));
+            return overlay->get_is_reverse(handle) ? flip(translated) : translated;
+        };
+
+        sequence_starts.reserve(order.size() + 1);
+        right_starts.reserve(order.size() + 1);
+        left_starts.reserve(order.size() + 1);
+        underlying.reserve(order.size());
+        underlying_reverse.reserve(order.size());
+        for (const handle_t& handle : order) {
+            sequence_starts.push_back(sequences.size());
+            sequences += overlay->get_sequence(handle);
+            underlying.push_back(overlay->get_underlying_handle(handle));
+            underlying_reverse.push_back(overlay->get_underlying_handle(overlay->flip(handle)));
+
+            right_starts.push_back(right_edges.size());
+            overlay->follow_edges(handle, false, [&](const handle_t& next) {
+                right_edges.push_back(translate(next));
+            });
+            left_starts.push_back(left_edges.size());
+            overlay->follow_edges(handle, true, [&](const handle_t& prev) {
+                left_edges.push_back(translate(prev));
+            });
+        }
+        sequence_starts.push_back(sequences.size());
+        right_starts.push_back(right_edges.size());
+        left_starts.push_back(left_edges.size());
+    }
+
+    bool MaterializedOverlay::has_node(id_t node_id) const {
+        return node_id >= 1 && node_id <= (id_t) underlying.size();
+    }
+
+    handle_t MaterializedOverlay::get_handle(const id_t& node_id, bool is_reverse) const {
+        return handlegraph::number_bool_packing::pack(node_id - 1, is_reverse);
+    }
+
+    id_t MaterializedOverlay::get_id(const handle_t& handle) const {
+        return rank_of(handle) + 1;
+    }
+
+    bool MaterializedOverlay::get_is_reverse(const handle_t& handle) const {
+        return handlegraph::number_bool_packing::unpack_bit(handle);
+    }
+
+    handle_t MaterializedOverlay::flip(const handle_t& handle) const {
+        return handlegraph::number_bool_packing::toggle_bit(handle);
+    }
+
+    size_t MaterializedOverlay::get_length(const handle_t& handle) const {
+        size_t rank = rank_of(handle);
+        return sequence_starts[rank + 1] - sequence_starts[rank];
+    }
+
+    string MaterializedOverlay::get_sequence(const handle_t& handle) const {
+        size_t rank = rank_of(handle);
+        string sequence = sequences.substr(sequence_starts[rank], sequence_starts[rank + 1] - sequence_starts[rank]);
+        return get_is_reverse(handle) ? reverse_complement(sequence) : sequence;
+    }
+
+    char MaterializedOverlay::get_base(const handle_t& handle, size_t index) const {
+        size_t rank = rank_of(handle);
+        if (get_is_reverse(handle)) {
+            return reverse_complement(sequences[sequence_starts[rank + 1] - index - 1]);
+        }
+        return sequences[sequence_starts[rank] + index];
+    }
+
+    string MaterializedOverlay::get_subsequence(const handle_t& handle, size_t index, size_t size) const {
+        size_t length = get_length(handle);
+        if (index >= length) {
+            return string();
+        }
+        size = min(size, length - index);
+        size_t rank = rank_of(handle);
+        if (get_is_reverse(handle)) {
+            return reverse_complement(sequences.substr(sequence_starts[rank + 1] - index - size, size));
+        }
+        return sequences.substr(sequence_starts[rank] + index, size);
+    }
+
+    size_t MaterializedOverlay::get_degree(const handle_t& handle, bool go_left) const {
+        size_t rank = rank_of(handle);
+        if (go_left != get_is_reverse(handle)) {
+            return left_starts[rank + 1] - left_starts[rank];
+        }
+        return right_starts[rank + 1] - right_starts[rank];
+    }
+
+    bool MaterializedOverlay::follow_edges_impl(const handle_t& handle, bool go_left,
+                                                const function<bool(const handle_t&)>& iteratee) const {
+        size_t rank = rank_of(handle);
+        bool is_reverse = get_is_reverse(handle);
+        // going left from a reverse handle is going right from the forward one, and vice versa
+        bool use_left = (go_left != is_reverse);
+        const vector<handle_t>& edges = use_left ? left_edges : right_edges;
+        const vector<size_t>& starts = use_left ? left_starts : right_starts;
+        for (size_t i = starts[rank]; i < starts[rank + 1]; ++i) {
+            if (!iteratee(is_reverse ? flip(edges[i]) : edges[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool MaterializedOverlay::for_each_handle_impl(const function<bool(const handle_t&)>& iteratee,
+                                                   bool parallel) const {
+        // these graphs are small enough that we always go in order
+        for (size_t i = 0; i < underlying.size(); ++i) {
+            if (!iteratee(handlegraph::number_bool_packing::pack(i, false))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t MaterializedOverlay::get_node_count() const {
+        return underlying.size();
+    }
+
+    id_t MaterializedOverlay::min_node_id() const {
+        return 1;
+    }
+
+    id_t MaterializedOverlay::max_node_id() const {
+        return underlying.size();
+    }
+
+    handle_t MaterializedOverlay::get_underlying_handle(const handle_t& handle) const {
+        size_t rank = rank_of(handle);
+        return get_is_reverse(handle) ? underlying_reverse[rank] : underlying[rank];
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef VG_MATERIALIZED_OVERLAY_HPP_INCLUDED
+#define VG_MATERIALIZED_OVERLAY_HPP_INCLUDED
+
+/** \file
+ * materialized_overlay.hpp: defines a copy of a small overlay graph in flat
+ * arrays, so that aligning to it does not translate through the overlay's
+ * layers on every query
+ */
+
+#include <string>
+#include <vector>
+
+#include "handle.hpp"
+
+namespace vg {
+
+using namespace std;
+
+    /**
+     * A HandleGraph that copies the nodes and edges of another overlay into
+     * flat arrays once, and then answers queries from them. It keeps the
+     * overlay's mapping to its underlying graph, so it can stand in for the
+     * overlay, which need not outlive it.
+     *
+     * Nodes are numbered 1 to N in topological order if the overlay is a DAG
+     * (and in the overlay's order otherwise), and iterated in that order. Node
+     * IDs do not match the overlay's; use get_underlying_handle() to translate.
+     * Meant for the small graphs extracted to align a read to, since it copies
+     * the whole overlay.
+     */
+    class MaterializedOverlay : public ExpandingOverlayGraph {
+    public:
+
+        /// Copy the given overlay
+        MaterializedOverlay(const ExpandingOverlayGraph* overlay);
+
+        /// Default constructor -- not actually functional
+        MaterializedOverlay() = default;
+
+        /// Default destructor
+        ~MaterializedOverlay() = default;
+
+        //////////////////////////
+        /// HandleGraph interface
+        //////////////////////////
+
+        // Method to check if a node exists by ID
+        bool has_node(id_t node_id) const;
+
+        /// Look up the handle for the node with the given ID in the given orientation
+        handle_t get_handle(const id_t& node_id, bool is_reverse = false) const;
+
+        /// Get the ID from a handle
+        id_t get_id(const handle_t& handle) const;
+
+        /// Get the orientation of a handle
+        bool get_is_reverse(const handle_t& handle) const;
+
+        /// Invert the orientation of a handle (potentially without getting its ID)
+        handle_t flip(const handle_t& handle) const;
+
+        /// Get the length of a node
+        size_t get_length(const handle_t& handle) const;
+
+        /// Get the sequence of a node, presented in the handle's local forward
+        /// orientation.
+        string get_sequence(const handle_t& handle) const;
+
+        /// Get a base of a node, in the handle's local forward orientation.
+        char get_base(const handle_t& handle, size_t index) const;
+
+        /// Get part of a node's sequence, in the handle's local forward
+        /// orientation.
+        string get_subsequence(const handle_t& handle, size_t index, size_t size) const;
+
+        /// Get the number of edges on the right (go_left = false) or left
+        /// (go_left = true) side of the given handle.
+        size_t get_degree(const handle_t& handle, bool go_left) const;
+
+        /// Loop over all the handles to next/previous (right/left) nodes. Passes
+        /// them to a callback which returns false to stop iterating and true to
+        /// continue. Returns true if we finished and false if we stopped early.
+        bool follow_edges_impl(const handle_t& handle, bool go_left,
+                               const function<bool(const handle_t&)>& iteratee) const;
+
+        /// Loop over all the nodes in the graph in their local forward
+        /// orientations, in their internal stored order. Stop if the iteratee
+        /// returns false. Can be told to run in parallel, in which case stopping
+        /// after a false return value is on a best-effort basis and iteration
+        /// order is not defined.
+        bool for_each_handle_impl(const function<bool(const handle_t&)>& iteratee,
+                                  bool parallel = false) const;
+
+        /// Return the number of nodes in the graph
+        size_t get_node_count() const;
+
+        /// Return the smallest ID in the graph, or some smaller number if the
+        /// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+        id_t min_node_id() const;
+
+        /// Return the largest ID in the graph, or some larger number if the
+        /// largest ID is unavailable. Return value is unspecified if the graph is empty.
+        id_t max_node_id() const;
+
+        ///////////////////////////////////
+        /// ExpandingOverlayGraph interface
+        ///////////////////////////////////
+
+        /**
+         * Returns the handle in the overlay's underlying graph that corresponds
+         * to a handle in this graph
+         */
+        handle_t get_underlying_handle(const handle_t& handle) const;
+
+    private:
+
+        /// Get the index of the node a handle is on
+        inline size_t rank_of(const handle_t& handle) const {
+            return handlegraph::number_bool_packing::unpack_number(handle);
+        }
+
+        /// All the node sequences, in order, forward
+        string sequences;
+        /// Where each node's sequence starts in sequences, with the total
+        /// length at the end
+        vector<size_t> sequence_starts;
+        /// The edges off the right side of each node's forward handle, with
+        /// each node's starting where the previous node's end
+        vector<handle_t> right_edges;
+        /// Where each node's right edges start, with the total at the end
+        vector<size_t> right_starts;
+        /// The edges off the left side of each node's forward handle
+        vector<handle_t> left_edges;
+        /// Where each node's left edges start, with the total at the end
+        vector<size_t> left_starts;
+        /// The overlay's underlying handle for each node's forward handle
+        vector<handle_t> underlying;
+        /// The same for each node's reverse handle
+        vector<handle_t> underlying_reverse;
+    };
+}
+
+#endif
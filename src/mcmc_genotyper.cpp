@@ -4,6 +4,7 @@
 #include <random> 
 #include <chrono>
 #include <utility>
+#include <numeric>
 #include "multipath_alignment.hpp"
 
 // #define stdout_for_performance_script
@@ -43,13 +44,26 @@ namespace vg {
         unique_ptr<unordered_set<size_t>> to_swap_back(nullptr);
         int count =0;
         enum sample_mode {PROPOSAL_ORIGINAL, PROPOSAL_KARGER_STEIN};       
+
+        // keep the score of each read on the current genome, so that a proposal only needs
+        // to rescore the reads that visit the sites it changes
+        vector<size_t> all_read_idxs(reads.size());
+        iota(all_read_idxs.begin(), all_read_idxs.end(), 0);
+        vector<int32_t> read_scores = score_reads(*genome, reads, all_read_idxs);
+        int64_t total_score = 0;
+        for (int32_t score : read_scores) {
+            total_score += score;
+        }
+        unordered_map<id_t, vector<size_t>> reads_by_node = index_reads_by_node(reads);
+        unordered_map<const Snarl*, vector<size_t>> reads_by_snarl;
+        vector<size_t> affected_reads;
         // build markov chain using Metropolis-Hastings
         for(int i = 0; i< n_iterations; i++){ 
             
             int random_num;
 
             // holds the previous sample allele
-            double x_prev = log_target(genome, reads);
+            double x_prev = total_score;
 
             tuple<int, const Snarl*, vector<NodeTraversal> > to_receive;
             int* modified_haplo;
@@ -114,6 +128,14 @@ namespace vg {
 #endif
                     break;
                 }
+                affected_reads.clear();
+                for (size_t snarl_num : *to_swap_back) {
+                    const vector<size_t>& snarl_reads = reads_in_snarl(snarls.translate_snarl_num(snarl_num),
+                                                                       reads_by_node, reads_by_snarl);
+                    affected_reads.insert(affected_reads.end(), snarl_reads.begin(), snarl_reads.end());
+                }
+                sort(affected_reads.begin(), affected_reads.end());
+                affected_reads.erase(unique(affected_reads.begin(), affected_reads.end()), affected_reads.end());
                 
             }
             if(random_num == PROPOSAL_ORIGINAL){ //otherwise choose original
@@ -135,6 +157,7 @@ namespace vg {
                 }else{
                     modified_site = get<1>(to_receive); 
                     old_allele = &get<2>(to_receive); 
+                    affected_reads = reads_in_snarl(modified_site, reads_by_node, reads_by_snarl);
                 }
             }
 
@@ -143,8 +166,13 @@ namespace vg {
             *                      ACCEPT/REJECT SAMPLE 
             *########################################################################################
             **/
-            // holds new sample allele score 
-            double x_new = log_target(genome, reads);
+            // holds new sample allele score, which only differs in the reads that visit the changed sites
+            vector<int32_t> affected_scores = score_reads(*genome, reads, affected_reads);
+            int64_t new_total_score = total_score;
+            for (size_t j = 0; j < affected_reads.size(); ++j) {
+                new_total_score += affected_scores[j] - read_scores[affected_reads[j]];
+            }
+            double x_new = new_total_score;
 
             double likelihood_ratio = exp(log_base*(x_new - x_prev));
             
@@ -186,6 +214,10 @@ namespace vg {
                 // genome->print_phased_genome();
 #endif
                 previous_likelihood = current_likelihood;   //ACCEPT
+                for (size_t j = 0; j < affected_reads.size(); ++j) {
+                    read_scores[affected_reads[j]] = affected_scores[j];
+                }
+                total_score = new_total_score;
             }
         } 
         if(!return_optimal){
@@ -214,6 +246,56 @@ namespace vg {
         return sum_scores;
     }
 
+    vector<int32_t> MCMCGenotyper::score_reads(PhasedGenome& genome, const vector<multipath_alignment_t>& reads,
+                                               const vector<size_t>& read_idxs) const{
+        
+        vector<int32_t> scores(read_idxs.size());
+        // scoring doesn't modify the genome, so the reads can be scored in parallel
+#pragma omp parallel for schedule(dynamic, 16) if (read_idxs.size() >= 256)
+        for (size_t i = 0; i < read_idxs.size(); i++) {
+            scores[i] = genome.optimal_score_on_genome(reads[read_idxs[i]], graph);
+        }
+        return scores;
+    }
+
+    unordered_map<id_t, vector<size_t>> MCMCGenotyper::index_reads_by_node(const vector<multipath_alignment_t>& reads) const{
+        
+        unordered_map<id_t, vector<size_t>> reads_by_node;
+        for (size_t i = 0; i < reads.size(); i++) {
+            for (const auto& subpath : reads[i].subpath()) {
+                for (const auto& mapping : subpath.path().mapping()) {
+                    vector<size_t>& node_reads = reads_by_node[mapping.position().node_id()];
+                    // reads are added in order, so we only need to check the last one
+                    if (node_reads.empty() || node_reads.back() != i) {
+                        node_reads.push_back(i);
+                    }
+                }
+            }
+        }
+        return reads_by_node;
+    }
+
+    const vector<size_t>& MCMCGenotyper::reads_in_snarl(const Snarl* snarl, const unordered_map<id_t, vector<size_t>>& reads_by_node,
+                                                        unordered_map<const Snarl*, vector<size_t>>& memo) const{
+        
+        auto found = memo.find(snarl);
+        if (found != memo.end()) {
+            return found->second;
+        }
+        
+        vector<size_t>& snarl_reads = memo[snarl];
+        // include the boundaries, since a read can span the snarl without visiting its interior
+        for (id_t node_id : snarls.deep_contents(snarl, graph, true).first) {
+            auto node_reads = reads_by_node.find(node_id);
+            if (node_reads != reads_by_node.end()) {
+                snarl_reads.insert(snarl_reads.end(), node_reads->second.begin(), node_reads->second.end());
+            }
+        }
+        sort(snarl_reads.begin(), snarl_reads.end());
+        snarl_reads.erase(unique(snarl_reads.begin(), snarl_reads.end()), snarl_reads.end());
+        return snarl_reads;
+    }
+
     tuple<int, const Snarl*, vector<NodeTraversal> > MCMCGenotyper::proposal_sample(unique_ptr<PhasedGenome>& current)const{
         // get a different traversal through the snarl by uniformly choosing from all possible ways to traverse the snarl
         
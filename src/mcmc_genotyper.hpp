@@ -88,6 +88,25 @@ public:
 
      unordered_set<size_t> alt_proposal_sample(vector<unordered_set<size_t>>& gamma, PhasedGenome& genome) const;
 
+     /**
+      * Score the reads with the given indexes on the phased genome, in parallel
+      */
+     vector<int32_t> score_reads(PhasedGenome& genome, const vector<multipath_alignment_t>& reads,
+                                 const vector<size_t>& read_idxs) const;
+
+     /**
+      * Make an index from each node ID to the reads that visit it
+      */
+     unordered_map<id_t, vector<size_t>> index_reads_by_node(const vector<multipath_alignment_t>& reads) const;
+
+     /**
+      * Get the reads that visit the snarl's nodes, including its boundaries and the nodes of
+      * its children, in increasing order. These are the only reads whose score can
+      * change when the alleles at the snarl change. Results are memoized.
+      */
+     const vector<size_t>& reads_in_snarl(const Snarl* snarl, const unordered_map<id_t, vector<size_t>>& reads_by_node,
+                                          unordered_map<const Snarl*, vector<size_t>>& memo) const;
+
 
 };
 
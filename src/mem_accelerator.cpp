@@ -1,16 +1,23 @@
 /**
- * \file mem_accelerator.hpp
+ * \file mem_accelerator.cpp
  *
  * Implements an index for accelerating GCSA2 queries
  */
 
 #include "mem_accelerator.hpp"
+#include "utility.hpp"
 #include <sdsl/util.hpp>
 #include <cmath>
+#include <omp.h>
 
 namespace vg {
 
-MEMAccelerator::MEMAccelerator(const gcsa::GCSA& gcsa_index, size_t k) : k(k)
+// marks the start of a serialized MEMAccelerator
+static const uint32_t MEM_ACCELERATOR_MAGIC = 0x414d454d; // "MEMA"
+static const uint32_t MEM_ACCELERATOR_VERSION = 1;
+
+MEMAccelerator::MEMAccelerator(const gcsa::GCSA& gcsa_index, size_t k, size_t long_k,
+                               size_t min_long_count) : k(k)
 {
     // compute the minimum width required to express the integers.
     range_table.width(max<uint8_t>(sdsl::bits::length(gcsa_index.size()), 1));
@@ -59,15 +66,127 @@ MEMAccelerator::MEMAccelerator(const gcsa::GCSA& gcsa_index, size_t k) : k(k)
             stack.emplace_back(0, enc, range);
         }
     }
+    
+    if (long_k <= k) {
+        return;
+    }
+    assert(long_k <= 32);
+    this->long_k = long_k;
+    
+    // find the frequent long k-mers by extending each frequent k-mer in the
+    // dense table, which only ever shrinks its range
+    vector<vector<pair<uint64_t, gcsa::range_type>>> thread_long_kmers(get_thread_count());
+#pragma omp parallel for schedule(dynamic, 256)
+    for (int64_t kmer = 0; kmer < (int64_t(1) << (2 * k)); ++kmer) {
+        gcsa::range_type kmer_range(range_table[2 * kmer], range_table[2 * kmer + 1]);
+        if (gcsa::Range::empty(kmer_range) || gcsa::Range::length(kmer_range) < min_long_count) {
+            continue;
+        }
+        auto& found = thread_long_kmers[omp_get_thread_num()];
+        // records of (next char to query, k-mer integer encoding, range), as above
+        vector<tuple<int64_t, uint64_t, gcsa::range_type>> long_stack;
+        long_stack.emplace_back(0, kmer, kmer_range);
+        while (!long_stack.empty()) {
+            if (long_stack.size() == long_k - k + 1) {
+                // we've walked the full long k-mer
+                found.emplace_back(get<1>(long_stack.back()), get<2>(long_stack.back()));
+                long_stack.pop_back();
+            }
+            else if (get<0>(long_stack.back()) == 4) {
+                // we've walked all the long k-mers that start with this prefix
+                long_stack.pop_back();
+            }
+            else {
+                // extend the current range by the next character, if it stays frequent
+                uint64_t next = get<0>(long_stack.back())++;
+                uint64_t enc = (next << (2 * (k + long_stack.size() - 1))) | get<1>(long_stack.back());
+                gcsa::range_type range = gcsa_index.LF(get<2>(long_stack.back()),
+                                                       gcsa_index.alpha.char2comp[alphabet[next]]);
+                if (!gcsa::Range::empty(range) && gcsa::Range::length(range) >= min_long_count) {
+                    long_stack.emplace_back(0, enc, range);
+                }
+            }
+        }
+    }
+    
+    // lay them out in a hash table at most half full, in a consistent order
+    vector<pair<uint64_t, gcsa::range_type>> long_kmer_ranges;
+    for (auto& found : thread_long_kmers) {
+        long_kmer_ranges.insert(long_kmer_ranges.end(), found.begin(), found.end());
+        vector<pair<uint64_t, gcsa::range_type>>().swap(found);
+    }
+    sort(long_kmer_ranges.begin(), long_kmer_ranges.end());
+    size_t slots = 1;
+    while (slots < 2 * long_kmer_ranges.size()) {
+        slots *= 2;
+    }
+    long_occupied = sdsl::bit_vector(slots, 0);
+    long_kmers = sdsl::int_vector<>(slots, 0, 2 * long_k);
+    long_range_starts = sdsl::int_vector<>(slots, 0, range_table.width());
+    long_range_ends = sdsl::int_vector<>(slots, 0, range_table.width());
+    for (auto& long_kmer_range : long_kmer_ranges) {
+        size_t i = long_slot(long_kmer_range.first);
+        while (long_occupied[i]) {
+            i = (i + 1) & (slots - 1);
+        }
+        long_occupied[i] = 1;
+        long_kmers[i] = long_kmer_range.first;
+        long_range_starts[i] = long_kmer_range.second.first;
+        long_range_ends[i] = long_kmer_range.second.second;
+    }
 }
 
 gcsa::range_type MEMAccelerator::memoized_LF(string::const_iterator last) const {
-    int64_t enc = 0;
-    for (size_t i = 0; i < k; ++i) {
-        enc |= (encode(*last) << (i << 1));
-        --last;
-    }
+    uint64_t enc = encode_kmer(last, k);
     return gcsa::range_type(range_table[enc << 1], range_table[(enc << 1) | 1]);
 }
 
+bool MEMAccelerator::long_memoized_LF(string::const_iterator last, gcsa::range_type& range) const {
+    if (long_k == 0) {
+        return false;
+    }
+    uint64_t enc = encode_kmer(last, long_k);
+    for (size_t i = long_slot(enc); long_occupied[i]; i = (i + 1) & (long_kmers.size() - 1)) {
+        if (long_kmers[i] == enc) {
+            range = gcsa::range_type(long_range_starts[i], long_range_ends[i]);
+            return true;
+        }
+    }
+    return false;
+}
+
+void MEMAccelerator::serialize(ostream& out) const {
+    sdsl::write_member(MEM_ACCELERATOR_MAGIC, out);
+    sdsl::write_member(MEM_ACCELERATOR_VERSION, out);
+    sdsl::write_member(k, out);
+    sdsl::write_member(long_k, out);
+    range_table.serialize(out);
+    long_occupied.serialize(out);
+    long_kmers.serialize(out);
+    long_range_starts.serialize(out);
+    long_range_ends.serialize(out);
+    if (!out) {
+        throw runtime_error("error: could not write MEMAccelerator");
+    }
+}
+
+void MEMAccelerator::load(istream& in) {
+    uint32_t magic = 0, version = 0;
+    sdsl::read_member(magic, in);
+    sdsl::read_member(version, in);
+    if (!in || magic != MEM_ACCELERATOR_MAGIC || version != MEM_ACCELERATOR_VERSION) {
+        throw runtime_error("error: not a MEMAccelerator of a supported version");
+    }
+    sdsl::read_member(k, in);
+    sdsl::read_member(long_k, in);
+    range_table.load(in);
+    long_occupied.load(in);
+    long_kmers.load(in);
+    long_range_starts.load(in);
+    long_range_ends.load(in);
+    if (!in) {
+        throw runtime_error("error: truncated MEMAccelerator");
+    }
+}
+
 }
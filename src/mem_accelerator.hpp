@@ -8,49 +8,101 @@
 #define VG_MEM_ACCELERATOR_HPP_INCLUDED
 
 #include <cstdint>
+#include <iostream>
 #include <string>
 #include <gcsa/gcsa.h>
 #include <sdsl/int_vector.hpp>
 
+#include "wang_hash.hpp"
+
 namespace vg {
 
 using namespace std;
 
 /*
  * An auxilliary index that accelerates the initial steps of
- * MEM-finding in
+ * MEM-finding in a GCSA2. It has two levels: a dense table of
+ * the ranges of all k-mers, and optionally a sparse hash table
+ * of the ranges of frequent longer k-mers.
  */
 class MEMAccelerator {
 public:
-    
+
     MEMAccelerator() = default;
-    MEMAccelerator(const gcsa::GCSA& gcsa_index, size_t k);
-    
+
+    // memoize the ranges of all k-mers, and if long_k > k, also those
+    // of the long_k-mers that occur at least min_long_count times.
+    // long_k can be at most 32.
+    MEMAccelerator(const gcsa::GCSA& gcsa_index, size_t k, size_t long_k = 0,
+                   size_t min_long_count = 16);
+
     // return the length of k-mers that are memoized
     inline int64_t length() const;
-    
+
+    // return the length of the long k-mers that are memoized, or 0
+    // if there are none
+    inline int64_t long_length() const;
+
     // look up the GCSA range that corresponds to a k-length
     // string ending at the indicated position. client code
     // is responsible for ensuring that the string being
     // accessed is at least length k and consists only of ACGT
     // characters
     gcsa::range_type memoized_LF(string::const_iterator last) const;
-    
+
+    // look up the GCSA range that corresponds to a long_k-length
+    // string ending at the indicated position, returning false
+    // if it is not frequent enough to be memoized. the same
+    // requirements apply as for memoized_LF
+    bool long_memoized_LF(string::const_iterator last, gcsa::range_type& range) const;
+
+    // ask for the memory that memoized_LF and long_memoized_LF will
+    // read for the string ending at the indicated position to be
+    // brought into cache, so that the lookup can overlap with other
+    // work. this is only a hint, so the string needs to be long enough
+    // but may contain non-ACGT characters
+    inline void prefetch(string::const_iterator last) const;
+    inline void prefetch_long(string::const_iterator last) const;
+
+    // save to and load from a stream
+    void serialize(ostream& out) const;
+    void load(istream& in);
+
 private:
-    
+
     inline int64_t encode(char c) const;
-    
+
+    // encode the given number of bases ending at the indicated
+    // position, last base in the low bits
+    inline uint64_t encode_kmer(string::const_iterator last, int64_t length) const;
+
+    // the slot where a long k-mer's probe sequence starts
+    inline size_t long_slot(uint64_t enc) const;
+
     // the size k-mer we'll index
-    const int64_t k = 1;
+    int64_t k = 1;
     // the actual table
     sdsl::int_vector<> range_table;
-    
+
+    // the size of the long k-mers we'll index
+    int64_t long_k = 0;
+    // open-addressing hash table of long k-mers, with a power
+    // of 2 number of slots
+    sdsl::bit_vector long_occupied;
+    sdsl::int_vector<> long_kmers;
+    sdsl::int_vector<> long_range_starts;
+    sdsl::int_vector<> long_range_ends;
+
 };
 
 inline int64_t MEMAccelerator::length() const {
     return k;
 }
 
+inline int64_t MEMAccelerator::long_length() const {
+    return long_k;
+}
+
 inline int64_t MEMAccelerator::encode(char c) const {
     switch (c) {
         case 'A':
@@ -66,6 +118,36 @@ inline int64_t MEMAccelerator::encode(char c) const {
     }
 }
 
+inline uint64_t MEMAccelerator::encode_kmer(string::const_iterator last, int64_t length) const {
+    uint64_t enc = 0;
+    for (int64_t i = 0; i < length; ++i) {
+        enc |= (uint64_t(encode(*last)) << (i << 1));
+        --last;
+    }
+    return enc;
+}
+
+inline size_t MEMAccelerator::long_slot(uint64_t enc) const {
+    return wang_hash_64(enc) & (long_kmers.size() - 1);
+}
+
+inline void MEMAccelerator::prefetch(string::const_iterator last) const {
+    // mask off the bits that a non-ACGT character would set out of range
+    uint64_t enc = encode_kmer(last, k) & ((uint64_t(1) << (2 * k)) - 1);
+    __builtin_prefetch(range_table.data() + (((enc << 1) * range_table.width()) >> 6), 0, 0);
+}
+
+inline void MEMAccelerator::prefetch_long(string::const_iterator last) const {
+    if (long_k == 0) {
+        return;
+    }
+    size_t i = long_slot(encode_kmer(last, long_k));
+    __builtin_prefetch(long_occupied.data() + (i >> 6), 0, 0);
+    __builtin_prefetch(long_kmers.data() + ((i * long_kmers.width()) >> 6), 0, 0);
+    __builtin_prefetch(long_range_starts.data() + ((i * long_range_starts.width()) >> 6), 0, 0);
+    __builtin_prefetch(long_range_ends.data() + ((i * long_range_ends.width()) >> 6), 0, 0);
+}
+
 }
 
 #endif
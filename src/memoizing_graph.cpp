@@ -14,6 +14,11 @@ using namespace std;
         
     }
     
+    MemoizingGraph::MemoizingGraph(const PathPositionHandleGraph* graph, const PathOffsetIndex* path_offsets) :
+        graph(graph), path_offsets(path_offsets) {
+        
+    }
+    
     bool MemoizingGraph::has_node(id_t node_id) const {
         bool found_node = false;
         if (graph->has_node(node_id)) {
@@ -213,6 +218,12 @@ using namespace std;
     }
     
     size_t MemoizingGraph::get_position_of_step(const step_handle_t& step) const {
+        if (path_offsets) {
+            size_t offset;
+            if (path_offsets->find_offset(graph->get_id(graph->get_handle_of_step(step)), step, offset)) {
+                return offset;
+            }
+        }
         return graph->get_position_of_step(step);
     }
     
@@ -7,6 +7,7 @@
  */
 
 #include "handle.hpp"
+#include "path_offset_index.hpp"
 
 #include <unordered_map>
 
@@ -16,7 +17,7 @@ using namespace std;
 
     /**
      * A PathPositionHandleGraph implementation that memoizes the results of get_handle
-     * and steps_of_handle.
+     * and steps_of_handle, and can answer step positions from a PathOffsetIndex.
      */
     class MemoizingGraph : public PathPositionHandleGraph {
     public:
@@ -24,6 +25,10 @@ using namespace std;
         /// Initialize with a pointer to graph we want to memoize operations for
         MemoizingGraph(const PathPositionHandleGraph* graph);
         
+        /// Initialize with a pointer to graph we want to memoize operations for, and an
+        /// index to look up the positions of steps on its paths in, which may be null
+        MemoizingGraph(const PathPositionHandleGraph* graph, const PathOffsetIndex* path_offsets);
+        
         /// Default constructor -- not actually functional
         MemoizingGraph() = default;
         
@@ -206,6 +211,9 @@ using namespace std;
         /// The graph we're memoizing operations for
         const PathPositionHandleGraph* graph = nullptr;
         
+        /// Shared index of step positions on some of the graph's paths, if any
+        const PathOffsetIndex* path_offsets = nullptr;
+        
         /// Memo for get_handle
         unordered_map<id_t, handle_t> get_handle_memo;
         
@@ -24,6 +24,9 @@ size_t get_max_vmem_kb();
 /// Get the current virtual memory size, in kb, or 0 if unsupported.
 size_t get_current_vmem_kb();
 
+/// Get the current RSS usage, in kb, or 0 if unsupported.
+size_t get_current_rss_kb();
+
 
 }
 
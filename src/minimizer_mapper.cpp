@@ -6,6 +6,7 @@
 #include "minimizer_mapper.hpp"
 
 #include "crash.hpp"
+#include "scratch_arena.hpp"
 #include "annotation.hpp"
 #include "path_subgraph.hpp"
 #include "multipath_alignment.hpp"
@@ -17,12 +18,14 @@
 #include "algorithms/extract_containing_graph.hpp"
 #include "algorithms/extract_connecting_graph.hpp"
 #include "algorithms/chain_items.hpp"
+#include "algorithms/dag_edit_distance.hpp"
 
 #include <bdsg/overlays/strand_split_overlay.hpp>
 #include <gbwtgraph/algorithms.h>
 #include <gbwtgraph/cached_gbwtgraph.h>
 
 #include <iostream>
+#include <list>
 #include <algorithm>
 #include <cmath>
 #include <cfloat>
@@ -44,6 +47,9 @@ namespace vg {
 
 using namespace std;
 
+/// Source of MinimizerMapper::instance_id values
+static atomic<size_t> next_instance_id(0);
+
 MinimizerMapper::MinimizerMapper(const gbwtgraph::GBWTGraph& graph,
     const gbwtgraph::DefaultMinimizerIndex& minimizer_index,
     SnarlDistanceIndex* distance_index, 
@@ -57,6 +63,8 @@ MinimizerMapper::MinimizerMapper(const gbwtgraph::GBWTGraph& graph,
     
     // The GBWTGraph needs a GBWT
     crash_unless(graph.index != nullptr);
+    
+    instance_id = next_instance_id.fetch_add(1);
 }
 
 void MinimizerMapper::set_alignment_scores(const int8_t* score_matrix, int8_t gap_open, int8_t gap_extend, int8_t full_length_bonus) {
@@ -184,6 +192,10 @@ string MinimizerMapper::log_bits(const std::vector<bool>& bits) {
 
 void MinimizerMapper::dump_chaining_problem(const std::vector<algorithms::Anchor>& anchors, const std::vector<size_t>& cluster_seeds_sorted, const HandleGraph& graph) {
     ProblemDumpExplainer exp;
+    if (!exp.is_enabled()) {
+        // This problem isn't sampled, so don't bother extracting its subgraph.
+        return;
+    }
     
     // We need to keep track of all the points we want in our problem subgraph.
     std::vector<pos_t> seed_positions;
@@ -566,15 +578,55 @@ void MinimizerMapper::map(Alignment& aln, AlignmentEmitter& alignment_emitter) {
 }
 
 vector<Alignment> MinimizerMapper::map(Alignment& aln) {
-    if (align_from_chains) {
-        return map_from_chains(aln);
-    } else {
-        return map_from_extensions(aln);
+    string key;
+    if (use_duplicate_cache()) {
+        key = duplicate_key(aln);
+        vector<Alignment> mappings;
+        if (duplicate_read_results.lookup(key, mappings)) {
+            // We mapped this exact read before, so only the name differs.
+            for (auto& mapping : mappings) {
+                mapping.set_name(aln.name());
+            }
+            return mappings;
+        }
+    }
+    
+    vector<Alignment> mappings = align_from_chains ? map_from_chains(aln) : map_from_extensions(aln);
+    
+    if (use_duplicate_cache()) {
+        duplicate_read_results.insert(key, mappings, duplicate_cache_size);
     }
+    return mappings;
+}
+
+string MinimizerMapper::duplicate_key(const Alignment& aln) {
+    string key;
+    key.reserve(aln.sequence().size() + aln.quality().size() + 1);
+    key.append(aln.sequence());
+    // Sequences can't contain a tab, so this can't run into the qualities.
+    key.push_back('\t');
+    key.append(aln.quality());
+    return key;
+}
+
+size_t MinimizerMapper::duplicate_cache_hits() const {
+    return duplicate_read_results.hits() + duplicate_pair_results.hits();
+}
+
+size_t MinimizerMapper::duplicate_cache_misses() const {
+    return duplicate_read_results.misses() + duplicate_pair_results.misses();
+}
+
+void MinimizerMapper::clear_duplicate_caches() {
+    duplicate_read_results.clear();
+    duplicate_pair_results.clear();
 }
 
 vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
     
+    // Per-read scratch memory comes from this thread's arena, and is all freed at once when we finish the read.
+    ScratchArena::Scope scratch_scope;
+    
     if (show_work) {
         #pragma omp critical (cerr)
         dump_debug_query(aln);
@@ -597,12 +649,15 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
     vector<Seed> seeds = this->find_seeds(minimizers, aln, funnel);
 
     // Cluster the seeds. Get sets of input seed indexes that go together.
-    if (track_provenance) {
+    if (track_stages()) {
         funnel.stage("cluster");
     }
 
     // Find the clusters
     std::vector<Cluster> clusters = clusterer.cluster_seeds(seeds, get_distance_limit(aln.sequence().size()));
+    if (stage_stats) {
+        funnel.count_items(clusters.size());
+    }
     
 #ifdef debug_validate_clusters
     vector<vector<Cluster>> all_clusters;
@@ -646,7 +701,7 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
         cluster_score_cutoff = std::min(cluster_score_cutoff, second_best_cluster_score);
     }
 
-    if (track_provenance) {
+    if (track_stages()) {
         // Now we go from clusters to gapless extensions
         funnel.stage("extend");
     }
@@ -654,6 +709,10 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
     // These are the GaplessExtensions for all the clusters.
     vector<vector<GaplessExtension>> cluster_extensions;
     cluster_extensions.reserve(clusters.size());
+
+    // All the clusters share one GBWT record cache, since they tend to visit
+    // the same nodes.
+    GaplessExtensionCache extension_cache(gbwt_graph, extension_cache_records);
     
     // To compute the windows for explored minimizers, we need to get
     // all the minimizers that are explored.
@@ -663,6 +722,23 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
 
     size_t kept_cluster_count = 0;
     
+    // If we are culling clusters by their score bounds, we need to know which
+    // minimizers were located, and the best extension set score so far.
+    SmallBitset minimizer_located(cull_clusters_by_bound ? minimizers.size() : 0);
+    if (cull_clusters_by_bound) {
+        for (auto& seed : seeds) {
+            minimizer_located.insert(seed.source);
+        }
+    }
+    int best_extension_score = std::numeric_limits<int>::min();
+    
+    // Count the work we do on this read.
+    WorkBudget work_budget(max_work);
+    
+    // Mask the read once for all the clusters.
+    PreparedRead& prepared_read = PreparedRead::for_this_thread();
+    prepared_read.prepare(aln.sequence());
+    
     //Process clusters sorted by both score and read coverage
     process_until_threshold_c<double>(clusters.size(), [&](size_t i) -> double {
             return clusters[i].coverage;
@@ -701,6 +777,36 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
                 funnel.pass("cluster-score", cluster_num, cluster.score);
             }
             
+            if (cull_clusters_by_bound) {
+                // Don't extend the cluster if it can't make an alignment good
+                // enough to survive the extension set score threshold.
+                int bound = cluster_score_bound(cluster, minimizers, minimizer_located, aln.sequence().size());
+                if (kept_cluster_count >= min_extensions && best_extension_score != std::numeric_limits<int>::min() &&
+                    bound < best_extension_score - extension_set_score_threshold) {
+                    if (track_provenance) {
+                        funnel.fail("cluster-bound", cluster_num, bound);
+                    }
+                    if (show_work) {
+                        #pragma omp critical (cerr)
+                        {
+                            cerr << log_name() << "Cluster " << cluster_num << " can score at most " << bound
+                                 << " but we already have " << best_extension_score << endl;
+                        }
+                    }
+                    return false;
+                }
+                if (track_provenance) {
+                    funnel.pass("cluster-bound", cluster_num, bound);
+                }
+            }
+            
+            if (!work_budget.allows_more(kept_cluster_count > 0)) {
+                // We have done all the work we are allowed to for this read.
+                if (track_provenance) {
+                    funnel.fail("work-budget", cluster_num);
+                }
+                return false;
+            }
 
             if (show_work) {
                 #pragma omp critical (cerr)
@@ -717,9 +823,17 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
                 cluster_num,
                 minimizers,
                 seeds,
-                aln.sequence(),
+                prepared_read,
+                extension_cache,
                 minimizer_extended_cluster_count,
                 funnel));
+            work_budget.spend(cluster.seeds.size());
+            
+            if (cull_clusters_by_bound) {
+                best_extension_score = std::max(best_extension_score,
+                    score_extension_group(aln, cluster_extensions.back(), get_regular_aligner()->gap_open,
+                                          get_regular_aligner()->gap_extension));
+            }
             
             kept_cluster_count ++;
             
@@ -758,8 +872,15 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
             }
         });
         
-    std::vector<int> cluster_extension_scores = this->score_extensions(cluster_extensions, aln, funnel);
     if (track_provenance) {
+        count_extension_cache_use(extension_cache, 0, 0, 0, funnel);
+    }
+
+    std::vector<int> cluster_extension_scores = this->score_extensions(cluster_extensions, aln, funnel);
+    if (stage_stats) {
+        funnel.count_items(cluster_extensions.size());
+    }
+    if (track_stages()) {
         funnel.stage("align");
     }
 
@@ -826,6 +947,14 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
                 return false;
             }
             
+            if (!work_budget.allows_more(!alignments.empty())) {
+                // We have done all the work we are allowed to for this read.
+                if (track_provenance) {
+                    funnel.fail("work-budget", extension_num);
+                }
+                return false;
+            }
+            
             if (show_work) {
                 #pragma omp critical (cerr)
                 {
@@ -843,6 +972,7 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
             }
 
             auto& extensions = cluster_extensions[extension_num];
+            work_budget.spend(extensions.size());
 
             // Collect the top alignments. Make sure we have at least one always, starting with unaligned.
             vector<Alignment> best_alignments(1, aln);
@@ -979,7 +1109,10 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
         }
     }
     
-    if (track_provenance) {
+    if (stage_stats) {
+        funnel.count_items(alignments.size());
+    }
+    if (track_stages()) {
         // Now say we are finding the winner(s)
         funnel.stage("winner");
     }
@@ -1068,10 +1201,16 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
     double escape_bonus = mapq < std::numeric_limits<int32_t>::max() ? 1.0 : 2.0;
     double mapq_explored_cap = escape_bonus * faster_cap(minimizers, explored_minimizers, aln.sequence(), aln.quality());
 
+    // Collect the annotations for the primary mapping, to attach at the end
+    AnnotationBuffer annotations;
+    
     // Remember the uncapped MAPQ and the caps
-    set_annotation(mappings.front(),"secondary_scores", scores);
-    set_annotation(mappings.front(), "mapq_uncapped", mapq);
-    set_annotation(mappings.front(), "mapq_explored_cap", mapq_explored_cap);
+    set_annotation(annotations,"secondary_scores", scores);
+    set_annotation(annotations, "mapq_uncapped", mapq);
+    set_annotation(annotations, "mapq_explored_cap", mapq_explored_cap);
+    if (work_budget.exhausted()) {
+        set_annotation(annotations, "work_budget_exhausted", true);
+    }
 
     // Apply the caps and transformations
     mapq = round(min(mapq_explored_cap, min(mapq, 60.0)));
@@ -1100,28 +1239,38 @@ vector<Alignment> MinimizerMapper::map_from_extensions(Alignment& aln) {
         out.set_is_secondary(i > 0);
     }
     
+    if (stage_stats) {
+        funnel.count_items(mappings.size());
+    }
+    
     // Stop this alignment
     funnel.stop();
     
+    if (stage_stats) {
+        stage_stats->record(omp_get_thread_num(), funnel);
+    }
+    
     // Annotate with whatever's in the funnel
-    funnel.annotate_mapped_alignment(mappings[0], track_correctness);
+    funnel.annotate_mapped_alignment(mappings[0], annotations, track_correctness);
     
     if (track_provenance) {
         if (track_correctness) {
             annotate_with_minimizer_statistics(mappings[0], minimizers, seeds, seeds.size(), 0, funnel);
         }
         // Annotate with parameters used for the filters.
-        set_annotation(mappings[0], "param_hit-cap", (double) hit_cap);
-        set_annotation(mappings[0], "param_hard-hit-cap", (double) hard_hit_cap);
-        set_annotation(mappings[0], "param_score-fraction", (double) minimizer_score_fraction);
-        set_annotation(mappings[0], "param_max-extensions", (double) max_extensions);
-        set_annotation(mappings[0], "param_max-alignments", (double) max_alignments);
-        set_annotation(mappings[0], "param_cluster-score", (double) cluster_score_threshold);
-        set_annotation(mappings[0], "param_cluster-coverage", (double) cluster_coverage_threshold);
-        set_annotation(mappings[0], "param_extension-set", (double) extension_set_score_threshold);
-        set_annotation(mappings[0], "param_max-multimaps", (double) max_multimaps);
+        set_annotation(annotations, "param_hit-cap", (double) hit_cap);
+        set_annotation(annotations, "param_hard-hit-cap", (double) hard_hit_cap);
+        set_annotation(annotations, "param_score-fraction", (double) minimizer_score_fraction);
+        set_annotation(annotations, "param_max-extensions", (double) max_extensions);
+        set_annotation(annotations, "param_max-alignments", (double) max_alignments);
+        set_annotation(annotations, "param_cluster-score", (double) cluster_score_threshold);
+        set_annotation(annotations, "param_cluster-coverage", (double) cluster_coverage_threshold);
+        set_annotation(annotations, "param_extension-set", (double) extension_set_score_threshold);
+        set_annotation(annotations, "param_max-multimaps", (double) max_multimaps);
     }
     
+    attach_annotations(annotations, mappings[0]);
+    
 #ifdef print_minimizer_table
     cerr << aln.sequence() << "\t";
     for (char c : aln.quality()) {
@@ -1183,9 +1332,21 @@ void MinimizerMapper::pair_all(std::array<vector<Alignment>, 2>& mappings) const
     }
 }
 
+void MinimizerMapper::attach_annotations(const AnnotationBuffer& annotations, Alignment& aln) const {
+    if (keep_all_annotations) {
+        annotations.apply_to(aln);
+    } else {
+        // Only pairing status is written out in GAF and HTS formats
+        static const function<bool(const string&)> emitted = [](const string& name) {
+            return name == "proper_pair";
+        };
+        annotations.apply_to(aln, &emitted);
+    }
+}
+
 pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment& aln1, Alignment& aln2,
                                                       vector<pair<Alignment, Alignment>>& ambiguous_pair_buffer){
-    if (fragment_length_distr.is_finalized()) {
+    if (fragment_distr_is_finalized()) {
 
         //If we know the fragment length distribution then we just map paired ended 
         return map_paired(aln1, aln2);
@@ -1225,7 +1386,13 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                     return gbwt_graph.get_length(gbwt_graph.get_handle(node_id));
                     });           
             // If that all checks out, say they're mapped, emit them, and register their distance and orientations
-            fragment_length_distr.register_fragment_length(dist);
+            {
+                std::lock_guard<std::mutex> lock(fragment_length_mutex);
+                if (!fragment_length_distr.is_finalized()) {
+                    // Another thread may have finished the distribution while we were mapping
+                    fragment_length_distr.register_fragment_length(dist);
+                }
+            }
 
             std::array<vector<Alignment>, 2> mapped_pair;
             for (auto r : {0, 1}) {
@@ -1341,6 +1508,43 @@ struct alignment_index_t {
 const alignment_index_t NO_INDEX {std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max(), std::numeric_limits<bool>::max()};
 
 pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment& aln1, Alignment& aln2) {
+    if (!use_duplicate_cache() || !fragment_distr_is_finalized()) {
+        // Results for the pair depend on the distribution, so we can only
+        // reuse them once it stops changing.
+        return map_paired_with_distribution(aln1, aln2);
+    }
+    
+    string key = duplicate_key(aln1);
+    key.push_back('\t');
+    key.append(duplicate_key(aln2));
+    
+    pair<vector<Alignment>, vector<Alignment>> mappings;
+    if (duplicate_pair_results.lookup(key, mappings)) {
+        // We mapped this exact pair before, so only the names differ.
+        for (auto& mapping : mappings.first) {
+            mapping.set_name(aln1.name());
+            if (mapping.has_fragment_next()) {
+                mapping.mutable_fragment_next()->set_name(aln2.name());
+            }
+        }
+        for (auto& mapping : mappings.second) {
+            mapping.set_name(aln2.name());
+            if (mapping.has_fragment_prev()) {
+                mapping.mutable_fragment_prev()->set_name(aln1.name());
+            }
+        }
+        return mappings;
+    }
+    
+    mappings = map_paired_with_distribution(aln1, aln2);
+    duplicate_pair_results.insert(key, mappings, duplicate_cache_size);
+    return mappings;
+}
+
+pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired_with_distribution(Alignment& aln1, Alignment& aln2) {
+    
+    // Per-pair scratch memory comes from this thread's arena, and is all freed at once when we finish the pair.
+    ScratchArena::Scope scratch_scope;
     
     if (show_work) {
         #pragma omp critical (cerr)
@@ -1409,8 +1613,18 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
     std::array<std::vector<size_t>, 2> minimizer_score_order_by_read;
     // Minimizers for both reads, sorted by best score first.
     std::array<VectorView<Minimizer>, 2> minimizers_by_read;
+    if (this->batch_minimizers) {
+        // Look up the minimizers of both reads together.
+        std::vector<std::vector<Minimizer>> batch = this->find_minimizers_batch({&alns[0]->sequence(), &alns[1]->sequence()}, {&funnels[0], &funnels[1]});
+        for (auto r : {0, 1}) {
+            minimizers_in_read_by_read[r] = std::move(batch[r]);
+        }
+    } else {
+        for (auto r : {0, 1}) {
+            minimizers_in_read_by_read[r] = this->find_minimizers(alns[r]->sequence(), funnels[r]);
+        }
+    }
     for (auto r : {0, 1}) {
-        minimizers_in_read_by_read[r] = this->find_minimizers(alns[r]->sequence(), funnels[r]);
         minimizer_score_order_by_read[r] = sort_minimizers_by_score(minimizers_in_read_by_read[r]);
         minimizers_by_read[r] = {minimizers_in_read_by_read[r], minimizer_score_order_by_read[r]};
     }
@@ -1425,13 +1639,18 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
     }
 
     // Cluster the seeds. Get sets of input seed indexes that go together.
-    if (track_provenance) {
+    if (track_stages()) {
         for (auto r : {0, 1}) {
             funnels[r].stage("cluster");
         }
     }
 
     std::vector<std::vector<Cluster>> all_clusters = clusterer.cluster_seeds(seeds_by_read, get_distance_limit(aln1.sequence().size()), fragment_distance_limit);
+    if (stage_stats) {
+        for (auto r : {0, 1}) {
+            funnels[r].count_items(all_clusters[r].size());
+        }
+    }
 #ifdef debug_validate_clusters
     validate_clusters(all_clusters, seeds_by_read, get_distance_limit(aln1.sequence().size()), fragment_distance_limit);
 
@@ -1583,6 +1802,13 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
     alignment_indices.resize(max_fragment_num + 2);
 
     //Now that we've scored each of the clusters, extend and align them
+    // Both reads share one GBWT record cache for their extensions, since
+    // they come from the same place.
+    GaplessExtensionCache extension_cache(gbwt_graph, extension_cache_records);
+
+    // Count the work we do on each read.
+    std::array<WorkBudget, 2> work_budgets {WorkBudget(max_work), WorkBudget(max_work)};
+
     for (size_t read_num = 0 ; read_num < 2 ; read_num++) {
         Alignment& aln = *alns[read_num];
         std::vector<Cluster>& clusters = all_clusters[read_num];
@@ -1628,7 +1854,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
             cluster_score_cutoff = std::min(cluster_score_cutoff, second_best_cluster_score);
         }
 
-        if (track_provenance) {
+        if (track_stages()) {
             // Now we go from clusters to gapless extensions
             funnels[read_num].stage("extend");
         }
@@ -1637,10 +1863,29 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
         vector<pair<vector<GaplessExtension>, size_t>> cluster_extensions;
         cluster_extensions.reserve(clusters.size());
 
+        // Remember where the cache was, so we can count this read's use of it.
+        size_t extension_cache_uses = extension_cache.uses();
+        size_t extension_cache_records_decoded = extension_cache.records_decoded();
+        size_t extension_cache_flushes = extension_cache.flushes();
+
         minimizer_explored_by_read[read_num] = SmallBitset(minimizers.size());
         minimizer_aligned_count_by_read[read_num].resize(minimizers.size(), 0);
         size_t kept_cluster_count = 0;
         
+        // If we are culling clusters by their score bounds, we need to know which
+        // minimizers were located, and the best extension set score so far.
+        SmallBitset minimizer_located(cull_clusters_by_bound ? minimizers.size() : 0);
+        if (cull_clusters_by_bound) {
+            for (auto& seed : seeds) {
+                minimizer_located.insert(seed.source);
+            }
+        }
+        int best_extension_score = std::numeric_limits<int>::min();
+        
+        // Mask the read once for all its clusters.
+        PreparedRead& prepared_read = PreparedRead::for_this_thread(read_num);
+        prepared_read.prepare(aln.sequence());
+        
         //Process clusters sorted by both score and read coverage
         process_until_threshold_c<double>(clusters.size(), [&](size_t i) -> double {
                 return clusters[i].coverage;
@@ -1701,6 +1946,37 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                         funnels[read_num].pass("cluster-score", cluster_num, cluster.score);
                         funnels[read_num].pass("paired-clusters", cluster_num);
                     }
+                    
+                    if (cull_clusters_by_bound) {
+                        // Don't extend the cluster if it can't make an alignment good
+                        // enough to survive the extension set score threshold.
+                        int bound = cluster_score_bound(cluster, minimizers, minimizer_located, aln.sequence().size());
+                        if (kept_cluster_count >= min_extensions && best_extension_score != std::numeric_limits<int>::min() &&
+                            bound < best_extension_score - extension_set_score_threshold) {
+                            if (track_provenance) {
+                                funnels[read_num].fail("cluster-bound", cluster_num, bound);
+                            }
+                            if (show_work) {
+                                #pragma omp critical (cerr)
+                                {
+                                    cerr << log_name() << "Cluster " << cluster_num << " can score at most " << bound
+                                         << " but we already have " << best_extension_score << endl;
+                                }
+                            }
+                            return false;
+                        }
+                        if (track_provenance) {
+                            funnels[read_num].pass("cluster-bound", cluster_num, bound);
+                        }
+                    }
+                    
+                    if (!work_budgets[read_num].allows_more(kept_cluster_count > 0)) {
+                        // We have done all the work we are allowed to for this read.
+                        if (track_provenance) {
+                            funnels[read_num].fail("work-budget", cluster_num);
+                        }
+                        return false;
+                    }
 
                     if (show_work) {
                         #pragma omp critical (cerr)
@@ -1715,9 +1991,17 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                         cluster_num,
                         minimizers,
                         seeds,
-                        aln.sequence(),
+                        prepared_read,
+                        extension_cache,
                         minimizer_kept_cluster_count_by_read[read_num],
                         funnels[read_num])), cluster.fragment);
+                    work_budgets[read_num].spend(cluster.seeds.size());
+                    
+                    if (cull_clusters_by_bound) {
+                        best_extension_score = std::max(best_extension_score,
+                            score_extension_group(aln, cluster_extensions.back().first, get_regular_aligner()->gap_open,
+                                                  get_regular_aligner()->gap_extension));
+                    }
                     
                     kept_cluster_count ++;
                     
@@ -1745,9 +2029,14 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
             });
 
         // We now estimate the best possible alignment score for each cluster.
+        if (track_provenance) {
+            count_extension_cache_use(extension_cache, extension_cache_uses, extension_cache_records_decoded,
+                                      extension_cache_flushes, funnels[read_num]);
+        }
+
         std::vector<int> cluster_alignment_score_estimates = this->score_extensions(cluster_extensions, aln, funnels[read_num]);
         
-        if (track_provenance) {
+        if (track_stages()) {
             funnels[read_num].stage("align");
         }
         
@@ -1762,6 +2051,8 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
         
         //Since we will lose the order in which we pass alignments to the funnel, use this to keep track
         size_t curr_funnel_index = 0;
+        
+        size_t aligned_cluster_count = 0;
 
         // Go through the processed clusters in estimated-score order.
         process_until_threshold_b(cluster_alignment_score_estimates,
@@ -1769,6 +2060,14 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                 // This processed cluster is good enough.
                 // Called in descending score order.
                 
+                if (!work_budgets[read_num].allows_more(aligned_cluster_count > 0)) {
+                    // We have done all the work we are allowed to for this read.
+                    if (track_provenance) {
+                        funnels[read_num].fail("work-budget", processed_num);
+                    }
+                    return false;
+                }
+                
                 if (track_provenance) {
                     funnels[read_num].pass("extension-set", processed_num, cluster_alignment_score_estimates[processed_num]);
                     funnels[read_num].pass("max-alignments", processed_num);
@@ -1776,6 +2075,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                 }
                 
                 auto& extensions = cluster_extensions[processed_num].first;
+                work_budgets[read_num].spend(extensions.size());
                 
                 // Collect the top alignments. Make sure we have at least one always, starting with unaligned.
                 vector<Alignment> best_alignments(1, aln);
@@ -1885,7 +2185,8 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
                         minimizer_aligned_count_by_read[read_num][i] += minimizer_kept_cluster_count_by_read[read_num][processed_num][i];
                     }
                 }
-
+                
+                aligned_cluster_count++;
                 
                 return true;
             }, [&](size_t processed_num) {
@@ -1906,7 +2207,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
     //Now that we have alignments, figure out how to pair them up
     
-    if (track_provenance) {
+    if (track_stages()) {
         // Now say we are finding the pairs
         for (auto r : {0, 1}) {
             funnels[r].stage("pairing");
@@ -2111,6 +2412,9 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
                     // Stop this alignment
                     funnels[r].stop();
+                    if (stage_stats) {
+                        stage_stats->record(omp_get_thread_num(), funnels[r]);
+                    }
                 
                     // Annotate with whatever's in the funnel
                     funnels[r].annotate_mapped_alignment(paired_mappings[r].back(), track_correctness);
@@ -2271,7 +2575,7 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
 
     
     
-    if (track_provenance) {
+    if (track_stages()) {
         // Now say we are finding the winner(s)
         for (auto r : {0, 1}) {
             funnels[r].stage("winner");
@@ -2421,6 +2725,9 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
     // Store multiplicities, if we fill them in
     vector<double> paired_multiplicities;
 
+    // Collect the annotations for the primary mapping of each read, to attach at the end
+    std::array<AnnotationBuffer, 2> annotations;
+
     if (mappings[0].empty()) {
         //If we didn't get an alignment, return empty alignments
         for (auto r : {0, 1}) {
@@ -2513,8 +2820,11 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
             mapq_explored_caps[r] = mapq_explored_cap;
 
             // Remember the caps
-            set_annotation(mappings[r].front(), "mapq_explored_cap", mapq_explored_cap);
-            set_annotation(mappings[r].front(), "mapq_score_group", mapq_score_groups[r]);
+            set_annotation(annotations[r], "mapq_explored_cap", mapq_explored_cap);
+            set_annotation(annotations[r], "mapq_score_group", mapq_score_groups[r]);
+            if (work_budgets[r].exhausted()) {
+                set_annotation(annotations[r], "work_budget_exhausted", true);
+            }
         }
         
         // Have a function to transform interesting cap values to uncapped.
@@ -2540,9 +2850,9 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
             double read_mapq = uncapped_mapq;
             
             // Remember the uncapped MAPQ
-            set_annotation(mappings[r].front(), "mapq_uncapped", read_mapq);
+            set_annotation(annotations[r], "mapq_uncapped", read_mapq);
             // And the cap we actually applied (possibly from the pair partner)
-            set_annotation(mappings[r].front(), "mapq_applied_cap", mapq_cap);
+            set_annotation(annotations[r], "mapq_applied_cap", mapq_cap);
 
             // Apply the cap, and limit to 0-60
             double capped_mapq = min(mapq_cap, read_mapq); 
@@ -2571,10 +2881,10 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
             (std::abs(distances.front()-fragment_length_distr.mean()) <= 6.0*fragment_length_distr.std_dev()) ;
         string distribution = "-I " + to_string(fragment_length_distr.mean()) + " -D " + to_string(fragment_length_distr.std_dev());
         for (auto r : {0, 1}) {
-            set_annotation(mappings[r].front(), "fragment_length", distance_to_annotation(distances.front()));
-            set_annotation(mappings[r].front(), "proper_pair", properly_paired);
-            set_annotation(mappings[r].front(),"fragment_length_distribution", distribution);
-            set_annotation(mappings[r].front(),"secondary_scores", scores);
+            set_annotation(annotations[r], "fragment_length", distance_to_annotation(distances.front()));
+            set_annotation(annotations[r], "proper_pair", properly_paired);
+            set_annotation(annotations[r],"fragment_length_distribution", distribution);
+            set_annotation(annotations[r],"secondary_scores", scores);
         }
     }
     
@@ -2589,28 +2899,34 @@ pair<vector<Alignment>, vector<Alignment>> MinimizerMapper::map_paired(Alignment
         }
         // Stop this alignment
         funnels[r].stop();
+        if (stage_stats) {
+            funnels[r].count_items(mappings[r].size());
+            stage_stats->record(omp_get_thread_num(), funnels[r]);
+        }
     }
     
     for (auto r : {0, 1}) {
         // Annotate with whatever's in the funnel.
-        funnels[r].annotate_mapped_alignment(mappings[r].front(), track_correctness);
+        funnels[r].annotate_mapped_alignment(mappings[r].front(), annotations[r], track_correctness);
     
         if (track_provenance) {
             if (track_correctness) {
                 annotate_with_minimizer_statistics(mappings[r].front(), minimizers_by_read[r], seeds_by_read[r], seeds_by_read[r].size(), 0, funnels[r]);
             }
             // Annotate with parameters used for the filters.
-            set_annotation(mappings[r].front(), "param_hit-cap", (double) hit_cap);
-            set_annotation(mappings[r].front(), "param_hard-hit-cap", (double) hard_hit_cap);
-            set_annotation(mappings[r].front(), "param_score-fraction", (double) minimizer_score_fraction);
-            set_annotation(mappings[r].front(), "param_max-extensions", (double) max_extensions);
-            set_annotation(mappings[r].front(), "param_max-alignments", (double) max_alignments);
-            set_annotation(mappings[r].front(), "param_cluster-score", (double) cluster_score_threshold);
-            set_annotation(mappings[r].front(), "param_cluster-coverage", (double) cluster_coverage_threshold);
-            set_annotation(mappings[r].front(), "param_extension-set", (double) extension_set_score_threshold);
-            set_annotation(mappings[r].front(), "param_max-multimaps", (double) max_multimaps);
-            set_annotation(mappings[r].front(), "param_max-rescue-attempts", (double) max_rescue_attempts);
+            set_annotation(annotations[r], "param_hit-cap", (double) hit_cap);
+            set_annotation(annotations[r], "param_hard-hit-cap", (double) hard_hit_cap);
+            set_annotation(annotations[r], "param_score-fraction", (double) minimizer_score_fraction);
+            set_annotation(annotations[r], "param_max-extensions", (double) max_extensions);
+            set_annotation(annotations[r], "param_max-alignments", (double) max_alignments);
+            set_annotation(annotations[r], "param_cluster-score", (double) cluster_score_threshold);
+            set_annotation(annotations[r], "param_cluster-coverage", (double) cluster_coverage_threshold);
+            set_annotation(annotations[r], "param_extension-set", (double) extension_set_score_threshold);
+            set_annotation(annotations[r], "param_max-multimaps", (double) max_multimaps);
+            set_annotation(annotations[r], "param_max-rescue-attempts", (double) max_rescue_attempts);
         }
+        
+        attach_annotations(annotations[r], mappings[r].front());
     }
  
 #ifdef print_minimizer_table
@@ -3025,23 +3341,12 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
     int64_t min_distance = max(0.0, fragment_length_distr.mean() - rescued_alignment.sequence().size() - rescue_subgraph_stdevs * fragment_length_distr.std_dev());
     int64_t max_distance = fragment_length_distr.mean() + rescue_subgraph_stdevs * fragment_length_distr.std_dev();
 
-    subgraph_in_distance_range(*distance_index, aligned_read.path(), &cached_graph, min_distance, max_distance, rescue_nodes, rescue_forward);
+    rescue_subgraph(aligned_read, cached_graph, min_distance, max_distance, rescue_forward, rescue_nodes);
 
     if (rescue_nodes.size() == 0) {
         //If the rescue subgraph is empty
         return;
     }
-    
-    // Remove node ids that do not exist in the GBWTGraph from the subgraph.
-    // We may be using the distance index of the original graph, and nodes
-    // not visited by any thread are missing from the GBWTGraph.
-    for (auto iter = rescue_nodes.begin(); iter != rescue_nodes.end(); ) {
-        if (!cached_graph.has_node(*iter)) {
-            iter = rescue_nodes.erase(iter);
-        } else {
-            ++iter;
-        }
-    }
 
     // Find all seeds in the subgraph and try to get a full-length extension.
     GaplessExtender::cluster_type seeds = this->seeds_in_subgraph(minimizers, rescue_nodes);
@@ -3085,6 +3390,23 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
     std::vector<handle_t> topological_order = gbwtgraph::topological_order(cached_graph, rescue_nodes);
     if (!topological_order.empty()) {
         
+        if (rescue_prefilter_error_rate > 0.0) {
+            // Only align where the read could plausibly be.
+            std::vector<handle_t> keep;
+            if (best < extensions.size()) {
+                keep = extensions[best].path;
+            }
+            if (!prefilter_rescue_subgraph(cached_graph, topological_order, rescued_alignment.sequence(), keep)) {
+                if (show_work) {
+                    #pragma omp critical (cerr)
+                    {
+                        cerr << log_name() << "Rescue prefilter found no match" << endl;
+                    }
+                }
+                return;
+            }
+        }
+        
         size_t rescue_subgraph_bases = 0;
         for (auto& h : topological_order) {
             rescue_subgraph_bases += cached_graph.get_length(h);
@@ -3167,6 +3489,117 @@ void MinimizerMapper::attempt_rescue(const Alignment& aligned_read, Alignment& r
     }
 }
 
+/// A recently extracted rescue subgraph
+struct RescueSubgraphCacheEntry {
+    size_t mapper;
+    pos_t start;
+    bool forward;
+    int64_t min_distance;
+    int64_t max_distance;
+    std::unordered_set<nid_t> nodes;
+};
+
+void MinimizerMapper::rescue_subgraph(const Alignment& aligned_read, const HandleGraph& graph, int64_t min_distance,
+                                      int64_t max_distance, bool rescue_forward, std::unordered_set<nid_t>& rescue_nodes) const {
+
+    // Most recently used first
+    thread_local std::list<RescueSubgraphCacheEntry> cache;
+    
+    // The subgraph only depends on where the search starts and the range.
+    pos_t start = rescue_forward ? initial_position(aligned_read.path()) : final_position(aligned_read.path());
+    if (rescue_subgraph_cache_size > 0) {
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (it->mapper == instance_id && it->start == start && it->forward == rescue_forward &&
+                it->min_distance == min_distance && it->max_distance == max_distance) {
+                cache.splice(cache.begin(), cache, it);
+                rescue_nodes = cache.front().nodes;
+                return;
+            }
+        }
+    }
+    
+    subgraph_in_distance_range(*distance_index, aligned_read.path(), &graph, min_distance, max_distance, rescue_nodes, rescue_forward);
+    
+    // Remove node ids that do not exist in the GBWTGraph from the subgraph.
+    // We may be using the distance index of the original graph, and nodes
+    // not visited by any thread are missing from the GBWTGraph.
+    for (auto iter = rescue_nodes.begin(); iter != rescue_nodes.end(); ) {
+        if (!graph.has_node(*iter)) {
+            iter = rescue_nodes.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    
+    if (rescue_subgraph_cache_size > 0) {
+        cache.push_front({instance_id, start, rescue_forward, min_distance, max_distance, rescue_nodes});
+        while (cache.size() > rescue_subgraph_cache_size) {
+            cache.pop_back();
+        }
+    }
+}
+
+bool MinimizerMapper::prefilter_rescue_subgraph(const HandleGraph& graph, std::vector<handle_t>& topological_order,
+                                                const std::string& sequence, const std::vector<handle_t>& keep) const {
+
+    size_t max_edits = rescue_prefilter_error_rate * sequence.size();
+    std::vector<size_t> distances = algorithms::dag_edit_distance(graph, topological_order, sequence);
+    
+    // A match ending in a handle can only use bases within this distance
+    // before the end of that handle.
+    size_t span = sequence.size() + max_edits;
+    
+    // Walk back from the handles where good matches end, and keep everything
+    // that is close enough to them. reach[i] is how many bases before the
+    // end of handle i a kept alignment may still extend.
+    std::vector<int64_t> reach(topological_order.size(), -1);
+    std::unordered_map<handle_t, size_t> rank;
+    rank.reserve(topological_order.size());
+    for (size_t i = 0; i < topological_order.size(); i++) {
+        rank[topological_order[i]] = i;
+    }
+    bool found = false;
+    for (size_t i = topological_order.size(); i-- > 0; ) {
+        if (distances[i] <= max_edits) {
+            reach[i] = std::max<int64_t>(reach[i], span);
+            found = true;
+        }
+        if (reach[i] < 0) {
+            continue;
+        }
+        // Whatever is left after this handle's bases reaches its predecessors
+        int64_t remaining = reach[i] - (int64_t) graph.get_length(topological_order[i]);
+        if (remaining <= 0) {
+            continue;
+        }
+        graph.follow_edges(topological_order[i], true, [&](const handle_t& prev) {
+            auto it = rank.find(prev);
+            if (it != rank.end() && it->second < i) {
+                reach[it->second] = std::max(reach[it->second], remaining);
+            }
+        });
+    }
+    if (!found) {
+        return false;
+    }
+    
+    std::unordered_set<nid_t> required;
+    for (const handle_t& handle : keep) {
+        required.insert(graph.get_id(handle));
+    }
+    std::vector<handle_t> filtered;
+    filtered.reserve(topological_order.size());
+    for (size_t i = 0; i < topological_order.size(); i++) {
+        if (reach[i] >= 0 || required.count(graph.get_id(topological_order[i]))) {
+            filtered.push_back(topological_order[i]);
+        }
+    }
+    // A subsequence of a topological order is a topological order of the
+    // induced subgraph.
+    topological_order = std::move(filtered);
+    return true;
+}
+
 GaplessExtender::cluster_type MinimizerMapper::seeds_in_subgraph(const VectorView<Minimizer>& minimizers,
                                                                  const std::unordered_set<id_t>& subgraph) const {
     std::vector<id_t> sorted_ids(subgraph.begin(), subgraph.end());
@@ -3291,54 +3724,129 @@ void MinimizerMapper::extension_to_alignment(const GaplessExtension& extension,
 
 //-----------------------------------------------------------------------------
 
+MinimizerMapper::Minimizer MinimizerMapper::make_minimizer(const std::tuple<gbwtgraph::DefaultMinimizerIndex::minimizer_type, size_t, size_t>& found,
+                                                           const std::pair<const gbwtgraph::DefaultMinimizerIndex::value_type*, size_t>& hits) const {
+    double base_score = 1.0 + std::log(this->hard_hit_cap);
+    double score = 0.0;
+    if (hits.second > 0) {
+        if (hits.second <= this->hard_hit_cap) {
+            score = base_score - std::log(hits.second);
+        } else {
+            score = 1.0;
+        }
+    }
+    
+    // Length of the match from this minimizer or syncmer
+    int32_t match_length = (int32_t) minimizer_index.k();
+    // Number of candidate kmers that this minimizer is minimal of
+    int32_t candidate_count = this->minimizer_index.uses_syncmers() ? 1 : (int32_t) minimizer_index.w();
+    
+    auto& value = std::get<0>(found);
+    size_t agglomeration_start = std::get<1>(found);
+    size_t agglomeration_length = std::get<2>(found);
+    if (this->minimizer_index.uses_syncmers()) {
+        // The index says the start and length are 0. Really they should be where the k-mer is.
+        // So start where the k-mer is on the forward strand
+        agglomeration_start = value.is_reverse ? (value.offset - (match_length - 1)) : value.offset;
+        // And run for the k-mer length
+        agglomeration_length = match_length;
+    }
+    
+    return { value, agglomeration_start, agglomeration_length, hits.second, hits.first,
+             match_length, candidate_count, score };
+}
+
 std::vector<MinimizerMapper::Minimizer> MinimizerMapper::find_minimizers(const std::string& sequence, Funnel& funnel) const {
 
-    if (this->track_provenance) {
+    if (this->track_stages()) {
         // Start the minimizer finding stage
         funnel.stage("minimizer");
     }
 
     std::vector<Minimizer> result;
-    double base_score = 1.0 + std::log(this->hard_hit_cap);
     // Get minimizers and their window agglomeration starts and lengths
     // Starts and lengths are all 0 if we are using syncmers.
     vector<tuple<gbwtgraph::DefaultMinimizerIndex::minimizer_type, size_t, size_t>> minimizers =
         this->minimizer_index.minimizer_regions(sequence);
+    result.reserve(minimizers.size());
     for (auto& m : minimizers) {
-        double score = 0.0;
-        auto hits = this->minimizer_index.find(get<0>(m));
-        if (hits.second > 0) {
-            if (hits.second <= this->hard_hit_cap) {
-                score = base_score - std::log(hits.second);
-            } else {
-                score = 1.0;
-            }
-        }
-        
-        // Length of the match from this minimizer or syncmer
-        int32_t match_length = (int32_t) minimizer_index.k();
-        // Number of candidate kmers that this minimizer is minimal of
-        int32_t candidate_count = this->minimizer_index.uses_syncmers() ? 1 : (int32_t) minimizer_index.w();
-        
-        auto& value = std::get<0>(m);
-        size_t agglomeration_start = std::get<1>(m);
-        size_t agglomeration_length = std::get<2>(m);
-        if (this->minimizer_index.uses_syncmers()) {
-            // The index says the start and length are 0. Really they should be where the k-mer is.
-            // So start where the k-mer is on the forward strand
-            agglomeration_start = value.is_reverse ? (value.offset - (match_length - 1)) : value.offset;
-            // And run for the k-mer length
-            agglomeration_length = match_length;
-        }
-        
-        result.push_back({ value, agglomeration_start, agglomeration_length, hits.second, hits.first,
-                            match_length, candidate_count, score });
+        result.push_back(this->make_minimizer(m, this->minimizer_index.find(get<0>(m))));
     }
     
     if (this->track_provenance) {
         // Record how many we found, as new lines.
         funnel.introduce(result.size());
     }
+    if (this->stage_stats) {
+        funnel.count_items(result.size());
+    }
+
+    return result;
+}
+
+std::vector<std::vector<MinimizerMapper::Minimizer>> MinimizerMapper::find_minimizers_batch(const std::vector<const std::string*>& sequences, const std::vector<Funnel*>& funnels) const {
+    crash_unless(sequences.size() == funnels.size());
+
+    if (this->track_stages()) {
+        for (Funnel* funnel : funnels) {
+            funnel->stage("minimizer");
+        }
+    }
+
+    // First extract minimizers from every read, and remember where each one
+    // lives in a single flat array for the whole batch.
+    typedef tuple<gbwtgraph::DefaultMinimizerIndex::minimizer_type, size_t, size_t> found_t;
+    std::vector<std::vector<found_t>> found_by_read(sequences.size());
+    size_t total_found = 0;
+    for (size_t r = 0; r < sequences.size(); r++) {
+        found_by_read[r] = this->minimizer_index.minimizer_regions(*sequences[r]);
+        total_found += found_by_read[r].size();
+    }
+
+    // Order all the minimizer instances by key so identical keys are adjacent.
+    ScratchArena::Scope scratch_scope;
+    ScratchVector<std::pair<size_t, size_t>> instances;
+    instances.reserve(total_found);
+    for (size_t r = 0; r < found_by_read.size(); r++) {
+        for (size_t i = 0; i < found_by_read[r].size(); i++) {
+            instances.emplace_back(r, i);
+        }
+    }
+    std::sort(instances.begin(), instances.end(), [&](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) {
+        return get<0>(found_by_read[a.first][a.second]).key < get<0>(found_by_read[b.first][b.second]).key;
+    });
+
+    // Then do one index lookup per distinct key, and share it with all the
+    // instances of that key.
+    std::vector<std::vector<std::pair<const gbwtgraph::DefaultMinimizerIndex::value_type*, size_t>>> hits_by_read(sequences.size());
+    for (size_t r = 0; r < found_by_read.size(); r++) {
+        hits_by_read[r].resize(found_by_read[r].size());
+    }
+    for (size_t run_start = 0; run_start < instances.size();) {
+        auto& key = get<0>(found_by_read[instances[run_start].first][instances[run_start].second]).key;
+        auto hits = this->minimizer_index.find(get<0>(found_by_read[instances[run_start].first][instances[run_start].second]));
+        size_t run_end = run_start;
+        while (run_end < instances.size() && get<0>(found_by_read[instances[run_end].first][instances[run_end].second]).key == key) {
+            hits_by_read[instances[run_end].first][instances[run_end].second] = hits;
+            run_end++;
+        }
+        run_start = run_end;
+    }
+
+    // Finally make the scored minimizers in read order.
+    std::vector<std::vector<Minimizer>> result(sequences.size());
+    for (size_t r = 0; r < found_by_read.size(); r++) {
+        result[r].reserve(found_by_read[r].size());
+        for (size_t i = 0; i < found_by_read[r].size(); i++) {
+            result[r].push_back(this->make_minimizer(found_by_read[r][i], hits_by_read[r][i]));
+        }
+        if (this->track_provenance) {
+            funnels[r]->introduce(result[r].size());
+        }
+        if (this->stage_stats) {
+            funnels[r]->count_items(result[r].size());
+        }
+    }
 
     return result;
 }
@@ -3350,7 +3858,7 @@ std::vector<size_t> MinimizerMapper::sort_minimizers_by_score(const std::vector<
 
 std::vector<MinimizerMapper::Seed> MinimizerMapper::find_seeds(const VectorView<Minimizer>& minimizers, const Alignment& aln, Funnel& funnel) const {
 
-    if (this->track_provenance) {
+    if (this->track_stages()) {
         // Start the minimizer locating stage
         funnel.stage("seed");
     }
@@ -3384,7 +3892,8 @@ std::vector<MinimizerMapper::Seed> MinimizerMapper::find_seeds(const VectorView<
     size_t num_minimizers = 0;
     size_t read_len = aln.sequence().size();
     size_t num_min_by_read_len = read_len / this->num_bp_per_min;
-    std::vector<bool> read_bit_vector (read_len, false);
+    ScratchArena::Scope scratch_scope;
+    std::vector<bool, ScratchAllocator<bool>> read_bit_vector (read_len, false);
 
     // Select the minimizers we use for seeds.
     size_t rejected_count = 0;
@@ -3467,6 +3976,27 @@ std::vector<MinimizerMapper::Seed> MinimizerMapper::find_seeds(const VectorView<
     );
      
     
+    if (this->track_provenance) {
+        funnel.substage("prefetch");
+    }
+    
+    // Issue prefetches for the occurrence arrays of all the minimizers we
+    // might locate, so the cache misses overlap instead of happening one at a
+    // time in the filter loop below.
+    for (const Minimizer& minimizer : minimizers) {
+        if (minimizer.hits > 0 && minimizer.hits <= this->hard_hit_cap) {
+            __builtin_prefetch(minimizer.occs, 0, 1);
+            if (minimizer.hits * sizeof(*minimizer.occs) > 64) {
+                // Also get the next cache line, which the first few hits may spill into.
+                __builtin_prefetch((const char*) minimizer.occs + 64, 0, 1);
+            }
+        }
+    }
+    
+    if (this->track_provenance) {
+        funnel.substage("locate");
+    }
+    
     // Flag whether each minimizer in the read was located or not, for MAPQ capping.
     // We ignore minimizers with no hits (count them as not located), because
     // they would have to be created in the read no matter where we say it came
@@ -3570,6 +4100,10 @@ std::vector<MinimizerMapper::Seed> MinimizerMapper::find_seeds(const VectorView<
         }
     }
 
+    if (this->stage_stats) {
+        funnel.count_items(seeds.size());
+    }
+
     if (this->track_provenance) {
         if (this->track_correctness) {
             // Tag seeds with correctness 
@@ -3730,13 +4264,44 @@ void MinimizerMapper::score_cluster(Cluster& cluster, size_t i, const VectorView
     }
 }
 
+int MinimizerMapper::cluster_score_bound(const Cluster& cluster, const VectorView<Minimizer>& minimizers,
+                                         const SmallBitset& located, size_t seq_length) const {
+    const Aligner* aligner = get_regular_aligner();
+    
+    // The k-mers that must each contain an edit, by end position
+    std::vector<std::pair<size_t, size_t>> missing;
+    for (size_t i = 0; i < minimizers.size(); i++) {
+        if (located.contains(i) && !cluster.present.contains(i)) {
+            size_t start = minimizers[i].forward_offset();
+            missing.emplace_back(start + minimizers[i].length, start);
+        }
+    }
+    std::sort(missing.begin(), missing.end());
+    // Greedily take k-mers that don't overlap the last one taken
+    size_t edits = 0;
+    size_t taken_end = 0;
+    for (auto& kmer : missing) {
+        if (edits == 0 || kmer.second >= taken_end) {
+            edits++;
+            taken_end = kmer.first;
+        }
+    }
+    
+    // An edit costs at least a mismatch, a 1 bp deletion, or softclipping one base
+    int edit_cost = std::min<int>({aligner->match + aligner->mismatch, aligner->gap_open,
+                                   aligner->match + aligner->full_length_bonus});
+    int perfect = seq_length * aligner->match + 2 * aligner->full_length_bonus;
+    return perfect - edits * edit_cost;
+}
+
 //-----------------------------------------------------------------------------
 
 vector<GaplessExtension> MinimizerMapper::extend_cluster(const Cluster& cluster,
     size_t cluster_num,
     const VectorView<Minimizer>& minimizers,
     const std::vector<Seed>& seeds,
-    const string& sequence,
+    const PreparedRead& read,
+    GaplessExtensionCache& extension_cache,
     vector<vector<size_t>>& minimizer_kept_cluster_count,
     Funnel& funnel) const {
 
@@ -3763,7 +4328,7 @@ vector<GaplessExtension> MinimizerMapper::extend_cluster(const Cluster& cluster,
         }
     }
     
-    vector<GaplessExtension> cluster_extension = extender->extend(seed_matchings, sequence);
+    vector<GaplessExtension> cluster_extension = extender->extend(seed_matchings, read, extension_cache.get());
 
     if (show_work) {
         #pragma omp critical (cerr)
@@ -3792,6 +4357,14 @@ vector<GaplessExtension> MinimizerMapper::extend_cluster(const Cluster& cluster,
     return cluster_extension;
 }
 
+void MinimizerMapper::count_extension_cache_use(const GaplessExtensionCache& extension_cache,
+    size_t uses_before, size_t records_before, size_t flushes_before, Funnel& funnel) {
+
+    funnel.add_to_counter("extension-cache-uses", extension_cache.uses() - uses_before);
+    funnel.add_to_counter("extension-cache-records-decoded", extension_cache.records_decoded() - records_before);
+    funnel.add_to_counter("extension-cache-flushes", extension_cache.flushes() - flushes_before);
+}
+
 //-----------------------------------------------------------------------------
 
 int MinimizerMapper::score_extension_group(const Alignment& aln, const vector<GaplessExtension>& extended_seeds,
@@ -4400,15 +4973,19 @@ pair<Path, size_t> MinimizerMapper::get_best_alignment_against_any_tree(const ve
     }
     
     // We can align it once per target tree
-    for (auto& subgraph : trees) {
+    vector<Alignment> tree_alignments(trees.size());
+    // If batching, these are the alignments we still need to do
+    vector<PinnedAlignmentProblem> batch;
+    for (size_t i = 0; i < trees.size(); i++) {
         // For each tree we can map against, map pinning the correct edge of the sequence to the root.
+        auto& subgraph = trees[i];
         
         if (subgraph.get_node_count() != 0) {
             // This path has bases in it and could potentially be better than
             // the default full-length softclip
 
             // Do alignment to the subgraph with GSSWAligner.
-            Alignment current_alignment;
+            Alignment& current_alignment = tree_alignments[i];
             // If pinning right, we need to reverse the sequence, since we are
             // always pinning left to the left edge of the tree subgraph.
             current_alignment.set_sequence(pin_left ? sequence : reverse_complement(sequence));
@@ -4448,12 +5025,28 @@ pair<Path, size_t> MinimizerMapper::get_best_alignment_against_any_tree(const ve
                         << tail_subgraph_bases << " bp tree which would use more than " << max_dozeu_cells
                         << " cells and might exhaust Dozeu's allocator; suppressing further warnings." << endl;
                 }
+            } else if (batch_tail_alignment) {
+                // Save it to align exactly along with the other trees.
+                batch.push_back({&current_alignment, &subgraph, true});
             } else {
                 // X-drop align, accounting for full length bonus.
                 // We *always* do left-pinned alignment internally, since that's the shape of trees we get.
                 // Make sure to pass through the gap length limit so we don't just get the default.
                 get_regular_aligner()->align_pinned(current_alignment, subgraph, true, true, longest_detectable_gap);
             }
+        }
+    }
+    
+    if (!batch.empty()) {
+        // Align against all the trees at once.
+        get_regular_aligner()->align_pinned_batch(batch);
+    }
+    
+    for (size_t i = 0; i < trees.size(); i++) {
+        auto& subgraph = trees[i];
+        
+        if (subgraph.get_node_count() != 0) {
+            Alignment& current_alignment = tree_alignments[i];
             
             if (show_work) {
                 #pragma omp critical (cerr)
@@ -16,11 +16,13 @@
 #include "snarls.hpp"
 #include "tree_subgraph.hpp"
 #include "funnel.hpp"
+#include "duplicate_read_cache.hpp"
 
 #include <gbwtgraph/minimizer.h>
 #include <structures/immutable_list.hpp>
 
 #include <atomic>
+#include <mutex>
 
 namespace vg {
 
@@ -78,6 +80,9 @@ public:
      * If the reads are ambiguous and there's no fragment length distribution
      * fixed yet, they will be dropped into ambiguous_pair_buffer.
      *
+     * Can be called from several threads at once while the distribution is
+     * being learned, as long as each thread has its own buffer.
+     *
      * Otherwise, at least one result will be returned for them (although it
      * may be the unmapped alignment).
      */
@@ -94,6 +99,15 @@ public:
      */
     pair<vector<Alignment>, vector<Alignment>> map_paired(Alignment& aln1, Alignment& aln2);
 
+    /// Get how many reads and pairs were answered from, and had to be added
+    /// to, the duplicate read caches.
+    size_t duplicate_cache_hits() const;
+    size_t duplicate_cache_misses() const;
+
+    /// Forget all the results in the duplicate read caches, and reset the
+    /// counters. Must be done if the mapping parameters change.
+    void clear_duplicate_caches();
+
 
 
 
@@ -124,6 +138,20 @@ public:
     /// If set, exclude overlapping minimizers
     static constexpr bool default_exclude_overlapping_min = false;
     bool exclude_overlapping_min = default_exclude_overlapping_min;
+
+    /// If set, find minimizers for all the reads handled together (i.e. both
+    /// ends of a pair) in one batch, looking up each distinct minimizer in
+    /// the index only once.
+    static constexpr bool default_batch_minimizers = false;
+    bool batch_minimizers = default_batch_minimizers;
+
+    /// Remember the results for about this many distinct reads (and as many
+    /// distinct pairs), so reads with the same sequence and qualities as one
+    /// mapped before get the same results without being mapped again. Not
+    /// used while tracking provenance or correctness, or showing work. 0
+    /// disables the cache.
+    static constexpr size_t default_duplicate_cache_size = 0;
+    size_t duplicate_cache_size = default_duplicate_cache_size;
     
     //////////////
     // Alignment-from-gapless-extension/short read Giraffe specific parameters:
@@ -137,6 +165,11 @@ public:
     static constexpr size_t default_max_extensions = 800;
     size_t max_extensions = default_max_extensions;
 
+    /// How many decoded GBWT records should the gapless extension cache
+    /// shared by all clusters of a read or pair hold before it is emptied?
+    static constexpr size_t default_extension_cache_records = GaplessExtensionCache::DEFAULT_MAX_RECORDS;
+    size_t extension_cache_records = default_extension_cache_records;
+
     //If an extension set's score is smaller than the best 
     //extension's score by more than this much, don't align it
     static constexpr double default_extension_set_score_threshold = 20;
@@ -262,6 +295,18 @@ public:
     /// How many bases of indel should we allow in chaining?
     static constexpr size_t default_max_indel_bases = 50;
     size_t max_indel_bases = default_max_indel_bases;
+    /// Should we find distances and score transitions for several chaining
+    /// predecessors at a time?
+    static constexpr bool default_batch_chaining_transitions = false;
+    bool batch_chaining_transitions = default_batch_chaining_transitions;
+    /// Should we cache distance index queries across clustering and chaining
+    /// of each read?
+    static constexpr bool default_cache_distances = true;
+    bool cache_distances = default_cache_distances;
+    /// Reads with at least this many seeds have the independent parts of
+    /// their snarl trees clustered as parallel tasks. 0 disables this.
+    static constexpr size_t default_parallel_clustering_seeds = 0;
+    size_t parallel_clustering_seeds = default_parallel_clustering_seeds;
     
     /// If a chain's score is smaller than the best 
     /// chain's score by more than this much, don't align it
@@ -287,6 +332,15 @@ public:
     static constexpr size_t default_max_dp_cells = 16UL * 1024UL * 1024UL;
     size_t max_dp_cells = default_max_dp_cells;
     
+    /// How much work should we be willing to do on one read before we stop
+    /// and report the best alignment we have? Work is counted in seeds put
+    /// through extension or chaining and in extensions or chain items put
+    /// through alignment, not in time, so results don't depend on machine
+    /// load. Reads that run out get a work_budget_exhausted annotation. 0 means
+    /// no limit.
+    static constexpr size_t default_max_work = 0;
+    size_t max_work = default_max_work;
+    
     /////////////////
     // More shared parameters:
     /////////////////
@@ -310,6 +364,23 @@ public:
     /// algorithm. Only works if track_provenance is true.
     static constexpr bool default_track_correctness = false;
     bool track_correctness = default_track_correctness;
+
+    /// If set, time each stage of mapping and count its results, even
+    /// without track_provenance, and add the totals for each read to this.
+    /// Not owned by the mapper.
+    FunnelStats* stage_stats = nullptr;
+    
+    /// Should we mark stages in the funnel, either for provenance or just
+    /// for stage timing?
+    inline bool track_stages() const {
+        return track_provenance || stage_stats != nullptr;
+    }
+    
+    /// Attach all of the mapper's annotations to the output alignments. If
+    /// false, only the ones that GAF and HTS output use are attached, and the
+    /// rest never leave their AnnotationBuffer.
+    static constexpr bool default_keep_all_annotations = true;
+    bool keep_all_annotations = default_keep_all_annotations;
     
     /// If set, log what the mapper is thinking in its mapping of each read.
     static constexpr bool default_show_work = false;
@@ -331,6 +402,20 @@ public:
     static constexpr size_t default_rescue_seed_limit = 100;
     size_t rescue_seed_limit = default_rescue_seed_limit;
 
+    /// Before aligning in rescue, scan the rescue subgraph for the read with a
+    /// bit-parallel edit distance matcher, and only align against the parts of
+    /// the subgraph near matches with at most this fraction of the read length
+    /// in edits. If there are none, the rescue fails without aligning. 0
+    /// disables the scan.
+    static constexpr double default_rescue_prefilter_error_rate = 0.0;
+    double rescue_prefilter_error_rate = default_rescue_prefilter_error_rate;
+
+    /// Remember this many of the most recently extracted rescue subgraphs on
+    /// each thread, so pairs that rescue into the same place don't each have
+    /// to find the subgraph again. 0 disables the cache.
+    static constexpr size_t default_rescue_subgraph_cache_size = 16;
+    size_t rescue_subgraph_cache_size = default_rescue_subgraph_cache_size;
+
     /// For paired end mapping, how many times should we attempt rescue (per read)?
     static constexpr size_t default_max_rescue_attempts = 15;
     size_t max_rescue_attempts = default_max_rescue_attempts;
@@ -343,6 +428,18 @@ public:
     static constexpr size_t default_max_dozeu_cells = (size_t)(1.5 * 1024 * 1024);
     size_t max_dozeu_cells = default_max_dozeu_cells;
     
+    /// If set, align each tail against all of its trees together, with exact
+    /// batched pinned alignment instead of X-drop alignment to one tree at a
+    /// time.
+    static constexpr bool default_batch_tail_alignment = false;
+    bool batch_tail_alignment = default_batch_tail_alignment;
+    
+    /// If set, skip extending clusters whose upper bound on alignment score
+    /// (see cluster_score_bound()) is already more than
+    /// extension_set_score_threshold below the best extension set found.
+    static constexpr bool default_cull_clusters_by_bound = false;
+    bool cull_clusters_by_bound = default_cull_clusters_by_bound;
+    
     ///What is the maximum fragment length that we accept as valid for paired-end reads?
     static constexpr size_t default_max_fragment_length = 2000;
     size_t max_fragment_length = default_max_fragment_length;
@@ -361,18 +458,56 @@ public:
     /// Have we complained about hitting the size limit for rescue?
     atomic_flag warned_about_rescue_size = ATOMIC_FLAG_INIT;
     
+    /// Identifies this mapper's entries in the per-thread rescue subgraph caches.
+    size_t instance_id;
+
+    /// Results already found for reads and pairs, by duplicate_key().
+    DuplicateReadCache<vector<Alignment>> duplicate_read_results;
+    DuplicateReadCache<pair<vector<Alignment>, vector<Alignment>>> duplicate_pair_results;
+
+    /// Should the duplicate read caches be used for this read?
+    inline bool use_duplicate_cache() const {
+        return duplicate_cache_size > 0 && !track_provenance && !track_correctness && !show_work;
+    }
+
+    /// Get the key for a read in the duplicate read caches. Everything about
+    /// the mapping result but the read name depends only on this.
+    static string duplicate_key(const Alignment& aln);
+
+    /// Map a pair of reads with the fragment length distribution, without
+    /// consulting the duplicate pair cache.
+    pair<vector<Alignment>, vector<Alignment>> map_paired_with_distribution(Alignment& aln1, Alignment& aln2);
+    
+    /**
+     * Find the nodes in the GBWTGraph within the given distance range of the
+     * start or end of the aligned read's path, through the per-thread cache
+     * of recent rescue subgraphs.
+     */
+    void rescue_subgraph(const Alignment& aligned_read, const HandleGraph& graph, int64_t min_distance,
+                         int64_t max_distance, bool rescue_forward, std::unordered_set<nid_t>& rescue_nodes) const;
+    
     /// Have we complained about hitting the size limit for tails?
     mutable atomic_flag warned_about_tail_size = ATOMIC_FLAG_INIT;
 
-    bool fragment_distr_is_finalized () {return fragment_length_distr.is_finalized();}
+    bool fragment_distr_is_finalized () {
+        std::lock_guard<std::mutex> lock(fragment_length_mutex);
+        return fragment_length_distr.is_finalized();
+    }
     void finalize_fragment_length_distr() {
+        std::lock_guard<std::mutex> lock(fragment_length_mutex);
         if (!fragment_length_distr.is_finalized()) {
             fragment_length_distr.force_parameters(fragment_length_distr.mean(), fragment_length_distr.std_dev());
         } 
     }
     void force_fragment_length_distr(double mean, double stdev) {
+        std::lock_guard<std::mutex> lock(fragment_length_mutex);
         fragment_length_distr.force_parameters(mean, stdev);
     }
+    /// Start learning the fragment length distribution again, for a new set of reads
+    void reset_fragment_length_distr() {
+        std::lock_guard<std::mutex> lock(fragment_length_mutex);
+        fragment_length_distr.reset();
+    }
     double get_fragment_length_mean() const { return fragment_length_distr.mean(); }
     double get_fragment_length_stdev() const {return fragment_length_distr.std_dev(); }
     size_t get_fragment_length_sample_size() const { return fragment_length_distr.curr_sample_size(); }
@@ -438,6 +573,41 @@ public:
     
 protected:
     
+    /**
+     * Tracks the work done on one read against max_work. Work already started
+     * is always finished, so a read can go over by one item's worth.
+     */
+    class WorkBudget {
+    public:
+        /// Make a budget for the given amount of work, or no limit if 0.
+        explicit WorkBudget(size_t limit) : limit(limit) {}
+        
+        /// Record that some work was done.
+        inline void spend(size_t units) {
+            used += units;
+        }
+        
+        /// Return true if we may start more work. If we have nothing to show
+        /// for the read yet, we may always start, so every read gets a chance
+        /// at an alignment. Once this says no, the budget stays exhausted.
+        inline bool allows_more(bool have_result) {
+            if (limit != 0 && used >= limit && have_result) {
+                ran_out = true;
+            }
+            return !ran_out;
+        }
+        
+        /// Return true if we had to skip work because the budget ran out.
+        inline bool exhausted() const {
+            return ran_out;
+        }
+        
+    private:
+        size_t limit;
+        size_t used = 0;
+        bool ran_out = false;
+    };
+    
     /// Convert an integer distance, with limits standing for no distance, to a
     /// double annotation that can safely be parsed back from JSON into an
     /// integer if it is integral.
@@ -486,6 +656,10 @@ protected:
     /// knowing when we've observed enough good ones to learn a good
     /// distribution.
     FragmentLengthDistribution fragment_length_distr;
+    /// Guards the distribution while it is being learned, so that pairs can be
+    /// mapped for it from many threads at once. It doesn't change once it is
+    /// finalized.
+    mutable std::mutex fragment_length_mutex;
     /// We may need to complain exactly once that the distribution is bad.
     atomic_flag warned_about_bad_distribution = ATOMIC_FLAG_INIT;
 
@@ -498,6 +672,24 @@ protected:
      * return them sorted in read order.
      */
     std::vector<Minimizer> find_minimizers(const std::string& sequence, Funnel& funnel) const;
+
+    /**
+     * Find the minimizers in each of the given sequences, and return them
+     * sorted in read order, one vector per sequence.
+     *
+     * Extraction is done for all sequences first, and then each distinct
+     * minimizer key in the batch is looked up in the index only once, so
+     * repeated minimizers within and between reads share a hash table probe.
+     * Results are identical to calling find_minimizers() on each sequence.
+     */
+    std::vector<std::vector<Minimizer>> find_minimizers_batch(const std::vector<const std::string*>& sequences, const std::vector<Funnel*>& funnels) const;
+
+    /**
+     * Convert a minimizer found in a read and its hits in the index into a
+     * scored Minimizer.
+     */
+    Minimizer make_minimizer(const std::tuple<gbwtgraph::DefaultMinimizerIndex::minimizer_type, size_t, size_t>& found,
+                             const std::pair<const gbwtgraph::DefaultMinimizerIndex::value_type*, size_t>& hits) const;
     
     /**
      * Return the indices of all the minimizers, sorted in descending order by theit minimizers' scores.
@@ -527,6 +719,16 @@ protected:
      */
     void score_cluster(Cluster& cluster, size_t i, const VectorView<Minimizer>& minimizers, const std::vector<Seed>& seeds, size_t seq_length, Funnel& funnel) const;
     
+    /**
+     * Get an upper bound on the score of an alignment of the read from the
+     * cluster. Each located minimizer that did not get into the cluster means
+     * its k-mer does not occur where the cluster is, so we count
+     * non-overlapping such k-mers and charge each the cheapest possible edit
+     * against a perfect full-length match of the read.
+     */
+    int cluster_score_bound(const Cluster& cluster, const VectorView<Minimizer>& minimizers,
+                            const SmallBitset& located, size_t seq_length) const;
+    
     /**
      * Determine cluster score, read coverage, and a vector of flags for the
      * minimizers present in the cluster. Score is the sum of the scores of
@@ -557,18 +759,50 @@ protected:
         const VectorView<Minimizer>& minimizers,
         const std::function<void(const Minimizer&, const std::vector<nid_t>&, const std::function<void(const pos_t&)>&)>& for_each_pos_for_source_in_subgraph) const;
     
+    /// A read region to reseed, and the graph positions bounding it, as taken
+    /// by reseed_between().
+    struct ReseedGap {
+        size_t read_region_start;
+        size_t read_region_end;
+        pos_t left_graph_pos;
+        pos_t right_graph_pos;
+    };
+    
+    /**
+     * Reseed all the given gaps at once, returning the new seeds for each gap
+     * in the same order as reseed_between() for the single gap would.
+     * Minimizers are sorted by read position once to find the ones in each
+     * gap, their occurrences are prefetched, and minimizers with the same
+     * occurrences and orientation only query the callback once per gap, so
+     * the positions it produces must depend only on those.
+     */
+    std::vector<std::vector<Seed>> reseed_between(
+        const std::vector<ReseedGap>& gaps,
+        const HandleGraph& graph,
+        const VectorView<Minimizer>& minimizers,
+        const std::function<void(const Minimizer&, const std::vector<nid_t>&, const std::function<void(const pos_t&)>&)>& for_each_pos_for_source_in_subgraph) const;
+    
     /**
      * Extends the seeds in a cluster into a collection of GaplessExtension objects.
+     * Uses the given cache, shared with the other clusters of the read or pair.
      */
     vector<GaplessExtension> extend_cluster(
         const Cluster& cluster,
         size_t cluster_num,
         const VectorView<Minimizer>& minimizers,
         const std::vector<Seed>& seeds,
-        const string& sequence,
+        const PreparedRead& read,
+        GaplessExtensionCache& extension_cache,
         vector<vector<size_t>>& minimizer_kept_cluster_count,
         Funnel& funnel) const;
     
+    /**
+     * Record how much GBWT decoding the gapless extensions since the given
+     * snapshot of the cache needed, in the funnel's counters.
+     */
+    static void count_extension_cache_use(const GaplessExtensionCache& extension_cache,
+        size_t uses_before, size_t records_before, size_t flushes_before, Funnel& funnel);
+
     /**
      * Score the given group of gapless extensions. Determines the best score
      * that can be obtained by chaining extensions together, using the given
@@ -629,6 +863,15 @@ protected:
      */
     void attempt_rescue(const Alignment& aligned_read, Alignment& rescued_alignment, const VectorView<Minimizer>& minimizers, bool rescue_forward);
 
+    /**
+     * Restrict a topological order of the rescue subgraph to the handles that
+     * could be involved in an alignment of the read with few enough edits,
+     * according to rescue_prefilter_error_rate, plus the handles in keep.
+     * Returns false if there is no such alignment.
+     */
+    bool prefilter_rescue_subgraph(const HandleGraph& graph, std::vector<handle_t>& topological_order,
+                                   const std::string& sequence, const std::vector<handle_t>& keep) const;
+
     /**
      * Return the all non-redundant seeds in the subgraph, including those from
      * minimizers not used for mapping.
@@ -717,6 +960,12 @@ protected:
      */
     void pair_all(std::array<vector<Alignment>, 2>& mappings) const;
     
+    /**
+     * Attach the annotations collected for an output alignment to it,
+     * dropping the ones that are not wanted if keep_all_annotations is false.
+     */
+    void attach_annotations(const AnnotationBuffer& annotations, Alignment& aln) const;
+    
     /**
      * Add annotations to an Alignment with statistics about the minimizers.
      *
@@ -7,6 +7,7 @@
 #include "minimizer_mapper.hpp"
 
 #include "annotation.hpp"
+#include "scratch_arena.hpp"
 #include "path_subgraph.hpp"
 #include "multipath_alignment.hpp"
 #include "split_strand_graph.hpp"
@@ -25,6 +26,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <numeric>
 #include <cmath>
 #include <cfloat>
 
@@ -150,108 +152,147 @@ std::vector<MinimizerMapper::Seed> MinimizerMapper::reseed_between(
     const VectorView<Minimizer>& minimizers,
     const std::function<void(const Minimizer&, const std::vector<nid_t>&, const std::function<void(const pos_t&)>&)>& for_each_pos_for_source_in_subgraph
 ) const {
+    std::vector<ReseedGap> gaps {{read_region_start, read_region_end, left_graph_pos, right_graph_pos}};
+    return std::move(reseed_between(gaps, graph, minimizers, for_each_pos_for_source_in_subgraph).front());
+}
+
+std::vector<std::vector<MinimizerMapper::Seed>> MinimizerMapper::reseed_between(
+    const std::vector<ReseedGap>& gaps,
+    const HandleGraph& graph,
+    const VectorView<Minimizer>& minimizers,
+    const std::function<void(const Minimizer&, const std::vector<nid_t>&, const std::function<void(const pos_t&)>&)>& for_each_pos_for_source_in_subgraph
+) const {
     
-    // We are going to make up some seeds
-    std::vector<MinimizerMapper::Seed> forged_items;                                    
-    
-    
-    std::vector<pos_t> seed_positions;
-    seed_positions.reserve(2);
-    std::vector<size_t> position_forward_max_dist;
-    position_forward_max_dist.reserve(2);
-    std::vector<size_t> position_backward_max_dist;
-    position_backward_max_dist.reserve(2);
-    
-    if (!is_empty(left_graph_pos)) {
-        // We have a left endpoint
-        seed_positions.emplace_back(left_graph_pos);
-        position_forward_max_dist.emplace_back(this->reseed_search_distance);
-        position_backward_max_dist.emplace_back(0);
-    }
+    // We are going to make up some seeds for each gap
+    std::vector<std::vector<MinimizerMapper::Seed>> forged_items(gaps.size());
     
-    if (!is_empty(right_graph_pos)) {
-        // We have a left endpoint
-        seed_positions.emplace_back(right_graph_pos);
-        position_forward_max_dist.emplace_back(0);
-        position_backward_max_dist.emplace_back(this->reseed_search_distance);
-    }
+    // Sort the minimizers by read position once, so we can find the ones in
+    // each gap without scanning them all.
+    std::vector<size_t> minimizers_by_start(minimizers.size());
+    std::iota(minimizers_by_start.begin(), minimizers_by_start.end(), 0);
+    std::stable_sort(minimizers_by_start.begin(), minimizers_by_start.end(), [&](size_t a, size_t b) {
+        return minimizers[a].forward_offset() < minimizers[b].forward_offset();
+    });
     
-    std::vector<nid_t> sorted_ids;
-    {
-        bdsg::HashGraph subgraph;
-        // TODO: can we use connecting graph again?
-        // TODO: Should we be using more seeds from the cluster?
-        algorithms::extract_containing_graph(&graph, &subgraph, seed_positions, this->reseed_search_distance);
-        sorted_ids.reserve(subgraph.get_node_count());
-        subgraph.for_each_handle([&](const handle_t& h) {
-            sorted_ids.push_back(subgraph.get_id(h));
-        });
-    }
-    std::sort(sorted_ids.begin(), sorted_ids.end());
+    // These are reused for each gap.
+    std::vector<size_t> minimizers_in_gap;
+    std::vector<pos_t> hit_positions;
+    // Minimizers with the same occurrences and orientation have the same hits
+    // in the subgraph, so we only look them up once and remember where in
+    // hit_positions we put them.
+    std::unordered_map<std::pair<const void*, bool>, std::pair<size_t, size_t>> hit_ranges;
     
-    if (this->show_work) {
-        #pragma omp critical (cerr)
-        {
-            std::cerr << log_name() << "Reseeding against nodes ";
-            // Dump the nodes as consecutive ranges 
-            nid_t prev_node;
-            nid_t printed_node;
-            for (size_t i = 0; i < sorted_ids.size(); i++) {
-                if (i == 0 || prev_node + 1 != sorted_ids[i]) {
-                    if (i > 0) {
-                        std::cerr << "-" << prev_node << ", ";
-                    }
-                    std::cerr << sorted_ids[i];
-                    printed_node = sorted_ids[i];
-                }
-                prev_node = sorted_ids[i];
-            }
-            if (!sorted_ids.empty() && printed_node != sorted_ids.back()) {
-                std::cerr << "-" << sorted_ids.back();
-            }
-            std::cerr << endl;
+    for (size_t gap_num = 0; gap_num < gaps.size(); gap_num++) {
+        const ReseedGap& gap = gaps[gap_num];
+        
+        std::vector<pos_t> seed_positions;
+        seed_positions.reserve(2);
+        
+        if (!is_empty(gap.left_graph_pos)) {
+            // We have a left endpoint
+            seed_positions.emplace_back(gap.left_graph_pos);
         }
-    }
-    
-    for (size_t i = 0; i < minimizers.size(); i++) {
-        auto& m = minimizers[i];
         
-        if (m.forward_offset() < read_region_start || m.forward_offset() + m.length > read_region_end) {
-            // Minimizer is not in the range we care about.
-            // TODO: Find a faster way to find the relevant minimizers that doesn't require a scan! Sort them by start position or something.
-            continue;
+        if (!is_empty(gap.right_graph_pos)) {
+            // We have a right endpoint
+            seed_positions.emplace_back(gap.right_graph_pos);
         }
         
+        std::vector<nid_t> sorted_ids;
+        {
+            bdsg::HashGraph subgraph;
+            // TODO: can we use connecting graph again?
+            // TODO: Should we be using more seeds from the cluster?
+            algorithms::extract_containing_graph(&graph, &subgraph, seed_positions, this->reseed_search_distance);
+            sorted_ids.reserve(subgraph.get_node_count());
+            subgraph.for_each_handle([&](const handle_t& h) {
+                sorted_ids.push_back(subgraph.get_id(h));
+            });
+        }
+        std::sort(sorted_ids.begin(), sorted_ids.end());
+        
         if (this->show_work) {
             #pragma omp critical (cerr)
             {
-                std::cerr << log_name() << "Query minimizer #" << i << " at " << m.forward_offset() << " which overall has " << m.hits << " hits" << std::endl;
+                std::cerr << log_name() << "Reseeding against nodes ";
+                // Dump the nodes as consecutive ranges 
+                nid_t prev_node;
+                nid_t printed_node;
+                for (size_t i = 0; i < sorted_ids.size(); i++) {
+                    if (i == 0 || prev_node + 1 != sorted_ids[i]) {
+                        if (i > 0) {
+                            std::cerr << "-" << prev_node << ", ";
+                        }
+                        std::cerr << sorted_ids[i];
+                        printed_node = sorted_ids[i];
+                    }
+                    prev_node = sorted_ids[i];
+                }
+                if (!sorted_ids.empty() && printed_node != sorted_ids.back()) {
+                    std::cerr << "-" << sorted_ids.back();
+                }
+                std::cerr << endl;
             }
         }
         
-        // We may see duplicates, so we want to do our own deduplication.
-        unordered_set<pos_t> seen;
+        // Find the minimizers that are entirely in the read region.
+        minimizers_in_gap.clear();
+        auto it = std::lower_bound(minimizers_by_start.begin(), minimizers_by_start.end(), gap.read_region_start, [&](size_t i, size_t offset) {
+            return minimizers[i].forward_offset() < offset;
+        });
+        for (; it != minimizers_by_start.end() && minimizers[*it].forward_offset() < gap.read_region_end; ++it) {
+            if (minimizers[*it].forward_offset() + minimizers[*it].length <= gap.read_region_end) {
+                minimizers_in_gap.push_back(*it);
+            }
+        }
+        // Make seeds in minimizer order.
+        std::sort(minimizers_in_gap.begin(), minimizers_in_gap.end());
         
-        size_t hit_count = 0;
+        // Start fetching all the occurrences we will look at, so the cache
+        // misses overlap.
+        for (size_t i : minimizers_in_gap) {
+            if (minimizers[i].hits > 0) {
+                __builtin_prefetch(minimizers[i].occs, 0, 1);
+            }
+        }
         
-        // Find all its hits in the part of the graph between the bounds
-        for_each_pos_for_source_in_subgraph(m, sorted_ids, [&](const pos_t& pos) {
-            // So now we know pos corresponds to read base
-            // m.value.offset, in the read's forward orientation.
+        hit_positions.clear();
+        hit_ranges.clear();
+        for (size_t i : minimizers_in_gap) {
+            auto& m = minimizers[i];
             
-            // Forge an item.
-            forged_items.emplace_back();
-            forged_items.back().pos = pos;
-            forged_items.back().source = i;
+            if (this->show_work) {
+                #pragma omp critical (cerr)
+                {
+                    std::cerr << log_name() << "Query minimizer #" << i << " at " << m.forward_offset() << " which overall has " << m.hits << " hits" << std::endl;
+                }
+            }
             
-            // Record the hit
-            hit_count++;
-        });
-        
-        if (this->show_work) {
-            #pragma omp critical (cerr)
-            {
-                std::cerr << log_name() << "\tFound " << hit_count << "/" << m.hits << " hits" << std::endl;
+            std::pair<const void*, bool> key((const void*) m.occs, m.value.is_reverse);
+            auto found = hit_ranges.find(key);
+            if (found == hit_ranges.end()) {
+                // Find all its hits in the part of the graph between the bounds
+                size_t first_hit = hit_positions.size();
+                for_each_pos_for_source_in_subgraph(m, sorted_ids, [&](const pos_t& pos) {
+                    // So now we know pos corresponds to read base
+                    // m.value.offset, in the read's forward orientation.
+                    hit_positions.push_back(pos);
+                });
+                found = hit_ranges.emplace_hint(found, key, std::make_pair(first_hit, hit_positions.size()));
+            }
+            
+            for (size_t j = found->second.first; j < found->second.second; j++) {
+                // Forge an item.
+                forged_items[gap_num].emplace_back();
+                forged_items[gap_num].back().pos = hit_positions[j];
+                forged_items[gap_num].back().source = i;
+            }
+            
+            if (this->show_work) {
+                #pragma omp critical (cerr)
+                {
+                    std::cerr << log_name() << "\tFound " << (found->second.second - found->second.first) << "/" << m.hits << " hits" << std::endl;
+                }
             }
         }
     }
@@ -264,6 +305,9 @@ std::vector<MinimizerMapper::Seed> MinimizerMapper::reseed_between(
 
 vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
     
+    // Per-read scratch memory comes from this thread's arena, and is all freed at once when we finish the read.
+    ScratchArena::Scope scratch_scope;
+    
     if (show_work) {
         #pragma omp critical (cerr)
         dump_debug_query(aln);
@@ -273,6 +317,11 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
     Funnel funnel;
     funnel.start(aln.name());
     
+    // Clustering and chaining ask about the same places in the graph over and
+    // over, so remember distance index answers for the whole read.
+    DistanceCache distance_cache;
+    DistanceCache* read_distance_cache = cache_distances ? &distance_cache : nullptr;
+    
     // Prepare the RNG for shuffling ties, if needed
     LazyRNG rng([&]() {
         return aln.sequence();
@@ -293,13 +342,19 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
     vector<Seed> seeds = this->find_seeds(minimizers, aln, funnel);
     
     // Pre-cluster just the seeds we have. Get sets of input seed indexes that go together.
-    if (track_provenance) {
+    if (track_stages()) {
         funnel.stage("precluster");
+    }
+    if (track_provenance) {
         funnel.substage("compute-preclusters");
     }
 
     // Find the clusters up to a flat distance limit
-    std::vector<Cluster> preclusters = clusterer.cluster_seeds(seeds, chaining_cluster_distance);
+    std::vector<Cluster> preclusters = clusterer.cluster_seeds(seeds, chaining_cluster_distance, read_distance_cache,
+                                                               parallel_clustering_seeds);
+    if (stage_stats) {
+        funnel.count_items(preclusters.size());
+    }
     
     if (track_provenance) {
         funnel.substage("score-preclusters");
@@ -407,7 +462,7 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
         precluster_connections.emplace_back(std::numeric_limits<size_t>::max(), unconnected);
     }
     
-    if (track_provenance) {
+    if (track_stages()) {
         funnel.stage("reseed");
     }
     
@@ -445,6 +500,11 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
     // Connections don't appear in the funnel so we track them ourselves.
     size_t precluster_connection_explored_count = 0;
     
+    // We collect all the gaps to reseed and do them together, so we only
+    // need to go through the minimizers once.
+    std::vector<ReseedGap> gaps_to_reseed;
+    std::vector<size_t> gap_connections;
+    
     process_until_threshold_a(precluster_connections.size(), (std::function<double(size_t)>) [&](size_t i) -> double {
         // Best pairs to connect are those with the highest average coverage
         if (precluster_connections[i].first == std::numeric_limits<size_t>::max()) {
@@ -523,8 +583,27 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
             this->dump_debug_minimizers(minimizers, aln.sequence(), nullptr, left_read, right_read - left_read);
         }
         
-        // Do the reseed
-        std::vector<Seed> new_seeds = reseed_between(left_read, right_read, left_pos, right_pos, this->gbwt_graph, minimizers, find_minimizer_hit_positions);
+        // Remember to reseed this gap
+        gaps_to_reseed.push_back({left_read, right_read, left_pos, right_pos});
+        gap_connections.push_back(connection_num);
+        
+        precluster_connection_explored_count++;
+        
+        return true;
+    }, [&](size_t connection_num) -> void {
+        // There are too many sufficiently good connections
+        // TODO: Add provenance tracking
+    }, [&](size_t connection_num) -> void {
+        // This connection is not sufficiently good.
+        // TODO: Add provenance tracking
+    });
+    
+    // Do the reseeds
+    std::vector<std::vector<Seed>> new_seeds_by_gap = reseed_between(gaps_to_reseed, this->gbwt_graph, minimizers, find_minimizer_hit_positions);
+    
+    for (size_t gap_num = 0; gap_num < gaps_to_reseed.size(); gap_num++) {
+        auto& connected = precluster_connections[gap_connections[gap_num]];
+        std::vector<Seed>& new_seeds = new_seeds_by_gap[gap_num];
         
         // Concatenate and deduplicate with existing seeds
         size_t seeds_before = seeds.size();
@@ -563,17 +642,7 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
                 this->dump_debug_seeds(minimizers, seeds, new_seeds);
             }
         }
-        
-        precluster_connection_explored_count++;
-        
-        return true;
-    }, [&](size_t connection_num) -> void {
-        // There are too many sufficiently good connections
-        // TODO: Add provenance tracking
-    }, [&](size_t connection_num) -> void {
-        // This connection is not sufficiently good.
-        // TODO: Add provenance tracking
-    });
+    }
     
     if (this->track_provenance) {
         // Make items in the funnel for all the new seeds, basically as one-seed preclusters.
@@ -587,12 +656,21 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
         this->tag_seeds(aln, seeds.cbegin() + old_seed_count, seeds.cend(), minimizers, preclusters.size(), funnel);
     }
     
+    if (stage_stats) {
+        // The reseed stage's results are all the seeds, old and new.
+        funnel.count_items(seeds.size());
+    }
+    
     // Make the main clusters that include the recovered seeds
-    if (track_provenance) {
+    if (track_stages()) {
         funnel.stage("cluster");
     }
     
-    std::vector<Cluster> clusters = clusterer.cluster_seeds(seeds, chaining_cluster_distance);
+    std::vector<Cluster> clusters = clusterer.cluster_seeds(seeds, chaining_cluster_distance, read_distance_cache,
+                                                            parallel_clustering_seeds);
+    if (stage_stats) {
+        funnel.count_items(clusters.size());
+    }
     
     // Determine the scores and read coverages for each cluster.
     // Also find the best and second-best cluster scores.
@@ -640,7 +718,7 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
         cluster_score_cutoff = std::min(cluster_score_cutoff, second_best_cluster_score);
     }
 
-    if (track_provenance) {
+    if (track_stages()) {
         // Now we go from clusters to chains
         funnel.stage("chain");
     }
@@ -660,6 +738,9 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
 
     size_t kept_cluster_count = 0;
     
+    // Count the work we do on this read.
+    WorkBudget work_budget(max_work);
+    
     // What cluster seeds define the space for clusters' chosen chains?
     vector<vector<size_t>> cluster_chain_seeds;
     
@@ -720,6 +801,13 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
                 funnel.pass("cluster-score", cluster_num, cluster.score);
             }
             
+            if (!work_budget.allows_more(kept_cluster_count > 0)) {
+                // We have done all the work we are allowed to for this read.
+                if (track_provenance) {
+                    funnel.fail("work-budget", cluster_num);
+                }
+                return false;
+            }
 
             if (show_work) {
                 #pragma omp critical (cerr)
@@ -744,6 +832,7 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
                 minimizer_kept_cluster_count.back()[seed.source]++;
             }
             ++kept_cluster_count;
+            work_budget.spend(cluster.seeds.size());
             
             if (show_work) {
                 dump_debug_seeds(minimizers, seeds, cluster.seeds);
@@ -766,7 +855,7 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
                 }
             }
             
-            if (show_work) {
+            if (Explainer::save_explanations) {
                 // Log the chaining problem so we can try it again elsewhere.
                 this->dump_chaining_problem(seed_anchors, cluster_seeds_sorted, gbwt_graph);
             }
@@ -790,7 +879,9 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
                                                                lookback_scale_factor,
                                                                min_good_transition_score_per_base,
                                                                item_bonus,
-                                                               max_indel_bases);
+                                                               max_indel_bases,
+                                                               batch_chaining_transitions,
+                                                               read_distance_cache);
             if (show_work && !candidate_chain.second.empty()) {
                 #pragma omp critical (cerr)
                 {
@@ -888,7 +979,10 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
         cluster_alignment_score_estimates[i] = cluster_chains[i].first;
     }
     
-    if (track_provenance) {
+    if (stage_stats) {
+        funnel.count_items(cluster_chains.size());
+    }
+    if (track_stages()) {
         funnel.stage("align");
     }
 
@@ -954,6 +1048,14 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
                 return false;
             }
             
+            if (!work_budget.allows_more(!alignments.empty())) {
+                // We have done all the work we are allowed to for this read.
+                if (track_provenance) {
+                    funnel.fail("work-budget", processed_num);
+                }
+                return false;
+            }
+            
             if (show_work) {
                 #pragma omp critical (cerr)
                 {
@@ -984,6 +1086,7 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
                 auto& eligible_seeds = cluster_chain_seeds[processed_num];
                 auto& score_and_chain = cluster_chains[processed_num]; 
                 vector<size_t>& chain = score_and_chain.second;
+                work_budget.spend(chain.size());
                 
                 // Do the DP between the items in the cluster as specified by the chain we got for it. 
                 best_alignments[0] = find_chain_alignment(aln, {seed_anchors, eligible_seeds}, chain);
@@ -1063,7 +1166,10 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
         }
     }
     
-    if (track_provenance) {
+    if (stage_stats) {
+        funnel.count_items(alignments.size());
+    }
+    if (track_stages()) {
         // Now say we are finding the winner(s)
         funnel.stage("winner");
     }
@@ -1152,10 +1258,16 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
     double escape_bonus = mapq < std::numeric_limits<int32_t>::max() ? 1.0 : 2.0;
     double mapq_explored_cap = escape_bonus * faster_cap(minimizers, explored_minimizers, aln.sequence(), aln.quality());
 
+    // Collect the annotations for the primary mapping, to attach at the end
+    AnnotationBuffer annotations;
+    
     // Remember the uncapped MAPQ and the caps
-    set_annotation(mappings.front(),"secondary_scores", scores);
-    set_annotation(mappings.front(), "mapq_uncapped", mapq);
-    set_annotation(mappings.front(), "mapq_explored_cap", mapq_explored_cap);
+    set_annotation(annotations,"secondary_scores", scores);
+    set_annotation(annotations, "mapq_uncapped", mapq);
+    set_annotation(annotations, "mapq_explored_cap", mapq_explored_cap);
+    if (work_budget.exhausted()) {
+        set_annotation(annotations, "work_budget_exhausted", true);
+    }
 
     // Apply the caps and transformations
     mapq = round(min(mapq_explored_cap, min(mapq, 60.0)));
@@ -1184,11 +1296,25 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
         out.set_is_secondary(i > 0);
     }
     
+    if (track_provenance && cache_distances) {
+        // Report how much the distance cache helped
+        funnel.add_to_counter("distance-cache-hits", distance_cache.hits());
+        funnel.add_to_counter("distance-cache-misses", distance_cache.misses());
+    }
+    
+    if (stage_stats) {
+        funnel.count_items(mappings.size());
+    }
+    
     // Stop this alignment
     funnel.stop();
     
+    if (stage_stats) {
+        stage_stats->record(omp_get_thread_num(), funnel);
+    }
+    
     // Annotate with whatever's in the funnel
-    funnel.annotate_mapped_alignment(mappings[0], track_correctness);
+    funnel.annotate_mapped_alignment(mappings[0], annotations, track_correctness);
     
     if (track_provenance) {
         if (track_correctness) {
@@ -1196,43 +1322,45 @@ vector<Alignment> MinimizerMapper::map_from_chains(Alignment& aln) {
         }
         // Annotate with parameters used for the filters and algorithms.
         
-        set_annotation(mappings[0], "param_hit-cap", (double) hit_cap);
-        set_annotation(mappings[0], "param_hard-hit-cap", (double) hard_hit_cap);
-        set_annotation(mappings[0], "param_score-fraction", (double) minimizer_score_fraction);
-        set_annotation(mappings[0], "param_max-unique-min", (double) max_unique_min);
-        set_annotation(mappings[0], "param_num-bp-per-min", (double) num_bp_per_min);
-        set_annotation(mappings[0], "param_exclude-overlapping-min", exclude_overlapping_min);
-        set_annotation(mappings[0], "param_align-from-chains", align_from_chains);
-        set_annotation(mappings[0], "param_chaining-cluster-distance", (double) chaining_cluster_distance);
-        set_annotation(mappings[0], "param_precluster-connection-coverage-threshold", precluster_connection_coverage_threshold);
-        set_annotation(mappings[0], "param_min-precluster-connections", (double) min_precluster_connections);
-        set_annotation(mappings[0], "param_max-precluster-connections", (double) max_precluster_connections);
-        set_annotation(mappings[0], "param_min-clusters-to-chain", (double) min_clusters_to_chain);
-        set_annotation(mappings[0], "param_max-clusters-to-chain", (double) max_clusters_to_chain);
-        set_annotation(mappings[0], "param_reseed-search-distance", (double) reseed_search_distance);
+        set_annotation(annotations, "param_hit-cap", (double) hit_cap);
+        set_annotation(annotations, "param_hard-hit-cap", (double) hard_hit_cap);
+        set_annotation(annotations, "param_score-fraction", (double) minimizer_score_fraction);
+        set_annotation(annotations, "param_max-unique-min", (double) max_unique_min);
+        set_annotation(annotations, "param_num-bp-per-min", (double) num_bp_per_min);
+        set_annotation(annotations, "param_exclude-overlapping-min", exclude_overlapping_min);
+        set_annotation(annotations, "param_align-from-chains", align_from_chains);
+        set_annotation(annotations, "param_chaining-cluster-distance", (double) chaining_cluster_distance);
+        set_annotation(annotations, "param_precluster-connection-coverage-threshold", precluster_connection_coverage_threshold);
+        set_annotation(annotations, "param_min-precluster-connections", (double) min_precluster_connections);
+        set_annotation(annotations, "param_max-precluster-connections", (double) max_precluster_connections);
+        set_annotation(annotations, "param_min-clusters-to-chain", (double) min_clusters_to_chain);
+        set_annotation(annotations, "param_max-clusters-to-chain", (double) max_clusters_to_chain);
+        set_annotation(annotations, "param_reseed-search-distance", (double) reseed_search_distance);
         
         // Chaining algorithm parameters
-        set_annotation(mappings[0], "param_max-lookback-bases", (double) max_lookback_bases);
-        set_annotation(mappings[0], "param_initial-lookback-threshold", (double) initial_lookback_threshold);
-        set_annotation(mappings[0], "param_lookback-scale-factor", lookback_scale_factor);
-        set_annotation(mappings[0], "param_min-good-transition-score-per-base", min_good_transition_score_per_base);
-        set_annotation(mappings[0], "param_item-bonus", (double) item_bonus);
-        set_annotation(mappings[0], "param_max-indel-bases", (double) max_indel_bases);
+        set_annotation(annotations, "param_max-lookback-bases", (double) max_lookback_bases);
+        set_annotation(annotations, "param_initial-lookback-threshold", (double) initial_lookback_threshold);
+        set_annotation(annotations, "param_lookback-scale-factor", lookback_scale_factor);
+        set_annotation(annotations, "param_min-good-transition-score-per-base", min_good_transition_score_per_base);
+        set_annotation(annotations, "param_item-bonus", (double) item_bonus);
+        set_annotation(annotations, "param_max-indel-bases", (double) max_indel_bases);
         
-        set_annotation(mappings[0], "param_max-chain-connection", (double) max_chain_connection);
-        set_annotation(mappings[0], "param_max-tail-length", (double) max_tail_length);
-        set_annotation(mappings[0], "param_max-alignments", (double) max_alignments);
-        set_annotation(mappings[0], "param_cluster-score", (double) cluster_score_threshold);
-        set_annotation(mappings[0], "param_cluster-coverage", (double) cluster_coverage_threshold);
-        set_annotation(mappings[0], "param_cluster-score", (double) cluster_score_threshold);
-        set_annotation(mappings[0], "param_chain-score", (double) chain_score_threshold);
-        set_annotation(mappings[0], "param_chain-min-score", (double) chain_min_score);
-        set_annotation(mappings[0], "param_min-chains", (double) min_chains);
+        set_annotation(annotations, "param_max-chain-connection", (double) max_chain_connection);
+        set_annotation(annotations, "param_max-tail-length", (double) max_tail_length);
+        set_annotation(annotations, "param_max-alignments", (double) max_alignments);
+        set_annotation(annotations, "param_cluster-score", (double) cluster_score_threshold);
+        set_annotation(annotations, "param_cluster-coverage", (double) cluster_coverage_threshold);
+        set_annotation(annotations, "param_cluster-score", (double) cluster_score_threshold);
+        set_annotation(annotations, "param_chain-score", (double) chain_score_threshold);
+        set_annotation(annotations, "param_chain-min-score", (double) chain_min_score);
+        set_annotation(annotations, "param_min-chains", (double) min_chains);
         
-        set_annotation(mappings[0], "precluster_connections_explored", (double)precluster_connection_explored_count);
-        set_annotation(mappings[0], "precluster_connections_total", (double)precluster_connections.size());
+        set_annotation(annotations, "precluster_connections_explored", (double)precluster_connection_explored_count);
+        set_annotation(annotations, "precluster_connections_total", (double)precluster_connections.size());
     }
     
+    attach_annotations(annotations, mappings[0]);
+    
 #ifdef print_minimizer_table
     cerr << aln.sequence() << "\t";
     for (char c : aln.quality()) {
@@ -1312,6 +1440,11 @@ Alignment MinimizerMapper::find_chain_alignment(
     // Note that the extender expects anchoring matches!!!
     WFAExtender extender(gbwt_graph, aligner); 
     
+    // Mask the read and get its reverse complement once for all the
+    // alignments with the extender.
+    PreparedRead& prepared_read = PreparedRead::for_this_thread();
+    prepared_read.prepare(aln.sequence());
+    
     // Keep a couple cursors in the chain: extension before and after the linking up we need to do.
     auto here_it = chain.begin();
     auto next_it = here_it;
@@ -1350,7 +1483,7 @@ Alignment MinimizerMapper::find_chain_alignment(
         if (left_tail.size() <= max_tail_length) {
             // Tail is short so keep to the GBWT.
             // We align the left tail with prefix(), which creates a prefix of the alignment.
-            left_alignment = extender.prefix(left_tail, right_anchor);
+            left_alignment = extender.prefix(prepared_read, left_tail_length, right_anchor);
             if (left_alignment && left_alignment.seq_offset != 0) {
                 // We didn't get all the way to the left end of the read without
                 // running out of score.
@@ -1535,7 +1668,7 @@ Alignment MinimizerMapper::find_chain_alignment(
             pos_t left_anchor = (*here).graph_end();
             get_offset(left_anchor)--;
             
-            link_alignment = extender.connect(linking_bases, left_anchor, (*next).graph_start());
+            link_alignment = extender.connect(prepared_read, link_start, link_length, left_anchor, (*next).graph_start());
             
             longest_attempted_connection = std::max(longest_attempted_connection, linking_bases.size());
             
@@ -1665,7 +1798,7 @@ Alignment MinimizerMapper::find_chain_alignment(
         if (right_tail_length <= max_tail_length) {
             // We align the right tail with suffix(), which creates a suffix of the alignment.
             // Make sure to walk back the anchor so it is outside of the region to be aligned.
-            right_alignment = extender.suffix(right_tail, left_anchor);
+            right_alignment = extender.suffix(prepared_read, (*here).read_end(), left_anchor);
         }
         
         if (right_alignment) {
@@ -5,6 +5,7 @@
  */
 
 #include "multipath_alignment_emitter.hpp"
+#include "direct_gaf_alignment_emitter.hpp"
 #include "vg/io/json2pb.h"
 
 using namespace vg::io;
@@ -89,12 +90,61 @@ void MultipathAlignmentEmitter::set_min_splice_length(int64_t min_splice_length)
     this->min_splice_length = min_splice_length;
 }
 
+void MultipathAlignmentEmitter::set_streaming(bool streaming) {
+    this->streaming = streaming;
+}
+
 void MultipathAlignmentEmitter::emit_pairs(const string& name_1, const string& name_2,
                                            vector<pair<multipath_alignment_t, multipath_alignment_t>>&& mp_aln_pairs,
                                            vector<pair<tuple<string, bool, int64_t>, tuple<string, bool, int64_t>>>* path_positions,
                                            vector<int64_t>* tlen_limits) {
     
     int thread_number = omp_get_thread_num();
+    if (streaming && (format == GAMP || format == GAM || format == GAF)) {
+        // convert and write one pair at a time, and let go of each pair once it's written
+        for (size_t i = 0; i < mp_aln_pairs.size(); ++i) {
+            if (format == GAMP) {
+                MultipathAlignment mp_aln_out_1, mp_aln_out_2;
+                to_proto_multipath_alignment(mp_aln_pairs[i].first, mp_aln_out_1);
+                to_proto_multipath_alignment(mp_aln_pairs[i].second, mp_aln_out_2);
+                mp_aln_out_1.set_name(name_1);
+                mp_aln_out_2.set_name(name_2);
+                mp_aln_out_1.set_paired_read_name(name_2);
+                mp_aln_out_2.set_paired_read_name(name_1);
+                if (!sample_name.empty()) {
+                    mp_aln_out_1.set_sample_name(sample_name);
+                    mp_aln_out_2.set_sample_name(sample_name);
+                }
+                if (!read_group.empty()) {
+                    mp_aln_out_1.set_read_group(read_group);
+                    mp_aln_out_2.set_read_group(read_group);
+                }
+                mp_aln_emitters[thread_number]->write(std::move(mp_aln_out_1));
+                mp_aln_emitters[thread_number]->write(std::move(mp_aln_out_2));
+            }
+            else {
+                Alignment aln_out_1, aln_out_2;
+                convert_to_alignment(mp_aln_pairs[i].first, aln_out_1, nullptr, &name_2);
+                convert_to_alignment(mp_aln_pairs[i].second, aln_out_2, &name_1, nullptr);
+                aln_out_1.set_name(name_1);
+                aln_out_2.set_name(name_2);
+                if (!sample_name.empty()) {
+                    aln_out_1.set_sample_name(sample_name);
+                    aln_out_2.set_sample_name(sample_name);
+                }
+                if (!read_group.empty()) {
+                    aln_out_1.set_read_group(read_group);
+                    aln_out_2.set_read_group(read_group);
+                }
+                write_alignment(std::move(aln_out_1), thread_number);
+                write_alignment(std::move(aln_out_2), thread_number);
+            }
+            mp_aln_pairs[i] = pair<multipath_alignment_t, multipath_alignment_t>();
+        }
+        check_breakpoint(thread_number);
+        return;
+    }
+    
     switch (format) {
         case GAMP:
         {
@@ -192,6 +242,9 @@ void MultipathAlignmentEmitter::emit_pairs(const string& name_1, const string& n
                 convert_to_hts_paired(name_1, name_2, mp_aln_pairs[i].first, mp_aln_pairs[i].second,
                                       ref_name_1, ref_rev_1, ref_pos_1, ref_name_2, ref_rev_2, ref_pos_2,
                                       tlen_limit, header, records);
+                if (streaming) {
+                    mp_aln_pairs[i] = pair<multipath_alignment_t, multipath_alignment_t>();
+                }
             }
             
             save_records(header, records, thread_number);
@@ -209,6 +262,39 @@ void MultipathAlignmentEmitter::emit_singles(const string& name, vector<multipat
     
     int thread_number = omp_get_thread_num();
     
+    if (streaming && (format == GAMP || format == GAM || format == GAF)) {
+        // convert and write one alignment at a time, and let go of each one once it's written
+        for (size_t i = 0; i < mp_alns.size(); ++i) {
+            if (format == GAMP) {
+                MultipathAlignment mp_aln_out;
+                to_proto_multipath_alignment(mp_alns[i], mp_aln_out);
+                mp_aln_out.set_name(name);
+                if (!sample_name.empty()) {
+                    mp_aln_out.set_sample_name(sample_name);
+                }
+                if (!read_group.empty()) {
+                    mp_aln_out.set_read_group(read_group);
+                }
+                mp_aln_emitters[thread_number]->write(std::move(mp_aln_out));
+            }
+            else {
+                Alignment aln_out;
+                convert_to_alignment(mp_alns[i], aln_out);
+                aln_out.set_name(name);
+                if (!sample_name.empty()) {
+                    aln_out.set_sample_name(sample_name);
+                }
+                if (!read_group.empty()) {
+                    aln_out.set_read_group(read_group);
+                }
+                write_alignment(std::move(aln_out), thread_number);
+            }
+            mp_alns[i] = multipath_alignment_t();
+        }
+        check_breakpoint(thread_number);
+        return;
+    }
+    
     switch (format) {
         case GAMP:
         {
@@ -253,18 +339,13 @@ void MultipathAlignmentEmitter::emit_singles(const string& name, vector<multipat
             
             if (format == GAM) {
                 aln_emitters[thread_number]->write_many(std::move(alns_out));
-                
-                if (multiplexer.want_breakpoint(thread_number)) {
-                    // The multiplexer wants our data.
-                    // Flush and create a breakpoint.
-                    aln_emitters[thread_number]->flush();
-                }
             }
             else {
                 for (auto& aln : alns_out) {
                     multiplexer.get_thread_stream(thread_number) << alignment_to_gaf(*graph, aln) << endl;
                 }
             }
+            check_breakpoint(thread_number);
             break;
         }
         case SAM:
@@ -282,6 +363,9 @@ void MultipathAlignmentEmitter::emit_singles(const string& name, vector<multipat
                 int64_t ref_pos;
                 tie(ref_name, ref_rev, ref_pos) = path_positions->at(i);
                 convert_to_hts_unpaired(name, mp_alns[i], ref_name, ref_rev, ref_pos, header, records);
+                if (streaming) {
+                    mp_alns[i] = multipath_alignment_t();
+                }
             }
             
             save_records(header, records, thread_number);
@@ -294,6 +378,33 @@ void MultipathAlignmentEmitter::emit_singles(const string& name, vector<multipat
     }
 }
 
+void MultipathAlignmentEmitter::write_alignment(Alignment&& aln, int thread_number) {
+    if (format == GAM) {
+        aln_emitters[thread_number]->write(std::move(aln));
+    }
+    else {
+        // format the line straight into a reused buffer, rather than through a GAF record
+        static thread_local string gaf_line;
+        gaf_line.clear();
+        DirectGAFAlignmentEmitter::append_gaf_line(*graph, aln, gaf_line);
+        multiplexer.get_thread_stream(thread_number).write(gaf_line.data(), gaf_line.size());
+    }
+}
+
+void MultipathAlignmentEmitter::check_breakpoint(int thread_number) {
+    if (multiplexer.want_breakpoint(thread_number)) {
+        // The multiplexer wants our data.
+        // Flush and create a breakpoint.
+        if (format == GAM) {
+            aln_emitters[thread_number]->flush();
+        }
+        else if (format == GAMP) {
+            mp_aln_emitters[thread_number]->flush();
+        }
+        multiplexer.register_breakpoint(thread_number);
+    }
+}
+
 void MultipathAlignmentEmitter::convert_to_alignment(const multipath_alignment_t& mp_aln, Alignment& aln,
                                                      const string* prev_name,
                                                      const string* next_name) const {
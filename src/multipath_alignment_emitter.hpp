@@ -50,6 +50,12 @@ public:
     /// in HTSLib output
     void set_min_splice_length(int64_t min_splice_length);
     
+    /// Choose whether to convert and write each alignment as soon as it is
+    /// emitted, releasing its multipath alignment right away, rather than
+    /// converting a read's whole group of alignments before writing any.
+    /// GAF lines are then formatted directly into the thread's output.
+    void set_streaming(bool streaming);
+    
     /// Emit paired read mappings as interleaved protobuf messages
     void emit_pairs(const string& name_1, const string& name_2,
                     vector<pair<multipath_alignment_t, multipath_alignment_t>>&& mp_aln_pairs,
@@ -71,6 +77,12 @@ private:
                               const string* prev_name = nullptr,
                               const string* next_name = nullptr) const;
     
+    /// write a single-path alignment to this thread's GAM or GAF output
+    void write_alignment(Alignment&& aln, int thread_number);
+    
+    /// give the multiplexer this thread's data if it wants it
+    void check_breakpoint(int thread_number);
+    
     /// store the data in an Algnment that is used in the conversion to bam1_t
     void create_alignment_shim(const string& name, const multipath_alignment_t& mp_aln,
                                Alignment& shim, const string* prev_name = nullptr,
@@ -109,6 +121,9 @@ private:
     /// the shortest deletion that we will interpret as a splice in the CIGAR string of HTS output
     int64_t min_splice_length = numeric_limits<int64_t>::max();
     
+    /// do we write each alignment as soon as it's converted?
+    bool streaming = false;
+    
 };
 
 }
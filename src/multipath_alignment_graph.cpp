@@ -10,6 +10,8 @@
 #include "algorithms/extract_connecting_graph.hpp"
 #include "algorithms/extract_extending_graph.hpp"
 
+#include <list>
+
 //#define debug_multipath_alignment
 //#define debug_decompose_algorithm
 //#define debug_shift_pruning
@@ -3928,57 +3930,100 @@ namespace vg {
         return count;
     }
     
+    thread_local MultipathAlignmentGraph::EdgeTable MultipathAlignmentGraph::forward_edge_table;
+    thread_local MultipathAlignmentGraph::EdgeTable MultipathAlignmentGraph::reverse_edge_table;
+    
+    void MultipathAlignmentGraph::EdgeTable::build(const vector<PathNode>& path_nodes, bool reverse) {
+        
+        // count the edges in each row
+        offsets.assign(path_nodes.size() + 1, 0);
+        for (size_t i = 0; i < path_nodes.size(); ++i) {
+            if (reverse) {
+                for (const pair<size_t, size_t>& edge : path_nodes[i].edges) {
+                    ++offsets[edge.first + 1];
+                }
+            }
+            else {
+                offsets[i + 1] = path_nodes[i].edges.size();
+            }
+        }
+        for (size_t i = 1; i < offsets.size(); ++i) {
+            offsets[i] += offsets[i - 1];
+        }
+        targets.resize(offsets.back());
+        lengths.resize(offsets.back());
+        
+        if (reverse) {
+            // bucket the edges by their target, using the row starts as insertion points
+            for (size_t i = 0; i < path_nodes.size(); ++i) {
+                for (const pair<size_t, size_t>& edge : path_nodes[i].edges) {
+                    size_t k = offsets[edge.first]++;
+                    targets[k] = i;
+                    lengths[k] = edge.second;
+                }
+            }
+            // the insertion points have moved to the end of their rows, so shift them back
+            for (size_t i = path_nodes.size(); i > 0; --i) {
+                offsets[i] = offsets[i - 1];
+            }
+            offsets[0] = 0;
+        }
+        else {
+            size_t k = 0;
+            for (const PathNode& path_node : path_nodes) {
+                for (const pair<size_t, size_t>& edge : path_node.edges) {
+                    targets[k] = edge.first;
+                    lengths[k] = edge.second;
+                    ++k;
+                }
+            }
+        }
+    }
+    
     // Kahn's algorithm
     void MultipathAlignmentGraph::topological_sort(vector<size_t>& order_out) {
         // Can only sort if edges are present.
         assert(has_reachability_edges);
         
+        const EdgeTable& edge_table = forward_edge_table;
+        forward_edge_table.build(path_nodes);
+        
         order_out.resize(path_nodes.size());
        
         vector<size_t> in_degree(path_nodes.size());
-        
-        for (const PathNode& path_node : path_nodes) {
-            for (const pair<size_t, size_t>& edge : path_node.edges) {
-                in_degree[edge.first]++;
-            }
+        for (size_t target : edge_table.targets) {
+            in_degree[target]++;
         }
         
-        list<size_t> source_queue;
+        // the output doubles as the queue of sources
+        size_t queue_end = 0;
         for (size_t i = 0; i < path_nodes.size(); i++) {
             if (in_degree[i] == 0) {
-                source_queue.push_back(i);
+                order_out[queue_end++] = i;
             }
         }
         
-        size_t next = 0;
-        while (!source_queue.empty()) {
-            size_t src = source_queue.front();
-            source_queue.pop_front();
-            
-            for (const pair<size_t, size_t>& edge : path_nodes.at(src).edges) {
-                in_degree[edge.first]--;
-                if (in_degree[edge.first] == 0) {
-                    source_queue.push_back(edge.first);
+        for (size_t next = 0; next < queue_end; next++) {
+            size_t src = order_out[next];
+            for (size_t k = edge_table.offsets[src]; k < edge_table.offsets[src + 1]; k++) {
+                size_t target = edge_table.targets[k];
+                in_degree[target]--;
+                if (in_degree[target] == 0) {
+                    order_out[queue_end++] = target;
                 }
             }
-            
-            order_out[next] = src;
-            next++;
         }
     }
     
     void MultipathAlignmentGraph::reorder_adjacency_lists(const vector<size_t>& order) {
-        vector<vector<pair<size_t, size_t>>> reverse_graph(path_nodes.size());
-        for (size_t i = 0; i < path_nodes.size(); i++) {
-            auto& edges = path_nodes[i].edges;
-            for (const pair<size_t, size_t>& edge : edges) {
-                reverse_graph[edge.first].emplace_back(i, edge.second);
-            }
-            edges.clear();
+        const EdgeTable& reverse_graph = reverse_edge_table;
+        reverse_edge_table.build(path_nodes, true);
+        for (PathNode& path_node : path_nodes) {
+            path_node.edges.clear();
         }
         for (size_t i : order) {
-            for (const pair<size_t, size_t>& edge : reverse_graph[i]) {
-                path_nodes[edge.first].edges.emplace_back(i, edge.second);
+            for (size_t k = reverse_graph.offsets[i]; k < reverse_graph.offsets[i + 1]; k++) {
+                path_nodes[reverse_graph.targets[k]].edges.emplace_back(i, reverse_graph.lengths[k]);
             }
         }
     }
@@ -3992,6 +4037,11 @@ namespace vg {
         // that the edge is a correct connection that we want to keep
         vector<pair<size_t, size_t>> shortest_exact_src;
         
+        // the edges in contiguous arrays for the DFS, and the last node whose DFS reached each node
+        const EdgeTable& edge_table = forward_edge_table;
+        vector<size_t> traversed_from;
+        vector<size_t> stack;
+        
         for (size_t i : topological_order) {
             vector<pair<size_t, size_t>>& edges = path_nodes[i].edges;
             
@@ -4026,14 +4076,18 @@ namespace vg {
                         }
                     }
                 }
+                
+                // removing transitive edges doesn't change reachability, so this snapshot stays good for
+                // the DFS as we go
+                forward_edge_table.build(path_nodes);
+                traversed_from.resize(path_nodes.size(), numeric_limits<size_t>::max());
             }
             
             vector<bool> keep(edges.size(), true);
-            unordered_set<size_t> traversed;
             
             for (size_t j = 0; j < edges.size(); j++) {
                 const pair<size_t, size_t>& edge = edges[j];
-                if (traversed.count(edge.first) && edge.second != 0 &&
+                if (traversed_from[edge.first] == i && edge.second != 0 &&
                     path_nodes[i].end != path_nodes[edge.first].begin) {
                     // we can reach the target of this edge by another path, so it is transitive
                     // and the path nodes don't abut on either the read or graph
@@ -4048,15 +4102,16 @@ namespace vg {
                 }
                 
                 // DFS to mark all reachable nodes from this edge
-                vector<size_t> stack{edge.first};
-                traversed.insert(edge.first);
+                stack.assign(1, edge.first);
+                traversed_from[edge.first] = i;
                 while (!stack.empty()) {
                     size_t idx = stack.back();
                     stack.pop_back();
-                    for (const pair<size_t, size_t>& edge_from : path_nodes.at(idx).edges) {
-                        if (!traversed.count(edge_from.first)) {
-                            stack.push_back(edge_from.first);
-                            traversed.insert(edge_from.first);
+                    for (size_t k = edge_table.offsets[idx]; k < edge_table.offsets[idx + 1]; k++) {
+                        size_t target = edge_table.targets[k];
+                        if (traversed_from[target] != i) {
+                            stack.push_back(target);
+                            traversed_from[target] = i;
                         }
                     }
                 }
@@ -4107,7 +4162,10 @@ namespace vg {
             return;
         }
         
-        unordered_map<pair<size_t, size_t>, int32_t> edge_weights;
+        // the weights of the edges are indexed the same as the edge table
+        const EdgeTable& edge_table = forward_edge_table;
+        forward_edge_table.build(path_nodes);
+        vector<int32_t> edge_weights(edge_table.targets.size());
         
         vector<int32_t> node_weights(path_nodes.size());
                 
@@ -4119,29 +4177,29 @@ namespace vg {
                                + (from_node.begin == alignment.sequence().begin() ? aligner->score_full_length_bonus(true, alignment) : 0)
                                + (from_node.end == alignment.sequence().end() ? aligner->score_full_length_bonus(false, alignment) : 0));
                         
-            for (const pair<size_t, size_t>& edge : from_node.edges) {
-                PathNode& to_node = path_nodes.at(edge.first);
+            for (size_t k = edge_table.offsets[i]; k < edge_table.offsets[i + 1]; k++) {
+                PathNode& to_node = path_nodes.at(edge_table.targets[k]);
                 
-                int64_t graph_dist = edge.second;
+                int64_t graph_dist = edge_table.lengths[k];
                 int64_t read_dist = to_node.begin - from_node.end;
                 
                 if (read_dist > graph_dist) {
                     // the read length in between the MEMs is longer than the distance, suggesting a read insert
                     // and potentially another mismatch on the other end
                     int64_t gap_length = read_dist - graph_dist;
-                    edge_weights[make_pair(i, edge.first)] = (-(gap_length - 1) * aligner->gap_extension - aligner->gap_open
-                                                              - (graph_dist > 0) * aligner->mismatch);
+                    edge_weights[k] = (-(gap_length - 1) * aligner->gap_extension - aligner->gap_open
+                                       - (graph_dist > 0) * aligner->mismatch);
                 }
                 else if (read_dist < graph_dist) {
                     // the read length in between the MEMs is shorter than the distance, suggesting a read deletion
                     // and potentially another mismatch on the other end
                     int64_t gap_length = graph_dist - read_dist;
-                    edge_weights[make_pair(i, edge.first)] = (-(gap_length - 1) * aligner->gap_extension - aligner->gap_open
-                                                              - (read_dist > 0) * aligner->mismatch);
+                    edge_weights[k] = (-(gap_length - 1) * aligner->gap_extension - aligner->gap_open
+                                       - (read_dist > 0) * aligner->mismatch);
                 }
                 else {
                     // the read length in between the MEMs is the same as the distance, suggesting a pure mismatch
-                    edge_weights[make_pair(i, edge.first)] = -((graph_dist > 0) + (graph_dist > 1)) * aligner->mismatch;
+                    edge_weights[k] = -((graph_dist > 0) + (graph_dist > 1)) * aligner->mismatch;
                 }
             }
         }
@@ -4153,9 +4211,10 @@ namespace vg {
         for (int64_t i = 0; i < topological_order.size(); i++) {
             size_t idx = topological_order[i];
             int32_t from_score = forward_scores[idx];
-            for (const pair<size_t, size_t>& edge : path_nodes.at(idx).edges) {
-                forward_scores[edge.first] = std::max(forward_scores[edge.first],
-                                                      node_weights[edge.first] + from_score + edge_weights[make_pair(idx, edge.first)]);
+            for (size_t k = edge_table.offsets[idx]; k < edge_table.offsets[idx + 1]; k++) {
+                size_t target = edge_table.targets[k];
+                forward_scores[target] = std::max(forward_scores[target],
+                                                  node_weights[target] + from_score + edge_weights[k]);
             }
         }
         
@@ -4163,9 +4222,9 @@ namespace vg {
         for (int64_t i = topological_order.size() - 1; i >= 0; i--) {
             size_t idx = topological_order[i];
             int32_t score_here = node_weights[idx];
-            for (const pair<size_t, size_t>& edge : path_nodes.at(idx).edges) {
+            for (size_t k = edge_table.offsets[idx]; k < edge_table.offsets[idx + 1]; k++) {
                 backward_scores[idx] = std::max(backward_scores[idx],
-                                                score_here + backward_scores[edge.first] + edge_weights[make_pair(idx, edge.first)]);
+                                                score_here + backward_scores[edge_table.targets[k]] + edge_weights[k]);
             }
         }
         
@@ -4189,7 +4248,7 @@ namespace vg {
                 size_t edges_removed = 0;
                 for (size_t j = 0; j < path_node.edges.size(); ++j) {
                     auto& edge = path_node.edges[j];
-                    if (forward_scores[i] + backward_scores[edge.first] + edge_weights[make_pair(i, edge.first)] < min_path_score) {
+                    if (forward_scores[i] + backward_scores[edge.first] + edge_weights[edge_table.offsets[i] + j] < min_path_score) {
                         ++edges_removed;
                     }
                     else {
@@ -4227,7 +4286,8 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
                                     double pessimistic_tail_gap_multiplier, bool simplify_topologies, size_t unmergeable_len,
                                     size_t band_padding, multipath_alignment_t& multipath_aln_out, SnarlManager* cutting_snarls,
                                     SnarlDistanceIndex* dist_index, const function<pair<id_t, bool>(id_t)>* project,
-                                    bool allow_negative_scores, unordered_map<handle_t, bool>* left_align_strand) {
+                                    bool allow_negative_scores, unordered_map<handle_t, bool>* left_align_strand,
+                                    bool batch_tails, int32_t connection_prune_score_diff) {
         
         // don't dynamically choose band padding, shim constant value into a function type
         function<size_t(const Alignment&,const HandleGraph&)> constant_padding = [&](const Alignment& seq, const HandleGraph& graph) {
@@ -4249,7 +4309,9 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
               dist_index,
               project,
               allow_negative_scores,
-              left_align_strand);
+              left_align_strand,
+              batch_tails,
+              connection_prune_score_diff);
     }
 
     void MultipathAlignmentGraph::deduplicate_alt_alns(vector<pair<path_t, int32_t>>& alt_alns,
@@ -5179,13 +5241,123 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
         return return_val;
     }
     
+    vector<vector<bool>> MultipathAlignmentGraph::prunable_connections(const Alignment& alignment, const GSSWAligner* aligner,
+                                                                       const multipath_alignment_t& multipath_aln,
+                                                                       const vector<vector<int32_t>>& connection_scores,
+                                                                       int32_t prune_score_diff) const {
+        
+        vector<vector<bool>> pruned(path_nodes.size());
+        
+        // edges that don't have a connecting alignment at all are removed regardless
+        vector<size_t> in_degree(path_nodes.size(), 0);
+        vector<size_t> out_degree(path_nodes.size(), 0);
+        for (size_t i = 0; i < path_nodes.size(); ++i) {
+            pruned[i].resize(path_nodes[i].edges.size(), false);
+            for (size_t e = 0; e < path_nodes[i].edges.size(); ++e) {
+                if (connection_scores[i][e] == numeric_limits<int32_t>::min()) {
+                    pruned[i][e] = true;
+                }
+                else {
+                    ++in_degree[path_nodes[i].edges[e].first];
+                    ++out_degree[i];
+                }
+            }
+        }
+        
+        // get a topological order with Kahn's algorithm
+        vector<size_t> order;
+        order.reserve(path_nodes.size());
+        vector<size_t> unvisited_in = in_degree;
+        for (size_t i = 0; i < path_nodes.size(); ++i) {
+            if (unvisited_in[i] == 0) {
+                order.push_back(i);
+            }
+        }
+        for (size_t k = 0; k < order.size(); ++k) {
+            size_t i = order[k];
+            for (size_t e = 0; e < path_nodes[i].edges.size(); ++e) {
+                if (!pruned[i][e] && --unvisited_in[path_nodes[i].edges[e].first] == 0) {
+                    order.push_back(path_nodes[i].edges[e].first);
+                }
+            }
+        }
+        if (order.size() != path_nodes.size()) {
+            // not a DAG, so the bounds don't mean anything
+            return pruned;
+        }
+        
+        // the best any one tail off of each node could score, which is an exact match with a full
+        // length bonus, or nothing if the node already reaches the end of the read
+        auto tail_bound = [&](size_t i, bool left) -> int64_t {
+            const PathNode& path_node = path_nodes[i];
+            if (left) {
+                size_t length = path_node.begin - alignment.sequence().begin();
+                return length ? aligner->score_exact_match(alignment, 0, length) + aligner->score_full_length_bonus(true, alignment) : 0;
+            }
+            else {
+                size_t length = alignment.sequence().end() - path_node.end;
+                return length ? (aligner->score_exact_match(alignment, path_node.end - alignment.sequence().begin(), length)
+                                 + aligner->score_full_length_bonus(false, alignment)) : 0;
+            }
+        };
+        
+        // the highest score of an alignment up to and including each node, assuming that any node could
+        // be a source, and the score of the best actual alignment with soft-clipped tails
+        vector<int64_t> prefix_upper(path_nodes.size(), numeric_limits<int64_t>::min());
+        vector<int64_t> prefix_lower(path_nodes.size(), numeric_limits<int64_t>::min());
+        for (size_t i : order) {
+            prefix_upper[i] = max(prefix_upper[i], tail_bound(i, true)) + multipath_aln.subpath(i).score();
+            prefix_lower[i] = (in_degree[i] == 0 ? 0 : prefix_lower[i]) + multipath_aln.subpath(i).score();
+            for (size_t e = 0; e < path_nodes[i].edges.size(); ++e) {
+                if (!pruned[i][e]) {
+                    size_t next = path_nodes[i].edges[e].first;
+                    prefix_upper[next] = max(prefix_upper[next], prefix_upper[i] + connection_scores[i][e]);
+                    prefix_lower[next] = max(prefix_lower[next], prefix_lower[i] + connection_scores[i][e]);
+                }
+            }
+        }
+        
+        // the highest score of an alignment from each node onward, assuming that any node could be a sink
+        vector<int64_t> suffix_upper(path_nodes.size());
+        int64_t best_lower = numeric_limits<int64_t>::min();
+        for (auto iter = order.rbegin(); iter != order.rend(); ++iter) {
+            size_t i = *iter;
+            int64_t best_next = tail_bound(i, false);
+            for (size_t e = 0; e < path_nodes[i].edges.size(); ++e) {
+                if (!pruned[i][e]) {
+                    best_next = max(best_next, connection_scores[i][e] + suffix_upper[path_nodes[i].edges[e].first]);
+                }
+            }
+            suffix_upper[i] = best_next + multipath_aln.subpath(i).score();
+            if (out_degree[i] == 0) {
+                best_lower = max(best_lower, prefix_lower[i]);
+            }
+        }
+        
+        // remove the edges that can't take part in a good enough alignment
+        for (size_t i = 0; i < path_nodes.size(); ++i) {
+            for (size_t e = 0; e < path_nodes[i].edges.size(); ++e) {
+                if (!pruned[i][e] &&
+                    prefix_upper[i] + connection_scores[i][e] + suffix_upper[path_nodes[i].edges[e].first] < best_lower - prune_score_diff) {
+#ifdef debug_multipath_alignment
+                    cerr << "pruning connection " << i << " -> " << path_nodes[i].edges[e].first << " with score " << connection_scores[i][e] << endl;
+#endif
+                    pruned[i][e] = true;
+                }
+            }
+        }
+        
+        return pruned;
+    }
+    
     void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGraph& align_graph, const GSSWAligner* aligner,
                                         bool score_anchors_as_matches, size_t max_alt_alns, bool dynamic_alt_alns, size_t max_gap,
                                         double pessimistic_tail_gap_multiplier, bool simplify_topologies, size_t unmergeable_len,
                                         function<size_t(const Alignment&,const HandleGraph&)> band_padding_function,
                                         multipath_alignment_t& multipath_aln_out, SnarlManager* cutting_snarls,
                                         SnarlDistanceIndex* dist_index, const function<pair<id_t, bool>(id_t)>* project,
-                                        bool allow_negative_scores, unordered_map<handle_t, bool>* left_align_strand) {
+                                        bool allow_negative_scores, unordered_map<handle_t, bool>* left_align_strand,
+                                        bool batch_tails, int32_t connection_prune_score_diff) {
         
         // TODO: magic number
         // how many tails we need to have before we try the more complicated but
@@ -5244,6 +5416,90 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
         };
         
         
+        // extract the graph between the end of one match node and the beginning of another
+        auto extract_connection = [&](size_t j, const pair<size_t, size_t>& edge,
+                                      bdsg::HashGraph& connecting_graph) -> unordered_map<id_t, id_t> {
+            
+            const PathNode& src_path_node = path_nodes.at(j);
+            const PathNode& dest_path_node = path_nodes.at(edge.first);
+            
+            const path_t& path = multipath_aln_out.subpath(j).path();
+            const path_mapping_t& final_mapping = path.mapping(path.mapping_size() - 1);
+            const position_t& final_mapping_position = final_mapping.position();
+            // make a pos_t that points to the final base in the match
+            pos_t src_pos = make_pos_t(final_mapping_position.node_id(),
+                                       final_mapping_position.is_reverse(),
+                                       final_mapping_position.offset() + mapping_from_length(final_mapping));
+            pos_t dest_pos = make_pos_t(multipath_aln_out.subpath(edge.first).path().mapping(0).position());
+            
+            // the longest gap that could be detected at this position in the read
+            size_t src_max_gap = aligner->longest_detectable_gap(alignment, src_path_node.end);
+            
+            size_t intervening_length = dest_path_node.begin - src_path_node.end;
+            
+            // if negative score is allowed set maximum distance to the length between path nodes
+            // otherwise set it to the maximum gap length possible while retaining a positive score
+            size_t max_dist = allow_negative_scores ?
+                edge.second :
+                intervening_length + min(min(src_max_gap, aligner->longest_detectable_gap(alignment, dest_path_node.begin)), max_gap);
+            
+#ifdef debug_multipath_alignment
+            cerr << "read dist: " << intervening_length << ", graph dist " << edge.second << " source max gap: " << src_max_gap << ", dest max gap " << aligner->longest_detectable_gap(alignment, dest_path_node.begin) << ", max allowed gap " << max_gap << endl;
+#endif
+            
+            return algorithms::extract_connecting_graph(&align_graph,      // DAG with split strands
+                                                        &connecting_graph, // graph to extract into
+                                                        max_dist,          // longest distance necessary
+                                                        src_pos,           // end of earlier match
+                                                        dest_pos,          // beginning of later match
+                                                        false);            // do not enforce max distance strictly
+        };
+        
+        // transfer the substring between two match nodes to a new alignment
+        auto intervening_alignment = [&](size_t j, const pair<size_t, size_t>& edge) {
+            const PathNode& src_path_node = path_nodes.at(j);
+            const PathNode& dest_path_node = path_nodes.at(edge.first);
+            Alignment intervening_sequence;
+            intervening_sequence.set_sequence(alignment.sequence().substr(src_path_node.end - alignment.sequence().begin(),
+                                                                          dest_path_node.begin - src_path_node.end));
+            if (!alignment.quality().empty()) {
+                intervening_sequence.set_quality(alignment.quality().substr(src_path_node.end - alignment.sequence().begin(),
+                                                                            dest_path_node.begin - src_path_node.end));
+            }
+            return intervening_sequence;
+        };
+        
+        // if we're pruning, extract and score every connection up front, so that we can skip the
+        // traceback for the ones that can't be part of a good alignment
+        bool prune_connections = connection_prune_score_diff >= 0;
+        vector<vector<unique_ptr<bdsg::HashGraph>>> connecting_graphs;
+        vector<vector<unordered_map<id_t, id_t>>> connecting_translations;
+        vector<vector<bool>> pruned;
+        if (prune_connections) {
+            connecting_graphs.resize(path_nodes.size());
+            connecting_translations.resize(path_nodes.size());
+            vector<vector<int32_t>> connection_scores(path_nodes.size());
+            for (size_t j = 0; j < path_nodes.size(); j++) {
+                const auto& edges = path_nodes[j].edges;
+                connecting_graphs[j].resize(edges.size());
+                connecting_translations[j].resize(edges.size());
+                connection_scores[j].resize(edges.size(), numeric_limits<int32_t>::min());
+                for (size_t e = 0; e < edges.size(); e++) {
+                    connecting_graphs[j][e].reset(new bdsg::HashGraph());
+                    connecting_translations[j][e] = extract_connection(j, edges[e], *connecting_graphs[j][e]);
+                    if (connecting_graphs[j][e]->get_node_count() != 0) {
+                        Alignment intervening_sequence = intervening_alignment(j, edges[e]);
+                        connection_scores[j][e] = aligner->score_global_banded(intervening_sequence, *connecting_graphs[j][e],
+                                                                               band_padding_function(intervening_sequence,
+                                                                                                     *connecting_graphs[j][e]),
+                                                                               true, left_align_strand);
+                    }
+                }
+            }
+            pruned = prunable_connections(alignment, aligner, multipath_aln_out, connection_scores,
+                                          connection_prune_score_diff);
+        }
+        
 #ifdef debug_multipath_alignment
         cerr << "doing DP between MEMs" << endl;
 #endif
@@ -5269,46 +5525,42 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
                                        final_mapping_position.is_reverse(),
                                        final_mapping_position.offset() + mapping_from_length(final_mapping));
             
-            // the longest gap that could be detected at this position in the read
-            size_t src_max_gap = aligner->longest_detectable_gap(alignment, src_path_node.end);
-            
             // This holds edges that we remove, because we couldn't actually get an alignment across them with a positive score.
             unordered_set<pair<size_t, size_t>> edges_for_removal;
             
-            for (const pair<size_t, size_t>& edge : src_path_node.edges) {
-                PathNode& dest_path_node = path_nodes.at(edge.first);
-                pos_t dest_pos = make_pos_t(multipath_aln_out.subpath(edge.first).path().mapping(0).position());
+            for (size_t e = 0; e < src_path_node.edges.size(); e++) {
+                const pair<size_t, size_t>& edge = src_path_node.edges[e];
                 
 #ifdef debug_multipath_alignment
                 cerr << "forming intervening alignment for edge to node " << edge.first << endl;
 #endif
                 
-                size_t intervening_length = dest_path_node.begin - src_path_node.end;
-
-                // if negative score is allowed set maximum distance to the length between path nodes
-                // otherwise set it to the maximum gap length possible while retaining a positive score 
-                size_t max_dist = allow_negative_scores ?
-                    edge.second :
-                    intervening_length + min(min(src_max_gap, aligner->longest_detectable_gap(alignment, dest_path_node.begin)), max_gap);
-                
+                if (prune_connections && pruned[j][e]) {
+                    // the connection can't be part of a good enough alignment, mark the edge for removal
 #ifdef debug_multipath_alignment
-                cerr << "read dist: " << intervening_length << ", graph dist " << edge.second << " source max gap: " << src_max_gap << ", dest max gap " << aligner->longest_detectable_gap(alignment, dest_path_node.begin) << ", max allowed gap " << max_gap << endl;
+                    cerr << "Remove edge " << j << " -> " << edge.first << " because its score bound is too low" << endl;
 #endif
+                    edges_for_removal.insert(edge);
+                    continue;
+                }
                 
-                // extract the graph between the matches
-                bdsg::HashGraph connecting_graph;
-                auto connect_trans = algorithms::extract_connecting_graph(&align_graph,      // DAG with split strands
-                                                                          &connecting_graph, // graph to extract into
-                                                                          max_dist,          // longest distance necessary
-                                                                          src_pos,           // end of earlier match
-                                                                          dest_pos,          // beginning of later match
-                                                                          false);            // do not enforce max distance strictly
+                // extract the graph between the matches, unless we already did
+                unique_ptr<bdsg::HashGraph> extracted_graph;
+                unordered_map<id_t, id_t> connect_trans;
+                if (prune_connections) {
+                    extracted_graph = move(connecting_graphs[j][e]);
+                    connect_trans = move(connecting_translations[j][e]);
+                }
+                else {
+                    extracted_graph.reset(new bdsg::HashGraph());
+                    connect_trans = extract_connection(j, edge, *extracted_graph);
+                }
+                bdsg::HashGraph& connecting_graph = *extracted_graph;
                                 
                 if (connecting_graph.get_node_count() == 0) {
                     // the MEMs weren't connectable with a positive score after all, mark the edge for removal
 #ifdef debug_multipath_alignment
-                    cerr << "Remove edge " << j << " -> " << edge.first << " because we got no nodes in the connecting graph "
-                        << src_pos << " to " << dest_pos << endl;
+                    cerr << "Remove edge " << j << " -> " << edge.first << " because we got no nodes in the connecting graph" << endl;
 #endif
                     edges_for_removal.insert(edge);
                     continue;
@@ -5319,13 +5571,7 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
                 
                 
                 // transfer the substring between the matches to a new alignment
-                Alignment intervening_sequence;
-                intervening_sequence.set_sequence(alignment.sequence().substr(src_path_node.end - alignment.sequence().begin(),
-                                                                              dest_path_node.begin - src_path_node.end));
-                if (!alignment.quality().empty()) {
-                    intervening_sequence.set_quality(alignment.quality().substr(src_path_node.end - alignment.sequence().begin(),
-                                                                                dest_path_node.begin - src_path_node.end));
-                }
+                Alignment intervening_sequence = intervening_alignment(j, edge);
                 
                 // if we're doing dynamic alt alignments, possibly expand the number of tracebacks until we get an
                 // alignment to every path or hit the hard max
@@ -5447,7 +5693,7 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
         
         // Actually align the tails
         auto tail_alignments = align_tails(alignment, align_graph, aligner, max_alt_alns, dynamic_alt_alns,
-                                           max_gap, pessimistic_tail_gap_multiplier, 0, &sources);
+                                           max_gap, pessimistic_tail_gap_multiplier, 0, &sources, batch_tails);
                 
         // TODO: merge and simplify the tail alignments? rescoring would be kind of a pain...
         
@@ -5991,7 +6237,7 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
     unordered_map<bool, unordered_map<size_t, vector<Alignment>>>
     MultipathAlignmentGraph::align_tails(const Alignment& alignment, const HandleGraph& align_graph, const GSSWAligner* aligner,
                                          size_t max_alt_alns, bool dynamic_alt_alns, size_t max_gap, double pessimistic_tail_gap_multiplier,
-                                         size_t min_paths, unordered_set<size_t>* sources) {
+                                         size_t min_paths, unordered_set<size_t>* sources, bool batch_tails) {
         
 #ifdef debug_multipath_alignment
         cerr << "doing tail alignments to:" << endl;
@@ -6023,6 +6269,12 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
         auto& left_alignments = to_return[false];
         auto& right_alignments = to_return[true];
         
+        // If batching, we keep the tail graphs around so we can align to them
+        // all at the end, along with how to translate each alignment back out
+        list<bdsg::HashGraph> tail_graphs;
+        vector<PinnedAlignmentProblem> batch;
+        vector<function<void(void)>> batch_translations;
+        
         vector<bool> is_source_node(path_nodes.size(), true);
         for (size_t j = 0; j < path_nodes.size(); j++) {
             PathNode& path_node = path_nodes.at(j);
@@ -6061,7 +6313,8 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
                 
                 pos_t end_pos = final_position(path_node.path);
                 
-                bdsg::HashGraph tail_graph;
+                tail_graphs.emplace_back();
+                bdsg::HashGraph& tail_graph = tail_graphs.back();
                 unordered_map<id_t, id_t> tail_trans = algorithms::extract_extending_graph(&align_graph,
                                                                                            &tail_graph,
                                                                                            target_length,
@@ -6107,7 +6360,16 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
                     
                     // align against the graph
                     auto& alt_alignments = right_alignments[j];
-                    if (num_alt_alns == 1) {
+                    if (num_alt_alns == 1 && batch_tails) {
+                        // save it to align exactly along with the other tails
+                        alt_alignments.emplace_back(move(right_tail_sequence));
+                        batch.push_back({&alt_alignments.back(), &tail_graph, true});
+                        batch_translations.emplace_back([&alt_alignments, tail_trans, end_pos]() {
+                            translate_node_ids(*alt_alignments.back().mutable_path(), tail_trans, id(end_pos), offset(end_pos), is_rev(end_pos));
+                        });
+                        continue;
+                    }
+                    else if (num_alt_alns == 1) {
 #ifdef debug_multipath_alignment
                         cerr << "align right with dozeu with gap " << gap << endl;
 #endif
@@ -6185,7 +6447,8 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
                     pos_t begin_pos = initial_position(path_node.path);
                     
                     
-                    bdsg::HashGraph tail_graph;
+                    tail_graphs.emplace_back();
+                    bdsg::HashGraph& tail_graph = tail_graphs.back();
                     unordered_map<id_t, id_t> tail_trans = algorithms::extract_extending_graph(&align_graph,
                                                                                                &tail_graph,
                                                                                                target_length,
@@ -6228,7 +6491,17 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
                         
                         // align against the graph
                         auto& alt_alignments = left_alignments[j];
-                        if (num_alt_alns == 1) {
+                        if (num_alt_alns == 1 && batch_tails) {
+                            // save it to align exactly along with the other tails
+                            alt_alignments.emplace_back(move(left_tail_sequence));
+                            batch.push_back({&alt_alignments.back(), &tail_graph, false});
+                            size_t removed_length = align_graph.get_length(align_graph.get_handle(id(begin_pos))) - offset(begin_pos);
+                            batch_translations.emplace_back([&alt_alignments, tail_trans, begin_pos, removed_length]() {
+                                translate_node_ids(*alt_alignments.back().mutable_path(), tail_trans, id(begin_pos), removed_length, !is_rev(begin_pos));
+                            });
+                            continue;
+                        }
+                        else if (num_alt_alns == 1) {
 #ifdef debug_multipath_alignment
                             cerr << "align left with dozeu using gap " << gap << endl;
 #endif
@@ -6277,6 +6550,14 @@ void MultipathAlignmentGraph::align(const Alignment& alignment, const HandleGrap
             }
         }
         
+        if (!batch.empty()) {
+            // do all the saved tails at once
+            aligner->align_pinned_batch(batch);
+            for (auto& translate : batch_translations) {
+                translate();
+            }
+        }
+        
         // GSSW does some weird things with N's that we want to normalize away
          if (find(alignment.sequence().begin(), alignment.sequence().end(), 'N') != alignment.sequence().end()) {
              for (bool side : {true, false}) {
@@ -193,11 +193,20 @@ namespace vg {
         /// Note that the output alignment may NOT be in topologically-sorted
         /// order, even if this MultipathAlignmentGraph is. You MUST sort it
         /// with topologically_order_subpaths() before trying to run DP on it.
+        ///
+        /// If batch_tails is set, tails that only need one traceback are
+        /// aligned exactly, all together, instead of with X-drop.
+        ///
+        /// If connection_prune_score_diff is nonnegative, the intervening
+        /// alignments are scored without traceback first, and connections that
+        /// can't be part of an alignment scoring within that much of the best
+        /// one are removed without being traced back.
         void align(const Alignment& alignment, const HandleGraph& align_graph, const GSSWAligner* aligner, bool score_anchors_as_matches,
                    size_t max_alt_alns, bool dynamic_alt_alns, size_t max_gap, double pessimistic_tail_gap_multiplier, bool simplify_topologies,
                    size_t unmergeable_len, size_t band_padding, multipath_alignment_t& multipath_aln_out, SnarlManager* cutting_snarls = nullptr,
                    SnarlDistanceIndex* dist_index = nullptr, const function<pair<id_t, bool>(id_t)>* project = nullptr,
-                   bool allow_negative_scores = false, unordered_map<handle_t, bool>* left_align_strand = nullptr);
+                   bool allow_negative_scores = false, unordered_map<handle_t, bool>* left_align_strand = nullptr,
+                   bool batch_tails = false, int32_t connection_prune_score_diff = -1);
         
         /// Do intervening and tail alignments between the anchoring paths and
         /// store the result in a multipath_alignment_t. Reachability edges must
@@ -211,12 +220,21 @@ namespace vg {
         /// Note that the output alignment may NOT be in topologically-sorted
         /// order, even if this MultipathAlignmentGraph is. You MUST sort it
         /// with topologically_order_subpaths() before trying to run DP on it.
+        ///
+        /// If batch_tails is set, tails that only need one traceback are
+        /// aligned exactly, all together, instead of with X-drop.
+        ///
+        /// If connection_prune_score_diff is nonnegative, the intervening
+        /// alignments are scored without traceback first, and connections that
+        /// can't be part of an alignment scoring within that much of the best
+        /// one are removed without being traced back.
         void align(const Alignment& alignment, const HandleGraph& align_graph, const GSSWAligner* aligner, bool score_anchors_as_matches,
                    size_t max_alt_alns, bool dynamic_alt_alns, size_t max_gap, double pessimistic_tail_gap_multiplier, bool simplify_topologies,
                    size_t unmergeable_len, function<size_t(const Alignment&,const HandleGraph&)> band_padding_function,
                    multipath_alignment_t& multipath_aln_out, SnarlManager* cutting_snarls = nullptr, SnarlDistanceIndex* dist_index = nullptr,
                    const function<pair<id_t, bool>(id_t)>* project = nullptr, bool allow_negative_scores = false,
-                   unordered_map<handle_t, bool>* left_align_strand = nullptr);
+                   unordered_map<handle_t, bool>* left_align_strand = nullptr, bool batch_tails = false,
+                   int32_t connection_prune_score_diff = -1);
         
         /// Converts a MultipathAlignmentGraph to a GraphViz Dot representation, output to the given ostream.
         /// If given the Alignment query we are working on, can produce information about subpath iterators.
@@ -305,6 +323,16 @@ namespace vg {
         vector<pair<size_t, size_t>> get_cut_segments(path_t& path, SnarlManager* cutting_snarls, SnarlDistanceIndex* dist_index,
                                                       const function<pair<id_t, bool>(id_t)>& project, int64_t max_snarl_cut_size) const;
         
+        /// Given the optimal score of the connecting alignment across each edge
+        /// (indexed like the edges, or numeric_limits<int32_t>::min() if there is
+        /// none), and the scores of the anchor subpaths, find the edges that can't
+        /// be on any alignment scoring within prune_score_diff of the best score
+        /// we know is achievable. Bounds the tails by their exact match scores.
+        vector<vector<bool>> prunable_connections(const Alignment& alignment, const GSSWAligner* aligner,
+                                                  const multipath_alignment_t& multipath_aln,
+                                                  const vector<vector<int32_t>>& connection_scores,
+                                                  int32_t prune_score_diff) const;
+        
         /// Generate alignments of the tails of the query sequence, beyond the
         /// sources and sinks. The Alignment passed *must* be the one that owns
         /// the sequence we are working on. Returns a map from tail
@@ -313,11 +341,13 @@ namespace vg {
         /// source subpaths and adds their numbers to the given set if not
         /// null.
         /// If dynamic alignment count is also selected, can indicate a minimum number
-        /// of paths that must be in the extending graph in order to do an alignment
+        /// of paths that must be in the extending graph in order to do an alignment.
+        /// If batch_tails is set, tails with only one alignment are done exactly
+        /// in one batch, instead of one at a time with X-drop.
         unordered_map<bool, unordered_map<size_t, vector<Alignment>>>
         align_tails(const Alignment& alignment, const HandleGraph& align_graph, const GSSWAligner* aligner,
                     size_t max_alt_alns, bool dynamic_alt_alns, size_t max_gap, double pessimistic_tail_gap_multiplier,
-                    size_t min_paths, unordered_set<size_t>* sources = nullptr);
+                    size_t min_paths, unordered_set<size_t>* sources = nullptr, bool batch_tails = false);
         
         /// Removes alignments that follow the same path through the graph, retaining only the
         /// highest scoring ones. If deduplicating leftward, then also removes paths that take a
@@ -360,6 +390,25 @@ namespace vg {
         /// Memo for the transcendental pessimistic tail gap function (thread local to maintain thread-safety)
         static thread_local unordered_map<double, vector<int64_t>> pessimistic_tail_gap_memo;
         
+        /// A snapshot of the reachability edges in compressed sparse row form, so that
+        /// graph algorithms can scan contiguous arrays instead of chasing each node's
+        /// adjacency list. The edges out of node i (or into it, for a reversed table)
+        /// are at indexes offsets[i] through offsets[i + 1] - 1 of the other arrays.
+        struct EdgeTable {
+            vector<size_t> offsets;
+            vector<size_t> targets;
+            vector<size_t> lengths;
+            
+            /// Fill in the table from the adjacency lists, reusing any memory it already has.
+            /// If reverse is set, the table holds the edges into each node instead.
+            void build(const vector<PathNode>& path_nodes, bool reverse = false);
+        };
+        
+        /// Scratch edge tables, kept thread local so that their memory is reused
+        /// across reads rather than reallocated for every cluster
+        static thread_local EdgeTable forward_edge_table;
+        static thread_local EdgeTable reverse_edge_table;
+        
         /// The largest size we will memoize up to
         static const size_t tail_gap_memo_max_size;
     };
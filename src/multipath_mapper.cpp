@@ -18,11 +18,14 @@
 #include <ctime>
 #endif
 
+#include <atomic>
+
 #ifdef debug_check_adapters
 #include "ssw_aligner.hpp"
 #endif
 
 #include "multipath_mapper.hpp"
+#include "splice_site_index.hpp"
 
 #include "multipath_alignment_graph.hpp"
 #include "kmp.hpp"
@@ -38,6 +41,7 @@
 #include "reverse_graph.hpp"
 #include "split_strand_graph.hpp"
 #include "dagified_graph.hpp"
+#include "materialized_overlay.hpp"
 
 #include "algorithms/count_covered.hpp"
 #include "algorithms/extract_containing_graph.hpp"
@@ -58,13 +62,21 @@ namespace vg {
 
     MultipathMapper::MultipathMapper(PathPositionHandleGraph* graph, gcsa::GCSA* gcsa_index, gcsa::LCPArray* lcp_array,
                                      haplo::ScoreProvider* haplo_score_provider, SnarlManager* snarl_manager,
-                                     SnarlDistanceIndex* distance_index) :
+                                     SnarlDistanceIndex* distance_index,
+                                     PathComponentIndex* path_component_index) :
         BaseMapper(graph, gcsa_index, lcp_array, haplo_score_provider),
         snarl_manager(snarl_manager),
         distance_index(distance_index),
-        path_component_index(distance_index ? nullptr : new PathComponentIndex(graph)),
+        path_component_index(path_component_index),
         splice_stats(*get_regular_aligner())
     {
+        if (distance_index) {
+            // we use the distance index instead
+            this->path_component_index.reset();
+        }
+        else if (!path_component_index) {
+            this->path_component_index.reset(new PathComponentIndex(graph));
+        }
         set_max_merge_supression_length();
     }
 
@@ -354,7 +366,21 @@ namespace vg {
     
     vector<MaximalExactMatch> MultipathMapper::find_mems(const Alignment& alignment,
                                                          vector<deque<pair<string::const_iterator, char>>>* mem_fanout_breaks) {
-        if (!use_stripped_match_alg &&
+        if (!lcp && !use_stripped_match_alg) {
+            // the other MEM algorithms need the LCP array, but this one can do without
+            auto mems = find_mems_simple(alignment.sequence().begin(), alignment.sequence().end(),
+                                         0, min_mem_length, mem_reseed_length);
+            for (auto& mem : mems) {
+                mem.primary = true;
+                if (hard_hit_max && mem.match_count >= hard_hit_max) {
+                    // too many hits to be worth querying, same as the other algorithms
+                    mem.nodes.clear();
+                }
+                mem.queried_count = mem.nodes.size();
+            }
+            return mems;
+        }
+        else if (!use_stripped_match_alg &&
             (!use_fanout_match_alg || (use_fanout_match_alg && alignment.quality().empty()))) {
             double dummy1, dummy2;
             return find_mems_deep(alignment.sequence().begin(), alignment.sequence().end(), dummy1, dummy2,
@@ -455,7 +481,7 @@ namespace vg {
 //#pragma omp atomic
 //        SUBGRAPH_TOTAL += cluster_graphs.size();
         
-        // align to each cluster subgraph
+        // decide which cluster subgraphs to align to
         size_t num_mappings = 0;
         for (auto& cluster_graph : cluster_graphs) {
             // if we have a cluster graph with small enough MEM coverage compared to the best one or we've made
@@ -470,18 +496,19 @@ namespace vg {
 //                PRUNE_COUNTER += cluster_graphs.size() - num_mappings;
                 break;
             }
-            
-#ifdef debug_multipath_mapper_alignment
-            cerr << "performing alignment to subgraph with coverage " << get<2>(cluster_graph) << " and multiplicity " << get<1>(cluster_graph).second << endl;
-#endif
-            double multiplicity = cluster_multiplicity(get<1>(cluster_graph));
-            size_t cluster_size = get<1>(cluster_graph).first.size();
-            multipath_alns_out.emplace_back();
-            multipath_align(alignment, cluster_graph, multipath_alns_out.back(), fanouts);
-            multiplicities_out.emplace_back(multiplicity);
+            multiplicities_out.emplace_back(cluster_multiplicity(get<1>(cluster_graph)));
             num_mappings++;
         }
         
+        // align to each of them
+        multipath_alns_out.resize(num_mappings);
+        for_each_cluster_job(num_mappings, [&](size_t i) {
+#ifdef debug_multipath_mapper_alignment
+            cerr << "performing alignment to subgraph with coverage " << get<2>(cluster_graphs[i]) << " and multiplicity " << get<1>(cluster_graphs[i]).second << endl;
+#endif
+            multipath_align(alignment, cluster_graphs[i], multipath_alns_out[i], fanouts);
+        });
+        
         if (!multipath_alns_out.empty()) {
             // find clusters whose likelihoods are approximately the same as the low end of the clusters we aligned
             auto aligner = get_aligner(!alignment.quality().empty());
@@ -555,6 +582,36 @@ namespace vg {
         
     }
     
+    void MultipathMapper::for_each_cluster_job(size_t num_jobs, const function<void(size_t)>& lambda) const {
+        
+        size_t num_workers = min(cluster_threads, num_jobs);
+        if (num_workers <= 1) {
+            for (size_t i = 0; i < num_jobs; ++i) {
+                lambda(i);
+            }
+            return;
+        }
+        
+        // each worker claims the next job until they run out, so slow clusters don't
+        // hold up the others
+        atomic<size_t> next_job(0);
+        auto work = [&]() {
+            for (size_t i = next_job.fetch_add(1); i < num_jobs; i = next_job.fetch_add(1)) {
+                lambda(i);
+            }
+        };
+        
+        // idle threads can pick these up, and otherwise we'll run them ourselves at the taskwait
+        for (size_t i = 1; i < num_workers; ++i) {
+            #pragma omp task shared(work)
+            {
+                work();
+            }
+        }
+        work();
+        #pragma omp taskwait
+    }
+    
     bool MultipathMapper::attempt_unpaired_multipath_map_of_pair(const Alignment& alignment1, const Alignment& alignment2,
                                                                  vector<pair<multipath_alignment_t, multipath_alignment_t>>& multipath_aln_pairs_out,
                                                                  vector<pair<Alignment, Alignment>>& ambiguous_pair_buffer) {
@@ -750,6 +807,13 @@ namespace vg {
             align_dag = dagified.get();
         }
         
+        // optionally copy the overlays out into flat arrays before aligning
+        unique_ptr<MaterializedOverlay> materialized;
+        if (materialize_alignment_graphs) {
+            materialized = unique_ptr<MaterializedOverlay>(new MaterializedOverlay(align_dag));
+            align_dag = materialized.get();
+        }
+        
         // put local alignment here
         Alignment aln = other_aln;
         // in case we're realigning a GAM, get rid of the path and score
@@ -827,8 +891,8 @@ namespace vg {
             
             vector<size_t> backward_dist(jump_positions.size(), search_dist_bwd);
             vector<size_t> forward_dist(jump_positions.size(), search_dist_fwd);
-            algorithms::extract_containing_graph(xindex, rescue_graph, jump_positions, backward_dist, forward_dist,
-                                                 num_alt_alns > 1 ? reversing_walk_length : 0);
+            extract_containing_graph_cached(rescue_graph, jump_positions, backward_dist, forward_dist,
+                                            num_alt_alns > 1 ? reversing_walk_length : 0);
             
         }
         else {
@@ -2644,7 +2708,7 @@ namespace vg {
                                       *get_aligner(!opt.quality().empty()));
         
         splice_regions.emplace_back(new SpliceRegion(get<0>(anchor_pos), searching_left, 2 * max_splice_overhang,
-                                                     *xindex, dinuc_machine, splice_stats));
+                                                     *xindex, dinuc_machine, splice_stats, splice_site_index));
         
         anchor_prejoin_sides.emplace_back();
         anchor_prejoin_sides.front().candidate_idx = -1;
@@ -2692,7 +2756,7 @@ namespace vg {
                                              *get_aligner(!opt.quality().empty()));
             
             splice_regions.emplace_back(new SpliceRegion(get<0>(candidate_pos), !searching_left, 2 * max_splice_overhang,
-                                                         *xindex, dinuc_machine, splice_stats));
+                                                         *xindex, dinuc_machine, splice_stats, splice_site_index));
             
             candidate_prejoin_sides.emplace_back();
             auto& candidate_side = candidate_prejoin_sides.back();
@@ -5273,7 +5337,12 @@ namespace vg {
         // we keep track of where the original occurrence was here
         unordered_map<size_t, size_t> previous_multipath_alns_1, previous_multipath_alns_2;
         
-        // align to each cluster pair
+        // records of (pair index, is read 1) for the alignments we need to do, and of
+        // ((pair index, is read 1), pair index to copy from) for the ones we can copy
+        vector<pair<size_t, bool>> alignment_jobs;
+        vector<pair<pair<size_t, bool>, size_t>> copy_jobs;
+        
+        // choose the cluster pairs to align to
         multipath_aln_pairs_out.reserve(min(num_mappings_to_compute, cluster_pairs.size()));
         size_t num_mappings = 0;
         for (size_t i = 0; i < cluster_pairs.size(); ++i) {
@@ -5306,54 +5375,58 @@ namespace vg {
             pair_multiplicities.push_back(pair_cluster_multiplicity(get<1>(cluster_graphs1[cluster_pair.first.first]),
                                                                     get<1>(cluster_graphs2[cluster_pair.first.second])));
                         
+            // either align each read to its cluster or copy the alignment from an earlier pair that
+            // shares the cluster, once the cluster's alignment is done
             auto prev_1 = previous_multipath_alns_1.find(cluster_pair.first.first);
             if (prev_1 == previous_multipath_alns_1.end()) {
-                // we haven't done this alignment yet, so we have to complete it for the first time
-                
-#ifdef debug_multipath_mapper
-                cerr << "performing alignment of read 1 to subgraph" << endl;
-#endif
-                
-                multipath_align(alignment1, cluster_graphs1[cluster_pair.first.first],
-                                multipath_aln_pairs_out.back().first,
-                                fanouts1);
-                
-                // keep track of the fact that we have completed this multipath alignment
+                alignment_jobs.emplace_back(i, true);
                 previous_multipath_alns_1[cluster_pair.first.first] = i;
             }
             else {
-#ifdef debug_multipath_mapper
-                cerr << "copying alignment from read1 at index " << prev_1->second << endl;
-#endif
-                // we've already completed this multipath alignment, so we can copy it
-                multipath_aln_pairs_out.back().first = multipath_aln_pairs_out[prev_1->second].first;
+                copy_jobs.emplace_back(make_pair(i, true), prev_1->second);
             }
             
-            // repeat this routine for the second read end
-            // TODO: repetitive code
             auto prev_2 = previous_multipath_alns_2.find(cluster_pair.first.second);
             if (prev_2 == previous_multipath_alns_2.end()) {
-                // we haven't done this alignment yet, so we have to complete it for the first time
-                
+                alignment_jobs.emplace_back(i, false);
+                previous_multipath_alns_2[cluster_pair.first.second] = i;
+            }
+            else {
+                copy_jobs.emplace_back(make_pair(i, false), prev_2->second);
+            }
+            
+            num_mappings++;
+        }
+        
+        // do the alignments
+        for_each_cluster_job(alignment_jobs.size(), [&](size_t j) {
+            size_t i = alignment_jobs[j].first;
+            const pair<size_t, size_t>& cluster_idxs = cluster_pairs[i].first;
+            if (alignment_jobs[j].second) {
 #ifdef debug_multipath_mapper
-                cerr << "performing alignment of read 2 to subgraph" << endl;
+                cerr << "performing alignment of read 1 to subgraph " << cluster_idxs.first << endl;
 #endif
-                
-                multipath_align(alignment2, cluster_graphs2[cluster_pair.first.second],
-                                multipath_aln_pairs_out.back().second, fanouts2);
-                
-                // keep track of the fact that we have completed this multipath alignment
-                previous_multipath_alns_2[cluster_pair.first.second] = i;
+                multipath_align(alignment1, cluster_graphs1[cluster_idxs.first], multipath_aln_pairs_out[i].first,
+                                fanouts1);
             }
             else {
 #ifdef debug_multipath_mapper
-                cerr << "copying alignment from read2 at index " << prev_2->second << endl;
+                cerr << "performing alignment of read 2 to subgraph " << cluster_idxs.second << endl;
 #endif
-                // we've already completed this multipath alignment, so we can copy it
-                multipath_aln_pairs_out.back().second = multipath_aln_pairs_out[prev_2->second].second;
+                multipath_align(alignment2, cluster_graphs2[cluster_idxs.second], multipath_aln_pairs_out[i].second,
+                                fanouts2);
+            }
+        });
+        
+        // we've already completed these multipath alignments, so we can copy them
+        for (const auto& copy_job : copy_jobs) {
+            size_t i = copy_job.first.first;
+            if (copy_job.first.second) {
+                multipath_aln_pairs_out[i].first = multipath_aln_pairs_out[copy_job.second].first;
+            }
+            else {
+                multipath_aln_pairs_out[i].second = multipath_aln_pairs_out[copy_job.second].second;
             }
-            
-            num_mappings++;
         }
         
         if (!multipath_aln_pairs_out.empty()) {
@@ -5496,8 +5569,8 @@ namespace vg {
         
         unique_ptr<bdsg::HashGraph> cluster_graph(new bdsg::HashGraph());
         
-        algorithms::extract_containing_graph(xindex, cluster_graph.get(), positions, forward_max_dist, backward_max_dist,
-                                             num_alt_alns > 1 ? reversing_walk_length : 0);
+        extract_containing_graph_cached(cluster_graph.get(), positions, forward_max_dist, backward_max_dist,
+                                        num_alt_alns > 1 ? reversing_walk_length : 0);
         
         return move(make_pair(move(cluster_graph), cluster.size() == 1));
     }
@@ -5520,6 +5593,42 @@ namespace vg {
         return gap_length;
     }
 
+    thread_local map<MultipathMapper::extraction_key_t, bdsg::HashGraph> MultipathMapper::extraction_cache;
+    void MultipathMapper::extract_containing_graph_cached(MutableHandleGraph* into, const vector<pos_t>& positions,
+                                                          const vector<size_t>& forward_max_dist,
+                                                          const vector<size_t>& backward_max_dist,
+                                                          size_t reversing_walk_length) const {
+        if (max_extraction_cache_size == 0) {
+            algorithms::extract_containing_graph(xindex, into, positions, forward_max_dist, backward_max_dist,
+                                                 reversing_walk_length);
+            return;
+        }
+        
+        extraction_key_t key;
+        get<0>(key) = xindex;
+        get<1>(key) = reversing_walk_length;
+        get<2>(key).reserve(positions.size());
+        for (size_t i = 0; i < positions.size(); ++i) {
+            get<2>(key).emplace_back(id(positions[i]), is_rev(positions[i]), offset(positions[i]),
+                                     forward_max_dist.at(i), backward_max_dist.at(i));
+        }
+        
+        auto it = extraction_cache.find(key);
+        if (it == extraction_cache.end()) {
+            if (extraction_cache.size() >= max_extraction_cache_size) {
+                // we've moved on to other reads, most likely
+                extraction_cache.clear();
+            }
+            it = extraction_cache.emplace(move(key), bdsg::HashGraph()).first;
+            algorithms::extract_containing_graph(xindex, &it->second, positions, forward_max_dist, backward_max_dist,
+                                                 reversing_walk_length);
+        }
+        
+        // we copy even after a fresh extraction, so that the node order doesn't depend on whether
+        // there was a cache hit
+        handlealgs::copy_handle_graph(&it->second, into);
+    }
+
     pair<unique_ptr<bdsg::HashGraph>, bool> MultipathMapper::extract_restrained_graph(const Alignment& alignment,
                                                                                       const memcluster_t& mem_cluster) const {
         
@@ -5597,8 +5706,8 @@ namespace vg {
             cluster_graph = unique_ptr<bdsg::HashGraph>(new bdsg::HashGraph());
             
             // extract according to the current search distances
-            algorithms::extract_containing_graph(xindex, cluster_graph.get(), positions, forward_dist, backward_dist,
-                                                 num_alt_alns > 1 ? reversing_walk_length : 0);
+            extract_containing_graph_cached(cluster_graph.get(), positions, forward_dist, backward_dist,
+                                            num_alt_alns > 1 ? reversing_walk_length : 0);
             
             // we can avoid a costly algorithm when the cluster was extracted from one position (and therefore
             // must be connected)
@@ -6135,6 +6244,14 @@ namespace vg {
                 align_dag = dagified.get();
             }
             
+            // optionally copy the overlays out into flat arrays, so that tail and connection
+            // alignment don't translate through them on every step
+            unique_ptr<MaterializedOverlay> materialized;
+            if (materialize_alignment_graphs) {
+                materialized = unique_ptr<MaterializedOverlay>(new MaterializedOverlay(align_dag));
+                align_dag = materialized.get();
+            }
+            
             // a function to translate from the transformed graphs ID space to the original graph's
             function<pair<id_t, bool>(id_t)> translator = [&](const id_t node_id) {
                 handle_t original = align_digraph->get_underlying_handle(align_dag->get_underlying_handle(align_dag->get_handle(node_id)));
@@ -6258,7 +6375,8 @@ namespace vg {
             multi_aln_graph.align(alignment, *align_dag, aligner, true, num_alt_alns, dynamic_max_alt_alns, max_alignment_gap,
                                   use_pessimistic_tail_alignment ? pessimistic_gap_multiplier : 0.0, simplify_topologies,
                                   max_tail_merge_supress_length, choose_band_padding, multipath_aln_out, snarl_manager,
-                                  distance_index, &translator);
+                                  distance_index, &translator, false, nullptr, batch_tail_alignment,
+                                  connection_prune_score_diff);
             
             // Note that we do NOT topologically order the multipath_alignment_t. The
             // caller has to do that, after it is finished breaking it up into
@@ -6314,7 +6432,8 @@ namespace vg {
         // do the connecting alignments and fill out the multipath_alignment_t object
         multi_aln_graph.align(alignment, subgraph, aligner, false, num_alt_alns, dynamic_max_alt_alns, max_alignment_gap,
                               use_pessimistic_tail_alignment ? pessimistic_gap_multiplier : 0.0, simplify_topologies,
-                              max_tail_merge_supress_length, choose_band_padding, multipath_aln_out);
+                              max_tail_merge_supress_length, choose_band_padding, multipath_aln_out, nullptr, nullptr,
+                              nullptr, false, nullptr, batch_tail_alignment, connection_prune_score_diff);
         
         for (size_t j = 0; j < multipath_aln_out.subpath_size(); j++) {
             translate_oriented_node_ids(*multipath_aln_out.mutable_subpath(j)->mutable_path(), translator);
@@ -7407,6 +7526,14 @@ namespace vg {
         splice_stats.update_intron_length_distribution(intron_mixture_weights, intron_component_params, *get_aligner());
     }
 
+    void MultipathMapper::set_splice_site_index(const SpliceSiteIndex* index) {
+        if (index && !index->covers(splice_stats)) {
+            cerr << "error:[MultipathMapper] splice site index does not contain all of the splice motifs" << endl;
+            exit(1);
+        }
+        splice_site_index = index;
+    }
+    
     void MultipathMapper::set_max_merge_supression_length() {
         max_tail_merge_supress_length = ceil(double(get_regular_aligner()->match) / double(get_regular_aligner()->mismatch));
     }
@@ -42,9 +42,12 @@ namespace vg {
         // Interface
         ////////////////////////////////////////////////////////////////////////
     
+        /// If no distance index is given, the mapper takes ownership of the
+        /// path component index, or builds one if that is null too.
         MultipathMapper(PathPositionHandleGraph* graph, gcsa::GCSA* gcsa_index, gcsa::LCPArray* lcp_array,
                         haplo::ScoreProvider* haplo_score_provider = nullptr, SnarlManager* snarl_manager = nullptr,
-                        SnarlDistanceIndex* distance_index = nullptr);
+                        SnarlDistanceIndex* distance_index = nullptr,
+                        PathComponentIndex* path_component_index = nullptr);
         ~MultipathMapper();
         
         /// Map read in alignment to graph and make multipath alignments.
@@ -97,6 +100,10 @@ namespace vg {
         void set_intron_length_distribution(const vector<double>& intron_mixture_weights,
                                             const vector<pair<double, double>>& intron_component_params);
         
+        /// Look up candidate splice sites in an index of the graph instead of searching
+        /// for them. Exits with an error if the index is missing any of the splice motifs.
+        void set_splice_site_index(const SpliceSiteIndex* index);
+        
         /// Decide how long of a tail alignment we want before we allow its subpath to be merged
         void set_max_merge_supression_length();
         
@@ -118,14 +125,19 @@ namespace vg {
         double band_padding_multiplier = 1.0;
         bool use_pessimistic_tail_alignment = false;
         double pessimistic_gap_multiplier = 0.0;
+        bool batch_tail_alignment = false;
+        int32_t connection_prune_score_diff = -1;
         bool restrained_graph_extraction = false;
         size_t max_expected_dist_approx_error = 8;
         int32_t num_alt_alns = 4;
         size_t max_dagify_duplications = 10;
+        // copy the strand-split and dagified overlays into flat arrays before aligning to them
+        bool materialize_alignment_graphs = false;
         double mem_coverage_min_ratio = 0.5;
         double truncation_multiplicity_mq_limit = 7.0;
         double max_suboptimal_path_score_ratio = 2.0;
         size_t num_mapping_attempts = 48;
+        size_t cluster_threads = 1;
         double log_likelihood_approx_factor = 1.0;
         size_t min_clustering_mem_length = 0;
         bool use_stripped_match_alg = false;
@@ -136,6 +148,7 @@ namespace vg {
         int max_fanout_base_quality = 20;
         int max_fans_out = 5;
         size_t max_p_value_memo_size = 500;
+        size_t max_extraction_cache_size = 32;
         size_t band_padding_memo_size = 2000;
         double max_exponential_rate_intercept = 0.612045;
         double max_exponential_rate_slope = 0.000555181;
@@ -527,6 +540,11 @@ namespace vg {
                                               vector<double>& pair_multiplicities_out) const;
         
 
+        /// Call the function on each of the given number of independent cluster alignment jobs,
+        /// using up to cluster_threads OpenMP tasks at once. Each job must write only its own
+        /// results, so that the output doesn't depend on the threads.
+        void for_each_cluster_job(size_t num_jobs, const function<void(size_t)>& lambda) const;
+
         /// Make a multipath alignment of the read against the indicated graph and add it to
         /// the list of multimappings.
         /// Does NOT necessarily produce a multipath_alignment_t in topological order.
@@ -650,6 +668,15 @@ namespace vg {
         
         /// A restrained estimate of the amount of gap we would like to align for a read tail
         int64_t pessimistic_gap(int64_t length, double multiplier) const;
+        
+        /// Extract the containing graph of the positions from the index graph, as with
+        /// algorithms::extract_containing_graph(), but copy it from an identical earlier
+        /// extraction on this thread if there was one. Mates and overlapping clusters
+        /// often ask for the same region.
+        void extract_containing_graph_cached(MutableHandleGraph* into, const vector<pos_t>& positions,
+                                             const vector<size_t>& forward_max_dist,
+                                             const vector<size_t>& backward_max_dist,
+                                             size_t reversing_walk_length) const;
 
         /// Return exact matches according to the object's parameters
         /// If using the fan-out algorithm, we can optionally leave fan-out MEMs in tact and
@@ -672,6 +699,7 @@ namespace vg {
         
         DinucleotideMachine dinuc_machine;
         SpliceStats splice_stats;
+        const SpliceSiteIndex* splice_site_index = nullptr;
         SnarlManager* snarl_manager;
         SnarlDistanceIndex* distance_index;
         unique_ptr<PathComponentIndex> path_component_index;
@@ -688,6 +716,12 @@ namespace vg {
         static thread_local unordered_map<double, vector<int64_t>> pessimistic_gap_memo;
         static const size_t gap_memo_max_size;
         
+        // recently extracted subgraphs of the index, keyed by the graph and each search's
+        // (position, forward distance, backward distance) and reversing walk length
+        // (thread local to maintain threadsafety)
+        typedef tuple<const HandleGraph*, size_t, vector<tuple<id_t, bool, size_t, size_t, size_t>>> extraction_key_t;
+        static thread_local map<extraction_key_t, bdsg::HashGraph> extraction_cache;
+        
         // a memo for transcendental band padidng function (gets initialized at construction)
         vector<size_t> band_padding_memo;
         
@@ -0,0 +1,127 @@
+/**
+ * \file ordered_alignment_emitter.cpp
+ * Implementation for OrderedAlignmentEmitter
+ */
+
+
+#include "ordered_alignment_emitter.hpp"
+
+#include <omp.h>
+
+namespace vg {
+
+using namespace std;
+
+OrderedAlignmentEmitter::OrderedAlignmentEmitter(unique_ptr<AlignmentEmitter>&& backing, size_t max_threads) :
+    backing(std::move(backing)), threads(max_threads) {
+
+    writer = thread([this]() {
+        write_in_order();
+    });
+}
+
+OrderedAlignmentEmitter::~OrderedAlignmentEmitter() {
+    {
+        lock_guard<mutex> lock(state_mutex);
+        stopping = true;
+    }
+    read_finished.notify_all();
+    writer.join();
+}
+
+void OrderedAlignmentEmitter::wait_for_room(size_t number, size_t window) {
+    while (true) {
+        {
+            lock_guard<mutex> lock(state_mutex);
+            if (number < next_to_write + window) {
+                return;
+            }
+        }
+        // Help map the reads we are waiting on, or at least get out of the
+        // way of the threads that are.
+        #pragma omp taskyield
+        this_thread::yield();
+    }
+}
+
+void OrderedAlignmentEmitter::start_read(size_t number) {
+    ThreadState& state = threads.at(omp_get_thread_num());
+    state.number = number;
+    state.active = true;
+}
+
+void OrderedAlignmentEmitter::finish_read() {
+    ThreadState& state = threads.at(omp_get_thread_num());
+    if (!state.active) {
+        throw runtime_error("error[vg::OrderedAlignmentEmitter]: read finished without being started");
+    }
+    state.active = false;
+    {
+        lock_guard<mutex> lock(state_mutex);
+        finished.emplace(state.number, std::move(state.outputs));
+    }
+    state.outputs.clear();
+    read_finished.notify_one();
+}
+
+void OrderedAlignmentEmitter::hold(Output&& output) {
+    ThreadState& state = threads.at(omp_get_thread_num());
+    if (!state.active) {
+        throw runtime_error("error[vg::OrderedAlignmentEmitter]: alignments emitted outside of a read");
+    }
+    state.outputs.emplace_back(std::move(output));
+}
+
+void OrderedAlignmentEmitter::write_in_order() {
+    unique_lock<mutex> lock(state_mutex);
+    while (true) {
+        read_finished.wait(lock, [&]() {
+            return stopping || (!finished.empty() && finished.begin()->first == next_to_write);
+        });
+        if (finished.empty()) {
+            // We must be stopping, and everything is written.
+            break;
+        }
+        // Take the next read in order, or when stopping, whatever is left in
+        // order even if some numbers never turned up.
+        size_t number = finished.begin()->first;
+        vector<Output> outputs = std::move(finished.begin()->second);
+        finished.erase(finished.begin());
+
+        lock.unlock();
+        for (Output& output : outputs) {
+            output(*backing);
+        }
+        lock.lock();
+
+        next_to_write = number + 1;
+    }
+}
+
+void OrderedAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
+    hold([aln_batch = std::move(aln_batch)](AlignmentEmitter& backing) mutable {
+        backing.emit_singles(std::move(aln_batch));
+    });
+}
+
+void OrderedAlignmentEmitter::emit_mapped_singles(vector<vector<Alignment>>&& alns_batch) {
+    hold([alns_batch = std::move(alns_batch)](AlignmentEmitter& backing) mutable {
+        backing.emit_mapped_singles(std::move(alns_batch));
+    });
+}
+
+void OrderedAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch, vector<int64_t>&& tlen_limit_batch) {
+    hold([aln1_batch = std::move(aln1_batch), aln2_batch = std::move(aln2_batch),
+          tlen_limit_batch = std::move(tlen_limit_batch)](AlignmentEmitter& backing) mutable {
+        backing.emit_pairs(std::move(aln1_batch), std::move(aln2_batch), std::move(tlen_limit_batch));
+    });
+}
+
+void OrderedAlignmentEmitter::emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch, vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch) {
+    hold([alns1_batch = std::move(alns1_batch), alns2_batch = std::move(alns2_batch),
+          tlen_limit_batch = std::move(tlen_limit_batch)](AlignmentEmitter& backing) mutable {
+        backing.emit_mapped_pairs(std::move(alns1_batch), std::move(alns2_batch), std::move(tlen_limit_batch));
+    });
+}
+
+}
@@ -0,0 +1,118 @@
+#ifndef VG_ORDERED_ALIGNMENT_EMITTER_HPP_INCLUDED
+#define VG_ORDERED_ALIGNMENT_EMITTER_HPP_INCLUDED
+
+/** \file
+ *
+ * Holds an AlignmentEmitter wrapper that writes alignments in input order.
+ */
+
+
+#include "vg/io/alignment_emitter.hpp"
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * An AlignmentEmitter implementation that holds on to what is emitted for
+ * each read until everything emitted for all earlier reads in the input has
+ * been passed on to a backing AlignmentEmitter, which it owns. The output then
+ * comes out in input order no matter how many threads are mapping.
+ *
+ * Mapping threads say which read they are working on with start_read() and
+ * finish_read(), counting reads (or pairs) from 0 in input order. Every number
+ * must be finished exactly once, even if nothing is emitted for it. The
+ * thread reading the input should call wait_for_room() before each read, so
+ * that a slow read can only hold up a bounded number of finished ones.
+ *
+ * The backing emitter is only ever called from one background thread, so
+ * the order in which it gets batches is the order they end up in.
+ */
+class OrderedAlignmentEmitter : public vg::io::AlignmentEmitter {
+public:
+
+    /**
+     * Make an emitter that emits to the given backing AlignmentEmitter, in
+     * order, and expects to be called from up to max_threads OMP threads.
+     * Takes ownership of the AlignmentEmitter.
+     */
+    OrderedAlignmentEmitter(unique_ptr<AlignmentEmitter>&& backing, size_t max_threads);
+
+    /// Write out everything that is left, in order, and stop the writer.
+    ~OrderedAlignmentEmitter();
+
+    /// Wait until the read with the given number is less than window reads
+    /// ahead of the first read that has not been written yet. Runs OpenMP
+    /// tasks while waiting, so it is safe to call from a thread that also
+    /// generates the tasks doing the mapping. window must be at least the
+    /// number of reads that can be read without being made available to
+    /// other threads.
+    void wait_for_room(size_t number, size_t window);
+
+    /// Say that the calling thread is now working on the read with the given
+    /// number. Everything it emits until finish_read() belongs to that read.
+    void start_read(size_t number);
+
+    /// Say that the calling thread is done with its read. What it emitted is
+    /// written once all earlier reads have been.
+    void finish_read();
+
+    /// Emit a batch of Alignments
+    virtual void emit_singles(vector<Alignment>&& aln_batch);
+    /// Emit batch of Alignments with secondaries. All secondaries must have is_secondary set already.
+    virtual void emit_mapped_singles(vector<vector<Alignment>>&& alns_batch);
+    /// Emit a batch of pairs of Alignments.
+    virtual void emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch,
+        vector<int64_t>&& tlen_limit_batch);
+    /// Emit the mappings of a batch of pairs of Alignments. All secondaries
+    /// must have is_secondary set already.
+    virtual void emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch,
+        vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch);
+
+protected:
+
+    /// Something emitted for a read, to be replayed on the backing emitter.
+    using Output = function<void(AlignmentEmitter&)>;
+
+    /// What each thread is working on.
+    struct ThreadState {
+        size_t number = 0;
+        bool active = false;
+        vector<Output> outputs;
+    };
+
+    /// Record output for the calling thread's read.
+    void hold(Output&& output);
+
+    /// Run on the writer thread: pass outputs to the backing emitter in order.
+    void write_in_order();
+
+    /// AlignmentEmitter to emit to once in order
+    unique_ptr<AlignmentEmitter> backing;
+
+    vector<ThreadState> threads;
+
+    /// Protects everything below
+    mutex state_mutex;
+    /// Signaled when a read is finished, or when we are stopping
+    condition_variable read_finished;
+    /// Reads that are finished but not written yet, by number
+    map<size_t, vector<Output>> finished;
+    /// Number of the first read that has not been written
+    size_t next_to_write = 0;
+    bool stopping = false;
+
+    thread writer;
+};
+
+}
+
+#endif
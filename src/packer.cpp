@@ -1,4 +1,9 @@
 #include <thread>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vg/io/protobuf_iterator.hpp>
 #include "packer.hpp"
 #include "statistics.hpp"
@@ -11,6 +16,8 @@ namespace vg {
 
 const int Packer::maximum_quality = 60;
 const int Packer::lru_cache_size = 4096;
+const size_t Packer::max_edit_buffer_bytes = 1 << 20;
+const char Packer::mapped_magic[8] = {'V', 'G', 'P', 'K', 'M', 'A', 'P', '1'};
 
 size_t Packer::estimate_data_width(size_t expected_coverage) {
     return std::ceil(std::log2(2 * expected_coverage));
@@ -95,6 +102,9 @@ Packer::Packer(const HandleGraph* graph, bool record_bases, bool record_edges, b
         tmpfstream_locks = new std::mutex[n_bins];
         // open tmpfile if needed
         ensure_edit_tmpfiles_open();
+        // buffer edits in memory so threads take each bin's lock once per batch
+        edit_buffers.resize(get_thread_count());
+        edit_buffer_bytes.resize(get_thread_count(), 0);
     }
 
     // speed up quality computation if necessary
@@ -107,6 +117,14 @@ Packer::Packer(const HandleGraph* graph, bool record_bases, bool record_edges, b
 #endif
 }
 
+void Packer::use_atomic_counters() {
+    assert(!is_compacted);
+    atomic_counters = true;
+    vector<std::atomic<uint32_t>>(record_bases ? num_bases_dynamic : 0).swap(coverage_atomic);
+    vector<std::atomic<uint32_t>>(record_edges ? num_edges_dynamic : 0).swap(edge_coverage_atomic);
+    vector<std::atomic<uint64_t>>(record_qualities ? num_nodes_dynamic : 0).swap(node_quality_atomic);
+}
+
 void Packer::clear() {
     for (auto& counter : coverage_dynamic) {
         delete counter;
@@ -120,20 +138,30 @@ void Packer::clear() {
         delete counter;
         counter = nullptr;
     }
+    vector<std::atomic<uint32_t>>().swap(coverage_atomic);
+    vector<std::atomic<uint32_t>>().swap(edge_coverage_atomic);
+    vector<std::atomic<uint64_t>>().swap(node_quality_atomic);
     delete [] base_locks;
     base_locks = nullptr;
     delete [] edge_locks;
     edge_locks = nullptr;
     delete [] node_quality_locks;
     node_quality_locks = nullptr;
-    delete [] tmpfstream_locks;
-    tmpfstream_locks = nullptr;
     close_edit_tmpfiles();
     remove_edit_tmpfiles();
+    delete [] tmpfstream_locks;
+    tmpfstream_locks = nullptr;
     for (auto& lru_cache : quality_cache) {
         delete lru_cache;
         lru_cache = nullptr;
     }
+    if (mapped_data != nullptr) {
+        munmap(mapped_data, mapped_length);
+        mapped_data = nullptr;
+        mapped_coverage = nullptr;
+        mapped_edge_coverage = nullptr;
+        mapped_node_quality = nullptr;
+    }
 }
 
 Packer::~Packer() {
@@ -147,6 +175,14 @@ void Packer::load_from_file(const string& file_name) {
         ss << "Error [Packer]: unable to read pack file: \"" << file_name << "\"" << endl;
         throw runtime_error(ss.str());
     }
+    char magic[sizeof(mapped_magic)];
+    if (in.read(magic, sizeof(magic)) && memcmp(magic, mapped_magic, sizeof(magic)) == 0) {
+        in.close();
+        load_mapped_file(file_name);
+        return;
+    }
+    in.clear();
+    in.seekg(0);
     load(in);
 }
 
@@ -155,6 +191,75 @@ void Packer::save_to_file(const string& file_name) {
     serialize(out);
 }
 
+void Packer::save_mapped_to_file(const string& file_name) {
+    make_compact();
+    ofstream out(file_name, std::ios_base::binary);
+    if (!out) {
+        stringstream ss;
+        ss << "Error [Packer]: unable to write pack file: \"" << file_name << "\"" << endl;
+        throw runtime_error(ss.str());
+    }
+    // header: magic, then the lengths of the three arrays, which follow it in order
+    uint64_t lengths[3] = {coverage_size(), edge_vector_size(), node_quality_vector_size()};
+    out.write(mapped_magic, sizeof(mapped_magic));
+    out.write((const char*) lengths, sizeof(lengths));
+    auto write_values = [&](size_t length, const function<size_t(size_t)>& get_value) {
+        vector<uint32_t> buffer;
+        buffer.reserve(min(length, (size_t) 1 << 16));
+        for (size_t i = 0; i < length; ++i) {
+            buffer.push_back(min(get_value(i), (size_t) numeric_limits<uint32_t>::max()));
+            if (buffer.size() == buffer.capacity() || i + 1 == length) {
+                out.write((const char*) buffer.data(), buffer.size() * sizeof(uint32_t));
+                buffer.clear();
+            }
+        }
+    };
+    write_values(lengths[0], [&](size_t i) { return coverage_at_position(i); });
+    write_values(lengths[1], [&](size_t i) { return edge_coverage(i); });
+    write_values(lengths[2], [&](size_t i) { return average_node_quality(i); });
+}
+
+void Packer::load_mapped_file(const string& file_name) {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    struct stat file_stats;
+    if (fd < 0 || fstat(fd, &file_stats) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        stringstream ss;
+        ss << "Error [Packer]: unable to read pack file: \"" << file_name << "\"" << endl;
+        throw runtime_error(ss.str());
+    }
+    size_t header_length = sizeof(mapped_magic) + 3 * sizeof(uint64_t);
+    mapped_length = file_stats.st_size;
+    mapped_data = mapped_length >= header_length ? mmap(nullptr, mapped_length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapped_data == MAP_FAILED) {
+        mapped_data = nullptr;
+        stringstream ss;
+        ss << "Error [Packer]: unable to map pack file: \"" << file_name << "\"" << endl;
+        throw runtime_error(ss.str());
+    }
+    const uint64_t* lengths = (const uint64_t*) ((const char*) mapped_data + sizeof(mapped_magic));
+    mapped_num_bases = lengths[0];
+    mapped_num_edges = lengths[1];
+    mapped_num_nodes = lengths[2];
+    if (header_length + (mapped_num_bases + mapped_num_edges + mapped_num_nodes) * sizeof(uint32_t) != mapped_length) {
+        stringstream ss;
+        ss << "Error [Packer]: pack file is truncated or corrupt: \"" << file_name << "\"" << endl;
+        throw runtime_error(ss.str());
+    }
+    mapped_coverage = (const uint32_t*) ((const char*) mapped_data + header_length);
+    mapped_edge_coverage = mapped_coverage + mapped_num_bases;
+    mapped_node_quality = mapped_edge_coverage + mapped_num_edges;
+    // lookups are scattered along the graph
+    madvise(mapped_data, mapped_length, MADV_RANDOM);
+    // there are no edits in this layout
+    bin_size = 0;
+    n_bins = 0;
+    is_compacted = true;
+}
+
 void Packer::load(istream& in) {
     sdsl::read_member(bin_size, in);
     sdsl::read_member(n_bins, in);
@@ -283,10 +388,11 @@ void Packer::collect_coverage(const vector<Packer*>& packers) {
     }
     if (record_qualities) {
 #pragma omp parallel for
-        for (size_t i = 1; i < node_quality_dynamic.size(); ++i) {
+        for (size_t i = 0; i < node_quality_dynamic.size(); ++i) {
             size_t qual_base_offset = i * node_qual_bin_size;
             size_t qual_bin_size = node_quality_bin_size(i);
-            for (size_t j = 0; j < qual_bin_size; ++j) {
+            // node ranks are 1-based, so skip the unused 0 slot
+            for (size_t j = (i == 0 ? 1 : 0); j < qual_bin_size; ++j) {
                 size_t inc_qual_cov = 0;
                 for (size_t k = 0; k < packers.size(); ++k) {
                     inc_qual_cov += packers[k]->total_node_quality(j + qual_base_offset);
@@ -401,6 +507,10 @@ void Packer::make_compact(void) {
     // construct the record marker bitvector
     remove_edit_tmpfiles();
     is_compacted = true;
+    // the flat counters are now redundant
+    vector<std::atomic<uint32_t>>().swap(coverage_atomic);
+    vector<std::atomic<uint32_t>>().swap(edge_coverage_atomic);
+    vector<std::atomic<uint64_t>>().swap(node_quality_atomic);
 }
 
 void Packer::make_dynamic(void) {
@@ -435,8 +545,43 @@ void Packer::ensure_edit_tmpfiles_open(void) {
     }
 }
 
+void Packer::buffer_edit(size_t bin, string&& record) {
+    size_t thread = omp_get_thread_num();
+    if (thread >= edit_buffers.size()) {
+        // more threads than we planned for, so go straight to the file
+        std::lock_guard<std::mutex> guard(tmpfstream_locks[bin]);
+        *tmpfstreams[bin] << record;
+        return;
+    }
+    edit_buffer_bytes[thread] += record.size();
+    edit_buffers[thread].emplace_back(bin, std::move(record));
+    if (edit_buffer_bytes[thread] >= max_edit_buffer_bytes) {
+        flush_edit_buffer(thread);
+    }
+}
+
+void Packer::flush_edit_buffer(size_t thread) {
+    auto& buffer = edit_buffers[thread];
+    // group the records by bin so we only need to lock each bin once
+    std::stable_sort(buffer.begin(), buffer.end(), [](const pair<size_t, string>& a, const pair<size_t, string>& b) {
+        return a.first < b.first;
+    });
+    for (size_t i = 0; i < buffer.size();) {
+        size_t bin = buffer[i].first;
+        std::lock_guard<std::mutex> guard(tmpfstream_locks[bin]);
+        for (; i < buffer.size() && buffer[i].first == bin; ++i) {
+            *tmpfstreams[bin] << buffer[i].second;
+        }
+    }
+    buffer.clear();
+    edit_buffer_bytes[thread] = 0;
+}
+
 void Packer::close_edit_tmpfiles(void) {
     if (!tmpfstreams.empty()) {
+        for (size_t i = 0; i < edit_buffers.size(); ++i) {
+            flush_edit_buffer(i);
+        }
         for (auto& tmpfstream : tmpfstreams) {
             *tmpfstream << delim1; // pad
             tmpfstream->close();
@@ -526,9 +671,7 @@ void Packer::add(const Alignment& aln, int min_mapq, int min_baseq, int trim_end
                     // we represent things on the forward strand
                     string pos_repr = pos_key(i);
                     string edit_repr = edit_value(edit, mapping.position().is_reverse());
-                    size_t bin = bin_for_position(i);
-                    std::lock_guard<std::mutex> guard(tmpfstream_locks[bin]);
-                    *tmpfstreams[bin] << pos_repr << edit_repr;
+                    buffer_edit(bin_for_position(i), pos_repr + edit_repr);
                 } 
                 if (mapping.position().is_reverse()) {
                     i -= edit.from_length();
@@ -580,6 +723,158 @@ void Packer::add(const Alignment& aln, int min_mapq, int min_baseq, int trim_end
     }
 }
 
+void Packer::add(const GAFRecordView& record, int min_mapq, int min_baseq, int trim_ends) {
+    // mapping quality threshold filter
+    int64_t mapping_quality;
+    if (!record.fields[11].to_int(mapping_quality) || mapping_quality < min_mapq) {
+        return;
+    }
+    int64_t query_length, query_start, path_start, path_end;
+    if (!record.fields[1].to_int(query_length) || !record.fields[2].to_int(query_start) ||
+        !record.fields[7].to_int(path_start) || !record.fields[8].to_int(path_end)) {
+        // unmapped
+        return;
+    }
+    vector<pair<nid_t, bool>> nodes;
+    record.for_each_node([&](id_t id, bool is_reverse) {
+        nodes.emplace_back(id, is_reverse);
+        return true;
+    });
+    if (nodes.empty()) {
+        return;
+    }
+    GAFRecordView::Field cs;
+    bool has_cs = record.find_tag("cs", cs);
+
+    // we count in the read's own coordinates, so the clipped bases are trimmed too
+    size_t position_in_read = query_start;
+    size_t read_length = query_length;
+    size_t trim_last = read_length + 1 < trim_ends ? 0 : read_length - trim_ends - 1;
+
+    // where we are on the path
+    size_t node_rank = 0;
+    size_t node_length = 0;
+    size_t offset = path_start;
+    // the basis position of the next base
+    size_t i = 0;
+    size_t node_quality_index = 0;
+    size_t total_node_quality = 0;
+
+    // move on to the given node of the path. returns false if it is outside
+    // of our graph, which may be a subgraph, since then we can't tell where
+    // the rest of the path goes
+    auto enter_node = [&](size_t rank) {
+        if (total_node_quality > 0) {
+            increment_node_quality(node_quality_index, total_node_quality);
+            total_node_quality = 0;
+        }
+        nid_t id = nodes[rank].first;
+        bool is_reverse = nodes[rank].second;
+        if (!graph->has_node(id)) {
+            return false;
+        }
+        node_length = graph->get_length(graph->get_handle(id));
+        Position pos;
+        pos.set_node_id(id);
+        pos.set_is_reverse(is_reverse);
+        pos.set_offset(offset);
+        i = position_in_basis(pos);
+        node_quality_index = node_index(id);
+        if (record_edges && rank > 0 && nodes[rank - 1].first != id &&
+            (trim_ends == 0 || (position_in_read - 1 >= trim_ends && position_in_read <= trim_last))) {
+            Edge e;
+            e.set_from(nodes[rank - 1].first);
+            e.set_from_start(nodes[rank - 1].second);
+            e.set_to(id);
+            e.set_to_end(is_reverse);
+            size_t edge_idx = edge_index(e);
+            if (edge_idx != 0) {
+                // there are no base qualities to filter on
+                increment_edge_coverage(edge_idx);
+            }
+        }
+        return true;
+    };
+
+    // walk along the path through the given number of graph bases, which are
+    // matches if is_match is set and are aligned to read bases if is_aligned
+    // is set. returns false if we can't go on.
+    auto walk = [&](size_t length, bool is_match, bool is_aligned) {
+        while (length > 0) {
+            if (offset >= node_length) {
+                if (node_rank + 1 >= nodes.size()) {
+                    // the cs string runs off the end of the path
+                    return false;
+                }
+                offset -= node_length;
+                if (!enter_node(++node_rank)) {
+                    return false;
+                }
+            }
+            size_t step = min(length, node_length - offset);
+            int64_t direction = nodes[node_rank].second ? -1 : 1;
+            for (size_t j = 0; j < step; ++j, ++position_in_read) {
+                if (is_match && record_bases && position_in_read >= trim_ends && position_in_read <= trim_last) {
+                    increment_coverage(i + direction * (int64_t)j);
+                    if (record_qualities && mapping_quality > 0) {
+                        total_node_quality += mapping_quality;
+                    }
+                }
+            }
+            if (!is_aligned) {
+                position_in_read -= step;
+            }
+            i += direction * (int64_t)step;
+            offset += step;
+            length -= step;
+        }
+        return true;
+    };
+
+    if (!enter_node(0)) {
+        return;
+    }
+    if (!has_cs) {
+        // everything matches
+        walk(path_end - path_start, true, true);
+    } else {
+        const char* here = cs.data;
+        const char* end = cs.data + cs.size;
+        while (here < end) {
+            char op = *here++;
+            const char* op_end = here;
+            while (op_end < end && *op_end != ':' && *op_end != '*' && *op_end != '+' && *op_end != '-' && *op_end != '~') {
+                ++op_end;
+            }
+            bool walked = true;
+            if (op == ':') {
+                size_t length = 0;
+                for (const char* c = here; c < op_end; ++c) {
+                    length = 10 * length + (*c - '0');
+                }
+                walked = walk(length, true, true);
+            } else if (op == '*') {
+                // a substitution of one base
+                walked = walk(1, false, true);
+            } else if (op == '-') {
+                walked = walk(op_end - here, false, false);
+            } else if (op == '+') {
+                position_in_read += op_end - here;
+            } else {
+                // we don't know how to count this
+                break;
+            }
+            if (!walked) {
+                break;
+            }
+            here = op_end;
+        }
+    }
+    if (total_node_quality > 0) {
+        increment_node_quality(node_quality_index, total_node_quality);
+    }
+}
+
 // find the position on the forward strand in the sequence vector
 size_t Packer::position_in_basis(const Position& pos) const {
     // get position on the forward strand
@@ -649,7 +944,9 @@ string Packer::unescape_delim(const string& s, char d) const {
 }
 
 size_t Packer::coverage_size(void) const {
-    if (is_compacted){
+    if (mapped_coverage != nullptr) {
+        return mapped_num_bases;
+    } else if (is_compacted){
         return coverage_civ.size();
     }
     else{
@@ -658,7 +955,9 @@ size_t Packer::coverage_size(void) const {
 }
 
 size_t Packer::edge_vector_size(void) const{
-    if (is_compacted){
+    if (mapped_edge_coverage != nullptr) {
+        return mapped_num_edges;
+    } else if (is_compacted){
         return edge_coverage_civ.size();
     }
     else{
@@ -667,7 +966,9 @@ size_t Packer::edge_vector_size(void) const{
 }
 
 size_t Packer::node_quality_vector_size(void) const {
-    if (is_compacted) {
+    if (mapped_node_quality != nullptr) {
+        return mapped_num_nodes;
+    } else if (is_compacted) {
         return node_quality_civ.size();
     } else {
         return num_nodes_dynamic;
@@ -739,6 +1040,10 @@ void Packer::init_node_quality_bin(size_t i) {
 }
 
 void Packer::increment_coverage(size_t i) {
+    if (atomic_counters) {
+        coverage_atomic[i].fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
     pair<size_t, size_t> bin_offset = coverage_bin_offset(i);
     std::lock_guard<std::mutex> guard(base_locks[bin_offset.first]);
     init_coverage_bin(bin_offset.first);
@@ -746,7 +1051,9 @@ void Packer::increment_coverage(size_t i) {
 }
 
 void Packer::increment_coverage(size_t i, size_t v) {
-    if (v > 0) {
+    if (v > 0 && atomic_counters) {
+        coverage_atomic[i].fetch_add(v, std::memory_order_relaxed);
+    } else if (v > 0) {
         pair<size_t, size_t> bin_offset = coverage_bin_offset(i);
         std::lock_guard<std::mutex> guard(base_locks[bin_offset.first]);
         init_coverage_bin(bin_offset.first);
@@ -755,6 +1062,10 @@ void Packer::increment_coverage(size_t i, size_t v) {
 }
 
 void Packer::increment_edge_coverage(size_t i) {
+    if (atomic_counters) {
+        edge_coverage_atomic[i].fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
     pair<size_t, size_t> bin_offset = edge_coverage_bin_offset(i);
     std::lock_guard<std::mutex> guard(edge_locks[bin_offset.first]);
     init_edge_coverage_bin(bin_offset.first);
@@ -765,7 +1076,9 @@ void Packer::increment_edge_coverage(size_t i) {
 }
 
 void Packer::increment_edge_coverage(size_t i, size_t v) {
-    if (v > 0) {
+    if (v > 0 && atomic_counters) {
+        edge_coverage_atomic[i].fetch_add(v, std::memory_order_relaxed);
+    } else if (v > 0) {
         pair<size_t, size_t> bin_offset = edge_coverage_bin_offset(i);
         std::lock_guard<std::mutex> guard(edge_locks[bin_offset.first]);
         init_edge_coverage_bin(bin_offset.first);
@@ -777,7 +1090,9 @@ void Packer::increment_edge_coverage(size_t i, size_t v) {
 }
 
 void Packer::increment_node_quality(size_t i, size_t v) {
-    if (v > 0) {
+    if (v > 0 && atomic_counters) {
+        node_quality_atomic[i].fetch_add(v, std::memory_order_relaxed);
+    } else if (v > 0) {
         pair<size_t, size_t> bin_offset = node_quality_bin_offset(i);
         std::lock_guard<std::mutex> guard(node_quality_locks[bin_offset.first]);
         init_node_quality_bin(bin_offset.first);
@@ -789,12 +1104,24 @@ void Packer::increment_node_quality(size_t i, size_t v) {
 }
 
 bool Packer::has_qualities() const {
-    if (is_compacted) {
+    if (mapped_node_quality != nullptr) {
+        for (size_t i = 0; i < mapped_num_nodes; ++i) {
+            if (mapped_node_quality[i] > 0) {
+                return true;
+            }
+        }
+    } else if (is_compacted) {
         for (size_t i = 0; i < node_quality_civ.size(); ++i) {
             if (node_quality_civ[i] > 0) {
                 return true;
             }
         }
+    } else if (atomic_counters) {
+        for (size_t i = 0; i < node_quality_atomic.size(); ++i) {
+            if (node_quality_atomic[i].load(std::memory_order_relaxed) > 0) {
+                return true;
+            }
+        }
     } else {
         for (size_t i = 0; i < node_quality_dynamic.size(); ++i) {
             if (node_quality_dynamic[i] != nullptr) {
@@ -810,8 +1137,12 @@ bool Packer::has_qualities() const {
 }
 
 size_t Packer::coverage_at_position(size_t i) const {
-    if (is_compacted) {
+    if (mapped_coverage != nullptr) {
+        return mapped_coverage[i];
+    } else if (is_compacted) {
         return coverage_civ[i];
+    } else if (atomic_counters) {
+        return coverage_atomic[i].load(std::memory_order_relaxed);
     } else {
         pair<size_t, size_t> bin_offset = coverage_bin_offset(i);
         if (coverage_dynamic[bin_offset.first] == nullptr) {
@@ -823,9 +1154,14 @@ size_t Packer::coverage_at_position(size_t i) const {
 }
 
 size_t Packer::edge_coverage(size_t i) const {
-    if (is_compacted){
+    if (mapped_edge_coverage != nullptr) {
+        return mapped_edge_coverage[i];
+    } else if (is_compacted){
         return edge_coverage_civ[i];
     }
+    else if (atomic_counters) {
+        return edge_coverage_atomic[i].load(std::memory_order_relaxed);
+    }
     else{
         pair<size_t, size_t> bin_offset = edge_coverage_bin_offset(i);
         if (edge_coverage_dynamic[bin_offset.first] == nullptr) {
@@ -855,6 +1191,8 @@ size_t Packer::total_node_quality(size_t i) const {
             coverage += coverage_at_position(base + i);
         }
         return avg_qual * coverage;
+    } else if (atomic_counters) {
+        return node_quality_atomic[i].load(std::memory_order_relaxed);
     } else {
         pair<size_t, size_t> bin_offset = node_quality_bin_offset(i);
         if (node_quality_dynamic[bin_offset.first] == nullptr) {
@@ -866,7 +1204,9 @@ size_t Packer::total_node_quality(size_t i) const {
 }
 
 size_t Packer::average_node_quality(size_t i) const {
-    if (is_compacted) {
+    if (mapped_node_quality != nullptr) {
+        return mapped_node_quality[i];
+    } else if (is_compacted) {
         return node_quality_civ[i];
     } else {
         Position pos;
@@ -955,13 +1295,13 @@ ostream& Packer::as_table(ostream& out, bool show_edits, vector<vg::id_t> node_i
     if (show_edits) out << "\t" << "edits";
     out << endl;
     // write the coverage as a vector
-    for (size_t i = 0; i < coverage_civ.size(); ++i) {
+    for (size_t i = 0; i < coverage_size(); ++i) {
         nid_t node_id = dynamic_cast<const VectorizableHandleGraph*>(graph)->node_at_vector_offset(i+1);
         if (!node_ids.empty() && find(node_ids.begin(), node_ids.end(), node_id) == node_ids.end()) {
             continue;
         }
         size_t offset = i - dynamic_cast<const VectorizableHandleGraph*>(graph)->node_vector_offset(node_id);
-        out << i << "\t" << node_id << "\t" << offset << "\t" << coverage_civ[i];
+        out << i << "\t" << node_id << "\t" << offset << "\t" << coverage_at_position(i);
         if (show_edits) {
             out << "\t" << count(edit_csas[bin_for_position(i)], pos_key(i));
             for (auto& edit : edits_at_position(i)) out << " " << pb2json(edit);
@@ -1020,7 +1360,7 @@ ostream& Packer::as_edge_table(ostream& out, vector<vg::id_t> node_ids) {
                 << edge.from_start() << "\t"
                 << edge.to() << "\t"
                 << edge.to_end() << "\t"
-                << edge_coverage_civ[edge_index(edge)]
+                << edge_coverage(edge_index(edge))
                 << endl;
             
             // Look at the enxt edge
@@ -1038,12 +1378,12 @@ ostream& Packer::as_quality_table(ostream& out, vector<vg::id_t> node_ids) {
         << "node.id" << "\t"
         << "avg-mapq";
     out << endl;
-    for (size_t i = 1; i < node_quality_civ.size(); ++i) {
+    for (size_t i = 1; i < node_quality_vector_size(); ++i) {
         nid_t node_id = index_to_node(i);
         if (!node_ids.empty() && find(node_ids.begin(), node_ids.end(), node_id) == node_ids.end()) {
             continue;
         }
-        out << i << "\t" << node_id << "\t" << node_quality_civ[i] << endl;
+        out << i << "\t" << node_id << "\t" << average_node_quality(i) << endl;
     }
     return out;
 }
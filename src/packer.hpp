@@ -6,6 +6,7 @@
 #include <chrono>
 #include <ctime>
 #include <mutex>
+#include <atomic>
 #include "omp.h"
 #include "lru_cache.h"
 #include "alignment.hpp"
@@ -17,6 +18,7 @@
 #include "sdsl/csa_wt.hpp"
 #include "sdsl/suffix_arrays.hpp"
 #include "utility.hpp"
+#include "gaf_sorter.hpp"
 
 namespace vg {
 
@@ -54,6 +56,14 @@ public:
     ~Packer();
     void clear();
 
+    /// Count base coverage, edge coverage, and node quality with atomic
+    /// fetch-and-add on flat arrays instead of the locked counter arrays. This
+    /// costs a full 32 bits per base and edge (64 per node), but threads never
+    /// wait on each other, even on very high coverage nodes. The counts are
+    /// folded into the compact representation as usual by make_compact().
+    /// Must be called before any coverage is added.
+    void use_atomic_counters();
+
     /// Add coverage from given alignment to the indexes
     /// aln : given alignemnt
     /// min_mapq : ignore alignments with mapping_quality below this value
@@ -61,10 +71,23 @@ public:
     /// trim_ends : ignore first and last <trim_ends> bases
     void add(const Alignment& aln, int min_mapq = 0, int min_baseq = 0, int trim_ends = 0);
 
+    /// Add coverage from a GAF line in node ID space, without making an
+    /// Alignment. The bases are walked with the cs tag if there is one, and
+    /// are otherwise taken to all match. GAF has no base qualities, so
+    /// min_baseq has no effect, and edits are never recorded, since that would
+    /// need the read sequence.
+    void add(const GAFRecordView& record, int min_mapq = 0, int min_baseq = 0, int trim_ends = 0);
+
     void merge_from_files(const vector<string>& file_names);
     void merge_from_dynamic(vector<Packer*>& packers);
+    /// Load a pack file. Files written by save_mapped_to_file are memory-mapped
+    /// read-only rather than read in, so processes on one host share them.
     void load_from_file(const string& file_name);
     void save_to_file(const string& file_name);
+    /// Save the base coverage, edge coverage and average node qualities (but
+    /// not edits) as flat arrays that load_from_file can memory-map and serve
+    /// lookups from directly. Counts are capped at 2^32 - 1.
+    void save_mapped_to_file(const string& file_name);
     void load(istream& in);
     size_t serialize(std::ostream& out,
                      sdsl::structure_tree_node* s = NULL,
@@ -127,6 +150,13 @@ private:
     void init_edge_coverage_bin(size_t i);
     void init_node_quality_bin(size_t i);
     
+    /// queue an edit record for a bin in this thread's buffer, writing the
+    /// buffer out if it's full
+    void buffer_edit(size_t bin, string&& record);
+    /// write a thread's buffered edit records to the bins' temp files
+    void flush_edit_buffer(size_t thread);
+    /// memory-map a file written by save_mapped_to_file
+    void load_mapped_file(const string& file_name);
     void ensure_edit_tmpfiles_open(void);
     void close_edit_tmpfiles(void);
     void remove_edit_tmpfiles(void);
@@ -164,10 +194,22 @@ private:
     size_t num_nodes_dynamic;
     // one mutex per element of node_quality_dynamic
     std::mutex* node_quality_locks;
+
+    // alternative lock-free dynamic model, indexed the same as the total lengths above
+    bool atomic_counters = false;
+    vector<std::atomic<uint32_t>> coverage_atomic;
+    vector<std::atomic<uint32_t>> edge_coverage_atomic;
+    vector<std::atomic<uint64_t>> node_quality_atomic;
     
     vector<string> edit_tmpfile_names;
     vector<ofstream*> tmpfstreams;
     std::mutex* tmpfstream_locks;
+    // edit records waiting to be written, with their bins, for each thread
+    vector<vector<pair<size_t, string>>> edit_buffers;
+    // total bytes of record in each thread's buffer
+    vector<size_t> edit_buffer_bytes;
+    // write out a thread's buffer when it gets this big
+    static const size_t max_edit_buffer_bytes;
     // which bin should we use
     size_t bin_for_position(size_t i) const;
     size_t n_bins = 1;
@@ -177,6 +219,17 @@ private:
     dac_vector<> coverage_civ; // graph coverage (compacted coverage_dynamic)
     vlc_vector<> edge_coverage_civ; // edge coverage (compacted edge_coverage_dynamic)
     vlc_vector<> node_quality_civ; // averge mapq for each node rank (compacted node_quality_dynamic)
+    // read-only memory-mapped alternative to the above, if loaded from a flat file
+    void* mapped_data = nullptr;
+    size_t mapped_length = 0;
+    const uint32_t* mapped_coverage = nullptr;
+    const uint32_t* mapped_edge_coverage = nullptr;
+    const uint32_t* mapped_node_quality = nullptr;
+    size_t mapped_num_bases = 0;
+    size_t mapped_num_edges = 0;
+    size_t mapped_num_nodes = 0;
+    // identifies the flat file layout
+    static const char mapped_magic[8];
     // edits
     vector<csa_sada<enc_vector<>, 32, 32, sa_order_sa_sampling<>, isa_sampling<>, succinct_byte_alphabet<> > > edit_csas;
     // make separators that are somewhat unusual, as we escape these
@@ -1,6 +1,8 @@
 #include "path_component_index.hpp"
 
+#include <algorithm>
 #include <queue>
+#include <string>
 #include "sdsl/bit_vectors.hpp"
 #include "algorithms/component.hpp"
 
@@ -12,9 +14,42 @@ namespace vg {
         // Nothing to do
     }
     
+    const string PathComponentIndex::HEADER = "#vg-path-components";
+    
     PathComponentIndex::PathComponentIndex(const PathHandleGraph* graph) {
         
-        component_path_sets = algorithms::component_paths(*graph);
+        component_path_sets = algorithms::component_paths_parallel(*graph);
+        index_paths(graph);
+    }
+    
+    PathComponentIndex::PathComponentIndex(const PathHandleGraph* graph, istream& in) {
+        
+        string line;
+        if (!getline(in, line) || line != HEADER) {
+            cerr << "error:[PathComponentIndex] Input is not a saved path component index" << endl;
+            exit(1);
+        }
+        while (getline(in, line)) {
+            size_t tab = line.find('\t');
+            if (tab == string::npos) {
+                cerr << "error:[PathComponentIndex] Saved path component index has a malformed line: " << line << endl;
+                exit(1);
+            }
+            size_t component = stoull(line.substr(0, tab));
+            string path_name = line.substr(tab + 1);
+            if (!graph->has_path(path_name)) {
+                cerr << "error:[PathComponentIndex] Saved path component index has path " << path_name << ", which is not in the graph. Was it saved for a different graph?" << endl;
+                exit(1);
+            }
+            if (component >= component_path_sets.size()) {
+                component_path_sets.resize(component + 1);
+            }
+            component_path_sets[component].insert(graph->get_path_handle(path_name));
+        }
+        index_paths(graph);
+    }
+    
+    void PathComponentIndex::index_paths(const PathHandleGraph* graph) {
         
         // make it so we can index into this with the path rank directly
         component_path_set_of_path.reserve(graph->get_path_count());
@@ -31,6 +66,23 @@ namespace vg {
         }
     }
     
+    void PathComponentIndex::serialize(const PathHandleGraph* graph, ostream& out) const {
+        
+        out << HEADER << "\n";
+        for (size_t i = 0; i < component_path_sets.size(); i++) {
+            // sort by name so the file doesn't depend on hash order
+            vector<string> path_names;
+            path_names.reserve(component_path_sets[i].size());
+            for (const path_handle_t& path : component_path_sets[i]) {
+                path_names.push_back(graph->get_path_name(path));
+            }
+            sort(path_names.begin(), path_names.end());
+            for (const string& path_name : path_names) {
+                out << i << "\t" << path_name << "\n";
+            }
+        }
+    }
+    
     bool PathComponentIndex::paths_on_same_component(const path_handle_t& path_1,
                                                      const path_handle_t& path_2) const {
         
@@ -6,6 +6,7 @@
  * Contains an index that maps embedded paths to the connected components of a graph
  */
 
+#include <iostream>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -23,17 +24,29 @@ namespace vg {
     class PathComponentIndex {
     public:
         
-        /// Constructor
+        /// Constructor, which finds the components on all threads
         PathComponentIndex(const PathHandleGraph* graph);
         
+        /// Load an index for the graph that was saved with serialize(). Paths
+        /// are matched up by name, and a missing path is an error.
+        PathComponentIndex(const PathHandleGraph* graph, istream& in);
+        
         /// Teturns true if the paths are on the same connected component of the graph
         bool paths_on_same_component(const path_handle_t& path_1,
                                      const path_handle_t& path_2) const;
         
+        /// Save the index, as tab-separated lines of component number and
+        /// path name after a header line.
+        void serialize(const PathHandleGraph* graph, ostream& out) const;
         
+        /// The first line of a saved index
+        static const string HEADER;
         
     private:
         
+        /// Index the component set each path is in, from component_path_sets
+        void index_paths(const PathHandleGraph* graph);
+        
         /// We make the default constructor private so that it can be used
         /// in move's, etc. but isn't exposed
         PathComponentIndex();
@@ -0,0 +1,77 @@
+/**
+ * \file path_offset_index.cpp: contains the implementation of PathOffsetIndex
+ */
+
+#include "path_offset_index.hpp"
+
+#include <algorithm>
+
+namespace vg {
+
+using namespace std;
+
+PathOffsetIndex::PathOffsetIndex(const PathPositionHandleGraph& graph, const unordered_set<path_handle_t>& paths) {
+
+    if (paths.empty() || graph.get_node_count() == 0) {
+        return;
+    }
+
+    // go through the paths in a consistent order so the table comes out the same every time
+    vector<path_handle_t> path_order(paths.begin(), paths.end());
+    sort(path_order.begin(), path_order.end(), [&](const path_handle_t& a, const path_handle_t& b) {
+        return as_integer(a) < as_integer(b);
+    });
+
+    min_id = graph.min_node_id();
+    node_starts.resize(graph.max_node_id() - min_id + 2, 0);
+
+    // count the visits to each node, shifted by one so the prefix sum gives the starts
+    for (const path_handle_t& path : path_order) {
+        graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+            ++node_starts[graph.get_id(graph.get_handle_of_step(step)) - min_id + 1];
+        });
+    }
+    for (size_t i = 1; i < node_starts.size(); ++i) {
+        node_starts[i] += node_starts[i - 1];
+    }
+
+    // fill in the visits, walking the offset along each path as we go
+    visit_table.resize(node_starts.back());
+    vector<size_t> next_visit(node_starts.begin(), node_starts.end() - 1);
+    for (const path_handle_t& path : path_order) {
+        size_t offset = 0;
+        graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+            handle_t handle = graph.get_handle_of_step(step);
+            Visit& visit = visit_table[next_visit[graph.get_id(handle) - min_id]++];
+            visit.step = step;
+            visit.offset = offset;
+            visit.is_reverse = graph.get_is_reverse(handle);
+            offset += graph.get_length(handle);
+        });
+    }
+}
+
+pair<const PathOffsetIndex::Visit*, const PathOffsetIndex::Visit*> PathOffsetIndex::visits(nid_t node_id) const {
+    if (node_id < min_id || node_id - min_id + 1 >= node_starts.size()) {
+        return make_pair(nullptr, nullptr);
+    }
+    const Visit* data = visit_table.data();
+    return make_pair(data + node_starts[node_id - min_id], data + node_starts[node_id - min_id + 1]);
+}
+
+bool PathOffsetIndex::find_offset(nid_t node_id, const step_handle_t& step, size_t& offset_out) const {
+    auto range = visits(node_id);
+    for (const Visit* visit = range.first; visit != range.second; ++visit) {
+        if (visit->step == step) {
+            offset_out = visit->offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t PathOffsetIndex::size() const {
+    return visit_table.size();
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef VG_PATH_OFFSET_INDEX_HPP_INCLUDED
+#define VG_PATH_OFFSET_INDEX_HPP_INCLUDED
+
+/** \file
+ * path_offset_index.hpp: defines an index from nodes to where a chosen set of
+ * paths visit them.
+ */
+
+#include "handle.hpp"
+
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * A read-only table of the steps that a set of paths take on each node, with
+ * the offset of each step along its path and the orientation in which it
+ * visits the node. It is built once up front, and can then be shared between
+ * threads, so that surjection doesn't have to go back to the graph's path
+ * position structures for the same reference nodes over and over.
+ *
+ * Visits are stored contiguously by node ID, so all of a node's visits can be
+ * found with one offset lookup and are usually on one cache line.
+ */
+class PathOffsetIndex {
+public:
+
+    /// One visit of an indexed path to a node
+    struct alignas(32) Visit {
+        /// The step on the path
+        step_handle_t step;
+        /// The offset along the path of the start of the step
+        size_t offset;
+        /// Whether the path visits the node in reverse
+        bool is_reverse;
+    };
+
+    /// Index the steps of the given paths in the given graph.
+    PathOffsetIndex(const PathPositionHandleGraph& graph, const unordered_set<path_handle_t>& paths);
+
+    /// Default constructor -- indexes nothing
+    PathOffsetIndex() = default;
+
+    /// Get the range of visits to the given node by indexed paths. The range
+    /// is empty if no indexed path visits the node.
+    pair<const Visit*, const Visit*> visits(nid_t node_id) const;
+
+    /// If the given step, which must be on the given node, is on an indexed
+    /// path, store its offset along the path in offset_out and return true.
+    /// Otherwise return false.
+    bool find_offset(nid_t node_id, const step_handle_t& step, size_t& offset_out) const;
+
+    /// Get the total number of visits indexed
+    size_t size() const;
+
+private:
+
+    /// The smallest node ID that can have visits
+    nid_t min_id = 0;
+
+    /// For each node ID from min_id, the index of its first visit in
+    /// visit_table, with a past-the-end entry at the end.
+    vector<size_t> node_starts;
+
+    /// All the visits, grouped by node
+    vector<Visit> visit_table;
+};
+
+}
+
+#endif
@@ -17,11 +17,25 @@ PhaseUnfolder::PhaseUnfolder(const PathHandleGraph& path_graph, const gbwt::GBWT
 void PhaseUnfolder::unfold(MutableHandleGraph& graph, bool show_progress) {
     
     std::list<bdsg::HashGraph> components = this->complement_components(graph, show_progress);
-    
+    std::vector<bdsg::HashGraph*> component_ptrs;
+    component_ptrs.reserve(components.size());
+    for (bdsg::HashGraph& component : components) {
+        component_ptrs.push_back(&component);
+    }
+
+    // Unfold the components in parallel using temporary ids for the
+    // duplicates, and then assign the permanent ids in component order.
+    vg::id_t first_duplicate = this->mapping.end();
+    std::vector<ComponentState> states(component_ptrs.size(), ComponentState(first_duplicate));
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < component_ptrs.size(); i++) {
+        this->unfold_component(states[i], *(component_ptrs[i]), graph);
+    }
+
     size_t haplotype_paths = 0;
     bdsg::HashGraph unfolded;
-    for (MutableHandleGraph& component : components) {
-        haplotype_paths += this->unfold_component(component, graph, unfolded);
+    for (ComponentState& state : states) {
+        haplotype_paths += this->insert_component(state, unfolded);
     }
     if (show_progress) {
         std::cerr << "Unfolded graph: "
@@ -376,36 +390,52 @@ std::list<bdsg::HashGraph> PhaseUnfolder::complement_components(MutableHandleGra
     return components;
 }
 
-size_t PhaseUnfolder::unfold_component(MutableHandleGraph& component, MutableHandleGraph& graph, MutableHandleGraph& unfolded) {
+void PhaseUnfolder::unfold_component(ComponentState& state, MutableHandleGraph& component, const MutableHandleGraph& graph) const {
     // Find the border nodes shared between the component and the graph.
     component.for_each_handle([&](const handle_t& handle) {
         vg::id_t id = component.get_id(handle);
         if (graph.has_node(id)) {
-            this->border.insert(id);
+            state.border.insert(id);
         }
     });
 
     // Generate the paths starting from each border node.
-    for (vg::id_t start_node : this->border) {
-        this->generate_paths(component, start_node);
+    for (vg::id_t start_node : state.border) {
+        this->generate_paths(state, component, start_node);
     }
 
     // Generate the threads for each node.
     component.for_each_handle([&](const handle_t& handle) {
-        this->generate_threads(component, component.get_id(handle));
+        this->generate_threads(state, component, component.get_id(handle));
     });
-    
+
+    state.reference_paths.clear();
+}
+
+size_t PhaseUnfolder::insert_component(ComponentState& state, MutableHandleGraph& unfolded) {
+    // Assign permanent ids to the duplicates.
+    vg::id_t offset = this->mapping.end();
+    for (vg::id_t original : state.duplicates) {
+        this->mapping.insert(original);
+    }
+    auto permanent = [&](gbwt::node_type node) -> gbwt::node_type {
+        if (node == gbwt::ENDMARKER || static_cast<vg::id_t>(gbwt::Node::id(node)) < state.first_duplicate) {
+            return node;
+        }
+        return gbwt::Node::encode(gbwt::Node::id(node) - state.first_duplicate + offset, gbwt::Node::is_reverse(node));
+    };
+
     auto insert_node = [&](gbwt::node_type node) {
         // create a new node
         if (!unfolded.has_node(gbwt::Node::id(node))) {
-            handle_t temp = this->path_graph.get_handle(this->get_mapping(gbwt::Node::id(node)));;
+            handle_t temp = this->path_graph.get_handle(this->get_mapping(gbwt::Node::id(node)));
             unfolded.create_handle(this->path_graph.get_sequence(temp), gbwt::Node::id(node));
         }
     };
 
     // Create the unfolded component from the tries.
-    for (auto mapping : this->prefixes) {
-        gbwt::node_type from = mapping.first.first, to = mapping.second;
+    for (auto mapping : state.prefixes) {
+        gbwt::node_type from = permanent(mapping.first.first), to = permanent(mapping.second);
         if (from != gbwt::ENDMARKER) {
             insert_node(from);
         }
@@ -414,30 +444,27 @@ size_t PhaseUnfolder::unfold_component(MutableHandleGraph& component, MutableHan
             unfolded.create_edge(make_edge(unfolded, from, to));
         }
     }
-    for (auto mapping : this->suffixes) {
-        gbwt::node_type from = mapping.second, to = mapping.first.second;
+    for (auto mapping : state.suffixes) {
+        gbwt::node_type from = permanent(mapping.second), to = permanent(mapping.first.second);
         insert_node(from);
         if (to != gbwt::ENDMARKER) {
             insert_node(to);
             unfolded.create_edge(make_edge(unfolded, from, to));
         }
     }
-    for (auto edge : this->crossing_edges) {
-        insert_node(edge.first);
-        insert_node(edge.second);
-        unfolded.create_edge(make_edge(unfolded, edge.first, edge.second));
+    for (auto edge : state.crossing_edges) {
+        gbwt::node_type from = permanent(edge.first), to = permanent(edge.second);
+        insert_node(from);
+        insert_node(to);
+        unfolded.create_edge(make_edge(unfolded, from, to));
     }
 
-    size_t haplotype_paths = this->crossing_edges.size();
-    this->border.clear();
-    this->reference_paths.clear();
-    this->prefixes.clear();
-    this->suffixes.clear();
-    this->crossing_edges.clear();
+    size_t haplotype_paths = state.crossing_edges.size();
+    state = ComponentState(state.first_duplicate);
     return haplotype_paths;
 }
 
-void PhaseUnfolder::generate_paths(MutableHandleGraph& component, vg::id_t from) {
+void PhaseUnfolder::generate_paths(ComponentState& state, MutableHandleGraph& component, vg::id_t from) const {
 
     handle_t from_handle = this->path_graph.get_handle(from);
     this->path_graph.for_each_step_on_handle(from_handle, [&](const step_handle_t& _step) {
@@ -463,15 +490,15 @@ void PhaseUnfolder::generate_paths(MutableHandleGraph& component, vg::id_t from)
                     break;  // Found a maximal path, no matching edge.
                 }
                 buffer.push_back(curr);
-                if (this->border.find(gbwt::Node::id(curr)) != this->border.end()) {
+                if (state.border.find(gbwt::Node::id(curr)) != state.border.end()) {
                     break;  // Found a border-to-border path.
                 }
                 prev = curr;
             }
             
-            bool to_border = (this->border.find(gbwt::Node::id(buffer.back())) != this->border.end());
-            this->reference_paths.push_back(buffer);
-            this->insert_path(buffer, true, to_border);
+            bool to_border = (state.border.find(gbwt::Node::id(buffer.back())) != state.border.end());
+            state.reference_paths.push_back(buffer);
+            this->insert_path(state, buffer, true, to_border);
         }
 
         // Backward.
@@ -496,34 +523,34 @@ void PhaseUnfolder::generate_paths(MutableHandleGraph& component, vg::id_t from)
                     break;  // Found a maximal path, no matching edge.
                 }
                 buffer.push_back(curr);
-                if (this->border.find(gbwt::Node::id(curr)) != this->border.end()) {
+                if (state.border.find(gbwt::Node::id(curr)) != state.border.end()) {
                     break;  // Found a border-to-border path.
                 }
                 prev = curr;
             }
             
-            bool to_border = (this->border.find(gbwt::Node::id(buffer.back())) != this->border.end());
-            this->reference_paths.push_back(buffer);
-            this->insert_path(buffer, true, to_border);
+            bool to_border = (state.border.find(gbwt::Node::id(buffer.back())) != state.border.end());
+            state.reference_paths.push_back(buffer);
+            this->insert_path(state, buffer, true, to_border);
         }
 
     });
 }
 
-void PhaseUnfolder::generate_threads(MutableHandleGraph& component, vg::id_t from) {
+void PhaseUnfolder::generate_threads(ComponentState& state, MutableHandleGraph& component, vg::id_t from) const {
 
-    bool is_internal = (this->border.find(from) == this->border.end());
-    this->create_state(from, false, is_internal);
-    this->create_state(from, true, is_internal);
+    bool is_internal = (state.border.find(from) == state.border.end());
+    this->create_state(state, from, false, is_internal);
+    this->create_state(state, from, true, is_internal);
 
-    while (!this->states.empty()) {
-        state_type state = this->states.top(); this->states.pop();
-        vg::id_t node = gbwt::Node::id(state.first.node);
-        bool is_reverse = gbwt::Node::is_reverse(state.first.node);
+    while (!state.states.empty()) {
+        state_type search = state.states.top(); state.states.pop();
+        vg::id_t node = gbwt::Node::id(search.first.node);
+        bool is_reverse = gbwt::Node::is_reverse(search.first.node);
 
-        if (state.second.size() >= 2 && this->border.find(node) != this->border.end()) {
+        if (search.second.size() >= 2 && state.border.find(node) != state.border.end()) {
             if (!is_internal) {
-                this->extend_path(state.second);
+                this->extend_path(state, search.second);
             }
             continue;   // The path reached a border.
         }
@@ -531,33 +558,33 @@ void PhaseUnfolder::generate_threads(MutableHandleGraph& component, vg::id_t fro
         bool was_extended = false;
         handle_t from = component.get_handle(node, is_reverse);
         component.follow_edges(from, false, [&](const handle_t& handle) {
-                was_extended |= this->extend_state(state, component.get_id(handle), component.get_is_reverse(handle));
+                was_extended |= this->extend_state(state, search, component.get_id(handle), component.get_is_reverse(handle));
             });
         component.follow_edges(from, true, [&](const handle_t& handle) {
-                was_extended |= this->extend_state(state, component.get_id(handle), !component.get_is_reverse(handle));
+                was_extended |= this->extend_state(state, search, component.get_id(handle), !component.get_is_reverse(handle));
             });
         if (!was_extended) {
-            this->extend_path(state.second);    // Maximal path.
+            this->extend_path(state, search.second);    // Maximal path.
         }
     }
 }
 
-void PhaseUnfolder::create_state(vg::id_t node, bool is_reverse, bool starting) {
+void PhaseUnfolder::create_state(ComponentState& state, vg::id_t node, bool is_reverse, bool starting) const {
     gbwt::node_type gbwt_node = gbwt::Node::encode(node, is_reverse);
     search_type search = (starting ? this->gbwt_index.prefix(gbwt_node) : this->gbwt_index.find(gbwt_node));
     if (search.empty()) {
         return;
     }
-    this->states.push(std::make_pair(search, path_type(1, search.node)));
+    state.states.push(std::make_pair(search, path_type(1, search.node)));
 }
 
-bool PhaseUnfolder::extend_state(state_type state, vg::id_t node, bool is_reverse) {
-    state.first = this->gbwt_index.extend(state.first, gbwt::Node::encode(node, is_reverse));
-    if (state.first.empty()) {
+bool PhaseUnfolder::extend_state(ComponentState& state, state_type search, vg::id_t node, bool is_reverse) const {
+    search.first = this->gbwt_index.extend(search.first, gbwt::Node::encode(node, is_reverse));
+    if (search.first.empty()) {
         return false;
     }
-    state.second.push_back(state.first.node);
-    this->states.push(state);
+    search.second.push_back(search.first.node);
+    state.states.push(search);
     return true;
 }
 
@@ -573,14 +600,14 @@ PhaseUnfolder::path_type canonical_orientation(const PhaseUnfolder::path_type& p
     return path;
 }
 
-void PhaseUnfolder::extend_path(const path_type& path) {
+void PhaseUnfolder::extend_path(ComponentState& state, const path_type& path) const {
     if (path.size() < 2) {
         return;
     }
-    bool from_border = (this->border.find(gbwt::Node::id(path.front())) != this->border.end());
-    bool to_border = (this->border.find(gbwt::Node::id(path.back())) != this->border.end());
+    bool from_border = (state.border.find(gbwt::Node::id(path.front())) != state.border.end());
+    bool to_border = (state.border.find(gbwt::Node::id(path.back())) != state.border.end());
     if (from_border && to_border) {
-        this->insert_path(path, from_border, to_border);
+        this->insert_path(state, path, from_border, to_border);
         return;
     }
 
@@ -592,8 +619,8 @@ void PhaseUnfolder::extend_path(const path_type& path) {
     // Note that the reverse complement of a reference path is also a
     // reference path.
     if (!from_border) {
-        for (size_t ref = 0; ref < this->reference_paths.size(); ref++) {
-            const path_type& reference = this->reference_paths[ref];
+        for (size_t ref = 0; ref < state.reference_paths.size(); ref++) {
+            const path_type& reference = state.reference_paths[ref];
             bool found = false;
             for (size_t i = 0; i < reference.size(); i++) {
                 edge_t candidate = make_edge(path_graph, reference[i], to_extend.front());
@@ -612,8 +639,8 @@ void PhaseUnfolder::extend_path(const path_type& path) {
 
     // Try adding a suffix of a reference path to the end of the path.
     if (!to_border) {
-        for (size_t ref = 0; ref < this->reference_paths.size(); ref++) {
-            const path_type& reference = this->reference_paths[ref];
+        for (size_t ref = 0; ref < state.reference_paths.size(); ref++) {
+            const path_type& reference = state.reference_paths[ref];
             bool found = false;
             for (size_t i = 0; i < reference.size(); i++) {
                 edge_t candidate = make_edge(path_graph, to_extend.back(), reference[i]);
@@ -630,10 +657,10 @@ void PhaseUnfolder::extend_path(const path_type& path) {
         }
     }
 
-    this->insert_path(to_extend, from_border, to_border);
+    this->insert_path(state, to_extend, from_border, to_border);
 }
 
-void PhaseUnfolder::insert_path(const path_type& path, bool from_border, bool to_border) {
+void PhaseUnfolder::insert_path(ComponentState& state, const path_type& path, bool from_border, bool to_border) const {
 
     if (path.size() < 2) {
         return;
@@ -650,42 +677,42 @@ void PhaseUnfolder::insert_path(const path_type& path, bool from_border, bool to
     // Prefixes.
     gbwt::node_type from = to_insert.front();
     if (!from_border) {
-        from = this->get_prefix(gbwt::ENDMARKER, from);
+        from = this->get_prefix(state, gbwt::ENDMARKER, from);
     }
     for (size_t i = 1; i < (to_insert.size() + 1) / 2; i++) {
-        from = this->get_prefix(from, to_insert[i]);
+        from = this->get_prefix(state, from, to_insert[i]);
     }
 
     // Suffixes.
     gbwt::node_type to = to_insert.back();
     if (!to_border) {
-        to = this->get_suffix(to, gbwt::ENDMARKER);
+        to = this->get_suffix(state, to, gbwt::ENDMARKER);
     }
     for (size_t i = to_insert.size() - 2; i >= (to_insert.size() + 1) / 2; i--) {
-        to = this->get_suffix(to_insert[i], to);
+        to = this->get_suffix(state, to_insert[i], to);
     }
 
     // Crossing edge.
-    this->crossing_edges.insert(std::make_pair(from, to));
+    state.crossing_edges.insert(std::make_pair(from, to));
 }
 
 
-gbwt::node_type PhaseUnfolder::get_prefix(gbwt::node_type from, gbwt::node_type node) {
+gbwt::node_type PhaseUnfolder::get_prefix(ComponentState& state, gbwt::node_type from, gbwt::node_type node) const {
     std::pair<gbwt::node_type, gbwt::node_type> key(from, node);
-    if (this->prefixes.find(key) == this->prefixes.end()) {
-        gbwt::size_type new_id = this->mapping.insert(gbwt::Node::id(node));
-        this->prefixes[key] = gbwt::Node::encode(new_id, gbwt::Node::is_reverse(node));
+    if (state.prefixes.find(key) == state.prefixes.end()) {
+        gbwt::size_type new_id = state.duplicate(gbwt::Node::id(node));
+        state.prefixes[key] = gbwt::Node::encode(new_id, gbwt::Node::is_reverse(node));
     }
-    return this->prefixes[key];
+    return state.prefixes[key];
 }
 
-gbwt::node_type PhaseUnfolder::get_suffix(gbwt::node_type node, gbwt::node_type to) {
+gbwt::node_type PhaseUnfolder::get_suffix(ComponentState& state, gbwt::node_type node, gbwt::node_type to) const {
     std::pair<gbwt::node_type, gbwt::node_type> key(node, to);
-    if (this->suffixes.find(key) == this->suffixes.end()) {
-        gbwt::size_type new_id = this->mapping.insert(gbwt::Node::id(node));
-        this->suffixes[key] = gbwt::Node::encode(new_id, gbwt::Node::is_reverse(node));
+    if (state.suffixes.find(key) == state.suffixes.end()) {
+        gbwt::size_type new_id = state.duplicate(gbwt::Node::id(node));
+        state.suffixes[key] = gbwt::Node::encode(new_id, gbwt::Node::is_reverse(node));
     }
-    return this->suffixes[key];
+    return state.suffixes[key];
 }
 
 } 
@@ -56,6 +56,9 @@ public:
      * and suffixes.
      *
      * - Extend the input graph with the unfolded components.
+     *
+     * The components are unfolded in parallel using OMP threads, but the
+     * duplicated nodes get the same ids as with a single thread.
      */
     void unfold(MutableHandleGraph& graph, bool show_progress = false);
 
@@ -101,6 +104,35 @@ public:
     }
 
 private:
+    /**
+     * The state for unfolding a single component. Components are unfolded
+     * independently, so the duplicated nodes get temporary ids starting from
+     * 'first_duplicate', which is larger than any id in the original graph.
+     * duplicates[i] is the original id for temporary id first_duplicate + i.
+     */
+    struct ComponentState {
+        explicit ComponentState(vg::id_t first_duplicate) : first_duplicate(first_duplicate) {}
+
+        hash_set<vg::id_t>     border;
+        std::stack<state_type> states;
+        std::vector<path_type> reference_paths;
+
+        /// Tries for the unfolded prefixes and reverse suffixes.
+        /// prefixes[(from, to)] is the mapping for to, and
+        /// suffixes[(from, to)] is the mapping for from.
+        pair_hash_map<std::pair<gbwt::node_type, gbwt::node_type>, gbwt::node_type> prefixes, suffixes;
+        pair_hash_set<std::pair<gbwt::node_type, gbwt::node_type>> crossing_edges;
+
+        vg::id_t              first_duplicate;
+        std::vector<vg::id_t> duplicates;
+
+        /// Create a new temporary duplicate of the given node.
+        vg::id_t duplicate(vg::id_t original) {
+            this->duplicates.push_back(original);
+            return this->first_duplicate + this->duplicates.size() - 1;
+        }
+    };
+
     /**
      * Generate a complement graph consisting of the edges that are in the
      * GBWT index but not in the input graph. Split the complement into
@@ -112,8 +144,16 @@ private:
      * Generate all border-to-border paths in the component supported by the
      * indexes. Unfold the paths by duplicating the inner nodes so that the
      * paths become disjoint, except for their shared prefixes/suffixes.
+     * The duplicates get temporary ids. This is thread-safe.
+     */
+    void unfold_component(ComponentState& state, MutableHandleGraph& component, const MutableHandleGraph& graph) const;
+
+    /**
+     * Assign permanent ids to the duplicated nodes in the unfolded component
+     * and insert the component into the unfolded graph. Returns the number of
+     * haplotype paths in the component.
      */
-    size_t unfold_component(MutableHandleGraph& component, MutableHandleGraph& graph, MutableHandleGraph& unfolded);
+    size_t insert_component(ComponentState& state, MutableHandleGraph& unfolded);
 
     /**
      * Generate all paths supported by the XG index passing through the given
@@ -121,7 +161,7 @@ private:
      * paths into the set in the canonical orientation, and use them as
      * reference paths for extending threads.
      */
-    void generate_paths(MutableHandleGraph& component, vg::id_t from);
+    void generate_paths(ComponentState& state, MutableHandleGraph& component, vg::id_t from) const;
 
    /**
     * Generate all paths supported by the GBWT index from the given node until
@@ -130,32 +170,32 @@ private:
     * passing through it. Otherwise consider only the threads starting from
     * it, and do not output threads reaching a border.
     */
-    void generate_threads(MutableHandleGraph& component, vg::id_t from);
+    void generate_threads(ComponentState& state, MutableHandleGraph& component, vg::id_t from) const;
 
     /**
-     * Create or extend the state with the given node orientation, and insert
-     * it into the stack if it is supported by the GBWT index. Use 'starting'
-     * to determine whether the initial state is for the threads starting at
-     * the node or for the threads passing through the node.
+     * Create or extend the search state with the given node orientation, and
+     * insert it into the stack if it is supported by the GBWT index. Use
+     * 'starting' to determine whether the initial state is for the threads
+     * starting at the node or for the threads passing through the node.
      */
-    void create_state(vg::id_t node, bool is_reverse, bool starting);
-    bool extend_state(state_type state, vg::id_t node, bool is_reverse);
+    void create_state(ComponentState& state, vg::id_t node, bool is_reverse, bool starting) const;
+    bool extend_state(ComponentState& state, state_type search, vg::id_t node, bool is_reverse) const;
 
     /**
      * Try to extend the path at both ends until the border by using the
      * reference paths. Insert the extended path into the set in the canonical
      * orientation.
      */
-    void extend_path(const path_type& path);
+    void extend_path(ComponentState& state, const path_type& path) const;
 
     /// Insert the path into the set in the canonical orientation.
-    void insert_path(const path_type& path, bool from_border, bool to_border);
+    void insert_path(ComponentState& state, const path_type& path, bool from_border, bool to_border) const;
 
     /// Get the id for the duplicate of 'node' after 'from'.
-    gbwt::node_type get_prefix(gbwt::node_type from, gbwt::node_type node);
+    gbwt::node_type get_prefix(ComponentState& state, gbwt::node_type from, gbwt::node_type node) const;
 
     /// Get the id for the duplicate of 'node' before 'to'.
-    gbwt::node_type get_suffix(gbwt::node_type node, gbwt::node_type to);
+    gbwt::node_type get_suffix(ComponentState& state, gbwt::node_type node, gbwt::node_type to) const;
 
     /// XG and GBWT indexes for the original graph.
     const PathHandleGraph& path_graph;
@@ -163,17 +203,6 @@ private:
 
     /// Mapping from duplicated nodes to original ids.
     gcsa::NodeMapping mapping;
-
-    /// Internal data structures for the current component.
-    hash_set<vg::id_t>     border;
-    std::stack<state_type> states;
-    std::vector<path_type> reference_paths;
-
-    /// Tries for the unfolded prefixes and reverse suffixes.
-    /// prefixes[(from, to)] is the mapping for to, and
-    /// suffixes[(from, to)] is the mapping for from.
-    pair_hash_map<std::pair<gbwt::node_type, gbwt::node_type>, gbwt::node_type> prefixes, suffixes;
-    pair_hash_set<std::pair<gbwt::node_type, gbwt::node_type>> crossing_edges;
 };
 
 }
@@ -595,7 +595,12 @@ namespace vg {
 #endif
             
             // add each location the start nodes occur in the path to the candidate starts
-            for ( HaplotypeNode* haplo_node : node_locations[start_pos.node_id()] ) {
+            // (looked up without inserting, so that reads can be scored concurrently)
+            auto locations = node_locations.find(start_pos.node_id());
+            if (locations == node_locations.end()) {
+                continue;
+            }
+            for ( HaplotypeNode* haplo_node : locations->second ) {
 #ifdef debug_phased_genome
                 cerr << "[PhasedGenome::optimal_score_on_genome]: marking candidate start position at " << haplo_node->node_traversal.node->id() << " on haplotype node at " << haplo_node << endl;
 #endif
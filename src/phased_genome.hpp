@@ -127,7 +127,8 @@ namespace vg {
         /// Returns the score of the highest scoring alignment contained in the multipath alignment
         /// that is restricted to the phased genome's paths through the variation graph.
         ///
-        /// Note: assumes that multipath_alignment_t has 'start' field filled in
+        /// Note: assumes that multipath_alignment_t has 'start' field filled in. Does not modify
+        /// the genome, so multiple alignments can be scored in parallel.
         int32_t optimal_score_on_genome(const multipath_alignment_t& multipath_aln, VG& graph);
         
         // TODO: make a local subalignment optimal score function (main obstacle is scoring partial subpaths)
@@ -0,0 +1,148 @@
+/**
+ * \file pruning_overlay.cpp: contains the implementation of PruningOverlay
+ */
+
+#include "pruning_overlay.hpp"
+
+#include <tuple>
+
+namespace vg {
+
+using namespace std;
+
+PruningOverlay::PruningOverlay(const HandleGraph* graph) : graph(graph) {
+    // Nothing to do!
+}
+
+void PruningOverlay::mask_node(const handle_t& handle) {
+    handle_t forward = graph->forward(handle);
+    masked_nodes.insert(graph->get_id(forward));
+    // Hide the edges too, so they don't come back with the node.
+    graph->follow_edges(forward, false, [&](const handle_t& next) {
+        masked_edges.insert(graph->edge_handle(forward, next));
+    });
+    graph->follow_edges(forward, true, [&](const handle_t& prev) {
+        masked_edges.insert(graph->edge_handle(prev, forward));
+    });
+}
+
+void PruningOverlay::mask_edge(const edge_t& edge) {
+    masked_edges.insert(graph->edge_handle(edge.first, edge.second));
+}
+
+void PruningOverlay::unmask_node(const handle_t& handle) {
+    masked_nodes.erase(graph->get_id(handle));
+}
+
+void PruningOverlay::unmask_edge(const edge_t& edge) {
+    masked_edges.erase(graph->edge_handle(edge.first, edge.second));
+    unmask_node(edge.first);
+    unmask_node(edge.second);
+}
+
+bool PruningOverlay::is_masked(const handle_t& handle) const {
+    return !masked_nodes.empty() && masked_nodes.count(graph->get_id(handle));
+}
+
+bool PruningOverlay::is_masked(const edge_t& edge) const {
+    return is_masked(edge.first) || is_masked(edge.second) ||
+        (!masked_edges.empty() && masked_edges.count(graph->edge_handle(edge.first, edge.second)));
+}
+
+pair<size_t, size_t> PruningOverlay::apply(DeletableHandleGraph& target) const {
+    // Deleting can move things around inside the target, so we go by ID and
+    // orientation rather than handle.
+    vector<tuple<nid_t, bool, nid_t, bool>> edges_to_destroy;
+    edges_to_destroy.reserve(masked_edges.size());
+    for (auto& edge : masked_edges) {
+        edges_to_destroy.emplace_back(graph->get_id(edge.first), graph->get_is_reverse(edge.first),
+                                      graph->get_id(edge.second), graph->get_is_reverse(edge.second));
+    }
+
+    pair<size_t, size_t> destroyed(0, 0);
+    for (auto& edge : edges_to_destroy) {
+        handle_t from = target.get_handle(get<0>(edge), get<1>(edge));
+        handle_t to = target.get_handle(get<2>(edge), get<3>(edge));
+        if (target.has_edge(from, to)) {
+            target.destroy_edge(from, to);
+            destroyed.first++;
+        }
+    }
+    for (auto& node_id : masked_nodes) {
+        if (target.has_node(node_id)) {
+            target.destroy_handle(target.get_handle(node_id));
+            destroyed.second++;
+        }
+    }
+    return destroyed;
+}
+
+bool PruningOverlay::has_node(nid_t node_id) const {
+    return graph->has_node(node_id) && !masked_nodes.count(node_id);
+}
+
+handle_t PruningOverlay::get_handle(const nid_t& node_id, bool is_reverse) const {
+    return graph->get_handle(node_id, is_reverse);
+}
+
+nid_t PruningOverlay::get_id(const handle_t& handle) const {
+    return graph->get_id(handle);
+}
+
+bool PruningOverlay::get_is_reverse(const handle_t& handle) const {
+    return graph->get_is_reverse(handle);
+}
+
+handle_t PruningOverlay::flip(const handle_t& handle) const {
+    return graph->flip(handle);
+}
+
+size_t PruningOverlay::get_length(const handle_t& handle) const {
+    return graph->get_length(handle);
+}
+
+string PruningOverlay::get_sequence(const handle_t& handle) const {
+    return graph->get_sequence(handle);
+}
+
+bool PruningOverlay::follow_edges_impl(const handle_t& handle, bool go_left,
+                                       const function<bool(const handle_t&)>& iteratee) const {
+    if (is_masked(handle)) {
+        return true;
+    }
+    return graph->follow_edges(handle, go_left, [&](const handle_t& next) {
+        bool keep_going = true;
+        if (!is_masked(go_left ? edge_t(next, handle) : edge_t(handle, next))) {
+            keep_going = iteratee(next);
+        }
+        return keep_going;
+    });
+}
+
+bool PruningOverlay::for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    return graph->for_each_handle([&](const handle_t& handle) {
+        bool keep_going = true;
+        if (!is_masked(handle)) {
+            keep_going = iteratee(handle);
+        }
+        return keep_going;
+    }, parallel);
+}
+
+size_t PruningOverlay::get_node_count() const {
+    return graph->get_node_count() - masked_nodes.size();
+}
+
+nid_t PruningOverlay::min_node_id() const {
+    return graph->min_node_id();
+}
+
+nid_t PruningOverlay::max_node_id() const {
+    return graph->max_node_id();
+}
+
+handle_t PruningOverlay::get_underlying_handle(const handle_t& handle) const {
+    return handle;
+}
+
+}
@@ -0,0 +1,139 @@
+#ifndef VG_PRUNING_OVERLAY_HPP_INCLUDED
+#define VG_PRUNING_OVERLAY_HPP_INCLUDED
+
+/**
+ * \file pruning_overlay.hpp
+ *
+ * Provides PruningOverlay, a HandleGraph implementation that hides nodes and
+ * edges of a backing graph, so that a graph can be pruned for GCSA indexing
+ * without making a mutable copy of it.
+ */
+
+#include "handle.hpp"
+
+#include <unordered_set>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Present a HandleGraph that is a backing HandleGraph with some nodes and
+ * edges masked out. Masking a node also masks all of its edges, so that
+ * unmasking the node later only brings back the edges that are unmasked
+ * explicitly, as if the node had been deleted and recreated.
+ *
+ * Handles are passed through from the backing graph. The backing graph must
+ * not be modified while the overlay exists. Masking and unmasking are not
+ * thread safe, but the HandleGraph interface is safe to use from multiple
+ * threads as long as nobody is masking anything.
+ */
+class PruningOverlay : public ExpandingOverlayGraph {
+public:
+
+    /// Make a new PruningOverlay over the given graph, with nothing masked.
+    PruningOverlay(const HandleGraph* backing);
+
+    /// Default constructor -- not actually functional
+    PruningOverlay() = default;
+
+    /// Default destructor
+    ~PruningOverlay() = default;
+
+    /// Hide the given node and all of its edges.
+    void mask_node(const handle_t& handle);
+
+    /// Hide the given edge.
+    void mask_edge(const edge_t& edge);
+
+    /// Show the given node again. Its edges stay hidden unless they are
+    /// unmasked themselves.
+    void unmask_node(const handle_t& handle);
+
+    /// Show the given edge again, and the nodes on its ends.
+    void unmask_edge(const edge_t& edge);
+
+    /// Return true if the given node is hidden.
+    bool is_masked(const handle_t& handle) const;
+
+    /// Return true if the given edge, or either node it connects, is hidden.
+    bool is_masked(const edge_t& edge) const;
+
+    /// Delete everything that is hidden in the overlay from the given graph,
+    /// which must be the backing graph, or have the same node IDs and edges.
+    /// Invalidates this overlay, since its backing graph has been modified.
+    /// Returns the number of edges and nodes deleted.
+    pair<size_t, size_t> apply(DeletableHandleGraph& graph) const;
+
+    //////////////////////////
+    /// HandleGraph interface
+    //////////////////////////
+
+    /// Method to check if a node exists by ID
+    bool has_node(nid_t node_id) const;
+
+    /// Look up the handle for the node with the given ID in the given orientation
+    handle_t get_handle(const nid_t& node_id, bool is_reverse = false) const;
+
+    /// Get the ID from a handle
+    nid_t get_id(const handle_t& handle) const;
+
+    /// Get the orientation of a handle
+    bool get_is_reverse(const handle_t& handle) const;
+
+    /// Invert the orientation of a handle (potentially without getting its ID)
+    handle_t flip(const handle_t& handle) const;
+
+    /// Get the length of a node
+    size_t get_length(const handle_t& handle) const;
+
+    /// Get the sequence of a node, presented in the handle's local forward
+    /// orientation.
+    string get_sequence(const handle_t& handle) const;
+
+    /// Loop over all the handles to next/previous (right/left) nodes. Passes
+    /// them to a callback which returns false to stop iterating and true to
+    /// continue. Returns true if we finished and false if we stopped early.
+    bool follow_edges_impl(const handle_t& handle, bool go_left, const function<bool(const handle_t&)>& iteratee) const;
+
+    /// Loop over all the nodes in the graph in their local forward
+    /// orientations, in their internal stored order. Stop if the iteratee
+    /// returns false. Can be told to run in parallel, in which case stopping
+    /// after a false return value is on a best-effort basis and iteration
+    /// order is not defined.
+    bool for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+
+    /// Return the number of nodes in the graph.
+    size_t get_node_count() const;
+
+    /// Return the smallest ID in the graph, or some smaller number if the
+    /// smallest ID is unavailable. Return value is unspecified if the graph is empty.
+    nid_t min_node_id() const;
+
+    /// Return the largest ID in the graph, or some larger number if the
+    /// largest ID is unavailable. Return value is unspecified if the graph is empty.
+    nid_t max_node_id() const;
+
+    ///////////////////////////////////
+    /// ExpandingOverlayGraph interface
+    ///////////////////////////////////
+
+    /// Returns the handle in the underlying graph that corresponds to a handle in the
+    /// overlay
+    handle_t get_underlying_handle(const handle_t& handle) const;
+
+private:
+
+    /// The graph we're masking things in
+    const HandleGraph* graph = nullptr;
+
+    /// The IDs of the hidden nodes
+    unordered_set<nid_t> masked_nodes;
+
+    /// The hidden edges, in the backing graph's canonical orientation
+    unordered_set<edge_t> masked_edges;
+};
+
+}
+
+#endif
@@ -0,0 +1,13 @@
+/** \file
+ * qual_adj_dozeu_kernels_avx2.cpp: Quality adjusted dozeu kernels built for
+ * AVX2. The Makefile adds -mavx2 when compiling this file.
+ */
+
+#if defined(__x86_64__)
+
+#define DZ_QUAL_ADJ
+#define DOZEU_KERNELS_TABLE qual_adj_dozeu_kernels_avx2
+#define DOZEU_KERNELS_ISA "avx2"
+#include "dozeu_kernels_body.hpp"
+
+#endif
@@ -0,0 +1,14 @@
+/** \file
+ * qual_adj_dozeu_kernels_avx512.cpp: Quality adjusted dozeu kernels built for
+ * AVX-512. The Makefile adds -mavx512f -mavx512bw -mavx512vl when compiling
+ * this file.
+ */
+
+#if defined(__x86_64__)
+
+#define DZ_QUAL_ADJ
+#define DOZEU_KERNELS_TABLE qual_adj_dozeu_kernels_avx512
+#define DOZEU_KERNELS_ISA "avx512"
+#include "dozeu_kernels_body.hpp"
+
+#endif
@@ -0,0 +1,10 @@
+/** \file
+ * qual_adj_dozeu_kernels_base.cpp: Quality adjusted dozeu kernels built for
+ * the baseline instruction set: SSE4.2 on x86-64, or NEON (through SIMDe) on
+ * ARM.
+ */
+
+#define DZ_QUAL_ADJ
+#define DOZEU_KERNELS_TABLE qual_adj_dozeu_kernels_base
+#define DOZEU_KERNELS_ISA "base"
+#include "dozeu_kernels_body.hpp"
@@ -2,6 +2,7 @@
  * \file qual_adj_xdrop_aliigner.cpp: contains implementation of QualAdjXdropAligner
  */
 #include "dozeu_interface.hpp"
+#include "dozeu_kernels.hpp"
 
 // Configure dozeu:
 // We want the full length bonus included
@@ -22,6 +23,11 @@ enum { MISMATCH = 1, MATCH = 2, INS = 3, DEL = 4 };
 #include <dozeu/dozeu.h>
 
 using namespace vg;
+
+/// Get the fastest build of the dozeu functions that this CPU supports
+static inline const DozeuKernels& kernels() {
+    return get_dozeu_kernels(true);
+}
  
 QualAdjXdropAligner::QualAdjXdropAligner(const QualAdjXdropAligner& other)
 {
@@ -33,7 +39,7 @@ QualAdjXdropAligner& QualAdjXdropAligner::operator=(const QualAdjXdropAligner& o
 	if (this != &other) {
 
         if (dz) {
-            dz_destroy(dz);
+            kernels().destroy(dz);
         }
         
         // TODO: a bit of an arcane step
@@ -43,10 +49,10 @@ QualAdjXdropAligner& QualAdjXdropAligner::operator=(const QualAdjXdropAligner& o
             qual_adj_matrix[i] = dz_qual_matrix(other.dz)[(i / 16) * 32 + (i % 16)];
         }
         
-        dz = dz_qual_adj_init(other.dz->matrix,
-                              qual_adj_matrix,
-                              *((const uint16_t*) &other.dz->giv),
-                              *((const uint16_t*) &other.dz->gev));
+        dz = kernels().init(other.dz->matrix,
+                            qual_adj_matrix,
+                            *((const uint16_t*) &other.dz->giv),
+                            *((const uint16_t*) &other.dz->gev));
         
         free(qual_adj_matrix);
     }
@@ -62,7 +68,7 @@ QualAdjXdropAligner& QualAdjXdropAligner::operator=(QualAdjXdropAligner&& other)
 {
 	if (this != &other) {
         if (dz) {
-            dz_destroy(dz);
+            kernels().destroy(dz);
         }
         dz = other.dz;
         other.dz = nullptr;
@@ -92,45 +98,45 @@ QualAdjXdropAligner::QualAdjXdropAligner(const int8_t* _score_matrix,
         }
     }
     
-    dz = dz_qual_adj_init(_score_matrix, qual_adj_scores_4x4, _gap_open - _gap_extension,
-                          _gap_extension);
+    dz = kernels().init(_score_matrix, qual_adj_scores_4x4, _gap_open - _gap_extension,
+                        _gap_extension);
     
     free(qual_adj_scores_4x4);
 }
 
 QualAdjXdropAligner::~QualAdjXdropAligner(void)
 {
-    dz_destroy(dz);
+    kernels().destroy(dz);
 }
 
 dz_query_s* QualAdjXdropAligner::pack_query_forward(const char* seq, const uint8_t* qual,
                                                     int8_t full_length_bonus, size_t len) {
-    return dz_qual_adj_pack_query_forward(dz, seq, qual, full_length_bonus, len);
+    return kernels().pack_query_forward(dz, seq, qual, full_length_bonus, len);
 }
 
 dz_query_s* QualAdjXdropAligner::pack_query_reverse(const char* seq, const uint8_t* qual,
                                                     int8_t full_length_bonus, size_t len) {
-    return dz_qual_adj_pack_query_reverse(dz, seq, qual, full_length_bonus, len);
+    return kernels().pack_query_reverse(dz, seq, qual, full_length_bonus, len);
 }
 
 const dz_forefront_s* QualAdjXdropAligner::scan(const dz_query_s* query, const dz_forefront_s** forefronts,
                                          size_t n_forefronts, const char* ref, int32_t rlen,
                                          uint32_t rid, uint16_t xt) {
-    return dz_qual_adj_scan(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
+    return kernels().scan(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
 }
 
 const dz_forefront_s* QualAdjXdropAligner::extend(const dz_query_s* query, const dz_forefront_s** forefronts,
                                            size_t n_forefronts, const char* ref, int32_t rlen,
                                            uint32_t rid, uint16_t xt) {
-    return dz_qual_adj_extend(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
+    return kernels().extend(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
 }
 
 dz_alignment_s* QualAdjXdropAligner::trace(const dz_forefront_s* forefront) {
-    return dz_qual_adj_trace(dz, forefront);
+    return kernels().trace(dz, forefront);
 }
 
 void QualAdjXdropAligner::flush() {
-    dz_qual_adj_flush(dz);
+    kernels().flush(dz);
 }
 
 /**
@@ -12,19 +12,32 @@ void RareVariantSimplifier::simplify() {
     // This holds the IDs of all the nodes we want to keep around
     unordered_set<id_t> to_keep;
 
+    vector<path_handle_t> ref_paths;
     graph.for_each_path_handle([&](const path_handle_t& path) {
         // For each path
         
         if (!Paths::is_alt(graph.get_path_name(path))) {
             // If it isn't an alt path, we want to trace it
-
-            // For each occurrence from start to end
-            // Put the ID of the node we are visiting in the to-keep set
-            for (handle_t handle : graph.scan_path(path)) {
-                to_keep.insert(graph.get_id(handle));
-            }
+            ref_paths.push_back(path);
         }
     });
+    
+    // Trace the paths in parallel, since there can be a lot of them
+    vector<vector<id_t>> thread_visited(get_thread_count());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < ref_paths.size(); i++) {
+        auto& visited = thread_visited[omp_get_thread_num()];
+        // For each occurrence from start to end
+        // Remember the ID of the node we are visiting
+        for (handle_t handle : graph.scan_path(ref_paths[i])) {
+            visited.push_back(graph.get_id(handle));
+        }
+    }
+    for (auto& visited : thread_visited) {
+        // Put them all in the to-keep set
+        to_keep.insert(visited.begin(), visited.end());
+        vector<id_t>().swap(visited);
+    }
 
     variant_source.fill_buffer();
     while(variant_source.get() != nullptr) {
@@ -172,12 +185,23 @@ void RareVariantSimplifier::simplify() {
         variant_source.fill_buffer();
     }
     
+    // After going through all the variants, find all nodes that aren't to-keep
+    vector<vector<id_t>> thread_doomed(get_thread_count());
     graph.for_each_handle([&](const handle_t& handle) {
-        // After going through all the variants, delete all nodes that aren't to-keep
         if (!to_keep.count(graph.get_id(handle))) {
-            graph.destroy_handle(handle);
+            thread_doomed[omp_get_thread_num()].push_back(graph.get_id(handle));
         }
-    });
+    }, true);
+    
+    // And delete them, in a consistent order
+    vector<id_t> doomed;
+    for (auto& ids : thread_doomed) {
+        doomed.insert(doomed.end(), ids.begin(), ids.end());
+    }
+    sort(doomed.begin(), doomed.end());
+    for (id_t id : doomed) {
+        graph.destroy_handle(graph.get_handle(id));
+    }
 }
 
 }
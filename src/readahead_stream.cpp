@@ -0,0 +1,253 @@
+/**
+ * \file readahead_stream.cpp
+ * Implementation for reading large files ahead of their parsers
+ */
+
+#include "readahead_stream.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace vg {
+
+using namespace std;
+
+const size_t ReadaheadInputStream::DEFAULT_CHUNK_SIZE = 8 << 20;
+const size_t ReadaheadInputStream::DEFAULT_MAX_CHUNKS = 4;
+bool ReadaheadInputStream::report_bandwidth = getenv("VG_REPORT_READ_BANDWIDTH") != nullptr;
+
+/// Stream buffer that hands out the chunks a background thread reads.
+class ReadaheadInputStream::Buffer : public streambuf {
+public:
+    Buffer(const string& filename, size_t chunk_size, size_t max_chunks) :
+        filename(filename), chunk_size(chunk_size), max_chunks(max_chunks),
+        start_time(chrono::steady_clock::now()) {
+
+        fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat file_stats;
+        if (fstat(fd, &file_stats) == 0) {
+            file_size = file_stats.st_size;
+        }
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        start_reader(0);
+    }
+
+    ~Buffer() {
+        if (fd < 0) {
+            return;
+        }
+        stop_reader();
+        close(fd);
+
+        if (report_bandwidth) {
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+            double megabytes = bytes_read / (1024.0 * 1024.0);
+            cerr << "[ReadaheadInputStream] read " << megabytes << " MB from " << filename << " in "
+                 << seconds << " s (" << (seconds > 0 ? megabytes / seconds : 0.0) << " MB/s)" << endl;
+        }
+    }
+
+    bool is_open() const {
+        return fd >= 0;
+    }
+
+protected:
+    int_type underflow() {
+        if (fd < 0) {
+            return traits_type::eof();
+        }
+
+        unique_lock<mutex> lock(queue_mutex);
+        queue_not_empty.wait(lock, [&]() {
+            return !queue.empty();
+        });
+        if (queue.front().empty()) {
+            // The reader hit the end of the file, and leaves the marker for
+            // anyone who asks again.
+            return traits_type::eof();
+        }
+        current_start += current.size();
+        current.swap(queue.front());
+        if (queue.front().capacity() > 0) {
+            // Give our old chunk back to be refilled
+            free_chunks.emplace_back(std::move(queue.front()));
+        }
+        queue.pop_front();
+        lock.unlock();
+        queue_not_full.notify_one();
+
+        setg(current.data(), current.data(), current.data() + current.size());
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pos_type seekoff(off_type offset, ios_base::seekdir direction, ios_base::openmode which) {
+        if (fd < 0 || !(which & ios_base::in)) {
+            return pos_type(off_type(-1));
+        }
+        off_type here = current_start + (gptr() - eback());
+        off_type target = offset + (direction == ios_base::beg ? 0 : (direction == ios_base::cur ? here : (off_type) file_size));
+        if (target < 0 || target > (off_type) file_size) {
+            return pos_type(off_type(-1));
+        }
+        if (target >= current_start && target <= current_start + (off_type) current.size()) {
+            // We already have this position
+            setg(current.data(), current.data() + (target - current_start), current.data() + current.size());
+        } else {
+            // Start reading again from the new position
+            stop_reader();
+            current.clear();
+            setg(current.data(), current.data(), current.data());
+            start_reader(target);
+        }
+        return pos_type(target);
+    }
+
+    pos_type seekpos(pos_type position, ios_base::openmode which) {
+        return seekoff(off_type(position), ios_base::beg, which);
+    }
+
+private:
+
+    /// Start the reader thread at the given file offset, with nothing
+    /// queued.
+    void start_reader(size_t offset) {
+        current_start = offset;
+        stopping = false;
+        reader = thread([this, offset]() {
+            read_loop(offset);
+        });
+    }
+
+    /// Stop the reader thread and throw out whatever it queued.
+    void stop_reader() {
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            stopping = true;
+        }
+        queue_not_full.notify_all();
+        reader.join();
+        while (!queue.empty()) {
+            if (!queue.front().empty()) {
+                free_chunks.emplace_back(std::move(queue.front()));
+            }
+            queue.pop_front();
+        }
+    }
+
+    /// Main loop for the reader thread.
+    void read_loop(size_t offset) {
+        while (true) {
+            vector<char> chunk;
+            {
+                unique_lock<mutex> lock(queue_mutex);
+                queue_not_full.wait(lock, [&]() {
+                    return stopping || queue.size() < max_chunks;
+                });
+                if (stopping) {
+                    return;
+                }
+                if (!free_chunks.empty()) {
+                    chunk = std::move(free_chunks.back());
+                    free_chunks.pop_back();
+                }
+            }
+
+            chunk.resize(chunk_size);
+            size_t filled = 0;
+            while (filled < chunk_size) {
+                ssize_t got = pread(fd, chunk.data() + filled, chunk_size - filled, offset + filled);
+                if (got < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    cerr << "error:[ReadaheadInputStream] could not read " << filename << ": " << strerror(errno) << endl;
+                    exit(1);
+                }
+                if (got == 0) {
+                    break;
+                }
+                filled += got;
+            }
+            chunk.resize(filled);
+            offset += filled;
+
+            {
+                lock_guard<mutex> lock(queue_mutex);
+                bytes_read += filled;
+                // An empty chunk marks the end of the file
+                queue.emplace_back(std::move(chunk));
+            }
+            queue_not_empty.notify_one();
+            if (filled == 0) {
+                return;
+            }
+        }
+    }
+
+    string filename;
+    int fd = -1;
+    size_t file_size = 0;
+    size_t chunk_size;
+    size_t max_chunks;
+
+    /// The chunk the parser is reading
+    vector<char> current;
+    /// Where current starts in the file
+    off_type current_start = 0;
+
+    /// Chunks read but not yet handed out
+    deque<vector<char>> queue;
+    /// Chunks the reader can reuse
+    vector<vector<char>> free_chunks;
+    /// Set when the reader thread should stop
+    bool stopping = false;
+    mutex queue_mutex;
+    condition_variable queue_not_empty;
+    condition_variable queue_not_full;
+    thread reader;
+
+    /// For reporting bandwidth
+    size_t bytes_read = 0;
+    chrono::steady_clock::time_point start_time;
+};
+
+ReadaheadInputStream::ReadaheadInputStream(const string& filename, size_t chunk_size, size_t max_chunks) :
+    istream(nullptr), buffer(new Buffer(filename, chunk_size, max_chunks)) {
+    rdbuf(buffer.get());
+    if (!buffer->is_open()) {
+        setstate(ios_base::failbit);
+    }
+}
+
+ReadaheadInputStream::~ReadaheadInputStream() {
+    // Defined here where the Buffer is complete.
+}
+
+bool ReadaheadInputStream::is_open() const {
+    return buffer->is_open();
+}
+
+bool ReadaheadInputStream::can_read(const string& filename) {
+    struct stat info;
+    return filename != "-" && stat(filename.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+}
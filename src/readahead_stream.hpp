@@ -0,0 +1,63 @@
+#ifndef VG_READAHEAD_STREAM_HPP_INCLUDED
+#define VG_READAHEAD_STREAM_HPP_INCLUDED
+
+/**
+ * \file readahead_stream.hpp
+ *
+ * Defines an input stream for large regular files that keeps a background
+ * thread reading big chunks ahead of the parser.
+ */
+
+#include <istream>
+#include <memory>
+#include <string>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * An input stream over a regular file, where a background thread reads
+ * chunk_size bytes at a time with pread(), keeping up to max_chunks chunks
+ * ahead of whatever is parsing (and maybe decompressing) the stream. The
+ * kernel is told the file will be read sequentially.
+ *
+ * Seeking is supported; seeks outside the chunk being read restart the
+ * reader at the new position.
+ *
+ * If report_bandwidth is set, the amount read and the bandwidth achieved are
+ * reported to standard error when the stream is destroyed.
+ */
+class ReadaheadInputStream : public istream {
+public:
+    /// Open the given file. If it can't be opened, the stream is not
+    /// is_open() and has its fail bit set.
+    ReadaheadInputStream(const string& filename, size_t chunk_size = DEFAULT_CHUNK_SIZE,
+                         size_t max_chunks = DEFAULT_MAX_CHUNKS);
+    ~ReadaheadInputStream();
+
+    /// Return true if the file was opened.
+    bool is_open() const;
+
+    /// Return true if the named file is a regular file, which this stream
+    /// can read. Pipes and standard input ("-") can't be read with pread().
+    static bool can_read(const string& filename);
+
+    /// How much do we read at a time by default?
+    static const size_t DEFAULT_CHUNK_SIZE;
+    /// How many chunks can we read ahead by default?
+    static const size_t DEFAULT_MAX_CHUNKS;
+
+    /// Should streams report their bandwidth when they are destroyed?
+    /// Defaults to true if the VG_REPORT_READ_BANDWIDTH environment variable
+    /// is set.
+    static bool report_bandwidth;
+
+private:
+    class Buffer;
+    unique_ptr<Buffer> buffer;
+};
+
+}
+
+#endif
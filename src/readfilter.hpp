@@ -14,9 +14,15 @@
 #include "IntervalTree.h"
 #include "annotation.hpp"
 #include "multipath_alignment_emitter.hpp"
+#include "columnar_alignments.hpp"
 #include <vg/io/alignment_emitter.hpp>
 #include <vg/vg.pb.h>
 #include <vg/io/stream.hpp>
+#include <vg/io/message_iterator.hpp>
+#include <vg/io/registry.hpp>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
 
 #include <htslib/khash.h>
 
@@ -181,6 +187,11 @@ private:
      */
     bool sample_read(const Read& read) const;
     
+    /**
+     * Sample a read by name, as above, given whether it is paired.
+     */
+    bool sample_read(const string& name, bool is_paired) const;
+    
     /**
      * Convert a multipath alignment to a single path
      */
@@ -196,6 +207,11 @@ private:
      */
     bool matches_name(const Read& read) const;
     
+    /**
+     * Does the name have one of the indicated prefixes?
+     */
+    bool matches_name(const string& name) const;
+    
     /**
      * Does the read match one of the excluded refpos contigs?
      */
@@ -289,6 +305,39 @@ private:
     
     /// Helper function for filter
     void filter_internal(istream* in);
+    
+    /**
+     * Can we reject reads on their serialized bytes with
+     * passes_raw_filters(), before parsing them? This is only safe if
+     * rejected reads are not emitted or counted.
+     */
+    bool can_prefilter() const;
+    
+    /**
+     * Check the cheap filters (name prefixes, mapping quality, and
+     * downsampling) on a serialized read without parsing all of it. Returns
+     * false only if filter_alignment() would reject the read. Reads that are
+     * not understood pass.
+     */
+    bool passes_raw_filters(const string& serialized) const;
+    
+    /**
+     * Call the lambda on every read in the stream that passes the raw
+     * filters. The main thread decompresses batches of serialized reads while
+     * the other threads check, parse, and filter the reads in previous
+     * batches.
+     */
+    void for_each_prefiltered(istream& in, const function<void(Read&)>& lambda);
+    
+    /// How many serialized reads go in each batch for for_each_prefiltered()
+    static const size_t PREFILTER_BATCH_SIZE = 1024;
+    
+    /**
+     * If the stream is a columnar GAMC file of reads of our type, call the
+     * lambda on every read in it in parallel and return true. Otherwise,
+     * return false without reading anything.
+     */
+    bool for_each_columnar(istream& in, const function<void(Read&)>& lambda);
 };
 
 // Keep some basic counts for when verbose mode is enabled
@@ -399,6 +448,10 @@ void ReadFilter<Read>::filter_internal(istream* in) {
     
     if (interleaved) {
         vg::io::for_each_interleaved_pair_parallel(*in, pair_lambda);
+    } else if (for_each_columnar(*in, lambda)) {
+        // The reads came from a GAMC file.
+    } else if (can_prefilter()) {
+        for_each_prefiltered(*in, lambda);
     } else {
         vg::io::for_each_parallel(*in, lambda);
     }
@@ -412,6 +465,139 @@ void ReadFilter<Read>::filter_internal(istream* in) {
     }
 }
 
+template<typename Read>
+bool ReadFilter<Read>::can_prefilter() const {
+    // We only know how to look inside serialized Alignments.
+    return false;
+}
+
+template<>
+inline bool ReadFilter<Alignment>::can_prefilter() const {
+    // Rejected reads must not be needed for output or for counts, and there
+    // must be a filter to push down.
+    return !complement_filter && !verbose
+        && (!name_prefixes.empty() || min_mapq > 0 || downsample_probability != 1.0);
+}
+
+template<typename Read>
+bool ReadFilter<Read>::for_each_columnar(istream& in, const function<void(Read&)>& lambda) {
+    // Only Alignments can be stored in columns.
+    return false;
+}
+
+template<>
+inline bool ReadFilter<Alignment>::for_each_columnar(istream& in, const function<void(Alignment&)>& lambda) {
+    if (!is_gamc_stream(in)) {
+        return false;
+    }
+    for_each_gamc_parallel(in, lambda);
+    return true;
+}
+
+template<typename Read>
+bool ReadFilter<Read>::passes_raw_filters(const string& serialized) const {
+    return true;
+}
+
+template<>
+inline bool ReadFilter<Alignment>::passes_raw_filters(const string& serialized) const {
+    using google::protobuf::internal::WireFormatLite;
+    
+    google::protobuf::io::CodedInputStream coded_in((const uint8_t*) serialized.data(), serialized.size());
+    
+    // Fields we don't see have their default values.
+    string name;
+    uint32_t mapping_quality = 0;
+    // If either fragment is set, we would need to parse it to know if the read is paired.
+    bool maybe_paired = false;
+    
+    uint32_t tag;
+    while ((tag = coded_in.ReadTag()) != 0) {
+        int field = WireFormatLite::GetTagFieldNumber(tag);
+        WireFormatLite::WireType wire_type = WireFormatLite::GetTagWireType(tag);
+        bool ok;
+        if (field == Alignment::kNameFieldNumber && wire_type == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+            ok = WireFormatLite::ReadString(&coded_in, &name);
+        } else if (field == Alignment::kMappingQualityFieldNumber && wire_type == WireFormatLite::WIRETYPE_VARINT) {
+            ok = coded_in.ReadVarint32(&mapping_quality);
+        } else {
+            if (field == Alignment::kFragmentPrevFieldNumber || field == Alignment::kFragmentNextFieldNumber) {
+                maybe_paired = true;
+            }
+            ok = WireFormatLite::SkipField(&coded_in, tag);
+        }
+        if (!ok) {
+            // Leave the problem to the real parser.
+            return true;
+        }
+    }
+    
+    if (!name_prefixes.empty() && !matches_name(name)) {
+        return false;
+    }
+    if (min_mapq > 0 && (int32_t) mapping_quality < min_mapq) {
+        return false;
+    }
+    if (downsample_probability != 1.0 && !maybe_paired && !sample_read(name, false)) {
+        return false;
+    }
+    return true;
+}
+
+template<typename Read>
+void ReadFilter<Read>::for_each_prefiltered(istream& in, const function<void(Read&)>& lambda) {
+    vg::io::MessageIterator input_iterator(in);
+    const string& read_tag = vg::io::Registry::get_protobuf_tag<Read>();
+    
+    // Don't let the reader get too far ahead of the workers.
+    size_t max_outstanding = 2 * threads;
+    size_t outstanding = 0;
+    
+    #pragma omp parallel num_threads(threads)
+    {
+        #pragma omp single
+        {
+            while (input_iterator.has_current()) {
+                auto batch = make_shared<vector<string>>();
+                batch->reserve(PREFILTER_BATCH_SIZE);
+                while (input_iterator.has_current() && batch->size() < PREFILTER_BATCH_SIZE) {
+                    auto tagged = input_iterator.take();
+                    if (tagged.second && (tagged.first.empty() || tagged.first == read_tag)) {
+                        batch->emplace_back(std::move(*tagged.second));
+                    }
+                }
+                
+                size_t currently_outstanding;
+                #pragma omp atomic capture
+                currently_outstanding = ++outstanding;
+                
+                // If the workers are behind, the reader does this batch itself.
+                #pragma omp task firstprivate(batch) shared(outstanding) if(currently_outstanding <= max_outstanding)
+                {
+                    Read read;
+                    for (auto& serialized : *batch) {
+                        if (!passes_raw_filters(serialized)) {
+                            continue;
+                        }
+                        read.Clear();
+                        if (!read.ParseFromString(serialized)) {
+                            #pragma omp critical (cerr)
+                            {
+                                cerr << "error[vg filter]: could not parse a " << read_tag << " message" << endl;
+                                exit(1);
+                            }
+                        }
+                        lambda(read);
+                    }
+                    #pragma omp atomic update
+                    --outstanding;
+                }
+            }
+            #pragma omp taskwait
+        }
+    }
+}
+
 template<>
 inline int ReadFilter<Alignment>::filter(istream* alignment_stream) {
     
@@ -685,6 +871,11 @@ inline double ReadFilter<MultipathAlignment>::get_score(const MultipathAlignment
 
 template<typename Read>
 bool ReadFilter<Read>::matches_name(const Read& aln) const {
+    return matches_name(aln.name());
+}
+
+template<typename Read>
+bool ReadFilter<Read>::matches_name(const string& name) const {
     bool keep = true;
     // filter (current) alignment
     if (!name_prefixes.empty()) {
@@ -697,8 +888,8 @@ bool ReadFilter<Read>::matches_name(const Read& aln) const {
         size_t left_bound = 0;
         size_t left_match = 0;
         while (left_match < name_prefixes[left_bound].size() &&
-               left_match < aln.name().size() &&
-               name_prefixes[left_bound][left_match] == aln.name()[left_match]) {
+               left_match < name.size() &&
+               name_prefixes[left_bound][left_match] == name[left_match]) {
             // Scan all the matches at the start
             left_match++;
         }
@@ -706,8 +897,8 @@ bool ReadFilter<Read>::matches_name(const Read& aln) const {
         size_t right_bound = name_prefixes.size() - 1;
         size_t right_match = 0;
         while (right_match < name_prefixes[right_bound].size() &&
-               right_match < aln.name().size() &&
-               name_prefixes[right_bound][right_match] == aln.name()[right_match]) {
+               right_match < name.size() &&
+               name_prefixes[right_bound][right_match] == name[right_match]) {
             // Scan all the matches at the end
             right_match++;
         }
@@ -723,8 +914,8 @@ bool ReadFilter<Read>::matches_name(const Read& aln) const {
                 size_t center_match = min(left_match, right_match);
                 
                 while (center_match < name_prefixes[center].size() &&
-                       center_match < aln.name().size() &&
-                       name_prefixes[center][center_match] == aln.name()[center_match]) {
+                       center_match < name.size() &&
+                       name_prefixes[center][center_match] == name[center_match]) {
                     // Scan all the matches here
                     center_match++;
                 }
@@ -735,8 +926,8 @@ bool ReadFilter<Read>::matches_name(const Read& aln) const {
                     break;
                 }
                 
-                if (center_match == aln.name().size() ||
-                    name_prefixes[center][center_match] > aln.name()[center_match]) {
+                if (center_match == name.size() ||
+                    name_prefixes[center][center_match] > name[center_match]) {
                     // The match, if it exists, must be before us
                     right_bound = center;
                     right_match = center_match;
@@ -1465,16 +1656,19 @@ template<typename Read>
 bool ReadFilter<Read>::sample_read(const Read& read) const {
     // Decide if the alignment is paired.
     // It is paired if fragment_next or fragment_prev point to something.
-    bool is_paired = get_is_paired(read);
-    
+    return sample_read(read.name(), get_is_paired(read));
+}
+
+template<typename Read>
+bool ReadFilter<Read>::sample_read(const string& name, bool is_paired) const {
     // Compute the QNAME that samtools would use
     string qname;
     if (is_paired) {
         // Strip pair end identifiers like _1 or /2 that vg uses at the end of the name.
-        qname = regex_replace(read.name(), regex("[/_][12]$"), "");
+        qname = regex_replace(name, regex("[/_][12]$"), "");
     } else {
         // Any _1 in the name is part of the actual read name.
-        qname = read.name();
+        qname = name;
     }
     
     // Now treat it as samtools would.
@@ -1,13 +1,17 @@
 #include "recombinator.hpp"
 
+#include "alignment.hpp"
 #include "kff.hpp"
 #include "statistics.hpp"
 #include "algorithms/component.hpp"
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <map>
 
+#include <omp.h>
+
 namespace vg {
 
 //------------------------------------------------------------------------------
@@ -22,6 +26,9 @@ constexpr std::uint64_t Haplotypes::Header::DEFAULT_K;
 constexpr size_t HaplotypePartitioner::SUBCHAIN_LENGTH;
 constexpr size_t HaplotypePartitioner::APPROXIMATE_JOBS;
 
+constexpr double KmerCounts::GAMMA;
+constexpr size_t KmerCounts::NOT_FOUND;
+
 constexpr size_t Recombinator::NUM_HAPLOTYPES;
 constexpr size_t Recombinator::NUM_CANDIDATES;
 constexpr size_t Recombinator::COVERAGE;
@@ -40,43 +47,105 @@ std::string to_string(handle_t handle) {
 
 //------------------------------------------------------------------------------
 
-hash_map<Haplotypes::Subchain::kmer_type, size_t>::iterator
-find_kmer(hash_map<Haplotypes::Subchain::kmer_type, size_t>& counts, Haplotypes::Subchain::kmer_type kmer, size_t k) {
-    Haplotypes::Subchain::kmer_type rc = minimizer_reverse_complement(kmer, k);
-    auto forward = counts.find(kmer);
-    auto reverse = counts.find(rc);
-    return (forward != counts.end() ? forward : reverse);
+KmerCounts::KmerCounts(std::vector<kmer_type>& kmer_set) {
+    gbwt::removeDuplicates(kmer_set, true);
+    if (kmer_set.empty()) {
+        return;
+    }
+
+    // Build the hash function and store the kmers in the order it gives them.
+    this->mphf.reset(new mphf_type(kmer_set.size(), kmer_set, omp_get_max_threads(), GAMMA, false, false));
+    this->kmers.resize(kmer_set.size());
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < kmer_set.size(); i++) {
+        this->kmers[this->mphf->lookup(kmer_set[i])] = kmer_set[i];
+    }
+    this->counts.resize(kmer_set.size(), 0);
 }
 
-hash_map<Haplotypes::Subchain::kmer_type, size_t> Haplotypes::kmer_counts(const std::string& kff_file, Verbosity verbosity) const {
-    double start = gbwt::readTimer();
-    if (verbosity >= verbosity_basic) {
-        std::cerr << "Reading kmer counts" << std::endl;
+size_t KmerCounts::find(kmer_type kmer) const {
+    if (this->empty()) {
+        return NOT_FOUND;
     }
+    // The hash function maps kmers not in the table to arbitrary slots, so we
+    // have to check that we got the right one.
+    uint64_t slot = this->mphf->lookup(kmer);
+    if (slot >= this->size() || this->kmers[slot] != kmer) {
+        return NOT_FOUND;
+    }
+    return slot;
+}
 
-    // Open and validate the kmer count file.
-    ParallelKFFReader reader(kff_file);
+size_t KmerCounts::at(kmer_type kmer) const {
+    size_t slot = this->find(kmer);
+    if (slot == NOT_FOUND) {
+        throw std::out_of_range("KmerCounts::at(): kmer not in the table");
+    }
+    return this->counts[slot];
+}
 
-    // Populate the map with the kmers we are interested in.
-    double checkpoint = gbwt::readTimer();
-    hash_map<Subchain::kmer_type, size_t> result;
-    result.reserve(this->header.total_kmers);
+void KmerCounts::add(size_t slot, size_t count) {
+    #pragma omp atomic
+    this->counts[slot] += count;
+}
+
+size_t KmerCounts::find_either(kmer_type kmer, size_t k) const {
+    size_t slot = this->find(kmer);
+    if (slot == NOT_FOUND) {
+        slot = this->find(minimizer_reverse_complement(kmer, k));
+    }
+    return slot;
+}
+
+void KmerCounts::clear() {
+    std::fill(this->counts.begin(), this->counts.end(), 0);
+}
+
+KmerCounts Haplotypes::kmer_table(Verbosity verbosity) const {
+    double start = gbwt::readTimer();
+    std::vector<KmerCounts::kmer_type> kmers;
+    kmers.reserve(this->header.total_kmers);
     for (size_t chain_id = 0; chain_id < this->chains.size(); chain_id++) {
         const TopLevelChain& chain = this->chains[chain_id];
         for (size_t subchain_id = 0; subchain_id < chain.subchains.size(); subchain_id++) {
             const Subchain& subchain = chain.subchains[subchain_id];
             for (size_t kmer_id = 0; kmer_id < subchain.kmers.size(); kmer_id++) {
-                result[subchain.kmers[kmer_id].first] = 0;
+                kmers.push_back(subchain.kmers[kmer_id].first);
             }
         }
     }
+    KmerCounts result(kmers);
     if (verbosity >= verbosity_detailed) {
-        double seconds = gbwt::readTimer() - checkpoint;
-        std::cerr << "Initialized the hash map with " << result.size() << " kmers in " << seconds << " seconds" << std::endl;
+        double seconds = gbwt::readTimer() - start;
+        std::cerr << "Initialized the kmer table with " << result.size() << " kmers in " << seconds << " seconds" << std::endl;
     }
+    return result;
+}
+
+KmerCounts Haplotypes::kmer_counts(const std::string& kff_file, Verbosity verbosity) const {
+    // Open and validate the kmer count file before doing anything expensive.
+    ParallelKFFReader reader(kff_file);
+
+    // Populate the table with the kmers we are interested in.
+    KmerCounts result = this->kmer_table(verbosity);
+    this->kmer_counts(reader, result, verbosity);
+    return result;
+}
+
+void Haplotypes::kmer_counts(const std::string& kff_file, KmerCounts& result, Verbosity verbosity) const {
+    ParallelKFFReader reader(kff_file);
+    this->kmer_counts(reader, result, verbosity);
+}
+
+void Haplotypes::kmer_counts(ParallelKFFReader& reader, KmerCounts& result, Verbosity verbosity) const {
+    double start = gbwt::readTimer();
+    if (verbosity >= verbosity_basic) {
+        std::cerr << "Reading kmer counts" << std::endl;
+    }
+    result.clear();
 
     // Read the KFF file and add the counts using multiple threads.
-    checkpoint = gbwt::readTimer();
+    double checkpoint = gbwt::readTimer();
     size_t kmer_count = 0;
     #pragma omp parallel
     {
@@ -87,20 +156,14 @@ hash_map<Haplotypes::Subchain::kmer_type, size_t> Haplotypes::kmer_counts(const
                 if (block.empty()) {
                     break;
                 }
-                std::vector<std::pair<hash_map<Subchain::kmer_type, size_t>::iterator, size_t>> buffer;
                 for (auto kmer : block) {
-                    auto iter = find_kmer(result, kmer.first, this->k());
-                    if (iter != result.end()) {
-                        buffer.push_back({ iter, kmer.second });
-                    }
-                }
-                #pragma omp critical
-                {
-                    for (auto to_update : buffer) {
-                        to_update.first->second += to_update.second;
+                    size_t slot = result.find_either(kmer.first, this->k());
+                    if (slot != KmerCounts::NOT_FOUND) {
+                        result.add(slot, kmer.second);
                     }
-                    kmer_count += block.size();
                 }
+                #pragma omp atomic
+                kmer_count += block.size();
             }
         }
     }
@@ -113,9 +176,90 @@ hash_map<Haplotypes::Subchain::kmer_type, size_t> Haplotypes::kmer_counts(const
         double seconds = gbwt::readTimer() - start;
         std::cerr << "Read the kmer counts in " << seconds << " seconds" << std::endl;
     }
+}
+
+// Returns the 2-bit code of the base in the minimizer index encoding, or 4 if
+// the character is not a base.
+inline Haplotypes::Subchain::kmer_type pack_base(char c) {
+    switch (c) {
+    case 'A': case 'a':
+        return 0;
+    case 'C': case 'c':
+        return 1;
+    case 'G': case 'g':
+        return 2;
+    case 'T': case 't':
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+KmerCounts Haplotypes::kmer_counts_from_reads(const std::vector<std::string>& read_files, Verbosity verbosity) const {
+    // Populate the table with the kmers we are interested in. Only the counts
+    // are modified after this, so it is safe to search it from multiple threads.
+    KmerCounts result = this->kmer_table(verbosity);
+    this->kmer_counts_from_reads(read_files, result, verbosity);
     return result;
 }
 
+void Haplotypes::kmer_counts_from_reads(const std::vector<std::string>& read_files, KmerCounts& result, Verbosity verbosity) const {
+    double start = gbwt::readTimer();
+    if (verbosity >= verbosity_basic) {
+        std::cerr << "Counting kmers in the reads" << std::endl;
+    }
+    result.clear();
+
+    // Count the occurrences of those kmers in the reads using multiple threads.
+    // We do not store the other kmers, so we need no external counter.
+    size_t k = this->k();
+    Subchain::kmer_type mask = (Subchain::kmer_type(1) << (2 * k)) - 1;
+    size_t rc_shift = 2 * (k - 1);
+    for (const std::string& filename : read_files) {
+        double checkpoint = gbwt::readTimer();
+        size_t kmer_count = 0;
+        size_t read_count = fastq_unpaired_for_each_parallel(filename, [&](Alignment& aln) {
+            const std::string& sequence = aln.sequence();
+            Subchain::kmer_type forward = 0, reverse = 0;
+            size_t valid_chars = 0, found = 0;
+            for (char c : sequence) {
+                Subchain::kmer_type packed = pack_base(c);
+                if (packed > 3) {
+                    valid_chars = 0;
+                    forward = 0;
+                    reverse = 0;
+                    continue;
+                }
+                forward = ((forward << 2) | packed) & mask;
+                reverse = (reverse >> 2) | ((packed ^ 3) << rc_shift);
+                valid_chars++;
+                if (valid_chars < k) {
+                    continue;
+                }
+                size_t slot = result.find(forward);
+                if (slot == KmerCounts::NOT_FOUND) {
+                    slot = result.find(reverse);
+                }
+                if (slot != KmerCounts::NOT_FOUND) {
+                    result.add(slot, 1);
+                    found++;
+                }
+            }
+            #pragma omp atomic
+            kmer_count += found;
+        });
+        if (verbosity >= verbosity_detailed) {
+            double seconds = gbwt::readTimer() - checkpoint;
+            std::cerr << "Found " << kmer_count << " kmer occurrences in " << read_count << " reads from " << filename << " in " << seconds << " seconds" << std::endl;
+        }
+    }
+
+    if (verbosity >= verbosity_basic) {
+        double seconds = gbwt::readTimer() - start;
+        std::cerr << "Counted the kmers in " << seconds << " seconds" << std::endl;
+    }
+}
+
 //------------------------------------------------------------------------------
 
 std::string Haplotypes::Subchain::to_string() const {
@@ -387,29 +531,80 @@ Haplotypes HaplotypePartitioner::partition_haplotypes(const Parameters& paramete
         std::cerr << "Running " << omp_get_max_threads() << " jobs in parallel" << std::endl;
     }
     start = gbwt::readTimer();
+
+    // Partition each top-level chain into subchains.
+    std::vector<const gbwtgraph::TopLevelChain*> chains_by_offset(result.components(), nullptr);
+    for (auto& chains : chains_by_job) {
+        for (auto& chain : chains) {
+            chains_by_offset[chain.offset] = &chain;
+        }
+    }
+    std::vector<std::vector<Subchain>> subchains_by_chain(result.components());
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t chain_id = 0; chain_id < chains_by_offset.size(); chain_id++) {
+        if (chains_by_offset[chain_id] == nullptr) {
+            continue;
+        }
+        try {
+            subchains_by_chain[chain_id] = this->get_subchains(*(chains_by_offset[chain_id]), parameters);
+        } catch (const std::runtime_error& e) {
+            std::cerr << "error: [chain " << chain_id << "]: " << e.what() << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    // Process all subchains as independent tasks, job by job, with one task per
+    // chain without subchains. Each task has its own output slot.
+    std::vector<std::pair<size_t, size_t>> tasks; // (chain id, subchain id or no_subchain)
+    constexpr size_t no_subchain = std::numeric_limits<size_t>::max();
+    for (auto& chains : chains_by_job) {
+        for (auto& chain : chains) {
+            if (subchains_by_chain[chain.offset].empty()) {
+                tasks.push_back({ chain.offset, no_subchain });
+            }
+            for (size_t i = 0; i < subchains_by_chain[chain.offset].size(); i++) {
+                tasks.push_back({ chain.offset, i });
+            }
+        }
+    }
+    std::vector<std::vector<Haplotypes::Subchain>> task_output(tasks.size());
     #pragma omp parallel for schedule(dynamic, 1)
+    for (size_t task = 0; task < tasks.size(); task++) {
+        size_t chain_id = tasks[task].first;
+        try {
+            if (tasks[task].second == no_subchain) {
+                this->build_full_haplotypes(*(chains_by_offset[chain_id]), task_output[task]);
+            } else {
+                this->build_subchain(subchains_by_chain[chain_id][tasks[task].second], task_output[task]);
+            }
+        } catch (const std::runtime_error& e) {
+            std::cerr << "error: [chain " << chain_id << "]: " << e.what() << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    subchains_by_chain = std::vector<std::vector<Subchain>>(); // Save memory.
+
+    // Put the subchains together in order.
+    for (size_t task = 0; task < tasks.size(); task++) {
+        auto& output = result.chains[tasks[task].first].subchains;
+        for (auto& subchain : task_output[task]) {
+            output.push_back(std::move(subchain));
+        }
+        task_output[task] = std::vector<Haplotypes::Subchain>();
+    }
     for (size_t job = 0; job < chains_by_job.size(); job++) {
         const std::vector<gbwtgraph::TopLevelChain>& chains = chains_by_job[job];
         size_t total_subchains = 0, total_kmers = 0;
         for (auto& chain : chains) {
-            try {
-                this->build_subchains(chain, result.chains[chain.offset], parameters);
-            } catch (const std::runtime_error& e) {
-                std::cerr << "error: [job " << job << "]: " << e.what() << std::endl;
-                std::exit(EXIT_FAILURE);
-            }
             total_subchains += result.chains[chain.offset].subchains.size();
             for (auto& subchain : result.chains[chain.offset].subchains) {
                 total_kmers += subchain.kmers.size();
             }
         }
-        #pragma omp critical
-        {
-            result.header.total_subchains += total_subchains;
-            result.header.total_kmers += total_kmers;
-            if (this->verbosity >= Haplotypes::verbosity_detailed) {
-                std::cerr << "Finished job " << job << " with " << chains.size() << " chains, " << total_subchains << " subchains, and " << total_kmers << " kmers" << std::endl;
-            }
+        result.header.total_subchains += total_subchains;
+        result.header.total_kmers += total_kmers;
+        if (this->verbosity >= Haplotypes::verbosity_detailed) {
+            std::cerr << "Finished job " << job << " with " << chains.size() << " chains, " << total_subchains << " subchains, and " << total_kmers << " kmers" << std::endl;
         }
     }
     if (verbosity >= Haplotypes::verbosity_basic) {
@@ -671,101 +866,96 @@ void present_kmers(const std::vector<std::vector<HaplotypePartitioner::kmer_type
     std::vector<std::pair<HaplotypePartitioner::kmer_type, size_t>>& all_kmers,
     sdsl::bit_vector& kmers_present) {
 
-    // Build a map of distinct kmers. For each kmer, record the largest sequence
-    // id containing the kmer and the number of sequences containing it.
-    std::map<HaplotypePartitioner::kmer_type, std::pair<size_t, size_t>> present;
-    for (size_t sequence_id = 0; sequence_id < sequences.size(); sequence_id++) {
-        auto& sequence = sequences[sequence_id];
-        for (auto kmer : sequence) {
-            auto iter = present.find(kmer);
-            if (iter != present.end()) {
-                if (iter->second.first < sequence_id) {
-                    iter->second.first = sequence_id;
-                    iter->second.second++;
-                }
-            } else {
-                present[kmer] = std::pair<size_t, size_t>(sequence_id, 1);
-            }
-        }
+    // The kmers in each sequence are distinct, so the number of occurrences of a
+    // kmer in the concatenation is the number of sequences containing it.
+    size_t total_kmers = 0;
+    for (auto& sequence : sequences) {
+        total_kmers += sequence.size();
+    }
+    std::vector<HaplotypePartitioner::kmer_type> occurrences;
+    occurrences.reserve(total_kmers);
+    for (auto& sequence : sequences) {
+        occurrences.insert(occurrences.end(), sequence.begin(), sequence.end());
     }
+    std::sort(occurrences.begin(), occurrences.end());
 
     // Now take those kmers that occur in some but not in all sequences.
-    // Use the first field for storing the offset of the kmer in the vector.
-    all_kmers.reserve(present.size());
-    size_t offset = 0;
-    for (auto iter = present.begin(); iter != present.end(); ++iter) {
-        if (iter->second.second < sequences.size()) {
-            all_kmers.push_back({ iter->first, iter->second.second });
-            iter->second.first = offset;
-            offset++;
+    for (size_t i = 0, j = 0; i < occurrences.size(); i = j) {
+        while (j < occurrences.size() && occurrences[j] == occurrences[i]) {
+            j++;
+        }
+        if (j - i < sequences.size()) {
+            all_kmers.push_back({ occurrences[i], j - i });
         }
     }
+    occurrences = std::vector<HaplotypePartitioner::kmer_type>();
 
-    // Transform the sequences into kmer presence bitvectors.
+    // Transform the sequences into kmer presence bitvectors. Both the sequences
+    // and the selected kmers are sorted, so we can merge them.
     kmers_present = sdsl::bit_vector(sequences.size() * all_kmers.size());
     for (size_t i = 0; i < sequences.size(); i++) {
         size_t start = i * all_kmers.size();
+        size_t offset = 0;
         for (auto kmer : sequences[i]) {
-            auto iter = present.find(kmer);
-            if (iter->second.second < sequences.size()) {
-                kmers_present[start + iter->second.first] = 1;
+            while (offset < all_kmers.size() && all_kmers[offset].first < kmer) {
+                offset++;
+            }
+            if (offset < all_kmers.size() && all_kmers[offset].first == kmer) {
+                kmers_present[start + offset] = 1;
             }
         }
     }
 }
 
-void HaplotypePartitioner::build_subchains(const gbwtgraph::TopLevelChain& chain, Haplotypes::TopLevelChain& output, const Parameters& parameters) const {
-    std::vector<Subchain> subchains = this->get_subchains(chain, parameters);
-    for (const Subchain& subchain : subchains) {
-        std::vector<std::pair<Subchain, std::vector<sequence_type>>> to_process;
-        auto sequences = this->get_sequences(subchain);
-        if (sequences.empty()) {
-            // There are no haplotypes crossing the subchain, so we break it into
-            // a suffix and a prefix.
-            to_process.push_back({ { Haplotypes::Subchain::suffix, subchain.start, empty_gbwtgraph_handle() }, this->get_sequences(subchain.start) });
-            to_process.push_back({ { Haplotypes::Subchain::prefix, empty_gbwtgraph_handle(), subchain.end }, this->get_sequences(subchain.end) });
-        } else {
-            to_process.push_back({ subchain, std::move(sequences) });
-        }
-        for (auto iter = to_process.begin(); iter != to_process.end(); ++iter) {
-            output.subchains.push_back({
-                iter->first.type,
-                gbwtgraph::GBWTGraph::handle_to_node(iter->first.start), gbwtgraph::GBWTGraph::handle_to_node(iter->first.end),
-                {}, {}, sdsl::bit_vector()
-            });
-            Haplotypes::Subchain& subchain = output.subchains.back();
-            std::vector<std::vector<kmer_type>> kmers_by_sequence;
-            kmers_by_sequence.reserve(iter->second.size());
-            for (sequence_type sequence : iter->second) {
-                kmers_by_sequence.emplace_back(this->unique_minimizers(sequence, iter->first));
-            }
-            present_kmers(kmers_by_sequence, subchain.kmers, subchain.kmers_present);
-            subchain.sequences = std::move(iter->second);
-        }
+void HaplotypePartitioner::build_subchain(const Subchain& subchain, std::vector<Haplotypes::Subchain>& output) const {
+    std::vector<std::pair<Subchain, std::vector<sequence_type>>> to_process;
+    auto sequences = this->get_sequences(subchain);
+    if (sequences.empty()) {
+        // There are no haplotypes crossing the subchain, so we break it into
+        // a suffix and a prefix.
+        to_process.push_back({ { Haplotypes::Subchain::suffix, subchain.start, empty_gbwtgraph_handle() }, this->get_sequences(subchain.start) });
+        to_process.push_back({ { Haplotypes::Subchain::prefix, empty_gbwtgraph_handle(), subchain.end }, this->get_sequences(subchain.end) });
+    } else {
+        to_process.push_back({ subchain, std::move(sequences) });
     }
-
-    // Take entire sequences if we could not generate any haplotypes.
-    // Note that the kmer sets should be empty, as the sequences should
-    // be identical.
-    if (subchains.empty()) {
-        output.subchains.push_back({
-            Haplotypes::Subchain::full_haplotype,
-            gbwt::ENDMARKER, gbwt::ENDMARKER,
+    for (auto iter = to_process.begin(); iter != to_process.end(); ++iter) {
+        output.push_back({
+            iter->first.type,
+            gbwtgraph::GBWTGraph::handle_to_node(iter->first.start), gbwtgraph::GBWTGraph::handle_to_node(iter->first.end),
             {}, {}, sdsl::bit_vector()
         });
-        Haplotypes::Subchain& subchain = output.subchains.back();
-        gbwt::node_type node = gbwtgraph::GBWTGraph::handle_to_node(chain.handle);
-        auto sequences = this->r_index.decompressDA(node);
+        Haplotypes::Subchain& subchain = output.back();
         std::vector<std::vector<kmer_type>> kmers_by_sequence;
-        kmers_by_sequence.reserve(sequences.size());
-        for (auto seq_id : sequences) {
-            kmers_by_sequence.emplace_back(this->unique_minimizers(seq_id));
+        kmers_by_sequence.reserve(iter->second.size());
+        for (sequence_type sequence : iter->second) {
+            kmers_by_sequence.emplace_back(this->unique_minimizers(sequence, iter->first));
         }
         present_kmers(kmers_by_sequence, subchain.kmers, subchain.kmers_present);
-        subchain.sequences.reserve(sequences.size());
-        for (size_t i = 0; i < sequences.size(); i++) {
-            subchain.sequences.push_back({ sequences[i], 0 });
-        }
+        subchain.sequences = std::move(iter->second);
+    }
+}
+
+void HaplotypePartitioner::build_full_haplotypes(const gbwtgraph::TopLevelChain& chain, std::vector<Haplotypes::Subchain>& output) const {
+    // Take entire sequences if we could not generate any haplotypes.
+    // Note that the kmer sets should be empty, as the sequences should
+    // be identical.
+    output.push_back({
+        Haplotypes::Subchain::full_haplotype,
+        gbwt::ENDMARKER, gbwt::ENDMARKER,
+        {}, {}, sdsl::bit_vector()
+    });
+    Haplotypes::Subchain& subchain = output.back();
+    gbwt::node_type node = gbwtgraph::GBWTGraph::handle_to_node(chain.handle);
+    auto sequences = this->r_index.decompressDA(node);
+    std::vector<std::vector<kmer_type>> kmers_by_sequence;
+    kmers_by_sequence.reserve(sequences.size());
+    for (auto seq_id : sequences) {
+        kmers_by_sequence.emplace_back(this->unique_minimizers(seq_id));
+    }
+    present_kmers(kmers_by_sequence, subchain.kmers, subchain.kmers_present);
+    subchain.sequences.reserve(sequences.size());
+    for (size_t i = 0; i < sequences.size(); i++) {
+        subchain.sequences.push_back({ sequences[i], 0 });
     }
 }
 
@@ -1064,7 +1254,7 @@ void recombinator_sanity_checks(const Recombinator::Parameters& parameters) {
 }
 
 double get_or_estimate_coverage(
-    const hash_map<Haplotypes::Subchain::kmer_type, size_t>& counts,
+    const KmerCounts& counts,
     const Recombinator::Parameters& parameters,
     Haplotypes::Verbosity verbosity) {
     if (parameters.coverage > 0) {
@@ -1076,11 +1266,12 @@ double get_or_estimate_coverage(
         std::cerr << "Estimating kmer coverage" << std::endl;
     }
     std::map<size_t, size_t> count_to_frequency;
-    for (auto iter = counts.begin(); iter != counts.end(); ++iter) {
+    for (size_t slot = 0; slot < counts.size(); slot++) {
         // We are only interested in kmers with multiple occurrences, as unique
         // kmers are likely sequencing errors.
-        if (iter->second > 1) {
-            count_to_frequency[iter->second]++;
+        size_t count = counts.count(slot);
+        if (count > 1) {
+            count_to_frequency[count]++;
         }
     }
 
@@ -1135,8 +1326,17 @@ gbwt::GBWT Recombinator::generate_haplotypes(const Haplotypes& haplotypes, const
     // Sanity checks (may throw).
     recombinator_sanity_checks(parameters);
 
-    // Get kmer counts (may throw) and determine coverage.
-    hash_map<Haplotypes::Subchain::kmer_type, size_t> counts = haplotypes.kmer_counts(kff_file, this->verbosity);
+    // Get kmer counts (may throw).
+    KmerCounts counts = haplotypes.kmer_counts(kff_file, this->verbosity);
+    return this->generate_haplotypes(haplotypes, counts, parameters);
+}
+
+gbwt::GBWT Recombinator::generate_haplotypes(const Haplotypes& haplotypes,
+    const KmerCounts& counts,
+    const Parameters& parameters) const {
+
+    // Sanity checks (may throw) and determine coverage.
+    recombinator_sanity_checks(parameters);
     double coverage = get_or_estimate_coverage(counts, parameters, this->verbosity);
 
     double start = gbwt::readTimer();
@@ -1163,9 +1363,26 @@ gbwt::GBWT Recombinator::generate_haplotypes(const Haplotypes& haplotypes, const
         }
     }
 
+    // Start the jobs with the most work first, so that a large job does not
+    // keep a single thread busy after the others have finished. The work in a
+    // subchain is proportional to the number of (haplotype, kmer) pairs.
+    std::vector<std::pair<size_t, size_t>> job_order; // (work, job)
+    for (size_t job = 0; job < jobs.size(); job++) {
+        size_t work = 0;
+        for (auto chain_id : jobs[job]) {
+            for (auto& subchain : haplotypes.chains[chain_id].subchains) {
+                work += subchain.sequences.size() * subchain.kmers.size();
+            }
+        }
+        job_order.push_back({ work, job });
+    }
+    std::sort(job_order.begin(), job_order.end(), std::greater<std::pair<size_t, size_t>>());
+
     // Build partial indexes.
     // We use a separate MetadataBuilder for each job, because we don't know in advance
     // how many fragments there will be for each generated haplotype.
+    // Each job compresses its own index as soon as it finishes, so we only keep
+    // one dynamic index per thread in memory.
     double checkpoint = gbwt::readTimer();
     if (this->verbosity >= Haplotypes::verbosity_basic) {
         std::cerr << "Running " << omp_get_max_threads() << " GBWT construction jobs in parallel" << std::endl;
@@ -1173,7 +1390,8 @@ gbwt::GBWT Recombinator::generate_haplotypes(const Haplotypes& haplotypes, const
     std::vector<gbwt::GBWT> indexes(jobs.size());
     Statistics statistics;
     #pragma omp parallel for schedule(dynamic, 1)
-    for (size_t job = 0; job < jobs.size(); job++) {
+    for (size_t i = 0; i < job_order.size(); i++) {
+        size_t job = job_order[i].second;
         gbwt::GBWTBuilder builder(sdsl::bits::length(this->gbz.index.sigma() - 1), parameters.buffer_size);
         gbwtgraph::MetadataBuilder metadata;
         Statistics job_statistics;
@@ -1218,6 +1436,7 @@ gbwt::GBWT Recombinator::generate_haplotypes(const Haplotypes& haplotypes, const
         std::cerr << "Merging the partial indexes" << std::endl;
     }
     gbwt::GBWT merged(indexes);
+    indexes = std::vector<gbwt::GBWT>(); // Release the partial indexes.
     if (parameters.include_reference) {
         copy_reference_samples(this->gbz.index, merged);
     }
@@ -1240,7 +1459,7 @@ gbwt::GBWT Recombinator::generate_haplotypes(const Haplotypes& haplotypes, const
 // statistics with the number of non-frequent kmers if necessary.
 std::vector<std::pair<Recombinator::kmer_presence, double>> classify_kmers(
     const Haplotypes::Subchain& subchain,
-    const hash_map<Haplotypes::Subchain::kmer_type, size_t>& kmer_counts,
+    const KmerCounts& kmer_counts,
     double coverage,
     Recombinator::Statistics* statistics,
     const Recombinator::Parameters& parameters
@@ -1328,7 +1547,7 @@ std::vector<std::pair<size_t, double>> select_diploid(
 // if provided.
 std::vector<std::pair<size_t, double>> select_haplotypes(
     const Haplotypes::Subchain& subchain,
-    const hash_map<Haplotypes::Subchain::kmer_type, size_t>& kmer_counts,
+    const KmerCounts& kmer_counts,
     double coverage,
     Recombinator::Statistics* statistics,
     std::vector<Recombinator::LocalHaplotype>* local_haplotypes,
@@ -1415,7 +1634,7 @@ std::vector<std::pair<size_t, double>> select_haplotypes(
 }
 
 Recombinator::Statistics Recombinator::generate_haplotypes(const Haplotypes::TopLevelChain& chain,
-    const hash_map<Haplotypes::Subchain::kmer_type, size_t>& kmer_counts,
+    const KmerCounts& kmer_counts,
     gbwt::GBWTBuilder& builder, gbwtgraph::MetadataBuilder& metadata,
     const Parameters& parameters,
     double coverage
@@ -1508,6 +1727,15 @@ Recombinator::Statistics Recombinator::generate_haplotypes(const Haplotypes::Top
 std::vector<Recombinator::LocalHaplotype> Recombinator::extract_sequences(
     const Haplotypes& haplotypes, const std::string& kff_file,
     size_t chain_id, size_t subchain_id, const Parameters& parameters
+) const {
+    // Get kmer counts (may throw).
+    KmerCounts counts = haplotypes.kmer_counts(kff_file, this->verbosity);
+    return this->extract_sequences(haplotypes, counts, chain_id, subchain_id, parameters);
+}
+
+std::vector<Recombinator::LocalHaplotype> Recombinator::extract_sequences(
+    const Haplotypes& haplotypes, const KmerCounts& counts,
+    size_t chain_id, size_t subchain_id, const Parameters& parameters
 ) const {
     // Sanity checks.
     if (chain_id >= haplotypes.chains.size()) {
@@ -1540,8 +1768,7 @@ std::vector<Recombinator::LocalHaplotype> Recombinator::extract_sequences(
         result[i].sequence = generate_haplotype(pos, until, limit, limit, this->gbz.graph);
     }
 
-    // Get kmer counts (may throw) and determine coverage.
-    hash_map<Haplotypes::Subchain::kmer_type, size_t> counts = haplotypes.kmer_counts(kff_file, this->verbosity);
+    // Determine coverage.
     double coverage = get_or_estimate_coverage(counts, parameters, this->verbosity);
 
     // Fill in the scores.
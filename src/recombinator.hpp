@@ -12,11 +12,83 @@
 #include "snarl_distance_index.hpp"
 
 #include <iostream>
+#include <memory>
 
+#include <BooPHF.h>
 #include <gbwtgraph/algorithms.h>
 
 namespace vg {
 
+class ParallelKFFReader;
+
+//------------------------------------------------------------------------------
+
+/**
+ * A table of counts for a fixed set of kmers.
+ *
+ * The kmers are mapped to slots in a flat array using a minimal perfect hash
+ * function, which takes a few bits per kmer. We also store the kmers, because
+ * the hash function maps other kmers to arbitrary slots. This takes much less
+ * space than a hash map from kmers to counts and can be built in parallel.
+ *
+ * Once the table has been built, searching it and adding to the counts is
+ * thread-safe.
+ */
+class KmerCounts {
+public:
+    typedef gbwtgraph::Key64::value_type kmer_type;
+    typedef std::uint32_t count_type;
+    typedef boomphf::mphf<kmer_type, boomphf::SingleHashFunctor<kmer_type>> mphf_type;
+
+    /// Space / construction time tradeoff for the hash function.
+    constexpr static double GAMMA = 2.0;
+
+    /// Slot returned for kmers that are not in the table.
+    constexpr static size_t NOT_FOUND = std::numeric_limits<size_t>::max();
+
+    /// Creates an empty table.
+    KmerCounts() = default;
+
+    /// Creates a table with zero counts for the given kmers. Sorts the kmers
+    /// and removes duplicates. Uses OpenMP threads.
+    explicit KmerCounts(std::vector<kmer_type>& kmers);
+
+    /// Returns the number of kmers in the table.
+    size_t size() const { return this->kmers.size(); }
+
+    /// Returns `true` if the table is empty.
+    bool empty() const { return this->kmers.empty(); }
+
+    /// Returns the slot for the kmer or `NOT_FOUND` if it is not in the table.
+    size_t find(kmer_type kmer) const;
+
+    /// Returns the slot for the kmer or its reverse complement, or `NOT_FOUND`
+    /// if neither is in the table.
+    size_t find_either(kmer_type kmer, size_t k) const;
+
+    /// Returns the count for the kmer. Throws `std::out_of_range` if the kmer
+    /// is not in the table.
+    size_t at(kmer_type kmer) const;
+
+    /// Returns the count in the given slot.
+    size_t count(size_t slot) const { return this->counts[slot]; }
+
+    /// Adds to the count in the given slot. This is thread-safe.
+    void add(size_t slot, size_t count);
+
+    /// Sets all counts to zero.
+    void clear();
+
+private:
+    std::unique_ptr<mphf_type> mphf;
+
+    // Kmer in each slot.
+    std::vector<kmer_type> kmers;
+
+    // Count in each slot.
+    std::vector<count_type> counts;
+};
+
 //------------------------------------------------------------------------------
 
 /**
@@ -195,15 +267,40 @@ public:
 
     std::vector<TopLevelChain> chains;
 
+    /// Returns a table with zero counts for the kmers used in this object. The
+    /// table can be reused for multiple samples.
+    KmerCounts kmer_table(Verbosity verbosity) const;
+
     /**
-      * Returns a mapping from kmers to their counts in the given KFF file.
+      * Returns a table of counts for the kmers used in this object from the
+      * given KFF file.
       * The counts include both the kmer and the reverse complement.
       *
       * Reads the KFF file using OpenMP threads. Exits with `std::exit()` if
       * the file cannot be opened and throws `std::runtime_error` if the kmer
       * counts cannot be used.
      */
-    hash_map<Subchain::kmer_type, size_t> kmer_counts(const std::string& kff_file, Verbosity verbosity) const;
+    KmerCounts kmer_counts(const std::string& kff_file, Verbosity verbosity) const;
+
+    /// As above, but replaces the counts in a table from `kmer_table()`.
+    void kmer_counts(const std::string& kff_file, KmerCounts& counts, Verbosity verbosity) const;
+
+    /// As above, but reads the kmers from an open KFF file.
+    void kmer_counts(ParallelKFFReader& reader, KmerCounts& counts, Verbosity verbosity) const;
+
+    /**
+      * Returns a table of counts for the kmers used in this object from the
+      * given FASTQ / FASTA files, which may be gzip-compressed. Only the kmers used in this object
+      * are counted, so there is no need for an external kmer counter or a KFF
+      * file. The counts include both the kmer and the reverse complement.
+      *
+      * Reads the files using OpenMP threads. Exits with `std::exit()` if a
+      * file cannot be opened.
+      */
+    KmerCounts kmer_counts_from_reads(const std::vector<std::string>& read_files, Verbosity verbosity) const;
+
+    /// As above, but replaces the counts in a table from `kmer_table()`.
+    void kmer_counts_from_reads(const std::vector<std::string>& read_files, KmerCounts& counts, Verbosity verbosity) const;
 
     /// Serializes the object to a stream in the simple-sds format.
     void simple_sds_serialize(std::ostream& out) const;
@@ -296,6 +393,11 @@ public:
      * a number of jobs that can be later used as GBWT construction jobs. Multiple
      * jobs are run in parallel using OpenMP threads.
      *
+     * The subchains of all top-level chains are processed as one pool of tasks,
+     * so a single large chain does not end up running on one thread. Each task
+     * writes to its own slot, and the results are put together in order at the
+     * end.
+     *
      * Each top-level chain is partitioned into subchains that consist of one or
      * more snarls. Multiple snarls are combined into the same subchain if the
      * minimum distance over the subchain is at most the target length and there
@@ -349,8 +451,13 @@ private:
     // entirely in the shared initial/final nodes.
     std::vector<kmer_type> unique_minimizers(sequence_type sequence, Subchain subchain) const;
 
-    // Build subchains for a specific top-level chain.
-    void build_subchains(const gbwtgraph::TopLevelChain& chain, Haplotypes::TopLevelChain& output, const Parameters& parameters) const;
+    // Build the output for a subchain and append it to the vector. If no
+    // haplotypes cross the subchain, this appends a suffix and a prefix instead.
+    void build_subchain(const Subchain& subchain, std::vector<Haplotypes::Subchain>& output) const;
+
+    // Build a single subchain with entire haplotypes for a top-level chain that
+    // could not be partitioned, and append it to the vector.
+    void build_full_haplotypes(const gbwtgraph::TopLevelChain& chain, std::vector<Haplotypes::Subchain>& output) const;
 };
 
 //------------------------------------------------------------------------------
@@ -484,6 +591,12 @@ public:
      */
     gbwt::GBWT generate_haplotypes(const Haplotypes& haplotypes, const std::string& kff_file, const Parameters& parameters) const;
 
+    /// Generates haplotypes as above, using the given kmer counts from
+    /// `Haplotypes::kmer_counts()` or `Haplotypes::kmer_counts_from_reads()`.
+    gbwt::GBWT generate_haplotypes(const Haplotypes& haplotypes,
+        const KmerCounts& kmer_counts,
+        const Parameters& parameters) const;
+
     /// A local haplotype sequence within a single subchain.
     struct LocalHaplotype {
         /// Name of the haplotype.
@@ -514,13 +627,19 @@ public:
         size_t chain_id, size_t subchain_id, const Parameters& parameters
     ) const;
 
+    /// Extracts the local haplotypes as above, using the given kmer counts.
+    std::vector<LocalHaplotype> extract_sequences(
+        const Haplotypes& haplotypes, const KmerCounts& kmer_counts,
+        size_t chain_id, size_t subchain_id, const Parameters& parameters
+    ) const;
+
     const gbwtgraph::GBZ& gbz;
     Verbosity verbosity;
 
 private:
     // Generate haplotypes for the given chain.
     Statistics generate_haplotypes(const Haplotypes::TopLevelChain& chain,
-        const hash_map<Haplotypes::Subchain::kmer_type, size_t>& kmer_counts,
+        const KmerCounts& kmer_counts,
         gbwt::GBWTBuilder& builder, gbwtgraph::MetadataBuilder& metadata,
         const Parameters& parameters, double coverage) const;
 };
@@ -92,6 +92,26 @@ void Sampler::set_source_paths(const vector<string>& source_paths,
     else {
         path_sampler = vg::discrete_distribution<>();
     }
+    if (precompute_paths) {
+        precompute_source_paths();
+    }
+}
+
+void Sampler::precompute_source_paths() {
+    precompute_paths = true;
+    source_path_indexes.clear();
+    source_path_indexes.resize(source_paths.size());
+    for (size_t i = 0; i < source_paths.size(); ++i) {
+        path_handle_t path_handle = graph.get_path_handle(source_paths[i]);
+        auto& path_index = source_path_indexes[i];
+        path_index.sequence.reserve(graph.get_path_length(path_handle));
+        graph.for_each_step_in_path(path_handle, [&](const step_handle_t& step) {
+            handle_t handle = graph.get_handle_of_step(step);
+            path_index.step_handles.push_back(handle);
+            path_index.step_offsets.push_back(path_index.sequence.size());
+            path_index.sequence.append(graph.get_sequence(handle));
+        });
+    }
 }
     
 
@@ -116,13 +136,37 @@ pos_t position_at(PathPositionHandleGraph* graph_ptr, const string& path_name, c
     return pos;
 }
 
+void Sampler::seed_rngs(int seed) {
+    rngs.clear();
+    nonces.clear();
+    rngs.emplace_back(seed);
+    // engine with coding-time random coefficient to produce good seeds for the
+    // other threads from one seed
+    linear_congruential_engine<uint64_t, 1094757125720465369ull, 10230831556735383564ull, 18446744073709551557ull> seed_perturbor(seed);
+    for (int i = 1, n = get_thread_count(); i < n; ++i) {
+        rngs.emplace_back(seed_perturbor());
+    }
+    nonces.resize(rngs.size(), 0);
+}
+
+mt19937& Sampler::rng() {
+    return rngs[omp_get_thread_num()];
+}
+
+int64_t Sampler::next_nonce() {
+    // interleave the threads' counters so that the nonces are unique, and
+    // they are the same as a single shared counter when there's one thread
+    int thread_num = omp_get_thread_num();
+    return (nonces[thread_num]++) * rngs.size() + thread_num;
+}
+
 pos_t Sampler::position(void) {
     // We sample from the entire graph sequence, 1-based.
     vg::uniform_int_distribution<size_t> xdist(1, total_seq_length);
-    size_t offset = xdist(rng);
+    size_t offset = xdist(rng());
     id_t id = dynamic_cast<VectorizableHandleGraph*>(&graph)->node_at_vector_offset(offset);
     vg::uniform_int_distribution<size_t> flip(0, 1);
-    bool rev = forward_only ? false : flip(rng);
+    bool rev = forward_only ? false : flip(rng());
     // 1-0 base conversion
     size_t node_offset = offset - dynamic_cast<VectorizableHandleGraph*>(&graph)->node_vector_offset(id) - 1;
     // Ignore flipping the node offset because we're uniform over both strands
@@ -141,7 +185,7 @@ string Sampler::sequence(size_t length) {
         // pick one at random
         vg::uniform_int_distribution<int> next_dist(0, nextc.size()-1);
         // update our position
-        pos = nextp.at(next_dist(rng));
+        pos = nextp.at(next_dist(rng()));
         // append to our sequence
         seq += nextc[pos];
     }
@@ -196,13 +240,13 @@ vector<Edit> Sampler::mutate_edit(const Edit& edit,
             // this character from the old edit.
             Edit* e = nullptr;
             
-            if (rprob(rng) <= base_error) {
+            if (rprob(rng()) <= base_error) {
                 // We should do a substitution relative to the old edit.
                 
                 // pick another base than what c is
                 char n;
                 do {
-                    n = bases[rbase(rng)];
+                    n = bases[rbase(rng())];
                 } while (n == c);
                 // make the edit for the sub
                 e = new_mapping.add_edit();
@@ -218,12 +262,12 @@ vector<Edit> Sampler::mutate_edit(const Edit& edit,
 #ifdef debug
                 cerr << "Produced relative substitution " << pb2json(*e) << endl;
 #endif
-            } else if (rprob(rng) <= indel_error) {
+            } else if (rprob(rng()) <= indel_error) {
                 // We have an indel.
                 // Note that we're using a simple geometric indel dsitribution here
-                if (rprob(rng) < 0.5) {
+                if (rprob(rng()) < 0.5) {
                     // This should be an insertion relative to the original edit.
-                    char n = bases[rbase(rng)];
+                    char n = bases[rbase(rng())];
                     e = new_mapping.add_edit();
                     string s(1, n);
                     e->set_sequence(s);
@@ -370,7 +414,7 @@ vector<Alignment> Sampler::alignment_pair(size_t read_length, size_t fragment_le
     // simulate forward/reverse pair by first simulating a long read
     vg::normal_distribution<> norm_dist(fragment_length, fragment_std_dev);
     // bound at read length so we always get enough sequence
-    int frag_len = max((int)read_length, (int)round(norm_dist(rng)));
+    int frag_len = max((int)read_length, (int)round(norm_dist(rng())));
     auto fragment = alignment_with_error(frag_len, base_error, indel_error);
     // then taking the ends
     auto fragments = alignment_ends(fragment, read_length, read_length);
@@ -380,10 +424,7 @@ vector<Alignment> Sampler::alignment_pair(size_t read_length, size_t fragment_le
         string data;
         aln1.SerializeToString(&data);
         aln2.SerializeToString(&data);
-        int n;
-#pragma omp critical(nonce)
-        n = nonce++;
-        data += std::to_string(n);
+        data += std::to_string(next_nonce());
         const string hash = sha1head(data, 16);
         aln1.set_name(hash + "_1");
         aln2.set_name(hash + "_2");
@@ -407,7 +448,11 @@ Alignment Sampler::alignment(size_t length) {
     if (source_paths.empty()) {
         return alignment_to_graph(length);
     } else {
-        return alignment_to_path(source_paths[path_sampler(rng)], length);
+        size_t path_idx = path_sampler(rng());
+        if (!source_path_indexes.empty()) {
+            return alignment_to_indexed_path(path_idx, length);
+        }
+        return alignment_to_path(source_paths[path_idx], length);
     }
 }
 
@@ -418,9 +463,9 @@ Alignment Sampler::alignment_to_path(const string& source_path, size_t length) {
     path_handle_t path_handle = graph.get_path_handle(source_path);
     uint64_t path_length = graph.get_path_length(path_handle);
     vg::uniform_int_distribution<size_t> xdist(0, path_length - 1);
-    size_t path_offset = xdist(rng);
+    size_t path_offset = xdist(rng());
     vg::uniform_int_distribution<size_t> flip(0, 1);
-    bool rev = forward_only ? false : flip(rng);
+    bool rev = forward_only ? false : flip(rng());
     
     // We will fill in this string
     string seq;
@@ -467,10 +512,95 @@ Alignment Sampler::alignment_to_path(const string& source_path, size_t length) {
     { // name the alignment
         string data;
         aln.SerializeToString(&data);
-        int n;
-#pragma omp critical(nonce)
-        n = nonce++;
-        data += std::to_string(n);
+        data += std::to_string(next_nonce());
+        const string hash = sha1head(data, 16);
+        aln.set_name(hash);
+    }
+    // And set its identity
+    aln.set_identity(identity(aln.path()));
+    aln.clear_refpos();
+    annotate_with_path_positions(aln);
+    return aln;
+}
+
+// generates the same alignment as alignment_to_path, but from the precomputed path
+Alignment Sampler::alignment_to_indexed_path(size_t path_idx, size_t length) {
+    
+    const SourcePathIndex& path_index = source_path_indexes[path_idx];
+    
+    // Pick a starting point along the path and an orientation
+    uint64_t path_length = path_index.sequence.size();
+    vg::uniform_int_distribution<size_t> xdist(0, path_length - 1);
+    size_t path_offset = xdist(rng());
+    vg::uniform_int_distribution<size_t> flip(0, 1);
+    bool rev = forward_only ? false : flip(rng());
+    
+    // the interval of the path that we take, walking off the end if necessary
+    size_t begin, end;
+    if (rev) {
+        begin = path_offset + 1 >= length ? path_offset + 1 - length : 0;
+        end = path_offset + 1;
+    }
+    else {
+        begin = path_offset;
+        end = min<size_t>(path_offset + length, path_length);
+    }
+    
+    Alignment aln;
+    if (rev) {
+        aln.set_sequence(reverse_complement(path_index.sequence.substr(begin, end - begin)));
+    }
+    else {
+        aln.set_sequence(path_index.sequence.substr(begin, end - begin));
+    }
+    
+    // find the step that contains the first base we'll walk along
+    size_t first = rev ? end - 1 : begin;
+    size_t step_idx = upper_bound(path_index.step_offsets.begin(), path_index.step_offsets.end(),
+                                  first) - path_index.step_offsets.begin() - 1;
+    
+    // add a mapping for each step that the read overlaps
+    Path* path = aln.mutable_path();
+    size_t remaining = end - begin;
+    while (remaining > 0) {
+        handle_t handle = path_index.step_handles[step_idx];
+        size_t step_begin = path_index.step_offsets[step_idx];
+        size_t step_end = step_begin + graph.get_length(handle);
+        size_t from_length;
+        size_t node_offset;
+        if (rev) {
+            // walk backward from the end of the interval within this step
+            size_t take_begin = max(step_begin, begin);
+            size_t take_end = begin + remaining;
+            from_length = take_end - take_begin;
+            node_offset = step_end - take_end;
+            --step_idx;
+        }
+        else {
+            size_t take_begin = end - remaining;
+            size_t take_end = min(step_end, end);
+            from_length = take_end - take_begin;
+            node_offset = take_begin - step_begin;
+            ++step_idx;
+        }
+        remaining -= from_length;
+        
+        Mapping* mapping = path->add_mapping();
+        Position* position = mapping->mutable_position();
+        position->set_node_id(graph.get_id(handle));
+        position->set_is_reverse(graph.get_is_reverse(handle) != rev);
+        position->set_offset(node_offset);
+        Edit* edit = mapping->add_edit();
+        edit->set_from_length(from_length);
+        edit->set_to_length(from_length);
+    }
+    // Simplify the alignment to merge redundant mappings, like alignment_to_path does
+    aln = simplify(aln);
+    
+    { // name the alignment
+        string data;
+        aln.SerializeToString(&data);
+        data += std::to_string(next_nonce());
         const string hash = sha1head(data, 16);
         aln.set_name(hash);
     }
@@ -508,7 +638,7 @@ Alignment Sampler::alignment_to_graph(size_t length) {
         // pick one at random
         vg::uniform_int_distribution<int> next_dist(0, nextc.size()-1);
         // update our position
-        pos = nextp.at(next_dist(rng));
+        pos = nextp.at(next_dist(rng()));
         // update our char
         c = nextc[pos];
     } while (seq.size() < length);
@@ -520,10 +650,7 @@ Alignment Sampler::alignment_to_graph(size_t length) {
     { // name the alignment
         string data;
         aln.SerializeToString(&data);
-        int n;
-#pragma omp critical(nonce)
-        n = nonce++;
-        data += std::to_string(n);
+        data += std::to_string(next_nonce());
         const string hash = sha1head(data, 16);
         aln.set_name(hash);
     }
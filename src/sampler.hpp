@@ -10,10 +10,10 @@
 #include <algorithm>
 #include <chrono>
 #include <ctime>
-#include "lru_cache.h"
 #include "statistics.hpp"
 #include "position.hpp"
 #include "vg/io/json2pb.h"
+#include "utility.hpp"
 
 namespace vg {
 
@@ -83,12 +83,12 @@ class Sampler: public AbstractReadSampler {
 
 public:
 
-    // We need this so we don't re-load the node for every character we visit in
-    // it.
-    LRUCache<id_t, Node> node_cache;
-    LRUCache<id_t, vector<Edge> > edge_cache;
-    mt19937 rng;
-    int64_t nonce;
+    // A random engine and a read naming counter for each thread, so that
+    // threads can sample independently. The output for a given seed is
+    // deterministic for a given number of threads if reads are assigned to
+    // threads statically.
+    vector<mt19937> rngs;
+    vector<int64_t> nonces;
     // If set, only sample positions/start reads on the forward strands of their
     // nodes.
     bool forward_only;
@@ -112,11 +112,8 @@ public:
             const vector<pair<string, double>>& transcript_expressions = {},
             const vector<tuple<string, string, size_t>>& haplotype_transcripts = {})
         : AbstractReadSampler(*x),
-          node_cache(100),
-          edge_cache(100),
           forward_only(forward_only),
           no_Ns(!allow_Ns),
-          nonce(0),
           source_paths(source_paths) {
         // sum seq lengths
         graph.for_each_handle([&](const handle_t& handle) {
@@ -125,7 +122,7 @@ public:
         if (!seed) {
             seed = time(NULL);
         }
-        rng.seed(seed);
+        seed_rngs(seed);
         set_source_paths(source_paths, source_path_ploidies, transcript_expressions, haplotype_transcripts);
     }
     
@@ -133,6 +130,9 @@ public:
     Alignment sample_read();
     pair<Alignment, Alignment> sample_read_pair();
 
+    /// Get the random engine for the current thread
+    mt19937& rng();
+
     /// Make a path sampling distribution based on relative lengths (weighted
     /// by ploidy) or on transcript expressions. (At most one of source_paths and
     /// expressions should be non-empty.) If providing a transcript expression
@@ -157,6 +157,12 @@ public:
     /// Get an alignment against the currently set source_path.
     Alignment alignment_to_path(const string& source_path, size_t length);
     
+    /// Precompute the sequence and step offsets of each source path, so that
+    /// reads can be extracted from paths without querying the graph for each
+    /// base. This takes memory proportional to the total length of the source
+    /// paths, and the precomputation is redone if the source paths change.
+    void precompute_source_paths();
+    
     Alignment alignment_with_error(size_t length,
                                    double base_error,
                                    double indel_error);
@@ -196,6 +202,31 @@ public:
     /// need to be accounted for by deletions.
     bool is_valid(const Alignment& aln);
 
+private:
+
+    /// The concatenated sequence of a source path, with the handles of its
+    /// steps and the offsets at which they start
+    struct SourcePathIndex {
+        string sequence;
+        vector<handle_t> step_handles;
+        vector<size_t> step_offsets;
+    };
+    
+    /// Precomputed indexes of the source paths, if in use
+    vector<SourcePathIndex> source_path_indexes;
+    bool precompute_paths = false;
+    
+    /// Get an alignment against the source path with this index, using its
+    /// precomputed sequence and step offsets
+    Alignment alignment_to_indexed_path(size_t path_idx, size_t length);
+
+    /// Make a random engine for each thread. The first thread uses the seed
+    /// directly, so that single-threaded sampling is unchanged.
+    void seed_rngs(int seed);
+
+    /// Get a number that is unique to this read, for naming
+    int64_t next_nonce();
+
 };
 
 /**
@@ -252,7 +283,8 @@ private:
         
     private:
         
-        mt19937_64 prng;
+        /// a random engine for each thread
+        vector<mt19937_64> prngs;
         unordered_map<From, vg::uniform_int_distribution<size_t>> samplers;
         
         unordered_map<To, size_t> column_of;
@@ -401,8 +433,13 @@ private:
  * A finite state Markov distribution that supports sampling
  */
 template<class From, class To>
-NGSSimulator::MarkovDistribution<From, To>::MarkovDistribution(uint64_t seed) : prng(seed) {
-    // nothing to do
+NGSSimulator::MarkovDistribution<From, To>::MarkovDistribution(uint64_t seed) {
+    // the first thread uses the seed directly, the rest are derived from it
+    prngs.emplace_back(seed);
+    linear_congruential_engine<uint64_t, 1094757125720465369ull, 10230831556735383564ull, 18446744073709551557ull> seed_perturbor(seed);
+    for (int i = 1, n = get_thread_count(); i < n; ++i) {
+        prngs.emplace_back(seed_perturbor());
+    }
 }
 
 template<class From, class To>
@@ -435,13 +472,15 @@ void NGSSimulator::MarkovDistribution<From, To>::finalize() {
 
 template<class From, class To>
 To NGSSimulator::MarkovDistribution<From, To>::sample_transition(From from) {
+    mt19937_64& prng = prngs[omp_get_thread_num()];
     // return randomly if a transition has never been observed
-    if (!cond_distrs.count(from)) {
+    auto it = cond_distrs.find(from);
+    if (it == cond_distrs.end()) {
         return value_at[vg::uniform_int_distribution<size_t>(0, value_at.size() - 1)(prng)];
     }
     
-    size_t sample_val = samplers[from](prng);
-    vector<size_t>& cdf = cond_distrs[from];
+    size_t sample_val = samplers.at(from)(prng);
+    const vector<size_t>& cdf = it->second;
     
     if (sample_val <= cdf[0]) {
         return value_at[0];
@@ -0,0 +1,115 @@
+/**
+ * \file scratch_arena.cpp
+ * Implementation of the per-thread scratch arena.
+ */
+
+#include "scratch_arena.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace vg {
+
+using namespace std;
+
+const size_t ScratchArena::DEFAULT_BLOCK_SIZE = 1024 * 1024;
+
+vector<shared_ptr<ScratchArena>> ScratchArena::thread_arenas;
+mutex ScratchArena::thread_arenas_mutex;
+
+ScratchArena::ScratchArena(size_t min_block_size) : min_block_size(std::max<size_t>(min_block_size, 64)) {
+    // Nothing to do; we allocate blocks on demand.
+}
+
+void* ScratchArena::allocate(size_t bytes, size_t alignment) {
+    if (!blocks.empty()) {
+        // Try and fit in the current block.
+        Block& block = blocks.back();
+        uintptr_t base = (uintptr_t) block.data.get();
+        // Round the next free position up to the alignment
+        size_t start = ((base + block_used + alignment - 1) / alignment) * alignment - base;
+        if (start + bytes <= block.size) {
+            block_used = start + bytes;
+            peak = std::max(peak, earlier_used + block_used);
+            return block.data.get() + start;
+        }
+        // Otherwise the rest of this block is wasted.
+        earlier_used += block_used;
+    }
+
+    // We need a new block. Grow geometrically so we don't make too many.
+    size_t block_size = std::max(min_block_size, bytes + alignment);
+    if (!blocks.empty()) {
+        block_size = std::max(block_size, blocks.back().size * 2);
+    }
+    blocks.push_back({unique_ptr<char[]>(new char[block_size]), block_size});
+    block_used = 0;
+
+    Block& block = blocks.back();
+    uintptr_t base = (uintptr_t) block.data.get();
+    size_t start = ((base + alignment - 1) / alignment) * alignment - base;
+    block_used = start + bytes;
+    peak = std::max(peak, earlier_used + block_used);
+    return block.data.get() + start;
+}
+
+void ScratchArena::reset() {
+    if (blocks.size() > 1) {
+        // Replace all the blocks with one big enough to hold all of them, so
+        // the next task of the same size fits without growing.
+        size_t total = capacity();
+        blocks.clear();
+        blocks.push_back({unique_ptr<char[]>(new char[total]), total});
+    }
+    block_used = 0;
+    earlier_used = 0;
+}
+
+size_t ScratchArena::used() const {
+    return earlier_used + block_used;
+}
+
+size_t ScratchArena::high_water_mark() const {
+    return peak;
+}
+
+size_t ScratchArena::capacity() const {
+    size_t total = 0;
+    for (auto& block : blocks) {
+        total += block.size;
+    }
+    return total;
+}
+
+ScratchArena& ScratchArena::for_this_thread() {
+    thread_local shared_ptr<ScratchArena> arena;
+    if (!arena) {
+        arena = make_shared<ScratchArena>();
+        lock_guard<mutex> lock(thread_arenas_mutex);
+        thread_arenas.push_back(arena);
+    }
+    return *arena;
+}
+
+void ScratchArena::report_thread_arenas(ostream& out) {
+    lock_guard<mutex> lock(thread_arenas_mutex);
+    for (size_t i = 0; i < thread_arenas.size(); i++) {
+        out << "Scratch arena " << i << ": high-water mark " << thread_arenas[i]->high_water_mark()
+            << " bytes, capacity " << thread_arenas[i]->capacity() << " bytes" << endl;
+    }
+}
+
+ScratchArena::Scope::Scope() : arena(ScratchArena::for_this_thread()) {
+    arena.scope_depth++;
+}
+
+ScratchArena::Scope::~Scope() {
+    assert(arena.scope_depth > 0);
+    arena.scope_depth--;
+    if (arena.scope_depth == 0) {
+        // Nothing can be using the arena anymore.
+        arena.reset();
+    }
+}
+
+}
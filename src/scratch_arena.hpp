@@ -0,0 +1,173 @@
+#ifndef VG_SCRATCH_ARENA_HPP_INCLUDED
+#define VG_SCRATCH_ARENA_HPP_INCLUDED
+
+/**
+ * \file scratch_arena.hpp
+ * Defines a per-thread monotonic arena for short-lived scratch memory, and an
+ * STL allocator that draws from it.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * A monotonic bump allocator. Allocations are carved out of large blocks and
+ * are never individually freed; instead the whole arena is reset at once when
+ * all the scratch data in it is dead.
+ *
+ * When reset, the arena keeps its largest block around, so once it has warmed
+ * up to the size needed for a typical task, it no longer talks to the system
+ * allocator at all.
+ *
+ * Not thread safe; each thread should use its own arena, as obtained from
+ * for_this_thread().
+ */
+class ScratchArena {
+public:
+    /// Make a new arena, which will allocate blocks of at least the given size.
+    ScratchArena(size_t min_block_size = DEFAULT_BLOCK_SIZE);
+
+    ~ScratchArena() = default;
+
+    // Arenas hand out pointers to their blocks, so they can't be copied or moved.
+    ScratchArena(const ScratchArena& other) = delete;
+    ScratchArena(ScratchArena&& other) = delete;
+    ScratchArena& operator=(const ScratchArena& other) = delete;
+    ScratchArena& operator=(ScratchArena&& other) = delete;
+
+    /// Get memory for the given number of bytes, at the given alignment.
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    /// Forget about all allocations. All memory handed out is invalidated.
+    void reset();
+
+    /// Get the number of bytes currently handed out.
+    size_t used() const;
+
+    /// Get the most bytes that have ever been handed out between resets.
+    size_t high_water_mark() const;
+
+    /// Get the number of bytes held in blocks, used or not.
+    size_t capacity() const;
+
+    /**
+     * Get the arena for the calling thread. It lives as long as the thread
+     * does, or until the end of the program, whichever is later.
+     */
+    static ScratchArena& for_this_thread();
+
+    /**
+     * Write a line for each thread that has used its arena, giving the
+     * arena's high-water mark and capacity.
+     */
+    static void report_thread_arenas(ostream& out);
+
+    /**
+     * RAII guard marking a region where the calling thread's arena is in use.
+     * Guards may nest; the arena is reset when the outermost guard goes away.
+     */
+    class Scope {
+    public:
+        Scope();
+        ~Scope();
+        Scope(const Scope& other) = delete;
+        Scope& operator=(const Scope& other) = delete;
+    protected:
+        ScratchArena& arena;
+    };
+
+    /// Default size of the first block
+    static const size_t DEFAULT_BLOCK_SIZE;
+
+protected:
+
+    /// A block of memory that we allocate out of.
+    struct Block {
+        unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    /// Smallest block to allocate.
+    size_t min_block_size;
+    /// All blocks we own. The last one is the one being allocated from.
+    vector<Block> blocks;
+    /// Bytes used in the last block.
+    size_t block_used = 0;
+    /// Bytes used in all blocks before the last one.
+    size_t earlier_used = 0;
+    /// Most bytes ever used between resets.
+    size_t peak = 0;
+    /// How many Scopes are open for this arena.
+    size_t scope_depth = 0;
+
+    /// All the per-thread arenas that have been created, for reporting.
+    static vector<shared_ptr<ScratchArena>> thread_arenas;
+    /// Mutex protecting thread_arenas
+    static mutex thread_arenas_mutex;
+};
+
+/**
+ * STL allocator that draws from a ScratchArena. Deallocation is a no-op;
+ * memory comes back when the arena is reset. Containers using this allocator
+ * must not outlive the reset of their arena.
+ */
+template<typename T>
+class ScratchAllocator {
+public:
+    typedef T value_type;
+
+    /// Make an allocator drawing from the calling thread's arena.
+    ScratchAllocator() : arena(&ScratchArena::for_this_thread()) {
+        // Nothing to do
+    }
+
+    /// Make an allocator drawing from the given arena.
+    ScratchAllocator(ScratchArena& arena) : arena(&arena) {
+        // Nothing to do
+    }
+
+    template<typename U>
+    ScratchAllocator(const ScratchAllocator<U>& other) : arena(other.arena) {
+        // Nothing to do
+    }
+
+    T* allocate(size_t n) {
+        return (T*) arena->allocate(n * sizeof(T), alignof(T));
+    }
+
+    void deallocate(T* p, size_t n) {
+        // Memory is reclaimed when the arena is reset.
+    }
+
+    template<typename U>
+    bool operator==(const ScratchAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+
+    template<typename U>
+    bool operator!=(const ScratchAllocator<U>& other) const {
+        return arena != other.arena;
+    }
+
+protected:
+    template<typename U>
+    friend class ScratchAllocator;
+
+    ScratchArena* arena;
+};
+
+/// A vector of scratch data, allocated from the calling thread's arena.
+template<typename T>
+using ScratchVector = std::vector<T, ScratchAllocator<T>>;
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * \file shard_manifest.cpp
+ * Implementation for shard manifests and reading shards as one input
+ */
+
+#include "shard_manifest.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <streambuf>
+
+#include <sys/stat.h>
+
+namespace vg {
+
+using namespace std;
+
+const string SHARD_MANIFEST_HEADER = "#vg-shards";
+
+/// Get the directory part of a file name, with its trailing slash, or "" if
+/// there is none.
+static string directory_of(const string& filename) {
+    size_t slash = filename.rfind('/');
+    return slash == string::npos ? "" : filename.substr(0, slash + 1);
+}
+
+bool is_shard_manifest(const string& filename) {
+    struct stat info;
+    if (filename == "-" || stat(filename.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    ifstream in(filename);
+    string header(SHARD_MANIFEST_HEADER.size(), '\0');
+    in.read(&header[0], header.size());
+    return in && header == SHARD_MANIFEST_HEADER;
+}
+
+vector<string> read_shard_manifest(const string& filename) {
+    ifstream in(filename);
+    string line;
+    if (!in || !getline(in, line) || line.compare(0, SHARD_MANIFEST_HEADER.size(), SHARD_MANIFEST_HEADER) != 0) {
+        cerr << "error:[read_shard_manifest] " << filename << " is not a shard manifest" << endl;
+        exit(1);
+    }
+
+    string directory = directory_of(filename);
+    vector<string> shards;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        string shard = (line[0] == '/') ? line : directory + line;
+        if (!ifstream(shard)) {
+            cerr << "error:[read_shard_manifest] could not open shard " << shard << " listed in " << filename << endl;
+            exit(1);
+        }
+        shards.emplace_back(std::move(shard));
+    }
+    return shards;
+}
+
+void write_shard_manifest(const string& filename, const vector<string>& shard_filenames) {
+    ofstream out(filename);
+    string directory = directory_of(filename);
+    out << SHARD_MANIFEST_HEADER << "\n";
+    for (const string& shard : shard_filenames) {
+        if (directory_of(shard) == directory) {
+            out << shard.substr(directory.size()) << "\n";
+        } else {
+            out << shard << "\n";
+        }
+    }
+    if (!out) {
+        cerr << "error:[write_shard_manifest] could not write shard manifest " << filename << endl;
+        exit(1);
+    }
+}
+
+vector<string> expand_shard_manifest(const string& filename) {
+    if (is_shard_manifest(filename)) {
+        return read_shard_manifest(filename);
+    }
+    return {filename};
+}
+
+/// Stream buffer that reads from each file in turn.
+class ConcatenatedInputStream::Buffer : public streambuf {
+public:
+    Buffer(const vector<string>& filenames) : filenames(filenames), data(1 << 16) {
+        // Nothing to do
+    }
+
+protected:
+    int_type underflow() {
+        while (true) {
+            if (current.is_open()) {
+                current.read(data.data(), data.size());
+                streamsize got = current.gcount();
+                if (got > 0) {
+                    setg(data.data(), data.data(), data.data() + got);
+                    return traits_type::to_int_type(*gptr());
+                }
+                current.close();
+            }
+            if (next_file == filenames.size()) {
+                return traits_type::eof();
+            }
+            current.open(filenames[next_file], ios::binary);
+            if (!current.is_open()) {
+                cerr << "error:[ConcatenatedInputStream] could not open " << filenames[next_file] << endl;
+                exit(1);
+            }
+            next_file++;
+        }
+    }
+
+private:
+    vector<string> filenames;
+    size_t next_file = 0;
+    ifstream current;
+    vector<char> data;
+};
+
+ConcatenatedInputStream::ConcatenatedInputStream(const vector<string>& filenames) : istream(nullptr),
+    buffer(new Buffer(filenames)) {
+    rdbuf(buffer.get());
+}
+
+ConcatenatedInputStream::~ConcatenatedInputStream() {
+    // Defined here where the Buffer is complete.
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef VG_SHARD_MANIFEST_HPP_INCLUDED
+#define VG_SHARD_MANIFEST_HPP_INCLUDED
+
+/**
+ * \file shard_manifest.hpp
+ *
+ * Defines manifests that let an output split into several shard files be
+ * read back as one input.
+ *
+ * A manifest is a text file starting with a "#vg-shards" header line, and
+ * then one shard file name per line. Relative shard names are relative to
+ * the directory the manifest is in. Shards are read in the order listed.
+ */
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/// The first line of every shard manifest
+extern const string SHARD_MANIFEST_HEADER;
+
+/// Return true if the given file is a regular file that starts like a shard
+/// manifest. Never reads from anything but regular files, so it is safe to
+/// call on pipes and standard input ("-").
+bool is_shard_manifest(const string& filename);
+
+/// Read the shard file names listed in a manifest, resolved relative to the
+/// manifest's directory. Reports an error and quits if the manifest can't be
+/// read or a shard doesn't exist.
+vector<string> read_shard_manifest(const string& filename);
+
+/// Write a manifest listing the given shard files. Shards in the same directory
+/// as the manifest are listed by their base names.
+void write_shard_manifest(const string& filename, const vector<string>& shard_filenames);
+
+/// Get the files to read for the given input: the shards if it is a manifest,
+/// and otherwise just the file itself.
+vector<string> expand_shard_manifest(const string& filename);
+
+/**
+ * An input stream that reads a series of files one after the other, as if
+ * they were one file. Compressed formats made of independent blocks, like the
+ * BGZF used for GAM, can be read straight through the joins.
+ */
+class ConcatenatedInputStream : public istream {
+public:
+    ConcatenatedInputStream(const vector<string>& filenames);
+    ~ConcatenatedInputStream();
+
+private:
+    class Buffer;
+    unique_ptr<Buffer> buffer;
+};
+
+}
+
+#endif
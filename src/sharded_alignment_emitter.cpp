@@ -0,0 +1,69 @@
+/**
+ * \file sharded_alignment_emitter.cpp
+ * Implementation for ShardedAlignmentEmitter
+ */
+
+
+#include "sharded_alignment_emitter.hpp"
+#include "hts_alignment_emitter.hpp"
+#include "shard_manifest.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <omp.h>
+
+namespace vg {
+
+using namespace std;
+
+ShardedAlignmentEmitter::ShardedAlignmentEmitter(const string& manifest_filename, const string& format,
+                                                 const vector<tuple<path_handle_t, size_t, size_t>>& paths, size_t max_threads,
+                                                 const HandleGraph* graph, int flags) :
+    manifest_filename(manifest_filename) {
+
+    if (format == "SAM" || format == "BAM" || format == "CRAM") {
+        cerr << "error[vg::ShardedAlignmentEmitter]: " << format << " output cannot be sharded" << endl;
+        exit(1);
+    }
+    if (manifest_filename == "-") {
+        cerr << "error[vg::ShardedAlignmentEmitter]: shard manifest must go to a file" << endl;
+        exit(1);
+    }
+
+    string extension = format;
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    for (size_t i = 0; i < max_threads; i++) {
+        shard_filenames.push_back(manifest_filename + "." + to_string(i) + "." + extension);
+        // Each shard is only written by one thread, but that thread can have
+        // any number, so each needs to be ready for all of them.
+        shards.emplace_back(get_alignment_emitter(shard_filenames.back(), format, paths, max_threads, graph, flags));
+    }
+}
+
+ShardedAlignmentEmitter::~ShardedAlignmentEmitter() {
+    // Make sure everything is on disk before saying where it is.
+    shards.clear();
+    write_shard_manifest(manifest_filename, shard_filenames);
+}
+
+AlignmentEmitter& ShardedAlignmentEmitter::shard_for_thread() {
+    return *shards.at(omp_get_thread_num());
+}
+
+void ShardedAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
+    shard_for_thread().emit_singles(std::move(aln_batch));
+}
+
+void ShardedAlignmentEmitter::emit_mapped_singles(vector<vector<Alignment>>&& alns_batch) {
+    shard_for_thread().emit_mapped_singles(std::move(alns_batch));
+}
+
+void ShardedAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch, vector<int64_t>&& tlen_limit_batch) {
+    shard_for_thread().emit_pairs(std::move(aln1_batch), std::move(aln2_batch), std::move(tlen_limit_batch));
+}
+
+void ShardedAlignmentEmitter::emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch, vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch) {
+    shard_for_thread().emit_mapped_pairs(std::move(alns1_batch), std::move(alns2_batch), std::move(tlen_limit_batch));
+}
+
+}
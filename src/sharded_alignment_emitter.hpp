@@ -0,0 +1,72 @@
+#ifndef VG_SHARDED_ALIGNMENT_EMITTER_HPP_INCLUDED
+#define VG_SHARDED_ALIGNMENT_EMITTER_HPP_INCLUDED
+
+/** \file
+ *
+ * Holds an AlignmentEmitter that gives each thread its own output file.
+ */
+
+
+#include "vg/io/alignment_emitter.hpp"
+#include "handle.hpp"
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * An AlignmentEmitter implementation that sends what each OMP thread emits
+ * to that thread's own shard file, so threads never wait on each other to
+ * write. When it is destroyed, and the shards are complete, it writes a shard
+ * manifest (see shard_manifest.hpp) listing them, which other commands can
+ * read as one input.
+ *
+ * Shards are named after the manifest, with the thread number and the format
+ * as extensions.
+ */
+class ShardedAlignmentEmitter : public vg::io::AlignmentEmitter {
+public:
+
+    /**
+     * Make an emitter that writes a manifest to the given file (which may not
+     * be "-"), and one shard in the given format for each of up to max_threads
+     * OMP threads. The other arguments are as for get_alignment_emitter(), and
+     * are used for each shard. HTSlib formats are not supported.
+     */
+    ShardedAlignmentEmitter(const string& manifest_filename, const string& format,
+                            const vector<tuple<path_handle_t, size_t, size_t>>& paths, size_t max_threads,
+                            const HandleGraph* graph, int flags);
+
+    /// Finish the shards and write the manifest.
+    ~ShardedAlignmentEmitter();
+
+    /// Emit a batch of Alignments
+    virtual void emit_singles(vector<Alignment>&& aln_batch);
+    /// Emit batch of Alignments with secondaries. All secondaries must have is_secondary set already.
+    virtual void emit_mapped_singles(vector<vector<Alignment>>&& alns_batch);
+    /// Emit a batch of pairs of Alignments.
+    virtual void emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch,
+        vector<int64_t>&& tlen_limit_batch);
+    /// Emit the mappings of a batch of pairs of Alignments. All secondaries
+    /// must have is_secondary set already.
+    virtual void emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch,
+        vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch);
+
+protected:
+    string manifest_filename;
+    vector<string> shard_filenames;
+    /// The emitter for each thread's shard
+    vector<unique_ptr<AlignmentEmitter>> shards;
+
+    /// Get the emitter for the calling thread.
+    AlignmentEmitter& shard_for_thread();
+};
+
+}
+
+#endif
@@ -89,15 +89,27 @@ pair<size_t, size_t> SmallSnarlSimplifier::simplify_once(size_t iteration) {
     // not work if we modify the graph.
     map<const Snarl*, vector<SnarlTraversal>> leaf_traversals;
     
-    for (const Snarl* leaf : leaves) {
+    // Make all the entries up front, so the leaves can be filled in in
+    // parallel. Finding contents and traversals only reads the graph.
+    vector<const Snarl*> leaf_order(leaves.begin(), leaves.end());
+    for (const Snarl* leaf : leaf_order) {
+        leaf_contents[leaf];
+        leaf_sizes[leaf];
+        leaf_traversals[leaf];
+    }
+    
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < leaf_order.size(); i++) {
         // Look at all the leaves
+        const Snarl* leaf = leaf_order[i];
         
         // Get the contents of the bubble, excluding the boundary nodes
-        leaf_contents[leaf] = site_manager.deep_contents(leaf, graph, false);
+        auto& contents = leaf_contents.at(leaf);
+        contents = site_manager.deep_contents(leaf, graph, false);
         
         // For each leaf, calculate its total size.
-        unordered_set<id_t>& nodes = leaf_contents[leaf].first;
-        size_t& total_size = leaf_sizes[leaf];
+        unordered_set<id_t>& nodes = contents.first;
+        size_t& total_size = leaf_sizes.at(leaf);
         for (id_t node_id : nodes) {
             // For each node include it in the size figure
             total_size += graph.get_length(graph.get_handle(node_id));
@@ -116,8 +128,7 @@ pair<size_t, size_t> SmallSnarlSimplifier::simplify_once(size_t iteration) {
         
         // Identify the replacement traversal for the bubble if it's the right size.
         // We can't necessarily do this after we've modified the graph.
-        vector<SnarlTraversal>& traversals = leaf_traversals[leaf];
-        traversals = traversal_finder.find_traversals(*leaf);
+        leaf_traversals.at(leaf) = traversal_finder.find_traversals(*leaf);
     }
     
     for (const Snarl* leaf : leaves) {
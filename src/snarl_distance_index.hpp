@@ -22,13 +22,14 @@ size_t maximum_distance(const SnarlDistanceIndex& distance_index, pos_t pos1, po
 
 //Fill in the index
 //size_limit is a limit on the number of nodes in a snarl, after which the index won't store pairwise distances
-void fill_in_distance_index(SnarlDistanceIndex* distance_index, const HandleGraph* graph, const HandleGraphSnarlFinder* snarl_finder, size_t size_limit = 50000);
+//Chains at the same depth in the snarl tree are filled in in parallel
+void fill_in_distance_index(SnarlDistanceIndex* distance_index, const HandleGraph* graph, const HandleGraphSnarlFinder* snarl_finder, size_t size_limit = 50000, bool show_progress = false);
 
 //Fill in the temporary snarl record with distances
 void populate_snarl_index(SnarlDistanceIndex::TemporaryDistanceIndex& temp_index, 
     pair<SnarlDistanceIndex::temp_record_t, size_t> snarl_index, size_t size_limit, const HandleGraph* graph) ;
 
-SnarlDistanceIndex::TemporaryDistanceIndex make_temporary_distance_index(const HandleGraph* graph, const HandleGraphSnarlFinder* snarl_finder, size_t size_limit);
+SnarlDistanceIndex::TemporaryDistanceIndex make_temporary_distance_index(const HandleGraph* graph, const HandleGraphSnarlFinder* snarl_finder, size_t size_limit, bool show_progress = false);
 
 //Define wang_hash for net_handle_t's so that we can use a hash_map
 template<> struct wang_hash<handlegraph::net_handle_t> {
@@ -122,6 +123,12 @@ struct MIPayloadValues{
 //
 // If no values are stored, then the two uint64_t's will both be inf
 // bools are always stored, everything else is all 1's if it is not stored
+//
+// The prefix sum and chain component are NO_VALUE for nodes that are children
+// of the root or of root snarls. These are stored as all 1's, so that those
+// nodes get payloads too, like nodes in nested snarls, and clustering doesn't
+// have to look them up in the distance index. That means all 1's can't be
+// used for an actual value.
 // 
 
 struct MIPayload {
@@ -171,11 +178,14 @@ struct MIPayload {
              || info.parent_record_offset > PARENT_RECORD_MASK
              || info.node_record_offset > NODE_RECORD_OFFSET_MASK
              || info.node_length > NODE_LENGTH_MASK
-             || info.prefix_sum > PREFIX_SUM_MASK
-             || info.chain_component > CHAIN_COMPONENT_MASK) {
+             || (info.prefix_sum >= PREFIX_SUM_MASK && info.prefix_sum != NO_VALUE)
+             || (info.chain_component >= CHAIN_COMPONENT_MASK && info.chain_component != NO_VALUE)) {
             //If there aren't enough bits to represent one of the values
             return NO_CODE;
         }
+        //Missing values are all 1's
+        code_type prefix_sum = info.prefix_sum == NO_VALUE ? PREFIX_SUM_MASK : info.prefix_sum;
+        code_type chain_component = info.chain_component == NO_VALUE ? CHAIN_COMPONENT_MASK : info.chain_component;
 
         code_type encoded1 = (static_cast<code_type>(info.record_offset)           << NODE_RECORD_OFFSET)
                            | (static_cast<code_type>(info.parent_record_offset)  << PARENT_RECORD_OFFSET);
@@ -186,8 +196,8 @@ struct MIPayload {
                            | (static_cast<code_type>(info.is_trivial_chain)   << IS_TRIVIAL_CHAIN_OFFSET)
                            | (static_cast<code_type>(info.parent_is_chain)    << PARENT_IS_CHAIN_OFFSET)
                            | (static_cast<code_type>(info.parent_is_root)    << PARENT_IS_ROOT_OFFSET)
-                           | (static_cast<code_type>(info.prefix_sum)         << PREFIX_SUM_OFFSET)
-                           | (static_cast<code_type>(info.chain_component)    << CHAIN_COMPONENT_OFFSET);
+                           | (prefix_sum                                      << PREFIX_SUM_OFFSET)
+                           | (chain_component                                 << CHAIN_COMPONENT_OFFSET);
 
         return {encoded1, encoded2};
 
@@ -230,11 +240,13 @@ struct MIPayload {
     }
     static void set_prefix_sum(gbwtgraph::Payload& code, size_t prefix_sum) {
         code.second = code.second & ~(PREFIX_SUM_MASK << PREFIX_SUM_OFFSET);
-        code.second = code.second | (static_cast<code_type>(prefix_sum) << PREFIX_SUM_OFFSET);
+        code_type value = prefix_sum == NO_VALUE ? PREFIX_SUM_MASK : (static_cast<code_type>(prefix_sum) & PREFIX_SUM_MASK);
+        code.second = code.second | (value << PREFIX_SUM_OFFSET);
     }
     static void set_chain_component(gbwtgraph::Payload& code, size_t chain_component) {
         code.second = code.second & ~(CHAIN_COMPONENT_MASK << CHAIN_COMPONENT_OFFSET);
-        code.second = code.second | (static_cast<code_type>(chain_component) << CHAIN_COMPONENT_OFFSET);
+        code_type value = chain_component == NO_VALUE ? CHAIN_COMPONENT_MASK : (static_cast<code_type>(chain_component) & CHAIN_COMPONENT_MASK);
+        code.second = code.second | (value << CHAIN_COMPONENT_OFFSET);
     }
 
 
@@ -292,13 +304,15 @@ struct MIPayload {
         if (code == NO_CODE) {
             return NO_VALUE;
         }
-        return (size_t) (code.second >> PREFIX_SUM_OFFSET & PREFIX_SUM_MASK);
+        code_type value = code.second >> PREFIX_SUM_OFFSET & PREFIX_SUM_MASK;
+        return value == PREFIX_SUM_MASK ? NO_VALUE : (size_t) value;
     }
     static size_t chain_component (const gbwtgraph::Payload code) { 
         if (code == NO_CODE) {
             return NO_VALUE;
         }
-        return (size_t) (code.second >> CHAIN_COMPONENT_OFFSET    & CHAIN_COMPONENT_MASK);
+        code_type value = code.second >> CHAIN_COMPONENT_OFFSET & CHAIN_COMPONENT_MASK;
+        return value == CHAIN_COMPONENT_MASK ? NO_VALUE : (size_t) value;
     }
 
     
@@ -23,7 +23,30 @@ SnarlDistanceIndexClusterer::SnarlDistanceIndexClusterer( const SnarlDistanceInd
                                         graph(nullptr){
 };
 
-vector<SnarlDistanceIndexClusterer::Cluster> SnarlDistanceIndexClusterer::cluster_seeds (const vector<Seed>& seeds, size_t read_distance_limit) const {
+unique_ptr<SnarlDistanceIndexClusterer::ClusteringScratch> SnarlDistanceIndexClusterer::ClusteringScratch::take() {
+    vector<unique_ptr<ClusteringScratch>>& pool = thread_pool();
+    if (pool.empty()) {
+        return unique_ptr<ClusteringScratch>(new ClusteringScratch());
+    }
+    unique_ptr<ClusteringScratch> scratch = std::move(pool.back());
+    pool.pop_back();
+    return scratch;
+}
+
+void SnarlDistanceIndexClusterer::ClusteringScratch::give(unique_ptr<ClusteringScratch>&& scratch) {
+    scratch->clear();
+    thread_pool().emplace_back(std::move(scratch));
+}
+
+vector<unique_ptr<SnarlDistanceIndexClusterer::ClusteringScratch>>& SnarlDistanceIndexClusterer::ClusteringScratch::thread_pool() {
+    //In case more than one problem is alive on a thread at once, this is a pool and not just one scratch
+    thread_local vector<unique_ptr<ClusteringScratch>> pool;
+    return pool;
+}
+
+vector<SnarlDistanceIndexClusterer::Cluster> SnarlDistanceIndexClusterer::cluster_seeds (const vector<Seed>& seeds, size_t read_distance_limit,
+                                                                                     DistanceCache* distance_cache,
+                                                                                     size_t parallel_seed_threshold) const {
     //Wrapper for single ended
 
     vector<SeedCache> seed_caches(seeds.size());
@@ -34,7 +57,7 @@ vector<SnarlDistanceIndexClusterer::Cluster> SnarlDistanceIndexClusterer::cluste
     vector<vector<SeedCache>*> all_seed_caches = {&seed_caches};
 
     std::vector<std::vector<size_t>> all_clusters =
-        std::get<0>(cluster_seeds_internal(all_seed_caches, read_distance_limit, 0))[0].all_groups();
+        std::get<0>(cluster_seeds_internal(all_seed_caches, read_distance_limit, 0, distance_cache, parallel_seed_threshold))[0].all_groups();
 
     std::vector<Cluster> result;
     result.reserve(all_clusters.size());
@@ -52,7 +75,9 @@ vector<SnarlDistanceIndexClusterer::Cluster> SnarlDistanceIndexClusterer::cluste
 
 vector<vector<SnarlDistanceIndexClusterer::Cluster>> SnarlDistanceIndexClusterer::cluster_seeds (
               const vector<vector<Seed>>& all_seeds, 
-              size_t read_distance_limit, size_t fragment_distance_limit) const {
+              size_t read_distance_limit, size_t fragment_distance_limit,
+              DistanceCache* distance_cache,
+              size_t parallel_seed_threshold) const {
     //Wrapper for paired end
 
     if (all_seeds.size() > 2) {
@@ -77,7 +102,8 @@ vector<vector<SnarlDistanceIndexClusterer::Cluster>> SnarlDistanceIndexClusterer
     for (vector<SeedCache>& v : all_seed_caches) seed_cache_pointers.push_back(&v);
 
     //Actually cluster the seeds
-    auto union_finds = cluster_seeds_internal(seed_cache_pointers, read_distance_limit, fragment_distance_limit);
+    auto union_finds = cluster_seeds_internal(seed_cache_pointers, read_distance_limit, fragment_distance_limit, distance_cache,
+                                              parallel_seed_threshold);
 
     vector<structures::UnionFind>* read_union_finds = &std::get<0>(union_finds);
     structures::UnionFind* fragment_union_find = &std::get<1>(union_finds);
@@ -86,7 +112,7 @@ vector<vector<SnarlDistanceIndexClusterer::Cluster>> SnarlDistanceIndexClusterer
     //Map the old group heads to new indices
     size_t curr_index = 0;
     size_t read_num_offset = 0;
-    hash_map<size_t, size_t> old_to_new_cluster_index;
+    flat_hash_map<size_t, size_t> old_to_new_cluster_index;
 
     for (size_t read_num = 0 ; read_num < read_union_finds->size() ; read_num++) {
         vector<vector<size_t>> read_clusters = read_union_finds->at(read_num).all_groups();
@@ -122,9 +148,20 @@ vector<vector<SnarlDistanceIndexClusterer::Cluster>> SnarlDistanceIndexClusterer
 }
 
 
+size_t SnarlDistanceIndexClusterer::distance_in_parent(ClusteringProblem& clustering_problem, const net_handle_t& parent,
+    const net_handle_t& child1, const net_handle_t& child2, const HandleGraph* graph, size_t distance_limit) const {
+    if (clustering_problem.distance_cache != nullptr) {
+        //Sibling pairs come up again and again when we cluster the same read more than once
+        return clustering_problem.distance_cache->distance_in_parent(distance_index, parent, child1, child2, graph, distance_limit);
+    }
+    return distance_index.distance_in_parent(parent, child1, child2, graph, distance_limit);
+}
+
 tuple<vector<structures::UnionFind>, structures::UnionFind> SnarlDistanceIndexClusterer::cluster_seeds_internal (
               vector<vector<SeedCache>*>& all_seeds, 
-              size_t read_distance_limit, size_t fragment_distance_limit) const {
+              size_t read_distance_limit, size_t fragment_distance_limit,
+              DistanceCache* distance_cache,
+              size_t parallel_seed_threshold) const {
     /* Given a vector of seeds and a limit, find a clustering of seeds where
      * seeds that are closer than the limit cluster together.
      * Returns a vector of clusters
@@ -153,6 +190,9 @@ cerr << "\tread distance limit: " << read_distance_limit << " and fragment dista
     size_t seed_count = 0;
     for (auto v : all_seeds) seed_count+= v->size();
     ClusteringProblem clustering_problem (&all_seeds, read_distance_limit, fragment_distance_limit, seed_count);
+    clustering_problem.distance_cache = distance_cache;
+    //Only very long reads have enough work per level to be worth splitting up
+    clustering_problem.parallel = parallel_seed_threshold != 0 && seed_count >= parallel_seed_threshold;
 
 
     //Initialize chains_by_level with all the seeds on chains
@@ -313,12 +353,12 @@ cerr << "Add all seeds to nodes: " << endl;
 
 
     //Map the parent SnarlTreeNodeProblem to its depth so we don't use get_depth() as much
-    hash_map<net_handle_t, size_t> parent_to_depth;
+    flat_hash_map<net_handle_t, size_t> parent_to_depth;
     parent_to_depth.reserve(clustering_problem.seed_count_prefix_sum.back());
 
 
     //All nodes we've already assigned
-    hash_set<id_t> seen_nodes;
+    flat_hash_set<id_t> seen_nodes;
     seen_nodes.reserve(clustering_problem.seed_count_prefix_sum.back());
 
     for (size_t read_num = 0 ; read_num < clustering_problem.all_seeds->size() ; read_num++){ 
@@ -455,7 +495,8 @@ cerr << distance_index.net_handle_as_string(node_net_handle) << " parent: " << d
                     //and remember it in the seed's cache
 
                     //prefix sum
-                    prefix_sum = is_trivial_chain ? std::numeric_limits<size_t>::max() 
+                    //A node that is a trivial chain starts at the start of it, as in the payload
+                    prefix_sum = is_trivial_chain ? 0
                                                   : distance_index.get_prefix_sum_value(node_net_handle);
                     MIPayload::set_prefix_sum(seed.minimizer_cache, prefix_sum);
 
@@ -476,7 +517,7 @@ cerr << distance_index.net_handle_as_string(node_net_handle) << " parent: " << d
 
                 }
 #ifdef DEBUG_CLUSTER
-                //assert(prefix_sum == (is_trivial_chain ? std::numeric_limits<size_t>::max() 
+                //assert(prefix_sum == (is_trivial_chain ? 0 
                 //                                  : distance_index.get_prefix_sum_value(node_net_handle)));
                 assert(node_length == distance_index.minimum_length(node_net_handle));
 
@@ -690,20 +731,51 @@ cerr << distance_index.net_handle_as_string(node_net_handle) << " parent: " << d
 
 //Cluster all of the snarls in clustering_problem from the same depth
 //Assumes that all the children of the snarls have been clustered already and are present in clustering_problem.snarls_to_children
+void SnarlDistanceIndexClusterer::for_each_subtree(ClusteringProblem& clustering_problem, size_t count,
+                                                   const std::function<void(size_t)>& cluster_one) const {
+    if (!clustering_problem.parallel || count < 2) {
+        for (size_t i = 0 ; i < count ; i++) {
+            cluster_one(i);
+        }
+        return;
+    }
+
+    DistanceCache* distance_cache = clustering_problem.distance_cache;
+    clustering_problem.distance_cache = nullptr;
+
+    //These become tasks for whatever team we are running in, so idle mapping threads
+    //can pick them up. Outside of a parallel region they just run in order
+    for (size_t i = 0 ; i < count ; i++) {
+        #pragma omp task firstprivate(i) shared(cluster_one)
+        {
+            cluster_one(i);
+        }
+    }
+    #pragma omp taskwait
+
+    clustering_problem.distance_cache = distance_cache;
+}
+
 void SnarlDistanceIndexClusterer::cluster_snarl_level(ClusteringProblem& clustering_problem) const {
 
-    for (const net_handle_t& snarl_handle : clustering_problem.parent_snarls) {
-        //Go through each of the snarls at this level, cluster them,
-        //and find which chains they belong to, if any
+    //Cluster each of the snarls at this level. Snarls at the same level don't
+    //share any seeds, so this can be done in any order
+    for_each_subtree(clustering_problem, clustering_problem.parent_snarls.size(), [&](size_t i) {
         SnarlTreeNodeProblem* snarl_problem = &clustering_problem.all_node_problems.at(
-                                                    clustering_problem.net_handle_to_node_problem_index.at(snarl_handle));
+                clustering_problem.net_handle_to_node_problem_index.at(clustering_problem.parent_snarls[i]));
 
 #ifdef DEBUG_CLUSTER
         cerr << "Cluster one snarl " << distance_index.net_handle_as_string(snarl_problem->containing_net_handle) << endl;
 #endif
 
-        //Cluster the snarlindex];
         cluster_one_snarl(clustering_problem, snarl_problem);
+    });
+
+    for (const net_handle_t& snarl_handle : clustering_problem.parent_snarls) {
+        //Go through each of the clustered snarls
+        //and find which chains they belong to, if any
+        SnarlTreeNodeProblem* snarl_problem = &clustering_problem.all_node_problems.at(
+                                                    clustering_problem.net_handle_to_node_problem_index.at(snarl_handle));
 
         /*Now add the snarl to its parent. Only do so if the clusters are close enough to the boundaries that it can be clustered*/
 
@@ -784,8 +856,21 @@ void SnarlDistanceIndexClusterer::cluster_chain_level(ClusteringProblem& cluster
     }
 
 
-    for (const net_handle_t& chain_handle : *(clustering_problem.current_chains)) {
+    const vector<net_handle_t>& chains = *(clustering_problem.current_chains);
+
+    //Where each chain goes once it is clustered
+    struct ChainPlacement {
+        net_handle_t parent;
+        bool is_root;
+        bool is_root_snarl;
+        bool is_top_level_chain;
+    };
+    vector<ChainPlacement> placements(chains.size());
 
+    //Cluster each of the chains at this level. Chains at the same level don't
+    //share any seeds, so this can be done in any order
+    for_each_subtree(clustering_problem, chains.size(), [&](size_t i) {
+        const net_handle_t& chain_handle = chains[i];
         SnarlTreeNodeProblem* chain_problem = &clustering_problem.all_node_problems.at(
                 clustering_problem.net_handle_to_node_problem_index.at(chain_handle));
 
@@ -797,23 +882,33 @@ void SnarlDistanceIndexClusterer::cluster_chain_level(ClusteringProblem& cluster
         }
 #endif
 
-
-        net_handle_t parent = chain_problem->has_parent_handle
+        ChainPlacement& placement = placements[i];
+        placement.parent = chain_problem->has_parent_handle
                             ? chain_problem->parent_net_handle
                             : distance_index.start_end_traversal_of(distance_index.get_parent(chain_handle));
-        bool is_root = distance_index.is_root(parent);
-        bool is_root_snarl = is_root ? distance_index.is_root_snarl(parent) : false;
+        placement.is_root = distance_index.is_root(placement.parent);
+        placement.is_root_snarl = placement.is_root ? distance_index.is_root_snarl(placement.parent) : false;
 
         //This is used to determine if we need to remember the distances to the ends of the chain, since
         //for a top level chain it doesn't matter
-        bool is_top_level_chain = (depth == 1) && !is_root_snarl &&
+        placement.is_top_level_chain = (depth == 1) && !placement.is_root_snarl &&
                          !distance_index.is_externally_start_start_connected(chain_handle) &&
                          !distance_index.is_externally_start_end_connected(chain_handle) &&
                          !distance_index.is_externally_end_end_connected(chain_handle) &&
                          !distance_index.is_looping_chain(chain_handle);
 
         // Compute the clusters for the chain
-        cluster_one_chain(clustering_problem, chain_problem, is_top_level_chain);
+        cluster_one_chain(clustering_problem, chain_problem, placement.is_top_level_chain);
+    });
+
+    for (size_t i = 0 ; i < chains.size() ; i++) {
+        const net_handle_t& chain_handle = chains[i];
+        SnarlTreeNodeProblem* chain_problem = &clustering_problem.all_node_problems.at(
+                clustering_problem.net_handle_to_node_problem_index.at(chain_handle));
+        const net_handle_t& parent = placements[i].parent;
+        bool is_root = placements[i].is_root;
+        bool is_root_snarl = placements[i].is_root_snarl;
+        bool is_top_level_chain = placements[i].is_top_level_chain;
 
         //Add the chain to its parent
         if (is_root) {
@@ -995,18 +1090,18 @@ void SnarlDistanceIndexClusterer::compare_and_combine_cluster_on_child_structure
 
 
     //Get the distances between the two sides of the children in the parent
-    size_t distance_left_left = distance_index.distance_in_parent(parent_handle, distance_index.flip(child_handle1), 
+    size_t distance_left_left = distance_in_parent(clustering_problem, parent_handle, distance_index.flip(child_handle1), 
                                             distance_index.flip(child_handle2), graph,
                                             (clustering_problem.fragment_distance_limit == 0 ? clustering_problem.read_distance_limit 
                                                                                      : clustering_problem.fragment_distance_limit));
-    size_t distance_left_right = distance_index.distance_in_parent(parent_handle, distance_index.flip(child_handle1), 
+    size_t distance_left_right = distance_in_parent(clustering_problem, parent_handle, distance_index.flip(child_handle1), 
                                             child_handle2, graph,
                                             (clustering_problem.fragment_distance_limit == 0 ? clustering_problem.read_distance_limit 
                                                                                      : clustering_problem.fragment_distance_limit));
-    size_t distance_right_right = distance_index.distance_in_parent(parent_handle, child_handle1, child_handle2, graph,
+    size_t distance_right_right = distance_in_parent(clustering_problem, parent_handle, child_handle1, child_handle2, graph,
                                             (clustering_problem.fragment_distance_limit == 0 ? clustering_problem.read_distance_limit 
                                                                                      : clustering_problem.fragment_distance_limit));
-    size_t distance_right_left = distance_index.distance_in_parent(parent_handle, child_handle1, 
+    size_t distance_right_left = distance_in_parent(clustering_problem, parent_handle, child_handle1, 
                                             distance_index.flip(child_handle2), graph,
                                             (clustering_problem.fragment_distance_limit == 0 ? clustering_problem.read_distance_limit 
                                                                                      : clustering_problem.fragment_distance_limit));
@@ -3,9 +3,14 @@
 
 #include "snarls.hpp"
 #include "snarl_distance_index.hpp"
+#include "distance_cache.hpp"
 #include "hash_map.hpp"
 #include "small_bitset.hpp"
 #include <structures/union_find.hpp>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 
 namespace vg{
@@ -104,8 +109,13 @@ class SnarlDistanceIndexClusterer {
          *between them (including both of the positions) is less than
          *the distance limit are in the same cluster
          *This produces a vector of clusters
+         *If a distance_cache is given, distance index queries go through it
+         *If there are at least parallel_seed_threshold seeds (and it isn't 0), the independent
+         *subtrees of the snarl tree are clustered in parallel as OpenMP tasks
          */
-        vector<Cluster> cluster_seeds ( const vector<Seed>& seeds, size_t read_distance_limit) const;
+        vector<Cluster> cluster_seeds ( const vector<Seed>& seeds, size_t read_distance_limit,
+                                        DistanceCache* distance_cache = nullptr,
+                                        size_t parallel_seed_threshold = 0) const;
         
         /* The same thing, but for paired end reads.
          * Given seeds from multiple reads of a fragment, cluster each read
@@ -119,7 +129,9 @@ class SnarlDistanceIndexClusterer {
 
         vector<vector<Cluster>> cluster_seeds ( 
                 const vector<vector<Seed>>& all_seeds, 
-                size_t read_distance_limit, size_t fragment_distance_limit=0) const;
+                size_t read_distance_limit, size_t fragment_distance_limit=0,
+                DistanceCache* distance_cache = nullptr,
+                size_t parallel_seed_threshold = 0) const;
 
 
         /**
@@ -135,7 +147,9 @@ class SnarlDistanceIndexClusterer {
         //fragment_distance_limit defaults to 0, meaning that we don't cluster by fragment
         tuple<vector<structures::UnionFind>, structures::UnionFind> cluster_seeds_internal ( 
                 vector<vector<SeedCache>*>& all_seeds,
-                size_t read_distance_limit, size_t fragment_distance_limit=0) const;
+                size_t read_distance_limit, size_t fragment_distance_limit=0,
+                DistanceCache* distance_cache = nullptr,
+                size_t parallel_seed_threshold = 0) const;
 
         const SnarlDistanceIndex& distance_index;
         const HandleGraph* graph;
@@ -242,21 +256,55 @@ class SnarlDistanceIndexClusterer {
 
             //Constructor
             //read_count is the number of reads in a fragment (2 for paired end)
-            SnarlTreeNodeProblem( net_handle_t net, size_t read_count, size_t seed_count, const SnarlDistanceIndex& distance_index) :
-                containing_net_handle(std::move(net)),
-                fragment_best_left(std::numeric_limits<size_t>::max()), fragment_best_right(std::numeric_limits<size_t>::max()){
-                read_cluster_heads.reserve(seed_count);
+            SnarlTreeNodeProblem( net_handle_t net, size_t read_count, size_t seed_count, const SnarlDistanceIndex& distance_index) {
+                reset(net, read_count, seed_count, distance_index);
             }
             //Constructor for a node or trivial chain, used to remember information from the cache
-            SnarlTreeNodeProblem( net_handle_t net, size_t read_count, size_t seed_count, bool is_reversed_in_parent, size_t node_length, size_t prefix_sum, size_t component) :
-                containing_net_handle(net),
-                is_reversed_in_parent(is_reversed_in_parent),
-                node_length(node_length),
-                prefix_sum_value(prefix_sum),
-                chain_component_start(component),
-                chain_component_end(component),
-                fragment_best_left(std::numeric_limits<size_t>::max()), fragment_best_right(std::numeric_limits<size_t>::max()){
-                    read_cluster_heads.reserve(seed_count);
+            SnarlTreeNodeProblem( net_handle_t net, size_t read_count, size_t seed_count, bool is_reversed_in_parent, size_t node_length, size_t prefix_sum, size_t component) {
+                reset(net, read_count, seed_count, is_reversed_in_parent, node_length, prefix_sum, component);
+            }
+
+            //Reinitialize as if newly constructed, but keep the memory of the
+            //children and cluster heads for reuse
+            void reset( net_handle_t net, size_t read_count, size_t seed_count, const SnarlDistanceIndex& distance_index) {
+                clear();
+                containing_net_handle = net;
+                read_cluster_heads.reserve(seed_count);
+            }
+            void reset( net_handle_t net, size_t read_count, size_t seed_count, bool is_reversed_in_parent, size_t node_length, size_t prefix_sum, size_t component) {
+                clear();
+                containing_net_handle = net;
+                this->is_reversed_in_parent = is_reversed_in_parent;
+                this->node_length = node_length;
+                prefix_sum_value = prefix_sum;
+                chain_component_start = component;
+                chain_component_end = component;
+                read_cluster_heads.reserve(seed_count);
+            }
+
+            //Forget everything about the snarl tree node
+            void clear() {
+                read_cluster_heads.clear();
+                children.clear();
+                read_best_left = make_pair(std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max());
+                read_best_right = make_pair(std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max());
+                fragment_best_left = std::numeric_limits<size_t>::max();
+                fragment_best_right = std::numeric_limits<size_t>::max();
+                distance_start_left = std::numeric_limits<size_t>::max();
+                distance_start_right = std::numeric_limits<size_t>::max();
+                distance_end_left = std::numeric_limits<size_t>::max();
+                distance_end_right = std::numeric_limits<size_t>::max();
+                node_length = std::numeric_limits<size_t>::max();
+                prefix_sum_value = std::numeric_limits<size_t>::max();
+                chain_component_start = 0;
+                chain_component_end = 0;
+                loop_left = std::numeric_limits<size_t>::max();
+                loop_right = std::numeric_limits<size_t>::max();
+                has_parent_handle = false;
+                has_grandparent_handle = false;
+                is_reversed_in_parent = false;
+                is_trivial_chain = false;
+                is_looping_chain = false;
             }
 
             //Set the values needed to cluster a chain
@@ -288,6 +336,71 @@ class SnarlDistanceIndexClusterer {
 
         };
 
+        //Holds the SnarlTreeNodeProblems for one clustering problem, like a vector
+        //that never frees anything. clear() only forgets how many problems are in
+        //use, and new problems reuse the old ones' memory, so once a thread has
+        //clustered a few reads it doesn't need to allocate any more
+        class NodeProblemStorage {
+        public:
+            size_t size() const { return used; }
+            bool empty() const { return used == 0; }
+            SnarlTreeNodeProblem& at(size_t i) {
+                if (i >= used) {
+                    throw std::out_of_range("No node problem " + std::to_string(i));
+                }
+                return problems[i];
+            }
+            const SnarlTreeNodeProblem& at(size_t i) const {
+                if (i >= used) {
+                    throw std::out_of_range("No node problem " + std::to_string(i));
+                }
+                return problems[i];
+            }
+            SnarlTreeNodeProblem& back() { return problems[used - 1]; }
+
+            //Add a problem, with the same arguments as a SnarlTreeNodeProblem constructor
+            template<typename... Args>
+            void emplace_back(Args&&... args) {
+                if (used < problems.size()) {
+                    problems[used].reset(std::forward<Args>(args)...);
+                } else {
+                    problems.emplace_back(std::forward<Args>(args)...);
+                }
+                used++;
+            }
+
+            void reserve(size_t count) { problems.reserve(count); }
+            void clear() { used = 0; }
+
+        private:
+            vector<SnarlTreeNodeProblem> problems;
+            size_t used = 0;
+        };
+
+        //The parts of a ClusteringProblem that can be reused from one read to the next
+        struct ClusteringScratch {
+            hash_map<net_handle_t, size_t> net_handle_to_node_problem_index;
+            NodeProblemStorage all_node_problems;
+            vector<net_handle_t> parent_snarls;
+            vector<pair<net_handle_t, net_handle_t>> root_children;
+
+            //Empty everything out for a new read, keeping the memory
+            void clear() {
+                net_handle_to_node_problem_index.clear();
+                all_node_problems.clear();
+                parent_snarls.clear();
+                root_children.clear();
+            }
+
+            //Get a cleared scratch to use on this thread, reusing an old one if possible
+            static unique_ptr<ClusteringScratch> take();
+            //Give back a scratch that this thread is done with
+            static void give(unique_ptr<ClusteringScratch>&& scratch);
+        private:
+            //The scratches this thread isn't using
+            static vector<unique_ptr<ClusteringScratch>>& thread_pool();
+        };
+
         //These will be the cluster heads and distances for a cluster
         struct ClusterHead {
             size_t read_num = std::numeric_limits<size_t>::max();
@@ -331,6 +444,14 @@ class SnarlDistanceIndexClusterer {
             size_t read_distance_limit;
             size_t fragment_distance_limit;
 
+            //Cache for distance index queries, if we were given one to use
+            DistanceCache* distance_cache = nullptr;
+
+            //Should the snarls and chains at each level be clustered as parallel tasks?
+            //Seeds in different subtrees are never in the same group, so the tasks
+            //touch disjoint parts of the union finds
+            bool parallel = false;
+
 
             //////////Data structures to hold clustering information
 
@@ -347,10 +468,14 @@ class SnarlDistanceIndexClusterer {
             //////////Data structures to hold snarl tree relationships
             //The snarls and chains get updated as we move up the snarl tree
 
+            //Where the following structures really live; it goes back to the thread's
+            //pool when we are done so the next read can reuse the memory
+            unique_ptr<ClusteringScratch> scratch;
+
             //Maps each net_handle_t to an index to its node problem, in all_node_problems
-            hash_map<net_handle_t, size_t> net_handle_to_node_problem_index;
+            hash_map<net_handle_t, size_t>& net_handle_to_node_problem_index;
             //This stores all the snarl tree nodes and their clustering scratch work 
-            vector<SnarlTreeNodeProblem> all_node_problems;
+            NodeProblemStorage& all_node_problems;
            
             //All chains for the current level of the snarl tree and gets updated as the algorithm
             //moves up the snarl tree. At one iteration, the algorithm will go through each chain
@@ -368,13 +493,13 @@ class SnarlDistanceIndexClusterer {
             //All snarls for the current level of the snarl tree 
             //(chains from chain_to_children get added to their parent snarls, snarls get added to parent_snarls
             //then all snarls in snarl_to_children are clustered and added to parent_chain_to_children)
-            vector<net_handle_t> parent_snarls;
+            vector<net_handle_t>& parent_snarls;
 
 
             //This holds all the child problems of the root
             //Each pair is the parent and the child. This will be sorted by parent before
             //clustering
-            vector<pair<net_handle_t, net_handle_t>> root_children;
+            vector<pair<net_handle_t, net_handle_t>>& root_children;
 
 
             /////////////////////////////////////////////////////////
@@ -387,7 +512,12 @@ class SnarlDistanceIndexClusterer {
                 read_distance_limit(read_distance_limit),
                 fragment_distance_limit(fragment_distance_limit),
                 fragment_union_find (seed_count, false),
-                seed_count_prefix_sum(1,0){
+                seed_count_prefix_sum(1,0),
+                scratch(ClusteringScratch::take()),
+                net_handle_to_node_problem_index(scratch->net_handle_to_node_problem_index),
+                all_node_problems(scratch->all_node_problems),
+                parent_snarls(scratch->parent_snarls),
+                root_children(scratch->root_children){
 
                 for (size_t i = 0 ; i < all_seeds->size() ; i++) {
                     size_t size = all_seeds->at(i)->size();
@@ -401,8 +531,22 @@ class SnarlDistanceIndexClusterer {
                 all_node_problems.reserve(5*seed_count);
                 root_children.reserve(seed_count);
             }
+
+            ~ClusteringProblem() {
+                ClusteringScratch::give(std::move(scratch));
+            }
+
+            ClusteringProblem(const ClusteringProblem& other) = delete;
+            ClusteringProblem& operator=(const ClusteringProblem& other) = delete;
         };
 
+        //Get the distance between two children of a parent snarl tree node, using the
+        //clustering problem's distance cache if it has one
+        size_t distance_in_parent(ClusteringProblem& clustering_problem, const net_handle_t& parent,
+                                  const net_handle_t& child1, const net_handle_t& child2,
+                                  const HandleGraph* graph = nullptr,
+                                  size_t distance_limit = std::numeric_limits<size_t>::max()) const;
+
         //Go through all the seeds and assign them to their parent chains or roots
         //If a node is in a chain, then assign it to its parent chain and add the parent
         //chain to chain_to_children_by_level
@@ -412,6 +556,12 @@ class SnarlDistanceIndexClusterer {
                         vector<vector<net_handle_t>>& chains_by_level) const;
 
 
+        //Run cluster_one(i) for every i less than count, as OpenMP tasks if the clustering
+        //problem is parallel. The distance cache isn't thread safe, so it is set
+        //aside while the tasks run
+        void for_each_subtree(ClusteringProblem& clustering_problem, size_t count,
+                              const std::function<void(size_t)>& cluster_one) const;
+
         //Cluster all the snarls at the current level
         void cluster_snarl_level(ClusteringProblem& clustering_problem) const;
 
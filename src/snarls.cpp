@@ -19,6 +19,31 @@ SnarlManager SnarlFinder::find_snarls_parallel() {
     return find_snarls();
 }
 
+void SnarlFinder::find_snarls_streaming(const function<void(vector<Snarl>&)>& emit_chain) {
+    // By default, we have to find all the snarls first
+    SnarlManager snarl_manager = find_snarls_parallel();
+    
+    snarl_manager.for_each_top_level_chain([&](const Chain* chain) {
+        vector<Snarl> chain_snarls;
+        list<const Snarl*> stack;
+        for (auto here = chain_begin(*chain); here != chain_end(*chain); ++here) {
+            stack.push_back(here->first);
+            while (!stack.empty()) {
+                const Snarl* snarl = stack.back();
+                stack.pop_back();
+                chain_snarls.push_back(*snarl);
+                for (auto& child_chain : snarl_manager.chains_of(snarl)) {
+                    // Stack up the child snarls in reverse order, so we visit them in forward order
+                    for (auto there = chain_rbegin(child_chain); there != chain_rend(child_chain); ++there) {
+                        stack.push_back(there->first);
+                    }
+                }
+            }
+        }
+        emit_chain(chain_snarls);
+    });
+}
+
 HandleGraphSnarlFinder::HandleGraphSnarlFinder(const HandleGraph* graph) : graph(graph) {
     // Nothing to do!
 }
@@ -96,224 +121,233 @@ SnarlManager HandleGraphSnarlFinder::find_snarls_unindexed() {
         
         // This snarl is real, we care about type and connectivity.
         // All its children are done.
-
-        /////
-        // Determine connectivity
-        /////
-        
-        // Make a net graph for the snarl that uses internal connectivity
-        NetGraph connectivity_net_graph(snarl.start(), snarl.end(), managed_child_chains, graph, true);
+        classify_snarl(snarl, managed_child_chains);
         
-        // Evaluate connectivity
-        // A snarl is minimal, so we know out start and end will be normal nodes.
-        handle_t start_handle = connectivity_net_graph.get_handle(snarl.start().node_id(), snarl.start().backward());
-        handle_t end_handle = connectivity_net_graph.get_handle(snarl.end().node_id(), snarl.end().backward());
+        // Now we know all about our snarl, but we don't know about our parent.
         
-        // Start out by assuming we aren't connected
-        bool connected_start_start = false;
-        bool connected_end_end = false;
-        bool connected_start_end = false;
+        if (stack.size() > 1) {
+            // We have a parent. Join it as a child, at the end of the current chain
+            assert(!stack[stack.size() - 2].child_chains.empty());
+            stack[stack.size() - 2].child_chains.back().emplace_back(std::move(snarl));
+        } else {
+            // Just manage ourselves now, because our parent can't manage us.
+            snarl_manager.add_snarl(snarl);
+        }
         
-        // We do a couple of direcred walk searches to test connectivity.
-        list<handle_t> queue{start_handle};
-        unordered_set<handle_t> queued{start_handle};
-        auto handle_edge = [&](const handle_t& other) {
+        // Leave the stack
+        stack.pop_back();
+    });
+    
+    // Give it back
+    return snarl_manager;
+}
+
+void HandleGraphSnarlFinder::classify_snarl(Snarl& snarl, const vector<Chain>& child_chains) const {
+
+    /////
+    // Determine connectivity
+    /////
+    
+    // Make a net graph for the snarl that uses internal connectivity
+    NetGraph connectivity_net_graph(snarl.start(), snarl.end(), child_chains, graph, true);
+    
+    // Evaluate connectivity
+    // A snarl is minimal, so we know out start and end will be normal nodes.
+    handle_t start_handle = connectivity_net_graph.get_handle(snarl.start().node_id(), snarl.start().backward());
+    handle_t end_handle = connectivity_net_graph.get_handle(snarl.end().node_id(), snarl.end().backward());
+    
+    // Start out by assuming we aren't connected
+    bool connected_start_start = false;
+    bool connected_end_end = false;
+    bool connected_start_end = false;
+    
+    // We do a couple of direcred walk searches to test connectivity.
+    list<handle_t> queue{start_handle};
+    unordered_set<handle_t> queued{start_handle};
+    auto handle_edge = [&](const handle_t& other) {
 #ifdef debug
-            cerr << "\tCan reach " << connectivity_net_graph.get_id(other)
-            << " " << connectivity_net_graph.get_is_reverse(other) << endl;
+        cerr << "\tCan reach " << connectivity_net_graph.get_id(other)
+        << " " << connectivity_net_graph.get_is_reverse(other) << endl;
 #endif
-            
-            // Whenever we see a new node orientation, queue it.
-            if (!queued.count(other)) {
-                queue.push_back(other);
-                queued.insert(other);
-            }
-        };
         
+        // Whenever we see a new node orientation, queue it.
+        if (!queued.count(other)) {
+            queue.push_back(other);
+            queued.insert(other);
+        }
+    };
+    
 #ifdef debug
-        cerr << "Looking for start-start turnarounds and through connections from "
-             << connectivity_net_graph.get_id(start_handle) << " " <<
-            connectivity_net_graph.get_is_reverse(start_handle) << endl;
+    cerr << "Looking for start-start turnarounds and through connections from "
+         << connectivity_net_graph.get_id(start_handle) << " " <<
+        connectivity_net_graph.get_is_reverse(start_handle) << endl;
 #endif
+    
+    while (!queue.empty()) {
+        handle_t here = queue.front();
+        queue.pop_front();
         
-        while (!queue.empty()) {
-            handle_t here = queue.front();
-            queue.pop_front();
-            
-            if (here == end_handle) {
-                // Start can reach the end
-                connected_start_end = true;
-            }
-            
-            if (here == connectivity_net_graph.flip(start_handle)) {
-                // Start can reach itself the other way around
-                connected_start_start = true;
-            }
-            
-            if (connected_start_end && connected_start_start) {
-                // No more searching needed
-                break;
-            }
-            
-            // Look at everything reachable on a proper rightward directed walk.
-            connectivity_net_graph.follow_edges(here, false, handle_edge);
+        if (here == end_handle) {
+            // Start can reach the end
+            connected_start_end = true;
         }
         
-        auto end_inward = connectivity_net_graph.flip(end_handle);
+        if (here == connectivity_net_graph.flip(start_handle)) {
+            // Start can reach itself the other way around
+            connected_start_start = true;
+        }
+        
+        if (connected_start_end && connected_start_start) {
+            // No more searching needed
+            break;
+        }
         
+        // Look at everything reachable on a proper rightward directed walk.
+        connectivity_net_graph.follow_edges(here, false, handle_edge);
+    }
+    
+    auto end_inward = connectivity_net_graph.flip(end_handle);
+    
 #ifdef debug
-        cerr << "Looking for end-end turnarounds from " << connectivity_net_graph.get_id(end_inward)
-             << " " << connectivity_net_graph.get_is_reverse(end_inward) << endl;
+    cerr << "Looking for end-end turnarounds from " << connectivity_net_graph.get_id(end_inward)
+         << " " << connectivity_net_graph.get_is_reverse(end_inward) << endl;
 #endif
+    
+    // Reset and search the other way from the end to see if it can find itself.
+    queue = {end_inward};
+    queued = {end_inward};
+    while (!queue.empty()) {
+        handle_t here = queue.front();
+        queue.pop_front();
         
-        // Reset and search the other way from the end to see if it can find itself.
-        queue = {end_inward};
-        queued = {end_inward};
-        while (!queue.empty()) {
-            handle_t here = queue.front();
-            queue.pop_front();
-            
 #ifdef debug
-            cerr << "Got to " << connectivity_net_graph.get_id(here) << " "
-                 << connectivity_net_graph.get_is_reverse(here) << endl;
+        cerr << "Got to " << connectivity_net_graph.get_id(here) << " "
+             << connectivity_net_graph.get_is_reverse(here) << endl;
 #endif
-            
-            if (here == end_handle) {
-                // End can reach itself the other way around
-                connected_end_end = true;
-                break;
-            }
-            
-            // Look at everything reachable on a proper rightward directed walk.
-            connectivity_net_graph.follow_edges(here, false, handle_edge);
+        
+        if (here == end_handle) {
+            // End can reach itself the other way around
+            connected_end_end = true;
+            break;
         }
         
-        // Save the connectivity info. TODO: should the connectivity flags be
-        // calculated based on just the net graph, or based on actual connectivity
-        // within child snarls.
-        snarl.set_start_self_reachable(connected_start_start);
-        snarl.set_end_self_reachable(connected_end_end);
-        snarl.set_start_end_reachable(connected_start_end);
+        // Look at everything reachable on a proper rightward directed walk.
+        connectivity_net_graph.follow_edges(here, false, handle_edge);
+    }
+    
+    // Save the connectivity info. TODO: should the connectivity flags be
+    // calculated based on just the net graph, or based on actual connectivity
+    // within child snarls.
+    snarl.set_start_self_reachable(connected_start_start);
+    snarl.set_end_self_reachable(connected_end_end);
+    snarl.set_start_end_reachable(connected_start_end);
 
 #ifdef debug
-        cerr << "Connectivity: " << connected_start_start << " " << connected_end_end << " " << connected_start_end << endl;
+    cerr << "Connectivity: " << connected_start_start << " " << connected_end_end << " " << connected_start_end << endl;
 #endif
 
-        /////
-        // Determine tip presence
-        /////
-        
-        // Make a net graph that just pretends child snarls/chains are ordinary nodes
-        NetGraph flat_net_graph(snarl.start(), snarl.end(), managed_child_chains, graph);
-        
-        // Having internal tips in the net graph disqualifies a snarl from being an ultrabubble
-        auto tips = handlealgs::find_tips(&flat_net_graph);
+    /////
+    // Determine tip presence
+    /////
+    
+    // Make a net graph that just pretends child snarls/chains are ordinary nodes
+    NetGraph flat_net_graph(snarl.start(), snarl.end(), child_chains, graph);
+    
+    // Having internal tips in the net graph disqualifies a snarl from being an ultrabubble
+    auto tips = handlealgs::find_tips(&flat_net_graph);
 
 #ifdef debug
-        cerr << "Tips: " << endl;
-        for (auto& tip : tips) {
-            cerr << "\t" << flat_net_graph.get_id(tip) << (flat_net_graph.get_is_reverse(tip) ? '-' : '+') << endl;
-        }
+    cerr << "Tips: " << endl;
+    for (auto& tip : tips) {
+        cerr << "\t" << flat_net_graph.get_id(tip) << (flat_net_graph.get_is_reverse(tip) ? '-' : '+') << endl;
+    }
 #endif
 
-        // We should have at least the bounding nodes.
-        assert(tips.size() >= 2);
-        bool has_internal_tips = (tips.size() > 2); 
-        
-        /////
-        // Determine cyclicity/acyclicity
-        /////
+    // We should have at least the bounding nodes.
+    assert(tips.size() >= 2);
+    bool has_internal_tips = (tips.size() > 2); 
     
-        // This definitely should be calculated based on the internal-connectivity-ignoring net graph.
-        snarl.set_directed_acyclic_net_graph(handlealgs::is_directed_acyclic(&flat_net_graph));
+    /////
+    // Determine cyclicity/acyclicity
+    /////
+
+    // This definitely should be calculated based on the internal-connectivity-ignoring net graph.
+    snarl.set_directed_acyclic_net_graph(handlealgs::is_directed_acyclic(&flat_net_graph));
 
-        /////
-        // Determine classification
-        /////
+    /////
+    // Determine classification
+    /////
 
-        // Now we need to work out if the snarl can be a unary snarl or an ultrabubble or what.
-        if (snarl.start().node_id() == snarl.end().node_id()) {
-            // Snarl has the same start and end (or no start or end, in which case we don't care).
-            snarl.set_type(UNARY);
+    // Now we need to work out if the snarl can be a unary snarl or an ultrabubble or what.
+    if (snarl.start().node_id() == snarl.end().node_id()) {
+        // Snarl has the same start and end (or no start or end, in which case we don't care).
+        snarl.set_type(UNARY);
 #ifdef debug
-            cerr << "Snarl is UNARY" << endl;
+        cerr << "Snarl is UNARY" << endl;
 #endif
-        } else if (!snarl.start_end_reachable()) {
-            // Can't be an ultrabubble if we're not connected through.
-            snarl.set_type(UNCLASSIFIED);
+    } else if (!snarl.start_end_reachable()) {
+        // Can't be an ultrabubble if we're not connected through.
+        snarl.set_type(UNCLASSIFIED);
 #ifdef debug
-            cerr << "Snarl is UNCLASSIFIED because it doesn't connect through" << endl;
+        cerr << "Snarl is UNCLASSIFIED because it doesn't connect through" << endl;
 #endif
-        } else if (snarl.start_self_reachable() || snarl.end_self_reachable()) {
-            // Can't be an ultrabubble if we have these cycles
-            snarl.set_type(UNCLASSIFIED);
-            
+    } else if (snarl.start_self_reachable() || snarl.end_self_reachable()) {
+        // Can't be an ultrabubble if we have these cycles
+        snarl.set_type(UNCLASSIFIED);
+        
 #ifdef debug
-            cerr << "Snarl is UNCLASSIFIED because it allows turning around, creating a directed cycle" << endl;
+        cerr << "Snarl is UNCLASSIFIED because it allows turning around, creating a directed cycle" << endl;
 #endif
 
-        } else {
-            // See if we have all ultrabubble children
-            bool all_ultrabubble_children = true;
-            for (auto& chain : managed_child_chains) {
-                for (auto& child : chain) {
-                    if (child.first->type() != ULTRABUBBLE) {
-                        all_ultrabubble_children = false;
-                        break;
-                    }
-                }
-                if (!all_ultrabubble_children) {
+    } else {
+        // See if we have all ultrabubble children
+        bool all_ultrabubble_children = true;
+        for (auto& chain : child_chains) {
+            for (auto& child : chain) {
+                if (child.first->type() != ULTRABUBBLE) {
+                    all_ultrabubble_children = false;
                     break;
                 }
             }
-            
             if (!all_ultrabubble_children) {
-                // If we have non-ultrabubble children, we can't be an ultrabubble.
-                snarl.set_type(UNCLASSIFIED);
+                break;
+            }
+        }
+        
+        if (!all_ultrabubble_children) {
+            // If we have non-ultrabubble children, we can't be an ultrabubble.
+            snarl.set_type(UNCLASSIFIED);
 #ifdef debug
-                cerr << "Snarl is UNCLASSIFIED because it has non-ultrabubble children" << endl;
+            cerr << "Snarl is UNCLASSIFIED because it has non-ultrabubble children" << endl;
 #endif
-            } else if (has_internal_tips) {
-                // If we have internal tips, we can't be an ultrabubble
-                snarl.set_type(UNCLASSIFIED);
-                
+        } else if (has_internal_tips) {
+            // If we have internal tips, we can't be an ultrabubble
+            snarl.set_type(UNCLASSIFIED);
+            
 #ifdef debug
-                cerr << "Snarl is UNCLASSIFIED because it contains internal tips" << endl;
+            cerr << "Snarl is UNCLASSIFIED because it contains internal tips" << endl;
 #endif
-            } else if (!snarl.directed_acyclic_net_graph()) {
-                // If all our children are ultrabubbles but we ourselves are cyclic, we can't be an ultrabubble
-                snarl.set_type(UNCLASSIFIED);
-                
+        } else if (!snarl.directed_acyclic_net_graph()) {
+            // If all our children are ultrabubbles but we ourselves are cyclic, we can't be an ultrabubble
+            snarl.set_type(UNCLASSIFIED);
+            
 #ifdef debug
-                cerr << "Snarl is UNCLASSIFIED because it is not directed-acyclic" << endl;
+            cerr << "Snarl is UNCLASSIFIED because it is not directed-acyclic" << endl;
 #endif
-            } else {
-                // We have only ultrabubble children and are acyclic.
-                // We're an ultrabubble.
-                snarl.set_type(ULTRABUBBLE);
+        } else {
+            // We have only ultrabubble children and are acyclic.
+            // We're an ultrabubble.
+            snarl.set_type(ULTRABUBBLE);
 #ifdef debug
-                cerr << "Snarl is an ULTRABUBBLE" << endl;
+            cerr << "Snarl is an ULTRABUBBLE" << endl;
 #endif
-            }
         }
-        
-        // Now we know all about our snarl, but we don't know about our parent.
-        
-        if (stack.size() > 1) {
-            // We have a parent. Join it as a child, at the end of the current chain
-            assert(!stack[stack.size() - 2].child_chains.empty());
-            stack[stack.size() - 2].child_chains.back().emplace_back(std::move(snarl));
-        } else {
-            // Just manage ourselves now, because our parent can't manage us.
-            snarl_manager.add_snarl(snarl);
-        }
-        
-        // Leave the stack
-        stack.pop_back();
-    });
-    
-    // Give it back
-    return snarl_manager;
+    }
+}
+
+void HandleGraphSnarlFinder::traverse_decomposition_parallel(const function<void(handle_t)>& begin_chain, const function<void(handle_t)>& end_chain,
+    const function<void(handle_t)>& begin_snarl, const function<void(handle_t)>& end_snarl) const {
+    traverse_decomposition(begin_chain, end_chain, begin_snarl, end_snarl);
 }
 
 SnarlManager HandleGraphSnarlFinder::find_snarls() {
@@ -327,6 +361,94 @@ SnarlManager HandleGraphSnarlFinder::find_snarls() {
     return snarl_manager;
 }
 
+void HandleGraphSnarlFinder::find_snarls_streaming(const function<void(vector<Snarl>&)>& emit_chain) {
+    
+    // Like find_snarls_unindexed(), but instead of handing finished snarls to
+    // a SnarlManager, each snarl collects itself and its descendants in the
+    // order they should be written, until a whole top-level chain is done.
+    struct SnarlSubtree {
+        Snarl snarl;
+        // The descendants, with each snarl before its children
+        vector<Snarl> descendants;
+    };
+    
+    struct TranslationFrame {
+        SnarlSubtree subtree;
+        vector<vector<SnarlSubtree>> child_chains;
+        handle_t current_chain_start;
+    };
+    
+    vector<TranslationFrame> stack;
+    // The snarls of the top-level chain we are in
+    vector<Snarl> top_level_chain;
+    
+    traverse_decomposition_parallel([&](handle_t chain_start) {
+        if (!stack.empty()) {
+            stack.back().current_chain_start = chain_start;
+            stack.back().child_chains.emplace_back();
+        }
+    }, [&](handle_t chain_end) {
+        if (!stack.empty()) {
+            if (stack.back().current_chain_start == chain_end) {
+                // Drop the empty chain
+                assert(stack.back().child_chains.back().empty());
+                stack.back().child_chains.pop_back();
+            }
+        } else if (!top_level_chain.empty()) {
+            // A top-level chain is finished, so nothing else can refer to its snarls
+            emit_chain(top_level_chain);
+            top_level_chain.clear();
+        }
+    }, [&](handle_t snarl_start) {
+        stack.emplace_back();
+        auto& snarl = stack.back().subtree.snarl;
+        snarl.mutable_start()->set_node_id(graph->get_id(snarl_start));
+        snarl.mutable_start()->set_backward(graph->get_is_reverse(snarl_start));
+    }, [&](handle_t snarl_end) {
+        auto& subtree = stack.back().subtree;
+        auto& snarl = subtree.snarl;
+        snarl.mutable_end()->set_node_id(graph->get_id(snarl_end));
+        snarl.mutable_end()->set_backward(graph->get_is_reverse(snarl_end));
+        
+        // The child snarls don't move until we're done, so net graphs can point at them
+        vector<Chain> child_chains;
+        for (auto& child_chain : stack.back().child_chains) {
+            child_chains.emplace_back();
+            for (auto& child : child_chain) {
+                // Fill us in as the parent (before we have connectivity info filled in)
+                *child.snarl.mutable_parent() = snarl;
+                child_chains.back().emplace_back(&child.snarl, false);
+            }
+        }
+        
+        classify_snarl(snarl, child_chains);
+        
+        // Our children go after us, with their child chains contiguous
+        for (auto& child_chain : stack.back().child_chains) {
+            for (auto& child : child_chain) {
+                subtree.descendants.emplace_back(std::move(child.snarl));
+                for (auto& descendant : child.descendants) {
+                    subtree.descendants.emplace_back(std::move(descendant));
+                }
+            }
+        }
+        stack.back().child_chains.clear();
+        
+        if (stack.size() > 1) {
+            // Join the parent as a child, at the end of the current chain
+            assert(!stack[stack.size() - 2].child_chains.empty());
+            stack[stack.size() - 2].child_chains.back().emplace_back(std::move(subtree));
+        } else {
+            top_level_chain.emplace_back(std::move(snarl));
+            for (auto& descendant : subtree.descendants) {
+                top_level_chain.emplace_back(std::move(descendant));
+            }
+        }
+        
+        stack.pop_back();
+    });
+}
+
 bool start_backward(const Chain& chain) {
     // The start snarl is backward if it is marked backward.
     return !chain.empty() && chain.front().second;
@@ -503,6 +625,43 @@ SnarlManager::SnarlManager(istream& in) : SnarlManager([&in](const function<void
     // Nothing to do!
 }
 
+SnarlManager::SnarlManager(istream& in, const function<bool(const vector<Snarl>&)>& select_chain) : SnarlManager([&](const function<void(Snarl&)>& consume_snarl) -> void {
+    // The snarls of the chain we are reading, and which of them are top-level
+    vector<Snarl> chain_snarls;
+    vector<Snarl> chain_roots;
+    auto finish_chain = [&]() {
+        if (!chain_roots.empty() && select_chain(chain_roots)) {
+            for (Snarl& snarl : chain_snarls) {
+                consume_snarl(snarl);
+            }
+        }
+        chain_snarls.clear();
+        chain_roots.clear();
+    };
+    for (vg::io::ProtobufIterator<Snarl> iter(in); iter.has_current(); iter.advance()) {
+        if (!iter->has_parent()) {
+            // A top-level snarl continues the chain only if it shares a boundary node with the last one
+            bool continues_chain = false;
+            if (!chain_roots.empty()) {
+                const Snarl& prev = chain_roots.back();
+                for (id_t id : {iter->start().node_id(), iter->end().node_id()}) {
+                    if (id == prev.start().node_id() || id == prev.end().node_id()) {
+                        continues_chain = true;
+                    }
+                }
+            }
+            if (!continues_chain) {
+                finish_chain();
+            }
+            chain_roots.push_back(*iter);
+        }
+        chain_snarls.push_back(*iter);
+    }
+    finish_chain();
+}) {
+    // Nothing to do!
+}
+
 SnarlManager::SnarlManager(const function<void(const function<void(Snarl&)>&)>& for_each_snarl) {
     for_each_snarl([&](Snarl& snarl) {
         // Add each snarl to us
@@ -29,6 +29,18 @@ namespace vg {
 
 class SnarlManager;
 
+/**
+ * Snarls are defined at the Protobuf level, but here is how we define
+ * chains as real objects.
+ *
+ * A chain is a sequence of Snarls, in either normal (false) or reverse (true)
+ * orientation.
+ *
+ * The SnarlManager is going to have one official copy of each chain stored,
+ * and it will give you a pointer to it on demand.
+ */
+using Chain = vector<pair<const Snarl*, bool>>;
+
 /**
  * Represents a strategy for finding (nested) sites in a vg graph that can be described
  * by snarls. Polymorphic base class/interface.
@@ -48,6 +60,16 @@ public:
      * implementation.
      */
     virtual SnarlManager find_snarls_parallel();
+    
+    /**
+     * Find all the snarls, but instead of keeping them all in a SnarlManager,
+     * hand over the snarls of each top-level chain as soon as the chain is
+     * finished. Each snarl comes before its children and has its parent
+     * filled in, and the snarls of each child chain are contiguous and in
+     * order. Top-level chains may come in any order. If not implemented,
+     * defaults to finding all the snarls first.
+     */
+    virtual void find_snarls_streaming(const function<void(vector<Snarl>&)>& emit_chain);
 };
 
 /**
@@ -68,6 +90,12 @@ protected:
      */
     virtual SnarlManager find_snarls_unindexed();
     
+    /**
+     * Fill in the connectivity and type of a snarl with its start and end set,
+     * given its child chains, which must already be classified.
+     */
+    void classify_snarl(Snarl& snarl, const vector<Chain>& child_chains) const;
+    
 public:
 
     /**
@@ -82,6 +110,12 @@ public:
      */
     virtual SnarlManager find_snarls();
     
+    /**
+     * Find all the snarls, handing over each top-level chain's snarls as soon
+     * as it is finished, without ever holding more than the chain being built.
+     */
+    virtual void find_snarls_streaming(const function<void(vector<Snarl>&)>& emit_chain);
+    
     /**
      * Visit all snarls and chains, including trivial snarls and single-node
      * empty chains.
@@ -106,19 +140,19 @@ public:
      */
     virtual void traverse_decomposition(const function<void(handle_t)>& begin_chain, const function<void(handle_t)>& end_chain,
         const function<void(handle_t)>& begin_snarl, const function<void(handle_t)>& end_snarl) const = 0;
+    
+    /**
+     * Visit all snarls and chains like traverse_decomposition(), but do the
+     * decomposition work in parallel where the finder supports it. The
+     * callbacks are still called one at a time, though not necessarily from
+     * the calling thread, and top-level chains may come in a different order.
+     *
+     * By default, just calls traverse_decomposition().
+     */
+    virtual void traverse_decomposition_parallel(const function<void(handle_t)>& begin_chain, const function<void(handle_t)>& end_chain,
+        const function<void(handle_t)>& begin_snarl, const function<void(handle_t)>& end_snarl) const;
 };
 
-/**
- * Snarls are defined at the Protobuf level, but here is how we define
- * chains as real objects.
- *
- * A chain is a sequence of Snarls, in either normal (false) or reverse (true)
- * orientation.
- *
- * The SnarlManager is going to have one official copy of each chain stored,
- * and it will give you a pointer to it on demand.
- */
-using Chain = vector<pair<const Snarl*, bool>>;
     
 /**
  * Return true if the first snarl in the given chain is backward relative to the chain.
@@ -416,6 +450,13 @@ public:
     /// Construct a SnarlManager for the snarls contained in an input stream
     SnarlManager(istream& in);
     
+    /// Construct a SnarlManager for only the top-level chains in an input
+    /// stream that the selector accepts. The snarls of each top-level chain
+    /// must be contiguous, as written by vg snarls, and only one chain is held
+    /// at a time while reading. The selector gets the chain's top-level snarls
+    /// in order.
+    SnarlManager(istream& in, const function<bool(const vector<Snarl>&)>& select_chain);
+    
     /// Construct a SnarlManager from a function that calls a callback with each Snarl in turn
     SnarlManager(const function<void(const function<void(Snarl&)>&)>& for_each_snarl);
         
@@ -0,0 +1,153 @@
+/**
+ * \file splice_site_index.cpp
+ *
+ * Implements SpliceSiteIndex
+ *
+ */
+
+#include "splice_site_index.hpp"
+
+#include <sdsl/util.hpp>
+
+//#define debug_splice_site_index
+
+namespace vg {
+
+// marks the start of a serialized SpliceSiteIndex
+static const uint32_t SPLICE_SITE_INDEX_MAGIC = 0x58495353; // "SSIX"
+static const uint32_t SPLICE_SITE_INDEX_VERSION = 1;
+
+SpliceSiteIndex::SpliceSiteIndex(const HandleGraph& graph, const SpliceStats& splice_stats)
+    : SpliceSiteIndex(graph, motif_dinucleotides(splice_stats))
+{
+    // nothing else to do
+}
+
+SpliceSiteIndex::SpliceSiteIndex(const HandleGraph& graph, uint16_t dinucleotide_mask) {
+
+    // index both strands, since a node can be traversed in either orientation
+    mask = dinucleotide_mask;
+    for (uint8_t code = 0; code < 16; ++code) {
+        if (dinucleotide_mask & (1 << code)) {
+            mask |= (1 << reverse_complement_code(code));
+        }
+    }
+
+    if (graph.get_node_count() == 0) {
+        return;
+    }
+
+    min_id = graph.min_node_id();
+    nid_t max_id = graph.max_node_id();
+
+    vector<uint64_t> starts(max_id - min_id + 2, 0);
+    vector<uint64_t> found;
+    for (nid_t node_id = min_id; node_id <= max_id; ++node_id) {
+        starts[node_id - min_id] = found.size();
+        if (!graph.has_node(node_id)) {
+            continue;
+        }
+        string seq = graph.get_sequence(graph.get_handle(node_id));
+        for (size_t i = 1; i < seq.size(); ++i) {
+            int code = encode(seq.substr(i - 1, 2));
+            if (code >= 0 && (mask & (1 << code))) {
+                found.push_back(((i - 1) << 4) | code);
+            }
+        }
+    }
+    starts.back() = found.size();
+
+#ifdef debug_splice_site_index
+    cerr << "indexed " << found.size() << " dinucleotides on IDs " << min_id << " to " << max_id << " with mask " << mask << endl;
+#endif
+
+    site_starts = sdsl::int_vector<>(starts.size());
+    for (size_t i = 0; i < starts.size(); ++i) {
+        site_starts[i] = starts[i];
+    }
+    sdsl::util::bit_compress(site_starts);
+
+    sites = sdsl::int_vector<>(found.size());
+    for (size_t i = 0; i < found.size(); ++i) {
+        sites[i] = found[i];
+    }
+    sdsl::util::bit_compress(sites);
+}
+
+uint16_t SpliceSiteIndex::motif_dinucleotides(const SpliceStats& splice_stats) {
+    uint16_t motif_mask = 0;
+    for (size_t i = 0; i < splice_stats.motif_size(); ++i) {
+        // the motif on the right side of the intron is oriented into
+        // the intron, so it's read in reverse along the node
+        const string& left_motif = splice_stats.oriented_motif(i, false);
+        const string& right_motif = splice_stats.oriented_motif(i, true);
+        for (const string& dinucleotide : {left_motif, string(right_motif.rbegin(), right_motif.rend())}) {
+            int code = encode(dinucleotide);
+            if (code >= 0) {
+                motif_mask |= (1 << code);
+            }
+        }
+    }
+    return motif_mask;
+}
+
+bool SpliceSiteIndex::covers(const SpliceStats& splice_stats) const {
+    uint16_t needed = motif_dinucleotides(splice_stats);
+    return (needed & mask) == needed;
+}
+
+int SpliceSiteIndex::encode(const string& dinucleotide) {
+    if (dinucleotide.size() != 2) {
+        return -1;
+    }
+    int code = 0;
+    for (char c : dinucleotide) {
+        code <<= 2;
+        switch (c) {
+            case 'A':
+                break;
+            case 'C':
+                code |= 1;
+                break;
+            case 'G':
+                code |= 2;
+                break;
+            case 'T':
+                code |= 3;
+                break;
+            default:
+                return -1;
+        }
+    }
+    return code;
+}
+
+void SpliceSiteIndex::serialize(ostream& out) const {
+    sdsl::write_member(SPLICE_SITE_INDEX_MAGIC, out);
+    sdsl::write_member(SPLICE_SITE_INDEX_VERSION, out);
+    sdsl::write_member(mask, out);
+    sdsl::write_member(min_id, out);
+    site_starts.serialize(out);
+    sites.serialize(out);
+    if (!out) {
+        throw runtime_error("error: could not write SpliceSiteIndex");
+    }
+}
+
+void SpliceSiteIndex::load(istream& in) {
+    uint32_t magic = 0, version = 0;
+    sdsl::read_member(magic, in);
+    sdsl::read_member(version, in);
+    if (!in || magic != SPLICE_SITE_INDEX_MAGIC || version != SPLICE_SITE_INDEX_VERSION) {
+        throw runtime_error("error: not a SpliceSiteIndex of a supported version");
+    }
+    sdsl::read_member(mask, in);
+    sdsl::read_member(min_id, in);
+    site_starts.load(in);
+    sites.load(in);
+    if (!in) {
+        throw runtime_error("error: truncated SpliceSiteIndex");
+    }
+}
+
+}
@@ -0,0 +1,123 @@
+/**
+ * \file splice_site_index.hpp
+ *
+ * Defines an index of the candidate splice sites in a graph
+ *
+ */
+#ifndef VG_SPLICE_SITE_INDEX_HPP_INCLUDED
+#define VG_SPLICE_SITE_INDEX_HPP_INCLUDED
+
+#include <cstdint>
+#include <iostream>
+#include <sdsl/int_vector.hpp>
+
+#include "handle.hpp"
+#include "splicing.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/*
+ * An offline index of the occurrences of splice motif dinucleotides
+ * on each node of a graph, so that candidate splice sites can be
+ * looked up instead of searched for in the node sequences during
+ * spliced alignment. Only dinucleotides that lie within a single node
+ * are indexed, since those that cross a node boundary depend on the
+ * edges that are traversed.
+ */
+class SpliceSiteIndex {
+public:
+
+    SpliceSiteIndex() = default;
+
+    // index the dinucleotides that are needed to find the motifs of
+    // the splice stats on either strand
+    SpliceSiteIndex(const HandleGraph& graph, const SpliceStats& splice_stats);
+
+    // index the dinucleotides in the mask (bit 4 * first + second, with
+    // A, C, G, T = 0, 1, 2, 3) and their reverse complements
+    SpliceSiteIndex(const HandleGraph& graph, uint16_t dinucleotide_mask);
+
+    // the mask of the dinucleotides that must be indexed to find the
+    // motifs of the splice stats, in the forward orientation of a node
+    static uint16_t motif_dinucleotides(const SpliceStats& splice_stats);
+
+    // true if all of the dinucleotides needed for the splice stats'
+    // motifs are indexed
+    bool covers(const SpliceStats& splice_stats) const;
+
+    // iterate over the occurrences of indexed dinucleotides on a node in the
+    // given orientation. the iteratee gets the offset of the first base of the
+    // dinucleotide and its code (as in the mask), in increasing order of offset,
+    // or in decreasing order if requested. the node length must be given.
+    template<typename Iteratee>
+    void for_each_dinucleotide(nid_t node_id, bool is_reverse, size_t node_length,
+                               bool decreasing, const Iteratee& iteratee) const;
+
+    // the code of a dinucleotide, or -1 if it contains a non-ACGT character
+    static int encode(const string& dinucleotide);
+
+    // save to and load from a stream
+    void serialize(ostream& out) const;
+    void load(istream& in);
+
+private:
+
+    static inline uint8_t reverse_complement_code(uint8_t code);
+
+    // the dinucleotides that are indexed, in forward node orientation
+    uint16_t mask = 0;
+
+    nid_t min_id = 0;
+
+    // the range of sites of the node with ID min_id + i is
+    // [site_starts[i], site_starts[i + 1])
+    sdsl::int_vector<> site_starts;
+    // offset of the dinucleotide on the forward strand in the high
+    // bits and its code in the low 4 bits
+    sdsl::int_vector<> sites;
+};
+
+inline uint8_t SpliceSiteIndex::reverse_complement_code(uint8_t code) {
+    // complement is 3 - base with A, C, G, T = 0, 1, 2, 3
+    return ((3 - (code & 3)) << 2) | (3 - (code >> 2));
+}
+
+template<typename Iteratee>
+void SpliceSiteIndex::for_each_dinucleotide(nid_t node_id, bool is_reverse, size_t node_length,
+                                            bool decreasing, const Iteratee& iteratee) const {
+    if (node_id < min_id || node_id - min_id + 1 >= site_starts.size()) {
+        return;
+    }
+    size_t begin = site_starts[node_id - min_id];
+    size_t end = site_starts[node_id - min_id + 1];
+    // the sites are in increasing order on the forward strand, which is
+    // decreasing order on the reverse strand
+    if (decreasing != is_reverse) {
+        for (size_t i = end; i > begin; --i) {
+            uint64_t site = sites[i - 1];
+            if (is_reverse) {
+                iteratee(node_length - 2 - (site >> 4), reverse_complement_code(site & 0xf));
+            }
+            else {
+                iteratee(site >> 4, site & 0xf);
+            }
+        }
+    }
+    else {
+        for (size_t i = begin; i < end; ++i) {
+            uint64_t site = sites[i];
+            if (is_reverse) {
+                iteratee(node_length - 2 - (site >> 4), reverse_complement_code(site & 0xf));
+            }
+            else {
+                iteratee(site >> 4, site & 0xf);
+            }
+        }
+    }
+}
+
+}
+
+#endif // VG_SPLICE_SITE_INDEX_HPP_INCLUDED
@@ -6,6 +6,7 @@
  */
 
 #include "splicing.hpp"
+#include "splice_site_index.hpp"
 
 //#define debug_splice_region
 //#define debug_trimming
@@ -227,7 +228,8 @@ void SpliceStats::init(const vector<tuple<string, string, double>>& motifs,
 SpliceRegion::SpliceRegion(const pos_t& seed_pos, bool search_left, int64_t search_dist,
                            const HandleGraph& graph,
                            const DinucleotideMachine& dinuc_machine,
-                           const SpliceStats& splice_stats)
+                           const SpliceStats& splice_stats,
+                           const SpliceSiteIndex* splice_site_index)
     : subgraph(graph, seed_pos, search_left, search_dist + 2, 5, search_dist * search_dist), motif_matches(splice_stats.motif_size())
 {
     
@@ -244,6 +246,13 @@ SpliceRegion::SpliceRegion(const pos_t& seed_pos, bool search_left, int64_t sear
     handle_t handle = subgraph.handle_at_order(0);
     seed = pair<handle_t, size_t>(handle, offset(seed_pos));
     
+    if (splice_site_index) {
+        // look up the matches within nodes in the index rather than doing the DP
+        find_indexed_motif_matches(seed_pos, search_left, search_dist, graph, dinuc_machine,
+                                   splice_stats, *splice_site_index);
+        return;
+    }
+    
     // extract the subgraph and initialize the DP structure
     vector<pair<handle_t, vector<uint32_t>>> dinuc_states;
     dinuc_states.emplace_back(handle, vector<uint32_t>(subgraph.get_length(handle),
@@ -266,29 +275,7 @@ SpliceRegion::SpliceRegion(const pos_t& seed_pos, bool search_left, int64_t sear
             if (dinuc_machine.matches(states[j], splice_stats.oriented_motif(i, search_left))) {
                 if ((j == 0 && !search_left) || (j + 1 == states.size() && search_left)) {
                     // we need to cross a node boundary to backtrack
-                    subgraph.follow_edges(handle, !search_left, [&](const handle_t& prev) {
-                        if (search_left) {
-                            if (subgraph.get_base(prev, 0) == splice_stats.oriented_motif(i, true).front() &&
-                                (prev != seed.first || seed.second != 0)) {
-                                int64_t trav_dist = subgraph.min_distance_from_start(prev) + subgraph.get_length(prev) - 1;
-                                motif_matches[i].emplace_back(prev, 1, trav_dist);
-#ifdef debug_splice_region
-                                cerr << "record match to motif " << i << " at " << subgraph.order_of(prev) << "-th node " << subgraph.get_id(prev) << ", ending on node " << subgraph.order_of(handle) << ", dist " << trav_dist << endl;
-#endif
-                            }
-                        }
-                        else {
-                            size_t k = subgraph.get_length(prev) - 1;
-                            if (subgraph.get_base(prev, k) == splice_stats.oriented_motif(i, false).front() &&
-                                (prev != seed.first || seed.second != subgraph.get_length(seed.first))) {
-                                int64_t trav_dist = subgraph.min_distance_from_start(prev) + k;
-                                motif_matches[i].emplace_back(prev, k, trav_dist);
-#ifdef debug_splice_region
-                                cerr << "record match to motif " << i << " at " << subgraph.order_of(prev) << "-th node " << subgraph.get_id(prev) << ", ending on node " << subgraph.order_of(handle) << ", dist " << trav_dist << endl;
-#endif
-                            }
-                        }
-                    });
+                    record_boundary_motif_match(handle, i, search_left, splice_stats);
                 }
                 else {
                     int64_t trav_dist = subgraph.min_distance_from_start(handle);
@@ -368,6 +355,172 @@ const pair<handle_t, size_t>& SpliceRegion::get_seed_pos() const {
     return seed;
 }
 
+void SpliceRegion::record_boundary_motif_match(handle_t handle, size_t motif_num, bool search_left,
+                                               const SpliceStats& splice_stats) {
+    subgraph.follow_edges(handle, !search_left, [&](const handle_t& prev) {
+        if (search_left) {
+            if (subgraph.get_base(prev, 0) == splice_stats.oriented_motif(motif_num, true).front() &&
+                (prev != seed.first || seed.second != 0)) {
+                int64_t trav_dist = subgraph.min_distance_from_start(prev) + subgraph.get_length(prev) - 1;
+                motif_matches[motif_num].emplace_back(prev, 1, trav_dist);
+#ifdef debug_splice_region
+                cerr << "record match to motif " << motif_num << " at " << subgraph.order_of(prev) << "-th node " << subgraph.get_id(prev) << ", ending on node " << subgraph.order_of(handle) << ", dist " << trav_dist << endl;
+#endif
+            }
+        }
+        else {
+            size_t k = subgraph.get_length(prev) - 1;
+            if (subgraph.get_base(prev, k) == splice_stats.oriented_motif(motif_num, false).front() &&
+                (prev != seed.first || seed.second != subgraph.get_length(seed.first))) {
+                int64_t trav_dist = subgraph.min_distance_from_start(prev) + k;
+                motif_matches[motif_num].emplace_back(prev, k, trav_dist);
+#ifdef debug_splice_region
+                cerr << "record match to motif " << motif_num << " at " << subgraph.order_of(prev) << "-th node " << subgraph.get_id(prev) << ", ending on node " << subgraph.order_of(handle) << ", dist " << trav_dist << endl;
+#endif
+            }
+        }
+    });
+}
+
+void SpliceRegion::find_indexed_motif_matches(const pos_t& seed_pos, bool search_left, int64_t search_dist,
+                                              const HandleGraph& graph,
+                                              const DinucleotideMachine& dinuc_machine,
+                                              const SpliceStats& splice_stats,
+                                              const SpliceSiteIndex& splice_site_index) {
+    
+    assert(splice_site_index.covers(splice_stats));
+    
+    // the dinucleotide that each motif matches, in the order of the node sequence
+    vector<int> motif_codes(splice_stats.motif_size());
+    for (size_t i = 0; i < splice_stats.motif_size(); ++i) {
+        const string& motif = splice_stats.oriented_motif(i, search_left);
+        motif_codes[i] = SpliceSiteIndex::encode(search_left ? string(motif.rbegin(), motif.rend()) : motif);
+    }
+    
+    vector<handle_t> handles(1, subgraph.handle_at_order(0));
+    while (subgraph.is_extendable()) {
+        handles.push_back(subgraph.extend());
+    }
+    int64_t incr = search_left ? -1 : 1;
+    
+    // the DP is only needed across node boundaries, so we only keep the state
+    // at the last base of each node in the direction of the search, which has
+    // the same semantics as in the full DP
+    vector<uint32_t> end_states(handles.size(), dinuc_machine.init_state());
+    
+    for (size_t i = 0; i < handles.size(); ++i) {
+        
+        handle_t here = handles[i];
+        int64_t length = subgraph.get_length(here);
+        
+        // determine where we'll start iterating from
+        int64_t j;
+        if (i == 0) {
+            j = search_left ? offset(seed_pos) - 1 : offset(seed_pos);
+        }
+        else {
+            j = search_left ? length - 1 : 0;
+        }
+        
+        // determine the bounds of the iteration
+        int64_t prev_dist = subgraph.min_distance_from_start(here);
+        int64_t left_end = 0;
+        int64_t right_end = length;
+        if (prev_dist + length >= search_dist) {
+            if (search_left) {
+                left_end = prev_dist + length - search_dist;
+            }
+            else {
+                right_end = search_dist - prev_dist;
+            }
+        }
+        
+        int64_t start = j;
+        int64_t end = search_left ? 0 : length - 1;
+        
+        // the state at the first position, if it is at a node boundary
+        uint32_t boundary_state = dinuc_machine.init_state();
+        bool at_boundary = ((j == 0 && !search_left) || (j == length - 1 && search_left));
+        // whether the first position can be the first base of a dinucleotide
+        bool start_has_base = true;
+        if (at_boundary) {
+            // merge all of the incoming transition states
+            bool has_incoming = false;
+            char base = subgraph.get_base(here, j);
+            subgraph.follow_edges(here, !search_left, [&](const handle_t& prev) {
+                uint32_t incoming = end_states[subgraph.order_of(prev)];
+                boundary_state = dinuc_machine.merge_state(boundary_state, dinuc_machine.update_state(incoming, base));
+                has_incoming = true;
+            });
+            for (size_t k = 0; k < splice_stats.motif_size(); ++k) {
+                if (dinuc_machine.matches(boundary_state, splice_stats.oriented_motif(k, search_left))) {
+                    record_boundary_motif_match(here, k, search_left, splice_stats);
+                }
+            }
+            if (j == end) {
+                end_states[i] = boundary_state;
+            }
+            start_has_base = has_incoming;
+            j += incr;
+        }
+        
+        // the range of the first base of dinucleotides that the DP would match within the node
+        int64_t first_begin, first_end;
+        if (search_left) {
+            first_begin = left_end;
+            first_end = start_has_base ? start : start - 1;
+        }
+        else {
+            first_begin = start_has_base ? start : start + 1;
+            first_end = right_end - 1;
+        }
+        
+#ifdef debug_splice_region
+        cerr << "node number " << i << ", underlying ID " << subgraph.get_id(here) << ", indexed dinucleotides starting in [" << first_begin << ", " << first_end << "), node len = " << length << endl;
+#endif
+        
+        if (first_begin < first_end) {
+            handle_t underlying = subgraph.get_underlying_handle(here);
+            splice_site_index.for_each_dinucleotide(graph.get_id(underlying), graph.get_is_reverse(underlying),
+                                                    length, search_left, [&](size_t site_offset, uint8_t code) {
+                int64_t k = site_offset;
+                if (k < first_begin || k >= first_end) {
+                    return;
+                }
+                for (size_t m = 0; m < motif_codes.size(); ++m) {
+                    if (motif_codes[m] == code) {
+                        if (search_left) {
+                            motif_matches[m].emplace_back(here, k + 2, prev_dist + length - k - 2);
+                        }
+                        else {
+                            motif_matches[m].emplace_back(here, k, prev_dist + k);
+                        }
+#ifdef debug_splice_region
+                        cerr << "record indexed match to motif " << m << " at " << k << " on node " << subgraph.get_id(here) << endl;
+#endif
+                    }
+                }
+            });
+        }
+        
+        // does the DP reach the end of the node?
+        if (j >= left_end && j < right_end && end >= left_end && end < right_end
+            && (search_left ? end <= j : end >= j)) {
+            uint32_t prev_state;
+            if (end == j) {
+                // the end is the first position after the start
+                prev_state = at_boundary ? boundary_state : dinuc_machine.init_state();
+            }
+            else {
+                // only the last base of the previous state matters
+                prev_state = dinuc_machine.update_state(dinuc_machine.init_state(),
+                                                        subgraph.get_base(here, end - incr));
+            }
+            end_states[i] = dinuc_machine.update_state(prev_state, subgraph.get_base(here, end));
+        }
+    }
+}
+
 const vector<tuple<handle_t, size_t, int64_t>>& SpliceRegion::candidate_splice_sites(size_t motif_num) const {
     return motif_matches[motif_num];
 }
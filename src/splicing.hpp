@@ -17,6 +17,8 @@ namespace vg {
 
 using namespace std;
 
+class SpliceSiteIndex;
+
 /*
  * Object that represents:
  * 1. A table of the acceptable splice motifs and their scores
@@ -97,10 +99,13 @@ private:
 class SpliceRegion {
 public:
     
+    // if an index of splice sites is provided, motifs that lie within a node
+    // are looked up in it instead of being searched for in the node sequences
     SpliceRegion(const pos_t& seed_pos, bool search_left, int64_t search_dist,
                  const HandleGraph& graph,
                  const DinucleotideMachine& dinuc_machine,
-                 const SpliceStats& splice_stats);
+                 const SpliceStats& splice_stats,
+                 const SpliceSiteIndex* splice_site_index = nullptr);
     SpliceRegion() = default;
     ~SpliceRegion() = default;
     
@@ -116,6 +121,18 @@ public:
     const pair<handle_t, size_t>& get_seed_pos() const;
     
 private:
+    
+    // record the matches to a motif that end at the first base of this node
+    // in the direction of the search
+    void record_boundary_motif_match(handle_t handle, size_t motif_num, bool search_left,
+                                     const SpliceStats& splice_stats);
+    
+    // find the motif matches using the splice site index
+    void find_indexed_motif_matches(const pos_t& seed_pos, bool search_left, int64_t search_dist,
+                                    const HandleGraph& graph,
+                                    const DinucleotideMachine& dinuc_machine,
+                                    const SpliceStats& splice_stats,
+                                    const SpliceSiteIndex& splice_site_index);
 
     IncrementalSubgraph subgraph;
     
@@ -0,0 +1,252 @@
+/**
+ * \file step_position_overlay.cpp: contains the implementation of StepPositionOverlay
+ */
+
+
+#include "step_position_overlay.hpp"
+
+#include <algorithm>
+
+
+namespace vg {
+
+using namespace std;
+
+    StepPositionOverlay::StepPositionOverlay(const PathPositionHandleGraph* graph) : graph(graph) {
+        
+        if (graph->get_node_count() == 0) {
+            return;
+        }
+        
+        // go through the paths in a consistent order so the arrays come out the same every time
+        vector<path_handle_t> path_order;
+        graph->for_each_path_handle([&](const path_handle_t& path) {
+            path_order.push_back(path);
+        });
+        sort(path_order.begin(), path_order.end(), [&](const path_handle_t& a, const path_handle_t& b) {
+            return as_integer(a) < as_integer(b);
+        });
+        
+        min_id = graph->min_node_id();
+        node_starts.resize(graph->max_node_id() - min_id + 2, 0);
+        
+        // count the visits to each node, shifted by one so the prefix sum gives the starts
+        for (const path_handle_t& path : path_order) {
+            graph->for_each_step_in_path(path, [&](const step_handle_t& step) {
+                ++node_starts[graph->get_id(graph->get_handle_of_step(step)) - min_id + 1];
+            });
+        }
+        for (size_t i = 1; i < node_starts.size(); ++i) {
+            node_starts[i] += node_starts[i - 1];
+        }
+        
+        // fill in the visits, walking the offset along each path as we go
+        visit_paths.resize(node_starts.back());
+        visit_steps.resize(node_starts.back());
+        visit_offsets.resize(node_starts.back());
+        visit_reverse.resize(node_starts.back());
+        vector<size_t> next_visit(node_starts.begin(), node_starts.end() - 1);
+        for (const path_handle_t& path : path_order) {
+            size_t offset = 0;
+            graph->for_each_step_in_path(path, [&](const step_handle_t& step) {
+                handle_t handle = graph->get_handle_of_step(step);
+                size_t i = next_visit[graph->get_id(handle) - min_id]++;
+                visit_paths[i] = path;
+                visit_steps[i] = step;
+                visit_offsets[i] = offset;
+                visit_reverse[i] = graph->get_is_reverse(handle);
+                offset += graph->get_length(handle);
+            });
+            path_lengths[path] = offset;
+        }
+    }
+    
+    pair<size_t, size_t> StepPositionOverlay::visit_range(id_t node_id) const {
+        if (node_id < min_id || node_id - min_id + 1 >= node_starts.size()) {
+            return make_pair(0, 0);
+        }
+        return make_pair(node_starts[node_id - min_id], node_starts[node_id - min_id + 1]);
+    }
+    
+    bool StepPositionOverlay::has_node(id_t node_id) const {
+        return graph->has_node(node_id);
+    }
+    
+    handle_t StepPositionOverlay::get_handle(const id_t& node_id, bool is_reverse) const {
+        return graph->get_handle(node_id, is_reverse);
+    }
+    
+    id_t StepPositionOverlay::get_id(const handle_t& handle) const {
+        return graph->get_id(handle);
+    }
+    
+    bool StepPositionOverlay::get_is_reverse(const handle_t& handle) const {
+        return graph->get_is_reverse(handle);
+    }
+    
+    handle_t StepPositionOverlay::flip(const handle_t& handle) const {
+        return graph->flip(handle);
+    }
+    
+    size_t StepPositionOverlay::get_length(const handle_t& handle) const {
+        return graph->get_length(handle);
+    }
+    
+    string StepPositionOverlay::get_sequence(const handle_t& handle) const {
+        return graph->get_sequence(handle);
+    }
+    
+    bool StepPositionOverlay::follow_edges_impl(const handle_t& handle, bool go_left,
+                                           const function<bool(const handle_t&)>& iteratee) const {
+        
+        return graph->follow_edges(handle, go_left, [&](const handle_t& next) {
+            return iteratee(next);
+        });
+    }
+    
+    bool StepPositionOverlay::for_each_handle_impl(const function<bool(const handle_t&)>& iteratee, bool parallel) const {
+        return graph->for_each_handle([&](const handle_t& handle) {
+            return iteratee(handle);
+        }, parallel);
+    }
+    
+    size_t StepPositionOverlay::get_node_count() const {
+        return graph->get_node_count();
+    }
+    
+    id_t StepPositionOverlay::min_node_id() const {
+        return graph->min_node_id();
+    }
+    
+    id_t StepPositionOverlay::max_node_id() const {
+        return graph->max_node_id();
+    }
+    
+    size_t StepPositionOverlay::get_path_count() const {
+        return graph->get_path_count();
+    }
+    
+    bool StepPositionOverlay::has_path(const std::string& path_name) const {
+        return graph->has_path(path_name);
+    }
+    
+    path_handle_t StepPositionOverlay::get_path_handle(const std::string& path_name) const {
+        return graph->get_path_handle(path_name);
+    }
+    
+    std::string StepPositionOverlay::get_path_name(const path_handle_t& path_handle) const {
+        return graph->get_path_name(path_handle);
+    }
+    
+    bool StepPositionOverlay::get_is_circular(const path_handle_t& path_handle) const {
+        return graph->get_is_circular(path_handle);
+    }
+    
+    size_t StepPositionOverlay::get_step_count(const path_handle_t& path_handle) const {
+        return graph->get_step_count(path_handle);
+    }
+    
+    handle_t StepPositionOverlay::get_handle_of_step(const step_handle_t& step_handle) const {
+        return graph->get_handle_of_step(step_handle);
+    }
+    
+    path_handle_t StepPositionOverlay::get_path_handle_of_step(const step_handle_t& step_handle) const {
+        return graph->get_path_handle_of_step(step_handle);
+    }
+    
+    step_handle_t StepPositionOverlay::path_begin(const path_handle_t& path_handle) const {
+        return graph->path_begin(path_handle);
+    }
+    
+    step_handle_t StepPositionOverlay::path_end(const path_handle_t& path_handle) const {
+        return graph->path_end(path_handle);
+    }
+    
+    step_handle_t StepPositionOverlay::path_back(const path_handle_t& path_handle) const {
+        return graph->path_back(path_handle);
+    }
+    
+    step_handle_t StepPositionOverlay::path_front_end(const path_handle_t& path_handle) const {
+        return graph->path_front_end(path_handle);
+    }
+    
+    bool StepPositionOverlay::has_next_step(const step_handle_t& step_handle) const {
+        return graph->has_next_step(step_handle);
+    }
+    
+    bool StepPositionOverlay::has_previous_step(const step_handle_t& step_handle) const {
+        return graph->has_previous_step(step_handle);
+    }
+    
+    step_handle_t StepPositionOverlay::get_next_step(const step_handle_t& step_handle) const {
+        return graph->get_next_step(step_handle);
+    }
+    
+    step_handle_t StepPositionOverlay::get_previous_step(const step_handle_t& step_handle) const {
+        return graph->get_previous_step(step_handle);
+    }
+
+    bool StepPositionOverlay::for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const {
+        return graph->for_each_path_handle(iteratee);
+    }
+    
+    bool StepPositionOverlay::for_each_step_on_handle_impl(const handle_t& handle,
+                                                           const std::function<bool(const step_handle_t&)>& iteratee) const {
+        auto range = visit_range(graph->get_id(handle));
+        for (size_t i = range.first; i < range.second; ++i) {
+            if (!iteratee(visit_steps[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    std::vector<step_handle_t> StepPositionOverlay::steps_of_handle(const handle_t& handle,
+                                                                    bool match_orientation) const {
+        vector<step_handle_t> to_return;
+        auto range = visit_range(graph->get_id(handle));
+        bool is_reverse = graph->get_is_reverse(handle);
+        for (size_t i = range.first; i < range.second; ++i) {
+            if (!match_orientation || (bool) visit_reverse[i] == is_reverse) {
+                to_return.push_back(visit_steps[i]);
+            }
+        }
+        return to_return;
+    }
+    
+    bool StepPositionOverlay::is_empty(const path_handle_t& path_handle) const {
+        return graph->is_empty(path_handle);
+    }
+    
+    size_t StepPositionOverlay::get_path_length(const path_handle_t& path_handle) const {
+        auto it = path_lengths.find(path_handle);
+        return it != path_lengths.end() ? it->second : graph->get_path_length(path_handle);
+    }
+    
+    size_t StepPositionOverlay::get_position_of_step(const step_handle_t& step) const {
+        auto range = visit_range(graph->get_id(graph->get_handle_of_step(step)));
+        for (size_t i = range.first; i < range.second; ++i) {
+            if (visit_steps[i] == step) {
+                return visit_offsets[i];
+            }
+        }
+        return graph->get_position_of_step(step);
+    }
+    
+    step_handle_t StepPositionOverlay::get_step_at_position(const path_handle_t& path,
+                                                            const size_t& position) const {
+        return graph->get_step_at_position(path, position);
+    }
+    
+    bool StepPositionOverlay::for_each_step_position_on_handle(const handle_t& handle,
+                                                               const std::function<bool(const step_handle_t&, const bool&, const size_t&)>& iteratee) const {
+        auto range = visit_range(graph->get_id(handle));
+        bool is_reverse = graph->get_is_reverse(handle);
+        for (size_t i = range.first; i < range.second; ++i) {
+            if (!iteratee(visit_steps[i], (bool) visit_reverse[i] != is_reverse, visit_offsets[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
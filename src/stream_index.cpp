@@ -447,6 +447,54 @@ auto StreamIndexBase::find(id_t min_node, id_t max_node, const function<bool(int
     }
 }
 
+auto StreamIndexBase::find_scan_ranges(const vector<vector<pair<id_t, id_t>>>& queries) const -> vector<tuple<int64_t, int64_t, id_t>> {
+    // Collect the runs for every range of every query, as (VO, is start,
+    // query range max ID) events. Ends sort before starts at the same VO.
+    vector<tuple<int64_t, bool, id_t>> events;
+    for (auto& query : queries) {
+        for (auto& range : query) {
+            find(range.first, range.second, [&](int64_t start_vo, int64_t past_end_vo) -> bool {
+                if (start_vo < past_end_vo) {
+                    events.emplace_back(start_vo, true, range.second);
+                    events.emplace_back(past_end_vo, false, range.second);
+                }
+                // We can't scan the data, so take all the runs.
+                return true;
+            });
+        }
+    }
+    sort(events.begin(), events.end());
+    
+    vector<tuple<int64_t, int64_t, id_t>> to_return;
+    
+    // Sweep over the events, tracking the max IDs of the runs we are in.
+    multiset<id_t> active;
+    int64_t range_start = 0;
+    for (size_t i = 0; i < events.size();) {
+        int64_t vo = get<0>(events[i]);
+        if (!active.empty() && range_start < vo) {
+            // Emit the range since the last event, merging it into the
+            // previous one if they abut and want the same IDs.
+            id_t max_id = *active.rbegin();
+            if (!to_return.empty() && get<1>(to_return.back()) == range_start && get<2>(to_return.back()) == max_id) {
+                get<1>(to_return.back()) = vo;
+            } else {
+                to_return.emplace_back(range_start, vo, max_id);
+            }
+        }
+        for (; i < events.size() && get<0>(events[i]) == vo; i++) {
+            if (get<1>(events[i])) {
+                active.insert(get<2>(events[i]));
+            } else {
+                active.erase(active.find(get<2>(events[i])));
+            }
+        }
+        range_start = vo;
+    }
+    
+    return to_return;
+}
+
 auto StreamIndexBase::scan_backward(const function<bool(int64_t, int64_t)> scan_callback) const -> void {
     // Remember the previous range's start VO, to be the next range's past-end VO.
     int64_t prev_vo = numeric_limits<int64_t>::max();
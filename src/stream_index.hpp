@@ -6,12 +6,16 @@
  * Contains the StreamIndex template, which allows lookup by relevant node ID in sorted VPKG-formatted files.
  */
  
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <set>
+#include <tuple>
 #include <unordered_map>
 #include <type_traits>
 
+#include <omp.h>
+
 #include "types.hpp"
 #include <vg/vg.pb.h>
 #include <vg/io/protobuf_iterator.hpp>
@@ -272,6 +276,16 @@ public:
     /// from the linear index, or the past-the-end of the previous run scanned.
     void find(id_t min_node, id_t max_node, const function<bool(int64_t, int64_t)> scan_callback) const;
     
+    /// Find the ranges of virtual offsets to scan for a batch of queries,
+    /// each of which is a vector of sorted, coalesced inclusive node ID
+    /// ranges. The runs for all the queries are split at each other's
+    /// boundaries and returned in order as disjoint ranges, so no group needs
+    /// to be scanned twice. Each range comes with the largest node ID that
+    /// any of the queries scanning it is looking for; once a group with a
+    /// larger minimum node ID is seen, the rest of the range can be skipped.
+    /// Abutting ranges with the same maximum node ID are merged.
+    vector<tuple<int64_t, int64_t, id_t>> find_scan_ranges(const vector<vector<pair<id_t, id_t>>>& queries) const;
+    
     /// Iterate over ranges of virtual offsets from the end of the file to the
     /// start. The ranges to *not* necessarily correspond to runs. The ending
     /// VO of the first range iterated may be numeric_limits<int64_t>::max().
@@ -378,6 +392,18 @@ public:
     void find(cursor_t& cursor, const vector<pair<id_t, id_t>>& ranges, const function<void(const Message&)> handle_result,
         bool only_fully_contained = false) const;
     
+    /// Answer a batch of queries at once, where each query is a vector of
+    /// sorted, coalesced inclusive ranges as for find(). Calls the callback
+    /// with the query number and each message that matches that query; a
+    /// message matching several queries is passed once for each of them, but
+    /// each group in the file is decoded at most once for the whole batch.
+    /// The scan ranges are read in parallel, one OMP thread per cursor, but
+    /// the callback is only called by one thread at a time, in file order.
+    /// If only_fully_contained is set, only messages where *all* the involved
+    /// nodes are in one of the query's ranges will match it.
+    void find_batch(vector<cursor_t>& cursors, const vector<vector<pair<id_t, id_t>>>& queries,
+        const function<void(size_t, const Message&)> handle_result, bool only_fully_contained = false) const;
+    
     /// Given a cursor at the beginning of a sorted, readable file, index the file.
     void index(cursor_t& cursor);
     
@@ -870,6 +896,130 @@ auto StreamIndex<Message>::find(cursor_t& cursor, const vector<pair<id_t, id_t>>
     }
 }
 
+template<typename Message>
+auto StreamIndex<Message>::find_batch(vector<cursor_t>& cursors, const vector<vector<pair<id_t, id_t>>>& queries,
+    const function<void(size_t, const Message&)> handle_result, bool only_fully_contained) const -> void {
+    
+    assert(!cursors.empty());
+    
+    // Lay out the ranges of all the queries by start, as (start, end, query
+    // number), so we can find the queries that want each node ID.
+    vector<tuple<id_t, id_t, size_t>> query_ranges;
+    for (size_t i = 0; i < queries.size(); i++) {
+        for (auto& range : queries[i]) {
+            query_ranges.emplace_back(range.first, range.second, i);
+        }
+    }
+    sort(query_ranges.begin(), query_ranges.end());
+    
+    // Keep the running maximum of the range ends, so we know when no earlier
+    // range can reach a node ID.
+    vector<id_t> max_end_through(query_ranges.size());
+    for (size_t i = 0; i < query_ranges.size(); i++) {
+        max_end_through[i] = (i == 0 ? get<1>(query_ranges[i]) : max(max_end_through[i - 1], get<1>(query_ranges[i])));
+    }
+    
+    // Call the iteratee with the number of every query with a range
+    // containing the given ID. Queries may repeat.
+    auto for_each_query_of = [&](id_t id, const function<void(size_t)>& iteratee) {
+        auto found = upper_bound(query_ranges.begin(), query_ranges.end(), id,
+            [](id_t id, const tuple<id_t, id_t, size_t>& range) {
+                return id < get<0>(range);
+            });
+        for (size_t i = found - query_ranges.begin(); i > 0 && max_end_through[i - 1] >= id; i--) {
+            if (get<1>(query_ranges[i - 1]) >= id) {
+                iteratee(get<2>(query_ranges[i - 1]));
+            }
+        }
+    };
+    
+    vector<tuple<int64_t, int64_t, id_t>> scan_ranges = find_scan_ranges(queries);
+    
+#ifdef debug
+    cerr << "Batch of " << queries.size() << " queries needs " << scan_ranges.size() << " scan ranges" << endl;
+#endif
+    
+    // Scan the ranges in parallel, but emit what we find in file order.
+    #pragma omp parallel for ordered schedule(dynamic, 1) num_threads(cursors.size())
+    for (size_t i = 0; i < scan_ranges.size(); i++) {
+        cursor_t& cursor = cursors[omp_get_thread_num()];
+        int64_t start_vo, past_end_vo;
+        id_t max_id;
+        tie(start_vo, past_end_vo, max_id) = scan_ranges[i];
+        
+        // The matching messages in the range, and (query, message number) for all the matches.
+        vector<Message> messages;
+        vector<pair<size_t, size_t>> matches;
+        
+        vector<id_t> ids;
+        vector<size_t> matched_queries;
+        
+        cursor.seek_group(start_vo);
+        int64_t group_vo = cursor.tell_group();
+        id_t group_min_id = numeric_limits<id_t>::max();
+        while (cursor.has_current() && cursor.tell_group() < past_end_vo) {
+            if (cursor.tell_group() != group_vo) {
+                // We finished the previous group.
+                if (group_min_id != numeric_limits<id_t>::max() && group_min_id > max_id) {
+                    // Everything in the (non-empty) previous group was too
+                    // high for every query, and so is everything after it.
+                    break;
+                }
+                group_vo = cursor.tell_group();
+                group_min_id = numeric_limits<id_t>::max();
+            }
+            
+            ids.clear();
+            for_each_id(*cursor, [&](const id_t& found) {
+                ids.push_back(found);
+                group_min_id = min(group_min_id, found);
+                return true;
+            });
+            
+            // Find the queries that want any of the IDs
+            matched_queries.clear();
+            for (auto& id : ids) {
+                for_each_query_of(id, [&](size_t query) {
+                    matched_queries.push_back(query);
+                });
+            }
+            sort(matched_queries.begin(), matched_queries.end());
+            matched_queries.erase(unique(matched_queries.begin(), matched_queries.end()), matched_queries.end());
+            
+            bool kept = false;
+            for (auto& query : matched_queries) {
+                if (only_fully_contained) {
+                    // We need *all* of the nodes to be in this query.
+                    bool contained = all_of(ids.begin(), ids.end(), [&](const id_t& id) {
+                        return is_in_range(queries[query], id);
+                    });
+                    if (!contained) {
+                        continue;
+                    }
+                }
+                if (!kept) {
+                    // Take the message, which also advances the cursor.
+                    messages.emplace_back(cursor.take());
+                    kept = true;
+                }
+                matches.emplace_back(query, messages.size() - 1);
+            }
+            
+            if (!kept) {
+                // Look for the next message
+                cursor.advance();
+            }
+        }
+        
+        #pragma omp ordered
+        {
+            for (auto& match : matches) {
+                handle_result(match.first, messages[match.second]);
+            }
+        }
+    }
+}
+
 template<typename Message>
 auto StreamIndex<Message>::index(cursor_t& cursor) -> void {
     // Keep track of what group we are in 
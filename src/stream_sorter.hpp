@@ -4,6 +4,9 @@
 #include <vg/vg.pb.h>
 #include <vg/io/protobuf_emitter.hpp>
 #include <vg/io/protobuf_iterator.hpp>
+#include <vg/io/message_iterator.hpp>
+#include <vg/io/message_emitter.hpp>
+#include <vg/io/registry.hpp>
 #include <vg/io/stream.hpp>
 #include "types.hpp"
 #include "progressive.hpp"
@@ -21,6 +24,9 @@
 #include <unordered_map>
 #include <tuple>
 
+#include <omp.h>
+#include <ips4o.hpp>
+
 #include <sys/time.h>
 #include <sys/resource.h>
 
@@ -70,7 +76,9 @@ public:
     // Supporting API
     //////////////////
 
-    /// Sort a vector of messages, in place.
+    /// Sort a vector of messages, in place. The sort is stable. Each
+    /// message's minimum position is computed only once, and the sort uses
+    /// OMP threads if called outside of a parallel region.
     void sort(vector<Message>& msgs) const;
 
     /// Return true if out of Messages a and b, a must come before b, and false otherwise.
@@ -83,6 +91,13 @@ public:
     /// only the reverse strand is visited.
     Position get_min_position(const Message& msg) const;
 
+    /// A compact sort key for a message: node ID, orientation, and offset of
+    /// its minimum Position. Keys compare in the same order as less_than().
+    using key_type = tuple<nid_t, bool, int64_t>;
+    
+    /// Compute the sort key for a message.
+    key_type get_sort_key(const Message& msg) const;
+    
     /// Return True if position A is less than position B in our sort, and false otherwise.
     /// Position order is defined first by node ID, then by strand (forward first), and then by offset within the strand.
     /// We can't sort by actual base on the forward strand, because we need to be able to sort without knowing the graph's node lengths.
@@ -173,9 +188,35 @@ StreamSorter<Message>::StreamSorter(bool show_progress) {
 
 template<typename Message>
 void StreamSorter<Message>::sort(vector<Message>& msgs) const {
-    std::sort(msgs.begin(), msgs.end(), [&](const Message& a, const Message& b) {
-        return this->less_than(a, b);
-    });
+    // Finding the min position scans the whole message, so we compute the
+    // keys once instead of in every comparison. Ties are broken by the
+    // original rank to make the order deterministic.
+    vector<pair<key_type, size_t>> keys(msgs.size());
+    for (size_t i = 0; i < msgs.size(); i++) {
+        keys[i] = make_pair(get_sort_key(msgs[i]), i);
+    }
+    if (omp_in_parallel()) {
+        ips4o::sort(keys.begin(), keys.end());
+    } else {
+        ips4o::parallel::sort(keys.begin(), keys.end());
+    }
+    
+    // Apply the permutation in place, one cycle at a time.
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i].second == i) {
+            continue;
+        }
+        Message temp = std::move(msgs[i]);
+        size_t j = i;
+        while (keys[j].second != i) {
+            size_t next = keys[j].second;
+            msgs[j] = std::move(msgs[next]);
+            keys[j].second = j;
+            j = next;
+        }
+        msgs[j] = std::move(temp);
+        keys[j].second = j;
+    }
 }
 
 template<typename Message>
@@ -254,54 +295,82 @@ void StreamSorter<Message>::stream_sort(istream& stream_in, ostream& stream_out,
     // This tracks the total messages observed on input
     size_t total_messages_read = 0;
     
-    // This cursor will read in the input file.
-    cursor_t input_cursor(stream_in);
+    // This iterator will read in the input file. We only decompress under the
+    // lock, and each thread parses the messages it took.
+    vg::io::MessageIterator input_iterator(stream_in);
+    const string& message_tag = vg::io::Registry::get_protobuf_tag<Message>();
     
-    #pragma omp parallel shared(stream_in, input_cursor, outstanding_temp_files, messages_per_file, total_messages_read)
+    #pragma omp parallel shared(stream_in, input_iterator, outstanding_temp_files, messages_per_file, total_messages_read)
     {
     
         while(true) {
     
-            vector<Message> thread_buffer;
+            vector<vg::io::MessageIterator::TaggedMessage> serialized;
         
             #pragma omp critical (input_cursor)
             {
                 // Each thread fights for the file and the winner takes some data
                 size_t buffered_message_bytes = 0;
-                while (input_cursor.has_current() && buffered_message_bytes < max_buf_size) {
+                while (input_iterator.has_current() && buffered_message_bytes < max_buf_size) {
                     // Until we run out of input messages or space, buffer each, recording its size.
-                    thread_buffer.emplace_back(std::move(input_cursor.take()));
-                    // Note that the message has to be small enough for its size to fit in a signed int
-                    buffered_message_bytes += thread_buffer.back().ByteSize();
+                    serialized.emplace_back(std::move(input_iterator.take()));
+                    if (!serialized.back().second) {
+                        // This is just a tag alone; throw this away.
+                        serialized.pop_back();
+                        continue;
+                    }
+                    buffered_message_bytes += serialized.back().second->size();
                 }
             
                 // Update the progress bar
                 update_progress(stream_in.tellg());
             }
             
-            if (thread_buffer.empty()) {
+            if (serialized.empty()) {
                 // No data was found
                 break;
             }
             
+            // Parse each message only to find its sort key, and keep the
+            // serialized bytes so that we can write them without
+            // serializing the messages again.
+            vector<pair<key_type, size_t>> keys(serialized.size());
+            Message scratch;
+            for (size_t i = 0; i < serialized.size(); i++) {
+                if (!scratch.ParseFromString(*(serialized[i].second))) {
+                    #pragma omp critical (cerr)
+                    {
+                        cerr << "error:[vg::StreamSorter]: could not parse a "
+                             << (serialized[i].first.empty() ? "untagged" : serialized[i].first) << " message" << endl;
+                        exit(1);
+                    }
+                }
+                // Ties are broken by input order.
+                keys[i] = make_pair(get_sort_key(scratch), i);
+            }
+            
             // Do a sort of the data we grabbed
-            this->sort(thread_buffer);
+            ips4o::sort(keys.begin(), keys.end());
             
             // Save it to a temp file.
             string temp_name = temp_file::create();
             ofstream temp_stream(temp_name);
-            // OK to save as one massive group here.
-            // TODO: This write could also be in a thread.
-            vg::io::write_buffered(temp_stream, thread_buffer, 0);
+            {
+                // OK to save as one massive group here.
+                vg::io::MessageEmitter temp_emitter(temp_stream, true, serialized.size());
+                for (auto& key : keys) {
+                    temp_emitter.write(message_tag, std::move(*(serialized[key.second].second)));
+                }
+            }
             
             #pragma omp critical (outstanding_temp_files)
             {
                 // Remember the temp file name
                 outstanding_temp_files.push_back(temp_name);
                 // Remember the messages in the file, for progress purposes
-                messages_per_file[temp_name] = thread_buffer.size();
+                messages_per_file[temp_name] = serialized.size();
                 // Remember how many messages we found in the total
-                total_messages_read += thread_buffer.size();
+                total_messages_read += serialized.size();
             }
         }
     }
@@ -385,29 +454,31 @@ void StreamSorter<Message>::streaming_merge(list<cursor_t>& cursors, emitter_t&
 
     // Put all the files in a priority queue based on which has a message that comes first.
     // We work with pointers to cursors because we don't want to be copying the actual cursors around the heap.
-    // We also *reverse* the order, because priority queues put the "greatest" element first
-    auto cursor_order = [&](cursor_t*& a, cursor_t*& b) {
-        if (b->has_current()) {
-            if(!a->has_current()) {
-                // Cursors that aren't empty come first
-                return true;
-            }
-            return less_than(*(*b), *(*a));
-        }
-        return false;
+    // The key of the current message is cached with the cursor, so that we do
+    // not have to scan the messages again for every comparison. Ties go to the
+    // earlier cursor. We *reverse* the order, because priority queues put the
+    // "greatest" element first.
+    using entry_type = tuple<key_type, size_t, cursor_t*>;
+    auto cursor_order = [](const entry_type& a, const entry_type& b) {
+        return make_pair(get<0>(b), get<1>(b)) < make_pair(get<0>(a), get<1>(a));
     };
-    priority_queue<cursor_t*, vector<cursor_t*>, decltype(cursor_order)> cursor_queue(cursor_order);
-
+    priority_queue<entry_type, vector<entry_type>, decltype(cursor_order)> cursor_queue(cursor_order);
+    
+    size_t cursor_rank = 0;
     for (auto& cursor : cursors) {
-        // Put the cursor pointers in the queue
-        cursor_queue.push(&cursor);
+        // Put the non-empty cursors in the queue
+        if (cursor.has_current()) {
+            cursor_queue.emplace(get_sort_key(*cursor), cursor_rank, &cursor);
+        }
+        cursor_rank++;
     }
     
-    while(!cursor_queue.empty() && cursor_queue.top()->has_current()) {
+    while(!cursor_queue.empty()) {
         // Until we have run out of data in all the temp files
         
         // Pop off the winning cursor
-        cursor_t* winner = cursor_queue.top();
+        size_t winner_rank = get<1>(cursor_queue.top());
+        cursor_t* winner = get<2>(cursor_queue.top());
         cursor_queue.pop();
         
         // Grab and emit its message, and advance it
@@ -415,7 +486,7 @@ void StreamSorter<Message>::streaming_merge(list<cursor_t>& cursors, emitter_t&
         
         // Put it back in the heap if it is not depleted
         if (winner->has_current()) {
-            cursor_queue.push(winner);
+            cursor_queue.emplace(get_sort_key(*(*winner)), winner_rank, winner);
         }
         // TODO: Maybe keep it off the heap for the next loop somehow if it still wins
         
@@ -446,7 +517,7 @@ vector<string> StreamSorter<Message>::streaming_merge(const vector<string>& temp
         // Open up cursors into all the files.
         list<ifstream> temp_ifstreams;
         list<cursor_t> temp_cursors;
-        open_all(vector<string>(&temp_files_out[start_file], &temp_files_out[start_file + file_count]), temp_ifstreams, temp_cursors);
+        open_all(vector<string>(temp_files_in.begin() + start_file, temp_files_in.begin() + start_file + file_count), temp_ifstreams, temp_cursors);
         
         // Work out how many messages to expect
         size_t expected_messages = 0;
@@ -472,7 +543,7 @@ vector<string> StreamSorter<Message>::streaming_merge(const vector<string>& temp
         // Clean up the input files we used
         temp_cursors.clear();
         temp_ifstreams.clear();
-        for (size_t i = start_file; i < file_count; i++) {
+        for (size_t i = start_file; i < start_file + file_count; i++) {
             temp_file::remove(temp_files_in.at(i));
         }
         
@@ -491,6 +562,12 @@ bool StreamSorter<Message>::less_than(const Message &a, const Message &b) const
     return less_than(get_min_position(a), get_min_position(b));
 }
 
+template<typename Message>
+typename StreamSorter<Message>::key_type StreamSorter<Message>::get_sort_key(const Message& msg) const {
+    Position pos = get_min_position(msg);
+    return key_type(pos.node_id(), pos.is_reverse(), pos.offset());
+}
+
 template<typename Message>
 Position StreamSorter<Message>::get_min_position(const Message& msg) const {
     // This holds the min Position we get
@@ -10,6 +10,7 @@
 #include "../gff_reader.hpp"
 #include "../region_expander.hpp"
 #include "../algorithms/alignment_path_offsets.hpp"
+#include "../step_position_overlay.hpp"
 #include <bdsg/overlays/overlay_helper.hpp>
 
 #include <unistd.h>
@@ -313,6 +314,13 @@ int main_annotate(int argc, char** argv) {
                 });
             }
             
+            // Precompute the path visits so all the threads can look up positions without
+            // going back to the graph's path structures
+            unique_ptr<StepPositionOverlay> step_positions;
+            if (add_positions) {
+                step_positions = make_unique<StepPositionOverlay>(mapper.xindex);
+            }
+            
             get_input_file(gam_name, [&](istream& in) {
                 vg::io::for_each_parallel<Alignment>(in, [&](Alignment& aln) {
                     // For each read
@@ -322,10 +330,10 @@ int main_annotate(int argc, char** argv) {
                         aln.clear_refpos();
                         if (add_multiple_positions) {
                             // One position per node
-                            vg::algorithms::annotate_with_node_path_positions(*mapper.xindex, aln, search_limit);
+                            vg::algorithms::annotate_with_node_path_positions(*step_positions, aln, search_limit);
                         } else {
                             // One position per alignment
-                            vg::algorithms::annotate_with_initial_path_positions(*mapper.xindex, aln, search_limit);
+                            vg::algorithms::annotate_with_initial_path_positions(*step_positions, aln, search_limit);
                         }
                     }
                     
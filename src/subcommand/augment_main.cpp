@@ -57,10 +57,11 @@ void help_augment(char** argv, ConfigurableParser& parser) {
          << "    -Q, --min-mapq N            ignore alignments with mapping quality < N" << endl
          << "    -N, --max-n F               maximum fraction of N bases in an edit for it to be included [default : 0.25]" << endl
          << "    -E, --edges-only            only edges implied by reads, ignoring edits" << endl
+         << "    -k, --chunk-size N          work on N node IDs at a time to bound memory (needs a sorted GAM with a .gai index)" << endl
          << "    -h, --help                  print this help message" << endl
          << "    -p, --progress              show progress" << endl
          << "    -v, --verbose               print information and warnings about vcf generation" << endl
-         << "    -t, --threads N             number of threads (only 1st pass with -m or -q option is multithreaded)" << endl
+         << "    -t, --threads N             number of threads (graph modification in the 2nd pass is single-threaded)" << endl
          << "loci file options:" << endl
          << "    -l, --include-loci FILE     merge all alleles in loci into the graph" << endl       
          << "    -L, --include-gt FILE       merge only the alleles in called genotypes into the graph" << endl;
@@ -123,6 +124,9 @@ int main_augment(int argc, char** argv) {
     // GAF format toggle
     string aln_format = "GAM";
 
+    // When non-zero, augment a sorted, indexed GAM this many node IDs at a time
+    size_t chunk_size = 0;
+
     // Print some progress messages to screen
     bool show_progress = false;
 
@@ -147,6 +151,7 @@ int main_augment(int argc, char** argv) {
         {"max-n", required_argument, 0, 'N'},
         {"edges-only", no_argument, 0, 'E'},
         {"gaf", no_argument, 0, 'F'},
+        {"chunk-size", required_argument, 0, 'k'},
         {"help", no_argument, 0, 'h'},
         {"progress", required_argument, 0, 'p'},
         {"verbose", no_argument, 0, 'v'},
@@ -156,7 +161,7 @@ int main_augment(int argc, char** argv) {
         {"include-gt", required_argument, 0, 'L'},
         {0, 0, 0, 0}
     };
-    static const char* short_options = "a:Z:A:iCSBhpvt:l:L:sm:c:q:Q:N:EF";
+    static const char* short_options = "a:Z:A:iCSBhpvt:l:L:sm:c:q:Q:N:EFk:";
     optind = 2; // force optind past command positional arguments
 
     // This is our command-line parser
@@ -211,6 +216,9 @@ int main_augment(int argc, char** argv) {
         case 'F':
             aln_format = "GAF";
             break;
+        case 'k':
+            chunk_size = parse<size_t>(optarg);
+            break;
         case 'h':
         case '?':
             /* getopt_long already printed an error message. */
@@ -278,6 +286,12 @@ int main_augment(int argc, char** argv) {
         cerr <<"vg augment] error: -E cannot be used with -i" << endl;
         return 1;
     }
+    if (chunk_size > 0 && (gam_in_file_name.empty() || gam_in_file_name == "-" || aln_format != "GAM" ||
+                           !loci_file.empty() || label_paths || edges_only)) {
+        cerr << "[vg augment] error: chunking (-k) requires a sorted, indexed GAM file, and does not work with"
+             << " GAF (-F), stdin, loci (-l/-L), label-paths (-B) or edges-only (-E)" << endl;
+        return 1;
+    }
     if (gam_in_file_name == "-" && !label_paths) {
         cerr << "[vg augment] warning: reading the entire GAM from stdin into memory.  it is recommended to pass in"
              << " a filename rather than - so it can be streamed over two passes" << endl;
@@ -325,7 +339,7 @@ int main_augment(int argc, char** argv) {
     else {
         // the packer's required for any kind of filtering logic -- so we use it when
         // baseq is present as well, or n-fraction.
-        if (min_coverage > 0 || min_baseq || max_frac_n < 1.) {
+        if (chunk_size == 0 && (min_coverage > 0 || min_baseq || max_frac_n < 1.)) {
             vectorizable_graph = dynamic_cast<HandleGraph*>(overlay_helper.apply(graph.get()));
             size_t data_width = Packer::estimate_data_width(expected_coverage);
             size_t bin_count = Packer::estimate_bin_count(get_thread_count());
@@ -403,6 +417,21 @@ int main_augment(int argc, char** argv) {
                     min_coverage,
                     max_frac_n,
                     edges_only);
+        } else if (chunk_size > 0) {
+            // coverage is counted one chunk at a time instead of in a Packer
+            augment_chunked(graph.get(),
+                            gam_in_file_name,
+                            chunk_size,
+                            translation_file_name.empty() ? nullptr : &translation,
+                            gam_out_file_name,
+                            include_paths,
+                            include_paths,
+                            !include_softclips,
+                            is_subgraph,
+                            min_baseq,
+                            min_mapq,
+                            min_coverage,
+                            max_frac_n);
         } else {
             // much better to stream from a file so we can do two passes without storing in memory
             augment(graph.get(),
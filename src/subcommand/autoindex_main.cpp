@@ -3,7 +3,10 @@
  * Defines the "vg autoindex" subcommand, which produces indexes needed for other subcommands
  */
 #include <iostream>
+#include <fstream>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
 #include <algorithm>
 #include <cctype>
 #include <unistd.h>
@@ -16,8 +19,11 @@
 
 #include "subcommand.hpp"
 #include "index_registry.hpp"
+#include "index_partitions.hpp"
 #include "utility.hpp"
 
+#include <Fasta.h>
+
 using namespace std;
 using namespace vg;
 using namespace vg::subcommand;
@@ -96,6 +102,94 @@ pair<string, vector<string>> parse_provide_string(const string& str) {
     return return_val;
 }
 
+// Turn a contig name into something that can go in a file name
+string file_safe_name(const string& contig) {
+    string safe = contig;
+    for (char& c : safe) {
+        if (!isalnum(c) && c != '.' && c != '_' && c != '-') {
+            c = '_';
+        }
+    }
+    return safe;
+}
+
+// Copy each sequence of the FASTA files into its own FASTA file in the
+// directory, and return the (contig, file name) pairs
+vector<pair<string, string>> split_fasta_by_contig(const vector<string>& fasta_names, const string& directory) {
+    vector<pair<string, string>> contig_fastas;
+    for (auto& fasta_name : fasta_names) {
+        FastaReference ref;
+        ref.open(fasta_name);
+        for (const auto& idx_entry : *ref.index) {
+            const string& contig = idx_entry.first;
+            string filename = directory + "/" + to_string(contig_fastas.size()) + "." + file_safe_name(contig) + ".fa";
+            ofstream out(filename);
+            out << '>' << contig << '\n';
+            int64_t length = idx_entry.second.length;
+            int64_t line_length = max<int64_t>(idx_entry.second.line_blen, 1);
+            for (int64_t i = 0; i < length; i += line_length) {
+                out << ref.getSubSequence(contig, i, min(line_length, length - i)) << '\n';
+            }
+            if (!out) {
+                cerr << "error:[vg autoindex] could not write FASTA for contig " << contig << endl;
+                exit(1);
+            }
+            contig_fastas.emplace_back(contig, filename);
+        }
+    }
+    return contig_fastas;
+}
+
+// Copy the records of each contig in the VCFs into their own compressed VCFs
+// in the directory, and return the files for each contig
+unordered_map<string, vector<string>> split_vcf_by_contig(const vector<string>& vcf_names, const string& directory) {
+    unordered_map<string, vector<string>> contig_vcfs;
+    for (size_t i = 0; i < vcf_names.size(); ++i) {
+        htsFile* vcf = bcf_open(vcf_names[i].c_str(), "r");
+        if (!vcf) {
+            cerr << "error:[vg autoindex] failed to open VCF " << vcf_names[i] << endl;
+            exit(1);
+        }
+        bcf_hdr_t* header = bcf_hdr_read(vcf);
+        bcf1_t* vcf_rec = bcf_init();
+        // Output files are opened as each contig comes up
+        unordered_map<string, htsFile*> outputs;
+        int err_code;
+        while ((err_code = bcf_read(vcf, header, vcf_rec)) == 0) {
+            string contig = bcf_hdr_id2name(header, vcf_rec->rid);
+            auto found = outputs.find(contig);
+            if (found == outputs.end()) {
+                string filename = directory + "/" + to_string(i) + "." + file_safe_name(contig) + ".vcf.gz";
+                htsFile* out = bcf_open(filename.c_str(), "wz");
+                if (!out || bcf_hdr_write(out, header) != 0) {
+                    cerr << "error:[vg autoindex] could not write VCF for contig " << contig << endl;
+                    exit(1);
+                }
+                found = outputs.emplace(contig, out).first;
+                contig_vcfs[contig].push_back(filename);
+            }
+            if (bcf_write(found->second, header, vcf_rec) != 0) {
+                cerr << "error:[vg autoindex] could not write VCF for contig " << contig << endl;
+                exit(1);
+            }
+        }
+        if (err_code != -1) {
+            cerr << "error:[vg autoindex] failed to read from VCF " << vcf_names[i] << endl;
+            exit(1);
+        }
+        for (auto& output : outputs) {
+            if (hts_close(output.second) != 0) {
+                cerr << "error:[vg autoindex] could not finish VCF for contig " << output.first << endl;
+                exit(1);
+            }
+        }
+        bcf_destroy(vcf_rec);
+        bcf_hdr_destroy(header);
+        hts_close(vcf);
+    }
+    return contig_vcfs;
+}
+
 void help_autoindex(char** argv) {
     cerr
     << "usage: " << argv[0] << " autoindex [options]" << endl
@@ -116,8 +210,13 @@ void help_autoindex(char** argv) {
     << "    -a, --gff-tx-tag STR   GTF/GFF tag (in col. 9) for transcript ID (default: " << IndexingParameters::gff_transcript_tag << ")" << endl
     << "  logging and computation:" << endl
     << "    -T, --tmp-dir DIR      temporary directory to use for intermediate files" << endl
+    << "    -C, --cache-dir DIR    save finished indexes in DIR and reuse them on later runs" << endl
+    << "                           with the same inputs and parameters" << endl
     << "    -M, --target-mem MEM   target max memory usage (not exact, formatted INT[kMG])" << endl
     << "                           (default: 1/2 of available)" << endl
+    << "    --partition            build a separate set of giraffe indexes for each contig of -r,"  << endl
+    << "                           listed in PREFIX.partitions, so mapping only needs one set in"  << endl
+    << "                           memory at a time (see vg giraffe --partition-list)" << endl
 // TODO: hiding this now that we have rewinding options, since detailed args aren't really in the spirit of this subcommand
 //    << "    --gbwt-buffer-size NUM GBWT construction buffer size in millions of nodes; may need to be" << endl
 //    << "                           increased for graphs with long haplotypes (default: " << IndexingParameters::gbwt_insert_batch_size / gbwt::MILLION << ")" << endl
@@ -140,6 +239,7 @@ int main_autoindex(int argc, char** argv) {
 #define OPT_FORCE_PHASED 1002
 #define OPT_GBWT_BUFFER_SIZE 1003
 #define OPT_GCSA_SIZE_LIMIT 1004
+#define OPT_PARTITION 1005
     
     // load the registry
     IndexRegistry registry = VGIndexes::get_vg_index_registry();
@@ -152,6 +252,15 @@ int main_autoindex(int argc, char** argv) {
     
     string gfa_name;
     
+    // For building partitioned indexes, we need to remember the inputs and
+    // settings to give to each partition's registry
+    bool partition = false;
+    vector<string> fasta_names;
+    string ins_fasta_name;
+    string cache_dir;
+    bool keep_intermediate = false;
+    bool other_inputs = false;
+    
     int c;
     optind = 2; // force optind past command positional argument
     while (true) {
@@ -173,6 +282,7 @@ int main_autoindex(int argc, char** argv) {
             {"gbwt-buffer-size", required_argument, 0, OPT_GBWT_BUFFER_SIZE},
             {"gcsa-size-limit", required_argument, 0, OPT_GCSA_SIZE_LIMIT},
             {"tmp-dir", required_argument, 0, 'T'},
+            {"cache-dir", required_argument, 0, 'C'},
             {"threads", required_argument, 0, 't'},
             {"verbosity", required_argument, 0, 'V'},
             {"dot", no_argument, 0, 'd'},
@@ -180,11 +290,12 @@ int main_autoindex(int argc, char** argv) {
             {"keep-intermediate", no_argument, 0, OPT_KEEP_INTERMEDIATE},
             {"force-unphased", no_argument, 0, OPT_FORCE_UNPHASED},
             {"force-phased", no_argument, 0, OPT_FORCE_PHASED},
+            {"partition", no_argument, 0, OPT_PARTITION},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "p:w:r:v:i:g:x:H:a:P:R:f:M:T:t:dV:h",
+        c = getopt_long (argc, argv, "p:w:r:v:i:g:x:H:a:P:R:f:M:T:C:t:dV:h",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -224,21 +335,25 @@ int main_autoindex(int argc, char** argv) {
                 break;
             case 'r':
                 registry.provide("Reference FASTA", optarg);
+                fasta_names.push_back(optarg);
                 break;
             case 'v':
                 vcf_names.push_back(optarg);
                 break;
             case 'i':
                 registry.provide("Insertion Sequence FASTA", optarg);
+                ins_fasta_name = optarg;
                 break;
             case 'g':
                 gfa_name = optarg;
                 break;
             case 'x':
                 registry.provide("GTF/GFF", optarg);
+                other_inputs = true;
                 break;
             case 'H':
                 registry.provide("Haplotype GTF/GFF", optarg);
+                other_inputs = true;
                 break;
             case 'f':
                 IndexingParameters::gff_feature_name = optarg;
@@ -250,6 +365,7 @@ int main_autoindex(int argc, char** argv) {
             {
                 auto parsed = parse_provide_string(optarg);
                 registry.provide(parsed.first, parsed.second);
+                other_inputs = true;
                 break;
             }
             case 'R':
@@ -264,6 +380,10 @@ int main_autoindex(int argc, char** argv) {
             case 'T':
                 temp_file::set_dir(optarg);
                 break;
+            case 'C':
+                registry.set_cache_directory(optarg);
+                cache_dir = optarg;
+                break;
             case 't':
                 omp_set_num_threads(parse<int>(optarg));
                 break;
@@ -282,6 +402,7 @@ int main_autoindex(int argc, char** argv) {
                 break;
             case OPT_KEEP_INTERMEDIATE:
                 registry.set_intermediate_file_keeping(true);
+                keep_intermediate = true;
                 break;
             case OPT_FORCE_UNPHASED:
                 force_unphased = true;
@@ -292,6 +413,9 @@ int main_autoindex(int argc, char** argv) {
             case OPT_GCSA_SIZE_LIMIT:
                 IndexingParameters::gcsa_size_limit = parse<int64_t>(optarg);
                 break;
+            case OPT_PARTITION:
+                partition = true;
+                break;
             case 'h':
                 help_autoindex(argv);
                 return 0;
@@ -312,23 +436,85 @@ int main_autoindex(int argc, char** argv) {
     
     // we have special logic for VCFs to make it friendly to both phased
     // and unphased VCF files
-    if (!vcf_names.empty()) {
-        // we interpret it as a phased VCF if any of the VCFs have phasing
-        bool phased = force_phased;
-        if (!force_unphased) {
-            for (size_t i = 0; i < vcf_names.size() && !phased; ++i) {
-                phased = IndexRegistry::vcf_is_phased(vcf_names[i]);
+    // we interpret it as a phased VCF if any of the VCFs have phasing
+    bool phased = force_phased;
+    if (!force_unphased) {
+        for (size_t i = 0; i < vcf_names.size() && !phased; ++i) {
+            phased = IndexRegistry::vcf_is_phased(vcf_names[i]);
+        }
+    }
+    string vcf_index_name = phased ? "VCF w/ Phasing" : "VCF";
+    
+    if (partition) {
+        // build the giraffe indexes for each contig separately
+        if (fasta_names.empty() || !gfa_name.empty() || other_inputs || print_dot) {
+            cerr << "error:[vg autoindex] Partitioned indexes (--partition) are built from only FASTA (-r), VCF (-v), and insertion FASTA (-i) inputs" << endl;
+            return 1;
+        }
+        auto giraffe_targets = VGIndexes::get_default_giraffe_indexes();
+        sort(giraffe_targets.begin(), giraffe_targets.end());
+        for (auto& target : targets) {
+            if (!binary_search(giraffe_targets.begin(), giraffe_targets.end(), target)) {
+                cerr << "error:[vg autoindex] Partitioned indexes (--partition) can only be built for the giraffe workflow" << endl;
+                return 1;
             }
         }
         
-        for (auto& vcf_name : vcf_names) {
-            if (phased) {
-                registry.provide("VCF w/ Phasing", vcf_name);
+        string prefix = registry.get_prefix();
+        string split_dir = temp_file::create_directory();
+        auto contig_fastas = split_fasta_by_contig(fasta_names, split_dir);
+        auto contig_vcfs = split_vcf_by_contig(vcf_names, split_dir);
+        
+        vector<IndexPartition> partitions;
+        unordered_set<string> used_names;
+        for (auto& contig_fasta : contig_fastas) {
+            const string& contig = contig_fasta.first;
+            string name = file_safe_name(contig);
+            if (used_names.count(name)) {
+                name += "_" + to_string(partitions.size());
             }
-            else {
-                registry.provide("VCF", vcf_name);
+            used_names.insert(name);
+            if (IndexingParameters::verbosity >= IndexingParameters::Basic) {
+                cerr << "[vg autoindex] Building partition " << name << " for contig " << contig << endl;
             }
+            
+            IndexRegistry partition_registry = VGIndexes::get_vg_index_registry();
+            partition_registry.set_prefix(prefix + "." + name);
+            if (!cache_dir.empty()) {
+                partition_registry.set_cache_directory(cache_dir);
+            }
+            partition_registry.set_intermediate_file_keeping(keep_intermediate);
+            partition_registry.set_target_memory_usage(target_mem_usage);
+            partition_registry.provide("Reference FASTA", contig_fasta.second);
+            if (!ins_fasta_name.empty()) {
+                partition_registry.provide("Insertion Sequence FASTA", ins_fasta_name);
+            }
+            auto found = contig_vcfs.find(contig);
+            if (found != contig_vcfs.end()) {
+                partition_registry.provide(vcf_index_name, found->second);
+            }
+            
+            try {
+                partition_registry.make_indexes(giraffe_targets);
+            }
+            catch (InsufficientInputException ex) {
+                cerr << "error:[vg autoindex] Input is not sufficient to create indexes for contig " << contig << endl;
+                cerr << ex.what();
+                return 1;
+            }
+            partitions.push_back({name,
+                                  partition_registry.require("Giraffe GBZ").at(0),
+                                  partition_registry.require("Minimizers").at(0),
+                                  partition_registry.require("Giraffe Distance Index").at(0)});
         }
+        temp_file::remove(split_dir);
+        
+        write_partition_list(prefix + ".partitions", partitions);
+        return 0;
+    }
+    
+    for (auto& vcf_name : vcf_names) {
+        registry.provide(vcf_index_name, vcf_name);
     }
     
     if (!gfa_name.empty()) {
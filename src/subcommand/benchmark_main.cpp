@@ -7,15 +7,39 @@
 #include <unistd.h>
 #include <getopt.h>
 
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <sstream>
 
 #include "subcommand.hpp"
 
 #include "../benchmark.hpp"
 #include "../version.hpp"
+#include "../alignment.hpp"
+#include "../utility.hpp"
+#include "../hash_map.hpp"
+#include "../hts_alignment_emitter.hpp"
 
 #include "../gbwt_extender.hpp"
 #include "../gbwt_helper.hpp"
+#include "../algorithms/chain_items.hpp"
+#include "../integrated_snarl_finder.hpp"
+#include "../memoizing_graph.hpp"
+#include "../minimizer_mapper.hpp"
+#include "../null_masking_graph.hpp"
+#include "../snarl_distance_index.hpp"
+#include "../subgraph_overlay.hpp"
+
+#include <bdsg/hash_graph.hpp>
+#include <bdsg/packed_graph.hpp>
+#include <bdsg/overlays/path_position_overlays.hpp>
+#include <gbwtgraph/gbz.h>
+#include <vg/io/alignment_emitter.hpp>
+#include <vg/io/alignment_io.hpp>
+#include <vg/io/stream.hpp>
+#include <vg/io/vpkg.hpp>
+#include <xg.hpp>
 
 
 
@@ -26,12 +50,593 @@ using namespace vg::subcommand;
 void help_benchmark(char** argv) {
     cerr << "usage: " << argv[0] << " benchmark [options] >report.tsv" << endl
          << "options:" << endl
-         << "    -p, --progress         show progress" << endl;
+         << "    -p, --progress         show progress" << endl
+         << "    -c, --counters         also report hardware performance counters per test run (Linux only)" << endl
+         << "    -t, --threads INT      run parallel benchmarks on 1, 2, 4, ... up to this many threads [all available]" << endl
+         << "handle graph benchmarks (use -c to also count cache misses):" << endl
+         << "    -H, --handle-graphs    benchmark graph operations in each HandleGraph backend and overlay" << endl
+         << "alignment I/O benchmarks:" << endl
+         << "    -I, --io               benchmark writing and reading GAM, GAF, SAM, and BAM" << endl
+         << "    -r, --io-reads INT     on this many synthetic reads [100000]" << endl
+         << "mapping stage benchmarks (all of -Z, -m, -d, and -f are needed):" << endl
+         << "    -Z, --gbz-name FILE    benchmark Giraffe stages on this GBZ graph" << endl
+         << "    -m, --minimizer-name FILE  and this minimizer index" << endl
+         << "    -d, --dist-name FILE   and this distance index" << endl
+         << "    -f, --fastq-in FILE    with reads from this FASTQ" << endl
+         << "    -n, --max-reads INT    use at most this many reads [1000]" << endl
+         << "    -i, --iterations INT   run each stage over all the reads this many times [5]" << endl;
+}
+
+/// Child class of MinimizerMapper that lets us run its stages one at a time.
+class StageBenchmarkMapper : public MinimizerMapper {
+public:
+    using MinimizerMapper::MinimizerMapper;
+    using MinimizerMapper::Cluster;
+    using MinimizerMapper::clusterer;
+    using MinimizerMapper::find_minimizers;
+    using MinimizerMapper::find_seeds;
+    using MinimizerMapper::score_cluster;
+    using MinimizerMapper::extend_cluster;
+    using MinimizerMapper::to_anchors;
+};
+
+/**
+ * Benchmark each stage of Giraffe mapping separately on the given reads, and
+ * also whole-read mapping, and add the results to the given vector. Each
+ * benchmark run processes every read once, starting from the saved outputs
+ * of the stages before it.
+ */
+void benchmark_mapping_stages(const gbwtgraph::GBZ& gbz, const gbwtgraph::DefaultMinimizerIndex& minimizer_index,
+                              SnarlDistanceIndex& distance_index, const vector<Alignment>& reads,
+                              size_t iterations, vector<BenchmarkResult>& results) {
+    
+    StageBenchmarkMapper mapper(gbz.graph, minimizer_index, &distance_index);
+    // We aren't tracking anything, so one Funnel can be shared by everything.
+    Funnel funnel;
+    
+    // Compute the input for each stage from the stage before it.
+    vector<vector<MinimizerMapper::Minimizer>> minimizers(reads.size());
+    vector<vector<MinimizerMapper::Seed>> seeds(reads.size());
+    vector<vector<StageBenchmarkMapper::Cluster>> clusters(reads.size());
+    vector<vector<algorithms::Anchor>> anchors(reads.size());
+    // For each read, for each cluster, the indexes of its anchors to chain.
+    vector<vector<vector<size_t>>> chain_problems(reads.size());
+    for (size_t i = 0; i < reads.size(); i++) {
+        minimizers[i] = mapper.find_minimizers(reads[i].sequence(), funnel);
+        seeds[i] = mapper.find_seeds(minimizers[i], reads[i], funnel);
+        clusters[i] = mapper.clusterer.cluster_seeds(seeds[i], mapper.get_distance_limit(reads[i].sequence().size()));
+        for (size_t j = 0; j < clusters[i].size(); j++) {
+            mapper.score_cluster(clusters[i][j], j, minimizers[i], seeds[i], reads[i].sequence().size(), funnel);
+        }
+        anchors[i] = mapper.to_anchors(reads[i], minimizers[i], seeds[i]);
+        for (auto& cluster : clusters[i]) {
+            chain_problems[i].push_back(cluster.seeds);
+            algorithms::sort_and_shadow(anchors[i], chain_problems[i].back());
+        }
+    }
+    
+    string suffix = " on " + std::to_string(reads.size()) + " reads";
+    
+    results.push_back(run_benchmark("find_minimizers()" + suffix, iterations, [&]() {
+        for (auto& read : reads) {
+            auto found = mapper.find_minimizers(read.sequence(), funnel);
+        }
+    }));
+    
+    results.push_back(run_benchmark("find_seeds()" + suffix, iterations, [&]() {
+        for (size_t i = 0; i < reads.size(); i++) {
+            auto found = mapper.find_seeds(minimizers[i], reads[i], funnel);
+        }
+    }));
+    
+    results.push_back(run_benchmark("cluster_seeds()" + suffix, iterations, [&]() {
+        for (size_t i = 0; i < reads.size(); i++) {
+            auto found = mapper.clusterer.cluster_seeds(seeds[i], mapper.get_distance_limit(reads[i].sequence().size()));
+        }
+    }));
+    
+    results.push_back(run_benchmark("minimum_distance() between consecutive seeds" + suffix, iterations, [&]() {
+        for (size_t i = 0; i < reads.size(); i++) {
+            for (size_t j = 1; j < seeds[i].size(); j++) {
+                size_t distance = minimum_distance(distance_index, seeds[i][j - 1].pos, seeds[i][j].pos, false, &gbz.graph);
+            }
+        }
+    }));
+    
+    results.push_back(run_benchmark("extend_cluster() on all clusters" + suffix, iterations, [&]() {
+        for (size_t i = 0; i < reads.size(); i++) {
+            GaplessExtensionCache extension_cache(gbz.graph, mapper.extension_cache_records);
+            vector<vector<size_t>> minimizer_kept_cluster_count;
+            for (size_t j = 0; j < clusters[i].size(); j++) {
+                auto extensions = mapper.extend_cluster(clusters[i][j], j, minimizers[i], seeds[i], reads[i].sequence(),
+                                                        extension_cache, minimizer_kept_cluster_count, funnel);
+            }
+        }
+    }));
+    
+    results.push_back(run_benchmark("find_best_chain() on all clusters" + suffix, iterations, [&]() {
+        for (size_t i = 0; i < reads.size(); i++) {
+            for (auto& problem : chain_problems[i]) {
+                VectorView<algorithms::Anchor> to_chain {anchors[i], problem};
+                auto chain = algorithms::find_best_chain(to_chain, distance_index, gbz.graph, 6, 1,
+                                                         mapper.max_lookback_bases,
+                                                         mapper.min_lookback_items,
+                                                         mapper.lookback_item_hard_cap,
+                                                         mapper.initial_lookback_threshold,
+                                                         mapper.lookback_scale_factor,
+                                                         mapper.min_good_transition_score_per_base,
+                                                         mapper.item_bonus,
+                                                         mapper.max_indel_bases,
+                                                         mapper.batch_chaining_transitions);
+            }
+        }
+    }));
+    
+    // Whole-read mapping includes the alignment stages, which need all the
+    // earlier ones to have run. Mapping can modify the read, so work on copies.
+    results.push_back(run_benchmark("map_from_extensions()" + suffix, iterations, [&]() {
+        for (auto& read : reads) {
+            Alignment aln = read;
+            auto mapped = mapper.map_from_extensions(aln);
+        }
+    }));
+    
+    results.push_back(run_benchmark("map_from_chains()" + suffix, iterations, [&]() {
+        for (auto& read : reads) {
+            Alignment aln = read;
+            auto mapped = mapper.map_from_chains(aln);
+        }
+    }));
+}
+
+/**
+ * Benchmark filling a hash table of the given type with the given keys, and
+ * then looking each key up along with a missing key for each, and add the
+ * results to the given vector.
+ */
+template<typename Table, typename Key>
+void benchmark_hash_table(const string& table_name, const vector<Key>& keys, const vector<Key>& missing_keys,
+                          vector<BenchmarkResult>& results) {
+    string suffix = " on " + std::to_string(keys.size()) + " keys in " + table_name;
+    
+    results.push_back(run_benchmark("hash table insert" + suffix, 10, [&]() {
+        Table table;
+        for (size_t i = 0; i < keys.size(); i++) {
+            table[keys[i]] = i;
+        }
+        assert(table.size() <= keys.size());
+    }));
+    
+    Table table;
+    for (size_t i = 0; i < keys.size(); i++) {
+        table[keys[i]] = i;
+    }
+    results.push_back(run_benchmark("hash table lookup" + suffix, 10, [&]() {
+        size_t found = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            found += table.count(keys[i]);
+            found += table.count(missing_keys[i]);
+        }
+        assert(found >= keys.size());
+    }));
+}
+
+/**
+ * Benchmark the basic HandleGraph operations on every node of the given
+ * graph, and add the results to the given vector. Parallel iteration uses the
+ * given number of threads.
+ */
+void benchmark_handle_graph(const string& graph_name, const HandleGraph& graph, size_t threads,
+                            vector<BenchmarkResult>& results) {
+    
+    string suffix = " on " + std::to_string(graph.get_node_count()) + " nodes in " + graph_name;
+    vector<handle_t> handles;
+    handles.reserve(graph.get_node_count());
+    graph.for_each_handle([&](const handle_t& h) {
+        handles.push_back(h);
+    });
+    
+    results.push_back(run_benchmark("for_each_handle()" + suffix, 10, [&]() {
+        size_t seen = 0;
+        graph.for_each_handle([&](const handle_t& h) {
+            seen++;
+        });
+        assert(seen == handles.size());
+    }));
+    
+    omp_set_num_threads(threads);
+    results.push_back(run_benchmark("parallel for_each_handle() on " + std::to_string(threads) + " threads" + suffix, 10, [&]() {
+        atomic<size_t> seen(0);
+        graph.for_each_handle([&](const handle_t& h) {
+            seen++;
+        }, true);
+        assert(seen == handles.size());
+    }));
+    omp_set_num_threads(1);
+    
+    results.push_back(run_benchmark("follow_edges() both ways" + suffix, 10, [&]() {
+        size_t edges = 0;
+        for (const handle_t& h : handles) {
+            for (bool go_left : {false, true}) {
+                graph.follow_edges(h, go_left, [&](const handle_t& next) {
+                    edges++;
+                });
+            }
+        }
+        assert(edges > 0);
+    }));
+    
+    results.push_back(run_benchmark("get_sequence()" + suffix, 10, [&]() {
+        size_t length = 0;
+        for (const handle_t& h : handles) {
+            length += graph.get_sequence(h).size();
+        }
+        assert(length >= handles.size());
+    }));
+}
+
+/**
+ * Benchmark finding the path steps on every node of the given graph, and, if
+ * it has positions, looking up step positions along the given path, and add
+ * the results to the given vector.
+ */
+void benchmark_path_handle_graph(const string& graph_name, const PathHandleGraph& graph, const string& path_name,
+                                 vector<BenchmarkResult>& results) {
+    
+    string suffix = " in " + graph_name;
+    vector<handle_t> handles;
+    graph.for_each_handle([&](const handle_t& h) {
+        handles.push_back(h);
+    });
+    
+    results.push_back(run_benchmark("steps_of_handle() on " + std::to_string(handles.size()) + " nodes" + suffix, 10, [&]() {
+        size_t steps = 0;
+        for (const handle_t& h : handles) {
+            steps += graph.steps_of_handle(h).size();
+        }
+        assert(steps > 0);
+    }));
+    
+    const PathPositionHandleGraph* position_graph = dynamic_cast<const PathPositionHandleGraph*>(&graph);
+    if (position_graph == nullptr) {
+        return;
+    }
+    path_handle_t path = graph.get_path_handle(path_name);
+    vector<step_handle_t> steps;
+    graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+        steps.push_back(step);
+    });
+    size_t path_length = position_graph->get_path_length(path);
+    
+    results.push_back(run_benchmark("get_position_of_step() on " + std::to_string(steps.size()) + " steps" + suffix, 10, [&]() {
+        size_t total = 0;
+        for (const step_handle_t& step : steps) {
+            total += position_graph->get_position_of_step(step);
+        }
+        assert(steps.size() < 2 || total > 0);
+    }));
+    
+    // Look up positions scattered along the path
+    vector<size_t> positions;
+    uint32_t bits = 0xcafebebe;
+    for (size_t i = 0; i < steps.size(); i++) {
+        bits = (bits * 73 + 1375) % 477218579;
+        positions.push_back(bits % path_length);
+    }
+    results.push_back(run_benchmark("get_step_at_position() on " + std::to_string(positions.size()) + " positions" + suffix, 10, [&]() {
+        for (const size_t& position : positions) {
+            step_handle_t step = position_graph->get_step_at_position(path, position);
+            assert(step != position_graph->path_end(path));
+        }
+    }));
+}
+
+/**
+ * Build the same graph of SNP bubbles, with a reference path and some
+ * haplotypes through it, in each HandleGraph backend and under each overlay,
+ * and benchmark them all, adding the results to the given vector.
+ */
+void benchmark_handle_graphs(size_t threads, bool show_progress, vector<BenchmarkResult>& results) {
+    
+    size_t bubble_count = 30000;
+    size_t node_length = 32;
+    size_t haplotype_count = 8;
+    
+    if (show_progress) {
+        cerr << "Building graphs for handle graph benchmarks" << endl;
+    }
+    
+    // Each bubble is a reference node followed by two alleles. Each haplotype
+    // visits each reference node and one of the alleles.
+    bdsg::HashGraph hash_graph;
+    gbwtgraph::SequenceSource source;
+    vector<gbwt::vector_type> haplotypes(haplotype_count);
+    path_handle_t ref_path = hash_graph.create_path_handle("ref");
+    vector<path_handle_t> haplotype_paths;
+    for (size_t i = 0; i < haplotype_count; i++) {
+        haplotype_paths.push_back(hash_graph.create_path_handle("hap" + std::to_string(i)));
+    }
+    
+    uint32_t bits = 0xcafebebe;
+    auto step_rng = [&bits]() {
+        bits = (bits * 73 + 1375) % 477218579;
+    };
+    nid_t next_id = 1;
+    handle_t previous_ref, previous_alt;
+    for (size_t i = 0; i < bubble_count; i++) {
+        string sequence;
+        for (size_t j = 0; j < node_length; j++) {
+            sequence.push_back("ACGT"[bits & 0x3]);
+            step_rng();
+        }
+        handle_t anchor = hash_graph.create_handle(sequence, next_id);
+        source.add_node(next_id, sequence);
+        next_id++;
+        if (i > 0) {
+            hash_graph.create_edge(previous_ref, anchor);
+            hash_graph.create_edge(previous_alt, anchor);
+        }
+        
+        // Add the alleles
+        string ref_base(1, "ACGT"[bits & 0x3]);
+        string alt_base(1, "ACGT"[(bits + 1) & 0x3]);
+        step_rng();
+        previous_ref = hash_graph.create_handle(ref_base, next_id);
+        source.add_node(next_id, ref_base);
+        next_id++;
+        previous_alt = hash_graph.create_handle(alt_base, next_id);
+        source.add_node(next_id, alt_base);
+        next_id++;
+        hash_graph.create_edge(anchor, previous_ref);
+        hash_graph.create_edge(anchor, previous_alt);
+        
+        hash_graph.append_step(ref_path, anchor);
+        hash_graph.append_step(ref_path, previous_ref);
+        for (size_t j = 0; j < haplotype_count; j++) {
+            handle_t allele = (bits >> j) & 0x1 ? previous_alt : previous_ref;
+            hash_graph.append_step(haplotype_paths[j], anchor);
+            hash_graph.append_step(haplotype_paths[j], allele);
+            haplotypes[j].push_back(gbwt::Node::encode(hash_graph.get_id(anchor), false));
+            haplotypes[j].push_back(gbwt::Node::encode(hash_graph.get_id(allele), false));
+        }
+        step_rng();
+    }
+    
+    bdsg::PackedGraph packed_graph;
+    handlealgs::copy_path_handle_graph(&hash_graph, &packed_graph);
+    bdsg::PackedPositionOverlay packed_positions(&packed_graph);
+    xg::XG xg_graph;
+    xg_graph.from_path_handle_graph(hash_graph);
+    gbwt::GBWT gbwt_index = get_gbwt(haplotypes);
+    gbwtgraph::GBWTGraph gbwt_graph(gbwt_index, source);
+    
+    MemoizingGraph memoizing(&xg_graph);
+    unordered_set<nid_t> all_nodes;
+    xg_graph.for_each_handle([&](const handle_t& h) {
+        all_nodes.insert(xg_graph.get_id(h));
+    });
+    SubgraphOverlay subgraph(&xg_graph, &all_nodes);
+    NullMaskingGraph null_masking(&xg_graph);
+    
+    if (show_progress) {
+        cerr << "Benchmarking handle graph backends" << endl;
+    }
+    benchmark_handle_graph("HashGraph", hash_graph, threads, results);
+    benchmark_handle_graph("PackedGraph", packed_graph, threads, results);
+    benchmark_handle_graph("XG", xg_graph, threads, results);
+    benchmark_handle_graph("GBWTGraph", gbwt_graph, threads, results);
+    benchmark_handle_graph("MemoizingGraph over XG", memoizing, threads, results);
+    benchmark_handle_graph("SubgraphOverlay of all of XG", subgraph, threads, results);
+    benchmark_handle_graph("NullMaskingGraph over XG", null_masking, threads, results);
+    
+    benchmark_path_handle_graph("HashGraph", hash_graph, "ref", results);
+    benchmark_path_handle_graph("PackedGraph", packed_graph, "ref", results);
+    benchmark_path_handle_graph("PackedPositionOverlay over PackedGraph", packed_positions, "ref", results);
+    benchmark_path_handle_graph("XG", xg_graph, "ref", results);
+    benchmark_path_handle_graph("MemoizingGraph over XG", memoizing, "ref", results);
+}
+
+/**
+ * Benchmark encoding and decoding alignments, and writing and reading them
+ * through the alignment emitters and parsers, in each alignment format on
+ * 1, 2, 4, ... up to max_threads threads, and add the results to the given
+ * vector. The alignments are synthetic reads along the reference path of a
+ * synthetic linear graph, so they can be written as SAM and BAM without
+ * surjection. The size of each file is reported in the name of the benchmark
+ * that reads it back.
+ */
+void benchmark_alignment_io(size_t read_count, size_t max_threads, bool show_progress, vector<BenchmarkResult>& results) {
+    
+    // Make a linear graph with a reference path through it
+    size_t node_count = 10000;
+    size_t node_length = 32;
+    bdsg::HashGraph built;
+    path_handle_t built_path = built.create_path_handle("ref");
+    uint32_t bits = 0xcafebebe;
+    auto step_rng = [&bits]() {
+        bits = (bits * 73 + 1375) % 477218579;
+    };
+    for (size_t i = 0; i < node_count; i++) {
+        string sequence;
+        for (size_t j = 0; j < node_length; j++) {
+            sequence.push_back("ACGT"[bits & 0x3]);
+            step_rng();
+        }
+        handle_t h = built.create_handle(sequence, i + 1);
+        if (i > 0) {
+            built.create_edge(built.get_handle(i, false), h);
+        }
+        built.append_step(built_path, h);
+    }
+    // HTSlib output needs path positions
+    xg::XG graph;
+    graph.from_path_handle_graph(built);
+    path_handle_t ref_path = graph.get_path_handle("ref");
+    size_t ref_length = graph.get_path_length(ref_path);
+    vector<tuple<path_handle_t, size_t, size_t>> paths {make_tuple(ref_path, ref_length, ref_length)};
+    
+    // Make reads along the path, each with a mismatch
+    size_t read_length = 150;
+    vector<Alignment> alignments(read_count);
+    for (size_t i = 0; i < read_count; i++) {
+        Alignment& aln = alignments[i];
+        aln.set_name("read" + std::to_string(i));
+        size_t start = bits % (ref_length - read_length);
+        step_rng();
+        size_t mismatch = bits % read_length;
+        step_rng();
+        
+        size_t offset = start;
+        size_t rank = 1;
+        while (offset < start + read_length) {
+            nid_t node_id = offset / node_length + 1;
+            size_t node_offset = offset % node_length;
+            size_t length = std::min(node_length - node_offset, start + read_length - offset);
+            string node_sequence = graph.get_sequence(graph.get_handle(node_id)).substr(node_offset, length);
+            
+            Mapping* mapping = aln.mutable_path()->add_mapping();
+            mapping->mutable_position()->set_node_id(node_id);
+            mapping->mutable_position()->set_offset(node_offset);
+            mapping->set_rank(rank++);
+            // Match up to the mismatch, if it is on this node, and then after it
+            size_t read_offset = offset - start;
+            if (mismatch >= read_offset && mismatch < read_offset + length) {
+                size_t before = mismatch - read_offset;
+                char replacement = node_sequence[before] == 'A' ? 'C' : 'A';
+                if (before > 0) {
+                    Edit* edit = mapping->add_edit();
+                    edit->set_from_length(before);
+                    edit->set_to_length(before);
+                }
+                Edit* edit = mapping->add_edit();
+                edit->set_from_length(1);
+                edit->set_to_length(1);
+                edit->set_sequence(string(1, replacement));
+                if (before + 1 < length) {
+                    edit = mapping->add_edit();
+                    edit->set_from_length(length - before - 1);
+                    edit->set_to_length(length - before - 1);
+                }
+                node_sequence[before] = replacement;
+            } else {
+                Edit* edit = mapping->add_edit();
+                edit->set_from_length(length);
+                edit->set_to_length(length);
+            }
+            *aln.mutable_sequence() += node_sequence;
+            offset += length;
+        }
+        
+        string quality;
+        for (size_t j = 0; j < read_length; j++) {
+            quality.push_back(30 + (bits % 11));
+            step_rng();
+        }
+        aln.set_quality(quality);
+        aln.set_mapping_quality(60);
+        aln.set_score(read_length - 5);
+        aln.set_identity((read_length - 1) / (double) read_length);
+        Position* refpos = aln.add_refpos();
+        refpos->set_name("ref");
+        refpos->set_offset(start);
+    }
+    
+    string suffix = " for " + std::to_string(read_count) + " reads";
+    
+    // Encoding and decoding in memory, on one thread
+    vector<string> encoded(read_count);
+    results.push_back(run_benchmark("encode GAM records" + suffix, 3, [&]() {
+        for (size_t i = 0; i < read_count; i++) {
+            alignments[i].SerializeToString(&encoded[i]);
+        }
+    }));
+    results.push_back(run_benchmark("decode GAM records" + suffix, 3, [&]() {
+        Alignment aln;
+        for (size_t i = 0; i < read_count; i++) {
+            aln.ParseFromString(encoded[i]);
+        }
+    }));
+    results.push_back(run_benchmark("encode GAF records" + suffix, 3, [&]() {
+        stringstream out;
+        for (size_t i = 0; i < read_count; i++) {
+            out << vg::io::alignment_to_gaf(graph, alignments[i]) << "\n";
+        }
+    }));
+    
+    // Each format to write, with the HTSlib compression level, or -1 for not applicable
+    vector<pair<string, int>> outputs {{"GAM", -1}, {"GAF", -1}, {"SAM", -1}, {"BAM", 1}, {"BAM", 6}, {"BAM", 9}};
+    int default_level = HTSWriter::compression_level;
+    string filename = temp_file::create();
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        string thread_suffix = suffix + " on " + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+        for (auto& output : outputs) {
+            const string& format = output.first;
+            string description = format + (output.second >= 0 ? " at level " + std::to_string(output.second) : "");
+            if (show_progress) {
+                cerr << "Benchmarking " << description << " I/O" << thread_suffix << endl;
+            }
+            HTSWriter::compression_level = output.second >= 0 ? output.second : default_level;
+            
+            results.push_back(run_benchmark("write " + description + thread_suffix, 3, [&]() {
+                auto emitter = get_alignment_emitter(filename, format, paths, threads, &graph,
+                                                     ALIGNMENT_EMITTER_FLAG_HTS_RAW);
+#pragma omp parallel for num_threads(threads) schedule(static, 256)
+                for (size_t i = 0; i < read_count; i++) {
+                    Alignment copy = alignments[i];
+                    emitter->emit_single(std::move(copy));
+                }
+                // Destroying the emitter flushes the file
+            }));
+            
+            size_t file_size;
+            {
+                ifstream in(filename, ios::binary | ios::ate);
+                file_size = in.tellg();
+            }
+            
+            omp_set_num_threads(threads);
+            results.push_back(run_benchmark("read " + description + " (" + std::to_string(file_size) + " bytes)" + thread_suffix, 3, [&]() {
+                atomic<size_t> read_back(0);
+                auto count = [&](Alignment& aln) {
+                    read_back++;
+                };
+                if (format == "GAM") {
+                    ifstream in(filename);
+                    vg::io::for_each_parallel<Alignment>(in, count);
+                } else if (format == "GAF") {
+                    vg::io::gaf_unpaired_for_each_parallel(graph, filename, count);
+                } else {
+                    hts_for_each_parallel(filename, count, &graph);
+                }
+                assert(read_back == read_count);
+            }));
+            omp_set_num_threads(1);
+        }
+    }
+    HTSWriter::compression_level = default_level;
+    temp_file::remove(filename);
 }
 
 int main_benchmark(int argc, char** argv) {
 
     bool show_progress = false;
+    bool use_counters = false;
+    
+    // Should we benchmark HandleGraph implementations?
+    bool handle_graph_benchmarks = false;
+    
+    // Should we benchmark alignment I/O, and how much?
+    bool io_benchmarks = false;
+    size_t io_reads = 100000;
+    size_t max_threads = get_thread_count();
+    
+    // What real data should we benchmark mapping stages on, if any?
+    string gbz_name;
+    string minimizer_name;
+    string distance_name;
+    string fastq_name;
+    size_t max_reads = 1000;
+    size_t stage_iterations = 5;
     
     // Which experiments should we run?
     bool sort_and_order_experiment = false;
@@ -43,12 +648,23 @@ int main_benchmark(int argc, char** argv) {
         static struct option long_options[] =
             {
                 {"progress",  no_argument, 0, 'p'},
+                {"counters",  no_argument, 0, 'c'},
+                {"handle-graphs", no_argument, 0, 'H'},
+                {"io", no_argument, 0, 'I'},
+                {"io-reads", required_argument, 0, 'r'},
+                {"threads", required_argument, 0, 't'},
+                {"gbz-name", required_argument, 0, 'Z'},
+                {"minimizer-name", required_argument, 0, 'm'},
+                {"dist-name", required_argument, 0, 'd'},
+                {"fastq-in", required_argument, 0, 'f'},
+                {"max-reads", required_argument, 0, 'n'},
+                {"iterations", required_argument, 0, 'i'},
                 {"help", no_argument, 0, 'h'},
                 {0, 0, 0, 0}
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "ph?",
+        c = getopt_long (argc, argv, "pcHIr:t:Z:m:d:f:n:i:h?",
                          long_options, &option_index);
 
         /* Detect the end of the options. */
@@ -62,6 +678,50 @@ int main_benchmark(int argc, char** argv) {
             show_progress = true;
             break;
             
+        case 'c':
+            use_counters = true;
+            break;
+            
+        case 'H':
+            handle_graph_benchmarks = true;
+            break;
+            
+        case 'I':
+            io_benchmarks = true;
+            break;
+            
+        case 'r':
+            io_reads = parse<size_t>(optarg);
+            break;
+            
+        case 't':
+            max_threads = parse<size_t>(optarg);
+            break;
+            
+        case 'Z':
+            gbz_name = optarg;
+            break;
+            
+        case 'm':
+            minimizer_name = optarg;
+            break;
+            
+        case 'd':
+            distance_name = optarg;
+            break;
+            
+        case 'f':
+            fastq_name = optarg;
+            break;
+            
+        case 'n':
+            max_reads = parse<size_t>(optarg);
+            break;
+            
+        case 'i':
+            stage_iterations = parse<size_t>(optarg);
+            break;
+            
         case 'h':
         case '?':
             /* getopt_long already printed an error message. */
@@ -81,12 +741,28 @@ int main_benchmark(int argc, char** argv) {
         exit(1);
     }
     
+    bool stage_benchmarks = !gbz_name.empty() || !minimizer_name.empty() || !distance_name.empty() || !fastq_name.empty();
+    if (stage_benchmarks && (gbz_name.empty() || minimizer_name.empty() || distance_name.empty() || fastq_name.empty())) {
+        cerr << "error:[vg benchmark] Mapping stage benchmarks need a GBZ (-Z), minimizer index (-m), distance index (-d), and reads (-f)" << endl;
+        exit(1);
+    }
+    if (stage_iterations == 0) {
+        cerr << "error:[vg benchmark] Number of iterations must be positive" << endl;
+        exit(1);
+    }
+    if (io_reads == 0 || max_threads == 0) {
+        cerr << "error:[vg benchmark] I/O benchmarks need at least one read, and benchmarks need at least one thread" << endl;
+        exit(1);
+    }
+    
     // Do all benchmarking on one thread
     omp_set_num_threads(1);
     
     // Turn on nested parallelism, so we can parallelize over VCFs and over alignment bands
     omp_set_nested(1);
     
+    set_benchmark_counters(use_counters);
+    
     vector<BenchmarkResult> results;
     
     // We're doing long alignments so we need to raise the WFA score caps
@@ -165,20 +841,142 @@ int main_benchmark(int argc, char** argv) {
         Aligner aligner;
         WFAExtender extender(graph, aligner, error_model);
         
-        results.push_back(run_benchmark("connect() on " + std::to_string(node_count) + " node sequence", 1, [&]() {
-            // Do the alignment
-            WFAAlignment aligned = extender.connect(to_connect, from_pos, to_pos);
-            // Make sure it succeeded
-            assert(aligned);
-        }));
+        for (bool bit_parallel : {true, false}) {
+            extender.bit_parallel = bit_parallel;
+            results.push_back(run_benchmark("connect() on " + std::to_string(node_count) + " node sequence" +
+                                            (bit_parallel ? "" : " comparing one base at a time"), 1, [&]() {
+                // Do the alignment
+                WFAAlignment aligned = extender.connect(to_connect, from_pos, to_pos);
+                // Make sure it succeeded
+                assert(aligned);
+            }));
+        }
+    }
+        
+    for (size_t anchor_count = 250; anchor_count <= 4000; anchor_count *= 2) {
+        // Prepare a long linear graph, as for a long read
+        size_t chain_node_length = 32;
+        size_t chain_node_count = (anchor_count * 6) / chain_node_length + 2;
+        bdsg::HashGraph graph;
+        for (size_t i = 0; i < chain_node_count; i++) {
+            graph.create_handle(std::string(chain_node_length, 'A'), i + 1);
+            if (i > 0) {
+                graph.create_edge(graph.get_handle(i, false), graph.get_handle(i + 1, false));
+            }
+        }
+        IntegratedSnarlFinder snarl_finder(graph);
+        SnarlDistanceIndex distance_index;
+        fill_in_distance_index(&distance_index, &graph, &snarl_finder);
+        
+        // Scatter anchors along the main diagonal, with small indels and some
+        // spurious ones off of it.
+        std::vector<algorithms::Anchor> anchors;
+        uint32_t bits = 0xcafebebe;
+        size_t graph_length = chain_node_count * chain_node_length;
+        for (size_t i = 0; i < anchor_count; i++) {
+            bits = (bits * 73 + 1375) % 477218579;
+            size_t read_pos = i * 5;
+            size_t graph_pos = read_pos + 3 + (bits % 7);
+            if (bits % 13 == 0) {
+                graph_pos = (graph_pos * 7) % (graph_length - chain_node_length);
+            }
+            anchors.emplace_back(read_pos, make_pos_t(graph_pos / chain_node_length + 1, false, graph_pos % chain_node_length), 15, 15);
+        }
+        algorithms::sort_and_shadow(anchors);
+        VectorView<algorithms::Anchor> to_chain {anchors};
+        
+        for (bool batch_transitions : {false, true}) {
+            results.push_back(run_benchmark("find_best_chain() on " + std::to_string(anchor_count) + " anchors" +
+                                            (batch_transitions ? " with batched transitions" : ""), 10, [&]() {
+                auto chain = algorithms::find_best_chain(to_chain, distance_index, graph, 6, 1,
+                                                         MinimizerMapper::default_max_lookback_bases,
+                                                         MinimizerMapper::default_min_lookback_items,
+                                                         MinimizerMapper::default_lookback_item_hard_cap,
+                                                         MinimizerMapper::default_initial_lookback_threshold,
+                                                         MinimizerMapper::default_lookback_scale_factor,
+                                                         MinimizerMapper::default_min_good_transition_score_per_base,
+                                                         MinimizerMapper::default_item_bonus,
+                                                         MinimizerMapper::default_max_indel_bases,
+                                                         batch_transitions);
+                assert(!chain.second.empty());
+            }));
+        }
+    }
+    
+    {
+        // Compare hash tables on the sort of keys hot paths look up: node IDs
+        // and positions, scattered over a big graph.
+        size_t key_count = 100000;
+        vector<nid_t> ids, missing_ids;
+        vector<pos_t> positions, missing_positions;
+        uint32_t bits = 0xcafebebe;
+        for (size_t i = 0; i < key_count; i++) {
+            bits = (bits * 73 + 1375) % 477218579;
+            // Odd IDs get looked up and are there, even ones are missing.
+            ids.push_back(bits * 2 + 1);
+            missing_ids.push_back(bits * 2);
+            positions.push_back(make_pos_t(bits * 2 + 1, bits & 0x1, bits % 32));
+            missing_positions.push_back(make_pos_t(bits * 2, bits & 0x1, bits % 32));
+        }
+        benchmark_hash_table<std::unordered_map<nid_t, size_t>>("unordered_map of IDs", ids, missing_ids, results);
+        benchmark_hash_table<hash_map<nid_t, size_t>>("hash_map of IDs", ids, missing_ids, results);
+        benchmark_hash_table<flat_hash_map<nid_t, size_t>>("flat_hash_map of IDs", ids, missing_ids, results);
+        benchmark_hash_table<std::unordered_map<pos_t, size_t>>("unordered_map of positions", positions, missing_positions, results);
+        benchmark_hash_table<flat_hash_map<pos_t, size_t>>("flat_hash_map of positions", positions, missing_positions, results);
     }
+    
+    if (stage_benchmarks) {
+        if (show_progress) {
+            cerr << "Loading indexes for mapping stage benchmarks" << endl;
+        }
+        auto gbz = vg::io::VPKG::load_one<gbwtgraph::GBZ>(gbz_name);
+        auto minimizer_index = vg::io::VPKG::load_one<gbwtgraph::DefaultMinimizerIndex>(minimizer_name);
+        // Report how much the distance index costs to keep in memory, since
+        // that decides whether it fits next to everything else.
+        double gigabytes_before_distance_index = gbwt::inGigabytes(gbwt::memoryUsage());
+        auto distance_index = vg::io::VPKG::load_one<SnarlDistanceIndex>(distance_name);
+        distance_index->preload(true);
+        if (show_progress) {
+            cerr << "Distance index raised memory footprint by "
+                 << (gbwt::inGigabytes(gbwt::memoryUsage()) - gigabytes_before_distance_index) << " GB" << endl;
+        }
         
+        vector<Alignment> reads;
+        fastq_unpaired_for_each(fastq_name, [&](Alignment& aln) {
+            if (reads.size() < max_reads) {
+                toUppercaseInPlace(*aln.mutable_sequence());
+                reads.emplace_back(std::move(aln));
+            }
+        });
+        if (reads.empty()) {
+            cerr << "error:[vg benchmark] No reads found in " << fastq_name << endl;
+            exit(1);
+        }
+        
+        if (show_progress) {
+            cerr << "Benchmarking mapping stages on " << reads.size() << " reads" << endl;
+        }
+        benchmark_mapping_stages(*gbz, *minimizer_index, *distance_index, reads, stage_iterations, results);
+    }
+    
+    if (handle_graph_benchmarks) {
+        benchmark_handle_graphs(max_threads, show_progress, results);
+    }
+    
+    if (io_benchmarks) {
+        benchmark_alignment_io(io_reads, max_threads, show_progress, results);
+    }
+    
     // Do the control against itself
     results.push_back(run_benchmark("control", 1000, benchmark_control));
     
 
     cout << "# Benchmark results for vg " << Version::get_short() << endl;
-    cout << "# runs\ttest(us)\tstddev(us)\tcontrol(us)\tstddev(us)\tscore\terr\tname" << endl;
+    cout << "# runs\ttest(us)\tstddev(us)\tcontrol(us)\tstddev(us)\tscore\terr\t";
+    if (use_counters) {
+        cout << "cycles\tinstructions\tcache-misses\tbranch-misses\t";
+    }
+    cout << "name" << endl;
     for (auto& result : results) {
         cout << result << endl;
     }
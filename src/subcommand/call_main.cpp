@@ -53,6 +53,7 @@ void help_call(char** argv) {
        << "    -i, --ins-fasta FILE    Insertions fasta (required if VCF contains symbolic insertions)" << endl
        << "    -s, --sample NAME       Sample name [default=SAMPLE]" << endl
        << "    -r, --snarls FILE       Snarls (from vg snarls) to avoid recomputing." << endl
+       << "    -D, --depth-index FILE  Load the binned depth index of the pack from FILE, or compute it and save it there if FILE doesn't exist" << endl
        << "    -g, --gbwt FILE         Only call genotypes that are present in given GBWT index." << endl
        << "    -z, --gbz               Only call genotypes that are present in GBZ index (applies only if input graph is GBZ)." << endl
        << "    -N, --translation FILE  Node ID translation (as created by vg gbwt --translation) to apply to snarl names in output" << endl
@@ -67,6 +68,8 @@ void help_call(char** argv) {
        << "                                from if no samples are used. Unmatched contigs get ploidy 2 (or that from -d)." << endl
        << "    -n, --nested            Activate nested calling mode (experimental)" << endl
        << "    -I, --chains            Call chains instead of snarls (experimental)" << endl
+       << "    -u, --stream            Write each VCF record as soon as everything before it on the reference is called" << endl
+       << "                            (cannot be used with -v, -A, -G or -I)" << endl
        << "    -t, --threads N         number of threads to use" << endl;
 }    
 
@@ -76,6 +79,7 @@ int main_call(int argc, char** argv) {
     string vcf_filename;
     string sample_name = "SAMPLE";
     string snarl_filename;
+    string depth_index_filename;
     string gbwt_filename;
     bool   gbz_paths = false;
     string translation_file_name;
@@ -105,6 +109,7 @@ int main_call(int argc, char** argv) {
     bool genotype_snarls = false;
     bool nested = false;
     bool call_chains = false;
+    bool stream_output = false;
     bool all_snarls = false;
     int64_t min_ref_allele_len = 0;
     int64_t max_ref_allele_len = numeric_limits<int64_t>::max();    
@@ -139,6 +144,7 @@ int main_call(int argc, char** argv) {
             {"ins-fasta", required_argument, 0, 'i'},
             {"sample", required_argument, 0, 's'},            
             {"snarls", required_argument, 0, 'r'},
+            {"depth-index", required_argument, 0, 'D'},
             {"gbwt", required_argument, 0, 'g'},
             {"gbz", no_argument, 0, 'z'},
             {"translation", required_argument, 0, 'N'},
@@ -155,6 +161,7 @@ int main_call(int argc, char** argv) {
             {"legacy", no_argument, 0, 'L'},
             {"nested", no_argument, 0, 'n'},
             {"chains", no_argument, 0, 'I'},            
+            {"stream", no_argument, 0, 'u'},
             {"threads", required_argument, 0, 't'},
             {"help", no_argument, 0, 'h'},
             {0, 0, 0, 0}
@@ -162,7 +169,7 @@ int main_call(int argc, char** argv) {
 
         int option_index = 0;
 
-        c = getopt_long (argc, argv, "k:Be:b:m:v:aAc:C:f:i:s:r:g:zN:Op:S:o:l:d:R:GTLM:nt:h",
+        c = getopt_long (argc, argv, "k:Be:b:m:v:aAc:C:f:i:s:r:D:g:zN:Op:S:o:l:d:R:GTLM:nut:h",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -213,6 +220,9 @@ int main_call(int argc, char** argv) {
         case 'r':
             snarl_filename = optarg;
             break;
+        case 'D':
+            depth_index_filename = optarg;
+            break;
         case 'g':
             gbwt_filename = optarg;
             break;
@@ -280,6 +290,9 @@ int main_call(int argc, char** argv) {
         case 'I':
             call_chains =true;
             break;            
+        case 'u':
+            stream_output = true;
+            break;
         case 't':
         {
             int num_threads = parse<int>(optarg);
@@ -475,6 +488,10 @@ int main_call(int argc, char** argv) {
         cerr << "error [vg call]: gbwt (-g) cannot be used with legacy caller (-L)" << endl;
         return 1;
     }
+    if (stream_output && (!vcf_filename.empty() || all_snarls || gaf_output || call_chains)) {
+        cerr << "error [vg call]: streaming output (-u) cannot be used with -v, -A, -G or -I" << endl;
+        return 1;
+    }
     if (gbz_paths && !gbwt_filename.empty()) {
         cerr << "error [vg call]: gbwt (-g) cannot be used with gbz graph (-z): choose one or the other" << endl;
         return 1;
@@ -650,9 +667,37 @@ int main_call(int argc, char** argv) {
         SupportBasedSnarlCaller* packed_caller = nullptr;
 
         if (ratio_caller == false) {
-            // Make a depth index
-            depth_index = algorithms::binned_packed_depth_index(*packer, ref_paths, min_depth_bin_width, max_depth_bin_width,
-                                                                depth_scale_fac, 0, true, true);
+            // Make a depth index, or load the one we made last time
+            bool loaded_depth_index = false;
+            if (!depth_index_filename.empty() && file_exists(depth_index_filename)) {
+                ifstream depth_index_file(depth_index_filename, ios::binary);
+                try {
+                    depth_index = algorithms::load_binned_depth_index(depth_index_file);
+                } catch (const runtime_error& e) {
+                    cerr << "error:[vg call] Unable to load depth index " << depth_index_filename << ": " << e.what() << endl;
+                    return 1;
+                }
+                for (const string& ref_path : ref_paths) {
+                    if (!depth_index.count(ref_path)) {
+                        cerr << "error:[vg call] Depth index " << depth_index_filename << " has no depths for path "
+                             << ref_path << "; remove it to recompute it" << endl;
+                        return 1;
+                    }
+                }
+                loaded_depth_index = true;
+            }
+            if (!loaded_depth_index) {
+                depth_index = algorithms::binned_packed_depth_index(*packer, ref_paths, min_depth_bin_width, max_depth_bin_width,
+                                                                    depth_scale_fac, 0, true, true);
+                if (!depth_index_filename.empty()) {
+                    ofstream depth_index_file(depth_index_filename, ios::binary);
+                    if (!depth_index_file) {
+                        cerr << "error:[vg call] Unable to write depth index " << depth_index_filename << endl;
+                        return 1;
+                    }
+                    algorithms::save_binned_depth_index(depth_index, depth_index_file);
+                }
+            }
             // Make a new-stype probablistic caller
             auto poisson_caller = new PoissonSupportSnarlCaller(*graph, *snarl_manager, *support_finder, depth_index,
                                                                 //todo: qualities need to be used better in conjunction with
@@ -814,7 +859,61 @@ int main_call(int argc, char** argv) {
     }
 
     // Call the graph
-    if (!call_chains) {
+    if (stream_output) {
+        VCFOutputCaller* vcf_caller = dynamic_cast<VCFOutputCaller*>(graph_caller.get());
+        assert(vcf_caller != nullptr);
+        cout << header << flush;
+        
+        // order the top-level snarls by where the reference paths first enter them, using the
+        // same (contig, position) keys as the VCF records, and put any the paths miss first.
+        // snarls on several paths are called on the lexicographically lowest, so we look there first
+        vector<pair<pair<string, size_t>, const Snarl*>> keyed_snarls;
+        unordered_set<const Snarl*> seen_snarls;
+        vector<size_t> path_order(ref_paths.size());
+        for (size_t i = 0; i < path_order.size(); ++i) {
+            path_order[i] = i;
+        }
+        std::sort(path_order.begin(), path_order.end(), [&](size_t a, size_t b) { return ref_paths[a] < ref_paths[b]; });
+        for (size_t i : path_order) {
+            subrange_t subrange;
+            string base_name = Paths::strip_subrange(ref_paths[i], &subrange);
+            size_t position = 1 + (subrange == PathMetadata::NO_SUBRANGE ? 0 : subrange.first) +
+                (i < ref_path_offsets.size() ? ref_path_offsets[i] : 0);
+            graph->for_each_step_in_path(graph->get_path_handle(ref_paths[i]), [&](step_handle_t step) {
+                    handle_t handle = graph->get_handle_of_step(step);
+                    const Snarl* snarl = snarl_manager->into_which_snarl(graph->get_id(handle), graph->get_is_reverse(handle));
+                    if (snarl != nullptr && snarl_manager->is_root(snarl) && seen_snarls.insert(snarl).second) {
+                        keyed_snarls.push_back(make_pair(make_pair(base_name, position), snarl));
+                    }
+                    position += graph->get_length(handle);
+                });
+        }
+        snarl_manager->for_each_top_level_snarl([&](const Snarl* snarl) {
+                if (!seen_snarls.count(snarl)) {
+                    keyed_snarls.push_back(make_pair(make_pair(string(), 0), snarl));
+                }
+            });
+        std::stable_sort(keyed_snarls.begin(), keyed_snarls.end(), [](const pair<pair<string, size_t>, const Snarl*>& a,
+                                                                      const pair<pair<string, size_t>, const Snarl*>& b) {
+                return a.first < b.first;
+            });
+        vector<const Snarl*> snarl_order;
+        snarl_order.reserve(keyed_snarls.size());
+        for (auto& keyed_snarl : keyed_snarls) {
+            snarl_order.push_back(keyed_snarl.second);
+        }
+
+        // a snarl's records can't come before where the reference enters it, so once every
+        // snarl before the next unfinished one is done, everything before its key is final
+        graph_caller->call_snarls_in_order(*graph, snarl_order, [&](size_t done_count) {
+                if (done_count < keyed_snarls.size()) {
+                    vcf_caller->write_variants_before(cout, keyed_snarls[done_count].first);
+                }
+            });
+        // and flush whatever is left
+        vcf_caller->write_variants(cout);
+        return 0;
+    } else if (!call_chains) {
 
         // Call each snarl
         // (todo: try chains in normal mode)
@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <getopt.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <regex>
@@ -22,7 +23,9 @@
 #include "../region.hpp"
 #include "../haplotype_extracter.hpp"
 #include "../algorithms/sorted_id_ranges.hpp"
+#include "../algorithms/component.hpp"
 #include "../algorithms/find_gbwt.hpp"
+#include "../job_schedule.hpp"
 #include <bdsg/overlays/overlay_helper.hpp>
 #include "../io/save_handle_graph.hpp"
 
@@ -66,6 +69,8 @@ void help_chunk(char** argv) {
          << "component chunking:" << endl
          << "    -C, --components         create a chunk for each connected component.  if a targets given with (-p, -P, -r, -R), limit to components containing them" << endl
          << "    -M, --path-components    create a chunk for each path in the graph's connected component" << endl
+         << "    --target-mem GB          with -C and no targets, extract and write only as many components at once" << endl
+         << "                             as should fit in about this many GB [unlimited]" << endl
          << "general:" << endl
          << "    -s, --chunk-size N       create chunks spanning N bases (or nodes with -r/-R) for all input regions." << endl
          << "    -o, --overlap N          overlap between chunks when using -s [0]" << endl        
@@ -111,6 +116,7 @@ int main_chunk(int argc, char** argv) {
     bool fully_contained = false;
     int n_chunks = 0;
     size_t gam_split_size = 0;
+    double target_mem_gb = 0;
     string output_format = "pg";
     bool output_format_set = false;
     bool components = false;
@@ -118,6 +124,7 @@ int main_chunk(int argc, char** argv) {
     string snarl_filename;
     
     #define OPT_NO_EMBEDDED_HAPLOTYPES 1000
+    #define OPT_TARGET_MEM 1001
     
     int c;
     optind = 2; // force optind past command positional argument
@@ -142,6 +149,7 @@ int main_chunk(int argc, char** argv) {
             {"id-range", no_argument, 0, 'R'},
             {"trace", no_argument, 0, 'T'},
             {"no-embedded-haplotypes", no_argument, 0, OPT_NO_EMBEDDED_HAPLOTYPES},
+            {"target-mem", required_argument, 0, OPT_TARGET_MEM},
             {"fully-contained", no_argument, 0, 'f'},
             {"threads", required_argument, 0, 't'},
             {"n-chunks", required_argument, 0, 'n'},
@@ -254,6 +262,14 @@ int main_chunk(int argc, char** argv) {
             trace = true;
             break;
             
+        case OPT_TARGET_MEM:
+            target_mem_gb = parse<double>(optarg);
+            if (target_mem_gb <= 0) {
+                cerr << "error:[vg chunk] Target memory (--target-mem) must be positive" << endl;
+                return 1;
+            }
+            break;
+            
         case OPT_NO_EMBEDDED_HAPLOTYPES:
             no_embedded_haplotypes = true;
             break;
@@ -598,7 +614,7 @@ int main_chunk(int argc, char** argv) {
     vector<unordered_set<nid_t>> component_ids; 
     if (components == true && regions.empty()) {
         // no regions given, we find our components from scratch and make some dummy regions
-        component_ids = handlealgs::weakly_connected_components(graph);
+        component_ids = algorithms::weakly_connected_components_parallel(*graph);
         for (int i = 0; i < component_ids.size(); ++i) {
             Region region;
             region.seq = "";
@@ -665,175 +681,235 @@ int main_chunk(int argc, char** argv) {
         }
     }
 
-    // extract chunks in parallel
-#pragma omp parallel for
-    for (int i = 0; i < num_regions; ++i) {
-        int tid = omp_get_thread_num();
-        Region& region = regions[i];
-        PathChunker& chunker = chunkers[tid];
-        unique_ptr<MutablePathMutableHandleGraph> subgraph;
-        map<string, int> trace_thread_frequencies;
-        if (!component_ids.empty()) {
-            subgraph = vg::io::new_output_graph<MutablePathMutableHandleGraph>(output_format);
-            chunker.extract_component(component_ids[i], *subgraph, false);
-            output_regions[i] = region;
+    // The node ID ranges to look up in the GAM index for each region
+    vector<vector<pair<vg::id_t, vg::id_t>>> region_id_ranges(chunk_gam && !components ? num_regions : 0);
+
+    // When extracting path regions with context, every region on a path
+    // needs the same index of the path's edges, and building it walks the
+    // whole path. So we chunk the regions one path at a time, sorted by
+    // position, and build the index once for each path, sharing it between
+    // the threads.
+    bool share_path_edges = component_ids.empty() && !id_range && !components && snarl_manager.get() == nullptr;
+    vector<vector<int>> region_batches;
+    if (share_path_edges) {
+        vector<int> region_order(num_regions);
+        for (int i = 0; i < num_regions; ++i) {
+            region_order[i] = i;
         }
-        else if (id_range == false) {
-            subgraph = vg::io::new_output_graph<MutablePathMutableHandleGraph>(output_format);
-            if (components == true) {
-                chunker.extract_path_component(region.seq, *subgraph, output_regions[i]);
-            } else if (snarl_manager.get() != nullptr) {
-                chunker.extract_snarls(region, *snarl_manager, *subgraph);
-                output_regions[i] = region;                
-            } else {
-                chunker.extract_subgraph(region, context_steps, context_length,
-                                         trace, *subgraph, output_regions[i]);
+        std::stable_sort(region_order.begin(), region_order.end(), [&](int a, int b) {
+            return make_pair(regions[a].seq, regions[a].start) < make_pair(regions[b].seq, regions[b].start);
+        });
+        for (int i : region_order) {
+            if (region_batches.empty() || regions[region_batches.back().front()].seq != regions[i].seq) {
+                region_batches.emplace_back();
             }
-        } else {
-            if (chunk_graph || context_steps > 0) {
+            region_batches.back().push_back(i);
+        }
+    } else if (num_regions > 0) {
+        region_batches.emplace_back(num_regions);
+        for (int i = 0; i < num_regions; ++i) {
+            region_batches.back()[i] = i;
+        }
+    }
+
+    for (auto& region_batch : region_batches) {
+        unique_ptr<set<pair<pair<vg::id_t, bool>, pair<vg::id_t, bool>>>> path_edge_set;
+        if (share_path_edges) {
+            path_handle_t path_handle = graph->get_path_handle(regions[region_batch.front()].seq);
+            path_edge_set.reset(new set<pair<pair<vg::id_t, bool>, pair<vg::id_t, bool>>>(
+                chunkers[0].get_path_edge_index(graph->path_begin(path_handle), graph->path_back(path_handle),
+                                                std::max(context_steps, context_length))));
+        }
+
+        // extract a chunk
+        auto chunk_region = [&](int i) {
+            Region& region = regions[i];
+            // Chunkers only hold the graph, so each chunk can have its own,
+            // whatever kind of thread it runs on.
+            PathChunker chunker(graph);
+            unique_ptr<MutablePathMutableHandleGraph> subgraph;
+            map<string, int> trace_thread_frequencies;
+            if (!component_ids.empty()) {
                 subgraph = vg::io::new_output_graph<MutablePathMutableHandleGraph>(output_format);
-                output_regions[i].seq = region.seq;
-                chunker.extract_id_range(region.start, region.end,
-                                         components ? numeric_limits<int64_t>::max() : context_steps,
-                                         context_length, trace && !components,
-                                         *subgraph, output_regions[i]);
-            } else {
-                // in this case, there's no need to actually build the subgraph, so we don't
-                // in order to save time.
+                chunker.extract_component(component_ids[i], *subgraph, false);
                 output_regions[i] = region;
             }
-        }
-
-        // optionally trace our haplotypes
-        if (trace && subgraph && gbwt_index) {
-            int64_t trace_start;
-            int64_t trace_steps = 0;
-            if (id_range) {
-                trace_start = output_regions[i].start;
-                trace_steps = output_regions[i].end - trace_start;
-            } else {
-                path_handle_t path_handle = graph->get_path_handle(output_regions[i].seq);
-                step_handle_t trace_start_step = graph->get_step_at_position(path_handle, output_regions[i].start);
-                step_handle_t trace_end_step = graph->get_step_at_position(path_handle, output_regions[i].end);
-                // make sure we don't loop forever in next loop
-                if (output_regions[i].start > output_regions[i].end) {
-                    swap(trace_start_step, trace_end_step);
-                }
-                trace_start = graph->get_id(graph->get_handle_of_step(trace_start_step));
-                for (; trace_start_step != trace_end_step; trace_start_step = graph->get_next_step(trace_start_step)) {
-                    ++trace_steps;
-                }
-                // haplotype_extender is forward only.  until it's made bidirectional, try to
-                // detect backward paths and trace them backwards.  this will not cover all possible cases though.
-                if (graph->get_is_reverse(graph->get_handle_of_step(trace_start_step)) &&
-                    graph->get_is_reverse(graph->get_handle_of_step(trace_end_step))) {
-                    trace_start = graph->get_id(graph->get_handle_of_step(trace_end_step));
+            else if (id_range == false) {
+                subgraph = vg::io::new_output_graph<MutablePathMutableHandleGraph>(output_format);
+                if (components == true) {
+                    chunker.extract_path_component(region.seq, *subgraph, output_regions[i]);
+                } else if (snarl_manager.get() != nullptr) {
+                    chunker.extract_snarls(region, *snarl_manager, *subgraph);
+                    output_regions[i] = region;                
+                } else {
+                    chunker.extract_subgraph(region, context_steps, context_length,
+                                             trace, *subgraph, output_regions[i], path_edge_set.get());
                 }
-            }
-            Graph g;
-            trace_haplotypes_and_paths(*graph, *gbwt_index, trace_start, trace_steps,
-                                       g, trace_thread_frequencies, false);
-            subgraph->for_each_path_handle([&trace_thread_frequencies, &subgraph](path_handle_t path_handle) {
-                    trace_thread_frequencies[subgraph->get_path_name(path_handle)] = 1;});
-            VG* vg_subgraph = dynamic_cast<VG*>(subgraph.get());
-            if (vg_subgraph != nullptr) {
-                // our graph is in vg format, just extend it
-                vg_subgraph->extend(g);
             } else {
-                // our graph is not in vg format.  covert it, extend it, convert it back
-                // this can eventually be avoided by handlifying the haplotype tracer
-                VG vg;
-                handlealgs::copy_path_handle_graph(subgraph.get(), &vg);
-                subgraph.reset();
-                vg.extend(g);
-                subgraph = vg::io::new_output_graph<MutablePathMutableHandleGraph>(output_format);
-                handlealgs::copy_path_handle_graph(&vg, subgraph.get());
+                if (chunk_graph || context_steps > 0) {
+                    subgraph = vg::io::new_output_graph<MutablePathMutableHandleGraph>(output_format);
+                    output_regions[i].seq = region.seq;
+                    chunker.extract_id_range(region.start, region.end,
+                                             components ? numeric_limits<int64_t>::max() : context_steps,
+                                             context_length, trace && !components,
+                                             *subgraph, output_regions[i]);
+                } else {
+                    // in this case, there's no need to actually build the subgraph, so we don't
+                    // in order to save time.
+                    output_regions[i] = region;
+                }
             }
-        }
 
-        ofstream out_file;
-        ostream* out_stream = NULL;
-        if (chunk_graph) {
-            if ((!region_strings.empty() || !node_range_string.empty()) &&
-                (regions.size()  == 1) && chunk_size == 0) {
-                // If we are going to output only one chunk, it should go to
-                // stdout instead of to a file on disk
-                out_stream = &cout;
-            } else {
-                // Otherwise, we write files under the specified prefix, using
-                // a prefix-i-seq-start-end convention.
-                string name = chunk_name(out_chunk_prefix, i, output_regions[i], output_ext, 0, components);
-                out_file.open(name);
-                if (!out_file) {
-                    cerr << "error[vg chunk]: can't open output chunk file " << name << endl;
-                    exit(1);
+            // optionally trace our haplotypes
+            if (trace && subgraph && gbwt_index) {
+                int64_t trace_start;
+                int64_t trace_steps = 0;
+                if (id_range) {
+                    trace_start = output_regions[i].start;
+                    trace_steps = output_regions[i].end - trace_start;
+                } else {
+                    path_handle_t path_handle = graph->get_path_handle(output_regions[i].seq);
+                    step_handle_t trace_start_step = graph->get_step_at_position(path_handle, output_regions[i].start);
+                    step_handle_t trace_end_step = graph->get_step_at_position(path_handle, output_regions[i].end);
+                    // make sure we don't loop forever in next loop
+                    if (output_regions[i].start > output_regions[i].end) {
+                        swap(trace_start_step, trace_end_step);
+                    }
+                    trace_start = graph->get_id(graph->get_handle_of_step(trace_start_step));
+                    for (; trace_start_step != trace_end_step; trace_start_step = graph->get_next_step(trace_start_step)) {
+                        ++trace_steps;
+                    }
+                    // haplotype_extender is forward only.  until it's made bidirectional, try to
+                    // detect backward paths and trace them backwards.  this will not cover all possible cases though.
+                    if (graph->get_is_reverse(graph->get_handle_of_step(trace_start_step)) &&
+                        graph->get_is_reverse(graph->get_handle_of_step(trace_end_step))) {
+                        trace_start = graph->get_id(graph->get_handle_of_step(trace_end_step));
+                    }
                 }
-                out_stream = &out_file;
+                // the existing paths get a frequency of 1, and the threads are added straight to the subgraph
+                trace_haplotypes_and_paths(*graph, *gbwt_index, trace_start, trace_steps,
+                                           *subgraph, trace_thread_frequencies, false);
             }
 
-            assert(subgraph);
-            vg::io::save_handle_graph(subgraph.get(), *out_stream);
-        }
-        
-        // optional gam chunking
-        if (chunk_gam) {
-            if (!components) {
-                // old way: use the gam index
-                for (size_t gi = 0; gi < gam_indexes.size(); ++gi) {
-                    auto& gam_index = gam_indexes[gi];
-                    assert(gam_index.get() != nullptr);
-                    GAMIndex::cursor_t& cursor = cursors_vec[gi][tid];
-            
-                    string gam_name = chunk_name(out_chunk_prefix, i, output_regions[i], ".gam", gi, components);
-                    ofstream out_gam_file(gam_name);
-                    if (!out_gam_file) {
-                        cerr << "error[vg chunk]: can't open output gam file " << gam_name << endl;
+            ofstream out_file;
+            ostream* out_stream = NULL;
+            if (chunk_graph) {
+                if ((!region_strings.empty() || !node_range_string.empty()) &&
+                    (regions.size()  == 1) && chunk_size == 0) {
+                    // If we are going to output only one chunk, it should go to
+                    // stdout instead of to a file on disk
+                    out_stream = &cout;
+                } else {
+                    // Otherwise, we write files under the specified prefix, using
+                    // a prefix-i-seq-start-end convention.
+                    string name = chunk_name(out_chunk_prefix, i, output_regions[i], output_ext, 0, components);
+                    out_file.open(name);
+                    if (!out_file) {
+                        cerr << "error[vg chunk]: can't open output chunk file " << name << endl;
                         exit(1);
                     }
-            
-                    // Work out the ID ranges to look up
-                    vector<pair<vg::id_t, vg::id_t>> region_id_ranges;
+                    out_stream = &out_file;
+                }
+
+                assert(subgraph);
+                vg::io::save_handle_graph(subgraph.get(), *out_stream);
+            }
+        
+            // optional gam chunking
+            if (chunk_gam) {
+                if (!components) {
+                    // old way: use the gam index, once we know the ID ranges of all the regions
                     if (subgraph) {
                         // Use the regions from the graph
-                        region_id_ranges = vg::algorithms::sorted_id_ranges(subgraph.get());
+                        region_id_ranges[i] = vg::algorithms::sorted_id_ranges(subgraph.get());
                     } else {
                         // Use the region we were asked for
-                        region_id_ranges = {{region.start, region.end}};
+                        region_id_ranges[i] = {{region.start, region.end}};
                     }
-                    
-                    auto emit = vg::io::emit_to<Alignment>(out_gam_file);
-                    
-                    auto handle_read = [&](const Alignment& aln) {
-                        check_read(aln, graph);
-                        emit(aln);
-                    };
-                    
-                    gam_index->find(cursor, region_id_ranges, handle_read, fully_contained);
-                }
-            } else {
+                } else {
 #pragma omp critical (node_to_component)
-                {
-                    // we're doing components, just use stl map, which we update here
-                    subgraph->for_each_handle([&](handle_t sg_handle) {
-                            // note, if components overlap, this is arbitrary.  up to user to only use
-                            // path components if they are disjoint
-                            node_to_component[subgraph->get_id(sg_handle)] = i;
-                        });
+                    {
+                        // we're doing components, just use stl map, which we update here
+                        subgraph->for_each_handle([&](handle_t sg_handle) {
+                                // note, if components overlap, this is arbitrary.  up to user to only use
+                                // path components if they are disjoint
+                                node_to_component[subgraph->get_id(sg_handle)] = i;
+                            });
+                    }
                 }
             }
-        }
-        // trace annotations
-        if (trace) {
-            // Even if we have only one chunk, the trace annotation data always
-            // ends up in a file.
-            string annot_name = chunk_name(out_chunk_prefix, i, output_regions[i], ".annotate.txt", 0, components);
-            ofstream out_annot_file(annot_name);
-            if (!out_annot_file) {
-                cerr << "error[vg chunk]: can't open output trace annotation file " << annot_name << endl;
-                exit(1);
+            // trace annotations
+            if (trace) {
+                // Even if we have only one chunk, the trace annotation data always
+                // ends up in a file.
+                string annot_name = chunk_name(out_chunk_prefix, i, output_regions[i], ".annotate.txt", 0, components);
+                ofstream out_annot_file(annot_name);
+                if (!out_annot_file) {
+                    cerr << "error[vg chunk]: can't open output trace annotation file " << annot_name << endl;
+                    exit(1);
+                }
+                for (auto tf : trace_thread_frequencies) {
+                    out_annot_file << tf.first << "\t" << tf.second << endl;
+                }
             }
-            for (auto tf : trace_thread_frequencies) {
-                out_annot_file << tf.first << "\t" << tf.second << endl;
+        };
+        
+        if (!component_ids.empty() && target_mem_gb > 0) {
+            // Extract and write whole components, biggest first, as many at a
+            // time as should fit in memory. We guess at the memory for a
+            // component from its node count, and the schedule corrects the
+            // guess from the observed memory use as it goes.
+            vector<pair<int64_t, int64_t>> approx_job_requirements;
+            approx_job_requirements.reserve(region_batch.size());
+            for (int i : region_batch) {
+                int64_t node_count = component_ids[i].size();
+                approx_job_requirements.emplace_back(node_count, 256 * node_count + 4096);
+            }
+            JobSchedule schedule(approx_job_requirements, [&](int64_t j) {
+                chunk_region(region_batch[j]);
+            });
+            schedule.execute(target_mem_gb * 1024 * 1024 * 1024);
+        } else {
+            // extract chunks in parallel
+#pragma omp parallel for schedule(dynamic, 1)
+            for (size_t j = 0; j < region_batch.size(); ++j) {
+                chunk_region(region_batch[j]);
+            }
+        }
+    }
+        
+    // chunk the gams by region, querying each index for a batch of regions at
+    // once so that each part of the gam is read only once per batch
+    if (chunk_gam && !components) {
+        // Limit how many output files we have open at once
+        size_t max_open_gams = 256;
+        for (size_t gi = 0; gi < gam_indexes.size(); ++gi) {
+            auto& gam_index = gam_indexes[gi];
+            assert(gam_index.get() != nullptr);
+            for (size_t batch_start = 0; batch_start < (size_t)num_regions; batch_start += max_open_gams) {
+                size_t batch_end = min(batch_start + max_open_gams, (size_t)num_regions);
+                
+                list<ofstream> out_gam_files;
+                vector<function<void(const Alignment&)>> emitters;
+                for (size_t i = batch_start; i < batch_end; ++i) {
+                    string gam_name = chunk_name(out_chunk_prefix, i, output_regions[i], ".gam", gi, components);
+                    out_gam_files.emplace_back(gam_name);
+                    if (!out_gam_files.back()) {
+                        cerr << "error[vg chunk]: can't open output gam file " << gam_name << endl;
+                        exit(1);
+                    }
+                    emitters.emplace_back(vg::io::emit_to<Alignment>(out_gam_files.back()));
+                }
+                
+                vector<vector<pair<vg::id_t, vg::id_t>>> batch_ranges(region_id_ranges.begin() + batch_start,
+                                                                      region_id_ranges.begin() + batch_end);
+                gam_index->find_batch(cursors_vec[gi], batch_ranges, [&](size_t region, const Alignment& aln) {
+                    check_read(aln, graph);
+                    emitters[region](aln);
+                }, fully_contained);
+                
+                // Flush the emitters before closing their files
+                emitters.clear();
             }
         }
     }
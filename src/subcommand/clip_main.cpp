@@ -208,15 +208,11 @@ int main_clip(int argc, char** argv) {
         return 1;
     }
 
-    // to do: I think it could be a good idea to combine these options
-    if (min_depth >= 0 && max_deletion >= 0) {
-        cerr << "error:[vg-clip] -d cannot (yet?) be used with -D" << endl;
-        return 1;
-    }
-
-    // ditto about combining
-    if ((stub_clipping || stubbify_reference) && (min_depth >= 0 || max_deletion >= 0)) {
-        cerr << "error:[vg-clip] -s and -S cannot (yet?) be used with -d or -D" << endl;
+    // the combined modes are applied one after the other to the whole graph, since the
+    // snarls and path positions that the BED modes use would go stale after the first
+    int clip_mode_count = (min_depth >= 0) + (max_deletion >= 0) + (stub_clipping || stubbify_reference);
+    if (clip_mode_count > 1 && !bed_path.empty()) {
+        cerr << "error:[vg-clip] -d, -D and -s/-S can only be combined with -P" << endl;
         return 1;
     }
     
@@ -344,12 +340,13 @@ int main_clip(int argc, char** argv) {
             // do the contained snarls
             clip_contained_low_depth_nodes_and_edges(graph.get(), pp_graph, bed_regions, *snarl_manager, false, min_depth, min_fragment_len, verbose);
         }
-        
-    } else if (max_deletion >= 0) {
+    }
+    if (max_deletion >= 0) {
         // run the deletion edge clipping on the whole graph
         clip_deletion_edges(graph.get(), max_deletion, context_steps, ref_prefixes, min_fragment_len, verbose);
-    } else if (stub_clipping || stubbify_reference) {
-        // run the stub clipping
+    }
+    if (stub_clipping || stubbify_reference) {
+        // run the stub clipping last, since the other modes can leave stubs behind
         if (bed_path.empty()) {            
             // do the whole graph
             if (stubbify_reference) {
@@ -364,7 +361,8 @@ int main_clip(int argc, char** argv) {
             // do the contained snarls
             clip_contained_stubs(graph.get(), pp_graph, bed_regions, *snarl_manager, false, min_fragment_len, verbose);
         }        
-    }else {
+    }
+    if (clip_mode_count == 0) {
         // run the alt-allele clipping
         clip_contained_snarls(graph.get(), pp_graph, bed_regions, *snarl_manager, false, min_fragment_len,
                               max_nodes, max_edges, max_nodes_shallow, max_edges_shallow, max_avg_degree, max_reflen_prop, max_reflen, out_bed, verbose);
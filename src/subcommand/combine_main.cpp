@@ -19,6 +19,7 @@
 #include "../handle.hpp"
 #include "../vg.hpp"
 #include "../io/save_handle_graph.hpp"
+#include "../io/load_joined_graphs.hpp"
 
 using namespace std;
 using namespace vg;
@@ -34,7 +35,8 @@ void help_combine(char** argv) {
          << "                          Node IDs not modified [DEPRECATED]" << endl
          << "    -p, --connect-paths   Add edges necessary to connect paths with the same name present in different graphs." << endl
          << "                          ex: If path x is present in graphs N-1 and N, then an edge connecting the last node of x in N-1 " << endl
-         << "                          and the first node of x in N will be added." << endl;
+         << "                          and the first node of x in N will be added." << endl
+         << "    -t, --threads N       number of graphs to load in parallel [all available threads]" << endl;
 }
 
 static int cat_proto_graphs(int argc, char** argv);
@@ -57,11 +59,12 @@ int main_combine(int argc, char** argv) {
             {"help", no_argument, 0, 'h'},
             {"connect-paths", no_argument, 0, 'p'},
             {"cat-proto", no_argument, 0, 'c'},
+            {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hpc",
+        c = getopt_long (argc, argv, "hpct:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -76,6 +79,9 @@ int main_combine(int argc, char** argv) {
         case 'c':
             cat_proto = true;
             break;
+        case 't':
+            omp_set_num_threads(parse<int>(optarg));
+            break;
         case 'h':
         case '?':
             help_combine(argv);
@@ -93,25 +99,17 @@ int main_combine(int argc, char** argv) {
         return cat_proto_graphs(argc, argv);
     }
     
-    unique_ptr<MutablePathMutableHandleGraph> first_graph;
-    string first_graph_filename = get_input_file_name(optind, argc, argv);
-    first_graph = vg::io::VPKG::load_one<MutablePathMutableHandleGraph>(first_graph_filename);
-    int64_t max_node_id = first_graph->max_node_id();
-
+    vector<string> graph_filenames;
     while (optind < argc) {
+        graph_filenames.push_back(get_input_file_name(optind, argc, argv));
+    }
 
-        unique_ptr<MutablePathMutableHandleGraph> graph;
-        string graph_filename = get_input_file_name(optind, argc, argv);
-        graph = vg::io::VPKG::load_one<MutablePathMutableHandleGraph>(graph_filename);
-
-        // join the id spaces if necessary
-        int64_t delta = max_node_id - graph->min_node_id();
-        if (delta >= 0) {
-            graph->increment_node_ids(delta + 1);
-        }
-        max_node_id = graph->max_node_id();
-
-        if (connect_paths) {
+    // load and join the id spaces of the graphs in parallel, and merge them in order
+    unique_ptr<MutablePathMutableHandleGraph> first_graph;
+    vg::io::for_each_joined_graph(graph_filenames, get_thread_count(), [&](unique_ptr<MutablePathMutableHandleGraph>& graph) {
+        if (!first_graph) {
+            first_graph = std::move(graph);
+        } else if (connect_paths) {
             handlealgs::append_path_handle_graph(graph.get(), first_graph.get(), true);
         } else {
             graph->for_each_path_handle([&](path_handle_t path_handle) {
@@ -122,8 +120,8 @@ int main_combine(int argc, char** argv) {
                     }
                 });
             handlealgs::copy_path_handle_graph(graph.get(), first_graph.get());
-        }        
-    }
+        }
+    });
 
     // Serialize the graph using VPKG.
     vg::io::save_handle_graph(first_graph.get(), cout);
@@ -17,6 +17,7 @@
 #include <vg/io/stream.hpp>
 #include <vg/io/vpkg.hpp>
 #include "../io/save_handle_graph.hpp"
+#include "../io/load_joined_graphs.hpp"
 #include <handlegraph/mutable_path_mutable_handle_graph.hpp>
 
 using namespace std;
@@ -31,6 +32,7 @@ void help_concat(char** argv) {
          << endl
          << "Options:" << endl
          << "    -p, --only-join-paths         Only add edges necessary to join up appended paths (as opposed between all heads/tails)" << endl
+         << "    -t, --threads N               number of graphs to load in parallel [all available threads]" << endl
          << endl;
 }
 
@@ -50,11 +52,12 @@ int main_concat(int argc, char** argv) {
         {
             {"help", no_argument, 0, 'h'},
             {"only-join-paths", no_argument, 0, 'p'},
+            {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hp",
+        c = getopt_long (argc, argv, "hpt:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -66,6 +69,9 @@ int main_concat(int argc, char** argv) {
         case 'p':
             only_join_paths = true;
             break;
+        case 't':
+            omp_set_num_threads(parse<int>(optarg));
+            break;
         case 'h':
         case '?':
             help_concat(argv);
@@ -76,28 +82,20 @@ int main_concat(int argc, char** argv) {
         }
     }
 
-    unique_ptr<MutablePathMutableHandleGraph> first_graph;
-    get_input_file(optind, argc, argv, [&](istream& in) {
-            first_graph = vg::io::VPKG::load_one<MutablePathMutableHandleGraph>(in);
-        });
-    int64_t max_node_id = first_graph->max_node_id();
-
+    vector<string> graph_filenames;
     while (optind < argc) {
+        graph_filenames.push_back(get_input_file_name(optind, argc, argv));
+    }
 
-        unique_ptr<MutablePathMutableHandleGraph> graph;
-        get_input_file(optind, argc, argv, [&](istream& in) {
-                graph = vg::io::VPKG::load_one<MutablePathMutableHandleGraph>(in);
-            });
-
-        // join the id spaces if necessary
-        int64_t delta = max_node_id - graph->min_node_id();
-        if (delta >= 0) {
-            graph->increment_node_ids(delta + 1);
+    // load and join the id spaces of the graphs in parallel, and append them in order
+    unique_ptr<MutablePathMutableHandleGraph> first_graph;
+    vg::io::for_each_joined_graph(graph_filenames, get_thread_count(), [&](unique_ptr<MutablePathMutableHandleGraph>& graph) {
+        if (!first_graph) {
+            first_graph = std::move(graph);
+        } else {
+            handlealgs::append_path_handle_graph(graph.get(), first_graph.get(), only_join_paths);
         }
-        max_node_id = graph->max_node_id();
-
-        handlealgs::append_path_handle_graph(graph.get(), first_graph.get(), only_join_paths);
-    }
+    });
 
     // Serialize the graph using VPKG.
     vg::io::save_handle_graph(first_graph.get(), cout);
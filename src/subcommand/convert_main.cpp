@@ -8,6 +8,8 @@
 #include "../gfa.hpp"
 #include "../gbwt_helper.hpp"
 #include "../gbwtgraph_helper.hpp"
+#include "../hts_alignment_emitter.hpp"
+#include "../columnar_alignments.hpp"
 #include <vg/io/stream.hpp>
 #include <vg/io/vpkg.hpp>
 #include <vg/io/alignment_emitter.hpp>
@@ -28,7 +30,7 @@ using namespace vg::io;
 //------------------------------------------------------------------------------
 
 // We need a type for describing what kind of input to parse.
-enum input_type { input_handlegraph, input_gam, input_gaf, input_gfa, input_gbwtgraph };
+enum input_type { input_handlegraph, input_gam, input_gaf, input_gamc, input_gfa, input_gbwtgraph };
 const input_type INPUT_DEFAULT = input_handlegraph;
 
 // We also need a type for a tri-state for deciding what kind of GFA output algorithm to use.
@@ -56,6 +58,7 @@ int main_convert(int argc, char** argv) {
     int64_t input_rgfa_rank = 0;
     string gfa_trans_path;
     string input_aln;
+    string alignment_output_format;
     string gbwt_name;
     unordered_set<string> ref_samples;
     bool drop_haplotypes = false;
@@ -78,6 +81,8 @@ int main_convert(int argc, char** argv) {
     constexpr int OPT_GBWTGRAPH_ALGORITHM = 1001;
     constexpr int OPT_VG_ALGORITHM = 1002;
     constexpr int OPT_NO_TRANSLATION = 1003;
+    constexpr int OPT_GAM_TO_GAMC = 1004;
+    constexpr int OPT_GAMC_TO_GAM = 1005;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -105,6 +110,8 @@ int main_convert(int argc, char** argv) {
             {"no-translation", no_argument, 0, OPT_NO_TRANSLATION},
             {"gam-to-gaf", required_argument, 0, 'G'},
             {"gaf-to-gam", required_argument, 0, 'F'},
+            {"gam-to-gamc", required_argument, 0, OPT_GAM_TO_GAMC},
+            {"gamc-to-gam", required_argument, 0, OPT_GAMC_TO_GAM},
             {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
 
@@ -185,11 +192,25 @@ int main_convert(int argc, char** argv) {
             no_multiple_inputs(input);
             input = input_gam;
             input_aln = optarg;
+            alignment_output_format = "GAF";
             break;
         case 'F':
             no_multiple_inputs(input);
             input = input_gaf;
             input_aln = optarg;
+            alignment_output_format = "GAM";
+            break;
+        case OPT_GAM_TO_GAMC:
+            no_multiple_inputs(input);
+            input = input_gam;
+            input_aln = optarg;
+            alignment_output_format = "GAMC";
+            break;
+        case OPT_GAMC_TO_GAM:
+            no_multiple_inputs(input);
+            input = input_gamc;
+            input_aln = optarg;
+            alignment_output_format = "GAM";
             break;
         case 't':
             {
@@ -238,29 +259,53 @@ int main_convert(int argc, char** argv) {
 
     
     // with -F or -G we convert an alignment and not a graph
-    if (input == input_gam || input == input_gaf) {
+    if (input == input_gam || input == input_gaf || input == input_gamc) {
         if (!output_format.empty()) {
-            cerr << "error [vg convert]: Alignment conversion options (-F and -G) cannot be used "
-                 << "with any graph conversion options" << endl;
+            cerr << "error [vg convert]: Alignment conversion options (-F, -G, --gam-to-gamc, and --gamc-to-gam) "
+                 << "cannot be used with any graph conversion options" << endl;
             return 1;
         }
 
+        // Only GAF needs a graph, for node lengths and sequences.
         unique_ptr<HandleGraph> input_graph;
-        string input_graph_filename = get_input_file_name(optind, argc, argv);
-        input_graph = vg::io::VPKG::load_one<HandleGraph>(input_graph_filename);
+        if (input == input_gaf || alignment_output_format == "GAF") {
+            string input_graph_filename = get_input_file_name(optind, argc, argv);
+            input_graph = vg::io::VPKG::load_one<HandleGraph>(input_graph_filename);
+        }
 
-        unique_ptr<AlignmentEmitter> emitter = get_non_hts_alignment_emitter("-", (input == input_gam) ? "GAF" : "GAM", {}, get_thread_count(),
-                                                                             input_graph.get());
+        unique_ptr<AlignmentEmitter> emitter = get_alignment_emitter("-", alignment_output_format, {}, get_thread_count(),
+                                                                     input_graph.get());
+        // Each thread moves its converted alignments into a batch and hands
+        // the whole batch to the emitter, instead of copying every alignment
+        // into a batch of its own. The emitter compresses and writes the
+        // batches from each thread in parallel.
+        constexpr size_t EMIT_BATCH_SIZE = 512;
+        vector<vector<Alignment>> batches(omp_get_max_threads());
         std::function<void(Alignment&)> lambda = [&] (Alignment& aln) {
-            emitter->emit_singles({aln});
+            vector<Alignment>& batch = batches[omp_get_thread_num()];
+            batch.emplace_back(std::move(aln));
+            if (batch.size() >= EMIT_BATCH_SIZE) {
+                emitter->emit_singles(std::move(batch));
+                batch.clear();
+                batch.reserve(EMIT_BATCH_SIZE);
+            }
         };                
         if (input == input_gam) {
             get_input_file(input_aln, [&](istream& in) {
                     vg::io::for_each_parallel(in, lambda);
             });
+        } else if (input == input_gamc) {
+            get_input_file(input_aln, [&](istream& in) {
+                    for_each_gamc_parallel(in, lambda);
+            });
         } else {
             gaf_unpaired_for_each_parallel(*input_graph, input_aln, lambda);
         }
+        for (auto& batch : batches) {
+            if (!batch.empty()) {
+                emitter->emit_singles(std::move(batch));
+            }
+        }
         return 0;
     }
 
@@ -299,12 +344,32 @@ int main_convert(int argc, char** argv) {
         if (output_format == "xg") {
             xg::XG* xg_graph = dynamic_cast<xg::XG*>(output_graph.get());
             
-            // Need to go through a handle graph
-            bdsg::HashGraph intermediate;
-            cerr << "warning [vg convert]: currently cannot convert GFA directly to XG; converting through another format" << endl;
-            algorithms::gfa_to_path_handle_graph(input_stream_name, &intermediate,
-                                                 input_rgfa_rank, gfa_trans_path);
-            graph_to_xg_adjusting_paths(&intermediate, xg_graph, ref_samples, drop_haplotypes);
+            try {
+                if (ref_samples.empty()) {
+                    // We can go straight to XG
+                    unordered_set<PathSense> ignore_sense;
+                    if (drop_haplotypes) {
+                        ignore_sense.insert(PathSense::HAPLOTYPE);
+                    }
+                    algorithms::gfa_to_xg(input_stream_name, xg_graph, input_rgfa_rank, gfa_trans_path, &ignore_sense);
+                }
+                else {
+                    // Promoting haplotypes to reference needs to look at all
+                    // the paths first, so we go through a handle graph
+                    bdsg::HashGraph intermediate;
+                    algorithms::gfa_to_path_handle_graph(input_stream_name, &intermediate,
+                                                         input_rgfa_rank, gfa_trans_path);
+                    graph_to_xg_adjusting_paths(&intermediate, xg_graph, ref_samples, drop_haplotypes);
+                }
+            } catch (algorithms::GFAFormatError& e) {
+                cerr << "error [vg convert]: Input GFA is not acceptable." << endl;
+                cerr << e.what() << endl;
+                exit(1);
+            } catch (std::ios_base::failure& e) {
+                cerr << "error [vg convert]: IO error processing input GFA." << endl;
+                cerr << e.what() << endl;
+                exit(1);
+            }
         }
         else {
             // If the GFA doesn't have forward references, we can handle it
@@ -496,13 +561,15 @@ void help_convert(char** argv) {
          << "alignment options:" << endl
          << "    -G, --gam-to-gaf FILE  convert GAM FILE to GAF" << endl
          << "    -F, --gaf-to-gam FILE  convert GAF FILE to GAM" << endl
+         << "    --gam-to-gamc FILE     convert GAM FILE to columnar GAMC (no graph needed)" << endl
+         << "    --gamc-to-gam FILE     convert GAMC FILE to GAM (no graph needed)" << endl
          << "general options:" << endl
          << "    -t, --threads N        use N threads (defaults to numCPUs)" << endl;
 }
 
 void no_multiple_inputs(input_type input) {
     if (input != INPUT_DEFAULT) {
-        std::cerr << "error [vg convert]: cannot combine input types (GFA, GBWTGraph, GBZ, GAM, GAF)" << std::endl;
+        std::cerr << "error [vg convert]: cannot combine input types (GFA, GBWTGraph, GBZ, GAM, GAF, GAMC)" << std::endl;
         std::exit(EXIT_FAILURE);
     }
 }
@@ -53,6 +53,9 @@ void help_deconstruct(char** argv){
          << "    -K, --keep-conflicted    Retain conflicted genotypes in output." << endl
          << "    -S, --strict-conflicts   Drop genotypes when we have more than one haplotype for any given phase (set by default when using GBWT input)." << endl
          << "    -C, --contig-only-ref    Only use the CONTIG name (and not SAMPLE#CONTIG#HAPLOTYPE etc) for the reference if possible (ie there is only one reference sample)." << endl
+         << "    -F, --fingerprints-out FILE  Write a fingerprint of each snarl's graph and path content to FILE." << endl
+         << "    -i, --prior-vcf FILE     Only deconstruct snarls that changed since the run that wrote FILE, reusing its records for the rest." << endl
+         << "    -f, --prior-fingerprints FILE  Fingerprints written with -F by the run that wrote the -i VCF." << endl
          << "    -t, --threads N          Use N threads" << endl
          << "    -v, --verbose            Print some status messages" << endl
          << endl;
@@ -81,6 +84,9 @@ int main_deconstruct(int argc, char** argv){
     int context_jaccard_window = 10000;
     bool untangle_traversals = false;
     bool contig_only_ref = false;
+    string prior_vcf_name;
+    string prior_fingerprints_name;
+    string fingerprints_out_name;
     
     int c;
     optind = 2; // force optind past command positional argument
@@ -103,13 +109,16 @@ int main_deconstruct(int argc, char** argv){
                 {"keep-conflicted", no_argument, 0, 'K'},
                 {"strict-conflicts", no_argument, 0, 'S'},
                 {"contig-only-ref", no_argument, 0, 'C'},                
+                {"fingerprints-out", required_argument, 0, 'F'},
+                {"prior-vcf", required_argument, 0, 'i'},
+                {"prior-fingerprints", required_argument, 0, 'f'},
                 {"threads", required_argument, 0, 't'},
                 {"verbose", no_argument, 0, 'v'},
                 {0, 0, 0, 0}
             };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hp:P:H:r:g:T:OeKSCd:c:uat:v",
+        c = getopt_long (argc, argv, "hp:P:H:r:g:T:OeKSCd:c:uaF:i:f:t:v",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -164,6 +173,15 @@ int main_deconstruct(int argc, char** argv){
         case 'C':
             contig_only_ref = true;
             break;            
+        case 'F':
+            fingerprints_out_name = optarg;
+            break;
+        case 'i':
+            prior_vcf_name = optarg;
+            break;
+        case 'f':
+            prior_fingerprints_name = optarg;
+            break;
         case 't':
             omp_set_num_threads(parse<int>(optarg));
             break;
@@ -216,6 +234,17 @@ int main_deconstruct(int argc, char** argv){
         return 1;
     }
 
+    if (prior_vcf_name.empty() != prior_fingerprints_name.empty()) {
+        cerr << "Error [vg deconstruct]: -i and -f must be used together" << endl;
+        return 1;
+    }
+
+    if ((!prior_vcf_name.empty() || !fingerprints_out_name.empty()) && (!gbwt_file_name.empty() || gbz_graph)) {
+        // the fingerprints only see the graph's paths, not the GBWT's haplotypes
+        cerr << "Error [vg deconstruct]: -i, -f and -F cannot be used with -g or GBZ input" << endl;
+        return 1;
+    }
+
     if (!gbwt_file_name.empty() || gbz_graph) {
         // context jaccard depends on having steps for each alt traversal, which is
         // not something we have on hand when getting traversals from the GBWT/GBZ
@@ -352,6 +381,12 @@ int main_deconstruct(int argc, char** argv){
     }
     dd.set_translation(translation.get());
     dd.set_nested(all_snarls);
+    if (!prior_vcf_name.empty()) {
+        dd.set_prior_run(prior_vcf_name, prior_fingerprints_name);
+    }
+    if (!fingerprints_out_name.empty()) {
+        dd.set_fingerprint_output(fingerprints_out_name);
+    }
     dd.deconstruct(refpaths, graph, snarl_manager.get(), path_restricted_traversals, ploidy,
                    all_snarls,
                    context_jaccard_window,
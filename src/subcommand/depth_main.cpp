@@ -37,6 +37,8 @@ void help_depth(char** argv) {
          << "    -n, --max-nodes N      maximum nodes to consider [1000000]" << endl
          << "    -s, --random-seed N    random seed for sampling nodes to consider" << endl
          << "    -Q, --min-mapq N       ignore alignments with mapping quality < N [0]" << endl
+         << "    -e, --precision F      for a sorted GAM indexed with vg gamsort -i, only look up sampled nodes until the" << endl
+         << "                           95% confidence interval of the mean is within this fraction of it [0 = read everything]" << endl
          << "  path coverage depth (print 1-based positional depths along path):" << endl
          << "     activate by specifiying -p without -k" << endl
          << "    -c, --count-cycles     count each time a path steps on a position (by default paths are only counted once)" << endl
@@ -66,6 +68,7 @@ int main_depth(int argc, char** argv) {
     size_t max_nodes = 1000000;
     int random_seed = time(NULL);
     size_t min_mapq = 0;
+    double target_precision = 0;
     bool count_cycles = false;
 
     size_t min_coverage = 1;
@@ -85,6 +88,7 @@ int main_depth(int argc, char** argv) {
             {"max-nodes", required_argument, 0, 'n'},
             {"random-seed", required_argument, 0, 's'},
             {"min-mapq", required_argument, 0, 'Q'},
+            {"precision", required_argument, 0, 'e'},
             {"min-coverage", required_argument, 0, 'm'},
             {"count-cycles", no_argument, 0, 'c'},
             {"threads", required_argument, 0, 't'},
@@ -93,7 +97,7 @@ int main_depth(int argc, char** argv) {
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hk:p:P:b:dg:a:n:s:m:ct:",
+        c = getopt_long (argc, argv, "hk:p:P:b:dg:a:n:s:Q:e:m:ct:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -132,6 +136,13 @@ int main_depth(int argc, char** argv) {
         case 'Q':
             min_mapq = parse<size_t>(optarg);
             break;
+        case 'e':
+            target_precision = parse<double>(optarg);
+            if (target_precision < 0) {
+                cerr << "error:[vg depth] Precision (-e) must be nonnegative" << endl;
+                exit(1);
+            }
+            break;
         case 'm':
             min_coverage = parse<size_t>(optarg);
             break;
@@ -171,6 +182,10 @@ int main_depth(int argc, char** argv) {
         cerr << "error:[vg depth] At most one of a pack file (-k), a GAM file (-g), or a GAF file (-a) must be given" << endl;
         exit(1);
     }
+    if (target_precision > 0 && (gam_filename.empty() || gam_filename == "-")) {
+        cerr << "error:[vg depth] Precision (-e) can only be used with an indexed GAM file (-g)" << endl;
+        exit(1);
+    }
 
     // Read the graph
     unique_ptr<PathHandleGraph> path_handle_graph;
@@ -230,26 +245,38 @@ int main_depth(int argc, char** argv) {
             }
         }
 
-        for (const auto& ref_coord_path : ref_paths) {
-            const string& ref_path = ref_coord_path.second;
-            const string& base_path = ref_coord_path.first.first;
-            const size_t subpath_offset = ref_coord_path.first.second;
-            
-            if (bin_size > 1) {
-                vector<tuple<size_t, size_t, double, double>> binned_depth;
+        if (bin_size > 1) {
+            // bins are small, so we can compute all the paths' bins up front. with enough paths
+            // to go around, give each thread its own paths.  otherwise, use all the threads on each path.
+            vector<const pair<const pair<string, int64_t>, string>*> ref_path_list;
+            for (const auto& ref_coord_path : ref_paths) {
+                ref_path_list.push_back(&ref_coord_path);
+            }
+            vector<vector<tuple<size_t, size_t, double, double>>> binned_depths(ref_path_list.size());
+#pragma omp parallel for schedule(dynamic, 1) if (ref_path_list.size() >= (size_t)get_thread_count())
+            for (size_t i = 0; i < ref_path_list.size(); ++i) {
+                const string& ref_path = ref_path_list[i]->second;
                 if (!pack_filename.empty()) {
-                    binned_depth = algorithms::binned_packed_depth(*packer, ref_path, bin_size, min_coverage, count_dels);
+                    binned_depths[i] = algorithms::binned_packed_depth(*packer, ref_path, bin_size, min_coverage, count_dels);
                 } else {
-                    binned_depth = algorithms::binned_path_depth(*graph, ref_path, bin_size, min_coverage, count_cycles);
+                    binned_depths[i] = algorithms::binned_path_depth(*graph, ref_path, bin_size, min_coverage, count_cycles);
                 }
-                for (auto& bin_cov : binned_depth) {
+            }
+            for (size_t i = 0; i < ref_path_list.size(); ++i) {
+                const string& base_path = ref_path_list[i]->first.first;
+                const size_t subpath_offset = ref_path_list[i]->first.second;
+                for (auto& bin_cov : binned_depths[i]) {
                     // bins can ben nan if min_coverage filters everything out.  just skip
                     if (!isnan(get<3>(bin_cov))) {
                         cout << base_path << "\t" << (get<0>(bin_cov) + 1 + subpath_offset)<< "\t" << (get<1>(bin_cov) + 1 + subpath_offset) << "\t" << get<2>(bin_cov)
                              << "\t" << sqrt(get<3>(bin_cov)) << endl;
                     }
                 }
-            } else {
+                vector<tuple<size_t, size_t, double, double>>().swap(binned_depths[i]);
+            }
+        } else {
+            for (const auto& ref_coord_path : ref_paths) {
+                const string& ref_path = ref_coord_path.second;
                 if (!pack_filename.empty()) {
                     algorithms::packed_depths(*packer, ref_path, min_coverage, cout);
                 } else {
@@ -263,8 +290,18 @@ int main_depth(int argc, char** argv) {
     if (!gam_filename.empty() || !gaf_filename.empty()) {
         const string& mapping_filename = !gam_filename.empty() ? gam_filename : gaf_filename;
         pair<double, double> mapping_cov;
-        mapping_cov = algorithms::sample_mapping_depth(*graph, mapping_filename, max_nodes, random_seed,
-                                                       min_coverage, min_mapq, !gam_filename.empty() ? "GAM" : "GAF");
+        if (target_precision > 0) {
+            try {
+                mapping_cov = algorithms::sample_indexed_mapping_depth(*graph, mapping_filename, max_nodes, random_seed,
+                                                                       min_coverage, min_mapq, target_precision);
+            } catch (const runtime_error& e) {
+                cerr << "error:[vg depth] " << e.what() << endl;
+                exit(1);
+            }
+        } else {
+            mapping_cov = algorithms::sample_mapping_depth(*graph, mapping_filename, max_nodes, random_seed,
+                                                           min_coverage, min_mapq, !gam_filename.empty() ? "GAM" : "GAF");
+        }
         cout << mapping_cov.first << "\t" << sqrt(mapping_cov.second) << endl;
     }
         
@@ -7,6 +7,8 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <mutex>
+#include <functional>
 
 #include "subcommand.hpp"
 
@@ -31,6 +33,8 @@ void help_gamcompare(char** argv) {
          << "    -T, --tsv                  output TSV (correct, mq, aligner, read) compatible with plot-qq.R instead of GAM" << endl
          << "    -a, --aligner              aligner name for TSV output [\"vg\"]" << endl
          << "    -s, --score-alignment      get a correctness score of the alignment (higher is better)" << endl
+         << "    -b, --buckets N            partition the reads into N temporary files by name and compare them in parallel," << endl
+         << "                               to bound memory use (output order may differ)" << endl
          << "    -t, --threads N            number of threads to use" << endl;
 }
 
@@ -92,6 +96,7 @@ int main_gamcompare(int argc, char** argv) {
     }
 
     int threads = 1;
+    size_t buckets = 0;
     int64_t range = -1;
     bool output_tsv = false;
     string aligner_name = "vg";
@@ -112,12 +117,13 @@ int main_gamcompare(int argc, char** argv) {
             {"tsv", no_argument, 0, 'T'},
             {"aligner", required_argument, 0, 'a'},
             {"score-alignment", no_argument, 0, 's'},
+            {"buckets", required_argument, 0, 'b'},
             {"threads", required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hd:r:n:Ta:st:",
+        c = getopt_long (argc, argv, "hd:r:n:Ta:sb:t:",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -163,6 +169,10 @@ int main_gamcompare(int argc, char** argv) {
             score_alignment = true;
             break;
 
+        case 'b':
+            buckets = parse<size_t>(optarg);
+            break;
+
         case 't':
             threads = parse<int>(optarg);
             omp_set_num_threads(threads);
@@ -183,10 +193,35 @@ int main_gamcompare(int argc, char** argv) {
     string test_file_name = get_input_file_name(optind, argc, argv);
     string truth_file_name = get_input_file_name(optind, argc, argv);
 
+    if (truth_file_name == "-" && test_file_name == "-") {
+        cerr << "error[vg gamcompare]: Standard input can only be used for truth or test file, not both" << endl;
+        exit(1);
+    }
+
+    // Open the named file or standard input, if it looks good, and pass it along
+    auto with_input = [](const string& file_name, const string& looking_for,
+                         const function<void(istream&)>& use_input) {
+        if (file_name == "-") {
+            if (!std::cin) {
+                cerr << "error[vg gamcompare]: Unable to read standard input when looking for " << looking_for << endl;
+                exit(1);
+            }
+            use_input(std::cin);
+        } else {
+            ifstream file_in(file_name);
+            if (!file_in) {
+                cerr << "error[vg gamcompare]: Unable to read " << file_name << " when looking for " << looking_for << endl;
+                exit(1);
+            }
+            use_input(file_in);
+        }
+    };
+
     // True path positions. For each alignment name, store a mapping from reference path names
     // to sets of (sequence offset, is_reverse). There is usually either one position per
     // alignment or one position per node.
-    vg::string_hash_map<string, map<string, vector<pair<size_t, bool> > > > true_path_positions;
+    typedef vg::string_hash_map<string, map<string, vector<pair<size_t, bool> > > > path_position_table_t;
+    path_position_table_t true_path_positions;
     function<void(Alignment&)> record_path_positions = [&true_path_positions](Alignment& aln) {
         auto val = alignment_refpos_to_path_offsets(aln);
 #pragma omp critical (truth_table)
@@ -195,7 +230,8 @@ int main_gamcompare(int argc, char** argv) {
 
     // True graph positions. For each alignment name, we find the maximal read intervals that correspond
     // to a gapless alignment between the read and a single node.
-    vg::string_hash_map<string, std::vector<MappingRun>> true_graph_positions;
+    typedef vg::string_hash_map<string, std::vector<MappingRun>> graph_position_table_t;
+    graph_position_table_t true_graph_positions;
     function<void(Alignment&)> record_graph_positions = [&true_graph_positions](Alignment& aln) {
         if (aln.path().mapping_size() > 0) {
 #pragma omp critical (truth_table)
@@ -203,33 +239,53 @@ int main_gamcompare(int argc, char** argv) {
         }
     };
 
-    if (truth_file_name == "-") {
-        // Read truth fropm standard input, if it looks good.
-        if (test_file_name == "-") {
-            cerr << "error[vg gamcompare]: Standard input can only be used for truth or test file, not both" << endl;
-            exit(1);
-        }
-        if (!std::cin) {
-            cerr << "error[vg gamcompare]: Unable to read standard input when looking for true reads" << endl;
-            exit(1);
-        }
-        if (distance_name.empty()) {
-            vg::io::for_each_parallel(std::cin, record_path_positions);
-        } else {
-            vg::io::for_each_parallel(std::cin, record_graph_positions);
+    // The temporary files that the truth and test reads are partitioned into, if bucketing
+    vector<string> truth_bucket_names;
+    vector<string> test_bucket_names;
+
+    // Split reads into temporary files by the hash of their names, so that each read
+    // ends up in the same bucket as its truth
+    auto partition_reads = [&](istream& in, vector<string>& bucket_names, bool is_truth) {
+        vector<unique_ptr<ofstream>> bucket_files;
+        vector<unique_ptr<vg::io::ProtobufEmitter<Alignment>>> bucket_emitters;
+        vector<mutex> bucket_mutexes(buckets);
+        for (size_t i = 0; i < buckets; ++i) {
+            bucket_names.push_back(temp_file::create(is_truth ? "gamcompare-truth-" : "gamcompare-test-"));
+            bucket_files.emplace_back(new ofstream(bucket_names.back()));
+            if (!*bucket_files.back()) {
+                cerr << "error[vg gamcompare]: Unable to write temporary file " << bucket_names.back() << endl;
+                exit(1);
+            }
+            bucket_emitters.emplace_back(new vg::io::ProtobufEmitter<Alignment>(*bucket_files.back()));
         }
+        function<void(Alignment&)> write_to_bucket = [&](Alignment& aln) {
+            if (is_truth) {
+                // We only need the name, path, and positions of the truth
+                aln.clear_sequence();
+                aln.clear_quality();
+            }
+            size_t bucket = std::hash<string>()(aln.name()) % buckets;
+            lock_guard<mutex> guard(bucket_mutexes[bucket]);
+            bucket_emitters[bucket]->write(std::move(aln));
+        };
+        vg::io::for_each_parallel(in, write_to_bucket);
+        // Flush the emitters before closing their files
+        bucket_emitters.clear();
+        bucket_files.clear();
+    };
+
+    if (buckets > 0) {
+        with_input(truth_file_name, "true reads", [&](istream& in) {
+            partition_reads(in, truth_bucket_names, true);
+        });
+    } else if (distance_name.empty()) {
+        with_input(truth_file_name, "true reads", [&](istream& in) {
+            vg::io::for_each_parallel(in, record_path_positions);
+        });
     } else {
-        // Read truth from this file, if it looks good.
-        ifstream truth_file_in(truth_file_name);
-        if (!truth_file_in) {
-            cerr << "error[vg gamcompare]: Unable to read " << truth_file_name << " when looking for true reads" << endl;
-            exit(1);
-        }
-        if (distance_name.empty()) {
-            vg::io::for_each_parallel(truth_file_in, record_path_positions);
-        } else {
-            vg::io::for_each_parallel(truth_file_in, record_graph_positions);
-        }
+        with_input(truth_file_name, "true reads", [&](istream& in) {
+            vg::io::for_each_parallel(in, record_graph_positions);
+        });
     }
     if (score_alignment && range == -1) {
         cerr << "error[vg gamcompare]: Score-alignment requires range" << endl;
@@ -285,8 +341,10 @@ int main_gamcompare(int argc, char** argv) {
         correct_count_by_mapq_by_thread[i].resize(61,0);
     }
    
-    // This function annotates every read with distance and correctness, and batch-outputs them.
-    function<void(Alignment&)> annotate_test = [&](Alignment& aln) {
+    // This function annotates a read with distance and correctness against the given truth
+    // tables, and batch-outputs it.
+    auto annotate_against = [&](Alignment& aln, const path_position_table_t& true_path_positions,
+                                const graph_position_table_t& true_graph_positions) {
         bool found = false;
         if (distance_name.empty()) {
             //If the distance index isn't used
@@ -386,19 +444,44 @@ int main_gamcompare(int argc, char** argv) {
         }
     };
 
-    if (test_file_name == "-") {
-        if (!std::cin) {
-            cerr << "error[vg gamcompare]: Unable to read standard input when looking for reads under test" << endl;
-            exit(1);
+    if (buckets > 0) {
+        with_input(test_file_name, "reads under test", [&](istream& in) {
+            partition_reads(in, test_bucket_names, false);
+        });
+
+        // Each bucket's truth fits in memory on its own, so compare the buckets in parallel
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t i = 0; i < buckets; ++i) {
+            path_position_table_t bucket_path_positions;
+            graph_position_table_t bucket_graph_positions;
+            {
+                ifstream truth_in(truth_bucket_names[i]);
+                function<void(Alignment&)> record_truth = [&](Alignment& aln) {
+                    if (distance_name.empty()) {
+                        bucket_path_positions[aln.name()] = alignment_refpos_to_path_offsets(aln);
+                    } else if (aln.path().mapping_size() > 0) {
+                        bucket_graph_positions[aln.name()] = base_mappings(aln);
+                    }
+                };
+                vg::io::for_each(truth_in, record_truth);
+            }
+            temp_file::remove(truth_bucket_names[i]);
+            {
+                ifstream test_in(test_bucket_names[i]);
+                function<void(Alignment&)> annotate_test = [&](Alignment& aln) {
+                    annotate_against(aln, bucket_path_positions, bucket_graph_positions);
+                };
+                vg::io::for_each(test_in, annotate_test);
+            }
+            temp_file::remove(test_bucket_names[i]);
         }
-        vg::io::for_each_parallel(std::cin, annotate_test);
     } else {
-        ifstream test_file_in(test_file_name);
-        if (!test_file_in) {
-            cerr << "error[vg gamcompare]: Unable to read " << test_file_name << " when looking for reads under test" << endl;
-            exit(1);
-        }
-        vg::io::for_each_parallel(test_file_in, annotate_test);
+        function<void(Alignment&)> annotate_test = [&](Alignment& aln) {
+            annotate_against(aln, true_path_positions, true_graph_positions);
+        };
+        with_input(test_file_name, "reads under test", [&](istream& in) {
+            vg::io::for_each_parallel(in, annotate_test);
+        });
     }
 
     if (output_tsv) {
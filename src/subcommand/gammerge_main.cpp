@@ -0,0 +1,154 @@
+/** \file gammerge_main.cpp
+ *
+ * Defines the "vg gammerge" subcommand, which merges the mappings of the same
+ * reads against several index partitions into one set of mappings.
+ */
+
+#include <getopt.h>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "subcommand.hpp"
+
+#include "../aligner.hpp"
+#include "../index_partitions.hpp"
+#include "../utility.hpp"
+#include <vg/io/protobuf_emitter.hpp>
+#include <vg/io/protobuf_iterator.hpp>
+
+using namespace std;
+using namespace vg;
+using namespace vg::subcommand;
+
+void help_gammerge(char** argv) {
+    cerr << "usage: " << argv[0] << " gammerge [options] partition1.gam partition2.gam [...] > merged.gam" << endl
+         << endl
+         << "Merge single-end giraffe mappings of the same reads against different index" << endl
+         << "partitions (see vg autoindex --partition). Each input must come from a" << endl
+         << "vg giraffe --ordered-output run on the same FASTQ, so reads are in the same order." << endl
+         << "The best mapping of each read wins, and its MAPQ accounts for the candidates" << endl
+         << "found in all the partitions." << endl
+         << endl
+         << "options:" << endl
+         << "    -M, --max-multimaps N  output up to N mappings per read [1]" << endl
+         << "    -h, --help             print this help message to stderr and exit" << endl;
+}
+
+int main_gammerge(int argc, char** argv) {
+
+    if (argc == 2) {
+        help_gammerge(argv);
+        return 1;
+    }
+
+    size_t max_multimaps = 1;
+
+    int c;
+    optind = 2; // force optind past command positional argument
+    while (true) {
+        static struct option long_options[] =
+        {
+            {"max-multimaps", required_argument, 0, 'M'},
+            {"help", no_argument, 0, 'h'},
+            {0, 0, 0, 0}
+        };
+
+        int option_index = 0;
+        c = getopt_long (argc, argv, "M:h",
+                         long_options, &option_index);
+
+        // Detect the end of the options.
+        if (c == -1)
+            break;
+
+        switch (c)
+        {
+        case 'M':
+            max_multimaps = parse<size_t>(optarg);
+            if (max_multimaps == 0) {
+                cerr << "error:[vg gammerge] max multimaps (-M) must be at least 1" << endl;
+                return 1;
+            }
+            break;
+        case 'h':
+        case '?':
+            help_gammerge(argv);
+            return 1;
+        default:
+            abort();
+        }
+    }
+
+    if (optind >= argc) {
+        cerr << "error:[vg gammerge] no input GAM files given" << endl;
+        return 1;
+    }
+
+    vector<string> filenames;
+    vector<unique_ptr<ifstream>> files;
+    vector<unique_ptr<vg::io::ProtobufIterator<Alignment>>> inputs;
+    for (int i = optind; i < argc; i++) {
+        filenames.emplace_back(argv[i]);
+        files.emplace_back(new ifstream(filenames.back()));
+        if (!*files.back()) {
+            cerr << "error:[vg gammerge] could not open " << filenames.back() << endl;
+            return 1;
+        }
+        inputs.emplace_back(new vg::io::ProtobufIterator<Alignment>(*files.back()));
+    }
+
+    // The scoring parameters only set the MAPQ scale, which giraffe doesn't change
+    Aligner aligner;
+    vg::io::ProtobufEmitter<Alignment> emitter(cout);
+
+    vector<vector<Alignment>> mappings(inputs.size());
+    while (true) {
+        // Take the next read's mappings from each input
+        string read_name;
+        size_t finished = 0;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            mappings[i].clear();
+            auto& input = *inputs[i];
+            if (!input.has_current()) {
+                finished++;
+                continue;
+            }
+            if (i == finished) {
+                read_name = input->name();
+            }
+            if (input->name() != read_name) {
+                cerr << "error:[vg gammerge] " << filenames[i] << " has read " << input->name() << " where "
+                     << read_name << " was expected; were all inputs mapped with --ordered-output?" << endl;
+                return 1;
+            }
+            while (input.has_current() && input->name() == read_name) {
+                if (input->has_fragment_next() || input->has_fragment_prev()) {
+                    cerr << "error:[vg gammerge] " << filenames[i] << " has paired reads, which cannot be merged" << endl;
+                    return 1;
+                }
+                mappings[i].emplace_back(std::move(*input));
+                input.advance();
+            }
+        }
+        if (finished == inputs.size()) {
+            break;
+        }
+        if (finished != 0) {
+            cerr << "error:[vg gammerge] the inputs do not all have the same reads" << endl;
+            return 1;
+        }
+
+        for (auto& aln : merge_partition_mappings(mappings, aligner, max_multimaps)) {
+            emitter.write(std::move(aln));
+        }
+    }
+
+    return 0;
+}
+
+// Register subcommand
+static Subcommand vg_gammerge("gammerge", "merge mappings against index partitions", main_gammerge);
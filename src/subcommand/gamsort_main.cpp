@@ -1,6 +1,7 @@
 #include "../stream_sorter.hpp"
 #include <vg/io/stream.hpp>
 #include "../stream_index.hpp"
+#include "../gaf_sorter.hpp"
 #include <getopt.h>
 #include "subcommand.hpp"
 
@@ -13,10 +14,11 @@ using namespace vg;
 using namespace vg::subcommand;
 void help_gamsort(char **argv)
 {
-    cerr << "gamsort: sort a GAM file, or index a sorted GAM file" << endl
+    cerr << "gamsort: sort a GAM/GAF file, or index a sorted GAM file" << endl
          << "Usage: " << argv[1] << " [Options] gamfile" << endl
          << "Options:" << endl
-         << "  -i / --index FILE       produce an index of the sorted GAM file" << endl
+         << "  -i / --index FILE       produce an index of the sorted GAM/GAF file" << endl
+         << "  -G / --gaf-input        input is GAF (plain, gzip, or BGZF); output is BGZF-compressed GAF" << endl
          << "  -d / --dumb-sort        use naive sorting algorithm (no tmp files, faster for small GAMs)" << endl
          << "  -p / --progress         Show progress." << endl
          << "  -t / --threads          Use the specified number of threads." << endl
@@ -27,6 +29,7 @@ int main_gamsort(int argc, char **argv)
 {
     string index_filename;
     bool easy_sort = false;
+    bool gaf_input = false;
     bool show_progress = false;
     // We limit the max threads, and only allow thread count to be lowered, to
     // prevent tcmalloc from giving each thread a very large heap for many
@@ -41,12 +44,13 @@ int main_gamsort(int argc, char **argv)
             {
                 {"index", required_argument, 0, 'i'},
                 {"dumb-sort", no_argument, 0, 'd'},
+                {"gaf-input", no_argument, 0, 'G'},
                 {"rocks", required_argument, 0, 'r'},
                 {"progress", no_argument, 0, 'p'},
                 {"threads", required_argument, 0, 't'},
                 {0, 0, 0, 0}};
         int option_index = 0;
-        c = getopt_long(argc, argv, "i:dhpt:",
+        c = getopt_long(argc, argv, "i:dGhpt:",
                         long_options, &option_index);
 
         // Detect the end of the options.
@@ -61,6 +65,9 @@ int main_gamsort(int argc, char **argv)
         case 'd':
             easy_sort = true;
             break;
+        case 'G':
+            gaf_input = true;
+            break;
         case 'p':
             show_progress = true;
             break;
@@ -83,6 +90,21 @@ int main_gamsort(int argc, char **argv)
     
     omp_set_num_threads(num_threads);
 
+    if (gaf_input) {
+        // Sort GAF lines with temp files, writing BGZF to standard output.
+        GAFSorter sorter(show_progress);
+        unique_ptr<GAFIndex> index;
+        if (!index_filename.empty()) {
+            index = unique_ptr<GAFIndex>(new GAFIndex());
+        }
+        sorter.sort(get_input_file_name(optind, argc, argv), "-", index.get());
+        if (index.get() != nullptr) {
+            ofstream index_out(index_filename);
+            index->save(index_out);
+        }
+        return 0;
+    }
+
     get_input_file(optind, argc, argv, [&](istream& gam_in) {
 
         GAMSorter gs(show_progress);
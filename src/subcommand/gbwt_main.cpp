@@ -16,6 +16,7 @@
 #include "../haplotype_indexer.hpp"
 #include "../path.hpp"
 #include "../region.hpp"
+#include "../algorithms/component.hpp"
 #include "../algorithms/find_translation.hpp"
 
 #include <vg/io/vpkg.hpp>
@@ -43,6 +44,7 @@ struct GBWTConfig {
     HaplotypeIndexer haplotype_indexer;
     bool gam_format = false, inputs_as_jobs = false, parse_only = false;
     size_t build_jobs = default_build_jobs();
+    bool build_jobs_set = false; // Did the user choose the number of jobs?
 
     // GFA parsing.
     gbwtgraph::GFAParsingParameters gfa_parameters = get_best_gbwtgraph_gfa_parsing_parameters();
@@ -260,7 +262,8 @@ void help_gbwt(char** argv) {
     std::cerr << "        --id-interval N     store path ids at one out of N positions (default " << gbwt::DynamicGBWT::SAMPLE_INTERVAL << ")" << std::endl;
     std::cerr << std::endl;
     std::cerr << "Multithreading:" << std::endl;
-    std::cerr << "        --num-jobs N        use at most N parallel build jobs (for -v, -G, -l, -P; default " << GBWTConfig::default_build_jobs() << ")" << std::endl;
+    std::cerr << "        --num-jobs N        use at most N parallel build jobs (for -v, -G, -l, -P; default " << GBWTConfig::default_build_jobs() << ";" << std::endl;
+    std::cerr << "                            for -G, as many as fit in memory)" << std::endl;
     std::cerr << "        --num-threads N     use N parallel search threads (for -b and -r; default " << omp_get_max_threads() << ")" << std::endl;
     std::cerr << std::endl;
     std::cerr << "Step 1: GBWT construction (requires -o and one of { -v, -G, -Z, -E, A }):" << std::endl;
@@ -569,6 +572,7 @@ GBWTConfig parse_gbwt_config(int argc, char** argv) {
         // Multithreading parameters
         case OPT_NUM_JOBS:
             config.build_jobs = parse<size_t>(optarg);
+            config.build_jobs_set = true;
             break;
         case OPT_NUM_THREADS:
             config.search_threads = std::max(parse<size_t>(optarg), 1ul);
@@ -1339,6 +1343,23 @@ void step_1_build_gbwts(GBWTHandler& gbwts, GraphHandler& graphs, GBWTConfig& co
         if(config.show_progress) {
             std::cerr << "Input type: GFA" << std::endl;
         }
+        if (!config.build_jobs_set || config.show_progress) {
+            // Components are built in parallel jobs, and we can run as many
+            // of them as fit in memory.
+            double scan_start = gbwt::readTimer();
+            GFAStatistics stats = scan_gfa(config.input_filenames.front(), config.gfa_parameters.max_node_length, omp_get_max_threads());
+            if (!config.build_jobs_set && stats.segments > 0) {
+                size_t memory = sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+                config.gfa_parameters.parallel_jobs = guess_parallel_gbwt_jobs(stats.nodes, std::max(stats.paths + stats.walks, size_t(1)),
+                                                                               memory, config.gfa_parameters.batch_size);
+            }
+            if (config.show_progress) {
+                std::cerr << "GFA has " << stats.segments << " segments (" << stats.nodes << " nodes), "
+                          << stats.paths << " paths, and " << stats.walks << " walks" << std::endl;
+                std::cerr << "Building with up to " << config.gfa_parameters.parallel_jobs << " parallel jobs" << std::endl;
+            }
+            report_time_memory("GFA scanned", scan_start, config);
+        }
         auto result = gbwtgraph::gfa_to_gbwt(config.input_filenames.front(), config.gfa_parameters);
         if (result.first.get() == nullptr || result.second.get() == nullptr) {
             std::cerr << "error: [vg gbwt] GBWT construction from GFA failed" << std::endl;
@@ -1519,12 +1540,24 @@ void step_4_path_cover(GBWTHandler& gbwts, GraphHandler& graphs, GBWTConfig& con
         return !Paths::is_alt(graph->get_path_name(path));
     };
     
+    gbwtgraph::PathCoverParameters parameters = config.path_cover_parameters();
+    if (!config.build_jobs_set && config.path_cover != GBWTConfig::path_cover_augment) {
+        // Run as many component jobs at once as fit in memory, judging by the
+        // actual components, so one big chromosome doesn't hold up the rest.
+        size_t memory = sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGE_SIZE);
+        parameters.parallel_jobs = guess_parallel_gbwt_jobs(algorithms::component_sizes(*graph), parameters.num_paths,
+                                                            memory, parameters.batch_size);
+        if (config.show_progress) {
+            std::cerr << "Building with up to " << parameters.parallel_jobs << " parallel jobs" << std::endl;
+        }
+    }
+    
     if (config.path_cover == GBWTConfig::path_cover_greedy) {
         if (config.show_progress) {
             std::cerr << "Algorithm: greedy" << std::endl;
         }
         gbwt::GBWT cover = gbwtgraph::path_cover_gbwt(
-            *graph, config.path_cover_parameters(),
+            *graph, parameters,
             config.include_named_paths, &path_filter
         );
         copy_reference_samples(*graph, cover);
@@ -1541,7 +1574,7 @@ void step_4_path_cover(GBWTHandler& gbwts, GraphHandler& graphs, GBWTConfig& con
         }
         gbwts.use_compressed();
         gbwt::GBWT cover = gbwtgraph::local_haplotypes(
-            *graph, gbwts.compressed, config.path_cover_parameters(),
+            *graph, gbwts.compressed, parameters,
             config.include_named_paths, &path_filter
         );
         copy_reference_samples(gbwts.compressed, cover);
@@ -14,6 +14,10 @@
 #include <unordered_set>
 #include <chrono>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <functional>
 
 #include "subcommand.hpp"
 #include "options.hpp"
@@ -24,10 +28,17 @@
 #include <vg/io/vpkg.hpp>
 #include <vg/io/stream.hpp>
 #include "../hts_alignment_emitter.hpp"
+#include "../ordered_alignment_emitter.hpp"
+#include "../sharded_alignment_emitter.hpp"
 #include "../minimizer_mapper.hpp"
 #include "../index_registry.hpp"
+#include "../index_partitions.hpp"
 #include "../watchdog.hpp"
 #include "../crash.hpp"
+#include "../scratch_arena.hpp"
+#include "../memusage.hpp"
+#include "../telemetry.hpp"
+#include "../config/allocator_config.hpp"
 #include <bdsg/overlays/overlay_helper.hpp>
 
 #include "../gbwtgraph_helper.hpp"
@@ -43,6 +54,8 @@
 #endif
 
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #ifdef __linux__
 #include <linux/perf_event.h>
 #include <asm/unistd.h>
@@ -172,12 +185,24 @@ static GroupedOptionGroup get_options() {
         MinimizerMapper::default_max_extensions,
         "extend up to INT clusters"
     );
+    comp_opts.add_range(
+        "extension-cache-records",
+        &MinimizerMapper::extension_cache_records,
+        MinimizerMapper::default_extension_cache_records,
+        "keep up to INT decoded GBWT records between the gapless extensions for a read"
+    );
     comp_opts.add_range(
         "max-alignments", 'a',
         &MinimizerMapper::max_alignments,
         MinimizerMapper::default_max_alignments,
         "align up to INT extensions"
     );
+    comp_opts.add_range(
+        "max-work",
+        &MinimizerMapper::max_work,
+        MinimizerMapper::default_max_work,
+        "stop after about INT seeds and extensions of work per read and report the best alignment so far (0 = no limit)"
+    );
     comp_opts.add_range(
         "cluster-score", 's',
         &MinimizerMapper::cluster_score_threshold,
@@ -237,6 +262,30 @@ static GroupedOptionGroup get_options() {
         MinimizerMapper::default_exclude_overlapping_min,
         "exclude overlapping minimizers"
     );
+    comp_opts.add_flag(
+        "batch-minimizers",
+        &MinimizerMapper::batch_minimizers,
+        MinimizerMapper::default_batch_minimizers,
+        "look up minimizers for both reads of a pair together"
+    );
+    comp_opts.add_range(
+        "duplicate-cache",
+        &MinimizerMapper::duplicate_cache_size,
+        MinimizerMapper::default_duplicate_cache_size,
+        "reuse the results for up to INT distinct reads seen again with the same sequence and qualities"
+    );
+    comp_opts.add_flag(
+        "batch-tail-alignment",
+        &MinimizerMapper::batch_tail_alignment,
+        MinimizerMapper::default_batch_tail_alignment,
+        "align each tail exactly against all its candidate trees together, instead of with X-drop one at a time"
+    );
+    comp_opts.add_flag(
+        "cull-clusters",
+        &MinimizerMapper::cull_clusters_by_bound,
+        MinimizerMapper::default_cull_clusters_by_bound,
+        "skip clusters whose best possible score is below the extension set threshold"
+    );
     comp_opts.add_range(
         "paired-distance-limit",
         &MinimizerMapper::paired_distance_stdevs,
@@ -255,6 +304,19 @@ static GroupedOptionGroup get_options() {
         MinimizerMapper::default_rescue_seed_limit,
         "attempt rescue with at most INT seeds"
     );
+    comp_opts.add_range(
+        "rescue-subgraph-cache",
+        &MinimizerMapper::rescue_subgraph_cache_size,
+        MinimizerMapper::default_rescue_subgraph_cache_size,
+        "reuse the INT most recent rescue subgraphs on each thread"
+    );
+    comp_opts.add_range(
+        "rescue-prefilter",
+        &MinimizerMapper::rescue_prefilter_error_rate,
+        MinimizerMapper::default_rescue_prefilter_error_rate,
+        "only align rescues near matches with at most FLOAT edits per base, found by a bit-parallel scan (0 = disabled)",
+        double_is_nonnegative
+    );
     
     // Configure chaining
     auto& chaining_opts = parser.add_group<MinimizerMapper>("long-read/chaining parameters");
@@ -306,6 +368,24 @@ static GroupedOptionGroup get_options() {
         MinimizerMapper::default_lookback_item_hard_cap,
         "maximum items to consider coming from when chaining"
     );
+    chaining_opts.add_flag(
+        "batch-chaining-transitions",
+        &MinimizerMapper::batch_chaining_transitions,
+        MinimizerMapper::default_batch_chaining_transitions,
+        "find distances and score transitions for several chaining predecessors at a time"
+    );
+    chaining_opts.add_flag(
+        "no-distance-cache",
+        &MinimizerMapper::cache_distances,
+        MinimizerMapper::default_cache_distances,
+        "disable remembering distance index queries across clustering and chaining of each read"
+    );
+    chaining_opts.add_range(
+        "parallel-clustering-seeds",
+        &MinimizerMapper::parallel_clustering_seeds,
+        MinimizerMapper::default_parallel_clustering_seeds,
+        "cluster reads with at least INT seeds using parallel tasks (0 = never)"
+    );
     
     chaining_opts.add_range(
         "chain-score-threshold",
@@ -362,16 +442,96 @@ std::string strip_suffixes(std::string filename, const std::vector<std::string>&
     return filename;
 }
 
-// Returns the name of the sampled GBZ.
-string sample_haplotypes(const vector<pair<string, string>>& indexes, string& basename, string& sample_name, string& haplotype_file, string& kff_file, bool progress);
+// Returns the name of the sampled GBZ. If there is no KFF file, counts the
+// kmers in the given read files instead.
+string sample_haplotypes(const vector<pair<string, string>>& indexes, string& basename, string& sample_name, string& haplotype_file, string& kff_file, const vector<string>& read_files, bool progress);
 
 //----------------------------------------------------------------------------
 
+/// Log the process's memory use, and how much of it each allocator subsystem
+/// has, if the allocator keeps track.
+static void report_memory_usage(ostream& out, const string& when) {
+    out << "Memory use " << when << ": " << get_current_rss_kb() / 1024 << " MB resident, "
+        << get_max_rss_kb() / 1024 << " MB max";
+    auto usage = get_allocator_subsystem_usage();
+    if (!usage.empty()) {
+        out << "; allocated:";
+        for (auto& subsystem : usage) {
+            out << " " << subsystem.first << " " << subsystem.second / (1024 * 1024) << " MB";
+        }
+    }
+    out << endl;
+}
+
+/// Listen for mapping jobs on a Unix domain socket at the given path,
+/// replacing any stale socket there. Returns the listening file descriptor.
+static int listen_for_jobs(const string& socket_name) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_name.size() >= sizeof(address.sun_path)) {
+        cerr << "error:[vg giraffe] Socket path is too long: " << socket_name << endl;
+        exit(1);
+    }
+    strcpy(address.sun_path, socket_name.c_str());
+    
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd == -1) {
+        int problem = errno;
+        cerr << "error:[vg giraffe] Could not create socket: " << strerror(problem) << endl;
+        exit(1);
+    }
+    unlink(socket_name.c_str());
+    if (bind(listen_fd, (sockaddr*) &address, sizeof(address)) == -1 || listen(listen_fd, 16) == -1) {
+        int problem = errno;
+        cerr << "error:[vg giraffe] Could not listen on socket " << socket_name << ": " << strerror(problem) << endl;
+        exit(1);
+    }
+    return listen_fd;
+}
+
+/// Read one newline-terminated line from a connection. Returns false if the
+/// connection closed before a full line was read.
+static bool read_job_line(int connection_fd, string& line) {
+    line.clear();
+    char c;
+    while (true) {
+        ssize_t got = read(connection_fd, &c, 1);
+        if (got == 1) {
+            if (c == '\n') {
+                return true;
+            }
+            line.push_back(c);
+        } else if (got == -1 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+}
+
+/// Send a reply line back over a connection, ignoring clients that have gone away.
+static void write_job_reply(int connection_fd, const string& reply) {
+    string line = reply + "\n";
+    size_t written = 0;
+    while (written < line.size()) {
+        ssize_t put = write(connection_fd, line.data() + written, line.size() - written);
+        if (put == -1 && errno == EINTR) {
+            continue;
+        }
+        if (put <= 0) {
+            return;
+        }
+        written += put;
+    }
+}
+
 void help_giraffe(char** argv, const BaseOptionGroup& parser, bool full_help) {
     cerr
     << "usage:" << endl
     << "  " << argv[0] << " giraffe -Z graph.gbz [-d graph.dist -m graph.min] <input options> [other options] > output.gam" << endl
     << "  " << argv[0] << " giraffe -Z graph.gbz --haplotype-name graph.hapl --kff-name sample.kff <input options> [other options] > output.gam" << endl
+    << "  " << argv[0] << " giraffe -Z graph.gbz --haplotype-name graph.hapl -f sample.fq.gz [other options] > output.gam" << endl
     << endl
     << "Fast haplotype-aware short read mapper." << endl
     << endl;
@@ -381,6 +541,8 @@ void help_giraffe(char** argv, const BaseOptionGroup& parser, bool full_help) {
     << "  -Z, --gbz-name FILE           map to this GBZ graph" << endl
     << "  -d, --dist-name FILE          cluster using this distance index" << endl
     << "  -m, --minimizer-name FILE     use this minimizer index" << endl
+    << "  --partition-list FILE         use the indexes of one partition from FILE (see vg autoindex --partition)" << endl
+    << "  --partition NAME              the partition to use; merge the results for all of them with vg gammerge" << endl
     << "  -p, --progress                show progress" << endl
     << "  -t, --threads INT             number of mapping threads to use" << endl
     << "  -b, --parameter-preset NAME   set computational parameters (fast / default) [default]" << endl
@@ -396,6 +558,7 @@ void help_giraffe(char** argv, const BaseOptionGroup& parser, bool full_help) {
     << "haplotype sampling:" << endl
     << "  --haplotype-name FILE         sample from haplotype information in FILE" << endl
     << "  --kff-name FILE               sample according to kmer counts in FILE" << endl
+    << "                                (default: count kmers in the FASTQ input)" << endl
     << "  --index-basename STR          name prefix for generated graph/index files (default: from graph name)" << endl;
 
     cerr
@@ -414,10 +577,26 @@ void help_giraffe(char** argv, const BaseOptionGroup& parser, bool full_help) {
     if (full_help) {
         cerr
         << "  -P, --prune-low-cplx          prune short and low complexity anchors during linear format realignment" << endl
+        << "  --index-surjection-paths      index where the --ref-paths visit each node up front, to surject faster" << endl
+        << "  --direct-gaf                  format GAF output directly from alignments, without the general converter" << endl
         << "  -n, --discard                 discard all output alignments (for profiling)" << endl
+        << "  --ordered-output              write alignments in input order, the same on every run (FASTQ input only)" << endl
+        << "  --reorder-window INT          with --ordered-output, let reads get at most INT ahead of the" << endl
+        << "                                first unwritten one [4 * threads * batch size]" << endl
         << "  --output-basename NAME        write output to a GAM file beginning with the given prefix for each setting combination" << endl
+        << "  --output-shards FILE          write output to a file per thread (GAM / GAF / json / tsv), and a list of" << endl
+        << "                                them to FILE that vg filter, pack, and surject can read as one input" << endl
         << "  --report-name NAME            write a TSV of output file and mapping speed to the given file" << endl
-        << "  --show-work                   log how the mapper comes to its conclusions about mapping locations" << endl;
+        << "  --slow-reads FILE             write the slowest reads to map to FILE as FASTA (interleaved if paired)" << endl
+        << "  --slow-read-count INT         number of slow reads to write with --slow-reads [100]" << endl
+        << "  --stage-times FILE            write total time and results per mapping stage to FILE as JSON" << endl
+        << "  --show-work                   log how the mapper comes to its conclusions about mapping locations" << endl
+        << "  --dump-problems N             save every Nth chaining problem as problemNUM.json, written in the" << endl
+        << "                                background; with --show-work, only save every Nth of its dumps" << endl
+        << "  --compress-dumps              zstd-compress saved problem dumps" << endl
+        << "  --serve FILE                  load the indexes once and then map jobs sent to a Unix socket at FILE;" << endl
+        << "                                each job is a line of \"OUTPUT_FILE [input options] [parameter options]\"," << endl
+        << "                                answered with \"done N\" or \"error: ...\"; send \"shutdown\" to stop" << endl;
     }
 
     if (full_help) {
@@ -426,9 +605,16 @@ void help_giraffe(char** argv, const BaseOptionGroup& parser, bool full_help) {
         << "  -A, --rescue-algorithm NAME   use algorithm NAME for rescue (none / dozeu / gssw) [dozeu]" << endl
         << "  --fragment-mean FLOAT         force the fragment length distribution to have this mean (requires --fragment-stdev)" << endl
         << "  --fragment-stdev FLOAT        force the fragment length distribution to have this standard deviation (requires --fragment-mean)" << endl
+        << "  --parallel-warmup             learn the fragment length distribution on all threads instead of one" << endl
         << "  --track-provenance            track how internal intermediate alignment candidates were arrived at" << endl
         << "  --track-correctness           track if internal intermediate alignment candidates are correct (implies --track-provenance)" << endl
-        << "  -B, --batch-size INT          number of reads or pairs per batch to distribute to threads [" << vg::io::DEFAULT_PARALLEL_BATCHSIZE << "]" << endl;
+        << "  -B, --batch-size INT          number of reads or pairs per batch to distribute to threads [" << vg::io::DEFAULT_PARALLEL_BATCHSIZE << "]" << endl
+        << "  --no-preload-distance-index   serve the distance index from its file mapping as needed, instead of paging it all in first" << endl
+        << "  --interleave-indexes          spread the memory for the indexes across all NUMA nodes" << endl
+        << "  --pin-threads                 pin each mapping thread to a CPU, spreading them evenly across sockets" << endl
+        << "  --report-memory SECONDS       log memory use by indexes and mapping threads this often" << endl
+        << "  --telemetry SECONDS           log mapping throughput and memory use this often" << endl
+        << "  --telemetry-file FILE         append telemetry to FILE as JSON lines instead of logging it" << endl;
 
         auto helps = parser.get_help();
         print_table(helps, cerr);
@@ -461,6 +647,26 @@ int main_giraffe(int argc, char** argv) {
     #define OPT_REF_PATHS 1010
     #define OPT_SHOW_WORK 1011
     #define OPT_NAMED_COORDINATES 1012
+    #define OPT_DIRECT_GAF 1013
+    #define OPT_NO_PRELOAD_DISTANCE_INDEX 1014
+    #define OPT_SLOW_READS 1015
+    #define OPT_SLOW_READ_COUNT 1016
+    #define OPT_STAGE_TIMES 1017
+    #define OPT_INDEX_SURJECTION_PATHS 1018
+    #define OPT_SERVE 1019
+    #define OPT_INTERLEAVE_INDEXES 1020
+    #define OPT_PIN_THREADS 1021
+    #define OPT_REPORT_MEMORY 1022
+    #define OPT_TELEMETRY 1023
+    #define OPT_TELEMETRY_FILE 1024
+    #define OPT_PARALLEL_WARMUP 1025
+    #define OPT_ORDERED_OUTPUT 1026
+    #define OPT_REORDER_WINDOW 1027
+    #define OPT_OUTPUT_SHARDS 1028
+    #define OPT_PARTITION_LIST 1029
+    #define OPT_PARTITION 1030
+    #define OPT_DUMP_PROBLEMS 1031
+    #define OPT_COMPRESS_DUMPS 1032
     constexpr int OPT_HAPLOTYPE_NAME = 1100;
     constexpr int OPT_KFF_NAME = 1101;
     constexpr int OPT_INDEX_BASENAME = 1102;
@@ -477,9 +683,20 @@ int main_giraffe(int argc, char** argv) {
 
     // For haplotype sampling.
     string haplotype_name, kff_name;
+    // Which partition's indexes to use, if any
+    string partition_list_name, partition_name;
 
     string output_basename;
     string report_name;
+    // Where should we listen for mapping jobs, if serving?
+    string serve_socket_name;
+    // Where should the current job's output go, if serving?
+    string job_output_filename;
+    // Where should we dump the slowest reads, and how many?
+    string slow_reads_name;
+    size_t slow_read_count = 100;
+    // Where should we write stage timing totals?
+    string stage_times_name;
     bool show_progress = false;
     
     // Main Giraffe program options struct
@@ -510,6 +727,8 @@ int main_giraffe(int argc, char** argv) {
     double fragment_stdev = 0.0;
     // How many pairs should we be willing to buffer before giving up on fragment length estimation?
     size_t MAX_BUFFERED_PAIRS = 100000;
+    // Should we map pairs on all threads while learning the fragment length distribution?
+    bool parallel_warmup = false;
     // What sample name if any should we apply?
     string sample_name;
     // What read group if any should we apply?
@@ -521,8 +740,27 @@ int main_giraffe(int argc, char** argv) {
     // Should we log our mapping decision making?
     bool show_work = MinimizerMapper::default_show_work;
     
+    // Should we page the whole distance index in before mapping?
+    bool preload_distance_index = true;
+    // Should we interleave the index memory across NUMA nodes?
+    bool interleave_indexes = false;
+    // Should we pin the mapping threads to CPUs?
+    bool pin_threads = false;
+    // How often should we log memory use, in seconds, or 0 for never?
+    size_t memory_report_interval = 0;
+    // How often should we report throughput, in seconds, or 0 for never?
+    size_t telemetry_interval = 0;
+    // Where should the throughput reports go, if not to standard error?
+    string telemetry_filename;
+    
     // Should we throw out our alignments instead of outputting them?
     bool discard_alignments = false;
+    // Should we write alignments in input order?
+    bool ordered_output = false;
+    // How far ahead of the first unwritten read can reading go, or 0 for automatic?
+    size_t reorder_window = 0;
+    // Where should we put the manifest, if we are writing a shard per thread?
+    string output_shards_name;
     // How many reads per batch to run at a time?
     uint64_t batch_size = vg::io::DEFAULT_PARALLEL_BATCHSIZE;
     
@@ -541,6 +779,10 @@ int main_giraffe(int argc, char** argv) {
     
     // For GAM format, should we report in named-segment space instead of node ID space?
     bool named_coordinates = false;
+    // For GAF format, should we format lines directly from the alignments?
+    bool direct_gaf = false;
+    // For HTSlib formats, should we index the reference paths before surjecting?
+    bool index_surjection_paths = false;
 
     // Map algorithm names to rescue algorithms
     std::map<std::string, MinimizerMapper::RescueAlgorithm> rescue_algorithms = {
@@ -588,6 +830,8 @@ int main_giraffe(int argc, char** argv) {
         {"progress", no_argument, 0, 'p'},
         {"haplotype-name", required_argument, 0, OPT_HAPLOTYPE_NAME},
         {"kff-name", required_argument, 0, OPT_KFF_NAME},
+        {"partition-list", required_argument, 0, OPT_PARTITION_LIST},
+        {"partition", required_argument, 0, OPT_PARTITION},
         {"index-basename", required_argument, 0, OPT_INDEX_BASENAME},
         {"gam-in", required_argument, 0, 'G'},
         {"fastq-in", required_argument, 0, 'f'},
@@ -599,16 +843,34 @@ int main_giraffe(int argc, char** argv) {
         {"ref-paths", required_argument, 0, OPT_REF_PATHS},
         {"prune-low-cplx", no_argument, 0, 'P'},
         {"named-coordinates", no_argument, 0, OPT_NAMED_COORDINATES},
+        {"direct-gaf", no_argument, 0, OPT_DIRECT_GAF},
+        {"ordered-output", no_argument, 0, OPT_ORDERED_OUTPUT},
+        {"reorder-window", required_argument, 0, OPT_REORDER_WINDOW},
+        {"output-shards", required_argument, 0, OPT_OUTPUT_SHARDS},
+        {"index-surjection-paths", no_argument, 0, OPT_INDEX_SURJECTION_PATHS},
+        {"no-preload-distance-index", no_argument, 0, OPT_NO_PRELOAD_DISTANCE_INDEX},
+        {"interleave-indexes", no_argument, 0, OPT_INTERLEAVE_INDEXES},
+        {"pin-threads", no_argument, 0, OPT_PIN_THREADS},
+        {"report-memory", required_argument, 0, OPT_REPORT_MEMORY},
+        {"telemetry", required_argument, 0, OPT_TELEMETRY},
+        {"telemetry-file", required_argument, 0, OPT_TELEMETRY_FILE},
         {"discard", no_argument, 0, 'n'},
         {"output-basename", required_argument, 0, OPT_OUTPUT_BASENAME},
         {"report-name", required_argument, 0, OPT_REPORT_NAME},
+        {"slow-reads", required_argument, 0, OPT_SLOW_READS},
+        {"slow-read-count", required_argument, 0, OPT_SLOW_READ_COUNT},
+        {"stage-times", required_argument, 0, OPT_STAGE_TIMES},
+        {"serve", required_argument, 0, OPT_SERVE},
         {"fast-mode", no_argument, 0, 'b'},
         {"rescue-algorithm", required_argument, 0, 'A'},
         {"fragment-mean", required_argument, 0, OPT_FRAGMENT_MEAN },
         {"fragment-stdev", required_argument, 0, OPT_FRAGMENT_STDEV },
+        {"parallel-warmup", no_argument, 0, OPT_PARALLEL_WARMUP },
         {"track-provenance", no_argument, 0, OPT_TRACK_PROVENANCE},
         {"track-correctness", no_argument, 0, OPT_TRACK_CORRECTNESS},
         {"show-work", no_argument, 0, OPT_SHOW_WORK},
+        {"dump-problems", required_argument, 0, OPT_DUMP_PROBLEMS},
+        {"compress-dumps", no_argument, 0, OPT_COMPRESS_DUMPS},
         {"batch-size", required_argument, 0, 'B'},
         {"threads", required_argument, 0, 't'},
     };
@@ -737,6 +999,12 @@ int main_giraffe(int argc, char** argv) {
             case OPT_KFF_NAME:
                 kff_name = optarg;
                 break;
+            case OPT_PARTITION_LIST:
+                partition_list_name = optarg;
+                break;
+            case OPT_PARTITION:
+                partition_name = optarg;
+                break;
             case OPT_INDEX_BASENAME:
                 index_basename_override = optarg;
                 break;
@@ -808,6 +1076,38 @@ int main_giraffe(int argc, char** argv) {
                 named_coordinates = true;
                 break;
 
+            case OPT_DIRECT_GAF:
+                direct_gaf = true;
+                break;
+
+            case OPT_INDEX_SURJECTION_PATHS:
+                index_surjection_paths = true;
+                break;
+
+            case OPT_NO_PRELOAD_DISTANCE_INDEX:
+                preload_distance_index = false;
+                break;
+
+            case OPT_INTERLEAVE_INDEXES:
+                interleave_indexes = true;
+                break;
+
+            case OPT_PIN_THREADS:
+                pin_threads = true;
+                break;
+
+            case OPT_REPORT_MEMORY:
+                memory_report_interval = parse<size_t>(optarg);
+                break;
+
+            case OPT_TELEMETRY:
+                telemetry_interval = parse<size_t>(optarg);
+                break;
+
+            case OPT_TELEMETRY_FILE:
+                telemetry_filename = optarg;
+                break;
+
             case 'n':
                 discard_alignments = true;
                 break;
@@ -819,6 +1119,23 @@ int main_giraffe(int argc, char** argv) {
             case OPT_REPORT_NAME:
                 report_name = optarg;
                 break;
+
+            case OPT_SLOW_READS:
+                slow_reads_name = optarg;
+                break;
+
+            case OPT_SLOW_READ_COUNT:
+                slow_read_count = parse<size_t>(optarg);
+                break;
+
+            case OPT_STAGE_TIMES:
+                stage_times_name = optarg;
+                break;
+
+            case OPT_SERVE:
+                serve_socket_name = optarg;
+                break;
+
             case 'b':
                 param_preset = optarg;
                 {
@@ -859,6 +1176,22 @@ int main_giraffe(int argc, char** argv) {
                 fragment_stdev = parse<double>(optarg);
                 break;
 
+            case OPT_PARALLEL_WARMUP:
+                parallel_warmup = true;
+                break;
+
+            case OPT_ORDERED_OUTPUT:
+                ordered_output = true;
+                break;
+
+            case OPT_REORDER_WINDOW:
+                reorder_window = parse<size_t>(optarg);
+                break;
+
+            case OPT_OUTPUT_SHARDS:
+                output_shards_name = optarg;
+                break;
+
             case OPT_TRACK_PROVENANCE:
                 track_provenance = true;
                 break;
@@ -873,6 +1206,19 @@ int main_giraffe(int argc, char** argv) {
                 // Also turn on saving explanations
                 Explainer::save_explanations = true;
                 break;
+
+            case OPT_DUMP_PROBLEMS:
+                ProblemDumpExplainer::sample_interval = parse<size_t>(optarg);
+                if (ProblemDumpExplainer::sample_interval == 0) {
+                    cerr << "error:[vg giraffe] --dump-problems must be at least 1" << endl;
+                    exit(1);
+                }
+                Explainer::save_explanations = true;
+                break;
+
+            case OPT_COMPRESS_DUMPS:
+                ExplanationWriter::compress = true;
+                break;
                 
             case 'B':
                 batch_size = parse<uint64_t>(optarg);
@@ -941,6 +1287,29 @@ int main_giraffe(int argc, char** argv) {
         }
     }
 
+    if (!partition_list_name.empty() || !partition_name.empty()) {
+        // Use one partition's indexes.
+        if (partition_list_name.empty() || partition_name.empty()) {
+            cerr << "error:[vg giraffe] A partition needs both a list (--partition-list) and a name (--partition)." << endl;
+            exit(1);
+        }
+        bool found = false;
+        for (auto& partition : read_partition_list(partition_list_name)) {
+            if (partition.name == partition_name) {
+                provided_indexes.emplace_back("Giraffe GBZ", partition.gbz);
+                provided_indexes.emplace_back("Minimizers", partition.minimizers);
+                provided_indexes.emplace_back("Giraffe Distance Index", partition.distance);
+                index_basename = strip_suffixes(partition.gbz, { ".gbz", ".giraffe" });
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            cerr << "error:[vg giraffe] Partition " << partition_name << " is not in " << partition_list_name << "." << endl;
+            exit(1);
+        }
+    }
+
     // If we don't want rescue, let the user see we don't try it.
     if (parser.get_option_value<size_t>("rescue-attempts") == 0 || rescue_algorithm == MinimizerMapper::rescue_none) {
         // Replace any parsed values
@@ -973,6 +1342,47 @@ int main_giraffe(int argc, char** argv) {
         exit(1);
     }
     
+    if (ordered_output && !gam_filename.empty()) {
+        cerr << "error:[vg giraffe] Ordered output (--ordered-output) needs FASTQ input (-f)." << endl;
+        exit(1);
+    }
+    
+    if (!output_shards_name.empty()) {
+        if (hts_output) {
+            cerr << "error:[vg giraffe] Output in " << output_format << " format cannot be sharded (--output-shards)." << endl;
+            exit(1);
+        }
+        if (!output_basename.empty()) {
+            cerr << "error:[vg giraffe] Cannot use both --output-shards and --output-basename." << endl;
+            exit(1);
+        }
+        if (ordered_output) {
+            cerr << "error:[vg giraffe] Sharded output (--output-shards) cannot be ordered (--ordered-output)." << endl;
+            exit(1);
+        }
+        if (output_shards_name == "-") {
+            cerr << "error:[vg giraffe] The shard manifest (--output-shards) must go to a file." << endl;
+            exit(1);
+        }
+    }
+    
+    if (ordered_output && parallel_warmup) {
+        // Which pairs wait for the distribution would depend on timing.
+        cerr << "error:[vg giraffe] Ordered output (--ordered-output) cannot be used with --parallel-warmup." << endl;
+        exit(1);
+    }
+    
+    if (!serve_socket_name.empty()) {
+        if (!fastq_filename_1.empty() || !gam_filename.empty() || interleaved) {
+            cerr << "error:[vg giraffe] Input reads (-f, -G, -i) are given with each job when serving (--serve)." << endl;
+            exit(1);
+        }
+        if (!output_basename.empty()) {
+            cerr << "error:[vg giraffe] Output files are given with each job when serving (--serve), not with --output-basename." << endl;
+            exit(1);
+        }
+    }
+    
     if (have_input_file(optind, argc, argv)) {
         // TODO: work out how to interpret additional files as reads.
         cerr << "error:[vg giraffe] Extraneous input file: " << get_input_file_name(optind, argc, argv) << endl;
@@ -991,13 +1401,28 @@ int main_giraffe(int argc, char** argv) {
         cerr << "warning:[vg giraffe] Attempting to set paired-end parameters but running in single-end mode" << endl;
     }
 
-    bool haplotype_sampling = !haplotype_name.empty() & !kff_name.empty();
+    // Without a KFF file, we sample according to the kmers in the reads we are
+    // about to map.
+    vector<string> sampling_reads;
+    if (!haplotype_name.empty() && kff_name.empty()) {
+        if (!fastq_filename_1.empty()) {
+            sampling_reads.push_back(fastq_filename_1);
+        }
+        if (!fastq_filename_2.empty()) {
+            sampling_reads.push_back(fastq_filename_2);
+        }
+        if (sampling_reads.empty()) {
+            cerr << "error:[vg giraffe] Haplotype sampling without --kff-name requires FASTQ input (-f)." << endl;
+            exit(1);
+        }
+    }
+    bool haplotype_sampling = !haplotype_name.empty() && (!kff_name.empty() || !sampling_reads.empty());
     if (!index_basename_override.empty()) {
         index_basename = index_basename_override;
     }
     if (haplotype_sampling) {
         // If we do haplotype sampling, we get a new GBZ and later build indexes for it.
-        string gbz_name = sample_haplotypes(provided_indexes, index_basename, sample_name, haplotype_name, kff_name, show_progress);
+        string gbz_name = sample_haplotypes(provided_indexes, index_basename, sample_name, haplotype_name, kff_name, sampling_reads, show_progress);
         registry.provide("Giraffe GBZ", gbz_name);
         index_basename = split_ext(gbz_name).first;
     } else {
@@ -1058,11 +1483,45 @@ int main_giraffe(int argc, char** argv) {
     }
 #endif
     
+    // Log memory use in the background, if asked.
+    std::mutex memory_report_mutex;
+    std::condition_variable memory_report_stop;
+    bool memory_report_done = false;
+    std::thread memory_reporter;
+    if (memory_report_interval != 0) {
+        memory_reporter = std::thread([&]() {
+            std::unique_lock<std::mutex> lock(memory_report_mutex);
+            while (!memory_report_stop.wait_for(lock, std::chrono::seconds(memory_report_interval), [&]() { return memory_report_done; })) {
+                report_memory_usage(cerr, "so far");
+            }
+        });
+    }
+    // And stop when we stop, however that happens.
+    struct ReporterStopper {
+        std::function<void()> stop;
+        ~ReporterStopper() {
+            stop();
+        }
+    } memory_reporter_stopper {[&]() {
+        if (memory_reporter.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(memory_report_mutex);
+                memory_report_done = true;
+            }
+            memory_report_stop.notify_all();
+            memory_reporter.join();
+            report_memory_usage(cerr, "at exit");
+        }
+    }};
+    
     try {
         if (show_progress) {
             cerr << "Preparing Indexes" << endl;
         }
+        // Anything new we build counts against making indexes.
+        set_thread_allocator_subsystem("index construction");
         registry.make_indexes(index_targets);
+        set_thread_allocator_subsystem("");
     }
     catch (InsufficientInputException ex) {
         cerr << "error:[vg giraffe] Input is not sufficient to create indexes" << endl;
@@ -1079,33 +1538,89 @@ int main_giraffe(int argc, char** argv) {
     }
 #endif
     
-    // Grab the minimizer index
+    // The indexes are independent, so load them all at once, each on its own
+    // thread, which overlaps the waits on the filesystem.
+    std::mutex progress_mutex;
+    auto load_timed = [&](const std::string& description, const std::function<void()>& load) {
+        std::chrono::time_point<std::chrono::system_clock> load_start = std::chrono::system_clock::now();
+        if (interleave_indexes) {
+            // Memory policy is per thread, so each loader needs to ask.
+            set_numa_interleave(true);
+        }
+        set_thread_allocator_subsystem("indexes");
+        load();
+        set_thread_allocator_subsystem("");
+        std::chrono::duration<double> load_seconds = std::chrono::system_clock::now() - load_start;
+        if (show_progress) {
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            cerr << "Loaded " << description << " in " << load_seconds.count() << " seconds" << endl;
+        }
+    };
     if (show_progress) {
-        cerr << "Loading Minimizer Index" << endl;
+        cerr << "Loading Minimizer Index, GBZ, and Distance Index v2" << endl;
     }
-    auto minimizer_index = vg::io::VPKG::load_one<gbwtgraph::DefaultMinimizerIndex>(registry.require("Minimizers").at(0));
-
-    // Grab the GBZ
-    if (show_progress) {
-        cerr << "Loading GBZ" << endl;
+    std::chrono::time_point<std::chrono::system_clock> indexes_start = std::chrono::system_clock::now();
+    if (interleave_indexes && !set_numa_interleave(true)) {
+        cerr << "warning:[vg giraffe] Cannot interleave index memory across NUMA nodes on this system" << endl;
+        interleave_indexes = false;
     }
-    auto gbz = vg::io::VPKG::load_one<gbwtgraph::GBZ>(registry.require("Giraffe GBZ").at(0));
-
+    
+    // Grab the minimizer index
+    unique_ptr<gbwtgraph::DefaultMinimizerIndex> minimizer_index;
+    std::thread minimizer_loader(load_timed, "Minimizer Index", [&]() {
+        minimizer_index = load_one_mapped<gbwtgraph::DefaultMinimizerIndex>(registry.require("Minimizers").at(0));
+    });
+    
     // Grab the distance index
-    if (show_progress) {
-        cerr << "Loading Distance Index v2" << endl;
-    }
-    auto distance_index = vg::io::VPKG::load_one<SnarlDistanceIndex>(registry.require("Giraffe Distance Index").at(0));
+    unique_ptr<SnarlDistanceIndex> distance_index;
+    std::thread distance_loader(load_timed, "Distance Index v2", [&]() {
+        distance_index = vg::io::VPKG::load_one<SnarlDistanceIndex>(registry.require("Giraffe Distance Index").at(0));
+    });
+    
+    // Grab the GBZ
+    unique_ptr<gbwtgraph::GBZ> gbz;
+    load_timed("GBZ", [&]() {
+        gbz = load_one_mapped<gbwtgraph::GBZ>(registry.require("Giraffe GBZ").at(0));
+    });
     
+    minimizer_loader.join();
+    distance_loader.join();
     if (show_progress) {
-        cerr << "Paging in Distance Index v2" << endl;
+        std::chrono::duration<double> indexes_seconds = std::chrono::system_clock::now() - indexes_start;
+        cerr << "Loaded indexes in " << indexes_seconds.count() << " seconds" << endl;
+        report_memory_usage(cerr, "after loading indexes");
     }
+    
     std::chrono::time_point<std::chrono::system_clock> preload_start = std::chrono::system_clock::now();
-    // Make sure the distance index is paged in from disk.
-    // This does a blocking load; a nonblocking hint to the kernel doesn't seem to help at all.
-    distance_index->preload(true);
+    if (preload_distance_index) {
+        if (show_progress) {
+            cerr << "Paging in Distance Index v2" << endl;
+        }
+        // Make sure the distance index is paged in from disk.
+        // This does a blocking load; a nonblocking hint to the kernel doesn't seem to help at all.
+        distance_index->preload(true);
+    } else if (show_progress) {
+        // When loaded from a file, the index is memory-mapped, so queries can
+        // be served straight from the page cache, which is shared with any
+        // other processes using the same index.
+        cerr << "Not paging in Distance Index v2; it will be read from disk as needed" << endl;
+    }
     std::chrono::time_point<std::chrono::system_clock> preload_end = std::chrono::system_clock::now();
     std::chrono::duration<double> di2_preload_seconds = preload_end - preload_start;
+    if (interleave_indexes) {
+        // The distance index pages have now been faulted in as interleaved, so
+        // the mapping can go back to using local memory.
+        set_numa_interleave(false);
+    }
+    
+    if (pin_threads) {
+        int sockets = pin_threads_across_sockets();
+        if (sockets == 0) {
+            cerr << "warning:[vg giraffe] Cannot pin threads to CPUs on this system" << endl;
+        } else if (show_progress) {
+            cerr << "Pinned " << get_thread_count() << " threads across " << sockets << " sockets" << endl;
+        }
+    }
     
     // If we are tracking correctness, we will fill this in with a graph for
     // getting offsets along ref paths.
@@ -1162,12 +1677,21 @@ int main_giraffe(int argc, char** argv) {
         report << "#file\treads/second/thread" << endl;
     }
 
-    // We need to loop over all the ranges...
-    for_each_combo([&]() {
+    // How many reads did the last run of the mapping map?
+    size_t last_reads_mapped = 0;
+
+    // Map all the input reads with the parameters in the given options. This
+    // runs once for each combination of parameter ranges, or once for each job
+    // when serving.
+    auto run_mapping = [&](GroupedOptionGroup& options) {
     
         // Work out where to send the output. Default to stdout.
         string output_filename = "-";
-        if (!output_basename.empty()) {
+        if (!job_output_filename.empty()) {
+            output_filename = job_output_filename;
+        } else if (!output_shards_name.empty()) {
+            output_filename = output_shards_name;
+        } else if (!output_basename.empty()) {
             // Compose a name using all the parameters.
             stringstream s;
             
@@ -1177,7 +1701,7 @@ int main_giraffe(int argc, char** argv) {
                 s << "-i";
             }
             // Make a slug of the other options
-            parser.print_options(s, true);
+            options.print_options(s, true);
             s << ".gam";
             
             output_filename = s.str();
@@ -1193,11 +1717,13 @@ int main_giraffe(int argc, char** argv) {
 
         // Show and apply all the parser-managed options
         if (show_progress) {
-            parser.print_options(cerr);
+            options.print_options(cerr);
         }
-        parser.apply(minimizer_mapper);
-        parser.apply(main_options);
-        parser.apply(scoring_options);
+        options.apply(minimizer_mapper);
+        // Results from an earlier run may have used different parameters.
+        minimizer_mapper.clear_duplicate_caches();
+        options.apply(main_options);
+        options.apply(scoring_options);
         
         if (show_progress && interleaved) {
             cerr << "--interleaved" << endl;
@@ -1221,6 +1747,10 @@ int main_giraffe(int argc, char** argv) {
             cerr << "--show-work " << endl;
         }
         minimizer_mapper.show_work = show_work;
+        
+        // Only GAM and JSON output carries the mapper's annotations, so don't
+        // build them into the alignments for other formats.
+        minimizer_mapper.keep_all_annotations = (output_format == "GAM" || output_format == "JSON");
 
         if (show_progress && paired) {
             if (forced_mean && forced_stdev) {
@@ -1239,7 +1769,32 @@ int main_giraffe(int argc, char** argv) {
 
         // Work out the number of threads we will have
         size_t thread_count = omp_get_max_threads();
+        
+        // If we want stage timings, collect them from all the threads.
+        unique_ptr<FunnelStats> stage_stats;
+        if (!stage_times_name.empty()) {
+            if (show_progress) {
+                cerr << "--stage-times " << stage_times_name << endl;
+            }
+            stage_stats.reset(new FunnelStats(thread_count));
+            minimizer_mapper.stage_stats = stage_stats.get();
+        }
+        
+        // If we want to know how we are doing as we go, report periodically.
+        unique_ptr<Telemetry> telemetry;
+        if (telemetry_interval != 0 || !telemetry_filename.empty()) {
+            telemetry.reset(new Telemetry(thread_count, std::chrono::seconds(telemetry_interval == 0 ? 60 : telemetry_interval),
+                                          telemetry_filename, stage_stats.get()));
+        }
 
+        // What the mapping threads allocate, including their scratch space
+        // and output buffers, counts against mapping. OMP keeps the same
+        // threads around, so this sticks for the mapping parallel sections.
+        #pragma omp parallel
+        {
+            set_thread_allocator_subsystem("mapping");
+        }
+        
         // Set up counters per-thread for total reads mapped
         vector<size_t> reads_mapped_by_thread(thread_count, 0);
         
@@ -1300,6 +1855,10 @@ int main_giraffe(int argc, char** argv) {
         // Establish a watchdog to find reads that take too long to map.
         // If we see any, we will issue a warning.
         unique_ptr<Watchdog> watchdog(new Watchdog(thread_count, chrono::seconds(main_options.watchdog_timeout)));
+        if (!slow_reads_name.empty()) {
+            // Also have it remember the slowest reads to write out later.
+            watchdog->keep_slowest(slow_read_count);
+        }
 
         {
         
@@ -1314,6 +1873,9 @@ int main_giraffe(int argc, char** argv) {
             // Set up output to an emitter that will handle serialization and surjection.
             // Unless we want to discard all the alignments in which case do that.
             unique_ptr<AlignmentEmitter> alignment_emitter;
+            // If we are putting the output in order, this is what needs to know
+            // what read each thread is on.
+            OrderedAlignmentEmitter* ordered_emitter = nullptr;
             if (discard_alignments) {
                 alignment_emitter = make_unique<NullAlignmentEmitter>();
             } else {
@@ -1328,16 +1890,38 @@ int main_giraffe(int argc, char** argv) {
                     // When not surjecting, use named segments instead of node IDs.
                     flags |= ALIGNMENT_EMITTER_FLAG_VG_USE_SEGMENT_NAMES;
                 }
+                if (direct_gaf) {
+                    // Skip the general GAF converter.
+                    flags |= ALIGNMENT_EMITTER_FLAG_GAF_DIRECT;
+                }
+                if (index_surjection_paths) {
+                    // When surjecting, look up path positions in our own index.
+                    flags |= ALIGNMENT_EMITTER_FLAG_HTS_INDEX_PATHS;
+                }
                 
                 // We send along the positional graph when we have it, and otherwise we send the GBWTGraph which is sufficient for GAF output.
                 // TODO: What if we need both a positional graph and a NamedNodeBackTranslation???
                 const HandleGraph* emitter_graph = path_position_graph ? (const HandleGraph*)path_position_graph : (const HandleGraph*)&(gbz->graph);
                 
-                alignment_emitter = get_alignment_emitter(output_filename, output_format,
-                                                          paths, thread_count,
-                                                          emitter_graph, flags);
+                if (!output_shards_name.empty()) {
+                    // Give each thread its own file, listed in a manifest at the output file.
+                    alignment_emitter = make_unique<ShardedAlignmentEmitter>(output_filename, output_format,
+                                                                             paths, thread_count,
+                                                                             emitter_graph, flags);
+                } else {
+                    alignment_emitter = get_alignment_emitter(output_filename, output_format,
+                                                              paths, thread_count,
+                                                              emitter_graph, flags,
+                                                              ordered_output ? &ordered_emitter : nullptr);
+                }
             }
             
+            // Reading can't wait on reads that are not in a batch yet.
+            size_t window = std::max<size_t>(reorder_window != 0 ? reorder_window : 4 * thread_count * batch_size, batch_size);
+            auto wait_for_room = [&](size_t number) {
+                ordered_emitter->wait_for_room(number, window);
+            };
+            
 #ifdef USE_CALLGRIND
             // We want to profile the alignment, not the loading.
             CALLGRIND_START_INSTRUMENTATION;
@@ -1354,18 +1938,26 @@ int main_giraffe(int argc, char** argv) {
             if (interleaved || !fastq_filename_2.empty()) {
                 //Map paired end from either one gam or fastq file or two fastq files
 
-                // a buffer to hold read pairs that can't be unambiguously mapped before the fragment length distribution
-                // is estimated
-                // note: sufficient to have only one buffer because multithreading code enforces single threaded mode
-                // during distribution estimation
-                vector<pair<Alignment, Alignment>> ambiguous_pair_buffer;
+                // buffers to hold read pairs that can't be unambiguously mapped before the fragment length distribution
+                // is estimated, one per thread since with parallel warmup all threads can be estimating it at once
+                vector<vector<pair<Alignment, Alignment>>> ambiguous_pair_buffers(thread_count);
+                // the total size of the buffers, which other threads can read safely
+                atomic<size_t> ambiguous_pair_count(0);
                 
                 // Track whether the distribution was ready, so we can detect when it becomes ready and capture the all-threads start time.
                 bool distribution_was_ready = false;
+                if (parallel_warmup) {
+                    // All the threads start at once.
+                    all_threads_start = first_thread_start;
+                }
 
                 // Define how to know if the paired end distribution is ready
                 auto distribution_is_ready = [&]() {
                     bool is_ready = minimizer_mapper.fragment_distr_is_finalized();
+                    if (parallel_warmup) {
+                        // The threads don't wait for the distribution.
+                        return true;
+                    }
                     if (is_ready && !distribution_was_ready) {
                         // It has become ready now.
                         distribution_was_ready = true;
@@ -1386,10 +1978,11 @@ int main_giraffe(int argc, char** argv) {
                 
                 // Define a way to force the distribution ready
                 auto require_distribution_finalized = [&]() {
+                    #pragma omp critical (require_distribution_finalized)
                     if (!minimizer_mapper.fragment_distr_is_finalized()){
                         cerr << "warning[vg::giraffe]: Finalizing fragment length distribution before reaching maximum sample size" << endl;
                         cerr << "                      mapped " << minimizer_mapper.get_fragment_length_sample_size() 
-                             << " reads single ended with " << ambiguous_pair_buffer.size() << " pairs of reads left unmapped" << endl;
+                             << " reads single ended with " << ambiguous_pair_count.load() << " pairs of reads left unmapped" << endl;
                         cerr << "                      mean: " << minimizer_mapper.get_fragment_length_mean() << ", stdev: " 
                              << minimizer_mapper.get_fragment_length_stdev() << endl;
                         minimizer_mapper.finalize_fragment_length_distr();
@@ -1412,8 +2005,15 @@ int main_giraffe(int argc, char** argv) {
                         
                         toUppercaseInPlace(*aln1.mutable_sequence());
                         toUppercaseInPlace(*aln2.mutable_sequence());
+                        if (telemetry) {
+                            telemetry->count_read(thread_num, aln1.sequence().size());
+                            telemetry->count_read(thread_num, aln2.sequence().size());
+                        }
 
+                        auto& ambiguous_pair_buffer = ambiguous_pair_buffers.at(thread_num);
+                        size_t buffered_before = ambiguous_pair_buffer.size();
                         pair<vector<Alignment>, vector<Alignment>> mapped_pairs = minimizer_mapper.map_paired(aln1, aln2, ambiguous_pair_buffer);
+                        ambiguous_pair_count += ambiguous_pair_buffer.size() - buffered_before;
                         if (!mapped_pairs.first.empty() && !mapped_pairs.second.empty()) {
                             //If we actually tried to map this paired end
                             
@@ -1435,8 +2035,11 @@ int main_giraffe(int argc, char** argv) {
                             reads_mapped_by_thread.at(thread_num) += 2;
                         }
                         
-                        if (!minimizer_mapper.fragment_distr_is_finalized() && ambiguous_pair_buffer.size() >= MAX_BUFFERED_PAIRS) {
+                        // each thread gets its share of the buffer limit
+                        if (!minimizer_mapper.fragment_distr_is_finalized() &&
+                            ambiguous_pair_buffer.size() >= (parallel_warmup ? MAX_BUFFERED_PAIRS / thread_count : MAX_BUFFERED_PAIRS)) {
                             // We risk running out of memory if we keep this up.
+                            #pragma omp critical (cerr)
                             cerr << "warning[vg::giraffe]: Encountered " << ambiguous_pair_buffer.size() << " ambiguously-paired reads before finding enough" << endl
                                  << "                      unambiguously-paired reads to learn fragment length distribution. Are you sure" << endl
                                  << "                      your reads are paired and your graph is not a hairball?" << endl;
@@ -1444,7 +2047,10 @@ int main_giraffe(int argc, char** argv) {
                         }
                         
                         if (watchdog) {
-                            watchdog->check_out(thread_num);
+                            watchdog->check_out(thread_num, [&]() {
+                                return ">" + aln1.name() + "\n" + aln1.sequence() + "\n" +
+                                       ">" + aln2.name() + "\n" + aln2.sequence() + "\n";
+                            });
                         }
                         
                         clear_crash_context();
@@ -1454,6 +2060,17 @@ int main_giraffe(int argc, char** argv) {
                     }
                 };
 
+                // Define how to map a pair when we know where it is in the input.
+                // Pairs that wait for the fragment length distribution put out
+                // nothing here, and get new numbers after everything else.
+                auto map_numbered_read_pair = [&](Alignment& aln1, Alignment& aln2, size_t number) {
+                    ordered_emitter->start_read(number);
+                    map_read_pair(aln1, aln2);
+                    ordered_emitter->finish_read();
+                };
+                
+                // How many pairs did we read?
+                size_t pair_count = 0;
                 if (!gam_filename.empty()) {
                     // GAM file to remap
                     get_input_file(gam_filename, [&](istream& in) {
@@ -1462,34 +2079,56 @@ int main_giraffe(int argc, char** argv) {
                     });
                 } else if (!fastq_filename_2.empty()) {
                     //A pair of FASTQ files to map
-                    fastq_paired_two_files_for_each_parallel_after_wait(fastq_filename_1, fastq_filename_2, map_read_pair, distribution_is_ready, batch_size);
+                    if (ordered_emitter) {
+                        pair_count = fastq_paired_two_files_for_each_parallel_after_wait_numbered(fastq_filename_1, fastq_filename_2, map_numbered_read_pair, distribution_is_ready, wait_for_room, batch_size);
+                    } else {
+                        fastq_paired_two_files_for_each_parallel_after_wait(fastq_filename_1, fastq_filename_2, map_read_pair, distribution_is_ready, batch_size);
+                    }
 
 
                 } else if ( !fastq_filename_1.empty()) {
                     // An interleaved FASTQ file to map, map all its pairs in parallel.
-                    fastq_paired_interleaved_for_each_parallel_after_wait(fastq_filename_1, map_read_pair, distribution_is_ready, batch_size);
+                    if (ordered_emitter) {
+                        pair_count = fastq_paired_interleaved_for_each_parallel_after_wait_numbered(fastq_filename_1, map_numbered_read_pair, distribution_is_ready, wait_for_room, batch_size);
+                    } else {
+                        fastq_paired_interleaved_for_each_parallel_after_wait(fastq_filename_1, map_read_pair, distribution_is_ready, batch_size);
+                    }
                 }
 
                 // Now map all the ambiguous pairs
                 // Make sure fragment length distribution is finalized first.
                 require_distribution_finalized();
-                for (pair<Alignment, Alignment>& alignment_pair : ambiguous_pair_buffer) {
-                    try {
-                        set_crash_context(alignment_pair.first.name() + ", " + alignment_pair.second.name());
-                        auto mapped_pairs = minimizer_mapper.map_paired(alignment_pair.first, alignment_pair.second);
-                        // Work out whether it could be properly paired or not, if that is relevant.
-                        int64_t tlen_limit = 0;
-                        if (hts_output && minimizer_mapper.fragment_distr_is_finalized()) {
-                             tlen_limit = minimizer_mapper.get_fragment_length_mean() + 6 * minimizer_mapper.get_fragment_length_stdev();
+                // When the output is ordered, they come after all the other
+                // pairs, in the order they were buffered.
+                size_t ambiguous_number = pair_count;
+                for (auto& ambiguous_pair_buffer : ambiguous_pair_buffers) {
+                    #pragma omp parallel for schedule(dynamic, 1)
+                    for (size_t i = 0; i < ambiguous_pair_buffer.size(); ++i) {
+                        pair<Alignment, Alignment>& alignment_pair = ambiguous_pair_buffer[i];
+                        if (ordered_emitter) {
+                            ordered_emitter->start_read(ambiguous_number + i);
+                        }
+                        try {
+                            set_crash_context(alignment_pair.first.name() + ", " + alignment_pair.second.name());
+                            auto mapped_pairs = minimizer_mapper.map_paired(alignment_pair.first, alignment_pair.second);
+                            // Work out whether it could be properly paired or not, if that is relevant.
+                            int64_t tlen_limit = 0;
+                            if (hts_output && minimizer_mapper.fragment_distr_is_finalized()) {
+                                 tlen_limit = minimizer_mapper.get_fragment_length_mean() + 6 * minimizer_mapper.get_fragment_length_stdev();
+                            }
+                            // Emit the read
+                            alignment_emitter->emit_mapped_pair(std::move(mapped_pairs.first), std::move(mapped_pairs.second), tlen_limit);
+                            // Record that we mapped a read.
+                            reads_mapped_by_thread.at(omp_get_thread_num()) += 2;
+                            clear_crash_context();
+                        } catch (const std::exception& ex) {
+                            report_exception(ex);
+                        }
+                        if (ordered_emitter) {
+                            ordered_emitter->finish_read();
                         }
-                        // Emit the read
-                        alignment_emitter->emit_mapped_pair(std::move(mapped_pairs.first), std::move(mapped_pairs.second), tlen_limit);
-                        // Record that we mapped a read.
-                        reads_mapped_by_thread.at(omp_get_thread_num()) += 2;
-                        clear_crash_context();
-                    } catch (const std::exception& ex) {
-                        report_exception(ex);
                     }
+                    ambiguous_number += ambiguous_pair_buffer.size();
                 }
             } else {
                 // Map single-ended
@@ -1510,6 +2149,9 @@ int main_giraffe(int argc, char** argv) {
                         }
                         
                         toUppercaseInPlace(*aln.mutable_sequence());
+                        if (telemetry) {
+                            telemetry->count_read(thread_num, aln.sequence().size());
+                        }
                     
                         // Map the read with the MinimizerMapper.
                         minimizer_mapper.map(aln, *alignment_emitter);
@@ -1517,7 +2159,9 @@ int main_giraffe(int argc, char** argv) {
                         reads_mapped_by_thread.at(thread_num)++;
                         
                         if (watchdog) {
-                            watchdog->check_out(thread_num);
+                            watchdog->check_out(thread_num, [&]() {
+                                return ">" + aln.name() + "\n" + aln.sequence() + "\n";
+                            });
                         }
                         clear_crash_context();
                     } catch (const std::exception& ex) {
@@ -1535,7 +2179,15 @@ int main_giraffe(int argc, char** argv) {
                 
                 if (!fastq_filename_1.empty()) {
                     // FASTQ file to map, map all its reads in parallel.
-                    fastq_unpaired_for_each_parallel(fastq_filename_1, map_read, batch_size);
+                    if (ordered_emitter) {
+                        fastq_unpaired_for_each_parallel_numbered(fastq_filename_1, [&](Alignment& aln, size_t number) {
+                            ordered_emitter->start_read(number);
+                            map_read(aln);
+                            ordered_emitter->finish_read();
+                        }, wait_for_room, batch_size);
+                    } else {
+                        fastq_unpaired_for_each_parallel(fastq_filename_1, map_read, batch_size);
+                    }
                 }
             }
         
@@ -1548,6 +2200,9 @@ int main_giraffe(int argc, char** argv) {
         stop_perf_for_thread();
 #endif
         
+        // Make the last throughput report.
+        telemetry.reset();
+        
         // Compute wall clock elapsed
         std::chrono::duration<double> all_threads_seconds = end - all_threads_start;
         std::chrono::duration<double> first_thread_additional_seconds = all_threads_start - first_thread_start;
@@ -1573,11 +2228,17 @@ int main_giraffe(int argc, char** argv) {
             }
         }
         
+        #pragma omp parallel
+        {
+            set_thread_allocator_subsystem("");
+        }
+        
         // How many reads did we map?
         size_t total_reads_mapped = 0;
         for (auto& reads_mapped : reads_mapped_by_thread) {
             total_reads_mapped += reads_mapped;
         }
+        last_reads_mapped = total_reads_mapped;
         
         // Compute speed (as reads per thread-second)
         double reads_per_second_per_thread = total_reads_mapped / (all_threads_seconds.count() * thread_count + first_thread_additional_seconds.count());
@@ -1606,7 +2267,37 @@ int main_giraffe(int argc, char** argv) {
                     << " M mapping instructions per inclusive CPU-second" << endl;
             }
 
+            if (minimizer_mapper.duplicate_cache_size > 0) {
+                cerr << "Reused results for " << minimizer_mapper.duplicate_cache_hits() << " duplicate reads or pairs out of "
+                    << (minimizer_mapper.duplicate_cache_hits() + minimizer_mapper.duplicate_cache_misses()) << " looked up." << endl;
+            }
+
             cerr << "Memory footprint: " << gbwt::inGigabytes(gbwt::memoryUsage()) << " GB" << endl;
+            report_memory_usage(cerr, "after mapping");
+            ScratchArena::report_thread_arenas(cerr);
+            watchdog->report_latency(cerr);
+            if (stage_stats) {
+                stage_stats->print_summary(cerr);
+            }
+        }
+        
+        if (stage_stats) {
+            ofstream stage_times(stage_times_name);
+            if (!stage_times) {
+                cerr << "error:[vg giraffe] Could not open " << stage_times_name << " to write stage times" << endl;
+                exit(1);
+            }
+            stage_stats->to_json(stage_times);
+        }
+        
+        if (!slow_reads_name.empty()) {
+            // Dump the reads that took longest, so they can be profiled on their own.
+            ofstream slow_reads(slow_reads_name);
+            if (!slow_reads) {
+                cerr << "error:[vg giraffe] Could not open " << slow_reads_name << " to write slow reads" << endl;
+                exit(1);
+            }
+            watchdog->write_slowest(slow_reads);
         }
         
         
@@ -1615,31 +2306,229 @@ int main_giraffe(int argc, char** argv) {
             report << output_filename << "\t" << reads_per_second_per_thread << endl;
         }
         
-    });
+    };
+    
+    if (serve_socket_name.empty()) {
+        // We need to loop over all the ranges...
+        for_each_combo([&]() {
+            run_mapping(parser);
+        });
+        return 0;
+    }
+    
+    // Otherwise, keep the indexes loaded and map the jobs that come in on the
+    // socket, one at a time, each with all the threads.
+    int listen_fd = listen_for_jobs(serve_socket_name);
+    if (show_progress) {
+        cerr << "Serving mapping jobs on " << serve_socket_name << endl;
+    }
+    
+    // Apply the preset named by a -b option to the given parser, or complain
+    auto apply_preset = [&](GroupedOptionGroup& job_parser, const string& preset_name, string& problem) {
+        auto found = presets.find(preset_name);
+        if (found == presets.end()) {
+            problem = "invalid parameter preset: " + preset_name;
+            return false;
+        }
+        found->second.apply(job_parser);
+        return true;
+    };
+    
+    // Set up a job from the tokens of a job line, on a fresh parser that has the
+    // server's own parameters, followed by the job's overrides. Returns false and
+    // fills in the problem if the job doesn't make sense.
+    auto set_up_job = [&](const vector<string>& tokens, GroupedOptionGroup& job_parser, string& problem) {
+        string ignored;
+        // Replay the server's command line to get its parameters.
+        optind = 0;
+        while (true) {
+            int option_index = 0;
+            int server_c = getopt_long(argc, argv, short_options.c_str(), &long_options[0], &option_index);
+            if (server_c == -1) {
+                break;
+            }
+            if (!job_parser.parse(server_c, optarg) && server_c == 'b') {
+                apply_preset(job_parser, optarg, ignored);
+            }
+        }
+        
+        job_output_filename = tokens.front();
+        if (job_output_filename == "-") {
+            problem = "job output must go to a file";
+            return false;
+        }
         
+        // Parse the job's own options
+        vector<char*> job_argv;
+        string job_command = "giraffe";
+        job_argv.push_back(&job_command[0]);
+        vector<string> job_args(tokens.begin() + 1, tokens.end());
+        for (string& arg : job_args) {
+            job_argv.push_back(&arg[0]);
+        }
+        job_argv.push_back(nullptr);
+        
+        fastq_filename_1.clear();
+        fastq_filename_2.clear();
+        gam_filename.clear();
+        interleaved = false;
+        
+        int old_opterr = opterr;
+        opterr = 0;
+        optind = 0;
+        bool ok = true;
+        while (ok) {
+            int option_index = 0;
+            int job_c = getopt_long(job_argv.size() - 1, job_argv.data(), short_options.c_str(), &long_options[0], &option_index);
+            if (job_c == -1) {
+                break;
+            }
+            if (job_parser.parse(job_c, optarg)) {
+                continue;
+            }
+            switch (job_c) {
+            case 'f':
+                if (fastq_filename_1.empty()) {
+                    fastq_filename_1 = optarg;
+                } else if (fastq_filename_2.empty()) {
+                    fastq_filename_2 = optarg;
+                } else {
+                    problem = "cannot specify more than two FASTQ files";
+                    ok = false;
+                }
+                break;
+            case 'G':
+                gam_filename = optarg;
+                break;
+            case 'i':
+                interleaved = true;
+                break;
+            case 'b':
+                ok = apply_preset(job_parser, optarg, problem);
+                break;
+            default:
+                problem = "unsupported option in job: " + string(job_argv[optind - 1]);
+                ok = false;
+                break;
+            }
+        }
+        opterr = old_opterr;
+        if (!ok) {
+            return false;
+        }
+        if (optind < job_argv.size() - 1) {
+            problem = "extraneous argument in job: " + string(job_argv[optind]);
+            return false;
+        }
+        
+        paired = interleaved || !fastq_filename_2.empty();
+        if (fastq_filename_1.empty() == gam_filename.empty()) {
+            problem = "job needs exactly one of FASTQ input (-f) or GAM input (-G)";
+            return false;
+        }
+        if (interleaved && !fastq_filename_2.empty()) {
+            problem = "cannot designate both interleaved paired ends (-i) and separate paired end file (-f)";
+            return false;
+        }
+        if (ordered_output && !gam_filename.empty()) {
+            problem = "ordered output (--ordered-output) needs FASTQ input (-f)";
+            return false;
+        }
+        for (const string& input : {fastq_filename_1, fastq_filename_2, gam_filename}) {
+            if (!input.empty() && !ifstream(input).is_open()) {
+                problem = "could not open input file " + input;
+                return false;
+            }
+        }
+        
+        // If we don't want rescue, let the user see we don't try it.
+        if (job_parser.get_option_value<size_t>("rescue-attempts") == 0 || rescue_algorithm == MinimizerMapper::rescue_none) {
+            job_parser.set_option_value<size_t>("rescue-attempts", 0);
+        }
+        return true;
+    };
+    
+    bool serving = true;
+    while (serving) {
+        int connection_fd = accept(listen_fd, nullptr, nullptr);
+        if (connection_fd == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int problem = errno;
+            cerr << "error:[vg giraffe] Could not accept connection: " << strerror(problem) << endl;
+            break;
+        }
+        
+        string line;
+        while (read_job_line(connection_fd, line)) {
+            // Split the job into whitespace-separated tokens
+            vector<string> tokens;
+            stringstream line_stream(line);
+            string token;
+            while (line_stream >> token) {
+                tokens.push_back(token);
+            }
+            if (tokens.empty()) {
+                continue;
+            }
+            if (tokens.size() == 1 && tokens.front() == "shutdown") {
+                write_job_reply(connection_fd, "done 0");
+                serving = false;
+                break;
+            }
+            
+            GroupedOptionGroup job_parser = get_options();
+            string problem;
+            if (!set_up_job(tokens, job_parser, problem)) {
+                write_job_reply(connection_fd, "error: " + problem);
+                continue;
+            }
+            
+            if (show_progress) {
+                cerr << "Starting job: " << line << endl;
+            }
+            // Each job learns its own fragment length distribution
+            minimizer_mapper.reset_fragment_length_distr();
+            if (forced_mean && forced_stdev) {
+                minimizer_mapper.force_fragment_length_distr(fragment_mean, fragment_stdev);
+            }
+            run_mapping(job_parser);
+            write_job_reply(connection_fd, "done " + to_string(last_reads_mapped));
+        }
+        close(connection_fd);
+    }
+    
+    close(listen_fd);
+    unlink(serve_socket_name.c_str());
     return 0;
 }
 
 //----------------------------------------------------------------------------
 
-string sample_haplotypes(const vector<pair<string, string>>& indexes, string& basename, string& sample_name, string& haplotype_file, string& kff_file, bool progress) {
+string sample_haplotypes(const vector<pair<string, string>>& indexes, string& basename, string& sample_name, string& haplotype_file, string& kff_file, const vector<string>& read_files, bool progress) {
 
     if (progress) {
         std::cerr << "Sampling haplotypes" << std::endl;
     }
 
     // Sanity checks.
-    if (haplotype_file.empty() || kff_file.empty()) {
-        std::cerr << "error:[vg giraffe] Haplotype sampling requires --haplotype-name and --kff-name." << std::endl;
+    if (haplotype_file.empty() || (kff_file.empty() && read_files.empty())) {
+        std::cerr << "error:[vg giraffe] Haplotype sampling requires --haplotype-name and either --kff-name or FASTQ input." << std::endl;
         std::exit(EXIT_FAILURE);
     }
 
     // Determine output name.
     std::string sample = sample_name;
     if (sample.empty()) {
-        sample = file_base_name(kff_file);
+        std::string sample_file = (kff_file.empty() ? read_files.front() : kff_file);
+        if (kff_file.empty() && split_ext(sample_file).second == "gz") {
+            sample = file_base_name(split_ext(sample_file).first);
+        } else {
+            sample = file_base_name(sample_file);
+        }
         if (progress) {
-            std::cerr << "Guessing from " << kff_file << " that sample name is " << sample << std::endl;
+            std::cerr << "Guessing from " << sample_file << " that sample name is " << sample << std::endl;
         }
     }
     if (sample == "giraffe") {
@@ -1676,7 +2565,12 @@ string sample_haplotypes(const vector<pair<string, string>>& indexes, string& ba
     parameters.include_reference = true;
     gbwt::GBWT sampled_gbwt;
     try {
-        sampled_gbwt = recombinator.generate_haplotypes(haplotypes, kff_file, parameters);
+        if (kff_file.empty()) {
+            KmerCounts counts = haplotypes.kmer_counts_from_reads(read_files, verbosity);
+            sampled_gbwt = recombinator.generate_haplotypes(haplotypes, counts, parameters);
+        } else {
+            sampled_gbwt = recombinator.generate_haplotypes(haplotypes, kff_file, parameters);
+        }
     } catch (const std::runtime_error& e) {
         std::cerr << "error:[vg giraffe] Haplotype sampling failed: " << e.what() << std::endl;
         std::exit(EXIT_FAILURE);
@@ -9,11 +9,13 @@
 
 #include "../hash_map.hpp"
 #include "../recombinator.hpp"
+#include "../utility.hpp"
 
 #include <cmath>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <sstream>
 #include <thread>
 #include <vector>
 #include <unordered_map>
@@ -77,6 +79,7 @@ struct HaplotypesConfig {
         mode_sample_graph,
         mode_preprocess,
         mode_sample_haplotypes,
+        mode_sample_batch,
         mode_map_variants,
         mode_extract,
     };
@@ -89,6 +92,8 @@ struct HaplotypesConfig {
     std::string gbz_output, haplotype_output, score_output;
     std::string distance_name, r_index_name;
     std::string haplotype_input, kmer_input, vcf_input;
+    std::vector<std::string> read_input;
+    std::string sample_manifest;
 
     // Computational parameters.
     size_t k = haplotypes_default_k(), w = haplotypes_default_w();
@@ -113,6 +118,8 @@ void preprocess_graph(const gbwtgraph::GBZ& gbz, Haplotypes& haplotypes, Haploty
 
 void sample_haplotypes(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes, const HaplotypesConfig& config);
 
+void sample_batch(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes, const HaplotypesConfig& config);
+
 void map_variants(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes, const HaplotypesConfig& config);
 
 void extract_haplotypes(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes, const HaplotypesConfig& config);
@@ -134,7 +141,8 @@ int main_haplotypes(int argc, char** argv) {
 
     // Generate or load haplotype information.
     Haplotypes haplotypes;
-    if (config.mode == HaplotypesConfig::mode_sample_graph || config.mode == HaplotypesConfig::mode_preprocess) {
+    if (config.mode == HaplotypesConfig::mode_sample_graph || config.mode == HaplotypesConfig::mode_preprocess ||
+        (config.mode == HaplotypesConfig::mode_sample_batch && config.haplotype_input.empty())) {
         preprocess_graph(gbz, haplotypes, config);
     } else {
         if (config.verbosity >= Haplotypes::verbosity_basic) {
@@ -160,6 +168,9 @@ int main_haplotypes(int argc, char** argv) {
     if (config.mode == HaplotypesConfig::mode_sample_graph || config.mode == HaplotypesConfig::mode_sample_haplotypes) {
         sample_haplotypes(gbz, haplotypes, config);
     }
+    if (config.mode == HaplotypesConfig::mode_sample_batch) {
+        sample_batch(gbz, haplotypes, config);
+    }
 
     // Map variants to subchains.
     if (config.mode == HaplotypesConfig::mode_map_variants) {
@@ -189,6 +200,8 @@ void help_haplotypes(char** argv, bool developer_options) {
     std::cerr << usage << "-k kmers.kff -g output.gbz graph.gbz" << std::endl;
     std::cerr << usage << "-H output.hapl graph.gbz" << std::endl;
     std::cerr << usage << "-i graph.hapl -k kmers.kff -g output.gbz graph.gbz" << std::endl;
+    std::cerr << usage << "-i graph.hapl --read-input reads.fq.gz -g output.gbz graph.gbz" << std::endl;
+    std::cerr << usage << "-i graph.hapl --sample-manifest samples.tsv graph.gbz" << std::endl;
     if (developer_options) {
         std::cerr << usage << "-i graph.hapl --vcf-input variants.vcf graph.gbz > output.tsv" << std::endl;
         std::cerr << usage << "-i graph.hapl -k kmers.kff --extract M:N graph.gbz > output.fa" << std::endl;
@@ -200,12 +213,16 @@ void help_haplotypes(char** argv, bool developer_options) {
     std::cerr << "Output files:" << std::endl;
     std::cerr << "    -g, --gbz-output X        write the output GBZ to X" << std::endl;
     std::cerr << "    -H, --haplotype-output X  write haplotype information to X" << std::endl;
+    std::cerr << "        --sample-manifest X   sample haplotypes for many samples listed in X, one per line:" << std::endl;
+    std::cerr << "                              output GBZ, then a KFF file or FASTQ / FASTA files" << std::endl;
     std::cerr << std::endl;
     std::cerr << "Input files:" << std::endl;
     std::cerr << "    -d, --distance-index X    use this distance index (default: <basename>.dist)" << std::endl;
     std::cerr << "    -r, --r-index X           use this r-index (default: <basename>.ri)" << std::endl;
     std::cerr << "    -i, --haplotype-input X   use this haplotype information (default: generate)" << std::endl;
     std::cerr << "    -k, --kmer-input X        use kmer counts from this KFF file (required for --gbz-output)" << std::endl;
+    std::cerr << "        --read-input X        count the kmers in FASTQ / FASTA file X instead of using -k" << std::endl;
+    std::cerr << "                              (may repeat)" << std::endl;
     std::cerr << std::endl;
     std::cerr << "Options for generating haplotype information:" << std::endl;
     std::cerr << "        --kmer-length N       kmer length for building the minimizer index (default: " << haplotypes_default_k() << ")" << std::endl;
@@ -240,6 +257,8 @@ void help_haplotypes(char** argv, bool developer_options) {
 //----------------------------------------------------------------------------
 
 HaplotypesConfig::HaplotypesConfig(int argc, char** argv, size_t max_threads) {
+    constexpr int OPT_READ_INPUT = 1100;
+    constexpr int OPT_SAMPLE_MANIFEST = 1101;
     constexpr int OPT_KMER_LENGTH = 1200;
     constexpr int OPT_WINDOW_LENGTH = 1201;
     constexpr int OPT_SUBCHAIN_LENGTH = 1202;
@@ -264,6 +283,8 @@ HaplotypesConfig::HaplotypesConfig(int argc, char** argv, size_t max_threads) {
         { "r-index", required_argument, 0, 'r' },
         { "haplotype-input", required_argument, 0, 'i' },
         { "kmer-input", required_argument, 0, 'k' },
+        { "read-input", required_argument, 0, OPT_READ_INPUT },
+        { "sample-manifest", required_argument, 0, OPT_SAMPLE_MANIFEST },
         { "kmer-length", required_argument, 0, OPT_KMER_LENGTH },
         { "window-length", required_argument, 0, OPT_WINDOW_LENGTH },
         { "subchain-length", required_argument, 0, OPT_SUBCHAIN_LENGTH },
@@ -314,6 +335,12 @@ HaplotypesConfig::HaplotypesConfig(int argc, char** argv, size_t max_threads) {
         case 'k':
             this->kmer_input = optarg;
             break;
+        case OPT_READ_INPUT:
+            this->read_input.push_back(optarg);
+            break;
+        case OPT_SAMPLE_MANIFEST:
+            this->sample_manifest = optarg;
+            break;
 
         case OPT_KMER_LENGTH:
             this->k = parse<size_t>(optarg);
@@ -434,15 +461,26 @@ HaplotypesConfig::HaplotypesConfig(int argc, char** argv, size_t max_threads) {
         std::exit(EXIT_FAILURE);
     }
     this->graph_name = argv[optind];
-    if (this->haplotype_input.empty() && !this->kmer_input.empty() && !this->gbz_output.empty()) {
+    if (!this->kmer_input.empty() && !this->read_input.empty()) {
+        std::cerr << "error: [vg haplotypes] cannot use both a KFF file and reads as kmer input" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    bool has_kmers = !this->kmer_input.empty() || !this->read_input.empty();
+    if (!this->sample_manifest.empty() && (has_kmers || !this->gbz_output.empty())) {
+        std::cerr << "error: [vg haplotypes] a sample manifest replaces kmer input and GBZ output" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    if (!this->sample_manifest.empty()) {
+        this->mode = mode_sample_batch;
+    } else if (this->haplotype_input.empty() && has_kmers && !this->gbz_output.empty()) {
         this->mode = mode_sample_graph;
     } else if (this->haplotype_input.empty() && !this->haplotype_output.empty()) {
         this->mode = mode_preprocess;
-    } else if (!this->haplotype_input.empty() && !this->kmer_input.empty() && !this->gbz_output.empty()) {
+    } else if (!this->haplotype_input.empty() && has_kmers && !this->gbz_output.empty()) {
         this->mode = mode_sample_haplotypes;
     } else if (!this->haplotype_input.empty() && !this->vcf_input.empty()) {
         this->mode = mode_map_variants;
-    } else if (!this->haplotype_input.empty() && !this->kmer_input.empty() &&
+    } else if (!this->haplotype_input.empty() && has_kmers &&
         this->chain_id < std::numeric_limits<size_t>::max() && this->subchain_id < std::numeric_limits<size_t>::max()) {
         this->mode = mode_extract;
     }
@@ -558,12 +596,22 @@ size_t threads_to_jobs(size_t threads) {
 
 void validate_subgraph(const gbwtgraph::GBWTGraph& graph, const gbwtgraph::GBWTGraph& subgraph, HaplotypePartitioner::Verbosity verbosity);
 
-void sample_haplotypes(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes, const HaplotypesConfig& config) {
+// Returns the kmer counts from the KFF file or the reads (may throw).
+KmerCounts get_kmer_counts(const Haplotypes& haplotypes, const HaplotypesConfig& config) {
+    if (!config.read_input.empty()) {
+        return haplotypes.kmer_counts_from_reads(config.read_input, config.verbosity);
+    }
+    return haplotypes.kmer_counts(config.kmer_input, config.verbosity);
+}
+
+// Samples haplotypes using the given kmer counts and writes the GBZ.
+void sample_haplotypes(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes, const KmerCounts& counts,
+    const std::string& gbz_output, const HaplotypesConfig& config) {
     omp_set_num_threads(threads_to_jobs(config.threads));
     Recombinator recombinator(gbz, config.verbosity);
     gbwt::GBWT merged;
     try {
-        merged = recombinator.generate_haplotypes(haplotypes, config.kmer_input, config.recombinator_parameters);
+        merged = recombinator.generate_haplotypes(haplotypes, counts, config.recombinator_parameters);
     } catch (const std::runtime_error& e) {
         std::cerr << "error: [vg haplotypes] " << e.what() << std::endl;
         std::exit(EXIT_FAILURE);
@@ -580,7 +628,7 @@ void sample_haplotypes(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes,
         double seconds = gbwt::readTimer() - checkpoint;
         std::cerr << "Built the GBWTGraph in " << seconds << " seconds" << std::endl;
     }
-    save_gbz(merged, output_graph, config.gbz_output, config.verbosity >= Haplotypes::verbosity_basic);
+    save_gbz(merged, output_graph, gbz_output, config.verbosity >= Haplotypes::verbosity_basic);
 
     // Validate the graph.
     if (config.validate) {
@@ -589,6 +637,94 @@ void sample_haplotypes(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes,
     }
 }
 
+void sample_haplotypes(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes, const HaplotypesConfig& config) {
+    omp_set_num_threads(threads_to_jobs(config.threads));
+    KmerCounts counts;
+    try {
+        counts = get_kmer_counts(haplotypes, config);
+    } catch (const std::runtime_error& e) {
+        std::cerr << "error: [vg haplotypes] " << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    sample_haplotypes(gbz, haplotypes, counts, config.gbz_output, config);
+}
+
+//----------------------------------------------------------------------------
+
+/// A sample in a sample manifest: output GBZ and either a KFF file or reads.
+struct ManifestSample {
+    std::string gbz_output;
+    std::string kmer_input;
+    std::vector<std::string> read_input;
+};
+
+std::vector<ManifestSample> read_sample_manifest(const std::string& filename) {
+    std::ifstream in(filename);
+    if (!in) {
+        std::cerr << "error: [vg haplotypes] cannot open sample manifest " << filename << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<ManifestSample> result;
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(in, line)) {
+        line_number++;
+        std::istringstream fields(line);
+        ManifestSample sample;
+        if (!(fields >> sample.gbz_output) || sample.gbz_output.front() == '#') {
+            continue; // Empty line or comment.
+        }
+        std::string input;
+        size_t kff_files = 0;
+        while (fields >> input) {
+            if (split_ext(input).second == "kff") {
+                sample.kmer_input = input;
+                kff_files++;
+            } else {
+                sample.read_input.push_back(input);
+            }
+        }
+        if (kff_files > 1 || sample.kmer_input.empty() == sample.read_input.empty()) {
+            std::cerr << "error: [vg haplotypes] line " << line_number << " of sample manifest " << filename
+                << " must list an output GBZ and either one KFF file or read files" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        result.push_back(sample);
+    }
+    return result;
+}
+
+void sample_batch(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes, const HaplotypesConfig& config) {
+    std::vector<ManifestSample> samples = read_sample_manifest(config.sample_manifest);
+    if (config.verbosity >= Haplotypes::verbosity_basic) {
+        std::cerr << "Sampling haplotypes for " << samples.size() << " samples" << std::endl;
+    }
+
+    // The graph, the haplotype information, and the kmer table are shared
+    // between the samples. Only the counts are replaced for each sample.
+    omp_set_num_threads(threads_to_jobs(config.threads));
+    KmerCounts counts = haplotypes.kmer_table(config.verbosity);
+    for (size_t i = 0; i < samples.size(); i++) {
+        const ManifestSample& sample = samples[i];
+        if (config.verbosity >= Haplotypes::verbosity_basic) {
+            std::cerr << "Sample " << (i + 1) << " / " << samples.size() << ": " << sample.gbz_output << std::endl;
+        }
+        omp_set_num_threads(threads_to_jobs(config.threads));
+        try {
+            if (sample.read_input.empty()) {
+                haplotypes.kmer_counts(sample.kmer_input, counts, config.verbosity);
+            } else {
+                haplotypes.kmer_counts_from_reads(sample.read_input, counts, config.verbosity);
+            }
+        } catch (const std::runtime_error& e) {
+            std::cerr << "error: [vg haplotypes] " << e.what() << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        sample_haplotypes(gbz, haplotypes, counts, sample.gbz_output, config);
+    }
+}
+
 //----------------------------------------------------------------------------
 
 gbwt::size_type path_for_contig(const gbwtgraph::GBZ& gbz, gbwt::size_type contig_id, const std::string& contig_name) {
@@ -885,8 +1021,9 @@ void extract_haplotypes(const gbwtgraph::GBZ& gbz, const Haplotypes& haplotypes,
     Recombinator recombinator(gbz, config.verbosity);
     std::vector<Recombinator::LocalHaplotype> result;
     try {
+        KmerCounts counts = get_kmer_counts(haplotypes, config);
         result = recombinator.extract_sequences(
-            haplotypes, config.kmer_input,
+            haplotypes, counts,
             config.chain_id, config.subchain_id, config.recombinator_parameters
         );
     } catch (const std::runtime_error& e) {
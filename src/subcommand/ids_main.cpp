@@ -21,6 +21,8 @@
 #include "bdsg/hash_graph.hpp"
 #include <bdsg/overlays/overlay_helper.hpp>
 #include "../io/save_handle_graph.hpp"
+#include "../algorithms/id_sort.hpp"
+#include "../algorithms/copy_in_order.hpp"
 #include <gcsa/support.h>
 
 using namespace std;
@@ -37,7 +39,8 @@ void help_ids(char** argv) {
         << "                         by iterating through the supplied graphs and incrementing" << endl
         << "                         their ids to be non-conflicting (modifies original files)" << endl
         << "    -m, --mapping FILE   create an empty node mapping for vg prune" << endl
-        << "    -s, --sort           assign new node IDs in (generalized) topological sort order" << endl;
+        << "    -s, --sort           assign new node IDs in (generalized) topological sort order" << endl
+        << "    -t, --threads N      number of threads to use for sorting and compacting" << endl;
 }
 
 int main_ids(int argc, char** argv) {
@@ -65,12 +68,13 @@ int main_ids(int argc, char** argv) {
             {"join", no_argument, 0, 'j'},
             {"mapping", required_argument, 0, 'm'},
             {"sort", no_argument, 0, 's'},
+            {"threads", required_argument, 0, 't'},
             {"help", no_argument, 0, 'h'},
             {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hci:d:jm:s",
+        c = getopt_long (argc, argv, "hci:d:jm:st:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -103,6 +107,10 @@ int main_ids(int argc, char** argv) {
                 sort = true;
                 break;
 
+            case 't':
+                omp_set_num_threads(parse<int>(optarg));
+                break;
+
             case 'h':
             case '?':
                 help_ids(argv);
@@ -121,44 +129,28 @@ int main_ids(int argc, char** argv) {
             
         if (sort || compact) {
             // We need to reassign IDs
-            hash_map<nid_t, nid_t> new_ids;
-            
+            vector<handle_t> order;
             if (compact && !sort) {
-                // We are compacting, but do not need to topologically sort
-                
-                // Loop over all the nodes in the graph's order and assign them new IDs in ID order.
-                // This is slower than it needs to be, but gets us nice results even on graphs that don't preserve node order.
-                // TODO: counting all the nodes may be an O(1) scan of the graph to save some vector copies.
-                vector<nid_t> all_ids;
-                all_ids.reserve(graph->get_node_count());
-                graph->for_each_handle([&](const handle_t& h) {
-                    all_ids.emplace_back(graph->get_id(h));
-                });
-                std::sort(all_ids.begin(), all_ids.end());
-                
-                // Now invert the vector's mapping
-                new_ids.reserve(all_ids.size());
-                for (nid_t i = 1; i < all_ids.size() + 1; i++) {
-                    new_ids[all_ids[i - 1]] = i;
-                }
+                // We are compacting, but do not need to topologically sort.
+                // Assign new IDs in ID order, which gets us nice results even on graphs that
+                // don't preserve node order.
+                order = algorithms::id_order(graph.get());
             } else {
                 // We are sorting to assign IDs, which inherently compacts.
-                
-                // We only need to sort the ID numbers, not the graph's iteration order (if any).
-                auto handle_order = handlealgs::topological_order(graph.get());
-                
-                // Now invert the order's mapping
-                new_ids.reserve(handle_order.size());
-                for (nid_t i = 1; i < handle_order.size() + 1; i++) {
-                    new_ids[graph->get_id(handle_order[i - 1])] = i;
-                }
+                // Independent components are sorted on separate threads.
+                order = algorithms::component_topological_order(graph.get());
             }
             
-            // Now assign the IDs. If we find any e.g. dangling paths or
-            // edges with no nodes we will crash.
-            graph->reassign_node_ids([&](const nid_t& old_id) {
-                return new_ids.at(old_id);
-            });
+            auto renumbered = vg::io::new_graph_like<MutablePathMutableHandleGraph>(graph.get());
+            if (renumbered) {
+                // Build the renumbered graph in one pass instead of renumbering
+                // every node and path step in place.
+                algorithms::copy_in_order(*graph, *renumbered, order);
+                order.clear();
+                graph = std::move(renumbered);
+            } else {
+                algorithms::assign_ids_in_order(graph.get(), order);
+            }
         }
 
         if (increment != 0) {
@@ -16,6 +16,7 @@
 #include "../xg.hpp"
 #include <vg/io/stream.hpp>
 #include <vg/io/vpkg.hpp>
+#include <vg/io/alignment_emitter.hpp>
 #include <bdsg/overlays/overlay_helper.hpp>
 
 using namespace std;
@@ -27,6 +28,7 @@ void help_inject(char** argv) {
          << endl
          << "options:" << endl
          << "    -x, --xg-name FILE       use this graph or xg index (required, non-XG formats also accepted)" << endl
+         << "    -o, --output-format NAME output the alignments in NAME format (gam / gaf / json) [gam]" << endl
          << "    -t, --threads N          number of threads to use" << endl;
 }
 
@@ -37,6 +39,7 @@ int main_inject(int argc, char** argv) {
     }
 
     string xg_name;
+    string output_format = "GAM";
     int threads = get_thread_count();
 
     int c;
@@ -46,12 +49,13 @@ int main_inject(int argc, char** argv) {
         {
           {"help", no_argument, 0, 'h'},
           {"xg-name", required_argument, 0, 'x'},
+          {"output-format", required_argument, 0, 'o'},
           {"threads", required_argument, 0, 't'},
           {0, 0, 0, 0}
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:t:",
+        c = getopt_long (argc, argv, "hx:o:t:",
                          long_options, &option_index);
 
         // Detect the end of the options.
@@ -64,6 +68,17 @@ int main_inject(int argc, char** argv) {
             xg_name = optarg;
             break;
 
+        case 'o':
+            output_format = optarg;
+            for (auto& ch : output_format) {
+                ch = toupper(ch);
+            }
+            if (output_format != "GAM" && output_format != "GAF" && output_format != "JSON") {
+                cerr << "error[vg inject]: Invalid output format: " << optarg << endl;
+                exit(1);
+            }
+            break;
+
         case 't':
           threads = parse<int>(optarg);
           break;
@@ -92,11 +107,19 @@ int main_inject(int argc, char** argv) {
     bdsg::PathPositionOverlayHelper overlay_helper;
     PathPositionHandleGraph* xgidx = overlay_helper.apply(path_handle_graph.get());    
 
-    vg::io::ProtobufEmitter<Alignment> buf(cout);
-    function<void(Alignment&)> lambda = [&buf](Alignment& aln) {
-#pragma omp critical (buf)
-        {
-            buf.write(std::move(aln));
+    // The emitter buffers and serializes each thread's alignments on its own
+    // thread, so converting threads only wait for it to write out.
+    unique_ptr<vg::io::AlignmentEmitter> alignment_emitter = vg::io::get_non_hts_alignment_emitter(
+        "-", output_format, {}, threads, xgidx);
+    
+    // Hand the alignments over in batches
+    vector<vector<Alignment>> batches(threads);
+    function<void(Alignment&)> lambda = [&](Alignment& aln) {
+        auto& batch = batches.at(omp_get_thread_num());
+        batch.emplace_back(std::move(aln));
+        if (batch.size() == HTS_READ_BATCH_SIZE) {
+            alignment_emitter->emit_singles(std::move(batch));
+            batch.clear();
         }
     };
     if (threads > 1) {
@@ -104,6 +127,11 @@ int main_inject(int argc, char** argv) {
     } else {
         hts_for_each(file_name, lambda, xgidx);
     }
+    for (auto& batch : batches) {
+        if (!batch.empty()) {
+            alignment_emitter->emit_singles(std::move(batch));
+        }
+    }
     return 0;
 }
 
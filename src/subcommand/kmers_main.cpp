@@ -9,6 +9,7 @@
 #include <getopt.h>
 
 #include <iostream>
+#include <mutex>
 #include <set>
 
 #include "subcommand.hpp"
@@ -16,6 +17,8 @@
 #include "../vg.hpp"
 #include "../vg_set.hpp"
 #include "../kmer.hpp"
+#include "../kff.hpp"
+#include "../hash_map.hpp"
 
 using namespace std;
 using namespace vg;
@@ -29,6 +32,9 @@ void help_kmers(char** argv) {
          << "    -k, --kmer-size N     print kmers of size N in the graph" << endl
          << "    -t, --threads N       number of threads to use" << endl
          << "    -p, --progress        show progress" << endl
+         << "kff options:" << endl
+         << "    -K, --kff-out FILE    count canonical kmers (on either strand) instead, and write them" << endl
+         << "                          with their counts to FILE in KFF format (N <= 31)" << endl
          << "gcsa options:" << endl
          << "    -g, --gcsa-out        output a table suitable for input to GCSA2:" << endl
          << "                          kmer, starting position, previous characters," << endl
@@ -49,6 +55,7 @@ int main_kmers(int argc, char** argv) {
     // General options.
     size_t kmer_size = 0;
     bool show_progress = false;
+    string kff_name;
 
     // GCSA options. Head and tail for distributed kmer generation.
     bool gcsa_out = false;
@@ -66,6 +73,9 @@ int main_kmers(int argc, char** argv) {
             {"kmer-size", required_argument, 0, 'k'},
             {"threads", required_argument, 0, 't'},
             {"progress",  no_argument, 0, 'p'},
+            
+            // KFF options.
+            {"kff-out", required_argument, 0, 'K'},
 
             // GCSA options.
             {"gcsa-out", no_argument, 0, 'g'},
@@ -82,7 +92,7 @@ int main_kmers(int argc, char** argv) {
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "k:t:pgBH:T:e:Fh",
+        c = getopt_long (argc, argv, "k:t:pK:gBH:T:e:Fh",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -101,6 +111,11 @@ int main_kmers(int argc, char** argv) {
             case 'p':
                 show_progress = true;
                 break;
+                
+            // KFF options.
+            case 'K':
+                kff_name = optarg;
+                break;
 
             // GCSA options.
             case 'g':
@@ -143,6 +158,17 @@ int main_kmers(int argc, char** argv) {
         std::exit(EXIT_FAILURE);
     }
 
+    if (!kff_name.empty()) {
+        if (gcsa_out) {
+            cerr << "error: [vg kmers] KFF output (-K) cannot be combined with GCSA output (-g, -B)" << endl;
+            std::exit(EXIT_FAILURE);
+        }
+        if (kmer_size > gbwtgraph::Key64::KMER_MAX_LENGTH) {
+            cerr << "error: [vg kmers] KFF output (-K) supports kmers of size up to " << gbwtgraph::Key64::KMER_MAX_LENGTH << endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
     vector<string> graph_file_names;
     while (optind < argc) {
         string file_name = get_input_file_name(optind, argc, argv);
@@ -160,6 +186,76 @@ int main_kmers(int argc, char** argv) {
             size_t limit = ~(size_t)0;
             graphs.write_gcsa_kmers_binary(cout, kmer_size, limit, head_id, tail_id);
         }
+    } else if (!kff_name.empty()) {
+        typedef gbwtgraph::Key64::value_type packed_kmer_t;
+        
+        // Count packed canonical kmers into hash table shards, buffering
+        // them per thread and shard so threads rarely wait on each other.
+        size_t threads = omp_get_max_threads();
+        // Use a fixed number of shards, so the output order does not depend
+        // on the thread count.
+        size_t shard_count = 256;
+        size_t flush_size = 1024;
+        vector<flat_hash_map<packed_kmer_t, size_t>> shards(shard_count);
+        vector<mutex> shard_mutexes(shard_count);
+        vector<vector<vector<packed_kmer_t>>> buffers(threads, vector<vector<packed_kmer_t>>(shard_count));
+        wang_hash<packed_kmer_t> hasher;
+        
+        auto flush = [&](size_t shard, vector<packed_kmer_t>& buffer) {
+            lock_guard<mutex> lock(shard_mutexes[shard]);
+            auto& table = shards[shard];
+            for (auto& packed : buffer) {
+                table[packed]++;
+            }
+            buffer.clear();
+        };
+        
+        graphs.for_each_kmer_parallel(kmer_size, [&](const kmer_t& kmer) {
+            // Pack the kmer 2 bits to a base, skipping any with non-ACGT characters.
+            packed_kmer_t packed = 0;
+            for (char base : kmer.seq) {
+                auto code = gbwtgraph::KmerEncoding::CHAR_TO_PACK[static_cast<uint8_t>(base)];
+                if (code > 3) {
+                    return;
+                }
+                packed = (packed << 2) | code;
+            }
+            packed = std::min(packed, minimizer_reverse_complement(packed, kmer_size));
+            
+            size_t shard = hasher(packed) % shard_count;
+            auto& buffer = buffers[omp_get_thread_num()][shard];
+            buffer.push_back(packed);
+            if (buffer.size() >= flush_size) {
+                flush(shard, buffer);
+            }
+        });
+        for (auto& thread_buffers : buffers) {
+            for (size_t shard = 0; shard < shard_count; shard++) {
+                flush(shard, thread_buffers[shard]);
+            }
+        }
+        buffers.clear();
+        
+        if (show_progress) {
+            size_t total = 0;
+            for (auto& table : shards) {
+                total += table.size();
+            }
+            cerr << "[vg kmers] Writing " << total << " distinct kmers to " << kff_name << endl;
+        }
+        
+        // Write the shards one at a time, each sorted so the file does not
+        // depend on timing.
+        kff_write(kff_name, kmer_size, [&](const function<void(packed_kmer_t, size_t)>& write_kmer) {
+            for (auto& table : shards) {
+                vector<pair<packed_kmer_t, size_t>> sorted(table.begin(), table.end());
+                table = flat_hash_map<packed_kmer_t, size_t>();
+                std::sort(sorted.begin(), sorted.end());
+                for (auto& kmer_and_count : sorted) {
+                    write_kmer(kmer_and_count.first, kmer_and_count.second);
+                }
+            }
+        });
     } else {
         auto lambda = [](const kmer_t& kmer) {
 #pragma omp critical (cout)
@@ -87,7 +87,10 @@ void help_minimizer(char** argv) {
     std::cerr << "    -g, --gbwt-name X       use the GBWT index in file X (required with a non-GBZ graph)" << std::endl;
     std::cerr << "    -p, --progress          show progress information" << std::endl;
     std::cerr << "    -t, --threads N         use N threads for index construction (default " << get_default_threads() << ")" << std::endl;
-    std::cerr << "                            (using more than " << DEFAULT_MAX_THREADS << " threads rarely helps)" << std::endl;
+    std::cerr << "                            (using more than " << DEFAULT_MAX_THREADS << " threads rarely helps without --partitioned)" << std::endl;
+    std::cerr << "        --partitioned       sort and deduplicate the minimizers in partitions before inserting" << std::endl;
+    std::cerr << "                            them; scales to more threads but uses more memory" << std::endl;
+    std::cerr << "                            (default threads: all available)" << std::endl;
     std::cerr << "        --no-dist           build the index without distance index annotations (not recommended)" << std::endl;
     std::cerr << std::endl;
 }
@@ -106,6 +109,8 @@ int main_minimizer(int argc, char** argv) {
     size_t threshold = DEFAULT_THRESHOLD, iterations = DEFAULT_ITERATIONS, hash_table_size = 0;
     bool progress = false;
     int threads = get_default_threads();
+    bool threads_set = false;
+    bool partitioned = false;
     bool require_distance_index = true;
 
     constexpr int OPT_THRESHOLD = 1001;
@@ -113,6 +118,7 @@ int main_minimizer(int argc, char** argv) {
     constexpr int OPT_FAST_COUNTING = 1003;
     constexpr int OPT_SAVE_MEMORY = 1004;
     constexpr int OPT_HASH_TABLE = 1005;
+    constexpr int OPT_PARTITIONED = 1006;
     constexpr int OPT_NO_DIST = 1100;
 
     int c;
@@ -139,6 +145,7 @@ int main_minimizer(int argc, char** argv) {
             { "gbwt-graph", no_argument, 0, 'G' }, // deprecated
             { "progress", no_argument, 0, 'p' },
             { "threads", required_argument, 0, 't' },
+            { "partitioned", no_argument, 0, OPT_PARTITIONED },
             { "no-dist", no_argument, 0, OPT_NO_DIST },
             { 0, 0, 0, 0 }
         };
@@ -219,6 +226,10 @@ int main_minimizer(int argc, char** argv) {
             threads = parse<int>(optarg);
             threads = std::min(threads, omp_get_max_threads());
             threads = std::max(threads, 1);
+            threads_set = true;
+            break;
+        case OPT_PARTITIONED:
+            partitioned = true;
             break;
         case OPT_NO_DIST:
             require_distance_index = false;
@@ -248,6 +259,10 @@ int main_minimizer(int argc, char** argv) {
     if (!load_index.empty() || use_syncmers) {
         weighted = false;
     }
+    if (partitioned && !threads_set) {
+        // The thread cap is only there because of the shared insertion.
+        threads = omp_get_max_threads();
+    }
     omp_set_num_threads(threads);
 
 
@@ -356,14 +371,20 @@ int main_minimizer(int argc, char** argv) {
         }
         std::cerr << std::endl;
     }
+    std::function<gbwtgraph::Payload(const pos_t&)> get_payload;
     if (distance_name.empty()) {
-        gbwtgraph::index_haplotypes(gbz->graph, *index, [](const pos_t&) -> gbwtgraph::Payload {
+        get_payload = [](const pos_t&) -> gbwtgraph::Payload {
             return MIPayload::NO_CODE;
-        });
+        };
     } else {
-        gbwtgraph::index_haplotypes(gbz->graph, *index, [&](const pos_t& pos) -> gbwtgraph::Payload {
+        get_payload = [&](const pos_t& pos) -> gbwtgraph::Payload {
             return MIPayload::encode(get_minimizer_distances(*distance_index,pos));
-        });
+        };
+    }
+    if (partitioned) {
+        index_haplotypes_partitioned(gbz->graph, *index, get_payload);
+    } else {
+        gbwtgraph::index_haplotypes(gbz->graph, *index, get_payload);
     }
 
     // Index statistics.
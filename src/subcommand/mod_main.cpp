@@ -20,6 +20,7 @@
 #include "../algorithms/simplify_siblings.hpp"
 #include "../algorithms/normalize.hpp"
 #include "../algorithms/prune.hpp"
+#include "../algorithms/copy_in_order.hpp"
 #include "../io/save_handle_graph.hpp"
 
 using namespace std;
@@ -33,6 +34,7 @@ void help_mod(char** argv) {
          << "options:" << endl
          << "    -P, --label-paths       don't edit with -i alignments, just use them for labeling the graph" << endl
          << "    -c, --compact-ids       should we sort and compact the id space? (default false)" << endl
+         << "                            with -X, chopped pieces are numbered in order too, in one parallel pass" << endl
          << "    -b, --break-cycles      use an approximate topological sort to break cycles in the graph" << endl
          << "    -n, --normalize         normalize the graph so that edges are always non-redundant" << endl
          << "                            (nodes have unique starting and ending bases relative to neighbors," << endl
@@ -704,8 +706,14 @@ int main_mod(int argc, char** argv) {
         *vg_graph = g;
     }
 
+    // If we are going to chop and compact, and can make a new graph like this
+    // one, we can do both at once when we chop, by building a new graph with
+    // the pieces in order, instead of sorting and then chopping in place.
+    bool chop_by_copy = compact_ids && chop_to && vg_graph == nullptr &&
+        vg::io::new_graph_like<MutablePathDeletableHandleGraph>(graph.get()) != nullptr;
+
     // and optionally compact ids
-    if (compact_ids) {
+    if (compact_ids && !chop_by_copy) {
         // Sort and compact IDs.
         // TODO: This differs from vg ids! Make an alforithm.
         graph->apply_ordering(handlealgs::topological_order(graph.get()), true);
@@ -727,7 +735,11 @@ int main_mod(int argc, char** argv) {
         algorithms::prune_short_subgraphs(*graph, path_length);
     }
 
-    if (chop_to) {
+    if (chop_by_copy) {
+        auto chopped = vg::io::new_graph_like<MutablePathDeletableHandleGraph>(graph.get());
+        algorithms::copy_in_order(*graph, *chopped, handlealgs::topological_order(graph.get()), chop_to);
+        graph = std::move(chopped);
+    } else if (chop_to) {
         MutablePathDeletableHandleGraph* chop_graph = graph.get();
         if (vg_graph != nullptr) {
             chop_graph = vg_graph;
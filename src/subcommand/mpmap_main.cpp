@@ -17,10 +17,12 @@
 #include "../algorithms/component.hpp"
 #include "../multipath_mapper.hpp"
 #include "../mem_accelerator.hpp"
+#include "../splice_site_index.hpp"
 #include "../surjector.hpp"
 #include "../multipath_alignment_emitter.hpp"
 #include "../path.hpp"
 #include "../watchdog.hpp"
+#include "../telemetry.hpp"
 #include <bdsg/overlays/overlay_helper.hpp>
 #include <bdsg/packed_graph.hpp>
 #include <bdsg/hash_graph.hpp>
@@ -94,11 +96,13 @@ void help_mpmap(char** argv) {
     << "graph/index:" << endl
     << "  -x, --graph-name FILE     graph (required; XG format recommended but other formats are valid, see `vg convert`) " << endl
     << "  -g, --gcsa-name FILE      use this GCSA2/LCP index pair for MEMs (required; both FILE and FILE.lcp, see `vg index`)" << endl
+    << "      --no-lcp              find MEMs without loading FILE.lcp (less memory, but slower seeding)" << endl
     //<< "  -H, --gbwt-name FILE         use this GBWT haplotype index for population-based MAPQs" << endl
     << "  -d, --dist-name FILE      use this snarl distance index for clustering (recommended, see `vg index`)" << endl
     //<< "      --linear-index FILE      use this sublinear Li and Stephens index file for population-based MAPQs" << endl
     //<< "      --linear-path PATH       use the given path name as the path that the linear index is against" << endl
     << "  -s, --snarls FILE         align to alternate paths in these snarls (unnecessary if providing -d, see `vg snarls`)" << endl
+    << "      --path-components FILE  without -d, load the paths' connected components from FILE, or save them there" << endl
     << "input:" << endl
     << "  -f, --fastq FILE          input FASTQ (possibly gzipped), can be given twice for paired ends (for stdin use -)" << endl
     << "  -i, --interleaved         input contains interleaved paired ends" << endl
@@ -113,6 +117,7 @@ void help_mpmap(char** argv) {
     << "                            reference sequences for HTSlib formats (see -F) [all paths]" << endl
     << "  -N, --sample NAME         add this sample name to output" << endl
     << "  -R, --read-group NAME     add this read group to output" << endl
+    << "      --stream-output       write each alignment as soon as it is converted, rather than a read's whole group at once" << endl
     << "  -p, --suppress-progress   do not report progress to stderr" << endl
     //<< "algorithm:" << endl
     //<< "       --min-dist-cluster       use the minimum distance based clusterer (requires a distance index from -d)" << endl
@@ -120,6 +125,10 @@ void help_mpmap(char** argv) {
 //    << "  -E, --long-read-scoring      set alignment scores to long-read defaults: -q1 -z1 -o1 -y1 -L0 (can be overridden)" << endl
     << "computational parameters:" << endl
     << "  -t, --threads INT         number of compute threads to use [all available]" << endl
+    << "      --cluster-threads INT align to up to this many of a read's clusters at once [1]" << endl
+    << "      --materialize-graphs  copy each read's alignment subgraph into flat arrays before aligning" << endl
+    << "      --telemetry INT       log mapping throughput and memory use every this many seconds" << endl
+    << "      --telemetry-file FILE append telemetry to FILE as JSON lines instead of logging it" << endl
     << endl
     << "advanced options:" << endl
     << "algorithm:" << endl
@@ -131,6 +140,7 @@ void help_mpmap(char** argv) {
     << "  -M, --max-multimaps INT   report (up to) this many mappings per read [10 rna / 1 dna]" << endl
     << "  -a, --agglomerate-alns    combine separate multipath alignments into one (possibly disconnected) alignment" << endl
     << "  -r, --intron-distr FILE   intron length distribution (from scripts/intron_length_distribution.py)" << endl
+    << "      --splice-sites FILE   look up splice motifs in this splice site index of the graph (see `vg rna`)" << endl
     << "  -Q, --mq-max INT          cap mapping quality estimates at this much [60]" << endl
     << "  -b, --frag-sample INT     look for this many unambiguous mappings to estimate the fragment length distribution [1000]" << endl
     << "  -I, --frag-mean FLOAT     mean for a pre-determined fragment length distribution (also requires -D)" << endl
@@ -140,6 +150,8 @@ void help_mpmap(char** argv) {
     //<< "  -P, --max-p-val FLOAT        background model p-value must be less than this to avoid mismapping detection [0.0001]" << endl
     //<< "  -U, --report-group-mapq   add an annotation for the collective mapping quality of all reported alignments" << endl
     //<< "      --padding-mult FLOAT     pad dynamic programming bands in inter-MEM alignment FLOAT * sqrt(read length) [1.0]" << endl
+    //<< "      --batch-tails            align single-traceback read tails exactly, several at a time, instead of with X-drop" << endl
+    //<< "      --prune-connections INT  skip traceback on connections that can't be within INT of the best score [off]" << endl
     << "  -u, --map-attempts INT    perform (up to) this many mappings per read (0 for no limit) [24 paired / 64 unpaired]" << endl
     //<< "      --max-paths INT          consider (up to) this many paths per alignment for population consistency scoring, 0 to disable [10]" << endl
     //<< "      --top-tracebacks         consider paths for each alignment based only on alignment score and not based on haplotypes" << endl
@@ -215,6 +227,16 @@ int main_mpmap(int argc, char** argv) {
     #define OPT_RESEED_LENGTH 1035
     #define OPT_MAX_MOTIF_PAIRS 1036
     #define OPT_SUPPRESS_MISMAPPING_DETECTION 1037
+    #define OPT_BATCH_TAIL_ALIGNMENT 1038
+    #define OPT_PRUNE_CONNECTIONS 1039
+    #define OPT_CLUSTER_THREADS 1040
+    #define OPT_STREAM_OUTPUT 1041
+    #define OPT_NO_LCP 1042
+    #define OPT_SPLICE_SITES 1043
+    #define OPT_TELEMETRY 1044
+    #define OPT_TELEMETRY_FILE 1045
+    #define OPT_MATERIALIZE_GRAPHS 1046
+    #define OPT_PATH_COMPONENTS 1047
     string matrix_file_name;
     string graph_name;
     string gcsa_name;
@@ -223,11 +245,15 @@ int main_mpmap(int argc, char** argv) {
     string sublinearLS_ref_path;
     string snarls_name;
     string distance_index_name;
+    string path_components_name;
     string fastq_name_1;
     string fastq_name_2;
     string gam_file_name;
     string ref_paths_name;
     string intron_distr_name;
+    string splice_sites_name;
+    size_t telemetry_interval = 0;
+    string telemetry_name;
     int match_score = default_match;
     int mismatch_score = default_mismatch;
     int gap_open_score = default_gap_open;
@@ -343,6 +369,10 @@ int main_mpmap(int argc, char** argv) {
     int max_alignment_gap = 5000;
     bool use_pessimistic_tail_alignment = false;
     double pessimistic_gap_multiplier = 3.0;
+    bool batch_tail_alignment = false;
+    int32_t connection_prune_score_diff = -1;
+    int cluster_threads = 1;
+    bool materialize_graphs = false;
     bool restrained_graph_extraction = false;
     bool do_spliced_alignment = false;
     int max_softclip_overlap = 8;
@@ -364,7 +394,10 @@ int main_mpmap(int argc, char** argv) {
     int reversing_walk_length = 1;
     int min_splice_length = 20;
     int mem_accelerator_length = 12;
+    int mem_accelerator_long_length = 18;
     bool no_output = false;
+    bool stream_output = false;
+    bool use_lcp = true;
     string out_format = "GAMP";
 
     // default presets
@@ -418,6 +451,13 @@ int main_mpmap(int argc, char** argv) {
             {"report-allelic-mapq", no_argument, 0, OPT_REPORT_ALLELIC_MAPQ},
             {"suppress-mismapping", no_argument, 0, OPT_SUPPRESS_MISMAPPING_DETECTION},
             {"padding-mult", required_argument, 0, OPT_BAND_PADDING_MULTIPLIER},
+            {"batch-tails", no_argument, 0, OPT_BATCH_TAIL_ALIGNMENT},
+            {"prune-connections", required_argument, 0, OPT_PRUNE_CONNECTIONS},
+            {"cluster-threads", required_argument, 0, OPT_CLUSTER_THREADS},
+            {"materialize-graphs", no_argument, 0, OPT_MATERIALIZE_GRAPHS},
+            {"path-components", required_argument, 0, OPT_PATH_COMPONENTS},
+            {"stream-output", no_argument, 0, OPT_STREAM_OUTPUT},
+            {"no-lcp", no_argument, 0, OPT_NO_LCP},
             {"map-attempts", required_argument, 0, 'u'},
             {"max-paths", required_argument, 0, OPT_MAX_PATHS},
             {"top-tracebacks", no_argument, 0, OPT_TOP_TRACEBACKS},
@@ -450,6 +490,9 @@ int main_mpmap(int argc, char** argv) {
             {"not-spliced", no_argument, 0, 'X'},
             {"splice-odds", required_argument, 0, OPT_SPLICE_ODDS},
             {"intron-distr", required_argument, 0, 'r'},
+            {"splice-sites", required_argument, 0, OPT_SPLICE_SITES},
+            {"telemetry", required_argument, 0, OPT_TELEMETRY},
+            {"telemetry-file", required_argument, 0, OPT_TELEMETRY_FILE},
             {"max-motif-pairs", required_argument, 0, OPT_MAX_MOTIF_PAIRS},
             {"read-length", required_argument, 0, 'l'},
             {"nt-type", required_argument, 0, 'n'},
@@ -675,6 +718,14 @@ int main_mpmap(int argc, char** argv) {
                 band_padding_multiplier = parse<double>(optarg);
                 break;
                 
+            case OPT_BATCH_TAIL_ALIGNMENT:
+                batch_tail_alignment = true;
+                break;
+                
+            case OPT_PRUNE_CONNECTIONS:
+                connection_prune_score_diff = parse<int32_t>(optarg);
+                break;
+                
             case 'u':
                 max_map_attempts_arg = parse<int>(optarg);
                 // let 0 be a sentinel for no limit and also a sentinel for not giving an arg
@@ -820,6 +871,18 @@ int main_mpmap(int argc, char** argv) {
                 intron_distr_name = optarg;
                 break;
                 
+            case OPT_SPLICE_SITES:
+                splice_sites_name = optarg;
+                break;
+                
+            case OPT_TELEMETRY:
+                telemetry_interval = parse<size_t>(optarg);
+                break;
+                
+            case OPT_TELEMETRY_FILE:
+                telemetry_name = optarg;
+                break;
+                
             case 'l':
                 read_length = optarg;
                 break;
@@ -879,10 +942,38 @@ int main_mpmap(int argc, char** argv) {
             }
                 break;
                 
+            case OPT_CLUSTER_THREADS:
+                cluster_threads = parse<int>(optarg);
+                if (cluster_threads <= 0) {
+                    cerr << "error:[vg mpmap] Cluster thread count (--cluster-threads) set to " << cluster_threads << ", must set to a positive integer." << endl;
+                    exit(1);
+                }
+                break;
+                
             case OPT_NO_OUTPUT:
                 no_output = true;
                 break;
                 
+            case OPT_STREAM_OUTPUT:
+                stream_output = true;
+                break;
+                
+            case OPT_NO_LCP:
+                use_lcp = false;
+                break;
+                
+            case OPT_MATERIALIZE_GRAPHS:
+                materialize_graphs = true;
+                break;
+                
+            case OPT_PATH_COMPONENTS:
+                path_components_name = optarg;
+                if (path_components_name.empty()) {
+                    cerr << "error:[vg mpmap] Must provide path component file with --path-components" << endl;
+                    exit(1);
+                }
+                break;
+                
             case 'h':
             case '?':
             default:
@@ -1479,11 +1570,17 @@ int main_mpmap(int argc, char** argv) {
     }
     
     string lcp_name = gcsa_name + ".lcp";
-    ifstream lcp_stream(lcp_name);
-    if (!lcp_stream) {
+    ifstream lcp_stream;
+    if (use_lcp && !use_stripped_match_alg) {
+        lcp_stream.open(lcp_name);
+    }
+    if (use_lcp && !use_stripped_match_alg && !lcp_stream) {
         cerr << "error:[vg mpmap] Cannot open LCP file " << lcp_name << endl;
         exit(1);
     }
+    
+    // optional memoized queries, as made by vg autoindex
+    string mem_accelerator_name = gcsa_name + ".mema";
 
     ifstream matrix_stream;
     if (!matrix_file_name.empty()) {
@@ -1503,6 +1600,15 @@ int main_mpmap(int argc, char** argv) {
         }
     }
     
+    ifstream splice_sites_stream;
+    if (!splice_sites_name.empty()) {
+        splice_sites_stream.open(splice_sites_name);
+        if (!splice_sites_stream) {
+            cerr << "error:[vg mpmap] Cannot open splice site index file " << splice_sites_name << endl;
+            exit(1);
+        }
+    }
+    
     ifstream distance_index_stream;
     if (!distance_index_name.empty() && !(no_clustering && !snarls_name.empty())) {
         distance_index_stream.open(distance_index_name);
@@ -1778,29 +1884,48 @@ int main_mpmap(int argc, char** argv) {
     
     unique_ptr<MEMAccelerator> mem_accelerator;
     unique_ptr<gcsa::LCPArray> lcp_array;
-    if (!use_stripped_match_alg) {
+    if (!use_stripped_match_alg && file_exists(mem_accelerator_name)) {
+        // the memoized queries were saved with the GCSA2
+        log_progress("Loading memoized GCSA2 queries from " + mem_accelerator_name);
+        ifstream mem_accelerator_stream(mem_accelerator_name, ios::binary);
+        mem_accelerator = unique_ptr<MEMAccelerator>(new MEMAccelerator());
+        try {
+            mem_accelerator->load(mem_accelerator_stream);
+        } catch (const runtime_error& e) {
+            cerr << "error:[vg mpmap] Cannot load memoized GCSA2 queries from " << mem_accelerator_name << ": " << e.what() << endl;
+            exit(1);
+        }
+        log_progress("Completed loading memoized GCSA2 queries");
+    }
+    else if (!use_stripped_match_alg) {
         // don't make a huge table for a small graph
         mem_accelerator_length = min<int>(mem_accelerator_length, round(log(total_seq_length) / log(4.0)));
+        mem_accelerator_long_length = min<int>(mem_accelerator_long_length, mem_accelerator_length + 6);
         // try to add an active thread
         int curr_thread_active = threads_active++;
         if (curr_thread_active >= thread_count) {
             // take back the increment and don't let it go multithreaded
             --threads_active;
             log_progress("Memoizing GCSA2 queries");
-            mem_accelerator = unique_ptr<MEMAccelerator>(new MEMAccelerator(*gcsa_index, mem_accelerator_length));
+            mem_accelerator = unique_ptr<MEMAccelerator>(new MEMAccelerator(*gcsa_index, mem_accelerator_length,
+                                                                            mem_accelerator_long_length));
             log_progress("Completed memoizing GCSA2 queries");
         }
         else {
             // do the process in a background thread
             background_processes.emplace_back([&]() {
                 log_progress("Memoizing GCSA2 queries (in background)");
-                mem_accelerator = unique_ptr<MEMAccelerator>(new MEMAccelerator(*gcsa_index, mem_accelerator_length));
+                mem_accelerator = unique_ptr<MEMAccelerator>(new MEMAccelerator(*gcsa_index, mem_accelerator_length,
+                                                                                mem_accelerator_long_length));
                 --threads_active;
                 log_progress("Completed memoizing GCSA2 queries");
             });
         }
-        
-        // The stripped algorithm doesn't use the LCP, but we aren't doing it
+    }
+    
+    if (!use_stripped_match_alg && use_lcp) {
+        // The stripped algorithm doesn't use the LCP, and without it we use a
+        // slower MEM algorithm that doesn't either
         log_progress("Loading LCP from " + lcp_name);
         lcp_array = vg::io::VPKG::load_one<gcsa::LCPArray>(lcp_stream);
         log_progress("Completed loading LCP");
@@ -1874,14 +1999,31 @@ int main_mpmap(int argc, char** argv) {
     }
     background_processes.clear();
     
-    // this also takes a while inside the MultipathMapper constructor, but it will only activate if we don't
-    // have a distance index available for oriented distance calculations
-    if (distance_index_name.empty() && path_handle_graph->get_path_count() > 0) {
+    // this can take a while, but we only need it if we don't have a distance index available for
+    // oriented distance calculations
+    PathComponentIndex* path_component_index = nullptr;
+    if (distance_index_name.empty() && !path_components_name.empty() && file_exists(path_components_name)) {
+        log_progress("Loading path components from " + path_components_name);
+        ifstream path_components_stream(path_components_name);
+        path_component_index = new PathComponentIndex(path_position_handle_graph, path_components_stream);
+    }
+    else if (distance_index_name.empty() && path_handle_graph->get_path_count() > 0) {
         log_progress("Labeling embedded paths by their connected component");
+        path_component_index = new PathComponentIndex(path_position_handle_graph);
+        if (!path_components_name.empty()) {
+            log_progress("Saving path components to " + path_components_name);
+            ofstream path_components_stream(path_components_name);
+            if (!path_components_stream) {
+                cerr << "error:[vg mpmap] Cannot write path components to " << path_components_name << endl;
+                exit(1);
+            }
+            path_component_index->serialize(path_position_handle_graph, path_components_stream);
+        }
     }
     
+    // the mapper takes ownership of the path component index
     MultipathMapper multipath_mapper(path_position_handle_graph, gcsa_index.get(), lcp_array.get(), haplo_score_provider,
-        snarl_manager.get(), distance_index.get());
+        snarl_manager.get(), distance_index.get(), path_component_index);
     // give it the MEMAccelerator
     if (mem_accelerator.get() != nullptr) {
         multipath_mapper.accelerator = mem_accelerator.get();
@@ -1979,6 +2121,10 @@ int main_mpmap(int argc, char** argv) {
     multipath_mapper.max_alignment_gap = max_alignment_gap;
     multipath_mapper.use_pessimistic_tail_alignment = use_pessimistic_tail_alignment;
     multipath_mapper.pessimistic_gap_multiplier = pessimistic_gap_multiplier;
+    multipath_mapper.batch_tail_alignment = batch_tail_alignment;
+    multipath_mapper.connection_prune_score_diff = connection_prune_score_diff;
+    multipath_mapper.cluster_threads = cluster_threads;
+    multipath_mapper.materialize_alignment_graphs = materialize_graphs;
     multipath_mapper.restrained_graph_extraction = restrained_graph_extraction;
     
     // set pair rescue parameters
@@ -2012,6 +2158,12 @@ int main_mpmap(int argc, char** argv) {
     multipath_mapper.splice_rescue_graph_std_devs = splice_rescue_graph_std_devs;
     multipath_mapper.ref_path_handles = move(ref_path_handles);
     multipath_mapper.max_motif_pairs = max_motif_pairs;
+    unique_ptr<SpliceSiteIndex> splice_site_index;
+    if (!splice_sites_name.empty()) {
+        log_progress("Loading splice site index from " + splice_sites_name);
+        splice_site_index = vg::io::VPKG::load_one<SpliceSiteIndex>(splice_sites_stream);
+        multipath_mapper.set_splice_site_index(splice_site_index.get());
+    }
     if (!intron_distr_name.empty()) {
         multipath_mapper.set_intron_length_distribution(intron_mixture_weights, intron_component_params);
     }
@@ -2038,6 +2190,13 @@ int main_mpmap(int argc, char** argv) {
     // If we see any, we will issue a warning.
     unique_ptr<Watchdog> watchdog(new Watchdog(thread_count, chrono::minutes(read_length == "long" ? 40 : 5)));
     
+    // And report how fast we are going as we go, if asked.
+    unique_ptr<Telemetry> telemetry;
+    if (telemetry_interval != 0 || !telemetry_name.empty()) {
+        telemetry.reset(new Telemetry(thread_count, chrono::seconds(telemetry_interval == 0 ? 60 : telemetry_interval),
+                                      telemetry_name));
+    }
+    
     // are we doing paired ends?
     if (interleaved_input || !fastq_name_2.empty()) {
         // make sure buffer size is even (ensures that output will be interleaved)
@@ -2086,6 +2245,7 @@ int main_mpmap(int argc, char** argv) {
                                                                        &path_names_and_length);
     emitter->set_read_group(read_group);
     emitter->set_sample_name(sample_name);
+    emitter->set_streaming(stream_output);
     if (transcriptomic) {
         emitter->set_min_splice_length(min_splice_length);
     }
@@ -2107,6 +2267,9 @@ int main_mpmap(int argc, char** argv) {
         if (watchdog) {
             watchdog->check_in(thread_num, alignment.name());
         }
+        if (telemetry) {
+            telemetry->count_read(thread_num, alignment.sequence().size());
+        }
         
         toUppercaseInPlace(*alignment.mutable_sequence());
         
@@ -2172,6 +2335,10 @@ int main_mpmap(int argc, char** argv) {
         if (watchdog) {
             watchdog->check_in(thread_num, alignment_1.name());
         }
+        if (telemetry) {
+            telemetry->count_read(thread_num, alignment_1.sequence().size());
+            telemetry->count_read(thread_num, alignment_2.sequence().size());
+        }
         
         toUppercaseInPlace(*alignment_1.mutable_sequence());
         toUppercaseInPlace(*alignment_2.mutable_sequence());
@@ -2271,6 +2438,10 @@ int main_mpmap(int argc, char** argv) {
         if (watchdog) {
             watchdog->check_in(thread_num, alignment_1.name());
         }
+        if (telemetry) {
+            telemetry->count_read(thread_num, alignment_1.sequence().size());
+            telemetry->count_read(thread_num, alignment_2.sequence().size());
+        }
         
         bool is_rna = (uses_Us(alignment_1) || uses_Us(alignment_2));
         if (is_rna) {
@@ -2432,6 +2603,9 @@ int main_mpmap(int argc, char** argv) {
     delete emitter;
     cout.flush();
     
+    // Make the last throughput report.
+    telemetry.reset();
+    
     if (!suppress_progress) {
         for (auto uncounted_mappings : thread_num_reads_mapped) {
             num_reads_mapped += uncounted_mappings;
@@ -3,6 +3,7 @@
 #include "../xg.hpp"
 #include "../utility.hpp"
 #include "../packer.hpp"
+#include "../shard_manifest.hpp"
 #include <vg/io/stream.hpp>
 #include <vg/io/vpkg.hpp>
 #include <handlegraph/handle_graph.hpp>
@@ -19,9 +20,10 @@ void help_pack(char** argv) {
          << "options:" << endl
          << "    -x, --xg FILE          use this basis graph (any format accepted, does not have to be xg)" << endl
          << "    -o, --packs-out FILE   write compressed coverage packs to this output file" << endl
-         << "    -i, --packs-in FILE    begin by summing coverage packs from each provided FILE" << endl
-         << "    -g, --gam FILE         read alignments from this GAM file (could be '-' for stdin)" << endl
-         << "    -a, --gaf FILE         read alignments from this GAF file (could be '-' for stdin)" << endl
+         << "    -m, --mmap-out FILE    write uncompressed coverage (no edits) to this file, which vg call can memory-map" << endl
+         << "    -i, --packs-in FILE    begin by summing coverage packs from each provided FILE (e.g. shards of one GAM packed separately)" << endl
+         << "    -g, --gam FILE         read alignments from this GAM file or shard manifest (could be '-' for stdin)" << endl
+         << "    -a, --gaf FILE         read alignments from this GAF file or shard manifest (could be '-' for stdin)" << endl
          << "    -d, --as-table         write table on stdout representing packs" << endl
          << "    -D, --as-edge-table    write table on stdout representing edge coverage" << endl
          << "    -u, --as-qual-table    write table on stdout representing average node mapqs" << endl
@@ -32,6 +34,7 @@ void help_pack(char** argv) {
          << "    -Q, --min-mapq N       ignore reads with MAPQ < N and positions with base quality < N [default: 0]" << endl
          << "    -c, --expected-cov N   expected coverage.  used only for memory tuning [default : 128]" << endl
          << "    -s, --trim-ends N      ignore the first and last N bases of each read" << endl 
+         << "    -A, --atomic-counts    count coverage with lock-free atomic counters (scales better with threads, uses more memory)" << endl
          << "    -t, --threads N        use N threads (defaults to numCPUs)" << endl;
 }
 
@@ -41,6 +44,7 @@ int main_pack(int argc, char** argv) {
     string xg_name;
     vector<string> packs_in;
     string packs_out;
+    string mapped_out;
     string gam_in;
     string gaf_in;
     bool write_table = false;
@@ -54,6 +58,7 @@ int main_pack(int argc, char** argv) {
     int min_baseq = 0;
     size_t expected_coverage = 128;
     int trim_ends = 0;
+    bool atomic_counts = false;
 
     if (argc == 2) {
         help_pack(argv);
@@ -68,6 +73,7 @@ int main_pack(int argc, char** argv) {
             {"help", no_argument, 0, 'h'},
             {"xg", required_argument,0, 'x'},
             {"packs-out", required_argument,0, 'o'},
+            {"mmap-out", required_argument,0, 'm'},
             {"count-in", required_argument, 0, 'i'},
             {"gam", required_argument, 0, 'g'},
             {"gaf", required_argument, 0, 'a'},
@@ -82,11 +88,12 @@ int main_pack(int argc, char** argv) {
             {"min-mapq", required_argument, 0, 'Q'},
             {"expected-cov", required_argument, 0, 'c'},
             {"trim-ends", required_argument, 0, 's'},
+            {"atomic-counts", no_argument, 0, 'A'},
             {0, 0, 0, 0}
 
         };
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:o:i:g:a:dDut:eb:n:N:Q:c:s:",
+        c = getopt_long (argc, argv, "hx:o:m:i:g:a:dDut:eb:n:N:Q:c:s:A",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -106,6 +113,9 @@ int main_pack(int argc, char** argv) {
         case 'o':
             packs_out = optarg;
             break;
+        case 'm':
+            mapped_out = optarg;
+            break;
         case 'i':
             packs_in.push_back(optarg);
             break;
@@ -156,6 +166,9 @@ int main_pack(int argc, char** argv) {
         case 's':
             trim_ends = parse<int>(optarg);
             break;
+        case 'A':
+            atomic_counts = true;
+            break;
         default:
             abort();
         }
@@ -182,8 +195,8 @@ int main_pack(int argc, char** argv) {
         exit(1);
     }
 
-    if (packs_out.empty() && write_table == false && write_edge_table == false && write_qual_table == false) {
-        cerr << "error [vg pack]: Output must be selected with -o, -d or -D" << endl;
+    if (packs_out.empty() && mapped_out.empty() && write_table == false && write_edge_table == false && write_qual_table == false) {
+        cerr << "error [vg pack]: Output must be selected with -o, -m, -d or -D" << endl;
         exit(1);
     }
 
@@ -217,6 +230,11 @@ int main_pack(int argc, char** argv) {
 
     // create our packer
     Packer packer(graph, true, true, record_edits, true, bin_size, bin_count, data_width);
+    if (atomic_counts || packs_in.size() > 1) {
+        // merged shards are summed position by position, which would otherwise
+        // take a bin lock for every base of every shard
+        packer.use_atomic_counters();
+    }
     
     // todo one packer per thread and merge
     if (packs_in.size() == 1) {
@@ -233,6 +251,13 @@ int main_pack(int argc, char** argv) {
         get_input_file(gam_in, [&](istream& in) {
                 vg::io::for_each_parallel(in, lambda, batch_size);
             });
+    } else if (!gaf_in.empty() && !record_edits) {
+        // without edits, we can count straight from the GAF text
+        for (const string& gaf_file : expand_shard_manifest(gaf_in)) {
+            vg::for_each_gaf_record_parallel(gaf_file, [&](const GAFRecordView& record) {
+                    packer.add(record, min_mapq, min_baseq, trim_ends);
+                }, batch_size * 4);
+        }
     } else if (!gaf_in.empty()) {
         // we use this interface so we can ignore sequence, which takes a lot of time to parse
         // and is unused by pack
@@ -245,13 +270,18 @@ int main_pack(int argc, char** argv) {
 
         // computed batch size was tuned for GAM performance.  some small tests show that
         // gaf benefits from a slightly larger one. 
-        vg::io::gaf_unpaired_for_each_parallel(node_to_length, record_edits ? node_to_sequence : nullptr,
-                                               gaf_in, lambda, batch_size * 4);
+        for (const string& gaf_file : expand_shard_manifest(gaf_in)) {
+            vg::io::gaf_unpaired_for_each_parallel(node_to_length, record_edits ? node_to_sequence : nullptr,
+                                                   gaf_file, lambda, batch_size * 4);
+        }
     }
 
     if (!packs_out.empty()) {
         packer.save_to_file(packs_out);
     }
+    if (!mapped_out.empty()) {
+        packer.save_mapped_to_file(mapped_out);
+    }
     if (write_table || write_edge_table || write_qual_table) {
         packer.make_compact();
         if (write_table) {
@@ -45,6 +45,9 @@ void help_paths(char** argv) {
          << "    -M, --metadata           print a table of path names and their metadata" << endl
          << "    -C, --cyclicity          print a list of path names (as with -L) but paired with flag denoting the cyclicity" << endl
          << "    -F, --extract-fasta      print the paths in FASTA format" << endl
+         << "    -U, --subrange START-END with -F and -g, print only bases START to END (0-based, end exclusive)" << endl
+         << "    -O, --offset-index FILE  with -U, seek in GBWT threads using the sampled offset index in FILE" << endl
+         << "                             (built from the GBWT and the graph and saved to FILE if it does not exist)" << endl
          << "    -c, --coverage           print the coverage stats for selected paths (not including cylces)" << endl
          << "  path selection:" << endl
          << "    -p, --paths-file FILE    select the paths named in a file (one per line)" << endl
@@ -103,6 +106,9 @@ int main_paths(int argc, char** argv) {
     bool retain_paths = false;
     string graph_file;
     string gbwt_file;
+    string offset_index_file;
+    bool has_subrange = false;
+    size_t subrange_start = 0, subrange_end = 0;
     string path_prefix;
     string sample_name;
     string path_file;
@@ -137,6 +143,8 @@ int main_paths(int argc, char** argv) {
             {"metadata", no_argument, 0, 'M'},
             {"cyclicity", no_argument, 0, 'C'},
             {"extract-fasta", no_argument, 0, 'F'},
+            {"subrange", required_argument, 0, 'U'},
+            {"offset-index", required_argument, 0, 'O'},
             {"paths-file", required_argument, 0, 'p'},
             {"paths-by", required_argument, 0, 'Q'},
             {"sample", required_argument, 0, 'S'},
@@ -154,7 +162,7 @@ int main_paths(int argc, char** argv) {
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hLXv:x:g:Q:VEMCFAS:Tq:draGRHp:c",
+        c = getopt_long (argc, argv, "hLXv:x:g:Q:VEMCFU:O:AS:Tq:draGRHp:c",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -227,6 +235,24 @@ int main_paths(int argc, char** argv) {
             extract_as_fasta = true;
             output_formats++;
             break;
+
+        case 'U':
+            {
+                string range = optarg;
+                size_t dash = range.find('-');
+                if (dash == string::npos) {
+                    std::cerr << "error: [vg paths] subrange must be given as START-END: " << range << std::endl;
+                    std::exit(EXIT_FAILURE);
+                }
+                subrange_start = parse<size_t>(range.substr(0, dash));
+                subrange_end = parse<size_t>(range.substr(dash + 1));
+                has_subrange = true;
+            }
+            break;
+
+        case 'O':
+            offset_index_file = optarg;
+            break;
                 
         case 'p':
             path_file = optarg;
@@ -339,6 +365,14 @@ int main_paths(int argc, char** argv) {
         std::cerr << "error: [vg paths] dropping or retaining paths only works on embedded graph paths, not GBWT threads" << std::endl;
         std::exit(EXIT_FAILURE);
     }
+    if (has_subrange && (!extract_as_fasta || gbwt_file.empty())) {
+        std::cerr << "error: [vg paths] subrange option -U only works with -F on GBWT threads" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    if (!offset_index_file.empty() && !has_subrange) {
+        std::cerr << "error: [vg paths] offset index option -O requires -U" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
     if (coverage && !gbwt_file.empty()) {
         std::cerr << "error: [vg paths] coverage option -c only works on embedded graph paths, not GBWT threads" << std::endl;
         std::exit(EXIT_FAILURE);
@@ -410,31 +444,50 @@ int main_paths(int argc, char** argv) {
             std::exit(EXIT_SUCCESS);
         }
         
-        // Pre-parse some metadata
-        auto gbwt_reference_samples = gbwtgraph::parse_reference_samples_tag(*gbwt_index);
+        // Compose all the thread names once, so that we can look them up by name.
+        GBWTPathNames gbwt_names(*gbwt_index);
+
+        // Subranges are named like subpaths.
+        auto subrange_name = [&](const std::string& name) -> std::string {
+            return name + "[" + std::to_string(subrange_start) + "-" + std::to_string(subrange_end) + "]";
+        };
+
+        // Load or build the offset index for seeking in the threads.
+        unique_ptr<GBWTOffsetIndex> offset_index;
+        if (!offset_index_file.empty()) {
+            offset_index.reset(new GBWTOffsetIndex());
+            if (file_exists(offset_index_file)) {
+                load_gbwt_offset_index(*offset_index, offset_index_file);
+            } else {
+                *offset_index = GBWTOffsetIndex(*gbwt_index, *graph);
+                save_gbwt_offset_index(*offset_index, offset_index_file);
+            }
+            if (offset_index->paths() != gbwt_index->metadata.paths()) {
+                std::cerr << "error: [vg paths] offset index " << offset_index_file << " does not match the GBWT index" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+        }
 
         // Select the threads we are interested in.
         std::vector<gbwt::size_type> thread_ids;
         if (!sample_name.empty()) {
             thread_ids = threads_for_sample(*gbwt_index, sample_name);
         } else if(!path_prefix.empty()) {
-            for (size_t i = 0; i < gbwt_index->metadata.paths(); i++) {
-                PathSense sense = gbwtgraph::get_path_sense(*gbwt_index, i, gbwt_reference_samples);
-                std::string name = gbwtgraph::compose_path_name(*gbwt_index, i, sense);
+            for (size_t i = 0; i < gbwt_names.size(); i++) {
+                const std::string& name = gbwt_names.name(i);
                 if (name.length() >= path_prefix.length() && std::equal(path_prefix.begin(), path_prefix.end(), name.begin())) {
                     thread_ids.push_back(i);
                 }
             }
         } else if (!path_file.empty()) {
-            // TODO: there doesn't seem to be a look-up by name in the GBWT, so we check all of them
             thread_ids.reserve(path_names.size());
-            for (size_t i = 0; i < gbwt_index->metadata.paths(); i++) {
-                PathSense sense = gbwtgraph::get_path_sense(*gbwt_index, i, gbwt_reference_samples);
-                std::string name = gbwtgraph::compose_path_name(*gbwt_index, i, sense);
-                if (path_names.count(name)) {
-                    thread_ids.push_back(i);
+            for (auto& name : path_names) {
+                gbwt::size_type id = gbwt_names.find(name);
+                if (id < gbwt_names.size()) {
+                    thread_ids.push_back(id);
                 }
             }
+            std::sort(thread_ids.begin(), thread_ids.end());
             if (thread_ids.size() != path_names.size()) {
                 std::cerr << "error: [vg paths] could not find all path names from file in GBWT index" << std::endl;
                 std::exit(EXIT_FAILURE);
@@ -446,46 +499,75 @@ int main_paths(int argc, char** argv) {
             }
         }
         
-        // Process the threads.
-        for (gbwt::size_type id : thread_ids) {
-            PathSense sense = gbwtgraph::get_path_sense(*gbwt_index, id, gbwt_reference_samples);
-            std::string name = gbwtgraph::compose_path_name(*gbwt_index, id, sense);        
-
-            // We are only interested in the name
-            // TODO: do we need to consult list_cyclicity or list_metadata here?
-            if (list_names && !list_lengths) {
-                std::cout << name << endl;
+        // Process the threads. If we need the thread data, we extract a batch
+        // of threads in parallel and then output them in order.
+        constexpr size_t EXTRACT_BATCH_SIZE = 1024;
+        bool names_only = (list_names && !list_lengths);
+        // With an offset index, we can get subranges without extracting the threads.
+        bool seek_only = (offset_index && extract_as_fasta);
+        std::vector<gbwt::size_type> batch;
+        std::vector<Path> batch_paths;
+        for (size_t batch_start = 0; batch_start < thread_ids.size(); batch_start += EXTRACT_BATCH_SIZE) {
+            batch.assign(thread_ids.begin() + batch_start, thread_ids.begin() + std::min(batch_start + EXTRACT_BATCH_SIZE, thread_ids.size()));
+            if (!names_only && !seek_only) {
+                batch_paths = extract_gbwt_paths(*graph, *gbwt_index, batch, gbwt_names);
+            }
+            if (seek_only) {
+                std::vector<std::string> sequences(batch.size());
+                #pragma omp parallel for schedule(dynamic, 1)
+                for (size_t j = 0; j < batch.size(); j++) {
+                    sequences[j] = offset_index->substring(*gbwt_index, *graph, batch[j], subrange_start, subrange_end);
+                }
+                for (size_t j = 0; j < batch.size(); j++) {
+                    write_fasta_sequence(subrange_name(gbwt_names.name(batch[j])), sequences[j], cout);
+                }
                 continue;
             }
+            for (size_t j = 0; j < batch.size(); j++) {
+                gbwt::size_type id = batch[j];
+                const std::string& name = gbwt_names.name(id);
+
+                // We are only interested in the name
+                // TODO: do we need to consult list_cyclicity or list_metadata here?
+                if (names_only) {
+                    std::cout << name << endl;
+                    continue;
+                }
             
-            // TODO: implement list_metadata for GBWT threads?
+                // TODO: implement list_metadata for GBWT threads?
             
-            // Otherwise we need the actual thread data
-            Path path = extract_gbwt_path(*graph, *gbwt_index, id);
-            if (extract_as_gam || extract_as_gaf) {
-                // Write as an Alignment. Must contain the whole path.
-                aln_emitter->emit_singles({alignment_from_path(*graph, path)});
-            } else if (extract_as_vg) {
-                // Write as a Path in a VG
-                chunk_to_emitter(path, *graph_emitter);
-            } else if (extract_as_fasta) {
-                write_fasta_sequence(name, path_sequence(*graph, path), cout);
-            }
-            if (list_lengths) {
-                cout << path.name() << "\t" << path_to_length(path) << endl;
-            }
-            if (list_cyclicity) {
-                bool cyclic = false;
-                unordered_set<pair<nid_t, bool>> visits;
-                for (size_t i = 0; i < path.mapping_size() && !cyclic; ++i) {
-                    const Mapping& mapping = path.mapping(i);
-                    pair<unordered_set<pair<nid_t, bool>>::iterator, bool> ret =
-                        visits.insert(make_pair(mapping.position().node_id(), mapping.position().is_reverse()));
-                    if (ret.second == false) {
-                        cyclic = true;
+                // Otherwise we need the actual thread data
+                const Path& path = batch_paths[j];
+                if (extract_as_gam || extract_as_gaf) {
+                    // Write as an Alignment. Must contain the whole path.
+                    aln_emitter->emit_singles({alignment_from_path(*graph, path)});
+                } else if (extract_as_vg) {
+                    // Write as a Path in a VG
+                    chunk_to_emitter(path, *graph_emitter);
+                } else if (extract_as_fasta && has_subrange) {
+                    string sequence = path_sequence(*graph, path);
+                    size_t start = std::min(subrange_start, sequence.length());
+                    size_t end = std::max(start, std::min(subrange_end, sequence.length()));
+                    write_fasta_sequence(subrange_name(name), sequence.substr(start, end - start), cout);
+                } else if (extract_as_fasta) {
+                    write_fasta_sequence(name, path_sequence(*graph, path), cout);
+                }
+                if (list_lengths) {
+                    cout << path.name() << "\t" << path_to_length(path) << endl;
+                }
+                if (list_cyclicity) {
+                    bool cyclic = false;
+                    unordered_set<pair<nid_t, bool>> visits;
+                    for (size_t i = 0; i < path.mapping_size() && !cyclic; ++i) {
+                        const Mapping& mapping = path.mapping(i);
+                        pair<unordered_set<pair<nid_t, bool>>::iterator, bool> ret =
+                            visits.insert(make_pair(mapping.position().node_id(), mapping.position().is_reverse()));
+                        if (ret.second == false) {
+                            cyclic = true;
+                        }
                     }
+                    cout << path.name() << "\t" << (cyclic ? "cyclic" : "acyclic") << endl;
                 }
-                cout << path.name() << "\t" << (cyclic ? "cyclic" : "acyclic") << endl;
             }
         }
     } else if (graph) {
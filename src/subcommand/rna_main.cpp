@@ -10,6 +10,7 @@
 #include "subcommand.hpp"
 
 #include "../transcriptome.hpp"
+#include "../splice_site_index.hpp"
 #include <vg/io/vpkg.hpp>
 #include <vg/io/stream.hpp>
 #include "../gbwt_helper.hpp"
@@ -58,6 +59,9 @@ void help_rna(char** argv) {
          << "    -i, --write-info FILE      write pantranscriptome transcript info table as tsv file" << endl
          << "    -q, --out-exclude-ref      exclude reference transcripts from pantranscriptome output" << endl
          << "    -g, --gbwt-bidirectional   use bidirectional paths in GBWT index construction" << endl
+         << "    -x, --write-splice-sites FILE  write index of splice motifs in the splicing graph (for vg mpmap --splice-sites)" << endl
+         << "    -w, --stream-output        write projected transcripts as soon as each gene is projected, instead of" << endl
+         << "                               storing them (requires --do-not-sort; reference transcripts are written last)" << endl
 
          << endl;
 }
@@ -86,8 +90,10 @@ int32_t main_rna(int32_t argc, char** argv) {
     bool exclude_reference_transcripts = false;
     string gbwt_out_filename = "";
     bool gbwt_add_bidirectional = false;
+    bool stream_output = false;
     string fasta_out_filename = "";
     string info_out_filename = "";
+    string splice_sites_out_filename = "";
     int32_t num_threads = 1;
     bool show_progress = false;
 
@@ -117,6 +123,8 @@ int32_t main_rna(int32_t argc, char** argv) {
                 {"out-ref-paths",  no_argument, 0, 'u'},
                 {"out-exclude-ref",  no_argument, 0, 'q'},
                 {"gbwt-bidirectional",  no_argument, 0, 'g'},   
+                {"stream-output",  no_argument, 0, 'w'},
+                {"write-splice-sites",  required_argument, 0, 'x'},
                 {"threads",  required_argument, 0, 't'},
                 {"progress",  no_argument, 0, 'p'},
                 {"help", no_argument, 0, 'h'},
@@ -124,7 +132,7 @@ int32_t main_rna(int32_t argc, char** argv) {
             };
 
         int32_t option_index = 0;
-        c = getopt_long(argc, argv, "n:m:y:s:l:zjec:k:dorab:f:i:uqgt:ph?", long_options, &option_index);
+        c = getopt_long(argc, argv, "n:m:y:s:l:zjec:k:dorab:f:i:uqgwx:t:ph?", long_options, &option_index);
 
         /* Detect the end of the options. */
         if (c == -1)
@@ -213,6 +221,14 @@ int32_t main_rna(int32_t argc, char** argv) {
             gbwt_add_bidirectional = true;
             break;
 
+        case 'w':
+            stream_output = true;
+            break;
+
+        case 'x':
+            splice_sites_out_filename = optarg;
+            break;
+
         case 't':
             num_threads = stoi(optarg);
             break;
@@ -260,6 +276,12 @@ int32_t main_rna(int32_t argc, char** argv) {
         return 1;
     }
 
+    if (stream_output && (sort_collapse_graph || max_node_length > 0 || remove_non_transcribed_nodes || add_projected_transcript_paths)) {
+
+        cerr << "[vg rna] ERROR: Streamed transcripts (--stream-output) are written before the graph is finished, and can not be combined with sorting, chopping, removing regions or adding projected transcript paths. Use --do-not-sort." << endl;
+        return 1;
+    }
+
     double time_parsing_start = gcsa::readTimer();
     if (show_progress) { cerr << "[vg rna] Parsing graph file ..." << endl; }
 
@@ -380,10 +402,40 @@ int32_t main_rna(int32_t argc, char** argv) {
         if (show_progress) { cerr << "[vg rna] Transcripts parsed and graph updated in " << gcsa::readTimer() - time_transcript_start << " seconds, " << gcsa::inGigabytes(gcsa::memoryUsage()) << " GB" << endl; };
     }
 
+    bool write_pantranscriptome = (!gbwt_out_filename.empty() || !fasta_out_filename.empty() || !info_out_filename.empty());
+
+    // Pantranscriptome outputs, which are opened before projection if 
+    // the haplotype-specific transcripts are streamed.
+    unique_ptr<gbwt::GBWTBuilder> gbwt_builder;
+    ofstream fasta_ostream;
+    ofstream info_ostream;
+
+    auto open_pantranscriptome_outputs = [&]() {
+
+        if (!gbwt_out_filename.empty()) {
+
+            // Silence GBWT index construction. 
+            gbwt::Verbosity::set(gbwt::Verbosity::SILENT); 
+            gbwt_builder = make_unique<gbwt::GBWTBuilder>(gbwt::bit_length(gbwt::Node::encode(transcriptome.graph().max_node_id(), true)), gbwt::DynamicGBWT::INSERT_BATCH_SIZE, gbwt::DynamicGBWT::SAMPLE_INTERVAL);
+        }
+
+        if (!fasta_out_filename.empty()) {
+
+            fasta_ostream.open(fasta_out_filename);
+        }
+
+        if (!info_out_filename.empty()) {
+
+            info_ostream.open(info_out_filename);
+        }
+    };
+
+    bool streamed_output = false;
+
     if (!transcript_streams.empty() && (!haplotype_index->empty() || proj_emded_paths) && !use_hap_ref) {
 
         double time_project_start = gcsa::readTimer();
-        if (show_progress) { cerr << "[vg rna] Projecting transcripts to haplotypes ..." << endl; }
+        if (show_progress) { cerr << "[vg rna] Projecting transcripts to haplotypes" << ((stream_output && write_pantranscriptome) ? " and writing them to file(s)" : "") << " ..." << endl; }
 
         for (auto & transcript_stream: transcript_streams) {
 
@@ -394,7 +446,25 @@ int32_t main_rna(int32_t argc, char** argv) {
 
         // Add transcripts to transcriptome by projecting them onto embedded paths 
         // in a graph and/or haplotypes in a GBWT index.
-        transcriptome.add_haplotype_transcripts(transcript_streams, *haplotype_index, proj_emded_paths);
+        if (stream_output && write_pantranscriptome) {
+
+            open_pantranscriptome_outputs();
+
+            TranscriptPathOutput path_output;
+            path_output.gbwt_builder = gbwt_builder.get();
+            path_output.add_bidirectional = gbwt_add_bidirectional;
+            path_output.fasta_ostream = (fasta_ostream.is_open() ? &fasta_ostream : nullptr);
+            path_output.tsv_ostream = (info_ostream.is_open() ? &info_ostream : nullptr);
+
+            // Write the transcripts of each gene as soon as it is projected,
+            // so that the haplotype-specific transcripts are not stored.
+            transcriptome.add_haplotype_transcripts(transcript_streams, *haplotype_index, proj_emded_paths, &path_output);
+            streamed_output = true;
+
+        } else {
+
+            transcriptome.add_haplotype_transcripts(transcript_streams, *haplotype_index, proj_emded_paths);
+        }
 
         if (show_progress) { cerr << "[vg rna] Haplotype-specific transcripts constructed in " << gcsa::readTimer() - time_project_start << " seconds, " << gcsa::inGigabytes(gcsa::memoryUsage()) << " GB" << endl; };
     }
@@ -464,35 +534,32 @@ int32_t main_rna(int32_t argc, char** argv) {
 
     double time_writing_start = gcsa::readTimer();
 
-    bool write_pantranscriptome = (!gbwt_out_filename.empty() || !fasta_out_filename.empty() || !info_out_filename.empty());
-
     if (write_pantranscriptome) {
 
         if (show_progress) { cerr << "[vg rna] Writing pantranscriptome transcripts to file(s) ..." << endl; }
     }
 
-    // Write transcript paths in transcriptome as GBWT index.
-    if (!gbwt_out_filename.empty()) {
+    if (!streamed_output) {
 
-        // Silence GBWT index construction. 
-        gbwt::Verbosity::set(gbwt::Verbosity::SILENT); 
-        gbwt::GBWTBuilder gbwt_builder(gbwt::bit_length(gbwt::Node::encode(transcriptome.graph().max_node_id(), true)), gbwt::DynamicGBWT::INSERT_BATCH_SIZE, gbwt::DynamicGBWT::SAMPLE_INTERVAL);
+        open_pantranscriptome_outputs();
+    }
+
+    // Write transcript paths in transcriptome as GBWT index. If the haplotype-specific
+    // transcripts were streamed, only the reference transcripts are left to write.
+    if (!gbwt_out_filename.empty()) {
 
-        transcriptome.add_transcripts_to_gbwt(&gbwt_builder, gbwt_add_bidirectional, exclude_reference_transcripts);
+        transcriptome.add_transcripts_to_gbwt(gbwt_builder.get(), gbwt_add_bidirectional, exclude_reference_transcripts);
 
-        assert(gbwt_builder.index.hasMetadata());
+        assert(gbwt_builder->index.hasMetadata());
 
         // Finish contruction and recode index.
-        gbwt_builder.finish();
-        save_gbwt(gbwt_builder.index, gbwt_out_filename);
+        gbwt_builder->finish();
+        save_gbwt(gbwt_builder->index, gbwt_out_filename);
     }
 
     // Write transcript sequences in transcriptome as fasta file.
     if (!fasta_out_filename.empty()) {
 
-        ofstream fasta_ostream;
-        fasta_ostream.open(fasta_out_filename);
-
         transcriptome.write_transcript_sequences(&fasta_ostream, exclude_reference_transcripts);
      
         fasta_ostream.close();
@@ -501,14 +568,32 @@ int32_t main_rna(int32_t argc, char** argv) {
     // Write transcript info in transcriptome as tsv file.
     if (!info_out_filename.empty()) {
 
-        ofstream info_ostream;
-        info_ostream.open(info_out_filename);
-
-        transcriptome.write_transcript_info(&info_ostream, *haplotype_index, exclude_reference_transcripts);
+        transcriptome.write_transcript_info(&info_ostream, *haplotype_index, exclude_reference_transcripts, !streamed_output);
 
         info_ostream.close();
     }    
 
+    // Write index of splice motifs in the final splicing graph.
+    if (!splice_sites_out_filename.empty()) {
+
+        if (show_progress) { cerr << "[vg rna] Writing splice site index to file ..." << endl; }
+
+        Aligner aligner;
+        SpliceSiteIndex splice_site_index(transcriptome.graph(), SpliceStats(aligner));
+
+        ofstream splice_sites_ostream;
+        splice_sites_ostream.open(splice_sites_out_filename);
+
+        if (!splice_sites_ostream) {
+
+            cerr << "[vg rna] ERROR: Could not open splice site index file " << splice_sites_out_filename << " for writing." << endl;
+            return 1;
+        }
+
+        splice_site_index.serialize(splice_sites_ostream);
+        splice_sites_ostream.close();
+    }
+
     if (show_progress) { cerr << "[vg rna] Writing splicing graph to stdout ..." << endl; }
 
     // Write splicing graph to stdout 
@@ -108,7 +108,8 @@ void help_sim(char** argv) {
          << "    -v, --frag-std-dev FLOAT    use this standard deviation for fragment length estimation" << endl
          << "    -N, --allow-Ns              allow reads to be sampled from the graph with Ns in them" << endl
          << "    --max-tries N               attempt sampling operations up to N times before giving up [100]" << endl
-         << "    -t, --threads               number of compute threads (only when using FASTQ with -F) [1]" << endl
+         << "    --precompute-paths          precompute the sequences of the paths to simulate from (faster, uses more memory)" << endl
+         << "    -t, --threads               number of compute threads [1]" << endl
          << "simulate from paths:" << endl
          << "    -P, --path PATH             simulate from this path (may repeat; cannot also give -T)" << endl
          << "    -A, --any-path              simulate from any path (overrides -P)" << endl
@@ -132,12 +133,14 @@ int main_sim(int argc, char** argv) {
 
     #define OPT_MULTI_POSITION 1000
     #define OPT_MAX_TRIES 1001
+    #define OPT_PRECOMPUTE_PATHS 1002
 
     string xg_name;
     int num_reads = 1;
     int read_length = 100;
     bool progress = false;
     int threads = 1;
+    bool precompute_paths = false;
 
     int seed_val = time(NULL);
     double base_error = 0;
@@ -208,6 +211,7 @@ int main_sim(int argc, char** argv) {
             {"multi-position", no_argument, 0, OPT_MULTI_POSITION},
             {"allow-Ns", no_argument, 0, 'N'},
             {"max-tries", required_argument, 0, OPT_MAX_TRIES},
+            {"precompute-paths", no_argument, 0, OPT_PRECOMPUTE_PATHS},
             {"unsheared", no_argument, 0, 'u'},
             {"sub-rate", required_argument, 0, 'e'},
             {"indel-rate", required_argument, 0, 'i'},
@@ -359,6 +363,10 @@ int main_sim(int argc, char** argv) {
         case OPT_MAX_TRIES:
             max_tries = parse<size_t>(optarg);
             break;
+            
+        case OPT_PRECOMPUTE_PATHS:
+            precompute_paths = true;
+            break;
                 
         case 'u':
             unsheared_fragments = true;
@@ -739,7 +747,11 @@ int main_sim(int argc, char** argv) {
             cerr << "warning: Unsheared fragment option only available when simulating from FASTQ-trained errors" << endl;
         }
         
-        sampler.reset(new Sampler(xgidx, seed_val, forward_only, reads_may_contain_Ns, path_names, path_ploidies, transcript_expressions, haplotype_transcripts));
+        Sampler* basic_sampler = new Sampler(xgidx, seed_val, forward_only, reads_may_contain_Ns, path_names, path_ploidies, transcript_expressions, haplotype_transcripts);
+        if (precompute_paths) {
+            basic_sampler->precompute_source_paths();
+        }
+        sampler.reset(basic_sampler);
     } else {
         // Use the FASTQ-trained sampler
         sampler.reset(new NGSSimulator(*xgidx,
@@ -783,6 +795,16 @@ int main_sim(int argc, char** argv) {
         aln.set_score(aligner.score_contiguous_alignment(aln, strip_bonuses));
     };
     
+    // When just dumping sequence strings, each thread collects them in a buffer
+    // that is written out in batches.
+    vector<string> sequence_buffers(get_thread_count());
+    size_t sequence_buffer_size = 1 << 16;
+    auto flush_sequence_buffer = [&](string& buffer) {
+        #pragma omp critical (cout)
+        cout << buffer;
+        buffer.clear();
+    };
+    
     // And a function to emit either single or paired reads, while recomputing scores.
     auto emit = [&] (Alignment* r1, Alignment* r2) {
         // write the alignment or its string
@@ -801,13 +823,15 @@ int main_sim(int argc, char** argv) {
             }
         } else {
             // Print the sequences of the reads we have.
-            #pragma omp critical
-            {
-                cout << r1->sequence();
-                if (r2) {
-                    cout << "\t" << r2->sequence();
-                }
-                cout << endl;
+            string& buffer = sequence_buffers[omp_get_thread_num()];
+            buffer += r1->sequence();
+            if (r2) {
+                buffer += '\t';
+                buffer += r2->sequence();
+            }
+            buffer += '\n';
+            if (buffer.size() >= sequence_buffer_size) {
+                flush_sequence_buffer(buffer);
             }
         }
     };
@@ -821,8 +845,10 @@ int main_sim(int argc, char** argv) {
         Sampler* basic_sampler = dynamic_cast<Sampler*>(sampler.get());
         
         size_t max_iter = 1000;
-        int nonce = 1;
-        for (int i = 0; i < num_reads; ++i) {
+        // each thread has its own random engine, so static scheduling makes the
+        // output deterministic for a given seed and thread count (except for ordering)
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < num_reads; ++i) {
             // For each read we are going to generate
             
             if (fragment_length) {
@@ -893,6 +919,11 @@ int main_sim(int argc, char** argv) {
         throw std::logic_error("Attempted to use sampler type for which sampling is not implemented!");
     }
     
+    for (string& buffer : sequence_buffers) {
+        flush_sequence_buffer(buffer);
+    }
+    cout.flush();
+    
     return 0;
 }
 
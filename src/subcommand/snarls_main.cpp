@@ -42,6 +42,8 @@ void help_snarl(char** argv) {
          << "    -n, --named-coordinates    produce snarl and traversal outputs in named-segment (GFA) space" << endl
          << "    -T, --include-trivial      report snarls that consist of a single edge" << endl
          << "    -s, --sort-snarls          return snarls in sorted order by node ID (for topologically ordered graphs)" << endl
+         << "    -S, --stream               write each top-level chain's snarls as soon as they are found, without" << endl
+         << "                               holding all the snarls in memory (top-level chains in any order)" << endl
          << "    -v, --vcf FILE             use vcf-based instead of exhaustive traversal finder with -r" << endl
          << "    -f  --fasta FILE           reference in FASTA format (required for SVs by -v)" << endl
          << "    -i  --ins-fasta FILE       insertion sequences in FASTA format (required for SVs by -v)" << endl
@@ -71,6 +73,7 @@ int main_snarl(int argc, char** argv) {
     string ref_fasta_filename;
     string ins_fasta_filename;
     bool path_traversals = false;
+    bool stream_snarls = false;
         
     int c;
     optind = 2; // force optind past command positional argument
@@ -87,6 +90,7 @@ int main_snarl(int argc, char** argv) {
                 {"named-coordinates", no_argument, 0, 'n'},
                 {"include-trivial", no_argument, 0, 'T'},
                 {"sort-snarls", no_argument, 0, 's'},
+                {"stream", no_argument, 0, 'S'},
                 {"vcf", required_argument, 0, 'v'},
                 {"fasta", required_argument, 0, 'f'},
                 {"ins-fasta", required_argument, 0, 'i'},
@@ -97,7 +101,7 @@ int main_snarl(int argc, char** argv) {
 
         int option_index = 0;
 
-        c = getopt_long (argc, argv, "A:sr:laTopm:nv:f:i:eh?t:",
+        c = getopt_long (argc, argv, "A:sSr:laTopm:nv:f:i:eh?t:",
                          long_options, &option_index);
 
         /* Detect the end of the options. */
@@ -142,6 +146,9 @@ int main_snarl(int argc, char** argv) {
         case 's':
             sort_snarls = true;
             break;
+        case 'S':
+            stream_snarls = true;
+            break;
         case 'p':
             fill_path_names = true;
             break;
@@ -234,6 +241,42 @@ int main_snarl(int argc, char** argv) {
         return 1;
     }
 
+    if (stream_snarls && (!traversal_file.empty() || fill_path_names || sort_snarls)) {
+        cerr << "error:[vg snarls]: -S cannot be used with -r, -p or -s" << endl;
+        return 1;
+    }
+    
+    if (stream_snarls) {
+        // Write out each top-level chain as soon as it is done
+        vector<Snarl> snarl_buffer;
+        snarl_finder->find_snarls_streaming([&](vector<Snarl>& chain_snarls) {
+            for (Snarl& snarl : chain_snarls) {
+                if (filter_trivial_snarls) {
+                    // A snarl with nothing but its boundary nodes only has edges between them
+                    handle_t start = graph->get_handle(snarl.start().node_id(), snarl.start().backward());
+                    handle_t end = graph->get_handle(snarl.end().node_id(), snarl.end().backward());
+                    bool trivial = graph->follow_edges(start, false, [&](const handle_t& next) {
+                        return next == end;
+                    }) && graph->follow_edges(end, true, [&](const handle_t& prev) {
+                        return prev == start;
+                    });
+                    if (trivial) {
+                        continue;
+                    }
+                }
+                snarl_buffer.emplace_back(std::move(snarl));
+                if (translation) {
+                    // Bring all the output snarls into named segment space.
+                    algorithms::back_translate_in_place(translation, snarl_buffer.back());
+                }
+                vg::io::write_buffered(cout, snarl_buffer, buffer_size);
+            }
+        });
+        // flush
+        vg::io::write_buffered(cout, snarl_buffer, 0);
+        return 0;
+    }
+
     unique_ptr<TraversalFinder> trav_finder;
     vcflib::VariantCallFile variant_file;
     unique_ptr<FastaReference> ref_fasta;
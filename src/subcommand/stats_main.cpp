@@ -8,6 +8,7 @@
 #include <unistd.h>
 #include <getopt.h>
 
+#include <atomic>
 #include <list>
 #include <fstream>
 
@@ -33,6 +34,7 @@
 #include "../io/converted_hash_graph.hpp"
 #include "../io/save_handle_graph.hpp"
 #include "../gbzgraph.hpp"
+#include "../columnar_alignments.hpp"
 
 using namespace std;
 using namespace vg;
@@ -56,7 +58,7 @@ void help_stats(char** argv) {
          << "    -n, --node ID          consider node with the given id" << endl
          << "    -d, --to-head          show distance to head for each provided node" << endl
          << "    -t, --to-tail          show distance to head for each provided node" << endl
-         << "    -a, --alignments FILE  compute stats for reads aligned to the graph" << endl
+         << "    -a, --alignments FILE  compute stats for reads aligned to the graph (GAM or GAMC)" << endl
          << "    -r, --node-id-range    X:Y where X and Y are the smallest and largest "
         "node id in the graph, respectively" << endl
          << "    -o, --overlap PATH    for each overlapping path mapping in the graph write a table:" << endl
@@ -616,9 +618,6 @@ int main_stats(int argc, char** argv) {
             size_t total_perfect = 0; // Number of reads with no indels or substitutions relative to their paths
             size_t total_gapless = 0; // Number of reads with no indels relative to their paths
 
-            // These are for tracking which nodes are covered and which are not
-            map<vg::id_t, size_t> node_visit_counts;
-
             // And for counting indels
             // Inserted bases also counts softclips
             size_t total_insertions = 0;
@@ -662,10 +661,6 @@ int main_stats(int argc, char** argv) {
                 total_perfect += other.total_perfect;
                 total_gapless += other.total_gapless;
                 
-                for (auto& kv : other.node_visit_counts) {
-                    node_visit_counts[kv.first] += kv.second;
-                }
-                
                 total_insertions += other.total_insertions;
                 total_inserted_bases += other.total_inserted_bases;
                 total_deletions += other.total_deletions;
@@ -773,6 +768,28 @@ int main_stats(int argc, char** argv) {
             }, true);
         }
 
+        // We only report nodes visited never or once, so we count visits to
+        // each graph node, saturating at 2. The counters are shared between
+        // threads and take a byte per node ID, so memory doesn't grow with
+        // the number of reads or threads.
+        vg::id_t min_visit_id = 0;
+        vector<atomic<uint8_t>> node_visit_counts;
+        if (graph != nullptr && graph->get_node_count() > 0) {
+            min_visit_id = graph->min_node_id();
+            node_visit_counts = vector<atomic<uint8_t>>(graph->max_node_id() - min_visit_id + 1);
+        }
+        // Count a visit to a node, if it is in the graph
+        auto visit_node = [&](vg::id_t node_id) {
+            if (node_id < min_visit_id || node_id - min_visit_id >= (vg::id_t) node_visit_counts.size()) {
+                return;
+            }
+            auto& count = node_visit_counts[node_id - min_visit_id];
+            uint8_t seen = count.load(std::memory_order_relaxed);
+            while (seen < 2 && !count.compare_exchange_weak(seen, seen + 1, std::memory_order_relaxed)) {
+                // Someone else counted a visit; try again
+            }
+        };
+
         // Allocate per-thread storage for stats
         size_t thread_count = vg::get_thread_count();
         vector<ReadStats> read_stats;
@@ -833,7 +850,7 @@ int main_stats(int argc, char** argv) {
                     }
 
                     // Record that there was a visit to this node.
-                    stats.node_visit_counts[node_id]++;
+                    visit_node(node_id);
 
                     for(size_t j = 0; j < mapping.edit_size(); j++) {
                         // Go through edits and look for each type.
@@ -910,7 +927,11 @@ int main_stats(int argc, char** argv) {
         };
 
         // Actually go through all the reads and count stuff up.
-        vg::io::for_each_parallel(alignment_stream, lambda);
+        if (is_gamc_stream(alignment_stream)) {
+            for_each_gamc_parallel(alignment_stream, lambda);
+        } else {
+            vg::io::for_each_parallel(alignment_stream, lambda);
+        }
         
         // Now combine into a single ReadStats object (for which we pre-populated reads_on_allele with 0s).
         for (auto& per_thread : read_stats) {
@@ -989,7 +1010,8 @@ int main_stats(int argc, char** argv) {
                 nid_t id = graph->get_id(node);
                 size_t length = graph->get_length(node);
                 
-                if(!combined.node_visit_counts.count(id) || combined.node_visit_counts.at(id) == 0) {
+                uint8_t visits = node_visit_counts[id - min_visit_id].load();
+                if(visits == 0) {
                     // If we never visited it with a read, count it.
                     #pragma omp critical (unvisited_nodes)
                     unvisited_nodes++;
@@ -999,7 +1021,7 @@ int main_stats(int argc, char** argv) {
                         #pragma omp critical (unvisited_ids)
                         unvisited_ids.insert(id);
                     }
-                } else if(combined.node_visit_counts.at(id) == 1) {
+                } else if(visits == 1) {
                     // If we visited it with only one read, count it.
                     #pragma omp critical (single_visited_nodes)
                     single_visited_nodes++;
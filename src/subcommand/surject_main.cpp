@@ -22,6 +22,7 @@
 #include "../surjector.hpp"
 #include "../hts_alignment_emitter.hpp"
 #include "../multipath_alignment_emitter.hpp"
+#include "../shard_manifest.hpp"
 #include "../crash.hpp"
 #include "../watchdog.hpp"
 
@@ -55,6 +56,7 @@ void help_surject(char** argv) {
          << "  -R, --read-group NAME    set this read group for all reads" << endl
          << "  -f, --max-frag-len N     reads with fragment lengths greater than N will not be marked properly paired in SAM/BAM/CRAM" << endl
          << "  -L, --list-all-paths     annotate SAM records with a list of all attempted re-alignments to paths in SS tag" << endl
+         << "  -O, --sort-output        sort SAM/BAM/CRAM output by reference position, spilling to temporary files if needed" << endl
          << "  -C, --compression N      level for compression [0-9]" << endl
          << "  -V, --no-validate        skip checking whether alignments plausibly are against the provided graph" << endl
          << "  -w, --watchdog-timeout N warn when reads take more than the given number of seconds to surject" << endl;
@@ -102,6 +104,7 @@ int main_surject(int argc, char** argv) {
     bool annotate_with_all_path_scores = false;
     bool multimap = false;
     bool validate = true;
+    bool sort_output = false;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -130,6 +133,7 @@ int main_surject(int argc, char** argv) {
             {"read-group", required_argument, 0, 'R'},
             {"max-frag-len", required_argument, 0, 'f'},
             {"list-all-paths", no_argument, 0, 'L'},
+            {"sort-output", no_argument, 0, 'O'},
             {"compress", required_argument, 0, 'C'},
             {"no-validate", required_argument, 0, 'V'},
             {"watchdog-timeout", required_argument, 0, 'w'},
@@ -137,7 +141,7 @@ int main_surject(int argc, char** argv) {
         };
 
         int option_index = 0;
-        c = getopt_long (argc, argv, "hx:p:F:liGmcbsN:R:f:C:t:SPa:ALMVw:",
+        c = getopt_long (argc, argv, "hx:p:F:liGmcbsON:R:f:C:t:SPa:ALMVw:",
                 long_options, &option_index);
 
         // Detect the end of the options.
@@ -220,6 +224,10 @@ int main_surject(int argc, char** argv) {
             max_frag_len = parse<int32_t>(optarg);
             break;
 
+        case 'O':
+            sort_output = true;
+            break;
+
         case 'C':
             compress_level = parse<int>(optarg);
             break;
@@ -261,6 +269,11 @@ int main_surject(int argc, char** argv) {
         }
     };
 
+    if (sort_output && output_format != "SAM" && output_format != "BAM" && output_format != "CRAM") {
+        cerr << "error[vg surject] Sorting output (-O) requires SAM, BAM, or CRAM output" << endl;
+        exit(1);
+    }
+
     string file_name = get_input_file_name(optind, argc, argv);
     
     PathPositionHandleGraph* xgidx = nullptr;
@@ -329,7 +342,8 @@ int main_surject(int argc, char** argv) {
         // respect our parameter for whether to think with splicing.
         unique_ptr<AlignmentEmitter> alignment_emitter = get_alignment_emitter("-", 
             output_format, sequence_dictionary, thread_count, xgidx,
-            ALIGNMENT_EMITTER_FLAG_HTS_RAW | (spliced * ALIGNMENT_EMITTER_FLAG_HTS_SPLICED));
+            ALIGNMENT_EMITTER_FLAG_HTS_RAW | (spliced * ALIGNMENT_EMITTER_FLAG_HTS_SPLICED)
+            | (sort_output * ALIGNMENT_EMITTER_FLAG_HTS_SORTED));
 
         if (interleaved) {
             // GAM input is paired, and for HTS output reads need to know their pair partners' mapping locations.
@@ -450,7 +464,9 @@ int main_surject(int argc, char** argv) {
                     check_gaf_aln(src2);
                     return lambda(src1, src2);
                 };
-                vg::io::gaf_paired_interleaved_for_each_parallel(*xgidx, file_name, gaf_checking_lambda);
+                for (const string& gaf_file : expand_shard_manifest(file_name)) {
+                    vg::io::gaf_paired_interleaved_for_each_parallel(*xgidx, gaf_file, gaf_checking_lambda);
+                }
             }
         } else {
             // We can just surject each Alignment by itself.
@@ -493,7 +509,9 @@ int main_surject(int argc, char** argv) {
                     check_gaf_aln(src);
                     return lambda(src);
                 };
-                vg::io::gaf_unpaired_for_each_parallel(*xgidx, file_name, gaf_checking_lambda);
+                for (const string& gaf_file : expand_shard_manifest(file_name)) {
+                    vg::io::gaf_unpaired_for_each_parallel(*xgidx, gaf_file, gaf_checking_lambda);
+                }
             }
         }
     } else if (input_format == "GAMP") {
@@ -503,6 +521,9 @@ int main_surject(int argc, char** argv) {
         mp_alignment_emitter.set_read_group(read_group);
         mp_alignment_emitter.set_sample_name(sample_name);
         mp_alignment_emitter.set_min_splice_length(spliced ? min_splice_length : numeric_limits<int64_t>::max());
+        if (sort_output) {
+            mp_alignment_emitter.set_sort_by_position();
+        }
         
         // TODO: largely repetitive with GAM
         get_input_file(file_name, [&](istream& in) {
@@ -1,11 +1,13 @@
 #include <getopt.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
 #include "subcommand.hpp"
 
 #include "../vg.hpp"
+#include "../graph.hpp"
 #include <vg/io/vpkg.hpp>
 #include "../haplotype_extracter.hpp"
 #include "../algorithms/find_gbwt.hpp"
@@ -22,7 +24,7 @@ void help_trace(char** argv) {
          << "options:" << endl
          << "    -x, --index FILE           use this xg index or graph" << endl
          << "    -G, --gbwt-name FILE       use this GBWT haplotype index instead of any in the graph" << endl
-         << "    -n, --start-node INT       start at this node" << endl
+         << "    -n, --start-node INT       start at this node (may repeat)" << endl
         //TODO: implement backwards iteration over graph
         // << "    -b, --backwards            iterate backwards over graph" << endl
          << "    -d, --extend-distance INT  extend search this many nodes [default=50]" << endl
@@ -39,7 +41,7 @@ int main_trace(int argc, char** argv) {
   string xg_name;
   string gbwt_name;
   string annotation_path;
-  int64_t start_node = 0;
+  vector<vg::id_t> start_nodes;
   int extend_distance = 50;
   bool backwards = false;
   bool json = false;
@@ -84,7 +86,7 @@ int main_trace(int argc, char** argv) {
         break;
 
     case 'n':
-        start_node = parse<int>(optarg);
+        start_nodes.push_back(parse<vg::id_t>(optarg));
         break;
 
     case 'd':
@@ -114,7 +116,7 @@ int main_trace(int argc, char** argv) {
     cerr << "error:[vg trace] xg index must be specified with -x" << endl;
     return 1;
   }
-  if (start_node < 1) {
+  if (start_nodes.empty() || *min_element(start_nodes.begin(), start_nodes.end()) < 1) {
     cerr << "error:[vg trace] start node must be specified with -n" << endl;
     return 1;
   }
@@ -133,18 +135,18 @@ int main_trace(int argc, char** argv) {
   }
   
   // trace out our graph and paths from the start node
-  Graph trace_graph;
+  VG trace_graph;
   map<string, int> haplotype_frequences;
-  trace_haplotypes_and_paths(*xindex, *gbwt_index, start_node, extend_distance,
+  trace_haplotypes_and_paths(*xindex, *gbwt_index, start_nodes, extend_distance,
                              trace_graph, haplotype_frequences);
 
   // dump our graph to stdout
   if (json) {
-    cout << pb2json(trace_graph);
+    Graph graph;
+    from_path_handle_graph(trace_graph, graph);
+    cout << pb2json(graph);
   } else {
-    VG vg_graph;
-    vg_graph.extend(trace_graph);
-    vg_graph.serialize_to_ostream(cout);
+    trace_graph.serialize_to_ostream(cout);
   }
 
   // if requested, write thread frequencies to a file
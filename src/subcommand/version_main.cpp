@@ -13,6 +13,8 @@
 #include "subcommand.hpp"
 
 #include "../version.hpp"
+#include "../dozeu_kernels.hpp"
+#include "../compare_kernels.hpp"
 
 using namespace std;
 using namespace vg;
@@ -22,6 +24,7 @@ void help_version(char** argv){
     cerr << "usage: " << argv[0] << " version" << endl
          << "options: " << endl
          << "  -s / --slug           print only the one-line, whitespace-free version string" << endl
+         << "  -k / --kernels        print the instruction set chosen for each group of dispatched kernels" << endl
          << "  -h / --help           print this help" << endl
          << endl;
 }
@@ -29,6 +32,7 @@ void help_version(char** argv){
 int main_version(int argc, char** argv){
 
     bool slug_only = false;
+    bool show_kernels = false;
 
     int c;
     optind = 2; // force optind past command positional argument
@@ -36,10 +40,11 @@ int main_version(int argc, char** argv){
         static struct option long_options[] =
             {
                 {"slug", no_argument, 0, 's'},
+                {"kernels", no_argument, 0, 'k'},
                 {"help", no_argument, 0, 'h'},
                 {0, 0, 0, 0}};
         int option_index = 0;
-        c = getopt_long(argc, argv, "sh",
+        c = getopt_long(argc, argv, "skh",
                         long_options, &option_index);
 
         // Detect the end of the options.
@@ -50,6 +55,9 @@ int main_version(int argc, char** argv){
         case 's':
             slug_only = true;
             break;
+        case 'k':
+            show_kernels = true;
+            break;
         case 'h':
         case '?':
         default:
@@ -63,6 +71,13 @@ int main_version(int argc, char** argv){
         return 1;
     }
 
+    if (show_kernels) {
+        cout << "dozeu\t" << get_dozeu_kernels(false).isa << endl;
+        cout << "qual-adj-dozeu\t" << get_dozeu_kernels(true).isa << endl;
+        cout << "gapless-compare\t" << get_compare_kernels().isa << endl;
+        return 0;
+    }
+
     cout << (slug_only ? Version::get_version() : Version::get_long()) << endl;
     return 0;
 }
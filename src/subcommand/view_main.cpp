@@ -10,6 +10,8 @@
 
 #include <list>
 #include <fstream>
+#include <sstream>
+#include <unordered_set>
 
 #include "subcommand.hpp"
 
@@ -31,6 +33,18 @@ using namespace vg;
 using namespace vg::subcommand;
 using namespace vg::io;
 
+/// Clear all the top-level fields of the message that aren't in the given set.
+static void project_fields(google::protobuf::Message& message, const unordered_set<string>& fields) {
+    const google::protobuf::Reflection* reflection = message.GetReflection();
+    vector<const google::protobuf::FieldDescriptor*> present;
+    reflection->ListFields(message, &present);
+    for (const google::protobuf::FieldDescriptor* field : present) {
+        if (!fields.count(field->name())) {
+            reflection->ClearField(&message, field);
+        }
+    }
+}
+
 void help_view(char** argv) {
     cerr << "usage: " << argv[0] << " view [options] [ <graph.vg> | <graph.json> | <aln.gam> | <read1.fq> [<read2.fq>] ]" << endl
          << "options:" << endl
@@ -91,6 +105,7 @@ void help_view(char** argv) {
          << "    -D, --expect-duplicates    don't warn if encountering the same node or edge multiple times" << endl
          << "    -x, --extract-tag TAG      extract and concatenate messages with the given tag" << endl
          << "    --verbose                  explain the file being read with --extract-tag" << endl
+         << "    --fields LIST              when writing JSON from GAM, only include these comma-separated fields" << endl
          << "    --threads N                for parallel operations use this many threads [1]" << endl;
     
     // TODO: Can we regularize the option names for input and output types?
@@ -145,7 +160,10 @@ int main_view(int argc, char** argv) {
     bool ascii_labels = false;
     omp_set_num_threads(1); // default to 1 thread
     
+    unordered_set<string> fields;
+    
     #define OPT_VERBOSE 1000
+    #define OPT_FIELDS 1001
 
     int c;
     optind = 2; // force optind past "view" argument
@@ -195,6 +213,7 @@ int main_view(int argc, char** argv) {
                 {"expect-duplicates", no_argument, 0, 'D'},
                 {"extract-tag", required_argument, 0, 'x'},
                 {"verbose", no_argument, 0, OPT_VERBOSE},
+                {"fields", required_argument, 0, OPT_FIELDS},
                 {"multipath", no_argument, 0, 'k'},
                 {"multipath-in", no_argument, 0, 'K'},
                 {"ascii-labels", no_argument, 0, 'e'},
@@ -429,6 +448,20 @@ int main_view(int argc, char** argv) {
             verbose = true;
             break;
 
+        case OPT_FIELDS:
+        {
+            stringstream field_list(optarg);
+            string field;
+            while (getline(field_list, field, ',')) {
+                if (!Alignment::descriptor()->FindFieldByName(field)) {
+                    cerr << "[vg view] error: Alignment has no field " << field << endl;
+                    exit(1);
+                }
+                fields.insert(field);
+            }
+        }
+            break;
+
         case '7':
             omp_set_num_threads(parse<int>(optarg));
             break;
@@ -573,19 +606,50 @@ int main_view(int argc, char** argv) {
     } else if (input_type == "gam") {
         if (!input_json) {
             if (output_type == "json") {
-                // convert values to printable ones
-                function<void(Alignment&)> lambda = [](Alignment& a) {
-                    if(std::isnan(a.identity())) {
-                        // Fix up NAN identities that can't be serialized in
-                        // JSON. We shouldn't generate these any more, and they
-                        // are out of spec, but they can be in files.
-                        a.set_identity(0);
+                // Render batches of alignments in parallel, in chunks that
+                // each get their own buffer, and write the buffers in order.
+                size_t chunk_size = 256;
+                size_t batch_size = chunk_size * 4 * get_thread_count();
+                vector<Alignment> batch;
+                batch.reserve(batch_size);
+                vector<string> chunk_text;
+                auto render_batch = [&]() {
+                    chunk_text.clear();
+                    chunk_text.resize((batch.size() + chunk_size - 1) / chunk_size);
+                    #pragma omp parallel for schedule(dynamic, 1)
+                    for (size_t chunk = 0; chunk < chunk_text.size(); chunk++) {
+                        string& text = chunk_text[chunk];
+                        for (size_t i = chunk * chunk_size; i < std::min(batch.size(), (chunk + 1) * chunk_size); i++) {
+                            Alignment& a = batch[i];
+                            // convert values to printable ones
+                            if(std::isnan(a.identity())) {
+                                // Fix up NAN identities that can't be serialized in
+                                // JSON. We shouldn't generate these any more, and they
+                                // are out of spec, but they can be in files.
+                                a.set_identity(0);
+                            }
+                            if (!fields.empty()) {
+                                project_fields(a, fields);
+                            }
+                            text += pb2json(a);
+                            text += "\n";
+                        }
+                    }
+                    for (const string& text : chunk_text) {
+                        cout << text;
+                    }
+                    batch.clear();
+                };
+                function<void(Alignment&)> lambda = [&](Alignment& a) {
+                    batch.emplace_back(std::move(a));
+                    if (batch.size() >= batch_size) {
+                        render_batch();
                     }
-                    cout << pb2json(a) << "\n";
                 };
                 get_input_file(file_name, [&](istream& in) {
                     vg::io::for_each(in, lambda);
                 });
+                render_batch();
             } else if (output_type == "fastq") {
                 function<void(Alignment&)> lambda = [](Alignment& a) {
                     cout << "@" << a.name() << endl
@@ -14,11 +14,16 @@ namespace vg {
 using namespace std;
 
 SurjectingAlignmentEmitter::SurjectingAlignmentEmitter(const PathPositionHandleGraph* graph, unordered_set<path_handle_t> paths,
-    unique_ptr<AlignmentEmitter>&& backing, bool prune_suspicious_anchors) : surjector(graph), paths(paths), backing(std::move(backing)) {
+    unique_ptr<AlignmentEmitter>&& backing, bool prune_suspicious_anchors, bool index_paths) : surjector(graph), paths(paths), backing(std::move(backing)) {
     
     // Configure the surjector
     surjector.prune_suspicious_anchors = prune_suspicious_anchors;
     
+    if (index_paths) {
+        // Look up positions on the paths in our own table instead of the graph
+        path_offset_index = make_unique<PathOffsetIndex>(*graph, this->paths);
+        surjector.path_offset_index = path_offset_index.get();
+    }
 }
 
 void SurjectingAlignmentEmitter::surject_alignments_in_place(vector<Alignment>& alns) const {
@@ -30,7 +35,7 @@ void SurjectingAlignmentEmitter::surject_alignments_in_place(vector<Alignment>&
 
 void SurjectingAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
     // Intercept the batch on its way
-    vector<Alignment> aln_batch_caught(aln_batch);
+    vector<Alignment> aln_batch_caught(std::move(aln_batch));
     // Surject it in place
     surject_alignments_in_place(aln_batch_caught);
     // Forward it along
@@ -39,7 +44,7 @@ void SurjectingAlignmentEmitter::emit_singles(vector<Alignment>&& aln_batch) {
 
 void SurjectingAlignmentEmitter::emit_mapped_singles(vector<vector<Alignment>>&& alns_batch) {
     // Intercept the batch on its way
-    vector<vector<Alignment>> alns_batch_caught(alns_batch);
+    vector<vector<Alignment>> alns_batch_caught(std::move(alns_batch));
     for (auto& mappings : alns_batch_caught) {
         // Surject all mappings in place
         surject_alignments_in_place(mappings);
@@ -50,8 +55,8 @@ void SurjectingAlignmentEmitter::emit_mapped_singles(vector<vector<Alignment>>&&
 
 void SurjectingAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch, vector<int64_t>&& tlen_limit_batch) {
     // Intercept the batch on its way
-    vector<Alignment> aln1_batch_caught(aln1_batch);
-    vector<Alignment> aln2_batch_caught(aln2_batch);
+    vector<Alignment> aln1_batch_caught(std::move(aln1_batch));
+    vector<Alignment> aln2_batch_caught(std::move(aln2_batch));
     // Surject it in place
     surject_alignments_in_place(aln1_batch_caught);
     surject_alignments_in_place(aln2_batch_caught);
@@ -61,8 +66,8 @@ void SurjectingAlignmentEmitter::emit_pairs(vector<Alignment>&& aln1_batch, vect
 
 void SurjectingAlignmentEmitter::emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch, vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch) {
     // Intercept the batch on its way
-    vector<vector<Alignment>> alns1_batch_caught(alns1_batch);
-    vector<vector<Alignment>> alns2_batch_caught(alns2_batch);
+    vector<vector<Alignment>> alns1_batch_caught(std::move(alns1_batch));
+    vector<vector<Alignment>> alns2_batch_caught(std::move(alns2_batch));
     for (auto& mappings : alns1_batch_caught) {
         // Surject all mappings in place
         surject_alignments_in_place(mappings);
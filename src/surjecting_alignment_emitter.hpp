@@ -8,6 +8,7 @@
 
 
 #include "surjector.hpp"
+#include "path_offset_index.hpp"
 #include "vg/io/alignment_emitter.hpp"
 #include "handle.hpp"
 
@@ -32,10 +33,13 @@ public:
      *
      * If prune_suspicious_anchors is set, prunes out repetitive-looking
      * anchors when surjecting and lets those parts of reads be realigned.
+     *
+     * If index_paths is set, builds a PathOffsetIndex of the paths, shared by
+     * all threads, to look up path positions in while surjecting.
      */
     SurjectingAlignmentEmitter(const PathPositionHandleGraph* graph,
         unordered_set<path_handle_t> paths, unique_ptr<AlignmentEmitter>&& backing,
-        bool prune_suspicious_anchors = false);
+        bool prune_suspicious_anchors = false, bool index_paths = false);
    
     ///  Force full length alignment in surjection resolution 
     bool surject_subpath_global = true;
@@ -68,6 +72,9 @@ protected:
     /// Paths to surject into
     unordered_set<path_handle_t> paths;
     
+    /// Index of where the paths visit each node, if we made one
+    unique_ptr<PathOffsetIndex> path_offset_index;
+    
     /// AlignmentEmitter to emit to once done
     unique_ptr<AlignmentEmitter> backing;
     
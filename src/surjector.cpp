@@ -32,6 +32,82 @@ namespace vg {
 
 using namespace std;
     
+    namespace {
+    
+    /// Reusable storage for the algorithms on the path chunk colinearity graph, so that
+    /// reads with many chunks don't allocate new nested vectors at every step
+    struct ChunkGraphWorkspace {
+        
+        /// Adjacencies in compressed sparse row form: the edges of node i are
+        /// targets[offsets[i]] through targets[offsets[i + 1] - 1]
+        vector<size_t> offsets;
+        vector<size_t> targets;
+        
+        /// A bitset over the nodes, and which of its words have any bits set
+        vector<uint64_t> bits;
+        vector<size_t> touched_words;
+        
+        /// A DFS stack
+        vector<size_t> stack;
+        
+        /// Load the reverse of an adjacency list, with each node's edges in order by index
+        void load_reverse(const vector<vector<size_t>>& adj) {
+            offsets.assign(adj.size() + 1, 0);
+            for (const auto& adj_list : adj) {
+                for (size_t j : adj_list) {
+                    ++offsets[j + 1];
+                }
+            }
+            for (size_t i = 0; i < adj.size(); ++i) {
+                offsets[i + 1] += offsets[i];
+            }
+            targets.resize(offsets.back());
+            // use the stack to hold the next free position for each node
+            stack.assign(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < adj.size(); ++i) {
+                for (size_t j : adj[i]) {
+                    targets[stack[j]++] = i;
+                }
+            }
+            stack.clear();
+        }
+        
+        /// Clear the bitset and make sure it has room for the given number of nodes
+        void reset_bits(size_t size) {
+            clear_bits();
+            if (bits.size() * 64 < size) {
+                bits.resize((size + 63) / 64, 0);
+            }
+        }
+        
+        inline bool test(size_t i) const {
+            return bits[i / 64] & (uint64_t(1) << (i % 64));
+        }
+        
+        inline void set(size_t i) {
+            uint64_t& word = bits[i / 64];
+            if (!word) {
+                touched_words.push_back(i / 64);
+            }
+            word |= (uint64_t(1) << (i % 64));
+        }
+        
+        /// Unset all the bits, in time proportional to the number of words that were set
+        void clear_bits() {
+            for (size_t w : touched_words) {
+                bits[w] = 0;
+            }
+            touched_words.clear();
+        }
+    };
+    
+    ChunkGraphWorkspace& get_chunk_graph_workspace() {
+        thread_local ChunkGraphWorkspace workspace;
+        return workspace;
+    }
+    
+    }
+    
     Surjector::Surjector(const PathPositionHandleGraph* graph) : graph(graph) {
         if (!graph) {
             cerr << "error:[Surjector] Failed to provide an graph to the Surjector" << endl;
@@ -204,13 +280,22 @@ using namespace std;
         }
         
         // make an overlay that will memoize the results of some expensive XG operations
-        MemoizingGraph memoizing_graph(graph);
+        MemoizingGraph memoizing_graph(graph, path_offset_index);
+        
+        // most reads lie right along a reference path, and we can surject those without looking for anchors
+        pair<path_handle_t, bool> linear_path_strand;
+        pair<Alignment, pair<step_handle_t, step_handle_t>> linear_surjection;
+        bool surjected_linearly = (source_aln && !preserve_deletions &&
+                                   linear_surject(&memoizing_graph, *source_aln, paths, linear_path_strand, linear_surjection));
         
         // get the chunks of the aligned path that overlap the ref path
         unordered_map<pair<path_handle_t, bool>, vector<tuple<size_t, size_t, int32_t>>> connections;
-        auto path_overlapping_anchors = source_aln ? extract_overlapping_paths(&memoizing_graph, *source_aln, paths)
-                                                   : extract_overlapping_paths(&memoizing_graph, *source_mp_aln,
-                                                                               paths, connections);
+        unordered_map<pair<path_handle_t, bool>, pair<vector<path_chunk_t>, vector<pair<step_handle_t, step_handle_t>>>> path_overlapping_anchors;
+        if (!surjected_linearly) {
+            path_overlapping_anchors = source_aln ? extract_overlapping_paths(&memoizing_graph, *source_aln, paths)
+                                                  : extract_overlapping_paths(&memoizing_graph, *source_mp_aln,
+                                                                              paths, connections);
+        }
         
         if (source_mp_aln) {
             // the multipath alignment anchor algorithm can produce redundant paths if
@@ -400,6 +485,10 @@ using namespace std;
             }
         }
         
+        if (surjected_linearly) {
+            aln_surjections[linear_path_strand] = move(linear_surjection);
+        }
+        
         // in case we didn't overlap any paths, add a sentinel so the following code still executes correctly
         if (aln_surjections.empty() && mp_aln_surjections.empty()) {
             // this surjection didn't get aligned
@@ -535,44 +624,53 @@ using namespace std;
 
     vector<vector<size_t>> Surjector::reverse_adjacencies(const vector<vector<size_t>>& adj) const {
         // make a reverse adjacency list
+        auto& workspace = get_chunk_graph_workspace();
+        workspace.load_reverse(adj);
         vector<vector<size_t>> rev_adj(adj.size());
         for (size_t i = 0; i < adj.size(); ++i) {
-            for (size_t j : adj[i]) {
-                rev_adj[j].push_back(i);
-            }
+            rev_adj[i].assign(workspace.targets.begin() + workspace.offsets[i],
+                              workspace.targets.begin() + workspace.offsets[i + 1]);
         }
         return rev_adj;
     }
 
-    vector<size_t> Surjector::connected_components(const vector<vector<size_t>>& adj, const vector<vector<size_t>>& rev_adj,
-                                                   size_t* num_comps_out) const {
+    vector<size_t> Surjector::connected_components(const vector<vector<size_t>>& adj, size_t* num_comps_out) const {
+        
+        auto& workspace = get_chunk_graph_workspace();
+        workspace.load_reverse(adj);
+        workspace.reset_bits(adj.size());
+        vector<size_t>& stack = workspace.stack;
         
         // DFS to find connected components
-        vector<bool> enqueued(adj.size(), false);
         vector<size_t> comps(adj.size());
         size_t curr_comp = 0;
         for (size_t i = 0; i < adj.size(); ++i) {
-            if (!enqueued[i]) {
-                vector<size_t> stack(1, i);
-                enqueued[i] = true;
+            if (!workspace.test(i)) {
+                stack.push_back(i);
+                workspace.set(i);
                 while (!stack.empty()) {
                     size_t here = stack.back();
                     stack.pop_back();
                     comps[here] = curr_comp;
-                    for (const vector<vector<size_t>>* adj_list : {&adj, &rev_adj}) {
-                        for (size_t j : (*adj_list)[here]) {
-                            if (!enqueued[j]) {
-                                stack.push_back(j);
-                                enqueued[j] = true;
-                            }
+                    for (size_t j : adj[here]) {
+                        if (!workspace.test(j)) {
+                            stack.push_back(j);
+                            workspace.set(j);
+                        }
+                    }
+                    for (size_t k = workspace.offsets[here]; k < workspace.offsets[here + 1]; ++k) {
+                        size_t j = workspace.targets[k];
+                        if (!workspace.test(j)) {
+                            stack.push_back(j);
+                            workspace.set(j);
                         }
                     }
-                    
                 }
                 
                 curr_comp += 1;
             }
         }
+        workspace.clear_bits();
         
         if (num_comps_out) {
             *num_comps_out = curr_comp;
@@ -585,6 +683,10 @@ using namespace std;
         
         // by construction the graph here has edges in topological order
         
+        auto& workspace = get_chunk_graph_workspace();
+        workspace.reset_bits(adj.size());
+        vector<size_t>& stack = workspace.stack;
+        
         vector<vector<size_t>> reduction(adj.size());
         
         for (size_t i = 0; i < adj.size(); ++i) {
@@ -597,12 +699,11 @@ using namespace std;
                 continue;
             }
             
-            vector<bool> traversed(adj.size() - i, false);
-            
+            // the bitset marks what we've traversed to from this node
             for (size_t j = 0; j < edges.size(); j++) {
                 
                 size_t edge = edges[j];
-                if (traversed[edge - i]) {
+                if (workspace.test(edge)) {
                     // we can reach the target of this edge by another path, so it is transitive
                     continue;
                 }
@@ -611,21 +712,21 @@ using namespace std;
                 reduction[i].push_back(edge);
                 
                 // DFS to mark all reachable nodes from this edge
-                vector<size_t> stack(1, edge);
-                traversed[edge - i] = true;
+                stack.push_back(edge);
+                workspace.set(edge);
                 while (!stack.empty()) {
                     size_t idx = stack.back();
                     stack.pop_back();
                     for (size_t k : adj[idx]) {
-                        if (!traversed[k - i]) {
+                        if (!workspace.test(k)) {
                             stack.push_back(k);
-                            traversed[k - i] = true;
+                            workspace.set(k);
                         }
                     }
                 }
             }
             
-            
+            workspace.clear_bits();
         }
         
         return reduction;
@@ -637,47 +738,79 @@ using namespace std;
                                                               vector<pair<step_handle_t, step_handle_t>>& ref_chunks,
                                                               vector<tuple<size_t, size_t, int32_t>>& connections) const {
         
-        // this is an easy way to ensure that all adjacency lists are ordered by index
-        auto rev_adj = reverse_adjacencies(adj);
-        auto fwd_adj = reverse_adjacencies(rev_adj);
+        // get both adjacency lists ordered by index, with the reverse one in CSR form
+        auto& workspace = get_chunk_graph_workspace();
+        workspace.load_reverse(adj);
+        const vector<size_t>& rev_offsets = workspace.offsets;
+        const vector<size_t>& rev_targets = workspace.targets;
+        vector<vector<size_t>> fwd_adj = adj;
+        for (auto& adj_list : fwd_adj) {
+            sort(adj_list.begin(), adj_list.end());
+        }
         
-        map<pair<vector<size_t>, vector<size_t>>, vector<size_t>> neighbor_groups;
-        for (size_t i = 0; i < adj.size(); ++i) {
-            neighbor_groups[make_pair(rev_adj[i], fwd_adj[i])].push_back(i);
+        // group the chunks with the same neighbors by sorting them by their neighbors
+        auto rev_begin = [&](size_t i) { return rev_targets.begin() + rev_offsets[i]; };
+        auto rev_end = [&](size_t i) { return rev_targets.begin() + rev_offsets[i + 1]; };
+        auto neighbors_less = [&](size_t a, size_t b) {
+            if (lexicographical_compare(rev_begin(a), rev_end(a), rev_begin(b), rev_end(b))) {
+                return true;
+            }
+            if (lexicographical_compare(rev_begin(b), rev_end(b), rev_begin(a), rev_end(a))) {
+                return false;
+            }
+            return fwd_adj[a] < fwd_adj[b];
+        };
+        vector<size_t> order(adj.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        stable_sort(order.begin(), order.end(), neighbors_less);
+        
+        // the intervals of the order that share neighbors
+        vector<pair<size_t, size_t>> neighbor_groups;
+        for (size_t i = 0; i < order.size(); ++i) {
+            if (i == 0 || neighbors_less(order[i - 1], order[i])) {
+                neighbor_groups.emplace_back(i, i);
+            }
+            ++neighbor_groups.back().second;
         }
         
 #ifdef debug_spliced_surject
         cerr << "neighbor groups:" << endl;
         for (const auto& group : neighbor_groups) {
+            size_t rep = order[group.first];
             cerr << "(";
-            for (size_t i = 0; i < group.first.first.size(); ++i) {
-                if (i != 0){
+            for (auto it = rev_begin(rep); it != rev_end(rep); ++it) {
+                if (it != rev_begin(rep)){
                     cerr << ", ";
                 }
-                cerr << group.first.first[i];
+                cerr << *it;
             }
             cerr << ") (";
-            for (size_t i = 0; i < group.first.second.size(); ++i) {
+            for (size_t i = 0; i < fwd_adj[rep].size(); ++i) {
                 if (i != 0){
                     cerr << ", ";
                 }
-                cerr << group.first.second[i];
+                cerr << fwd_adj[rep][i];
             }
             cerr << ")" << endl;
-            for (auto i : group.second) {
-                cerr << "\t" << i << endl;
+            for (size_t i = group.first; i < group.second; ++i) {
+                cerr << "\t" << order[i] << endl;
             }
         }
 #endif
         
         vector<size_t> to_remove;
+        vector<int64_t> total_lengths;
         for (const auto& group : neighbor_groups) {
+            size_t group_size = group.second - group.first;
+            size_t rep = order[group.first];
             // only remove dominated chunks if they have the same, non-empty set of neighbors
-            if (group.second.size() > 1 && (!group.first.first.empty() || !group.first.second.empty())) {
-                vector<int64_t> total_lengths(group.second.size());
+            if (group_size > 1 && (rev_begin(rep) != rev_end(rep) || !fwd_adj[rep].empty())) {
+                total_lengths.resize(group_size);
                 int64_t max_total_length = 0;
-                for (size_t i = 0; i < group.second.size(); ++i) {
-                    auto& chunk = path_chunks[group.second[i]];
+                for (size_t i = 0; i < group_size; ++i) {
+                    auto& chunk = path_chunks[order[group.first + i]];
                     total_lengths[i] = path_from_length(chunk.second) + (chunk.first.second - chunk.first.first);
                     // don't count softclips
                     if (chunk.first.first == src_sequence.begin()) {
@@ -694,9 +827,9 @@ using namespace std;
                     }
                     max_total_length = max(total_lengths[i], max_total_length);
                 }
-                for (size_t i = 0; i < group.second.size(); ++i) {
+                for (size_t i = 0; i < group_size; ++i) {
                     if (total_lengths[i] < max_total_length - 2 * dominated_path_chunk_diff) {
-                        to_remove.push_back(group.second[i]);
+                        to_remove.push_back(order[group.first + i]);
                     }
                 }
             }
@@ -810,12 +943,14 @@ using namespace std;
         
         // mark path chunks for removal if a component has a connection but the
         // chunks don't occur on any interconnectino paths
-        vector<unordered_set<size_t>> to_remove_by_group(comp_groups.size());
+        vector<bool> marked_for_removal(adj.size(), false);
+        vector<size_t> num_marked_in_group(comp_groups.size(), 0);
         for (size_t i = 0; i < adj.size(); ++i) {
             size_t grp = component[i];
             if ((comp_has_connection_to[grp] && !connects_forward[i])
                 || (comp_has_connection_from[grp] && !connects_backward[i])) {
-                to_remove_by_group[grp].insert(i);
+                marked_for_removal[i] = true;
+                ++num_marked_in_group[grp];
 #ifdef debug_prune_unconnectable
                 cerr << "marking " << i << " for removal" << endl;
 #endif
@@ -829,8 +964,7 @@ using namespace std;
             // remove if not on an inter-connection path, but don't remove an entire group
             // TODO: but how can we be sure to produce sensible results when an entire group
             // should be removed?
-            if (to_remove_by_group[grp].count(i)
-                && to_remove_by_group[grp].size() < comp_groups[grp].size()) {
+            if (marked_for_removal[i] && num_marked_in_group[grp] < comp_groups[grp].size()) {
 #ifdef debug_prune_unconnectable
                 cerr << "removing " << i << endl;
 #endif
@@ -954,7 +1088,7 @@ using namespace std;
         auto rev_adj = reverse_adjacencies(adj);
         
         size_t num_comps = 0;
-        auto comps = connected_components(adj, rev_adj, &num_comps);
+        auto comps = connected_components(adj, &num_comps);
         
         vector<size_t> fwd(adj.size(), 0), bwd(adj.size(), 0);
         vector<size_t> total_comp_paths(num_comps, 0);
@@ -2477,9 +2611,7 @@ using namespace std;
       
         // find the connected components in the graph with the splice edges removed
         size_t num_comps = 0;
-        vector<size_t> constriction_comps = connected_components(colinear_adj_red,
-                                                                 reverse_adjacencies(colinear_adj_red),
-                                                                 &num_comps);
+        vector<size_t> constriction_comps = connected_components(colinear_adj_red, &num_comps);
         vector<vector<size_t>> comp_groups(num_comps);
         for (size_t i = 0; i < constriction_comps.size(); ++i) {
             comp_groups[constriction_comps[i]].push_back(i);
@@ -3682,6 +3814,93 @@ using namespace std;
         return to_return;
     }
 
+    bool Surjector::linear_surject(const PathPositionHandleGraph* graph, const Alignment& source,
+                                   const unordered_set<path_handle_t>& surjection_paths,
+                                   pair<path_handle_t, bool>& path_strand_out,
+                                   pair<Alignment, pair<step_handle_t, step_handle_t>>& surjection_out) const {
+        
+        const Path& path = source.path();
+        if (path.mapping_size() == 0) {
+            return false;
+        }
+        
+        step_handle_t first_step, prev_step;
+        bool rev_strand = false;
+        for (size_t i = 0; i < path.mapping_size(); ++i) {
+            const Mapping& mapping = path.mapping(i);
+            const Position& pos = mapping.position();
+            handle_t handle = graph->get_handle(pos.node_id(), pos.is_reverse());
+            
+            if ((i != 0 && pos.offset() != 0) ||
+                (i + 1 != path.mapping_size() && pos.offset() + mapping_from_length(mapping) != graph->get_length(handle))) {
+                // the mappings don't run from one node boundary to the next
+                return false;
+            }
+            
+            // find the one visit to this node by a reference path
+            step_handle_t step;
+            bool found = false;
+            for (const step_handle_t& step_here : graph->steps_of_handle(handle)) {
+                if (surjection_paths.count(graph->get_path_handle_of_step(step_here))) {
+                    if (found) {
+                        // there's more than one way we could surject this read
+                        return false;
+                    }
+                    step = step_here;
+                    found = true;
+                }
+            }
+            if (!found) {
+                return false;
+            }
+            
+            bool strand_here = graph->get_is_reverse(handle) != graph->get_is_reverse(graph->get_handle_of_step(step));
+            if (i == 0) {
+                rev_strand = strand_here;
+                first_step = step;
+            }
+            else if (strand_here != rev_strand ||
+                     (rev_strand ? graph->get_previous_step(prev_step) : graph->get_next_step(prev_step)) != step) {
+                // the alignment leaves the path
+                return false;
+            }
+            prev_step = step;
+        }
+        
+#ifdef debug_anchored_surject
+        cerr << "alignment lies along path " << graph->get_path_name(graph->get_path_handle_of_step(first_step)) << " strand " << rev_strand << ", surjecting linearly" << endl;
+#endif
+        
+        path_strand_out = make_pair(graph->get_path_handle_of_step(first_step), rev_strand);
+        surjection_out.second = make_pair(first_step, prev_step);
+        
+        // the path is the same as the one we started with, and we transfer the same metadata as
+        // the realigning algorithm does
+        Alignment& surjected = surjection_out.first;
+        surjected.set_sequence(source.sequence());
+        surjected.set_quality(source.quality());
+        *surjected.mutable_path() = path;
+        for (size_t i = 0; i < surjected.path().mapping_size(); ++i) {
+            surjected.mutable_path()->mutable_mapping(i)->set_rank(i + 1);
+        }
+        surjected.set_score(get_aligner(!source.quality().empty())->score_contiguous_alignment(surjected));
+        surjected.set_name(source.name());
+        surjected.set_read_group(source.read_group());
+        surjected.set_sample_name(source.sample_name());
+        surjected.set_mapping_quality(source.mapping_quality());
+        if (source.has_fragment_next()) {
+            *surjected.mutable_fragment_next() = source.fragment_next();
+        }
+        if (source.has_fragment_prev()) {
+            *surjected.mutable_fragment_prev() = source.fragment_prev();
+        }
+        if (source.has_annotation()) {
+            *surjected.mutable_annotation() = source.annotation();
+        }
+        
+        return true;
+    }
+
     void Surjector::filter_redundant_path_chunks(bool path_rev, vector<path_chunk_t>& path_chunks,
                                                  vector<pair<step_handle_t, step_handle_t>>& ref_chunks,
                                                  vector<tuple<size_t, size_t, int32_t>>& connections) const {
@@ -16,6 +16,7 @@
 #include "handle.hpp"
 #include <vg/vg.pb.h>
 #include "multipath_alignment.hpp"
+#include "path_offset_index.hpp"
 
 
 namespace vg {
@@ -132,6 +133,10 @@ using namespace std;
         
         bool annotate_with_all_path_scores = false;
         
+        /// If set, a shared index of the positions of steps on the paths we surject
+        /// onto, to use instead of the graph's own path position lookups. Not owned.
+        const PathOffsetIndex* path_offset_index = nullptr;
+        
     protected:
         
         void surject_internal(const Alignment* source_aln, const multipath_alignment_t* source_mp_aln,
@@ -167,6 +172,14 @@ using namespace std;
         // Support methods for the realigning surject algorithm
         ///////////////////////
         
+        /// if the alignment lies along consecutive steps of one strand of one of the reference
+        /// paths, and the reference paths visit each of its nodes only that once, surject it
+        /// without realignment and return true, otherwise return false
+        bool linear_surject(const PathPositionHandleGraph* graph, const Alignment& source,
+                            const unordered_set<path_handle_t>& surjection_paths,
+                            pair<path_handle_t, bool>& path_strand_out,
+                            pair<Alignment, pair<step_handle_t, step_handle_t>>& surjection_out) const;
+        
         /// get the chunks of the alignment path that follow the given reference paths
         unordered_map<pair<path_handle_t, bool>, pair<vector<path_chunk_t>, vector<pair<step_handle_t, step_handle_t>>>>
         extract_overlapping_paths(const PathPositionHandleGraph* graph, const Alignment& source,
@@ -215,10 +228,9 @@ using namespace std;
         /// reverses an adjacency list
         vector<vector<size_t>> reverse_adjacencies(const vector<vector<size_t>>& adj) const;
         
-        /// returns a vector assignming each node to a connectd component, requires both the forward and reverse adjacency
-        /// lists. optionally also returns the total number of components
+        /// returns a vector assignming each node to a connectd component. optionally also returns the total
+        /// number of components
         vector<size_t> connected_components(const vector<vector<size_t>>& adj,
-                                            const vector<vector<size_t>>& rev_adj,
                                             size_t* num_comps_out) const;
         
         /// returns the transitive reduction of a topologically sorted DAG's adjacency list
@@ -0,0 +1,108 @@
+#include "telemetry.hpp"
+
+#include <iostream>
+#include <sstream>
+
+#include "memusage.hpp"
+
+namespace vg {
+
+using namespace std;
+
+Telemetry::Telemetry(size_t thread_count, const clock::duration& interval,
+                     const string& json_filename, const FunnelStats* stage_stats) :
+    counts(std::max<size_t>(thread_count, 1)),
+    interval(interval),
+    stage_stats(stage_stats),
+    start_time(clock::now()),
+    last_time(start_time) {
+    
+    if (!json_filename.empty()) {
+        json_out.open(json_filename, ios_base::app);
+        if (!json_out) {
+            cerr << "error:[vg::Telemetry] Could not open " << json_filename << " to write telemetry" << endl;
+            exit(1);
+        }
+    }
+    reporter = thread(&Telemetry::reporter_loop, this);
+}
+
+Telemetry::~Telemetry() {
+    {
+        lock_guard<mutex> lock(stop_mutex);
+        stopping = true;
+    }
+    stop_signal.notify_all();
+    reporter.join();
+    report(true);
+}
+
+void Telemetry::reporter_loop() {
+    unique_lock<mutex> lock(stop_mutex);
+    while (!stop_signal.wait_for(lock, interval, [&]() { return stopping; })) {
+        report(false);
+    }
+}
+
+void Telemetry::report(bool final) {
+    clock::time_point now = clock::now();
+    size_t reads = 0;
+    size_t bases = 0;
+    for (auto& thread_counts : counts) {
+        reads += thread_counts.reads.load(memory_order_relaxed);
+        bases += thread_counts.bases.load(memory_order_relaxed);
+    }
+    double elapsed = chrono::duration<double>(now - start_time).count();
+    double window = chrono::duration<double>(now - last_time).count();
+    double reads_per_second = window > 0 ? (reads - last_reads) / window : 0.0;
+    double bases_per_second = window > 0 ? (bases - last_bases) / window : 0.0;
+    last_time = now;
+    last_reads = reads;
+    last_bases = bases;
+    
+    size_t rss_kb = get_current_rss_kb();
+    vector<pair<string, double>> stage_seconds;
+    double total_stage_seconds = 0;
+    if (stage_stats) {
+        stage_seconds = stage_stats->stage_seconds();
+        for (auto& stage : stage_seconds) {
+            total_stage_seconds += stage.second;
+        }
+    }
+    
+    // Assemble the report so that it goes out in one write.
+    stringstream line;
+    if (json_out.is_open()) {
+        line << "{\"seconds\": " << elapsed << ", \"final\": " << (final ? "true" : "false")
+             << ", \"reads\": " << reads << ", \"bases\": " << bases
+             << ", \"reads_per_second\": " << reads_per_second << ", \"bases_per_second\": " << bases_per_second
+             << ", \"rss_kb\": " << rss_kb;
+        if (stage_stats) {
+            line << ", \"stage_share\": {";
+            for (size_t i = 0; i < stage_seconds.size(); i++) {
+                line << (i == 0 ? "" : ", ") << "\"" << stage_seconds[i].first << "\": "
+                     << (total_stage_seconds > 0 ? stage_seconds[i].second / total_stage_seconds : 0.0);
+            }
+            line << "}";
+        }
+        line << "}" << endl;
+        json_out << line.str() << flush;
+    } else {
+        line << "[telemetry] " << elapsed << " s: " << reads << " reads, "
+             << reads_per_second << " reads/s, " << bases_per_second / 1E6 << " Mbp/s, "
+             << rss_kb / 1024 << " MB resident";
+        if (!stage_seconds.empty() && total_stage_seconds > 0) {
+            line << "; stages:";
+            for (auto& stage : stage_seconds) {
+                line << " " << stage.first << " " << (int) (100 * stage.second / total_stage_seconds) << "%";
+            }
+        }
+        if (final) {
+            line << " (final)";
+        }
+        line << endl;
+        cerr << line.str();
+    }
+}
+
+}
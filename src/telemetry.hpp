@@ -0,0 +1,99 @@
+#ifndef VG_TELEMETRY_HPP_INCLUDED
+#define VG_TELEMETRY_HPP_INCLUDED
+
+/**
+ * \file telemetry.hpp
+ * Defines a reporter that periodically logs how fast a long-running mapper is going.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "funnel.hpp"
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Periodically logs the throughput of a mapping run, along with the memory
+ * use and, if available, the share of mapping time spent in each stage. Each
+ * instance owns its own reporting thread.
+ *
+ * Mapping threads count their reads into their own cache-line-sized slot with
+ * relaxed atomics, so counting costs about as much as an uncontended
+ * increment.
+ *
+ * Reports go to standard error as text, or to a file as one JSON object per
+ * line.
+ */
+class Telemetry {
+public:
+    
+    using clock = chrono::steady_clock;
+    
+    /**
+     * Start reporting every interval on reads counted from the given number
+     * of threads. If json_filename is not empty, reports are appended to that
+     * file as JSON lines instead of going to standard error. If stage_stats
+     * is set, stage time shares are read from it.
+     */
+    Telemetry(size_t thread_count, const clock::duration& interval,
+              const string& json_filename = "", const FunnelStats* stage_stats = nullptr);
+    
+    /**
+     * Make a last report and stop the reporting thread.
+     */
+    ~Telemetry();
+    
+    /**
+     * Count a read with the given number of bases as mapped by the given thread.
+     */
+    inline void count_read(size_t thread, size_t bases);
+    
+private:
+    
+    /// Counts for one thread, kept on their own cache line.
+    struct alignas(64) ThreadCounts {
+        atomic<size_t> reads {0};
+        atomic<size_t> bases {0};
+    };
+    
+    /// Run on the reporting thread.
+    void reporter_loop();
+    
+    /// Write one report.
+    void report(bool final);
+    
+    vector<ThreadCounts> counts;
+    clock::duration interval;
+    const FunnelStats* stage_stats;
+    ofstream json_out;
+    
+    clock::time_point start_time;
+    clock::time_point last_time;
+    size_t last_reads = 0;
+    size_t last_bases = 0;
+    
+    mutex stop_mutex;
+    condition_variable stop_signal;
+    bool stopping = false;
+    thread reporter;
+};
+
+inline void Telemetry::count_read(size_t thread, size_t bases) {
+    ThreadCounts& mine = counts[thread];
+    // Only this thread writes here, so there is no need for a locked add.
+    mine.reads.store(mine.reads.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    mine.bases.store(mine.bases.load(memory_order_relaxed) + bases, memory_order_relaxed);
+}
+
+}
+
+#endif
@@ -1,5 +1,6 @@
 
 #include <thread>
+#include <atomic>
 
 #include <gbwtgraph/utils.h>
 
@@ -85,9 +86,34 @@ bool operator<(const Transcript & lhs, const Transcript & rhs) {
     return false;
 }
 
+bool operator==(const Edit & lhs, const Edit & rhs) { 
+
+    return (lhs.from_length() == rhs.from_length() && lhs.to_length() == rhs.to_length() && lhs.sequence() == rhs.sequence());
+}
+
 bool operator==(const Mapping & lhs, const Mapping & rhs) { 
 
-    return google::protobuf::util::MessageDifferencer::Equals(lhs, rhs);
+    // Compare the fields directly, since reflection-based comparison of 
+    // messages is slow enough to dominate the collapse of identical paths.
+    if (lhs.rank() != rhs.rank() || lhs.edit_size() != rhs.edit_size()) {
+
+        return false;
+    }
+
+    if (lhs.position().node_id() != rhs.position().node_id() || lhs.position().offset() != rhs.position().offset() || lhs.position().is_reverse() != rhs.position().is_reverse() || lhs.position().name() != rhs.position().name()) {
+
+        return false;
+    }
+
+    for (size_t i = 0; i < lhs.edit_size(); ++i) {
+
+        if (!(lhs.edit(i) == rhs.edit(i))) {
+
+            return false;
+        }
+    }
+
+    return true;
 }
 
 bool operator!=(const Mapping & lhs, const Mapping & rhs) { 
@@ -97,7 +123,20 @@ bool operator!=(const Mapping & lhs, const Mapping & rhs) {
 
 bool operator==(const Path & lhs, const Path & rhs) { 
 
-    return google::protobuf::util::MessageDifferencer::Equals(lhs, rhs);
+    if (lhs.name() != rhs.name() || lhs.is_circular() != rhs.is_circular() || lhs.length() != rhs.length() || lhs.mapping_size() != rhs.mapping_size()) {
+
+        return false;
+    }
+
+    for (size_t i = 0; i < lhs.mapping_size(); ++i) {
+
+        if (lhs.mapping(i) != rhs.mapping(i)) {
+
+            return false;
+        }
+    }
+
+    return true;
 }
 
 bool operator!=(const Path & lhs, const Path & rhs) { 
@@ -169,11 +208,18 @@ string TranscriptPath::get_name() const {
     }
 }
 
-handle_t EditedTranscriptPath::get_first_node_handle(const HandleGraph & graph) const {
+size_t EditedTranscriptPath::get_path_hash() const {
 
     assert(path.mapping_size() > 0);
 
-    return graph.get_handle(path.mapping()[0].position().node_id(), path.mapping()[0].position().is_reverse());
+    size_t seed = 0;
+
+    for (auto & mapping: path.mapping()) {
+
+        spp::hash_combine(seed, MappingHash()(mapping));
+    }
+
+    return seed;
 }
 
 CompletedTranscriptPath::CompletedTranscriptPath(const EditedTranscriptPath & edited_transcript_path_in) {
@@ -215,9 +261,18 @@ CompletedTranscriptPath::CompletedTranscriptPath(const EditedTranscriptPath & ed
     }
 }
 
-handle_t CompletedTranscriptPath::get_first_node_handle(const HandleGraph & graph) const {
+size_t CompletedTranscriptPath::get_path_hash() const {
 
-    return path.front();
+    assert(!path.empty());
+
+    size_t seed = 0;
+
+    for (auto & handle: path) {
+
+        spp::hash_combine(seed, handlegraph::as_integer(handle));
+    }
+
+    return seed;
 }
 
 Transcriptome::Transcriptome(unique_ptr<MutablePathDeletableHandleGraph>&& graph_in) : _graph(move(graph_in)) {
@@ -399,7 +454,7 @@ int32_t Transcriptome::add_reference_transcripts(vector<istream *> transcript_st
     return transcripts.size();
 }
 
-int32_t Transcriptome::add_haplotype_transcripts(vector<istream *> transcript_streams, const gbwt::GBWT & haplotype_index, const bool proj_emded_paths) {
+int32_t Transcriptome::add_haplotype_transcripts(vector<istream *> transcript_streams, const gbwt::GBWT & haplotype_index, const bool proj_emded_paths, TranscriptPathOutput * path_output) {
     
 #ifdef transcriptome_debug
     double time_parsing_1 = gcsa::readTimer();
@@ -444,6 +499,24 @@ int32_t Transcriptome::add_haplotype_transcripts(vector<istream *> transcript_st
     cerr << "\tDEBUG Projection start: " << gcsa::inGigabytes(gcsa::memoryUsage()) << " GB" << endl;
 #endif 
 
+    if (path_output) {
+
+        // Project, collapse and write transcript paths one gene at a time.
+        auto num_written_transcript_paths = stream_haplotype_transcripts(transcripts, haplotype_index, graph_path_pos_overlay, proj_emded_paths, mean_node_length(), path_output);
+
+        // Sort the reference transcript paths, which might 
+        // have been collapsed with haplotype transcript paths.
+        sort_transcript_paths_update_copy_id();
+
+        if (show_progress) { cerr << "\tProjected and wrote " << num_written_transcript_paths << " haplotype-specific transcript paths" << endl; }
+
+#ifdef transcriptome_debug
+        cerr << "\tDEBUG: " << gcsa::readTimer() - time_project_1 << " seconds, " << gcsa::inGigabytes(gcsa::memoryUsage()) << " GB" << endl;
+#endif 
+
+        return num_written_transcript_paths;
+    }
+
     // Save number of transcript paths before adding new.
     auto pre_num_transcript_paths = _transcript_paths.size();
 
@@ -929,17 +1002,20 @@ bool Transcriptome::has_overlapping_exons(const vector<Exon> & exons) const {
 list<EditedTranscriptPath> Transcriptome::construct_reference_transcript_paths_embedded(const vector<Transcript> & transcripts, const bdsg::PositionOverlay & graph_path_pos_overlay) const {
 
     list<EditedTranscriptPath> edited_transcript_paths;
-    spp::sparse_hash_map<handle_t, vector<EditedTranscriptPath *> > edited_transcript_paths_index;
+    spp::sparse_hash_map<size_t, vector<EditedTranscriptPath *> > edited_transcript_paths_index;
 
     mutex edited_transcript_paths_mutex;
 
+    // Transcripts are handed out to threads as they become free.
+    atomic<uint32_t> next_transcripts_idx(0);
+
     vector<thread> construction_threads;
     construction_threads.reserve(num_threads);
 
     // Spawn construction threads.
     for (size_t thread_idx = 0; thread_idx < num_threads; thread_idx++) {
 
-        construction_threads.push_back(thread(&Transcriptome::construct_reference_transcript_paths_embedded_callback, this, &edited_transcript_paths, &edited_transcript_paths_index, &edited_transcript_paths_mutex, thread_idx, ref(transcripts), ref(graph_path_pos_overlay)));
+        construction_threads.push_back(thread(&Transcriptome::construct_reference_transcript_paths_embedded_callback, this, &edited_transcript_paths, &edited_transcript_paths_index, &edited_transcript_paths_mutex, &next_transcripts_idx, ref(transcripts), ref(graph_path_pos_overlay)));
     }
 
     // Join construction threads.   
@@ -951,11 +1027,11 @@ list<EditedTranscriptPath> Transcriptome::construct_reference_transcript_paths_e
     return edited_transcript_paths;
 }
 
-void Transcriptome::construct_reference_transcript_paths_embedded_callback(list<EditedTranscriptPath> * edited_transcript_paths, spp::sparse_hash_map<handle_t, vector<EditedTranscriptPath *> > * edited_transcript_paths_index, mutex * edited_transcript_paths_mutex, const int32_t thread_idx, const vector<Transcript> & transcripts, const bdsg::PositionOverlay & graph_path_pos_overlay) const {
+void Transcriptome::construct_reference_transcript_paths_embedded_callback(list<EditedTranscriptPath> * edited_transcript_paths, spp::sparse_hash_map<size_t, vector<EditedTranscriptPath *> > * edited_transcript_paths_index, mutex * edited_transcript_paths_mutex, atomic<uint32_t> * next_transcripts_idx, const vector<Transcript> & transcripts, const bdsg::PositionOverlay & graph_path_pos_overlay) const {
 
     list<EditedTranscriptPath> thread_edited_transcript_paths;
 
-    int32_t transcripts_idx = thread_idx;
+    uint32_t transcripts_idx = (*next_transcripts_idx)++;
 
     while (transcripts_idx < transcripts.size()) {
 
@@ -971,7 +1047,7 @@ void Transcriptome::construct_reference_transcript_paths_embedded_callback(list<
             thread_edited_transcript_paths.emplace_back(new_edited_transcript_paths.front());
         }
 
-        transcripts_idx += num_threads;
+        transcripts_idx = (*next_transcripts_idx)++;
     }
 
     edited_transcript_paths_mutex->lock();
@@ -1333,18 +1409,21 @@ list<EditedTranscriptPath> Transcriptome::construct_reference_transcript_paths_g
     }
 
     list<EditedTranscriptPath> edited_transcript_paths;
-    spp::sparse_hash_map<handle_t, vector<EditedTranscriptPath *> > edited_transcript_paths_index;
+    spp::sparse_hash_map<size_t, vector<EditedTranscriptPath *> > edited_transcript_paths_index;
 
     uint32_t excluded_transcripts = 0;
     mutex edited_transcript_paths_mutex;
 
+    // Transcript sets are handed out to threads as they become free, largest first.
+    atomic<uint32_t> next_chrom_transcript_sets_idx(0);
+
     vector<thread> construction_threads;
     construction_threads.reserve(num_threads);
 
     // Spawn construction threads.
     for (size_t thread_idx = 0; thread_idx < num_threads; thread_idx++) {
 
-        construction_threads.push_back(thread(&Transcriptome::construct_reference_transcript_paths_gbwt_callback, this, &edited_transcript_paths, &edited_transcript_paths_index, &excluded_transcripts, &edited_transcript_paths_mutex, thread_idx, ref(chrom_transcript_sets), ref(transcripts), ref(haplotype_index), ref(haplotype_name_index)));
+        construction_threads.push_back(thread(&Transcriptome::construct_reference_transcript_paths_gbwt_callback, this, &edited_transcript_paths, &edited_transcript_paths_index, &excluded_transcripts, &edited_transcript_paths_mutex, &next_chrom_transcript_sets_idx, ref(chrom_transcript_sets), ref(transcripts), ref(haplotype_index), ref(haplotype_name_index)));
     }
 
     // Join construction threads.   
@@ -1362,9 +1441,9 @@ list<EditedTranscriptPath> Transcriptome::construct_reference_transcript_paths_g
     return edited_transcript_paths;
 }
 
-void Transcriptome::construct_reference_transcript_paths_gbwt_callback(list<EditedTranscriptPath> * edited_transcript_paths, spp::sparse_hash_map<handle_t, vector<EditedTranscriptPath *> > * edited_transcript_paths_index, uint32_t * excluded_transcripts, mutex * edited_transcript_paths_mutex, const int32_t thread_idx, const vector<pair<uint32_t, uint32_t> > & chrom_transcript_sets, const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const spp::sparse_hash_map<string, map<uint32_t, uint32_t> > & haplotype_name_index) const {
+void Transcriptome::construct_reference_transcript_paths_gbwt_callback(list<EditedTranscriptPath> * edited_transcript_paths, spp::sparse_hash_map<size_t, vector<EditedTranscriptPath *> > * edited_transcript_paths_index, uint32_t * excluded_transcripts, mutex * edited_transcript_paths_mutex, atomic<uint32_t> * next_chrom_transcript_sets_idx, const vector<pair<uint32_t, uint32_t> > & chrom_transcript_sets, const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const spp::sparse_hash_map<string, map<uint32_t, uint32_t> > & haplotype_name_index) const {
 
-    int32_t chrom_transcript_sets_idx = thread_idx;
+    uint32_t chrom_transcript_sets_idx = (*next_chrom_transcript_sets_idx)++;
 
     while (chrom_transcript_sets_idx < chrom_transcript_sets.size()) {
 
@@ -1545,30 +1624,33 @@ void Transcriptome::construct_reference_transcript_paths_gbwt_callback(list<Edit
 
         edited_transcript_paths_mutex->unlock();
 
-        chrom_transcript_sets_idx += num_threads;
+        chrom_transcript_sets_idx = (*next_chrom_transcript_sets_idx)++;
     }
 }
 
 void Transcriptome::project_haplotype_transcripts(const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool proj_emded_paths, const float mean_node_length) {
     
     list<CompletedTranscriptPath> completed_transcript_paths;
-    spp::sparse_hash_map<handle_t, vector<CompletedTranscriptPath *> > completed_transcript_paths_index;
+    spp::sparse_hash_map<size_t, vector<CompletedTranscriptPath *> > completed_transcript_paths_index;
 
     for (auto & transcript_path: _transcript_paths) {
 
-        auto completed_transcript_paths_index_it = completed_transcript_paths_index.emplace(transcript_path.get_first_node_handle(*_graph), vector<CompletedTranscriptPath *>());
+        auto completed_transcript_paths_index_it = completed_transcript_paths_index.emplace(transcript_path.get_path_hash(), vector<CompletedTranscriptPath *>());
         completed_transcript_paths_index_it.first->second.emplace_back(&transcript_path);
     }
 
     mutex completed_transcript_paths_mutex;
 
+    // Transcripts are handed out to threads as they become free.
+    atomic<uint32_t> next_transcripts_idx(0);
+
     vector<thread> projection_threads;
     projection_threads.reserve(num_threads);
 
     // Spawn projection threads.
     for (size_t thread_idx = 0; thread_idx < num_threads; thread_idx++) {
 
-        projection_threads.push_back(thread(&Transcriptome::project_haplotype_transcripts_callback, this, &completed_transcript_paths, &completed_transcript_paths_index, &completed_transcript_paths_mutex, thread_idx, ref(transcripts), ref(haplotype_index), ref(graph_path_pos_overlay), proj_emded_paths, mean_node_length));
+        projection_threads.push_back(thread(&Transcriptome::project_haplotype_transcripts_callback, this, &completed_transcript_paths, &completed_transcript_paths_index, &completed_transcript_paths_mutex, &next_transcripts_idx, ref(transcripts), ref(haplotype_index), ref(graph_path_pos_overlay), proj_emded_paths, mean_node_length));
     }
 
     // Join projection threads.   
@@ -1585,11 +1667,11 @@ void Transcriptome::project_haplotype_transcripts(const vector<Transcript> & tra
     }
 }
 
-void Transcriptome::project_haplotype_transcripts_callback(list<CompletedTranscriptPath> * completed_transcript_paths, spp::sparse_hash_map<handle_t, vector<CompletedTranscriptPath *> > * completed_transcript_paths_index,  mutex * completed_transcript_paths_mutex, const int32_t thread_idx, const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool proj_emded_paths, const float mean_node_length) {
+void Transcriptome::project_haplotype_transcripts_callback(list<CompletedTranscriptPath> * completed_transcript_paths, spp::sparse_hash_map<size_t, vector<CompletedTranscriptPath *> > * completed_transcript_paths_index,  mutex * completed_transcript_paths_mutex, atomic<uint32_t> * next_transcripts_idx, const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool proj_emded_paths, const float mean_node_length) {
     
     list<CompletedTranscriptPath> thread_completed_transcript_paths;
 
-    int32_t transcripts_idx = thread_idx;
+    uint32_t transcripts_idx = (*next_transcripts_idx)++;
     
     // TODO: Could share this among all threads
     auto reference_samples = gbwtgraph::parse_reference_samples_tag(haplotype_index);
@@ -1613,7 +1695,7 @@ void Transcriptome::project_haplotype_transcripts_callback(list<CompletedTranscr
             thread_completed_transcript_paths.splice(thread_completed_transcript_paths.end(), construct_completed_transcript_paths(project_transcript_embedded(transcript, graph_path_pos_overlay, false, true)));
         }
 
-        transcripts_idx += num_threads;
+        transcripts_idx = (*next_transcripts_idx)++;
     }
 
     // Add haplotype transcript paths to transcriptome.
@@ -1623,6 +1705,247 @@ void Transcriptome::project_haplotype_transcripts_callback(list<CompletedTranscr
     completed_transcript_paths_mutex->unlock();
 }
 
+int32_t Transcriptome::stream_haplotype_transcripts(const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool proj_emded_paths, const float mean_node_length, TranscriptPathOutput * path_output) {
+
+    auto gene_transcript_sets = group_transcripts_by_gene(transcripts);
+
+    // Index reference transcript paths by transcript name. Haplotype transcript 
+    // paths are only collapsed with the reference paths of the same gene. 
+    spp::sparse_hash_map<string, vector<CompletedTranscriptPath *> > reference_transcript_paths_index;
+
+    for (auto & transcript_path: _transcript_paths) {
+
+        for (auto & transcript_name: transcript_path.transcript_names) {
+
+            reference_transcript_paths_index[transcript_name].emplace_back(&transcript_path);
+        }
+    }
+
+    auto reference_samples = gbwtgraph::parse_reference_samples_tag(haplotype_index);
+    
+    if (path_output->gbwt_builder && !path_output->gbwt_builder->index.hasMetadata()) {
+
+        path_output->gbwt_builder->index.addMetadata();
+    }
+
+    // Get current number of haplotypes in GBWT index.
+    auto pre_num_haplotypes = (path_output->gbwt_builder ? path_output->gbwt_builder->index.metadata.haplotypes() : 0);
+
+    if (path_output->tsv_ostream) {
+
+        write_transcript_info_header(path_output->tsv_ostream);
+    }
+
+    // Everything below is only changed while holding the output mutex.
+    mutex output_mutex;
+    
+    vector<string> sample_names;
+    spp::sparse_hash_map<string, uint32_t> haplotype_copy_ids;
+
+    // New splice-junction edges are added after projection, since 
+    // the graph is read by the other threads while writing.
+    vector<pair<handle_t, handle_t> > splice_junction_edges;
+
+    int32_t num_written_transcript_paths = 0;
+
+    // Genes are handed out to threads as they become free.
+    atomic<uint32_t> next_gene_idx(0);
+
+    auto stream_genes = [&]() {
+
+        uint32_t gene_idx = next_gene_idx++;
+
+        while (gene_idx < gene_transcript_sets.size()) {
+
+            auto & gene_transcripts = gene_transcript_sets.at(gene_idx);
+
+            auto gene_transcript_paths = project_gene_haplotype_transcripts(gene_transcripts, transcripts, haplotype_index, reference_samples, graph_path_pos_overlay, proj_emded_paths, mean_node_length);
+
+            // Index the reference transcript paths of the gene.
+            spp::sparse_hash_map<size_t, vector<CompletedTranscriptPath *> > gene_transcript_paths_index;
+
+            for (auto transcript_idx: gene_transcripts) {
+
+                auto reference_transcript_paths_index_it = reference_transcript_paths_index.find(transcripts.at(transcript_idx).name);
+
+                if (reference_transcript_paths_index_it != reference_transcript_paths_index.end()) {
+
+                    for (auto transcript_path: reference_transcript_paths_index_it->second) {
+
+                        auto & indexed_transcript_paths = gene_transcript_paths_index[transcript_path->get_path_hash()];
+
+                        if (find(indexed_transcript_paths.begin(), indexed_transcript_paths.end(), transcript_path) == indexed_transcript_paths.end()) {
+
+                            indexed_transcript_paths.emplace_back(transcript_path);
+                        }
+                    }
+                }
+            }
+
+            lock_guard<mutex> output_lock(output_mutex);
+
+            // Collapse with reference transcript paths. This can update 
+            // the reference paths, which might be shared between genes.
+            remove_redundant_transcript_paths<CompletedTranscriptPath>(&gene_transcript_paths, &gene_transcript_paths_index);
+
+            gene_transcript_paths.sort(sort_transcript_paths_by_name);
+
+            for (auto & transcript_path: gene_transcript_paths) {
+
+                assert(!transcript_path.is_reference && transcript_path.is_haplotype);
+
+                sort(transcript_path.transcript_names.begin(), transcript_path.transcript_names.end());
+                sort(transcript_path.embedded_path_names.begin(), transcript_path.embedded_path_names.end());
+                sort(transcript_path.haplotype_gbwt_ids.begin(), transcript_path.haplotype_gbwt_ids.end());
+
+                transcript_path.copy_id = ++haplotype_copy_ids[transcript_path.transcript_names.front()];
+
+                for (size_t i = 1; i < transcript_path.path.size(); i++) {
+
+                    if (!_graph->has_edge(transcript_path.path.at(i - 1), transcript_path.path.at(i))) {
+
+                        splice_junction_edges.emplace_back(transcript_path.path.at(i - 1), transcript_path.path.at(i));
+                    }
+                }
+
+                if (path_output->gbwt_builder) {
+
+                    add_transcript_path_to_gbwt(path_output->gbwt_builder, transcript_path, path_output->add_bidirectional, pre_num_haplotypes + sample_names.size());
+                    sample_names.emplace_back(transcript_path.get_name());
+                }
+
+                if (path_output->fasta_ostream) {
+
+                    write_transcript_path_sequence(path_output->fasta_ostream, transcript_path);
+                }
+
+                if (path_output->tsv_ostream) {
+
+                    write_transcript_path_info(path_output->tsv_ostream, transcript_path, haplotype_index, reference_samples, false);
+                }
+
+                ++num_written_transcript_paths;
+            }
+
+            gene_idx = next_gene_idx++;
+        }
+    };
+
+    vector<thread> projection_threads;
+    projection_threads.reserve(num_threads);
+
+    // Spawn projection threads.
+    for (size_t thread_idx = 0; thread_idx < num_threads; thread_idx++) {
+
+        projection_threads.push_back(thread(stream_genes));
+    }
+
+    // Join projection threads.   
+    for (auto & thread: projection_threads) {
+        
+        thread.join();
+    }
+
+    // Augment splice graph with new splice-junction edges.    
+    for (auto & edge: splice_junction_edges) {
+
+        _graph->create_edge(edge.first, edge.second);
+    }
+
+    if (path_output->gbwt_builder) {
+
+        // Set number number of haplotypes and transcript path name in metadata.
+        path_output->gbwt_builder->index.metadata.setHaplotypes(pre_num_haplotypes + sample_names.size());
+        path_output->gbwt_builder->index.metadata.addSamples(sample_names);
+    }
+
+    return num_written_transcript_paths;
+}
+
+vector<vector<uint32_t> > Transcriptome::group_transcripts_by_gene(const vector<Transcript> & transcripts) const {
+
+    // Find the chromosome/contig span of each transcript. The exons 
+    // of reverse transcripts are in reverse order.
+    vector<pair<pair<string, int32_t>, pair<int32_t, uint32_t> > > transcript_spans;
+    transcript_spans.reserve(transcripts.size());
+
+    for (size_t i = 0; i < transcripts.size(); ++i) {
+
+        auto & transcript = transcripts.at(i);
+
+        int32_t span_start = numeric_limits<int32_t>::max();
+        int32_t span_end = numeric_limits<int32_t>::min();
+
+        for (auto & exon: transcript.exons) {
+
+            span_start = min(span_start, exon.coordinates.first);
+            span_end = max(span_end, exon.coordinates.second);
+        }
+
+        transcript_spans.emplace_back(make_pair(transcript.chrom, span_start), make_pair(span_end, i));
+    }
+
+    sort(transcript_spans.begin(), transcript_spans.end());
+
+    vector<vector<uint32_t> > gene_transcript_sets;
+
+    const string * cur_chrom = nullptr;
+    int32_t cur_end = 0;
+
+    for (auto & transcript_span: transcript_spans) {
+
+        if (!cur_chrom || *cur_chrom != transcript_span.first.first || transcript_span.first.second > cur_end) {
+
+            cur_chrom = &(transcript_span.first.first);
+            cur_end = transcript_span.second.first;
+
+            gene_transcript_sets.emplace_back();
+        
+        } else {
+
+            cur_end = max(cur_end, transcript_span.second.first);
+        }
+
+        gene_transcript_sets.back().emplace_back(transcript_span.second.second);
+    }
+
+    // Hand out the largest genes first.
+    stable_sort(gene_transcript_sets.begin(), gene_transcript_sets.end(), [](const vector<uint32_t> & lhs, const vector<uint32_t> & rhs) {
+
+        return (lhs.size() > rhs.size());
+    });
+
+    return gene_transcript_sets;
+}
+
+list<CompletedTranscriptPath> Transcriptome::project_gene_haplotype_transcripts(const vector<uint32_t> & gene_transcripts, const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const unordered_set<string> & reference_samples, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool proj_emded_paths, const float mean_node_length) const {
+
+    list<CompletedTranscriptPath> gene_transcript_paths;
+
+    for (auto transcript_idx: gene_transcripts) {
+
+        const Transcript & transcript = transcripts.at(transcript_idx);
+
+        if (!haplotype_index.empty()) { 
+
+            // Project transcript onto haplotypes in GBWT index.
+            gene_transcript_paths.splice(gene_transcript_paths.end(), construct_completed_transcript_paths(project_transcript_gbwt(transcript, haplotype_index, reference_samples, mean_node_length)));
+        }
+
+        if (proj_emded_paths) { 
+
+            // Project transcript onto embedded paths.
+            gene_transcript_paths.splice(gene_transcript_paths.end(), construct_completed_transcript_paths(project_transcript_embedded(transcript, graph_path_pos_overlay, false, true)));
+        }
+    }
+
+    // Collapse identical transcript paths within the gene.
+    spp::sparse_hash_map<size_t, vector<CompletedTranscriptPath *> > gene_transcript_paths_index;
+    remove_redundant_transcript_paths<CompletedTranscriptPath>(&gene_transcript_paths, &gene_transcript_paths_index);
+
+    return gene_transcript_paths;
+}
+
 list<EditedTranscriptPath> Transcriptome::project_transcript_gbwt(const Transcript & cur_transcript, const gbwt::GBWT & haplotype_index,
                                                                   const unordered_set<string>& reference_samples, const float mean_node_length) const {
     
@@ -1983,7 +2306,7 @@ vector<pair<exon_nodes_t, thread_ids_t> > Transcriptome::get_exon_haplotypes(con
 }
 
 template <class T>
-void Transcriptome::remove_redundant_transcript_paths(list<T> * new_transcript_paths, spp::sparse_hash_map<handle_t, vector<T*> > * transcript_paths_index) const {
+void Transcriptome::remove_redundant_transcript_paths(list<T> * new_transcript_paths, spp::sparse_hash_map<size_t, vector<T*> > * transcript_paths_index) const {
 
     auto new_transcript_paths_it = new_transcript_paths->begin();
 
@@ -1993,7 +2316,7 @@ void Transcriptome::remove_redundant_transcript_paths(list<T> * new_transcript_p
 
         bool unique_transcript_path = true;
 
-        auto transcript_paths_index_it = transcript_paths_index->emplace(new_transcript_paths_it->get_first_node_handle(*_graph), vector<T*>());
+        auto transcript_paths_index_it = transcript_paths_index->emplace(new_transcript_paths_it->get_path_hash(), vector<T*>());
 
         // Add unique transcript paths only.
         if (!transcript_paths_index_it.second && path_collapse_type != "no") {
@@ -2330,11 +2653,11 @@ void Transcriptome::augment_graph(const list<EditedTranscriptPath> & edited_tran
 
         if (!_transcript_paths.empty()) {
 
-            spp::sparse_hash_map<handle_t, vector<CompletedTranscriptPath *> > transcript_paths_index;
+            spp::sparse_hash_map<size_t, vector<CompletedTranscriptPath *> > transcript_paths_index;
 
             for (auto & transcript_path: _transcript_paths) {
 
-                auto transcript_paths_index_it = transcript_paths_index.emplace(transcript_path.get_first_node_handle(*_graph), vector<CompletedTranscriptPath *>());
+                auto transcript_paths_index_it = transcript_paths_index.emplace(transcript_path.get_path_hash(), vector<CompletedTranscriptPath *>());
                 transcript_paths_index_it.first->second.emplace_back(&transcript_path);
             }
 
@@ -2843,19 +3166,7 @@ void Transcriptome::add_transcripts_to_gbwt(gbwt::GBWTBuilder * gbwt_builder, co
 
         ++num_added_threads;
 
-        // Convert transcript path to GBWT thread.
-        gbwt::vector_type gbwt_thread(transcript_path.path.size());
-        for (size_t i = 0; i < transcript_path.path.size(); i++) {
-
-            gbwt_thread[i] = handle_to_gbwt(*_graph, transcript_path.path.at(i));
-        }
-
-        // Insert transcript path as thread into GBWT index.
-        gbwt_builder->insert(gbwt_thread, add_bidirectional);
-
-        // Insert transcript path name into GBWT index.
-        gbwt_builder->index.metadata.addPath(pre_num_haplotypes + sample_names.size(), 0, 0, 0);
-
+        add_transcript_path_to_gbwt(gbwt_builder, transcript_path, add_bidirectional, pre_num_haplotypes + sample_names.size());
         sample_names.emplace_back(transcript_path.get_name());
     }
 
@@ -2866,6 +3177,22 @@ void Transcriptome::add_transcripts_to_gbwt(gbwt::GBWTBuilder * gbwt_builder, co
     gbwt_builder->index.metadata.addSamples(sample_names);
 }
 
+void Transcriptome::add_transcript_path_to_gbwt(gbwt::GBWTBuilder * gbwt_builder, const CompletedTranscriptPath & transcript_path, const bool add_bidirectional, const gbwt::size_type path_id) const {
+
+    // Convert transcript path to GBWT thread.
+    gbwt::vector_type gbwt_thread(transcript_path.path.size());
+    for (size_t i = 0; i < transcript_path.path.size(); i++) {
+
+        gbwt_thread[i] = handle_to_gbwt(*_graph, transcript_path.path.at(i));
+    }
+
+    // Insert transcript path as thread into GBWT index.
+    gbwt_builder->insert(gbwt_thread, add_bidirectional);
+
+    // Insert transcript path name into GBWT index.
+    gbwt_builder->index.metadata.addPath(path_id, 0, 0, 0);
+}
+
 void Transcriptome::write_transcript_sequences(ostream * fasta_ostream, const bool exclude_reference_transcripts) const {
 
     int32_t num_written_sequences = 0;
@@ -2882,21 +3209,29 @@ void Transcriptome::write_transcript_sequences(ostream * fasta_ostream, const bo
 
         ++num_written_sequences;
 
-        // Construct transcript path sequence.
-        string transcript_path_sequence = "";
-        for (auto & handle: transcript_path.path) {
+        write_transcript_path_sequence(fasta_ostream, transcript_path);
+    }
+}
 
-            transcript_path_sequence += _graph->get_sequence(handle);
-        }
+void Transcriptome::write_transcript_path_sequence(ostream * fasta_ostream, const CompletedTranscriptPath & transcript_path) const {
+
+    // Construct transcript path sequence.
+    string transcript_path_sequence = "";
+    for (auto & handle: transcript_path.path) {
 
-        // Write transcript path name and sequence.
-        write_fasta_sequence(transcript_path.get_name(), transcript_path_sequence, *fasta_ostream);
+        transcript_path_sequence += _graph->get_sequence(handle);
     }
+
+    // Write transcript path name and sequence.
+    write_fasta_sequence(transcript_path.get_name(), transcript_path_sequence, *fasta_ostream);
 }
 
-void Transcriptome::write_transcript_info(ostream * tsv_ostream, const gbwt::GBWT & haplotype_index, const bool exclude_reference_transcripts) const {
+void Transcriptome::write_transcript_info(ostream * tsv_ostream, const gbwt::GBWT & haplotype_index, const bool exclude_reference_transcripts, const bool write_header) const {
 
-    *tsv_ostream << "Name\tLength\tTranscripts\tHaplotypes" << endl; 
+    if (write_header) {
+
+        write_transcript_info_header(tsv_ostream);
+    }
     
     // Parse reference sample tags.
     auto gbwt_reference_samples = gbwtgraph::parse_reference_samples_tag(haplotype_index);
@@ -2915,77 +3250,87 @@ void Transcriptome::write_transcript_info(ostream * tsv_ostream, const gbwt::GBW
 
         ++num_written_info;
 
-        // Get transcript path length.
-        int32_t transcript_path_length = 0;
+        write_transcript_path_info(tsv_ostream, transcript_path, haplotype_index, gbwt_reference_samples, exclude_reference_transcripts);
+    }
+}
 
-        for (auto & handle: transcript_path.path) {
+void Transcriptome::write_transcript_info_header(ostream * tsv_ostream) const {
 
-            transcript_path_length += _graph->get_length(handle);
-        }
+    *tsv_ostream << "Name\tLength\tTranscripts\tHaplotypes" << endl; 
+}
 
-        *tsv_ostream << transcript_path.get_name();
-        *tsv_ostream << "\t" << transcript_path_length;
-        *tsv_ostream << "\t";
+void Transcriptome::write_transcript_path_info(ostream * tsv_ostream, const CompletedTranscriptPath & transcript_path, const gbwt::GBWT & haplotype_index, const unordered_set<string> & gbwt_reference_samples, const bool exclude_reference_transcripts) const {
 
-        assert(!transcript_path.transcript_names.empty());
+    // Get transcript path length.
+    int32_t transcript_path_length = 0;
 
-        bool is_first = true;
+    for (auto & handle: transcript_path.path) {
 
-        for (auto & name: transcript_path.transcript_names) {
+        transcript_path_length += _graph->get_length(handle);
+    }
 
-            if (!is_first) {
+    *tsv_ostream << transcript_path.get_name();
+    *tsv_ostream << "\t" << transcript_path_length;
+    *tsv_ostream << "\t";
 
-                *tsv_ostream << ",";
-            } 
+    assert(!transcript_path.transcript_names.empty());
 
-            is_first = false;
-            *tsv_ostream << name;
-        }
+    bool is_first = true;
 
-        *tsv_ostream << "\t";
+    for (auto & name: transcript_path.transcript_names) {
 
-        assert(!transcript_path.embedded_path_names.empty() || !transcript_path.haplotype_gbwt_ids.empty());
+        if (!is_first) {
 
-        
-        // count how many times we see each ref and haplotype identifier
-        map<string, size_t> ref_name_count, hap_name_count;
-        for (auto & name: transcript_path.embedded_path_names) {
-            if (exclude_reference_transcripts && name.second) {
-                continue;
-            }
-            
-            ref_name_count[name.first]++;
-        }
-        for (auto & id: transcript_path.haplotype_gbwt_ids) {
-            if (exclude_reference_transcripts && id.second) {
-                continue;
-            }
+            *tsv_ostream << ",";
+        } 
+
+        is_first = false;
+        *tsv_ostream << name;
+    }
+
+    *tsv_ostream << "\t";
 
-            hap_name_count[get_base_gbwt_path_name(haplotype_index, id.first, gbwt_reference_samples)]++;
+    assert(!transcript_path.embedded_path_names.empty() || !transcript_path.haplotype_gbwt_ids.empty());
+
+    
+    // count how many times we see each ref and haplotype identifier
+    map<string, size_t> ref_name_count, hap_name_count;
+    for (auto & name: transcript_path.embedded_path_names) {
+        if (exclude_reference_transcripts && name.second) {
+            continue;
         }
         
-        is_first = true;
-        for (auto origin_name_count : {&ref_name_count, &hap_name_count}) {
-            for (const auto& name_and_count : *origin_name_count) {
-                // make an origin for each of the times we saw it
-                for (size_t i = 0; i < name_and_count.second; ++i) {
-                    
-                    if (!is_first) {
-                        *tsv_ostream << ",";
-                    }
-                    is_first = false;
-                    
-                    *tsv_ostream << name_and_count.first;
-                    if (name_and_count.second > 1) {
-                        // disambiguate across overlapping phase blocks, passes through the transcript by a haplotype
-                        *tsv_ostream << '#' << i;
-                    }
+        ref_name_count[name.first]++;
+    }
+    for (auto & id: transcript_path.haplotype_gbwt_ids) {
+        if (exclude_reference_transcripts && id.second) {
+            continue;
+        }
+
+        hap_name_count[get_base_gbwt_path_name(haplotype_index, id.first, gbwt_reference_samples)]++;
+    }
+    
+    is_first = true;
+    for (auto origin_name_count : {&ref_name_count, &hap_name_count}) {
+        for (const auto& name_and_count : *origin_name_count) {
+            // make an origin for each of the times we saw it
+            for (size_t i = 0; i < name_and_count.second; ++i) {
+                
+                if (!is_first) {
+                    *tsv_ostream << ",";
+                }
+                is_first = false;
+                
+                *tsv_ostream << name_and_count.first;
+                if (name_and_count.second > 1) {
+                    // disambiguate across overlapping phase blocks, passes through the transcript by a haplotype
+                    *tsv_ostream << '#' << i;
                 }
             }
         }
-
-        *tsv_ostream << endl;
     }
+
+    *tsv_ostream << endl;
 }
 
 void Transcriptome::write_graph(ostream * graph_ostream) const {
@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include <mutex>
+#include <atomic>
 #include <functional>
 
 #include <google/protobuf/util/message_differencer.h>
@@ -136,7 +137,8 @@ struct EditedTranscriptPath : public TranscriptPath {
 
     ~EditedTranscriptPath() {};
 
-    handle_t get_first_node_handle(const HandleGraph & graph) const;
+    /// Hash of the transcript path, which is the same for identical paths.
+    size_t get_path_hash() const;
 
 };
 
@@ -152,7 +154,8 @@ struct CompletedTranscriptPath : public TranscriptPath {
     CompletedTranscriptPath(const EditedTranscriptPath & edited_transcript_path, const HandleGraph & graph);
     ~CompletedTranscriptPath() {};
 
-    handle_t get_first_node_handle(const HandleGraph & graph) const;
+    /// Hash of the transcript path, which is the same for identical paths.
+    size_t get_path_hash() const;
 };
 
 struct MappingHash
@@ -174,6 +177,25 @@ struct MappingHash
     }
  };
 
+/**
+ * Data structure that defines where haplotype-specific transcript paths are
+ * written when they are streamed during projection. Null outputs are skipped.
+ */
+struct TranscriptPathOutput {
+
+    /// GBWT index builder that transcript paths are added to as threads.
+    gbwt::GBWTBuilder * gbwt_builder = nullptr;
+
+    /// Add transcript paths as bidirectional threads.
+    bool add_bidirectional = false;
+
+    /// Stream that transcript path sequences are written to in fasta format.
+    ostream * fasta_ostream = nullptr;
+
+    /// Stream that transcript path info is written to in tsv format.
+    ostream * tsv_ostream = nullptr;
+};
+
 /**
  * Class that defines a transcriptome represented by a set of transcript paths.
  */
@@ -215,7 +237,12 @@ class Transcriptome {
         /// Adds haplotype-specific transcript paths by projecting transcripts in
         /// gtf/gff3 files onto either non-reference embedded paths and/or haplotypes
         /// in a GBWT index. Returns the number of haplotype transcript paths projected.   
-        int32_t add_haplotype_transcripts(vector<istream *> transcript_streams, const gbwt::GBWT & haplotype_index, const bool proj_emded_paths);
+        /// If an output is given, the haplotype transcript paths of each gene are 
+        /// collapsed and written to it as soon as the gene is projected, instead of 
+        /// being added to the transcriptome. Only the reference transcript paths 
+        /// are then kept, and they should be written after this returns. The node
+        /// ids of the graph should not be changed after streaming.
+        int32_t add_haplotype_transcripts(vector<istream *> transcript_streams, const gbwt::GBWT & haplotype_index, const bool proj_emded_paths, TranscriptPathOutput * path_output = nullptr);
 
         /// Returns transcript paths.
         const vector<CompletedTranscriptPath> & transcript_paths() const;
@@ -254,7 +281,11 @@ class Transcriptome {
 
         /// Writes info on transcriptome transcript paths to tsv file.
         /// Returns the number of written transcripts.
-        void write_transcript_info(ostream * tsv_ostream, const gbwt::GBWT & haplotype_index, const bool exclude_reference_transcripts) const;
+        /// Optionally skips the header line (e.g. if streamed paths were already written).
+        void write_transcript_info(ostream * tsv_ostream, const gbwt::GBWT & haplotype_index, const bool exclude_reference_transcripts, const bool write_header = true) const;
+
+        /// Writes the header line of the transcript info tsv file.
+        void write_transcript_info_header(ostream * tsv_ostream) const;
 
         /// Writes the graph to a file.
         void write_graph(ostream * graph_ostream) const;
@@ -303,7 +334,7 @@ class Transcriptome {
         list<EditedTranscriptPath> construct_reference_transcript_paths_embedded(const vector<Transcript> & transcripts, const bdsg::PositionOverlay & graph_path_pos_overlay) const;
 
         /// Threaded reference transcript path construction using embedded paths.
-        void construct_reference_transcript_paths_embedded_callback(list<EditedTranscriptPath> * edited_transcript_paths, spp::sparse_hash_map<handle_t, vector<EditedTranscriptPath *> > * edited_transcript_paths_index, mutex * edited_transcript_paths_mutex, const int32_t thread_idx, const vector<Transcript> & transcripts, const bdsg::PositionOverlay & graph_path_pos_overlay) const;
+        void construct_reference_transcript_paths_embedded_callback(list<EditedTranscriptPath> * edited_transcript_paths, spp::sparse_hash_map<size_t, vector<EditedTranscriptPath *> > * edited_transcript_paths_index, mutex * edited_transcript_paths_mutex, atomic<uint32_t> * next_transcripts_idx, const vector<Transcript> & transcripts, const bdsg::PositionOverlay & graph_path_pos_overlay) const;
 
         /// Projects transcripts onto embedded paths in a graph and returns the resulting transcript paths.
         list<EditedTranscriptPath> project_transcript_embedded(const Transcript & cur_transcript, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool use_reference_paths, const bool use_haplotype_paths) const;
@@ -313,7 +344,7 @@ class Transcriptome {
         list<EditedTranscriptPath> construct_reference_transcript_paths_gbwt(const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index) const;
 
         /// Threaded reference transcript path construction using GBWT haplotype paths.
-        void construct_reference_transcript_paths_gbwt_callback(list<EditedTranscriptPath> * edited_transcript_paths, spp::sparse_hash_map<handle_t, vector<EditedTranscriptPath *> > * edited_transcript_paths_index, uint32_t * excluded_transcripts, mutex * edited_transcript_paths_mutex, const int32_t thread_idx, const vector<pair<uint32_t, uint32_t> > & chrom_transcript_sets, const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const spp::sparse_hash_map<string, map<uint32_t, uint32_t> > & haplotype_name_index) const;
+        void construct_reference_transcript_paths_gbwt_callback(list<EditedTranscriptPath> * edited_transcript_paths, spp::sparse_hash_map<size_t, vector<EditedTranscriptPath *> > * edited_transcript_paths_index, uint32_t * excluded_transcripts, mutex * edited_transcript_paths_mutex, atomic<uint32_t> * next_chrom_transcript_sets_idx, const vector<pair<uint32_t, uint32_t> > & chrom_transcript_sets, const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const spp::sparse_hash_map<string, map<uint32_t, uint32_t> > & haplotype_name_index) const;
 
         /// Constructs haplotype transcript paths by projecting transcripts onto
         /// embedded paths in a graph and/or haplotypes in a GBWT index. 
@@ -321,7 +352,21 @@ class Transcriptome {
         void project_haplotype_transcripts(const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool proj_emded_paths, const float mean_node_length);
 
         /// Threaded haplotype transcript projecting.
-        void project_haplotype_transcripts_callback(list<CompletedTranscriptPath> * completed_transcript_paths, spp::sparse_hash_map<handle_t, vector<CompletedTranscriptPath *> > * completed_transcript_paths_index,  mutex * completed_transcript_paths_mutex, const int32_t thread_idx, const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool proj_emded_paths, const float mean_node_length);
+        void project_haplotype_transcripts_callback(list<CompletedTranscriptPath> * completed_transcript_paths, spp::sparse_hash_map<size_t, vector<CompletedTranscriptPath *> > * completed_transcript_paths_index,  mutex * completed_transcript_paths_mutex, atomic<uint32_t> * next_transcripts_idx, const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool proj_emded_paths, const float mean_node_length);
+
+        /// Constructs haplotype transcript paths like project_haplotype_transcripts, but 
+        /// projects and collapses the transcripts one gene (set of overlapping transcripts)
+        /// at a time and writes the resulting paths to the output. Returns the number of
+        /// transcript paths written.
+        int32_t stream_haplotype_transcripts(const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool proj_emded_paths, const float mean_node_length, TranscriptPathOutput * path_output);
+
+        /// Groups transcripts that overlap on the same chromosome/contig into genes. 
+        /// Returns the transcript indices of each gene.
+        vector<vector<uint32_t> > group_transcripts_by_gene(const vector<Transcript> & transcripts) const;
+
+        /// Projects the transcripts of a gene onto embedded paths and/or haplotypes 
+        /// in a GBWT index, and returns the collapsed transcript paths.
+        list<CompletedTranscriptPath> project_gene_haplotype_transcripts(const vector<uint32_t> & gene_transcripts, const vector<Transcript> & transcripts, const gbwt::GBWT & haplotype_index, const unordered_set<string> & reference_samples, const bdsg::PositionOverlay & graph_path_pos_overlay, const bool proj_emded_paths, const float mean_node_length) const;
 
         /// Projects transcripts onto haplotypes in a GBWT index and returns the resulting transcript paths.
         list<EditedTranscriptPath> project_transcript_gbwt(const Transcript & cur_transcript, const gbwt::GBWT & haplotype_index,
@@ -331,9 +376,10 @@ class Transcriptome {
         /// resulting paths and the corresponding haplotype ids for each path.
         vector<pair<exon_nodes_t, thread_ids_t> > get_exon_haplotypes(const vg::id_t start_node, const vg::id_t end_node, const gbwt::GBWT & haplotype_index,  const unordered_set<string>& reference_samples, const int32_t expected_length) const;
 
-        /// Remove redundant transcript paths and update index.
+        /// Remove redundant transcript paths and update index of 
+        /// transcript paths by path hash.
         template <class T>
-        void remove_redundant_transcript_paths(list<T> * new_transcript_paths, spp::sparse_hash_map<handle_t, vector<T*> > * transcript_paths_index) const;
+        void remove_redundant_transcript_paths(list<T> * new_transcript_paths, spp::sparse_hash_map<size_t, vector<T*> > * transcript_paths_index) const;
 
         /// Constructs completed transcripts paths from 
         /// edited transcript paths. Checks that the
@@ -364,6 +410,15 @@ class Transcriptome {
         void add_splice_junction_edges(const list<CompletedTranscriptPath> & completed_transcript_paths);
         void add_splice_junction_edges(const vector<CompletedTranscriptPath> & completed_transcript_paths);
 
+        /// Adds a transcript path as a thread with the given path id to a GBWT index.
+        void add_transcript_path_to_gbwt(gbwt::GBWTBuilder * gbwt_builder, const CompletedTranscriptPath & transcript_path, const bool add_bidirectional, const gbwt::size_type path_id) const;
+
+        /// Writes a transcript path sequence to a fasta file.
+        void write_transcript_path_sequence(ostream * fasta_ostream, const CompletedTranscriptPath & transcript_path) const;
+
+        /// Writes info on a transcript path as a line in a tsv file.
+        void write_transcript_path_info(ostream * tsv_ostream, const CompletedTranscriptPath & transcript_path, const gbwt::GBWT & haplotype_index, const unordered_set<string> & gbwt_reference_samples, const bool exclude_reference_transcripts) const;
+
         /// Collects all unique nodes in transcriptome transcript paths.
         void collect_transcribed_nodes(spp::sparse_hash_set<nid_t> * transcribed_nodes) const;
 
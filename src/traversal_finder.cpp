@@ -830,6 +830,11 @@ vector<SnarlTraversal> PathTraversalFinder::find_traversals(const Snarl& site) {
 
 pair<vector<SnarlTraversal>, vector<pair<step_handle_t, step_handle_t> > > PathTraversalFinder::find_path_traversals(const Snarl& site) {
 
+    auto indexed = boundary_visits.find(&site);
+    if (indexed != boundary_visits.end()) {
+        return find_indexed_path_traversals(site, indexed->second);
+    }
+
     handle_t start_handle = graph.get_handle(site.start().node_id(), site.start().backward());
     handle_t end_handle = graph.get_handle(site.end().node_id(), site.end().backward());
     
@@ -925,6 +930,119 @@ pair<vector<SnarlTraversal>, vector<pair<step_handle_t, step_handle_t> > > PathT
     return make_pair(out_travs, out_steps);
 }
 
+void PathTraversalFinder::index_snarl_boundaries(const vector<const Snarl*>& snarls) {
+
+    // which snarls each node is a boundary of
+    unordered_map<nid_t, vector<size_t>> boundary_to_snarls;
+    for (size_t i = 0; i < snarls.size(); ++i) {
+        boundary_to_snarls[snarls[i]->start().node_id()].push_back(i);
+        if (snarls[i]->end().node_id() != snarls[i]->start().node_id()) {
+            boundary_to_snarls[snarls[i]->end().node_id()].push_back(i);
+        }
+    }
+
+    vector<path_handle_t> path_handles;
+    graph.for_each_path_handle([&](const path_handle_t& path_handle) {
+            if (paths.empty() || paths.count(path_handle)) {
+                path_handles.push_back(path_handle);
+            }
+        });
+
+    // each path's visits, by snarl, found in parallel
+    vector<unordered_map<size_t, vector<step_handle_t>>> visits_by_path(path_handles.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < path_handles.size(); ++i) {
+        graph.for_each_step_in_path(path_handles[i], [&](const step_handle_t& step) {
+                auto found = boundary_to_snarls.find(graph.get_id(graph.get_handle_of_step(step)));
+                if (found != boundary_to_snarls.end()) {
+                    for (size_t snarl_index : found->second) {
+                        visits_by_path[i][snarl_index].push_back(step);
+                    }
+                }
+            });
+    }
+
+    // then put them together in path order
+    for (const Snarl* snarl : snarls) {
+        boundary_visits[snarl];
+    }
+    for (auto& path_visits : visits_by_path) {
+        for (auto& snarl_visits : path_visits) {
+            boundary_visits[snarls[snarl_visits.first]].emplace_back(std::move(snarl_visits.second));
+        }
+        path_visits.clear();
+    }
+}
+
+pair<vector<SnarlTraversal>, vector<pair<step_handle_t, step_handle_t> > > PathTraversalFinder::find_indexed_path_traversals(
+    const Snarl& site, const vector<vector<step_handle_t>>& path_visits) const {
+
+    handle_t start_handle = graph.get_handle(site.start().node_id(), site.start().backward());
+    handle_t end_handle = graph.get_handle(site.end().node_id(), site.end().backward());
+
+    vector<SnarlTraversal> out_travs;
+    vector<pair<step_handle_t, step_handle_t> > out_steps;
+
+    // The snarl's boundaries separate it from the rest of the graph, so a
+    // path that enters it at the start stays inside it until its next visit
+    // to a boundary node. If that is the end, pointing out of the snarl, we
+    // have a traversal. If it is the start pointing out, the path left again.
+    // Visits to a boundary pointing into the snarl keep us inside it.
+    for (const vector<step_handle_t>& visits : path_visits) {
+        for (size_t i = 0; i < visits.size(); ++i) {
+            handle_t handle = graph.get_handle_of_step(visits[i]);
+            if (graph.get_id(handle) != site.start().node_id()) {
+                continue;
+            }
+            // walking backward along the path, we see everything flipped
+            bool backward = (handle != start_handle);
+            handle_t exit_handle = graph.flip(start_handle);
+            size_t j = i;
+            bool found_end = false;
+            while (true) {
+                handle_t here = graph.get_handle_of_step(visits[j]);
+                if (backward) {
+                    here = graph.flip(here);
+                }
+                if (here == end_handle) {
+                    found_end = true;
+                    break;
+                }
+                if (j != i && here == exit_handle) {
+                    break;
+                }
+                if (backward ? j == 0 : j + 1 == visits.size()) {
+                    break;
+                }
+                j = backward ? j - 1 : j + 1;
+            }
+            if (!found_end) {
+                continue;
+            }
+
+            SnarlTraversal trav;
+            step_handle_t step = visits[i];
+            while (true) {
+                handle_t here = graph.get_handle_of_step(step);
+                if (backward) {
+                    here = graph.flip(here);
+                }
+                Visit* visit = trav.add_visit();
+                visit->set_node_id(graph.get_id(here));
+                visit->set_backward(graph.get_is_reverse(here));
+                if (step == visits[j]) {
+                    break;
+                }
+                step = backward ? graph.get_previous_step(step) : graph.get_next_step(step);
+            }
+            out_travs.push_back(trav);
+            out_steps.push_back(make_pair(visits[i], visits[j]));
+        }
+    }
+
+    return make_pair(out_travs, out_steps);
+}
+
 TrivialTraversalFinder::TrivialTraversalFinder(const HandleGraph& graph) : graph(graph) {
     // Nothing to do!
 }
@@ -3371,6 +3489,30 @@ GBWTTraversalFinder::~GBWTTraversalFinder() {
 pair<vector<SnarlTraversal>, vector<vector<gbwt::size_type>>>
 GBWTTraversalFinder::find_gbwt_traversals(const Snarl& site, bool return_paths) {
 
+    gbwt::node_type start_node = gbwt::Node::encode(site.start().node_id(), site.start().backward());
+    gbwt::node_type end_node = gbwt::Node::encode(site.end().node_id(), site.end().backward());
+    auto indexed = end_visit_sequences.find(end_node);
+    if (indexed != end_visit_sequences.end()) {
+        // the index tells us who each haplotype is, and the bidirectional
+        // GBWT gives us the ones going backward from the start too
+        vector<SnarlTraversal> traversals;
+        vector<vector<gbwt::size_type>> gbwt_paths;
+        for (auto& haplotype : get_snarl_haplotypes(start_node, end_node)) {
+            traversals.emplace_back();
+            for (gbwt::node_type node : haplotype.first) {
+                *traversals.back().add_visit() = to_visit(gbwt::Node::id(node), gbwt::Node::is_reverse(node));
+            }
+            if (return_paths) {
+                gbwt_paths.emplace_back(indexed->second.begin() + haplotype.second.range.first,
+                                        indexed->second.begin() + haplotype.second.range.second + 1);
+                auto& ids = gbwt_paths.back();
+                std::sort(ids.begin(), ids.end());
+                ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+            }
+        }
+        return make_pair(traversals, gbwt_paths);
+    }
+
     // follow all gbwt threads from start to end
     vector<pair<vector<gbwt::node_type>, gbwt::SearchState> > forward_traversals = list_haplotypes(
         graph,
@@ -3464,6 +3606,145 @@ vector<SnarlTraversal> GBWTTraversalFinder::find_traversals(const Snarl& site) {
     return find_gbwt_traversals(site, false).first;
 }
 
+vector<pair<vector<gbwt::node_type>, gbwt::SearchState> >
+GBWTTraversalFinder::get_snarl_haplotypes(gbwt::node_type start, gbwt::node_type end) const {
+
+    vector<pair<vector<gbwt::node_type>, gbwt::SearchState> > search_intermediates;
+    vector<pair<vector<gbwt::node_type>, gbwt::SearchState> > search_results;
+
+    gbwt::node_type exit_node = gbwt::Node::reverse(start);
+    gbwt::SearchState first_state = gbwt.find(start);
+    if (!first_state.empty()) {
+        search_intermediates.emplace_back(vector<gbwt::node_type>(1, start), first_state);
+    }
+
+    while (!search_intermediates.empty()) {
+        auto last = std::move(search_intermediates.back());
+        search_intermediates.pop_back();
+
+        // the record's outgoing edges are the ones the haplotypes take
+        vector<gbwt::edge_type> edges = gbwt.edges(last.first.back());
+        for (size_t i = 0; i < edges.size(); ++i) {
+            gbwt::node_type next = edges[i].first;
+            if (next == gbwt::ENDMARKER || next == exit_node) {
+                continue;
+            }
+            gbwt::SearchState new_state = gbwt.extend(last.second, next);
+            if (new_state.empty()) {
+                continue;
+            }
+            vector<gbwt::node_type> new_thread;
+            if (i + 1 == edges.size()) {
+                new_thread = std::move(last.first);
+            } else {
+                new_thread = last.first;
+            }
+            new_thread.push_back(next);
+            if (next == end) {
+                search_results.emplace_back(std::move(new_thread), new_state);
+            } else {
+                search_intermediates.emplace_back(std::move(new_thread), new_state);
+            }
+        }
+    }
+
+    return search_results;
+}
+
+void GBWTTraversalFinder::index_snarl_boundaries(const vector<const Snarl*>& snarls) {
+
+    if (!gbwt.bidirectional()) {
+        // we would miss the haplotypes that only go from the end to the start
+        return;
+    }
+
+    vector<gbwt::node_type> starts(snarls.size());
+    vector<gbwt::node_type> ends(snarls.size());
+    unordered_map<gbwt::node_type, vector<size_t>> snarls_by_start;
+    unordered_set<gbwt::node_type> all_ends;
+    for (size_t i = 0; i < snarls.size(); ++i) {
+        starts[i] = gbwt::Node::encode(snarls[i]->start().node_id(), snarls[i]->start().backward());
+        ends[i] = gbwt::Node::encode(snarls[i]->end().node_id(), snarls[i]->end().backward());
+        snarls_by_start[starts[i]].push_back(i);
+        all_ends.insert(ends[i]);
+    }
+
+    // string the snarls into chains, where each one starts where the last one
+    // ended. chains start where no snarl ends, unless they're cyclic
+    vector<vector<size_t>> chains;
+    vector<bool> assigned(snarls.size(), false);
+    for (bool heads_only : {true, false}) {
+        for (size_t i = 0; i < snarls.size(); ++i) {
+            if (assigned[i] || (heads_only && all_ends.count(starts[i]))) {
+                continue;
+            }
+            chains.emplace_back();
+            size_t here = i;
+            bool more = true;
+            while (more) {
+                assigned[here] = true;
+                chains.back().push_back(here);
+                more = false;
+                auto found = snarls_by_start.find(ends[here]);
+                if (found != snarls_by_start.end()) {
+                    for (size_t next : found->second) {
+                        if (!assigned[next]) {
+                            here = next;
+                            more = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    vector<vector<pair<gbwt::node_type, vector<gbwt::size_type>>>> chain_tables(chains.size());
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < chains.size(); ++i) {
+        // only the first snarl of the chain has to locate all its visits to the start
+        gbwt::node_type start = starts[chains[i].front()];
+        vector<gbwt::size_type> start_sequences(gbwt.nodeSize(start));
+        for (gbwt::size_type offset = 0; offset < start_sequences.size(); ++offset) {
+            start_sequences[offset] = gbwt.locate(gbwt::edge_type(start, offset));
+        }
+        for (size_t snarl_index : chains[i]) {
+            start = starts[snarl_index];
+            gbwt::node_type end = ends[snarl_index];
+            gbwt::node_type exit_node = gbwt::Node::reverse(start);
+            vector<gbwt::size_type> end_sequences(gbwt.nodeSize(end), gbwt::invalid_sequence());
+            if (end == start) {
+                end_sequences = start_sequences;
+            } else {
+                // follow each haplotype through the snarl to carry its sequence to the end
+                for (gbwt::size_type offset = 0; offset < start_sequences.size(); ++offset) {
+                    gbwt::edge_type pos = gbwt.LF(gbwt::edge_type(start, offset));
+                    while (pos.first != gbwt::ENDMARKER && pos.first != end && pos.first != exit_node) {
+                        pos = gbwt.LF(pos);
+                    }
+                    if (pos.first == end) {
+                        end_sequences[pos.second] = start_sequences[offset];
+                    }
+                }
+                // haplotypes that start inside the snarl still need to be located
+                for (gbwt::size_type offset = 0; offset < end_sequences.size(); ++offset) {
+                    if (end_sequences[offset] == gbwt::invalid_sequence()) {
+                        end_sequences[offset] = gbwt.locate(gbwt::edge_type(end, offset));
+                    }
+                }
+            }
+            chain_tables[i].emplace_back(end, end_sequences);
+            start_sequences = std::move(end_sequences);
+        }
+    }
+
+    for (auto& tables : chain_tables) {
+        for (auto& table : tables) {
+            end_visit_sequences.emplace(table.first, std::move(table.second));
+        }
+    }
+}
+
 pair<vector<SnarlTraversal>, vector<gbwt::size_type>> GBWTTraversalFinder::find_path_traversals(const Snarl& site) {
     // get the unique traversals
     pair<vector<SnarlTraversal>, vector<vector<gbwt::size_type>>> gbwt_traversals = find_gbwt_traversals(site, true);
@@ -204,6 +204,14 @@ protected:
 
     // restrict to these paths
     unordered_set<path_handle_t> paths;
+
+    // for each snarl given to index_snarl_boundaries(), the steps where each
+    // path visits the snarl's boundary nodes, one list per path, in path order
+    unordered_map<const Snarl*, vector<vector<step_handle_t>>> boundary_visits;
+
+    // find_path_traversals() for a snarl in the boundary index
+    pair<vector<SnarlTraversal>, vector<pair<step_handle_t, step_handle_t> > > find_indexed_path_traversals(
+        const Snarl& site, const vector<vector<step_handle_t>>& path_visits) const;
     
 public:
     // if path_names not empty, only those paths will be considered
@@ -220,6 +228,18 @@ public:
     */
     virtual pair<vector<SnarlTraversal>, vector<pair<step_handle_t, step_handle_t> > > find_path_traversals(const Snarl& site);
 
+    /**
+     * Walk each path once, in parallel, recording where it visits the boundary
+     * nodes of the given snarls. Afterward, find_path_traversals() on these
+     * snarls (by address) reads the visits from this index instead of
+     * querying the steps on the boundary nodes and walking against the snarl
+     * contents, so it doesn't repeat the work for nested snarls or many
+     * paths. The index is read-only after this, so find_path_traversals()
+     * can be called from many threads. Traversals come out grouped by path, in
+     * path handle order.
+     */
+    void index_snarl_boundaries(const vector<const Snarl*>& snarls);
+
 };    
     
 
@@ -644,6 +664,17 @@ public:
     virtual pair<vector<SnarlTraversal>, vector<gbwt::size_type>> find_path_traversals(const Snarl& site);
 
     const gbwt::GBWT& get_gbwt() { return gbwt; }
+
+    /**
+     * Work out which GBWT sequence makes each visit to the end of each of the
+     * given snarls, so that find_gbwt_traversals() doesn't need to locate the
+     * haplotypes it finds. Snarls are processed in chain order, and the
+     * sequences at the end of one snarl are carried through the next by
+     * following each haplotype, so the work is linear in the number of visits
+     * rather than a locate per visit. Only used with a bidirectional GBWT.
+     * Traversals of indexed snarls stop at the snarl's boundaries.
+     */
+    void index_snarl_boundaries(const vector<const Snarl*>& snarls);
     
 protected:
 
@@ -652,6 +683,16 @@ protected:
      * in the GBWT, and returning all unique haplotypes found. 
      */
     vector<pair<vector<gbwt::node_type>, gbwt::SearchState> > get_spanning_haplotypes(handle_t start, handle_t end);    
+
+    /**
+     * Like get_spanning_haplotypes(), but haplotypes that leave through the
+     * start are dropped instead of followed through the rest of the graph.
+     */
+    vector<pair<vector<gbwt::node_type>, gbwt::SearchState> > get_snarl_haplotypes(gbwt::node_type start,
+                                                                                   gbwt::node_type end) const;
+
+    /// The sequence at each offset of each indexed snarl end's GBWT record
+    unordered_map<gbwt::node_type, vector<gbwt::size_type>> end_visit_sequences;
 };
 
 }
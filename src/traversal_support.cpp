@@ -187,6 +187,27 @@ vector<Support> TraversalSupportFinder::get_traversal_set_support(const vector<S
         ref_offsets = get_ref_offsets(traversals[ref_trav_idx]);
     }
 
+    // gather the supports of the snarl's nodes and edges the first time we see them, so that
+    // the traversals share lookups instead of going back to the support finder for every visit
+    unordered_map<id_t, tuple<Support, Support, int64_t>> node_slice;
+    unordered_map<edge_t, pair<Support, int64_t>> edge_slice;
+    auto get_node_slice = [&](id_t node_id) -> const tuple<Support, Support, int64_t>& {
+        auto it = node_slice.find(node_id);
+        if (it == node_slice.end()) {
+            pair<Support, Support> supports = get_min_avg_node_support(node_id);
+            it = node_slice.emplace(node_id, make_tuple(supports.first, supports.second,
+                                                        (int64_t)graph.get_length(graph.get_handle(node_id)))).first;
+        }
+        return it->second;
+    };
+    auto get_edge_slice = [&](const edge_t& edge) -> const pair<Support, int64_t>& {
+        auto it = edge_slice.find(edge);
+        if (it == edge_slice.end()) {
+            it = edge_slice.emplace(edge, make_pair(get_edge_support(edge), get_edge_length(edge, ref_offsets))).first;
+        }
+        return it->second;
+    };
+
     // pass 2: get the supports
     // we compute the various combinations of min/avg node/trav supports as we don't know which
     // we will need until all the sizes are known
@@ -279,11 +300,10 @@ vector<Support> TraversalSupportFinder::get_traversal_set_support(const vector<S
 
             if (visit.node_id() != 0) {
                 // get the node support
-                min_support = get_min_node_support(visit.node_id());
-                avg_support = get_avg_node_support(visit.node_id());
-                length = graph.get_length(graph.get_handle(visit.node_id()));
-                if (node_counts.count(visit.node_id())) {
-                    share_count = node_counts[visit.node_id()];
+                tie(min_support, avg_support, length) = get_node_slice(visit.node_id());
+                auto count_it = node_counts.find(visit.node_id());
+                if (count_it != node_counts.end()) {
+                    share_count = count_it->second;
                 } 
             } else {
                 // get the child support
@@ -300,10 +320,10 @@ vector<Support> TraversalSupportFinder::get_traversal_set_support(const vector<S
             if (visit_idx > 0 && (trav.visit(visit_idx - 1).node_id() != 0 || trav.visit(visit_idx).node_id() != 0)) {
                 // get the edge support
                 edge_t edge = to_edge(graph, trav.visit(visit_idx - 1), visit);
-                min_support = get_edge_support(edge);
-                length = get_edge_length(edge, ref_offsets);
-                if (edge_counts.count(edge)) {
-                    share_count = edge_counts[edge];                    
+                tie(min_support, length) = get_edge_slice(edge);
+                auto count_it = edge_counts.find(edge);
+                if (count_it != edge_counts.end()) {
+                    share_count = count_it->second;
                 }
                 update_support(trav_idx, min_support, min_support, length, share_count);
             }
@@ -489,6 +509,10 @@ Support PackedTraversalSupportFinder::get_edge_support(id_t from, bool from_reve
     return support;
 }
 
+pair<Support, Support> TraversalSupportFinder::get_min_avg_node_support(id_t node) const {
+    return make_pair(get_min_node_support(node), get_avg_node_support(node));
+}
+
 Support PackedTraversalSupportFinder::get_min_node_support(id_t node) const {
     Position pos;
     pos.set_node_id(node);
@@ -517,6 +541,25 @@ Support PackedTraversalSupportFinder::get_avg_node_support(id_t node) const {
     return support;
 }
 
+pair<Support, Support> PackedTraversalSupportFinder::get_min_avg_node_support(id_t node) const {
+    Position pos;
+    pos.set_node_id(node);
+    size_t offset = packer.position_in_basis(pos);
+    size_t length = graph.get_length(graph.get_handle(node));
+    size_t min_coverage = numeric_limits<size_t>::max();
+    size_t total_coverage = 0;
+    for (size_t i = 0; i < length; ++i) {
+        size_t coverage = packer.coverage_at_position(offset + i);
+        min_coverage = min(min_coverage, coverage);
+        total_coverage += coverage;
+    }
+    Support min_support;
+    min_support.set_forward(length > 0 ? min_coverage : packer.coverage_at_position(offset));
+    Support avg_support;
+    avg_support.set_forward((double)total_coverage / (double)length);
+    return make_pair(min_support, avg_support);
+}
+
 size_t PackedTraversalSupportFinder::get_avg_node_mapq(id_t node) const {
     size_t offset = packer.node_index(node);
     return packer.average_node_quality(offset);    
@@ -588,6 +631,21 @@ Support CachedPackedTraversalSupportFinder::get_avg_node_support(id_t node) cons
     }
 }
 
+pair<Support, Support> CachedPackedTraversalSupportFinder::get_min_avg_node_support(id_t node) const {
+    auto& min_cache = *min_node_support_cache[omp_get_thread_num()];
+    auto& avg_cache = *avg_node_support_cache[omp_get_thread_num()];
+    pair<Support, bool> cached_min = min_cache.retrieve(node);
+    pair<Support, bool> cached_avg = avg_cache.retrieve(node);
+    if (cached_min.second && cached_avg.second) {
+        return make_pair(cached_min.first, cached_avg.first);
+    } else {
+        pair<Support, Support> supports = PackedTraversalSupportFinder::get_min_avg_node_support(node);
+        min_cache.put(node, supports.first);
+        avg_cache.put(node, supports.second);
+        return supports;
+    }
+}
+
 size_t CachedPackedTraversalSupportFinder::get_avg_node_mapq(id_t node) const {
     auto& mapq_cache = *avg_node_mapq_cache[omp_get_thread_num()];
     pair<size_t, bool> cached = mapq_cache.retrieve(node);
@@ -39,6 +39,10 @@ public:
     /// Average support of a node
     virtual Support get_avg_node_support(id_t node) const = 0;
 
+    /// Minimum and average support of a node, for finders that can look them
+    /// up together
+    virtual pair<Support, Support> get_min_avg_node_support(id_t node) const;
+
     /// Average MAPQ of reads that map to a node
     virtual size_t get_avg_node_mapq(id_t node) const = 0;
 
@@ -142,6 +146,9 @@ public:
     /// Average support of a node
     virtual Support get_avg_node_support(id_t node) const;
 
+    /// Minimum and average support of a node, from one pass over its coverage
+    virtual pair<Support, Support> get_min_avg_node_support(id_t node) const;
+
     /// Average MAPQ of reads that map to a node
     virtual size_t get_avg_node_mapq(id_t node) const;
     
@@ -171,6 +178,9 @@ public:
     /// Average support of a node
     virtual Support get_avg_node_support(id_t node) const;
 
+    /// Minimum and average support of a node, filling both caches on a miss
+    virtual pair<Support, Support> get_min_avg_node_support(id_t node) const;
+
     /// Average MAPQ of reads that map to a node
     virtual size_t get_avg_node_mapq(id_t node) const;
     
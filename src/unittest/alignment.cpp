@@ -5,6 +5,8 @@
 
 #include <iostream>
 #include <string>
+#include <sstream>
+#include <tuple>
 #include "vg/io/json2pb.h"
 #include <vg/vg.pb.h>
 #include "../alignment.hpp"
@@ -239,6 +241,31 @@ TEST_CASE("Target to alignment extraction", "[target-to-aln]") {
         REQUIRE(target.path().mapping(1).position().is_reverse() == true);
     }
     
+    SECTION("BED regions come out in file order and match the single-region extraction") {
+        vector<tuple<size_t, size_t, string, size_t, bool>> regions {
+            {10, 20, "b", 3, false},
+            {0, 14, "a", 5, true},
+            {1, 2, "c", 1, false},
+            {12, 22, "d", 0, false},
+            {3, 7, "e", 2, true}
+        };
+        stringstream bed;
+        for (auto& region : regions) {
+            bed << "path\t" << get<0>(region) << "\t" << get<1>(region) << "\t" << get<2>(region)
+                << "\t" << get<3>(region) << "\t" << (get<4>(region) ? "-" : "+") << "\n";
+        }
+        
+        vector<Alignment> parsed;
+        parse_bed_regions(bed, &xg_index, &parsed);
+        REQUIRE(parsed.size() == regions.size());
+        for (size_t i = 0; i < regions.size(); i++) {
+            Alignment expected = target_alignment(&xg_index, path_handle, get<0>(regions[i]), get<1>(regions[i]),
+                                                  get<2>(regions[i]), get<4>(regions[i]));
+            expected.set_score(get<3>(regions[i]));
+            REQUIRE(pb2json(parsed[i]) == pb2json(expected));
+        }
+    }
+    
 }
 
 TEST_CASE("simplify_cigar merges runs of adjacent I's and D's in cigars", "[alignment][surject]") {
@@ -5,6 +5,8 @@
 
 #include <iostream>
 #include <string>
+#include <limits>
+#include <functional>
 #include "vg/io/json2pb.h"
 #include <vg/vg.pb.h>
 #include "../annotation.hpp"
@@ -86,6 +88,60 @@ TEST_CASE("Annotations convert to JSON sensibly", "[alignment][annotation]") {
     
     REQUIRE(json == R"({"annotation": {"snake_case_number": 1.5}})");
 }
+
+TEST_CASE("AnnotationBuffers hold typed annotations until they are applied", "[alignment][annotation]") {
+    
+    AnnotationBuffer annotations;
+    set_annotation(annotations, "proper_pair", true);
+    set_annotation(annotations, "fragment_length", 250);
+    set_annotation(annotations, "fragment_length_distribution", string("-I 250 -D 30"));
+    set_annotation(annotations, "secondary_scores", vector<double>{10.0, 5.0});
+    set_annotation(annotations, "mapq_uncapped", numeric_limits<double>::infinity());
+    
+    REQUIRE(annotations.size() == 5);
+    REQUIRE(has_annotation(annotations, "proper_pair"));
+    REQUIRE(!has_annotation(annotations, "rescued"));
+    REQUIRE(get_annotation<bool>(annotations, "proper_pair") == true);
+    REQUIRE(get_annotation<size_t>(annotations, "fragment_length") == 250);
+    REQUIRE(get_annotation<vector<double>>(annotations, "secondary_scores").size() == 2);
+    REQUIRE(get_annotation<double>(annotations, "missing") == 0.0);
+    
+    SECTION("Setting an annotation again replaces it") {
+        set_annotation(annotations, "fragment_length", 300);
+        REQUIRE(annotations.size() == 5);
+        REQUIRE(get_annotation<double>(annotations, "fragment_length") == 300.0);
+        
+        clear_annotation(annotations, "fragment_length");
+        REQUIRE(annotations.size() == 4);
+        REQUIRE(!has_annotation(annotations, "fragment_length"));
+    }
+    
+    SECTION("Applying the buffer sets the same values as set_annotation") {
+        Alignment aln;
+        annotations.apply_to(aln);
+        
+        Alignment direct;
+        set_annotation(direct, "proper_pair", true);
+        set_annotation(direct, "fragment_length", 250);
+        set_annotation(direct, "fragment_length_distribution", string("-I 250 -D 30"));
+        set_annotation(direct, "secondary_scores", vector<double>{10.0, 5.0});
+        set_annotation(direct, "mapq_uncapped", numeric_limits<double>::infinity());
+        
+        REQUIRE(pb2json(aln) == pb2json(direct));
+        REQUIRE(get_annotation<double>(aln, "mapq_uncapped") == numeric_limits<double>::infinity());
+    }
+    
+    SECTION("Applying the buffer can keep only some annotations") {
+        Alignment aln;
+        function<bool(const string&)> keep = [](const string& name) {
+            return name == "proper_pair";
+        };
+        annotations.apply_to(aln, &keep);
+        
+        REQUIRE(aln.annotation().fields().size() == 1);
+        REQUIRE(get_annotation<bool>(aln, "proper_pair") == true);
+    }
+}
    
 }
 }
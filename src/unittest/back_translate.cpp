@@ -5,12 +5,14 @@
 
 #include <iostream>
 #include <string>
+#include <sstream>
 #include <unordered_map>
 #include "vg/io/json2pb.h"
 #include <vg/vg.pb.h>
 #include <vg/io/alignment_io.hpp>
 #include <bdsg/hash_graph.hpp>
 #include "../algorithms/back_translate.hpp"
+#include "../flat_file_back_translation.hpp"
 #include "catch.hpp"
 #include "alignment.hpp"
 
@@ -370,5 +372,64 @@ TEST_CASE("A reverse-strand Alignment can be back-translated while converting to
 
     
 
+
+TEST_CASE("A FlatFileBackTranslation translates single ranges and batches the same way", "[algorithms][back_translate]") {
+
+    // Segment "chr1" of length 10 is chopped into nodes 3, 4, and 5, and
+    // segment 2 keeps its own number. The lines don't need to be in order.
+    stringstream translation_file;
+    translation_file << "T\tchr1\t1\n"
+                     << "K\t1\t8\t0\t5\n"
+                     << "K\t1\t0\t6\t3\n"
+                     << "K\t1\t4\t2\t4\n";
+    FlatFileBackTranslation trans(translation_file);
+    
+    REQUIRE(trans.get_back_graph_node_name(1) == "chr1");
+    REQUIRE(trans.get_back_graph_node_name(2) == "2");
+    
+    vector<oriented_node_range_t> ranges {
+        {3, false, 1, 3},
+        {4, false, 0, 4},
+        {5, false, 0, 2},
+        {2, false, 0, 5},
+        {4, true, 1, 2},
+        {3, true, 0, 4}
+    };
+    vector<oriented_node_range_t> expected {
+        {1, false, 1, 3},
+        {1, false, 4, 4},
+        {1, false, 8, 2},
+        {2, false, 0, 5},
+        {1, true, 3, 2},
+        {1, true, 6, 4}
+    };
+    
+    vector<oriented_node_range_t> translated;
+    trans.translate_back(ranges, translated);
+    REQUIRE(translated == expected);
+    for (size_t i = 0; i < ranges.size(); i++) {
+        REQUIRE(trans.translate_back(ranges[i]) == vector<oriented_node_range_t>{expected[i]});
+    }
+    
+    // A path along the nodes becomes one mapping on the segment
+    string path_string = R"(
+        {
+            "mapping": [
+                {"position": {"node_id": 3, "offset": 1}, "edit": [{"from_length": 3, "to_length": 3}]},
+                {"position": {"node_id": 4}, "edit": [{"from_length": 4, "to_length": 4}]},
+                {"position": {"node_id": 5}, "edit": [{"from_length": 1, "to_length": 1}]}
+            ]
+        }
+    )";
+    Path p;
+    json2pb(p, path_string.c_str(), path_string.size());
+    vg::algorithms::back_translate_in_place(&trans, p);
+    REQUIRE(p.mapping_size() == 1);
+    REQUIRE(p.mapping(0).position().name() == "chr1");
+    REQUIRE(p.mapping(0).position().offset() == 1);
+    REQUIRE(p.mapping(0).edit_size() == 1);
+    REQUIRE(p.mapping(0).edit(0).from_length() == 8);
+}
+
 }
 }
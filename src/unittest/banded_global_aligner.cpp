@@ -3562,11 +3562,74 @@ namespace vg {
             
             aligner.align_global_banded(aln, graph, 1, true);
         }
+        
+        TEST_CASE( "Banded global aligner gives the same alignments with narrow scores as with wide scores",
+                  "[alignment][banded][mapping]" ) {
+            
+            bdsg::HashGraph graph;
+            
+            handle_t h1 = graph.create_handle("ACGTTGCAGTCCAGT");
+            handle_t h2 = graph.create_handle("A");
+            handle_t h3 = graph.create_handle("G");
+            handle_t h4 = graph.create_handle("TTCAGGACTAGCATG");
+            handle_t h5 = graph.create_handle("CCAT");
+            handle_t h6 = graph.create_handle("GATTACAGT");
+            
+            graph.create_edge(h1, h2);
+            graph.create_edge(h1, h3);
+            graph.create_edge(h2, h4);
+            graph.create_edge(h3, h4);
+            graph.create_edge(h4, h5);
+            graph.create_edge(h4, h6);
+            graph.create_edge(h5, h6);
+            
+            TestAligner aligner_source;
+            const Aligner& aligner = *aligner_source.get_regular_aligner();
+            
+            vector<string> reads {
+                "ACGTTGCAGTCCAGTATTCAGGACTAGCATGCCATGATTACAGT",
+                "ACGTTGCAGTCCAGTGTTCAGGACTAGCATGGATTACAGT",
+                "ACGTTGCAGTCCAGTATTCAGCTAGCATGCCATCCGATTACAGT",
+                "ACGTTGCTTTTTTTTTTTTTTTTTAGCATGCCATGATTACAGT",
+                "ACGTTGCAGTCCAGTATTCAGGACTAGGATTACAGT",
+                "TCGTTGCAGTCCAGTATTCAGGACTAGCATGCCATGATTACAGA"
+            };
+            
+            for (const string& read : reads) {
+                for (int band_padding : {2, 8, 20}) {
+                    
+                    Alignment narrow;
+                    narrow.set_sequence(read);
+                    aligner.align_global_banded(narrow, graph, band_padding, true);
+                    
+                    Alignment wide;
+                    wide.set_sequence(read);
+                    BandedGlobalAligner<int32_t> band_graph(wide, graph, band_padding, true);
+                    band_graph.align(aligner.score_matrix, aligner.nt_table, aligner.gap_open, aligner.gap_extension);
+                    
+                    REQUIRE(narrow.score() == wide.score());
+                    REQUIRE(pb2json(narrow.path()) == pb2json(wide.path()));
+                    
+                    // scoring without the traceback gets the same score
+                    REQUIRE(aligner.score_global_banded(narrow, graph, band_padding, true) == narrow.score());
+                    
+                    vector<Alignment> narrow_alts;
+                    Alignment narrow_multi;
+                    narrow_multi.set_sequence(read);
+                    aligner.align_global_banded_multi(narrow_multi, narrow_alts, graph, 5, band_padding, true);
+                    
+                    vector<Alignment> wide_alts;
+                    Alignment wide_multi;
+                    wide_multi.set_sequence(read);
+                    BandedGlobalAligner<int32_t> multi_band_graph(wide_multi, graph, wide_alts, 5, band_padding, true);
+                    multi_band_graph.align(aligner.score_matrix, aligner.nt_table, aligner.gap_open, aligner.gap_extension);
+                    
+                    REQUIRE(narrow_alts.size() == wide_alts.size());
+                    for (size_t i = 0; i < narrow_alts.size(); i++) {
+                        REQUIRE(narrow_alts[i].score() == wide_alts[i].score());
+                    }
+                }
+            }
+        }
     }
 }
-
-
-
-
-
-
@@ -0,0 +1,119 @@
+/// \file unittest/batched_pinned_aligner.cpp
+///
+/// Unit tests for doing batches of pinned alignments at once
+///
+
+#include <iostream>
+#include <string>
+
+#include <vg/vg.pb.h>
+#include "batched_pinned_aligner.hpp"
+#include "path.hpp"
+#include "test_aligner.hpp"
+#include "catch.hpp"
+
+#include <bdsg/hash_graph.hpp>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("Batched pinned alignment finds exact matches", "[aligner][alignment][pinned]") {
+
+    bdsg::HashGraph graph;
+    handle_t h1 = graph.create_handle("AGTG");
+    handle_t h2 = graph.create_handle("C");
+    handle_t h3 = graph.create_handle("A");
+    handle_t h4 = graph.create_handle("TGAAGT");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h1, h3);
+    graph.create_edge(h2, h4);
+    graph.create_edge(h3, h4);
+
+    TestAligner aligner_source;
+    const Aligner& aligner = *aligner_source.get_regular_aligner();
+
+    for (bool pin_left : {false, true}) {
+        Alignment aln;
+        aln.set_sequence("AGTGCTGAAGT");
+        aligner.align_pinned_batch({{&aln, &graph, pin_left}});
+
+        const Path& path = aln.path();
+        REQUIRE(path.mapping_size() == 3);
+        REQUIRE(path.mapping(0).position().node_id() == graph.get_id(h1));
+        REQUIRE(path.mapping(0).position().offset() == 0);
+        REQUIRE(path.mapping(1).position().node_id() == graph.get_id(h2));
+        REQUIRE(path.mapping(2).position().node_id() == graph.get_id(h4));
+        for (size_t i = 0; i < path.mapping_size(); i++) {
+            REQUIRE(path.mapping(i).edit_size() == 1);
+            REQUIRE(path.mapping(i).edit(0).from_length() == path.mapping(i).edit(0).to_length());
+            REQUIRE(path.mapping(i).edit(0).sequence().empty());
+        }
+        REQUIRE(aln.score() == 11 + 5);
+    }
+}
+
+TEST_CASE("Batched pinned alignment gives the same scores as one at a time pinned alignment", "[aligner][alignment][pinned]") {
+
+    bdsg::HashGraph graph;
+    handle_t h1 = graph.create_handle("GATTACACAT");
+    handle_t h2 = graph.create_handle("G");
+    handle_t h3 = graph.create_handle("");
+    handle_t h4 = graph.create_handle("CCAGTTAGACCA");
+    handle_t h5 = graph.create_handle("TTA");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h1, h3);
+    graph.create_edge(h2, h4);
+    graph.create_edge(h3, h4);
+    graph.create_edge(h4, h5);
+
+    vector<string> reads {
+        "GATTACACATGCCAGTTAGACCATTA",
+        "GATTACACATCCAGTTAGACCATTA",
+        "GATTACAGATCCAGTTTTAGACCATTA",
+        "TTACACATGCCAGTTAGACCATT",
+        "CCCCCCCCGATTACACATCCAGTTAGACCA",
+        "CAGTTAGTTA",
+        "TTTTTTTTTT",
+        "A"
+    };
+
+    TestAligner aligner_source;
+    const Aligner& aligner = *aligner_source.get_regular_aligner();
+
+    // enough problems to need more than one batch
+    vector<Alignment> batched;
+    vector<PinnedAlignmentProblem> problems;
+    for (size_t i = 0; i < 2 * reads.size(); i++) {
+        batched.emplace_back();
+        batched.back().set_sequence(reads[i / 2]);
+    }
+    for (size_t i = 0; i < batched.size(); i++) {
+        problems.push_back({&batched[i], &graph, i % 2 == 1});
+    }
+    aligner.align_pinned_batch(problems);
+
+    for (size_t i = 0; i < batched.size(); i++) {
+        Alignment single;
+        single.set_sequence(batched[i].sequence());
+        aligner.align_pinned(single, graph, i % 2 == 1);
+
+        REQUIRE(batched[i].score() == single.score());
+        REQUIRE(path_to_length(batched[i].path()) == (int) batched[i].sequence().size());
+
+        // the pinned end must be at the edge of the graph
+        const Path& path = batched[i].path();
+        if (i % 2 == 1) {
+            REQUIRE(path.mapping(0).position().node_id() == graph.get_id(h1));
+            REQUIRE(path.mapping(0).position().offset() == 0);
+        }
+        else {
+            const Mapping& last = path.mapping(path.mapping_size() - 1);
+            REQUIRE(last.position().node_id() == graph.get_id(h5));
+            REQUIRE(last.position().offset() + mapping_from_length(last) == graph.get_length(h5));
+        }
+    }
+}
+
+}
+}
@@ -152,7 +152,47 @@ TEST_CASE("find_best_chain is willing to leave the main diagonal if the items su
     REQUIRE(result.second == std::vector<size_t>{0, 1, 2, 3});
 }
 
+
+TEST_CASE("find_best_chain gets the same answer with batched transitions", "[chain_items][find_best_chain]") {
+    // Set up graph fixture
+    HashGraph graph = make_long_graph(100, 10);
+    auto h = get_handles(graph);
+    
+    IntegratedSnarlFinder snarl_finder(graph);
+    SnarlDistanceIndex distance_index;
+    fill_in_distance_index(&distance_index, &graph, &snarl_finder);
+
+    // Scatter a lot of items near the main diagonal, with some off it.
+    vector<tuple<size_t, handle_t, size_t, size_t, int>> test_data;
+    uint32_t bits = 0xcafebebe;
+    for (size_t read_pos = 0; read_pos + 10 < 1000; read_pos += 3) {
+        bits = (bits * 73 + 1375) % 477218579;
+        size_t graph_pos = read_pos + (bits % 7) - 3;
+        if (bits % 11 == 0) {
+            // Put this one somewhere else entirely.
+            graph_pos = (graph_pos + 500) % 990;
+        }
+        if (graph_pos >= 990) {
+            continue;
+        }
+        test_data.emplace_back(read_pos, h[graph_pos / 10 + 1], graph_pos % 10, 5, 5 + bits % 3);
+    }
+    auto to_score = make_anchors(test_data, graph);
+    
+    for (size_t hard_cap : {3, 15, 100}) {
+        for (size_t min_items : {0, 1, 10}) {
+            for (size_t max_bases : {20, 100, 1000}) {
+                auto scalar = algorithms::find_best_chain(to_score, distance_index, graph, 6, 1,
+                                                          max_bases, min_items, hard_cap, 10, 2.0, -0.1, 0, 50, false);
+                auto batched = algorithms::find_best_chain(to_score, distance_index, graph, 6, 1,
+                                                           max_bases, min_items, hard_cap, 10, 2.0, -0.1, 0, 50, true);
+                REQUIRE(scalar.first == batched.first);
+                REQUIRE(scalar.second == batched.second);
+            }
+        }
+    }
 }
 
 }
 
+}
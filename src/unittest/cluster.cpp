@@ -429,6 +429,41 @@ namespace unittest {
                                                       make_pos_t(n7->id(), true, 3));
             REQUIRE(dist == std::numeric_limits<int64_t>::max());
         }
+        
+        SECTION("Path coordinates agree with the oriented distances between positions on the path") {
+            
+            measurer.max_walk = 10;
+            vector<pos_t> positions{
+                make_pos_t(n5->id(), false, 2),
+                make_pos_t(n2->id(), false, 1),
+                make_pos_t(n1->id(), false, 3),
+                make_pos_t(n3->id(), true, 0),
+                make_pos_t(n4->id(), true, 0),
+                make_pos_t(n6->id(), true, 2),
+                make_pos_t(n0->id(), true, 1)
+            };
+            
+            vector<vector<pair<int64_t, size_t>>> buckets = measurer.get_coordinate_buckets([&](size_t i) {
+                return positions[i];
+            }, positions.size());
+            
+            // one bucket for each strand of the path, without the position off the path
+            REQUIRE(buckets.size() == 2);
+            size_t num_placed = 0;
+            for (const auto& bucket : buckets) {
+                num_placed += bucket.size();
+                REQUIRE(is_sorted(bucket.begin(), bucket.end()));
+                for (size_t i = 1; i < bucket.size(); i++) {
+                    int64_t dist = measurer.oriented_distance(positions[bucket[i - 1].second],
+                                                              positions[bucket[i].second]);
+                    REQUIRE(dist == bucket[i].first - bucket[i - 1].first);
+                }
+                for (const auto& placed : bucket) {
+                    REQUIRE(placed.second != 2);
+                }
+            }
+            REQUIRE(num_placed == positions.size() - 1);
+        }
     }
 }
 
@@ -0,0 +1,108 @@
+/** \file
+ *
+ * Unit tests for the GAMC columnar alignment container in
+ * columnar_alignments.cpp.
+ */
+
+#include "../columnar_alignments.hpp"
+#include "../utility.hpp"
+#include "vg/io/json2pb.h"
+
+#include "catch.hpp"
+
+#include <fstream>
+
+namespace vg {
+
+namespace unittest {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+std::vector<Alignment> gamc_test_reads() {
+    std::vector<std::string> json {
+        R"({"name": "read1", "sequence": "GATTACA", "quality": "ERERERE=", "score": 7, "mapping_quality": 60,
+            "path": {"mapping": [{"position": {"node_id": 5, "offset": 2}, "edit": [{"from_length": 3, "to_length": 3}], "rank": 1},
+                                 {"position": {"node_id": 6}, "edit": [{"from_length": 1, "to_length": 1, "sequence": "A"}, {"from_length": 3, "to_length": 3}], "rank": 2}]},
+            "identity": 0.5})",
+        R"({"name": "read2", "sequence": "ACGTNNACRYacgt", "score": -3,
+            "path": {"name": "named", "mapping": [{"position": {"node_id": 3, "is_reverse": true}, "edit": [{"from_length": 2, "to_length": 0}, {"from_length": 0, "to_length": 14, "sequence": "ACGTNNACRYacgt"}], "rank": 1}]}})",
+        R"({"name": "unranked", "sequence": "T", "path": {"mapping": [{"position": {"node_id": 1}, "edit": [{"from_length": 1, "to_length": 1}]}]}})",
+        R"({})",
+        R"({"name": "unmapped", "sequence": "CCCCCCCCCCCCCCCCCCCCCCCCCN", "fragment_next": {"name": "mate"}})",
+    };
+    std::vector<Alignment> reads;
+    for (auto& line : json) {
+        reads.emplace_back();
+        json2pb(reads.back(), line.c_str(), line.size());
+    }
+    return reads;
+}
+
+} // anonymous namespace
+
+TEST_CASE("GAMC blocks restore the original reads", "[gamc]") {
+    std::vector<Alignment> reads = gamc_test_reads();
+    std::string buffer;
+    encode_gamc_block(reads, buffer);
+
+    std::vector<Alignment> decoded;
+    decode_gamc_block(buffer, decoded);
+    REQUIRE(decoded.size() == reads.size());
+    for (size_t i = 0; i < reads.size(); i++) {
+        REQUIRE(pb2json(decoded[i]) == pb2json(reads[i]));
+    }
+
+    SECTION("a subset of columns can be decoded") {
+        decode_gamc_block(buffer, decoded, (1u << GAMC_NAMES) | (1u << GAMC_SCORES));
+        REQUIRE(decoded.size() == reads.size());
+        for (size_t i = 0; i < reads.size(); i++) {
+            REQUIRE(decoded[i].name() == reads[i].name());
+            REQUIRE(decoded[i].score() == reads[i].score());
+            REQUIRE(decoded[i].mapping_quality() == reads[i].mapping_quality());
+            REQUIRE(decoded[i].sequence().empty());
+            REQUIRE(decoded[i].path().mapping_size() == 0);
+        }
+    }
+
+    SECTION("empty blocks") {
+        std::string empty_buffer;
+        encode_gamc_block({}, empty_buffer);
+        decode_gamc_block(empty_buffer, decoded);
+        REQUIRE(decoded.empty());
+    }
+
+    SECTION("truncated blocks are rejected") {
+        REQUIRE_THROWS_AS(decode_gamc_block(buffer.substr(0, buffer.size() - 1), decoded), std::runtime_error);
+    }
+}
+
+TEST_CASE("GAMC files can be written and read", "[gamc]") {
+    std::vector<Alignment> reads = gamc_test_reads();
+    std::string filename = temp_file::create();
+    {
+        GAMCAlignmentEmitter emitter(filename, 1);
+        std::vector<Alignment> copy = reads;
+        emitter.emit_singles(std::move(copy));
+    }
+
+    std::ifstream in(filename, std::ios_base::binary);
+    REQUIRE(is_gamc_stream(in));
+    std::vector<Alignment> found;
+    for_each_gamc(in, [&](Alignment& aln) {
+        found.push_back(aln);
+    });
+    REQUIRE(found.size() == reads.size());
+    for (size_t i = 0; i < reads.size(); i++) {
+        REQUIRE(pb2json(found[i]) == pb2json(reads[i]));
+    }
+
+    temp_file::remove(filename);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace unittest
+
+} // namespace vg
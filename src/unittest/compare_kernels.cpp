@@ -0,0 +1,63 @@
+/// \file unittest/compare_kernels.cpp
+///
+/// Unit tests for the builds of the sequence comparison kernels
+///
+
+#include "catch.hpp"
+#include "randomness.hpp"
+#include "../compare_kernels.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("Every build of the comparison kernels this CPU can run agrees with a plain loop", "[gapless_extender][kernels]") {
+
+    vector<const CompareKernels*> builds { &compare_kernels_base, &get_compare_kernels() };
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    if (__builtin_cpu_supports("avx2")) {
+        builds.push_back(&compare_kernels_avx2);
+    }
+#endif
+
+    default_random_engine gen(test_seed_source());
+    uniform_int_distribution<size_t> length_distr(0, 100);
+    uniform_int_distribution<int> base_distr(0, 3);
+
+    for (size_t rep = 0; rep < 1000; ++rep) {
+        // make two sequences that mostly match, so that the mismatches can be
+        // anywhere in the vector blocks
+        size_t len = length_distr(gen);
+        string a, b;
+        for (size_t i = 0; i < len; ++i) {
+            a.push_back("ACGT"[base_distr(gen)]);
+        }
+        b = a;
+        size_t mismatches = rep % 3;
+        for (size_t i = 0; i < mismatches && len > 0; ++i) {
+            size_t offset = uniform_int_distribution<size_t>(0, len - 1)(gen);
+            b[offset] = (b[offset] == 'A' ? 'C' : 'A');
+        }
+
+        size_t prefix = 0;
+        while (prefix < len && a[prefix] == b[prefix]) {
+            ++prefix;
+        }
+        size_t suffix = 0;
+        while (suffix < len && a[len - suffix - 1] == b[len - suffix - 1]) {
+            ++suffix;
+        }
+
+        for (const CompareKernels* build : builds) {
+            REQUIRE(build->common_prefix_length(a.data(), b.data(), len) == prefix);
+            REQUIRE(build->common_suffix_length(a.data() + len, b.data() + len, len) == suffix);
+        }
+    }
+}
+
+}
+}
@@ -40,6 +40,41 @@ TEST_CASE("Component sizes are computed correctly", "[compsize]") {
     
 }
 
+TEST_CASE("Parallel weakly connected components match the serial ones", "[compsize]") {
+    
+    int thread_count_pre = get_thread_count();
+    
+    // a long chain, a few reversing edges, and many singletons, with IDs out of order
+    bdsg::HashGraph graph;
+    vector<handle_t> handles;
+    for (int i = 0; i < 2000; ++i) {
+        handles.push_back(graph.create_handle("A", 1 + (i * 7919) % 2000 * 3));
+    }
+    for (int i = 0; i + 1 < 1000; ++i) {
+        graph.create_edge(handles[i], handles[i + 1]);
+    }
+    for (int i = 1000; i + 10 < 1500; i += 10) {
+        graph.create_edge(handles[i], graph.flip(handles[i + 10]));
+    }
+    
+    auto serial_result = handlealgs::weakly_connected_components(&graph);
+    
+    for (int num_threads : {1, 2, 4, 8}) {
+        omp_set_num_threads(num_threads);
+        auto parallel_result = algorithms::weakly_connected_components_parallel(graph);
+        // components come out in the same order
+        REQUIRE(parallel_result == serial_result);
+        REQUIRE(algorithms::num_components(graph) == serial_result.size());
+        auto comp_sizes = algorithms::component_sizes(graph);
+        REQUIRE(comp_sizes.size() == serial_result.size());
+        for (size_t i = 0; i < comp_sizes.size(); ++i) {
+            REQUIRE(comp_sizes[i] == serial_result[i].size());
+        }
+    }
+    
+    omp_set_num_threads(thread_count_pre);
+}
+
 TEST_CASE("Parallel component paths produces correct results", "[comppathset]") {
     
     
@@ -17,6 +17,8 @@
 
 #include <bdsg/hash_graph.hpp>
 
+#include <omp.h>
+
 namespace vg {
 namespace unittest {
 
@@ -1285,6 +1287,73 @@ GATTACACATTAG
 
 }
 
+TEST_CASE( "Chunks built in parallel are wired up the same as chunks built one at a time", "[constructor]" ) {
+
+    // Make a reference long enough for lots of small chunks, with SNPs and
+    // deletions scattered along it, including some near the chunk boundaries.
+    string reference_sequence;
+    string bases = "ACGT";
+    for (size_t i = 0; i < 2000; i++) {
+        reference_sequence.push_back(bases[(i * 7 + i / 3) % 4]);
+    }
+    stringstream vcf_data;
+    vcf_data << "##fileformat=VCFv4.0" << endl;
+    vcf_data << "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">" << endl;
+    vcf_data << "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT" << endl;
+    for (size_t pos = 5; pos + 3 < reference_sequence.size(); pos += 37) {
+        char ref_base = reference_sequence[pos - 1];
+        char alt_base = bases[(bases.find(ref_base) + 1) % 4];
+        vcf_data << "ref\t" << pos << "\t.\t" << ref_base << "\t" << alt_base << "\t29\tPASS\t.\tGT" << endl;
+        if (pos % 3 == 0) {
+            vcf_data << "ref\t" << pos + 2 << "\t.\t" << reference_sequence.substr(pos + 1, 3) << "\t"
+                     << reference_sequence[pos + 1] << "\t29\tPASS\t.\tGT" << endl;
+        }
+    }
+    
+    string fasta_filename = temp_file::create();
+    {
+        ofstream fasta_stream(fasta_filename);
+        fasta_stream << ">ref" << endl << reference_sequence << endl;
+    }
+    
+    // Build the whole graph with the given number of threads, and give back
+    // the chunks in the order they were emitted.
+    auto build = [&](int threads) {
+        std::stringstream vcf_stream(vcf_data.str());
+        vcflib::VariantCallFile vcf;
+        vcf.open(vcf_stream);
+        vector<vcflib::VariantCallFile*> vcf_pointers {&vcf};
+        
+        FastaReference reference;
+        reference.open(fasta_filename);
+        vector<FastaReference*> fasta_pointers {&reference};
+        vector<FastaReference*> ins_pointers;
+        
+        Constructor constructor;
+        constructor.alt_paths = true;
+        constructor.max_node_size = 20;
+        constructor.bases_per_chunk = 50;
+        constructor.vars_per_chunk = 2;
+        
+        vector<string> emitted;
+        int old_threads = get_thread_count();
+        omp_set_num_threads(threads);
+        constructor.construct_graph(fasta_pointers, vcf_pointers, ins_pointers, [&](Graph& constructed) {
+            emitted.push_back(pb2json(constructed));
+        });
+        omp_set_num_threads(old_threads);
+        return emitted;
+    };
+    
+    auto serial = build(1);
+    auto parallel = build(4);
+    
+    REQUIRE(serial.size() > 10);
+    REQUIRE(parallel == serial);
+    
+    temp_file::remove(fasta_filename);
+}
+
 TEST_CASE( "Non-left-shifted variants can be used to construct valid graphs", "[constructor]" ) {
 
     auto vcf_data = R"(##fileformat=VCFv4.0
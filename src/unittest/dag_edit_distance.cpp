@@ -0,0 +1,149 @@
+/// \file dag_edit_distance.cpp
+///  
+/// Unit tests for the bit-parallel DAG edit distance
+///
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include "../algorithms/dag_edit_distance.hpp"
+#include "../handle.hpp"
+#include "randomness.hpp"
+#include "catch.hpp"
+
+#include <bdsg/hash_graph.hpp>
+
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+using bdsg::HashGraph;
+
+/// The slow quadratic DP that dag_edit_distance should agree with
+static vector<size_t> dag_edit_distance_slow(const HandleGraph& graph, const vector<handle_t>& order,
+                                             const string& query) {
+    size_t m = query.size();
+    vector<vector<size_t>> end_columns(order.size());
+    vector<size_t> best(order.size(), m);
+    for (size_t i = 0; i < order.size(); i++) {
+        vector<size_t> column(m + 1);
+        for (size_t k = 0; k <= m; k++) {
+            column[k] = k;
+        }
+        bool first = true;
+        for (size_t j = 0; j < i; j++) {
+            if (graph.has_edge(order[j], order[i])) {
+                if (first) {
+                    column = end_columns[j];
+                    first = false;
+                } else {
+                    for (size_t k = 0; k <= m; k++) {
+                        column[k] = min(column[k], end_columns[j][k]);
+                    }
+                }
+            }
+        }
+        for (char c : graph.get_sequence(order[i])) {
+            vector<size_t> next(m + 1);
+            next[0] = 0;
+            for (size_t k = 1; k <= m; k++) {
+                bool match = (c == query[k - 1]) && c != 'N';
+                next[k] = min({column[k - 1] + (match ? 0 : 1), column[k] + 1, next[k - 1] + 1});
+            }
+            column = next;
+            best[i] = min(best[i], column[m]);
+        }
+        end_columns[i] = column;
+    }
+    return best;
+}
+
+TEST_CASE("DAG edit distance finds exact and approximate matches", "[dag_edit_distance][algorithms]") {
+    
+    HashGraph graph;
+    
+    handle_t start = graph.create_handle("GATTACA");
+    handle_t snp1 = graph.create_handle("C");
+    handle_t snp2 = graph.create_handle("T");
+    handle_t end = graph.create_handle("CATTAG");
+    
+    graph.create_edge(start, snp1);
+    graph.create_edge(start, snp2);
+    graph.create_edge(snp1, end);
+    graph.create_edge(snp2, end);
+    
+    vector<handle_t> order {start, snp1, snp2, end};
+    
+    SECTION("A match across the bubble is found on the right branch") {
+        auto distances = algorithms::dag_edit_distance(graph, order, "TACATCATT");
+        REQUIRE(distances[3] == 0);
+        // It doesn't end in the other nodes
+        REQUIRE(distances[0] > 0);
+    }
+    
+    SECTION("A mismatch costs one edit") {
+        auto distances = algorithms::dag_edit_distance(graph, order, "TACAGCATT");
+        REQUIRE(distances[3] == 1);
+    }
+    
+    SECTION("A query that is not there is far away") {
+        auto distances = algorithms::dag_edit_distance(graph, order, "GGGGGGGG");
+        for (size_t distance : distances) {
+            REQUIRE(distance >= 6);
+        }
+    }
+}
+
+TEST_CASE("DAG edit distance agrees with the DP on random DAGs", "[dag_edit_distance][algorithms]") {
+    
+    default_random_engine gen(test_seed_source());
+    uniform_int_distribution<int> base_distr(0, 4);
+    uniform_int_distribution<size_t> length_distr(1, 20);
+    const string bases = "ACGTN";
+    
+    for (size_t rep = 0; rep < 20; rep++) {
+        HashGraph graph;
+        vector<handle_t> order;
+        string backbone;
+        for (size_t i = 0; i < 30; i++) {
+            string seq;
+            for (size_t j = length_distr(gen); j > 0; j--) {
+                seq.push_back(bases[base_distr(gen) % 4]);
+            }
+            backbone += seq;
+            order.push_back(graph.create_handle(seq));
+            // Connect to a few earlier nodes, so there are merges
+            for (size_t back : {1, 2, 5}) {
+                if (i >= back && (back == 1 || gen() % 3 == 0)) {
+                    graph.create_edge(order[i - back], order[i]);
+                }
+            }
+        }
+        
+        // Queries across the word boundary, taken from the backbone with
+        // some errors, and some that are random
+        for (size_t length : {10, 63, 64, 65, 150}) {
+            string query;
+            if (length < backbone.size() && rep % 2 == 0) {
+                size_t start = gen() % (backbone.size() - length);
+                query = backbone.substr(start, length);
+                for (size_t j = 0; j < length / 10; j++) {
+                    query[gen() % length] = bases[base_distr(gen)];
+                }
+            } else {
+                for (size_t j = 0; j < length; j++) {
+                    query.push_back(bases[base_distr(gen)]);
+                }
+            }
+            
+            auto fast = algorithms::dag_edit_distance(graph, order, query);
+            auto slow = dag_edit_distance_slow(graph, order, query);
+            REQUIRE(fast == slow);
+        }
+    }
+}
+
+}
+}
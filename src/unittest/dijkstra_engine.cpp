@@ -0,0 +1,99 @@
+/// \file unittest/dijkstra_engine.cpp
+///
+/// Unit tests for the RadixHeap and the DijkstraEngine
+///
+
+#include "catch.hpp"
+#include "randomness.hpp"
+#include "algorithms/dijkstra_engine.hpp"
+
+#include <limits>
+#include <map>
+#include <queue>
+#include <random>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("RadixHeap pops keys in order", "[dijkstra][algorithms]") {
+
+    default_random_engine gen(test_seed_source());
+    uniform_int_distribution<int64_t> key_distr(-1000, 1000);
+
+    algorithms::RadixHeap<size_t> heap;
+    priority_queue<int64_t, vector<int64_t>, greater<int64_t>> truth;
+
+    for (size_t rep = 0; rep < 10; ++rep) {
+        // keys can go below the last key popped, and to the limits
+        for (size_t i = 0; i < 2000; ++i) {
+            if (truth.empty() || i % 3 != 0) {
+                int64_t key = key_distr(gen);
+                if (i % 97 == 0) {
+                    key = (i % 2 == 0) ? numeric_limits<int64_t>::min() : numeric_limits<int64_t>::max();
+                }
+                heap.push(key, i);
+                truth.push(key);
+            }
+            else {
+                REQUIRE(!heap.empty());
+                REQUIRE(heap.top().first == truth.top());
+                heap.pop();
+                truth.pop();
+            }
+        }
+        while (!truth.empty()) {
+            REQUIRE(heap.top().first == truth.top());
+            heap.pop();
+            truth.pop();
+        }
+        REQUIRE(heap.empty());
+        heap.clear();
+    }
+}
+
+TEST_CASE("DijkstraEngine pops each handle once at its smallest distance", "[dijkstra][algorithms]") {
+
+    default_random_engine gen(test_seed_source());
+    // enough handles to grow the record table
+    uniform_int_distribution<uint64_t> handle_distr(0, 5000);
+    uniform_int_distribution<int64_t> dist_distr(0, 10000);
+
+    for (size_t rep = 0; rep < 3; ++rep) {
+        // the same engine is reused for each search
+        algorithms::DijkstraEngine& engine = algorithms::DijkstraEngine::for_this_thread();
+
+        map<uint64_t, int64_t> best;
+        map<uint64_t, bool> finished;
+        for (size_t i = 0; i < 20000; ++i) {
+            if (i % 2 == 0 || engine.empty()) {
+                uint64_t key = handle_distr(gen);
+                int64_t dist = dist_distr(gen);
+                engine.push_or_reprioritize(as_handle(key), dist);
+                if (!finished[key] && (!best.count(key) || best[key] > dist)) {
+                    best[key] = dist;
+                }
+            }
+            else {
+                int64_t closest = numeric_limits<int64_t>::max();
+                for (auto& entry : best) {
+                    if (!finished[entry.first]) {
+                        closest = min(closest, entry.second);
+                    }
+                }
+                auto top = engine.top();
+                uint64_t key = as_integer(top.first);
+                REQUIRE(top.second == closest);
+                REQUIRE(best.at(key) == closest);
+                REQUIRE(!finished[key]);
+                REQUIRE(!engine.is_finished(top.first));
+                engine.pop();
+                finished[key] = true;
+                REQUIRE(engine.is_finished(top.first));
+            }
+        }
+    }
+}
+
+}
+}
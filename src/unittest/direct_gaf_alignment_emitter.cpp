@@ -0,0 +1,150 @@
+/// \file direct_gaf_alignment_emitter.cpp
+///  
+/// unit tests for writing GAF directly from Alignments
+///
+
+#include <iostream>
+#include <string>
+#include "vg/io/json2pb.h"
+#include <vg/vg.pb.h>
+#include <bdsg/hash_graph.hpp>
+#include "../direct_gaf_alignment_emitter.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("GAF lines can be formatted directly from Alignments", "[gaf][alignment_emitter]") {
+
+    bdsg::HashGraph g;
+    
+    handle_t h1 = g.create_handle("G");
+    handle_t h2 = g.create_handle("GGGG");
+    handle_t h3 = g.create_handle("AT");
+    handle_t h4 = g.create_handle("ACACAAA");
+    handle_t h5 = g.create_handle("A");
+    
+    g.create_edge(h1, h2);
+    g.create_edge(h2, h3);
+    g.create_edge(h3, h4);
+    g.create_edge(h4, h5);
+
+    SECTION("An Alignment with all kinds of edits produces the same GAF as the general converter") {
+        string alignment_string = R"(
+            {
+                "name": "francine",
+                "mapping_quality": 30,
+                "sequence": "GATTACA",
+                "path": {"mapping": [
+                    {
+                        "position": {"node_id": 2, "offset": 2},
+                        "edit": [
+                            {"from_length": 1, "to_length": 1},
+                            {"from_length": 1}
+                        ]
+                    },
+                    {
+                        "position": {"node_id": 3},
+                        "edit": [
+                            {"from_length": 1, "to_length": 1},
+                            {"to_length": 1, "sequence": "T"},
+                            {"from_length": 1, "to_length": 1}
+                        ]
+                    },
+                    {
+                        "position": {"node_id": 4},
+                        "edit": [
+                            {"from_length": 1, "to_length": 1},
+                            {"from_length": 2},
+                            {"from_length": 2, "to_length": 2}
+                        ]
+                    }
+                ]}
+            }
+        )";
+        
+        Alignment a;
+        json2pb(a, alignment_string.c_str(), alignment_string.size());
+
+        string line;
+        DirectGAFAlignmentEmitter::append_gaf_line(g, a, line);
+        REQUIRE(line == "francine\t7\t0\t7\t+\t>2>3>4\t13\t2\t11\t6\t9\t30\tcs:Z::1-G:1+T:2-CA:2\n");
+    }
+
+    SECTION("Soft clips, substitutions, and tags are handled") {
+        string alignment_string = R"(
+            {
+                "name": "fred",
+                "mapping_quality": 60,
+                "score": 12,
+                "sequence": "CGGAGTA",
+                "fragment_next": {"name": "fred2"},
+                "path": {"mapping": [
+                    {
+                        "position": {"node_id": 2, "offset": 1},
+                        "edit": [
+                            {"to_length": 1, "sequence": "C"},
+                            {"from_length": 2, "to_length": 2},
+                            {"from_length": 1, "to_length": 1, "sequence": "A"}
+                        ]
+                    },
+                    {
+                        "position": {"node_id": 3},
+                        "edit": [
+                            {"from_length": 1, "to_length": 1, "sequence": "G"},
+                            {"from_length": 1, "to_length": 1},
+                            {"to_length": 1, "sequence": "A"}
+                        ]
+                    }
+                ]}
+            }
+        )";
+
+        Alignment a;
+        json2pb(a, alignment_string.c_str(), alignment_string.size());
+
+        string line;
+        DirectGAFAlignmentEmitter::append_gaf_line(g, a, line);
+        REQUIRE(line == "fred\t7\t1\t6\t+\t>2>3\t6\t1\t6\t3\t5\t60\tcs:Z::2*GA*AG:1\tAS:i:12\tfn:Z:fred2\n");
+    }
+
+    SECTION("Consecutive mappings on the same node are merged into one visit") {
+        string alignment_string = R"(
+            {
+                "name": "frank",
+                "sequence": "CACA",
+                "path": {"mapping": [
+                    {
+                        "position": {"node_id": 4, "offset": 1},
+                        "edit": [{"from_length": 2, "to_length": 2}]
+                    },
+                    {
+                        "position": {"node_id": 4, "offset": 3},
+                        "edit": [{"from_length": 2, "to_length": 2}]
+                    }
+                ]}
+            }
+        )";
+
+        Alignment a;
+        json2pb(a, alignment_string.c_str(), alignment_string.size());
+
+        string line;
+        DirectGAFAlignmentEmitter::append_gaf_line(g, a, line);
+        REQUIRE(line == "frank\t4\t0\t4\t+\t>4\t7\t1\t5\t4\t4\t0\tcs:Z::4\n");
+    }
+
+    SECTION("An unmapped Alignment gets placeholders") {
+        Alignment a;
+        a.set_name("felix");
+        a.set_sequence("GATTACA");
+
+        string line;
+        DirectGAFAlignmentEmitter::append_gaf_line(g, a, line);
+        REQUIRE(line == "felix\t7\t*\t*\t*\t*\t*\t*\t*\t0\t0\t0\n");
+    }
+}
+
+}
+}
@@ -0,0 +1,90 @@
+/// \file distance_cache.cpp
+///  
+/// unit tests for the per-read distance query cache
+///
+
+#include <iostream>
+#include <random>
+#include "bdsg/hash_graph.hpp"
+#include "catch.hpp"
+#include "random_graph.hpp"
+#include "../distance_cache.hpp"
+#include "../integrated_snarl_finder.hpp"
+#include "../snarl_seed_clusterer.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("DistanceCache gives the same answers as the distance index", "[distance_cache]") {
+
+    for (size_t graph_number = 0; graph_number < 5; graph_number++) {
+        default_random_engine generator(graph_number);
+        
+        HashGraph graph;
+        random_graph(500, 20, 30, &graph);
+        
+        IntegratedSnarlFinder snarl_finder(graph);
+        SnarlDistanceIndex distance_index;
+        fill_in_distance_index(&distance_index, &graph, &snarl_finder);
+        
+        vector<nid_t> all_nodes;
+        graph.for_each_handle([&](const handle_t& h) {
+            all_nodes.push_back(graph.get_id(h));
+        });
+        uniform_int_distribution<size_t> node_index(0, all_nodes.size() - 1);
+        
+        // Pick some positions to look between
+        vector<pos_t> positions;
+        for (size_t i = 0; i < 20; i++) {
+            nid_t node = all_nodes[node_index(generator)];
+            size_t node_length = graph.get_length(graph.get_handle(node));
+            positions.push_back(make_pos_t(node, generator() % 2, generator() % node_length));
+        }
+        
+        DistanceCache cache;
+        
+        {
+            // Position distances should match
+            for (size_t pass = 0; pass < 2; pass++) {
+                for (auto& from : positions) {
+                    for (auto& to : positions) {
+                        size_t expected = minimum_distance(distance_index, from, to, false, &graph);
+                        REQUIRE(cache.minimum_distance(distance_index, from, to, &graph) == expected);
+                    }
+                }
+            }
+            // Everything on the second pass was a hit
+            REQUIRE(cache.hits() >= positions.size() * positions.size());
+            REQUIRE(cache.misses() <= positions.size() * positions.size());
+            
+            cache.clear();
+            REQUIRE(cache.hits() == 0);
+            REQUIRE(cache.misses() == 0);
+        }
+        
+        {
+            // Clustering with a cache should match clustering without one
+            vector<SnarlDistanceIndexClusterer::Seed> seeds;
+            for (auto& pos : positions) {
+                seeds.push_back({pos, 0});
+            }
+            SnarlDistanceIndexClusterer clusterer(distance_index, &graph);
+            
+            for (size_t limit : {5, 20, 100}) {
+                auto uncached = clusterer.cluster_seeds(seeds, limit);
+                // Do it twice through the cache, so the second time hits.
+                for (size_t pass = 0; pass < 2; pass++) {
+                    auto cached = clusterer.cluster_seeds(seeds, limit, &cache);
+                    REQUIRE(cached.size() == uncached.size());
+                    for (size_t i = 0; i < cached.size(); i++) {
+                        REQUIRE(cached[i].seeds == uncached[i].seeds);
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
+}
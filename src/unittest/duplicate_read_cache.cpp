@@ -0,0 +1,76 @@
+/// \file unittest/duplicate_read_cache.cpp
+///
+/// Unit tests for the cache of mapping results by read content
+///
+
+#include "catch.hpp"
+#include "../duplicate_read_cache.hpp"
+
+#include <omp.h>
+#include <vector>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("DuplicateReadCache remembers results", "[duplicate_read_cache]") {
+
+    DuplicateReadCache<vector<int>> cache;
+    vector<int> result;
+
+    REQUIRE(!cache.lookup("GATTACA\tIIIIIII", result));
+    cache.insert("GATTACA\tIIIIIII", {1, 2, 3}, 1000);
+    REQUIRE(cache.lookup("GATTACA\tIIIIIII", result));
+    REQUIRE(result == vector<int>({1, 2, 3}));
+
+    // Different qualities make a different read
+    REQUIRE(!cache.lookup("GATTACA\tIIIII##", result));
+
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(cache.misses() == 2);
+
+    SECTION("Inserting again keeps the first result") {
+        cache.insert("GATTACA\tIIIIIII", {4}, 1000);
+        REQUIRE(cache.lookup("GATTACA\tIIIIIII", result));
+        REQUIRE(result == vector<int>({1, 2, 3}));
+    }
+
+    SECTION("Clearing forgets results and counts") {
+        cache.clear();
+        REQUIRE(cache.hits() == 0);
+        REQUIRE(cache.misses() == 0);
+        REQUIRE(!cache.lookup("GATTACA\tIIIIIII", result));
+    }
+}
+
+TEST_CASE("DuplicateReadCache stays bounded", "[duplicate_read_cache]") {
+
+    DuplicateReadCache<size_t> cache;
+    size_t max_entries = 256;
+    size_t inserted = 10000;
+
+    #pragma omp parallel for
+    for (size_t i = 0; i < inserted; i++) {
+        cache.insert(to_string(i), i, max_entries);
+    }
+
+    size_t found = 0;
+    for (size_t i = 0; i < inserted; i++) {
+        size_t result;
+        if (cache.lookup(to_string(i), result)) {
+            REQUIRE(result == i);
+            found++;
+        }
+    }
+    REQUIRE(found > 0);
+    REQUIRE(found <= max_entries);
+
+    // The most recent reads are still there.
+    size_t result;
+    cache.insert("last", inserted, max_entries);
+    REQUIRE(cache.lookup("last", result));
+    REQUIRE(result == inserted);
+}
+
+}
+}
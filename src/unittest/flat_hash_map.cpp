@@ -0,0 +1,101 @@
+/// \file flat_hash_map.cpp
+///
+/// unit tests for the open-addressing flat hash tables
+///
+
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include "catch.hpp"
+#include "../hash_map.hpp"
+#include "../types.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("flat_hash_map agrees with unordered_map", "[flat_hash_map]") {
+
+    flat_hash_map<id_t, size_t> table;
+    unordered_map<id_t, size_t> truth;
+    
+    REQUIRE(table.empty());
+    REQUIRE(table.find(1) == table.end());
+    REQUIRE(table.erase(1) == 0);
+    
+    // Use few enough keys that they collide a lot and slots get reused after
+    // being erased.
+    default_random_engine generator(8675309);
+    uniform_int_distribution<id_t> key_distribution(1, 1000);
+    uniform_int_distribution<int> operation_distribution(0, 2);
+    for (size_t i = 0; i < 20000; i++) {
+        id_t key = key_distribution(generator);
+        switch (operation_distribution(generator)) {
+        case 0:
+            table[key] += i;
+            truth[key] += i;
+            break;
+        case 1:
+            REQUIRE(table.erase(key) == truth.erase(key));
+            break;
+        default:
+            REQUIRE(table.count(key) == truth.count(key));
+            if (truth.count(key)) {
+                REQUIRE(table.at(key) == truth.at(key));
+            }
+        }
+        REQUIRE(table.size() == truth.size());
+    }
+    
+    SECTION("Iteration visits everything once") {
+        size_t visited = 0;
+        for (auto& item : table) {
+            REQUIRE(truth.at(item.first) == item.second);
+            visited++;
+        }
+        REQUIRE(visited == truth.size());
+    }
+    
+    SECTION("Copies and moves keep everything") {
+        flat_hash_map<id_t, size_t> copy = table;
+        flat_hash_map<id_t, size_t> moved = std::move(copy);
+        REQUIRE(moved.size() == truth.size());
+        for (auto& item : truth) {
+            REQUIRE(moved.at(item.first) == item.second);
+        }
+    }
+    
+    SECTION("Erasing while iterating empties the table") {
+        for (auto it = table.begin(); it != table.end(); ) {
+            it = table.erase(it);
+        }
+        REQUIRE(table.empty());
+        REQUIRE(table.begin() == table.end());
+    }
+    
+    SECTION("Inserting does not replace values") {
+        table.clear();
+        REQUIRE(table.insert(make_pair(5, 1)).second);
+        REQUIRE(!table.emplace(5, 2).second);
+        REQUIRE(!table.try_emplace(5, 3).second);
+        REQUIRE(table.at(5) == 1);
+        REQUIRE_THROWS(table.at(6));
+    }
+}
+
+TEST_CASE("flat_hash_set can hold positions", "[flat_hash_map]") {
+
+    flat_hash_set<pos_t> positions;
+    positions.reserve(100);
+    for (id_t id = 1; id <= 100; id++) {
+        REQUIRE(positions.emplace(id, id % 2 == 0, id * 3).second);
+    }
+    REQUIRE(positions.size() == 100);
+    REQUIRE(!positions.insert(make_pos_t(2, true, 6)).second);
+    REQUIRE(positions.count(make_pos_t(2, true, 6)) == 1);
+    REQUIRE(positions.count(make_pos_t(2, false, 6)) == 0);
+    REQUIRE(positions.count(make_pos_t(2, true, 7)) == 0);
+}
+
+}
+}
@@ -0,0 +1,165 @@
+/** \file
+ *
+ * Unit tests for GAFSorter, which sorts GAF files by node ID into indexed
+ * BGZF files.
+ */
+
+#include "../gaf_sorter.hpp"
+#include "../utility.hpp"
+
+#include "catch.hpp"
+
+#include <fstream>
+
+namespace vg {
+
+namespace unittest {
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+std::string gaf_line(const std::string& name, const std::string& path, size_t path_start) {
+    return name + "\t10\t0\t10\t+\t" + path + "\t100\t" + std::to_string(path_start) + "\t"
+        + std::to_string(path_start + 10) + "\t10\t10\t60";
+}
+
+} // anonymous namespace
+
+TEST_CASE("GAF sort keys", "[gaf][gamsort]") {
+    SECTION("forward path") {
+        GAFSortKey key = gaf_sort_key(gaf_line("read", ">3>4>7", 5));
+        REQUIRE(key.min_id == 3);
+        REQUIRE(key.max_id == 7);
+        REQUIRE(key.offset == 5);
+    }
+
+    SECTION("minimum node is not the first node") {
+        GAFSortKey key = gaf_sort_key(gaf_line("read", "<12<11<2", 5));
+        REQUIRE(key.min_id == 2);
+        REQUIRE(key.max_id == 12);
+        REQUIRE(key.offset == 0);
+    }
+
+    SECTION("unmapped read") {
+        GAFSortKey key = gaf_sort_key("read\t10\t*\t*\t*\t*\t*\t*\t*\t*\t*\t255");
+        REQUIRE(key.min_id == 0);
+        REQUIRE(key.max_id == 0);
+    }
+}
+
+TEST_CASE("GAF record views", "[gaf][gamsort]") {
+    SECTION("mandatory fields and tags") {
+        std::string line = gaf_line("read", ">3<4>7", 5) + "\tAS:i:10\tcs:Z::10";
+        GAFRecordView record;
+        REQUIRE(record.split(line));
+        REQUIRE(record.fields[0].str() == "read");
+        REQUIRE(record.fields[5].str() == ">3<4>7");
+        REQUIRE(record.fields[11].str() == "60");
+        int64_t offset;
+        REQUIRE(record.fields[7].to_int(offset));
+        REQUIRE(offset == 5);
+
+        GAFRecordView::Field value;
+        REQUIRE(record.find_tag("cs", value));
+        REQUIRE(value.str() == ":10");
+        REQUIRE(record.find_tag("AS", value));
+        REQUIRE(value.str() == "10");
+        REQUIRE(!record.find_tag("cg", value));
+
+        std::vector<std::pair<id_t, bool>> nodes;
+        record.for_each_node([&](id_t id, bool is_reverse) {
+            nodes.emplace_back(id, is_reverse);
+            return true;
+        });
+        std::vector<std::pair<id_t, bool>> truth { { 3, false }, { 4, true }, { 7, false } };
+        REQUIRE(nodes == truth);
+    }
+
+    SECTION("no tags") {
+        GAFRecordView record;
+        REQUIRE(record.split(gaf_line("read", ">1", 0)));
+        REQUIRE(record.tags.empty());
+        GAFRecordView::Field value;
+        REQUIRE(!record.find_tag("cs", value));
+    }
+
+    SECTION("header and truncated lines") {
+        GAFRecordView record;
+        REQUIRE(!record.split("@HD\tVN:Z:1.0"));
+        REQUIRE(record.fields[0].empty());
+        REQUIRE(!record.split("read\t10\t0"));
+        REQUIRE(record.fields[2].str() == "0");
+        REQUIRE(record.fields[5].empty());
+    }
+}
+
+TEST_CASE("GAFSorter sorts and indexes GAF lines", "[gaf][gamsort]") {
+    std::vector<std::string> lines {
+        gaf_line("a", ">5>6", 0),
+        gaf_line("b", ">1>2", 3),
+        gaf_line("c", ">20>21", 0),
+        gaf_line("d", "<6<5", 1),
+        gaf_line("e", ">1>2>3", 1),
+        gaf_line("f", ">5>6", 0),
+    };
+    std::string input = temp_file::create();
+    {
+        std::ofstream out(input);
+        for (auto& line : lines) {
+            out << line << "\n";
+        }
+    }
+
+    std::string output = temp_file::create();
+    GAFIndex index;
+    GAFSorter sorter;
+    sorter.max_buf_size = 3 * lines.front().length();
+    sorter.group_size = 2;
+    sorter.sort(input, output, &index);
+
+    // Read the sorted file.
+    std::vector<std::string> sorted;
+    {
+        BGZF* file = bgzf_open(output.c_str(), "r");
+        REQUIRE(file != nullptr);
+        kstring_t buffer = { 0, 0, nullptr };
+        while (bgzf_getline(file, '\n', &buffer) >= 0) {
+            sorted.emplace_back(buffer.s, buffer.l);
+        }
+        free(buffer.s);
+        bgzf_close(file);
+    }
+
+    SECTION("lines are sorted by node and offset, keeping the input order for ties") {
+        std::vector<std::string> truth { lines[4], lines[1], lines[0], lines[3], lines[5], lines[2] };
+        REQUIRE(sorted == truth);
+    }
+
+    SECTION("node ranges can be queried") {
+        BGZF* file = bgzf_open(output.c_str(), "r");
+        REQUIRE(file != nullptr);
+        std::vector<std::string> found;
+        find_gaf(file, index, 6, 6, [&](const std::string& line) {
+            found.push_back(line);
+        });
+        std::vector<std::string> truth { lines[0], lines[3], lines[5] };
+        REQUIRE(found == truth);
+
+        found.clear();
+        find_gaf(file, index, 8, 19, [&](const std::string& line) {
+            found.push_back(line);
+        });
+        REQUIRE(found.empty());
+        bgzf_close(file);
+    }
+
+    temp_file::remove(input);
+    temp_file::remove(output);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace unittest
+
+} // namespace vg
@@ -1136,6 +1136,49 @@ TEST_CASE("Non-ACGT characters do not match", "[gapless_extender]") {
 
 //------------------------------------------------------------------------------
 
+TEST_CASE("Gapless extensions can share a cache", "[gapless_extender]") {
+
+    // Build a GBWT with three threads including a duplicate.
+    gbwt::GBWT gbwt_index = build_gbwt_index();
+
+    // Build a GBWT-backed graph.
+    gbwtgraph::GBWTGraph gbwt_graph = build_gbwt_graph(gbwt_index);
+
+    // And finally wrap it in a GaplessExtender with an Aligner.
+    Aligner aligner;
+    GaplessExtender extender(gbwt_graph, aligner);
+
+    std::vector<std::vector<std::pair<pos_t, size_t>>> clusters {
+        { { make_pos_t(4, false, 2), 0 }, { make_pos_t(6, false, 0), 2 } },
+        { { make_pos_t(5, false, 0), 4 }, { make_pos_t(4, false, 2), 3 } }
+    };
+    std::vector<std::string> reads { "GTACA", "GGAGTAC" };
+
+    // Use a cache small enough that it has to be emptied.
+    GaplessExtensionCache extension_cache(gbwt_graph, 1);
+    for (size_t round = 0; round < 2; round++) {
+        for (size_t i = 0; i < clusters.size(); i++) {
+            GaplessExtender::cluster_type cluster;
+            for (auto seed : clusters[i]) {
+                cluster.insert(GaplessExtender::to_seed(seed.first, seed.second));
+            }
+            GaplessExtender::cluster_type cluster_copy = cluster;
+            auto fresh = extender.extend(cluster, reads[i]);
+            auto shared = extender.extend(cluster_copy, reads[i], extension_cache.get());
+            REQUIRE(shared.size() == fresh.size());
+            for (size_t j = 0; j < fresh.size(); j++) {
+                REQUIRE(shared[j] == fresh[j]);
+            }
+        }
+    }
+
+    REQUIRE(extension_cache.uses() == 4);
+    REQUIRE(extension_cache.records_decoded() > 0);
+    REQUIRE(extension_cache.flushes() > 0);
+}
+
+//------------------------------------------------------------------------------
+
 TEST_CASE("Gapless extensions can be converted to WFAAlignments and joined", "[wfa_alignment]") {
 
     // Build a GBWT with three threads including a duplicate.
@@ -1823,6 +1866,50 @@ TEST_CASE("Gaps in a linear graph", "[wfa_extender]") {
 
 //------------------------------------------------------------------------------
 
+TEST_CASE("Bit-parallel matching agrees with base-by-base matching", "[wfa_extender]") {
+    // Use nodes long enough for whole vectors of bases.
+    std::vector<gbwt::vector_type> paths;
+    paths.emplace_back();
+    gbwtgraph::SequenceSource source;
+    std::vector<std::string> node_sequences {
+        "GATTACACATTAGACAGGATTACACATTAGACAGGATTAC",
+        "CAGACCATTGATTACAGATTTAGGACCATTAGATTACAGA",
+        "TTAGACAGGGATTACAGGATACACAGATTACATTAGACCA"
+    };
+    for (size_t i = 0; i < node_sequences.size(); i++) {
+        paths.back().push_back(gbwt::Node::encode(i + 1, false));
+        source.add_node(i + 1, node_sequences[i]);
+    }
+    gbwt::GBWT index = get_gbwt(paths);
+    gbwtgraph::GBWTGraph graph(index, source);
+    Aligner aligner;
+    WFAExtender extender(graph, aligner);
+
+    pos_t from(1, false, 2); pos_t to(3, false, 30);
+    std::string exact = node_sequences[0].substr(3) + node_sequences[1] + node_sequences[2].substr(0, 30);
+    std::vector<std::string> sequences { exact, exact, exact };
+    // A mismatch in the middle of a node.
+    sequences[1][20] = (sequences[1][20] == 'A' ? 'C' : 'A');
+    // A deletion and a mismatch, crossing node boundaries.
+    sequences[2].erase(40, 2);
+    sequences[2][70] = (sequences[2][70] == 'A' ? 'C' : 'A');
+
+    for (auto& sequence : sequences) {
+        extender.bit_parallel = false;
+        WFAAlignment slow = extender.connect(sequence, from, to);
+        extender.bit_parallel = true;
+        WFAAlignment fast = extender.connect(sequence, from, to);
+        REQUIRE(slow);
+        REQUIRE(fast);
+        REQUIRE(fast.score == slow.score);
+        REQUIRE(fast.edits == slow.edits);
+        REQUIRE(fast.path == slow.path);
+        check_alignment(fast, sequence, graph, aligner, &from, &to);
+    }
+}
+
+//------------------------------------------------------------------------------
+
 TEST_CASE("Special cases in a linear graph", "[wfa_extender]") {
     // Create the structures for graph 1: CGC, 2: GATTACA, 3: GATTA, 4: TAT
     gbwt::GBWT index = wfa_linear_gbwt();
@@ -2642,6 +2729,88 @@ TEST_CASE("WFAAlignment can be converted to Path", "[wfa_alignment]") {
 
 //------------------------------------------------------------------------------
 
+TEST_CASE("PreparedRead masks and encodes a read", "[gapless_extender][wfa_extender]") {
+    PreparedRead read;
+    read.prepare("GATNTACAx");
+
+    REQUIRE(read.size() == 9);
+    REQUIRE(read.forward() == "GATXTACAX");
+    REQUIRE(read.reverse() == "XTGTAXATC");
+    std::string bases("ACGT");
+    for (size_t i = 0; i < read.size(); i++) {
+        if (read.forward()[i] == 'X') {
+            REQUIRE(!read.is_valid(i));
+            REQUIRE(read.code(i) == 0);
+        } else {
+            REQUIRE(read.is_valid(i));
+            REQUIRE(bases[read.code(i)] == read.forward()[i]);
+        }
+    }
+
+    SECTION("Buffers are reused for the next read") {
+        std::string long_sequence(100, 'C');
+        long_sequence[40] = 'G';
+        read.prepare(long_sequence);
+        REQUIRE(read.size() == 100);
+        REQUIRE(read.packed().size() == 4);
+        REQUIRE(read.reverse()[59] == 'C');
+        REQUIRE(read.reverse()[0] == 'G');
+        REQUIRE(read.code(40) == 2);
+        REQUIRE(read.code(99) == 1);
+
+        read.prepare("A");
+        REQUIRE(read.forward() == "A");
+        REQUIRE(read.reverse() == "T");
+        REQUIRE(read.packed().size() == 1);
+        REQUIRE(read.code(0) == 0);
+    }
+}
+
+TEST_CASE("WFAExtender gives the same alignments for prepared reads", "[wfa_extender]") {
+    // 1   2         5       8       11
+    // CGC|GATTACA|G|ATTA|TG|GAA|CAT|TAT
+    // CGC|GATTACA|C|ATTA|TC|GAA|GTA|TAT
+    gbwt::GBWT index = wfa_general_gbwt();
+    gbwtgraph::GBWTGraph graph = wfa_general_graph(index);
+    Aligner aligner;
+    WFAExtender extender(graph, aligner);
+
+    auto same_alignment = [](const WFAAlignment& a, const WFAAlignment& b) {
+        REQUIRE(a.ok == b.ok);
+        REQUIRE(a.path == b.path);
+        REQUIRE(a.edits == b.edits);
+        REQUIRE(a.node_offset == b.node_offset);
+        REQUIRE(a.seq_offset == b.seq_offset);
+        REQUIRE(a.length == b.length);
+        REQUIRE(a.score == b.score);
+    };
+
+    // The read has an N in the middle, and we align pieces around it.
+    std::string sequence("TTAGACATTNGATTAGACATTCGA");
+    PreparedRead read;
+    read.prepare(sequence);
+
+    SECTION("Suffix") {
+        pos_t from(2, false, 1);
+        same_alignment(extender.suffix(read, 12, from), extender.suffix(sequence.substr(12), from));
+        same_alignment(extender.suffix(read, 0, from), extender.suffix(sequence, from));
+    }
+
+    SECTION("Prefix") {
+        pos_t to(5, false, 2);
+        same_alignment(extender.prefix(read, 9, to), extender.prefix(sequence.substr(0, 9), to));
+        same_alignment(extender.prefix(read, 11, to), extender.prefix(sequence.substr(0, 11), to));
+    }
+
+    SECTION("Connect") {
+        pos_t from(2, false, 1);
+        pos_t to(8, false, 0);
+        same_alignment(extender.connect(read, 12, 7, from, to), extender.connect(sequence.substr(12, 7), from, to));
+    }
+}
+
+//------------------------------------------------------------------------------
+
 
 }
 }
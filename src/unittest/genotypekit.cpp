@@ -1845,5 +1845,72 @@ TEST_CASE("GBWTTraversalFinder finds traversals for GBWT threads", "[genotype][g
     REQUIRE(gv_to_st(thread1) == travs_all[1]);
 }
 
+TEST_CASE("GBWTTraversalFinder finds the same traversals from its boundary index", "[genotype][gbwttraversalfinder]") {
+
+    // the same graph as above
+    string graph_json = R"({"node": [{"id": 1, "sequence": "CAAATAAGGCTT"}, {"id": 2, "sequence": "G"}, {"id": 3, "sequence": "GGAAATTTTC"}, {"id": 4, "sequence": "C"}, {"id": 5, "sequence": "TGGAGTTCTATTATATTCC"}, {"id": 6, "sequence": "G"}, {"id": 7, "sequence": "A"}, {"id": 8, "sequence": "ACTCTCTGGTTCCTG"}, {"id": 9, "sequence": "A"}, {"id": 10, "sequence": "G"}, {"id": 11, "sequence": "TGCTATGTGTAACTAGTAATGGTAATGGATATGTTGGGCTTTTTTCTTTGATTTATTTGAAGTGACGTTTGACAATCTATCACTAGGGGTAATGTGGGGAAATGGAAAGAATACAAGATTTGGAGCCA"}], "edge": [{"from": 1, "to": 2}, {"from": 1, "to": 3}, {"from": 2, "to": 3}, {"from": 3, "to": 4}, {"from": 3, "to": 5}, {"from": 4, "to": 5}, {"from": 5, "to": 6}, {"from": 5, "to": 7}, {"from": 6, "to": 8}, {"from": 7, "to": 8}, {"from": 8, "to": 9}, {"from": 8, "to": 10}, {"from": 9, "to": 11}, {"from": 10, "to": 11}]})";
+
+    vg::Graph proto_graph;
+    json2pb(proto_graph, graph_json.c_str(), graph_json.size());
+    xg::XG xg_index;
+    xg_index.from_path_handle_graph(vg::VG(proto_graph));
+
+    auto fw = [](vg::id_t id) {
+        return static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(id, false));
+    };
+
+    // some haplotypes start or end inside the chain, and the reverse strands
+    // in the bidirectional GBWT go through it backward
+    vector<gbwt::vector_type> haplotypes {
+        {fw(1), fw(3), fw(4), fw(5), fw(7), fw(8), fw(10), fw(11)},
+        {fw(1), fw(2), fw(3), fw(4), fw(5), fw(6), fw(8), fw(9), fw(11)},
+        {fw(2), fw(3), fw(4), fw(5), fw(6), fw(8), fw(9), fw(11)},
+        {fw(1), fw(3), fw(4), fw(5), fw(6), fw(8)},
+        {fw(1), fw(3), fw(4), fw(5), fw(6), fw(8)}
+    };
+    gbwt::GBWT gbwt_index = get_gbwt(haplotypes);
+    REQUIRE(gbwt_index.bidirectional());
+
+    // the chain of snarls, in both directions
+    vector<pair<vg::id_t, vg::id_t>> boundaries {{1, 3}, {3, 5}, {5, 8}, {8, 11}};
+    vector<Snarl> snarls;
+    for (auto& boundary : boundaries) {
+        snarls.emplace_back();
+        snarls.back().mutable_start()->set_node_id(boundary.first);
+        snarls.back().mutable_end()->set_node_id(boundary.second);
+    }
+    for (auto it = boundaries.rbegin(); it != boundaries.rend(); ++it) {
+        snarls.emplace_back();
+        snarls.back().mutable_start()->set_node_id(it->second);
+        snarls.back().mutable_start()->set_backward(true);
+        snarls.back().mutable_end()->set_node_id(it->first);
+        snarls.back().mutable_end()->set_backward(true);
+    }
+    vector<const Snarl*> snarl_ptrs;
+    for (auto& snarl : snarls) {
+        snarl_ptrs.push_back(&snarl);
+    }
+
+    GBWTTraversalFinder trav_finder(xg_index, gbwt_index);
+    GBWTTraversalFinder indexed_trav_finder(xg_index, gbwt_index);
+    indexed_trav_finder.index_snarl_boundaries(snarl_ptrs);
+
+    for (auto& snarl : snarls) {
+        auto direct = trav_finder.find_path_traversals(snarl);
+        auto indexed = indexed_trav_finder.find_path_traversals(snarl);
+        REQUIRE(!direct.first.empty());
+
+        multiset<pair<string, gbwt::size_type>> direct_travs;
+        multiset<pair<string, gbwt::size_type>> indexed_travs;
+        for (size_t i = 0; i < direct.first.size(); ++i) {
+            direct_travs.emplace(pb2json(direct.first[i]), direct.second[i]);
+        }
+        for (size_t i = 0; i < indexed.first.size(); ++i) {
+            indexed_travs.emplace(pb2json(indexed.first[i]), indexed.second[i]);
+        }
+        REQUIRE(indexed_travs == direct_travs);
+    }
+}
+
 }
 }
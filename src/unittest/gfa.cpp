@@ -6,6 +6,8 @@
 
 #include <bdsg/hash_graph.hpp>
 
+#include <omp.h>
+
 namespace vg {
 namespace unittest {
 
@@ -502,6 +504,177 @@ P	chr1	1+,3+	8M,1M
 }
 
 
+TEST_CASE("Parallel GFA parsing of a file matches streaming parsing", "[gfa]") {
+
+    // Make a GFA big enough to get split into several chunks, with string node
+    // names, rGFA tags, and paths that come before the nodes they visit.
+    stringstream gfa;
+    gfa << "H\tVN:Z:1.0\tRS:Z:GRCh38" << "\n";
+    gfa << "P\tearly\tnode1+,node2-\t*" << "\n";
+    size_t node_count = 20000;
+    string bases = "ACGT";
+    for (size_t i = 1; i <= node_count; i++) {
+        gfa << "S\tnode" << i << "\t";
+        for (size_t j = 0; j < 40; j++) {
+            gfa << bases[(i * 7 + j * 13) % 4];
+        }
+        gfa << "\tSN:Z:rpath\tSO:i:" << (i - 1) * 40 << "\tSR:i:0" << "\n";
+        if (i > 1) {
+            gfa << "L\tnode" << (i - 1) << "\t+\tnode" << i << "\t+\t0M" << "\n";
+        }
+        if (i > 2 && i % 3 == 0) {
+            gfa << "L\tnode" << (i - 2) << "\t+\tnode" << i << "\t-\t*" << "\n";
+        }
+        if (i % 1000 == 0) {
+            gfa << "W\tGRCh38\t0\tchr" << i << "\t*\t*\t>node" << (i - 1) << ">node" << i << "\n";
+            gfa << "P\tpath" << i << "\tnode" << (i - 2) << "+,node" << (i - 1) << "+\t*" << "\n";
+        }
+    }
+    
+    string filename = temp_file::create();
+    {
+        ofstream out(filename);
+        out << gfa.str();
+    }
+    
+    bdsg::HashGraph streamed;
+    algorithms::GFAIDMapInfo streamed_ids;
+    {
+        stringstream in(gfa.str());
+        algorithms::gfa_to_path_handle_graph(in, &streamed, &streamed_ids, 0);
+    }
+    
+    int threads = get_thread_count();
+    omp_set_num_threads(4);
+    bdsg::HashGraph parallel;
+    algorithms::GFAIDMapInfo parallel_ids;
+    algorithms::gfa_to_path_handle_graph(filename, &parallel, &parallel_ids, 0);
+    omp_set_num_threads(threads);
+    
+    REQUIRE(parallel.get_node_count() == node_count);
+    REQUIRE(parallel.has_path("early"));
+    REQUIRE(parallel.has_path("GRCh38#0#chr1000"));
+    REQUIRE(parallel.has_path("rpath"));
+    REQUIRE(parallel_ids.numeric_mode == false);
+    REQUIRE(*parallel_ids.name_to_id == *streamed_ids.name_to_id);
+    REQUIRE(handlealgs::are_equivalent_with_paths(&parallel, &streamed));
+    
+    temp_file::remove(filename);
+}
+
+TEST_CASE("GFA can be read straight into an XG", "[gfa][xg]") {
+
+    string filename = temp_file::create();
+    {
+        ofstream out(filename);
+        out << "H\tVN:Z:1.0\n"
+            << "S\ta\tCAAATAAG\tSN:Z:rpath\tSO:i:0\tSR:i:0\n"
+            << "S\tb\tG\n"
+            << "S\tc\tTTG\tSN:Z:rpath\tSO:i:9\tSR:i:0\n"
+            << "L\ta\t+\tb\t+\t0M\n"
+            << "L\tb\t+\tc\t-\t*\n"
+            << "L\ta\t+\tc\t+\t0M\n"
+            << "P\tx\ta+,b+,c-\t*\n"
+            << "W\tNA12878\t1\tchr1\t0\t11\t>a>c\n";
+    }
+    
+    bdsg::HashGraph loaded;
+    algorithms::GFAIDMapInfo loaded_ids;
+    algorithms::gfa_to_path_handle_graph(filename, &loaded, &loaded_ids, 0);
+    
+    SECTION("The XG matches the graph we would have loaded") {
+        xg::XG xg_index;
+        algorithms::GFAIDMapInfo xg_ids;
+        algorithms::gfa_to_xg(filename, &xg_index, &xg_ids, 0);
+        
+        REQUIRE(xg_index.get_node_count() == 3);
+        REQUIRE(xg_index.get_path_count() == loaded.get_path_count());
+        REQUIRE(xg_index.has_path("x"));
+        REQUIRE(xg_index.has_path("rpath"));
+        REQUIRE(*xg_ids.name_to_id == *loaded_ids.name_to_id);
+        REQUIRE(handlealgs::are_equivalent_with_paths(&xg_index, &loaded));
+    }
+    
+    SECTION("Paths of ignored senses are left out") {
+        xg::XG xg_index;
+        unordered_set<PathSense> ignore_sense {PathSense::HAPLOTYPE};
+        algorithms::gfa_to_xg(filename, &xg_index, nullptr, 0, &ignore_sense);
+        
+        REQUIRE(xg_index.get_path_count() == loaded.get_path_count() - 1);
+        REQUIRE(xg_index.has_path("x"));
+        xg_index.for_each_path_handle([&](const path_handle_t& path) {
+            REQUIRE(xg_index.get_sense(path) != PathSense::HAPLOTYPE);
+        });
+    }
+    
+    temp_file::remove(filename);
+}
+
+TEST_CASE("Parallel GFA parsing of a file rejects missing nodes", "[gfa]") {
+
+    string filename = temp_file::create();
+    {
+        ofstream out(filename);
+        out << "H\tVN:Z:1.0\nS\t1\tCAAATAAG\nS\t3\tG\nL\t1\t+\t2\t+\t0M\nL\t1\t+\t3\t+\t0M\n";
+    }
+    
+    int threads = get_thread_count();
+    omp_set_num_threads(4);
+    bdsg::HashGraph graph;
+    REQUIRE_THROWS_AS(algorithms::gfa_to_path_handle_graph(filename, &graph), algorithms::GFAFormatError);
+    omp_set_num_threads(threads);
+    
+    temp_file::remove(filename);
+}
+
+TEST_CASE("Parallel GFA parsing announces the size of the graph up front", "[gfa]") {
+
+    string filename = temp_file::create();
+    {
+        ofstream out(filename);
+        out << "H\tVN:Z:1.0\nP\tx\t10+,12-\t*\nS\t10\tCAAATAAG\nS\t11\tA\nS\t12\tG\n"
+            << "L\t10\t+\t11\t+\t0M\nL\t10\t+\t12\t-\t0M\nW\ts\t1\tc\t*\t*\t>10<12>11\n";
+    }
+    
+    for (bool numeric : {true, false}) {
+        algorithms::GFAParser parser;
+        vector<tuple<size_t, size_t, size_t, nid_t, nid_t>> announced;
+        nid_t first_node = 0;
+        parser.size_listeners.push_back([&](size_t node_count, size_t edge_count, size_t step_count, nid_t min_id, nid_t max_id) {
+            // Sizes have to come before any nodes
+            REQUIRE(first_node == 0);
+            announced.emplace_back(node_count, edge_count, step_count, min_id, max_id);
+        });
+        parser.node_listeners.push_back([&](nid_t id, const algorithms::GFAParser::chars_t& sequence, const algorithms::GFAParser::tag_list_t& tags) {
+            if (first_node == 0) {
+                first_node = id;
+            }
+        });
+        algorithms::GFAIDMapInfo ids;
+        parser.external_id_map = &ids;
+        if (!numeric) {
+            // Use up an ID name so the IDs can't be predicted.
+            algorithms::GFAParser::assign_new_sequence_id("x", ids);
+        }
+        parser.parse_parallel(filename);
+        
+        REQUIRE(announced.size() == 1);
+        REQUIRE(get<0>(announced[0]) == 3);
+        REQUIRE(get<1>(announced[0]) == 2);
+        REQUIRE(get<2>(announced[0]) == 5);
+        if (numeric) {
+            REQUIRE(get<3>(announced[0]) == 10);
+            REQUIRE(get<4>(announced[0]) == 12);
+            REQUIRE(first_node == 10);
+        } else {
+            REQUIRE(get<3>(announced[0]) == 0);
+            REQUIRE(get<4>(announced[0]) == 0);
+        }
+    }
+    
+    temp_file::remove(filename);
+}
+
         
 }
 }
@@ -5,8 +5,13 @@
 
 #include "../gbwt_helper.hpp"
 
+#include <bdsg/hash_graph.hpp>
+#include <gbwtgraph/utils.h>
+
 #include "catch.hpp"
 
+#include <sstream>
+
 
 
 namespace vg {
@@ -147,6 +152,35 @@ TEST_CASE("GBWT reconstruction", "[index_helpers]") {
     }
 }
 
+TEST_CASE("GBWT reconstruction with parallel mapping", "[index_helpers]") {
+    // Use enough threads to need multiple mapping batches in the job.
+    std::vector<gbwt::vector_type> source, truth;
+    for (size_t i = 0; i < 2500; i++) {
+        source.push_back(i % 2 == 0 ? short_path : alt_path);
+        truth.push_back(i % 2 == 0 ? gbwt::vector_type({ 2, 10, 14, 18 }) : gbwt::vector_type({ 2, 4, 10, 12, 20, 16, 18 }));
+    }
+    gbwt::GBWT original = get_gbwt(source);
+
+    std::vector<RebuildJob> jobs {
+        {
+            {
+                { { 8 }, { } }, // delete 4
+                { { 12, 14 }, { 14 } }, // delete 6 if followed by 7
+                { { 12, 16 }, { 12, 20, 16 } }, // visit 10 between 6 and 8
+            },
+            9
+        }
+    };
+    std::unordered_map<nid_t, size_t> node_to_job;
+    for (nid_t node = 1; node <= 10; node++) {
+        node_to_job[node] = 0;
+    }
+    RebuildParameters parameters;
+    parameters.num_jobs = 4;
+    gbwt::GBWT index = rebuild_gbwt(original, jobs, node_to_job, parameters);
+    check_paths(index, truth);
+}
+
 TEST_CASE("Multiple rebuild_gbwt jobs", "[index_helpers]") {
     // We order the threads by (phase, contig), but rebuild_gbwt() will
     // reorder them by contig (with stable sorting).
@@ -216,5 +250,110 @@ TEST_CASE("Multiple rebuild_gbwt jobs", "[index_helpers]") {
 
 //------------------------------------------------------------------------------
 
+TEST_CASE("GBWT path names", "[index_helpers]") {
+    std::vector<gbwt::vector_type> source {
+        sample_1_a, sample_1_b, sample_2_a, sample_2_b,
+    };
+    gbwt::GBWT index = get_gbwt(source);
+    index.addMetadata();
+    index.metadata.setSamples({ "sample1", "sample2" });
+    index.metadata.setHaplotypes(2);
+    index.metadata.setContigs({ "chrA", "chrB" });
+    index.metadata.addPath(0, 0, 0, 0);
+    index.metadata.addPath(0, 1, 0, 0);
+    index.metadata.addPath(1, 0, 0, 0);
+    index.metadata.addPath(1, 1, 0, 0);
+
+    bdsg::HashGraph graph;
+    for (nid_t node : { 11, 12, 13, 14, 15, 16, 17, 21, 22, 23, 24, 25 }) {
+        graph.create_handle("A", node);
+    }
+
+    GBWTPathNames names(index);
+    REQUIRE(names.size() == index.metadata.paths());
+
+    SECTION("names can be looked up") {
+        for (gbwt::size_type id = 0; id < names.size(); id++) {
+            REQUIRE(names.name(id) == gbwtgraph::compose_path_name(index, id, PathSense::HAPLOTYPE));
+            REQUIRE(names.find(names.name(id)) == id);
+        }
+        REQUIRE(names.find("sample3#1#chrA") == names.size());
+    }
+
+    SECTION("paths can be extracted in bulk") {
+        std::vector<gbwt::size_type> ids { 3, 0, 2 };
+        std::vector<Path> paths = extract_gbwt_paths(graph, index, ids, names);
+        REQUIRE(paths.size() == ids.size());
+        for (size_t i = 0; i < ids.size(); i++) {
+            Path truth = extract_gbwt_path(graph, index, ids[i]);
+            REQUIRE(paths[i].name() == truth.name());
+            REQUIRE(paths[i].mapping_size() == truth.mapping_size());
+            for (size_t j = 0; j < truth.mapping_size(); j++) {
+                REQUIRE(paths[i].mapping(j).position().node_id() == truth.mapping(j).position().node_id());
+                REQUIRE(paths[i].mapping(j).position().is_reverse() == truth.mapping(j).position().is_reverse());
+            }
+        }
+    }
+}
+
+TEST_CASE("GBWT offset index", "[index_helpers]") {
+    std::vector<gbwt::vector_type> source {
+        sample_1_a, sample_1_b, sample_2_a, sample_2_b,
+    };
+    gbwt::GBWT index = get_gbwt(source);
+
+    // Use nodes of different lengths so that offsets are not node counts.
+    bdsg::HashGraph graph;
+    std::vector<std::string> node_sequences { "GATTACA", "C", "TTG", "ACGTACGTAC", "G", "CAT", "AA", "T", "GGCC", "A", "CCCTA", "GT" };
+    std::vector<nid_t> node_ids { 11, 12, 13, 14, 15, 16, 17, 21, 22, 23, 24, 25 };
+    for (size_t i = 0; i < node_ids.size(); i++) {
+        graph.create_handle(node_sequences[i], node_ids[i]);
+    }
+
+    std::vector<std::string> truth;
+    for (auto& path : source) {
+        std::string sequence;
+        for (auto node : path) {
+            sequence += graph.get_sequence(gbwt_to_handle(graph, node));
+        }
+        truth.push_back(sequence);
+    }
+
+    for (size_t sample_interval : { size_t(1), size_t(5), GBWTOffsetIndex::DEFAULT_SAMPLE_INTERVAL }) {
+        GBWTOffsetIndex offsets(index, graph, sample_interval);
+        REQUIRE(offsets.paths() == source.size());
+        REQUIRE(offsets.sample_interval() == sample_interval);
+        for (gbwt::size_type id = 0; id < offsets.paths(); id++) {
+            REQUIRE(offsets.path_length(id) == truth[id].length());
+            for (size_t start = 0; start <= truth[id].length(); start++) {
+                for (size_t end = start; end <= truth[id].length() + 2; end += 3) {
+                    REQUIRE(offsets.substring(index, graph, id, start, end) == truth[id].substr(start, end - start));
+                }
+            }
+            auto past_end = offsets.seek(index, graph, id, truth[id].length());
+            REQUIRE(past_end.first == gbwt::invalid_edge());
+            REQUIRE(past_end.second == truth[id].length());
+        }
+    }
+
+    SECTION("serialization") {
+        GBWTOffsetIndex offsets(index, graph, 5);
+        std::stringstream buffer;
+        offsets.simple_sds_serialize(buffer);
+        REQUIRE(buffer.str().length() == offsets.simple_sds_size() * sizeof(std::uint64_t));
+
+        GBWTOffsetIndex loaded;
+        loaded.simple_sds_load(buffer);
+        REQUIRE(loaded.paths() == offsets.paths());
+        REQUIRE(loaded.sample_interval() == offsets.sample_interval());
+        for (gbwt::size_type id = 0; id < loaded.paths(); id++) {
+            REQUIRE(loaded.path_length(id) == offsets.path_length(id));
+            REQUIRE(loaded.substring(index, graph, id, 3, 17) == truth[id].substr(3, 14));
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
 }
 }
@@ -0,0 +1,116 @@
+/// \file index_partitions.cpp
+///
+/// unit tests for partition lists and merging mappings against partitions
+///
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "../index_partitions.hpp"
+#include "../annotation.hpp"
+#include "../utility.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("Partition lists can be written and read back", "[index_partitions]") {
+
+    string directory = temp_file::create_directory();
+    vector<IndexPartition> partitions {
+        {"chr1", directory + "/idx.chr1.giraffe.gbz", directory + "/idx.chr1.min", directory + "/idx.chr1.dist"},
+        {"chr2", "/elsewhere/chr2.gbz", "/elsewhere/chr2.min", "/elsewhere/chr2.dist"}
+    };
+    string list = directory + "/idx.partitions";
+    write_partition_list(list, partitions);
+
+    SECTION("Files next to the list are listed by base name") {
+        ifstream in(list);
+        string header, first;
+        getline(in, header);
+        getline(in, first);
+        REQUIRE(header == PARTITION_LIST_HEADER);
+        REQUIRE(first == "chr1\tidx.chr1.giraffe.gbz\tidx.chr1.min\tidx.chr1.dist");
+    }
+
+    SECTION("Reading resolves the files again") {
+        auto read = read_partition_list(list);
+        REQUIRE(read.size() == 2);
+        for (size_t i = 0; i < read.size(); i++) {
+            REQUIRE(read[i].name == partitions[i].name);
+            REQUIRE(read[i].gbz == partitions[i].gbz);
+            REQUIRE(read[i].minimizers == partitions[i].minimizers);
+            REQUIRE(read[i].distance == partitions[i].distance);
+        }
+    }
+
+    temp_file::remove(directory);
+}
+
+/// Make a mapped alignment with the given score, MAPQ, and candidate scores.
+static Alignment mapped_alignment(int32_t score, int32_t mapq, const vector<double>& candidates) {
+    Alignment aln;
+    aln.set_name("read");
+    aln.set_score(score);
+    aln.set_mapping_quality(mapq);
+    aln.mutable_path()->add_mapping()->mutable_position()->set_node_id(score);
+    set_annotation(aln, "secondary_scores", candidates);
+    return aln;
+}
+
+TEST_CASE("Merging mappings against partitions picks the best one", "[index_partitions]") {
+
+    Aligner aligner;
+
+    SECTION("A unique hit keeps its MAPQ") {
+        vector<vector<Alignment>> mappings(2);
+        mappings[0].emplace_back();
+        mappings[0].back().set_name("read");
+        mappings[1].push_back(mapped_alignment(100, 60, {100}));
+
+        auto merged = merge_partition_mappings(mappings, aligner);
+        REQUIRE(merged.size() == 1);
+        REQUIRE(merged[0].score() == 100);
+        REQUIRE(merged[0].mapping_quality() == 60);
+        REQUIRE(!merged[0].is_secondary());
+    }
+
+    SECTION("Equal hits in two partitions get a low MAPQ") {
+        vector<vector<Alignment>> mappings(2);
+        mappings[0].push_back(mapped_alignment(100, 60, {100}));
+        mappings[1].push_back(mapped_alignment(100, 60, {100}));
+
+        auto merged = merge_partition_mappings(mappings, aligner, 2);
+        REQUIRE(merged.size() == 2);
+        REQUIRE(merged[0].mapping_quality() <= 3);
+        REQUIRE(!merged[0].is_secondary());
+        REQUIRE(merged[1].is_secondary());
+        REQUIRE(get_annotation<vector<double>>(merged[0], "secondary_scores").size() == 2);
+    }
+
+    SECTION("The better partition wins") {
+        vector<vector<Alignment>> mappings(3);
+        mappings[0].push_back(mapped_alignment(50, 20, {50, 45}));
+        mappings[1].push_back(mapped_alignment(150, 60, {150}));
+        mappings[2].emplace_back();
+
+        auto merged = merge_partition_mappings(mappings, aligner);
+        REQUIRE(merged.size() == 1);
+        REQUIRE(merged[0].score() == 150);
+        REQUIRE(merged[0].mapping_quality() == 60);
+    }
+
+    SECTION("A read unmapped everywhere stays unmapped") {
+        vector<vector<Alignment>> mappings(2);
+        mappings[0].emplace_back();
+        mappings[1].emplace_back();
+
+        auto merged = merge_partition_mappings(mappings, aligner, 5);
+        REQUIRE(merged.size() == 1);
+        REQUIRE(merged[0].path().mapping_size() == 0);
+    }
+}
+
+}
+}
@@ -186,6 +186,44 @@ TEST_CASE("IndexedVG works on random graphs", "[handle][indexed-vg]") {
     }
 }
 
+TEST_CASE("IndexedVG gives the same answers from threads with a tiny cache", "[handle][indexed-vg]") {
+    VG random;
+    random_graph(500, 3, 50, &random);
+    random.id_sort();
+    
+    string filename = temp_file::create();
+    random.serialize_to_file(filename, 10);
+    
+    for (bool prefetch : {false, true}) {
+        // With a 1 byte cache, each shard can only keep the last group it got,
+        // so groups get evicted and reloaded all the time.
+        IndexedVG indexed(filename, 1);
+        indexed.set_prefetch(prefetch);
+        
+        vector<nid_t> ids;
+        random.for_each_handle([&](const handle_t& node) {
+            ids.push_back(random.get_id(node));
+        });
+        
+        atomic<size_t> mismatches(0);
+#pragma omp parallel for
+        for (size_t i = 0; i < ids.size(); i++) {
+            handle_t node = random.get_handle(ids[i]);
+            handle_t handle = indexed.get_handle(ids[i]);
+            if (indexed.get_sequence(handle) != random.get_sequence(node) ||
+                indexed.get_degree(handle, false) != random.get_degree(node, false) ||
+                indexed.get_degree(handle, true) != random.get_degree(node, true)) {
+                mismatches++;
+            }
+        }
+        REQUIRE(mismatches == 0);
+        REQUIRE(indexed.get_node_count() == random.get_node_count());
+    }
+    
+    temp_file::remove(filename);
+    temp_file::remove(filename + ".vgi");
+}
+
 }
 
 }
@@ -9,11 +9,17 @@
 #include "../handle.hpp"
 #include "vg/io/json2pb.h"
 #include "catch.hpp"
+#include "randomness.hpp"
 
 #include <vg/vg.pb.h>
 
 #include <bdsg/hash_graph.hpp>
 
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <set>
+
 
 namespace vg {
 namespace unittest {
@@ -253,7 +259,111 @@ TEST_CASE("K Widest Paths works correctly on small Wikipedia example", "[k_wides
 
 }
 
+TEST_CASE("K Widest Paths agrees with brute force on random DAGs", "[k_widest_paths][algorithms]") {
+
+    default_random_engine gen(test_seed_source());
+    uniform_real_distribution<double> weight_distr(0.0, 10.0);
+    bernoulli_distribution edge_distr(0.3);
+
+    for (size_t rep = 0; rep < 20; ++rep) {
+        HashGraph graph;
+        size_t node_count = 10;
+        vector<handle_t> nodes;
+        for (size_t i = 0; i < node_count; ++i) {
+            nodes.push_back(graph.create_handle("A"));
+        }
+        unordered_map<handle_t, double> node_weights;
+        unordered_map<edge_t, double> edge_weights;
+        for (size_t i = 0; i < node_count; ++i) {
+            // The source and sink shouldn't limit any paths.
+            node_weights[nodes[i]] = (i == 0 || i + 1 == node_count) ? 100.0 : weight_distr(gen);
+            for (size_t j = i + 1; j < node_count; ++j) {
+                if (j == i + 1 || edge_distr(gen)) {
+                    graph.create_edge(nodes[i], nodes[j]);
+                    edge_weights[graph.edge_handle(nodes[i], nodes[j])] = weight_distr(gen);
+                }
+            }
+        }
+
+        function<double(handle_t)> node_weight_callback = [&](handle_t h) {
+            if (!node_weights.count(h)) {
+                h = graph.flip(h);
+            }
+            return node_weights[h];
+        };
+        function<double(edge_t)> edge_weight_callback = [&](edge_t e) {
+            if (!edge_weights.count(e)) {
+                e = graph.edge_handle(graph.flip(e.second), graph.flip(e.first));
+            }
+            return edge_weights[e];
+        };
+
+        // Enumerate the widths of all the paths.
+        vector<double> all_widths;
+        vector<handle_t> stack_path {nodes.front()};
+        function<void(double)> enumerate = [&](double width) {
+            handle_t here = stack_path.back();
+            if (here == nodes.back()) {
+                all_widths.push_back(width);
+                return;
+            }
+            graph.follow_edges(here, false, [&](const handle_t& next) {
+                    double next_width = min(width, edge_weight_callback(graph.edge_handle(here, next)));
+                    next_width = min(next_width, node_weight_callback(next));
+                    stack_path.push_back(next);
+                    enumerate(next_width);
+                    stack_path.pop_back();
+                });
+        };
+        enumerate(numeric_limits<double>::max());
+        std::sort(all_widths.begin(), all_widths.end(), std::greater<double>());
+
+        vector<handle_t> order;
+        REQUIRE(algorithms::widest_path_order(&graph, nodes.front(), nodes.back(), order));
+        REQUIRE(order.size() == node_count);
+        REQUIRE(order.front() == nodes.front());
+
+        // The DAG search finds as wide a path as Dijkstra
+        auto dag_path = algorithms::widest_dag_path(&graph, nodes.front(), nodes.back(), order,
+                                                    node_weight_callback, edge_weight_callback,
+                                                    [](handle_t) {return false;}, [](edge_t) {return false;});
+        auto dijkstra_path = algorithms::widest_dijkstra(&graph, nodes.front(), nodes.back(),
+                                                         node_weight_callback, edge_weight_callback,
+                                                         [](handle_t) {return false;}, [](edge_t) {return false;});
+        REQUIRE(dag_path.first == dijkstra_path.first);
+        REQUIRE(dag_path.first == all_widths.front());
+        REQUIRE(dag_path.second.front() == nodes.front());
+        REQUIRE(dag_path.second.back() == nodes.back());
+
+        // And Yen's algorithm finds the widest paths
+        size_t K = 8;
+        auto widest_paths = algorithms::yens_k_widest_paths(&graph, nodes.front(), nodes.back(), K,
+                                                            node_weight_callback, edge_weight_callback);
+        REQUIRE(widest_paths.size() == min(K, all_widths.size()));
+        set<vector<handle_t>> distinct_paths;
+        for (size_t i = 0; i < widest_paths.size(); ++i) {
+            REQUIRE(widest_paths[i].first == all_widths[i]);
+            distinct_paths.insert(widest_paths[i].second);
+        }
+        REQUIRE(distinct_paths.size() == widest_paths.size());
+    }
+}
+
+TEST_CASE("Widest path order detects cycles", "[k_widest_paths][algorithms]") {
+    HashGraph graph;
+    handle_t a = graph.create_handle("A");
+    handle_t b = graph.create_handle("C");
+    handle_t c = graph.create_handle("G");
+    graph.create_edge(a, b);
+    graph.create_edge(b, b);
+    graph.create_edge(b, c);
+    vector<handle_t> order;
+    REQUIRE(!algorithms::widest_path_order(&graph, a, c, order));
+    
+    // But there's no cycle if we stop before it.
+    REQUIRE(algorithms::widest_path_order(&graph, a, b, order));
+    REQUIRE(order.size() == 2);
+}
 
 }
 }
-        
@@ -0,0 +1,104 @@
+/** \file
+ *
+ * Unit tests for the GCSA2 kmer helpers in kmer.cpp.
+ */
+
+#include "../kmer.hpp"
+#include "../source_sink_overlay.hpp"
+#include "../utility.hpp"
+#include "../vg.hpp"
+
+#include "catch.hpp"
+
+#include <fstream>
+
+namespace vg {
+
+namespace unittest {
+
+//------------------------------------------------------------------------------
+
+TEST_CASE("Duplicate GCSA kmers are merged", "[kmer][gcsa]") {
+    const gcsa::Alphabet alpha;
+    auto make_kmer = [&](const std::string& seq, gcsa::byte_type pred, gcsa::byte_type succ, id_t from, id_t to) {
+        gcsa::KMer kmer;
+        kmer.key = gcsa::Key::encode(alpha, seq, pred, succ);
+        kmer.from = gcsa::Node::encode(from, 0, false);
+        kmer.to = gcsa::Node::encode(to, 0, false);
+        return kmer;
+    };
+
+    std::vector<gcsa::KMer> kmers {
+        make_kmer("GATTA", 1 << alpha.char2comp['A'], 1 << alpha.char2comp['C'], 1, 5),
+        make_kmer("CATTA", 1 << alpha.char2comp['A'], 1 << alpha.char2comp['C'], 1, 5),
+        make_kmer("GATTA", 1 << alpha.char2comp['A'], 1 << alpha.char2comp['C'], 1, 5),
+        make_kmer("GATTA", 1 << alpha.char2comp['T'], 1 << alpha.char2comp['C'], 1, 5),
+        make_kmer("GATTA", 1 << alpha.char2comp['A'], 1 << alpha.char2comp['C'], 1, 6),
+    };
+
+    size_t removed = merge_gcsa_kmers(kmers);
+    REQUIRE(removed == 2);
+    REQUIRE(kmers.size() == 3);
+
+    size_t merged = 0;
+    for (auto& kmer : kmers) {
+        if (gcsa::Key::label(kmer.key) == gcsa::Key::label(gcsa::Key::encode(alpha, "GATTA", 0, 0)) && kmer.to == gcsa::Node::encode(5, 0, false)) {
+            REQUIRE(gcsa::Key::predecessors(kmer.key) == ((1 << alpha.char2comp['A']) | (1 << alpha.char2comp['T'])));
+            REQUIRE(gcsa::Key::successors(kmer.key) == (1 << alpha.char2comp['C']));
+            merged++;
+        }
+    }
+    REQUIRE(merged == 1);
+
+    std::vector<gcsa::KMer> empty;
+    REQUIRE(merge_gcsa_kmers(empty) == 0);
+}
+
+TEST_CASE("Sharded GCSA kmer files share a size budget", "[kmer][gcsa]") {
+    VG graph;
+    handle_t h1 = graph.create_handle("GATTACAGATTACA");
+    handle_t h2 = graph.create_handle("CATTAG");
+    handle_t h3 = graph.create_handle("TTTACAGG");
+    handle_t h4 = graph.create_handle("ACCAGTTA");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h1, h3);
+    graph.create_edge(h2, h4);
+    graph.create_edge(h3, h4);
+
+    SourceSinkOverlay overlay(&graph, 10);
+    id_t head_id = overlay.get_id(overlay.get_source_handle());
+    id_t tail_id = overlay.get_id(overlay.get_sink_handle());
+
+    SECTION("The files hold the bytes charged to the budget") {
+        std::atomic<size_t> bytes_used(0);
+        std::vector<std::string> tmpfiles = write_gcsa_kmers_to_tmpfiles(overlay, 10, bytes_used, 1000000, head_id, tail_id);
+        REQUIRE(!tmpfiles.empty());
+        size_t on_disk = 0;
+        for (auto& tmpfile : tmpfiles) {
+            std::ifstream in(tmpfile, std::ios::binary | std::ios::ate);
+            REQUIRE(in);
+            on_disk += in.tellg();
+            temp_file::remove(tmpfile);
+        }
+        REQUIRE(on_disk == bytes_used.load());
+
+        // a second graph charged to the same budget adds to it
+        size_t first_bytes = bytes_used.load();
+        for (auto& tmpfile : write_gcsa_kmers_to_tmpfiles(overlay, 10, bytes_used, 1000000, head_id, tail_id)) {
+            temp_file::remove(tmpfile);
+        }
+        REQUIRE(bytes_used.load() > first_bytes);
+    }
+
+    SECTION("Exceeding the budget throws") {
+        std::atomic<size_t> bytes_used(0);
+        REQUIRE_THROWS_AS(write_gcsa_kmers_to_tmpfiles(overlay, 10, bytes_used, 10, head_id, tail_id),
+                          SizeLimitExceededException);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace unittest
+
+} // namespace vg
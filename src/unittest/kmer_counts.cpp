@@ -0,0 +1,94 @@
+/** \file
+ *
+ * Unit tests for KmerCounts in recombinator.cpp, which stores counts for a
+ * fixed set of kmers.
+ */
+
+#include "../recombinator.hpp"
+#include "../kff.hpp"
+
+#include "catch.hpp"
+
+#include <random>
+
+namespace vg {
+
+namespace unittest {
+
+//------------------------------------------------------------------------------
+
+TEST_CASE("KmerCounts finds the kmers it was built with", "[recombinator][kmer_counts]") {
+
+    SECTION("empty table") {
+        std::vector<KmerCounts::kmer_type> kmers;
+        KmerCounts counts(kmers);
+        REQUIRE(counts.empty());
+        REQUIRE(counts.find(42) == KmerCounts::NOT_FOUND);
+        REQUIRE_THROWS_AS(counts.at(42), std::out_of_range);
+    }
+
+    SECTION("random kmers with duplicates") {
+        size_t k = 29;
+        KmerCounts::kmer_type mask = (KmerCounts::kmer_type(1) << (2 * k)) - 1;
+        std::mt19937_64 rng(0xBADC0FFEE);
+        std::vector<KmerCounts::kmer_type> kmers;
+        for (size_t i = 0; i < 10000; i++) {
+            kmers.push_back(rng() & mask);
+        }
+        std::vector<KmerCounts::kmer_type> truth = kmers;
+        kmers.insert(kmers.end(), truth.begin(), truth.begin() + 100);
+        gbwt::removeDuplicates(truth, false);
+
+        KmerCounts counts(kmers);
+        REQUIRE(counts.size() == truth.size());
+
+        std::vector<bool> used(counts.size(), false);
+        for (auto kmer : truth) {
+            size_t slot = counts.find(kmer);
+            REQUIRE(slot < counts.size());
+            REQUIRE(!used[slot]);
+            used[slot] = true;
+            REQUIRE(counts.at(kmer) == 0);
+        }
+
+        // Kmers that are not in the table are not found.
+        size_t false_positives = 0;
+        for (size_t i = 0; i < 10000; i++) {
+            KmerCounts::kmer_type kmer = rng() & mask;
+            if (!std::binary_search(truth.begin(), truth.end(), kmer) && counts.find(kmer) != KmerCounts::NOT_FOUND) {
+                false_positives++;
+            }
+        }
+        REQUIRE(false_positives == 0);
+    }
+}
+
+TEST_CASE("KmerCounts counts kmers in either orientation", "[recombinator][kmer_counts]") {
+    std::vector<std::string> sequences { "GATTACAGATTACA", "CATCATCATCATCA", "ACGTTGCAACGTTG" };
+    size_t k = sequences.front().length();
+    std::vector<KmerCounts::kmer_type> kmers;
+    for (auto& sequence : sequences) {
+        kmers.push_back(gbwtgraph::Key64::encode(sequence).get_key());
+    }
+    KmerCounts counts(kmers);
+
+    KmerCounts::kmer_type forward = gbwtgraph::Key64::encode(sequences[0]).get_key();
+    KmerCounts::kmer_type reverse = minimizer_reverse_complement(forward, k);
+    size_t slot = counts.find_either(forward, k);
+    REQUIRE(slot != KmerCounts::NOT_FOUND);
+    REQUIRE(counts.find_either(reverse, k) == slot);
+
+    #pragma omp parallel for
+    for (size_t i = 0; i < 1000; i++) {
+        counts.add(slot, 2);
+    }
+    REQUIRE(counts.count(slot) == 2000);
+    REQUIRE(counts.at(forward) == 2000);
+    REQUIRE(counts.at(gbwtgraph::Key64::encode(sequences[1]).get_key()) == 0);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace unittest
+
+} // namespace vg
@@ -9,6 +9,8 @@
 #include "../mapper.hpp"
 #include "xg.hpp"
 #include "../build_index.hpp"
+#include "../mem_accelerator.hpp"
+#include "random_graph.hpp"
 #include "catch.hpp"
 #include "../algorithms/alignment_path_offsets.hpp"
 
@@ -646,5 +648,90 @@ TEST_CASE( "Mapper can walk paths from fan-out MEM algorithm", "[mapping][mapper
     delete lcpidx;
 }
 
+TEST_CASE( "Batched MEM finding matches MEM finding one sequence at a time", "[mapping][mapper][mem]" ) {
+    
+    bdsg::HashGraph graph;
+    random_graph(500, 4, 20, &graph);
+    
+    // Make GCSA quiet
+    gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+    
+    // Make pointers to fill in
+    gcsa::GCSA* gcsaidx = nullptr;
+    gcsa::LCPArray* lcpidx = nullptr;
+    
+    // Build the GCSA index
+    build_gcsa_lcp(graph, gcsaidx, lcpidx, 16, 2);
+    
+    // Build the xg index
+    xg::XG xg_index;
+    xg_index.from_path_handle_graph(graph);
+    
+    Mapper mapper(&xg_index, gcsaidx, lcpidx);
+    
+    // reads from the graph, with some errors, Ns and lengths that won't fill the accelerator
+    vector<string> reads;
+    for (size_t i = 0; i < 40; ++i) {
+        string read = pseudo_random_sequence(i, i);
+        graph.for_each_handle([&](const handle_t& handle) {
+            if (graph.get_id(handle) % 7 == i % 7 && read.size() < 60) {
+                read += graph.get_sequence(handle);
+            }
+        });
+        if (i % 5 == 0 && !read.empty()) {
+            read[read.size() / 2] = 'N';
+        }
+        reads.push_back(read);
+    }
+    vector<pair<string::const_iterator, string::const_iterator>> seqs;
+    for (auto& read : reads) {
+        seqs.emplace_back(read.begin(), read.end());
+    }
+    
+    MEMAccelerator accelerator(*gcsaidx, 4, 7, 2);
+    
+    for (MEMAccelerator* accel : {(MEMAccelerator*) nullptr, &accelerator}) {
+        mapper.accelerator = accel;
+        for (int reseed_length : {0, 8}) {
+            auto batched = mapper.find_mems_simple_batch(seqs, 0, 3, reseed_length);
+            REQUIRE(batched.size() == reads.size());
+            for (size_t i = 0; i < reads.size(); ++i) {
+                auto single = mapper.find_mems_simple(reads[i].begin(), reads[i].end(), 0, 3, reseed_length);
+                REQUIRE(batched[i].size() == single.size());
+                for (size_t j = 0; j < single.size(); ++j) {
+                    REQUIRE(batched[i][j].begin == single[j].begin);
+                    REQUIRE(batched[i][j].end == single[j].end);
+                    REQUIRE(batched[i][j].range == single[j].range);
+                    REQUIRE(batched[i][j].match_count == single[j].match_count);
+                }
+            }
+        }
+    }
+    mapper.accelerator = nullptr;
+    
+    SECTION("MEMs are the same without the LCP array") {
+        Mapper lcp_free_mapper(&xg_index, gcsaidx, nullptr);
+        for (MEMAccelerator* accel : {(MEMAccelerator*) nullptr, &accelerator}) {
+            lcp_free_mapper.accelerator = accel;
+            for (int max_mem_length : {0, 12}) {
+                for (size_t i = 0; i < reads.size(); ++i) {
+                    auto lcp_free = lcp_free_mapper.find_mems_simple(reads[i].begin(), reads[i].end(), max_mem_length, 3);
+                    auto with_lcp = mapper.find_mems_simple(reads[i].begin(), reads[i].end(), max_mem_length, 3);
+                    REQUIRE(lcp_free.size() == with_lcp.size());
+                    for (size_t j = 0; j < with_lcp.size(); ++j) {
+                        REQUIRE(lcp_free[j].begin == with_lcp[j].begin);
+                        REQUIRE(lcp_free[j].end == with_lcp[j].end);
+                        REQUIRE(lcp_free[j].range == with_lcp[j].range);
+                    }
+                }
+            }
+        }
+    }
+    
+    // Clean up the GCSA/LCP index
+    delete gcsaidx;
+    delete lcpidx;
+}
+
 }
 }
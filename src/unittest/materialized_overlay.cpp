@@ -0,0 +1,87 @@
+/// \file materialized_overlay.cpp
+///
+/// unit tests for copying overlays into flat arrays
+///
+
+#include <algorithm>
+#include <iostream>
+#include "../materialized_overlay.hpp"
+#include "../dagified_graph.hpp"
+#include "../split_strand_graph.hpp"
+#include "../utility.hpp"
+#include "catch.hpp"
+
+#include "bdsg/hash_graph.hpp"
+
+namespace vg {
+namespace unittest {
+
+    TEST_CASE("MaterializedOverlay copies a dagified strand-split graph", "[overlay][materialize]") {
+
+        bdsg::HashGraph graph;
+
+        handle_t n1 = graph.create_handle("AAT");
+        handle_t n2 = graph.create_handle("ACG");
+        handle_t n3 = graph.create_handle("AG");
+        handle_t n4 = graph.create_handle("CCTA");
+
+        graph.create_edge(n1, n2);
+        graph.create_edge(n2, n3);
+        graph.create_edge(n2, graph.flip(n4));
+        graph.create_edge(n3, n2);
+
+        StrandSplitGraph split(&graph);
+        DagifiedGraph dagified(&split, 5);
+        MaterializedOverlay materialized(&dagified);
+
+        REQUIRE(materialized.get_node_count() == dagified.get_node_count());
+        REQUIRE(materialized.get_edge_count() == dagified.get_edge_count());
+        REQUIRE(materialized.min_node_id() == 1);
+        REQUIRE(materialized.max_node_id() == (id_t) materialized.get_node_count());
+
+        SECTION("Nodes have the sequences of the nodes they came from") {
+            materialized.for_each_handle([&](const handle_t& h) {
+                for (bool is_reverse : {false, true}) {
+                    handle_t oriented = is_reverse ? materialized.flip(h) : h;
+                    handle_t original = split.get_underlying_handle(materialized.get_underlying_handle(oriented));
+                    string sequence = graph.get_sequence(original);
+                    REQUIRE(materialized.get_sequence(oriented) == sequence);
+                    REQUIRE(materialized.get_length(oriented) == sequence.size());
+                    for (size_t i = 0; i < sequence.size(); i++) {
+                        REQUIRE(materialized.get_base(oriented, i) == sequence[i]);
+                    }
+                    REQUIRE(materialized.get_subsequence(oriented, 1, 2) == sequence.substr(1, 2));
+                }
+            });
+        }
+
+        SECTION("Edges connect the nodes the overlay's edges connect") {
+            // compare the edges as pairs of the overlay's underlying handles
+            auto edges_of = [&](const ExpandingOverlayGraph& g) {
+                vector<pair<uint64_t, uint64_t>> edges;
+                g.for_each_handle([&](const handle_t& h) {
+                    for (handle_t oriented : {h, g.flip(h)}) {
+                        REQUIRE(g.get_degree(oriented, false) == g.get_degree(g.flip(oriented), true));
+                        g.follow_edges(oriented, false, [&](const handle_t& next) {
+                            edges.emplace_back(handlegraph::as_integer(g.get_underlying_handle(oriented)),
+                                               handlegraph::as_integer(g.get_underlying_handle(next)));
+                        });
+                    }
+                });
+                sort(edges.begin(), edges.end());
+                return edges;
+            };
+            REQUIRE(edges_of(materialized) == edges_of(dagified));
+        }
+
+        SECTION("Nodes are in topological order") {
+            materialized.for_each_handle([&](const handle_t& h) {
+                materialized.follow_edges(h, false, [&](const handle_t& next) {
+                    REQUIRE(!materialized.get_is_reverse(next));
+                    REQUIRE(materialized.get_id(next) > materialized.get_id(h));
+                });
+            });
+        }
+    }
+}
+}
@@ -92,6 +92,82 @@ TEST_CASE("MEMAccelerator returns same ranges as direct LF queries",
         delete lcpidx;
     }
 }
+
+TEST_CASE("MEMAccelerator memoizes frequent long k-mers and survives serialization",
+          "[mem][mapping][memaccelerator]" ) {
+    
+    int num_graphs = 5;
+    int seq_size = 200;
+    int var_count = 4;
+    int var_length = 3;
+    int memo_length = 2;
+    int long_memo_length = 5;
+    size_t min_long_count = 2;
+    for (int g = 0; g < num_graphs; ++g) {
+        
+        bdsg::HashGraph graph;
+        random_graph(seq_size, var_length, var_count, &graph);
+        
+        // Make GCSA quiet
+        gcsa::Verbosity::set(gcsa::Verbosity::SILENT);
+        
+        // Make pointers to fill in
+        gcsa::GCSA* gcsaidx = nullptr;
+        gcsa::LCPArray* lcpidx = nullptr;
+        
+        // Build the GCSA index
+        build_gcsa_lcp(graph, gcsaidx, lcpidx, 8, 2);
+        
+        MEMAccelerator built(*gcsaidx, memo_length, long_memo_length, min_long_count);
+        
+        stringstream strm;
+        built.serialize(strm);
+        MEMAccelerator accelerator;
+        accelerator.load(strm);
+        
+        REQUIRE(accelerator.length() == memo_length);
+        REQUIRE(accelerator.long_length() == long_memo_length);
+        
+        // iterate over all long k-mers
+        for (int k = 0; k < (1 << (2 * long_memo_length)); ++k) {
+            
+            string seq(long_memo_length, 'N');
+            for (int i = 0; i < long_memo_length; ++i) {
+                seq[i] = "ACGT"[(k >> i) & 3];
+            }
+            
+            auto direct_range = gcsa::range_type(0, gcsaidx->size() - 1);
+            auto cursor = seq.end() - 1;
+            while (cursor >= seq.begin() && !gcsa::Range::empty(direct_range)) {
+                direct_range = gcsaidx->LF(direct_range,
+                                           gcsaidx->alpha.char2comp[*cursor]);
+                --cursor;
+            }
+            
+            // exactly the frequent long k-mers are found, with the direct range
+            gcsa::range_type memo_range;
+            bool frequent = (!gcsa::Range::empty(direct_range) &&
+                             gcsa::Range::length(direct_range) >= min_long_count);
+            REQUIRE(accelerator.long_memoized_LF(seq.end() - 1, memo_range) == frequent);
+            if (frequent) {
+                REQUIRE(memo_range == direct_range);
+            }
+            
+            // the dense level is unchanged by the round trip
+            REQUIRE(accelerator.memoized_LF(seq.end() - 1) == built.memoized_LF(seq.end() - 1));
+        }
+        
+        delete gcsaidx;
+        delete lcpidx;
+    }
+}
+
+TEST_CASE("MEMAccelerator rejects streams that don't hold one",
+          "[mem][mapping][memaccelerator]" ) {
+    stringstream strm("not a MEMAccelerator");
+    MEMAccelerator accelerator;
+    REQUIRE_THROWS_AS(accelerator.load(strm), std::runtime_error);
+}
    
 }
 }
@@ -31,6 +31,9 @@ public:
     using MinimizerMapper::with_dagified_local_graph;
     using MinimizerMapper::align_sequence_between;
     using MinimizerMapper::fix_dozeu_end_deletions;
+    using MinimizerMapper::Seed;
+    using MinimizerMapper::ReseedGap;
+    using MinimizerMapper::reseed_between;
 };
 
 TEST_CASE("Fragment length distribution gets reasonable value", "[giraffe][mapping]") {
@@ -441,6 +444,83 @@ TEST_CASE("MinimizerMapper can fix up alignments with deletions on the ends", "[
 }
 
 
+TEST_CASE("MinimizerMapper can reseed many gaps at once", "[giraffe][mapping]") {
+    
+    gbwtgraph::GBWTGraph gbwt_graph;
+    gbwt::GBWT gbwt;
+    gbwt_graph.set_gbwt(gbwt);
+    gbwtgraph::DefaultMinimizerIndex minimizer_index;
+    SnarlDistanceIndex distance_index;
+    PathPositionHandleGraph* handle_graph;
+    TestMinimizerMapper test_mapper (gbwt_graph, minimizer_index, &distance_index, handle_graph);
+    
+    HashGraph graph;
+    auto h1 = graph.create_handle("GATTACA");
+    auto h2 = graph.create_handle("CATTAG");
+    graph.create_edge(h1, h2);
+    
+    // Make minimizers out of order along the read, some of them sharing
+    // occurrences.
+    std::vector<gbwtgraph::DefaultMinimizerIndex::value_type> occurrences(3);
+    std::vector<TestMinimizerMapper::Minimizer> minimizers(6);
+    std::vector<size_t> offsets {30, 2, 12, 5, 20, 14};
+    std::vector<size_t> occurrence_numbers {0, 1, 2, 1, 0, 2};
+    for (size_t i = 0; i < minimizers.size(); i++) {
+        minimizers[i].value.offset = offsets[i];
+        minimizers[i].value.is_reverse = false;
+        minimizers[i].length = 5;
+        minimizers[i].hits = 1;
+        minimizers[i].occs = &occurrences[occurrence_numbers[i]];
+    }
+    VectorView<TestMinimizerMapper::Minimizer> minimizer_view(minimizers);
+    
+    // Each occurrence has one hit, which says which occurrence it is.
+    size_t queries = 0;
+    auto find_hits = [&](const TestMinimizerMapper::Minimizer& m, const std::vector<nid_t>& sorted_ids, const std::function<void(const pos_t&)>& iteratee) {
+        queries++;
+        iteratee(make_pos_t(sorted_ids.front(), false, (size_t) (m.occs - occurrences.data())));
+    };
+    
+    pos_t left {graph.get_id(h1), false, 3};
+    pos_t right {graph.get_id(h2), false, 1};
+    std::vector<TestMinimizerMapper::ReseedGap> gaps {
+        {0, 18, left, right},
+        {0, 40, empty_pos_t(), right},
+        {10, 30, left, empty_pos_t()},
+        {7, 9, left, right}
+    };
+    
+    std::vector<std::vector<TestMinimizerMapper::Seed>> batched = test_mapper.reseed_between(gaps, graph, minimizer_view, find_hits);
+    size_t batched_queries = queries;
+    REQUIRE(batched.size() == gaps.size());
+    
+    queries = 0;
+    for (size_t i = 0; i < gaps.size(); i++) {
+        std::vector<TestMinimizerMapper::Seed> single = test_mapper.reseed_between(gaps[i].read_region_start, gaps[i].read_region_end,
+                                                                                   gaps[i].left_graph_pos, gaps[i].right_graph_pos,
+                                                                                   graph, minimizer_view, find_hits);
+        REQUIRE(single.size() == batched[i].size());
+        for (size_t j = 0; j < single.size(); j++) {
+            REQUIRE(single[j].source == batched[i][j].source);
+            REQUIRE(single[j].pos == batched[i][j].pos);
+        }
+    }
+    
+    // Minimizers in a gap are found in minimizer order
+    // and only if they are entirely inside the gap.
+    REQUIRE(batched[0].size() == 3);
+    REQUIRE(batched[0][0].source == 1);
+    REQUIRE(batched[0][1].source == 2);
+    REQUIRE(batched[0][2].source == 3);
+    REQUIRE(batched[1].size() == 6);
+    REQUIRE(batched[2].size() == 3);
+    REQUIRE(batched[3].empty());
+    
+    // Shared occurrences are only looked up once per gap: 2 + 3 + 2 distinct
+    REQUIRE(batched_queries == 7);
+}
+
+
 }
 
 }
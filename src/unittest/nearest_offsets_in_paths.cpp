@@ -0,0 +1,76 @@
+/// \file unittest/nearest_offsets_in_paths.cpp
+///
+/// Unit tests for the batched nearest_offsets_in_paths
+///
+
+#include "catch.hpp"
+#include "algorithms/nearest_offsets_in_paths.hpp"
+#include "step_position_overlay.hpp"
+
+#include "bdsg/hash_graph.hpp"
+#include "bdsg/overlays/path_position_overlays.hpp"
+
+#include <algorithm>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("Batched nearest_offsets_in_paths finds the same offsets as one position at a time", "[nearest_offsets_in_paths]") {
+
+    bdsg::HashGraph graph;
+    handle_t h1 = graph.create_handle("GATT");
+    handle_t h2 = graph.create_handle("A");
+    handle_t h3 = graph.create_handle("CCC");
+    handle_t h4 = graph.create_handle("TTAG");
+    handle_t h5 = graph.create_handle("C");
+    handle_t h6 = graph.create_handle("GGGGGGGGGG");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h1, h3);
+    graph.create_edge(h2, h4);
+    graph.create_edge(h3, h4);
+    graph.create_edge(h4, h5);
+    graph.create_edge(h5, h6);
+
+    // h3, h5 and h6 are not on the path
+    path_handle_t p = graph.create_path_handle("p");
+    graph.append_step(p, h1);
+    graph.append_step(p, h2);
+    graph.append_step(p, h4);
+
+    bdsg::PositionOverlay pos_graph(&graph);
+    StepPositionOverlay overlay(&pos_graph);
+
+    // every position, repeated enough to be searched in parallel
+    vector<pos_t> positions;
+    while (positions.size() < algorithms::NEAREST_OFFSETS_PARALLEL_BATCH_SIZE) {
+        pos_graph.for_each_handle([&](const handle_t& handle) {
+            for (bool is_reverse : {true, false}) {
+                for (size_t offset = 0; offset < pos_graph.get_length(handle); ++offset) {
+                    positions.push_back(make_pos_t(pos_graph.get_id(handle), is_reverse, offset));
+                }
+            }
+        });
+    }
+
+    for (const PathPositionHandleGraph* g : {(const PathPositionHandleGraph*) &pos_graph, (const PathPositionHandleGraph*) &overlay}) {
+        for (int64_t max_search : {-1, 0, 2, 5, 100}) {
+            auto batched = algorithms::nearest_offsets_in_paths(g, positions, max_search);
+            REQUIRE(batched.size() == positions.size());
+            for (size_t i = 0; i < positions.size(); ++i) {
+                auto truth = algorithms::nearest_offsets_in_paths(&pos_graph, positions[i], max_search);
+                REQUIRE(batched[i].size() == truth.size());
+                for (auto& path_offsets : truth) {
+                    REQUIRE(batched[i].count(path_offsets.first));
+                    auto& found = batched[i].at(path_offsets.first);
+                    sort(path_offsets.second.begin(), path_offsets.second.end());
+                    sort(found.begin(), found.end());
+                    REQUIRE(found == path_offsets.second);
+                }
+            }
+        }
+    }
+}
+
+}
+}
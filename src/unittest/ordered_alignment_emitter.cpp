@@ -0,0 +1,125 @@
+/// \file ordered_alignment_emitter.cpp
+///
+/// unit tests for the AlignmentEmitter that puts output in input order
+///
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <omp.h>
+#include "catch.hpp"
+#include "../ordered_alignment_emitter.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+/// An AlignmentEmitter that remembers the names of what it gets
+class NameRecordingEmitter : public vg::io::AlignmentEmitter {
+public:
+    NameRecordingEmitter(vector<string>& names) : names(names) {}
+
+    virtual void emit_singles(vector<Alignment>&& aln_batch) {
+        lock_guard<mutex> lock(names_mutex);
+        for (auto& aln : aln_batch) {
+            names.push_back(aln.name());
+        }
+    }
+    virtual void emit_mapped_singles(vector<vector<Alignment>>&& alns_batch) {
+        lock_guard<mutex> lock(names_mutex);
+        for (auto& alns : alns_batch) {
+            for (auto& aln : alns) {
+                names.push_back(aln.name());
+            }
+        }
+    }
+    virtual void emit_pairs(vector<Alignment>&& aln1_batch, vector<Alignment>&& aln2_batch,
+                            vector<int64_t>&& tlen_limit_batch) {
+        lock_guard<mutex> lock(names_mutex);
+        for (size_t i = 0; i < aln1_batch.size(); i++) {
+            names.push_back(aln1_batch[i].name());
+            names.push_back(aln2_batch[i].name());
+        }
+    }
+    virtual void emit_mapped_pairs(vector<vector<Alignment>>&& alns1_batch,
+                                   vector<vector<Alignment>>&& alns2_batch, vector<int64_t>&& tlen_limit_batch) {
+        lock_guard<mutex> lock(names_mutex);
+        for (size_t i = 0; i < alns1_batch.size(); i++) {
+            for (auto& aln : alns1_batch[i]) {
+                names.push_back(aln.name());
+            }
+            for (auto& aln : alns2_batch[i]) {
+                names.push_back(aln.name());
+            }
+        }
+    }
+
+private:
+    vector<string>& names;
+    mutex names_mutex;
+};
+
+TEST_CASE("OrderedAlignmentEmitter writes reads in input order", "[ordered_alignment_emitter]") {
+
+    size_t read_count = 500;
+    vector<string> names;
+    {
+        OrderedAlignmentEmitter emitter(unique_ptr<vg::io::AlignmentEmitter>(new NameRecordingEmitter(names)), 4);
+
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(4)
+        for (size_t i = 0; i < read_count; i++) {
+            // Go through the reads backward in chunks, so they finish out of order.
+            size_t number = (i / 50) * 50 + (49 - i % 50);
+            emitter.start_read(number);
+            if (number % 7 == 0) {
+                // Some reads are slow.
+                this_thread::sleep_for(chrono::microseconds(200));
+            }
+            if (number % 5 != 0) {
+                // Some reads don't produce anything.
+                Alignment aln;
+                aln.set_name("read" + to_string(number));
+                if (number % 2 == 0) {
+                    emitter.emit_mapped_single({aln});
+                } else {
+                    Alignment mate;
+                    mate.set_name("mate" + to_string(number));
+                    emitter.emit_pair(std::move(aln), std::move(mate), 0);
+                }
+            }
+            emitter.finish_read();
+        }
+    }
+
+    vector<string> expected;
+    for (size_t number = 0; number < read_count; number++) {
+        if (number % 5 != 0) {
+            expected.push_back("read" + to_string(number));
+            if (number % 2 != 0) {
+                expected.push_back("mate" + to_string(number));
+            }
+        }
+    }
+    REQUIRE(names == expected);
+}
+
+TEST_CASE("OrderedAlignmentEmitter holds up reading until there is room", "[ordered_alignment_emitter]") {
+
+    vector<string> names;
+    OrderedAlignmentEmitter emitter(unique_ptr<vg::io::AlignmentEmitter>(new NameRecordingEmitter(names)), 1);
+
+    // Nothing is written yet, so only the first reads fit.
+    emitter.wait_for_room(9, 10);
+
+    // Once the first read is finished, there is room for one more.
+    emitter.start_read(0);
+    emitter.finish_read();
+    emitter.wait_for_room(10, 10);
+
+    REQUIRE_THROWS(emitter.finish_read());
+}
+
+}
+}
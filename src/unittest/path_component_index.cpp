@@ -4,6 +4,7 @@
 /// Unit tests for PathComponentIndex
 ///
 
+#include <sstream>
 #include "catch.hpp"
 #include "path_component_index.hpp"
 #include "xg.hpp"
@@ -39,6 +40,24 @@ namespace unittest {
                         == (comp_1.count(path_1) == comp_1.count(path_2)));
             });
         });
+        
+        SECTION("A saved index loads with the same components") {
+            stringstream strm;
+            pc_index.serialize(&xg_index, strm);
+            
+            string header;
+            getline(strm, header);
+            REQUIRE(header == PathComponentIndex::HEADER);
+            strm.seekg(0);
+            
+            PathComponentIndex loaded(&xg_index, strm);
+            xg_index.for_each_path_handle([&](const path_handle_t& path_1) {
+                xg_index.for_each_path_handle([&](const path_handle_t& path_2) {
+                    REQUIRE(loaded.paths_on_same_component(path_1, path_2)
+                            == pc_index.paths_on_same_component(path_1, path_2));
+                });
+            });
+        }
     }
 
 }
@@ -0,0 +1,82 @@
+/// \file unittest/path_offset_index.cpp
+///
+/// Unit tests for the PathOffsetIndex
+///
+
+#include "catch.hpp"
+#include "path_offset_index.hpp"
+#include "memoizing_graph.hpp"
+
+#include "bdsg/hash_graph.hpp"
+#include "bdsg/overlays/path_position_overlays.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("PathOffsetIndex finds the offsets and orientations of path visits", "[surject][path_offset_index]") {
+
+    bdsg::HashGraph graph;
+    handle_t h1 = graph.create_handle("GATT");
+    handle_t h2 = graph.create_handle("A");
+    handle_t h3 = graph.create_handle("CA");
+    handle_t h4 = graph.create_handle("TTAG");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h1, h3);
+    graph.create_edge(h2, h4);
+    graph.create_edge(h3, h4);
+    graph.create_edge(h4, graph.flip(h3));
+
+    // p1 visits h3 twice, once in each orientation
+    path_handle_t p1 = graph.create_path_handle("p1");
+    graph.append_step(p1, h1);
+    graph.append_step(p1, h3);
+    graph.append_step(p1, h4);
+    graph.append_step(p1, graph.flip(h3));
+    // p2 is not indexed
+    path_handle_t p2 = graph.create_path_handle("p2");
+    graph.append_step(p2, h1);
+    graph.append_step(p2, h2);
+    graph.append_step(p2, h4);
+
+    bdsg::PositionOverlay pos_graph(&graph);
+    PathOffsetIndex index(pos_graph, {pos_graph.get_path_handle("p1")});
+
+    REQUIRE(index.size() == 4);
+
+    SECTION("Every step on the indexed path is found at its position") {
+        pos_graph.for_each_step_in_path(pos_graph.get_path_handle("p1"), [&](const step_handle_t& step) {
+            handle_t handle = pos_graph.get_handle_of_step(step);
+            size_t offset;
+            REQUIRE(index.find_offset(pos_graph.get_id(handle), step, offset));
+            REQUIRE(offset == pos_graph.get_position_of_step(step));
+        });
+    }
+
+    SECTION("Visits record the orientation of the path on the node") {
+        auto range = index.visits(graph.get_id(h3));
+        REQUIRE(range.second - range.first == 2);
+        REQUIRE(range.first[0].is_reverse != range.first[1].is_reverse);
+        REQUIRE(index.visits(graph.get_id(h2)).first == index.visits(graph.get_id(h2)).second);
+    }
+
+    SECTION("Steps on other paths are not found") {
+        pos_graph.for_each_step_in_path(pos_graph.get_path_handle("p2"), [&](const step_handle_t& step) {
+            size_t offset;
+            REQUIRE(!index.find_offset(pos_graph.get_id(pos_graph.get_handle_of_step(step)), step, offset));
+        });
+    }
+
+    SECTION("MemoizingGraph gives the same positions with and without the index") {
+        MemoizingGraph plain(&pos_graph);
+        MemoizingGraph indexed(&pos_graph, &index);
+        for (const char* name : {"p1", "p2"}) {
+            pos_graph.for_each_step_in_path(pos_graph.get_path_handle(name), [&](const step_handle_t& step) {
+                REQUIRE(indexed.get_position_of_step(step) == plain.get_position_of_step(step));
+            });
+        }
+    }
+}
+
+}
+}
@@ -613,5 +613,60 @@ TEST_CASE("PhaseUnfolder can extend short threads", "[phaseunfolder][indexing]")
     }
 }
 
+
+TEST_CASE("PhaseUnfolder assigns the same ids with any number of threads", "[phaseunfolder][indexing]") {
+
+    // Build an XG index with a path.
+    Graph graph_with_path;
+    json2pb(graph_with_path, unfolder_graph_path.c_str(), unfolder_graph_path.size());
+    xg::XG xg_index;
+    xg_index.from_path_handle_graph(VG(graph_with_path));
+
+    // Build a GBWT with threads in both components.
+    gbwt::vector_type alt_path {
+        static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(1, false)),
+        static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(2, false)),
+        static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(4, false)),
+        static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(5, false)),
+        static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(6, false)),
+        static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(8, false)),
+        static_cast<gbwt::vector_type::value_type>(gbwt::Node::encode(9, false))
+    };
+    std::vector<gbwt::vector_type> gbwt_threads { alt_path };
+    gbwt::GBWT gbwt_index = get_gbwt(gbwt_threads);
+
+    std::set<vg::id_t> to_remove { 3, 4, 7, 8, 9 };
+    auto unfold_with = [&](size_t threads, VG& vg_graph) -> PhaseUnfolder {
+        PhaseUnfolder unfolder(xg_index, gbwt_index, 10);
+        Graph temp_graph;
+        json2pb(temp_graph, unfolder_graph.c_str(), unfolder_graph.size());
+        vg_graph.merge(temp_graph);
+        for (vg::id_t node : to_remove) {
+            vg_graph.destroy_node(node);
+        }
+        int old_threads = omp_get_max_threads();
+        omp_set_num_threads(threads);
+        unfolder.unfold(vg_graph);
+        omp_set_num_threads(old_threads);
+        return unfolder;
+    };
+
+    VG serial_graph, parallel_graph;
+    PhaseUnfolder serial = unfold_with(1, serial_graph);
+    PhaseUnfolder parallel = unfold_with(4, parallel_graph);
+
+    REQUIRE(parallel_graph.get_node_count() == serial_graph.get_node_count());
+    REQUIRE(parallel_graph.get_edge_count() == serial_graph.get_edge_count());
+    serial_graph.for_each_handle([&](const handle_t& handle) {
+        vg::id_t id = serial_graph.get_id(handle);
+        REQUIRE(parallel_graph.has_node(id));
+        REQUIRE(parallel.get_mapping(id) == serial.get_mapping(id));
+        serial_graph.follow_edges(handle, false, [&](const handle_t& next) {
+            REQUIRE(parallel_graph.has_edge(parallel_graph.get_handle(id, false),
+                                            parallel_graph.get_handle(serial_graph.get_id(next), serial_graph.get_is_reverse(next))));
+        });
+    });
+}
+
 }
 }
@@ -0,0 +1,129 @@
+/// \file unittest/pruning_overlay.cpp
+///
+/// Unit tests for the PruningOverlay and pruning through it
+///
+
+#include "catch.hpp"
+#include "random_graph.hpp"
+#include "../pruning_overlay.hpp"
+#include "../algorithms/prune.hpp"
+
+#include "bdsg/hash_graph.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("PruningOverlay hides masked nodes and edges", "[overlay][handle][prune]") {
+
+    bdsg::HashGraph graph;
+    handle_t h1 = graph.create_handle("GATT");
+    handle_t h2 = graph.create_handle("A");
+    handle_t h3 = graph.create_handle("CA");
+    handle_t h4 = graph.create_handle("TTAG");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h1, h3);
+    graph.create_edge(h2, h4);
+    graph.create_edge(h3, h4);
+
+    PruningOverlay pruned(&graph);
+
+    REQUIRE(pruned.get_node_count() == 4);
+
+    SECTION("Masking an edge hides it from both ends") {
+        pruned.mask_edge(make_pair(graph.flip(h3), graph.flip(h1)));
+        REQUIRE(pruned.is_masked(make_pair(h1, h3)));
+        REQUIRE(pruned.get_degree(h1, false) == 1);
+        REQUIRE(pruned.get_degree(h3, true) == 0);
+        REQUIRE(!pruned.has_edge(h1, h3));
+        REQUIRE(pruned.has_edge(h1, h2));
+        // The backing graph is untouched
+        REQUIRE(graph.has_edge(h1, h3));
+    }
+
+    SECTION("Masking a node hides it and its edges, and they don't come back with it") {
+        pruned.mask_node(graph.flip(h2));
+        REQUIRE(!pruned.has_node(graph.get_id(h2)));
+        REQUIRE(pruned.get_node_count() == 3);
+        REQUIRE(pruned.get_degree(h1, false) == 1);
+        size_t seen = 0;
+        pruned.for_each_handle([&](const handle_t& handle) {
+            REQUIRE(graph.get_id(handle) != graph.get_id(h2));
+            seen++;
+        });
+        REQUIRE(seen == 3);
+
+        pruned.unmask_node(h2);
+        REQUIRE(pruned.has_node(graph.get_id(h2)));
+        REQUIRE(pruned.get_degree(h2, false) == 0);
+        REQUIRE(pruned.get_degree(h2, true) == 0);
+
+        pruned.unmask_edge(make_pair(h2, h4));
+        REQUIRE(pruned.has_edge(h2, h4));
+        REQUIRE(!pruned.has_edge(h1, h2));
+    }
+
+    SECTION("Applying the mask deletes what it hides") {
+        pruned.mask_node(h2);
+        pruned.mask_edge(make_pair(h3, h4));
+        auto destroyed = pruned.apply(graph);
+        REQUIRE(destroyed.first == 3);
+        REQUIRE(destroyed.second == 1);
+        REQUIRE(graph.get_node_count() == 3);
+        REQUIRE(graph.get_edge_count() == 1);
+        REQUIRE(graph.has_edge(graph.get_handle(1), graph.get_handle(3)));
+    }
+}
+
+TEST_CASE("Pruning through a PruningOverlay matches pruning a copy", "[overlay][handle][prune]") {
+
+    for (size_t trial = 0; trial < 10; trial++) {
+        bdsg::HashGraph graph;
+        random_graph(2000, 10, 200, &graph);
+
+        bdsg::HashGraph copy;
+        handlealgs::copy_handle_graph(&graph, &copy);
+
+        size_t removed_degree = algorithms::remove_high_degree_nodes(copy, 5);
+        size_t removed_complex = algorithms::prune_complex_with_head_tail(copy, 24, 3);
+        size_t removed_subgraph = algorithms::prune_short_subgraphs(copy, 33);
+
+        PruningOverlay pruned(&graph);
+        REQUIRE(algorithms::remove_high_degree_nodes(pruned, 5) == removed_degree);
+        REQUIRE(algorithms::prune_complex_with_head_tail(pruned, 24, 3) == removed_complex);
+        REQUIRE(algorithms::prune_short_subgraphs(pruned, 33) == removed_subgraph);
+
+        REQUIRE(pruned.get_node_count() == copy.get_node_count());
+        REQUIRE(pruned.get_edge_count() == copy.get_edge_count());
+
+        pruned.apply(graph);
+        REQUIRE(handlealgs::are_equivalent(&graph, &copy));
+    }
+}
+
+TEST_CASE("Paths can be restored through a PruningOverlay", "[overlay][handle][prune]") {
+
+    bdsg::HashGraph graph;
+    random_graph(1000, 10, 150, &graph);
+
+    PruningOverlay pruned(&graph);
+    algorithms::prune_complex_with_head_tail(pruned, 24, 1);
+    algorithms::restore_paths(pruned, graph);
+
+    graph.for_each_path_handle([&](const path_handle_t& path) {
+        handle_t prev;
+        bool first = true;
+        graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+            handle_t curr = graph.get_handle_of_step(step);
+            REQUIRE(pruned.has_node(graph.get_id(curr)));
+            if (!first) {
+                REQUIRE(pruned.has_edge(prev, curr));
+            }
+            first = false;
+            prev = curr;
+        });
+    });
+}
+
+}
+}
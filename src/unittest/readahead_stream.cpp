@@ -0,0 +1,85 @@
+/// \file readahead_stream.cpp
+///
+/// unit tests for reading files ahead of their parsers
+///
+
+#include <fstream>
+#include <iterator>
+#include "../readahead_stream.hpp"
+#include "../utility.hpp"
+#include "catch.hpp"
+
+namespace vg {
+namespace unittest {
+
+    TEST_CASE("ReadaheadInputStream reads files in small chunks", "[readahead][stream]") {
+
+        // make a file much bigger than the chunks and the readahead window
+        string filename = temp_file::create();
+        string contents;
+        for (size_t i = 0; i < 10000; ++i) {
+            contents += to_string(i) + "\n";
+        }
+        {
+            ofstream out(filename);
+            out << contents;
+        }
+
+        REQUIRE(ReadaheadInputStream::can_read(filename));
+        REQUIRE(!ReadaheadInputStream::can_read("-"));
+
+        SECTION("The whole file reads back") {
+            ReadaheadInputStream in(filename, 1000, 2);
+            REQUIRE(in.is_open());
+            string read_back((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+            REQUIRE(read_back == contents);
+        }
+
+        SECTION("Lines read back") {
+            ReadaheadInputStream in(filename, 1000, 2);
+            string line;
+            size_t count = 0;
+            while (getline(in, line)) {
+                REQUIRE(line == to_string(count));
+                count++;
+            }
+            REQUIRE(count == 10000);
+        }
+
+        SECTION("Seeking within and between chunks works") {
+            ReadaheadInputStream in(filename, 1000, 2);
+            char c;
+            in.seekg(10);
+            REQUIRE(in.tellg() == 10);
+            in.get(c);
+            REQUIRE(c == contents[10]);
+
+            // move within the chunk we have
+            in.seekg(500);
+            in.get(c);
+            REQUIRE(c == contents[500]);
+            REQUIRE(in.tellg() == 501);
+
+            // move far ahead and then back again
+            in.seekg(contents.size() - 5);
+            string tail((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+            REQUIRE(tail == contents.substr(contents.size() - 5));
+            in.clear();
+            in.seekg(2500);
+            REQUIRE(in.tellg() == 2500);
+            string middle(3000, '\0');
+            in.read(&middle[0], middle.size());
+            REQUIRE(middle == contents.substr(2500, 3000));
+        }
+
+        temp_file::remove(filename);
+    }
+
+    TEST_CASE("ReadaheadInputStream reports missing files", "[readahead][stream]") {
+        ReadaheadInputStream in("/this/file/does/not/exist.gam");
+        REQUIRE(!in.is_open());
+        REQUIRE(in.fail());
+        REQUIRE(!ReadaheadInputStream::can_read("/this/file/does/not/exist.gam"));
+    }
+}
+}
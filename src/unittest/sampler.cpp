@@ -92,6 +92,31 @@ TEST_CASE( "Sampler can sample from a 1-node graph", "[sampler]" ) {
         
     }
     
+    SECTION( "Sampling in parallel is deterministic for a given seed" ) {
+        
+        Sampler other_sampler(&xg_index, 1337);
+        
+        vector<Alignment> alns(200), other_alns(200);
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < alns.size(); i++) {
+            alns[i] = sampler.alignment_with_error(5, 0.1, 0.0);
+        }
+#pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < other_alns.size(); i++) {
+            other_alns[i] = other_sampler.alignment_with_error(5, 0.1, 0.0);
+        }
+        
+        unordered_set<string> names;
+        for (size_t i = 0; i < alns.size(); i++) {
+            REQUIRE(alns[i].name() == other_alns[i].name());
+            REQUIRE(alns[i].sequence() == other_alns[i].sequence());
+            names.insert(alns[i].name());
+        }
+        
+        // Every read gets its own name
+        REQUIRE(names.size() == alns.size());
+    }
+    
 }
 
 TEST_CASE( "position_at works", "[sampler]" ) {
@@ -297,6 +322,23 @@ TEST_CASE( "Sampler can across reversing edges", "[sampler]" ) {
         
         
     }
+    
+    SECTION( "Precomputed paths give the same reads" ) {
+        
+        sampler.set_source_paths({"ref"}, {}, {}, {});
+        
+        Sampler precomputed_sampler(&xg_index, 1337);
+        precomputed_sampler.set_source_paths({"ref"}, {}, {}, {});
+        precomputed_sampler.precompute_source_paths();
+        
+        for (size_t i = 0; i < 200; i++) {
+            // Include reads that hang off the ends of the path
+            size_t length = 1 + i % 14;
+            Alignment aln = sampler.alignment(length);
+            Alignment precomputed_aln = precomputed_sampler.alignment(length);
+            REQUIRE(pb2json(aln) == pb2json(precomputed_aln));
+        }
+    }
 }
 
 }
@@ -0,0 +1,69 @@
+/// \file scratch_arena.cpp
+///  
+/// Unit tests for the per-thread scratch arena
+///
+
+#include <iostream>
+#include <string>
+#include "../scratch_arena.hpp"
+#include "catch.hpp"
+
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("ScratchArena hands out aligned memory and tracks its high-water mark", "[arena]") {
+    ScratchArena arena(128);
+    
+    char* a = (char*) arena.allocate(3, 1);
+    uint64_t* b = (uint64_t*) arena.allocate(sizeof(uint64_t), alignof(uint64_t));
+    REQUIRE(((uintptr_t) b) % alignof(uint64_t) == 0);
+    a[0] = 'x';
+    *b = 12345;
+    REQUIRE(arena.used() >= 3 + sizeof(uint64_t));
+    
+    // Go past the first block
+    char* big = (char*) arena.allocate(1000, 1);
+    big[999] = 'y';
+    REQUIRE(*b == 12345);
+    REQUIRE(arena.high_water_mark() >= 1011);
+    size_t peak = arena.high_water_mark();
+    
+    arena.reset();
+    REQUIRE(arena.used() == 0);
+    REQUIRE(arena.high_water_mark() == peak);
+    
+    SECTION("After a reset, the same work fits in one block") {
+        size_t capacity = arena.capacity();
+        arena.allocate(3, 1);
+        arena.allocate(sizeof(uint64_t), alignof(uint64_t));
+        arena.allocate(1000, 1);
+        REQUIRE(arena.capacity() == capacity);
+    }
+}
+
+TEST_CASE("ScratchVector works like a vector and is reclaimed by Scope", "[arena]") {
+    ScratchArena& arena = ScratchArena::for_this_thread();
+    {
+        ScratchArena::Scope outer;
+        ScratchVector<int> numbers;
+        for (int i = 0; i < 10000; i++) {
+            numbers.push_back(i);
+        }
+        {
+            ScratchArena::Scope inner;
+            ScratchVector<string> words {"a", "b", "c"};
+            REQUIRE(words.size() == 3);
+        }
+        // The inner scope must not have reset the arena out from under us.
+        REQUIRE(arena.used() > 0);
+        for (int i = 0; i < 10000; i++) {
+            REQUIRE(numbers[i] == i);
+        }
+    }
+    REQUIRE(arena.used() == 0);
+}
+
+}
+}
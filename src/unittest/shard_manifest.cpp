@@ -0,0 +1,70 @@
+/// \file shard_manifest.cpp
+///
+/// unit tests for shard manifests and reading shards as one input
+///
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "../shard_manifest.hpp"
+#include "../utility.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("Shard manifests can be written and read back as one input", "[shard_manifest]") {
+
+    string directory = temp_file::create_directory();
+    vector<string> shards;
+    string expected;
+    for (size_t i = 0; i < 3; i++) {
+        shards.push_back(directory + "/out." + to_string(i) + ".gaf");
+        ofstream out(shards.back());
+        string contents = "shard " + to_string(i) + "\n";
+        if (i == 1) {
+            // Shards can be empty
+            contents.clear();
+        }
+        out << contents;
+        expected += contents;
+    }
+    string manifest = directory + "/out";
+    write_shard_manifest(manifest, shards);
+
+    REQUIRE(is_shard_manifest(manifest));
+    REQUIRE(!is_shard_manifest(shards.front()));
+    REQUIRE(!is_shard_manifest("-"));
+
+    SECTION("The shards are listed relative to the manifest") {
+        ifstream in(manifest);
+        string header, first;
+        getline(in, header);
+        getline(in, first);
+        REQUIRE(header == SHARD_MANIFEST_HEADER);
+        REQUIRE(first == "out.0.gaf");
+        REQUIRE(read_shard_manifest(manifest) == shards);
+        REQUIRE(expand_shard_manifest(manifest) == shards);
+    }
+
+    SECTION("Files that aren't manifests expand to themselves") {
+        REQUIRE(expand_shard_manifest(shards.front()) == vector<string>({shards.front()}));
+    }
+
+    SECTION("The shards read as one file") {
+        string contents;
+        get_input_file(manifest, [&](istream& in) {
+            stringstream buffer;
+            buffer << in.rdbuf();
+            contents = buffer.str();
+        });
+        REQUIRE(contents == expected);
+    }
+
+    temp_file::remove(directory);
+}
+
+}
+}
@@ -12,6 +12,7 @@
 #include "vg/io/json2pb.h"
 #include <vg/vg.pb.h>
 #include "catch.hpp"
+#include <omp.h>
 #include "random_graph.hpp"
 #include "randomness.hpp"
 #include "../snarl_distance_index.hpp"
@@ -7405,5 +7406,36 @@ namespace vg {
                 }
             }
         }
+
+        TEST_CASE("Distance index construction gives the same distances with multiple threads", "[snarl_distance]") {
+            default_random_engine generator(test_seed_source());
+            for (size_t repeat = 0; repeat < 20; repeat++) {
+                VG graph;
+                random_graph(1000, 20, 30, &graph);
+                IntegratedSnarlFinder finder(graph);
+
+                int threads = get_thread_count();
+                omp_set_num_threads(1);
+                SnarlDistanceIndex serial_index;
+                fill_in_distance_index(&serial_index, &graph, &finder);
+                omp_set_num_threads(4);
+                SnarlDistanceIndex parallel_index;
+                fill_in_distance_index(&parallel_index, &graph, &finder);
+                omp_set_num_threads(threads);
+
+                uniform_int_distribution<id_t> random_node_ids(graph.min_node_id(), graph.max_node_id());
+                for (size_t i = 0; i < 100; i++) {
+                    id_t node_id1 = random_node_ids(generator);
+                    id_t node_id2 = random_node_ids(generator);
+                    if (!graph.has_node(node_id1) || !graph.has_node(node_id2)) {
+                        continue;
+                    }
+                    pos_t pos1 = make_pos_t(node_id1, false, 0);
+                    pos_t pos2 = make_pos_t(node_id2, true, 0);
+                    REQUIRE(minimum_distance(serial_index, pos1, pos2) == minimum_distance(parallel_index, pos1, pos2));
+                    REQUIRE(maximum_distance(serial_index, pos1, pos2) == maximum_distance(parallel_index, pos1, pos2));
+                }
+            }
+        }
    }
 }
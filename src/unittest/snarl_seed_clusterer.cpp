@@ -3309,6 +3309,106 @@ namespace unittest {
         REQUIRE(false);
     }
     */
+    TEST_CASE("Parallel clustering matches serial clustering", "[cluster]"){
+        default_random_engine generator(8);
+        HashGraph graph;
+        random_graph({400, 300}, 30, 60, &graph);
+
+        IntegratedSnarlFinder snarl_finder(graph);
+        SnarlDistanceIndex dist_index;
+        fill_in_distance_index(&dist_index, &graph, &snarl_finder);
+        SnarlDistanceIndexClusterer clusterer(dist_index, &graph);
+
+        vector<id_t> all_nodes;
+        graph.for_each_handle([&](const handle_t& h)->bool{
+            all_nodes.push_back(graph.get_id(h));
+            return true;
+        });
+        uniform_int_distribution<int> randPosIndex(0, all_nodes.size()-1);
+
+        for (size_t k = 0; k < 5 ; k++) {
+            vector<SnarlDistanceIndexClusterer::Seed> seeds;
+            for (size_t j = 0; j < 100; j++) {
+                id_t node_id = all_nodes[randPosIndex(generator)];
+                offset_t offset = uniform_int_distribution<int>(0, graph.get_length(graph.get_handle(node_id)) - 1)(generator);
+                seeds.push_back({ make_pos_t(node_id, uniform_int_distribution<int>(0,1)(generator) == 0, offset), 0});
+            }
+
+            vector<SnarlDistanceIndexClusterer::Cluster> serial_clusters = clusterer.cluster_seeds(seeds, 15);
+            vector<SnarlDistanceIndexClusterer::Cluster> parallel_clusters;
+            #pragma omp parallel num_threads(4)
+            {
+                #pragma omp single
+                {
+                    parallel_clusters = clusterer.cluster_seeds(seeds, 15, nullptr, 1);
+                }
+            }
+
+            REQUIRE(parallel_clusters.size() == serial_clusters.size());
+            for (size_t i = 0 ; i < serial_clusters.size() ; i++) {
+                vector<size_t> serial_seeds = serial_clusters[i].seeds;
+                vector<size_t> parallel_seeds = parallel_clusters[i].seeds;
+                std::sort(serial_seeds.begin(), serial_seeds.end());
+                std::sort(parallel_seeds.begin(), parallel_seeds.end());
+                REQUIRE(parallel_seeds == serial_seeds);
+            }
+        }
+    }
+
+    TEST_CASE("Payloads cover nodes off of chains and cluster the same", "[cluster]"){
+        default_random_engine generator(9);
+        HashGraph graph;
+        random_graph({400, 300}, 30, 60, &graph);
+
+        IntegratedSnarlFinder snarl_finder(graph);
+        SnarlDistanceIndex dist_index;
+        fill_in_distance_index(&dist_index, &graph, &snarl_finder);
+        SnarlDistanceIndexClusterer clusterer(dist_index, &graph);
+
+        vector<id_t> all_nodes;
+        graph.for_each_handle([&](const handle_t& h)->bool{
+            all_nodes.push_back(graph.get_id(h));
+            return true;
+        });
+
+        // Every node should get a payload, including the ones that are
+        // trivial chains in non-simple snarls and children of the root.
+        for (id_t node_id : all_nodes) {
+            pos_t pos = make_pos_t(node_id, false, 0);
+            MIPayloadValues values = get_minimizer_distances(dist_index, pos);
+            gbwtgraph::Payload payload = MIPayload::encode(values);
+            REQUIRE(payload != MIPayload::NO_CODE);
+            REQUIRE(MIPayload::prefix_sum(payload) == values.prefix_sum);
+            REQUIRE(MIPayload::chain_component(payload) == values.chain_component);
+            REQUIRE(MIPayload::node_length(payload) == values.node_length);
+        }
+
+        uniform_int_distribution<int> randPosIndex(0, all_nodes.size()-1);
+        for (size_t k = 0; k < 5 ; k++) {
+            vector<SnarlDistanceIndexClusterer::Seed> seeds;
+            vector<SnarlDistanceIndexClusterer::Seed> seeds_with_payloads;
+            for (size_t j = 0; j < 100; j++) {
+                id_t node_id = all_nodes[randPosIndex(generator)];
+                offset_t offset = uniform_int_distribution<int>(0, graph.get_length(graph.get_handle(node_id)) - 1)(generator);
+                pos_t pos = make_pos_t(node_id, uniform_int_distribution<int>(0,1)(generator) == 0, offset);
+                seeds.push_back({ pos, 0});
+                seeds_with_payloads.push_back({ pos, 0, MIPayload::encode(get_minimizer_distances(dist_index, pos))});
+            }
+
+            // Clusters can come out in a different order, so compare them as sets
+            auto to_sets = [](const vector<SnarlDistanceIndexClusterer::Cluster>& clusters) {
+                set<vector<size_t>> result;
+                for (auto& cluster : clusters) {
+                    vector<size_t> cluster_seeds = cluster.seeds;
+                    std::sort(cluster_seeds.begin(), cluster_seeds.end());
+                    result.insert(cluster_seeds);
+                }
+                return result;
+            };
+            REQUIRE(to_sets(clusterer.cluster_seeds(seeds_with_payloads, 15)) == to_sets(clusterer.cluster_seeds(seeds, 15)));
+        }
+    }
+
     TEST_CASE("Random graphs", "[cluster_random]"){
 
 
@@ -8,9 +8,11 @@
 #include <iostream>
 #include <sstream>
 #include <set>
+#include <tuple>
 #include "vg/io/json2pb.h"
 #include <vg/vg.pb.h>
 #include "catch.hpp"
+#include <omp.h>
 #include "random_graph.hpp"
 #include "randomness.hpp"
 #include "../snarls.hpp"
@@ -4088,7 +4090,41 @@ namespace vg {
                     REQUIRE(trav_is_correct);
                 }
             }
-                
+
+            SECTION( "PathTraversalFinder finds the same traversals from its boundary index") {
+
+                CactusSnarlFinder snarl_finder(graph);
+                SnarlManager snarl_manager = snarl_finder.find_snarls();
+                PathTraversalFinder trav_finder(graph, snarl_manager);
+                PathTraversalFinder indexed_trav_finder(graph, snarl_manager);
+
+                vector<const Snarl*> snarls;
+                snarl_manager.for_each_snarl_preorder([&](const Snarl* snarl) {
+                    snarls.push_back(snarl);
+                });
+                REQUIRE(!snarls.empty());
+                indexed_trav_finder.index_snarl_boundaries(snarls);
+
+                for (const Snarl* snarl : snarls) {
+                    auto direct = trav_finder.find_path_traversals(*snarl);
+                    auto indexed = indexed_trav_finder.find_path_traversals(*snarl);
+                    
+                    // they can come out in a different order
+                    multiset<tuple<string, string, string>> direct_travs;
+                    multiset<tuple<string, string, string>> indexed_travs;
+                    for (size_t i = 0; i < direct.first.size(); ++i) {
+                        direct_travs.emplace(pb2json(direct.first[i]),
+                                             graph.get_path_name(graph.get_path_handle_of_step(direct.second[i].first)),
+                                             graph.get_path_name(graph.get_path_handle_of_step(direct.second[i].second)));
+                    }
+                    for (size_t i = 0; i < indexed.first.size(); ++i) {
+                        indexed_travs.emplace(pb2json(indexed.first[i]),
+                                              graph.get_path_name(graph.get_path_handle_of_step(indexed.second[i].first)),
+                                              graph.get_path_name(graph.get_path_handle_of_step(indexed.second[i].second)));
+                    }
+                    REQUIRE(indexed_travs == direct_travs);
+                }
+            }
         }
         
         TEST_CASE("snarls and chains can be found in a graph with lots of root snarl connectivity", "[snarls]") {
@@ -4145,5 +4181,71 @@ namespace vg {
                 });
             }
         }
+        
+        TEST_CASE("Parallel decomposition traversal visits each component's snarls and chains", "[snarls]") {
+            
+            // Make several disconnected copies of a bubble chain, of different sizes
+            VG graph;
+            for (size_t copy = 0; copy < 4; copy++) {
+                Node* prev = graph.create_node("GATT");
+                for (size_t i = 0; i <= copy; i++) {
+                    Node* alt1 = graph.create_node("A");
+                    Node* alt2 = graph.create_node("C");
+                    Node* next = graph.create_node("TACA");
+                    graph.create_edge(prev, alt1);
+                    graph.create_edge(prev, alt2);
+                    graph.create_edge(alt1, next);
+                    graph.create_edge(alt2, next);
+                    prev = next;
+                }
+            }
+            
+            IntegratedSnarlFinder snarl_finder(graph);
+            
+            // Record the top-level chain count and the boundaries of all the snarls
+            auto record = [&](bool parallel) {
+                size_t depth = 0;
+                size_t top_level_chains = 0;
+                vector<handle_t> snarl_starts;
+                set<pair<id_t, id_t>> snarls;
+                auto begin_chain = [&](handle_t handle) {
+                    if (depth == 0) {
+                        top_level_chains++;
+                    }
+                    depth++;
+                };
+                auto end_chain = [&](handle_t handle) {
+                    depth--;
+                };
+                auto begin_snarl = [&](handle_t handle) {
+                    depth++;
+                    snarl_starts.push_back(handle);
+                };
+                auto end_snarl = [&](handle_t handle) {
+                    depth--;
+                    id_t a = graph.get_id(snarl_starts.back());
+                    id_t b = graph.get_id(handle);
+                    snarls.emplace(min(a, b), max(a, b));
+                    snarl_starts.pop_back();
+                };
+                if (parallel) {
+                    snarl_finder.traverse_decomposition_parallel(begin_chain, end_chain, begin_snarl, end_snarl);
+                } else {
+                    snarl_finder.traverse_decomposition(begin_chain, end_chain, begin_snarl, end_snarl);
+                }
+                REQUIRE(depth == 0);
+                return make_pair(top_level_chains, snarls);
+            };
+            
+            int threads = get_thread_count();
+            omp_set_num_threads(4);
+            auto parallel_result = record(true);
+            omp_set_num_threads(threads);
+            auto serial_result = record(false);
+            
+            REQUIRE(parallel_result.first == 4);
+            REQUIRE(parallel_result.first == serial_result.first);
+            REQUIRE(parallel_result.second == serial_result.second);
+        }
     }
 }
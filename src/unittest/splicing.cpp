@@ -7,12 +7,14 @@
 #include <random>
 
 #include "../splicing.hpp"
+#include "../splice_site_index.hpp"
 #include "../multipath_mapper.hpp"
 #include "../integrated_snarl_finder.hpp"
 #include "../build_index.hpp"
 #include "xg.hpp"
 #include "catch.hpp"
 #include "test_aligner.hpp"
+#include "random_graph.hpp"
 
 #include <bdsg/hash_graph.hpp>
 
@@ -242,6 +244,60 @@ TEST_CASE("SpliceRegion can detect a splice sites across node boundaries going l
 
 }
 
+TEST_CASE("SpliceRegion finds the same splice sites with a splice site index",
+          "[splice]") {
+    
+    TestAligner test_aligner;
+    SpliceStats splice_stats(*test_aligner.get_regular_aligner());
+    DinucleotideMachine machine;
+    
+    for (size_t rep = 0; rep < 5; ++rep) {
+        
+        HashGraph graph;
+        random_graph(300, 3, 30, &graph);
+        
+        SpliceSiteIndex splice_site_index(graph, splice_stats);
+        REQUIRE(splice_site_index.covers(splice_stats));
+        
+        // the index should survive a round trip through a stream
+        stringstream strm;
+        splice_site_index.serialize(strm);
+        SpliceSiteIndex loaded_index;
+        loaded_index.load(strm);
+        REQUIRE(loaded_index.covers(splice_stats));
+        
+        stringstream garbage("not an index");
+        SpliceSiteIndex bad_index;
+        REQUIRE_THROWS_AS(bad_index.load(garbage), runtime_error);
+        
+        graph.for_each_handle([&](const handle_t& handle) {
+            for (bool is_reverse : {false, true}) {
+                for (size_t offset = 0; offset < graph.get_length(handle); ++offset) {
+                    pos_t pos(graph.get_id(handle), is_reverse, offset);
+                    for (bool search_left : {false, true}) {
+                        for (int64_t search_dist : {3, 10, 40}) {
+                            SpliceRegion searched(pos, search_left, search_dist, graph, machine, splice_stats);
+                            SpliceRegion indexed(pos, search_left, search_dist, graph, machine, splice_stats,
+                                                 &loaded_index);
+                            for (size_t i = 0; i < splice_stats.motif_size(); ++i) {
+                                auto& searched_sites = searched.candidate_splice_sites(i);
+                                auto& indexed_sites = indexed.candidate_splice_sites(i);
+                                REQUIRE(searched_sites.size() == indexed_sites.size());
+                                for (size_t j = 0; j < searched_sites.size(); ++j) {
+                                    REQUIRE(searched.get_subgraph().get_underlying_handle(get<0>(searched_sites[j]))
+                                            == indexed.get_subgraph().get_underlying_handle(get<0>(indexed_sites[j])));
+                                    REQUIRE(get<1>(searched_sites[j]) == get<1>(indexed_sites[j]));
+                                    REQUIRE(get<2>(searched_sites[j]) == get<2>(indexed_sites[j]));
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
+
 TEST_CASE("Softclip trimming works on a simple example",
           "[splice]") {
     
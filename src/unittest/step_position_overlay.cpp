@@ -0,0 +1,105 @@
+/// \file unittest/step_position_overlay.cpp
+///
+/// Unit tests for the StepPositionOverlay
+///
+
+#include "catch.hpp"
+#include "step_position_overlay.hpp"
+#include "algorithms/nearest_offsets_in_paths.hpp"
+
+#include "bdsg/hash_graph.hpp"
+#include "bdsg/overlays/path_position_overlays.hpp"
+
+#include <algorithm>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("StepPositionOverlay agrees with the graph it indexes", "[surject][step_position_overlay]") {
+
+    bdsg::HashGraph graph;
+    handle_t h1 = graph.create_handle("GATT");
+    handle_t h2 = graph.create_handle("A");
+    handle_t h3 = graph.create_handle("CA");
+    handle_t h4 = graph.create_handle("TTAG");
+    handle_t h5 = graph.create_handle("C");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h1, h3);
+    graph.create_edge(h2, h4);
+    graph.create_edge(h3, h4);
+    graph.create_edge(h4, graph.flip(h3));
+    graph.create_edge(h4, h5);
+
+    // p1 visits h3 twice, once in each orientation
+    path_handle_t p1 = graph.create_path_handle("p1");
+    graph.append_step(p1, h1);
+    graph.append_step(p1, h3);
+    graph.append_step(p1, h4);
+    graph.append_step(p1, graph.flip(h3));
+    // p2 is on the reverse strand
+    path_handle_t p2 = graph.create_path_handle("p2");
+    graph.append_step(p2, graph.flip(h4));
+    graph.append_step(p2, graph.flip(h2));
+    graph.append_step(p2, graph.flip(h1));
+    // h5 is on no path
+
+    bdsg::PositionOverlay pos_graph(&graph);
+    StepPositionOverlay overlay(&pos_graph);
+
+    SECTION("Steps and their positions are the same") {
+        pos_graph.for_each_handle([&](const handle_t& handle) {
+            for (bool is_reverse : {false, true}) {
+                handle_t oriented = is_reverse ? pos_graph.flip(handle) : handle;
+                for (bool match_orientation : {false, true}) {
+                    auto truth = pos_graph.steps_of_handle(oriented, match_orientation);
+                    auto found = overlay.steps_of_handle(oriented, match_orientation);
+                    sort(truth.begin(), truth.end());
+                    sort(found.begin(), found.end());
+                    REQUIRE(found == truth);
+                }
+                for (auto& step : overlay.steps_of_handle(oriented)) {
+                    REQUIRE(overlay.get_position_of_step(step) == pos_graph.get_position_of_step(step));
+                }
+            }
+        });
+        for (auto path : {p1, p2}) {
+            REQUIRE(overlay.get_path_length(path) == pos_graph.get_path_length(path));
+        }
+    }
+
+    SECTION("Visit arrays record the orientation of the path on the node") {
+        auto range = overlay.visit_range(graph.get_id(h3));
+        REQUIRE(range.second - range.first == 2);
+        REQUIRE(overlay.visit_is_reverse(range.first) != overlay.visit_is_reverse(range.first + 1));
+        range = overlay.visit_range(graph.get_id(h5));
+        REQUIRE(range.first == range.second);
+        range = overlay.visit_range(graph.max_node_id() + 1);
+        REQUIRE(range.first == range.second);
+    }
+
+    SECTION("Nearest path offsets are the same") {
+        pos_graph.for_each_handle([&](const handle_t& handle) {
+            for (bool is_reverse : {false, true}) {
+                for (size_t offset = 0; offset < pos_graph.get_length(handle); ++offset) {
+                    pos_t pos = make_pos_t(pos_graph.get_id(handle), is_reverse, offset);
+                    for (int64_t max_search : {0, 2, 10}) {
+                        auto truth = algorithms::nearest_offsets_in_paths(&pos_graph, pos, max_search);
+                        auto found = algorithms::nearest_offsets_in_paths(&overlay, pos, max_search);
+                        REQUIRE(found.size() == truth.size());
+                        for (auto& path_offsets : truth) {
+                            REQUIRE(found.count(path_offsets.first));
+                            auto& found_offsets = found.at(path_offsets.first);
+                            sort(path_offsets.second.begin(), path_offsets.second.end());
+                            sort(found_offsets.begin(), found_offsets.end());
+                            REQUIRE(found_offsets == path_offsets.second);
+                        }
+                    }
+                }
+            }
+        });
+    }
+}
+
+}
+}
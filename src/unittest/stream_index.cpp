@@ -5,6 +5,7 @@
 ///
 
 #include <iostream>
+#include <list>
 #include "catch.hpp"
 #include "../stream_index.hpp"
 #include <vg/io/stream.hpp>
@@ -410,6 +411,65 @@ TEST_CASE("GAMIndex can work with ProtobufIterator cursors", "[gam][gamindex]")
     
 }
 
+TEST_CASE("GAMIndex can answer batches of queries", "[gam][gamindex]") {
+    stringstream file;
+    
+    // Make groups of one-node alignments, with two alignments to each node
+    id_t next_id = 1;
+    for (size_t group_number = 0; group_number < 50; group_number++) {
+        vector<Alignment> group;
+        for (size_t i = 0; i < 100; i++) {
+            group.emplace_back();
+            Alignment& aln = group.back();
+            aln.mutable_path()->add_mapping()->mutable_position()->set_node_id(next_id);
+            aln.set_sequence(random_sequence(100));
+            next_id += i % 2;
+        }
+        vg::io::write_buffered(file, group, 0);
+    }
+    
+    GAMIndex index;
+    {
+        GAMIndex::cursor_t cursor(file);
+        index.index(cursor);
+    }
+    
+    // Give every thread its own copy of the data to read
+    list<stringstream> streams;
+    vector<GAMIndex::cursor_t> cursors;
+    for (size_t i = 0; i < 4; i++) {
+        streams.emplace_back(file.str());
+        cursors.emplace_back(streams.back());
+    }
+    
+    // Make overlapping, nested, adjacent, and out of range queries
+    vector<vector<pair<id_t, id_t>>> queries {
+        {{1, 10}},
+        {{5, 20}, {400, 450}},
+        {{8, 9}},
+        {{21, 30}},
+        {{1000, 1200}},
+        {{2400, 2600}},
+        {{3000, 4000}}
+    };
+    
+    vector<vector<id_t>> found(queries.size());
+    index.find_batch(cursors, queries, [&](size_t query, const Alignment& aln) {
+        found.at(query).push_back(aln.path().mapping(0).position().node_id());
+    });
+    
+    for (size_t i = 0; i < queries.size(); i++) {
+        // We should get the same reads, in the same order, as querying alone
+        vector<id_t> truth;
+        index.find(cursors.front(), queries[i], [&](const Alignment& aln) {
+            truth.push_back(aln.path().mapping(0).position().node_id());
+        });
+        REQUIRE(found[i] == truth);
+    }
+    REQUIRE(found[0].size() == 20);
+    REQUIRE(found[1].size() == 32 + 102);
+    REQUIRE(found[6].empty());
+}
 
 }
 }
@@ -127,6 +127,94 @@ TEST_CASE( "Spliced surject algorithm preserves deletions against the path", "[s
     
 }
 
+TEST_CASE( "Alignments that lie along a path are surjected in place", "[surject]" ) {
+    
+    bdsg::HashGraph graph;
+    handle_t h1 = graph.create_handle("GTCGT");
+    handle_t h2 = graph.create_handle("ACC");
+    handle_t h3 = graph.create_handle("TCCTTGC");
+    handle_t h4 = graph.create_handle("G");
+    
+    graph.create_edge(h1, h2);
+    graph.create_edge(h2, h3);
+    graph.create_edge(h1, h4);
+    graph.create_edge(h4, h3);
+    
+    path_handle_t p = graph.create_path_handle("p");
+    graph.append_step(p, h1);
+    graph.append_step(p, h2);
+    graph.append_step(p, h3);
+    
+    bdsg::PositionOverlay pos_graph(&graph);
+    Surjector surjector(&pos_graph);
+    unordered_set<path_handle_t> paths{p};
+    
+    // make a read along the nodes, starting and ending partway through the outer ones
+    auto make_read = [&](const vector<handle_t>& read_path, size_t first_offset, size_t last_length) {
+        Alignment read;
+        string seq;
+        Path* rpath = read.mutable_path();
+        for (size_t i = 0; i < read_path.size(); ++i) {
+            handle_t h = read_path[i];
+            size_t offset = (i == 0 ? first_offset : 0);
+            size_t length = (i + 1 == read_path.size() ? last_length : pos_graph.get_length(h) - offset);
+            Mapping* m = rpath->add_mapping();
+            m->set_rank(rpath->mapping_size());
+            m->mutable_position()->set_node_id(pos_graph.get_id(h));
+            m->mutable_position()->set_is_reverse(pos_graph.get_is_reverse(h));
+            m->mutable_position()->set_offset(offset);
+            Edit* e = m->add_edit();
+            e->set_from_length(length);
+            e->set_to_length(length);
+            seq += pos_graph.get_sequence(h).substr(offset, length);
+        }
+        read.set_sequence(seq);
+        read.set_score(Aligner().score_contiguous_alignment(read));
+        return read;
+    };
+    
+    SECTION("Forward strand of path") {
+        Alignment read = make_read({h1, h2, h3}, 2, 4);
+        Alignment surjected = surjector.surject(read, paths);
+        
+        REQUIRE(surjected.path().mapping_size() == 3);
+        for (size_t i = 0; i < read.path().mapping_size(); ++i) {
+            REQUIRE(surjected.path().mapping(i).position().node_id() == read.path().mapping(i).position().node_id());
+            REQUIRE(surjected.path().mapping(i).position().offset() == read.path().mapping(i).position().offset());
+            REQUIRE(!surjected.path().mapping(i).position().is_reverse());
+        }
+        REQUIRE(surjected.score() == read.score());
+        REQUIRE(surjected.refpos_size() == 1);
+        REQUIRE(surjected.refpos(0).name() == graph.get_path_name(p));
+        REQUIRE(surjected.refpos(0).offset() == 2);
+        REQUIRE(!surjected.refpos(0).is_reverse());
+    }
+    
+    SECTION("Reverse strand of path") {
+        Alignment read = make_read({graph.flip(h3), graph.flip(h2), graph.flip(h1)}, 3, 3);
+        Alignment surjected = surjector.surject(read, paths);
+        
+        REQUIRE(surjected.path().mapping_size() == 3);
+        REQUIRE(surjected.score() == read.score());
+        REQUIRE(surjected.refpos_size() == 1);
+        REQUIRE(surjected.refpos(0).name() == graph.get_path_name(p));
+        REQUIRE(surjected.refpos(0).offset() == 2);
+        REQUIRE(surjected.refpos(0).is_reverse());
+    }
+    
+    SECTION("Reads that leave the path are still realigned to it") {
+        Alignment read = make_read({h1, h4, h3}, 2, 4);
+        Alignment surjected = surjector.surject(read, paths);
+        
+        REQUIRE(surjected.path().mapping_size() != 0);
+        for (size_t i = 0; i < surjected.path().mapping_size(); ++i) {
+            REQUIRE(surjected.path().mapping(i).position().node_id() != graph.get_id(h4));
+        }
+        REQUIRE(surjected.refpos_size() == 1);
+        REQUIRE(surjected.refpos(0).name() == graph.get_path_name(p));
+    }
+}
+
 TEST_CASE( "Spliced surject algorithm works when a read touches the same path in both orientations", "[surject]" ) {
     
     bdsg::HashGraph graph;
@@ -0,0 +1,50 @@
+/// \file unittest/telemetry.cpp
+///
+/// Unit tests for the Telemetry throughput reporter
+///
+
+#include "catch.hpp"
+#include "../telemetry.hpp"
+#include "../utility.hpp"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("Telemetry reports the reads counted from all threads", "[telemetry]") {
+
+    string filename = temp_file::create();
+    {
+        Telemetry telemetry(4, chrono::milliseconds(10), filename);
+        for (size_t thread = 0; thread < 4; thread++) {
+            for (size_t i = 0; i < 25; i++) {
+                telemetry.count_read(thread, 150);
+            }
+        }
+        this_thread::sleep_for(chrono::milliseconds(100));
+    }
+
+    vector<string> lines;
+    ifstream in(filename);
+    string line;
+    while (getline(in, line)) {
+        lines.push_back(line);
+    }
+    temp_file::remove(filename);
+
+    // We get periodic reports, and then the final one with everything.
+    REQUIRE(lines.size() >= 2);
+    REQUIRE(lines.back().find("\"final\": true") != string::npos);
+    REQUIRE(lines.back().find("\"reads\": 100,") != string::npos);
+    REQUIRE(lines.back().find("\"bases\": 15000,") != string::npos);
+    for (size_t i = 0; i + 1 < lines.size(); i++) {
+        REQUIRE(lines[i].find("\"final\": false") != string::npos);
+    }
+}
+
+}
+}
@@ -375,6 +375,36 @@ namespace vg {
                     REQUIRE(seq_hap_transcript_paths.back() == "TTTTGGACTTT");
                 }
 
+                SECTION("Transcriptome can stream transcripts projected onto GBWT haplotypes") {
+
+                    std::stringstream fasta_stream;
+
+                    TranscriptPathOutput path_output;
+                    path_output.fasta_ostream = &fasta_stream;
+
+                    REQUIRE(transcriptome.add_haplotype_transcripts(vector<istream *>({&transcript_stream}), *haplotype_index, false, &path_output) == 2);
+
+                    REQUIRE(transcriptome.transcript_paths().size() == 3);
+                    REQUIRE(transcriptome.reference_transcript_paths().size() == 3);
+                    REQUIRE(transcriptome.haplotype_transcript_paths().size() == 1);
+
+                    // Streamed paths and the reference path they collapsed
+                    // with should be the same as when projecting without streaming.
+                    auto seq_hap_transcript_paths = transcript_paths_to_sequences(transcriptome.haplotype_transcript_paths(), transcriptome.graph());
+
+                    string fasta_line;
+                    while (getline(fasta_stream, fasta_line)) {
+
+                        if (!fasta_line.empty() && fasta_line.front() != '>') {
+
+                            seq_hap_transcript_paths.emplace_back(fasta_line);
+                        }
+                    }
+
+                    sort(seq_hap_transcript_paths.begin(), seq_hap_transcript_paths.end());
+                    REQUIRE(seq_hap_transcript_paths == vector<string>({"AAAGTTTAAA", "TTTAAAA", "TTTTGGACTTT"}));
+                }
+
                 SECTION("Transcriptome can project transcripts onto embedded paths and GBWT haplotypes") {
 
                     transcriptome.add_haplotype_transcripts(vector<istream *>({&transcript_stream}), *haplotype_index, true);
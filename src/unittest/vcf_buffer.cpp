@@ -136,5 +136,39 @@ ref	18	rs1342	A	G	29	PASS	.	GT
     
 }
 
+TEST_CASE( "VcfBuffer prefetching reads the same variants", "[vcfbuffer][vcf]" ) {
+
+    auto vcf_data = R"(##fileformat=VCFv4.0
+##FORMAT=<ID=GT,Number=1,Type=String,Description="Genotype">
+#CHROM	POS	ID	REF	ALT	QUAL	FILTER	INFO	FORMAT
+ref	5	rs1337	A	G	29	PASS	.	GT
+ref	7	rs1338	A	G	29	PASS	.	GT
+ref	7	rs1339	A	T	29	PASS	.	GT
+ref	8	rs1340	A	G	29	PASS	.	GT
+ref	17	rs1341	A	G	29	PASS	.	GT
+ref2	18	rs1342	A	G	29	PASS	.	GT
+)";
+
+    for (size_t prefetch : {0, 1, 2, 100}) {
+        std::stringstream vcf_stream(vcf_data);
+        vcflib::VariantCallFile vcf;
+        vcf.open(vcf_stream);
+        
+        VcfBuffer buffer(&vcf, prefetch);
+        vector<string> seen;
+        buffer.fill_buffer();
+        while (buffer.get() != nullptr) {
+            seen.push_back(buffer.get()->sequenceName + ":" + buffer.get()->id);
+            buffer.handle_buffer();
+            buffer.fill_buffer();
+        }
+        // Asking again at the end is safe
+        buffer.fill_buffer();
+        REQUIRE(buffer.get() == nullptr);
+        
+        REQUIRE(seen == vector<string>({"ref:rs1337", "ref:rs1338", "ref:rs1339", "ref:rs1340", "ref:rs1341", "ref2:rs1342"}));
+    }
+}
+
 }
 }
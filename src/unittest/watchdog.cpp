@@ -0,0 +1,51 @@
+/// \file watchdog.cpp
+///  
+/// unit tests for the Watchdog's latency tracking
+///
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "catch.hpp"
+#include "../watchdog.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("Watchdog keeps the slowest tasks", "[watchdog]") {
+
+    Watchdog watchdog(2, chrono::seconds(60));
+    watchdog.keep_slowest(2);
+
+    size_t descriptions = 0;
+    for (size_t i = 0; i < 4; i++) {
+        // Task i takes about i * 5 ms, alternating between threads.
+        watchdog.check_in(i % 2, "task" + to_string(i));
+        this_thread::sleep_for(chrono::milliseconds(i * 5));
+        watchdog.check_out(i % 2, [&]() {
+            descriptions++;
+            return "task" + to_string(i) + "\n";
+        });
+    }
+    // Each thread can keep 2, so every task got described.
+    REQUIRE(descriptions == 4);
+
+    stringstream slowest;
+    watchdog.write_slowest(slowest);
+    REQUIRE(slowest.str() == "task3\ntask2\n");
+
+    SECTION("Latency histogram counts every task") {
+        // A task checked out without a description is still counted.
+        watchdog.check_in(0, "task4");
+        watchdog.check_out(0);
+
+        stringstream report;
+        watchdog.report_latency(report);
+        REQUIRE(report.str().find("(5 tasks)") != string::npos);
+    }
+}
+
+}
+}
@@ -0,0 +1,99 @@
+/// \file work_stealing_scheduler.cpp
+///  
+/// unit tests for the work-stealing read scheduler
+///
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <vg/vg.pb.h>
+#include "catch.hpp"
+#include "../work_stealing_scheduler.hpp"
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+TEST_CASE("WorkStealingScheduler processes every item exactly once", "[work_stealing_scheduler]") {
+
+    size_t item_count = 1000;
+    int old_threads = omp_get_max_threads();
+    omp_set_num_threads(4);
+
+    for (size_t batch_size : {1, 7, 64, 2000}) {
+        vector<atomic<size_t>> times_seen(item_count);
+        for (auto& count : times_seen) {
+            count = 0;
+        }
+        size_t next_item = 0;
+        // Note which items were processed before we allowed parallelism.
+        vector<size_t> serial_order;
+
+        WorkStealingScheduler<size_t> scheduler(batch_size, 2);
+        size_t processed = scheduler.run([&](size_t& item) {
+            if (next_item >= item_count) {
+                return false;
+            }
+            item = next_item++;
+            return true;
+        }, [&](size_t& item) {
+            if (item % 97 == 0) {
+                // Some items are slow.
+                this_thread::sleep_for(chrono::milliseconds(2));
+            }
+            if (item < 10) {
+                serial_order.push_back(item);
+            }
+            times_seen[item]++;
+        }, [&]() {
+            return next_item >= 10;
+        });
+
+        REQUIRE(processed == item_count);
+        for (auto& count : times_seen) {
+            REQUIRE(count == 1);
+        }
+        REQUIRE(serial_order.size() == 10);
+        for (size_t i = 0; i < serial_order.size(); i++) {
+            REQUIRE(serial_order[i] == i);
+        }
+    }
+
+    omp_set_num_threads(old_threads);
+}
+
+TEST_CASE("WorkStealingScheduler handles empty input", "[work_stealing_scheduler]") {
+    WorkStealingScheduler<size_t> scheduler(10);
+    size_t processed = scheduler.run([&](size_t& item) {
+        return false;
+    }, [&](size_t& item) {
+        FAIL("No items should be processed");
+    });
+    REQUIRE(processed == 0);
+    REQUIRE(scheduler.items_stolen() == 0);
+}
+
+TEST_CASE("WorkStealingScheduler puts protobuf items in its batch arenas", "[work_stealing_scheduler]") {
+    size_t next_item = 0;
+    atomic<size_t> on_arena(0);
+    WorkStealingScheduler<Alignment> scheduler(16);
+    size_t processed = scheduler.run([&](Alignment& aln) {
+        if (next_item >= 100) {
+            return false;
+        }
+        aln.set_name("read" + to_string(next_item++));
+        aln.set_sequence("GATTACA");
+        aln.mutable_path()->add_mapping()->add_edit()->set_from_length(7);
+        return true;
+    }, [&](Alignment& aln) {
+        if (aln.GetArena() != nullptr && aln.path().mapping(0).edit(0).from_length() == 7) {
+            on_arena++;
+        }
+    });
+    REQUIRE(processed == 100);
+    REQUIRE(on_arena == 100);
+}
+
+}
+}
@@ -0,0 +1,76 @@
+/// \file unittest/zstdutil.cpp
+///
+/// Unit tests for the zstd compression helpers
+///
+
+#include "catch.hpp"
+#include "../zstdutil.hpp"
+
+#include <string>
+#include <vector>
+
+namespace vg {
+namespace unittest {
+using namespace std;
+
+static string make_record(size_t i) {
+    return "chr1\t" + to_string(1000 + 17 * i) + "\t.\tACGT\tA\t" + to_string(i % 60) + "\tPASS\tAT=>1>2>" + to_string(i % 7) + "\tGT\t0|1";
+}
+
+TEST_CASE("Parallel and streaming zstd compression round trip", "[zstdutil]") {
+
+    string data;
+    for (size_t i = 0; i < 50000; ++i) {
+        data += make_record(i) + "\n";
+    }
+
+    SECTION("Parallel compression can be decompressed in one go") {
+        string compressed, decompressed;
+        REQUIRE(zstdutil::ParallelCompressString(data, compressed, 4) == 0);
+        REQUIRE(compressed.size() < data.size());
+        REQUIRE(zstdutil::DecompressString(compressed, decompressed) == 0);
+        REQUIRE(decompressed == data);
+    }
+
+    SECTION("A stream written in pieces is one frame") {
+        string compressed, decompressed;
+        {
+            zstdutil::StreamCompressor compressor(compressed, zstdutil::DEFAULTCOMPRESSLEVEL, 2);
+            for (size_t i = 0; i < data.size(); i += 1000) {
+                REQUIRE(compressor.Write(data.data() + i, min<size_t>(1000, data.size() - i)) == 0);
+            }
+            REQUIRE(compressor.Finish() == 0);
+        }
+        REQUIRE(zstdutil::StreamDecompressString(compressed, decompressed) == 0);
+        REQUIRE(decompressed == data);
+    }
+}
+
+TEST_CASE("Records compressed with a trained dictionary round trip", "[zstdutil]") {
+
+    vector<string> samples;
+    for (size_t i = 0; i < 2000; ++i) {
+        samples.push_back(make_record(i));
+    }
+    string dict;
+    REQUIRE(zstdutil::TrainDictionary(samples, dict, 4096) == 0);
+    REQUIRE(!dict.empty());
+
+    zstdutil::Dictionary dictionary(dict);
+    size_t with_dict = 0, without_dict = 0;
+    for (size_t i = 5000; i < 5100; ++i) {
+        string record = make_record(i);
+        string compressed, plain_compressed, decompressed;
+        REQUIRE(dictionary.CompressString(record, compressed) == 0);
+        REQUIRE(dictionary.DecompressString(compressed, decompressed) == 0);
+        REQUIRE(decompressed == record);
+        REQUIRE(zstdutil::CompressString(record, plain_compressed) == 0);
+        with_dict += compressed.size();
+        without_dict += plain_compressed.size();
+    }
+    // The point of the dictionary is to make small records smaller.
+    REQUIRE(with_dict < without_dict);
+}
+
+}
+}
@@ -1,7 +1,10 @@
 #include "utility.hpp"
 #include "statistics.hpp"
+#include "shard_manifest.hpp"
+#include "readahead_stream.hpp"
 
 #include <set>
+#include <map>
 #include <mutex>
 #include <dirent.h>
 #include <thread>
@@ -11,6 +14,11 @@
 #include <iostream>
 #include <cctype>
 
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
 
 // For setting the temporary directory in submodules.
 #include <gcsa/utils.h>
@@ -155,6 +163,99 @@ void choose_good_thread_count() {
     }
 }
 
+int pin_threads_across_sockets() {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return 0;
+    }
+    
+    // Group the CPUs we may use by the socket they are on
+    map<int, vector<int>> cpus_by_socket;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        int socket = 0;
+        ifstream socket_file("/sys/devices/system/cpu/cpu" + to_string(cpu) + "/topology/physical_package_id");
+        if (socket_file) {
+            socket_file >> socket;
+        }
+        cpus_by_socket[socket].push_back(cpu);
+    }
+    if (cpus_by_socket.empty()) {
+        return 0;
+    }
+    
+    // Deal the CPUs out one socket at a time
+    vector<int> cpu_order;
+    for (size_t i = 0; cpu_order.size() < (size_t) CPU_COUNT(&allowed); i++) {
+        for (auto& socket_cpus : cpus_by_socket) {
+            if (i < socket_cpus.second.size()) {
+                cpu_order.push_back(socket_cpus.second[i]);
+            }
+        }
+    }
+    
+    // OMP keeps its threads around between parallel sections, so each one
+    // only needs to be pinned once.
+    bool pinned = true;
+#pragma omp parallel
+    {
+        cpu_set_t target;
+        CPU_ZERO(&target);
+        CPU_SET(cpu_order[omp_get_thread_num() % cpu_order.size()], &target);
+        if (sched_setaffinity(0, sizeof(target), &target) != 0) {
+#pragma omp atomic write
+            pinned = false;
+        }
+    }
+    return pinned ? cpus_by_socket.size() : 0;
+#else
+    return 0;
+#endif
+}
+
+bool set_numa_interleave(bool interleave) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    // These come from linux/mempolicy.h, which we don't want to need libnuma for.
+    const int MPOL_DEFAULT_POLICY = 0;
+    const int MPOL_INTERLEAVE_POLICY = 3;
+    if (!interleave) {
+        return syscall(SYS_set_mempolicy, MPOL_DEFAULT_POLICY, nullptr, 0) == 0;
+    }
+    
+    // Read the online nodes, which are listed like "0-1,4"
+    ifstream online_file("/sys/devices/system/node/online");
+    string online;
+    if (!(online_file >> online)) {
+        return false;
+    }
+    vector<unsigned long> node_mask;
+    vector<string> ranges;
+    for (const string& range : split_delims(online, ",", ranges)) {
+        size_t dash = range.find('-');
+        int first = stoi(range.substr(0, dash));
+        int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+        for (int node = first; node <= last; node++) {
+            size_t word = node / (8 * sizeof(unsigned long));
+            if (word >= node_mask.size()) {
+                node_mask.resize(word + 1, 0);
+            }
+            node_mask[word] |= 1ul << (node % (8 * sizeof(unsigned long)));
+        }
+    }
+    if (node_mask.empty()) {
+        return false;
+    }
+    // The kernel wants one more than the highest node bit it should look at.
+    return syscall(SYS_set_mempolicy, MPOL_INTERLEAVE_POLICY, node_mask.data(), node_mask.size() * 8 * sizeof(unsigned long) + 1) == 0;
+#else
+    return false;
+#endif
+}
+
 std::vector<std::string> &split_delims(const std::string &s, const std::string& delims, std::vector<std::string> &elems, size_t max_cuts) {
     size_t start = string::npos;
     size_t cuts = 0;
@@ -617,6 +718,18 @@ void get_input_file(const string& file_name, function<void(istream&)> callback)
     if (file_name == "-") {
         // Just use standard input
         callback(std::cin);
+    } else if (is_shard_manifest(file_name)) {
+        // Read all the shards as one file
+        ConcatenatedInputStream in(read_shard_manifest(file_name));
+        callback(in);
+    } else if (ReadaheadInputStream::can_read(file_name)) {
+        // Read big regular files ahead of whatever parses them
+        ReadaheadInputStream in(file_name);
+        if (!in.is_open()) {
+            cerr << "error:[get_input_file] could not open file \"" << file_name << "\"" << endl;
+            exit(1);
+        }
+        callback(in);
     } else {
         // Open a file
         ifstream in;
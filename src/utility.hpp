@@ -41,6 +41,14 @@ int get_thread_count(void);
 /// OMP_NUM_THREADS if set, the "hardware concurrency", and container limit
 /// information that may be available in /proc.
 void choose_good_thread_count();
+/// Pin each OMP thread to its own CPU, dealing the threads out to the CPU
+/// sockets in turn so that each socket runs an even share of them. Returns the
+/// number of sockets used, or 0 if threads can't be pinned on this platform.
+int pin_threads_across_sockets();
+/// Have the memory that the calling thread allocates from now on be
+/// interleaved across all the NUMA nodes, or go back to allocating on the local
+/// node if false. Returns false if memory policy can't be set on this platform.
+bool set_numa_interleave(bool interleave);
 string wrap_text(const string& str, size_t width);
 bool is_number(const string& s);
 
@@ -801,8 +809,9 @@ string get_input_file_name(int& optind, int argc, char** argv, bool test_open =
 string get_output_file_name(int& optind, int argc, char** argv);
 
 /// Get a callback with an istream& to an open file. Handles "-" as a filename as
-/// indicating standard input. The reference passed is guaranteed to be valid
-/// only until the callback returns.
+/// indicating standard input, and reads all the shards of a shard manifest
+/// (see shard_manifest.hpp) as one file. The reference passed is guaranteed to
+/// be valid only until the callback returns.
 void get_input_file(const string& file_name, function<void(istream&)> callback);
 
 /// Split off the extension from a filename and return both parts. 
@@ -27,6 +27,28 @@ void VcfBuffer::handle_buffer() {
 }
 
 void VcfBuffer::fill_buffer() {
+    if (prefetch != 0) {
+        if (file != nullptr && file->is_open() && !has_buffer && safe_to_get) {
+            if (!prefetch_thread.joinable()) {
+                start_prefetch();
+            }
+            unique_lock<mutex> lock(prefetch_mutex);
+            prefetch_changed.wait(lock, [&]() {
+                return !prefetched.empty() || prefetch_done;
+            });
+            if (prefetched.empty()) {
+                // The background thread hit the end of the file.
+                safe_to_get = false;
+            } else {
+                buffer = std::move(prefetched.front());
+                prefetched.pop_front();
+                has_buffer = true;
+                lock.unlock();
+                prefetch_changed.notify_all();
+            }
+        }
+        return;
+    }
     if(file != nullptr && file->is_open() && !has_buffer && safe_to_get) {
         // Put a new variant in the buffer if we have a file and the buffer was empty.
         has_buffer = safe_to_get = file->getNextVariant(buffer);
@@ -46,7 +68,8 @@ bool VcfBuffer::set_region(const string& contig, int64_t start, int64_t end) {
         return false;
     }
 
-    // Discard any variants we had.
+    // Discard any variants we had, including any read ahead.
+    stop_prefetch();
     has_buffer = false;
     
     // Remember that we can get the next variant now, in case we had hit the end
@@ -62,7 +85,7 @@ bool VcfBuffer::set_region(const string& contig, int64_t start, int64_t end) {
     }
 }
 
-VcfBuffer::VcfBuffer(vcflib::VariantCallFile* file) : file(file) {
+VcfBuffer::VcfBuffer(vcflib::VariantCallFile* file, size_t prefetch) : file(file), prefetch(prefetch) {
     // Our buffer needs to know about the VCF file it is reading from, because
     // it cares about the sample names. If it's not associated properely, we
     // can't getNextVariant into it.
@@ -72,8 +95,58 @@ VcfBuffer::VcfBuffer(vcflib::VariantCallFile* file) : file(file) {
     }
 }
 
+VcfBuffer::~VcfBuffer() {
+    stop_prefetch();
+}
+
+void VcfBuffer::start_prefetch() {
+    prefetch_done = false;
+    prefetch_stop = false;
+    prefetch_thread = thread([this]() {
+        while (true) {
+            vcflib::Variant variant(*file);
+            // Read and parse outside the lock; nothing else touches the file
+            // while we run.
+            bool got = file->getNextVariant(variant);
+            
+            unique_lock<mutex> lock(prefetch_mutex);
+            if (!got) {
+                prefetch_done = true;
+                lock.unlock();
+                prefetch_changed.notify_all();
+                return;
+            }
+            prefetched.emplace_back(std::move(variant));
+            lock.unlock();
+            prefetch_changed.notify_all();
+            
+            lock.lock();
+            prefetch_changed.wait(lock, [&]() {
+                return prefetched.size() < prefetch || prefetch_stop;
+            });
+            if (prefetch_stop) {
+                return;
+            }
+        }
+    });
+}
+
+void VcfBuffer::stop_prefetch() {
+    if (prefetch_thread.joinable()) {
+        {
+            lock_guard<mutex> lock(prefetch_mutex);
+            prefetch_stop = true;
+        }
+        prefetch_changed.notify_all();
+        prefetch_thread.join();
+    }
+    prefetched.clear();
+    prefetch_done = false;
+    prefetch_stop = false;
+}
+
 
-WindowedVcfBuffer::WindowedVcfBuffer(vcflib::VariantCallFile* file, size_t window_size): reader(file), window_size(window_size) {
+WindowedVcfBuffer::WindowedVcfBuffer(vcflib::VariantCallFile* file, size_t window_size, size_t prefetch): reader(file, prefetch), window_size(window_size) {
     // Nothing to do!
 }
 
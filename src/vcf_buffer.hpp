@@ -6,7 +6,11 @@
  * look-ahead.
  */
 
+#include <condition_variable>
+#include <deque>
 #include <list>
+#include <mutex>
+#include <thread>
 #include <tuple>
 
 // We need vcflib
@@ -75,8 +79,18 @@ public:
     /**
      * Make a new VcfBuffer buffering the file at the given pointer (which must
      * outlive the buffer, but which may be null).
+     *
+     * If prefetch is nonzero, a background thread reads and parses up to
+     * that many variants ahead, so decompression and parsing overlap with
+     * whatever the caller does with each variant. The file must then not be
+     * used except through this buffer while the buffer exists.
+     */
+    VcfBuffer(vcflib::VariantCallFile* file = nullptr, size_t prefetch = 0);
+    
+    /**
+     * Stop any background reading.
      */
-    VcfBuffer(vcflib::VariantCallFile* file = nullptr);
+    ~VcfBuffer();
     
 protected:
     
@@ -92,6 +106,26 @@ protected:
     // We can wrap the null file (and never have any variants) with a null here.
     vcflib::VariantCallFile* const file;
     
+    // How many variants to read ahead in the background, or 0 to read them
+    // when asked for.
+    size_t prefetch;
+    // This is the background reading thread, if running.
+    thread prefetch_thread;
+    // This protects the read-ahead state below.
+    mutex prefetch_mutex;
+    // This is signaled when either side of the read-ahead queue changes.
+    condition_variable prefetch_changed;
+    // This holds variants read ahead, in order.
+    deque<vcflib::Variant> prefetched;
+    // This is set when the background thread hits the end of the file.
+    bool prefetch_done = false;
+    // This is set to ask the background thread to stop.
+    bool prefetch_stop = false;
+    
+    /// Start reading ahead in the background.
+    void start_prefetch();
+    /// Stop reading ahead in the background and forget what was read.
+    void stop_prefetch();
     
 
 private:
@@ -116,8 +150,11 @@ public:
      * Make a new WindowedVcfBuffer buffering the file at the given pointer
      * (which must outlive the buffer, but which may be null). The VCF in the
      * file must be sorted, but may contain overlapping variants.
+     *
+     * If prefetch is nonzero, up to that many variants are read ahead in the
+     * background, as for VcfBuffer.
      */
-    WindowedVcfBuffer(vcflib::VariantCallFile* file, size_t window_size);
+    WindowedVcfBuffer(vcflib::VariantCallFile* file, size_t window_size, size_t prefetch = 0);
     
     /**
      * Advance to the next variant, making it the current variant. Returns true
@@ -2374,7 +2374,7 @@ void VG::sort() {
         return;
     }
     
-    apply_ordering(handlealgs::topological_order(this));
+    apply_ordering(algorithms::component_topological_order(this));
 }
     
 void VG::id_sort() {
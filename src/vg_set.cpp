@@ -30,19 +30,24 @@ void VGset::transform(std::function<void(MutableHandleGraph*)> lambda) {
     }
 }
 
+unique_ptr<HandleGraph> VGset::load_graph(const string& name) {
+    unique_ptr<HandleGraph> g;
+    get_input_file(name, [&](istream& in) {
+            g = vg::io::VPKG::load_one<HandleGraph>(in);
+        });
+    // legacy:
+    VG* vg_g = dynamic_cast<VG*>(g.get());
+    if (vg_g != nullptr) {
+        vg_g->name = name;
+    }
+    return g;
+}
+
 void VGset::for_each(std::function<void(HandleGraph*)> lambda) {
     // TODO: add a way to cache graphs here for multiple scans
     for (auto& name : filenames) {
         // load
-        unique_ptr<HandleGraph> g;
-        get_input_file(name, [&](istream& in) {
-                g = vg::io::VPKG::load_one<HandleGraph>(in);
-            });
-        // legacy:
-        VG* vg_g = dynamic_cast<VG*>(g.get());
-        if (vg_g != nullptr) {
-            vg_g->name = name;
-        }        
+        unique_ptr<HandleGraph> g = load_graph(name);
         // apply
         lambda(g.get());
     }
@@ -78,46 +83,95 @@ void VGset::to_xg(xg::XG& index) {
 
 void VGset::to_xg(xg::XG& index, const function<bool(const string&)>& paths_to_remove, map<string, Path>* removed_paths) {
 
-    // We make multiple passes through the input graphs, loading each and going through its nodes/edges/paths.
-    // TODO: This is going to go load all the graphs multiple times, even if there's only one graph!
-    // TODO: streaming HandleGraph API?
-    // TODO: push-driven XG build?
-    // TODO: XG::from_path_handle_graphs?
+    // XG construction goes through the nodes, edges, and paths several times,
+    // so we load every graph once, all at the same time, on all our threads,
+    // and work out the node order and the paths to keep for each one while
+    // we are at it.
+    vector<unique_ptr<HandleGraph>> graphs(filenames.size());
+    vector<vector<handle_t>> node_orders(filenames.size());
+    vector<vector<path_handle_t>> kept_paths(filenames.size());
+    vector<vector<path_handle_t>> dropped_paths(filenames.size());
     
-    // We need to recostruct full removed paths from fragmentary paths encountered in each chunk.
-    // This maps from path name to all the Mappings in the path in the order we encountered them
-    auto for_each_sequence = [&](const std::function<void(const std::string& seq, const nid_t& node_id)>& lambda) {
-        for_each([&](HandleGraph* graph) {
-            // For each graph in the set
-            
-            // ID-sort its handles. This is the order that we have historically
-            // used, and may be required for e.g. vg map to work correctly.
-            // TODO: Compute this only once and not each time we want to visit
-            // all the nodes during XG construction?
-            vector<handle_t> order;
-            // TODO: reserve if counting handles will be efficient. Can we know?
-            graph->for_each_handle([&](const handle_t& h) {
-                order.push_back(h);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        graphs[i] = load_graph(filenames[i]);
+        HandleGraph* graph = graphs[i].get();
+        
+        // ID-sort its handles. This is the order that we have historically
+        // used, and may be required for e.g. vg map to work correctly.
+        vector<handle_t>& order = node_orders[i];
+        order.reserve(graph->get_node_count());
+        graph->for_each_handle([&](const handle_t& h) {
+            order.push_back(h);
+        });
+        std::sort(order.begin(), order.end(), [&](const handle_t& a, const handle_t& b) {
+            // Return true if a must come first
+            // We know everything is locally forward already.
+            return graph->get_id(a) < graph->get_id(b);
+        });
+        
+        // Look at each graph and see if it has path support
+        PathHandleGraph* path_graph = dynamic_cast<PathHandleGraph*>(graph);
+        if (path_graph != nullptr) {
+            path_graph->for_each_path_handle([&](const path_handle_t& p) {
+                if (paths_to_remove(path_graph->get_path_name(p))) {
+                    dropped_paths[i].push_back(p);
+                } else {
+                    kept_paths[i].push_back(p);
+                }
             });
-            std::sort(order.begin(), order.end(), [&](const handle_t& a, const handle_t& b) {
-                // Return true if a must come first
-                // We know everything is locally forward already.
-                return graph->get_id(a) < graph->get_id(b);
+        }
+    }
+    
+    if (removed_paths != nullptr) {
+        // When we filter out a path, we need to send our caller a Protobuf
+        // version of it. Make those in parallel over all the dropped paths.
+        vector<pair<size_t, path_handle_t>> to_convert;
+        for (size_t i = 0; i < dropped_paths.size(); ++i) {
+            for (const path_handle_t& p : dropped_paths[i]) {
+                to_convert.emplace_back(i, p);
+            }
+        }
+        vector<Path> proto_paths(to_convert.size());
+        
+#pragma omp parallel for schedule(dynamic, 1)
+        for (size_t j = 0; j < to_convert.size(); ++j) {
+            const PathHandleGraph* path_graph = dynamic_cast<const PathHandleGraph*>(graphs[to_convert[j].first].get());
+            const path_handle_t& p = to_convert[j].second;
+            Path& proto_path = proto_paths[j];
+            proto_path.set_name(path_graph->get_path_name(p));
+            proto_path.set_is_circular(path_graph->get_is_circular(p));
+            size_t rank = 1;
+            path_graph->for_each_step_in_path(p, [&](const step_handle_t& s) {
+                handle_t stepped_on = path_graph->get_handle_of_step(s);
+                
+                Mapping* mapping = proto_path.add_mapping();
+                mapping->mutable_position()->set_node_id(path_graph->get_id(stepped_on));
+                mapping->mutable_position()->set_is_reverse(path_graph->get_is_reverse(stepped_on));
+                mapping->set_rank(rank++);
             });
-            
-            for (const handle_t& h : order) {
+        }
+        for (Path& proto_path : proto_paths) {
+            string path_name = proto_path.name();
+            removed_paths->emplace(std::move(path_name), std::move(proto_path));
+        }
+    }
+    
+    auto for_each_sequence = [&](const std::function<void(const std::string& seq, const nid_t& node_id)>& lambda) {
+        for (size_t i = 0; i < graphs.size(); ++i) {
+            for (const handle_t& h : node_orders[i]) {
                 // For each node in the graph, tell the XG about it.
                 // Assume it is locally forward.
 #ifdef debug
-                cerr << "Yield node " << graph->get_id(h) << " sequence " << graph->get_sequence(h) << endl;
+                cerr << "Yield node " << graphs[i]->get_id(h) << " sequence " << graphs[i]->get_sequence(h) << endl;
 #endif
-                lambda(graph->get_sequence(h), graph->get_id(h));
+                lambda(graphs[i]->get_sequence(h), graphs[i]->get_id(h));
             }
-        });
+        }
     };
 
     auto for_each_edge = [&](const std::function<void(const nid_t& from, const bool& from_rev, const nid_t& to, const bool& to_rev)>& lambda) {
-        for_each([&](HandleGraph* graph) {
+        for (auto& graph : graphs) {
             // For each graph in the set
             graph->for_each_edge([&](const edge_t& e) {
                 // For each edge in the graph, tell the XG about it
@@ -129,7 +183,7 @@ void VGset::to_xg(xg::XG& index, const function<bool(const string&)>& paths_to_r
                 
                 lambda(graph->get_id(e.first), graph->get_is_reverse(e.first), graph->get_id(e.second), graph->get_is_reverse(e.second));
             });
-        });
+        }
     };
     
     // We no longer need to reconstitute paths ourselves; we require that each
@@ -139,74 +193,45 @@ void VGset::to_xg(xg::XG& index, const function<bool(const string&)>& paths_to_r
                                      const nid_t& node_id, const bool& is_rev,
                                      const std::string& cigar,
                                      bool is_empty, bool is_circular)>& lambda) {
-                                 
-        for_each([&](HandleGraph* graph) {
-            // Look at each graph and see if it has path support
-            // TODO: do we need a different for_each to push this down to the loader?
-            PathHandleGraph* path_graph = dynamic_cast<PathHandleGraph*>(graph);
-            if (path_graph != nullptr) {
-                // The graph we loaded actually can have paths, so it can have visits
-                path_graph->for_each_path_handle([&](const path_handle_t& p) {
-                    // For each path
-                    
-                    // Get its metadata
-                    string path_name = path_graph->get_path_name(p);
-                    bool is_circular = path_graph->get_is_circular(p);
-                    
-                    if(paths_to_remove(path_name)) {
-                        // We want to filter out this path
-                        if (removed_paths != nullptr) {
-                            // When we filter out a path, we need to send our caller a Protobuf version of it.
-                            Path proto_path;
-                            proto_path.set_name(path_name);
-                            proto_path.set_is_circular(is_circular);
-                            size_t rank = 1;
-                            path_graph->for_each_step_in_path(p, [&](const step_handle_t& s) {
-                                handle_t stepped_on = path_graph->get_handle_of_step(s);
-                                
-                                Mapping* mapping = proto_path.add_mapping();
-                                mapping->mutable_position()->set_node_id(path_graph->get_id(stepped_on));
-                                mapping->mutable_position()->set_is_reverse(path_graph->get_is_reverse(stepped_on));
-                                mapping->set_rank(rank++);
-                            });
-                            removed_paths->emplace(std::move(path_name), std::move(proto_path));
-                        }
-                    } else {
-                        // We want to leave this path in
-                    
-                        // Assume it is empty
-                        bool is_empty = true;
-                        
-                        path_graph->for_each_step_in_path(p, [&](const step_handle_t& s) {
-                            // For each visit on the path
-                            handle_t stepped_on = path_graph->get_handle_of_step(s);
-                            // The path can't be empty
-                            is_empty = false;
-                            // Tell the XG about it
+        
+        for (size_t i = 0; i < graphs.size(); ++i) {
+            const PathHandleGraph* path_graph = dynamic_cast<const PathHandleGraph*>(graphs[i].get());
+            for (const path_handle_t& p : kept_paths[i]) {
+                // Get its metadata
+                string path_name = path_graph->get_path_name(p);
+                bool is_circular = path_graph->get_is_circular(p);
+                
+                // Assume it is empty
+                bool is_empty = true;
+                
+                path_graph->for_each_step_in_path(p, [&](const step_handle_t& s) {
+                    // For each visit on the path
+                    handle_t stepped_on = path_graph->get_handle_of_step(s);
+                    // The path can't be empty
+                    is_empty = false;
+                    // Tell the XG about it
 #ifdef debug
-                            cerr << "Yield path " << path_name << " visit to "
-                                << path_graph->get_id(stepped_on) << " " << path_graph->get_is_reverse(stepped_on) << endl;
+                    cerr << "Yield path " << path_name << " visit to "
+                        << path_graph->get_id(stepped_on) << " " << path_graph->get_is_reverse(stepped_on) << endl;
 #endif
-                            lambda(path_name, path_graph->get_id(stepped_on), path_graph->get_is_reverse(stepped_on), "", is_empty, is_circular); 
-                        });
-                        
-                        if (is_empty) {
-                            // If the path is empty, tell the XG that.
-                            // It still could be circular.
-                            
+                    lambda(path_name, path_graph->get_id(stepped_on), path_graph->get_is_reverse(stepped_on), "", is_empty, is_circular); 
+                });
+                
+                if (is_empty) {
+                    // If the path is empty, tell the XG that.
+                    // It still could be circular.
+                    
 #ifdef debug
-                            cerr << "Yield empty path " << path_name << endl;
+                    cerr << "Yield empty path " << path_name << endl;
 #endif
-                            
-                            lambda(path_name, 0, false, "", is_empty, is_circular);
-                        }
-                    }
-                });
+                    
+                    lambda(path_name, 0, false, "", is_empty, is_circular);
+                }
             }
-        });
+        }
     };
     
-    // Now build the xg graph, looping over all our graphs in our set whenever we want anything.
+    // Now build the xg graph from the graphs we loaded.
     index.from_enumerators(for_each_sequence, for_each_edge, for_each_path_element, false);
 }
 
@@ -292,8 +317,10 @@ vector<string> VGset::write_gcsa_kmers_binary(int kmer_size, size_t& size_limit,
         tail_id = max_id + 2;
     }
 
+    // All the graphs' kmers share one size budget. Each graph's kmers are sharded
+    // into one file per thread, so the threads never wait on each other to write.
     vector<string> tmpnames;
-    size_t total_size = 0;
+    atomic<size_t> total_size(0);
     for_each([&](HandleGraph* g) {
         // Make an overlay for each graph, without modifying it. Break into tip-less cycle components.
         // Make sure to use a consistent head and tail ID across all graphs in the set.
@@ -303,9 +330,11 @@ vector<string> VGset::write_gcsa_kmers_binary(int kmer_size, size_t& size_limit,
         head_id = overlay.get_id(overlay.get_source_handle());
         tail_id = overlay.get_id(overlay.get_sink_handle());
         
-        size_t current_bytes = size_limit - total_size;
         try {
-            tmpnames.push_back(write_gcsa_kmers_to_tmpfile(overlay, kmer_size, current_bytes, head_id, tail_id));
+            for (string& tmpname : write_gcsa_kmers_to_tmpfiles(overlay, kmer_size, total_size, size_limit,
+                                                                 head_id, tail_id)) {
+                tmpnames.emplace_back(std::move(tmpname));
+            }
         }
         catch (SizeLimitExceededException& ex) {
             // clean up the temporary files before continuing to throw the exception
@@ -314,7 +343,6 @@ vector<string> VGset::write_gcsa_kmers_binary(int kmer_size, size_t& size_limit,
             }
             throw ex;
         }
-        total_size += current_bytes;
     });
     size_limit = total_size;
     return tmpnames;
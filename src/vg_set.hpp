@@ -36,7 +36,8 @@ public:
     /// necessary when storing many graphs in the same index
     int64_t merge_id_space(void);
 
-    /// Transforms to a succinct, queryable representation
+    /// Transforms to a succinct, queryable representation. All the graphs
+    /// are loaded into memory at once, in parallel.
     void to_xg(xg::XG& index);
 
     /// As above, except paths with names matching the given predicate are removed.
@@ -66,6 +67,11 @@ public:
 
     // Use progress bars if show_progress is true?
     bool progress_bars = true;
+    
+private:
+    
+    /// Load one of the graphs
+    unique_ptr<HandleGraph> load_graph(const string& name);
 };
 
 }
@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <cassert>
+#include <algorithm>
 
 #include "memusage.hpp"
 
@@ -48,6 +49,10 @@ void Watchdog::check_in(size_t thread, const string& task) {
 }
 
 void Watchdog::check_out(size_t thread) {
+    check_out(thread, nullptr);
+}
+
+void Watchdog::check_out(size_t thread, const function<string(void)>& describe) {
     // Find the state for the thread we are talking about
     auto& t = state.at(thread); 
 
@@ -61,11 +66,28 @@ void Watchdog::check_out(size_t thread) {
             " but is trying to check out again!");
     }
     
+    // How long was the thread checked in?
+    duration checked_in_duration = clock::now() - t.last_checkin;
+    t.latency_histogram[latency_bucket(checked_in_duration)]++;
+    
+    if (slowest_count > 0 && describe &&
+        (t.slowest.size() < slowest_count || checked_in_duration > t.slowest.front().first)) {
+        // This is one of the slowest tasks so far, so keep a record of it.
+        auto faster = [](const pair<duration, string>& a, const pair<duration, string>& b) {
+            return a.first > b.first;
+        };
+        if (t.slowest.size() >= slowest_count) {
+            // Drop the fastest one we have.
+            pop_heap(t.slowest.begin(), t.slowest.end(), faster);
+            t.slowest.pop_back();
+        }
+        t.slowest.emplace_back(checked_in_duration, describe());
+        push_heap(t.slowest.begin(), t.slowest.end(), faster);
+    }
+    
     if (t.timed_out) {
         // The thread already hit the timeout and we reported a warning. We should follow up.
         
-        // How long was the thread checked in?
-        auto checked_in_duration = clock::now() - t.last_checkin;
         auto checked_in_seconds = chrono::duration_cast<chrono::seconds>(checked_in_duration);
         
         // While it was checked in, how much did the high water memory usage mark rise
@@ -81,6 +103,78 @@ void Watchdog::check_out(size_t thread) {
     t.is_checked_in = false;
 }
 
+void Watchdog::keep_slowest(size_t count) {
+    slowest_count = count;
+    for (auto& t : state) {
+        lock_guard<mutex> lock(t.access_mutex);
+        t.slowest.reserve(count);
+    }
+}
+
+size_t Watchdog::latency_bucket(const duration& elapsed) {
+    // Bucket i holds tasks taking [2^i, 2^(i+1)) microseconds, except that
+    // bucket 0 also has the faster ones.
+    auto microseconds = chrono::duration_cast<chrono::microseconds>(elapsed).count();
+    size_t bucket = 0;
+    while (microseconds > 1 && bucket + 1 < LATENCY_BUCKETS) {
+        microseconds >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void Watchdog::report_latency(ostream& out) {
+    size_t histogram[LATENCY_BUCKETS] = {};
+    size_t total = 0;
+    for (auto& t : state) {
+        lock_guard<mutex> lock(t.access_mutex);
+        for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+            histogram[i] += t.latency_histogram[i];
+            total += t.latency_histogram[i];
+        }
+    }
+    
+    if (total == 0) {
+        return;
+    }
+    
+    out << "Task latency histogram (" << total << " tasks):" << endl;
+    size_t so_far = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        if (histogram[i] == 0) {
+            continue;
+        }
+        so_far += histogram[i];
+        out << "\t";
+        if (i == 0) {
+            out << "<2 us";
+        } else if (i + 1 == LATENCY_BUCKETS) {
+            out << ">=" << (1ull << i) << " us";
+        } else {
+            out << (1ull << i) << "-" << (1ull << (i + 1)) << " us";
+        }
+        out << "\t" << histogram[i] << "\t" << (100.0 * so_far / total) << "% cumulative" << endl;
+    }
+}
+
+void Watchdog::write_slowest(ostream& out) {
+    vector<pair<duration, string>> all_slowest;
+    for (auto& t : state) {
+        lock_guard<mutex> lock(t.access_mutex);
+        all_slowest.insert(all_slowest.end(), t.slowest.begin(), t.slowest.end());
+    }
+    // Each thread kept its own slowest, so we only want the slowest of those.
+    sort(all_slowest.begin(), all_slowest.end(), [](const pair<duration, string>& a, const pair<duration, string>& b) {
+        return a.first > b.first;
+    });
+    if (all_slowest.size() > slowest_count) {
+        all_slowest.resize(slowest_count);
+    }
+    for (auto& record : all_slowest) {
+        out << record.second;
+    }
+}
+
 void Watchdog::watcher_loop() {
     while (!stop_watcher) {
         // Keep looping until we're asked to shut down
@@ -12,6 +12,8 @@
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <functional>
+#include <ostream>
 
 namespace vg {
 
@@ -26,6 +28,10 @@ using namespace std;
  * All synchronization is managed internally. Threads are responsible for
  * knowing their ID numbers, and we can only handle a certain number of
  * threads.
+ *
+ * Every check-in to check-out interval is also counted in a per-thread
+ * latency histogram, and the slowest few tasks can be kept so they can be
+ * written out at the end of the run.
  */
 class Watchdog {
 
@@ -58,6 +64,38 @@ public:
      */
     void check_out(size_t thread);
     
+    /**
+     * Check the given thread out of the task it is checked in for. If the
+     * task was one of the slowest seen, call describe to get a record of it
+     * (such as the read in FASTA format) to keep for write_slowest().
+     * describe is not called for tasks that are not being kept.
+     */
+    void check_out(size_t thread, const function<string(void)>& describe);
+    
+    /**
+     * Keep records for up to the given number of the slowest tasks. Must be
+     * called before any thread checks in.
+     */
+    void keep_slowest(size_t count);
+    
+    /**
+     * Write a latency histogram over all threads' tasks so far to the given
+     * stream. Must not be called while threads are checking in and out.
+     */
+    void report_latency(ostream& out);
+    
+    /**
+     * Write the records kept for the slowest tasks to the given stream, from
+     * slowest to fastest. Must not be called while threads are checking in
+     * and out.
+     */
+    void write_slowest(ostream& out);
+    
+    /// How many power-of-two latency buckets do we count tasks in? The first
+    /// is for tasks under 2 microseconds, and the last holds everything too
+    /// slow for the others.
+    static const size_t LATENCY_BUCKETS = 32;
+    
 private:
     // Since we are accessed by the watcher thread, we can't be copied or moved
     
@@ -92,6 +130,11 @@ protected:
         size_t checkin_high_water_kb;
         /// What task did the thread last check into?
         string task_name;
+        /// How many tasks took each power-of-two number of microseconds?
+        size_t latency_histogram[LATENCY_BUCKETS] = {};
+        /// Records of the slowest tasks the thread has done, as a min-heap
+        /// on how long they took.
+        vector<pair<duration, string>> slowest;
     };
     
     /// Holds the state of each thread, along with its mutex.
@@ -100,6 +143,9 @@ protected:
     /// How long should we give a task to be checked in before complaining?
     duration timeout;
     
+    /// How many of the slowest tasks should each thread keep records for?
+    size_t slowest_count = 0;
+    
     /// What's the most recent process memory high water mark estimate?
     /// We report on this when tasks take a long time in case they also are using a lot of memory.
     atomic<size_t> memory_high_water_kb;
@@ -110,6 +156,9 @@ protected:
     /// Function run in the watcher thread.
     void watcher_loop();
     
+    /// Get the latency histogram bucket for a task that took the given time.
+    static size_t latency_bucket(const duration& elapsed);
+    
 };
 
 }
@@ -0,0 +1,260 @@
+#ifndef VG_WORK_STEALING_SCHEDULER_HPP_INCLUDED
+#define VG_WORK_STEALING_SCHEDULER_HPP_INCLUDED
+
+/** \file
+ * work_stealing_scheduler.hpp: defines WorkStealingScheduler, for spreading
+ * reads over OpenMP threads without letting slow reads hold up whole batches.
+ */
+
+#include <omp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <google/protobuf/arena.h>
+#include <google/protobuf/message.h>
+
+namespace vg {
+
+using namespace std;
+
+/**
+ * Says how to make an item in a batch's Arena. Protobuf messages are made as
+ * arena messages, so all of their nested messages and strings come from the
+ * arena too; anything else is just constructed there. Specialize this for
+ * aggregates of messages that should all live in the arena.
+ */
+template<typename Item, typename Enabled = void>
+struct ArenaItem {
+    static Item* create(google::protobuf::Arena* arena) {
+        return google::protobuf::Arena::Create<Item>(arena);
+    }
+};
+
+template<typename Item>
+struct ArenaItem<Item, typename enable_if<is_base_of<google::protobuf::Message, Item>::value>::type> {
+    static Item* create(google::protobuf::Arena* arena) {
+        return google::protobuf::Arena::CreateMessage<Item>(arena);
+    }
+};
+
+/**
+ * Reads items (reads or read pairs) from a source in batches and processes
+ * them in parallel with OpenMP tasks.
+ *
+ * Each batch is a task, but its items are claimed one at a time, so a thread
+ * that runs out of its own batch takes unclaimed items from batches other
+ * threads are still working through. When the input runs out, extra tasks are
+ * made that only steal, so the threads that would otherwise sit idle at the
+ * end of the input help finish the last batches. A batch containing a few
+ * pathological reads then only holds one thread for as long as those reads
+ * take.
+ *
+ * Each batch's items are allocated in a protobuf Arena (see ArenaItem),
+ * so a batch of reads is freed all at once when its last item is done,
+ * instead of one nested message at a time.
+ *
+ * Items are processed on OpenMP team threads, so omp_get_thread_num() is
+ * valid for things like Watchdog check-ins. Processing order is not
+ * preserved.
+ */
+template<typename Item>
+class WorkStealingScheduler {
+public:
+
+    /**
+     * Make a scheduler that reads batch_size items at a time, and keeps at
+     * most max_batches_in_flight batches unfinished at once. If
+     * max_batches_in_flight is 0, allow a few per thread.
+     */
+    WorkStealingScheduler(size_t batch_size, size_t max_batches_in_flight = 0);
+
+    /**
+     * Call lambda on every item that get_item produces, until get_item
+     * returns false. Until single_threaded_until_true returns true, items are
+     * processed one at a time in order on the calling thread; it is checked
+     * before the first item and after each one. Returns the number of items
+     * processed.
+     */
+    size_t run(const function<bool(Item&)>& get_item,
+               const function<void(Item&)>& lambda,
+               const function<bool(void)>& single_threaded_until_true = []() { return true; });
+
+    /// How many items have been processed by a thread that didn't get their batch?
+    size_t items_stolen() const;
+
+private:
+
+    struct Batch {
+        /// Where the items live. Declared first so it is destroyed last.
+        google::protobuf::Arena arena;
+        vector<Item*> items;
+        /// Index of the next item nobody has claimed
+        atomic<size_t> next_item {0};
+    };
+
+    /// Claim and process items from the batch until it has none left.
+    /// Returns the number of items processed.
+    size_t drain(Batch& batch, const function<void(Item&)>& lambda);
+
+    /// Get a batch with items still to claim, or null if there are none.
+    shared_ptr<Batch> find_work();
+
+    /// Drain the given batch (if any), and then steal until there is nothing
+    /// left to steal.
+    void work(shared_ptr<Batch> home, const function<void(Item&)>& lambda);
+
+    size_t batch_size;
+    size_t max_batches_in_flight;
+
+    /// Batches that may still have unclaimed items.
+    list<shared_ptr<Batch>> active;
+    mutex active_mutex;
+
+    /// Number of items read but not yet finished.
+    atomic<size_t> items_in_flight {0};
+    atomic<size_t> stolen {0};
+};
+
+//------------------------------------------------------------------------------
+
+template<typename Item>
+WorkStealingScheduler<Item>::WorkStealingScheduler(size_t batch_size, size_t max_batches_in_flight) :
+    batch_size(std::max<size_t>(batch_size, 1)),
+    max_batches_in_flight(max_batches_in_flight != 0 ? max_batches_in_flight : 4 * omp_get_max_threads()) {
+    // Nothing to do
+}
+
+template<typename Item>
+size_t WorkStealingScheduler<Item>::items_stolen() const {
+    return stolen.load();
+}
+
+template<typename Item>
+size_t WorkStealingScheduler<Item>::drain(Batch& batch, const function<void(Item&)>& lambda) {
+    size_t processed = 0;
+    for (size_t i = batch.next_item.fetch_add(1); i < batch.items.size(); i = batch.next_item.fetch_add(1)) {
+        lambda(*batch.items[i]);
+        items_in_flight.fetch_sub(1);
+        processed++;
+    }
+    return processed;
+}
+
+template<typename Item>
+shared_ptr<typename WorkStealingScheduler<Item>::Batch> WorkStealingScheduler<Item>::find_work() {
+    lock_guard<mutex> lock(active_mutex);
+    while (!active.empty()) {
+        if (active.front()->next_item.load() < active.front()->items.size()) {
+            // Take from the oldest batch, so batches finish in roughly the
+            // order they were read.
+            return active.front();
+        }
+        // Everything in this batch is claimed already.
+        active.pop_front();
+    }
+    return nullptr;
+}
+
+template<typename Item>
+void WorkStealingScheduler<Item>::work(shared_ptr<Batch> home, const function<void(Item&)>& lambda) {
+    if (home) {
+        drain(*home, lambda);
+    }
+    for (shared_ptr<Batch> other = find_work(); other; other = find_work()) {
+        stolen.fetch_add(drain(*other, lambda));
+    }
+}
+
+template<typename Item>
+size_t WorkStealingScheduler<Item>::run(const function<bool(Item&)>& get_item,
+                                        const function<void(Item&)>& lambda,
+                                        const function<bool(void)>& single_threaded_until_true) {
+    size_t item_count = 0;
+    #pragma omp parallel
+    {
+        #pragma omp single
+        {
+            bool multi_threaded = single_threaded_until_true();
+            bool more = true;
+            while (more && !multi_threaded) {
+                // Process items in order until we're allowed to go parallel.
+                google::protobuf::Arena arena;
+                Item& item = *ArenaItem<Item>::create(&arena);
+                more = get_item(item);
+                if (more) {
+                    lambda(item);
+                    item_count++;
+                    multi_threaded = single_threaded_until_true();
+                }
+            }
+
+            while (more) {
+                shared_ptr<Batch> batch = make_shared<Batch>();
+                batch->items.reserve(batch_size);
+                while (batch->items.size() < batch_size) {
+                    batch->items.push_back(ArenaItem<Item>::create(&batch->arena));
+                    if (!get_item(*batch->items.back())) {
+                        batch->items.pop_back();
+                        more = false;
+                        break;
+                    }
+                }
+                if (batch->items.empty()) {
+                    break;
+                }
+                item_count += batch->items.size();
+                items_in_flight.fetch_add(batch->items.size());
+                {
+                    lock_guard<mutex> lock(active_mutex);
+                    active.push_back(batch);
+                }
+
+                #pragma omp task firstprivate(batch) shared(lambda)
+                {
+                    work(batch, lambda);
+                }
+
+                while (items_in_flight.load() >= max_batches_in_flight * batch_size) {
+                    // Too much is read ahead, so help out instead of reading.
+                    shared_ptr<Batch> other = find_work();
+                    if (other) {
+                        // Only take a little, so we can get back to reading soon.
+                        size_t i = other->next_item.fetch_add(1);
+                        if (i < other->items.size()) {
+                            lambda(*other->items[i]);
+                            items_in_flight.fetch_sub(1);
+                            stolen.fetch_add(1);
+                        }
+                    } else {
+                        // Everything is claimed; wait for it to finish.
+                        #pragma omp taskyield
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+            // The input is done. Let any idle threads help with the
+            // last batches.
+            for (int i = 1; i < omp_get_num_threads(); i++) {
+                #pragma omp task shared(lambda)
+                {
+                    work(nullptr, lambda);
+                }
+            }
+            #pragma omp taskwait
+        }
+    }
+    return item_count;
+}
+
+}
+
+#endif
@@ -3,6 +3,7 @@
  */
 
 #include "dozeu_interface.hpp"
+#include "dozeu_kernels.hpp"
 
 // Configure dozeu:
 // We want the full length bonus included
@@ -28,6 +29,11 @@ enum { MISMATCH = 1, MATCH = 2, INS = 3, DEL = 4 };
 
 using namespace vg;
 
+/// Get the fastest build of the dozeu functions that this CPU supports
+static inline const DozeuKernels& kernels() {
+    return get_dozeu_kernels(false);
+}
+
 XdropAligner::XdropAligner(const XdropAligner& other)
 {
     *this = other;
@@ -38,11 +44,11 @@ XdropAligner& XdropAligner::operator=(const XdropAligner& other)
 	if (this != &other) {
 
         if (dz) {
-            dz_destroy(dz);
+            kernels().destroy(dz);
         }
-        dz = dz_init(other.dz->matrix,
-                     *((const uint16_t*) &other.dz->giv),
-                     *((const uint16_t*) &other.dz->gev));
+        dz = kernels().init(other.dz->matrix, nullptr,
+                            *((const uint16_t*) &other.dz->giv),
+                            *((const uint16_t*) &other.dz->gev));
     }
 
 	return *this;
@@ -57,7 +63,7 @@ XdropAligner& XdropAligner::operator=(XdropAligner&& other)
 {
 	if (this != &other) {
         if (dz) {
-            dz_destroy(dz);
+            kernels().destroy(dz);
         }
         dz = other.dz;
         other.dz = nullptr;
@@ -72,42 +78,42 @@ XdropAligner::XdropAligner(const int8_t* _score_matrix, int8_t _gap_open, int8_t
     // are added when opening a gap
     assert(_gap_open - _gap_extension >= 0);
     assert(_gap_extension > 0);
-    dz = dz_init(_score_matrix, _gap_open - _gap_extension, _gap_extension);
+    dz = kernels().init(_score_matrix, nullptr, _gap_open - _gap_extension, _gap_extension);
 }
 
 XdropAligner::~XdropAligner(void)
 {
-    dz_destroy(dz);
+    kernels().destroy(dz);
 }
 
 dz_query_s* XdropAligner::pack_query_forward(const char* seq, const uint8_t* qual,
                                              int8_t full_length_bonus, size_t len) {
-    return dz_pack_query_forward(dz, seq, full_length_bonus, len);
+    return kernels().pack_query_forward(dz, seq, qual, full_length_bonus, len);
 }
 
 dz_query_s* XdropAligner::pack_query_reverse(const char* seq, const uint8_t* qual,
                                              int8_t full_length_bonus, size_t len) {
-    return dz_pack_query_reverse(dz, seq, full_length_bonus, len);
+    return kernels().pack_query_reverse(dz, seq, qual, full_length_bonus, len);
 }
 
 const dz_forefront_s* XdropAligner::scan(const dz_query_s* query, const dz_forefront_s** forefronts,
                                          size_t n_forefronts, const char* ref, int32_t rlen,
                                          uint32_t rid, uint16_t xt) {
-    return dz_scan(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
+    return kernels().scan(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
 }
 
 const dz_forefront_s* XdropAligner::extend(const dz_query_s* query, const dz_forefront_s** forefronts,
                                            size_t n_forefronts, const char* ref, int32_t rlen,
                                            uint32_t rid, uint16_t xt) {
-    return dz_extend(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
+    return kernels().extend(dz, query, forefronts, n_forefronts, ref, rlen, rid, xt);
 }
 
 dz_alignment_s* XdropAligner::trace(const dz_forefront_s* forefront) {
-    return dz_trace(dz, forefront);
+    return kernels().trace(dz, forefront);
 }
 
 void XdropAligner::flush() {
-    dz_flush(dz);
+    kernels().flush(dz);
 }
 
 /**
@@ -10,6 +10,8 @@
 
 #include "zstdutil.hpp"
 
+#include <zdict.h>
+
 namespace zstdutil {
 
 int CompressString(const std::string& src, std::string& dst, int compressionlevel) {
@@ -136,4 +138,148 @@ int StreamDecompressString(const std::string& src, std::string& dst, int compres
   return 0;
 }
 
+int ParallelCompressString(const std::string& src, std::string& dst, int threads, int compressionlevel) {
+  ZSTD_CCtx* const cctx = ZSTD_createCCtx();
+  if (cctx == nullptr) {
+    return -1;
+  }
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, compressionlevel);
+  if (threads > 1) {
+    // This fails harmlessly if zstd can't use threads, and then we compress
+    // on this thread.
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, threads);
+  }
+  // Record the size so that DecompressString can decompress in one go.
+  ZSTD_CCtx_setPledgedSrcSize(cctx, src.size());
+
+  dst.resize(ZSTD_compressBound(src.size()));
+  size_t const cSize = ZSTD_compress2(cctx, &dst[0], dst.size(), src.data(), src.size());
+  ZSTD_freeCCtx(cctx);
+  if (ZSTD_isError(cSize)) {
+    return -1;
+  }
+  dst.resize(cSize);
+  return 0;
+}
+
+int TrainDictionary(const std::vector<std::string>& samples, std::string& dict, size_t capacity) {
+  std::string concatenated;
+  std::vector<size_t> sizes;
+  sizes.reserve(samples.size());
+  for (const auto& sample : samples) {
+    concatenated.append(sample);
+    sizes.push_back(sample.size());
+  }
+  dict.resize(capacity);
+  size_t const dSize = ZDICT_trainFromBuffer(&dict[0], capacity, concatenated.data(),
+                                             sizes.data(), sizes.size());
+  if (ZDICT_isError(dSize)) {
+    dict.clear();
+    return -1;
+  }
+  dict.resize(dSize);
+  return 0;
+}
+
+Dictionary::Dictionary(const std::string& dict, int compressionlevel)
+    : cdict_(ZSTD_createCDict(dict.data(), dict.size(), compressionlevel)),
+      ddict_(ZSTD_createDDict(dict.data(), dict.size())) {
+}
+
+Dictionary::~Dictionary() {
+  ZSTD_freeCDict(cdict_);
+  ZSTD_freeDDict(ddict_);
+}
+
+namespace {
+
+// Contexts are expensive to make compared to compressing a small record, so
+// each thread keeps one of each around.
+struct ThreadContexts {
+  ZSTD_CCtx* cctx = ZSTD_createCCtx();
+  ZSTD_DCtx* dctx = ZSTD_createDCtx();
+  ~ThreadContexts() {
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+  }
+};
+
+ThreadContexts& GetThreadContexts() {
+  thread_local ThreadContexts contexts;
+  return contexts;
+}
+
+}  // namespace
+
+int Dictionary::CompressString(const std::string& src, std::string& dst) const {
+  if (cdict_ == nullptr) {
+    return -1;
+  }
+  dst.resize(ZSTD_compressBound(src.size()));
+  size_t const cSize = ZSTD_compress_usingCDict(GetThreadContexts().cctx, &dst[0], dst.size(),
+                                                src.data(), src.size(), cdict_);
+  if (ZSTD_isError(cSize)) {
+    return -1;
+  }
+  dst.resize(cSize);
+  return 0;
+}
+
+int Dictionary::DecompressString(const std::string& src, std::string& dst) const {
+  if (ddict_ == nullptr) {
+    return -1;
+  }
+  unsigned long long const rSize = ZSTD_getFrameContentSize(src.data(), src.size());
+  if (rSize == ZSTD_CONTENTSIZE_ERROR || rSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+    return -2;
+  }
+  dst.resize(rSize);
+  size_t const dSize = ZSTD_decompress_usingDDict(GetThreadContexts().dctx, &dst[0], dst.size(),
+                                                  src.data(), src.size(), ddict_);
+  if (ZSTD_isError(dSize)) {
+    return -1;
+  }
+  dst.resize(dSize);
+  return 0;
+}
+
+StreamCompressor::StreamCompressor(std::string& dst, int compressionlevel, int threads)
+    : dst_(dst), buffer_(ZSTD_CStreamOutSize(), '\0'), cctx_(ZSTD_createCCtx()) {
+  ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, compressionlevel);
+  if (threads > 1) {
+    ZSTD_CCtx_setParameter(cctx_, ZSTD_c_nbWorkers, threads);
+  }
+}
+
+StreamCompressor::~StreamCompressor() {
+  ZSTD_freeCCtx(cctx_);
+}
+
+int StreamCompressor::Run(ZSTD_inBuffer& input, ZSTD_EndDirective mode) {
+  if (cctx_ == nullptr) {
+    return -1;
+  }
+  for (;;) {
+    ZSTD_outBuffer output = {&buffer_[0], buffer_.size(), 0};
+    size_t const remaining = ZSTD_compressStream2(cctx_, &output, &input, mode);
+    if (ZSTD_isError(remaining)) {
+      return -1;
+    }
+    dst_.append(buffer_.data(), output.pos);
+    if (mode == ZSTD_e_end ? remaining == 0 : input.pos == input.size) {
+      return 0;
+    }
+  }
+}
+
+int StreamCompressor::Write(const char* data, size_t size) {
+  ZSTD_inBuffer input = {data, size, 0};
+  return Run(input, ZSTD_e_continue);
+}
+
+int StreamCompressor::Finish() {
+  ZSTD_inBuffer input = {nullptr, 0, 0};
+  return Run(input, ZSTD_e_end);
+}
+
 }  // namespace util
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include <zstd.h>
 
 namespace zstdutil {
@@ -32,4 +33,66 @@ int StreamDecompressString(const std::string& src, std::string& dst,
 int StreamCompressString(const std::string& src, std::string& dst,
                          int compressionlevel = DEFAULTCOMPRESSLEVEL);
 
+// Compress with the given number of zstd worker threads, as one frame that
+// DecompressString can read. Falls back to compressing on the calling thread
+// if this zstd was built without multithreading.
+// if return code not 0 is error
+int ParallelCompressString(const std::string& src, std::string& dst, int threads,
+                           int compressionlevel = DEFAULTCOMPRESSLEVEL);
+
+// Train a dictionary of at most capacity bytes on samples of the records it
+// will be used for.
+// if return code not 0 is error
+int TrainDictionary(const std::vector<std::string>& samples, std::string& dict,
+                    size_t capacity = 112640);
+
+// A trained dictionary, digested for compressing and decompressing many small
+// similar records. It can be used from several threads at once.
+class Dictionary {
+ public:
+  explicit Dictionary(const std::string& dict,
+                      int compressionlevel = DEFAULTCOMPRESSLEVEL);
+  ~Dictionary();
+  Dictionary(const Dictionary&) = delete;
+  Dictionary& operator=(const Dictionary&) = delete;
+
+  // if return code not 0 is error
+  int CompressString(const std::string& src, std::string& dst) const;
+
+  // if return code not 0 is error
+  int DecompressString(const std::string& src, std::string& dst) const;
+
+ private:
+  ZSTD_CDict* cdict_;
+  ZSTD_DDict* ddict_;
+};
+
+// Compresses data that arrives in pieces into a single frame, appending the
+// compressed bytes to dst as they are produced. Finish() must be called to end
+// the frame.
+class StreamCompressor {
+ public:
+  explicit StreamCompressor(std::string& dst,
+                            int compressionlevel = DEFAULTCOMPRESSLEVEL,
+                            int threads = 0);
+  ~StreamCompressor();
+  StreamCompressor(const StreamCompressor&) = delete;
+  StreamCompressor& operator=(const StreamCompressor&) = delete;
+
+  // if return code not 0 is error
+  int Write(const char* data, size_t size);
+
+  // if return code not 0 is error
+  int Finish();
+
+ private:
+  // Run the compressor over the input with the given directive until it has
+  // taken all the input, or until the frame is done for ZSTD_e_end.
+  int Run(ZSTD_inBuffer& input, ZSTD_EndDirective mode);
+
+  std::string& dst_;
+  std::string buffer_;
+  ZSTD_CCtx* cctx_;
+};
+
 }  // namespace util
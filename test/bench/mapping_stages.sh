@@ -0,0 +1,17 @@
+#!/bin/bash
+# Benchmark each Giraffe mapping stage on the small test graph and reads.
+# Run from the test directory, with vg on the PATH. Writes the benchmark TSV
+# to standard output; any extra arguments are passed to vg benchmark.
+
+set -e
+
+if [ ! -d small ]; then
+    echo "usage: run $0 from the vg test directory" >&2
+    exit 1
+fi
+
+workdir=$(mktemp -d)
+trap 'rm -rf "$workdir"' EXIT
+
+vg autoindex -r small/x.fa -v small/x.vcf.gz -w giraffe -p "$workdir/x" >&2
+vg benchmark -Z "$workdir/x.giraffe.gbz" -m "$workdir/x.min" -d "$workdir/x.dist" -f small/x.fa_1.fastq "$@"
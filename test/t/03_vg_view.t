@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 22
+plan tests 24
 
 is $(vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz | vg view -d - | wc -l) 505 "view produces the expected number of lines of dot output"
 is $(vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz | vg view -g - | wc -l) 503 "view produces the expected number of lines of GFA output"
@@ -38,6 +38,11 @@ is $(samtools view -u minigiab/NA12878.chr22.tiny.bam | vg view -bG - | vg view
 
 is $(vg view -f ./small/x.fa_1.fastq  ./small/x.fa_2.fastq | vg view -a - | wc -l) 2000 "view can handle fastq input"
 
+vg view -f ./small/x.fa_1.fastq ./small/x.fa_2.fastq > fastq.gam
+is "$(vg view -a fastq.gam --threads 4 | md5sum)" "$(vg view -a fastq.gam | md5sum)" "view writes the same JSON with multiple threads"
+is "$(vg view -a fastq.gam --fields name,sequence | head -n1 | jq -c 'keys')" '["name","sequence"]' "view can render only some fields of alignments"
+rm -f fastq.gam
+
 is $(vg view -Jv ./cyclic/two_node.json | vg view -j - | jq ".edge | length") 4 "view can translate graphs with 2-node cycles"
 
 is $(vg view -g ./cyclic/all.vg | tr '\t' ' ' | grep "4 + 4 -" | wc -l) 1 "view outputs properly oriented GFA"
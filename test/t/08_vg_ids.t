@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 10
+plan tests 12
 
 num_nodes=$(vg construct -r small/x.fa -v small/x.vcf.gz | vg ids -c - | vg view -g - | grep ^S | wc -l)
 
@@ -41,6 +41,12 @@ is $(vg ids -s ids/unordered.vg | vg view -j - | jq -r -c '.node[1] | (.sequence
 is $(vg ids -s ids/unordered.vg | vg stats -r - | awk '{print $2}') $(vg stats -r ids/unordered.vg | awk '{print $2}') "sorting does not affect id range"
 is $(vg convert ids/unordered.vg -v | vg ids -s - | vg stats -r - | awk '{print $2}') $(vg stats -r ids/unordered.vg | awk '{print $2}') "sorting does not affect id range of vg"
 is $(vg convert ids/unordered.vg -a | vg ids -s - | vg stats -r - | awk '{print $2}') $(vg stats -r ids/unordered.vg | awk '{print $2}') "sorting does not affect id range of hg"
+vg combine ids/unordered.vg ids/unordered.vg ids/unordered.vg > components.vg
+is $(vg ids -s -t 4 components.vg | vg view -j - | jq -r -c '.edge[] | select((.from | tonumber) > (.to | tonumber))' | wc -l) 0 "sorting components in parallel removes back-edges in each DAG"
+diff <(vg ids -s -t 1 components.vg | vg view -) <(vg ids -s -t 4 components.vg | vg view -)
+is $? 0 "sorting components in parallel does not depend on the thread count"
+rm components.vg
+
 # this test relies on id sorting being implemented in pg
 #is $(vg convert ids/unordered.vg -p | vg ids -s - | vg stats -r - | awk '{print $2}') $(vg stats -r ids/unordered.vg | awk '{print $2}') "sorting does not affect id range of pg"
 
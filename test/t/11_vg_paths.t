@@ -7,7 +7,7 @@ PATH=../bin:$PATH # for vg
 
 export LC_ALL="C" # force a consistent sort order 
 
-plan tests 20
+plan tests 21
 
 vg construct -r small/x.fa -v small/x.vcf.gz -a > x.vg
 vg construct -r small/x.fa -v small/x.vcf.gz > x2.vg
@@ -39,6 +39,11 @@ vg paths -v x.vg -Q x -F > x_from_vg.fa
 diff x_from_vg.fa small/x.fa
 is $? 0 "Fasta extracted from vg is the same as the input fasta"
 is $(vg paths -x x.xg -g x.gbwt -F | wc -l) 28 "Fasta extracted from threads has correct number of lines"
+vg paths -x x.xg -g x.gbwt -F -U 100-700 > x_sub.fa
+vg paths -x x.xg -g x.gbwt -F -U 100-700 -O x.goff > x_sub_built.fa
+vg paths -x x.xg -g x.gbwt -F -U 100-700 -O x.goff > x_sub_loaded.fa
+diff x_sub.fa x_sub_built.fa && diff x_sub.fa x_sub_loaded.fa
+is $? 0 "thread subranges are the same with and without an offset index"
 
 is $(vg msga -w 20 -f msgas/s.fa | vg paths -v - -r -Q s1 | vg view - | grep ^P | cut -f 3 | sort | uniq | wc -l) 1 "a single path may be retained"
 
@@ -46,7 +51,7 @@ is $(vg msga -w 20 -f msgas/s.fa  | vg paths -v - -r -Q s1 | vg view - | grep -v
 
 is $(vg construct -a -r tiny/tiny.fa -v tiny/tiny.vcf.gz | vg paths -d -a -v - | vg paths -L -v - | wc -l) 1 "alt allele paths can be dropped"
 
-rm -f x.xg x.gbwt x.vg x2.vg x_from_xg.fa x_from_vg.fa q.vg
+rm -f x.xg x.gbwt x.vg x2.vg x_from_xg.fa x_from_vg.fa q.vg x.goff x_sub.fa x_sub_built.fa x_sub_loaded.fa
 
 vg msga -w 20 -f msgas/q.fa  > q.vg
 is $(vg paths -cv q.vg | awk '{print NF; exit}') 4 "vg path coverage has correct number of columns"
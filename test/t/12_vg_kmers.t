@@ -7,7 +7,7 @@ PATH=../bin:$PATH # for vg
 
 export LC_ALL="C" # force a consistent sort order 
 
-plan tests 10
+plan tests 12
 
 is $(vg construct -r small/x.fa -v small/x.vcf.gz | vg kmers -k 11 - | cut -f 1 | sort | uniq | wc -l) \
     4250 \
@@ -29,6 +29,13 @@ is "$(vg kmers -g -k 11 -t 1 x.vg | grep AATAAGGCTTG | cut -f 4,5)" "$(printf 'A
 
 is "$(vg kmers -g -k 11 -t 1 x.vg | grep CATATTAGCCA | cut -f 3)" "G,A" "GCSA2 output works when previous characters are multiple"
 
+vg kmers -k 11 -t 1 -K x1.kff x.vg
+is $? 0 "KFF output can be written"
+vg kmers -k 11 -t 4 -K x4.kff x.vg
+cmp x1.kff x4.kff
+is $? 0 "KFF output does not depend on the thread count"
+rm -f x1.kff x4.kff
+
 rm x.vg
 rm -rf x.vg.index
 
@@ -7,7 +7,7 @@ PATH=../bin:$PATH # for vg
 
 export LC_ALL="C" # force a consistent sort order
 
-plan tests 32
+plan tests 34
 
 is $(vg construct -r small/x.fa -v small/x.vcf.gz | vg mod -k x - | vg view - | grep "^P" | cut -f 3 | grep -o "[0-9]\+" |  wc -l) \
     $(vg construct -r small/x.fa -v small/x.vcf.gz | vg mod -k x - | vg view - | grep "^S" | wc -l) \
@@ -64,6 +64,12 @@ rm -f s.vg s2.vg
 vg msga -f msgas/l.fa -b a1 -w 16 | vg mod -X 8 - | vg validate -
 is $? 0 "chopping self-cycling nodes retains the cycle"
 
+vg msga -f msgas/l.fa -b a1 -w 16 | vg convert -p - > l.pg
+vg mod -c -X 8 l.pg | vg validate -
+is $? 0 "chopping and compacting together produces a valid graph"
+is "$(vg mod -c -X 8 l.pg | vg paths -X -v - | vg view -a - | jq -r '.sequence' | sort | md5sum)" "$(vg mod -X 8 l.pg | vg paths -X -v - | vg view -a - | jq -r '.sequence' | sort | md5sum)" "chopping and compacting together keeps the path sequences"
+rm -f l.pg
+
 vg mod -U 3 graphs/atgclinv2.vg | vg validate -
 is $? 0 "unrolling works and produces a valid graph"
 
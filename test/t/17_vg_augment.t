@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 39
+plan tests 41
 
 vg view -J -v pileup/tiny.json > tiny.vg
 
@@ -81,6 +81,17 @@ vg index -x x.xg -g x.gcsa -k 16 x.vg
 vg map -x x.xg -g x.gcsa -G small/x-s1337-n100-e0.01-i0.005.gam -t 1 >x.gam
 vg augment -Z x.trans -i -S x.vg x.gam >x.mod.vg
 is $(vg view -Z x.trans | wc -l) 1290 "the expected graph translation is exported when the graph is edited"
+vg augment -i -S -t 1 x.vg x.gam -A x.aug1.gam | vg view - > x.aug1.gfa
+vg augment -i -S -t 4 x.vg x.gam -A x.aug4.gam | vg view - > x.aug4.gfa
+diff x.aug1.gfa x.aug4.gfa && diff <(vg view -aj x.aug1.gam) <(vg view -aj x.aug4.gam)
+is "$?" 0 "augmentation does not depend on the thread count"
+rm -f x.aug1.gfa x.aug4.gfa x.aug1.gam x.aug4.gam
+vg gamsort -i x.sorted.gam.gai x.gam >x.sorted.gam
+vg augment -i -S x.vg x.sorted.gam | vg stats -lz - >x.whole.stats
+vg augment -i -S -k 50 x.vg x.sorted.gam | vg stats -lz - >x.chunked.stats
+diff x.whole.stats x.chunked.stats
+is "$?" 0 "augmenting by node ID chunks gives a graph of the same size"
+rm -f x.sorted.gam x.sorted.gam.gai x.whole.stats x.chunked.stats
 rm -rf x.vg x.xg x.gcsa x.reads x.gam x.mod.vg x.trans
 
 vg construct -m 1000 -r tiny/tiny.fa >flat.vg
@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 19
+plan tests 22
 
 # Toy example of hand-made pileup (and hand inspected truth) to make sure some
 # obvious (and only obvious) SNPs are detected by vg call
@@ -35,7 +35,18 @@ vg call  mappedminitest_aug.xg -k mappedminitest_aug.pack > calledminitest.vcf
 L_COUNT=$(cat calledminitest.vcf | grep "#" -v | wc -l)
 is "${L_COUNT}" "1" "Called microinversion"
 
-rm -f miniFastaGraph.vg miniFasta.gam miniFastaGraph.gam calledminitest.vcf  miniFastaGraph.xg miniFastaGraph.gcsa mappedminitest_aug.vg mappedminitest_aug.gam mappedminitest_aug.xg mappedminitest_aug.pack miniFastaGraph.gcsa.lcp
+vg call  mappedminitest_aug.xg -k mappedminitest_aug.pack -u -t 2 > streamedminitest.vcf
+diff calledminitest.vcf streamedminitest.vcf
+is "$?" 0 "Streaming call output is the same as sorted call output"
+
+vg call  mappedminitest_aug.xg -k mappedminitest_aug.pack -D minitest.depth > indexedminitest.vcf
+diff calledminitest.vcf indexedminitest.vcf
+is "$?" 0 "Calling while saving a depth index gives the same output"
+vg call  mappedminitest_aug.xg -k mappedminitest_aug.pack -D minitest.depth > indexedminitest.vcf
+diff calledminitest.vcf indexedminitest.vcf
+is "$?" 0 "Calling with a saved depth index gives the same output"
+
+rm -f miniFastaGraph.vg miniFasta.gam miniFastaGraph.gam calledminitest.vcf streamedminitest.vcf indexedminitest.vcf minitest.depth  miniFastaGraph.xg miniFastaGraph.gcsa mappedminitest_aug.vg mappedminitest_aug.gam mappedminitest_aug.xg mappedminitest_aug.pack miniFastaGraph.gcsa.lcp
 
 vg construct -r inverting/miniFasta.fa -v inverting/miniFasta_VCFinversion.vcf.gz -S > miniFastaGraph.vg
 vg index -x miniFastaGraph.xg -g miniFastaGraph.gcsa miniFastaGraph.vg
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 13
+plan tests 14
 
 vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg  x.vg
@@ -27,6 +27,10 @@ fi
 
 is "${OUT_OF_RANGE}" "0" "vg filter downsamples correctly"
 
+# Filters checked before parsing agree with the full filters used in verbose mode
+PREFIX=$(vg view -aj x.gam | head -n 1 | jq -r '.name' | cut -c1)
+is "$(vg filter -n ${PREFIX} -d 7.5 -t 4 x.gam | vg view -aj - | jq -r '.name' | sort | md5sum)" "$(vg filter -n ${PREFIX} -d 7.5 -v x.gam 2>/dev/null | vg view -aj - | jq -r '.name' | sort | md5sum)" "vg filter prefilters serialized reads correctly"
+
 
 cp small/x-s1-l100-n100-p50.gam paired.gam
 cp small/x-s1-l100-n100.gam single.gam
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 24
+plan tests 25
 
 vg construct -r tiny/tiny.fa -v tiny/tiny.vcf.gz > tiny.vg
 vg index tiny.vg -x tiny.xg
@@ -38,6 +38,12 @@ grep -v "#" hla_decon_path.vcf | awk '{print $1 "\t" $2 "\t" $4 "\t" $5}' | sort
 diff hla_decon.tsv hla_decon_path.tsv
 is "$?" 0 "path-based and exhaustive decontruction give equivalent sites when expected"
 
+vg deconstruct hla.xg -p "gi|568815592:29791752-29792749" -e -F hla_decon_path.fp > hla_decon_path.vcf
+vg deconstruct hla.xg -p "gi|568815592:29791752-29792749" -e -i hla_decon_path.vcf -f hla_decon_path.fp > hla_decon_reused.vcf
+diff hla_decon_path.vcf hla_decon_reused.vcf
+is "$?" 0 "incremental deconstruction of an unchanged graph reuses the prior VCF"
+rm -f hla_decon_path.fp hla_decon_reused.vcf
+
 # want to extract a sample, but bcftools -s doesn't seem to work on travis.  so we torture it out with awk
 SAMPLE_COL=$(grep CHROM hla_decon_path.vcf | tr '\t' '\n' | nl | grep "528476637" | awk '{print $1}')
 is $(grep -v "#" hla_decon_path.vcf | awk -v x="$SAMPLE_COL" '{print $x}' | uniq) 1 "path that differs from reference in every alt has correct genotype"
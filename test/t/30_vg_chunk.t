@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 32
+plan tests 34
 
 # Construct a graph with alt paths so we can make a GBWT and a GBZ
 vg construct -m 1000 -r small/x.fa -v small/x.vcf.gz -a >x.vg
@@ -40,6 +40,17 @@ vg chunk -x x.xg -p x -s 233 -o 50 -b _chunk_test -c 0 -t 1
 is $(ls -l _chunk_test*.vg | wc -l) 6 "-s produces correct number of chunks"
 rm -f _chunk_test*
 
+# overlapping regions out of path order chunk the same with any number of threads
+printf "x\t500\t600\nx\t2\t200\nx\t150\t250\nx\t520\t560\n" > _chunk_test_bed.bed
+vg chunk -x x.xg -e _chunk_test_bed.bed -b _chunk_test -E _chunk_test_out1.bed -c 2 -t 1
+cat _chunk_test_*.vg | md5sum > _chunk_test_sum1.txt
+rm -f _chunk_test_*.vg
+vg chunk -x x.xg -e _chunk_test_bed.bed -b _chunk_test -E _chunk_test_out4.bed -c 2 -t 4
+cat _chunk_test_*.vg | md5sum > _chunk_test_sum4.txt
+diff _chunk_test_out1.bed _chunk_test_out4.bed && diff _chunk_test_sum1.txt _chunk_test_sum4.txt
+is "$?" 0 "chunking overlapping regions is deterministic across thread counts"
+rm -f _chunk_test*
+
 #check that gam chunker runs through without crashing
 vg gamsort small/x-l100-n1000-s10-e0.01-i0.01.gam -i x.sorted.gam.gai > x.sorted.gam
 printf "x\t2\t200\nx\t500\t600\n" > _chunk_test_bed.bed
@@ -123,6 +134,10 @@ cat comp_0_nodes.txt comp_1_nodes.txt | sort > comp_nodes.txt
 cat x_nodes.txt y_nodes.txt | sort > nodes.txt
 diff comp_nodes.txt nodes.txt
 is "$?" 0 "components finds subgraphs"
+vg chunk -x xy.vg -C -b components_chunk -t 2 --target-mem 1
+vg view components_chunk_0.vg components_chunk_1.vg | grep "^S" | awk '{print $3}' | sort > comp_nodes.txt
+diff comp_nodes.txt nodes.txt
+is "$?" 0 "components finds subgraphs within a memory target"
 
 rm -f xy.vg x.vg y.vg x_nodes.txt y_nodes.txt convert path_chunk_x.vg  convert path_chunk_y.vg pc_x_nodes.txt pc_y_nodes.txt x_paths.txt pc_x_paths.txt components_chunk_0.vg components_chunk_1.vg comp_0_nodes.txt comp_1_nodes.txt comp_nodes.txt nodes.txt x.gam y.gam xy.gam path_chunk_x.gam path_chunk_y.gam
 
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 19
+plan tests 20
 
 vg view -J -v snarls/snarls.json > snarls.vg
 vg snarls -t 1 snarls.vg -r st.pb > snarls.pb
@@ -13,7 +13,10 @@ is $(vg view -R snarls.pb | wc -l) 3 "vg snarls made right number of protobuf Sn
 is $(vg view -E st.pb | wc -l) 6 "vg snarls made right number of protobuf SnarlTraversals"
 is $(vg view -R snarls.pb | jq -r '[(.start.node_id | tonumber), (.end.node_id | tonumber)] | min' | tr '\n' ',') "1,3,7," "vg snarls made snarls in the right order"
 
-rm -f snarls.pb st.pb
+vg snarls -t 1 -S snarls.vg > streamed.pb
+is "$(vg view -R streamed.pb)" "$(vg view -R snarls.pb)" "vg snarls streams the same snarls in the same order"
+
+rm -f snarls.pb st.pb streamed.pb
 
 vg index snarls.vg -x snarls.xg
 is $(vg snarls snarls.xg -r st.pb | vg view -R - | wc -l) 3 "vg snarls on xg made right number of protobuf Snarls"
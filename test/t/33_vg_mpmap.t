@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 21
+plan tests 22
 
 
 # Exercise the GBWT
@@ -87,8 +87,10 @@ CAAATAAGGT
 HHHHHHHHHH" > t.fq
 
 is "$(vg mpmap -B -n dna -x t.xg -g t.gcsa -f t.fq | vg view -Kj - | wc -l)" "3" "multipath mapping works in scenarios that trigger branch point trimming"
+rm t.gcsa.lcp
+is "$(vg mpmap -B -n dna -x t.xg -g t.gcsa --no-lcp -f t.fq | vg view -Kj - | wc -l)" "3" "multipath mapping works without the LCP array"
 
-rm t.vg t.xg t.gcsa t.gcsa.lcp t.fq
+rm t.vg t.xg t.gcsa t.fq
 
 # test spliced alignment
 
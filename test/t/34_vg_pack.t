@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 20
+plan tests 21
 
 vg construct -m 1000 -r tiny/tiny.fa >flat.vg
 vg view flat.vg| sed 's/CAAATAAGGCTTGGAAATTTTCTGGAGTTCTATTATATTCCAACTCTCTG/CAAATAAGGCTTGGAAATTTTCTGGAGATCTATTATACTCCAACTCTCTG/' | vg view -Fv - >2snp.vg
@@ -115,7 +115,13 @@ vg map -x flat.vg -g flat.gcsa -s AACTCTCTG | vg view -a - | vg view -JaG - >> f
 vg pack -x flat.vg -o flat.cx -g flat.gam
 is $(vg pack -x flat.vg -i flat.cx -u | awk ' NR>1 {print $2 "\t" $3}' | sort -g | awk '{print $2}' | tr '\n' '-') 20-15-10-10-0-0-0-0-60-60- "average node qualities are correct"
 
-rm -f flat.gam flat.cx 
+vg pack -x flat.vg -m flat.mapped.cx -g flat.gam
+vg pack -x flat.vg -i flat.cx -d -D -u > flat.tsv
+vg pack -x flat.vg -i flat.mapped.cx -d -D -u > flat.mapped.tsv
+diff flat.tsv flat.mapped.tsv
+is "$?" 0 "memory-mapped packs give the same tables as compressed packs"
+
+rm -f flat.gam flat.cx flat.mapped.cx flat.tsv flat.mapped.tsv
 
 vg map -x flat.vg -g flat.gcsa -s CAAATAAGGCTTGGAAATTTTCTGGAGTTCTATTATATTCCAACTCTCTG > span2.gam
 vg map -x flat.vg -g flat.gcsa -s CAGAGAGTTGGAATATAATAGAACTCCAGAAAATTTCCAAGCCTTATTTG >> span2.gam
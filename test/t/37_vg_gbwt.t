@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 159
+plan tests 160
 
 
 # Build vg graphs for two chromosomes
@@ -359,6 +359,7 @@ is $(vg gbwt -c gfa.gbwt) 4 "gfa: 4 threads"
 is $(vg gbwt -C gfa.gbwt) 2 "gfa: 2 contigs"
 is $(vg gbwt -H gfa.gbwt) 2 "gfa: 2 haplotypes"
 is $(vg gbwt -S gfa.gbwt) 1 "gfa: 1 sample"
+is $(vg gbwt -p -o /dev/null -G graphs/components_walks.gfa 2>&1 | grep -c "GFA has 12 segments (12 nodes), 0 paths, and 4 walks") 1 "gfa: lines are counted before construction"
 
 # Build GBWT and GBWTGraph from GFA
 vg gbwt -o gfa2.gbwt -g gfa2.gg --translation gfa2.trans -G graphs/components_walks.gfa
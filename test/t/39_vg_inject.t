@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 12
+plan tests 13
 
 vg construct -r small/x.fa > j.vg
 vg index -x j.xg j.vg
@@ -45,6 +45,8 @@ is "$(samtools view small/x.bam | sort -k 1 | cut -f 6)" "$(vg inject -x x.xg sm
 
 is "$(vg inject -x x.xg small/i.bam | vg view -a - | wc -l)" 470 "vg inject preserves all reads"
 
+is "$(vg inject -x x.xg -t 2 -o gaf small/i.bam | wc -l)" 470 "vg inject can write GAF"
+
 is "$(vg inject -x x.xg small/i.bam | vg view -a - | jq .path.mapping[0].position.is_reverse | grep -v true | wc -l)" \
     0 "vg inject works perfectly for the reads flagged as is_reverse"
 
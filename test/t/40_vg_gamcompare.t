@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 7
+plan tests 9
 
 vg construct -r small/x.fa -v small/x.vcf.gz >s.vg
 vg index -x s.xg -g s.gcsa s.vg
@@ -18,6 +18,11 @@ is $(vg map -x s.xg -g s.gcsa -G s.sim --surject-to sam | vg inject -x s.xg - |
 
 is $(vg gamcompare --range 10 s.sim s.sim | vg view -aj - | jq -c 'select(.correctly_mapped)' | wc -l) 1000 "gamcompare says the truth is correctly mapped"
 
+vg map -x s.xg -g s.gcsa -G s.sim > s.mapped.gam
+is "$(vg gamcompare -T -r 10 s.mapped.gam s.sim | sort | md5sum)" "$(vg gamcompare -T -r 10 -b 7 -t 2 s.mapped.gam s.sim | sort | md5sum)" "gamcompare gives the same TSV when comparing in buckets"
+is "$(vg gamcompare -T -r 10 -d s.dist s.mapped.gam s.sim | sort | md5sum)" "$(vg gamcompare -T -r 10 -d s.dist -b 7 -t 2 s.mapped.gam s.sim | sort | md5sum)" "gamcompare gives the same TSV when comparing in buckets with a distance index"
+rm -f s.mapped.gam
+
 # Map a couple adjacent reads with multi-positioning
 vg map -x s.xg  -g s.gcsa -s "AATCTCTCTGAACTTCAGTTTAATTATC" > read1.gam
 vg annotate -a read1.gam -p -x s.xg > read1.single.gam
@@ -6,7 +6,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 PATH=../bin:$PATH # for vg
 
 
-plan tests 2
+plan tests 5
 
 vg construct -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg  x.vg
@@ -22,5 +22,16 @@ is "$(md5sum <min_ids.gamsorted.txt)" "$(md5sum <min_ids.sorted.txt)" "Sorting a
 vg gamsort x.gam -i x.sorted.gam.gai >x.sorted.gam
 is "$?" "0" "sorted GAMs can be indexed during the sort"
 
+vg gamsort -d -t 2 x.gam | vg view -aj - | jq -r '.path.mapping | ([.[] | .position.node_id | tonumber] | min)' >min_ids.easy.txt
+is "$(md5sum <min_ids.easy.txt)" "$(md5sum <min_ids.sorted.txt)" "Sorting a GAM in memory with multiple threads orders the alignments by min node ID"
 
-rm -f x.vg x.xg x.gam x.sorted.gam x.sorted.2.gam min_ids.gamsorted.txt min_ids.sorted.txt x.sorted.gam.gai x.sorted.2.gam.gai
+
+vg convert -G x.gam x.xg > x.gaf
+vg gamsort -G -i x.sorted.gaf.gz.gai x.gaf > x.sorted.gaf.gz
+zcat x.sorted.gaf.gz | cut -f6 | tr '<>' '  ' | awk '{ m = $1; for (i = 2; i <= NF; i++) if ($i < m) m = $i; print m }' > min_ids.gafsorted.txt
+cut -f6 x.gaf | tr '<>' '  ' | awk '{ m = $1; for (i = 2; i <= NF; i++) if ($i < m) m = $i; print m }' | sort -n > min_ids.gaf.txt
+is "$(md5sum <min_ids.gafsorted.txt)" "$(md5sum <min_ids.gaf.txt)" "Sorting a GAF orders the lines by min node ID"
+is "$(zcat x.sorted.gaf.gz | wc -l)" "$(wc -l < x.gaf)" "Sorting a GAF keeps all the lines"
+
+rm -f x.gaf x.sorted.gaf.gz x.sorted.gaf.gz.gai min_ids.gafsorted.txt min_ids.gaf.txt
+rm -f x.vg x.xg x.gam x.sorted.gam x.sorted.2.gam min_ids.gamsorted.txt min_ids.sorted.txt min_ids.easy.txt x.sorted.gam.gai x.sorted.2.gam.gai
@@ -5,10 +5,12 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 1
+plan tests 3
 
 vg benchmark >/dev/null
 
 is "${?}" "0" "vg benchmark completes succesfully"
 
+is "$(vg benchmark -I -r 1000 -t 2 | grep -c "read BAM")" "6" "vg benchmark reads back BAM at each compression level and thread count"
 
+is "$(vg benchmark -H -t 2 | grep -c "get_step_at_position")" "3" "vg benchmark looks up path positions in each graph that has them"
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 16
+plan tests 18
 
 
 # Indexing a single graph
@@ -55,7 +55,13 @@ is $? 0 "construction with payload"
 #Construction will not be deterministic because the snarls are not deterministic
 #is $(md5sum x.mi | cut -f 1 -d\ ) 6d377fdd427c7173e16e92516bf72b7b "construction is deterministic"
 
-rm -f x.vg x.xg x.gbwt x.snarls x.dist x.mi x.gg x.gbz
+# Partitioned construction does not depend on the number of threads
+vg minimizer --no-dist --partitioned -t 1 -o x.mi -g x.gbwt x.gg
+is $? 0 "partitioned construction"
+vg minimizer --no-dist --partitioned -t 4 -o x.pmi -g x.gbwt x.gg
+is $(md5sum x.pmi | cut -f 1 -d\ ) $(md5sum x.mi | cut -f 1 -d\ ) "partitioned construction is deterministic with multiple threads"
+
+rm -f x.vg x.xg x.gbwt x.snarls x.dist x.mi x.pmi x.gg x.gbz
 
 
 # Indexing two graphs
@@ -7,7 +7,7 @@ PATH=../bin:$PATH # for vg
 
 export LC_ALL="C" # force a consistent sort order
 
-plan tests 106
+plan tests 108
 
 vg construct -r complex/c.fa -v complex/c.vcf.gz > c.vg
 cat <(vg view c.vg | grep ^S | sort) <(vg view c.vg | grep L | uniq | wc -l) <(vg paths -v c.vg -E) > c.info
@@ -71,6 +71,11 @@ vg convert x.vg -F sim-rm.gaf -t 1 | vg convert x.vg -G - -t 1 > sim-rm2.gaf
 diff sim-rm.gaf sim-rm2.gaf
 is "$?" 0 "vg convert gam -> gaf -> gam -> gaf makes same gaf twice"
 
+vg convert --gam-to-gamc sim-rm.gam > sim-rm.gamc
+is "$(vg convert --gamc-to-gam sim-rm.gamc -t 1 | vg view -aj - | md5sum)" "$(vg view -aj sim-rm.gam | md5sum)" "vg convert gam -> gamc -> gam restores the reads"
+is "$(vg stats -a sim-rm.gamc x.vg | grep -v "^Speed" | grep -v "^Total time" | md5sum)" "$(vg stats -a sim-rm.gam x.vg | grep -v "^Speed" | grep -v "^Total time" | md5sum)" "vg stats reads gamc like gam"
+rm -f sim-rm.gamc
+
 vg convert x.vg -G sim-rm.gam | vg convert x.vg -F - | vg convert x.vg -G - | sort > sim-rm2-mt-sort.gaf
 sort sim-rm2.gaf > sim-rm2-sort.gaf
 diff sim-rm2-sort.gaf sim-rm2-mt-sort.gaf
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 50
+plan tests 57
 
 vg construct -a -r small/x.fa -v small/x.vcf.gz >x.vg
 vg index -x x.xg x.vg
@@ -107,6 +107,13 @@ is "$(vg view -aj single.gam | jq -c 'select((.fragment_next | not) and (.fragme
 vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq -f small/x.fa_1.fastq --fragment-mean 300 --fragment-stdev 100 > paired.gam
 is "$(vg view -aj paired.gam | jq -c 'select((.fragment_next | not) and (.fragment_prev | not))' | wc -l)" "0" "paired reads have cross-references"
 
+vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq -t 4 -B 10 --ordered-output -o GAF > ordered.gaf
+is "$(cut -f 1 ordered.gaf)" "$(awk 'NR % 4 == 1' small/x.fa_1.fastq | cut -c 2- | cut -f 1 -d ' ')" "ordered output follows the input order"
+
+vg giraffe x.fa x.vcf.gz -f small/x.fa_1.fastq -t 2 --output-shards sharded.gam
+is "$(vg filter sharded.gam | vg view -a - | wc -l)" "1000" "sharded output can be read back as one input"
+rm -f sharded.gam*
+
 # Test paired surjected mapping
 vg giraffe x.fa x.vcf.gz -iG <(vg view -a small/x-s13241-n1-p500-v300.gam | sed 's%_1%/1%' | sed 's%_2%/2%' | vg view -JaG - ) --output-format SAM >surjected.sam
 is "$(cat surjected.sam | grep -v '^@' | sort -k4 | cut -f 4)" "$(printf '321\n762')" "surjection of paired reads to SAM yields correct positions"
@@ -123,7 +130,7 @@ is "$(cat surjected.sam | grep -v '^@' | cut -f 1 | sort | uniq | wc -l)" "2" "s
 is "$(cat surjected.sam | grep -v '^@' | cut -f 7)" "$(printf '*\n*')" "surjection of unpaired reads to SAM produces absent partner contigs"
 is "$(cat surjected.sam | grep -v '^@' | sort -k4 | cut -f 2)" "$(printf '0\n16')" "surjection of unpaired reads to SAM produces correct flags"
 
-rm -f x.vg x.gbwt x.xg x.min x.dist x.gg x.fa x.fa.fai x.vcf.gz x.vcf.gz.tbi single.gam paired.gam surjected.sam
+rm -f x.vg x.gbwt x.xg x.min x.dist x.gg x.fa x.fa.fai x.vcf.gz x.vcf.gz.tbi single.gam paired.gam ordered.gaf surjected.sam
 rm -f x.giraffe.gbz
 
 rm -f xy.vg xy.gbwt xy.xg xy.min xy.dist xy.gg xy.fa xy.fa.fai xy.vcf.gz xy.vcf.gz.tbi
@@ -204,7 +211,11 @@ cat mapped.gaf | cut -f6 | tr '><' '\n\n' | grep "." | sort | uniq > gaf_names.t
 
 is "$(md5sum gaf_names.txt | cut -f1 -d' ')" "$(md5sum gam_names.txt | cut -f1 -d' ')" "Mapping reads as named GAF uses the same names as named GAM"
 
-rm -f reads.gam mapped.gam mapped.gaf brca.* gam_names.txt gaf_names.txt
+vg giraffe -Z brca.giraffe.gbz -m brca.min -d brca.dist -G reads.gam --max-work 1 > budget.gam
+is "$?" "0" "Mapping reads with a tiny work budget succeeds"
+is "$(vg view -aj budget.gam | jq -r '.score' | grep -v "^0" | grep -v "null" | wc -l)" "200" "Reads still get alignments when the work budget runs out"
+
+rm -f reads.gam mapped.gam mapped.gaf budget.gam brca.* gam_names.txt gaf_names.txt
 
 # Try long read alignment with Distance Index 2
 vg construct -S -a -r 1mb1kgp/z.fa -v 1mb1kgp/z.vcf.gz >1mb1kgp.vg 2>/dev/null
@@ -216,5 +227,10 @@ is "$(vg view -aj longread.gam | jq -r '.score')" "7989" "A long read can be cor
 is "$(vg view -aj longread.gam | jq -c '.path.mapping[].edit[] | select(.sequence)' | wc -l)" "2" "A long read has the correct edits found"
 is "$(vg view -aj longread.gam | jq -c '. | select(.annotation["filter_3_cluster-coverage_cluster_passed_size_total"] <= 300)' | wc -l)" "1" "Long read minimizer set is correctly restricted"
 
-rm -f longread.gam 1mb1kgp.dist 1mb1kgp.giraffe.gbz 1mb1kgp.min log.txt
+vg giraffe -Z 1mb1kgp.giraffe.gbz -f reads/1mb1kgp_longread.fq -U 300 --align-from-chains --dump-problems 1 --compress-dumps >/dev/null
+is "$?" "0" "A long read can be mapped while dumping chaining problems"
+is "$(ls problem*.json.zst 2>/dev/null | wc -l | awk '{print ($1 > 0)}')" "1" "Chaining problem dumps are written compressed"
+is "$(zstd -dc $(ls problem*.json.zst | head -n 1) | jq -r '.items | length > 0')" "true" "Compressed chaining problem dumps hold the problem"
+
+rm -f longread.gam 1mb1kgp.dist 1mb1kgp.giraffe.gbz 1mb1kgp.min log.txt problem*.json.zst
 
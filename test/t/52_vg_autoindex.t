@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 49
+plan tests 56
 
 rm auto.*
 
@@ -35,7 +35,7 @@ rm auto.*
 
 vg autoindex -p auto -w mpmap -w rpvg -r tiny/tiny.fa -v tiny/tiny.vcf.gz -x tiny/tiny.gtf
 is $(echo $?) 0 "autoindexing successfully completes indexing for vg mpmap with unchunked input"
-is $(ls auto.* | wc -l) 6 "autoindexing creates 6 files for mpmap/rpvg"
+is $(ls auto.* | wc -l) 7 "autoindexing creates 7 files for mpmap/rpvg"
 vg sim -x auto.spliced.xg -n 20 -a -l 10 | vg mpmap -x auto.spliced.xg -g auto.spliced.gcsa -d auto.spliced.dist -B -t 1 -G - > /dev/null
 is $(echo $?) 0 "basic autoindexing results can be used by vg mpmap"
 is $(vg paths -g auto.haplotx.gbwt -L | wc -l) 6 "haplotype transcript GBWT made by autoindex is valid"
@@ -45,7 +45,7 @@ rm auto.*
 
 vg autoindex -p auto -w mpmap  -r tiny/tiny.fa -v tiny/tiny.vcf.gz -x tiny/tiny.gtf --force-unphased
 is $(echo $?) 0 "autoindexing successfully completes indexing for vg mpmap with unchunked, unphased input"
-is $(ls auto.* | wc -l) 4 "autoindexing creates 4 files for mpmap/rpvg"
+is $(ls auto.* | wc -l) 5 "autoindexing creates 5 files for mpmap/rpvg"
 vg sim -x auto.spliced.xg -n 20 -a -l 10 | vg mpmap -x auto.spliced.xg -g auto.spliced.gcsa -d auto.spliced.dist -B -t 1 -G - > /dev/null
 is $(echo $?) 0 "basic unphased autoindexing results can be used by vg mpmap"
 
@@ -53,7 +53,7 @@ rm auto.*
 
 vg autoindex -p auto -w mpmap -r tiny/tiny.fa -x tiny/tiny.gtf
 is $(echo $?) 0 "autoindexing successfully completes indexing for vg mpmap without variants"
-is $(ls auto.* | wc -l) 4 "autoindexing creates 4 files for mpmap without variants"
+is $(ls auto.* | wc -l) 5 "autoindexing creates 5 files for mpmap without variants"
 vg sim -x auto.spliced.xg -n 20 -a -l 10 | vg mpmap -x auto.spliced.xg -g auto.spliced.gcsa -d auto.spliced.dist -B -t 1 -G - > /dev/null
 is $(echo $?) 0 "autoindexing results with no variants can be used by vg mpmap"
 
@@ -61,13 +61,13 @@ rm auto.*
 
 vg autoindex -p auto -w mpmap -w rpvg -r small/x.fa -r small/y.fa -v small/x.vcf.gz -v small/y.vcf.gz -x small/x.gtf -x small/y.gtf
 is $(echo $?) 0 "autoindexing successfully completes indexing for vg mpmap with chunked input"
-is $(ls auto.* | wc -l) 6 "autoindexing creates 6 files for mpmap/rpvg with chunked input"
+is $(ls auto.* | wc -l) 7 "autoindexing creates 7 files for mpmap/rpvg with chunked input"
 
 rm auto.*
 
 vg autoindex -p auto -w mpmap -r small/x.fa -r small/y.fa -v small/x.vcf.gz -v small/y.vcf.gz -x small/x.gtf -x small/y.gtf --force-unphased
 is $(echo $?) 0 "autoindexing successfully completes indexing for vg mpmap with unphased chunked input"
-is $(ls auto.* | wc -l) 4 "autoindexing creates 4 files for mpmap/rpvg with chunked input"
+is $(ls auto.* | wc -l) 5 "autoindexing creates 5 files for mpmap/rpvg with chunked input"
 vg sim -x auto.spliced.xg -n 20 -a -l 10 | vg mpmap -x auto.spliced.xg -g auto.spliced.gcsa -d auto.spliced.dist -B -t 1 -G - > /dev/null
 is $(echo $?) 0 "autoindexing results with chunked unphased input can be used by vg mpmap"
 
@@ -134,6 +134,17 @@ printf '@read\nGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGATTACACATTAGGGGGGGGGGGGGGG
 vg giraffe -Z auto.giraffe.gbz -m auto.min -d auto.dist -f read.fq --named-coordinates > read.gam
 is "$(vg view -aj read.gam | jq -r '.path.mapping[].position.name')" "Ishmael" "GFA segment names are available in output GAM when a walk exists"
 
+rm auto.*
+
+rm -rf auto_cache
+vg autoindex -p auto -w giraffe -r tiny/tiny.fa -v tiny/tiny.vcf.gz -C auto_cache 2> /dev/null
+md5sum auto.giraffe.gbz auto.min auto.dist > auto.md5
+rm auto.giraffe.gbz auto.min auto.dist
+is "$(vg autoindex -p auto -w giraffe -r tiny/tiny.fa -v tiny/tiny.vcf.gz -C auto_cache 2>&1 | grep 'Reusing cached' | wc -l)" "$(ls auto_cache | wc -l)" "autoindex reuses every cached recipe result on a rerun"
+is "$(md5sum -c auto.md5 | grep -c OK)" 3 "autoindex restores identical indexes from the cache"
+is "$(vg autoindex -p auto -w giraffe -r tiny/tiny.fa -v tiny/tiny.vcf.gz -C auto_cache --gbwt-buffer-size 5 2>&1 | grep 'Reusing cached' | wc -l)" "$(ls auto_cache | wc -l)" "autoindex cache ignores parameters that don't change index contents"
+
+rm -rf auto_cache auto.md5
 rm auto.*
 rm read.fq read.gam
 
@@ -157,3 +168,13 @@ is "$(echo $?)" 0 "Indexing is successful after rewinding from GCSA2 indexing"
 
 rm auto.*
 rm read.fq read.gam
+
+vg autoindex -p auto -w giraffe -r small/xy.fa -v small/xy2.vcf.gz --partition
+is $(echo $?) 0 "autoindexing successfully completes partitioned indexing for vg giraffe"
+is "$(grep -v '^#' auto.partitions | cut -f1 | tr '\n' ' ')" "x y " "autoindexing lists one partition per contig"
+vg giraffe --partition-list auto.partitions --partition x --ordered-output -f reads/small.middle.ref.fq > part.x.gam
+vg giraffe --partition-list auto.partitions --partition y --ordered-output -f reads/small.middle.ref.fq > part.y.gam
+is "$(vg gammerge part.x.gam part.y.gam | vg view -aj - | jq -r '.name' | sort | uniq | wc -l)" "$(vg view -aj part.x.gam | jq -r '.name' | sort | uniq | wc -l)" "merging partitioned mappings produces one result per read"
+is "$(vg gammerge part.x.gam part.x.gam | vg view -aj - | jq -r 'select(.mapping_quality > 3) | .name' | wc -l)" 0 "reads mapped equally well in two partitions get low MAPQ"
+
+rm auto.* part.x.gam part.y.gam
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 17
+plan tests 18
 
 vg msga -f GRCh38_alts/FASTA/HLA/V-352962.fa -t 1 -k 16 | vg mod -U 10 - | vg mod -c - > hla.vg
 
@@ -46,7 +46,12 @@ vg validate clip.vg
 is "$?" 0 "clipped graph is valid"
 is $(vg view clip.vg | grep ^S | wc -l) "49" "Just one node filtered"
 
-rm -f clip.vg
+vg clip clip.vg -s -P "gi|568815551:1054737-1055734" | vg view - | sort > chained.gfa
+vg clip hla.vg -d 4 -s -P "gi|568815551:1054737-1055734" | vg view - | sort > combined.gfa
+diff chained.gfa combined.gfa
+is "$?" 0 "combining depth and stub clipping is the same as chaining them"
+
+rm -f clip.vg chained.gfa combined.gfa
 
 # clip out out-of-bounds low coverage node
 printf "gi|568815551:1054737-1055734\t5\t25\n" > region.bed
@@ -5,7 +5,7 @@ BASH_TAP_ROOT=../deps/bash-tap
 
 PATH=../bin:$PATH # for vg
 
-plan tests 19
+plan tests 26
 
 # The test graph consists of two subgraphs of the HPRC Minigraph-Cactus v1.1 graph:
 # - GRCh38#chr6:31498145-31511124 (micb)
@@ -45,6 +45,20 @@ is $(vg gbwt -S -Z diploid.gbz) 3 "1 generated + 2 reference samples"
 is $(vg gbwt -C -Z diploid.gbz) 2 "2 contigs"
 is $(vg gbwt -H -Z diploid.gbz) 4 "2 generated + 2 reference haplotypes"
 
+# Count the kmers in the reads instead of using a KFF file
+vg haplotypes --validate -i full.hapl --read-input haplotype-sampling/HG003.fq.gz --include-reference --diploid-sampling -g from_reads.gbz full.gbz
+is $? 0 "diploid sampling with kmers counted from reads"
+is $(vg gbwt -H -Z from_reads.gbz) 4 "2 generated + 2 reference haplotypes"
+
+# Sample multiple samples in one run
+printf "batch_kff.gbz\thaplotype-sampling/HG003.kff\nbatch_reads.gbz\thaplotype-sampling/HG003.fq.gz\n" > samples.tsv
+vg haplotypes --validate -i full.hapl --sample-manifest samples.tsv --include-reference --diploid-sampling full.gbz
+is $? 0 "sampling multiple samples from a manifest"
+cmp batch_kff.gbz diploid.gbz
+is $? 0 "the batch output from a KFF file is identical to sampling it separately"
+cmp batch_reads.gbz from_reads.gbz
+is $? 0 "the batch output from reads is identical to sampling them separately"
+
 # Giraffe integration, guessed output name
 vg giraffe -Z full.gbz --haplotype-name full.hapl --kff-name haplotype-sampling/HG003.kff \
     -f haplotype-sampling/HG003.fq.gz > default.gam 2> /dev/null
@@ -60,9 +74,18 @@ is $? 0 "Giraffe integration with a specified output name"
 cmp full.HG003.gbz sampled.003HG.gbz
 is $? 0 "the sampled graphs are identical"
 
+# Giraffe integration, kmers counted from the reads being mapped
+vg giraffe -Z full.gbz --haplotype-name full.hapl --index-basename counted \
+    -f haplotype-sampling/HG003.fq.gz > counted.gam 2> /dev/null
+is $? 0 "Giraffe integration without a KFF file"
+cmp from_reads.gbz counted.HG003.gbz
+is $? 0 "the sampled graph is identical to one sampled from the reads manually"
+
 # Cleanup
 rm -r full.gbz full.ri full.dist full.hapl
 rm -f indirect.gbz direct.gbz no_ref.gbz
-rm -f diploid.gbz
+rm -f diploid.gbz from_reads.gbz
+rm -f samples.tsv batch_kff.gbz batch_reads.gbz
 rm -f full.HG003.gbz full.HG003.dist full.HG003.min default.gam
 rm -f sampled.003HG.gbz sampled.003HG.dist sampled.003HG.min specified.gam
+rm -f counted.HG003.gbz counted.HG003.dist counted.HG003.min counted.gam